@@ -1,3 +1,4 @@
+#include <sstream>
 #include "AsyncDetector.h"
 
 ///
@@ -47,6 +48,16 @@ AsyncDetector::AsyncDetector(const cv::CommandLineParser& parser)
     m_startFrame = parser.get<int>("start_frame");
     m_endFrame = parser.get<int>("end_frame");
     m_finishDelay = parser.get<int>("end_delay");
+    m_detectorsCount = static_cast<size_t>(std::max(1, parser.get<int>("detectors")));
+    m_gpuIds = parser.get<std::string>("gpu_ids");
+    m_placement.Parse(parser.get<std::string>("affinity"));
+    m_latencyController = std::make_unique<LatencyController>(std::max(0., parser.get<double>("latency_slo")));
+    m_stageLatencies = std::make_unique<latency::StageLatencies>("async_detector", std::max(0., parser.get<double>("latency_slo")));
+    if (!parser.get<std::string>("trace").empty())
+    {
+        trace::Recorder::Instance().Enable();
+        m_traceDumper = std::make_unique<trace::SloDumper>(parser.get<std::string>("trace"), std::max(0., parser.get<double>("latency_slo")));
+    }
 
     m_colors.emplace_back(255, 0, 0);
     m_colors.emplace_back(0, 255, 0);
@@ -76,7 +87,9 @@ void AsyncDetector::Process()
 
     bool stopFlag = false;
 
-    std::thread thCapture(CaptureThread, m_inFile, m_startFrame, &m_fps, &m_framesQue, &stopFlag);
+    TRACE_THREAD_NAME("render");
+    m_placement.Apply("render");
+    std::thread thCapture(CaptureThread, m_inFile, m_startFrame, &m_fps, m_detectorsCount, m_gpuIds, &m_placement, &m_framesQue, m_latencyController.get(), &stopFlag);
 
 #ifndef SILENT_WORK
     cv::namedWindow("Video", cv::WINDOW_NORMAL | cv::WINDOW_KEEPRATIO);
@@ -92,7 +105,11 @@ void AsyncDetector::Process()
 		int64 t1 = cv::getTickCount();
 
         // Show frame after detecting and tracking
-        frame_ptr processedFrame = m_framesQue.GetFirstProcessedFrame();
+        frame_ptr processedFrame;
+        {
+            TRACE_SPAN("wait_processed", "async");
+            processedFrame = m_framesQue.GetFirstProcessedFrame();
+        }
         if (!processedFrame)
         {
             stopFlag = true;
@@ -102,9 +119,16 @@ void AsyncDetector::Process()
         int64 t2 = cv::getTickCount();
 
         allTime += t2 - processedFrame->m_dt;
+        const double latency = 1000. * (t2 - processedFrame->m_dt) / freq;
+        m_latencyController->AddEndToEndLatency(latency);
+        if (m_traceDumper)
+            m_traceDumper->Check(latency);
         int currTime = cvRound(1000 * (t2 - t1) / freq);
 
+        TRACE_SPAN("render", "async");
         DrawData(processedFrame, framesCounter, currTime);
+        processedFrame->m_timestamps.Mark(latency::Stamp::Output);
+        m_stageLatencies->Add(processedFrame->m_timestamps);
 
 		if (!m_outFile.empty())
 		{
@@ -121,6 +145,8 @@ void AsyncDetector::Process()
         int k = cv::waitKey(waitTime);
         if (k == 27)
             break;
+        if ((k == 't' || k == 'T') && m_traceDumper)
+            m_traceDumper->Dump();
 #else
 		std::this_thread::sleep_for(std::chrono::milliseconds(1));
 #endif
@@ -141,6 +167,10 @@ void AsyncDetector::Process()
         thCapture.join();
 
     std::cout << "work time = " << (allTime / freq) << std::endl;
+    m_latencyController->PrintReport();
+    m_stageLatencies->PrintReport();
+    if (m_traceDumper)
+        m_traceDumper->Dump();
 #ifndef SILENT_WORK
 	cv::waitKey(m_finishDelay);
 #endif
@@ -265,11 +295,20 @@ void AsyncDetector::DrawData(frame_ptr frameInfo, int framesCounter, int currTim
 ///
 /// \brief AsyncDetector::CaptureThread
 /// \param fileName
+/// \param startFrame
+/// \param fps
+/// \param detectorsCount - count of the DetectThread workers
+/// \param gpuIds - comma separated GPU ids of the workers
+/// \param placement - affinity of the capture, detect<worker> and tracking threads
 /// \param framesQue
+/// \param latencyController
 /// \param stopFlag
 ///
-void AsyncDetector::CaptureThread(std::string fileName, int startFrame, float* fps, FramesQueue* framesQue, bool* stopFlag)
+void AsyncDetector::CaptureThread(std::string fileName, int startFrame, float* fps, size_t detectorsCount, std::string gpuIds, const affinity::Placement* placement, FramesQueue* framesQue, LatencyController* latencyController, bool* stopFlag)
 {
+    TRACE_THREAD_NAME("capture");
+    // The frames pool is allocated and decoded by this thread: on the NUMA node of the capture
+    placement->Apply("capture");
     cv::VideoCapture capture;
     if (fileName.size() == 1)
         capture.open(atoi(fileName.c_str()));
@@ -352,15 +391,48 @@ void AsyncDetector::CaptureThread(std::string fileName, int startFrame, float* f
     capture >> firstFrame;
 	++frameInd;
 
-    std::thread thDetection(DetectThread, detectorConfig, firstFrame, framesQue, stopFlag);
-    std::thread thTracking(TrackingThread, trackerSettings, framesQue, stopFlag);
+    // The workers take the newest frames concurrently, every one with own detector (and GPU from the gpuIds list)
+    std::vector<std::string> workerGpus;
+    {
+        std::istringstream ids(gpuIds);
+        std::string id;
+        while (std::getline(ids, id, ','))
+        {
+            if (id.find_first_not_of(" \t") != std::string::npos)
+                workerGpus.push_back(id);
+        }
+    }
+    std::vector<std::thread> thDetection;
+    for (size_t i = 0; i < detectorsCount; ++i)
+    {
+        config_t workerConfig = detectorConfig;
+        if (!workerGpus.empty())
+            workerConfig.emplace("gpuId", workerGpus[i % workerGpus.size()]);
+        thDetection.emplace_back(DetectThread, std::move(workerConfig), firstFrame, placement, static_cast<int>(i), framesQue, latencyController, stopFlag);
+    }
+    std::thread thTracking(TrackingThread, trackerSettings, placement, framesQue, latencyController, stopFlag);
+
+    // The frames are returned to the pool after the rendering (or when the queue drops them) and the capture
+    // decodes into their buffers. The frame still shared by somebody (the tracker keeps the UMat) isn't reused
+    constexpr size_t maxQueueSize = 15;
+    RecyclingPool<FrameInfo> framesPool(maxQueueSize + 2, [](FrameInfo& frameInfo)
+    {
+        frameInfo.m_clFrame.release();
+        return RecyclingPool<FrameInfo>::IsExclusive(frameInfo.m_frame);
+    });
 
     // Capture frame
     for (; !(*stopFlag);)
     {
-        frame_ptr frameInfo(new FrameInfo(frameInd));
+        frame_ptr frameInfo = framesPool.Get([frameInd]() { return std::make_unique<FrameInfo>(frameInd); });
+        frameInfo->Reset(frameInd);
         frameInfo->m_dt = cv::getTickCount();
-        capture >> frameInfo->m_frame;
+        frameInfo->m_timestamps.Mark(latency::Stamp::Capture);
+        {
+            TRACE_SPAN("capture", "async");
+            capture >> frameInfo->m_frame;
+        }
+        frameInfo->m_timestamps.Mark(latency::Stamp::Decoded);
         if (frameInfo->m_frame.empty())
         {
             std::cerr << "Frame is empty!" << std::endl;
@@ -371,7 +443,8 @@ void AsyncDetector::CaptureThread(std::string fileName, int startFrame, float* f
 		if (frameInfo->m_clFrame.empty())
 			frameInfo->m_clFrame = frameInfo->m_frame.getUMat(cv::ACCESS_READ);
 
-        framesQue->AddNewFrame(frameInfo, 15);
+        if (!framesQue->AddNewFrame(frameInfo, maxQueueSize))
+            latencyController->AddDropped();
 
 #if 1
         std::this_thread::sleep_for(std::chrono::milliseconds(1000 / cvRound(*fps) - 1));
@@ -381,14 +454,18 @@ void AsyncDetector::CaptureThread(std::string fileName, int startFrame, float* f
 
 		++frameInd;
     }
+    std::cout << "Frames pool: " << framesPool.CreatedCount() << " frames created, " << framesPool.ReusedCount() << " reused" << std::endl;
 
     framesQue->SetBreak(true);
     if (thTracking.joinable())
         thTracking.join();
 
     framesQue->SetBreak(true);
-    if (thDetection.joinable())
-        thDetection.join();
+    for (auto& th : thDetection)
+    {
+        if (th.joinable())
+            th.join();
+    }
 
     framesQue->SetBreak(true);
 }
@@ -397,23 +474,58 @@ void AsyncDetector::CaptureThread(std::string fileName, int startFrame, float* f
 /// \brief AsyncDetector::DetectThread
 /// \param
 ///
-void AsyncDetector::DetectThread(const config_t& config, cv::Mat firstFrame, FramesQueue* framesQue, bool* stopFlag)
+void AsyncDetector::DetectThread(const config_t& config, cv::Mat firstFrame, const affinity::Placement* placement, int workerIndex, FramesQueue* framesQue, LatencyController* latencyController, bool* stopFlag)
 {
+    placement->Apply("detect", workerIndex);
 	cv::UMat ufirst = firstFrame.getUMat(cv::ACCESS_READ);
     std::unique_ptr<BaseDetector> detector = CreateDetector(tracking::Detectors::Yolo_Darknet, config, ufirst);
     detector->SetMinObjectSize(cv::Size(firstFrame.cols / 50, firstFrame.cols / 50));
+    // The motion map isn't drawn: the detections are swapped to the frames without the copy
+    detector->SetMotionMapEnabled(false);
+    TRACE_THREAD_NAME("detect");
 
     for (; !(*stopFlag);)
     {
-        frame_ptr frameInfo = framesQue->GetLastUndetectedFrame();
+        frame_ptr frameInfo;
+        {
+            TRACE_SPAN("wait_undetected", "async");
+            frameInfo = framesQue->GetLastUndetectedFrame();
+        }
         if (frameInfo)
         {
-            detector->Detect(frameInfo->m_clFrame);
-            //std::this_thread::sleep_for(std::chrono::milliseconds(500));
+            cv::Rect roi;
+            const LatencyController::Decision decision = latencyController->Decide(frameInfo->m_dt, frameInfo->m_frame.size(), roi);
+            if (decision == LatencyController::Decision::Predict)
+            {
+                // The tracker predicts the objects on this frame
+                frameInfo->m_inDetector.store(FrameInfo::StateSkipped);
+                framesQue->Signal(frameInfo->m_dt);
+                continue;
+            }
 
-            const regions_t& regions = detector->GetDetects();
-            frameInfo->m_regions.assign(regions.begin(), regions.end());
+            TRACE_SPAN("detect", "async");
+            frameInfo->m_timestamps.Mark(latency::Stamp::DetectStart);
+            int64 t1 = cv::getTickCount();
+            if (decision == LatencyController::Decision::Roi)
+            {
+                detector->Detect(cv::UMat(frameInfo->m_clFrame, roi));
+                detector->TakeDetects(frameInfo->m_regions);
+                for (auto& region : frameInfo->m_regions)
+                {
+                    region.m_brect += roi.tl();
+                    region.m_rrect.center += cv::Point2f(static_cast<float>(roi.x), static_cast<float>(roi.y));
+                }
+            }
+            else
+            {
+                detector->Detect(frameInfo->m_clFrame);
+                detector->TakeDetects(frameInfo->m_regions);
+            }
+            const double areaRatio = (decision == LatencyController::Decision::Roi) ? (static_cast<double>(roi.area()) / frameInfo->m_frame.size().area()) : 1.;
+            latencyController->AddDetectLatency(decision, 1000. * (cv::getTickCount() - t1) / cv::getTickFrequency(), areaRatio);
+            //std::this_thread::sleep_for(std::chrono::milliseconds(500));
 
+            frameInfo->m_timestamps.Mark(latency::Stamp::DetectEnd);
             frameInfo->m_inDetector.store(FrameInfo::StateCompleted);
             framesQue->Signal(frameInfo->m_dt);
         }
@@ -424,18 +536,37 @@ void AsyncDetector::DetectThread(const config_t& config, cv::Mat firstFrame, Fra
 /// \brief AsyncDetector::TrackingThread
 /// \param
 ///
-void AsyncDetector::TrackingThread(const TrackerSettings& settings, FramesQueue* framesQue, bool* stopFlag)
+void AsyncDetector::TrackingThread(const TrackerSettings& settings, const affinity::Placement* placement, FramesQueue* framesQue, LatencyController* latencyController, bool* stopFlag)
 {
+    placement->Apply("tracking");
     std::unique_ptr<BaseTracker> tracker = BaseTracker::CreateTracker(settings);
+    TRACE_THREAD_NAME("tracking");
 
     for (; !(*stopFlag);)
     {
-        frame_ptr frameInfo = framesQue->GetFirstDetectedFrame();
+        frame_ptr frameInfo;
+        {
+            TRACE_SPAN("wait_detected", "async");
+            frameInfo = framesQue->GetFirstDetectedFrame();
+        }
         if (frameInfo)
         {
+            TRACE_SPAN("track", "async");
+            frameInfo->m_timestamps.Mark(latency::Stamp::TrackStart);
+            int64 t1 = cv::getTickCount();
             tracker->Update(frameInfo->m_regions, frameInfo->m_clFrame, frameInfo->m_fps);
 
             tracker->GetTracks(frameInfo->m_tracks);
+            frameInfo->m_timestamps.Mark(latency::Stamp::TrackEnd);
+            latencyController->AddTrackLatency(1000. * (cv::getTickCount() - t1) / cv::getTickFrequency());
+
+            std::vector<cv::Rect> trackedRects;
+            trackedRects.reserve(frameInfo->m_tracks.size());
+            for (const auto& track : frameInfo->m_tracks)
+            {
+                trackedRects.emplace_back(track.m_rrect.boundingRect());
+            }
+            latencyController->SetTrackedRects(std::move(trackedRects));
             frameInfo->m_inTracker.store(FrameInfo::StateCompleted);
             framesQue->Signal(frameInfo->m_dt);
         }
@@ -11,6 +11,11 @@
 
 #include "BaseDetector.h"
 #include "Ctracker.h"
+#include "recycling_pool.h"
+#include "LatencyController.h"
+#include "trace_events.h"
+#include "thread_affinity.h"
+#include "frame_latency.h"
 
 // ----------------------------------------------------------------------
 
@@ -26,6 +31,7 @@ struct FrameInfo
 	int64 m_dt = 0;
 	float m_fps = 0;
 	size_t m_frameInd = 0;
+	latency::FrameTimestamps m_timestamps; // From the capture to the rendering of the tracks
 
 	static constexpr int StateNotProcessed = 0;
 	static constexpr int StateInProcess = 1;
@@ -39,6 +45,23 @@ struct FrameInfo
         : m_frameInd(frameInd), m_inDetector(StateNotProcessed), m_inTracker(StateNotProcessed)
     {
     }
+
+    ///
+    /// \brief Reset
+    /// The frame from the pool gets the new index, the buffer of m_frame is kept for the capture
+    /// \param frameInd
+    ///
+    void Reset(size_t frameInd)
+    {
+        m_regions.clear();
+        m_tracks.clear();
+        m_dt = 0;
+        m_fps = 0;
+        m_frameInd = frameInd;
+        m_timestamps.Reset();
+        m_inDetector.store(StateNotProcessed);
+        m_inTracker.store(StateNotProcessed);
+    }
 };
 
 #include "Queue.h"
@@ -65,6 +88,12 @@ private:
     int m_startFrame = 0;
     int m_endFrame = 0;
     int m_finishDelay = 0;
+    size_t m_detectorsCount = 1;
+    std::string m_gpuIds;
+    affinity::Placement m_placement; // Stages capture, detect<worker>, tracking and render
+    std::unique_ptr<LatencyController> m_latencyController;
+    std::unique_ptr<latency::StageLatencies> m_stageLatencies; // Distributions of the stages and the end-to-end latency
+    std::unique_ptr<trace::SloDumper> m_traceDumper; // Timeline of the threads: on the 't' key, on the latency_slo violation and at the end
     std::vector<cv::Scalar> m_colors;
 
 	FramesQueue m_framesQue;
@@ -73,7 +102,7 @@ private:
 
     void DrawTrack(cv::Mat frame, const TrackingObject& track, bool drawTrajectory = true);
 
-    static void CaptureThread(std::string fileName, int startFrame, float* fps, FramesQueue* framesQue, bool* stopFlag);
-    static void DetectThread(const config_t& config, cv::Mat firstFrame, FramesQueue* framesQue, bool* stopFlag);
-	static void TrackingThread(const TrackerSettings& settings, FramesQueue* framesQue, bool* stopFlag);
+    static void CaptureThread(std::string fileName, int startFrame, float* fps, size_t detectorsCount, std::string gpuIds, const affinity::Placement* placement, FramesQueue* framesQue, LatencyController* latencyController, bool* stopFlag);
+    static void DetectThread(const config_t& config, cv::Mat firstFrame, const affinity::Placement* placement, int workerIndex, FramesQueue* framesQue, LatencyController* latencyController, bool* stopFlag);
+	static void TrackingThread(const TrackerSettings& settings, const affinity::Placement* placement, FramesQueue* framesQue, LatencyController* latencyController, bool* stopFlag);
 };
@@ -0,0 +1,155 @@
+#include <iostream>
+#include <iomanip>
+#include "LatencyController.h"
+
+///
+/// \brief LatencyController::LatencyController
+/// \param targetLatencyMs
+/// \param maxPredicted
+///
+LatencyController::LatencyController(double targetLatencyMs, size_t maxPredicted)
+    : m_targetLatency(targetLatencyMs), m_maxPredicted(maxPredicted)
+{
+    for (auto& decision : m_decisions)
+    {
+        decision = 0;
+    }
+}
+
+///
+/// \brief LatencyController::Ema
+/// \param val
+/// \param newVal
+///
+void LatencyController::Ema(double& val, double newVal)
+{
+    val = (val > 0) ? ((1. - EmaAlpha) * val + EmaAlpha * newVal) : newVal;
+}
+
+///
+/// \brief LatencyController::TrackedRoi
+/// \param frameSize
+/// \return Union of the enlarged rects of the tracked objects or empty rect if the ROI detection doesn't make sense
+///
+cv::Rect LatencyController::TrackedRoi(cv::Size frameSize) const
+{
+    cv::Rect roi;
+    for (const auto& rect : m_trackedRects)
+    {
+        // Objects move between the tracked frame and the current frame
+        cv::Rect bigRect(rect.x - rect.width / 2, rect.y - rect.height / 2, 2 * rect.width, 2 * rect.height);
+        roi = roi.empty() ? bigRect : (roi | bigRect);
+    }
+    roi &= cv::Rect(0, 0, frameSize.width, frameSize.height);
+    // The big ROI isn't faster than the full frame
+    if (roi.area() > 0.6 * frameSize.area())
+        roi = cv::Rect();
+    return roi;
+}
+
+///
+/// \brief LatencyController::Decide
+/// \param captureTicks
+/// \param frameSize
+/// \param roi
+/// \return
+///
+LatencyController::Decision LatencyController::Decide(int64 captureTicks, cv::Size frameSize, cv::Rect& roi)
+{
+    Decision decision = Decision::Full;
+    if (Enabled())
+    {
+        const double frameAge = 1000. * (cv::getTickCount() - captureTicks) / cv::getTickFrequency();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const double budget = m_targetLatency - frameAge - m_trackLatency;
+        if (m_fullLatency <= 0 || m_predictedInRow >= m_maxPredicted || budget >= m_fullLatency)
+        {
+            decision = Decision::Full;
+        }
+        else
+        {
+            roi = TrackedRoi(frameSize);
+            const double areaRatio = static_cast<double>(roi.area()) / frameSize.area();
+            const double roiLatency = ((m_roiLatency > 0) ? m_roiLatency : m_fullLatency) * areaRatio;
+            decision = (!roi.empty() && budget >= roiLatency) ? Decision::Roi : Decision::Predict;
+        }
+        m_predictedInRow = (decision == Decision::Full) ? 0 : (m_predictedInRow + 1);
+    }
+    ++m_decisions[static_cast<int>(decision)];
+    return decision;
+}
+
+///
+/// \brief LatencyController::AddDetectLatency
+/// \param decision
+/// \param ms
+/// \param areaRatio
+///
+void LatencyController::AddDetectLatency(Decision decision, double ms, double areaRatio)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (decision == Decision::Full)
+        Ema(m_fullLatency, ms);
+    else if (decision == Decision::Roi && areaRatio > 0)
+        Ema(m_roiLatency, ms / areaRatio);
+}
+
+///
+/// \brief LatencyController::AddTrackLatency
+/// \param ms
+///
+void LatencyController::AddTrackLatency(double ms)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Ema(m_trackLatency, ms);
+}
+
+///
+/// \brief LatencyController::AddEndToEndLatency
+/// \param ms
+///
+void LatencyController::AddEndToEndLatency(double ms)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_endToEndSum += ms;
+    m_endToEndMax = std::max(m_endToEndMax, ms);
+    ++m_endToEndCount;
+    if (Enabled() && ms > m_targetLatency)
+        ++m_overTarget;
+}
+
+///
+/// \brief LatencyController::AddDropped
+///
+void LatencyController::AddDropped()
+{
+    ++m_dropped;
+}
+
+///
+/// \brief LatencyController::SetTrackedRects
+/// \param rects
+///
+void LatencyController::SetTrackedRects(std::vector<cv::Rect>&& rects)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_trackedRects = std::move(rects);
+}
+
+///
+/// \brief LatencyController::PrintReport
+///
+void LatencyController::PrintReport() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "Latency: target " << m_targetLatency << " ms, mean " << (m_endToEndCount ? (m_endToEndSum / m_endToEndCount) : 0.)
+              << " ms, max " << m_endToEndMax << " ms, over target " << m_overTarget << " of " << m_endToEndCount << " frames" << std::endl;
+    std::cout << "Decisions: full " << m_decisions[static_cast<int>(Decision::Full)].load()
+              << ", roi " << m_decisions[static_cast<int>(Decision::Roi)].load()
+              << ", predict " << m_decisions[static_cast<int>(Decision::Predict)].load()
+              << ", dropped by queue " << m_dropped.load() << std::endl;
+    std::cout << "Stages: detect " << m_fullLatency << " ms (roi " << m_roiLatency << " ms per frame), track " << m_trackLatency << " ms" << std::endl;
+    std::cout << std::defaultfloat;
+}
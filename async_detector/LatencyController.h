@@ -0,0 +1,102 @@
+#pragma once
+
+#include <mutex>
+#include <vector>
+#include <atomic>
+
+#include <opencv2/opencv.hpp>
+
+///
+/// \brief The LatencyController class
+/// Backpressure of the asynchronous pipeline with the target end-to-end latency: the detector decides for the every
+/// frame to run the full detection, the detection only around the tracked objects (ROI) or to skip the detection and
+/// give the frame to the tracker for the prediction. The decisions use the measured latencies of the stages
+///
+class LatencyController
+{
+public:
+    ///
+    enum class Decision
+    {
+        Full = 0,
+        Roi,
+        Predict
+    };
+
+    ///
+    /// \brief LatencyController
+    /// \param targetLatencyMs - target latency from the capture to the rendering, 0 - always full detection
+    /// \param maxPredicted - max count of the frames in a row without the full detection (keeps the estimate fresh)
+    ///
+    LatencyController(double targetLatencyMs, size_t maxPredicted = 25);
+
+    ///
+    bool Enabled() const
+    {
+        return m_targetLatency > 0;
+    }
+
+    ///
+    /// \brief Decide
+    /// \param captureTicks - cv::getTickCount of the frame capture
+    /// \param frameSize
+    /// \param roi - the region for the ROI detection
+    /// \return
+    ///
+    Decision Decide(int64 captureTicks, cv::Size frameSize, cv::Rect& roi);
+
+    ///
+    /// \brief AddDetectLatency
+    /// \param decision - Full or Roi
+    /// \param ms
+    /// \param areaRatio - part of the frame area which was detected
+    ///
+    void AddDetectLatency(Decision decision, double ms, double areaRatio);
+    ///
+    void AddTrackLatency(double ms);
+    ///
+    /// \brief AddEndToEndLatency
+    /// \param ms - from the capture to the rendering of the frame
+    ///
+    void AddEndToEndLatency(double ms);
+    ///
+    /// \brief AddDropped
+    /// The frame which was dropped by the full queue
+    ///
+    void AddDropped();
+
+    ///
+    /// \brief SetTrackedRects
+    /// \param rects - the objects of the last tracked frame
+    ///
+    void SetTrackedRects(std::vector<cv::Rect>&& rects);
+
+    ///
+    /// \brief PrintReport
+    /// The counts of the decisions and the latencies
+    ///
+    void PrintReport() const;
+
+private:
+    double m_targetLatency = 0;
+    size_t m_maxPredicted = 25;
+    static constexpr double EmaAlpha = 0.1;
+
+    mutable std::mutex m_mutex;
+    double m_fullLatency = 0;        // ms
+    double m_roiLatency = 0;         // ms per the whole frame area
+    double m_trackLatency = 0;       // ms
+    size_t m_predictedInRow = 0;
+    std::vector<cv::Rect> m_trackedRects;
+
+    std::atomic<size_t> m_decisions[3];
+    std::atomic<size_t> m_dropped { 0 };
+
+    double m_endToEndSum = 0;
+    double m_endToEndMax = 0;
+    size_t m_endToEndCount = 0;
+    size_t m_overTarget = 0;
+
+    static void Ema(double& val, double newVal);
+    cv::Rect TrackedRoi(cv::Size frameSize) const;
+};
@@ -1,14 +1,15 @@
 #pragma once
 
-#include <queue>
-#include <deque>
-#include <list>
 #include <vector>
+#include <memory>
+#include <cassert>
 #include <algorithm>
 #include <mutex>
 #include <condition_variable>
 #include <atomic>
 
+#include "metrics.h"
+
 #define SHOW_QUE_LOG 0
 #if SHOW_QUE_LOG
 ///
@@ -33,21 +34,22 @@ struct FrameInfo;
 typedef std::shared_ptr<FrameInfo> frame_ptr;
 ///
 /// A threadsafe-queue with Frames
+/// Fixed ring of the frames between the capture (adds to the tail), the detector (takes the newest frame), the tracker
+/// (goes forward through the detected frames) and the renderer (removes from the head). Every index has only one writer
+/// and the frames are claimed by the atomic states, so the threads don't lock each other. The mutex and the condition
+/// variable are used only for the sleeping when there is nothing to do
 ///
 class FramesQueue
 {
-private:
-    typedef std::list<frame_ptr> queue_t;
-
 public:
     ///
     /// \brief FramesQueue
+    /// \param capacity - max count of the frames in the queue
     ///
-    FramesQueue()
-          : m_que(),
-          m_mutex(),
-          m_cond(),
-          m_break(false)
+    explicit FramesQueue(size_t capacity = 16)
+        : m_slots(std::max<size_t>(1, capacity)),
+          m_depthGauge(metrics::Registry::Instance().GetGauge("mtracker_frames_queue_depth", "Frames in the queue between the capture and the rendering")),
+          m_droppedCounter(metrics::Registry::Instance().GetCounter("mtracker_frames_dropped_total", "Frames dropped by the full queue"))
     {}
 
     FramesQueue(const FramesQueue&) = delete;
@@ -60,23 +62,36 @@ public:
 
     ///
     /// \brief AddNewFrame
+    /// Called only from the capture thread, the frame is dropped if the queue is full
     /// \param frameInfo
+    /// \param maxQueueSize - 0 for the queue capacity
+    /// \return false if the frame was dropped
     ///
-    void AddNewFrame(frame_ptr frameInfo, size_t maxQueueSize)
+    bool AddNewFrame(frame_ptr frameInfo, size_t maxQueueSize)
     {
 #if SHOW_QUE_LOG
         QUE_LOG << "AddNewFrame start: " << frameInfo->m_dt << std::endl;
 #endif
-		std::lock_guard<std::mutex> lock(m_mutex);
+        const size_t queueSize = (maxQueueSize > 0) ? std::min(maxQueueSize, m_slots.size()) : m_slots.size();
 
-		if (!maxQueueSize || (maxQueueSize > 0 && m_que.size() < maxQueueSize))
-			m_que.push_back(frameInfo);
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        const bool added = (tail - m_head.load(std::memory_order_acquire) < queueSize);
+        if (added)
+        {
+            std::atomic_store(&Slot(tail), frameInfo);
+            m_tail.store(tail + 1, std::memory_order_release);
+            m_depthGauge.Add(1);
+        }
+        else
+        {
+            m_droppedCounter.Add();
+        }
 
 #if SHOW_QUE_LOG
-		QUE_LOG << "AddNewFrame end: " << frameInfo->m_dt << ", frameInd " << frameInfo->m_frameInd << ", queue size " << m_que.size() << std::endl;
+        QUE_LOG << "AddNewFrame end: " << frameInfo->m_dt << ", frameInd " << frameInfo->m_frameInd << ", queue size " << (m_tail.load() - m_head.load()) << std::endl;
 #endif
-
-		m_cond.notify_all();
+        Signal(frameInfo->m_dt);
+        return added;
     }
 
 #if SHOW_QUE_LOG
@@ -85,26 +100,29 @@ public:
     ///
     void PrintQue()
     {
-        QUE_LOG << "m_que (" << m_que.size() << "): ";
-        size_t i = 0;
-        for (auto it : m_que)
+        const size_t head = m_head.load();
+        const size_t tail = m_tail.load();
+        QUE_LOG << "m_que (" << (tail - head) << "): ";
+        for (size_t i = head; i < tail; ++i)
         {
+            frame_ptr it = std::atomic_load(&Slot(i));
+            if (!it)
+                continue;
             if (it->m_inDetector.load() != FrameInfo::StateNotProcessed && it->m_inTracker.load() != FrameInfo::StateNotProcessed)
-                std::cout << i << " d" << it->m_inDetector.load() << " t" << it->m_inTracker.load() << "; ";
+                std::cout << (i - head) << " d" << it->m_inDetector.load() << " t" << it->m_inTracker.load() << "; ";
             else if (it->m_inDetector.load() != FrameInfo::StateNotProcessed)
-                std::cout << i << " d" << it->m_inDetector.load() << "; ";
+                std::cout << (i - head) << " d" << it->m_inDetector.load() << "; ";
             else if (it->m_inTracker.load() != FrameInfo::StateNotProcessed)
-                std::cout << i << " t" << it->m_inTracker.load() << "; ";
+                std::cout << (i - head) << " t" << it->m_inTracker.load() << "; ";
             else
-                std::cout << i << "; ";
-
-            ++i;
+                std::cout << (i - head) << "; ";
         }
         std::cout << std::endl;
     }
 #endif
     ///
     /// \brief GetLastUndetectedFrame
+    /// Called only from the detector thread: takes the newest frame and skips the older undetected frames
     /// \return
     ///
     frame_ptr GetLastUndetectedFrame()
@@ -112,63 +130,44 @@ public:
 #if SHOW_QUE_LOG
         QUE_LOG << "GetLastUndetectedFrame start" << std::endl;
 #endif
-        std::unique_lock<std::mutex> lock(m_mutex);
-        while (m_que.empty() || m_que.back()->m_inDetector.load() != FrameInfo::StateNotProcessed)
+        frame_ptr frameInfo = WaitFrame([this]() -> frame_ptr
         {
-            if (m_break.load())
-                break;
+            const size_t tail = m_tail.load(std::memory_order_acquire);
+            if (tail == m_head.load(std::memory_order_acquire))
+                return nullptr;
 
-            m_cond.wait(lock);
-            //PrintQue();
-        }
-        if (!m_break.load())
-        {
-            frame_ptr frameInfo = m_que.back();
-            assert(frameInfo->m_inDetector.load() == FrameInfo::StateNotProcessed);
-            assert(frameInfo->m_inTracker.load() == FrameInfo::StateNotProcessed);
-            frameInfo->m_inDetector.store(FrameInfo::StateInProcess);
+            frame_ptr last = std::atomic_load(&Slot(tail - 1));
+            // The renderer took this frame and the capture could fill the slot again
+            if (!last || m_head.load(std::memory_order_acquire) >= tail)
+                return nullptr;
+            int expected = FrameInfo::StateNotProcessed;
+            if (!last->m_inDetector.compare_exchange_strong(expected, FrameInfo::StateInProcess))
+                return nullptr;
+            assert(last->m_inTracker.load() == FrameInfo::StateNotProcessed);
 
-			queue_t::reverse_iterator it = m_que.rbegin();
-			for (++it; it != m_que.rend(); ++it)
-			{
-				if ((*it)->m_inDetector.load() == FrameInfo::StateNotProcessed)
-					(*it)->m_inDetector.store(FrameInfo::StateSkipped);
-				else
-					break;
-			}
-#if SHOW_QUE_LOG
-			PrintQue();
-            QUE_LOG << "GetLastUndetectedFrame end: " << frameInfo->m_dt << ", frameInd " << frameInfo->m_frameInd << std::endl;
-#endif
-            return frameInfo;
-        }
-        return nullptr;
-    }
-
-    ///
-    /// \brief SearchUntracked
-    /// \return
-    ///
-    queue_t::iterator SearchUntracked()
-    {
-        queue_t::iterator res_it = m_que.end();
-        for (queue_t::iterator it = m_que.begin(); it != m_que.end(); ++it)
-        {
-			if ((*it)->m_inDetector.load() == FrameInfo::StateInProcess || (*it)->m_inDetector.load() == FrameInfo::StateNotProcessed)
-			{
-				break;
-			}
-            else if ((*it)->m_inTracker.load() == FrameInfo::StateNotProcessed)
+            for (size_t i = tail - 1; i-- > m_head.load(std::memory_order_acquire);)
             {
-                res_it = it;
-                break;
+                frame_ptr prev = std::atomic_load(&Slot(i));
+                expected = FrameInfo::StateNotProcessed;
+                if (!prev || !prev->m_inDetector.compare_exchange_strong(expected, FrameInfo::StateSkipped))
+                    break;
             }
+            return last;
+        });
+#if SHOW_QUE_LOG
+        if (frameInfo)
+        {
+            PrintQue();
+            QUE_LOG << "GetLastUndetectedFrame end: " << frameInfo->m_dt << ", frameInd " << frameInfo->m_frameInd << std::endl;
         }
-        return res_it;
+#endif
+        return frameInfo;
     }
 
     ///
     /// \brief GetFirstDetectedFrame
+    /// Called only from the tracking thread: the frames are tracked in order, so it waits for the detector on the
+    /// next frame instead of the searching from the head
     /// \return
     ///
     frame_ptr GetFirstDetectedFrame()
@@ -176,33 +175,30 @@ public:
 #if SHOW_QUE_LOG
         QUE_LOG << "GetFirstDetectedFrame start" << std::endl;
 #endif
-        std::unique_lock<std::mutex> lock(m_mutex);
-        queue_t::iterator it = SearchUntracked();
-        while (it == m_que.end())
+        frame_ptr frameInfo = WaitFrame([this]() -> frame_ptr
         {
-            if (m_break.load())
-                break;
+            if (m_trackPos == m_tail.load(std::memory_order_acquire))
+                return nullptr;
 
-            m_cond.wait(lock);
-            it = SearchUntracked();
-            //PrintQue();
-        }
-        if (!m_break.load())
-        {
-            frame_ptr frameInfo = *it;
-            assert(frameInfo->m_inTracker.load() == FrameInfo::StateNotProcessed);
-            assert(frameInfo->m_inDetector.load() != FrameInfo::StateInProcess && frameInfo->m_inDetector.load() != FrameInfo::StateNotProcessed);
-            frameInfo->m_inTracker.store(FrameInfo::StateInProcess);
+            frame_ptr next = std::atomic_load(&Slot(m_trackPos));
+            const int inDetector = next->m_inDetector.load();
+            if (inDetector == FrameInfo::StateInProcess || inDetector == FrameInfo::StateNotProcessed)
+                return nullptr;
+            assert(next->m_inTracker.load() == FrameInfo::StateNotProcessed);
+            next->m_inTracker.store(FrameInfo::StateInProcess);
+            ++m_trackPos;
+            return next;
+        });
 #if SHOW_QUE_LOG
+        if (frameInfo)
             QUE_LOG << "GetFirstDetectedFrame end: " << frameInfo->m_dt << ", frameInd " << frameInfo->m_frameInd << std::endl;
 #endif
-            return frameInfo;
-        }
-        return nullptr;
+        return frameInfo;
     }
 
     ///
     /// \brief GetFirstProcessedFrame
+    /// Called only from the rendering thread: removes the head frame after the tracking
     /// \return
     ///
     frame_ptr GetFirstProcessedFrame()
@@ -210,29 +206,30 @@ public:
 #if SHOW_QUE_LOG
         QUE_LOG << "GetFirstProcessedFrame start" << std::endl;
 #endif
-        std::unique_lock<std::mutex> lock(m_mutex);
-        while (m_que.empty() || m_que.front()->m_inTracker.load() != FrameInfo::StateCompleted)
+        frame_ptr frameInfo = WaitFrame([this]() -> frame_ptr
         {
-            if (m_break.load())
-                break;
+            const size_t head = m_head.load(std::memory_order_relaxed);
+            if (head == m_tail.load(std::memory_order_acquire))
+                return nullptr;
 
-            m_cond.wait(lock);
-            //PrintQue();
-        }
-        if (!m_break.load())
-        {
-            frame_ptr frameInfo = std::move(m_que.front());
-            m_que.pop_front();
+            frame_ptr first = std::atomic_load(&Slot(head));
+            if (first->m_inTracker.load() != FrameInfo::StateCompleted)
+                return nullptr;
+            std::atomic_store(&Slot(head), frame_ptr());
+            m_head.store(head + 1, std::memory_order_release);
+            m_depthGauge.Add(-1);
+            return first;
+        });
 #if SHOW_QUE_LOG
+        if (frameInfo)
             QUE_LOG << "GetFirstProcessedFrame end: " << frameInfo->m_dt << ", frameInd " << frameInfo->m_frameInd << std::endl;
 #endif
-            return frameInfo;
-        }
-        return nullptr;
+        return frameInfo;
     }
 
     ///
     /// \brief Signal
+    /// Wakes up the waiting threads after the frame state was changed
     ///
     void Signal(
 #if SHOW_QUE_LOG
@@ -245,6 +242,11 @@ public:
 #if SHOW_QUE_LOG
         QUE_LOG << "Signal start:" << ts << std::endl;
 #endif
+        m_epoch.fetch_add(1, std::memory_order_acq_rel);
+        {
+            // The waiting thread is either before the epoch check or already sleeps
+            std::lock_guard<std::mutex> lock(m_waitMutex);
+        }
         m_cond.notify_all();
 #if SHOW_QUE_LOG
         QUE_LOG << "Signal end: " << ts << std::endl;
@@ -264,8 +266,45 @@ public:
     }
 
 private:
-    queue_t m_que;
-    mutable std::mutex m_mutex;
+    std::vector<frame_ptr> m_slots;          // Read and written only with std::atomic_load/std::atomic_store
+    std::atomic<size_t> m_head { 0 };        // The oldest frame, written by the renderer
+    std::atomic<size_t> m_tail { 0 };        // The next new frame, written by the capture
+    size_t m_trackPos = 0;                   // The next frame for the tracking, used only by the tracker
+
+    std::atomic<size_t> m_epoch { 0 };
+    std::mutex m_waitMutex;
     std::condition_variable m_cond;
-    std::atomic<bool> m_break;
+    std::atomic<bool> m_break { false };
+
+    metrics::Gauge& m_depthGauge;
+    metrics::Counter& m_droppedCounter;
+
+    ///
+    frame_ptr& Slot(size_t ind)
+    {
+        return m_slots[ind % m_slots.size()];
+    }
+
+    ///
+    /// \brief WaitFrame
+    /// \param tryGet - returns the frame or nullptr if it isn't ready yet, called without lock
+    /// \return nullptr after SetBreak
+    ///
+    template<typename TRY_GET>
+    frame_ptr WaitFrame(TRY_GET tryGet)
+    {
+        for (;;)
+        {
+            const size_t epoch = m_epoch.load(std::memory_order_acquire);
+            if (m_break.load())
+                return nullptr;
+
+            frame_ptr frameInfo = tryGet();
+            if (frameInfo)
+                return frameInfo;
+
+            std::unique_lock<std::mutex> lock(m_waitMutex);
+            m_cond.wait(lock, [this, epoch]() { return m_break.load() || m_epoch.load(std::memory_order_acquire) != epoch; });
+        }
+    }
 };
@@ -1,4 +1,5 @@
 #include "AsyncDetector.h"
+#include "task_scheduler.h"
 
 #include <opencv2/opencv.hpp>
 #include <opencv2/core/ocl.hpp>
@@ -9,9 +10,10 @@ static void Help()
 {
     printf("\nExample of the AsyncDetector\n"
            "Usage: \n"
-           "          ./AsyncDetector <path to movie file> [--start_frame]=<start a video from this position> [--end_frame]=<play a video to this position> [--end_delay]=<delay in milliseconds after video ending> [--out]=<name of result video file> [--show_logs]=<show logs> \n\n"
+           "          ./AsyncDetector <path to movie file> [--start_frame]=<start a video from this position> [--end_frame]=<play a video to this position> [--end_delay]=<delay in milliseconds after video ending> [--out]=<name of result video file> [--show_logs]=<show logs> [--detectors]=<count of the detector workers> [--gpu_ids]=<GPUs of the detector workers> [--latency_slo]=<target latency in milliseconds> [--metrics_file]=<prometheus text file> [--trace]=<timeline json> [--affinity]=<placement of the threads> [--threads]=<threads of the task scheduler> \n\n"
            "Press:\n"
-           "\'m\' key for change mode: play|pause. When video is paused you can press any key for get next frame. \n\n"
+           "\'m\' key for change mode: play|pause. When video is paused you can press any key for get next frame. \n"
+           "\'t\' key dumps the timeline of the --trace. \n\n"
            "Press Esc to exit from video \n\n"
            );
 }
@@ -25,6 +27,13 @@ const char* keys =
     "{ o  out         |                    | Name of result video file | }"
     "{ sl show_logs   |1                   | Show Trackers logs | }"
     "{ g gpu          |0                   | Use OpenCL acceleration | }"
+    "{ dn detectors   |1                   | Count of the detector workers, every worker has own detector and takes the newest frame | }"
+    "{ gi gpu_ids     |                    | Comma separated GPU ids of the detector workers (cycled), empty for the default GPU | }"
+    "{ ls latency_slo |0                   | Target latency from the capture to the rendering in milliseconds: the detector runs the full, ROI-only or no detection (tracker prediction) to keep it, 0 - always full detection, it's the SLA of the frame latency report too | }"
+    "{ tr trace       |                    | Chrome trace_event json with the timeline of the threads (CMake option USE_TRACE_EVENTS): dumped on the 't' key, on the latency_slo violation and at the end | }"
+    "{ mf metrics_file |                   | Prometheus text file with the metrics of the detector, tracker and queues for the node_exporter textfile collector, it's rewritten every second | }"
+    "{ af affinity     |                    | CPU affinity of the threads: stage=cpus[/OpenMP threads] separated by ';', the stages capture, detect<worker>, tracking, render and * (the others), the cpus 0-3,8 or node1 | }"
+    "{ th threads      |0                   | Threads of the task scheduler shared by the parallel loops of the library and OpenCV, 0 - hardware concurrency | }"
 };
 
 // ----------------------------------------------------------------------
@@ -39,6 +48,12 @@ int main(int argc, char** argv)
     cv::ocl::setUseOpenCL(useOCL);
     std::cout << (cv::ocl::useOpenCL() ? "OpenCL is enabled" : "OpenCL not used") << std::endl;
 
+    tasks::InstallOpenCVBackend(static_cast<size_t>(std::max(0, parser.get<int>("threads"))));
+
+    std::unique_ptr<metrics::TextFileExporter> metricsExporter;
+    if (!parser.get<std::string>("metrics_file").empty())
+        metricsExporter = std::make_unique<metrics::TextFileExporter>(parser.get<std::string>("metrics_file"), std::chrono::milliseconds(1000));
+
     AsyncDetector asyncDetector(parser);
 	asyncDetector.Process();
 
@@ -0,0 +1,153 @@
+#include <iostream>
+#include "AsyncVideoWriter.h"
+
+///
+/// \brief AsyncVideoWriter::AsyncVideoWriter
+/// \param fileName
+/// \param fourcc
+/// \param fps
+/// \param frameSize
+/// \param queueSize
+/// \param dropPolicy
+/// \param hwEncode
+///
+AsyncVideoWriter::AsyncVideoWriter(const std::string& fileName, int fourcc, double fps, cv::Size frameSize,
+                                   size_t queueSize, DropPolicy dropPolicy, bool hwEncode)
+    : m_fileName(fileName), m_fourcc(fourcc), m_fps(fps), m_frameSize(frameSize),
+      m_queueSize(std::max<size_t>(1, queueSize)), m_dropPolicy(dropPolicy), m_hwEncode(hwEncode)
+{
+    m_thread = std::thread(&AsyncVideoWriter::WriterThread, this);
+}
+
+///
+/// \brief AsyncVideoWriter::~AsyncVideoWriter
+///
+AsyncVideoWriter::~AsyncVideoWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+        m_notEmpty.notify_all();
+        m_notFull.notify_all();
+    }
+    if (m_thread.joinable())
+        m_thread.join();
+
+    std::cout << "AsyncVideoWriter: " << m_written.load() << " frames written, " << m_dropped.load() << " dropped" << std::endl;
+}
+
+///
+/// \brief AsyncVideoWriter::Write
+/// \param frame
+/// \return
+///
+bool AsyncVideoWriter::Write(const cv::Mat& frame)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_failed)
+        return false;
+
+    if (m_queue.size() >= m_queueSize)
+    {
+        switch (m_dropPolicy)
+        {
+        case DropPolicy::Wait:
+            m_notFull.wait(lock, [this]() { return m_queue.size() < m_queueSize || m_stop || m_failed; });
+            if (m_stop || m_failed)
+                return false;
+            break;
+
+        case DropPolicy::DropNewest:
+            ++m_dropped;
+            return false;
+
+        case DropPolicy::DropOldest:
+            m_freeBuffers.emplace_back(std::move(m_queue.front()));
+            m_queue.pop_front();
+            ++m_dropped;
+            break;
+        }
+    }
+
+    // The caller reuses its frame buffer, so the frame is copied to the buffer of the queue
+    cv::Mat buffer;
+    if (!m_freeBuffers.empty())
+    {
+        buffer = std::move(m_freeBuffers.back());
+        m_freeBuffers.pop_back();
+    }
+    lock.unlock();
+    frame.copyTo(buffer);
+    lock.lock();
+
+    m_queue.emplace_back(std::move(buffer));
+    m_notEmpty.notify_one();
+    return true;
+}
+
+///
+/// \brief AsyncVideoWriter::WriterThread
+///
+void AsyncVideoWriter::WriterThread()
+{
+    cv::VideoWriter writer;
+    if (!OpenWriter(writer, m_fileName, m_fourcc, m_fps, m_frameSize, m_hwEncode))
+    {
+        std::cerr << "AsyncVideoWriter: can't open " << m_fileName << std::endl;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_failed = true;
+        m_notFull.notify_all();
+        return;
+    }
+
+    for (;;)
+    {
+        cv::Mat frame;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_notEmpty.wait(lock, [this]() { return !m_queue.empty() || m_stop; });
+            if (m_queue.empty())
+                break;
+            frame = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+
+        writer << frame;
+        ++m_written;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_freeBuffers.size() < m_queueSize)
+            m_freeBuffers.emplace_back(std::move(frame));
+        m_notFull.notify_one();
+    }
+}
+
+///
+/// \brief AsyncVideoWriter::OpenWriter
+/// \param writer
+/// \param fileName
+/// \param fourcc
+/// \param fps
+/// \param frameSize
+/// \param hwEncode
+/// \return
+///
+bool AsyncVideoWriter::OpenWriter(cv::VideoWriter& writer, const std::string& fileName, int fourcc, double fps, cv::Size frameSize, bool hwEncode)
+{
+#if (CV_VERSION_MAJOR > 4) || ((CV_VERSION_MAJOR == 4) && ((CV_VERSION_MINOR > 5) || ((CV_VERSION_MINOR == 5) && (CV_VERSION_REVISION >= 2))))
+    if (hwEncode)
+    {
+        writer.open(fileName, cv::CAP_ANY, fourcc, fps, frameSize, { cv::VIDEOWRITER_PROP_HW_ACCELERATION, cv::VIDEO_ACCELERATION_ANY });
+        if (writer.isOpened())
+        {
+            std::cout << "Hardware encoding: " << static_cast<int>(writer.get(cv::VIDEOWRITER_PROP_HW_ACCELERATION)) << std::endl;
+            return true;
+        }
+    }
+#else
+    if (hwEncode)
+        std::cerr << "Hardware encoding requires OpenCV 4.5.2 or newer, the software encoding is used" << std::endl;
+#endif
+    writer.open(fileName, fourcc, fps, frameSize, true);
+    return writer.isOpened();
+}
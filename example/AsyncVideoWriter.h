@@ -0,0 +1,99 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+
+#include <opencv2/opencv.hpp>
+
+///
+/// \brief The AsyncVideoWriter class
+/// Encoding of the result video by the separate thread: Write copies the frame to the bounded queue and returns,
+/// so the tracking loop doesn't wait for the encoder and the disk. The buffers of the queue are reused
+///
+class AsyncVideoWriter
+{
+public:
+    ///
+    /// \brief The DropPolicy enum
+    /// Behaviour of Write when the queue is full
+    ///
+    enum class DropPolicy
+    {
+        Wait = 0,   // Write waits for the free place: the result video has the all frames
+        DropNewest, // The new frame isn't written
+        DropOldest  // The oldest queued frame is replaced by the new one
+    };
+
+    ///
+    /// \brief AsyncVideoWriter
+    /// \param fileName
+    /// \param fourcc
+    /// \param fps
+    /// \param frameSize
+    /// \param queueSize - at least 1
+    /// \param dropPolicy
+    /// \param hwEncode - hardware encoder (VIDEOWRITER_PROP_HW_ACCELERATION of OpenCV 4.5.2+)
+    ///
+    AsyncVideoWriter(const std::string& fileName, int fourcc, double fps, cv::Size frameSize,
+                     size_t queueSize, DropPolicy dropPolicy, bool hwEncode);
+    AsyncVideoWriter(const AsyncVideoWriter&) = delete;
+    AsyncVideoWriter& operator=(const AsyncVideoWriter&) = delete;
+    ///
+    /// \brief ~AsyncVideoWriter
+    /// Writes the queued frames and closes the file
+    ///
+    ~AsyncVideoWriter();
+
+    ///
+    /// \brief Write
+    /// \param frame
+    /// \return false if the frame was dropped or the writer isn't opened
+    ///
+    bool Write(const cv::Mat& frame);
+
+    ///
+    size_t WrittenCount() const
+    {
+        return m_written.load();
+    }
+    ///
+    size_t DroppedCount() const
+    {
+        return m_dropped.load();
+    }
+
+    ///
+    /// \brief OpenWriter
+    /// Opens the writer, with hwEncode tries the hardware encoder at first
+    ///
+    static bool OpenWriter(cv::VideoWriter& writer, const std::string& fileName, int fourcc, double fps, cv::Size frameSize, bool hwEncode);
+
+private:
+    std::string m_fileName;
+    int m_fourcc = 0;
+    double m_fps = 25;
+    cv::Size m_frameSize;
+    size_t m_queueSize = 1;
+    DropPolicy m_dropPolicy = DropPolicy::Wait;
+    bool m_hwEncode = false;
+
+    std::deque<cv::Mat> m_queue;
+    std::vector<cv::Mat> m_freeBuffers;
+    bool m_stop = false;
+    bool m_failed = false;
+
+    std::atomic<size_t> m_written { 0 };
+    std::atomic<size_t> m_dropped { 0 };
+
+    std::mutex m_mutex;
+    std::condition_variable m_notEmpty;
+    std::condition_variable m_notFull;
+    std::thread m_thread;
+
+    void WriterThread();
+};
@@ -0,0 +1,290 @@
+#include <iostream>
+#include <fstream>
+#include <cstring>
+
+#include "BinaryResultsLog.h"
+#include "object_types.h"
+
+///
+/// \brief BinaryResultsWriter::BinaryResultsWriter
+/// \param fileName
+/// \param writeEachNFrame
+/// \param flushEachNFrames
+///
+BinaryResultsWriter::BinaryResultsWriter(const std::string& fileName, int writeEachNFrame, int flushEachNFrames)
+    : m_writeEachNFrame(std::max(1, writeEachNFrame)), m_flushEachNFrames(std::max(1, flushEachNFrames))
+{
+    m_file = fopen(fileName.c_str(), "wb");
+    if (!m_file)
+    {
+        std::cerr << "BinaryResultsWriter: can't open " << fileName << std::endl;
+        return;
+    }
+    BinaryHeader header;
+    fwrite(&header, sizeof(header), 1, m_file);
+
+    m_thread = std::thread(&BinaryResultsWriter::WriteThread, this);
+}
+
+///
+/// \brief BinaryResultsWriter::~BinaryResultsWriter
+///
+BinaryResultsWriter::~BinaryResultsWriter()
+{
+    if (!m_file)
+        return;
+
+    Flush();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cond.notify_one();
+    if (m_thread.joinable())
+        m_thread.join();
+
+    fclose(m_file);
+    m_file = nullptr;
+}
+
+///
+/// \brief BinaryResultsWriter::AddTrack
+/// \param framesCounter
+/// \param trackID
+/// \param brect
+/// \param type
+/// \param confidence
+/// \return
+///
+bool BinaryResultsWriter::AddTrack(int framesCounter, track_id_t trackID, const cv::Rect& brect, objtype_t type, float confidence)
+{
+    if (!m_file)
+        return false;
+
+    if (framesCounter != m_lastFrame)
+    {
+        m_lastFrame = framesCounter;
+        if (++m_framesInBuffer > m_flushEachNFrames)
+            Flush();
+    }
+    if (framesCounter % m_writeEachNFrame != 0)
+        return true;
+
+    BinaryRecord record;
+    record.m_frame = framesCounter;
+    record.m_kind = BinaryRecord::KindDetection;
+    record.m_trackID = static_cast<uint64_t>(trackID.m_val);
+    record.m_x = brect.x;
+    record.m_y = brect.y;
+    record.m_width = brect.width;
+    record.m_height = brect.height;
+    record.m_type = type;
+    record.m_conf = confidence;
+    m_records.emplace_back(record);
+    return true;
+}
+
+///
+/// \brief BinaryResultsWriter::AddRobustTrack
+/// \param framesCounter
+/// \param trackID
+///
+void BinaryResultsWriter::AddRobustTrack(int framesCounter, track_id_t trackID)
+{
+    if (!m_file)
+        return;
+
+    if (m_robustIDs.size() >= MaxRobustIDs)
+        m_robustIDs.clear();
+    if (!m_robustIDs.insert(trackID).second)
+        return;
+
+    BinaryRecord record;
+    record.m_frame = framesCounter;
+    record.m_kind = BinaryRecord::KindRobustID;
+    record.m_trackID = static_cast<uint64_t>(trackID.m_val);
+    m_records.emplace_back(record);
+}
+
+///
+/// \brief BinaryResultsWriter::Flush
+///
+void BinaryResultsWriter::Flush()
+{
+    m_framesInBuffer = 0;
+    if (!m_file || m_records.empty())
+        return;
+
+    std::vector<BinaryRecord> records;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_toWrite.emplace_back(std::move(m_records));
+        if (!m_freeBuffers.empty())
+        {
+            records = std::move(m_freeBuffers.back());
+            m_freeBuffers.pop_back();
+        }
+    }
+    m_cond.notify_one();
+
+    records.clear();
+    m_records = std::move(records);
+}
+
+///
+/// \brief BinaryResultsWriter::WriteThread
+///
+void BinaryResultsWriter::WriteThread()
+{
+    for (;;)
+    {
+        std::vector<BinaryRecord> records;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cond.wait(lock, [this]() { return m_stop || !m_toWrite.empty(); });
+            if (m_toWrite.empty())
+                break;
+            records = std::move(m_toWrite.front());
+            m_toWrite.pop_front();
+        }
+
+        if (fwrite(records.data(), sizeof(BinaryRecord), records.size(), m_file) != records.size())
+            std::cerr << "BinaryResultsWriter: write error" << std::endl;
+        fflush(m_file);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_freeBuffers.size() < 2)
+            m_freeBuffers.emplace_back(std::move(records));
+    }
+}
+
+///
+/// \brief BinaryResultsReader::~BinaryResultsReader
+///
+BinaryResultsReader::~BinaryResultsReader()
+{
+    if (m_file)
+        fclose(m_file);
+}
+
+///
+/// \brief BinaryResultsReader::Rewind
+/// \return false if the file has the wrong header
+///
+bool BinaryResultsReader::Rewind()
+{
+    fseek(m_file, 0, SEEK_SET);
+    m_block.clear();
+    m_blockPos = 0;
+
+    BinaryHeader header;
+    BinaryHeader expected;
+    if (fread(&header, sizeof(header), 1, m_file) != 1 ||
+            memcmp(header.m_magic, expected.m_magic, sizeof(header.m_magic)) != 0 ||
+            header.m_recordSize != sizeof(BinaryRecord))
+    {
+        std::cerr << "BinaryResultsReader: " << m_fileName << " has wrong format" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+///
+/// \brief BinaryResultsReader::ReadRecord
+/// \param record
+/// \return
+///
+bool BinaryResultsReader::ReadRecord(BinaryRecord& record)
+{
+    if (m_blockPos >= m_block.size())
+    {
+        constexpr size_t BlockSize = 4096;
+        m_block.resize(BlockSize);
+        m_block.resize(fread(m_block.data(), sizeof(BinaryRecord), BlockSize, m_file));
+        m_blockPos = 0;
+        if (m_block.empty())
+            return false;
+    }
+    record = m_block[m_blockPos++];
+    return true;
+}
+
+///
+/// \brief BinaryResultsReader::Open
+/// \param robustOnly
+/// \return
+///
+bool BinaryResultsReader::Open(bool robustOnly)
+{
+    if (m_file)
+        fclose(m_file);
+    m_file = fopen(m_fileName.c_str(), "rb");
+    if (!m_file)
+    {
+        std::cerr << "BinaryResultsReader: can't open " << m_fileName << std::endl;
+        return false;
+    }
+    m_robustOnly = robustOnly;
+    m_robustIDs.clear();
+    if (!Rewind())
+        return false;
+
+    if (m_robustOnly)
+    {
+        // The tracks become robust later than their first detections, so the IDs are collected before the reading
+        BinaryRecord record;
+        while (ReadRecord(record))
+        {
+            if (record.m_kind == BinaryRecord::KindRobustID)
+                m_robustIDs.insert(record.m_trackID);
+        }
+        return Rewind();
+    }
+    return true;
+}
+
+///
+/// \brief BinaryResultsReader::Read
+/// \param record
+/// \return
+///
+bool BinaryResultsReader::Read(BinaryRecord& record)
+{
+    if (!m_file)
+        return false;
+
+    while (ReadRecord(record))
+    {
+        if (record.m_kind != BinaryRecord::KindDetection)
+            continue;
+        if (!m_robustOnly || m_robustIDs.find(record.m_trackID) != std::end(m_robustIDs))
+            return true;
+    }
+    return false;
+}
+
+///
+/// \brief BinaryResultsReader::ExportCsv
+/// \param csvFileName
+/// \return
+///
+size_t BinaryResultsReader::ExportCsv(const std::string& csvFileName)
+{
+    std::ofstream resCSV(csvFileName);
+    if (!resCSV.is_open())
+    {
+        std::cerr << "BinaryResultsReader: can't open " << csvFileName << std::endl;
+        return 0;
+    }
+    size_t count = 0;
+    char delim = ',';
+    BinaryRecord record;
+    while (Read(record))
+    {
+        resCSV << record.m_frame << delim << TypeConverter::Type2Str(record.m_type) << delim << record.m_x << delim << record.m_y << delim <<
+            record.m_width << delim << record.m_height << delim <<
+            record.m_conf << delim << record.m_trackID << "\n";
+        ++count;
+    }
+    return count;
+}
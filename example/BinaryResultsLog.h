@@ -0,0 +1,164 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdint>
+#include <vector>
+#include <deque>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_set>
+
+#include <opencv2/opencv.hpp>
+
+#include "defines.h"
+
+///
+/// \brief The BinaryRecord struct
+/// Fixed size record of the binary results file. The file is the header and the array of the records,
+/// so it can be memory mapped or read by the blocks
+///
+#pragma pack(push, 1)
+struct BinaryRecord
+{
+    static constexpr uint32_t KindDetection = 0;
+    static constexpr uint32_t KindRobustID = 1; // The track became robust, only m_frame and m_trackID are valid
+
+    int32_t m_frame = 0;
+    uint32_t m_kind = KindDetection;
+    uint64_t m_trackID = 0;
+    int32_t m_x = 0;
+    int32_t m_y = 0;
+    int32_t m_width = 0;
+    int32_t m_height = 0;
+    int32_t m_type = -1;
+    float m_conf = 0.f;
+};
+
+///
+/// \brief The BinaryHeader struct
+///
+struct BinaryHeader
+{
+    char m_magic[4] = { 'M', 'T', 'R', 'B' };
+    uint32_t m_version = 1;
+    uint32_t m_recordSize = sizeof(BinaryRecord);
+    uint32_t m_reserved = 0;
+};
+#pragma pack(pop)
+
+///
+/// \brief The BinaryResultsWriter class
+/// Streaming writer of the tracking results: the records are appended to the buffer and the background thread
+/// writes the buffer to the file every flushEachNFrames frames. The memory doesn't grow with the length of the video,
+/// the robust IDs filter of ResultsLog is applied by BinaryResultsReader after the fact
+///
+class BinaryResultsWriter
+{
+public:
+    ///
+    /// \brief BinaryResultsWriter
+    /// \param fileName
+    /// \param writeEachNFrame - the detections of the other frames aren't written
+    /// \param flushEachNFrames
+    ///
+    BinaryResultsWriter(const std::string& fileName, int writeEachNFrame, int flushEachNFrames = 100);
+    BinaryResultsWriter(const BinaryResultsWriter&) = delete;
+    BinaryResultsWriter& operator=(const BinaryResultsWriter&) = delete;
+    ///
+    /// \brief ~BinaryResultsWriter
+    /// Writes the buffered records and closes the file
+    ///
+    ~BinaryResultsWriter();
+
+    ///
+    bool IsOpened() const
+    {
+        return m_file != nullptr;
+    }
+
+    ///
+    bool AddTrack(int framesCounter, track_id_t trackID, const cv::Rect& brect, objtype_t type, float confidence);
+    ///
+    void AddRobustTrack(int framesCounter, track_id_t trackID);
+
+    ///
+    /// \brief Flush
+    /// Gives the buffered records to the writing thread
+    ///
+    void Flush();
+
+private:
+    FILE* m_file = nullptr;
+    int m_writeEachNFrame = 1;
+    int m_flushEachNFrames = 100;
+
+    std::vector<BinaryRecord> m_records;
+    int m_lastFrame = -1;
+    int m_framesInBuffer = 0;
+
+    // IDs which were already marked robust, cleared when it's too big: the duplicated marks are ignored by the reader
+    std::unordered_set<track_id_t> m_robustIDs;
+    static constexpr size_t MaxRobustIDs = 100000;
+
+    std::deque<std::vector<BinaryRecord>> m_toWrite;
+    std::vector<std::vector<BinaryRecord>> m_freeBuffers;
+    bool m_stop = false;
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    std::thread m_thread;
+
+    void WriteThread();
+};
+
+///
+/// \brief The BinaryResultsReader class
+/// Reader of the BinaryResultsWriter file: the first pass collects the robust IDs, Read returns only their detections
+/// like the csv of ResultsLog
+///
+class BinaryResultsReader
+{
+public:
+    ///
+    BinaryResultsReader(const std::string& fileName)
+        : m_fileName(fileName)
+    {
+    }
+    ///
+    ~BinaryResultsReader();
+
+    ///
+    /// \brief Open
+    /// \param robustOnly - Read skips the detections of the not robust tracks
+    /// \return
+    ///
+    bool Open(bool robustOnly = true);
+
+    ///
+    /// \brief Read
+    /// \param record - the next detection of the file
+    /// \return false at the end of the file
+    ///
+    bool Read(BinaryRecord& record);
+
+    ///
+    /// \brief ExportCsv
+    /// Writes the detections in the csv format of ResultsLog: frame,type,x,y,width,height,confidence,ID
+    /// \param csvFileName
+    /// \return count of the written detections
+    ///
+    size_t ExportCsv(const std::string& csvFileName);
+
+private:
+    std::string m_fileName;
+    FILE* m_file = nullptr;
+    bool m_robustOnly = true;
+    std::unordered_set<uint64_t> m_robustIDs;
+
+    std::vector<BinaryRecord> m_block;
+    size_t m_blockPos = 0;
+
+    bool ReadRecord(BinaryRecord& record);
+    bool Rewind();
+};
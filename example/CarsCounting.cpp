@@ -14,6 +14,7 @@ CarsCounting::CarsCounting(const cv::CommandLineParser& parser)
 #endif
 
 	m_drawHeatMap = parser.get<int>("heat_map") != 0;
+	m_heatMapScale = std::max(1, parser.get<int>("heat_map_scale"));
 
 	m_weightsFile = parser.get<std::string>("weights");
 	m_configFile = parser.get<std::string>("config");
@@ -51,8 +52,8 @@ void CarsCounting::DrawTrack(cv::Mat frame, const TrackingObject& track, bool dr
 {
     cv::Rect brect = track.m_rrect.boundingRect();
 
-    m_resultsLog.AddTrack(framesCounter, track.m_ID, brect, track.m_type, track.m_confidence);
-	m_resultsLog.AddRobustTrack(track.m_ID);
+    if (!m_headless)
+        LogTrack(framesCounter, track);
 
     if (track.m_isStatic)
     {
@@ -74,8 +75,8 @@ void CarsCounting::DrawTrack(cv::Mat frame, const TrackingObject& track, bool dr
 		{
             int traceSize = static_cast<int>(track.m_trace.size());
             int period = std::min(2 * cvRound(m_fps), traceSize);
-            const auto& from = m_geoParams.Pix2Geo(track.m_trace[traceSize - period]);
-            const auto& to = m_geoParams.Pix2Geo(track.m_trace[traceSize - 1]);
+            const auto from = m_geoParams.Pix2GeoLut(track.m_trace[traceSize - period]);
+            const auto to = m_geoParams.Pix2GeoLut(track.m_trace[traceSize - 1]);
 			auto dist = DistanceInMeters(from, to);
 
 			std::stringstream label;
@@ -224,7 +225,9 @@ bool CarsCounting::InitTracker(cv::UMat frame)
             m_keyFrame = frame.getMat(cv::ACCESS_READ).clone();
         else
             cv::cvtColor(frame, m_keyFrame, cv::COLOR_GRAY2BGR);
-        m_heatMap = cv::Mat(m_keyFrame.size(), CV_32FC1, cv::Scalar::all(0));
+        // Difference array of the grid: the rect changes 4 values, the map is restored by the integral on the drawing
+        cv::Size gridSize((m_keyFrame.cols + m_heatMapScale - 1) / m_heatMapScale, (m_keyFrame.rows + m_heatMapScale - 1) / m_heatMapScale);
+        m_heatMap = cv::Mat(gridSize.height + 1, gridSize.width + 1, CV_32FC1, cv::Scalar::all(0));
     }
 
     const int minStaticTime = 5;
@@ -271,6 +274,7 @@ bool CarsCounting::InitTracker(cv::UMat frame)
     std::vector<cv::Point2f> geoPoints{ cv::Point2f(30.258855, 60.006536), cv::Point2f(30.258051, 60.006855), cv::Point2f(30.258080, 60.007414), cv::Point2f(30.259066, 60.007064) };
 #endif
     m_geoParams.SetKeyPoints(framePoints, geoPoints);
+    m_geoParams.BuildLut(frame.size());
 #endif
     return true;
 }
@@ -308,7 +312,8 @@ void CarsCounting::DrawData(cv::Mat frame, const std::vector<TrackingObject>& tr
             {
                 DrawTrack(frame, track, true, framesCounter);
 
-                CheckLinesIntersection(track, static_cast<float>(frame.cols), static_cast<float>(frame.rows));
+                if (!m_headless)
+                    CheckLinesIntersection(track, static_cast<float>(frame.cols), static_cast<float>(frame.rows), framesCounter);
             }
         }
     }
@@ -319,9 +324,35 @@ void CarsCounting::DrawData(cv::Mat frame, const std::vector<TrackingObject>& tr
         rl.Draw(frame);
     }
 
-	cv::Mat heatMap = DrawHeatMap();
-	if (!heatMap.empty())
-		cv::imshow("Heat map", heatMap);
+	if (!m_headless)
+	{
+		cv::Mat heatMap = DrawHeatMap();
+		if (!heatMap.empty())
+			cv::imshow("Heat map", heatMap);
+	}
+}
+
+///
+/// \brief CarsCounting::HeadlessData
+/// \param tracks
+/// \param frameSize
+/// \param framesCounter
+/// \param currTime
+///
+void CarsCounting::HeadlessData(const std::vector<TrackingObject>& tracks, cv::Size frameSize, int framesCounter, int currTime)
+{
+    VideoExample::HeadlessData(tracks, frameSize, framesCounter, currTime);
+
+    for (const auto& track : tracks)
+    {
+        if (!track.m_isStatic &&
+                track.IsRobust(cvRound(m_fps / 4),          // Minimal trajectory size
+                               0.8f,                        // Minimal ratio raw_trajectory_points / trajectory_lenght
+                               cv::Size2f(0.1f, 8.0f)))     // Min and max ratio: width / height
+        {
+            CheckLinesIntersection(track, static_cast<float>(frameSize.width), static_cast<float>(frameSize.height), framesCounter);
+        }
+    }
 }
 
 ///
@@ -331,6 +362,7 @@ void CarsCounting::DrawData(cv::Mat frame, const std::vector<TrackingObject>& tr
 void CarsCounting::AddLine(const RoadLine& newLine)
 {
     m_lines.push_back(newLine);
+    m_linesIndexDirty = true;
 }
 
 ///
@@ -365,26 +397,89 @@ bool CarsCounting::RemoveLine(unsigned int lineUid)
         else
             ++it;
     }
+    m_linesIndexDirty = true;
     return false;
 }
 
+///
+/// \brief CarsCounting::SetCrossingCallback
+/// \param callback
+///
+void CarsCounting::SetCrossingCallback(std::function<void(const LineCrossing&)> callback)
+{
+    m_crossingCallback = std::move(callback);
+}
+
 ///
 /// \brief CarsCounting::CheckLinesIntersection
 /// \param track
+/// \param xMax
+/// \param yMax
+/// \param framesCounter
 ///
-void CarsCounting::CheckLinesIntersection(const TrackingObject& track, float xMax, float yMax)
+void CarsCounting::CheckLinesIntersection(const TrackingObject& track, float xMax, float yMax, int framesCounter)
 {
     auto Pti2f = [&](cv::Point pt) -> cv::Point2f
     {
         return cv::Point2f(pt.x / xMax, pt.y / yMax);
     };
 
+    if (m_linesIndexDirty)
+    {
+        m_linesIndex.Build(m_lines);
+        m_linesIndexDirty = false;
+    }
+
+    // The points of the lost tracks are removed
+    constexpr int pruneFrames = 100;
+    if (framesCounter - m_lastPruneFrame > pruneFrames)
+    {
+        for (auto it = std::begin(m_checkedPoints); it != std::end(m_checkedPoints);)
+        {
+            if (framesCounter - it->second.m_frameInd > pruneFrames)
+                it = m_checkedPoints.erase(it);
+            else
+                ++it;
+        }
+        m_lastPruneFrame = framesCounter;
+    }
+
 	constexpr size_t minTrack = 5;
 	if (track.m_trace.size() >= minTrack)
 	{
-		for (auto& rl : m_lines)
+        const Point_t& lastPt = track.m_trace[track.m_trace.size() - 1];
+        auto checked = m_checkedPoints.find(track.m_ID);
+        if (checked != std::end(m_checkedPoints))
+        {
+            checked->second.m_frameInd = framesCounter;
+            if (checked->second.m_pt == lastPt)
+                return;
+            checked->second.m_pt = lastPt;
+        }
+        else
+        {
+            m_checkedPoints.emplace(track.m_ID, CheckedPoint{ lastPt, framesCounter });
+        }
+
+        const cv::Point2f pt1 = Pti2f(track.m_trace[track.m_trace.size() - minTrack]);
+        const cv::Point2f pt2 = Pti2f(lastPt);
+        m_linesIndex.Query(pt1, pt2, m_candidateLines);
+		for (size_t lineInd : m_candidateLines)
 		{
-            rl.IsIntersect(track.m_ID, Pti2f(track.m_trace[track.m_trace.size() - minTrack]), Pti2f(track.m_trace[track.m_trace.size() - 1]));
+            RoadLine& rl = m_lines[lineInd];
+            int direction = rl.IsIntersect(track.m_ID, pt1, pt2);
+            if (direction)
+            {
+                LineCrossing crossing;
+                crossing.m_lineUid = rl.m_uid;
+                crossing.m_trackID = track.m_ID;
+                crossing.m_direction = direction;
+                crossing.m_frameInd = framesCounter;
+                if (m_crossingCallback)
+                    m_crossingCallback(crossing);
+                else if (m_showLogs)
+                    std::cout << "Frame " << framesCounter << ": track " << track.m_ID.ID2Str() << " crossed line " << rl.m_uid << " in direction " << direction << std::endl;
+            }
 		}
 	}
 }
@@ -397,7 +492,10 @@ cv::Mat CarsCounting::DrawHeatMap()
 	cv::Mat res;
 	if (!m_heatMap.empty())
 	{
-		cv::normalize(m_heatMap, m_normHeatMap, 255, 0, cv::NORM_MINMAX, CV_8UC1);
+		cv::integral(m_heatMap, m_heatSum, CV_64F);
+		cv::normalize(m_heatSum(cv::Rect(1, 1, m_heatMap.cols - 1, m_heatMap.rows - 1)), m_normHeatMap, 255, 0, cv::NORM_MINMAX, CV_8UC1);
+		cv::resize(m_normHeatMap, m_normHeatMap, cv::Size(m_heatMapScale * m_normHeatMap.cols, m_heatMapScale * m_normHeatMap.rows), 0, 0, cv::INTER_LINEAR);
+		m_normHeatMap = m_normHeatMap(cv::Rect(0, 0, m_keyFrame.cols, m_keyFrame.rows));
 		cv::applyColorMap(m_normHeatMap, m_colorMap, cv::COLORMAP_HOT);
 		cv::bitwise_or(m_keyFrame, m_colorMap, res);
 	}
@@ -412,13 +510,18 @@ void CarsCounting::AddToHeatMap(const cv::Rect& rect)
 	if (m_heatMap.empty())
 		return;
 
+	const int gridWidth = m_heatMap.cols - 1;
+	const int gridHeight = m_heatMap.rows - 1;
+	const int x1 = std::max(0, std::min(gridWidth, rect.x / m_heatMapScale));
+	const int y1 = std::max(0, std::min(gridHeight, rect.y / m_heatMapScale));
+	const int x2 = std::max(0, std::min(gridWidth, (rect.x + rect.width + m_heatMapScale - 1) / m_heatMapScale));
+	const int y2 = std::max(0, std::min(gridHeight, (rect.y + rect.height + m_heatMapScale - 1) / m_heatMapScale));
+	if (x1 >= x2 || y1 >= y2)
+		return;
+
 	constexpr float w = 0.001f;
-	for (int y = 0; y < rect.height; ++y)
-	{
-		float* heatPtr = m_heatMap.ptr<float>(rect.y + y) + rect.x;
-		for (int x = 0; x < rect.width; ++x)
-		{
-			heatPtr[x] += w;
-		}
-	}
+	m_heatMap.at<float>(y1, x1) += w;
+	m_heatMap.at<float>(y1, x2) -= w;
+	m_heatMap.at<float>(y2, x1) -= w;
+	m_heatMap.at<float>(y2, x2) += w;
 }
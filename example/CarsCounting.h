@@ -1,6 +1,8 @@
 #pragma once
 
 #include <unordered_set>
+#include <unordered_map>
+#include <functional>
 #include "VideoExample.h"
 
 ///
@@ -77,10 +79,36 @@ public:
 		m_toPix = toPix;
 		//std::cout << "To Geo: " << m_toGeo << std::endl;
 		//std::cout << "To Pix: " << m_toPix << std::endl;
+		m_lut.release();
 
 		return res;
 	}
 
+	///
+	/// \brief BuildLut
+	/// Geo coordinates in the nodes of the grid: Pix2GeoLut interpolates them instead of the perspective division
+	/// \param frameSize
+	/// \param cellSize - step of the grid in pixels
+	///
+	void BuildLut(cv::Size frameSize, int cellSize = 16)
+	{
+		m_lutCell = std::max(1, cellSize);
+		const int cols = frameSize.width / m_lutCell + 2;
+		const int rows = frameSize.height / m_lutCell + 2;
+		std::vector<cv::Point_<T>> pix;
+		pix.reserve(static_cast<size_t>(rows * cols));
+		for (int y = 0; y < rows; ++y)
+		{
+			for (int x = 0; x < cols; ++x)
+			{
+				pix.emplace_back(static_cast<T>(x * m_lutCell), static_cast<T>(y * m_lutCell));
+			}
+		}
+		std::vector<cv::Point_<T>> geo;
+		Pix2Geo(pix, geo);
+		m_lut = cv::Mat(geo, true).reshape(2, rows);
+	}
+
 	///
 	cv::Point Geo2Pix(const cv::Point_<T>& geo) const
 	{
@@ -97,12 +125,65 @@ public:
 		return cv::Point_<T>(g[0] / g[2], g[1] / g[2]);
 	}
 
+	///
+	/// \brief Pix2Geo
+	/// Batched conversion of the trajectory points
+	/// \param pix
+	/// \param geo
+	///
+	template<typename PT>
+	void Pix2Geo(const std::vector<PT>& pix, std::vector<cv::Point_<T>>& geo) const
+	{
+		const T* m = m_toGeo.val;
+		geo.resize(pix.size());
+		for (size_t i = 0; i < pix.size(); ++i)
+		{
+			const T x = static_cast<T>(pix[i].x);
+			const T y = static_cast<T>(pix[i].y);
+			const T w = 1 / (m[6] * x + m[7] * y + m[8]);
+			geo[i].x = (m[0] * x + m[1] * y + m[2]) * w;
+			geo[i].y = (m[3] * x + m[4] * y + m[5]) * w;
+		}
+	}
+
+	///
+	/// \brief Pix2GeoLut
+	/// Bilinear interpolation on the grid of BuildLut, Pix2Geo without the grid or out of the frame
+	/// \param pix
+	/// \return
+	///
+	template<typename PT>
+	cv::Point_<T> Pix2GeoLut(const PT& pix) const
+	{
+		const T fx = static_cast<T>(pix.x) / m_lutCell;
+		const T fy = static_cast<T>(pix.y) / m_lutCell;
+		const int x = static_cast<int>(fx);
+		const int y = static_cast<int>(fy);
+		if (m_lut.empty() || fx < 0 || fy < 0 || x + 1 >= m_lut.cols || y + 1 >= m_lut.rows)
+			return Pix2Geo(cv::Point(cvRound(pix.x), cvRound(pix.y)));
+
+		const T ax = fx - x;
+		const T ay = fy - y;
+		const cv::Point_<T>* row0 = m_lut.ptr<cv::Point_<T>>(y) + x;
+		const cv::Point_<T>* row1 = m_lut.ptr<cv::Point_<T>>(y + 1) + x;
+		return (1 - ay) * ((1 - ax) * row0[0] + ax * row0[1]) + ay * ((1 - ax) * row1[0] + ax * row1[1]);
+	}
+
 	///
 	std::vector<cv::Point> GetFramePoints() const
 	{
 		return m_framePoints;
 	}
 
+	///
+	/// \brief ToGeo
+	/// \return Homography of the frame pixels to (latitude, longitude), for example for CameraFusion::AddCamera
+	///
+	const cv::Matx<T, 3, 3>& ToGeo() const
+	{
+		return m_toGeo;
+	}
+
 	///
 	bool Empty() const
 	{
@@ -115,6 +196,9 @@ private:
 
 	cv::Matx<T, 3, 3> m_toGeo;
 	cv::Matx<T, 3, 3> m_toPix;
+
+	cv::Mat m_lut;
+	int m_lutCell = 16;
 };
 
 ///
@@ -329,6 +413,106 @@ private:
     }
 };
 
+///
+/// \brief The LineCrossing struct
+/// The event of the track crossing the road line
+///
+struct LineCrossing
+{
+    unsigned int m_lineUid = 0;
+    track_id_t m_trackID;
+    int m_direction = 0; // 1 or 2 like the counters of RoadLine
+    int m_frameInd = 0;
+};
+
+///
+/// \brief The RoadLinesIndex class
+/// Uniform grid over the normalized frame, the cells keep the indices of the lines passing through them.
+/// Only the lines from the cells of the segment bounding box are checked
+///
+class RoadLinesIndex
+{
+public:
+    ///
+    explicit RoadLinesIndex(int gridSize = 16)
+        : m_gridSize(std::max(1, gridSize))
+    {
+    }
+
+    ///
+    /// \brief Build
+    /// \param lines - with the normalized coordinates
+    ///
+    void Build(const std::deque<RoadLine>& lines)
+    {
+        m_cells.assign(static_cast<size_t>(m_gridSize * m_gridSize), std::vector<size_t>());
+        m_stamps.assign(lines.size(), 0);
+        m_stamp = 0;
+        for (size_t i = 0; i < lines.size(); ++i)
+        {
+            cv::Rect cells = CellsRect(lines[i].m_pt1, lines[i].m_pt2);
+            for (int y = cells.y; y < cells.y + cells.height; ++y)
+            {
+                for (int x = cells.x; x < cells.x + cells.width; ++x)
+                {
+                    m_cells[static_cast<size_t>(y * m_gridSize + x)].push_back(i);
+                }
+            }
+        }
+    }
+
+    ///
+    /// \brief Query
+    /// \param pt1, pt2 - the segment of the trajectory in the normalized coordinates
+    /// \param candidates - the lines which can cross the segment
+    ///
+    void Query(cv::Point2f pt1, cv::Point2f pt2, std::vector<size_t>& candidates)
+    {
+        candidates.clear();
+        if (m_cells.empty())
+            return;
+
+        ++m_stamp;
+        cv::Rect cells = CellsRect(pt1, pt2);
+        for (int y = cells.y; y < cells.y + cells.height; ++y)
+        {
+            for (int x = cells.x; x < cells.x + cells.width; ++x)
+            {
+                for (size_t lineInd : m_cells[static_cast<size_t>(y * m_gridSize + x)])
+                {
+                    if (m_stamps[lineInd] != m_stamp)
+                    {
+                        m_stamps[lineInd] = m_stamp;
+                        candidates.push_back(lineInd);
+                    }
+                }
+            }
+        }
+    }
+
+private:
+    int m_gridSize = 16;
+    std::vector<std::vector<size_t>> m_cells;
+    std::vector<size_t> m_stamps; // The line was already added to the candidates of the current query
+    size_t m_stamp = 0;
+
+    ///
+    cv::Rect CellsRect(cv::Point2f pt1, cv::Point2f pt2) const
+    {
+        auto ToCell = [this](float val)
+        {
+            return std::max(0, std::min(m_gridSize - 1, static_cast<int>(val * m_gridSize)));
+        };
+        // The borders are extended by the epsilon of RoadLine::CheckIntersection
+        constexpr float eps = 0.0001f;
+        int x1 = ToCell(std::min(pt1.x, pt2.x) - eps);
+        int x2 = ToCell(std::max(pt1.x, pt2.x) + eps);
+        int y1 = ToCell(std::min(pt1.y, pt2.y) - eps);
+        int y2 = ToCell(std::max(pt1.y, pt2.y) + eps);
+        return cv::Rect(x1, y1, x2 - x1 + 1, y2 - y1 + 1);
+    }
+};
+
 ///
 /// \brief The CarsCounting class
 ///
@@ -341,6 +525,11 @@ public:
     void AddLine(const RoadLine& newLine);
     bool GetLine(unsigned int lineUid, RoadLine& line);
     bool RemoveLine(unsigned int lineUid);
+    ///
+    /// \brief SetCrossingCallback
+    /// \param callback - is called for the every crossing of the line by the track
+    ///
+    void SetCrossingCallback(std::function<void(const LineCrossing&)> callback);
 
 private:
 
@@ -356,17 +545,34 @@ private:
 
     void DrawData(cv::Mat frame, const std::vector<TrackingObject>& tracks, int framesCounter, int currTime) override;
     void DrawTrack(cv::Mat frame, const TrackingObject& track, bool drawTrajectory, int framesCounter) override;
+    void HeadlessData(const std::vector<TrackingObject>& tracks, cv::Size frameSize, int framesCounter, int currTime) override;
 
     // Road lines
     std::deque<RoadLine> m_lines;
-    void CheckLinesIntersection(const TrackingObject& track, float xMax, float yMax);
+    RoadLinesIndex m_linesIndex;
+    bool m_linesIndexDirty = true;
+    std::vector<size_t> m_candidateLines;
+    std::function<void(const LineCrossing&)> m_crossingCallback;
+
+    // The last checked point of the tracks: the segment is checked only when the trajectory was changed
+    struct CheckedPoint
+    {
+        Point_t m_pt;
+        int m_frameInd = 0;
+    };
+    std::unordered_map<track_id_t, CheckedPoint> m_checkedPoints;
+    int m_lastPruneFrame = 0;
+
+    void CheckLinesIntersection(const TrackingObject& track, float xMax, float yMax, int framesCounter);
 
 	// Binding frame coordinates to geographical coordinates
 	GeoParams<float> m_geoParams;
 
 	// Heat map for visualization long term detections
+	int m_heatMapScale = 4;
 	cv::Mat m_keyFrame;
-	cv::Mat m_heatMap;
+	cv::Mat m_heatMap;       // Difference array of the downscaled grid
+	cv::Mat m_heatSum;
 	cv::Mat m_normHeatMap;
 	cv::Mat m_colorMap;
 
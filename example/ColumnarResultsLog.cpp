@@ -0,0 +1,327 @@
+#include <iostream>
+#include <cstring>
+#include <algorithm>
+
+#include "ColumnarResultsLog.h"
+
+namespace
+{
+    const char ColumnarMagic[4] = { 'M', 'T', 'R', 'C' };
+    constexpr uint32_t ColumnarVersion = 1;
+
+    ///
+    template<typename T>
+    void WriteColumn(FILE* file, const std::vector<T>& column)
+    {
+        if (!column.empty())
+            fwrite(column.data(), sizeof(T), column.size(), file);
+    }
+    ///
+    template<typename T>
+    bool ReadColumn(FILE* file, std::vector<T>& column, size_t rows)
+    {
+        column.resize(rows);
+        return !rows || fread(column.data(), sizeof(T), rows, file) == rows;
+    }
+    ///
+    template<typename T>
+    void WriteValue(FILE* file, T val)
+    {
+        fwrite(&val, sizeof(T), 1, file);
+    }
+    ///
+    template<typename T>
+    bool ReadValue(FILE* file, T& val)
+    {
+        return fread(&val, sizeof(T), 1, file) == 1;
+    }
+}
+
+///
+/// \brief ColumnarResultsWriter::ColumnarResultsWriter
+/// \param fileName
+/// \param writeEachNFrame
+/// \param framesPerBlock
+///
+ColumnarResultsWriter::ColumnarResultsWriter(const std::string& fileName, int writeEachNFrame, int framesPerBlock)
+    : m_writeEachNFrame(std::max(1, writeEachNFrame)), m_framesPerBlock(std::max(1, framesPerBlock))
+{
+    m_file = fopen(fileName.c_str(), "wb");
+    if (!m_file)
+    {
+        std::cerr << "ColumnarResultsWriter: can't open " << fileName << std::endl;
+        return;
+    }
+    fwrite(ColumnarMagic, 1, sizeof(ColumnarMagic), m_file);
+    WriteValue(m_file, ColumnarVersion);
+    WriteValue(m_file, static_cast<int32_t>(m_framesPerBlock));
+}
+
+///
+/// \brief ColumnarResultsWriter::~ColumnarResultsWriter
+///
+ColumnarResultsWriter::~ColumnarResultsWriter()
+{
+    if (!m_file)
+        return;
+
+    Flush();
+
+    const uint64_t footerOffset = static_cast<uint64_t>(ftell(m_file));
+    WriteValue(m_file, static_cast<uint64_t>(m_robustIDs.size()));
+    for (const auto& id : m_robustIDs)
+    {
+        WriteValue(m_file, static_cast<uint64_t>(id.m_val));
+    }
+    WriteValue(m_file, static_cast<uint64_t>(m_index.size()));
+    for (const auto& block : m_index)
+    {
+        WriteValue(m_file, block.m_firstFrame);
+        WriteValue(m_file, block.m_lastFrame);
+        WriteValue(m_file, block.m_offset);
+    }
+    WriteValue(m_file, footerOffset);
+    fwrite(ColumnarMagic, 1, sizeof(ColumnarMagic), m_file);
+
+    fclose(m_file);
+    m_file = nullptr;
+}
+
+///
+/// \brief ColumnarResultsWriter::AddTrack
+/// \param framesCounter
+/// \param trackID
+/// \param brect
+/// \param type
+/// \param confidence
+/// \return
+///
+bool ColumnarResultsWriter::AddTrack(int framesCounter, track_id_t trackID, const cv::Rect& brect, objtype_t type, float confidence)
+{
+    if (!m_file)
+        return false;
+    if (framesCounter % m_writeEachNFrame != 0)
+        return true;
+
+    // The blocks are aligned by the frames, so the block of the frame is known from the index
+    if (m_blockFirstFrame >= 0 && framesCounter / m_framesPerBlock != m_blockFirstFrame / m_framesPerBlock)
+        Flush();
+    if (m_blockFirstFrame < 0)
+        m_blockFirstFrame = framesCounter;
+    m_blockLastFrame = std::max(m_blockLastFrame, framesCounter);
+
+    m_block.m_frame.push_back(framesCounter);
+    m_block.m_trackID.push_back(static_cast<uint64_t>(trackID.m_val));
+    m_block.m_x.push_back(brect.x);
+    m_block.m_y.push_back(brect.y);
+    m_block.m_width.push_back(brect.width);
+    m_block.m_height.push_back(brect.height);
+    m_block.m_type.push_back(type);
+    m_block.m_conf.push_back(confidence);
+    return true;
+}
+
+///
+/// \brief ColumnarResultsWriter::AddRobustTrack
+/// \param trackID
+///
+void ColumnarResultsWriter::AddRobustTrack(track_id_t trackID)
+{
+    m_robustIDs.insert(trackID);
+}
+
+///
+/// \brief ColumnarResultsWriter::Flush
+///
+void ColumnarResultsWriter::Flush()
+{
+    if (!m_file || m_block.Size() == 0)
+        return;
+
+    BlockIndex block;
+    block.m_firstFrame = m_blockFirstFrame;
+    block.m_lastFrame = m_blockLastFrame;
+    block.m_offset = static_cast<uint64_t>(ftell(m_file));
+    m_index.push_back(block);
+
+    WriteValue(m_file, block.m_firstFrame);
+    WriteValue(m_file, block.m_lastFrame);
+    WriteValue(m_file, static_cast<uint64_t>(m_block.Size()));
+    WriteColumn(m_file, m_block.m_frame);
+    WriteColumn(m_file, m_block.m_trackID);
+    WriteColumn(m_file, m_block.m_x);
+    WriteColumn(m_file, m_block.m_y);
+    WriteColumn(m_file, m_block.m_width);
+    WriteColumn(m_file, m_block.m_height);
+    WriteColumn(m_file, m_block.m_type);
+    WriteColumn(m_file, m_block.m_conf);
+    fflush(m_file);
+
+    m_block.Clear();
+    m_blockFirstFrame = -1;
+    m_blockLastFrame = -1;
+}
+
+///
+/// \brief ColumnarResultsReader::~ColumnarResultsReader
+///
+ColumnarResultsReader::~ColumnarResultsReader()
+{
+    if (m_file)
+        fclose(m_file);
+}
+
+///
+/// \brief ColumnarResultsReader::Open
+/// \return
+///
+bool ColumnarResultsReader::Open()
+{
+    if (m_file)
+        fclose(m_file);
+    m_index.clear();
+    m_robustIDs.clear();
+
+    m_file = fopen(m_fileName.c_str(), "rb");
+    if (!m_file)
+    {
+        std::cerr << "ColumnarResultsReader: can't open " << m_fileName << std::endl;
+        return false;
+    }
+
+    auto WrongFormat = [this]()
+    {
+        std::cerr << "ColumnarResultsReader: " << m_fileName << " has wrong format or wasn't closed" << std::endl;
+        return false;
+    };
+
+    char magic[4] = { 0 };
+    uint32_t version = 0;
+    int32_t framesPerBlock = 0;
+    if (fread(magic, 1, sizeof(magic), m_file) != sizeof(magic) || memcmp(magic, ColumnarMagic, sizeof(magic)) != 0 ||
+            !ReadValue(m_file, version) || version != ColumnarVersion || !ReadValue(m_file, framesPerBlock) || framesPerBlock < 1)
+        return WrongFormat();
+    m_framesPerBlock = framesPerBlock;
+
+    uint64_t footerOffset = 0;
+    if (fseek(m_file, -static_cast<long>(sizeof(footerOffset) + sizeof(magic)), SEEK_END) != 0 || !ReadValue(m_file, footerOffset) ||
+            fread(magic, 1, sizeof(magic), m_file) != sizeof(magic) || memcmp(magic, ColumnarMagic, sizeof(magic)) != 0)
+        return WrongFormat();
+
+    fseek(m_file, static_cast<long>(footerOffset), SEEK_SET);
+    uint64_t count = 0;
+    if (!ReadValue(m_file, count))
+        return WrongFormat();
+    for (uint64_t i = 0; i < count; ++i)
+    {
+        uint64_t id = 0;
+        if (!ReadValue(m_file, id))
+            return WrongFormat();
+        m_robustIDs.insert(id);
+    }
+    if (!ReadValue(m_file, count))
+        return WrongFormat();
+    m_index.resize(count);
+    for (auto& block : m_index)
+    {
+        if (!ReadValue(m_file, block.m_firstFrame) || !ReadValue(m_file, block.m_lastFrame) || !ReadValue(m_file, block.m_offset))
+            return WrongFormat();
+    }
+    return true;
+}
+
+///
+/// \brief ColumnarResultsReader::ReadBlock
+/// \param blockInd
+/// \param columns
+/// \param robustOnly
+/// \return
+///
+bool ColumnarResultsReader::ReadBlock(size_t blockInd, TrackColumns& columns, bool robustOnly)
+{
+    columns.Clear();
+    if (!m_file || blockInd >= m_index.size())
+        return false;
+
+    fseek(m_file, static_cast<long>(m_index[blockInd].m_offset), SEEK_SET);
+    int32_t firstFrame = 0;
+    int32_t lastFrame = 0;
+    uint64_t rows = 0;
+    bool res = ReadValue(m_file, firstFrame) && ReadValue(m_file, lastFrame) && ReadValue(m_file, rows);
+    const size_t rowsCount = static_cast<size_t>(rows);
+    res = res && ReadColumn(m_file, columns.m_frame, rowsCount) && ReadColumn(m_file, columns.m_trackID, rowsCount) &&
+            ReadColumn(m_file, columns.m_x, rowsCount) && ReadColumn(m_file, columns.m_y, rowsCount) &&
+            ReadColumn(m_file, columns.m_width, rowsCount) && ReadColumn(m_file, columns.m_height, rowsCount) &&
+            ReadColumn(m_file, columns.m_type, rowsCount) && ReadColumn(m_file, columns.m_conf, rowsCount);
+    if (!res)
+    {
+        std::cerr << "ColumnarResultsReader: " << m_fileName << " block " << blockInd << " is broken" << std::endl;
+        columns.Clear();
+        return false;
+    }
+
+    if (robustOnly)
+    {
+        size_t dst = 0;
+        for (size_t i = 0; i < rowsCount; ++i)
+        {
+            if (!IsRobust(columns.m_trackID[i]))
+                continue;
+            columns.m_frame[dst] = columns.m_frame[i];
+            columns.m_trackID[dst] = columns.m_trackID[i];
+            columns.m_x[dst] = columns.m_x[i];
+            columns.m_y[dst] = columns.m_y[i];
+            columns.m_width[dst] = columns.m_width[i];
+            columns.m_height[dst] = columns.m_height[i];
+            columns.m_type[dst] = columns.m_type[i];
+            columns.m_conf[dst] = columns.m_conf[i];
+            ++dst;
+        }
+        columns.Resize(dst);
+    }
+    return true;
+}
+
+///
+/// \brief ColumnarResultsReader::FindBlock
+/// \param frame
+/// \return The first block with the frames not less than frame
+///
+size_t ColumnarResultsReader::FindBlock(int frame) const
+{
+    return static_cast<size_t>(std::lower_bound(std::begin(m_index), std::end(m_index), frame,
+                                                [](const ColumnarResultsWriter::BlockIndex& block, int fr) { return block.m_lastFrame < fr; }) - std::begin(m_index));
+}
+
+///
+/// \brief ColumnarResultsReader::ReadFrames
+/// \param firstFrame
+/// \param lastFrame
+/// \param columns
+/// \param robustOnly
+/// \return
+///
+bool ColumnarResultsReader::ReadFrames(int firstFrame, int lastFrame, TrackColumns& columns, bool robustOnly)
+{
+    columns.Clear();
+    TrackColumns block;
+    for (size_t blockInd = FindBlock(firstFrame); blockInd < m_index.size() && m_index[blockInd].m_firstFrame <= lastFrame; ++blockInd)
+    {
+        if (!ReadBlock(blockInd, block, robustOnly))
+            return false;
+        for (size_t i = 0; i < block.Size(); ++i)
+        {
+            if (block.m_frame[i] < firstFrame || block.m_frame[i] > lastFrame)
+                continue;
+            columns.m_frame.push_back(block.m_frame[i]);
+            columns.m_trackID.push_back(block.m_trackID[i]);
+            columns.m_x.push_back(block.m_x[i]);
+            columns.m_y.push_back(block.m_y[i]);
+            columns.m_width.push_back(block.m_width[i]);
+            columns.m_height.push_back(block.m_height[i]);
+            columns.m_type.push_back(block.m_type[i]);
+            columns.m_conf.push_back(block.m_conf[i]);
+        }
+    }
+    return true;
+}
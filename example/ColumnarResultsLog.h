@@ -0,0 +1,179 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <unordered_set>
+
+#include <opencv2/opencv.hpp>
+
+#include "defines.h"
+
+///
+/// \brief The TrackColumns struct
+/// Detections of the block of frames, the column per field
+///
+struct TrackColumns
+{
+    std::vector<int32_t> m_frame;
+    std::vector<uint64_t> m_trackID;
+    std::vector<int32_t> m_x;
+    std::vector<int32_t> m_y;
+    std::vector<int32_t> m_width;
+    std::vector<int32_t> m_height;
+    std::vector<int32_t> m_type;
+    std::vector<float> m_conf;
+
+    ///
+    size_t Size() const
+    {
+        return m_frame.size();
+    }
+    ///
+    void Clear()
+    {
+        m_frame.clear();
+        m_trackID.clear();
+        m_x.clear();
+        m_y.clear();
+        m_width.clear();
+        m_height.clear();
+        m_type.clear();
+        m_conf.clear();
+    }
+    ///
+    void Resize(size_t rows)
+    {
+        m_frame.resize(rows);
+        m_trackID.resize(rows);
+        m_x.resize(rows);
+        m_y.resize(rows);
+        m_width.resize(rows);
+        m_height.resize(rows);
+        m_type.resize(rows);
+        m_conf.resize(rows);
+    }
+};
+
+///
+/// \brief The ColumnarResultsWriter class
+/// Chunked column format of the tracking results. The file:
+///  - header: "MTRC", version, frames per block;
+///  - blocks: first frame, last frame, rows count and the columns frame, ID, x, y, width, height, type, confidence;
+///  - footer: robust IDs, blocks index (first frame, last frame, offset), offset of the footer and "MTRC".
+/// The block of the frame is found by the index without parsing of the data
+///
+class ColumnarResultsWriter
+{
+public:
+    ///
+    /// \brief ColumnarResultsWriter
+    /// \param fileName
+    /// \param writeEachNFrame - the detections of the other frames aren't written
+    /// \param framesPerBlock
+    ///
+    ColumnarResultsWriter(const std::string& fileName, int writeEachNFrame, int framesPerBlock = 256);
+    ColumnarResultsWriter(const ColumnarResultsWriter&) = delete;
+    ColumnarResultsWriter& operator=(const ColumnarResultsWriter&) = delete;
+    ///
+    /// \brief ~ColumnarResultsWriter
+    /// Writes the last block and the footer
+    ///
+    ~ColumnarResultsWriter();
+
+    ///
+    bool IsOpened() const
+    {
+        return m_file != nullptr;
+    }
+
+    ///
+    bool AddTrack(int framesCounter, track_id_t trackID, const cv::Rect& brect, objtype_t type, float confidence);
+    ///
+    void AddRobustTrack(track_id_t trackID);
+    ///
+    /// \brief Flush
+    /// Writes the current block
+    ///
+    void Flush();
+
+private:
+    FILE* m_file = nullptr;
+    int m_writeEachNFrame = 1;
+    int m_framesPerBlock = 256;
+
+    TrackColumns m_block;
+    int m_blockFirstFrame = -1;
+    int m_blockLastFrame = -1;
+
+    struct BlockIndex
+    {
+        int32_t m_firstFrame = 0;
+        int32_t m_lastFrame = 0;
+        uint64_t m_offset = 0;
+    };
+    std::vector<BlockIndex> m_index;
+    std::unordered_set<track_id_t> m_robustIDs;
+
+    friend class ColumnarResultsReader;
+};
+
+///
+/// \brief The ColumnarResultsReader class
+/// Reads the footer of the ColumnarResultsWriter file and loads the blocks of the frames range
+///
+class ColumnarResultsReader
+{
+public:
+    ///
+    ColumnarResultsReader(const std::string& fileName)
+        : m_fileName(fileName)
+    {
+    }
+    ///
+    ~ColumnarResultsReader();
+
+    ///
+    bool Open();
+
+    ///
+    size_t BlocksCount() const
+    {
+        return m_index.size();
+    }
+
+    ///
+    /// \brief ReadBlock
+    /// \param blockInd
+    /// \param columns
+    /// \param robustOnly - the rows of the not robust tracks are removed
+    /// \return
+    ///
+    bool ReadBlock(size_t blockInd, TrackColumns& columns, bool robustOnly = true);
+
+    ///
+    /// \brief ReadFrames
+    /// \param firstFrame
+    /// \param lastFrame - inclusive
+    /// \param columns - the detections of the range
+    /// \param robustOnly
+    /// \return
+    ///
+    bool ReadFrames(int firstFrame, int lastFrame, TrackColumns& columns, bool robustOnly = true);
+
+    ///
+    bool IsRobust(uint64_t trackID) const
+    {
+        return m_robustIDs.find(trackID) != std::end(m_robustIDs);
+    }
+
+private:
+    std::string m_fileName;
+    FILE* m_file = nullptr;
+    int m_framesPerBlock = 256;
+    std::vector<ColumnarResultsWriter::BlockIndex> m_index;
+    std::unordered_set<uint64_t> m_robustIDs;
+
+    size_t FindBlock(int frame) const;
+};
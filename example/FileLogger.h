@@ -1,14 +1,23 @@
 #pragma once
 #include <fstream>
 #include <map>
+#include <memory>
 #include <unordered_set>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
 
 #include <opencv2/opencv.hpp>
 
 #include "object_types.h"
+#include "BinaryResultsLog.h"
+#include "ColumnarResultsLog.h"
 
 ///
 /// \brief The ResultsLog class
+/// The csv is written at the end with the detections of the robust tracks only. The file with ".bin" extension
+/// is written by BinaryResultsWriter during the processing and filtered by BinaryResultsReader, the file with ".col"
+/// extension is written by blocks of columns by ColumnarResultsWriter
 ///
 class ResultsLog
 {
@@ -22,13 +31,26 @@ public:
 	///
 	~ResultsLog()
 	{
-		WriteAll(true);
+		if (m_resCSV.is_open())
+			WriteAll(true);
 	}
 
 	///
 	bool Open()
 	{
 		m_resCSV.close();
+		m_binWriter.reset();
+		m_colWriter.reset();
+		if (HasExtension(m_fileName, ".col"))
+		{
+			m_colWriter = std::make_unique<ColumnarResultsWriter>(m_fileName, m_writeEachNFrame);
+			return m_colWriter->IsOpened();
+		}
+		if (IsBinaryFile(m_fileName))
+		{
+			m_binWriter = std::make_unique<BinaryResultsWriter>(m_fileName, m_writeEachNFrame);
+			return m_binWriter->IsOpened();
+		}
 		if (m_fileName.size() > 5)
 		{
 			m_resCSV.open(m_fileName);
@@ -37,9 +59,27 @@ public:
 		return false;
 	}
 
+	///
+	static bool HasExtension(const std::string& fileName, const std::string& ext)
+	{
+		return fileName.size() > ext.size() && fileName.compare(fileName.size() - ext.size(), ext.size(), ext) == 0;
+	}
+	///
+	static bool IsBinaryFile(const std::string& fileName)
+	{
+		return HasExtension(fileName, ".bin");
+	}
+
 	///
 	bool AddTrack(int framesCounter, track_id_t trackID, const cv::Rect& brect, objtype_t type, float confidence)
 	{
+		if (m_colWriter)
+			return m_colWriter->AddTrack(framesCounter, trackID, brect, type, confidence);
+		if (m_binWriter)
+		{
+			m_lastFrame = framesCounter;
+			return m_binWriter->AddTrack(framesCounter, trackID, brect, type, confidence);
+		}
 		if (m_resCSV.is_open())
 		{
 			auto frame = m_frames.find(framesCounter);
@@ -61,12 +101,27 @@ public:
 	///
 	void AddRobustTrack(track_id_t trackID)
 	{
-		m_robustIDs.insert(trackID);
+		if (m_colWriter)
+			m_colWriter->AddRobustTrack(trackID);
+		else if (m_binWriter)
+			m_binWriter->AddRobustTrack(m_lastFrame, trackID);
+		else
+			m_robustIDs.insert(trackID);
 	}
 
     ///
     void Flush()
     {
+        if (m_colWriter)
+        {
+            m_colWriter->Flush();
+            return;
+        }
+        if (m_binWriter)
+        {
+            m_binWriter->Flush();
+            return;
+        }
         WriteAll(true);
         m_frames.clear();
     }
@@ -74,6 +129,9 @@ public:
 private:
 	std::string m_fileName;
 	std::ofstream m_resCSV;
+	std::unique_ptr<BinaryResultsWriter> m_binWriter;
+	std::unique_ptr<ColumnarResultsWriter> m_colWriter;
+	int m_lastFrame = 0;
 
 	///
 	struct Detection
@@ -118,7 +176,7 @@ private:
                         {
                             m_resCSV << frame.first << delim << TypeConverter::Type2Str(detect.m_type) << delim << detect.m_rect.x << delim << detect.m_rect.y << delim <<
                                 detect.m_rect.width << delim << detect.m_rect.height << delim <<
-                                detect.m_conf << delim << std::endl;
+                                detect.m_conf << delim << detect.m_trackID.ID2Str() << std::endl;
                         }
                     }
                 }
@@ -164,3 +222,106 @@ private:
 		}
 	}
 };
+
+///
+/// \brief The ResultsReader class
+/// Streaming reader of the csv written by ResultsLog: frame,type,x,y,width,height,confidence,ID.
+/// Only the current line is in memory, so the file can be bigger than RAM
+///
+class ResultsReader
+{
+public:
+	///
+	/// \brief The Detection struct
+	///
+	struct Detection
+	{
+		int m_frame = 0;
+		objtype_t m_type = bad_type;
+		cv::Rect m_rect;
+		float m_conf = 0.f;
+		track_id_t m_trackID = 0;
+	};
+
+	///
+	ResultsReader(const std::string& fileName)
+		: m_fileName(fileName)
+	{
+	}
+
+	///
+	bool Open()
+	{
+		m_resCSV.close();
+		m_resCSV.clear();
+		m_resCSV.open(m_fileName);
+		m_lineNum = 0;
+		return m_resCSV.is_open();
+	}
+
+	///
+	/// \brief Read
+	/// \param detect - the next detection of the file
+	/// \param line - source line of the detection
+	/// \return false at the end of the file
+	///
+	bool Read(Detection& detect, std::string& line)
+	{
+		while (std::getline(m_resCSV, line))
+		{
+			++m_lineNum;
+			if (line.empty())
+				continue;
+			if (Parse(line, detect))
+				return true;
+			std::cerr << "ResultsReader: " << m_fileName << ":" << m_lineNum << " wrong line \"" << line << "\"" << std::endl;
+		}
+		return false;
+	}
+
+private:
+	std::string m_fileName;
+	std::ifstream m_resCSV;
+	size_t m_lineNum = 0;
+
+	///
+	static bool Parse(const std::string& line, Detection& detect)
+	{
+		const char* str = line.c_str();
+		char* end = nullptr;
+
+		detect.m_frame = static_cast<int>(std::strtol(str, &end, 10));
+		if (end == str || *end != ',')
+			return false;
+		str = end + 1;
+
+		const char* typeEnd = std::strchr(str, ',');
+		if (!typeEnd)
+			return false;
+		const std::string typeName(str, typeEnd);
+		detect.m_type = (typeName == TypeConverter::Type2Str(bad_type)) ? bad_type : TypeConverter::Str2Type(typeName);
+		str = typeEnd + 1;
+
+		int vals[4];
+		for (int& val : vals)
+		{
+			val = static_cast<int>(std::strtol(str, &end, 10));
+			if (end == str || *end != ',')
+				return false;
+			str = end + 1;
+		}
+		detect.m_rect = cv::Rect(vals[0], vals[1], vals[2], vals[3]);
+
+		detect.m_conf = std::strtof(str, &end);
+		if (end == str || *end != ',')
+			return false;
+		str = end + 1;
+
+		// Files of the old format are without ID
+		const auto id = std::strtoull(str, &end, 10);
+		if (end == str)
+			return false;
+		detect.m_trackID = track_id_t(static_cast<track_id_t::value_type>(id));
+		return true;
+	}
+};
@@ -0,0 +1,345 @@
+#include "ImageSequenceCapture.h"
+
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+
+#include <inih/INIReader.h>
+
+#ifdef HAVE_FILESYSTEM
+#include <filesystem>
+namespace fs = std::filesystem;
+#endif
+
+#ifdef USE_TURBOJPEG
+#include <turbojpeg.h>
+#endif
+
+namespace
+{
+    ///
+    /// \brief IsImageFile
+    /// \param fileName
+    /// \return
+    ///
+    bool IsImageFile(const std::string& fileName)
+    {
+        const size_t dot = fileName.find_last_of('.');
+        if (dot == std::string::npos)
+            return false;
+        std::string ext = fileName.substr(dot + 1);
+        std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return ext == "jpg" || ext == "jpeg" || ext == "png" || ext == "bmp" || ext == "tif" || ext == "tiff" || ext == "webp";
+    }
+
+    ///
+    /// \brief FileExists
+    /// \param fileName
+    /// \return
+    ///
+    bool FileExists(const std::string& fileName)
+    {
+        std::ifstream file(fileName, std::ios::binary);
+        return file.is_open();
+    }
+
+    ///
+    /// \brief ReadFile
+    /// \param fileName
+    /// \param data - reused buffer
+    /// \return
+    ///
+    bool ReadFile(const std::string& fileName, std::vector<uchar>& data)
+    {
+        std::ifstream file(fileName, std::ios::binary | std::ios::ate);
+        if (!file.is_open())
+            return false;
+        const std::streamsize size = file.tellg();
+        if (size <= 0)
+            return false;
+        data.resize(static_cast<size_t>(size));
+        file.seekg(0, std::ios::beg);
+        return static_cast<bool>(file.read(reinterpret_cast<char*>(data.data()), size));
+    }
+
+    ///
+    /// \brief ReadSeqInfoFps
+    /// MOT sequence: <seq>/seqinfo.ini and the images in <seq>/img1
+    /// \param path
+    /// \return frameRate or 0
+    ///
+    float ReadSeqInfoFps(const std::string& path)
+    {
+        std::string dir = path;
+        while (!dir.empty() && (dir.back() == '/' || dir.back() == '\\'))
+        {
+            dir.pop_back();
+        }
+        if (dir.find_first_of("*%") != std::string::npos || IsImageFile(dir))
+        {
+            const size_t slash = dir.find_last_of("/\\");
+            dir = (slash == std::string::npos) ? std::string(".") : dir.substr(0, slash);
+        }
+        const size_t slash = dir.find_last_of("/\\");
+        const std::string seqDir = (slash == std::string::npos) ? std::string(".") : dir.substr(0, slash);
+
+        for (const auto& iniDir : { dir, seqDir })
+        {
+            const std::string iniFile = iniDir + "/seqinfo.ini";
+            if (!FileExists(iniFile))
+                continue;
+            INIReader seqInfo(iniFile);
+            if (seqInfo.ParseError() == 0)
+                return std::max(0.f, static_cast<float>(seqInfo.GetReal("Sequence", "frameRate", 0)));
+        }
+        return 0;
+    }
+
+    ///
+    /// \brief The ImageDecoder class
+    /// Decoder of the thread: JPEG by libjpeg-turbo to BGR, the other formats and the errors by cv::imdecode
+    ///
+    class ImageDecoder
+    {
+    public:
+        ImageDecoder()
+        {
+#ifdef USE_TURBOJPEG
+            m_tj = tjInitDecompress();
+#endif
+        }
+        ImageDecoder(const ImageDecoder&) = delete;
+        ImageDecoder& operator=(const ImageDecoder&) = delete;
+        ~ImageDecoder()
+        {
+#ifdef USE_TURBOJPEG
+            if (m_tj)
+                tjDestroy(m_tj);
+#endif
+        }
+
+        ///
+        /// \brief Decode
+        /// \param fileName
+        /// \param frame - its buffer is reused if the size is the same
+        /// \return
+        ///
+        bool Decode(const std::string& fileName, cv::Mat& frame)
+        {
+            if (!ReadFile(fileName, m_data))
+                return false;
+
+#ifdef USE_TURBOJPEG
+            if (m_tj && m_data.size() > 2 && m_data[0] == 0xFF && m_data[1] == 0xD8)
+            {
+                int width = 0;
+                int height = 0;
+                int subsamp = 0;
+                int colorspace = 0;
+                const unsigned long size = static_cast<unsigned long>(m_data.size());
+                if (tjDecompressHeader3(m_tj, m_data.data(), size, &width, &height, &subsamp, &colorspace) == 0)
+                {
+                    frame.create(height, width, CV_8UC3);
+                    if (tjDecompress2(m_tj, m_data.data(), size, frame.data, width, static_cast<int>(frame.step), height, TJPF_BGR, 0) == 0)
+                        return true;
+                }
+            }
+#endif
+            cv::imdecode(m_data, cv::IMREAD_COLOR, &frame);
+            return !frame.empty();
+        }
+
+    private:
+        std::vector<uchar> m_data;
+#ifdef USE_TURBOJPEG
+        tjhandle m_tj = nullptr;
+#endif
+    };
+}
+
+///
+/// \brief ImageSequenceCapture::~ImageSequenceCapture
+///
+ImageSequenceCapture::~ImageSequenceCapture()
+{
+    Stop();
+}
+
+///
+/// \brief ImageSequenceCapture::IsImageSequence
+/// \param path
+/// \return
+///
+bool ImageSequenceCapture::IsImageSequence(const std::string& path)
+{
+    if (path.find_first_of("*%") != std::string::npos)
+        return true;
+#ifdef HAVE_FILESYSTEM
+    std::error_code ec;
+    return fs::is_directory(path, ec);
+#else
+    return !path.empty() && (path.back() == '/' || path.back() == '\\');
+#endif
+}
+
+///
+/// \brief ImageSequenceCapture::Open
+/// \param path
+/// \param startFrame
+/// \param threads
+/// \param aheadFrames
+/// \return
+///
+bool ImageSequenceCapture::Open(const std::string& path, int startFrame, size_t threads, size_t aheadFrames)
+{
+    Stop();
+    m_files.clear();
+    m_decoded.clear();
+    m_freeBuffers.clear();
+    m_nextDecode = 0;
+    m_nextRead = 0;
+    m_stop = false;
+
+    if (path.find('%') != std::string::npos)
+    {
+        // The numbering starts from 0 or 1 and lasts until the first missed file
+        char fileName[4096];
+        for (int ind = 0; ; ++ind)
+        {
+            snprintf(fileName, sizeof(fileName), path.c_str(), ind);
+            if (!FileExists(fileName))
+            {
+                if (ind == 0)
+                    continue;
+                break;
+            }
+            m_files.emplace_back(fileName);
+        }
+    }
+    else
+    {
+        std::vector<cv::String> files;
+        cv::glob(path, files, false);
+        for (const auto& fileName : files)
+        {
+            if (IsImageFile(fileName))
+                m_files.emplace_back(fileName);
+        }
+        std::sort(m_files.begin(), m_files.end());
+    }
+    if (startFrame > 0)
+        m_files.erase(m_files.begin(), m_files.begin() + std::min<size_t>(static_cast<size_t>(startFrame), m_files.size()));
+    if (m_files.empty())
+    {
+        std::cerr << "ImageSequenceCapture::Open: images are not found in " << path << std::endl;
+        return false;
+    }
+    m_fps = ReadSeqInfoFps(path);
+
+    if (!threads)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min(threads, m_files.size());
+    m_aheadFrames = aheadFrames ? aheadFrames : (2 * threads);
+    for (size_t i = 0; i < threads; ++i)
+    {
+        m_threads.emplace_back(&ImageSequenceCapture::DecodeThread, this);
+    }
+    return true;
+}
+
+///
+/// \brief ImageSequenceCapture::Stop
+///
+void ImageSequenceCapture::Stop()
+{
+    m_stop = true;
+    m_decodedCond.notify_all();
+    m_freeCond.notify_all();
+    for (auto& thread : m_threads)
+    {
+        if (thread.joinable())
+            thread.join();
+    }
+    m_threads.clear();
+}
+
+///
+/// \brief ImageSequenceCapture::DecodeThread
+///
+void ImageSequenceCapture::DecodeThread()
+{
+    ImageDecoder decoder;
+    for (;;)
+    {
+        size_t ind = 0;
+        DecodedFrame decoded;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_freeCond.wait(lock, [this]() { return m_stop.load() || m_nextDecode >= m_files.size() || m_nextDecode < m_nextRead + m_aheadFrames; });
+            if (m_stop.load() || m_nextDecode >= m_files.size())
+                break;
+            ind = m_nextDecode++;
+            if (!m_freeBuffers.empty())
+            {
+                decoded.m_frame = m_freeBuffers.back();
+                m_freeBuffers.pop_back();
+            }
+        }
+
+        decoded.m_captureNs = latency::Now();
+        if (!decoder.Decode(m_files[ind], decoded.m_frame))
+        {
+            std::cerr << "ImageSequenceCapture: can't decode " << m_files[ind] << std::endl;
+            decoded.m_frame.release();
+        }
+        decoded.m_decodedNs = latency::Now();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_decoded.emplace(ind, std::move(decoded));
+        m_decodedCond.notify_all();
+    }
+}
+
+///
+/// \brief ImageSequenceCapture::Read
+/// \param frame
+/// \param timestamps
+/// \return
+///
+bool ImageSequenceCapture::Read(cv::Mat& frame, latency::FrameTimestamps* timestamps)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;)
+    {
+        if (m_nextRead >= m_files.size())
+            return false;
+        m_decodedCond.wait(lock, [this]() { return m_stop.load() || m_decoded.find(m_nextRead) != std::end(m_decoded); });
+        auto it = m_decoded.find(m_nextRead);
+        if (it == std::end(m_decoded))
+            return false;
+
+        DecodedFrame decoded = std::move(it->second);
+        m_decoded.erase(it);
+        ++m_nextRead;
+        m_freeCond.notify_all();
+
+        // The broken file is skipped, the error is printed by the decoder
+        if (decoded.m_frame.empty())
+            continue;
+
+        if (timestamps)
+        {
+            timestamps->Reset();
+            timestamps->Set(latency::Stamp::Capture, decoded.m_captureNs);
+            timestamps->Set(latency::Stamp::Decoded, decoded.m_decodedNs);
+        }
+
+        // The previous buffer of the reader goes to the workers if nobody else keeps it
+        std::swap(frame, decoded.m_frame);
+        if (!decoded.m_frame.empty() && decoded.m_frame.u && decoded.m_frame.u->refcount == 1 && m_freeBuffers.size() < m_aheadFrames)
+            m_freeBuffers.emplace_back(std::move(decoded.m_frame));
+        return true;
+    }
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <map>
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+
+#include <opencv2/opencv.hpp>
+
+#include "frame_latency.h"
+
+///
+/// \brief The ImageSequenceCapture class
+/// Frames from the directory of the images (MOT datasets, archive exports) or from the pattern of the files:
+/// the worker threads decode ahead up to aheadFrames, the reader gets the frames in the order of the file names.
+/// The buffers of the read frames go back to the workers, JPEG is decoded by libjpeg-turbo with USE_TURBOJPEG
+///
+class ImageSequenceCapture
+{
+public:
+    ImageSequenceCapture() = default;
+    ImageSequenceCapture(const ImageSequenceCapture&) = delete;
+    ImageSequenceCapture& operator=(const ImageSequenceCapture&) = delete;
+    ~ImageSequenceCapture();
+
+    ///
+    /// \brief IsImageSequence
+    /// \param path
+    /// \return true for the directory, the glob pattern (img1/*.jpg) and the printf pattern (img1/%06d.jpg)
+    ///
+    static bool IsImageSequence(const std::string& path);
+
+    ///
+    /// \brief Open
+    /// \param path - directory or the pattern of the files
+    /// \param startFrame - count of the skipped first images
+    /// \param threads - decoding threads, 0 - hardware concurrency
+    /// \param aheadFrames - count of the decoded frames waiting for the reader, 0 - 2 per thread
+    /// \return false if there are no images
+    ///
+    bool Open(const std::string& path, int startFrame, size_t threads, size_t aheadFrames);
+
+    ///
+    /// \brief Read
+    /// \param frame - gets the next frame, its previous buffer is reused by the workers
+    /// \param timestamps - gets the Capture and the Decoded stamps of the decoding
+    /// \return false if the sequence is finished
+    ///
+    bool Read(cv::Mat& frame, latency::FrameTimestamps* timestamps = nullptr);
+
+    ///
+    /// \brief Stop
+    /// Stops the decoding threads
+    ///
+    void Stop();
+
+    ///
+    /// \brief Fps
+    /// \return frameRate of seqinfo.ini of the MOT sequence or 0
+    ///
+    float Fps() const
+    {
+        return m_fps;
+    }
+    ///
+    size_t FramesCount() const
+    {
+        return m_files.size();
+    }
+    ///
+    size_t ThreadsCount() const
+    {
+        return m_threads.size();
+    }
+
+private:
+    std::vector<std::string> m_files;
+    float m_fps = 0;
+    size_t m_aheadFrames = 1;
+
+    struct DecodedFrame
+    {
+        cv::Mat m_frame;
+        int64_t m_captureNs = 0;
+        int64_t m_decodedNs = 0;
+    };
+    std::map<size_t, DecodedFrame> m_decoded; // By the index of the file
+    std::vector<cv::Mat> m_freeBuffers;
+    size_t m_nextDecode = 0;
+    size_t m_nextRead = 0;
+
+    std::atomic<bool> m_stop { false };
+
+    std::mutex m_mutex;
+    std::condition_variable m_decodedCond;
+    std::condition_variable m_freeCond;
+    std::vector<std::thread> m_threads;
+
+    void DecodeThread();
+};
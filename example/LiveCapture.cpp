@@ -0,0 +1,102 @@
+#include "LiveCapture.h"
+
+///
+/// \brief LiveCapture::LiveCapture
+/// \param capture
+/// \param keepFrames
+///
+LiveCapture::LiveCapture(cv::VideoCapture& capture, size_t keepFrames)
+    : m_capture(capture), m_keepFrames(std::max<size_t>(1, keepFrames))
+{
+    m_thread = std::thread(&LiveCapture::GrabThread, this);
+}
+
+///
+/// \brief LiveCapture::~LiveCapture
+///
+LiveCapture::~LiveCapture()
+{
+    Stop();
+}
+
+///
+/// \brief LiveCapture::Stop
+///
+void LiveCapture::Stop()
+{
+    m_stop = true;
+    m_cond.notify_all();
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+///
+/// \brief LiveCapture::GrabThread
+///
+void LiveCapture::GrabThread()
+{
+    for (size_t ind = 1; !m_stop.load(); ++ind)
+    {
+        GrabbedFrame grabbed;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_freeBuffers.empty())
+            {
+                grabbed.m_frame = m_freeBuffers.back();
+                m_freeBuffers.pop_back();
+            }
+        }
+        grabbed.m_captureNs = latency::Now();
+        if (!m_capture.read(grabbed.m_frame) || grabbed.m_frame.empty())
+            break;
+        grabbed.m_decodedNs = latency::Now();
+        grabbed.m_ind = ind;
+        ++m_grabbed;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_frames.emplace_back(std::move(grabbed));
+        if (m_frames.size() > m_keepFrames)
+        {
+            if (m_freeBuffers.size() < m_keepFrames + 1)
+                m_freeBuffers.emplace_back(std::move(m_frames.front().m_frame));
+            m_frames.pop_front();
+            ++m_dropped;
+        }
+        m_cond.notify_one();
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_finished = true;
+    m_cond.notify_all();
+}
+
+///
+/// \brief LiveCapture::Read
+/// \param frame
+/// \param dropped
+/// \param timestamps
+/// \return
+///
+bool LiveCapture::Read(cv::Mat& frame, size_t& dropped, latency::FrameTimestamps* timestamps)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cond.wait(lock, [this]() { return !m_frames.empty() || m_finished || m_stop.load(); });
+    if (m_frames.empty())
+        return false;
+
+    GrabbedFrame& grabbed = m_frames.front();
+    dropped = grabbed.m_ind - m_lastReadInd - 1;
+    m_lastReadInd = grabbed.m_ind;
+    if (timestamps)
+    {
+        timestamps->Reset();
+        timestamps->Set(latency::Stamp::Capture, grabbed.m_captureNs);
+        timestamps->Set(latency::Stamp::Decoded, grabbed.m_decodedNs);
+    }
+
+    // The previous buffer of the reader goes to the grab thread if nobody else keeps it
+    std::swap(frame, grabbed.m_frame);
+    if (!grabbed.m_frame.empty() && grabbed.m_frame.u && grabbed.m_frame.u->refcount == 1 && m_freeBuffers.size() < m_keepFrames + 1)
+        m_freeBuffers.emplace_back(std::move(grabbed.m_frame));
+    m_frames.pop_front();
+    return true;
+}
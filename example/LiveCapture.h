@@ -0,0 +1,84 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+
+#include <opencv2/opencv.hpp>
+
+#include "frame_latency.h"
+
+///
+/// \brief The LiveCapture class
+/// Capture of the live stream (RTSP camera): the separate thread grabs the frames as fast as the camera sends them
+/// and keeps only the last keepFrames, the older frames are dropped. So the internal buffer of cv::VideoCapture
+/// doesn't grow when the processing falls behind and the reader always gets the fresh frames
+///
+class LiveCapture
+{
+public:
+    ///
+    /// \brief LiveCapture
+    /// \param capture - opened capture, it must live until Stop
+    /// \param keepFrames - count of the last frames waiting for the reader, at least 1
+    ///
+    LiveCapture(cv::VideoCapture& capture, size_t keepFrames);
+    LiveCapture(const LiveCapture&) = delete;
+    LiveCapture& operator=(const LiveCapture&) = delete;
+    ~LiveCapture();
+
+    ///
+    /// \brief Read
+    /// \param frame - gets the oldest kept frame, its previous buffer is reused by the grab thread
+    /// \param dropped - count of the frames dropped before this frame
+    /// \param timestamps - gets the Capture and the Decoded stamps of the grab
+    /// \return false if the stream is finished
+    ///
+    bool Read(cv::Mat& frame, size_t& dropped, latency::FrameTimestamps* timestamps = nullptr);
+
+    ///
+    /// \brief Stop
+    /// Stops the grab thread
+    ///
+    void Stop();
+
+    ///
+    size_t GrabbedCount() const
+    {
+        return m_grabbed.load();
+    }
+    ///
+    size_t DroppedCount() const
+    {
+        return m_dropped.load();
+    }
+
+private:
+    cv::VideoCapture& m_capture;
+    size_t m_keepFrames = 1;
+
+    struct GrabbedFrame
+    {
+        cv::Mat m_frame;
+        size_t m_ind = 0;
+        int64_t m_captureNs = 0;
+        int64_t m_decodedNs = 0;
+    };
+    std::deque<GrabbedFrame> m_frames;
+    std::vector<cv::Mat> m_freeBuffers;
+    size_t m_lastReadInd = 0;
+    bool m_finished = false;
+
+    std::atomic<bool> m_stop { false };
+    std::atomic<size_t> m_grabbed { 0 };
+    std::atomic<size_t> m_dropped { 0 };
+
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    std::thread m_thread;
+
+    void GrabThread();
+};
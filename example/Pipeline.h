@@ -0,0 +1,197 @@
+#pragma once
+
+#include <deque>
+#include <algorithm>
+#include <mutex>
+#include <chrono>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+#include <condition_variable>
+
+#include <opencv2/core.hpp>
+
+///
+/// \brief The BoundedQueue class
+/// Queue between two stages of the pipeline: Push waits while the queue is full, Pop waits while it's empty.
+/// After Close the Push is rejected and Pop returns the remaining items and then false
+///
+template<typename T>
+class BoundedQueue
+{
+public:
+    ///
+    /// \brief BoundedQueue
+    /// \param capacity - at least 1
+    ///
+    explicit BoundedQueue(size_t capacity)
+        : m_capacity(std::max<size_t>(1, capacity))
+    {
+    }
+
+    ///
+    /// \brief Push
+    /// \param item
+    /// \return false if the queue was closed
+    ///
+    bool Push(T&& item)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_notFull.wait(lock, [this]() { return m_closed || m_items.size() < m_capacity; });
+        if (m_closed)
+            return false;
+        m_items.emplace_back(std::move(item));
+        m_occupancySum += m_items.size();
+        ++m_pushCount;
+        m_maxOccupancy = std::max(m_maxOccupancy, m_items.size());
+        m_notEmpty.notify_one();
+        return true;
+    }
+
+    ///
+    /// \brief TryPush
+    /// \param item
+    /// \return false if the queue is full or closed, the item isn't moved
+    ///
+    bool TryPush(T&& item)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_closed || m_items.size() >= m_capacity)
+            return false;
+        m_items.emplace_back(std::move(item));
+        m_occupancySum += m_items.size();
+        ++m_pushCount;
+        m_maxOccupancy = std::max(m_maxOccupancy, m_items.size());
+        m_notEmpty.notify_one();
+        return true;
+    }
+
+    ///
+    /// \brief Pop
+    /// \param item
+    /// \param timeoutMs - max waiting time
+    /// \return false if the queue was closed and empty or on the timeout
+    ///
+    bool Pop(T& item, int timeoutMs)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (!m_notEmpty.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this]() { return m_closed || !m_items.empty(); }))
+            return false;
+        if (m_items.empty())
+            return false;
+        item = std::move(m_items.front());
+        m_items.pop_front();
+        m_notFull.notify_one();
+        return true;
+    }
+
+    ///
+    /// \brief Close
+    /// Wakes up the all waiting stages
+    ///
+    void Close()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closed = true;
+        m_notFull.notify_all();
+        m_notEmpty.notify_all();
+    }
+
+    ///
+    bool Closed() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_closed;
+    }
+    ///
+    size_t Size() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_items.size();
+    }
+    ///
+    size_t Capacity() const
+    {
+        return m_capacity;
+    }
+    ///
+    /// \brief MeanOccupancy
+    /// \return The mean queue size after the Push
+    ///
+    double MeanOccupancy() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_pushCount ? (static_cast<double>(m_occupancySum) / m_pushCount) : 0.;
+    }
+    ///
+    size_t MaxOccupancy() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_maxOccupancy;
+    }
+
+private:
+    size_t m_capacity = 1;
+    std::deque<T> m_items;
+    bool m_closed = false;
+
+    size_t m_occupancySum = 0;
+    size_t m_pushCount = 0;
+    size_t m_maxOccupancy = 0;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_notFull;
+    std::condition_variable m_notEmpty;
+};
+
+///
+/// \brief The PipelineStageStats struct
+/// Latency of the one stage of the pipeline
+///
+struct PipelineStageStats
+{
+    std::string m_name;
+    std::atomic<int64> m_ticks { 0 };
+    std::atomic<size_t> m_items { 0 };
+
+    PipelineStageStats(const std::string& name)
+        : m_name(name)
+    {
+    }
+
+    ///
+    void Add(int64 ticks)
+    {
+        m_ticks += ticks;
+        ++m_items;
+    }
+
+    ///
+    /// \brief MeanLatency
+    /// \return Mean processing time of the one item in milliseconds
+    ///
+    double MeanLatency() const
+    {
+        const size_t items = m_items.load();
+        return items ? (1000. * m_ticks.load() / (cv::getTickFrequency() * items)) : 0.;
+    }
+};
+
+///
+/// \brief PrintPipelineStats
+/// \param stages - latency of the stages
+/// \param occupancy - mean and max occupancy of the queues after the every stage except the last
+///
+inline void PrintPipelineStats(const std::vector<const PipelineStageStats*>& stages, const std::vector<std::pair<double, size_t>>& occupancy)
+{
+    std::cout << "Pipeline:";
+    for (size_t i = 0; i < stages.size(); ++i)
+    {
+        std::cout << " " << stages[i]->m_name << " " << std::fixed << std::setprecision(1) << stages[i]->MeanLatency() << " ms";
+        if (i < occupancy.size())
+            std::cout << " -> [" << std::setprecision(1) << occupancy[i].first << "/" << occupancy[i].second << "] ->";
+    }
+    std::cout << std::defaultfloat << std::endl;
+}
@@ -0,0 +1,280 @@
+#include "TrackletsStitcher.h"
+#include "task_scheduler.h"
+
+#include <algorithm>
+#include <cmath>
+
+///
+/// \brief TrackletsStitcher::TrackletsStitcher
+/// \param settings
+///
+TrackletsStitcher::TrackletsStitcher(const StitchSettings& settings)
+    : m_settings(settings)
+{
+    m_settings.m_maxGap = std::max(1, m_settings.m_maxGap);
+}
+
+///
+/// \brief TrackletsStitcher::Process
+/// \param inFile
+/// \param outFile
+/// \return
+///
+bool TrackletsStitcher::Process(const std::string& inFile, const std::string& outFile)
+{
+    if (!LoadTracklets(inFile))
+        return false;
+    std::cout << "TrackletsStitcher: " << m_tracklets.size() << " tracklets in " << inFile << std::endl;
+
+    BuildIndex();
+    const size_t linksCount = MatchTracklets();
+    std::cout << "TrackletsStitcher: " << linksCount << " tracklets are merged" << std::endl;
+
+    return WriteResult(inFile, outFile);
+}
+
+///
+/// \brief TrackletsStitcher::LoadTracklets
+/// \param inFile
+/// \return
+///
+bool TrackletsStitcher::LoadTracklets(const std::string& inFile)
+{
+    m_tracklets.clear();
+    m_trackletsInds.clear();
+    m_frameSize = cv::Size(1, 1);
+
+    ResultsReader reader(inFile);
+    if (!reader.Open())
+    {
+        std::cerr << "TrackletsStitcher: can't open " << inFile << std::endl;
+        return false;
+    }
+
+    ResultsReader::Detection detect;
+    std::string line;
+    while (reader.Read(detect, line))
+    {
+        m_frameSize.width = std::max(m_frameSize.width, detect.m_rect.x + detect.m_rect.width);
+        m_frameSize.height = std::max(m_frameSize.height, detect.m_rect.y + detect.m_rect.height);
+
+        auto it = m_trackletsInds.find(detect.m_trackID);
+        if (it == std::end(m_trackletsInds))
+        {
+            Tracklet tracklet;
+            tracklet.m_ID = detect.m_trackID;
+            tracklet.m_type = detect.m_type;
+            tracklet.m_firstFrame = detect.m_frame;
+            tracklet.m_firstRect = detect.m_rect;
+            tracklet.m_lastFrame = detect.m_frame;
+            tracklet.m_lastRect = detect.m_rect;
+            tracklet.m_next = m_tracklets.size();
+            tracklet.m_root = m_tracklets.size();
+            m_trackletsInds.emplace(detect.m_trackID, m_tracklets.size());
+            m_tracklets.emplace_back(tracklet);
+            continue;
+        }
+
+        // Lines are ordered by frames
+        Tracklet& tracklet = m_tracklets[it->second];
+        if (detect.m_frame <= tracklet.m_lastFrame)
+            continue;
+
+        const cv::Point2f diff(0.5f * (detect.m_rect.x + detect.m_rect.br().x - tracklet.m_lastRect.x - tracklet.m_lastRect.br().x),
+                               0.5f * (detect.m_rect.y + detect.m_rect.br().y - tracklet.m_lastRect.y - tracklet.m_lastRect.br().y));
+        const cv::Point2f velocity = diff / static_cast<float>(detect.m_frame - tracklet.m_lastFrame);
+        const bool firstVelocity = (tracklet.m_lastFrame == tracklet.m_firstFrame);
+        tracklet.m_lastVelocity = firstVelocity ? velocity : (1.f - m_settings.m_velocityAlpha) * tracklet.m_lastVelocity + m_settings.m_velocityAlpha * velocity;
+
+        // Velocity in the beginning is averaged over the same time as the mean lifetime of the EMA
+        if (tracklet.m_firstVelocityCount < static_cast<int>(1.f / std::max(m_settings.m_velocityAlpha, 0.01f)))
+        {
+            ++tracklet.m_firstVelocityCount;
+            tracklet.m_firstVelocity += (velocity - tracklet.m_firstVelocity) / static_cast<float>(tracklet.m_firstVelocityCount);
+        }
+
+        tracklet.m_lastFrame = detect.m_frame;
+        tracklet.m_lastRect = detect.m_rect;
+    }
+    return true;
+}
+
+///
+/// \brief TrackletsStitcher::BuildIndex
+///
+void TrackletsStitcher::BuildIndex()
+{
+    m_buckets.clear();
+    if (m_tracklets.empty())
+        return;
+
+    int minFrame = m_tracklets.front().m_firstFrame;
+    int maxFrame = minFrame;
+    double sizesSum = 0;
+    for (const auto& tracklet : m_tracklets)
+    {
+        minFrame = std::min(minFrame, tracklet.m_firstFrame);
+        maxFrame = std::max(maxFrame, tracklet.m_firstFrame);
+        sizesSum += std::sqrt(static_cast<double>(tracklet.m_firstRect.area()));
+    }
+    m_firstBucketFrame = minFrame;
+    m_buckets.resize(static_cast<size_t>((maxFrame - minFrame) / m_settings.m_maxGap) + 1);
+
+    for (size_t i = 0; i < m_tracklets.size(); ++i)
+    {
+        m_buckets[(m_tracklets[i].m_firstFrame - m_firstBucketFrame) / m_settings.m_maxGap].m_starts.push_back(i);
+    }
+
+    // Cell is about the gate of the mean object
+    const int cellSize = std::max(8, static_cast<int>(m_settings.m_maxDist * sizesSum / m_tracklets.size()));
+
+    tasks::ParallelFor(0, static_cast<int>(m_buckets.size()), [&](int bi)
+    {
+        TimeBucket& bucket = m_buckets[bi];
+        bucket.m_grid.Build(bucket.m_starts, m_frameSize, cellSize, [this](size_t ind)
+        {
+            const cv::Rect& r = m_tracklets[ind].m_firstRect;
+            return cv::Point2f(r.x + 0.5f * r.width, r.y + 0.5f * r.height);
+        });
+    });
+}
+
+///
+/// \brief TrackletsStitcher::LinkCandidates
+/// Starts of the tracklets in the m_maxGap frames after the end near the predicted position
+/// \param end
+/// \param endInd
+/// \param links
+///
+void TrackletsStitcher::LinkCandidates(const Tracklet& end, size_t endInd, std::vector<Link>& links) const
+{
+    const cv::Point2f endCenter(end.m_lastRect.x + 0.5f * end.m_lastRect.width, end.m_lastRect.y + 0.5f * end.m_lastRect.height);
+    const float endSize = std::sqrt(static_cast<float>(std::max(1, end.m_lastRect.area())));
+
+    // Query area covers the way of the object during m_maxGap frames
+    const cv::Point2f farCenter = endCenter + static_cast<float>(m_settings.m_maxGap) * end.m_lastVelocity;
+    const float radius = 2.f * m_settings.m_maxDist * endSize;
+    const cv::Rect2f area(std::min(endCenter.x, farCenter.x) - radius, std::min(endCenter.y, farCenter.y) - radius,
+                          std::abs(farCenter.x - endCenter.x) + 2 * radius, std::abs(farCenter.y - endCenter.y) + 2 * radius);
+
+    const int firstBucket = std::max(0, (end.m_lastFrame + 1 - m_firstBucketFrame) / m_settings.m_maxGap);
+    const int lastBucket = std::min(static_cast<int>(m_buckets.size()) - 1, (end.m_lastFrame + m_settings.m_maxGap - m_firstBucketFrame) / m_settings.m_maxGap);
+    for (int bi = firstBucket; bi <= lastBucket; ++bi)
+    {
+        const TimeBucket& bucket = m_buckets[bi];
+        bucket.m_grid.Query(area, [&](size_t pointInd)
+        {
+            const size_t startInd = bucket.m_starts[pointInd];
+            const Tracklet& start = m_tracklets[startInd];
+
+            const int gap = start.m_firstFrame - end.m_lastFrame;
+            if (gap < 1 || gap > m_settings.m_maxGap || start.m_type != end.m_type)
+                return;
+
+            const float startArea = static_cast<float>(std::max(1, start.m_firstRect.area()));
+            const float endArea = endSize * endSize;
+            if (std::min(startArea, endArea) < m_settings.m_minSizeRatio * std::max(startArea, endArea))
+                return;
+
+            // Both tracklets are extrapolated to the middle of the gap
+            const float halfGap = 0.5f * gap;
+            const cv::Point2f startCenter(start.m_firstRect.x + 0.5f * start.m_firstRect.width, start.m_firstRect.y + 0.5f * start.m_firstRect.height);
+            const cv::Point2f diff = (endCenter + halfGap * end.m_lastVelocity) - (startCenter - halfGap * start.m_firstVelocity);
+            const float objSize = 0.5f * (endSize + std::sqrt(startArea));
+            const float dist = std::sqrt(diff.x * diff.x + diff.y * diff.y) / objSize;
+            if (dist > m_settings.m_maxDist)
+                return;
+
+            Link link;
+            link.m_end = endInd;
+            link.m_start = startInd;
+            link.m_cost = dist / m_settings.m_maxDist + static_cast<float>(gap) / m_settings.m_maxGap;
+            links.emplace_back(link);
+        });
+    }
+}
+
+///
+/// \brief TrackletsStitcher::MatchTracklets
+/// \return Count of the links
+///
+size_t TrackletsStitcher::MatchTracklets()
+{
+    std::vector<std::vector<Link>> endsLinks(m_tracklets.size());
+
+    tasks::ParallelFor(0, static_cast<int>(m_tracklets.size()), [&](int i)
+    {
+        LinkCandidates(m_tracklets[i], static_cast<size_t>(i), endsLinks[i]);
+    }, 64);
+
+    std::vector<Link> links;
+    for (auto& endLinks : endsLinks)
+    {
+        links.insert(std::end(links), std::begin(endLinks), std::end(endLinks));
+    }
+    endsLinks.clear();
+    std::sort(std::begin(links), std::end(links), [](const Link& l1, const Link& l2) { return l1.m_cost < l2.m_cost; });
+
+    // Greedy: the best links first, every tracklet has one continuation and one predecessor
+    std::vector<char> hasPrev(m_tracklets.size(), 0);
+    size_t linksCount = 0;
+    for (const auto& link : links)
+    {
+        Tracklet& end = m_tracklets[link.m_end];
+        if (end.m_next != link.m_end || hasPrev[link.m_start])
+            continue;
+        end.m_next = link.m_start;
+        hasPrev[link.m_start] = 1;
+        ++linksCount;
+    }
+
+    // Chains go forward in time, the root is the first tracklet
+    for (size_t i = 0; i < m_tracklets.size(); ++i)
+    {
+        if (hasPrev[i])
+            continue;
+        for (size_t ind = i; ; ind = m_tracklets[ind].m_next)
+        {
+            m_tracklets[ind].m_root = i;
+            if (m_tracklets[ind].m_next == ind)
+                break;
+        }
+    }
+    return linksCount;
+}
+
+///
+/// \brief TrackletsStitcher::WriteResult
+/// \param inFile
+/// \param outFile
+/// \return
+///
+bool TrackletsStitcher::WriteResult(const std::string& inFile, const std::string& outFile) const
+{
+    ResultsReader reader(inFile);
+    if (!reader.Open())
+    {
+        std::cerr << "TrackletsStitcher: can't open " << inFile << std::endl;
+        return false;
+    }
+    std::ofstream resCSV(outFile);
+    if (!resCSV.is_open())
+    {
+        std::cerr << "TrackletsStitcher: can't open " << outFile << std::endl;
+        return false;
+    }
+
+    ResultsReader::Detection detect;
+    std::string line;
+    while (reader.Read(detect, line))
+    {
+        auto it = m_trackletsInds.find(detect.m_trackID);
+        if (it == std::end(m_trackletsInds))
+            continue;
+        // ID is the last column
+        const Tracklet& root = m_tracklets[m_tracklets[it->second].m_root];
+        resCSV.write(line.data(), line.rfind(',') + 1);
+        resCSV << root.m_ID.ID2Str() << '\n';
+    }
+    return true;
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "defines.h"
+#include "FileLogger.h"
+#include "spatial_grid.h"
+
+///
+/// \brief The StitchSettings struct
+///
+struct StitchSettings
+{
+    int m_maxGap = 50;            // Maximum frames between the end of the tracklet and the start of its continuation
+    float m_maxDist = 1.5f;       // Distance between the predicted end and the start in the object sizes
+    float m_minSizeRatio = 0.5f;  // Minimal ratio of the areas of the end and the start
+    float m_velocityAlpha = 0.3f; // Weight of the new velocity in the exponential moving average
+};
+
+///
+/// \brief The TrackletsStitcher class
+/// Offline post-processing of the ResultsLog csv: the broken tracks are merged into one ID.
+/// The first streaming pass collects only the ends and the starts of the tracklets, so memory depends
+/// on the tracklets count but not on the length of the recording.
+/// Starts are indexed by the time buckets of m_maxGap frames with the spatial grid in every bucket,
+/// ends are matched with the predicted position in parallel, the best pairs are linked greedily.
+/// The second streaming pass writes the file with the new IDs
+///
+class TrackletsStitcher
+{
+public:
+    TrackletsStitcher(const StitchSettings& settings);
+
+    ///
+    /// \brief Process
+    /// \param inFile - csv of ResultsLog
+    /// \param outFile - csv with the same lines and the merged IDs
+    /// \return
+    ///
+    bool Process(const std::string& inFile, const std::string& outFile);
+
+private:
+    StitchSettings m_settings;
+
+    ///
+    /// \brief The Tracklet struct
+    /// Start and end of the track with ID
+    ///
+    struct Tracklet
+    {
+        track_id_t m_ID = 0;
+        objtype_t m_type = bad_type;
+
+        int m_firstFrame = 0;
+        cv::Rect m_firstRect;
+        cv::Point2f m_firstVelocity; // pixels/frame in the beginning
+        int m_firstVelocityCount = 0;
+
+        int m_lastFrame = 0;
+        cv::Rect m_lastRect;
+        cv::Point2f m_lastVelocity;  // pixels/frame in the end
+
+        size_t m_next = 0;           // Index of the continuation or the own index
+        size_t m_root = 0;           // Index of the first tracklet of the chain
+    };
+    std::vector<Tracklet> m_tracklets;
+    std::unordered_map<track_id_t, size_t> m_trackletsInds;
+    cv::Size m_frameSize;
+
+    ///
+    /// \brief The TimeBucket struct
+    /// Starts of the tracklets in the frames [index * m_maxGap, (index + 1) * m_maxGap)
+    ///
+    struct TimeBucket
+    {
+        std::vector<size_t> m_starts;
+        SpatialGrid m_grid;
+    };
+    std::vector<TimeBucket> m_buckets;
+    int m_firstBucketFrame = 0;
+
+    ///
+    /// \brief The Link struct
+    ///
+    struct Link
+    {
+        size_t m_end = 0;
+        size_t m_start = 0;
+        float m_cost = 0.f;
+    };
+
+    bool LoadTracklets(const std::string& inFile);
+    void BuildIndex();
+    void LinkCandidates(const Tracklet& end, size_t endInd, std::vector<Link>& links) const;
+    size_t MatchTracklets();
+    bool WriteResult(const std::string& inFile, const std::string& outFile) const;
+};
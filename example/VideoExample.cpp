@@ -1,8 +1,35 @@
 #include <iomanip>
+#include <fstream>
+#include <sstream>
 #include <ctime>
 
 #include "VideoExample.h"
 
+namespace
+{
+///
+/// \brief The BatchStamps class
+/// Marks the start of the stage on the all frames of the batch and the end when the stage is finished
+///
+class BatchStamps
+{
+public:
+    BatchStamps(FrameInfo& frame, latency::Stamp start, latency::Stamp end)
+        : m_frame(frame), m_end(end)
+    {
+        m_frame.MarkStamp(start);
+    }
+    ~BatchStamps()
+    {
+        m_frame.MarkStamp(m_end);
+    }
+
+private:
+    FrameInfo& m_frame;
+    latency::Stamp m_end;
+};
+}
+
 ///
 /// \brief VideoExample::VideoExample
 /// \param parser
@@ -17,6 +44,37 @@ VideoExample::VideoExample(const cv::CommandLineParser& parser)
     m_endFrame = parser.get<int>("end_frame");
     m_finishDelay = parser.get<int>("end_delay");
 	m_batchSize = std::max(1, parser.get<int>("batch_size"));
+	m_headless = parser.get<int>("headless") != 0;
+	m_renderEvery = std::max(0, parser.get<int>("render_every"));
+	m_writeQueueSize = static_cast<size_t>(std::max(0, parser.get<int>("write_queue")));
+	m_writeDropPolicy = static_cast<AsyncVideoWriter::DropPolicy>(std::max(0, std::min(static_cast<int>(AsyncVideoWriter::DropPolicy::DropOldest), parser.get<int>("write_drop"))));
+	m_hwEncode = parser.get<int>("hw_encode") != 0;
+	m_liveKeepFrames = static_cast<size_t>(std::max(0, parser.get<int>("live")));
+	m_decodeThreads = static_cast<size_t>(std::max(0, parser.get<int>("decode_threads")));
+	m_hwDecode = static_cast<HWDecode>(std::max(0, std::min(static_cast<int>(HWDecode::CudaCodec), parser.get<int>("hw_decode"))));
+	if (!parser.get<std::string>("trace").empty())
+	{
+		trace::Recorder::Instance().Enable();
+		m_traceDumper = std::make_unique<trace::SloDumper>(parser.get<std::string>("trace"), parser.get<double>("trace_slo"));
+	}
+	m_placement.Parse(parser.get<std::string>("affinity"));
+	m_latencySla = std::max(0., parser.get<double>("latency_sla"));
+	if (!parser.get<std::string>("shm_tracks").empty())
+	{
+		m_tracksRing = std::make_unique<ShmTracksRing>();
+		if (!m_tracksRing->Create(parser.get<std::string>("shm_tracks"), 64, 1024, 256))
+			m_tracksRing.reset();
+	}
+	if (parser.get<int>("preview_port") > 0)
+	{
+		PreviewServer::Settings previewSettings;
+		previewSettings.m_port = parser.get<int>("preview_port");
+		previewSettings.m_width = std::max(0, parser.get<int>("preview_width"));
+		previewSettings.m_fps = std::max(0.f, parser.get<float>("preview_fps"));
+		m_previewServer = std::make_unique<PreviewServer>(previewSettings);
+		if (!m_previewServer->Start())
+			m_previewServer.reset();
+	}
 
     m_colors.emplace_back(255, 0, 0);
     m_colors.emplace_back(0, 255, 0);
@@ -30,8 +88,14 @@ VideoExample::VideoExample(const cv::CommandLineParser& parser)
 
     m_resultsLog.Open();
 
-    std::string settingsFile = parser.get<std::string>("settings");
-    m_trackerSettingsLoaded = ParseTrackerSettings(settingsFile, m_trackerSettings);
+    m_settingsFile = parser.get<std::string>("settings");
+    m_trackerSettingsLoaded = ParseTrackerSettings(m_settingsFile, m_trackerSettings);
+    // Auto takes the OpenCL state of the main thread once: the stage threads don't depend on the OpenCV defaults
+    m_execPolicy = m_trackerSettings.m_execPolicy.Resolve();
+    std::cout << "Execution policy: " << ((m_execPolicy.m_backend == exec::Backend::OpenCL) ? "OpenCL" : "CPU") << (m_execPolicy.m_openclDevice.empty() ? "" : (" on " + m_execPolicy.m_openclDevice)) << std::endl;
+    m_settingsReload = std::max(0, parser.get<int>("settings_reload"));
+    if (m_settingsReload && m_trackerSettingsLoaded)
+        m_settingsContent = ReadSettingsFile();
 
 	if (m_batchSize > 1)
 	{
@@ -45,10 +109,14 @@ VideoExample::VideoExample(const cv::CommandLineParser& parser)
 ///
 void VideoExample::SyncProcess()
 {
+    exec::ScopedStage execStage(m_execPolicy, "sync");
+    m_placement.Apply("sync");
+    m_stageLatencies = std::make_unique<latency::StageLatencies>("sync", m_latencySla);
     cv::VideoWriter writer;
 
 #ifndef SILENT_WORK
-    cv::namedWindow("Video", cv::WINDOW_NORMAL | cv::WINDOW_KEEPRATIO);
+    if (!m_headless)
+        cv::namedWindow("Video", cv::WINDOW_NORMAL | cv::WINDOW_KEEPRATIO);
     bool manualMode = false;
 #endif
 
@@ -57,12 +125,15 @@ void VideoExample::SyncProcess()
 
     int framesCounter = m_startFrame + 1;
 
+    // Engine of the detector is prepared in parallel with the capture opening
+    auto prefetch = std::async(std::launch::async, [this]() { PrefetchDetector(); });
     cv::VideoCapture capture;
     if (!OpenCapture(capture))
     {
         std::cerr << "Can't open " << m_inFile << std::endl;
         return;
     }
+    prefetch.wait();
 
 	FrameInfo frameInfo(m_batchSize);
 	frameInfo.m_frames.resize(frameInfo.m_batchSize);
@@ -75,8 +146,7 @@ void VideoExample::SyncProcess()
 		size_t i = 0;
 		for (; i < m_batchSize; ++i)
 		{
-			capture >> frameInfo.m_frames[i].GetMatBGRWrite();
-			if (frameInfo.m_frames[i].empty())
+			if (!ReadFrame(capture, frameInfo.m_frames[i], framesCounter))
 				break;
 			frameInfo.m_frameInds[i] = framesCounter;
 
@@ -93,24 +163,26 @@ void VideoExample::SyncProcess()
 		if (!m_isDetectorInitialized || !m_isTrackerInitialized)
 		{
 			cv::UMat ufirst = frameInfo.m_frames[0].GetUMatBGR();
+			// Detector and tracker with its embeddings networks are independent, so they are initialized in parallel
+			std::future<bool> detectorInit;
+			if (!m_isDetectorInitialized)
+				detectorInit = std::async(std::launch::async, [this, ufirst]() { return InitDetector(ufirst); });
+			if (!m_isTrackerInitialized)
+				m_isTrackerInitialized = InitTracker(ufirst);
+			if (detectorInit.valid())
+				m_isDetectorInitialized = detectorInit.get();
+
 			if (!m_isDetectorInitialized)
 			{
-				m_isDetectorInitialized = InitDetector(ufirst);
-				if (!m_isDetectorInitialized)
-				{
-					std::cerr << "CaptureAndDetect: Detector initialize error!!!" << std::endl;
-					break;
-				}
+				std::cerr << "CaptureAndDetect: Detector initialize error!!!" << std::endl;
+				break;
 			}
 			if (!m_isTrackerInitialized)
 			{
-				m_isTrackerInitialized = InitTracker(ufirst);
-				if (!m_isTrackerInitialized)
-				{
-					std::cerr << "CaptureAndDetect: Tracker initialize error!!!" << std::endl;
-					break;
-				}
+				std::cerr << "CaptureAndDetect: Tracker initialize error!!!" << std::endl;
+				break;
 			}
+			m_trackerReady = true;
 		}
 
         int64 t1 = cv::getTickCount();
@@ -122,10 +194,20 @@ void VideoExample::SyncProcess()
 
         allTime += t2 - t1;
         int currTime = cvRound(1000 * (t2 - t1) / freq);
+        if (m_traceDumper)
+            m_traceDumper->Check(currTime);
 
+		LogInterpolated(frameInfo);
 		for (i = 0; i < m_batchSize; ++i)
 		{
+			if (m_headless)
+			{
+				OutputHeadless(frameInfo.m_frames[i], frameInfo.m_tracks[i], frameInfo.m_frameInds[i], currTime);
+				PublishFrame(frameInfo.m_frames[i]);
+				continue;
+			}
 			DrawData(frameInfo.m_frames[i].GetMatBGR(), frameInfo.m_tracks[i], frameInfo.m_frameInds[i], currTime);
+			PublishFrame(frameInfo.m_frames[i]);
 
 #ifndef SILENT_WORK
 			cv::imshow("Video", frameInfo.m_frames[i].GetMatBGR());
@@ -136,6 +218,8 @@ void VideoExample::SyncProcess()
 				break;
 			else if (k == 'm' || k == 'M')
 				manualMode = !manualMode;
+			else if (k == 't' || k == 'T')
+				DumpTrace();
 #else
 			std::this_thread::sleep_for(std::chrono::milliseconds(1));
 #endif
@@ -145,12 +229,19 @@ void VideoExample::SyncProcess()
         if (framesCounter % 100 == 0)
             m_resultsLog.Flush();
     }
+    StopCapture();
 
+    StopRender();
+    m_asyncWriter.reset(); // Writes the queued frames
     int64 stopLoopTime = cv::getTickCount();
 
     std::cout << "algorithms time = " << (allTime / freq) << ", work time = " << ((stopLoopTime - startLoopTime) / freq) << std::endl;
+    m_stageLatencies->PrintReport();
+    if (m_traceDumper)
+        m_traceDumper->Dump();
 #ifndef SILENT_WORK
-    cv::waitKey(m_finishDelay);
+    if (!m_headless)
+        cv::waitKey(m_finishDelay);
 #endif
 }
 
@@ -163,12 +254,17 @@ void VideoExample::AsyncProcess()
 {
     std::atomic<bool> stopCapture(false);
 
+    TRACE_THREAD_NAME("tracking_render");
+    exec::ScopedStage execStage(m_execPolicy, "tracking_render");
+    m_placement.Apply("tracking_render");
+    m_stageLatencies = std::make_unique<latency::StageLatencies>("async", m_latencySla);
     std::thread thCapDet(CaptureAndDetect, this, std::ref(stopCapture));
 
     cv::VideoWriter writer;
 
 #ifndef SILENT_WORK
-    cv::namedWindow("Video", cv::WINDOW_NORMAL | cv::WINDOW_KEEPRATIO);
+    if (!m_headless)
+        cv::namedWindow("Video", cv::WINDOW_NORMAL | cv::WINDOW_KEEPRATIO);
     bool manualMode = false;
 #endif
 
@@ -184,6 +280,7 @@ void VideoExample::AsyncProcess()
         std::cout << "--- waiting tracking from " << (processCounter % 2) << " ind = " << processCounter << std::endl;
 #endif
         {
+            TRACE_SPAN("wait_captured", "example");
             std::unique_lock<std::mutex> lock(frameInfo.m_mutex);
             if (!frameInfo.m_cond.wait_for(lock, std::chrono::milliseconds(m_captureTimeOut), [&frameInfo] { return frameInfo.m_captured.load(); }))
             {
@@ -203,25 +300,38 @@ void VideoExample::AsyncProcess()
                 frameInfo.m_cond.notify_one();
                 break;
             }
+            m_trackerReady = true;
         }
 
         int64 t1 = cv::getTickCount();
 
+        if (frameInfo.m_embeddingsFuture.valid())
+            frameInfo.m_embeddingsFuture.get();
         Tracking(frameInfo);
 
         int64 t2 = cv::getTickCount();
 
         allTime += t2 - t1 + frameInfo.m_dt;
         int currTime = cvRound(1000 * (t2 - t1 + frameInfo.m_dt) / freq);
+        if (m_traceDumper)
+            m_traceDumper->Check(currTime);
 
 #if SHOW_ASYNC_LOGS
         std::cout << "--- Frame " << frameInfo.m_frameInds[0] << ": td = " << (1000 * frameInfo.m_dt / freq) << ", tt = " << (1000 * (t2 - t1) / freq) << std::endl;
 #endif
 
+		LogInterpolated(frameInfo);
 		int key = 0;
 		for (size_t i = 0; i < m_batchSize; ++i)
 		{
+			if (m_headless)
+			{
+				OutputHeadless(frameInfo.m_frames[i], frameInfo.m_tracks[i], frameInfo.m_frameInds[i], currTime);
+				PublishFrame(frameInfo.m_frames[i]);
+				continue;
+			}
 			DrawData(frameInfo.m_frames[i].GetMatBGR(), frameInfo.m_tracks[i], frameInfo.m_frameInds[i], currTime);
+			PublishFrame(frameInfo.m_frames[i]);
 
 			WriteFrame(writer, frameInfo.m_frames[i].GetMatBGR());
 
@@ -232,6 +342,8 @@ void VideoExample::AsyncProcess()
 			key = cv::waitKey(waitTime);
 			if (key == 'm' || key == 'M')
 				manualMode = !manualMode;
+			else if (key == 't' || key == 'T')
+				DumpTrace();
 			else
 				break;
 #else
@@ -259,12 +371,303 @@ void VideoExample::AsyncProcess()
     if (thCapDet.joinable())
         thCapDet.join();
 
+    StopRender();
+    m_asyncWriter.reset(); // Writes the queued frames
     int64 stopLoopTime = cv::getTickCount();
 
     std::cout << "--- algorithms time = " << (allTime / freq) << ", work time = " << ((stopLoopTime - startLoopTime) / freq) << std::endl;
+    m_stageLatencies->PrintReport();
+    if (m_traceDumper)
+        m_traceDumper->Dump();
 
 #ifndef SILENT_WORK
-    cv::waitKey(m_finishDelay);
+    if (!m_headless)
+        cv::waitKey(m_finishDelay);
+#endif
+}
+
+///
+/// \brief VideoExample::PipelineProcess
+/// Capture -> preprocess -> detect -> embed -> track -> render/write: every stage runs by its own thread (render on the
+/// calling thread for the imshow), the stages are connected by the bounded queues of queueDepth batches.
+/// The batches are reused from the pool so the capture doesn't allocate the new frames
+/// \param queueDepth
+///
+void VideoExample::PipelineProcess(size_t queueDepth)
+{
+    using FramePtr = std::unique_ptr<FrameInfo>;
+
+    queueDepth = std::max<size_t>(1, queueDepth);
+    m_stageLatencies = std::make_unique<latency::StageLatencies>("pipeline", m_latencySla);
+    constexpr size_t StagesCount = 6;
+    const size_t poolSize = (StagesCount - 1) * queueDepth + StagesCount;
+
+	BoundedQueue<FramePtr> freeQueue(poolSize);
+    std::vector<std::unique_ptr<BoundedQueue<FramePtr>>> queues;
+    for (size_t i = 0; i < StagesCount - 1; ++i)
+    {
+        queues.emplace_back(std::make_unique<BoundedQueue<FramePtr>>(queueDepth));
+    }
+    for (size_t i = 0; i < poolSize; ++i)
+    {
+        auto frameInfo = std::make_unique<FrameInfo>(m_batchSize);
+        frameInfo->m_frames.resize(frameInfo->m_batchSize);
+        frameInfo->m_frameInds.resize(frameInfo->m_batchSize);
+        freeQueue.Push(std::move(frameInfo));
+    }
+
+    PipelineStageStats captureStats("capture");
+    PipelineStageStats preprocessStats("preprocess");
+    PipelineStageStats detectStats("detect");
+    PipelineStageStats embedStats("embed");
+    PipelineStageStats trackStats("track");
+    PipelineStageStats renderStats("render");
+    const std::vector<const PipelineStageStats*> stagesStats = { &captureStats, &preprocessStats, &detectStats, &embedStats, &trackStats, &renderStats };
+
+    auto printStats = [&]()
+    {
+        std::vector<std::pair<double, size_t>> occupancy;
+        for (const auto& queue : queues)
+        {
+            occupancy.emplace_back(queue->MeanOccupancy(), queue->MaxOccupancy());
+        }
+        PrintPipelineStats(stagesStats, occupancy);
+    };
+
+    std::atomic<bool> stopPipeline(false);
+    std::atomic<bool> needGray(false); // The detector or the tracker uses the gray frames
+    auto stopAll = [&]()
+    {
+        stopPipeline = true;
+        freeQueue.Close();
+        for (auto& queue : queues)
+        {
+            queue->Close();
+        }
+    };
+
+    constexpr int popTimeOut = 100;
+
+    // The all stages except capture and render: takes the batch from the input queue and passes it to the next
+    auto runStage = [&](BoundedQueue<FramePtr>& inQueue, BoundedQueue<FramePtr>& outQueue, PipelineStageStats& stats, auto process)
+    {
+        exec::ScopedStage execStage(m_execPolicy, stats.m_name);
+        m_placement.Apply(stats.m_name);
+        for (; !stopPipeline.load();)
+        {
+            FramePtr frameInfo;
+            if (!inQueue.Pop(frameInfo, popTimeOut))
+            {
+                if (inQueue.Closed())
+                    break;
+                continue;
+            }
+            int64 t1 = cv::getTickCount();
+            if (!process(*frameInfo))
+            {
+                stopAll();
+                break;
+            }
+            stats.Add(cv::getTickCount() - t1);
+            if (!outQueue.Push(std::move(frameInfo)))
+                break;
+        }
+        outQueue.Close();
+    };
+
+    std::thread thCapture([&]()
+    {
+        exec::ScopedStage execStage(m_execPolicy, "capture");
+        m_placement.Apply("capture");
+        auto prefetch = std::async(std::launch::async, [this]() { PrefetchDetector(); });
+        cv::VideoCapture capture;
+        if (!OpenCapture(capture))
+        {
+            std::cerr << "+++ Can't open " << m_inFile << std::endl;
+            stopAll();
+            return;
+        }
+        prefetch.wait();
+        int framesCounter = 0;
+        for (bool lastFrame = false; !stopPipeline.load() && !lastFrame;)
+        {
+            FramePtr frameInfo;
+            if (!freeQueue.Pop(frameInfo, popTimeOut))
+            {
+                if (freeQueue.Closed())
+                    break;
+                continue;
+            }
+            int64 t1 = cv::getTickCount();
+            size_t i = 0;
+            for (; i < frameInfo->m_batchSize && !lastFrame; ++i)
+            {
+                if (!ReadFrame(capture, frameInfo->m_frames[i], framesCounter))
+                    break;
+                frameInfo->m_frameInds[i] = framesCounter;
+                ++framesCounter;
+                lastFrame = m_endFrame && framesCounter > m_endFrame;
+            }
+            if (i < frameInfo->m_batchSize)
+                break;
+            captureStats.Add(cv::getTickCount() - t1);
+            if (!queues[0]->Push(std::move(frameInfo)))
+                break;
+        }
+        StopCapture();
+        queues[0]->Close();
+    });
+
+    std::thread thPreprocess(runStage, std::ref(*queues[0]), std::ref(*queues[1]), std::ref(preprocessStats), [&](FrameInfo& frameInfo)
+    {
+        // The upload and the conversion are cached by the frame and shared with the next stages
+        const bool gray = needGray.load();
+        for (auto& frame : frameInfo.m_frames)
+        {
+            if (gray)
+                frame.GetUMatGray();
+            else
+                frame.GetUMatBGR();
+        }
+        return true;
+    });
+
+    std::thread thDetect(runStage, std::ref(*queues[1]), std::ref(*queues[2]), std::ref(detectStats), [&](FrameInfo& frameInfo)
+    {
+        if (!m_isDetectorInitialized)
+        {
+            m_isDetectorInitialized = InitDetector(frameInfo.m_frames[0].GetUMatBGR());
+            if (!m_isDetectorInitialized)
+            {
+                std::cerr << "+++ PipelineProcess: Detector initialize error!!!" << std::endl;
+                return false;
+            }
+            if (m_detector->CanGrayProcessing())
+                needGray = true;
+        }
+        int64 t1 = cv::getTickCount();
+        Detection(frameInfo);
+        frameInfo.m_dt = cv::getTickCount() - t1;
+        return true;
+    });
+
+    std::thread thEmbed(runStage, std::ref(*queues[2]), std::ref(*queues[3]), std::ref(embedStats), [&](FrameInfo& frameInfo)
+    {
+        CalcEmbeddings(frameInfo);
+        return true;
+    });
+
+    std::thread thTrack(runStage, std::ref(*queues[3]), std::ref(*queues[4]), std::ref(trackStats), [&](FrameInfo& frameInfo)
+    {
+        if (!m_isTrackerInitialized)
+        {
+            m_isTrackerInitialized = InitTracker(frameInfo.m_frames[0].GetUMatBGR());
+            if (!m_isTrackerInitialized)
+            {
+                std::cerr << "--- PipelineProcess: Tracker initialize error!!!" << std::endl;
+                return false;
+            }
+            m_trackerReady = true;
+            if (!m_tracker->CanColorFrameToTrack())
+                needGray = true;
+        }
+        int64 t1 = cv::getTickCount();
+        Tracking(frameInfo);
+        frameInfo.m_dt += cv::getTickCount() - t1;
+        return true;
+    });
+
+    exec::ScopedStage execStage(m_execPolicy, "render");
+    m_placement.Apply("render");
+    cv::VideoWriter writer;
+
+#ifndef SILENT_WORK
+    if (!m_headless)
+        cv::namedWindow("Video", cv::WINDOW_NORMAL | cv::WINDOW_KEEPRATIO);
+    bool manualMode = false;
+#endif
+
+    double freq = cv::getTickFrequency();
+
+    int64 allTime = 0;
+    int64 startLoopTime = cv::getTickCount();
+    size_t processCounter = 0;
+    BoundedQueue<FramePtr>& renderQueue = *queues.back();
+    for (int key = 0; key != 27 && !stopPipeline.load();)
+    {
+        FramePtr frameInfo;
+        if (!renderQueue.Pop(frameInfo, popTimeOut))
+        {
+            if (renderQueue.Closed())
+                break;
+            continue;
+        }
+        int64 t1 = cv::getTickCount();
+
+        allTime += frameInfo->m_dt;
+        int currTime = cvRound(1000 * frameInfo->m_dt / freq);
+        if (m_traceDumper)
+            m_traceDumper->Check(currTime);
+
+		LogInterpolated(*frameInfo);
+		for (size_t i = 0; i < frameInfo->m_batchSize; ++i)
+		{
+			if (m_headless)
+			{
+				OutputHeadless(frameInfo->m_frames[i], frameInfo->m_tracks[i], frameInfo->m_frameInds[i], currTime);
+				PublishFrame(frameInfo->m_frames[i]);
+				continue;
+			}
+			DrawData(frameInfo->m_frames[i].GetMatBGR(), frameInfo->m_tracks[i], frameInfo->m_frameInds[i], currTime);
+			PublishFrame(frameInfo->m_frames[i]);
+
+			WriteFrame(writer, frameInfo->m_frames[i].GetMatBGR());
+
+#ifndef SILENT_WORK
+			cv::imshow("Video", frameInfo->m_frames[i].GetMatBGR());
+
+			int waitTime = manualMode ? 0 : 1;
+			key = cv::waitKey(waitTime);
+			if (key == 'm' || key == 'M')
+				manualMode = !manualMode;
+			else if (key == 't' || key == 'T')
+				DumpTrace();
+			else if (key == 27)
+				break;
+#endif
+		}
+        renderStats.Add(cv::getTickCount() - t1);
+        freeQueue.Push(std::move(frameInfo));
+
+        ++processCounter;
+        if (processCounter % 100 == 0)
+        {
+            m_resultsLog.Flush();
+            if (m_showLogs)
+                printStats();
+        }
+    }
+    stopAll();
+
+    for (auto th : { &thCapture, &thPreprocess, &thDetect, &thEmbed, &thTrack })
+    {
+        if (th->joinable())
+            th->join();
+    }
+
+    StopRender();
+    m_asyncWriter.reset(); // Writes the queued frames
+    int64 stopLoopTime = cv::getTickCount();
+
+    printStats();
+    std::cout << "--- algorithms time = " << (allTime / freq) << ", work time = " << ((stopLoopTime - startLoopTime) / freq) << std::endl;
+    m_stageLatencies->PrintReport();
+    if (m_traceDumper)
+        m_traceDumper->Dump();
+
+#ifndef SILENT_WORK
+    if (!m_headless)
+        cv::waitKey(m_finishDelay);
 #endif
 }
 
@@ -275,6 +678,10 @@ void VideoExample::AsyncProcess()
 ///
 void VideoExample::CaptureAndDetect(VideoExample* thisPtr, std::atomic<bool>& stopCapture)
 {
+    TRACE_THREAD_NAME("capture_detect");
+    exec::ScopedStage execStage(thisPtr->m_execPolicy, "capture_detect");
+    thisPtr->m_placement.Apply("capture_detect");
+    auto prefetch = std::async(std::launch::async, [thisPtr]() { thisPtr->PrefetchDetector(); });
     cv::VideoCapture capture;
     if (!thisPtr->OpenCapture(capture))
     {
@@ -282,6 +689,7 @@ void VideoExample::CaptureAndDetect(VideoExample* thisPtr, std::atomic<bool>& st
         stopCapture = true;
         return;
     }
+    prefetch.wait();
 
 	int framesCounter = 0;
 
@@ -296,6 +704,7 @@ void VideoExample::CaptureAndDetect(VideoExample* thisPtr, std::atomic<bool>& st
         std::cout << "+++ waiting capture to " << (processCounter % 2) << " ind = " << processCounter << std::endl;
 #endif
         {
+            TRACE_SPAN("wait_tracked", "example");
             std::unique_lock<std::mutex> lock(frameInfo.m_mutex);
             if (!frameInfo.m_cond.wait_for(lock, std::chrono::milliseconds(localTrackingTimeOut), [&frameInfo] { return !frameInfo.m_captured.load(); }))
             {
@@ -313,18 +722,16 @@ void VideoExample::CaptureAndDetect(VideoExample* thisPtr, std::atomic<bool>& st
 			frameInfo.m_frameInds.resize(frameInfo.m_batchSize);
 		}
 
-        cv::Mat frame;
 		size_t i = 0;
 		for (; i < frameInfo.m_batchSize; ++i)
 		{
-			capture >> frame;
-			if (frame.empty())
+			// Decoding into the buffer of the slot: the tracking thread has already released it
+			if (!thisPtr->ReadFrame(capture, frameInfo.m_frames[i], framesCounter))
 			{
 				std::cerr << "+++ CaptureAndDetect: frame is empty!" << std::endl;
 				frameInfo.m_cond.notify_one();
 				break;
 			}
-            frameInfo.m_frames[i].GetMatBGRWrite() = frame;
 			frameInfo.m_frameInds[i] = framesCounter;
 			++framesCounter;
 
@@ -354,6 +761,8 @@ void VideoExample::CaptureAndDetect(VideoExample* thisPtr, std::atomic<bool>& st
         int64 t2 = cv::getTickCount();
         frameInfo.m_dt = t2 - t1;
 
+        thisPtr->StartEmbeddings(frameInfo);
+
 #if SHOW_ASYNC_LOGS
         std::cout << "+++ capture m_captured " << (processCounter % 2) << " - captured still " << frameInfo.m_captured.load() << std::endl;
 #endif
@@ -363,6 +772,7 @@ void VideoExample::CaptureAndDetect(VideoExample* thisPtr, std::atomic<bool>& st
 
 		++processCounter;
     }
+    thisPtr->StopCapture();
     stopCapture = true;
 }
 
@@ -373,6 +783,11 @@ void VideoExample::CaptureAndDetect(VideoExample* thisPtr, std::atomic<bool>& st
 ///
 void VideoExample::Detection(FrameInfo& frame)
 {
+	TRACE_SPAN("detection", "example");
+	BatchStamps stamps(frame, latency::Stamp::DetectStart, latency::Stamp::DetectEnd);
+	if (DetectionOnDevice(frame))
+		return;
+
 	if (m_trackerSettings.m_useAbandonedDetection)
 	{
 		for (const auto& track : m_tracks)
@@ -391,7 +806,192 @@ void VideoExample::Detection(FrameInfo& frame)
             frames.emplace_back(frame.m_frames[i].GetUMatBGR());
 	}
 	frame.CleanRegions();
-    m_detector->Detect(frames, frame.m_regions);
+	frame.m_interpolated.assign(frame.m_frames.size(), false);
+
+	// Without the tracks and the motion only the every wake_idle_period frame is processed
+	frame.m_idleSkipped = false;
+	if (m_trackerSettings.m_wakeIdlePeriod > 1)
+	{
+		if (!m_motionWake)
+			m_motionWake = std::make_unique<MotionWake>(m_trackerSettings.m_wakeIdlePeriod, m_trackerSettings.m_wakeMotionScale,
+				m_trackerSettings.m_wakeDiffThreshold, m_trackerSettings.m_wakeMotionThreshold);
+		const bool hasTracks = m_activeTracks.load() > 0;
+		bool needProcess = false;
+		for (const auto& fr : frames)
+		{
+			needProcess |= m_motionWake->NeedProcess(fr, hasTracks);
+		}
+		if (!needProcess)
+		{
+			frame.m_idleSkipped = true;
+			return;
+		}
+	}
+
+	// Only the keyframes are detected and tracked, the tracks of the frames between them are extrapolated
+	if (m_trackerReady.load() && m_trackerSettings.m_detectKeyframeInterval > 1 && m_trackerSettings.m_keyframeInterpolation > 0 &&
+		!m_detector->CanGrayProcessing())
+	{
+		std::vector<cv::UMat> keyframes;
+		std::vector<size_t> keyframeInds;
+		for (size_t i = 0; i < frames.size(); ++i)
+		{
+			if (m_keyframesCounter++ % static_cast<size_t>(m_trackerSettings.m_detectKeyframeInterval) == 0)
+			{
+				keyframes.emplace_back(frames[i]);
+				keyframeInds.emplace_back(i);
+			}
+			else
+			{
+				frame.m_interpolated[i] = true;
+			}
+		}
+		if (!keyframes.empty())
+		{
+			std::vector<regions_t> regions;
+			m_detector->Detect(keyframes, regions);
+			for (size_t i = 0; i < keyframeInds.size() && i < regions.size(); ++i)
+			{
+				frame.m_regions[keyframeInds[i]].swap(regions[i]);
+			}
+		}
+	}
+	// Between the keyframes only the predicted tracks and the borders are detected
+	else if (m_trackerReady.load() && m_trackerSettings.m_detectKeyframeInterval > 1 && !m_detector->CanGrayProcessing())
+	{
+		if (!m_detectionScheduler)
+			m_detectionScheduler = std::make_unique<DetectionScheduler>(m_trackerSettings.m_detectKeyframeInterval,
+				m_trackerSettings.m_detectRoiMargin, m_trackerSettings.m_detectBorderRatio);
+		std::vector<cv::Rect> predictedRects;
+		{
+			std::lock_guard<std::mutex> lock(m_predictedMutex);
+			predictedRects = m_predictedRects;
+		}
+		m_detectionScheduler->Detect(*m_detector, frames, predictedRects, frame.m_regions);
+	}
+	else
+	{
+		m_detector->Detect(frames, frame.m_regions);
+	}
+}
+
+///
+/// \brief VideoExample::DetectionOnDevice
+/// The frames of cudacodec are detected in the CUDA memory without the download and the upload by the detector.
+/// The wake on motion, the keyframes scheduler and the abandoned objects need the host frames, they use Detection
+/// \param frame
+/// \return false if the frames aren't detected on the device
+///
+bool VideoExample::DetectionOnDevice(FrameInfo& frame)
+{
+#ifdef USE_CUDACODEC
+	if (!m_detector->CanDeviceProcessing() || m_trackerSettings.m_useAbandonedDetection ||
+		m_trackerSettings.m_wakeIdlePeriod > 1 || m_trackerSettings.m_detectKeyframeInterval > 1)
+		return false;
+
+	std::vector<DeviceFrame> deviceFrames(frame.m_frames.size());
+	for (size_t i = 0; i < frame.m_frames.size(); ++i)
+	{
+		if (!frame.m_frames[i].GetDeviceFrame(deviceFrames[i]))
+			return false;
+	}
+
+	frame.CleanRegions();
+	frame.m_interpolated.assign(frame.m_frames.size(), false);
+	frame.m_idleSkipped = false;
+	for (size_t i = 0; i < deviceFrames.size(); ++i)
+	{
+		if (!m_detector->DetectDevice(deviceFrames[i]))
+			return false;
+		m_detector->TakeDetects(frame.m_regions[i]);
+	}
+	return true;
+#else
+	(void)frame;
+	return false;
+#endif
+}
+
+///
+/// \brief VideoExample::StartEmbeddings
+/// Histograms and embeddings of the detected regions are calculated by the separate task:
+/// the capture thread continues with the detection of the next batch, AsyncProcess waits for the task before Tracking
+/// \param frame
+///
+void VideoExample::StartEmbeddings(FrameInfo& frame)
+{
+	frame.m_embeddings.clear();
+	if (!m_trackerReady.load())
+		return;
+
+	frame.m_embeddingsFuture = std::async(std::launch::async, [this, &frame]()
+	{
+		exec::ScopedStage execStage(m_execPolicy, "embed");
+		m_placement.Apply("embed");
+		CalcEmbeddings(frame);
+	});
+}
+
+///
+/// \brief VideoExample::CalcEmbeddings
+/// \param frame
+///
+void VideoExample::CalcEmbeddings(FrameInfo& frame)
+{
+	TRACE_SPAN("embeddings", "example");
+	if (!m_trackerReady.load())
+	{
+		frame.m_embeddings.clear();
+		return;
+	}
+
+	std::vector<std::vector<RegionEmbedding>> embeddings(frame.m_frames.size());
+	for (size_t i = 0; i < frame.m_frames.size(); ++i)
+	{
+		if (m_tracker->CanColorFrameToTrack())
+			m_tracker->CalcEmbeddings(embeddings[i], frame.m_regions[i], frame.m_frames[i].GetUMatBGR());
+		else
+			m_tracker->CalcEmbeddings(embeddings[i], frame.m_regions[i], frame.m_frames[i].GetUMatGray());
+	}
+	frame.m_embeddings.swap(embeddings);
+}
+
+///
+/// \brief VideoExample::ReadSettingsFile
+/// \return Content of the settings file, empty on the error
+///
+std::string VideoExample::ReadSettingsFile() const
+{
+    std::ifstream file(m_settingsFile);
+    if (!file.is_open())
+        return std::string();
+    std::stringstream content;
+    content << file.rdbuf();
+    return content.str();
+}
+
+///
+/// \brief VideoExample::ReloadSettings
+/// The changed settings file is applied to the tracker without the loss of the tracks
+///
+void VideoExample::ReloadSettings()
+{
+    if (!m_settingsReload || !m_trackerSettingsLoaded || ++m_settingsReloadCounter < m_settingsReload)
+        return;
+    m_settingsReloadCounter = 0;
+
+    std::string content = ReadSettingsFile();
+    if (content.empty() || content == m_settingsContent)
+        return;
+    m_settingsContent = std::move(content);
+
+    // Parameters from the code like the embeddings networks are kept, the file overrides the others
+    TrackerSettings settings = m_trackerSettings;
+    if (ParseTrackerSettings(m_settingsFile, settings))
+    {
+        m_tracker->ApplySettings(settings);
+        std::cout << "Settings " << m_settingsFile << " are applied to the tracker" << std::endl;
+    }
 }
 
 ///
@@ -401,19 +1001,87 @@ void VideoExample::Detection(FrameInfo& frame)
 ///
 void VideoExample::Tracking(FrameInfo& frame)
 {
+	TRACE_SPAN("tracking", "example");
+	BatchStamps stamps(frame, latency::Stamp::TrackStart, latency::Stamp::TrackEnd);
 	assert(frame.m_regions.size() == frame.m_frames.size());
 
+	ReloadSettings();
+
 	frame.CleanTracks();
+	frame.m_interpolatedTracks.clear();
+	if (frame.m_idleSkipped && m_tracker->GetTracksCount() == 0)
+		return;
+
+	const bool hasEmbeddings = frame.m_embeddings.size() == frame.m_frames.size();
 	for (size_t i = 0; i < frame.m_frames.size(); ++i)
 	{
-		if (m_tracker->CanColorFrameToTrack())
-			m_tracker->Update(frame.m_regions[i], frame.m_frames[i].GetUMatBGR(), m_fps);
+		if (i < frame.m_interpolated.size() && frame.m_interpolated[i] && m_trackInterpolator.Extrapolate(frame.m_frameInds[i], m_fps, frame.m_tracks[i]))
+		{
+			m_extrapolatedFrames.emplace_back(frame.m_frameInds[i]);
+			if (m_previewServer && m_previewServer->HasPreviewClients())
+				m_previewServer->PostFrame(frame.m_frames[i].GetMatBGR());
+			continue;
+		}
+
+		// After the dropped or skipped frames the time-based thresholds of the tracker count the real time
+		const int framesGap = (m_lastTrackedFrameInd >= 0) ? std::max(1, frame.m_frameInds[i] - m_lastTrackedFrameInd) : 1;
+		m_lastTrackedFrameInd = frame.m_frameInds[i];
+		const float fps = m_fps / framesGap;
+
+		cv::UMat trackFrame = m_tracker->CanColorFrameToTrack() ? frame.m_frames[i].GetUMatBGR() : frame.m_frames[i].GetUMatGray();
+		if (hasEmbeddings)
+			m_tracker->Update(frame.m_regions[i], frame.m_embeddings[i], trackFrame, fps);
 		else
-			m_tracker->Update(frame.m_regions[i], frame.m_frames[i].GetUMatGray(), m_fps);
+			m_tracker->Update(frame.m_regions[i], trackFrame, fps);
 		m_tracker->GetTracks(frame.m_tracks[i]);
+		if (m_trackerSettings.m_keyframeInterpolation > 0)
+		{
+			if (m_trackerSettings.m_keyframeInterpolation == 2)
+			{
+				for (int extrapolatedInd : m_extrapolatedFrames)
+				{
+					frame.m_interpolatedTracks.emplace_back(extrapolatedInd, std::vector<TrackingObject>());
+					m_trackInterpolator.Interpolate(extrapolatedInd, frame.m_frameInds[i], frame.m_tracks[i], frame.m_interpolatedTracks.back().second);
+				}
+			}
+			m_extrapolatedFrames.clear();
+			m_trackInterpolator.Update(frame.m_frameInds[i], frame.m_tracks[i]);
+		}
+		// One delta for the all consumers: every call of GetTracksDelta starts the new delta
+		const bool previewTracks = m_previewServer && m_previewServer->HasTracksClients();
+		if (m_tracksRing || previewTracks)
+		{
+			m_tracker->GetTracksDelta(m_tracksDelta, false);
+			if (m_tracksRing)
+				m_tracksRing->Publish(static_cast<uint64_t>(frame.m_frameInds[i]), frame.m_frameInds[i] / m_fps, m_tracksDelta);
+			if (previewTracks)
+				m_previewServer->PostTracks(frame.m_frameInds[i], m_tracksDelta);
+		}
+		if (m_previewServer && m_previewServer->HasPreviewClients())
+			m_previewServer->PostFrame(frame.m_frames[i].GetMatBGR());
 	}
 	if (m_trackerSettings.m_useAbandonedDetection)
 		m_tracker->GetTracks(m_tracks);
+	m_activeTracks = m_tracker->GetTracksCount();
+
+	if (m_trackerSettings.m_detectKeyframeInterval > 1)
+	{
+		std::vector<cv::Rect> predictedRects;
+		m_tracker->GetPredictedRects(predictedRects);
+		std::lock_guard<std::mutex> lock(m_predictedMutex);
+		m_predictedRects.swap(predictedRects);
+	}
+
+	// The detector with the motion gate detects the crops with the tracked objects on the every frame
+	if (!frame.m_tracks.empty())
+	{
+		std::vector<cv::Rect> trackedRects;
+		for (const auto& track : frame.m_tracks.back())
+		{
+			trackedRects.emplace_back(track.m_rrect.boundingRect());
+		}
+		m_detector->SetTrackedRects(trackedRects);
+	}
 }
 
 ///
@@ -501,11 +1169,127 @@ void VideoExample::DrawTrack(cv::Mat frame,
         }
     }
 
-	cv::Rect brect = track.m_rrect.boundingRect();
-	m_resultsLog.AddTrack(framesCounter, track.m_ID, brect, track.m_type, track.m_confidence);
+	// In the headless mode the tracks are logged by HeadlessData, the render thread only draws
+	if (!m_headless)
+		LogTrack(framesCounter, track);
+}
+
+///
+/// \brief VideoExample::LogTrack
+/// With keyframe_interpolation = 2 the extrapolated tracks are replaced by the interpolated ones of LogInterpolated
+/// \param framesCounter
+/// \param track
+///
+void VideoExample::LogTrack(int framesCounter, const TrackingObject& track)
+{
+	if (m_trackerSettings.m_keyframeInterpolation == 2 && track.m_estimate == TrackingObject::Estimate::Extrapolated)
+		return;
+	m_resultsLog.AddTrack(framesCounter, track.m_ID, track.m_rrect.boundingRect(), track.m_type, track.m_confidence);
 	m_resultsLog.AddRobustTrack(track.m_ID);
 }
 
+///
+/// \brief VideoExample::LogInterpolated
+/// The tracks of the previous frames between the keyframes are interpolated after the tracking of the next keyframe
+/// \param frameInfo
+///
+void VideoExample::LogInterpolated(const FrameInfo& frameInfo)
+{
+	for (const auto& interpolated : frameInfo.m_interpolatedTracks)
+	{
+		for (const auto& track : interpolated.second)
+		{
+			m_resultsLog.AddTrack(interpolated.first, track.m_ID, track.m_rrect.boundingRect(), track.m_type, track.m_confidence);
+			m_resultsLog.AddRobustTrack(track.m_ID);
+		}
+	}
+}
+
+///
+/// \brief VideoExample::HeadlessData
+/// \param tracks
+/// \param frameSize
+/// \param framesCounter
+/// \param currTime
+///
+void VideoExample::HeadlessData(const std::vector<TrackingObject>& tracks, cv::Size /*frameSize*/, int framesCounter, int currTime)
+{
+	if (m_showLogs)
+		std::cout << "Frame " << framesCounter << ": tracks = " << tracks.size() << ", time = " << currTime << std::endl;
+
+	for (const auto& track : tracks)
+	{
+		LogTrack(framesCounter, track);
+	}
+}
+
+///
+/// \brief VideoExample::OutputHeadless
+/// The results without the drawing, the every m_renderEvery frame is copied to the render thread.
+/// If the render thread falls behind then the snapshot is dropped
+/// \param frame
+/// \param tracks
+/// \param frameInd
+/// \param currTime
+///
+void VideoExample::OutputHeadless(Frame& frame, const std::vector<TrackingObject>& tracks, int frameInd, int currTime)
+{
+	HeadlessData(tracks, frame.GetMatBGR().size(), frameInd, currTime);
+
+	if (m_renderEvery <= 0 || frameInd % m_renderEvery != 0 || m_outFile.empty())
+		return;
+
+	if (!m_renderQueue)
+	{
+		// The motion map uses the current state of the detector, it's not valid for the snapshot
+		m_detector->SetMotionMapEnabled(false);
+		m_renderQueue = std::make_unique<BoundedQueue<RenderSnapshot>>(2);
+		m_renderThread = std::thread(&VideoExample::RenderThread, this);
+	}
+	RenderSnapshot snapshot;
+	frame.GetMatBGR().copyTo(snapshot.m_frame);
+	snapshot.m_tracks = tracks;
+	snapshot.m_frameInd = frameInd;
+	snapshot.m_currTime = currTime;
+	m_renderQueue->TryPush(std::move(snapshot));
+}
+
+///
+/// \brief VideoExample::RenderThread
+///
+void VideoExample::RenderThread()
+{
+	exec::ScopedStage execStage(m_execPolicy, "render");
+	m_placement.Apply("render");
+	cv::VideoWriter writer;
+	for (;;)
+	{
+		RenderSnapshot snapshot;
+		if (!m_renderQueue->Pop(snapshot, 100))
+		{
+			if (m_renderQueue->Closed())
+				break;
+			continue;
+		}
+		DrawData(snapshot.m_frame, snapshot.m_tracks, snapshot.m_frameInd, snapshot.m_currTime);
+		WriteFrame(writer, snapshot.m_frame);
+	}
+}
+
+///
+/// \brief VideoExample::StopRender
+/// Draws the queued snapshots and stops the render thread
+///
+void VideoExample::StopRender()
+{
+	if (!m_renderQueue)
+		return;
+	m_renderQueue->Close();
+	if (m_renderThread.joinable())
+		m_renderThread.join();
+	m_renderQueue.reset();
+}
+
 ///
 /// \brief VideoExample::OpenCapture
 /// \param capture
@@ -513,6 +1297,19 @@ void VideoExample::DrawTrack(cv::Mat frame,
 ///
 bool VideoExample::OpenCapture(cv::VideoCapture& capture)
 {
+    if (ImageSequenceCapture::IsImageSequence(m_inFile))
+    {
+        m_imageSequence = std::make_unique<ImageSequenceCapture>();
+        if (!m_imageSequence->Open(m_inFile, m_startFrame, m_decodeThreads, 0))
+        {
+            m_imageSequence.reset();
+            return false;
+        }
+        m_fps = (m_imageSequence->Fps() > 0) ? m_imageSequence->Fps() : 25.f;
+        std::cout << "Images " << m_inFile << " were started from " << m_startFrame << " frame with " << m_fps << " fps: " << m_imageSequence->FramesCount() << " frames, "
+                  << m_imageSequence->ThreadsCount() << " decoding threads" << std::endl;
+        return true;
+    }
 	if (m_inFile.size() == 1)
 	{
 #ifdef _WIN32
@@ -523,6 +1320,55 @@ bool VideoExample::OpenCapture(cv::VideoCapture& capture)
 		//if (capture.isOpened())
 		//	capture.set(cv::CAP_PROP_SETTINGS, 1);
 	}
+    else if (m_hwDecode == HWDecode::CudaCodec)
+    {
+#ifdef USE_CUDACODEC
+        // The properties are read by the usual capture, then it's closed and the frames are decoded by NVDEC
+        capture.open(m_inFile);
+        if (!capture.isOpened())
+            return false;
+        m_fps = std::max(25.f, (float)capture.get(cv::CAP_PROP_FPS));
+        capture.release();
+
+        m_cudaReader = cv::cudacodec::createVideoReader(m_inFile);
+        if (!m_cudaReader)
+            return false;
+        for (int i = 0; i < m_startFrame && m_cudaReader->nextFrame(m_cudaFrame); ++i)
+        {
+        }
+        std::cout << "Video " << m_inFile << " was started from " << m_startFrame << " frame with " << m_fps << " fps, cudacodec decoding" << std::endl;
+        return true;
+#else
+        std::cerr << "cudacodec decoding was not configured in CMake (USE_CUDACODEC), the software decoding is used" << std::endl;
+        capture.open(m_inFile);
+#endif
+    }
+    else if (m_hwDecode != HWDecode::None)
+    {
+#if (CV_VERSION_MAJOR > 4) || ((CV_VERSION_MAJOR == 4) && ((CV_VERSION_MINOR > 5) || ((CV_VERSION_MINOR == 5) && (CV_VERSION_REVISION >= 2))))
+        cv::VideoAccelerationType accel = cv::VIDEO_ACCELERATION_ANY;
+        if (m_hwDecode == HWDecode::VAAPI)
+            accel = cv::VIDEO_ACCELERATION_VAAPI;
+        else if (m_hwDecode == HWDecode::D3D11)
+            accel = cv::VIDEO_ACCELERATION_D3D11;
+        // With OpenCL the decoded frame goes to the UMat without the copy to the host memory
+        m_hwDecodeToDevice = cv::ocl::useOpenCL();
+        capture.open(m_inFile, cv::CAP_ANY, { cv::CAP_PROP_HW_ACCELERATION, static_cast<int>(accel),
+                                              cv::CAP_PROP_HW_ACCELERATION_USE_OPENCL, m_hwDecodeToDevice ? 1 : 0 });
+        if (capture.isOpened())
+        {
+            std::cout << "Hardware decoding: " << static_cast<int>(capture.get(cv::CAP_PROP_HW_ACCELERATION)) << (m_hwDecodeToDevice ? " to the OpenCL memory" : "") << std::endl;
+        }
+        else
+        {
+            m_hwDecodeToDevice = false;
+            capture.open(m_inFile);
+        }
+#else
+        std::cerr << "Hardware decoding requires OpenCV 4.5.2 or newer, the software decoding is used" << std::endl;
+        capture.open(m_inFile);
+#endif
+    }
     else
         capture.open(m_inFile);
 
@@ -534,11 +1380,102 @@ bool VideoExample::OpenCapture(cv::VideoCapture& capture)
 
 		std::cout << "Video " << m_inFile << " was started from " << m_startFrame << " frame with " << m_fps << " fps" << std::endl;
 
+        // Live stream: the grab thread keeps only the last frames
+        if (m_liveKeepFrames > 0)
+            m_liveCapture = std::make_unique<LiveCapture>(capture, m_liveKeepFrames);
+
         return true;
     }
     return false;
 }
 
+///
+/// \brief VideoExample::ReadFrame
+/// \param capture
+/// \param frame
+/// \param framesCounter - index of the frame, it's increased by the count of the frames dropped by the live capture
+/// \return false if the video is finished
+///
+bool VideoExample::ReadFrame(cv::VideoCapture& capture, Frame& frame, int& framesCounter)
+{
+    TRACE_SPAN("read_frame", "example");
+    if (m_liveCapture)
+    {
+        // The stamps of the grab thread: the waiting of the frame for the reader is the part of the latency
+        size_t dropped = 0;
+        if (!m_liveCapture->Read(frame.GetMatBGRWrite(), dropped, &frame.Timestamps()))
+            return false;
+        framesCounter += static_cast<int>(dropped);
+        return !frame.empty();
+    }
+    if (m_imageSequence)
+        return m_imageSequence->Read(frame.GetMatBGRWrite(), &frame.Timestamps());
+
+    frame.Timestamps().Reset();
+    frame.Timestamps().Mark(latency::Stamp::Capture);
+
+#ifdef USE_CUDACODEC
+    if (m_cudaReader)
+    {
+        // NVDEC returns BGRA, it stays in the CUDA memory until the first request of the host copy
+        if (!m_cudaReader->nextFrame(frame.GetGpuBGRAWrite()))
+            return false;
+        frame.Timestamps().Mark(latency::Stamp::Decoded);
+        return !frame.empty();
+    }
+#endif
+    if (m_hwDecodeToDevice)
+        capture >> frame.GetUMatBGRWrite();
+    else
+        capture >> frame.GetMatBGRWrite();
+    frame.Timestamps().Mark(latency::Stamp::Decoded);
+    return !frame.empty();
+}
+
+///
+/// \brief VideoExample::PublishFrame
+/// The tracks of the frame are drawn or logged: the end of its latency
+/// \param frame
+///
+void VideoExample::PublishFrame(Frame& frame)
+{
+    frame.Timestamps().Mark(latency::Stamp::Output);
+    m_stageLatencies->Add(frame.Timestamps());
+}
+
+///
+/// \brief VideoExample::StopCapture
+/// Stops the grab thread of the live stream and the decoding threads of the images
+///
+void VideoExample::StopCapture()
+{
+    if (m_imageSequence)
+    {
+        m_imageSequence->Stop();
+        m_imageSequence.reset();
+    }
+    if (m_liveCapture)
+    {
+        m_liveCapture->Stop();
+        std::cout << "Live capture: " << m_liveCapture->GrabbedCount() << " frames grabbed, " << m_liveCapture->DroppedCount() << " dropped" << std::endl;
+        m_liveCapture.reset();
+    }
+}
+
+///
+/// \brief VideoExample::DumpTrace
+/// Timeline of the last events on demand
+///
+void VideoExample::DumpTrace()
+{
+    if (!m_traceDumper)
+        return;
+    if (m_traceDumper->Dump())
+        std::cout << "Trace is dumped" << std::endl;
+    else
+        std::cerr << "Trace wasn't dumped" << std::endl;
+}
+
 ///
 /// \brief VideoExample::WriteFrame
 /// \param writer
@@ -547,10 +1484,19 @@ bool VideoExample::OpenCapture(cv::VideoCapture& capture)
 ///
 bool VideoExample::WriteFrame(cv::VideoWriter& writer, const cv::Mat& frame)
 {
+    TRACE_SPAN("write_frame", "example");
     if (!m_outFile.empty())
     {
+        // The encoding thread: the tracking loop doesn't wait for the encoder and the disk
+        if (m_writeQueueSize > 0)
+        {
+            if (!m_asyncWriter)
+                m_asyncWriter = std::make_unique<AsyncVideoWriter>(m_outFile, m_fourcc, m_fps, frame.size(), m_writeQueueSize, m_writeDropPolicy, m_hwEncode);
+            return m_asyncWriter->Write(frame);
+        }
+
         if (!writer.isOpened())
-            writer.open(m_outFile, m_fourcc, m_fps, frame.size(), true);
+            AsyncVideoWriter::OpenWriter(writer, m_outFile, m_fourcc, m_fps, frame.size(), m_hwEncode);
 
         if (writer.isOpened())
         {
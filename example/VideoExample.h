@@ -7,13 +7,40 @@
 #include <chrono>
 #include <condition_variable>
 #include <atomic>
+#include <future>
+
+#include <opencv2/core/ocl.hpp>
+#ifdef USE_CUDACODEC
+#include <opencv2/cudacodec.hpp>
+#include <opencv2/opencv_modules.hpp>
+#ifdef HAVE_OPENCV_CUDAIMGPROC
+#include <opencv2/cudaimgproc.hpp>
+#endif
+#endif
 
 #include "BaseDetector.h"
+#include "DetectionScheduler.h"
+#include "MotionWake.h"
 #include "Ctracker.h"
+#include "ShmTracksRing.h"
+#include "PreviewServer.h"
+#include "TrackInterpolator.h"
 #include "FileLogger.h"
+#include "Pipeline.h"
+#include "LiveCapture.h"
+#include "ImageSequenceCapture.h"
+#include "AsyncVideoWriter.h"
+#include "trace_events.h"
+#include "execution_policy.h"
+#include "thread_affinity.h"
+#include "frame_latency.h"
 
 ///
 /// \brief The Frame struct
+/// The UMat and the gray versions of the captured frame are calculated once on the first request from any thread
+/// and are shared read-only by the all stages: the detection and the tracking threads don't repeat the upload and
+/// the color conversion. The device result is finished before it's shared, so the OpenCL queue of the other thread sees it.
+/// The frame of cudacodec stays in the CUDA memory: the detector reads it there and the host copy is downloaded on the first request
 ///
 class Frame
 {
@@ -22,36 +49,156 @@ public:
     Frame(cv::Mat imgBGR)
     {
         m_mBGR = imgBGR;
+        m_mBGRGenerated = true;
+    }
+    Frame(const Frame& frame)
+    {
+        *this = frame;
+    }
+    Frame& operator=(const Frame& frame)
+    {
+        if (this != &frame)
+        {
+            std::lock(m_mutex, frame.m_mutex);
+            std::lock_guard<std::mutex> lock(m_mutex, std::adopt_lock);
+            std::lock_guard<std::mutex> lockOther(frame.m_mutex, std::adopt_lock);
+            m_mBGR = frame.m_mBGR;
+            m_mGray = frame.m_mGray;
+            m_umBGR = frame.m_umBGR;
+            m_umGray = frame.m_umGray;
+            m_mBGRGenerated = frame.m_mBGRGenerated;
+            m_umBGRGenerated = frame.m_umBGRGenerated;
+            m_mGrayGenerated = frame.m_mGrayGenerated;
+            m_umGrayGenerated = frame.m_umGrayGenerated;
+            m_timestamps = frame.m_timestamps;
+#ifdef USE_CUDACODEC
+            m_gpuBGRA = frame.m_gpuBGRA;
+            m_gpuGenerated = frame.m_gpuGenerated;
+#endif
+        }
+        return *this;
     }
 
     ///
     bool empty() const
     {
-        return m_mBGR.empty();
+#ifdef USE_CUDACODEC
+        if (m_gpuGenerated && !m_mBGRGenerated)
+            return m_gpuBGRA.empty();
+#endif
+        return m_mBGRGenerated ? m_mBGR.empty() : m_umBGR.empty();
     }
 
+    ///
+    /// \brief Timestamps
+    /// Stamps of the stages: the frame is passed by the stages one by one, so they aren't locked
+    ///
+    latency::FrameTimestamps& Timestamps()
+    {
+        return m_timestamps;
+    }
+
+    ///
+    /// \brief GetMatBGR
+    /// The frame decoded to the device memory is downloaded on the first request
     ///
     const cv::Mat& GetMatBGR()
     {
-        return m_mBGR;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return MatBGR();
     }
     ///
+    /// \brief GetMatBGRWrite
+    /// The capture decodes into the same buffer: the UMat view of the previous frame is released.
+    /// If somebody else (the tracker) still keeps the previous frame or its gray copy then the new buffer is allocated
+    ///
     cv::Mat& GetMatBGRWrite()
     {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_umBGR.release();
+        if (m_mBGR.u && m_mBGR.u->refcount > 1)
+            m_mBGR.release();
+        if (m_umGray.u && m_umGray.u->urefcount > 1)
+            m_umGray.release();
+        if (m_mGray.u && m_mGray.u->refcount > 1)
+            m_mGray.release();
+        m_mBGRGenerated = true;
         m_umBGRGenerated = false;
         m_mGrayGenerated = false;
         m_umGrayGenerated = false;
+#ifdef USE_CUDACODEC
+        m_gpuGenerated = false;
+#endif
         return m_mBGR;
     }
+    ///
+    /// \brief GetUMatBGRWrite
+    /// The hardware decoder writes the frame to the device memory, the host copy is created only on request
+    ///
+    cv::UMat& GetUMatBGRWrite()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_mBGRGenerated || (m_umBGR.u && m_umBGR.u->refcount > 1))
+            m_umBGR.release();
+        if (m_mBGR.u && m_mBGR.u->refcount > 1)
+            m_mBGR.release();
+        m_mBGRGenerated = false;
+        m_umBGRGenerated = true;
+        m_mGrayGenerated = false;
+        m_umGrayGenerated = false;
+#ifdef USE_CUDACODEC
+        m_gpuGenerated = false;
+#endif
+        return m_umBGR;
+    }
+#ifdef USE_CUDACODEC
+    ///
+    /// \brief GetGpuBGRAWrite
+    /// cudacodec decodes the BGRA frame to the CUDA memory, the host copies are created only on request
+    ///
+    cv::cuda::GpuMat& GetGpuBGRAWrite()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_gpuBGRA.refcount && *m_gpuBGRA.refcount > 1)
+            m_gpuBGRA.release();
+        m_umBGR.release();
+        if (m_mBGR.u && m_mBGR.u->refcount > 1)
+            m_mBGR.release();
+        m_gpuGenerated = true;
+        m_mBGRGenerated = false;
+        m_umBGRGenerated = false;
+        m_mGrayGenerated = false;
+        m_umGrayGenerated = false;
+        return m_gpuBGRA;
+    }
+    ///
+    /// \brief GetDeviceFrame
+    /// \return false if the frame isn't in the CUDA memory
+    ///
+    bool GetDeviceFrame(DeviceFrame& deviceFrame) const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_gpuGenerated || m_gpuBGRA.empty())
+            return false;
+        deviceFrame.m_data = m_gpuBGRA.data;
+        deviceFrame.m_width = m_gpuBGRA.cols;
+        deviceFrame.m_height = m_gpuBGRA.rows;
+        deviceFrame.m_channels = m_gpuBGRA.channels();
+        deviceFrame.m_pitch = m_gpuBGRA.step;
+        deviceFrame.m_stream = nullptr;
+        return true;
+    }
+#endif
     ///
     const cv::Mat& GetMatGray()
     {
-        if (m_mGray.empty() || !m_mGrayGenerated)
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_mGrayGenerated)
         {
-            if (m_umGray.empty() || !m_umGrayGenerated)
-                cv::cvtColor(m_mBGR, m_mGray, cv::COLOR_BGR2GRAY);
-            else
-                m_mGray = m_umGray.getMat(cv::ACCESS_READ);
+            if (m_umGrayGenerated)
+                m_mGray = exec::MapToHost(m_umGray, "Frame::GetMatGray");
+            else if (!GrayFromDevice())
+                cv::cvtColor(MatBGR(), m_mGray, cv::COLOR_BGR2GRAY);
             m_mGrayGenerated = true;
         }
         return m_mGray;
@@ -59,36 +206,27 @@ public:
     ///
     const cv::UMat& GetUMatBGR()
     {
-        std::thread::id lastThreadID = std::this_thread::get_id();
-
-        if (m_umBGR.empty() || !m_umBGRGenerated || lastThreadID != m_umBGRThreadID)
-        {
-            m_umBGR = m_mBGR.getUMat(cv::ACCESS_READ);
-            m_umBGRGenerated = true;
-            m_umBGRThreadID = lastThreadID;
-        }
-        return m_umBGR;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return UMatBGR();
     }
     ///
     const cv::UMat& GetUMatGray()
     {
-        std::thread::id lastThreadID = std::this_thread::get_id();
-
-        if (m_umGray.empty() || !m_umGrayGenerated || lastThreadID != m_umGrayThreadID)
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_umGrayGenerated)
         {
-            if (m_mGray.empty() || !m_mGrayGenerated)
+            if (m_mGrayGenerated || GrayFromDevice())
             {
-                if (m_umBGR.empty() || !m_umBGRGenerated || lastThreadID != m_umGrayThreadID)
-                    cv::cvtColor(m_mBGR, m_umGray, cv::COLOR_BGR2GRAY);
-                else
-                    cv::cvtColor(m_umBGR, m_umGray, cv::COLOR_BGR2GRAY);
+                m_mGrayGenerated = true;
+                m_umGray = exec::MapToDevice(m_mGray, "Frame::GetUMatGray");
             }
             else
             {
-                m_umGray = m_mGray.getUMat(cv::ACCESS_READ);
+                cv::cvtColor(UMatBGR(), m_umGray, cv::COLOR_BGR2GRAY);
+                if (cv::ocl::useOpenCL())
+                    cv::ocl::finish();
             }
             m_umGrayGenerated = true;
-            m_umGrayThreadID = lastThreadID;
         }
         return m_umGray;
     }
@@ -98,11 +236,70 @@ private:
     cv::Mat m_mGray;
     cv::UMat m_umBGR;
     cv::UMat m_umGray;
+    bool m_mBGRGenerated = true;
     bool m_umBGRGenerated = false;
     bool m_mGrayGenerated = false;
     bool m_umGrayGenerated = false;
-    std::thread::id m_umBGRThreadID;
-    std::thread::id m_umGrayThreadID;
+    mutable std::mutex m_mutex;
+    latency::FrameTimestamps m_timestamps;
+#ifdef USE_CUDACODEC
+    cv::cuda::GpuMat m_gpuBGRA;
+    cv::Mat m_mBGRA;
+    bool m_gpuGenerated = false;
+#ifdef HAVE_OPENCV_CUDAIMGPROC
+    cv::cuda::GpuMat m_gpuGray;
+#endif
+#endif
+
+    ///
+    const cv::Mat& MatBGR()
+    {
+        if (!m_mBGRGenerated)
+        {
+#ifdef USE_CUDACODEC
+            if (m_gpuGenerated && !m_umBGRGenerated)
+            {
+                // NVDEC returns BGRA
+                m_gpuBGRA.download(m_mBGRA);
+                cv::cvtColor(m_mBGRA, m_mBGR, cv::COLOR_BGRA2BGR);
+                m_mBGRGenerated = true;
+                return m_mBGR;
+            }
+#endif
+            if (exec::OnDevice(m_umBGR))
+                exec::CountTransfer(exec::Direction::ToHost, m_umBGR.total() * m_umBGR.elemSize(), "Frame::GetMatBGR");
+            m_umBGR.copyTo(m_mBGR);
+            m_mBGRGenerated = true;
+        }
+        return m_mBGR;
+    }
+    ///
+    /// \brief GrayFromDevice
+    /// The gray frame is converted in the CUDA memory and only one channel is downloaded
+    /// \return false if the frame isn't in the CUDA memory or without the cudaimgproc module
+    ///
+    bool GrayFromDevice()
+    {
+#if defined(USE_CUDACODEC) && defined(HAVE_OPENCV_CUDAIMGPROC)
+        if (m_gpuGenerated && !m_mBGRGenerated && !m_umBGRGenerated)
+        {
+            cv::cuda::cvtColor(m_gpuBGRA, m_gpuGray, cv::COLOR_BGRA2GRAY);
+            m_gpuGray.download(m_mGray);
+            return true;
+        }
+#endif
+        return false;
+    }
+    ///
+    const cv::UMat& UMatBGR()
+    {
+        if (!m_umBGRGenerated)
+        {
+            m_umBGR = exec::MapToDevice(MatBGR(), "Frame::GetUMatBGR");
+            m_umBGRGenerated = true;
+        }
+        return m_umBGR;
+    }
 };
 
 ///
@@ -146,6 +343,19 @@ struct FrameInfo
         }
     }
 
+    ///
+    /// \brief MarkStamp
+    /// The frames of the batch get the same stamp
+    ///
+    void MarkStamp(latency::Stamp stamp)
+    {
+        const int64_t ns = latency::Now();
+        for (auto& frame : m_frames)
+        {
+            frame.Timestamps().Set(stamp, ns);
+        }
+    }
+
     ///
     void CleanTracks()
     {
@@ -162,9 +372,15 @@ struct FrameInfo
     std::vector<std::vector<TrackingObject>> m_tracks;
     std::vector<int> m_frameInds;
 
+    std::vector<std::vector<RegionEmbedding>> m_embeddings; // Empty if the tracker calculates them in Update
+    std::future<void> m_embeddingsFuture;                   // Re-ID of the frames runs concurrently with the next detection
+
     size_t m_batchSize = 1;
 
     int64 m_dt = 0;
+    bool m_idleSkipped = false; // The frames were skipped by the wake on motion gate: no detection and tracking
+    std::vector<bool> m_interpolated; // The frames between the keyframes aren't detected and tracked, their tracks are extrapolated
+    std::vector<std::pair<int, std::vector<TrackingObject>>> m_interpolatedTracks; // Of the previous frames between the keyframes, for the results log
 
     std::condition_variable m_cond;
     std::mutex m_mutex;
@@ -187,6 +403,7 @@ public:
 
     void AsyncProcess();
     void SyncProcess();
+    void PipelineProcess(size_t queueDepth);
 
 protected:
     std::unique_ptr<BaseDetector> m_detector;
@@ -205,17 +422,34 @@ protected:
     static void CaptureAndDetect(VideoExample* thisPtr, std::atomic<bool>& stopCapture);
 
     virtual bool InitDetector(cv::UMat frame) = 0;
+    virtual void PrefetchDetector() {}
     virtual bool InitTracker(cv::UMat frame) = 0;
 
     void Detection(FrameInfo& frame);
+    bool DetectionOnDevice(FrameInfo& frame);
+    void StartEmbeddings(FrameInfo& frame);
+    void CalcEmbeddings(FrameInfo& frame);
     void Tracking(FrameInfo& frame);
+    std::string ReadSettingsFile() const;
+    void ReloadSettings();
 
     virtual void DrawData(cv::Mat frame, const std::vector<TrackingObject>& tracks, int framesCounter, int currTime) = 0;
 
     virtual void DrawTrack(cv::Mat frame, const TrackingObject& track, bool drawTrajectory, int framesCounter);
+    void LogTrack(int framesCounter, const TrackingObject& track);
+
+    ///
+    /// \brief HeadlessData
+    /// Results of the frame without the drawing: the tracks log and the counters
+    ///
+    virtual void HeadlessData(const std::vector<TrackingObject>& tracks, cv::Size frameSize, int framesCounter, int currTime);
+
+    bool m_headless = false; // No drawing and display on the processing threads
 
     TrackerSettings m_trackerSettings;
     bool m_trackerSettingsLoaded = false;
+    exec::Policy m_execPolicy; // Applied by the all stage threads
+    affinity::Placement m_placement; // CPUs and OpenMP threads of the stage threads
 
     std::vector<cv::Scalar> m_colors;
 
@@ -223,16 +457,92 @@ private:
 	std::vector<TrackingObject> m_tracks;
 
     bool m_isTrackerInitialized = false;
+    std::atomic<bool> m_trackerReady { false }; // The tracker can calculate the embeddings from the capture thread
     bool m_isDetectorInitialized = false;
+    std::unique_ptr<DetectionScheduler> m_detectionScheduler;
+    std::unique_ptr<MotionWake> m_motionWake;
+    std::atomic<size_t> m_activeTracks { 0 }; // Tracks count after the last tracking for the wake on motion gate
+    std::mutex m_predictedMutex;
+    std::vector<cv::Rect> m_predictedRects; // Areas of the tracks for the detection between the keyframes
     std::string m_inFile;
     std::string m_outFile;
+    std::string m_settingsFile;
+    int m_settingsReload = 0;         // Check of the settings file every N tracked frames, 0 - disabled
+    int m_settingsReloadCounter = 0;
+    std::string m_settingsContent;    // Content of the settings file after the last check
     int m_fourcc = cv::VideoWriter::fourcc('M', 'J', 'P', 'G');
+    size_t m_writeQueueSize = 0; // 0 - the result video is written synchronously
+    AsyncVideoWriter::DropPolicy m_writeDropPolicy = AsyncVideoWriter::DropPolicy::Wait;
+    bool m_hwEncode = false;
+    std::unique_ptr<AsyncVideoWriter> m_asyncWriter;
+
+    ///
+    /// \brief The RenderSnapshot struct
+    /// Copy of the frame and its tracks for the render thread of the headless mode
+    ///
+    struct RenderSnapshot
+    {
+        cv::Mat m_frame;
+        std::vector<TrackingObject> m_tracks;
+        int m_frameInd = 0;
+        int m_currTime = 0;
+    };
+    int m_renderEvery = 0; // Headless mode: the every m_renderEvery frame is drawn to the result video, 0 - never
+    std::unique_ptr<BoundedQueue<RenderSnapshot>> m_renderQueue;
+    std::thread m_renderThread;
+
+    void OutputHeadless(Frame& frame, const std::vector<TrackingObject>& tracks, int frameInd, int currTime);
+    void RenderThread();
+    void StopRender();
     int m_startFrame = 0;
     int m_endFrame = 0;
     int m_finishDelay = 0;
 
     FrameInfo m_frameInfo[2];
 
+    ///
+    /// \brief The HWDecode enum
+    /// Hardware video decoding of the file: by cv::VideoCapture with FFmpeg/GStreamer or by cv::cudacodec
+    ///
+    enum class HWDecode
+    {
+        None = 0,
+        Any,
+        VAAPI,
+        D3D11,
+        CudaCodec
+    };
+    HWDecode m_hwDecode = HWDecode::None;
+    bool m_hwDecodeToDevice = false; // The decoded frames stay in the OpenCL memory
+#ifdef USE_CUDACODEC
+    cv::Ptr<cv::cudacodec::VideoReader> m_cudaReader;
+    cv::cuda::GpuMat m_cudaFrame;
+#endif
+
+    size_t m_liveKeepFrames = 0; // Live stream: count of the last grabbed frames waiting for the processing, 0 - disabled
+    std::unique_ptr<LiveCapture> m_liveCapture;
+    size_t m_decodeThreads = 0; // Directory or pattern of the images: threads of the decoding ahead, 0 - hardware concurrency
+    std::unique_ptr<ImageSequenceCapture> m_imageSequence;
+    int m_lastTrackedFrameInd = -1;
+
+    std::unique_ptr<trace::SloDumper> m_traceDumper; // Timeline of the stages: on the 't' key, on the latency SLO violation and at the end
+    void DumpTrace();
+
+    double m_latencySla = 0; // End-to-end latency SLA in milliseconds, 0 - the violations aren't counted
+    std::unique_ptr<latency::StageLatencies> m_stageLatencies; // Of the running process: sync, async or pipeline
+    void PublishFrame(Frame& frame);
+
+    std::unique_ptr<ShmTracksRing> m_tracksRing; // Tracks of every frame for the analytics processes, the tracking doesn't wait for the readers
+    TracksDelta m_tracksDelta;
+    TrackInterpolator m_trackInterpolator; // Tracks of the frames between the keyframes with keyframe_interpolation
+    std::vector<int> m_extrapolatedFrames;
+    size_t m_keyframesCounter = 0;
+    void LogInterpolated(const FrameInfo& frameInfo);
+
+    std::unique_ptr<PreviewServer> m_previewServer; // Remote monitoring: the preview and the tracks over HTTP without the drawing
+
     bool OpenCapture(cv::VideoCapture& capture);
+    bool ReadFrame(cv::VideoCapture& capture, Frame& frame, int& framesCounter);
+    void StopCapture();
     bool WriteFrame(cv::VideoWriter& writer, const cv::Mat& frame);
 };
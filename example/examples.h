@@ -58,6 +58,10 @@ protected:
 
         config_t config;
 		config.emplace("useRotatedRect", "0");
+		config.emplace("motionScale", "1");  // 0.5 - the background subtraction on the 1/4 area
+		config.emplace("motionRefine", "0"); // Refine the scaled rects on the full resolution
+		config.emplace("bgModelFile", "");   // Background model snapshot for the warm restart, empty - disabled
+		config.emplace("motionMap", "1");    // Overlay of the motion map in CalcMotionMap, 0 - disabled
 
 		tracking::Detectors detectorType = tracking::Detectors::Motion_VIBE;
 
@@ -240,6 +244,7 @@ protected:
 
         config_t config;
         config.emplace("cascadeFileName", pathToModel + "haarcascade_frontalface_alt2.xml");
+        config.emplace("faceBackend", "CPU_ROI"); // CUDA, CPU or CPU_ROI
         m_detector = CreateDetector(tracking::Detectors::Face_HAAR, config, frame);
         if (m_detector.get())
         {
@@ -328,6 +333,7 @@ protected:
 
         config_t config;
         config.emplace("detectorType", (detectorType == tracking::Pedestrian_HOG) ? "HOG" : "C4");
+        config.emplace("hogBackend", "CUDA"); // CUDA, CPU or CPU_SCALES
         config.emplace("cascadeFileName1", pathToModel + "combined.txt.model");
         config.emplace("cascadeFileName2", pathToModel + "combined.txt.model_");
         m_detector = CreateDetector(detectorType, config, frame);
@@ -409,6 +415,7 @@ protected:
 	bool InitDetector(cv::UMat frame)
 	{
 		config_t config;
+		config.emplace("motionMap", "0");    // CalcMotionMap isn't drawn: the detections are swapped to the frame without the copy
 
 #ifdef _WIN32
 		std::string pathToModel = "../../data/";
@@ -583,6 +590,7 @@ protected:
 	bool InitDetector(cv::UMat frame)
 	{
 		config_t config;
+		config.emplace("motionMap", "0");    // CalcMotionMap isn't drawn: the detections are swapped to the frame without the copy
 
         if (!m_trackerSettingsLoaded)
         {
@@ -652,6 +660,10 @@ protected:
             config.emplace("gpuId", std::to_string(m_trackerSettings.m_gpuId));
             config.emplace("net_type", m_trackerSettings.m_netType);
             config.emplace("inference_precison", m_trackerSettings.m_inferencePrecison);
+            if (!m_trackerSettings.m_roiPolygon.empty())
+                config.emplace("roiPolygon", m_trackerSettings.m_roiPolygon);
+            if (!m_trackerSettings.m_excludePolygon.empty())
+                config.emplace("excludePolygon", m_trackerSettings.m_excludePolygon);
         }
 
         config.emplace("white_list", std::to_string((objtype_t)ObjectTypes::obj_person));
@@ -828,8 +840,33 @@ protected:
 	/// \return
 	///
 	bool InitDetector(cv::UMat frame)
+	{
+		m_detector = CreateDetector(tracking::Detectors::Yolo_TensorRT, GetDetectorConfig(), frame);
+		if (m_detector.get())
+		{
+			m_detector->SetMinObjectSize(cv::Size(frame.cols / 40, frame.rows / 40));
+			return true;
+		}
+		return false;
+	}
+
+	///
+	/// \brief PrefetchDetector
+	/// Cached engine is loaded while the capture is opened
+	///
+	void PrefetchDetector()
+	{
+		::PrefetchDetector(tracking::Detectors::Yolo_TensorRT, GetDetectorConfig());
+	}
+
+	///
+	/// \brief GetDetectorConfig
+	/// \return
+	///
+	config_t GetDetectorConfig() const
 	{
 		config_t config;
+		config.emplace("motionMap", "0");    // CalcMotionMap isn't drawn: the detections are swapped to the frame without the copy
         if (!m_trackerSettingsLoaded)
         {
 #ifdef _WIN32
@@ -915,6 +952,10 @@ protected:
             config.emplace("gpuId", std::to_string(m_trackerSettings.m_gpuId));
             config.emplace("net_type", m_trackerSettings.m_netType);
             config.emplace("inference_precison", m_trackerSettings.m_inferencePrecison);
+            if (!m_trackerSettings.m_roiPolygon.empty())
+                config.emplace("roiPolygon", m_trackerSettings.m_roiPolygon);
+            if (!m_trackerSettings.m_excludePolygon.empty())
+                config.emplace("excludePolygon", m_trackerSettings.m_excludePolygon);
         }
 
 		config.emplace("white_list", std::to_string((objtype_t)ObjectTypes::obj_person));
@@ -923,14 +964,7 @@ protected:
 		config.emplace("white_list", std::to_string((objtype_t)ObjectTypes::obj_motorbike));
 		config.emplace("white_list", std::to_string((objtype_t)ObjectTypes::obj_bus));
 		config.emplace("white_list", std::to_string((objtype_t)ObjectTypes::obj_truck));
-
-		m_detector = CreateDetector(tracking::Detectors::Yolo_TensorRT, config, frame);
-		if (m_detector.get())
-		{
-			m_detector->SetMinObjectSize(cv::Size(frame.cols / 40, frame.rows / 40));
-			return true;
-		}
-		return false;
+		return config;
 	}
 
 	///
@@ -1,5 +1,7 @@
 #include "MouseExample.h"
 #include "examples.h"
+#include "TrackletsStitcher.h"
+#include "task_scheduler.h"
 
 #ifdef BUILD_CARS_COUNTING
 #include "CarsCounting.h"
@@ -14,9 +16,10 @@ static void Help()
 {
     printf("\nExamples of the Multitarget tracking algorithm\n"
            "Usage: \n"
-           "          ./MultitargetTracker <path to movie file> [--example]=<number of example 0..7> [--start_frame]=<start a video from this position> [--end_frame]=<play a video to this position> [--end_delay]=<delay in milliseconds after video ending> [--out]=<name of result video file> [--show_logs]=<show logs> [--async]=<async pipeline> [--res]=<csv log file> [--settings]=<ini file> [--batch_size=<number of frames>] \n\n"
+           "          ./MultitargetTracker <path to movie file> [--example]=<number of example 0..7> [--start_frame]=<start a video from this position> [--end_frame]=<play a video to this position> [--end_delay]=<delay in milliseconds after video ending> [--out]=<name of result video file> [--show_logs]=<show logs> [--async]=<async pipeline> [--hw_decode]=<hardware video decoding> [--live]=<frames kept for live stream> [--decode_threads]=<threads of the images decoding> [--headless]=<no drawing> [--render_every]=<drawn frames in headless mode> [--write_queue]=<async writing queue> [--write_drop]=<drop policy> [--hw_encode]=<hardware encoding> [--pipeline_depth]=<queues depth of the staged pipeline> [--trace]=<timeline json> [--trace_slo]=<latency in milliseconds> [--latency_sla]=<end-to-end latency in milliseconds> [--affinity]=<placement of the threads> [--threads]=<threads of the task scheduler> [--shm_tracks]=<shared memory ring of the tracks> [--preview_port]=<http port of the preview> [--preview_width]=<width of the preview> [--preview_fps]=<frame rate of the preview> [--res]=<csv log file> [--settings]=<ini file> [--settings_reload]=<check period in frames> [--batch_size=<number of frames>] [--stitch]=<csv log file for the offline tracklets stitching> \n\n"
            "Press:\n"
-           "\'m\' key for change mode: play|pause. When video is paused you can press any key for get next frame. \n\n"
+           "\'m\' key for change mode: play|pause. When video is paused you can press any key for get next frame. \n"
+           "\'t\' key dumps the timeline of the --trace. \n\n"
            "Press Esc to exit from video \n\n"
            );
 }
@@ -31,9 +34,29 @@ const char* keys =
     "{ o  out           |                    | Name of result video file | }"
     "{ sl show_logs     |1                   | Show Trackers logs | }"
     "{ g gpu            |0                   | Use OpenCL acceleration | }"
+    "{ hl headless      |0                   | Headless mode: no drawing and display, only the tracks log | }"
+    "{ re render_every  |0                   | Headless mode: the every N frame is drawn to the result video by the separate thread, 0 - never | }"
+    "{ wq write_queue   |0                   | Queue of the thread which writes the result video, 0 - synchronous writing | }"
+    "{ wd write_drop    |0                   | Full write queue: 0 - wait, 1 - drop the new frame, 2 - drop the oldest frame | }"
+    "{ hwe hw_encode    |0                   | Hardware encoding of the result video (OpenCV 4.5.2+) | }"
+    "{ lv live          |0                   | Live stream: the grab thread keeps only N last frames, the older are dropped. 0 - disabled | }"
+    "{ dt decode_threads |0                  | Directory (img1) or pattern (img1/*.jpg, img1/%06d.jpg) of the images instead of the movie: threads of the decoding ahead, 0 - hardware concurrency | }"
+    "{ hw hw_decode     |0                   | Hardware video decoding: 0 - disabled, 1 - any, 2 - VAAPI, 3 - D3D11, 4 - cudacodec | }"
     "{ a async          |1                   | Use 2 theads for processing pipeline | }"
-    "{ r res            |                    | Path to the csv file with tracking result | }"
+    "{ pd pipeline_depth |0                  | Depth of the queues of the staged pipeline: capture, preprocess, detect, embed, track, render. 0 - disabled | }"
+    "{ tr trace         |                    | Chrome trace_event json with the timeline of the stages (CMake option USE_TRACE_EVENTS): dumped on the 't' key, on the trace_slo violation and at the end | }"
+    "{ ts trace_slo     |0                   | Latency of the frame processing in milliseconds: the longer frame dumps the timeline to <trace>_N.json, 0 - disabled | }"
+    "{ la latency_sla   |0                   | End-to-end latency SLA from the capture to the published tracks in milliseconds: the violations are counted in the latency report and mtracker_frame_latency_sla_violations_total, 0 - disabled | }"
+    "{ af affinity      |                    | CPU affinity of the threads: stage=cpus[/OpenMP threads] separated by ';', the stages of the pipeline, capture_detect, tracking_render, sync and * (the others), the cpus 0-3,8 or node1 | }"
+    "{ th threads       |0                   | Threads of the task scheduler shared by the parallel loops of the library and OpenCV, 0 - hardware concurrency | }"
+    "{ shm shm_tracks   |                    | Name of the shared memory ring for the tracks of every frame, for example /mtracking_tracks: the readers attach by mt_tracks_ring_open | }"
+    "{ pp preview_port  |0                   | Port of the HTTP preview: GET /preview - MJPEG of the frames, GET /tracks - JSON lines of the tracks delta, 0 - disabled | }"
+    "{ pw preview_width |640                 | Width of the preview frames, 0 - the frame size | }"
+    "{ pf preview_fps   |5                   | Maximum frame rate of the preview, 0 - every frame | }"
+    "{ r res            |                    | Path to the csv file with tracking result, the file with .bin extension is written in the binary format during the processing | }"
     "{ s settings       |                    | Path to the init file with tracking settings | }"
+    "{ sr settings_reload |0                 | Check the settings file every N tracked frames and apply the changes to the tracker without the loss of the tracks, 0 - disabled | }"
+    "{ st stitch        |                    | Path to the csv file with tracking result for the offline tracklets stitching, result is written to the --res file | }"
 	"{ bs batch_size    |1                   | Batch size - frames count for processing | }"
     "{ inf inference    |darknet             | For CarsCounting: Type of inference framework: darknet, ocvdnn | }"
 	"{ w weights        |                    | For CarsCounting: Weights of neural network: yolov4.weights | }"
@@ -41,6 +64,7 @@ const char* keys =
 	"{ n names          |                    | For CarsCounting: File with classes names: coco.names | }"
     "{ wf write_n_frame |1                   | Write logs on each N frame: 1 for writing each frame | }"
  	"{ hm heat_map      |0                   | For CarsCounting: Draw heat map | }"
+ 	"{ hs heat_map_scale |4                  | For CarsCounting: Heat map is accumulated on the grid downscaled N times | }"
 };
 
 // ----------------------------------------------------------------------
@@ -52,12 +76,34 @@ int main(int argc, char** argv)
     Help();
     parser.printMessage();
 
+    tasks::InstallOpenCVBackend(static_cast<size_t>(std::max(0, parser.get<int>("threads"))));
+
+    std::string stitchFile = parser.get<std::string>("stitch");
+    if (!stitchFile.empty())
+    {
+        std::string resFile = parser.get<std::string>("res");
+        if (resFile.empty())
+            resFile = stitchFile + ".stitched.csv";
+        if (ResultsLog::IsBinaryFile(stitchFile))
+        {
+            // The stitcher reads the csv with the robust tracks only
+            BinaryResultsReader reader(stitchFile);
+            std::string csvFile = stitchFile + ".csv";
+            if (!reader.Open() || !reader.ExportCsv(csvFile))
+                return 1;
+            stitchFile = csvFile;
+        }
+        TrackletsStitcher stitcher((StitchSettings()));
+        return stitcher.Process(stitchFile, resFile) ? 0 : 1;
+    }
+
     bool useOCL = parser.get<int>("gpu") != 0;
     cv::ocl::setUseOpenCL(useOCL);
     std::cout << (cv::ocl::useOpenCL() ? "OpenCL is enabled" : "OpenCL not used") << std::endl;
 
     int exampleNum = parser.get<int>("example");
     int asyncPipeline = parser.get<int>("async");
+    int pipelineDepth = parser.get<int>("pipeline_depth");
 
 	std::unique_ptr<VideoExample> detector;
 
@@ -112,7 +158,12 @@ int main(int argc, char** argv)
     }
 
 	if (detector.get())
-		asyncPipeline ? detector->AsyncProcess() : detector->SyncProcess();
+	{
+		if (pipelineDepth > 0)
+			detector->PipelineProcess(static_cast<size_t>(pipelineDepth));
+		else
+			asyncPipeline ? detector->AsyncProcess() : detector->SyncProcess();
+	}
 
 #ifndef SILENT_WORK
     cv::destroyAllWindows();
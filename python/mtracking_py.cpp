@@ -0,0 +1,404 @@
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+#include <pybind11/stl.h>
+
+#include <map>
+#include <string>
+#include <stdexcept>
+
+#include "BaseDetector.h"
+#include "Ctracker.h"
+#include "TrackerSettings.h"
+
+namespace py = pybind11;
+
+///
+/// \brief The RegionRecord struct
+/// Record of the structured numpy array of the regions: the input of the tracker and the output of the detector
+///
+struct RegionRecord
+{
+    int32_t x;
+    int32_t y;
+    int32_t width;
+    int32_t height;
+    int32_t type;
+    float confidence;
+};
+
+///
+/// \brief The TrackRecord struct
+/// Record of the structured numpy array of the tracks, the trajectories aren't copied
+///
+struct TrackRecord
+{
+    uint64_t id;
+    int32_t type;
+    float confidence;
+    int32_t x;              // Bounding rect of the rotated one
+    int32_t y;
+    int32_t width;
+    int32_t height;
+    float center_x;         // Rotated rect
+    float center_y;
+    float rect_width;
+    float rect_height;
+    float angle;
+    float velocity_x;       // pixels/sec
+    float velocity_y;
+    uint8_t is_static;
+    uint8_t out_of_frame;
+};
+
+namespace
+{
+///
+/// \brief WrapFrame
+/// cv::Mat header over the buffer of the uint8 numpy array HxW or HxWxC without the copy, the rows can have the padding
+/// \param frame - numpy array or None for the empty frame
+/// \return
+///
+cv::Mat WrapFrame(const py::object& frame)
+{
+    if (frame.is_none())
+        return cv::Mat();
+
+    py::array arr = py::array::ensure(frame);
+    if (!arr)
+        throw std::invalid_argument("Frame must be a numpy array");
+    py::buffer_info info = arr.request();
+
+    if (info.format != py::format_descriptor<uint8_t>::format())
+        throw std::invalid_argument("Frame must be uint8");
+    if (info.ndim != 2 && info.ndim != 3)
+        throw std::invalid_argument("Frame must be HxW or HxWxC");
+
+    const int channels = (info.ndim == 3) ? static_cast<int>(info.shape[2]) : 1;
+    if (channels < 1 || channels > 4)
+        throw std::invalid_argument("Frame must have from 1 to 4 channels");
+    if (info.strides[1] != channels || (info.ndim == 3 && info.strides[2] != 1) || info.strides[0] < info.shape[1] * channels)
+        throw std::invalid_argument("Pixels of the frame rows must be contiguous, use numpy.ascontiguousarray");
+
+    return cv::Mat(static_cast<int>(info.shape[0]), static_cast<int>(info.shape[1]), CV_8UC(channels), info.ptr, static_cast<size_t>(info.strides[0]));
+}
+
+///
+/// \brief ToRegions
+/// \param records
+/// \return
+///
+regions_t ToRegions(const py::array_t<RegionRecord, py::array::c_style | py::array::forcecast>& records)
+{
+    if (records.ndim() != 1)
+        throw std::invalid_argument("Regions must be one-dimensional array of the region_dtype");
+
+    regions_t regions;
+    regions.reserve(static_cast<size_t>(records.shape(0)));
+    const RegionRecord* ptr = records.data();
+    for (py::ssize_t i = 0; i < records.shape(0); ++i)
+    {
+        const RegionRecord& rec = ptr[i];
+        regions.emplace_back(cv::Rect(rec.x, rec.y, rec.width, rec.height), static_cast<objtype_t>(rec.type), rec.confidence);
+    }
+    return regions;
+}
+
+///
+/// \brief ToRecords
+/// \param regions
+/// \return
+///
+py::array_t<RegionRecord> ToRecords(const regions_t& regions)
+{
+    py::array_t<RegionRecord> records(static_cast<py::ssize_t>(regions.size()));
+    RegionRecord* ptr = records.mutable_data();
+    for (const auto& reg : regions)
+    {
+        ptr->x = reg.m_brect.x;
+        ptr->y = reg.m_brect.y;
+        ptr->width = reg.m_brect.width;
+        ptr->height = reg.m_brect.height;
+        ptr->type = static_cast<int32_t>(reg.m_type);
+        ptr->confidence = reg.m_confidence;
+        ++ptr;
+    }
+    return records;
+}
+
+///
+/// \brief ToRecords
+/// \param tracks
+/// \return
+///
+py::array_t<TrackRecord> ToRecords(const std::vector<TrackingObject>& tracks)
+{
+    py::array_t<TrackRecord> records(static_cast<py::ssize_t>(tracks.size()));
+    TrackRecord* ptr = records.mutable_data();
+    for (const auto& track : tracks)
+    {
+        const cv::Rect brect = track.m_rrect.boundingRect();
+        ptr->id = static_cast<uint64_t>(track.m_ID.m_val);
+        ptr->type = static_cast<int32_t>(track.m_type);
+        ptr->confidence = track.m_confidence;
+        ptr->x = brect.x;
+        ptr->y = brect.y;
+        ptr->width = brect.width;
+        ptr->height = brect.height;
+        ptr->center_x = track.m_rrect.center.x;
+        ptr->center_y = track.m_rrect.center.y;
+        ptr->rect_width = track.m_rrect.size.width;
+        ptr->rect_height = track.m_rrect.size.height;
+        ptr->angle = track.m_rrect.angle;
+        ptr->velocity_x = static_cast<float>(track.m_velocity[0]);
+        ptr->velocity_y = static_cast<float>(track.m_velocity[1]);
+        ptr->is_static = track.m_isStatic ? 1 : 0;
+        ptr->out_of_frame = track.m_outOfTheFrame ? 1 : 0;
+        ++ptr;
+    }
+    return records;
+}
+
+///
+/// \brief ToRecords
+/// \param ids
+/// \return
+///
+py::array_t<uint64_t> ToRecords(const std::vector<track_id_t>& ids)
+{
+    py::array_t<uint64_t> records(static_cast<py::ssize_t>(ids.size()));
+    uint64_t* ptr = records.mutable_data();
+    for (const auto& id : ids)
+    {
+        *ptr++ = static_cast<uint64_t>(id.m_val);
+    }
+    return records;
+}
+}
+
+///
+/// \brief The PyDetector class
+/// The frame is wrapped without the copy, Detect releases the GIL
+///
+class PyDetector
+{
+public:
+    PyDetector(int detectorType, const std::map<std::string, std::string>& config, const py::object& frame)
+    {
+        if (detectorType < 0 || detectorType >= static_cast<int>(tracking::DetectorsCount))
+            throw std::invalid_argument("Unknown detector type " + std::to_string(detectorType));
+
+        config_t detectorConfig(config.begin(), config.end());
+        cv::Mat frameMat = WrapFrame(frame);
+        cv::UMat frameUMat = frameMat.getUMat(cv::ACCESS_READ);
+        m_detector = CreateDetector(static_cast<tracking::Detectors>(detectorType), detectorConfig, frameUMat);
+        if (!m_detector)
+            throw std::runtime_error("Detector " + std::to_string(detectorType) + " wasn't created");
+    }
+
+    ///
+    py::array_t<RegionRecord> Detect(const py::object& frame)
+    {
+        cv::Mat frameMat = WrapFrame(frame);
+        {
+            py::gil_scoped_release release;
+            cv::UMat frameUMat = frameMat.getUMat(cv::ACCESS_READ);
+            m_detector->Detect(frameUMat);
+        }
+        return ToRecords(m_detector->GetDetects());
+    }
+
+    ///
+    bool CanGrayProcessing() const
+    {
+        return m_detector->CanGrayProcessing();
+    }
+
+private:
+    std::unique_ptr<BaseDetector> m_detector;
+};
+
+///
+/// \brief The PyTracker class
+/// One tracker is used by one Python thread at a time, the Update calls of the different trackers overlap
+///
+class PyTracker
+{
+public:
+    PyTracker(const TrackerSettings& settings)
+        : m_tracker(BaseTracker::CreateTracker(settings))
+    {
+        if (!m_tracker)
+            throw std::runtime_error("Tracker wasn't created");
+    }
+
+    ///
+    void Update(const py::array_t<RegionRecord, py::array::c_style | py::array::forcecast>& regions, const py::object& frame, float fps)
+    {
+        regions_t trackerRegions = ToRegions(regions);
+        cv::Mat frameMat = WrapFrame(frame);
+        {
+            py::gil_scoped_release release;
+            m_tracker->Update(trackerRegions, frameMat.getUMat(cv::ACCESS_READ), fps);
+        }
+        KeepFrame(frame);
+    }
+
+    ///
+    void UpdateAt(const py::array_t<RegionRecord, py::array::c_style | py::array::forcecast>& regions, const py::object& frame, double timestamp)
+    {
+        regions_t trackerRegions = ToRegions(regions);
+        cv::Mat frameMat = WrapFrame(frame);
+        {
+            py::gil_scoped_release release;
+            m_tracker->UpdateAt(trackerRegions, frameMat.getUMat(cv::ACCESS_READ), timestamp);
+        }
+        KeepFrame(frame);
+    }
+
+    ///
+    py::array_t<TrackRecord> GetTracks()
+    {
+        m_tracks.clear();
+        m_tracker->GetTracks(m_tracks);
+        return ToRecords(m_tracks);
+    }
+
+    ///
+    py::tuple GetTracksDelta()
+    {
+        m_tracker->GetTracksDelta(m_delta, false);
+        return py::make_tuple(ToRecords(m_delta.m_newTracks), ToRecords(m_delta.m_updatedTracks), ToRecords(m_delta.m_removedTracks));
+    }
+
+    ///
+    py::array_t<uint64_t> GetRemovedTracks() const
+    {
+        std::vector<track_id_t> ids;
+        m_tracker->GetRemovedTracks(ids);
+        return ToRecords(ids);
+    }
+
+    ///
+    size_t GetTracksCount() const
+    {
+        return m_tracker->GetTracksCount();
+    }
+
+    ///
+    bool CanColorFrameToTrack() const
+    {
+        return m_tracker->CanColorFrameToTrack();
+    }
+
+    ///
+    void ApplySettings(const TrackerSettings& settings)
+    {
+        m_tracker->ApplySettings(settings);
+    }
+
+private:
+    std::unique_ptr<BaseTracker> m_tracker;
+    py::object m_prevFrame; // The tracker keeps the previous frame without the copy: its buffer is alive until the next update
+    std::vector<TrackingObject> m_tracks;
+    TracksDelta m_delta;
+
+    ///
+    void KeepFrame(const py::object& frame)
+    {
+        m_prevFrame = frame;
+    }
+};
+
+///
+#define SETTINGS_FIELD(name, field) .def_readwrite(name, &TrackerSettings::field)
+#define SETTINGS_ENUM(name, field, type) .def_property(name, \
+    [](const TrackerSettings& s) { return static_cast<int>(s.field); }, \
+    [](TrackerSettings& s, int val) { s.field = static_cast<type>(val); })
+
+PYBIND11_MODULE(pymtracking, m)
+{
+    m.doc() = "Multitarget tracker: detectors, trackers and settings with the numpy frames and results";
+
+    PYBIND11_NUMPY_DTYPE(RegionRecord, x, y, width, height, type, confidence);
+    PYBIND11_NUMPY_DTYPE(TrackRecord, id, type, confidence, x, y, width, height, center_x, center_y, rect_width, rect_height, angle,
+                         velocity_x, velocity_y, is_static, out_of_frame);
+
+    m.attr("region_dtype") = py::dtype::of<RegionRecord>();
+    m.attr("track_dtype") = py::dtype::of<TrackRecord>();
+
+    m.def("type_to_str", &TypeConverter::Type2Str, py::arg("type"));
+    m.def("str_to_type", &TypeConverter::Str2Type, py::arg("name"));
+
+    py::class_<TrackerSettings>(m, "TrackerSettings")
+        .def(py::init<>())
+        .def("load", [](TrackerSettings& s, const std::string& settingsFile) { return ParseTrackerSettings(settingsFile, s); }, py::arg("settings_file"))
+        .def("set_distance", [](TrackerSettings& s, int distType)
+        {
+            if (distType < 0 || distType >= static_cast<int>(tracking::DistsCount))
+                throw std::invalid_argument("Unknown distance type " + std::to_string(distType));
+            s.SetDistance(static_cast<tracking::DistType>(distType));
+        }, py::arg("dist_type"))
+        .def("set_distances", [](TrackerSettings& s, const std::array<track_t, tracking::DistsCount>& dists) { return s.SetDistances(dists); }, py::arg("weights"))
+        SETTINGS_ENUM("kalman_type", m_kalmanType, tracking::KalmanType)
+        SETTINGS_ENUM("filter_goal", m_filterGoal, tracking::FilterGoal)
+        SETTINGS_ENUM("lost_track_type", m_lostTrackType, tracking::LostTrackType)
+        SETTINGS_ENUM("match_type", m_matchType, tracking::MatchType)
+        SETTINGS_ENUM("track_id_mode", m_trackIDMode, tracking::TrackIDMode)
+        SETTINGS_FIELD("split_assignment", m_splitAssignment)
+        SETTINGS_FIELD("type_groups_assignment", m_typeGroupsAssignment)
+        SETTINGS_FIELD("flow_window", m_flowWindow)
+        SETTINGS_FIELD("flow_birth_cost", m_flowBirthCost)
+        SETTINGS_FIELD("delta_time", m_dt)
+        SETTINGS_FIELD("nominal_fps", m_nominalFps)
+        SETTINGS_FIELD("accel_noise", m_accelNoiseMag)
+        SETTINGS_FIELD("use_aceleration", m_useAcceleration)
+        SETTINGS_FIELD("batched_kalman", m_batchedKalman)
+        SETTINGS_FIELD("kalman_steady_state", m_kalmanSteadyState)
+        SETTINGS_FIELD("dist_thresh", m_distThres)
+        SETTINGS_FIELD("min_area_radius_pix", m_minAreaRadiusPix)
+        SETTINGS_FIELD("min_area_radius_k", m_minAreaRadiusK)
+        SETTINGS_FIELD("spatial_gating", m_useSpatialGating)
+        SETTINGS_FIELD("parallel_dist_matrix", m_parallelDistMatrix)
+        SETTINGS_FIELD("parallel_tracks_update", m_parallelTracksUpdate)
+        SETTINGS_FIELD("max_skip_frames", m_maximumAllowedSkippedFrames)
+        SETTINGS_FIELD("max_trace_len", m_maxTraceLength)
+        SETTINGS_FIELD("detect_abandoned", m_useAbandonedDetection)
+        SETTINGS_FIELD("min_static_time", m_minStaticTime)
+        SETTINGS_FIELD("max_static_time", m_maxStaticTime)
+        SETTINGS_FIELD("max_speed_for_static", m_maxSpeedForStatic)
+        SETTINGS_FIELD("tracks_max_mb", m_tracksMaxMem)
+        SETTINGS_FIELD("stream_id", m_streamID)
+        SETTINGS_FIELD("reid_gallery_size", m_reidGallerySize)
+        SETTINGS_FIELD("reid_gallery_time", m_reidGalleryTime)
+        SETTINGS_FIELD("reid_gallery_dist", m_reidGalleryDist)
+        SETTINGS_FIELD("lazy_embeddings", m_lazyEmbeddings)
+        SETTINGS_FIELD("lazy_embeddings_iou", m_lazyEmbeddingsIoU)
+        SETTINGS_FIELD("nn_weights", m_nnWeights)
+        SETTINGS_FIELD("nn_config", m_nnConfig)
+        SETTINGS_FIELD("class_names", m_classNames)
+        SETTINGS_FIELD("confidence_threshold", m_confidenceThreshold)
+        SETTINGS_FIELD("detector_backend", m_detectorBackend)
+        SETTINGS_FIELD("net_type", m_netType)
+        SETTINGS_FIELD("inference_precison", m_inferencePrecison)
+        SETTINGS_FIELD("ocv_dnn_target", m_dnnTarget)
+        SETTINGS_FIELD("ocv_dnn_backend", m_dnnBackend);
+
+    py::class_<PyDetector>(m, "Detector")
+        .def(py::init<int, const std::map<std::string, std::string>&, const py::object&>(),
+             py::arg("detector_type"), py::arg("config"), py::arg("frame"),
+             "Detector by CreateDetector, the frame is the first frame of the stream (gray for the motion detectors)")
+        .def("detect", &PyDetector::Detect, py::arg("frame"), "Regions of the frame as the array of region_dtype")
+        .def("can_gray_processing", &PyDetector::CanGrayProcessing);
+
+    py::class_<PyTracker>(m, "Tracker")
+        .def(py::init<const TrackerSettings&>(), py::arg("settings"))
+        .def("update", &PyTracker::Update, py::arg("regions"), py::arg("frame"), py::arg("fps"),
+             "Regions is the array of region_dtype, the frame buffer must not be changed until the next update")
+        .def("update_at", &PyTracker::UpdateAt, py::arg("regions"), py::arg("frame"), py::arg("timestamp"))
+        .def("tracks", &PyTracker::GetTracks, "Alive tracks as the array of track_dtype")
+        .def("tracks_delta", &PyTracker::GetTracksDelta, "Tuple of the new and the updated tracks of track_dtype and the removed IDs after the previous poll")
+        .def("removed_tracks", &PyTracker::GetRemovedTracks)
+        .def("tracks_count", &PyTracker::GetTracksCount)
+        .def("can_color_frame_to_track", &PyTracker::CanColorFrameToTrack)
+        .def("apply_settings", &PyTracker::ApplySettings, py::arg("settings"));
+}
@@ -0,0 +1,143 @@
+#include <cmath>
+#include <iostream>
+#include <algorithm>
+#include "AdaptiveInput.h"
+
+///
+/// \brief AdaptiveInput::Init
+/// \param config
+/// \return
+///
+bool AdaptiveInput::Init(const config_t& config)
+{
+    auto adaptiveInput = config.find("adaptiveInput");
+    m_enabled = (adaptiveInput != config.end()) && (std::stoi(adaptiveInput->second) != 0);
+
+    auto adaptiveMinObject = config.find("adaptiveMinObject");
+    if (adaptiveMinObject != config.end())
+        m_minObject = std::max(1, std::stoi(adaptiveMinObject->second));
+
+    auto adaptivePercentile = config.find("adaptivePercentile");
+    if (adaptivePercentile != config.end())
+        m_percentile = std::min(1.f, std::max(0.f, std::stof(adaptivePercentile->second)));
+
+    auto adaptiveWindow = config.find("adaptiveWindow");
+    if (adaptiveWindow != config.end())
+        m_window = static_cast<size_t>(std::max(1, std::stoi(adaptiveWindow->second)));
+
+    auto adaptivePeriod = config.find("adaptivePeriod");
+    if (adaptivePeriod != config.end())
+        m_period = static_cast<size_t>(std::max(1, std::stoi(adaptivePeriod->second)));
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_sides.clear();
+    m_decided = false;
+    m_framesFromDecision = 0;
+    return true;
+}
+
+///
+/// \brief AdaptiveInput::Observe
+/// \param rects
+///
+void AdaptiveInput::Observe(const std::vector<cv::Rect>& rects)
+{
+    if (!m_enabled)
+        return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto& rect : rects)
+    {
+        const int side = std::min(rect.width, rect.height);
+        if (side <= 0)
+            continue;
+        m_sides.push_back(side);
+        if (m_sides.size() > m_window)
+            m_sides.pop_front();
+    }
+}
+
+///
+/// \brief AdaptiveInput::Select
+/// \param netSizes
+/// \param frameSize
+/// \param cropRatio
+/// \return
+///
+size_t AdaptiveInput::Select(const std::vector<cv::Size>& netSizes, cv::Size frameSize, float& cropRatio)
+{
+    const size_t defNetInd = netSizes.empty() ? 0 : (netSizes.size() - 1);
+    if (!m_enabled || netSizes.empty() || frameSize.area() <= 0)
+        return defNetInd;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // The decision isn't valid for the other frames or engines
+    if (m_decided && (frameSize != m_frameSize || netSizes.size() != m_netsCount))
+        m_decided = false;
+
+    if (!m_decided || ++m_framesFromDecision >= m_period)
+    {
+        m_framesFromDecision = 0;
+        size_t netInd = defNetInd;
+        float newCropRatio = cropRatio;
+        if (Decide(netSizes, frameSize, netInd, newCropRatio))
+        {
+            // Small changes of the ratio don't change the crops
+            const bool changed = !m_decided || netInd != m_netInd || ((newCropRatio > 0) != (m_cropRatio > 0)) ||
+                (newCropRatio > 0 && std::abs(newCropRatio - m_cropRatio) > 0.2f * m_cropRatio);
+            if (changed)
+            {
+                std::cout << "AdaptiveInput: input " << netSizes[netInd] << ", " << ((newCropRatio > 0) ? ("crop ratio " + std::to_string(newCropRatio)) : std::string("whole frame"))
+                          << ", frame " << frameSize << std::endl;
+                m_netInd = netInd;
+                m_cropRatio = newCropRatio;
+                m_frameSize = frameSize;
+                m_netsCount = netSizes.size();
+                m_decided = true;
+            }
+        }
+    }
+    if (!m_decided)
+        return defNetInd;
+
+    cropRatio = m_cropRatio;
+    return m_netInd;
+}
+
+///
+/// \brief AdaptiveInput::Decide
+/// \param netSizes
+/// \param frameSize
+/// \param netInd
+/// \param cropRatio
+/// \return false if there are not enough objects
+///
+bool AdaptiveInput::Decide(const std::vector<cv::Size>& netSizes, cv::Size frameSize, size_t& netInd, float& cropRatio)
+{
+    // At least the tenth of the window or 32 objects
+    if (m_sides.size() < std::min<size_t>(m_window, std::max<size_t>(32, m_window / 10)))
+        return false;
+    m_sorted.assign(std::begin(m_sides), std::end(m_sides));
+    const size_t pos = std::min(m_sorted.size() - 1, static_cast<size_t>(m_percentile * m_sorted.size()));
+    std::nth_element(m_sorted.begin(), m_sorted.begin() + pos, m_sorted.end());
+    const float objectSide = static_cast<float>(m_sorted[pos]);
+
+    // The whole frame is letterboxed to the input
+    for (size_t i = 0; i < netSizes.size(); ++i)
+    {
+        const float scale = std::min(static_cast<float>(netSizes[i].width) / frameSize.width, static_cast<float>(netSizes[i].height) / frameSize.height);
+        if (objectSide * scale >= m_minObject)
+        {
+            netInd = i;
+            cropRatio = -1.f;
+            return true;
+        }
+    }
+
+    // The crops of the largest input: the crop is cropRatio times of the input, so the objects are cropRatio times smaller.
+    // The crops aren't upscaled
+    netInd = netSizes.size() - 1;
+    cropRatio = std::max(1.f, objectSide / m_minObject);
+    return true;
+}
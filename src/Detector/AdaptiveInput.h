@@ -0,0 +1,68 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include "defines.h"
+
+///
+/// \brief The AdaptiveInput class
+/// Network input of the stream by the sizes of its tracked objects: the min sides of the tracked rects are collected
+/// on the sliding window and their low percentile on the network input must be at least minObject pixels.
+/// The smallest input (of the engines with the different sizes) that keeps the whole frame above it is selected,
+/// if there is no such input then the largest one detects on the crops with the ratio that keeps the objects above it.
+/// The decision is updated once per period of the frames and it's changed only on the significant difference,
+/// so the crops of the tiles gate stay the same. Until the window has enough objects the configured input is used
+///
+class AdaptiveInput
+{
+public:
+    ///
+    /// \brief Init
+    /// \param config - "adaptiveInput", "adaptiveMinObject", "adaptivePercentile", "adaptiveWindow", "adaptivePeriod"
+    /// \return
+    ///
+    bool Init(const config_t& config);
+
+    ///
+    bool Enabled() const
+    {
+        return m_enabled;
+    }
+
+    ///
+    /// \brief Observe
+    /// It's called by the tracker thread
+    /// \param rects - tracked objects on the last frame
+    ///
+    void Observe(const std::vector<cv::Rect>& rects);
+
+    ///
+    /// \brief Select
+    /// It's called by the detection threads
+    /// \param netSizes - input sizes of the engines in the ascending order of the area
+    /// \param frameSize
+    /// \param cropRatio - configured crop ratio, gets the ratio of the selected input: <= 0 - the whole frame
+    /// \return Index of the selected input
+    ///
+    size_t Select(const std::vector<cv::Size>& netSizes, cv::Size frameSize, float& cropRatio);
+
+private:
+    bool m_enabled = false;
+    int m_minObject = 16;          // Min side of the object on the network input, pixels
+    float m_percentile = 0.1f;     // Of the object sides
+    size_t m_window = 512;         // Last observed objects
+    size_t m_period = 100;         // Frames between the decisions
+
+    std::mutex m_mutex;            // Of the all members below
+    std::deque<int> m_sides;       // Min sides of the tracked rects on the frame
+
+    std::vector<int> m_sorted;
+    size_t m_framesFromDecision = 0;
+    bool m_decided = false;
+    cv::Size m_frameSize;
+    size_t m_netsCount = 0;
+    size_t m_netInd = 0;
+    float m_cropRatio = 0.f;
+
+    bool Decide(const std::vector<cv::Size>& netSizes, cv::Size frameSize, size_t& netInd, float& cropRatio);
+};
@@ -1,5 +1,13 @@
 #include "BackgroundSubtract.h"
+#include "execution_policy.h"
 #include <tuple>
+#include <fstream>
+#include <cstring>
+
+#ifdef USE_CUDA_BGFG
+#include <opencv2/cudaarithm.hpp>
+#include <opencv2/cudaimgproc.hpp>
+#endif
 
 //----------------------------------------------------------------------
 //
@@ -18,6 +26,11 @@ BackgroundSubtract::BackgroundSubtract(BGFG_ALGS algType, int channels)
 //----------------------------------------------------------------------
 bool BackgroundSubtract::Init(const config_t& config)
 {
+#ifdef USE_CUDA_BGFG
+    if (InitCuda(config))
+        return true;
+#endif
+
     bool failed = true;
     for (; failed;)
     {
@@ -204,6 +217,130 @@ bool BackgroundSubtract::Init(const config_t& config)
     return !failed;
 }
 
+#ifdef USE_CUDA_BGFG
+//----------------------------------------------------------------------
+// The CUDA models of MOG and MOG2 with the same params as on CPU
+//----------------------------------------------------------------------
+bool BackgroundSubtract::InitCuda(const config_t& config)
+{
+    m_modelMOGCuda.reset();
+    m_modelMOG2Cuda.reset();
+
+    auto bgfgCuda = config.find("bgfgCuda");
+    if (bgfgCuda == config.end() || std::stoi(bgfgCuda->second) == 0)
+        return false;
+    if (m_algType != ALG_MOG && m_algType != ALG_MOG2)
+    {
+        std::cerr << "BackgroundSubtract: CUDA backend is implemented only for MOG and MOG2! Used CPU." << std::endl;
+        return false;
+    }
+    if (cv::cuda::getCudaEnabledDeviceCount() <= 0)
+    {
+        std::cerr << "BackgroundSubtract: CUDA devices are not found! Used CPU." << std::endl;
+        return false;
+    }
+
+    auto readParam = [&config](const std::string& name, auto& value)
+    {
+        auto conf = config.find(name);
+        if (conf != config.end())
+        {
+            std::stringstream ss(conf->second);
+            ss >> value;
+        }
+    };
+
+    if (m_algType == ALG_MOG2)
+    {
+        int history = 500;
+        double varThreshold = 16;
+        int detectShadows = 1;
+        readParam("history", history);
+        readParam("varThreshold", varThreshold);
+        readParam("detectShadows", detectShadows);
+        m_modelMOG2Cuda = cv::cuda::createBackgroundSubtractorMOG2(history, varThreshold, detectShadows != 0);
+    }
+    else
+    {
+        int history = 100;
+        int nmixtures = 3;
+        double backgroundRatio = 0.7;
+        double noiseSigma = 0;
+        readParam("history", history);
+        readParam("nmixtures", nmixtures);
+        readParam("backgroundRatio", backgroundRatio);
+        readParam("noiseSigma", noiseSigma);
+        m_modelMOGCuda = cv::cuda::createBackgroundSubtractorMOG(history, nmixtures, backgroundRatio, noiseSigma);
+    }
+    m_medianCuda = cv::cuda::createMedianFilter(CV_8UC1, 3);
+    m_modelOCV.release();
+    m_rawForeground.release();
+    return true;
+}
+
+//----------------------------------------------------------------------
+// The image is converted to the channels of the model on the device, only the filtered mask is downloaded
+//----------------------------------------------------------------------
+void BackgroundSubtract::ApplyCuda(const cv::cuda::GpuMat& image, cv::UMat& foreground, double learningRate)
+{
+    const cv::cuda::GpuMat* img = &image;
+    if (image.channels() != m_channels)
+    {
+        int code = cv::COLOR_BGR2GRAY;
+        if (image.channels() == 1)
+            code = cv::COLOR_GRAY2BGR;
+        else if (image.channels() == 4)
+            code = (m_channels == 1) ? cv::COLOR_BGRA2GRAY : cv::COLOR_BGRA2BGR;
+        cv::cuda::cvtColor(image, m_gpuImg, code, 0, m_streamCuda);
+        img = &m_gpuImg;
+    }
+
+    if (m_modelMOG2Cuda)
+    {
+        m_modelMOG2Cuda->apply(*img, m_gpuRawForeground, learningRate, m_streamCuda);
+        cv::cuda::threshold(m_gpuRawForeground, m_gpuRawForeground, 200, 255, cv::THRESH_BINARY, m_streamCuda);
+    }
+    else
+    {
+        m_modelMOGCuda->apply(*img, m_gpuRawForeground, learningRate, m_streamCuda);
+    }
+    m_medianCuda->apply(m_gpuRawForeground, m_gpuForeground, m_streamCuda);
+    m_gpuForeground.download(m_hostForeground, m_streamCuda);
+    m_streamCuda.waitForCompletion();
+    exec::CountTransfer(exec::Direction::ToHost, m_hostForeground.total() * m_hostForeground.elemSize(), "BackgroundSubtract::ApplyCuda");
+    m_hostForeground.copyTo(foreground);
+}
+#endif
+
+//----------------------------------------------------------------------
+//
+//----------------------------------------------------------------------
+bool BackgroundSubtract::CudaBackend() const
+{
+#ifdef USE_CUDA_BGFG
+    return m_modelMOGCuda || m_modelMOG2Cuda;
+#else
+    return false;
+#endif
+}
+
+//----------------------------------------------------------------------
+//
+//----------------------------------------------------------------------
+bool BackgroundSubtract::SubtractDevice(const cv::cuda::GpuMat& image, cv::UMat& foreground)
+{
+#ifdef USE_CUDA_BGFG
+    if (!CudaBackend() || image.empty())
+        return false;
+    ApplyCuda(image, foreground);
+    return true;
+#else
+    (void)image;
+    (void)foreground;
+    return false;
+#endif
+}
+
 //----------------------------------------------------------------------
 //
 //----------------------------------------------------------------------
@@ -240,11 +377,21 @@ cv::UMat BackgroundSubtract::GetImg(const cv::UMat& image)
 //----------------------------------------------------------------------
 void BackgroundSubtract::Subtract(const cv::UMat& image, cv::UMat& foreground)
 {
+#ifdef USE_CUDA_BGFG
+    if (CudaBackend())
+    {
+        m_gpuUpload.upload(image);
+        exec::CountTransfer(exec::Direction::ToDevice, image.total() * image.elemSize(), "BackgroundSubtract::Subtract");
+        ApplyCuda(m_gpuUpload, foreground);
+        return;
+    }
+#endif
+
     switch (m_algType)
     {
     case ALG_VIBE:
-        m_modelVibe->update(GetImg(image).getMat(cv::ACCESS_READ));
-		m_rawForeground = m_modelVibe->getMask().getUMat(cv::ACCESS_READ);
+        m_modelVibe->update(GetImg(image));
+		m_rawForeground = m_modelVibe->getMaskUMat();
         break;
 
     case ALG_MOG:
@@ -277,8 +424,8 @@ void BackgroundSubtract::Subtract(const cv::UMat& image, cv::UMat& foreground)
         break;
 
     default:
-        m_modelVibe->update(GetImg(image).getMat(cv::ACCESS_READ));
-		m_rawForeground = m_modelVibe->getMask().getUMat(cv::ACCESS_READ);
+        m_modelVibe->update(GetImg(image));
+		m_rawForeground = m_modelVibe->getMaskUMat();
         break;
     }
 
@@ -303,6 +450,324 @@ void BackgroundSubtract::ResetModel(const cv::UMat& img, const cv::Rect& roiRect
 {
 	if (m_algType == ALG_VIBE)
 	{
-		m_modelVibe->ResetModel(GetImg(img).getMat(cv::ACCESS_READ), roiRect);
+		m_modelVibe->ResetModel(GetImg(img), roiRect);
 	}
 }
+
+//----------------------------------------------------------------------
+//
+//----------------------------------------------------------------------
+void BackgroundSubtract::SetTiles(int tileRows, int tilePitch)
+{
+    if (m_modelVibe)
+        m_modelVibe->SetTiles(tileRows, tilePitch);
+}
+
+//----------------------------------------------------------------------
+//
+//----------------------------------------------------------------------
+bool BackgroundSubtract::SaveModel(const std::string& fileName) const
+{
+    model_mats_t mats;
+    switch (m_algType)
+    {
+    case ALG_SuBSENSE:
+    case ALG_LOBSTER:
+        if (m_rawForeground.empty())
+            break;
+        m_modelSuBSENSE->exportModel(mats);
+        break;
+
+    case ALG_MOG:
+    case ALG_GMG:
+    case ALG_CNT:
+    case ALG_MOG2:
+#ifdef USE_CUDA_BGFG
+        if (CudaBackend())
+        {
+            cv::cuda::Stream stream;
+            cv::cuda::GpuMat gpuBackground;
+            if (m_modelMOG2Cuda)
+                m_modelMOG2Cuda->getBackgroundImage(gpuBackground, stream);
+            else
+                m_modelMOGCuda->getBackgroundImage(gpuBackground, stream);
+            stream.waitForCompletion();
+            if (!gpuBackground.empty())
+            {
+                cv::Mat background;
+                gpuBackground.download(background);
+                mats.emplace("background", background);
+            }
+            break;
+        }
+#endif
+        if (m_modelOCV)
+        {
+            try
+            {
+                cv::Mat background;
+                m_modelOCV->getBackgroundImage(background);
+                if (!background.empty())
+                    mats.emplace("background", background);
+            }
+            catch (const cv::Exception& ex)
+            {
+                std::cerr << "BackgroundSubtract::SaveModel: the background image isn't supported: " << ex.what() << std::endl;
+            }
+        }
+        break;
+
+    case ALG_VIBE:
+    default:
+    {
+        cv::Mat model = m_modelVibe->GetModel();
+        if (!model.empty())
+            mats.emplace("vibe", model);
+        break;
+    }
+    }
+
+    if (mats.empty())
+    {
+        std::cerr << "BackgroundSubtract::SaveModel: the model is empty" << std::endl;
+        return false;
+    }
+    return WriteModelFile(fileName, m_algType, m_channels, mats);
+}
+
+//----------------------------------------------------------------------
+//
+//----------------------------------------------------------------------
+bool BackgroundSubtract::LoadModel(const std::string& fileName)
+{
+    model_mats_t mats;
+    if (!ReadModelFile(fileName, m_algType, m_channels, mats))
+        return false;
+
+    bool res = false;
+    switch (m_algType)
+    {
+    case ALG_SuBSENSE:
+    case ALG_LOBSTER:
+    {
+        auto it = mats.find("lastColor");
+        res = (it != mats.end()) && m_modelSuBSENSE->importModel(mats);
+        if (res)
+            m_rawForeground.create(it->second.size(), CV_8UC1);
+        break;
+    }
+
+    case ALG_MOG:
+    case ALG_GMG:
+    case ALG_CNT:
+    case ALG_MOG2:
+    {
+        auto it = mats.find("background");
+#ifdef USE_CUDA_BGFG
+        if (CudaBackend() && it != mats.end())
+        {
+            constexpr int primeFrames = 50;
+            cv::cuda::GpuMat background(it->second);
+            ApplyCuda(background, m_rawForeground, 1.);
+            for (int i = 1; i < primeFrames; ++i)
+            {
+                ApplyCuda(background, m_rawForeground);
+            }
+            res = true;
+            break;
+        }
+#endif
+        if (m_modelOCV && it != mats.end())
+        {
+            // The mixtures aren't accessible: the model is initialized by the background (learning rate 1) and learned on it
+            // for the initialization frames of GMG and the stable weights of the others
+            constexpr int primeFrames = 50;
+            cv::UMat background = it->second.getUMat(cv::ACCESS_READ);
+            m_modelOCV->apply(background, m_rawForeground, 1.);
+            for (int i = 1; i < primeFrames; ++i)
+            {
+                m_modelOCV->apply(background, m_rawForeground);
+            }
+            res = true;
+        }
+        break;
+    }
+
+    case ALG_VIBE:
+    default:
+    {
+        auto it = mats.find("vibe");
+        res = (it != mats.end()) && m_modelVibe->SetModel(it->second);
+        break;
+    }
+    }
+
+    if (!res)
+        std::cerr << "BackgroundSubtract::LoadModel: the model from " << fileName << " doesn't fit the algorithm" << std::endl;
+    return res;
+}
+
+///
+/// The model file: the header, the table of the matrices and the matrices data with the 64 bytes aligned offsets,
+/// so the file can be memory-mapped and the matrices headers can point to the mapped data.
+/// All the values are in the little endian (native) order
+///
+namespace
+{
+    constexpr char ModelFileMagic[4] = { 'B', 'G', 'F', 'G' };
+    constexpr uint32_t ModelFileVersion = 1;
+    constexpr uint64_t ModelFileAlignment = 64;
+    constexpr uint32_t ModelFileMaxMats = 256; // The models have a few matrices, more is the broken file
+
+    struct ModelFileHeader
+    {
+        char m_magic[4];
+        uint32_t m_version;
+        int32_t m_algType;
+        int32_t m_channels;
+        uint32_t m_matsCount;
+        uint32_t m_reserved;
+    };
+
+    struct ModelFileMat
+    {
+        char m_name[48];
+        int32_t m_type;
+        int32_t m_rows;
+        int32_t m_cols;
+        uint32_t m_reserved;
+        uint64_t m_offset; // From the file begin
+        uint64_t m_size;   // In bytes
+    };
+
+    uint64_t AlignOffset(uint64_t offset)
+    {
+        return (offset + ModelFileAlignment - 1) / ModelFileAlignment * ModelFileAlignment;
+    }
+}
+
+//----------------------------------------------------------------------
+//
+//----------------------------------------------------------------------
+bool BackgroundSubtract::WriteModelFile(const std::string& fileName, int algType, int channels, const model_mats_t& mats)
+{
+    ModelFileHeader header;
+    std::memcpy(header.m_magic, ModelFileMagic, sizeof(header.m_magic));
+    header.m_version = ModelFileVersion;
+    header.m_algType = algType;
+    header.m_channels = channels;
+    header.m_matsCount = static_cast<uint32_t>(mats.size());
+    header.m_reserved = 0;
+
+    std::vector<ModelFileMat> table;
+    table.reserve(mats.size());
+    uint64_t offset = AlignOffset(sizeof(ModelFileHeader) + mats.size() * sizeof(ModelFileMat));
+    for (const auto& mat : mats)
+    {
+        if (mat.first.size() >= sizeof(ModelFileMat::m_name))
+        {
+            std::cerr << "BackgroundSubtract::SaveModel: too long name " << mat.first << std::endl;
+            return false;
+        }
+        ModelFileMat item;
+        std::memset(&item, 0, sizeof(item));
+        std::memcpy(item.m_name, mat.first.c_str(), mat.first.size());
+        item.m_type = mat.second.type();
+        item.m_rows = mat.second.rows;
+        item.m_cols = mat.second.cols;
+        item.m_offset = offset;
+        item.m_size = static_cast<uint64_t>(mat.second.total() * mat.second.elemSize());
+        offset = AlignOffset(offset + item.m_size);
+        table.push_back(item);
+    }
+
+    std::ofstream file(fileName, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        std::cerr << "BackgroundSubtract::SaveModel: can't open " << fileName << std::endl;
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(table.data()), static_cast<std::streamsize>(table.size() * sizeof(ModelFileMat)));
+
+    static const char zeros[ModelFileAlignment] = { 0 };
+    size_t i = 0;
+    for (const auto& mat : mats)
+    {
+        const uint64_t pos = static_cast<uint64_t>(file.tellp());
+        file.write(zeros, static_cast<std::streamsize>(table[i].m_offset - pos));
+
+        cv::Mat data = mat.second.isContinuous() ? mat.second : mat.second.clone();
+        file.write(reinterpret_cast<const char*>(data.data), static_cast<std::streamsize>(table[i].m_size));
+        ++i;
+    }
+    if (!file.good())
+    {
+        std::cerr << "BackgroundSubtract::SaveModel: write to " << fileName << " failed" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+//----------------------------------------------------------------------
+//
+//----------------------------------------------------------------------
+bool BackgroundSubtract::ReadModelFile(const std::string& fileName, int algType, int channels, model_mats_t& mats)
+{
+    std::ifstream file(fileName, std::ios::binary);
+    if (!file.is_open())
+    {
+        std::cerr << "BackgroundSubtract::LoadModel: can't open " << fileName << std::endl;
+        return false;
+    }
+
+    ModelFileHeader header;
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file.good() || std::memcmp(header.m_magic, ModelFileMagic, sizeof(header.m_magic)) != 0 || header.m_version != ModelFileVersion)
+    {
+        std::cerr << "BackgroundSubtract::LoadModel: " << fileName << " isn't a background model file" << std::endl;
+        return false;
+    }
+    if (header.m_algType != algType || header.m_channels != channels)
+    {
+        std::cerr << "BackgroundSubtract::LoadModel: " << fileName << " has the model of the algorithm " << header.m_algType << " with " << header.m_channels << " channels" << std::endl;
+        return false;
+    }
+
+    // The sizes from the file are checked by the file length before the allocations
+    file.seekg(0, std::ios::end);
+    const uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+    file.seekg(sizeof(header), std::ios::beg);
+    if (header.m_matsCount > ModelFileMaxMats || sizeof(header) + header.m_matsCount * sizeof(ModelFileMat) > fileSize)
+    {
+        std::cerr << "BackgroundSubtract::LoadModel: " << fileName << " has the broken table of " << header.m_matsCount << " matrices" << std::endl;
+        return false;
+    }
+
+    std::vector<ModelFileMat> table(header.m_matsCount);
+    file.read(reinterpret_cast<char*>(table.data()), static_cast<std::streamsize>(table.size() * sizeof(ModelFileMat)));
+    if (!file.good())
+        return false;
+
+    for (const auto& item : table)
+    {
+        if (item.m_rows < 0 || item.m_cols < 0 || item.m_type != CV_MAT_TYPE(item.m_type))
+            return false;
+        const uint64_t matSize = static_cast<uint64_t>(item.m_rows) * static_cast<uint64_t>(item.m_cols) * CV_ELEM_SIZE(item.m_type);
+        if (matSize != item.m_size || item.m_offset > fileSize || item.m_size > fileSize - item.m_offset)
+        {
+            std::cerr << "BackgroundSubtract::LoadModel: " << fileName << " is truncated" << std::endl;
+            return false;
+        }
+        cv::Mat mat(item.m_rows, item.m_cols, item.m_type);
+        file.seekg(static_cast<std::streamoff>(item.m_offset));
+        file.read(reinterpret_cast<char*>(mat.data), static_cast<std::streamsize>(item.m_size));
+        if (!file.good())
+        {
+            std::cerr << "BackgroundSubtract::LoadModel: " << fileName << " is truncated" << std::endl;
+            return false;
+        }
+        mats.emplace(std::string(item.m_name, strnlen(item.m_name, sizeof(item.m_name))), mat);
+    }
+    return true;
+}
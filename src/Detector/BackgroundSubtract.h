@@ -1,5 +1,7 @@
 #pragma once
 
+#include <map>
+#include <opencv2/core/cuda.hpp>
 #include "defines.h"
 #include "vibe_src/vibe.hpp"
 #include "Subsense/BackgroundSubtractorSuBSENSE.h"
@@ -9,6 +11,12 @@
 #include <opencv2/bgsegm.hpp>
 #endif
 
+#if defined(HAVE_OPENCV_CUDABGSEGM) && defined(HAVE_OPENCV_CUDAIMGPROC) && defined(HAVE_OPENCV_CUDAARITHM) && defined(HAVE_OPENCV_CUDAFILTERS)
+#define USE_CUDA_BGFG
+#include <opencv2/cudabgsegm.hpp>
+#include <opencv2/cudafilters.hpp>
+#endif
+
 ///
 /// \brief The BackgroundSubtract class
 ///
@@ -33,7 +41,48 @@ public:
 
     void Subtract(const cv::UMat& image, cv::UMat& foreground);
 
+    ///
+    /// \brief SubtractDevice
+    /// The frame stays in the CUDA memory: the color conversion, the subtraction and the filtering are on the device,
+    /// only the binary foreground is downloaded for the contours
+    /// \param image - 8-bit gray, BGR or BGRA
+    /// \param foreground
+    /// \return false if the CUDA backend isn't used
+    ///
+    bool SubtractDevice(const cv::cuda::GpuMat& image, cv::UMat& foreground);
+
+    ///
+    /// \brief CudaBackend
+    /// \return true if MOG or MOG2 are on the GPU ("bgfgCuda" config key)
+    ///
+    bool CudaBackend() const;
+
 	void ResetModel(const cv::UMat& img, const cv::Rect& roiRect);
+
+    ///
+    /// \brief SetTiles
+    /// The frames are the stacks of the independent tiles, see MotionAtlas. The per pixel models (MOG, MOG2, GMG, CNT) don't mix
+    /// the tiles, ViBe takes the neighbors only in the tile
+    /// \param tileRows
+    /// \param tilePitch - rows from the top of the tile to the top of the next one
+    ///
+    void SetTiles(int tileRows, int tilePitch);
+
+    ///
+    /// \brief SaveModel
+    /// Saves the learned background model for the warm restart
+    /// \param fileName
+    /// \return
+    ///
+    bool SaveModel(const std::string& fileName) const;
+    ///
+    /// \brief LoadModel
+    /// Restores the model saved by SaveModel with the same algorithm and channels count.
+    /// The samples models (ViBe, SuBSENSE, LOBSTER) are restored as is, the OpenCV models are learned on the saved background image
+    /// \param fileName
+    /// \return
+    ///
+    bool LoadModel(const std::string& fileName);
 	
 	int m_channels = 1;
 	BGFG_ALGS m_algType = BGFG_ALGS::ALG_MOG2;
@@ -43,7 +92,26 @@ private:
 	cv::Ptr<cv::BackgroundSubtractor> m_modelOCV;
     std::unique_ptr<BackgroundSubtractorLBSP> m_modelSuBSENSE;
 
+#ifdef USE_CUDA_BGFG
+    cv::Ptr<cv::cuda::BackgroundSubtractorMOG> m_modelMOGCuda;
+    cv::Ptr<cv::cuda::BackgroundSubtractorMOG2> m_modelMOG2Cuda;
+    cv::Ptr<cv::cuda::Filter> m_medianCuda;
+    cv::cuda::Stream m_streamCuda;
+    cv::cuda::GpuMat m_gpuUpload;
+    cv::cuda::GpuMat m_gpuImg;
+    cv::cuda::GpuMat m_gpuRawForeground;
+    cv::cuda::GpuMat m_gpuForeground;
+    cv::Mat m_hostForeground;
+
+    bool InitCuda(const config_t& config);
+    void ApplyCuda(const cv::cuda::GpuMat& image, cv::UMat& foreground, double learningRate = -1);
+#endif
+
 	cv::UMat m_rawForeground;
 
 	cv::UMat GetImg(const cv::UMat& image);
+
+    typedef std::map<std::string, cv::Mat> model_mats_t;
+    static bool WriteModelFile(const std::string& fileName, int algType, int channels, const model_mats_t& mats);
+    static bool ReadModelFile(const std::string& fileName, int algType, int channels, model_mats_t& mats);
 };
@@ -1,8 +1,15 @@
+#include <cfloat>
+#include <cctype>
+#include <iostream>
 #include "BaseDetector.h"
+#include "task_scheduler.h"
 #include "MotionDetector.h"
 #include "FaceDetector.h"
 #include "PedestrianDetector.h"
 #include "OCVDNNDetector.h"
+#include "MultiGpuDetector.h"
+#include "CascadeDetector.h"
+#include "HotSwapDetector.h"
 
 #ifdef BUILD_YOLO_LIB
 #include "YoloDarknetDetector.h"
@@ -11,6 +18,247 @@
 #include "YoloTensorRTDetector.h"
 #endif
 
+///
+/// \brief BaseDetector::CalcMotionMap
+/// \param frame
+///
+void BaseDetector::CalcMotionMap(cv::Mat& frame)
+{
+    if (!m_motionMapEnabled)
+        return;
+
+    m_motionForeground.create(frame.size(), CV_8UC1);
+    m_motionForeground.setTo(cv::Scalar(0));
+    for (const auto& region : m_regions)
+    {
+#if (CV_VERSION_MAJOR < 4)
+        cv::ellipse(m_motionForeground, region.m_rrect, cv::Scalar(255, 255, 255), CV_FILLED);
+#else
+        cv::ellipse(m_motionForeground, region.m_rrect, cv::Scalar(255, 255, 255), cv::FILLED);
+#endif
+    }
+    BlendMotionMap(frame, m_motionForeground);
+}
+
+///
+/// \brief BaseDetector::BlendMotionMap
+/// The min-max normalization of the foreground, the running average of the map and the addition to the last channel
+/// of the frame are fused in one pass over the persistent buffers
+/// \param frame
+/// \param foreground - CV_8UC1 of any size, it's resized to the frame size
+///
+void BaseDetector::BlendMotionMap(cv::Mat& frame, const cv::Mat& foreground)
+{
+    if (m_motionMap.size() != frame.size())
+    {
+        m_motionMap.create(frame.size(), CV_32FC1);
+        m_motionMap.setTo(cv::Scalar(0));
+    }
+
+    const cv::Mat* fg = &foreground;
+    if (foreground.size() != frame.size())
+    {
+        cv::resize(foreground, m_normFor, frame.size(), 0, 0, cv::INTER_LINEAR);
+        fg = &m_normFor;
+    }
+
+    constexpr float alpha = 0.95f;
+
+    // cv::NORM_MINMAX to [0, 255] and the weight of the new foreground by the table
+    double minVal = 0;
+    double maxVal = 0;
+    cv::minMaxLoc(*fg, &minVal, &maxVal);
+    const double scale = (maxVal - minVal > DBL_EPSILON) ? (255. / (maxVal - minVal)) : 0.;
+    float fgWeight[256];
+    for (int i = 0; i < 256; ++i)
+    {
+        fgWeight[i] = static_cast<float>((1. - alpha) * std::max(0., (i - minVal) * scale));
+    }
+
+    const int chans = frame.channels();
+    const int height = frame.rows;
+    const int width = frame.cols;
+    tasks::ParallelFor(0, height, [&](int y)
+    {
+        uchar* imgPtr = frame.ptr(y) + chans - 1;
+        float* moPtr = m_motionMap.ptr<float>(y);
+        const uchar* fgPtr = fg->ptr(y);
+        for (int x = 0; x < width; ++x)
+        {
+            const float mo = alpha * moPtr[x] + fgWeight[fgPtr[x]];
+            moPtr[x] = mo;
+            imgPtr[x * chans] = cv::saturate_cast<uchar>(imgPtr[x * chans] + mo);
+        }
+    });
+}
+
+///
+/// \brief BaseDetector::DetectAsync
+/// \param frame
+/// \return
+///
+std::future<regions_t> BaseDetector::DetectAsync(const cv::UMat& frame)
+{
+    std::unique_lock<std::mutex> lock(m_asyncMutex);
+    if (!m_asyncThread.joinable())
+    {
+        m_asyncStop = false;
+        m_asyncThread = std::thread(&BaseDetector::AsyncWorker, this);
+    }
+    m_asyncFreeCond.wait(lock, [this]() { return m_asyncInFlight < m_maxInFlight; });
+
+    ++m_asyncInFlight;
+    m_asyncQueue.emplace_back(frame, std::promise<regions_t>());
+    std::future<regions_t> res = m_asyncQueue.back().second.get_future();
+    lock.unlock();
+    m_asyncCond.notify_one();
+    return res;
+}
+
+///
+/// \brief BaseDetector::AsyncWorker
+///
+void BaseDetector::AsyncWorker()
+{
+    for (;;)
+    {
+        std::pair<cv::UMat, std::promise<regions_t>> task;
+        {
+            std::unique_lock<std::mutex> lock(m_asyncMutex);
+            m_asyncCond.wait(lock, [this]() { return m_asyncStop || !m_asyncQueue.empty(); });
+            // The queued frames are detected before the stop
+            if (m_asyncQueue.empty())
+                break;
+            task = std::move(m_asyncQueue.front());
+            m_asyncQueue.pop_front();
+        }
+
+        try
+        {
+            Detect(task.first);
+            regions_t res;
+            TakeDetects(res);
+            task.second.set_value(std::move(res));
+        }
+        catch (...)
+        {
+            task.second.set_exception(std::current_exception());
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_asyncMutex);
+            --m_asyncInFlight;
+        }
+        m_asyncFreeCond.notify_one();
+    }
+}
+
+///
+/// \brief BaseDetector::StopAsync
+///
+void BaseDetector::StopAsync()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_asyncMutex);
+        m_asyncStop = true;
+    }
+    m_asyncCond.notify_all();
+    if (m_asyncThread.joinable())
+        m_asyncThread.join();
+}
+
+///
+/// \brief BaseDetector::ReadClassesFilter
+/// \param config
+///
+void BaseDetector::ReadClassesFilter(const config_t& config)
+{
+	m_classesWhiteList.clear();
+	auto whiteRange = config.equal_range("white_list");
+	for (auto it = whiteRange.first; it != whiteRange.second; ++it)
+	{
+		m_classesWhiteList.insert(std::stoi(it->second));
+	}
+
+	m_classesThresholds.clear();
+	auto thresholdsRange = config.equal_range("class_threshold");
+	for (auto it = thresholdsRange.first; it != thresholdsRange.second; ++it)
+	{
+		const std::string& value = it->second;
+		const size_t pos = value.find(':');
+		if (pos == std::string::npos || pos == 0)
+		{
+			std::cerr << "Wrong class_threshold " << value << ", it must be type:confidence" << std::endl;
+			continue;
+		}
+		const std::string typeName = value.substr(0, pos);
+		const objtype_t type = std::isdigit(static_cast<unsigned char>(typeName[0])) ? std::stoi(typeName) : TypeConverter::Str2Type(typeName);
+		m_classesThresholds[type] = std::stof(value.substr(pos + 1));
+	}
+
+	auto topK = config.find("top_k");
+	if (topK != config.end())
+		m_topK = static_cast<size_t>(std::max(0, std::stoi(topK->second)));
+}
+
+///
+/// \brief BaseDetector::UpdateNetClassesThresholds
+/// \param defThreshold
+///
+void BaseDetector::UpdateNetClassesThresholds(float defThreshold)
+{
+	auto TypeThreshold = [&](objtype_t type)
+	{
+		if (!m_classesWhiteList.empty() && m_classesWhiteList.find(type) == std::end(m_classesWhiteList))
+			return DisabledClassThreshold;
+		auto it = m_classesThresholds.find(type);
+		return (it != std::end(m_classesThresholds)) ? it->second : defThreshold;
+	};
+
+	m_netOtherThreshold = TypeThreshold(bad_type);
+	m_netMinThreshold = m_netOtherThreshold;
+	m_netClassesThresholds.clear();
+	if (m_classesWhiteList.empty() && m_classesThresholds.empty())
+	{
+		m_netMinThreshold = defThreshold;
+		return;
+	}
+	m_netClassesThresholds.resize(m_typesMap.size());
+	for (size_t i = 0; i < m_typesMap.size(); ++i)
+	{
+		m_netClassesThresholds[i] = TypeThreshold(m_typesMap[i]);
+		m_netMinThreshold = std::min(m_netMinThreshold, m_netClassesThresholds[i]);
+	}
+}
+
+///
+/// \brief InitDetector
+/// \param detector
+/// \param config
+/// \return The detector or nullptr if it wasn't created or initialized
+///
+static std::unique_ptr<BaseDetector> InitDetector(std::unique_ptr<BaseDetector> detector, const config_t& config)
+{
+    if (!detector || !detector->Init(config))
+    {
+        detector.reset();
+    }
+    else
+    {
+        auto maxInFlight = config.find("maxInFlight");
+        if (maxInFlight != config.end())
+            detector->SetMaxInFlight(std::stoi(maxInFlight->second));
+        auto motionMap = config.find("motionMap");
+        if (motionMap != config.end())
+            detector->SetMotionMapEnabled(std::stoi(motionMap->second) != 0);
+        detector->InitTilesGate(config);
+        detector->InitCropsMosaic(config);
+        detector->InitDetectionMask(config);
+        detector->InitAdaptiveInput(config);
+    }
+    return detector;
+}
+
 ///
 /// \brief CreateDetector
 /// \param detectorType
@@ -24,6 +272,15 @@ std::unique_ptr<BaseDetector> CreateDetector(
 {
     std::unique_ptr<BaseDetector> detector;
 
+    // The swapped detector is created by the wrapper with the same config without "hotSwap"
+    auto hotSwap = config.find("hotSwap");
+    if (hotSwap != config.end() && std::stoi(hotSwap->second) != 0)
+        return InitDetector(std::make_unique<HotSwapDetector>(detectorType, frame), config);
+
+    // detectorType is the first tier of the cascade, the cascade creates the tiers by their configs
+    if (config.find("cascadeDetector") != config.end())
+        return InitDetector(std::make_unique<CascadeDetector>(detectorType, frame), config);
+
     switch (detectorType)
     {
     case tracking::Motion_VIBE:
@@ -69,7 +326,10 @@ std::unique_ptr<BaseDetector> CreateDetector(
 
 	case tracking::Yolo_Darknet:
 #ifdef BUILD_YOLO_LIB
-        detector = std::make_unique<YoloDarknetDetector>(frame);
+        if (config.find("gpuIds") != config.end())
+            detector = std::make_unique<MultiGpuDetector>(detectorType, frame);
+        else
+            detector = std::make_unique<YoloDarknetDetector>(frame);
 #else
 		std::cerr << "Darknet inference engine was not configured in CMake" << std::endl;
 #endif
@@ -77,7 +337,10 @@ std::unique_ptr<BaseDetector> CreateDetector(
 
 	case tracking::Yolo_TensorRT:
 #ifdef BUILD_YOLO_TENSORRT
-		detector = std::make_unique<YoloTensorRTDetector>(frame);
+		if (config.find("gpuIds") != config.end())
+			detector = std::make_unique<MultiGpuDetector>(detectorType, frame);
+		else
+			detector = std::make_unique<YoloTensorRTDetector>(frame);
 #else
 		std::cerr << "TensorRT inference engine was not configured in CMake" << std::endl;
 #endif
@@ -86,8 +349,25 @@ std::unique_ptr<BaseDetector> CreateDetector(
     default:
         break;
     }
+    return InitDetector(std::move(detector), config);
+}
 
-    if (!detector->Init(config))
-        detector.reset();
-    return std::move(detector);
+///
+/// \brief PrefetchDetector
+/// \param detectorType
+/// \param config
+///
+void PrefetchDetector(tracking::Detectors detectorType, const config_t& config)
+{
+    switch (detectorType)
+    {
+    case tracking::Yolo_TensorRT:
+#ifdef BUILD_YOLO_TENSORRT
+        YoloTensorRTDetector::Prefetch(config);
+#endif
+        break;
+
+    default:
+        break;
+    }
 }
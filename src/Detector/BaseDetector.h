@@ -1,7 +1,57 @@
 #pragma once
 
 #include <memory>
+#include <deque>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 #include "defines.h"
+#include "metrics.h"
+#include "execution_policy.h"
+#include "TilesMotionGate.h"
+#include "AdaptiveInput.h"
+#include "CropsMosaic.h"
+#include "DetectionMask.h"
+
+///
+/// \brief The DeviceFrame struct
+/// Frame in the CUDA device memory, for example cv::cuda::GpuMat of the hardware decoder.
+/// The raw pointer keeps the detectors library independent of the OpenCV CUDA modules
+///
+struct DeviceFrame
+{
+    const uint8_t* m_data = nullptr;
+    int m_width = 0;
+    int m_height = 0;
+    int m_channels = 3;       // BGR or BGRA
+    size_t m_pitch = 0;       // Bytes of the row
+    void* m_stream = nullptr; // cudaStream_t of the frame producer
+
+    ///
+    bool empty() const
+    {
+        return !m_data || m_width <= 0 || m_height <= 0;
+    }
+    ///
+    cv::Size size() const
+    {
+        return cv::Size(m_width, m_height);
+    }
+};
+
+///
+/// \brief The DetectStages struct
+/// Cumulative time of the Detect stages since the creation of the detector, seconds: the preparation of the network inputs
+/// (crops, resize, blob) and the network calls. The rest of Detect is the postprocessing: decoding, merging of the crops, NMS.
+/// The difference of two reads is the time of the calls between them, the detectors without the network have zeros
+///
+struct DetectStages
+{
+    double m_preprocess = 0;
+    double m_inference = 0;
+};
 
 ///
 /// \brief The BaseDetector class
@@ -20,8 +70,12 @@ public:
     }
     ///
     /// \brief ~BaseDetector
+    /// Derived detectors call StopAsync in their destructors: the worker thread uses their Detect
     ///
-    virtual ~BaseDetector(void) = default;
+    virtual ~BaseDetector(void)
+    {
+        StopAsync();
+    }
 
     ///
     /// \brief Init
@@ -37,19 +91,152 @@ public:
 
     ///
     /// \brief Detect
+    /// The detections are written to the buffers of the caller, see TakeDetects
     /// \param frames
-    /// \param regions
+    /// \param regions - resized to the frames count, the caller reuses them for the next frames
     ///
     virtual void Detect(const std::vector<cv::UMat>& frames, std::vector<regions_t>& regions)
     {
+        regions.resize(frames.size());
         for (size_t i = 0; i < frames.size(); ++i)
         {
             Detect(frames[i]);
-            auto res = GetDetects();
-            regions[i].assign(std::begin(res), std::end(res));
+            TakeDetects(regions[i]);
         }
     }
 
+    ///
+    /// \brief DetectStreams
+    /// The batch of the frames of the different streams: the detectors with the state of the stream (the background models)
+    /// keep it for the every stream, the others detect the batch by Detect(frames, regions)
+    /// \param streamIds - stream of the every frame, the frames of one stream are in their order
+    /// \param frames
+    /// \param regions
+    ///
+    virtual void DetectStreams(const std::vector<size_t>& /*streamIds*/, const std::vector<cv::UMat>& frames, std::vector<regions_t>& regions)
+    {
+        Detect(frames, regions);
+    }
+
+    ///
+    /// \brief DetectDevice
+    /// Detection of the frame in the device memory: only the regions are copied to the host, GetDetects returns them
+    /// \param frame
+    /// \return false if the detector hasn't the device path, the caller detects on the host copy of the frame
+    ///
+    virtual bool DetectDevice(const DeviceFrame& /*frame*/)
+    {
+        return false;
+    }
+
+    ///
+    /// \brief CanDeviceProcessing
+    /// \return true if DetectDevice is supported by the detector with the current config
+    ///
+    virtual bool CanDeviceProcessing() const
+    {
+        return false;
+    }
+
+    ///
+    /// \brief MaxBatchSize
+    /// \return Frames count in one call of Detect(frames, regions) that the detector runs together
+    ///
+    virtual size_t MaxBatchSize() const
+    {
+        return 1;
+    }
+
+    ///
+    /// \brief DetectAsync
+    /// Detection of the frame without the waiting for the result: the frames are processed in the order of the calls
+    /// by the worker thread of the detector, the call blocks only if MaxInFlight frames are already not ready.
+    /// Detect and GetDetects of the same detector must not be used while the futures aren't ready
+    /// \param frame - isn't copied, the caller doesn't change it until the future is ready
+    /// \return Regions of the frame
+    ///
+    virtual std::future<regions_t> DetectAsync(const cv::UMat& frame);
+
+    ///
+    /// \brief SetMaxInFlight
+    /// \param maxInFlight - count of the frames in DetectAsync which results aren't ready, at least 1
+    ///
+    void SetMaxInFlight(size_t maxInFlight)
+    {
+        std::lock_guard<std::mutex> lock(m_asyncMutex);
+        m_maxInFlight = std::max<size_t>(1, maxInFlight);
+        m_asyncFreeCond.notify_all();
+    }
+    ///
+    size_t MaxInFlight() const
+    {
+        std::lock_guard<std::mutex> lock(m_asyncMutex);
+        return m_maxInFlight;
+    }
+
+    ///
+    /// \brief InitTilesGate
+    /// Detectors with the crops detect only the crops with the motion or the tracked objects, with the cache only the changed crops
+    /// \param config
+    ///
+    bool InitTilesGate(const config_t& config)
+    {
+        return m_tilesGate.Init(config);
+    }
+    ///
+    /// \brief InitCropsMosaic
+    /// Detectors with the crops pack the small crops into the canvases of the network input size
+    /// \param config
+    ///
+    bool InitCropsMosaic(const config_t& config)
+    {
+        return m_cropsMosaic.Init(config);
+    }
+    ///
+    /// \brief InitDetectionMask
+    /// The masked pixels aren't detected
+    /// \param config
+    ///
+    bool InitDetectionMask(const config_t& config)
+    {
+        return m_detectionMask.Init(config);
+    }
+    ///
+    /// \brief InitAdaptiveInput
+    /// Detectors with the network choose the input size and the crops by the sizes of the tracked objects
+    /// \param config
+    ///
+    bool InitAdaptiveInput(const config_t& config)
+    {
+        return m_adaptiveInput.Init(config);
+    }
+    ///
+    /// \brief SetTrackedRects
+    /// \param rects - tracked objects on the last frame
+    ///
+    virtual void SetTrackedRects(const std::vector<cv::Rect>& rects)
+    {
+        m_tilesGate.SetTrackedRects(rects);
+        m_adaptiveInput.Observe(rects);
+    }
+
+    ///
+    /// \brief SwapModel
+    /// Hot swap of the model without the break of the detection, see HotSwapDetector
+    /// \param config - of the new model
+    /// \return false if the detector doesn't support the swap or the swap wasn't started
+    ///
+    virtual bool SwapModel(const config_t& /*config*/)
+    {
+        return false;
+    }
+
+    ///
+    /// \brief StopAsync
+    /// Waits for the queued frames of DetectAsync and stops the worker thread
+    ///
+    void StopAsync();
+
 	///
 	/// \brief ResetModel
 	/// \param img
@@ -75,7 +262,7 @@ public:
 
     ///
     /// \brief GetDetects
-    /// \return
+    /// \return Detections of the last Detect(frame), after Detect(frames, regions) and TakeDetects only with the motion map
     ///
     const regions_t& GetDetects() const
     {
@@ -83,63 +270,193 @@ public:
     }
 
     ///
-    /// \brief CalcMotionMap
-    /// \param frame
+    /// \brief TakeDetects
+    /// The detections of the last Detect are swapped to the buffer of the caller without the copy: the old content of regions
+    /// is dropped and its capacity is used by the next Detect. With the motion map they are copied, CalcMotionMap draws them
+    /// \param regions
     ///
-    virtual void CalcMotionMap(cv::Mat& frame)
+    void TakeDetects(regions_t& regions)
     {
-        if (m_motionMap.size() != frame.size())
-            m_motionMap = cv::Mat(frame.size(), CV_32FC1, cv::Scalar(0, 0, 0));
-
-        cv::Mat foreground(m_motionMap.size(), CV_8UC1, cv::Scalar(0, 0, 0));
-        for (const auto& region : m_regions)
+        if (m_motionMapEnabled)
         {
-#if (CV_VERSION_MAJOR < 4)
-            cv::ellipse(foreground, region.m_rrect, cv::Scalar(255, 255, 255), CV_FILLED);
-#else
-            cv::ellipse(foreground, region.m_rrect, cv::Scalar(255, 255, 255), cv::FILLED);
-#endif
+            regions.assign(std::begin(m_regions), std::end(m_regions));
         }
+        else
+        {
+            regions.swap(m_regions);
+            m_regions.clear();
+        }
+    }
 
-        cv::normalize(foreground, m_normFor, 255, 0, cv::NORM_MINMAX, m_motionMap.type());
-
-        double alpha = 0.95;
-        cv::addWeighted(m_motionMap, alpha, m_normFor, 1 - alpha, 0, m_motionMap);
+    ///
+    /// \brief CalcMotionMap
+    /// \param frame
+    ///
+    virtual void CalcMotionMap(cv::Mat& frame);
 
-        const int chans = frame.channels();
-		const int height = frame.rows;
-#pragma omp parallel for
-        for (int y = 0; y < height; ++y)
+    ///
+    /// \brief SetMotionMapEnabled
+    /// \param enabled - if false then CalcMotionMap doesn't change the frame and the map buffers are released
+    ///
+    void SetMotionMapEnabled(bool enabled)
+    {
+        m_motionMapEnabled = enabled;
+        if (!enabled)
         {
-            uchar* imgPtr = frame.ptr(y);
-            const float* moPtr = reinterpret_cast<float*>(m_motionMap.ptr(y));
-            for (int x = 0; x < frame.cols; ++x)
-            {
-                for (int ci = chans - 1; ci < chans; ++ci)
-                {
-                    imgPtr[ci] = cv::saturate_cast<uchar>(imgPtr[ci] + moPtr[0]);
-                }
-                imgPtr += chans;
-                ++moPtr;
-            }
+            m_motionMap.release();
+            m_normFor.release();
+            m_motionForeground.release();
         }
     }
+    ///
+    bool MotionMapEnabled() const
+    {
+        return m_motionMapEnabled;
+    }
+
+    ///
+    /// \brief Stages
+    /// \return Cumulative time of the Detect stages
+    ///
+    const DetectStages& Stages() const
+    {
+        return m_stages;
+    }
 
 protected:
     regions_t m_regions;
 
+    ///
+    /// \brief KeepLastDetects
+    /// The batch detection keeps the last frame detections for CalcMotionMap only
+    /// \param regions
+    ///
+    void KeepLastDetects(const std::vector<regions_t>& regions)
+    {
+        if (m_motionMapEnabled && !regions.empty())
+            m_regions.assign(std::begin(regions.back()), std::end(regions.back()));
+        else
+            m_regions.clear();
+    }
+
     cv::Size m_minObjectSize;
 
 	// Motion map for visualization current detections
+    bool m_motionMapEnabled = true;
     cv::Mat m_motionMap;
 	cv::Mat m_normFor;
+    cv::Mat m_motionForeground;
+
+    void BlendMotionMap(cv::Mat& frame, const cv::Mat& foreground);
 
 	std::set<objtype_t> m_classesWhiteList;
+	std::map<objtype_t, float> m_classesThresholds; // Confidence thresholds of the types instead of the detector threshold
+	size_t m_topK = 0;                              // Maximum candidates of the crop or the image before NMS, 0 - without limit
+
+	///
+	/// \brief ReadClassesFilter
+	/// Reads white_list (types), class_threshold ("type:confidence", the type is a number or a name) and top_k
+	/// \param config
+	///
+	void ReadClassesFilter(const config_t& config);
+
+	///
+	/// \brief UpdateNetClassesThresholds
+	/// Thresholds of the network classes for the decoding, it's called after FillTypesMap and ReadClassesFilter
+	/// \param defThreshold - confidence threshold of the detector
+	///
+	void UpdateNetClassesThresholds(float defThreshold);
 
-    std::vector<cv::Rect> GetCrops(float maxCropRatio, cv::Size netSize, cv::Size imgSize) const
+	///
+	/// \brief NetClassThreshold
+	/// \param classInd - class of the network output
+	/// \return Confidence threshold of the class, classes out of the white list have DisabledClassThreshold
+	///
+	float NetClassThreshold(size_t classInd) const
+	{
+		if (classInd < m_netClassesThresholds.size())
+			return m_netClassesThresholds[classInd];
+		else
+			return m_netOtherThreshold;
+	}
+	///
+	/// \brief NetMinThreshold
+	/// \return Minimal threshold of the enabled classes: the candidates with the lower objectness are skipped without the classes
+	///
+	float NetMinThreshold() const
+	{
+		return m_netMinThreshold;
+	}
+	///
+	/// \brief NetClassesThresholds
+	/// \return Thresholds of the every class of the network or empty if all classes have the detector threshold
+	///
+	const std::vector<float>& NetClassesThresholds() const
+	{
+		return m_netClassesThresholds;
+	}
+
+	static constexpr float DisabledClassThreshold = 2.f; // Over any confidence
+
+    TilesMotionGate m_tilesGate;
+    AdaptiveInput m_adaptiveInput;
+    CropsMosaic m_cropsMosaic;
+    DetectionMask m_detectionMask;
+
+    DetectStages m_stages;
+
+    ///
+    /// \brief The StageTimer class
+    /// Adds the time from the construction to Stop or to the end of the scope to the stage of m_stages
+    ///
+    class StageTimer
+    {
+    public:
+        explicit StageTimer(double& stage)
+            : m_stage(&stage), m_start(std::chrono::steady_clock::now())
+        {
+        }
+        ~StageTimer()
+        {
+            Stop();
+        }
+        void Stop()
+        {
+            if (m_stage)
+                *m_stage += std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+            m_stage = nullptr;
+        }
+
+    private:
+        double* m_stage = nullptr;
+        std::chrono::steady_clock::time_point m_start;
+    };
+
+    ///
+    /// \brief DetectHistogram
+    /// Time of the Detect calls of the detectors with the name, it's cached by the callers in the static references
+    /// \param detector - label of the metric
+    /// \param batch - Detect(frames, regions), it includes the single frame calls inside
+    ///
+    static metrics::Histogram& DetectHistogram(const std::string& detector, bool batch)
+    {
+        return metrics::Registry::Instance().GetHistogram(std::string(batch ? "mtracker_detect_batch_seconds" : "mtracker_detect_seconds") + "{detector=\"" + detector + "\"}",
+                                                          batch ? "Time of the batch detection" : "Time of the one frame detection");
+    }
+
+    ///
+    /// \brief GetCrops
+    /// The crops cover the bounding rect of the detection mask, the fully masked crops are dropped
+    ///
+    std::vector<cv::Rect> GetCrops(float maxCropRatio, cv::Size netSize, cv::Size frameSize) const
     {
         std::vector<cv::Rect> crops;
 
+        const cv::Rect area = m_detectionMask.BoundingRect(frameSize);
+        if (area.empty())
+            return crops;
+        const cv::Size imgSize = area.size();
+
         const float whRatio = static_cast<float>(netSize.width) / static_cast<float>(netSize.height);
         int cropHeight = cvRound(maxCropRatio * netSize.height);
         int cropWidth = cvRound(maxCropRatio * netSize.width);
@@ -177,7 +494,9 @@ protected:
                     x = imgSize.width - cropWidth;
                     needBreakX = true;
                 }
-                crops.emplace_back(x, y, cropWidth, cropHeight);
+                cv::Rect crop(area.x + x, area.y + y, cropWidth, cropHeight);
+                if (m_detectionMask.IsActive(crop, frameSize))
+                    crops.emplace_back(crop);
                 if (needBreakX)
                     break;
             }
@@ -213,6 +532,22 @@ protected:
 
 private:
     std::vector<objtype_t> m_typesMap;
+
+    std::vector<float> m_netClassesThresholds;
+    float m_netOtherThreshold = 0.f; // Classes out of the types map
+    float m_netMinThreshold = 0.f;
+
+    // Worker of DetectAsync
+    std::thread m_asyncThread;
+    mutable std::mutex m_asyncMutex;
+    std::condition_variable m_asyncCond;
+    std::condition_variable m_asyncFreeCond;
+    std::deque<std::pair<cv::UMat, std::promise<regions_t>>> m_asyncQueue;
+    size_t m_maxInFlight = 2;
+    size_t m_asyncInFlight = 0;
+    bool m_asyncStop = false;
+
+    void AsyncWorker();
 };
 
 
@@ -223,3 +558,11 @@ private:
 /// \return
 ///
 std::unique_ptr<BaseDetector> CreateDetector(tracking::Detectors detectorType, const config_t& config, cv::UMat& gray);
+
+///
+/// \brief PrefetchDetector
+/// Starts the loading of the model in the background, CreateDetector with the same config uses it
+/// \param detectorType
+/// \param config
+///
+void PrefetchDetector(tracking::Detectors detectorType, const config_t& config);
@@ -0,0 +1,220 @@
+#include <iostream>
+#include <algorithm>
+#include <numeric>
+#include "BatchDetectionService.h"
+
+///
+/// \brief BatchDetectionService::BatchDetectionService
+/// \param detector
+/// \param maxWait
+/// \param maxQueued
+/// \param workerInit
+///
+BatchDetectionService::BatchDetectionService(std::unique_ptr<BaseDetector> detector, std::chrono::milliseconds maxWait, size_t maxQueued, std::function<void()> workerInit)
+    : m_detector(std::move(detector)), m_maxWait(maxWait), m_workerInit(std::move(workerInit))
+{
+    if (m_detector)
+        m_maxBatch = std::max<size_t>(1, m_detector->MaxBatchSize());
+    else
+        std::cerr << "BatchDetectionService: empty detector" << std::endl;
+    m_maxQueued = (maxQueued > 0) ? std::max(maxQueued, m_maxBatch) : 2 * m_maxBatch;
+
+    m_thread = std::thread(&BatchDetectionService::Worker, this);
+}
+
+///
+/// \brief BatchDetectionService::~BatchDetectionService
+///
+BatchDetectionService::~BatchDetectionService()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cond.notify_all();
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+///
+/// \brief BatchDetectionService::Push
+/// \param streamId
+/// \param frame
+/// \return
+///
+std::future<regions_t> BatchDetectionService::Push(size_t streamId, const cv::UMat& frame)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_freeCond.wait(lock, [this]() { return m_inFlight < m_maxQueued; });
+
+    ++m_inFlight;
+    m_queue.emplace_back();
+    Task& task = m_queue.back();
+    task.m_streamId = streamId;
+    task.m_frame = frame;
+    task.m_time = std::chrono::steady_clock::now();
+
+    // Start and finish tags of the fair queuing: the stream with the larger weight advances slower
+    StreamState& stream = m_streams[streamId];
+    task.m_start = std::max(m_virtualTime, stream.m_lastFinish);
+    task.m_finish = task.m_start + 1. / std::max(1e-3, stream.m_qos.m_weight);
+    stream.m_lastFinish = task.m_finish;
+    task.m_deadline = (stream.m_qos.m_deadline.count() > 0) ? (task.m_time + stream.m_qos.m_deadline) : std::chrono::steady_clock::time_point::max();
+
+    std::future<regions_t> res = task.m_result.get_future();
+
+    const bool needNotify = (m_queue.size() == 1) || (m_queue.size() >= m_maxBatch);
+    lock.unlock();
+    if (needNotify)
+        m_cond.notify_one();
+    return res;
+}
+
+///
+/// \brief BatchDetectionService::SetStreamQoS
+/// \param streamId
+/// \param qos
+///
+void BatchDetectionService::SetStreamQoS(size_t streamId, const StreamQoS& qos)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_streams[streamId].m_qos = qos;
+}
+
+///
+/// \brief BatchDetectionService::GetStat
+/// \return
+///
+BatchDetectionService::Stat BatchDetectionService::GetStat() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stat;
+}
+
+///
+/// \brief BatchDetectionService::Worker
+///
+void BatchDetectionService::Worker()
+{
+    if (m_workerInit)
+        m_workerInit();
+
+    std::vector<Task> batch;
+    batch.reserve(m_maxBatch);
+    std::vector<cv::UMat> frames;
+    frames.reserve(m_maxBatch);
+    std::vector<size_t> streamIds;
+    streamIds.reserve(m_maxBatch);
+    std::vector<regions_t> regions;
+    std::vector<char> taken;
+    std::vector<size_t> order;
+
+    for (;;)
+    {
+        bool timeout = false;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cond.wait(lock, [this]() { return m_stop || !m_queue.empty(); });
+            if (m_queue.empty())
+                break;
+
+            // Waiting for the full batch until the oldest frame waits maxWait or the detection of the nearest deadline has to start,
+            // the stop flushes the queue
+            auto deadline = m_queue.front().m_time + m_maxWait;
+            for (const auto& task : m_queue)
+            {
+                if (task.m_deadline != std::chrono::steady_clock::time_point::max())
+                    deadline = std::min(deadline, task.m_deadline - m_batchTime);
+            }
+            if (!m_cond.wait_until(lock, deadline, [this]() { return m_stop || m_queue.size() >= m_maxBatch; }))
+                timeout = true;
+
+            // The frames with the deadlines before the next batch go first by the earliest deadline, then the others by the finish tags.
+            // The tags and the deadlines grow with the frames of one stream, so the frames of one stream are taken in the order of Push
+            const auto now = std::chrono::steady_clock::now();
+            const auto urgentTime = now + m_batchTime + m_maxWait;
+            order.resize(m_queue.size());
+            std::iota(std::begin(order), std::end(order), 0);
+            std::sort(std::begin(order), std::end(order), [&](size_t i1, size_t i2)
+            {
+                const Task& t1 = m_queue[i1];
+                const Task& t2 = m_queue[i2];
+                const bool urgent1 = t1.m_deadline <= urgentTime;
+                const bool urgent2 = t2.m_deadline <= urgentTime;
+                if (urgent1 != urgent2)
+                    return urgent1;
+                if (urgent1 && t1.m_deadline != t2.m_deadline)
+                    return t1.m_deadline < t2.m_deadline;
+                if (t1.m_finish != t2.m_finish)
+                    return t1.m_finish < t2.m_finish;
+                return i1 < i2;
+            });
+            const size_t batchSize = std::min(m_maxBatch, m_queue.size());
+            taken.assign(m_queue.size(), 0);
+            size_t deadlineMisses = 0;
+            for (size_t k = 0; k < batchSize; ++k)
+            {
+                const Task& task = m_queue[order[k]];
+                taken[order[k]] = 1;
+                m_virtualTime = std::max(m_virtualTime, task.m_start);
+                if (task.m_deadline < now + m_batchTime)
+                    ++deadlineMisses;
+            }
+            m_stat.m_deadlineMisses += deadlineMisses;
+            m_contended.store(deadlineMisses > 0 || m_queue.size() > batchSize, std::memory_order_relaxed);
+
+            // Frames of one stream are taken in the order of Push
+            batch.clear();
+            size_t keep = 0;
+            for (size_t i = 0; i < m_queue.size(); ++i)
+            {
+                if (taken[i])
+                    batch.emplace_back(std::move(m_queue[i]));
+                else
+                    m_queue[keep++] = std::move(m_queue[i]);
+            }
+            m_queue.resize(keep);
+        }
+
+        frames.clear();
+        streamIds.clear();
+        for (const auto& task : batch)
+        {
+            frames.emplace_back(task.m_frame);
+            streamIds.push_back(task.m_streamId);
+        }
+        regions.assign(batch.size(), regions_t());
+
+        std::exception_ptr error;
+        const auto batchStart = std::chrono::steady_clock::now();
+        try
+        {
+            if (!m_detector)
+                throw std::runtime_error("BatchDetectionService: empty detector");
+            m_detector->DetectStreams(streamIds, frames, regions);
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+        const auto batchTime = std::chrono::steady_clock::now() - batchStart;
+        for (size_t i = 0; i < batch.size(); ++i)
+        {
+            if (error)
+                batch[i].m_result.set_exception(error);
+            else
+                batch[i].m_result.set_value(std::move(regions[i]));
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_inFlight -= batch.size();
+            m_batchTime = (3 * m_batchTime + batchTime) / 4;
+            ++m_stat.m_batches;
+            m_stat.m_frames += batch.size();
+            if (timeout && batch.size() < m_maxBatch)
+                ++m_stat.m_timeoutBatches;
+        }
+        m_freeCond.notify_all();
+    }
+}
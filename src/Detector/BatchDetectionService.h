@@ -0,0 +1,135 @@
+#pragma once
+
+#include <chrono>
+#include <atomic>
+#include <functional>
+#include <unordered_map>
+#include "BaseDetector.h"
+
+///
+/// \brief The BatchDetectionService class
+/// One detector for the frames of many streams: the worker thread packs the queued frames of all streams into the batches
+/// up to MaxBatchSize of the detector and runs them by one call of DetectStreams(streamIds, frames, regions).
+/// Not full batch is started when its oldest frame waits maxWait or the deadline of a frame is near.
+/// The batches are filled by the weighted fair queuing of the streams: the frames with the near deadlines go first, then
+/// the frames with the least virtual finish time, so the stream with the weight 2 gets the twice more frames under the contention.
+/// The results are returned to the every stream by the futures in the order of its frames
+///
+class BatchDetectionService
+{
+public:
+    ///
+    /// \brief BatchDetectionService
+    /// \param detector - initialized detector, it is used only by the service
+    /// \param maxWait - the longest waiting of the frame for the full batch
+    /// \param maxQueued - Push blocks if so many frames aren't detected, 0 means two batches
+    /// \param workerInit - nullptr or the initialization of the worker thread (the affinity) before the first batch
+    ///
+    BatchDetectionService(std::unique_ptr<BaseDetector> detector, std::chrono::milliseconds maxWait, size_t maxQueued = 0, std::function<void()> workerInit = nullptr);
+    ///
+    /// \brief ~BatchDetectionService
+    /// Queued frames are detected before the stop
+    ///
+    ~BatchDetectionService();
+
+    BatchDetectionService(const BatchDetectionService&) = delete;
+    BatchDetectionService& operator=(const BatchDetectionService&) = delete;
+
+    ///
+    /// \brief Push
+    /// \param streamId - camera of the frame
+    /// \param frame - isn't copied, the caller doesn't change it until the future is ready
+    /// \return Regions of the frame
+    ///
+    std::future<regions_t> Push(size_t streamId, const cv::UMat& frame);
+
+    ///
+    /// \brief The StreamQoS struct
+    ///
+    struct StreamQoS
+    {
+        double m_weight = 1.;                       // Share of the detector under the contention
+        std::chrono::milliseconds m_deadline{ 0 };  // Target latency of the frame detection, 0 - without the deadline
+    };
+    ///
+    /// \brief SetStreamQoS
+    /// It's applied to the next frames of the stream
+    /// \param streamId
+    /// \param qos
+    ///
+    void SetStreamQoS(size_t streamId, const StreamQoS& qos);
+
+    ///
+    /// \brief Contended
+    /// \return true if the last batch was full and the frames left in the queue or a deadline was missed:
+    /// the low priority streams can reduce their load
+    ///
+    bool Contended() const
+    {
+        return m_contended.load(std::memory_order_relaxed);
+    }
+
+    ///
+    /// \brief The Stat struct
+    ///
+    struct Stat
+    {
+        size_t m_batches = 0;       // Detector calls
+        size_t m_frames = 0;        // Detected frames
+        size_t m_timeoutBatches = 0; // Batches started by maxWait before they are full
+        size_t m_deadlineMisses = 0; // Frames which are detected after their deadline by the smoothed batch time
+    };
+    ///
+    Stat GetStat() const;
+
+    ///
+    size_t MaxBatchSize() const
+    {
+        return m_maxBatch;
+    }
+
+private:
+    std::unique_ptr<BaseDetector> m_detector;
+    size_t m_maxBatch = 1;
+    std::chrono::milliseconds m_maxWait;
+    size_t m_maxQueued = 2;
+    std::function<void()> m_workerInit;
+
+    ///
+    /// \brief The Task struct
+    ///
+    struct Task
+    {
+        size_t m_streamId = 0;
+        cv::UMat m_frame;
+        std::promise<regions_t> m_result;
+        std::chrono::steady_clock::time_point m_time;
+        std::chrono::steady_clock::time_point m_deadline; // max() without the deadline
+        double m_start = 0;   // Virtual time of the fair queuing
+        double m_finish = 0;
+    };
+
+    ///
+    /// \brief The StreamState struct
+    ///
+    struct StreamState
+    {
+        StreamQoS m_qos;
+        double m_lastFinish = 0;
+    };
+    std::unordered_map<size_t, StreamState> m_streams;
+    double m_virtualTime = 0;
+    std::chrono::steady_clock::duration m_batchTime{ 0 }; // Smoothed duration of the detection of the batch
+    std::atomic<bool> m_contended{ false };
+
+    std::thread m_thread;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cond;
+    std::condition_variable m_freeCond;
+    std::deque<Task> m_queue;
+    size_t m_inFlight = 0;
+    bool m_stop = false;
+    Stat m_stat;
+
+    void Worker();
+};
@@ -0,0 +1,252 @@
+#include <cctype>
+#include <algorithm>
+#include <iostream>
+#include "CascadeDetector.h"
+
+///
+/// \brief CascadeDetector::CascadeDetector
+/// \param firstTierType
+/// \param colorFrame
+///
+CascadeDetector::CascadeDetector(tracking::Detectors firstTierType, const cv::UMat& colorFrame)
+    : BaseDetector(colorFrame), m_firstTierType(firstTierType), m_initFrame(colorFrame)
+{
+}
+
+///
+/// \brief CascadeDetector::~CascadeDetector
+///
+CascadeDetector::~CascadeDetector(void)
+{
+    StopAsync();
+}
+
+///
+/// \brief CascadeDetector::Init
+/// \param config
+/// \return
+///
+bool CascadeDetector::Init(const config_t& config)
+{
+    auto secondTierIt = config.find("cascadeDetector");
+    if (secondTierIt == config.end())
+    {
+        std::cerr << "CascadeDetector: empty cascadeDetector" << std::endl;
+        return false;
+    }
+    const int secondTierType = std::stoi(secondTierIt->second);
+    if (secondTierType < 0 || secondTierType >= tracking::DetectorsCount)
+    {
+        std::cerr << "CascadeDetector: wrong cascadeDetector " << secondTierIt->second << std::endl;
+        return false;
+    }
+
+    const std::string prefix = "cascade.";
+    config_t firstConfig;
+    config_t secondConfig;
+    m_refineClasses.clear();
+    for (const auto& kv : config)
+    {
+        if (kv.first.compare(0, prefix.size(), prefix) == 0)
+        {
+            secondConfig.emplace(kv.first.substr(prefix.size()), kv.second);
+        }
+        else if (kv.first == "cascadeClass")
+        {
+            const std::string& typeName = kv.second;
+            if (!typeName.empty())
+                m_refineClasses.insert(std::isdigit(static_cast<unsigned char>(typeName[0])) ? std::stoi(typeName) : TypeConverter::Str2Type(typeName));
+        }
+        else if (kv.first == "cascadeKeepProposals")
+        {
+            m_keepProposals = std::stoi(kv.second) != 0;
+        }
+        else if (kv.first == "cascadePadding")
+        {
+            m_padding = std::max(0.f, std::stof(kv.second));
+        }
+        else if (kv.first == "cascadeMinRoi")
+        {
+            m_minRoi = std::max(1, std::stoi(kv.second));
+        }
+        else if (kv.first == "cascadeFullFrameArea")
+        {
+            m_fullFrameArea = std::max(0.f, std::stof(kv.second));
+        }
+        else if (kv.first != "cascadeDetector")
+        {
+            firstConfig.emplace(kv.first, kv.second);
+        }
+    }
+
+    m_firstTier = CreateDetector(m_firstTierType, firstConfig, m_initFrame);
+    if (!m_firstTier)
+    {
+        std::cerr << "CascadeDetector: the first tier wasn't created" << std::endl;
+        return false;
+    }
+    m_secondTier = CreateDetector(static_cast<tracking::Detectors>(secondTierType), secondConfig, m_initFrame);
+    if (!m_secondTier)
+    {
+        std::cerr << "CascadeDetector: the second tier wasn't created" << std::endl;
+        m_firstTier.reset();
+        return false;
+    }
+    return true;
+}
+
+///
+/// \brief CascadeDetector::Detect
+/// \param frame
+///
+void CascadeDetector::Detect(const cv::UMat& frame)
+{
+    static metrics::Histogram& detectTime = DetectHistogram("cascade", false);
+    metrics::ScopedTimer timer(detectTime);
+
+    m_regions.clear();
+    m_rois.clear();
+    m_lastRoisCount = 0;
+
+    m_firstTier->Detect(frame);
+    const cv::Rect frameRect(0, 0, frame.cols, frame.rows);
+    for (const auto& proposal : m_firstTier->GetDetects())
+    {
+        if (!m_refineClasses.empty() && m_refineClasses.find(proposal.m_type) == std::end(m_refineClasses))
+        {
+            m_regions.push_back(proposal);
+            continue;
+        }
+        if (m_keepProposals)
+            m_regions.push_back(proposal);
+        AddRoi(proposal.m_brect, frameRect);
+    }
+
+    if (!m_rois.empty())
+    {
+        MergeRois(frameRect);
+
+        double roisArea = 0;
+        for (const auto& roi : m_rois)
+        {
+            roisArea += roi.area();
+        }
+        if (roisArea > m_fullFrameArea * frameRect.area())
+        {
+            m_lastRoisCount = 1;
+            m_secondTier->Detect(frame);
+            const regions_t& detects = m_secondTier->GetDetects();
+            m_regions.insert(std::end(m_regions), std::begin(detects), std::end(detects));
+        }
+        else
+        {
+            m_lastRoisCount = m_rois.size();
+            m_crops.resize(m_rois.size());
+            for (size_t i = 0; i < m_rois.size(); ++i)
+            {
+                m_crops[i] = frame(m_rois[i]);
+            }
+            m_cropsRegions.resize(m_crops.size());
+            m_secondTier->Detect(m_crops, m_cropsRegions);
+
+            for (size_t i = 0; i < m_rois.size(); ++i)
+            {
+                const cv::Point offset = m_rois[i].tl();
+                for (CRegion region : m_cropsRegions[i])
+                {
+                    region.m_brect += offset;
+                    region.m_rrect.center.x += offset.x;
+                    region.m_rrect.center.y += offset.y;
+                    m_regions.emplace_back(region);
+                }
+                m_cropsRegions[i].clear();
+            }
+            // The crops keep the frame until the next call otherwise
+            m_crops.clear();
+        }
+    }
+    UpdateStages();
+}
+
+///
+/// \brief CascadeDetector::AddRoi
+/// The proposal is expanded on m_padding of its size and at least to m_minRoi
+/// \param rect
+/// \param frameRect
+///
+void CascadeDetector::AddRoi(const cv::Rect& rect, const cv::Rect& frameRect)
+{
+    const int width = std::max(m_minRoi, cvRound(rect.width * (1.f + 2.f * m_padding)));
+    const int height = std::max(m_minRoi, cvRound(rect.height * (1.f + 2.f * m_padding)));
+    const cv::Point center(rect.x + rect.width / 2, rect.y + rect.height / 2);
+    const cv::Rect roi = cv::Rect(center.x - width / 2, center.y - height / 2, width, height) & frameRect;
+    if (!roi.empty())
+        m_rois.emplace_back(roi);
+}
+
+///
+/// \brief CascadeDetector::MergeRois
+/// The overlapped rects are replaced by their bounding rect until there are no intersections
+/// \param frameRect
+///
+void CascadeDetector::MergeRois(const cv::Rect& frameRect)
+{
+    for (bool merged = true; merged;)
+    {
+        merged = false;
+        for (size_t i = 0; i < m_rois.size(); ++i)
+        {
+            for (size_t j = i + 1; j < m_rois.size();)
+            {
+                if ((m_rois[i] & m_rois[j]).empty())
+                {
+                    ++j;
+                    continue;
+                }
+                m_rois[i] = (m_rois[i] | m_rois[j]) & frameRect;
+                m_rois[j] = m_rois.back();
+                m_rois.pop_back();
+                merged = true;
+            }
+        }
+    }
+}
+
+///
+/// \brief CascadeDetector::UpdateStages
+///
+void CascadeDetector::UpdateStages()
+{
+    const DetectStages& first = m_firstTier->Stages();
+    const DetectStages& second = m_secondTier->Stages();
+    m_stages.m_preprocess = first.m_preprocess + second.m_preprocess;
+    m_stages.m_inference = first.m_inference + second.m_inference;
+}
+
+///
+/// \brief CascadeDetector::SetTrackedRects
+/// \param rects
+///
+void CascadeDetector::SetTrackedRects(const std::vector<cv::Rect>& rects)
+{
+    m_firstTier->SetTrackedRects(rects);
+}
+
+///
+/// \brief CascadeDetector::ResetModel
+/// \param img
+/// \param roiRect
+///
+void CascadeDetector::ResetModel(const cv::UMat& img, const cv::Rect& roiRect)
+{
+    m_firstTier->ResetModel(img, roiRect);
+}
+
+///
+/// \brief CascadeDetector::CalcMotionMap
+/// \param frame
+///
+void CascadeDetector::CalcMotionMap(cv::Mat& frame)
+{
+    m_firstTier->CalcMotionMap(frame);
+}
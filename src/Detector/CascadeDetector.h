@@ -0,0 +1,70 @@
+#pragma once
+
+#include "BaseDetector.h"
+
+///
+/// \brief The CascadeDetector class
+/// Two tiers: the cheap detector (motion, tiny YOLO) on the every frame proposes the regions and the heavy detector
+/// (YOLO TensorRT, faces) detects only in the expanded rects of the proposals. The overlapped rects are merged, so the
+/// heavy detector gets one crop per group, and the crops go to it by one batch. If the crops cover the most of the frame
+/// then the heavy detector gets the whole frame. The proposals of the other types pass to the result as is.
+/// Config: "cascadeDetector" - type of the second tier, "cascade.<key>" - its config, the rest is the config of the first tier
+///
+class CascadeDetector final : public BaseDetector
+{
+public:
+    CascadeDetector(tracking::Detectors firstTierType, const cv::UMat& colorFrame);
+    ~CascadeDetector(void);
+
+    ///
+    /// \brief Init
+    /// \param config - cascadeDetector, cascade.<key>, cascadeClass (types of the refined proposals, the number or the name,
+    /// several keys, all types if there are no keys), cascadeKeepProposals (0 - the refined proposals are replaced by the
+    /// detections of the second tier, 1 - both are in the result), cascadePadding (expansion of the proposal on the part
+    /// of its size), cascadeMinRoi (min side of the crop in pixels), cascadeFullFrameArea (part of the frame area of the crops
+    /// for the detection on the whole frame)
+    ///
+    bool Init(const config_t& config);
+
+    void Detect(const cv::UMat& frame);
+
+    void SetTrackedRects(const std::vector<cv::Rect>& rects);
+    void ResetModel(const cv::UMat& img, const cv::Rect& roiRect);
+    void CalcMotionMap(cv::Mat& frame);
+
+    bool CanGrayProcessing() const
+    {
+        return m_firstTier && m_secondTier && m_firstTier->CanGrayProcessing() && m_secondTier->CanGrayProcessing();
+    }
+
+    ///
+    /// \brief RoisCount
+    /// \return Crops of the second tier on the last frame, 0 if it wasn't called, 1 for the whole frame
+    ///
+    size_t RoisCount() const
+    {
+        return m_lastRoisCount;
+    }
+
+private:
+    tracking::Detectors m_firstTierType;
+    cv::UMat m_initFrame;
+
+    std::unique_ptr<BaseDetector> m_firstTier;
+    std::unique_ptr<BaseDetector> m_secondTier;
+
+    std::set<objtype_t> m_refineClasses;
+    bool m_keepProposals = false;
+    float m_padding = 0.2f;
+    int m_minRoi = 32;
+    float m_fullFrameArea = 0.5f;
+
+    std::vector<cv::Rect> m_rois;
+    std::vector<cv::UMat> m_crops;
+    std::vector<regions_t> m_cropsRegions;
+    size_t m_lastRoisCount = 0;
+
+    void AddRoi(const cv::Rect& rect, const cv::Rect& frameRect);
+    void MergeRois(const cv::Rect& frameRect);
+    void UpdateStages();
+};
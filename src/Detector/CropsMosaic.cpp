@@ -0,0 +1,151 @@
+#include <algorithm>
+#include "CropsMosaic.h"
+
+///
+/// \brief CropsMosaic::Init
+/// \param config
+/// \return
+///
+bool CropsMosaic::Init(const config_t& config)
+{
+    auto cropsMosaic = config.find("cropsMosaic");
+    m_enabled = (cropsMosaic != config.end()) && (std::stoi(cropsMosaic->second) != 0);
+
+    auto cropsMosaicGap = config.find("cropsMosaicGap");
+    if (cropsMosaicGap != config.end())
+        m_gap = std::max(0, std::stoi(cropsMosaicGap->second));
+    return true;
+}
+
+///
+/// \brief CropsMosaic::Pack
+/// \param crops
+/// \param netSize
+/// \param canvases
+/// \param single
+///
+void CropsMosaic::Pack(const std::vector<cv::Size>& crops, cv::Size netSize, std::vector<Canvas>& canvases, std::vector<size_t>& single) const
+{
+    canvases.clear();
+    single.clear();
+
+    struct Shelf
+    {
+        int m_y = 0;
+        int m_height = 0;
+        int m_x = 0;
+    };
+    struct Bin
+    {
+        std::vector<Shelf> m_shelves;
+        int m_nextY = 0;
+    };
+    std::vector<Bin> bins;
+
+    std::vector<size_t> order;
+    order.reserve(crops.size());
+    for (size_t i = 0; i < crops.size(); ++i)
+    {
+        if (crops[i].width <= netSize.width && crops[i].height <= netSize.height && crops[i].area() > 0)
+            order.push_back(i);
+        else
+            single.push_back(i);
+    }
+    std::stable_sort(std::begin(order), std::end(order), [&crops](size_t i1, size_t i2) { return crops[i1].height > crops[i2].height; });
+
+    for (size_t ind : order)
+    {
+        const cv::Size& size = crops[ind];
+        bool placed = false;
+        for (size_t b = 0; b < bins.size() && !placed; ++b)
+        {
+            Bin& bin = bins[b];
+            for (auto& shelf : bin.m_shelves)
+            {
+                if (shelf.m_x + size.width <= netSize.width && size.height <= shelf.m_height)
+                {
+                    canvases[b].push_back({ ind, cv::Point(shelf.m_x, shelf.m_y), size });
+                    shelf.m_x += size.width + m_gap;
+                    placed = true;
+                    break;
+                }
+            }
+            if (!placed && bin.m_nextY + size.height <= netSize.height)
+            {
+                bin.m_shelves.push_back({ bin.m_nextY, size.height, size.width + m_gap });
+                canvases[b].push_back({ ind, cv::Point(0, bin.m_nextY), size });
+                bin.m_nextY += size.height + m_gap;
+                placed = true;
+            }
+        }
+        if (!placed)
+        {
+            bins.emplace_back();
+            bins.back().m_shelves.push_back({ 0, size.height, size.width + m_gap });
+            bins.back().m_nextY = size.height + m_gap;
+            canvases.emplace_back();
+            canvases.back().push_back({ ind, cv::Point(0, 0), size });
+        }
+    }
+
+    // The crop alone is detected with the resize to the input size
+    for (size_t i = 0; i < canvases.size();)
+    {
+        if (canvases[i].size() < 2)
+        {
+            single.push_back(canvases[i].front().m_cropInd);
+            canvases.erase(canvases.begin() + i);
+        }
+        else
+        {
+            ++i;
+        }
+    }
+    std::sort(std::begin(single), std::end(single));
+}
+
+///
+/// \brief CropsMosaic::Render
+/// \param crops
+/// \param canvas
+/// \param netSize
+/// \param image
+///
+void CropsMosaic::Render(const std::vector<cv::Mat>& crops, const Canvas& canvas, cv::Size netSize, cv::Mat& image) const
+{
+    if (canvas.empty())
+        return;
+    image.create(netSize, crops[canvas.front().m_cropInd].type());
+    image.setTo(cv::Scalar::all(128));
+    for (const auto& placement : canvas)
+    {
+        crops[placement.m_cropInd].copyTo(image(cv::Rect(placement.m_dst, placement.m_size)));
+    }
+}
+
+///
+/// \brief CropsMosaic::ToCrops
+/// \param canvasRegions
+/// \param canvas
+/// \param cropsRects
+/// \param cropsRegions
+///
+void CropsMosaic::ToCrops(const regions_t& canvasRegions, const Canvas& canvas, const std::vector<cv::Rect>& cropsRects, std::vector<regions_t>& cropsRegions) const
+{
+    for (const auto& reg : canvasRegions)
+    {
+        const cv::Point center(reg.m_brect.x + reg.m_brect.width / 2, reg.m_brect.y + reg.m_brect.height / 2);
+        for (const auto& placement : canvas)
+        {
+            const cv::Rect dst(placement.m_dst, placement.m_size);
+            if (!dst.contains(center))
+                continue;
+
+            const cv::Point shift = cropsRects[placement.m_cropInd].tl() - placement.m_dst;
+            const cv::Rect rect = (reg.m_brect & dst) + shift;
+            if (rect.area() > 0)
+                cropsRegions[placement.m_cropInd].emplace_back(rect, reg.m_type, reg.m_confidence);
+            break;
+        }
+    }
+}
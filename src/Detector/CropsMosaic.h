@@ -0,0 +1,72 @@
+#pragma once
+
+#include "defines.h"
+
+///
+/// \brief The CropsMosaic class
+/// Packing of the small crops into the canvases of the network input size: the crops that are much smaller than the
+/// input (the small maxCropRatio, the crops of the tracks) don't take the whole tensor each. The crops keep their scale,
+/// the canvas is the network input without the resize. The crops can be of the different frames of the batch.
+/// The regions of the canvas are returned to the crops by the centers before NMS
+///
+class CropsMosaic
+{
+public:
+    ///
+    /// \brief The Placement struct
+    /// Crop on the canvas
+    ///
+    struct Placement
+    {
+        size_t m_cropInd = 0;  // Index in the packed list
+        cv::Point m_dst;
+        cv::Size m_size;
+    };
+    typedef std::vector<Placement> Canvas;
+
+    ///
+    /// \brief Init
+    /// \param config - "cropsMosaic", "cropsMosaicGap"
+    /// \return
+    ///
+    bool Init(const config_t& config);
+
+    ///
+    bool Enabled() const
+    {
+        return m_enabled;
+    }
+
+    ///
+    /// \brief Pack
+    /// Shelf packing from the highest crops, the canvas with only one crop isn't made: the crop goes to the network alone
+    /// \param crops - sizes of the crops
+    /// \param netSize - network input size
+    /// \param canvases - with 2 and more crops
+    /// \param single - indices of the crops out of the canvases
+    ///
+    void Pack(const std::vector<cv::Size>& crops, cv::Size netSize, std::vector<Canvas>& canvases, std::vector<size_t>& single) const;
+
+    ///
+    /// \brief Render
+    /// \param crops - pixels of the packed list, the crops of the canvas have the same type
+    /// \param canvas
+    /// \param netSize
+    /// \param image - gray background like the letterbox of the detectors
+    ///
+    void Render(const std::vector<cv::Mat>& crops, const Canvas& canvas, cv::Size netSize, cv::Mat& image) const;
+
+    ///
+    /// \brief ToCrops
+    /// The region belongs to the crop with its center, it's clipped by the crop
+    /// \param canvasRegions - regions in the canvas coordinates
+    /// \param canvas
+    /// \param cropsRects - rects of the packed list in the frame coordinates
+    /// \param cropsRegions - regions of the crops in the frame coordinates
+    ///
+    void ToCrops(const regions_t& canvasRegions, const Canvas& canvas, const std::vector<cv::Rect>& cropsRects, std::vector<regions_t>& cropsRegions) const;
+
+private:
+    bool m_enabled = false;
+    int m_gap = 8;  // Padding between the crops, the detections don't cross it
+};
@@ -0,0 +1,184 @@
+#include <algorithm>
+#include <sstream>
+#include <iostream>
+#include "DetectionMask.h"
+
+///
+/// \brief DetectionMask::Init
+/// \param config
+/// \return
+///
+bool DetectionMask::Init(const config_t& config)
+{
+    bool res = true;
+
+    m_roiPolygons.clear();
+    auto roiRange = config.equal_range("roiPolygon");
+    for (auto it = roiRange.first; it != roiRange.second; ++it)
+    {
+        res &= ParsePolygons(it->second, m_roiPolygons);
+    }
+
+    m_excludePolygons.clear();
+    auto excludeRange = config.equal_range("excludePolygon");
+    for (auto it = excludeRange.first; it != excludeRange.second; ++it)
+    {
+        res &= ParsePolygons(it->second, m_excludePolygons);
+    }
+
+    m_enabled = !m_roiPolygons.empty() || !m_excludePolygons.empty();
+
+    std::lock_guard<std::mutex> lock(m_maskMutex);
+    m_mask.release();
+    m_boundingRect = cv::Rect();
+    return res;
+}
+
+///
+/// \brief DetectionMask::ParsePolygons
+/// \param str
+/// \param polygons
+/// \return
+///
+bool DetectionMask::ParsePolygons(const std::string& str, polygons_t& polygons)
+{
+    std::istringstream polygonsStream(str);
+    std::string polygonStr;
+    while (std::getline(polygonsStream, polygonStr, '|'))
+    {
+        std::vector<cv::Point2f> polygon;
+        std::istringstream pointsStream(polygonStr);
+        std::string pointStr;
+        while (std::getline(pointsStream, pointStr, ';'))
+        {
+            if (pointStr.find_first_not_of(" \t") == std::string::npos)
+                continue;
+            cv::Point2f pt;
+            char sep = 0;
+            std::istringstream pointStream(pointStr);
+            if (!(pointStream >> pt.x >> sep >> pt.y) || sep != ',')
+            {
+                std::cerr << "DetectionMask: wrong point \"" << pointStr << "\" in polygon \"" << polygonStr << "\"" << std::endl;
+                return false;
+            }
+            polygon.push_back(pt);
+        }
+        if (polygon.size() > 2)
+            polygons.emplace_back(std::move(polygon));
+        else if (!polygon.empty())
+            std::cerr << "DetectionMask: polygon \"" << polygonStr << "\" has less than 3 points" << std::endl;
+    }
+    return true;
+}
+
+///
+/// \brief DetectionMask::Update
+/// Is called under m_maskMutex
+/// \param frameSize
+///
+void DetectionMask::Update(cv::Size frameSize) const
+{
+    if (m_mask.size() == frameSize)
+        return;
+
+    auto ToPixels = [frameSize](const polygons_t& polygons)
+    {
+        std::vector<std::vector<cv::Point>> res;
+        for (const auto& polygon : polygons)
+        {
+            bool relative = true;
+            for (const auto& pt : polygon)
+            {
+                relative &= (pt.x <= 1.f) && (pt.y <= 1.f);
+            }
+            const float kx = relative ? static_cast<float>(frameSize.width) : 1.f;
+            const float ky = relative ? static_cast<float>(frameSize.height) : 1.f;
+            res.emplace_back();
+            for (const auto& pt : polygon)
+            {
+                res.back().emplace_back(cvRound(kx * pt.x), cvRound(ky * pt.y));
+            }
+        }
+        return res;
+    };
+
+    if (m_roiPolygons.empty())
+    {
+        m_mask = cv::Mat(frameSize, CV_8UC1, cv::Scalar(255));
+    }
+    else
+    {
+        m_mask = cv::Mat(frameSize, CV_8UC1, cv::Scalar(0));
+        cv::fillPoly(m_mask, ToPixels(m_roiPolygons), cv::Scalar(255));
+    }
+    if (!m_excludePolygons.empty())
+        cv::fillPoly(m_mask, ToPixels(m_excludePolygons), cv::Scalar(0));
+
+    m_boundingRect = cv::boundingRect(m_mask);
+    std::cout << "DetectionMask: " << cv::countNonZero(m_mask) << " from " << frameSize.area() << " pixels are detected, bounding rect " << m_boundingRect << std::endl;
+}
+
+///
+/// \brief DetectionMask::Mask
+/// \param frameSize
+/// \return
+///
+cv::Mat DetectionMask::Mask(cv::Size frameSize) const
+{
+    std::lock_guard<std::mutex> lock(m_maskMutex);
+    Update(frameSize);
+    return m_mask;
+}
+
+///
+/// \brief DetectionMask::BoundingRect
+/// \param frameSize
+/// \return
+///
+cv::Rect DetectionMask::BoundingRect(cv::Size frameSize) const
+{
+    if (!m_enabled)
+        return cv::Rect(0, 0, frameSize.width, frameSize.height);
+
+    std::lock_guard<std::mutex> lock(m_maskMutex);
+    Update(frameSize);
+    return m_boundingRect;
+}
+
+///
+/// \brief DetectionMask::IsActive
+/// \param rect
+/// \param frameSize
+/// \return
+///
+bool DetectionMask::IsActive(const cv::Rect& rect, cv::Size frameSize) const
+{
+    if (!m_enabled)
+        return true;
+
+    std::lock_guard<std::mutex> lock(m_maskMutex);
+    Update(frameSize);
+    cv::Rect r = rect & cv::Rect(0, 0, frameSize.width, frameSize.height);
+    return !r.empty() && cv::countNonZero(m_mask(r)) > 0;
+}
+
+///
+/// \brief DetectionMask::Filter
+/// \param regions
+/// \param frameSize
+///
+void DetectionMask::Filter(regions_t& regions, cv::Size frameSize) const
+{
+    if (!m_enabled)
+        return;
+
+    std::lock_guard<std::mutex> lock(m_maskMutex);
+    Update(frameSize);
+    regions.erase(std::remove_if(std::begin(regions), std::end(regions), [this](const CRegion& reg)
+    {
+        cv::Point center(reg.m_brect.x + reg.m_brect.width / 2, reg.m_brect.y + reg.m_brect.height / 2);
+        center.x = std::max(0, std::min(center.x, m_mask.cols - 1));
+        center.y = std::max(0, std::min(center.y, m_mask.rows - 1));
+        return m_mask.at<uchar>(center) == 0;
+    }), std::end(regions));
+}
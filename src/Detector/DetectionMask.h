@@ -0,0 +1,75 @@
+#pragma once
+
+#include <mutex>
+#include "defines.h"
+
+///
+/// \brief The DetectionMask class
+/// Static mask of the fixed camera: the regions of interest and the excluded areas (sky, roofs, timestamps, other roads).
+/// The polygons are "x0,y0;x1,y1;x2,y2;..." in pixels or, if all coordinates are not greater than 1, in the parts of the frame size.
+/// Some polygons of one key are separated by '|', the key can be repeated
+///
+class DetectionMask
+{
+public:
+    DetectionMask() = default;
+    ~DetectionMask() = default;
+
+    ///
+    /// \brief Init
+    /// \param config - "roiPolygon" (the whole frame by default) and "excludePolygon"
+    /// \return
+    ///
+    bool Init(const config_t& config);
+
+    ///
+    bool Enabled() const
+    {
+        return m_enabled;
+    }
+
+    ///
+    /// \brief Mask
+    /// \param frameSize
+    /// \return CV_8UC1 mask where 255 for the detected pixels
+    ///
+    cv::Mat Mask(cv::Size frameSize) const;
+
+    ///
+    /// \brief BoundingRect
+    /// \param frameSize
+    /// \return Bounding rect of the detected pixels or the whole frame if the mask is disabled
+    ///
+    cv::Rect BoundingRect(cv::Size frameSize) const;
+
+    ///
+    /// \brief IsActive
+    /// \param rect
+    /// \param frameSize
+    /// \return false if the all pixels of the rect are masked
+    ///
+    bool IsActive(const cv::Rect& rect, cv::Size frameSize) const;
+
+    ///
+    /// \brief Filter
+    /// Removes the regions with the masked centers
+    /// \param regions
+    /// \param frameSize
+    ///
+    void Filter(regions_t& regions, cv::Size frameSize) const;
+
+private:
+    typedef std::vector<std::vector<cv::Point2f>> polygons_t;
+
+    bool m_enabled = false;
+    polygons_t m_roiPolygons;
+    polygons_t m_excludePolygons;
+
+    // The mask is built for the size of the first frame and rebuilt only if the size changes
+    mutable std::mutex m_maskMutex;
+    mutable cv::Mat m_mask;
+    mutable cv::Rect m_boundingRect;
+
+    static bool ParsePolygons(const std::string& str, polygons_t& polygons);
+    void Update(cv::Size frameSize) const;
+};
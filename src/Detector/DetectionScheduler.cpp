@@ -0,0 +1,225 @@
+#include <algorithm>
+#include "DetectionScheduler.h"
+#include "nms.h"
+
+///
+/// \brief DetectionScheduler::DetectionScheduler
+/// \param keyframeInterval
+/// \param roiMargin
+/// \param borderRatio
+///
+DetectionScheduler::DetectionScheduler(int keyframeInterval, float roiMargin, float borderRatio)
+    : m_keyframeInterval(std::max(1, keyframeInterval)), m_roiMargin(std::max(0.f, roiMargin)), m_borderRatio(std::max(0.f, borderRatio))
+{
+}
+
+///
+/// \brief DetectionScheduler::Detect
+/// \param detector
+/// \param frames
+/// \param predictedRects
+/// \param regions
+///
+void DetectionScheduler::Detect(BaseDetector& detector, const std::vector<cv::UMat>& frames, const std::vector<cv::Rect>& predictedRects, std::vector<regions_t>& regions)
+{
+    std::vector<cv::UMat> images(frames.size());
+    std::vector<std::vector<Placement>> placements(frames.size());
+    for (size_t i = 0; i < frames.size(); ++i)
+    {
+        Prepare(frames[i], predictedRects, images[i], placements[i]);
+    }
+
+    std::vector<regions_t> imagesRegions(images.size());
+    detector.Detect(images, imagesRegions);
+
+    regions.resize(frames.size());
+    for (size_t i = 0; i < frames.size(); ++i)
+    {
+        Restore(imagesRegions[i], placements[i], regions[i]);
+    }
+}
+
+///
+/// \brief DetectionScheduler::Prepare
+/// \param frame
+/// \param predictedRects
+/// \param image
+/// \param placements
+///
+void DetectionScheduler::Prepare(const cv::UMat& frame, const std::vector<cv::Rect>& predictedRects, cv::UMat& image, std::vector<Placement>& placements)
+{
+    // The image can share the buffer of the previous frame, so the mosaic is the new buffer
+    const bool keyframe = (m_framesCount++ % static_cast<size_t>(m_keyframeInterval)) == 0;
+    cv::UMat mosaic;
+    if (!keyframe && MakeMosaic(frame, predictedRects, mosaic, placements))
+    {
+        image = mosaic;
+    }
+    else
+    {
+        placements.clear();
+        image = frame;
+    }
+}
+
+///
+/// \brief DetectionScheduler::Restore
+/// \param imageRegions
+/// \param placements
+/// \param regions
+///
+void DetectionScheduler::Restore(regions_t& imageRegions, const std::vector<Placement>& placements, regions_t& regions) const
+{
+    if (placements.empty())
+        regions = std::move(imageRegions);
+    else
+        MosaicToFrame(imageRegions, placements, regions);
+}
+
+///
+/// \brief DetectionScheduler::MakeMosaic
+/// \param frame
+/// \param predictedRects
+/// \param mosaic
+/// \param placements
+/// \return false if the mosaic isn't smaller than the frame
+///
+bool DetectionScheduler::MakeMosaic(const cv::UMat& frame, const std::vector<cv::Rect>& predictedRects, cv::UMat& mosaic, std::vector<Placement>& placements) const
+{
+    placements.clear();
+    const cv::Rect frameRect(0, 0, frame.cols, frame.rows);
+    const int border = std::max(1, cvRound(m_borderRatio * std::min(frame.cols, frame.rows)));
+    const int maxPiece = 4 * border;
+
+    // Expanded areas of the tracks, the overlapped areas are merged
+    std::vector<cv::Rect> rois;
+    for (const auto& rect : predictedRects)
+    {
+        const int dx = cvRound(m_roiMargin * rect.width);
+        const int dy = cvRound(m_roiMargin * rect.height);
+        cv::Rect roi = cv::Rect(rect.x - dx, rect.y - dy, rect.width + 2 * dx, rect.height + 2 * dy) & frameRect;
+        if (roi.area() <= 0)
+            continue;
+        for (bool merged = true; merged;)
+        {
+            merged = false;
+            for (size_t i = 0; i < rois.size(); ++i)
+            {
+                if ((rois[i] & roi).area() > 0)
+                {
+                    roi |= rois[i];
+                    rois.erase(rois.begin() + i);
+                    merged = true;
+                    break;
+                }
+            }
+        }
+        rois.push_back(roi);
+    }
+
+    // Borders are split on the pieces with the aspect ratio not more than 4
+    auto AddStrip = [&](const cv::Rect& strip)
+    {
+        if (strip.width >= strip.height)
+        {
+            for (int x = strip.x; x < strip.x + strip.width; x += maxPiece)
+            {
+                rois.emplace_back(x, strip.y, std::min(maxPiece, strip.x + strip.width - x), strip.height);
+            }
+        }
+        else
+        {
+            for (int y = strip.y; y < strip.y + strip.height; y += maxPiece)
+            {
+                rois.emplace_back(strip.x, y, strip.width, std::min(maxPiece, strip.y + strip.height - y));
+            }
+        }
+    };
+    if (m_borderRatio > 0)
+    {
+        AddStrip(cv::Rect(0, 0, frame.cols, border));
+        AddStrip(cv::Rect(0, frame.rows - border, frame.cols, border));
+        AddStrip(cv::Rect(0, border, border, frame.rows - 2 * border));
+        AddStrip(cv::Rect(frame.cols - border, border, border, frame.rows - 2 * border));
+    }
+    if (rois.empty())
+        return false;
+
+    // Shelf packing from the highest areas into the almost square mosaic
+    const int gap = 8;
+    double area = 0;
+    int maxWidth = 0;
+    for (const auto& roi : rois)
+    {
+        area += static_cast<double>(roi.width + gap) * (roi.height + gap);
+        maxWidth = std::max(maxWidth, roi.width);
+    }
+    const int mosaicWidth = std::min(frame.cols, std::max(maxWidth, cvCeil(sqrt(area))));
+
+    std::sort(std::begin(rois), std::end(rois), [](const cv::Rect& r1, const cv::Rect& r2) { return r1.height > r2.height; });
+    int x = 0;
+    int y = 0;
+    int shelfHeight = 0;
+    for (const auto& roi : rois)
+    {
+        if (x > 0 && x + roi.width > mosaicWidth)
+        {
+            x = 0;
+            y += shelfHeight + gap;
+            shelfHeight = 0;
+        }
+        placements.push_back({ roi, cv::Point(x, y) });
+        x += roi.width + gap;
+        shelfHeight = std::max(shelfHeight, roi.height);
+    }
+    const int mosaicHeight = y + shelfHeight;
+    if (static_cast<double>(mosaicWidth) * mosaicHeight >= static_cast<double>(frame.cols) * frame.rows)
+    {
+        placements.clear();
+        return false;
+    }
+
+    // Gray gaps like the letterbox of the detectors
+    mosaic.create(mosaicHeight, mosaicWidth, frame.type());
+    mosaic.setTo(cv::Scalar::all(128));
+    for (const auto& placement : placements)
+    {
+        frame(placement.m_src).copyTo(mosaic(cv::Rect(placement.m_dst, placement.m_src.size())));
+    }
+    return true;
+}
+
+///
+/// \brief DetectionScheduler::MosaicToFrame
+/// The region belongs to the placement with its center, the regions of the overlapped placements are merged by NMS
+/// \param mosaicRegions
+/// \param placements
+/// \param regions
+///
+void DetectionScheduler::MosaicToFrame(const regions_t& mosaicRegions, const std::vector<Placement>& placements, regions_t& regions) const
+{
+    regions_t tmpRegions;
+    for (const auto& reg : mosaicRegions)
+    {
+        const cv::Point center(reg.m_brect.x + reg.m_brect.width / 2, reg.m_brect.y + reg.m_brect.height / 2);
+        for (const auto& placement : placements)
+        {
+            const cv::Rect dst(placement.m_dst, placement.m_src.size());
+            if (!dst.contains(center))
+                continue;
+
+            const cv::Point shift = placement.m_src.tl() - placement.m_dst;
+            const cv::Rect rect = (reg.m_brect & dst) + shift;
+            if (rect.area() > 0)
+                tmpRegions.emplace_back(rect, reg.m_type, reg.m_confidence);
+            break;
+        }
+    }
+
+    regions.clear();
+    nms3<CRegion>(tmpRegions, regions, 0.4f,
+        [](const CRegion& reg) { return reg.m_brect; },
+        [](const CRegion& reg) { return reg.m_confidence; },
+        [](const CRegion& reg) { return reg.m_type; },
+        0, 0.f);
+}
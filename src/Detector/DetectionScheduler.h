@@ -0,0 +1,77 @@
+#pragma once
+
+#include "BaseDetector.h"
+
+///
+/// \brief The DetectionScheduler class
+/// The full frame is detected on the every keyframeInterval frame. On the frames between them the areas of the predicted tracks
+/// and the frame borders (the new objects come from them) are packed into the small mosaic: the detector runs on the mosaic
+/// and the regions are returned to the frame coordinates. All frames of the batch go to the detector by one call.
+/// If the mosaic isn't smaller than the frame then the full frame is detected
+///
+class DetectionScheduler
+{
+public:
+    ///
+    /// \brief DetectionScheduler
+    /// \param keyframeInterval - 1 means the full frame detection on the every frame
+    /// \param roiMargin - the predicted rect is expanded on this part of its size from the every side
+    /// \param borderRatio - width of the detected borders in the part of the min frame side
+    ///
+    DetectionScheduler(int keyframeInterval, float roiMargin, float borderRatio);
+
+    ///
+    /// \brief Detect
+    /// \param detector
+    /// \param frames - consecutive frames of one camera
+    /// \param predictedRects - areas of the tracks after the previous frame
+    /// \param regions
+    ///
+    void Detect(BaseDetector& detector, const std::vector<cv::UMat>& frames, const std::vector<cv::Rect>& predictedRects, std::vector<regions_t>& regions);
+
+    ///
+    /// \brief The Placement struct
+    /// Part of the frame on the mosaic
+    ///
+    struct Placement
+    {
+        cv::Rect m_src;
+        cv::Point m_dst;
+    };
+
+    ///
+    /// \brief Prepare
+    /// Image of the next frame for the detector which isn't called by the scheduler (the shared detector of the streams)
+    /// \param frame
+    /// \param predictedRects - areas of the tracks after the previous frame
+    /// \param image - the frame on the keyframe or the mosaic
+    /// \param placements - empty if the image is the frame
+    ///
+    void Prepare(const cv::UMat& frame, const std::vector<cv::Rect>& predictedRects, cv::UMat& image, std::vector<Placement>& placements);
+
+    ///
+    /// \brief Restore
+    /// \param imageRegions - regions of the image of Prepare
+    /// \param placements
+    /// \param regions - on the frame
+    ///
+    void Restore(regions_t& imageRegions, const std::vector<Placement>& placements, regions_t& regions) const;
+
+    ///
+    /// \brief Reset
+    /// The next frame is the keyframe
+    ///
+    void Reset()
+    {
+        m_framesCount = 0;
+    }
+
+private:
+    int m_keyframeInterval = 1;
+    float m_roiMargin = 0.5f;
+    float m_borderRatio = 0.05f;
+    size_t m_framesCount = 0;
+
+    bool MakeMosaic(const cv::UMat& frame, const std::vector<cv::Rect>& predictedRects, cv::UMat& mosaic, std::vector<Placement>& placements) const;
+    void MosaicToFrame(const regions_t& mosaicRegions, const std::vector<Placement>& placements, regions_t& regions) const;
+};
@@ -1,4 +1,6 @@
 #include "FaceDetector.h"
+#include "BackgroundSubtract.h"
+#include "nms.h"
 
 ///
 /// \brief FaceDetector::FaceDetector
@@ -9,6 +11,14 @@ FaceDetector::FaceDetector(const cv::UMat& gray)
 {
 }
 
+///
+/// \brief FaceDetector::~FaceDetector
+///
+FaceDetector::~FaceDetector(void)
+{
+    StopAsync();
+}
+
 ///
 /// \brief FaceDetector::Init
 /// \param cascadeFileName
@@ -23,6 +33,49 @@ bool FaceDetector::Init(const config_t& config)
         std::cerr << "Cascade " << cascadeFileName->second << " not opened!" << std::endl;
         return false;
     }
+
+    std::string faceBackend = "CPU";
+    auto faceBackendIt = config.find("faceBackend");
+    if (faceBackendIt != config.end())
+        faceBackend = faceBackendIt->second;
+
+    m_backend = (faceBackend == "CPU_ROI") ? Face_CPUROI : Face_CPU;
+    if (faceBackend == "CUDA")
+    {
+#ifdef HAVE_OPENCV_CUDAOBJDETECT
+        // The CUDA cascade supports only the new format of the Haar cascades
+        if (cascadeFileName != config.end() && cv::cuda::getCudaEnabledDeviceCount() > 0)
+        {
+            try
+            {
+                m_cudaCascade = cv::cuda::CascadeClassifier::create(cascadeFileName->second);
+                m_cudaCascade->setScaleFactor(ScaleFactor);
+                m_cudaCascade->setMinNeighbors(MinNeighbors);
+                m_backend = Face_CUDA;
+            }
+            catch (const cv::Exception& ex)
+            {
+                std::cerr << "FaceDetector: CUDA cascade " << cascadeFileName->second << " not opened: " << ex.what() << std::endl;
+                m_cudaCascade.release();
+            }
+        }
+#endif
+        if (m_backend != Face_CUDA)
+            std::cout << "FaceDetector: CUDA cascade isn't available, CPU is used" << std::endl;
+    }
+
+    auto refreshPeriod = config.find("faceRefreshPeriod");
+    if (refreshPeriod != config.end())
+        m_refreshPeriod = std::max(1, std::stoi(refreshPeriod->second));
+
+    auto motionScale = config.find("faceMotionScale");
+    if (motionScale != config.end())
+        m_motionScale = std::min(1., std::max(0.05, std::stod(motionScale->second)));
+
+    m_framesFromFull = m_refreshPeriod;
+    m_backgroundSubst.reset();
+    if (m_backend == Face_CPUROI)
+        m_backgroundSubst = std::make_unique<BackgroundSubtract>(BackgroundSubtract::BGFG_ALGS::ALG_VIBE, 1);
     return true;
 }
 
@@ -31,20 +84,164 @@ bool FaceDetector::Init(const config_t& config)
 /// \param gray
 ///
 void FaceDetector::Detect(const cv::UMat& gray)
+{
+    static metrics::Histogram& detectTime = DetectHistogram("face", false);
+    metrics::ScopedTimer timer(detectTime);
+
+    std::vector<cv::Rect> faceRects;
+    switch (m_backend)
+    {
+    case Face_CUDA:
+#ifdef HAVE_OPENCV_CUDAOBJDETECT
+        m_cudaCascade->setMinObjectSize(m_minObjectSize);
+        m_cudaCascade->setMaxObjectSize(cv::Size(gray.cols / 2, gray.rows / 2));
+        m_gpuFrame.upload(gray);
+        m_cudaCascade->detectMultiScale(m_gpuFrame, m_gpuObjects);
+        m_cudaCascade->convert(m_gpuObjects, faceRects);
+#endif
+        break;
+
+    case Face_CPUROI:
+        DetectROI(gray, faceRects);
+        break;
+
+    default:
+        DetectCPU(gray, m_minObjectSize, cv::Size(gray.cols / 2, gray.rows / 2), faceRects);
+        break;
+    }
+
+    m_regions.clear();
+    for (auto rect : faceRects)
+    {
+        m_regions.push_back(rect);
+    }
+}
+
+///
+/// \brief FaceDetector::DetectCPU
+/// \param gray
+/// \param minSize
+/// \param maxSize
+/// \param faceRects
+///
+void FaceDetector::DetectCPU(const cv::UMat& gray, cv::Size minSize, cv::Size maxSize, std::vector<cv::Rect>& faceRects)
 {
     bool findLargestObject = false;
     bool filterRects = true;
-    std::vector<cv::Rect> faceRects;
     m_cascade.detectMultiScale(gray,
                              faceRects,
-                             1.1,
-                             (filterRects || findLargestObject) ? 3 : 0,
+                             ScaleFactor,
+                             (filterRects || findLargestObject) ? MinNeighbors : 0,
                              findLargestObject ? cv::CASCADE_FIND_BIGGEST_OBJECT : 0,
-                             m_minObjectSize,
-                             cv::Size(gray.cols / 2, gray.rows / 2));
-    m_regions.clear();
-    for (auto rect : faceRects)
+                             minSize,
+                             maxSize);
+}
+
+///
+/// \brief FaceDetector::DetectROI
+/// The faces are searched only around the tracks with their scales and in the motion areas.
+/// The whole frame is detected on the first frame and once in m_refreshPeriod frames
+/// \param gray
+/// \param faceRects
+///
+void FaceDetector::DetectROI(const cv::UMat& gray, std::vector<cv::Rect>& faceRects)
+{
+    const cv::Rect frameRect(0, 0, gray.cols, gray.rows);
+    const cv::Size maxFrameSize(gray.cols / 2, gray.rows / 2);
+
+    // The motion mask is updated on the every frame
+    cv::resize(gray, m_smallFrame, cv::Size(), m_motionScale, m_motionScale, cv::INTER_AREA);
+    m_backgroundSubst->Subtract(m_smallFrame, m_foreground);
+
+    if (++m_framesFromFull > m_refreshPeriod)
     {
-        m_regions.push_back(rect);
+        m_framesFromFull = 0;
+        DetectCPU(gray, m_minObjectSize, maxFrameSize, faceRects);
+        return;
+    }
+
+    std::vector<cv::Rect> trackedRects;
+    {
+        std::lock_guard<std::mutex> lock(m_trackedMutex);
+        trackedRects = m_trackedRects;
+    }
+
+    struct ROI
+    {
+        cv::Rect m_rect;
+        cv::Size m_minSize;
+        cv::Size m_maxSize;
+    };
+    std::vector<ROI> rois;
+
+    // The tracked faces: the area twice larger than the track and the scales near the track size
+    for (const auto& track : trackedRects)
+    {
+        cv::Rect roi(track.x - track.width / 2, track.y - track.height / 2, 2 * track.width, 2 * track.height);
+        roi &= frameRect;
+        if (roi.width < m_minObjectSize.width || roi.height < m_minObjectSize.height)
+            continue;
+        cv::Size minSize(std::max(m_minObjectSize.width, cvRound(0.7 * track.width)), std::max(m_minObjectSize.height, cvRound(0.7 * track.height)));
+        cv::Size maxSize(std::min(roi.width, cvRound(1.5 * track.width)), std::min(roi.height, cvRound(1.5 * track.height)));
+        rois.push_back({ roi, minSize, maxSize });
     }
+
+    // The motion areas: the new faces with the all scales
+    cv::Mat foreground = exec::MapToHost(m_foreground, "FaceDetector::DetectROI");
+    std::vector<std::vector<cv::Point>> contours;
+#if (CV_VERSION_MAJOR < 4)
+    cv::findContours(foreground.clone(), contours, CV_RETR_EXTERNAL, CV_CHAIN_APPROX_SIMPLE);
+#else
+    cv::findContours(foreground.clone(), contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+#endif
+    const double invScale = 1. / m_motionScale;
+    for (const auto& contour : contours)
+    {
+        cv::Rect smallRect = cv::boundingRect(contour);
+        cv::Rect roi(cvRound(invScale * smallRect.x), cvRound(invScale * smallRect.y), cvRound(invScale * smallRect.width), cvRound(invScale * smallRect.height));
+        // The face can be partly out of the motion area
+        roi = cv::Rect(roi.x - m_minObjectSize.width, roi.y - m_minObjectSize.height, roi.width + 2 * m_minObjectSize.width, roi.height + 2 * m_minObjectSize.height) & frameRect;
+        if (roi.width < m_minObjectSize.width || roi.height < m_minObjectSize.height)
+            continue;
+
+        bool tracked = false;
+        for (const auto& r : rois)
+        {
+            tracked |= (r.m_rect & roi) == roi;
+        }
+        if (!tracked)
+            rois.push_back({ roi, m_minObjectSize, cv::Size(std::min(roi.width, maxFrameSize.width), std::min(roi.height, maxFrameSize.height)) });
+    }
+
+    std::vector<cv::Rect> roiFaces;
+    for (const auto& roi : rois)
+    {
+        if (roi.m_minSize.width > roi.m_maxSize.width || roi.m_minSize.height > roi.m_maxSize.height)
+            continue;
+        DetectCPU(cv::UMat(gray, roi.m_rect), roi.m_minSize, roi.m_maxSize, roiFaces);
+        for (auto rect : roiFaces)
+        {
+            faceRects.emplace_back(rect + roi.m_rect.tl());
+        }
+    }
+
+    // The faces from the overlapped areas
+    if (rois.size() > 1)
+    {
+        std::vector<cv::Rect> tmpRects;
+        tmpRects.swap(faceRects);
+        nms(tmpRects, faceRects, 0.3f, 0);
+    }
+}
+
+///
+/// \brief FaceDetector::SetTrackedRects
+/// \param rects
+///
+void FaceDetector::SetTrackedRects(const std::vector<cv::Rect>& rects)
+{
+    BaseDetector::SetTrackedRects(rects);
+
+    std::lock_guard<std::mutex> lock(m_trackedMutex);
+    m_trackedRects = rects;
 }
@@ -2,15 +2,37 @@
 
 #include "BaseDetector.h"
 
+#ifdef HAVE_OPENCV_CUDAOBJDETECT
+#include <opencv2/cudaobjdetect.hpp>
+#endif
+
+class BackgroundSubtract;
+
 ///
 /// \brief The FaceDetector class
 ///
 class FaceDetector final : public BaseDetector
 {
 public:
+    ///
+    /// \brief The FaceBackends enum
+    /// CPU - the whole frame, CPUROI - only around the tracked faces and the motion with the scales of the tracks,
+    /// the whole frame once in "faceRefreshPeriod" frames
+    ///
+    enum FaceBackends
+    {
+        Face_CPU,
+        Face_CPUROI,
+        Face_CUDA
+    };
+
     FaceDetector(const cv::UMat& gray);
-    ~FaceDetector(void) = default;
+    ~FaceDetector(void);
 
+    ///
+    /// \brief Init
+    /// \param config - "cascadeFileName", "faceBackend" (CUDA, CPU or CPU_ROI), "faceRefreshPeriod", "faceMotionScale"
+    ///
     bool Init(const config_t& config);
 
     void Detect(const cv::UMat& gray);
@@ -20,6 +42,31 @@ public:
 		return true;
 	}
 
+    void SetTrackedRects(const std::vector<cv::Rect>& rects);
+
 private:
     cv::CascadeClassifier m_cascade;
+    FaceBackends m_backend = Face_CPU;
+
+#ifdef HAVE_OPENCV_CUDAOBJDETECT
+    cv::Ptr<cv::cuda::CascadeClassifier> m_cudaCascade;
+    cv::cuda::GpuMat m_gpuFrame;
+    cv::cuda::GpuMat m_gpuObjects;
+#endif
+
+    // Face_CPUROI
+    int m_refreshPeriod = 10;
+    double m_motionScale = 0.25;
+    int m_framesFromFull = 0;
+    std::unique_ptr<BackgroundSubtract> m_backgroundSubst;
+    cv::UMat m_smallFrame;
+    cv::UMat m_foreground;
+    std::mutex m_trackedMutex;
+    std::vector<cv::Rect> m_trackedRects;
+
+    static constexpr double ScaleFactor = 1.1;
+    static constexpr int MinNeighbors = 3;
+
+    void DetectCPU(const cv::UMat& gray, cv::Size minSize, cv::Size maxSize, std::vector<cv::Rect>& faceRects);
+    void DetectROI(const cv::UMat& gray, std::vector<cv::Rect>& faceRects);
 };
@@ -0,0 +1,242 @@
+#include <iostream>
+#include "HotSwapDetector.h"
+
+///
+/// \brief HotSwapDetector::HotSwapDetector
+/// \param detectorType
+/// \param colorFrame
+///
+HotSwapDetector::HotSwapDetector(tracking::Detectors detectorType, const cv::UMat& colorFrame)
+    : BaseDetector(colorFrame), m_detectorType(detectorType), m_initFrame(colorFrame)
+{
+}
+
+///
+/// \brief HotSwapDetector::~HotSwapDetector
+///
+HotSwapDetector::~HotSwapDetector(void)
+{
+    StopAsync();
+    if (m_loadThread.joinable())
+        m_loadThread.join();
+    if (m_releaseThread.joinable())
+        m_releaseThread.join();
+}
+
+///
+/// \brief HotSwapDetector::Load
+/// \param config
+/// \return
+///
+std::unique_ptr<BaseDetector> HotSwapDetector::Load(const config_t& config)
+{
+    config_t detectorConfig = config;
+    detectorConfig.erase("hotSwap");
+    cv::UMat frame = m_initFrame;
+    std::unique_ptr<BaseDetector> detector = CreateDetector(m_detectorType, detectorConfig, frame);
+    // The detections are moved to the results of the wrapper, it draws the motion map
+    if (detector)
+        detector->SetMotionMapEnabled(false);
+    return detector;
+}
+
+///
+/// \brief HotSwapDetector::Init
+/// \param config
+/// \return
+///
+bool HotSwapDetector::Init(const config_t& config)
+{
+    m_active = Load(config);
+    return m_active != nullptr;
+}
+
+///
+/// \brief HotSwapDetector::SwapModel
+/// The new detector detects the init frame and the batch of them before the swap, so its first frame has the usual latency
+/// \param config
+/// \return
+///
+bool HotSwapDetector::SwapModel(const config_t& config)
+{
+    if (m_loading.exchange(true))
+    {
+        std::cerr << "HotSwapDetector: the previous model isn't swapped yet" << std::endl;
+        return false;
+    }
+    // The previous loading has finished
+    if (m_loadThread.joinable())
+        m_loadThread.join();
+
+    m_loadThread = std::thread([this, config]()
+    {
+        std::unique_ptr<BaseDetector> detector = Load(config);
+        if (!detector)
+        {
+            std::cerr << "HotSwapDetector: the new model wasn't created, the current one is kept" << std::endl;
+            m_loading.store(false, std::memory_order_release);
+            return;
+        }
+        detector->Detect(m_initFrame);
+        const size_t batchSize = detector->MaxBatchSize();
+        if (batchSize > 1)
+        {
+            std::vector<cv::UMat> frames(batchSize, m_initFrame);
+            std::vector<regions_t> regions;
+            detector->Detect(frames, regions);
+        }
+        regions_t regions;
+        detector->TakeDetects(regions);
+
+        std::lock_guard<std::mutex> lock(m_pendingMutex);
+        m_pending = std::move(detector);
+        m_hasPending.store(true, std::memory_order_release);
+    });
+    return true;
+}
+
+///
+/// \brief HotSwapDetector::TakePending
+/// Is called between the frames, the old detector is destroyed by the release thread
+///
+void HotSwapDetector::TakePending()
+{
+    if (!m_hasPending.load(std::memory_order_acquire))
+        return;
+
+    std::unique_ptr<BaseDetector> old;
+    {
+        std::lock_guard<std::mutex> lock(m_pendingMutex);
+        old = std::move(m_active);
+        m_active = std::move(m_pending);
+        m_hasPending.store(false, std::memory_order_relaxed);
+    }
+    m_active->SetTrackedRects(m_trackedRects);
+    ++m_swapsCount;
+
+    if (m_releaseThread.joinable())
+        m_releaseThread.join();
+    m_releaseThread = std::thread([](std::unique_ptr<BaseDetector> detector)
+    {
+        detector.reset();
+    }, std::move(old));
+
+    m_loading.store(false, std::memory_order_release);
+    std::cout << "HotSwapDetector: the model was swapped" << std::endl;
+}
+
+///
+/// \brief HotSwapDetector::Detect
+/// \param colorFrame
+///
+void HotSwapDetector::Detect(const cv::UMat& colorFrame)
+{
+    TakePending();
+    if (!m_active)
+    {
+        m_regions.clear();
+        return;
+    }
+    m_active->Detect(colorFrame);
+    m_active->TakeDetects(m_regions);
+}
+
+///
+/// \brief HotSwapDetector::Detect
+/// \param frames
+/// \param regions
+///
+void HotSwapDetector::Detect(const std::vector<cv::UMat>& frames, std::vector<regions_t>& regions)
+{
+    TakePending();
+    if (!m_active)
+    {
+        regions.assign(frames.size(), regions_t());
+        m_regions.clear();
+        return;
+    }
+    m_active->Detect(frames, regions);
+    KeepLastDetects(regions);
+}
+
+///
+/// \brief HotSwapDetector::DetectStreams
+/// \param streamIds
+/// \param frames
+/// \param regions
+///
+void HotSwapDetector::DetectStreams(const std::vector<size_t>& streamIds, const std::vector<cv::UMat>& frames, std::vector<regions_t>& regions)
+{
+    TakePending();
+    if (!m_active)
+    {
+        regions.assign(frames.size(), regions_t());
+        m_regions.clear();
+        return;
+    }
+    m_active->DetectStreams(streamIds, frames, regions);
+    KeepLastDetects(regions);
+}
+
+///
+/// \brief HotSwapDetector::DetectDevice
+/// \param frame
+/// \return
+///
+bool HotSwapDetector::DetectDevice(const DeviceFrame& frame)
+{
+    TakePending();
+    if (!m_active || !m_active->DetectDevice(frame))
+        return false;
+    m_active->TakeDetects(m_regions);
+    return true;
+}
+
+///
+/// \brief HotSwapDetector::CanDeviceProcessing
+/// \return
+///
+bool HotSwapDetector::CanDeviceProcessing() const
+{
+    return m_active && m_active->CanDeviceProcessing();
+}
+
+///
+/// \brief HotSwapDetector::MaxBatchSize
+/// \return
+///
+size_t HotSwapDetector::MaxBatchSize() const
+{
+    return m_active ? m_active->MaxBatchSize() : 1;
+}
+
+///
+/// \brief HotSwapDetector::SetTrackedRects
+/// \param rects
+///
+void HotSwapDetector::SetTrackedRects(const std::vector<cv::Rect>& rects)
+{
+    m_trackedRects.assign(std::begin(rects), std::end(rects));
+    if (m_active)
+        m_active->SetTrackedRects(rects);
+}
+
+///
+/// \brief HotSwapDetector::ResetModel
+/// \param img
+/// \param roiRect
+///
+void HotSwapDetector::ResetModel(const cv::UMat& img, const cv::Rect& roiRect)
+{
+    if (m_active)
+        m_active->ResetModel(img, roiRect);
+}
+
+///
+/// \brief HotSwapDetector::CanGrayProcessing
+/// \return
+///
+bool HotSwapDetector::CanGrayProcessing() const
+{
+    return m_active && m_active->CanGrayProcessing();
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+
+#include "BaseDetector.h"
+
+///
+/// \brief The HotSwapDetector class
+/// Double buffered detector for the model update without the restart of the pipeline: SwapModel creates the new detector
+/// by the new config and warms it up on the init frame in the background thread, the working detector detects the frames
+/// until the next Detect takes the ready one. The old detector is destroyed in the background after the swap.
+/// Both models are in the memory while the loading. Config: "hotSwap" = 1, the rest is the config of the detector
+///
+class HotSwapDetector final : public BaseDetector
+{
+public:
+    HotSwapDetector(tracking::Detectors detectorType, const cv::UMat& colorFrame);
+    ~HotSwapDetector(void);
+
+    bool Init(const config_t& config);
+
+    ///
+    /// \brief SwapModel
+    /// It can be called from another thread
+    /// \param config - of the new model, the detector type is the same
+    /// \return false if the previous swap isn't finished
+    ///
+    bool SwapModel(const config_t& config);
+
+    void Detect(const cv::UMat& colorFrame);
+    void Detect(const std::vector<cv::UMat>& frames, std::vector<regions_t>& regions);
+    void DetectStreams(const std::vector<size_t>& streamIds, const std::vector<cv::UMat>& frames, std::vector<regions_t>& regions);
+
+    bool DetectDevice(const DeviceFrame& frame);
+    bool CanDeviceProcessing() const;
+    size_t MaxBatchSize() const;
+
+    void SetTrackedRects(const std::vector<cv::Rect>& rects);
+    void ResetModel(const cv::UMat& img, const cv::Rect& roiRect);
+
+    bool CanGrayProcessing() const;
+
+    ///
+    /// \brief SwapsCount
+    /// \return Finished swaps
+    ///
+    size_t SwapsCount() const
+    {
+        return m_swapsCount;
+    }
+
+private:
+    tracking::Detectors m_detectorType;
+    cv::UMat m_initFrame;
+
+    std::unique_ptr<BaseDetector> m_active;        // Is used only by the thread of Detect
+    std::vector<cv::Rect> m_trackedRects;          // Are passed to the new detector
+
+    std::mutex m_pendingMutex;
+    std::unique_ptr<BaseDetector> m_pending;       // Loaded and warmed up
+    std::atomic<bool> m_hasPending{ false };
+    std::atomic<bool> m_loading{ false };
+    std::thread m_loadThread;
+    std::thread m_releaseThread;
+    size_t m_swapsCount = 0;
+
+    std::unique_ptr<BaseDetector> Load(const config_t& config);
+    void TakePending();
+};
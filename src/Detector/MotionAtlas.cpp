@@ -0,0 +1,167 @@
+#include <iostream>
+#include "MotionAtlas.h"
+#include "execution_policy.h"
+
+///
+/// \brief MotionAtlas::MotionAtlas
+/// \param algType
+/// \param channels
+/// \param maxStreams
+///
+MotionAtlas::MotionAtlas(BackgroundSubtract::BGFG_ALGS algType, int channels, size_t maxStreams)
+    : m_backgroundSubst(algType, channels), m_maxStreams(std::max<size_t>(1, maxStreams))
+{
+}
+
+///
+/// \brief MotionAtlas::Init
+/// \param config
+/// \return
+///
+bool MotionAtlas::Init(const config_t& config)
+{
+    if (!m_backgroundSubst.Init(config))
+        return false;
+    if (!m_atlas.empty())
+        m_backgroundSubst.SetTiles(m_tileSize.height, m_tilePitch);
+    return true;
+}
+
+///
+/// \brief MotionAtlas::Allocate
+/// \param frameSize
+/// \param scale
+/// \param type
+/// \return
+///
+bool MotionAtlas::Allocate(cv::Size frameSize, double scale, int type)
+{
+    m_tileSize = cv::Size(std::max(1, cvRound(scale * frameSize.width)), std::max(1, cvRound(scale * frameSize.height)));
+    m_tilePitch = m_tileSize.height + TileGap;
+    m_atlas.create(static_cast<int>(m_maxStreams) * m_tilePitch - TileGap, m_tileSize.width, type);
+    m_atlas.setTo(cv::Scalar::all(0));
+    m_backgroundSubst.SetTiles(m_tileSize.height, m_tilePitch);
+    std::cout << "MotionAtlas: " << m_maxStreams << " tiles " << m_tileSize << " in " << m_atlas.size() << std::endl;
+    return !m_atlas.empty();
+}
+
+///
+/// \brief MotionAtlas::Tile
+/// \param streamId
+/// \return Tile of the stream or -1 if all tiles are used by the other streams
+///
+int MotionAtlas::Tile(size_t streamId)
+{
+    auto it = m_tiles.find(streamId);
+    if (it != std::end(m_tiles))
+        return static_cast<int>(it->second);
+
+    if (m_tiles.size() >= m_maxStreams)
+    {
+        if (!m_tilesWarned)
+            std::cerr << "MotionAtlas: all " << m_maxStreams << " tiles are used, the stream " << streamId << " isn't detected" << std::endl;
+        m_tilesWarned = true;
+        return -1;
+    }
+    const size_t tile = m_tiles.size();
+    m_tiles.emplace(streamId, tile);
+    return static_cast<int>(tile);
+}
+
+///
+/// \brief MotionAtlas::Put
+/// The frame is converted to the channels of the model and resized into the tile without the intermediate copy
+/// \param frame
+/// \param tile
+///
+void MotionAtlas::Put(const cv::UMat& frame, size_t tile)
+{
+    cv::UMat dst(m_atlas, TileRect(tile));
+
+    const cv::UMat* src = &frame;
+    if (frame.channels() != m_atlas.channels())
+    {
+        int code = cv::COLOR_BGR2GRAY;
+        if (frame.channels() == 1)
+            code = cv::COLOR_GRAY2BGR;
+        else if (frame.channels() == 4)
+            code = (m_atlas.channels() == 1) ? cv::COLOR_BGRA2GRAY : cv::COLOR_BGRA2BGR;
+        cv::cvtColor(frame, m_converted, code);
+        src = &m_converted;
+    }
+    if (src->size() == m_tileSize)
+        src->copyTo(dst);
+    else
+        cv::resize(*src, dst, m_tileSize, 0, 0, cv::INTER_AREA);
+}
+
+///
+/// \brief MotionAtlas::Update
+/// \param streamIds
+/// \param frames
+/// \param scale
+///
+void MotionAtlas::Update(const std::vector<size_t>& streamIds, const std::vector<cv::UMat>& frames, double scale)
+{
+    m_foregrounds.resize(frames.size());
+    if (frames.empty())
+        return;
+    if (m_atlas.empty() && !Allocate(frames.front().size(), scale, CV_8UC(m_backgroundSubst.m_channels)))
+        return;
+
+    m_done.assign(frames.size(), 0);
+    size_t left = frames.size();
+    while (left > 0)
+    {
+        // One frame of the every stream in the step
+        m_stepTiles.assign(m_maxStreams, 0);
+        m_stepFrames.clear();
+        for (size_t i = 0; i < frames.size(); ++i)
+        {
+            if (m_done[i])
+                continue;
+            const int tile = Tile(streamIds[i]);
+            if (tile < 0 || frames[i].empty())
+            {
+                m_foregrounds[i].release();
+                m_done[i] = 1;
+                --left;
+                continue;
+            }
+            if (m_stepTiles[tile])
+                continue;
+            m_stepTiles[tile] = 1;
+            Put(frames[i], static_cast<size_t>(tile));
+            m_stepFrames.push_back(i);
+        }
+        if (m_stepFrames.empty())
+            break;
+
+        m_backgroundSubst.Subtract(m_atlas, m_atlasFg);
+
+        cv::Mat fg = exec::MapToHost(m_atlasFg, "MotionAtlas::Update");
+        for (size_t i : m_stepFrames)
+        {
+            fg(TileRect(m_tiles[streamIds[i]])).copyTo(m_foregrounds[i]);
+            m_done[i] = 1;
+            --left;
+        }
+    }
+}
+
+///
+/// \brief MotionAtlas::ResetModel
+/// \param streamId
+/// \param roiRect
+///
+void MotionAtlas::ResetModel(size_t streamId, const cv::Rect& roiRect)
+{
+    auto it = m_tiles.find(streamId);
+    if (it == std::end(m_tiles))
+        return;
+
+    const cv::Rect tileRect = TileRect(it->second);
+    const cv::Rect roi = roiRect & cv::Rect(0, 0, m_tileSize.width, m_tileSize.height);
+    if (!roi.empty())
+        m_backgroundSubst.ResetModel(m_atlas, roi + tileRect.tl());
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <unordered_map>
+#include "BackgroundSubtract.h"
+
+///
+/// \brief The MotionAtlas class
+/// Background subtraction of many low resolution streams by one model: the frames of the streams are the tiles of one atlas
+/// one under another, so the background models of all streams are in one device allocation and the every step of the
+/// algorithm (ViBe match and update, MOG2, the median filter) is one kernel for the all streams. The foreground is mapped
+/// to the host once for the all tiles. The tiles are separated by the background rows for the 3x3 filter.
+/// The tile of the stream gets the stream on the first frame, the tiles of the streams without the frame in the step
+/// are updated by their last frame
+///
+class MotionAtlas
+{
+public:
+    ///
+    /// \brief MotionAtlas
+    /// \param algType
+    /// \param channels
+    /// \param maxStreams - count of the tiles
+    ///
+    MotionAtlas(BackgroundSubtract::BGFG_ALGS algType, int channels, size_t maxStreams);
+
+    ///
+    /// \brief Init
+    /// \param config - background subtraction params
+    /// \return
+    ///
+    bool Init(const config_t& config);
+
+    ///
+    /// \brief Update
+    /// The frames of the same stream are subtracted by the sequential steps in their order
+    /// \param streamIds - stream of the every frame
+    /// \param frames - any size, they are resized to the tile size (of the first frame scaled by scale)
+    /// \param scale - of the first frame to the tile
+    ///
+    void Update(const std::vector<size_t>& streamIds, const std::vector<cv::UMat>& frames, double scale);
+
+    ///
+    /// \brief Foreground
+    /// \param ind - frame of the last Update
+    /// \return Binary mask of the tile size, empty if the frame has no tile
+    ///
+    const cv::Mat& Foreground(size_t ind) const
+    {
+        return m_foregrounds[ind];
+    }
+
+    ///
+    cv::Size TileSize() const
+    {
+        return m_tileSize;
+    }
+
+    ///
+    size_t MaxStreams() const
+    {
+        return m_maxStreams;
+    }
+
+    ///
+    /// \brief ResetModel
+    /// The model of the rect is reset by the last frame of the stream
+    /// \param streamId
+    /// \param roiRect - on the tile
+    ///
+    void ResetModel(size_t streamId, const cv::Rect& roiRect);
+
+private:
+    static constexpr int TileGap = 2;
+
+    BackgroundSubtract m_backgroundSubst;
+    size_t m_maxStreams = 1;
+
+    cv::Size m_tileSize;
+    int m_tilePitch = 0;
+    cv::UMat m_atlas;
+    cv::UMat m_atlasFg;
+    cv::UMat m_converted;
+
+    std::unordered_map<size_t, size_t> m_tiles; // Stream -> tile
+    bool m_tilesWarned = false;
+
+    std::vector<cv::Mat> m_foregrounds;
+    std::vector<size_t> m_stepFrames;
+    std::vector<char> m_stepTiles;
+    std::vector<char> m_done;
+
+    bool Allocate(cv::Size frameSize, double scale, int type);
+    int Tile(size_t streamId);
+    cv::Rect TileRect(size_t tile) const
+    {
+        return cv::Rect(0, static_cast<int>(tile) * m_tilePitch, m_tileSize.width, m_tileSize.height);
+    }
+    void Put(const cv::UMat& frame, size_t tile);
+};
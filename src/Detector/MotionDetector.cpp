@@ -1,3 +1,4 @@
+#include <fstream>
 #include "MotionDetector.h"
 
 ///
@@ -17,6 +18,16 @@ MotionDetector::MotionDetector(
 	m_backgroundSubst = std::make_unique<BackgroundSubtract>(algType, gray.channels());
 }
 
+///
+/// \brief MotionDetector::~MotionDetector
+///
+MotionDetector::~MotionDetector(void)
+{
+    StopAsync();
+    if (!m_bgModelFile.empty() && m_framesCount > 0)
+        m_backgroundSubst->SaveModel(m_bgModelFile);
+}
+
 ///
 /// \brief MotionDetector::Init
 /// \param config
@@ -28,51 +39,322 @@ bool MotionDetector::Init(const config_t& config)
     if (conf != config.end())
         m_useRotatedRect = std::stoi(conf->second) != 0;
 
-    return m_backgroundSubst->Init(config);
+    conf = config.find("motionScale");
+    if (conf != config.end())
+        m_scale = std::max(0.05, std::min(1., std::stod(conf->second)));
+
+    conf = config.find("motionRefine");
+    if (conf != config.end())
+        m_refine = std::stoi(conf->second) != 0;
+
+    conf = config.find("motionRefineThreshold");
+    if (conf != config.end())
+        m_refineThreshold = std::stoi(conf->second);
+
+    conf = config.find("bgModelFile");
+    if (conf != config.end())
+        m_bgModelFile = conf->second;
+
+    conf = config.find("bgModelSavePeriod");
+    if (conf != config.end())
+        m_bgModelSavePeriod = static_cast<size_t>(std::max(0, std::stoi(conf->second)));
+
+    if (!m_backgroundSubst->Init(config))
+        return false;
+
+    conf = config.find("motionStreams");
+    if (conf != config.end() && std::stoi(conf->second) > 0)
+    {
+        m_atlas = std::make_unique<MotionAtlas>(m_algType, m_backgroundSubst->m_channels, static_cast<size_t>(std::stoi(conf->second)));
+        if (!m_atlas->Init(config))
+            return false;
+    }
+
+    // The saved model is optional: without the file the background is learned from scratch
+    if (!m_bgModelFile.empty() && std::ifstream(m_bgModelFile).good())
+    {
+        if (m_backgroundSubst->LoadModel(m_bgModelFile))
+            std::cout << "MotionDetector: the background model was restored from " << m_bgModelFile << std::endl;
+    }
+    return true;
 }
 
 ///
 /// \brief MotionDetector::DetectContour
+/// \param fg - foreground
+/// \param scale - of the frame to the foreground
+/// \param regions
 ///
-void MotionDetector::DetectContour()
+void MotionDetector::DetectContour(cv::InputArray fg, double scale, regions_t& regions)
 {
-	m_regions.clear();
+	regions.clear();
+    if (!m_useRotatedRect)
+    {
+        DetectComponents(fg, scale, regions);
+        return;
+    }
+
+    // The foreground can be downscaled: the minimal size is compared in its scale and the regions are scaled back
+    const double invScale = 1. / scale;
+    const int minWidth = cvRound(scale * m_minObjectSize.width);
+    const int minHeight = cvRound(scale * m_minObjectSize.height);
     std::vector<std::vector<cv::Point>> contours;
     std::vector<cv::Vec4i> hierarchy;
 #if (CV_VERSION_MAJOR < 4)
-	cv::findContours(m_fg, contours, hierarchy, CV_RETR_EXTERNAL, CV_CHAIN_APPROX_SIMPLE, cv::Point());
+	cv::findContours(fg, contours, hierarchy, CV_RETR_EXTERNAL, CV_CHAIN_APPROX_SIMPLE, cv::Point());
 #else
-    cv::findContours(m_fg, contours, hierarchy, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE, cv::Point());
+    cv::findContours(fg, contours, hierarchy, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE, cv::Point());
 #endif
 	for (size_t i = 0; i < contours.size(); i++)
 	{
 		cv::Rect br = cv::boundingRect(contours[i]);
 
-		if (br.width >= m_minObjectSize.width &&
-			br.height >= m_minObjectSize.height)
+		if (br.width >= minWidth &&
+			br.height >= minHeight)
 		{
 			if (m_useRotatedRect)
 			{
 				cv::RotatedRect rr = cv::minAreaRect(contours[i]);
-				m_regions.push_back(CRegion(rr));
+				if (scale != 1.)
+					rr = cv::RotatedRect(rr.center * invScale, cv::Size2f(static_cast<float>(invScale * rr.size.width), static_cast<float>(invScale * rr.size.height)), rr.angle);
+				regions.push_back(CRegion(rr));
 			}
 			else
 			{
-				m_regions.push_back(CRegion(br));
+				if (scale != 1.)
+					br = cv::Rect(cvRound(invScale * br.x), cvRound(invScale * br.y), cvRound(invScale * br.width), cvRound(invScale * br.height));
+				regions.push_back(CRegion(br));
 			}
 		}
 	}
 }
 
+///
+/// \brief MotionDetector::DetectComponents
+/// Bounding rects of the foreground blobs from the connected components stats: faster than the contours on the noisy masks
+/// \param fg
+/// \param scale
+/// \param regions
+///
+void MotionDetector::DetectComponents(cv::InputArray fg, double scale, regions_t& regions)
+{
+    const int count = cv::connectedComponentsWithStats(fg, m_ccLabels, m_ccStats, m_ccCentroids, 8, CV_32S);
+
+    const double invScale = 1. / scale;
+    const int minWidth = cvRound(scale * m_minObjectSize.width);
+    const int minHeight = cvRound(scale * m_minObjectSize.height);
+
+    std::vector<cv::Rect> rects;
+    for (int i = 1; i < count; ++i) // 0 - background
+    {
+        const int* stat = m_ccStats.ptr<int>(i);
+        if (stat[cv::CC_STAT_WIDTH] >= minWidth && stat[cv::CC_STAT_HEIGHT] >= minHeight)
+            rects.emplace_back(stat[cv::CC_STAT_LEFT], stat[cv::CC_STAT_TOP], stat[cv::CC_STAT_WIDTH], stat[cv::CC_STAT_HEIGHT]);
+    }
+
+    // The external contours skip the blobs in the holes of other blobs, the components don't: the nested rects are removed
+    std::sort(rects.begin(), rects.end(), [](const cv::Rect& r1, const cv::Rect& r2) { return r1.area() > r2.area(); });
+    for (size_t i = 0; i < rects.size(); ++i)
+    {
+        bool nested = false;
+        for (size_t j = 0; j < i && !nested; ++j)
+        {
+            nested = (rects[i] & rects[j]) == rects[i];
+        }
+        if (nested)
+            continue;
+
+        cv::Rect br = rects[i];
+        if (scale != 1.)
+            br = cv::Rect(cvRound(invScale * br.x), cvRound(invScale * br.y), cvRound(invScale * br.width), cvRound(invScale * br.height));
+        regions.push_back(CRegion(br));
+    }
+}
+
 ///
 /// \brief MotionDetector::Detect
 /// \param gray
 ///
 void MotionDetector::Detect(const cv::UMat& gray)
 {
-    m_backgroundSubst->Subtract(gray, m_fg);
+    static metrics::Histogram& detectTime = DetectHistogram("motion", false);
+    metrics::ScopedTimer timer(detectTime);
+
+    const cv::UMat& frame = ScaledFrame(gray);
 
-	DetectContour();
+    if (!m_detectionMask.Enabled())
+    {
+        m_backgroundSubst->Subtract(frame, m_fg);
+    }
+    else
+    {
+        // The background model is only for the bounding rect of the mask, the masked pixels aren't foreground
+        const cv::Rect roi = ScaleRect(m_detectionMask.BoundingRect(gray.size()), frame.size());
+        m_fg.create(frame.size(), CV_8UC1);
+        m_fg.setTo(cv::Scalar(0));
+        if (!roi.empty())
+        {
+            m_backgroundSubst->Subtract(cv::UMat(frame, roi), m_roiFg);
+            cv::UMat fgRoi(m_fg, roi);
+            if (m_scale < 1.)
+            {
+                if (m_scaledMask.size() != frame.size())
+                    cv::resize(m_detectionMask.Mask(gray.size()), m_scaledMask, frame.size(), 0, 0, cv::INTER_NEAREST);
+                m_roiFg.copyTo(fgRoi, m_scaledMask(roi));
+            }
+            else
+            {
+                m_roiFg.copyTo(fgRoi, m_detectionMask.Mask(gray.size())(roi));
+            }
+        }
+    }
+
+	DetectContour(m_fg, m_scale, m_regions);
+
+    ++m_framesCount;
+    if (!m_bgModelFile.empty() && m_bgModelSavePeriod > 0 && m_framesCount % m_bgModelSavePeriod == 0)
+        m_backgroundSubst->SaveModel(m_bgModelFile);
+
+    if (m_refine && m_scale < 1.)
+    {
+        RefineRegions(gray);
+        gray.copyTo(m_prevGray);
+    }
+}
+
+///
+/// \brief MotionDetector::DetectStreams
+/// \param streamIds
+/// \param frames
+/// \param regions
+///
+void MotionDetector::DetectStreams(const std::vector<size_t>& streamIds, const std::vector<cv::UMat>& frames, std::vector<regions_t>& regions)
+{
+    if (!m_atlas)
+    {
+        BaseDetector::DetectStreams(streamIds, frames, regions);
+        return;
+    }
+
+    static metrics::Histogram& detectTime = DetectHistogram("motion_streams", true);
+    metrics::ScopedTimer timer(detectTime);
+
+    m_atlas->Update(streamIds, frames, m_scale);
+
+    regions.resize(frames.size());
+    for (size_t i = 0; i < frames.size(); ++i)
+    {
+        const cv::Mat& fg = m_atlas->Foreground(i);
+        if (fg.empty())
+        {
+            regions[i].clear();
+            continue;
+        }
+        // The tiles have the size of the first frame, the other frames are resized to them
+        DetectContour(fg, static_cast<double>(fg.cols) / frames[i].cols, regions[i]);
+    }
+    KeepLastDetects(regions);
+}
+
+///
+/// \brief MotionDetector::DetectDevice
+/// \param frame
+/// \return
+///
+bool MotionDetector::DetectDevice(const DeviceFrame& frame)
+{
+    if (!CanDeviceProcessing() || m_detectionMask.Enabled() || frame.empty())
+        return false;
+
+    static metrics::Histogram& detectTime = DetectHistogram("motion_device", false);
+    metrics::ScopedTimer timer(detectTime);
+
+    const cv::cuda::GpuMat image(frame.m_height, frame.m_width, CV_8UC(frame.m_channels), const_cast<uint8_t*>(frame.m_data), frame.m_pitch);
+    if (!m_backgroundSubst->SubtractDevice(image, m_fg))
+        return false;
+
+    DetectContour(m_fg, m_scale, m_regions);
+
+    ++m_framesCount;
+    if (!m_bgModelFile.empty() && m_bgModelSavePeriod > 0 && m_framesCount % m_bgModelSavePeriod == 0)
+        m_backgroundSubst->SaveModel(m_bgModelFile);
+    return true;
+}
+
+///
+/// \brief MotionDetector::ScaledFrame
+/// \param gray
+/// \return The frame for the background subtraction: the input or the downscaled input
+///
+const cv::UMat& MotionDetector::ScaledFrame(const cv::UMat& gray)
+{
+    if (m_scale >= 1.)
+        return gray;
+
+    const cv::Size scaledSize(std::max(1, cvRound(m_scale * gray.cols)), std::max(1, cvRound(m_scale * gray.rows)));
+    cv::resize(gray, m_scaledGray, scaledSize, 0, 0, cv::INTER_AREA);
+    return m_scaledGray;
+}
+
+///
+/// \brief MotionDetector::ScaleRect
+/// \param rect - rect on the full resolution frame
+/// \param frameSize - size of the scaled frame
+/// \return
+///
+cv::Rect MotionDetector::ScaleRect(const cv::Rect& rect, cv::Size frameSize) const
+{
+    if (m_scale >= 1.)
+        return rect;
+
+    const int left = cvFloor(m_scale * rect.x);
+    const int top = cvFloor(m_scale * rect.y);
+    const int right = cvCeil(m_scale * (rect.x + rect.width));
+    const int bottom = cvCeil(m_scale * (rect.y + rect.height));
+    return cv::Rect(left, top, right - left, bottom - top) & cv::Rect(0, 0, frameSize.width, frameSize.height);
+}
+
+///
+/// \brief MotionDetector::RefineRegions
+/// The scaled back rects are coarse: they are fitted to the changed pixels of the full resolution frames difference around them
+/// \param gray
+///
+void MotionDetector::RefineRegions(const cv::UMat& gray)
+{
+    if (m_prevGray.size() != gray.size() || m_prevGray.type() != gray.type())
+        return;
+
+    const cv::Rect frameRect(0, 0, gray.cols, gray.rows);
+    const int margin = cvCeil(1. / m_scale);
+    for (auto& region : m_regions)
+    {
+        if (m_useRotatedRect)
+            continue;
+
+        cv::Rect roi = region.m_brect;
+        roi.x -= margin;
+        roi.y -= margin;
+        roi.width += 2 * margin;
+        roi.height += 2 * margin;
+        roi &= frameRect;
+        if (roi.empty())
+            continue;
+
+        cv::absdiff(cv::UMat(gray, roi), cv::UMat(m_prevGray, roi), m_refineDiff);
+        if (m_refineDiff.channels() > 1)
+            cv::cvtColor(m_refineDiff, m_refineDiff, cv::COLOR_BGR2GRAY);
+        cv::threshold(m_refineDiff, m_refineDiff, m_refineThreshold, 255, cv::THRESH_BINARY);
+
+        std::vector<cv::Point> changed;
+        cv::findNonZero(m_refineDiff, changed);
+        if (changed.empty())
+            continue;
+
+        // The fine rect stays inside the coarse rect with the margin, a too small changed area keeps the coarse rect
+        const cv::Rect fine = cv::boundingRect(changed) + roi.tl();
+        if (fine.width >= m_minObjectSize.width && fine.height >= m_minObjectSize.height)
+            region = CRegion(fine);
+    }
 }
 
 ///
@@ -82,7 +364,18 @@ void MotionDetector::Detect(const cv::UMat& gray)
 ///
 void MotionDetector::ResetModel(const cv::UMat& img, const cv::Rect& roiRect)
 {
-	m_backgroundSubst->ResetModel(img, roiRect);
+    const cv::UMat& frame = ScaledFrame(img);
+    const cv::Rect scaledRect = ScaleRect(roiRect, frame.size());
+
+    if (m_detectionMask.Enabled())
+    {
+        const cv::Rect roi = ScaleRect(m_detectionMask.BoundingRect(img.size()), frame.size());
+        const cv::Rect resetRect = scaledRect & roi;
+        if (!resetRect.empty())
+            m_backgroundSubst->ResetModel(cv::UMat(frame, roi), resetRect - roi.tl());
+        return;
+    }
+	m_backgroundSubst->ResetModel(frame, scaledRect);
 }
 
 ///
@@ -91,30 +384,9 @@ void MotionDetector::ResetModel(const cv::UMat& img, const cv::Rect& roiRect)
 ///
 void MotionDetector::CalcMotionMap(cv::Mat& frame)
 {
-	if (m_motionMap.size() != frame.size())
-		m_motionMap = cv::Mat(frame.size(), CV_32FC1, cv::Scalar(0, 0, 0));
-
-	cv::normalize(m_fg, m_normFor, 255, 0, cv::NORM_MINMAX, m_motionMap.type());
-
-	double alpha = 0.95;
-	cv::addWeighted(m_motionMap, alpha, m_normFor, 1 - alpha, 0, m_motionMap);
+	if (!m_motionMapEnabled || m_fg.empty())
+		return;
 
-	const int chans = frame.channels();
-
-	const int height = frame.rows;
-#pragma omp parallel for
-	for (int y = 0; y < height; ++y)
-	{
-		uchar* imgPtr = frame.ptr(y);
-		float* moPtr = reinterpret_cast<float*>(m_motionMap.ptr(y));
-		for (int x = 0; x < frame.cols; ++x)
-		{
-			for (int ci = chans - 1; ci < chans; ++ci)
-			{
-				imgPtr[ci] = cv::saturate_cast<uchar>(imgPtr[ci] + moPtr[0]);
-			}
-			imgPtr += chans;
-			++moPtr;
-		}
-	}
+	cv::Mat fg = exec::MapToHost(m_fg, "MotionDetector::CalcMotionMap");
+	BlendMotionMap(frame, fg);
 }
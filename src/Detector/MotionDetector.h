@@ -2,6 +2,7 @@
 
 #include "BaseDetector.h"
 #include "BackgroundSubtract.h"
+#include "MotionAtlas.h"
 
 ///
 /// \brief The MotionDetector class
@@ -10,12 +11,54 @@ class MotionDetector final : public BaseDetector
 {
 public:
     MotionDetector(BackgroundSubtract::BGFG_ALGS algType, cv::UMat& gray);
-    ~MotionDetector(void) = default;
+    ~MotionDetector(void);
 
+    ///
+    /// \brief Init
+    /// \param config - "useRotatedRect", "motionScale" (0..1, the background subtraction on the downscaled frame),
+    ///                  "motionRefine" (refine the rects on the full resolution), "motionRefineThreshold",
+    ///                  "bgModelFile" (the background model is loaded on start and saved on exit), "bgModelSavePeriod" (frames, 0 - only on exit),
+    ///                  "bgfgCuda" (MOG and MOG2 on the GPU), "motionStreams" (tiles of MotionAtlas for DetectStreams)
+    ///                  and the background subtraction params
+    /// \return
+    ///
     bool Init(const config_t& config);
 
     void Detect(const cv::UMat& gray);
 
+    ///
+    /// \brief DetectStreams
+    /// With "motionStreams" the frames of all streams are subtracted by one MotionAtlas: one kernel of the every step for the batch.
+    /// The detection mask and the refinement are only on the single stream path
+    /// \param streamIds
+    /// \param frames
+    /// \param regions
+    ///
+    void DetectStreams(const std::vector<size_t>& streamIds, const std::vector<cv::UMat>& frames, std::vector<regions_t>& regions);
+
+    ///
+    /// \brief MaxBatchSize
+    /// \return Tiles of the atlas
+    ///
+    size_t MaxBatchSize() const
+    {
+        return m_atlas ? m_atlas->MaxStreams() : 1;
+    }
+
+    ///
+    /// \brief DetectDevice
+    /// The background is subtracted on the device frame, only the mask is downloaded for the regions.
+    /// The downscale, the refinement and the detection mask are on the host path
+    /// \param frame
+    /// \return
+    ///
+    bool DetectDevice(const DeviceFrame& frame);
+
+    bool CanDeviceProcessing() const
+    {
+        return m_backgroundSubst->CudaBackend() && m_scale >= 1. && !m_refine;
+    }
+
 	bool CanGrayProcessing() const
 	{
 		return true;
@@ -26,12 +69,39 @@ public:
 	void ResetModel(const cv::UMat& img, const cv::Rect& roiRect);
 
 private:
-    void DetectContour();
+    void DetectContour(cv::InputArray fg, double scale, regions_t& regions);
+    void DetectComponents(cv::InputArray fg, double scale, regions_t& regions);
+    void RefineRegions(const cv::UMat& gray);
+    const cv::UMat& ScaledFrame(const cv::UMat& gray);
+    cv::Rect ScaleRect(const cv::Rect& rect, cv::Size frameSize) const;
 
     std::unique_ptr<BackgroundSubtract> m_backgroundSubst;
+    std::unique_ptr<MotionAtlas> m_atlas; // Models of the streams of DetectStreams
 
     cv::UMat m_fg;
+    cv::UMat m_roiFg; // Foreground of the bounding rect of the detection mask
+
+    // Connected components of the foreground for the bounding rects mode
+    cv::Mat m_ccLabels;
+    cv::Mat m_ccStats;
+    cv::Mat m_ccCentroids;
 
     BackgroundSubtract::BGFG_ALGS m_algType = BackgroundSubtract::BGFG_ALGS::ALG_MOG2;
     bool m_useRotatedRect = false;
+
+    // The background is subtracted on the frame downscaled by m_scale, the regions are scaled back
+    double m_scale = 1.;
+    cv::UMat m_scaledGray;
+    cv::Mat m_scaledMask;
+
+    // Refinement of the scaled back rects by the frames difference on the full resolution
+    bool m_refine = false;
+    int m_refineThreshold = 15;
+    cv::UMat m_prevGray;
+    cv::UMat m_refineDiff;
+
+    // Warm restart: the snapshot of the background model
+    std::string m_bgModelFile;
+    size_t m_bgModelSavePeriod = 0;
+    size_t m_framesCount = 0;
 };
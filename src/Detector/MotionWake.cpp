@@ -0,0 +1,69 @@
+#include <algorithm>
+#include <iostream>
+#include "MotionWake.h"
+
+///
+/// \brief MotionWake::MotionWake
+/// \param idlePeriod
+/// \param motionScale
+/// \param diffThreshold
+/// \param motionThreshold
+///
+MotionWake::MotionWake(int idlePeriod, double motionScale, int diffThreshold, double motionThreshold)
+    : m_idlePeriod(std::max(1, idlePeriod)),
+      m_motionScale(std::min(1., std::max(0.02, motionScale))),
+      m_diffThreshold(std::max(1, diffThreshold)),
+      m_motionThreshold(std::max(0., motionThreshold))
+{
+}
+
+///
+/// \brief MotionWake::NeedProcess
+/// \param frame
+/// \param hasTracks
+/// \return
+///
+bool MotionWake::NeedProcess(const cv::UMat& frame, bool hasTracks)
+{
+    // The difference is calculated on the every frame: the previous small frame must be the last captured
+    const bool motion = HasMotion(frame);
+    const bool need = motion || hasTracks || (++m_framesFromProcess >= m_idlePeriod);
+    if (need)
+    {
+        m_framesFromProcess = 0;
+        ++m_processedCount;
+    }
+
+    if (++m_framesCount % 500 == 0)
+    {
+        std::cout << "MotionWake: " << (static_cast<double>(m_processedCount) / m_framesCount) << " of frames are processed" << std::endl;
+        m_framesCount = 0;
+        m_processedCount = 0;
+    }
+    return need;
+}
+
+///
+/// \brief MotionWake::HasMotion
+/// \param frame
+/// \return
+///
+bool MotionWake::HasMotion(const cv::UMat& frame)
+{
+    cv::UMat small;
+    cv::resize(frame, small, cv::Size(), m_motionScale, m_motionScale, cv::INTER_AREA);
+    if (small.channels() == 1)
+        m_smallFrame = small;
+    else
+        cv::cvtColor(small, m_smallFrame, cv::COLOR_BGR2GRAY);
+
+    bool motion = true;
+    if (m_prevSmallFrame.size() == m_smallFrame.size())
+    {
+        cv::absdiff(m_smallFrame, m_prevSmallFrame, m_diff);
+        cv::threshold(m_diff, m_diff, m_diffThreshold, 255, cv::THRESH_BINARY);
+        motion = cv::countNonZero(m_diff) > m_motionThreshold * m_diff.total();
+    }
+    std::swap(m_smallFrame, m_prevSmallFrame);
+    return motion;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "defines.h"
+
+///
+/// \brief The MotionWake class
+/// Gate of the whole pipeline for the fixed camera: while there are no tracks and no motion on the cheap low resolution
+/// difference of the consecutive frames only the every idlePeriod frame goes to the detector and the tracker.
+/// The normal rate returns immediately on the motion or with the active tracks
+///
+class MotionWake
+{
+public:
+    ///
+    /// \brief MotionWake
+    /// \param idlePeriod - the every idlePeriod frame is processed without the motion and tracks
+    /// \param motionScale - scale of the difference frame
+    /// \param diffThreshold - min brightness difference of the changed pixel
+    /// \param motionThreshold - min part of the changed pixels for the motion
+    ///
+    MotionWake(int idlePeriod, double motionScale, int diffThreshold, double motionThreshold);
+
+    ///
+    /// \brief NeedProcess
+    /// \param frame - color or gray frame
+    /// \param hasTracks - the tracker has the active tracks
+    /// \return true if the frame needs detection and tracking
+    ///
+    bool NeedProcess(const cv::UMat& frame, bool hasTracks);
+
+private:
+    int m_idlePeriod = 10;
+    double m_motionScale = 0.125;
+    int m_diffThreshold = 25;
+    double m_motionThreshold = 0.001;
+
+    cv::UMat m_smallFrame;
+    cv::UMat m_prevSmallFrame;
+    cv::UMat m_diff;
+
+    int m_framesFromProcess = 0;
+    size_t m_framesCount = 0;
+    size_t m_processedCount = 0;
+
+    bool HasMotion(const cv::UMat& frame);
+};
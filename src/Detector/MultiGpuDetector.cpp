@@ -0,0 +1,311 @@
+#include <sstream>
+#include <algorithm>
+#include <iostream>
+#include "MultiGpuDetector.h"
+
+///
+/// \brief MultiGpuDetector::MultiGpuDetector
+/// \param detectorType
+/// \param colorFrame
+///
+MultiGpuDetector::MultiGpuDetector(tracking::Detectors detectorType, const cv::UMat& colorFrame)
+    : BaseDetector(colorFrame), m_detectorType(detectorType), m_initFrame(colorFrame)
+{
+}
+
+///
+/// \brief MultiGpuDetector::~MultiGpuDetector
+///
+MultiGpuDetector::~MultiGpuDetector(void)
+{
+    StopAsync();
+    Stop();
+}
+
+///
+/// \brief MultiGpuDetector::Init
+/// \param config
+/// \return
+///
+bool MultiGpuDetector::Init(const config_t& config)
+{
+    Stop();
+
+    // The device is "<gpu>" or "<gpu>:dla<core>" for the DLA engine on Jetson
+    std::vector<std::pair<int, int>> gpuIds;
+    auto gpuIdsIt = config.find("gpuIds");
+    if (gpuIdsIt != config.end())
+    {
+        std::istringstream ids(gpuIdsIt->second);
+        std::string id;
+        while (std::getline(ids, id, ','))
+        {
+            if (id.find_first_not_of(" \t") == std::string::npos)
+                continue;
+            int dlaCore = -1;
+            const size_t dlaPos = id.find(":dla");
+            if (dlaPos != std::string::npos)
+                dlaCore = std::max(0, std::stoi(id.substr(dlaPos + 4)));
+            gpuIds.emplace_back(std::max(0, std::stoi(id.substr(0, dlaPos))), dlaCore);
+        }
+    }
+    if (gpuIds.empty())
+    {
+        std::cerr << "MultiGpuDetector: empty gpuIds" << std::endl;
+        return false;
+    }
+
+    // Engines of the all GPUs are loaded in parallel
+    m_stop = false;
+    std::vector<std::future<bool>> ready;
+    for (auto gpuId : gpuIds)
+    {
+        config_t deviceConfig = config;
+        deviceConfig.erase("gpuIds");
+        // The frames of one camera are shared by the GPUs
+        deviceConfig.erase("tilesMotionGate");
+        deviceConfig.erase("tilesCache");
+        deviceConfig.erase("gpuId");
+        deviceConfig.emplace("gpuId", std::to_string(gpuId.first));
+        deviceConfig.erase("dlaCore");
+        if (gpuId.second >= 0)
+            deviceConfig.emplace("dlaCore", std::to_string(gpuId.second));
+
+        m_devices.emplace_back(std::make_unique<Device>());
+        Device* device = m_devices.back().get();
+        device->m_gpuId = gpuId.first;
+        device->m_dlaCore = gpuId.second;
+
+        std::promise<bool> deviceReady;
+        ready.emplace_back(deviceReady.get_future());
+        device->m_thread = std::thread(&MultiGpuDetector::Worker, this, device, std::move(deviceConfig), std::move(deviceReady));
+    }
+    bool res = true;
+    for (size_t i = 0; i < ready.size(); ++i)
+    {
+        if (!ready[i].get())
+        {
+            std::cerr << "MultiGpuDetector: detector on GPU " << m_devices[i]->m_gpuId;
+            if (m_devices[i]->m_dlaCore >= 0)
+                std::cerr << " DLA " << m_devices[i]->m_dlaCore;
+            std::cerr << " wasn't created" << std::endl;
+            res = false;
+        }
+    }
+    if (!res)
+        Stop();
+    return res;
+}
+
+///
+/// \brief MultiGpuDetector::Detect
+/// \param colorFrame
+///
+void MultiGpuDetector::Detect(const cv::UMat& colorFrame)
+{
+    std::vector<cv::UMat> frames = { colorFrame };
+    std::vector<std::future<regions_t>> results = Dispatch(frames, 0, 1);
+    m_regions = results.front().get();
+}
+
+///
+/// \brief MultiGpuDetector::Detect
+/// The frames are split on the batches of the detectors, the batches run on the all GPUs together
+/// \param frames
+/// \param regions
+///
+void MultiGpuDetector::Detect(const std::vector<cv::UMat>& frames, std::vector<regions_t>& regions)
+{
+    std::vector<std::future<regions_t>> results;
+    results.reserve(frames.size());
+    for (size_t i = 0; i < frames.size(); i += m_batchSize)
+    {
+        auto batchResults = Dispatch(frames, i, std::min(m_batchSize, frames.size() - i));
+        for (auto& res : batchResults)
+        {
+            results.emplace_back(std::move(res));
+        }
+    }
+    regions.resize(frames.size());
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        regions[i] = results[i].get();
+    }
+    KeepLastDetects(regions);
+}
+
+///
+/// \brief MultiGpuDetector::DetectAsync
+/// Blocks while the every GPU has MaxInFlight frames
+/// \param colorFrame
+/// \return
+///
+std::future<regions_t> MultiGpuDetector::DetectAsync(const cv::UMat& colorFrame)
+{
+    const size_t maxInFlight = MaxInFlight();
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_freeCond.wait(lock, [this, maxInFlight]()
+        {
+            return m_devices.empty() ||
+                std::any_of(std::begin(m_devices), std::end(m_devices), [maxInFlight](const std::unique_ptr<Device>& device) { return device->m_load < maxInFlight; });
+        });
+    }
+    std::vector<cv::UMat> frames = { colorFrame };
+    return std::move(Dispatch(frames, 0, 1).front());
+}
+
+///
+/// \brief MultiGpuDetector::Dispatch
+/// \param frames
+/// \param from
+/// \param count
+/// \return
+///
+std::vector<std::future<regions_t>> MultiGpuDetector::Dispatch(const std::vector<cv::UMat>& frames, size_t from, size_t count)
+{
+    Task task;
+    std::vector<std::future<regions_t>> results;
+    task.m_frames.assign(std::begin(frames) + from, std::begin(frames) + from + count);
+    task.m_results.resize(count);
+    for (auto& res : task.m_results)
+    {
+        results.emplace_back(res.get_future());
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_devices.empty())
+        {
+            auto error = std::make_exception_ptr(std::runtime_error("MultiGpuDetector: detectors weren't created"));
+            for (auto& res : task.m_results)
+            {
+                res.set_exception(error);
+            }
+            return results;
+        }
+        Device* device = m_devices[LeastLoaded()].get();
+        device->m_load += count;
+        device->m_queue.emplace_back(std::move(task));
+    }
+    m_cond.notify_all();
+    return results;
+}
+
+///
+/// \brief MultiGpuDetector::LeastLoaded
+/// Is called under m_mutex. The equal loads are shared in round robin
+/// \return
+///
+size_t MultiGpuDetector::LeastLoaded()
+{
+    size_t res = m_nextDevice % m_devices.size();
+    for (size_t i = 1; i < m_devices.size(); ++i)
+    {
+        size_t ind = (m_nextDevice + i) % m_devices.size();
+        if (m_devices[ind]->m_load < m_devices[res]->m_load)
+            res = ind;
+    }
+    m_nextDevice = res + 1;
+    return res;
+}
+
+///
+/// \brief MultiGpuDetector::Worker
+/// The detector is created, runs and is destroyed on the thread of its GPU
+/// \param device
+/// \param config
+/// \param ready
+///
+void MultiGpuDetector::Worker(Device* device, config_t config, std::promise<bool> ready)
+{
+    cv::UMat frame = m_initFrame;
+    device->m_detector = CreateDetector(m_detectorType, config, frame);
+    if (device->m_detector)
+    {
+        // The detections of the devices are moved to the results
+        device->m_detector->SetMotionMapEnabled(false);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_batchSize = std::max<size_t>(1, device->m_detector->MaxBatchSize());
+        m_canGrayProcessing = device->m_detector->CanGrayProcessing();
+    }
+    ready.set_value(device->m_detector != nullptr);
+    if (!device->m_detector)
+        return;
+
+    std::vector<regions_t> regions;
+    for (;;)
+    {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cond.wait(lock, [this, device]() { return m_stop || !device->m_queue.empty(); });
+            // The queued frames are detected before the stop
+            if (device->m_queue.empty())
+                break;
+            task = std::move(device->m_queue.front());
+            device->m_queue.pop_front();
+        }
+
+        try
+        {
+            if (task.m_frames.size() == 1)
+            {
+                device->m_detector->Detect(task.m_frames.front());
+                regions_t res;
+                device->m_detector->TakeDetects(res);
+                task.m_results.front().set_value(std::move(res));
+            }
+            else
+            {
+                regions.assign(task.m_frames.size(), regions_t());
+                device->m_detector->Detect(task.m_frames, regions);
+                for (size_t i = 0; i < task.m_results.size(); ++i)
+                {
+                    task.m_results[i].set_value(std::move(regions[i]));
+                }
+            }
+        }
+        catch (...)
+        {
+            auto error = std::current_exception();
+            for (auto& res : task.m_results)
+            {
+                try
+                {
+                    res.set_exception(error);
+                }
+                catch (const std::future_error&)
+                {
+                }
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            device->m_load -= task.m_frames.size();
+        }
+        m_freeCond.notify_all();
+    }
+    device->m_detector.reset();
+}
+
+///
+/// \brief MultiGpuDetector::Stop
+///
+void MultiGpuDetector::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cond.notify_all();
+    for (auto& device : m_devices)
+    {
+        if (device->m_thread.joinable())
+            device->m_thread.join();
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_devices.clear();
+    m_freeCond.notify_all();
+}
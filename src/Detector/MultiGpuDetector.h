@@ -0,0 +1,91 @@
+#pragma once
+
+#include "BaseDetector.h"
+
+///
+/// \brief The MultiGpuDetector class
+/// One detector of the same type on the every GPU of "gpuIds": the detectors are created and run by their own threads,
+/// the frames and the batches go to the per-GPU queues of the least loaded GPU.
+/// The detectors get the usual config with "gpuId" of their GPU and "dlaCore" of the DLA devices. The DLA engine and the GPU engine
+/// of one Jetson run concurrently: the slower DLA has the more queued frames, so the frames go to the GPU more often
+///
+class MultiGpuDetector final : public BaseDetector
+{
+public:
+    MultiGpuDetector(tracking::Detectors detectorType, const cv::UMat& colorFrame);
+    ~MultiGpuDetector(void);
+
+    ///
+    /// \brief Init
+    /// \param config - "gpuIds" is the comma separated list of the GPUs, for example "0,1,2,3", or of the DLA cores of the GPU: "0,0:dla0,0:dla1"
+    ///
+    bool Init(const config_t& config);
+
+    void Detect(const cv::UMat& colorFrame);
+    void Detect(const std::vector<cv::UMat>& frames, std::vector<regions_t>& regions);
+
+    std::future<regions_t> DetectAsync(const cv::UMat& colorFrame);
+
+    ///
+    /// \brief MaxBatchSize
+    /// \return Frames count which keeps all GPUs busy
+    ///
+    size_t MaxBatchSize() const
+    {
+        return m_batchSize * m_devices.size();
+    }
+
+    bool CanGrayProcessing() const
+    {
+        return m_canGrayProcessing;
+    }
+
+    ///
+    /// \brief DevicesCount
+    /// \return
+    ///
+    size_t DevicesCount() const
+    {
+        return m_devices.size();
+    }
+
+private:
+    ///
+    /// \brief The Task struct
+    ///
+    struct Task
+    {
+        std::vector<cv::UMat> m_frames;
+        std::vector<std::promise<regions_t>> m_results;
+    };
+
+    ///
+    /// \brief The Device struct
+    ///
+    struct Device
+    {
+        int m_gpuId = 0;
+        int m_dlaCore = -1;
+        std::unique_ptr<BaseDetector> m_detector; // Is used only by m_thread
+        std::thread m_thread;
+        std::deque<Task> m_queue;
+        size_t m_load = 0;                        // Queued and detecting frames
+    };
+
+    tracking::Detectors m_detectorType;
+    cv::UMat m_initFrame;
+    size_t m_batchSize = 1;
+    bool m_canGrayProcessing = false;
+
+    std::vector<std::unique_ptr<Device>> m_devices;
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    std::condition_variable m_freeCond;
+    size_t m_nextDevice = 0;
+    bool m_stop = false;
+
+    std::vector<std::future<regions_t>> Dispatch(const std::vector<cv::UMat>& frames, size_t from, size_t count);
+    size_t LeastLoaded();
+    void Worker(Device* device, config_t config, std::promise<bool> ready);
+    void Stop();
+};
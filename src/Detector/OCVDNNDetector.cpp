@@ -1,6 +1,8 @@
 #include <fstream>
+#include <algorithm>
 #include "OCVDNNDetector.h"
 #include "nms.h"
+#include "dnn_mapped.h"
 
 ///
 /// \brief OCVDNNDetector::OCVDNNDetector
@@ -54,7 +56,7 @@ bool OCVDNNDetector::Init(const config_t& config)
     auto modelConfiguration = config.find("modelConfiguration");
     auto modelBinary = config.find("modelBinary");
     if (modelConfiguration != config.end() && modelBinary != config.end())
-        m_net = cv::dnn::readNet(modelConfiguration->second, modelBinary->second, "");
+        m_net = dnn_mapped::ReadNet(modelBinary->second, modelConfiguration->second);
 
     auto dnnTarget = config.find("dnnTarget");
     if (dnnTarget != config.end())
@@ -102,6 +104,7 @@ bool OCVDNNDetector::Init(const config_t& config)
         {
             std::cout << "Succeded!" << std::endl;
             m_net.setPreferableBackend(backend->second);
+            m_dnnBackend = backend->second;
         }
         else
         {
@@ -130,16 +133,12 @@ bool OCVDNNDetector::Init(const config_t& config)
         }
     }
 
-	m_classesWhiteList.clear();
-	auto whiteRange = config.equal_range("white_list");
-	for (auto it = whiteRange.first; it != whiteRange.second; ++it)
-	{
-		m_classesWhiteList.insert(std::stoi(it->second));
-	}
+	ReadClassesFilter(config);
 
     auto confidenceThreshold = config.find("confidenceThreshold");
     if (confidenceThreshold != config.end())
         m_confidenceThreshold = std::stof(confidenceThreshold->second);
+    UpdateNetClassesThresholds(m_confidenceThreshold);
 
     auto nmsThreshold = config.find("nmsThreshold");
     if (nmsThreshold != config.end())
@@ -153,6 +152,10 @@ bool OCVDNNDetector::Init(const config_t& config)
     if (maxCropRatio != config.end())
         m_maxCropRatio = std::stof(maxCropRatio->second);
 
+    auto maxBatch = config.find("maxBatch");
+    if (maxBatch != config.end())
+        m_maxBatch = std::max(1, std::stoi(maxBatch->second));
+
     auto inWidth = config.find("inWidth");
     if (inWidth != config.end())
         m_inWidth = std::stoi(inWidth->second);
@@ -190,52 +193,219 @@ bool OCVDNNDetector::Init(const config_t& config)
 ///
 void OCVDNNDetector::Detect(const cv::UMat& colorFrame)
 {
+    static metrics::Histogram& detectTime = DetectHistogram("ocv_dnn", false);
+    metrics::ScopedTimer timer(detectTime);
+
     m_regions.clear();
 
-    regions_t tmpRegions;
-    if (m_maxCropRatio <= 0)
+    std::vector<cv::Rect> crops = FrameCrops(colorFrame);
+    std::vector<cv::UMat> images(crops.size(), colorFrame);
+    std::vector<RegionsSoA> cropsRegions;
+    DetectInCrops(images, crops, cropsRegions);
+    MergeCrops(cropsRegions, 0, cropsRegions.size(), colorFrame.size(), m_regions);
+}
+
+///
+/// \brief OCVDNNDetector::Detect
+/// The crops of the all frames are detected as one batch
+/// \param frames
+/// \param regions
+///
+void OCVDNNDetector::Detect(const std::vector<cv::UMat>& frames, std::vector<regions_t>& regions)
+{
+    static metrics::Histogram& detectTime = DetectHistogram("ocv_dnn", true);
+    metrics::ScopedTimer timer(detectTime);
+
+    std::vector<cv::UMat> images;
+    std::vector<cv::Rect> crops;
+    std::vector<size_t> firstCrop;
+    firstCrop.reserve(frames.size() + 1);
+    for (const auto& frame : frames)
     {
-        DetectInCrop(colorFrame, cv::Rect(0, 0, colorFrame.cols, colorFrame.rows), tmpRegions);
+        firstCrop.push_back(crops.size());
+        std::vector<cv::Rect> frameCrops = FrameCrops(frame);
+        images.insert(std::end(images), frameCrops.size(), frame);
+        crops.insert(std::end(crops), std::begin(frameCrops), std::end(frameCrops));
     }
-    else
+    firstCrop.push_back(crops.size());
+
+    std::vector<RegionsSoA> cropsRegions;
+    DetectInCrops(images, crops, cropsRegions);
+
+    regions.resize(frames.size());
+    for (size_t i = 0; i < frames.size(); ++i)
     {
-		std::vector<cv::Rect> crops = GetCrops(m_maxCropRatio, cv::Size(m_inWidth, m_inHeight), colorFrame.size());
-		for (size_t i = 0; i < crops.size(); ++i)
-		{
-			const auto& crop = crops[i];
-			//std::cout << "Crop " << i << ": " << crop << std::endl;
-			DetectInCrop(colorFrame, crop, tmpRegions);
-		}
+        MergeCrops(cropsRegions, firstCrop[i], firstCrop[i + 1], frames[i].size(), regions[i]);
     }
-    nms3<CRegion>(tmpRegions, m_regions, m_nmsThreshold,
-        [](const CRegion& reg) { return reg.m_brect; },
-        [](const CRegion& reg) { return reg.m_confidence; },
-        [](const CRegion& reg) { return reg.m_type; },
-        0, 0.f);
+    KeepLastDetects(regions);
 }
 
 ///
-/// \brief OCVDNNDetector::DetectInCrop
+/// \brief OCVDNNDetector::DetectAsync
+/// The network with Inference Engine backend and one output is started by forwardAsync without the worker thread:
+/// the crops of the frame are one request and the next frames are started before the results of the previous ones.
+/// Other configurations are detected by the worker of BaseDetector
 /// \param colorFrame
-/// \param crop
-/// \param tmpRegions
+/// \return
 ///
-void OCVDNNDetector::DetectInCrop(const cv::UMat& colorFrame, const cv::Rect& crop, regions_t& tmpRegions)
+std::future<regions_t> OCVDNNDetector::DetectAsync(const cv::UMat& colorFrame)
 {
-    //Convert Mat to batch of images
-    cv::dnn::blobFromImage(cv::UMat(colorFrame, crop), m_inputBlob, 1.0, cv::Size(m_inWidth, m_inHeight), m_meanVal, m_swapRB, false, CV_8U);
+#if (((CV_VERSION_MAJOR == 4) && (CV_VERSION_MINOR > 0)) || (CV_VERSION_MAJOR > 4))
+    const bool nativeAsync = (m_dnnBackend == cv::dnn::DNN_BACKEND_INFERENCE_ENGINE) && (m_outNames.size() == 1) &&
+            (m_net.getLayer(0)->outputNameToIndex("im_info") == -1);
+    if (!nativeAsync)
+        return BaseDetector::DetectAsync(colorFrame);
+
+    // Requests of Inference Engine are limited by the in flight depth
+    const size_t maxInFlight = MaxInFlight();
+    while (!m_asyncRequests.empty() && (m_asyncRequests.size() >= maxInFlight || m_asyncRequests.front().wait_for(0)))
+    {
+        while (!m_asyncRequests.front().wait_for(std::chrono::milliseconds(1)))
+        {
+        }
+        m_asyncRequests.pop_front();
+    }
+
+    std::vector<cv::Rect> crops = FrameCrops(colorFrame);
+    std::vector<cv::UMat> images;
+    images.reserve(crops.size());
+    for (const auto& crop : crops)
+    {
+        images.emplace_back(colorFrame, crop);
+    }
+    cv::Mat inputBlob;
+    cv::dnn::blobFromImages(images, inputBlob, 1.0, cv::Size(m_inWidth, m_inHeight), m_meanVal, m_swapRB, false, CV_8U);
+    m_net.setInput(inputBlob, "", m_inScaleFactor, m_meanVal);
+    cv::AsyncArray request = m_net.forwardAsync(m_outNames[0]);
+    m_asyncRequests.push_back(request);
 
-    m_net.setInput(m_inputBlob, "", m_inScaleFactor, m_meanVal); //set the network input
+    // Outputs are parsed in the thread of the caller by the future get
+    const cv::Size frameSize = colorFrame.size();
+    return std::async(std::launch::deferred, [this, request, crops, frameSize]() mutable
+    {
+        std::vector<cv::Mat> detections(1);
+        request.get(detections[0]);
+
+        std::vector<RegionsSoA> cropsRegions;
+        ParseDetections(detections, crops, cropsRegions);
+        regions_t regions;
+        MergeCrops(cropsRegions, 0, cropsRegions.size(), frameSize, regions);
+        return regions;
+    });
+#else
+    return BaseDetector::DetectAsync(colorFrame);
+#endif
+}
 
-    if (m_net.getLayer(0)->outputNameToIndex("im_info") != -1)  // Faster-RCNN or R-FCN
+///
+/// \brief OCVDNNDetector::FrameCrops
+/// \param colorFrame
+/// \return The bounding rect of the detection mask or the crops of the network size
+///
+std::vector<cv::Rect> OCVDNNDetector::FrameCrops(const cv::UMat& colorFrame) const
+{
+    if (m_maxCropRatio <= 0)
     {
-        //cv::resize(frame, frame, cv::Size(m_inWidth, m_inHeight));
-        cv::Mat imInfo = (cv::Mat_<float>(1, 3) << m_inHeight, m_inWidth, 1.6f);
-        m_net.setInput(imInfo, "im_info");
+        const cv::Rect area = m_detectionMask.BoundingRect(colorFrame.size());
+        return area.empty() ? std::vector<cv::Rect>() : std::vector<cv::Rect>(1, area);
     }
+    return GetCrops(m_maxCropRatio, cv::Size(m_inWidth, m_inHeight), colorFrame.size());
+}
+
+///
+/// \brief OCVDNNDetector::DetectInCrops
+/// All crops are one 4D blob and one forward. Faster-RCNN and R-FCN with im_info are detected by the crop
+/// \param images - image of the every crop
+/// \param crops
+/// \param cropsRegions - regions of the every crop in the image coordinates
+///
+void OCVDNNDetector::DetectInCrops(const std::vector<cv::UMat>& images, const std::vector<cv::Rect>& crops, std::vector<RegionsSoA>& cropsRegions)
+{
+    cropsRegions.assign(crops.size(), RegionsSoA());
+    if (crops.empty())
+        return;
+
+    const bool hasImInfo = m_net.getLayer(0)->outputNameToIndex("im_info") != -1;  // Faster-RCNN or R-FCN
+    const size_t batchSize = hasImInfo ? 1 : crops.size();
 
+    std::vector<cv::UMat> batch;
+    std::vector<cv::Rect> batchCrops;
+    std::vector<RegionsSoA> batchRegions;
     std::vector<cv::Mat> detections;
-    m_net.forward(detections, m_outNames); //compute output
+    for (size_t i = 0; i < crops.size(); i += batchSize)
+    {
+        const size_t count = std::min(batchSize, crops.size() - i);
+        StageTimer preprocessTime(m_stages.m_preprocess);
+        batch.clear();
+        for (size_t j = i; j < i + count; ++j)
+        {
+            batch.emplace_back(images[j], crops[j]);
+        }
+
+        //Convert Mat to batch of images
+        cv::dnn::blobFromImages(batch, m_inputBlob, 1.0, cv::Size(m_inWidth, m_inHeight), m_meanVal, m_swapRB, false, CV_8U);
+
+        m_net.setInput(m_inputBlob, "", m_inScaleFactor, m_meanVal); //set the network input
+
+        if (hasImInfo)
+        {
+            cv::Mat imInfo = (cv::Mat_<float>(1, 3) << m_inHeight, m_inWidth, 1.6f);
+            m_net.setInput(imInfo, "im_info");
+        }
+        preprocessTime.Stop();
+
+        {
+            StageTimer inferenceTime(m_stages.m_inference);
+            m_net.forward(detections, m_outNames); //compute output
+        }
+
+        batchCrops.assign(std::begin(crops) + i, std::begin(crops) + i + count);
+        ParseDetections(detections, batchCrops, batchRegions);
+        for (size_t j = 0; j < count; ++j)
+        {
+            cropsRegions[i + j] = std::move(batchRegions[j]);
+        }
+    }
+}
+
+///
+/// \brief OCVDNNDetector::MergeCrops
+/// \param cropsRegions
+/// \param from
+/// \param to
+/// \param frameSize
+/// \param regions
+///
+void OCVDNNDetector::MergeCrops(std::vector<RegionsSoA>& cropsRegions, size_t from, size_t to, cv::Size frameSize, regions_t& regions) const
+{
+    RegionsSoA tmpRegions;
+    size_t count = 0;
+    for (size_t i = from; i < to; ++i)
+    {
+        count += cropsRegions[i].size();
+    }
+    tmpRegions.reserve(count);
+    for (size_t i = from; i < to; ++i)
+    {
+        tmpRegions.append(cropsRegions[i]);
+    }
+    if (m_topK)
+        tmpRegions.KeepTopK(m_topK);
+    nms_regions(tmpRegions, regions, m_nmsThreshold);
+    m_detectionMask.Filter(regions, frameSize);
+}
+
+///
+/// \brief OCVDNNDetector::ParseDetections
+/// \param detections - outputs of the network for the batch of the crops
+/// \param crops
+/// \param cropsRegions - regions of the every crop
+///
+void OCVDNNDetector::ParseDetections(const std::vector<cv::Mat>& detections, const std::vector<cv::Rect>& crops, std::vector<RegionsSoA>& cropsRegions) const
+{
+    cropsRegions.assign(crops.size(), RegionsSoA());
+    if (crops.empty())
+        return;
 
     if (m_outLayerType == "DetectionOutput")
     {
@@ -247,9 +417,12 @@ void OCVDNNDetector::DetectInCrop(const cv::UMat& colorFrame, const cv::Rect& cr
             const float* data = reinterpret_cast<float*>(detections[k].data);
             for (size_t i = 0; i < detections[k].total(); i += 7)
             {
+                const size_t batchId = static_cast<size_t>(std::max(0.f, data[i]));
                 float confidence = data[i + 2];
-                if (confidence > m_confidenceThreshold)
+                size_t objectClass = (int)(data[i + 1]) - 1;
+                if (confidence > NetClassThreshold(objectClass) && batchId < crops.size())
                 {
+                    const cv::Rect& crop = crops[batchId];
                     int left = (int)data[i + 3];
                     int top = (int)data[i + 4];
                     int right = (int)data[i + 5];
@@ -265,9 +438,7 @@ void OCVDNNDetector::DetectInCrop(const cv::UMat& colorFrame, const cv::Rect& cr
                         width = right - left + 1;
                         height = bottom - top + 1;
                     }
-                    size_t objectClass = (int)(data[i + 1]) - 1;
-					if (m_classesWhiteList.empty() || m_classesWhiteList.find(T2T(objectClass)) != std::end(m_classesWhiteList))
-						tmpRegions.emplace_back(cv::Rect(left + crop.x, top + crop.y, width, height), T2T(objectClass), confidence);
+					cropsRegions[batchId].emplace_back(cv::Rect(left + crop.x, top + crop.y, width, height), T2T(objectClass), confidence);
                 }
             }
         }
@@ -277,16 +448,33 @@ void OCVDNNDetector::DetectInCrop(const cv::UMat& colorFrame, const cv::Rect& cr
         for (size_t i = 0; i < detections.size(); ++i)
         {
             // Network produces output blob with a shape NxC where N is a number of detected objects and C is a number of classes + 4 where the first 4
-            // numbers are [center_x, center_y, width, height]
+            // numbers are [center_x, center_y, width, height]. The rows of the batch go one crop after another
+            const int rowsPerCrop = detections[i].rows / static_cast<int>(crops.size());
             const float* data = reinterpret_cast<float*>(detections[i].data);
-            for (int j = 0; j < detections[i].rows; ++j, data += detections[i].cols)
+            const int classesCount = detections[i].cols - 5;
+            const float minThreshold = NetMinThreshold();
+            for (int j = 0; j < rowsPerCrop * static_cast<int>(crops.size()); ++j, data += detections[i].cols)
             {
-                cv::Mat scores = detections[i].row(j).colRange(5, detections[i].cols);
-                cv::Point classIdPoint;
-                double confidence = 0;
-                minMaxLoc(scores, 0, &confidence, 0, &classIdPoint);
-                if (confidence > m_confidenceThreshold)
+                // Scores of the classes aren't greater than the objectness
+                if (data[4] <= minThreshold)
+                    continue;
+
+                // The best class of the white list with its own threshold
+                const float* scores = data + 5;
+                int classId = -1;
+                float confidence = 0.f;
+                for (int c = 0; c < classesCount; ++c)
+                {
+                    if (scores[c] > confidence && NetClassThreshold(c) <= 1.f)
+                    {
+                        confidence = scores[c];
+                        classId = c;
+                    }
+                }
+                if (classId >= 0 && confidence > NetClassThreshold(classId))
                 {
+                    const size_t batchId = static_cast<size_t>(j / rowsPerCrop);
+                    const cv::Rect& crop = crops[batchId];
                     int centerX = (int)(data[0] * crop.width);
                     int centerY = (int)(data[1] * crop.height);
                     int width = (int)(data[2] * crop.width);
@@ -294,8 +482,7 @@ void OCVDNNDetector::DetectInCrop(const cv::UMat& colorFrame, const cv::Rect& cr
                     int left = centerX - width / 2;
                     int top = centerY - height / 2;
 
-					if (m_classesWhiteList.empty() || m_classesWhiteList.find(T2T(classIdPoint.x)) != std::end(m_classesWhiteList))
-						tmpRegions.emplace_back(cv::Rect(left + crop.x, top + crop.y, width, height), T2T(classIdPoint.x), static_cast<float>(confidence));
+					cropsRegions[batchId].emplace_back(cv::Rect(left + crop.x, top + crop.y, width, height), T2T(classId), confidence);
                 }
             }
         }
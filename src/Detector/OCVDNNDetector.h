@@ -12,11 +12,23 @@ class OCVDNNDetector final : public BaseDetector
 {
 public:
     OCVDNNDetector(const cv::UMat& colorFrame);
-    ~OCVDNNDetector(void) = default;
+    ~OCVDNNDetector(void) { StopAsync(); }
 
     bool Init(const config_t& config);
 
     void Detect(const cv::UMat& colorFrame);
+    void Detect(const std::vector<cv::UMat>& frames, std::vector<regions_t>& regions);
+
+    ///
+    /// \brief MaxBatchSize
+    /// \return "maxBatch" frames: the crops of the all frames are detected by one forward
+    ///
+    size_t MaxBatchSize() const
+    {
+        return m_maxBatch;
+    }
+
+    std::future<regions_t> DetectAsync(const cv::UMat& colorFrame);
 
     bool CanGrayProcessing() const
     {
@@ -26,7 +38,15 @@ public:
 private:
     cv::dnn::Net m_net;
 
-    void DetectInCrop(const cv::UMat& colorFrame, const cv::Rect& crop, regions_t& tmpRegions);
+    std::vector<cv::Rect> FrameCrops(const cv::UMat& colorFrame) const;
+    void DetectInCrops(const std::vector<cv::UMat>& images, const std::vector<cv::Rect>& crops, std::vector<RegionsSoA>& cropsRegions);
+    void ParseDetections(const std::vector<cv::Mat>& detections, const std::vector<cv::Rect>& crops, std::vector<RegionsSoA>& cropsRegions) const;
+    void MergeCrops(std::vector<RegionsSoA>& cropsRegions, size_t from, size_t to, cv::Size frameSize, regions_t& regions) const;
+
+    int m_dnnBackend = cv::dnn::DNN_BACKEND_DEFAULT;
+#if (((CV_VERSION_MAJOR == 4) && (CV_VERSION_MINOR > 0)) || (CV_VERSION_MAJOR > 4))
+    std::deque<cv::AsyncArray> m_asyncRequests; // Started requests of forwardAsync
+#endif
 
     int m_inWidth = 608;
     int m_inHeight = 608;
@@ -38,6 +58,7 @@ private:
     float m_nmsThreshold = 0.4f;
     bool m_swapRB = false;
     float m_maxCropRatio = 2.0f;
+    size_t m_maxBatch = 1;
     std::vector<std::string> m_classNames;
     std::vector<cv::String> m_outNames;
     std::vector<int> m_outLayers;
@@ -1,5 +1,7 @@
+#include <iostream>
 #include "PedestrianDetector.h"
 #include "nms.h"
+#include "task_scheduler.h"
 
 ///
 /// \brief PedestrianDetector::PedestrianDetector
@@ -33,8 +35,36 @@ bool PedestrianDetector::Init(const config_t& config)
     switch (m_detectorType)
     {
     case HOG:
+    {
         m_hog.setSVMDetector(cv::HOGDescriptor::getDefaultPeopleDetector());
+
+        // CUDA by default if it is available
+        std::string hogBackend = "CUDA";
+        auto hogBackendIt = config.find("hogBackend");
+        if (hogBackendIt != config.end())
+            hogBackend = hogBackendIt->second;
+
+        m_hogBackend = (hogBackend == "CPU_SCALES") ? HOG_CPUScales : HOG_CPU;
+        if (hogBackend == "CUDA")
+        {
+#ifdef HAVE_OPENCV_CUDAOBJDETECT
+            if (cv::cuda::getCudaEnabledDeviceCount() > 0)
+            {
+                m_cudaHOG = cv::cuda::HOG::create(m_hog.winSize, m_hog.blockSize, m_hog.blockStride, m_hog.cellSize, m_hog.nbins);
+                m_cudaHOG->setSVMDetector(m_cudaHOG->getDefaultPeopleDetector());
+                m_cudaHOG->setHitThreshold(0);
+                m_cudaHOG->setWinStride(cv::Size(8, 8));
+                m_cudaHOG->setScaleFactor(HOGScale);
+                m_cudaHOG->setGroupThreshold(HOGGroupThreshold);
+                m_hogBackend = HOG_CUDA;
+            }
+#endif
+            if (m_hogBackend != HOG_CUDA)
+                std::cout << "PedestrianDetector: CUDA HOG isn't available, CPU is used" << std::endl;
+        }
+        m_levelScales.clear();
         return true;
+    }
 
     case C4:
     {
@@ -64,18 +94,37 @@ bool PedestrianDetector::Init(const config_t& config)
 ///
 void PedestrianDetector::Detect(const cv::UMat& gray)
 {
+    static metrics::Histogram& detectTime = DetectHistogram("pedestrian", false);
+    metrics::ScopedTimer timer(detectTime);
+
     std::vector<cv::Rect> foundRects;
     std::vector<cv::Rect> filteredRects;
 
     int neighbors = 0;
     if (m_detectorType == HOG)
     {
-        m_hog.detectMultiScale(gray, foundRects, 0, cv::Size(8, 8), cv::Size(32, 32), 1.05, 4, false);
+        switch (m_hogBackend)
+        {
+        case HOG_CUDA:
+#ifdef HAVE_OPENCV_CUDAOBJDETECT
+            m_gpuFrame.upload(gray);
+            m_cudaHOG->detectMultiScale(m_gpuFrame, foundRects);
+#endif
+            break;
+
+        case HOG_CPUScales:
+            DetectHOGScales(exec::MapToHost(gray, "PedestrianDetector::Detect(HOG)"), foundRects);
+            break;
+
+        default:
+            m_hog.detectMultiScale(gray, foundRects, 0, cv::Size(8, 8), cv::Size(32, 32), HOGScale, HOGGroupThreshold, false);
+            break;
+        }
     }
     else
     {
         IntImage<double> original;
-        original.Load(gray.getMat(cv::ACCESS_READ));
+        original.Load(exec::MapToHost(gray, "PedestrianDetector::Detect(C4)"));
 
         m_scannerC4.FastScan(original, foundRects, 2);
         neighbors = 1;
@@ -94,3 +143,63 @@ void PedestrianDetector::Detect(const cv::UMat& gray)
         m_regions.push_back(rect);
     }
 }
+
+///
+/// \brief PedestrianDetector::DetectHOGScales
+/// The same detection as detectMultiScale: the pyramid levels are resized and detected in the parallel threads
+/// from the largest level, the rects of all levels are grouped together
+/// \param gray
+/// \param foundRects
+///
+void PedestrianDetector::DetectHOGScales(const cv::Mat& gray, std::vector<cv::Rect>& foundRects)
+{
+    constexpr int maxLevels = 64;
+    const cv::Size winSize = m_hog.winSize;
+
+    if (m_levelScales.empty() || m_levelsFrameSize != gray.size())
+    {
+        m_levelsFrameSize = gray.size();
+        m_levelScales.clear();
+        double scale = 1.;
+        for (int i = 0; i < maxLevels; ++i)
+        {
+            if (cvRound(gray.cols / scale) < winSize.width || cvRound(gray.rows / scale) < winSize.height)
+                break;
+            m_levelScales.push_back(scale);
+            scale *= HOGScale;
+        }
+        m_levels.assign(m_levelScales.size(), cv::Mat());
+        m_levelsRects.assign(m_levelScales.size(), std::vector<cv::Rect>());
+    }
+
+    const int levelsCount = static_cast<int>(m_levelScales.size());
+    tasks::ParallelFor(0, levelsCount, [&](int i)
+    {
+        const double scale = m_levelScales[i];
+        cv::Mat level = gray;
+        if (i > 0)
+        {
+            cv::Size levelSize(cvRound(gray.cols / scale), cvRound(gray.rows / scale));
+            cv::resize(gray, m_levels[i], levelSize, 0, 0, cv::INTER_LINEAR);
+            level = m_levels[i];
+        }
+
+        std::vector<cv::Point> locations;
+        std::vector<double> weights;
+        m_hog.detect(level, locations, weights, 0, cv::Size(8, 8), cv::Size(32, 32));
+
+        auto& levelRects = m_levelsRects[i];
+        levelRects.clear();
+        for (const auto& pt : locations)
+        {
+            levelRects.emplace_back(cvRound(pt.x * scale), cvRound(pt.y * scale), cvRound(winSize.width * scale), cvRound(winSize.height * scale));
+        }
+    }, 1);
+
+    foundRects.clear();
+    for (const auto& levelRects : m_levelsRects)
+    {
+        foundRects.insert(std::end(foundRects), std::begin(levelRects), std::end(levelRects));
+    }
+    cv::groupRectangles(foundRects, HOGGroupThreshold, 0.2);
+}
@@ -3,6 +3,10 @@
 #include "BaseDetector.h"
 #include "pedestrians/c4-pedestrian-detector.h"
 
+#ifdef HAVE_OPENCV_CUDAOBJDETECT
+#include <opencv2/cudaobjdetect.hpp>
+#endif
+
 ///
 /// \brief The PedestrianDetector class
 ///
@@ -15,8 +19,19 @@ public:
         C4
     };
 
+    ///
+    /// \brief The HOGBackends enum
+    /// CPU - detectMultiScale of OpenCV, CPUScales - the pyramid levels are detected in parallel threads
+    ///
+    enum HOGBackends
+    {
+        HOG_CPU,
+        HOG_CPUScales,
+        HOG_CUDA
+    };
+
     PedestrianDetector(const cv::UMat& gray);
-    ~PedestrianDetector(void) = default;
+    ~PedestrianDetector(void) { StopAsync(); }
 
     bool Init(const config_t& config);
 
@@ -35,6 +50,20 @@ private:
     /// HOG detector
     ///
     cv::HOGDescriptor m_hog;
+    HOGBackends m_hogBackend = HOG_CPU;
+    std::vector<double> m_levelScales;            // Scales of the pyramid for HOG_CPUScales
+    std::vector<cv::Mat> m_levels;                // Images of the pyramid levels are reused from frame to frame
+    cv::Size m_levelsFrameSize;
+    std::vector<std::vector<cv::Rect>> m_levelsRects;
+#ifdef HAVE_OPENCV_CUDAOBJDETECT
+    cv::Ptr<cv::cuda::HOG> m_cudaHOG;
+    cv::cuda::GpuMat m_gpuFrame;
+#endif
+
+    static constexpr double HOGScale = 1.05;
+    static constexpr int HOGGroupThreshold = 4;
+
+    void DetectHOGScales(const cv::Mat& gray, std::vector<cv::Rect>& foundRects);
 
     ///
     /// \brief m_scannerC4
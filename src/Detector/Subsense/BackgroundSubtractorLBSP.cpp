@@ -54,6 +54,82 @@ void BackgroundSubtractorLBSP::setROI(cv::Mat& oROI) {
 		m_oROI = oROI.clone();
 }
 
+void BackgroundSubtractorLBSP::initBands() {
+	// ~4 bands per thread for the load balancing; 2*BAND_HALO rows are enough, the twice higher bands keep the writes far apart
+	const int nMinBandRows = 4*BAND_HALO;
+	const int nBands = std::max(1,std::min(4*cv::getNumThreads(),m_oImgSize.height/nMinBandRows));
+	const int nBandRows = (m_oImgSize.height+nBands-1)/nBands;
+	m_vnBandModelIdx.assign(1,0);
+	for(size_t nModelIter=0; nModelIter<m_nTotRelevantPxCount; ++nModelIter) {
+		const size_t nBand = static_cast<size_t>(m_aPxInfoLUT[m_aPxIdxLUT[nModelIter]].nImgCoord_Y/nBandRows);
+		while(m_vnBandModelIdx.size()<=nBand)
+			m_vnBandModelIdx.push_back(nModelIter);
+	}
+	m_vnBandModelIdx.push_back(m_nTotRelevantPxCount);
+	m_nBandsRunIdx = 0;
+}
+
+void BackgroundSubtractorLBSP::exportBaseModel(ModelMats& mModel) const {
+	CV_Assert(m_bInitialized);
+	mModel["lastColor"] = m_oLastColorFrame.clone();
+	mModel["lastDesc"] = m_oLastDescFrame.clone();
+	mModel["lastFGMask"] = m_oLastFGMask.clone();
+	mModel["roi"] = m_oROI.clone();
+	cv::Mat oLBSPThresholds(1,UCHAR_MAX+1,CV_32SC1);
+	for(size_t t=0; t<=UCHAR_MAX; ++t)
+		oLBSPThresholds.at<int>(0,(int)t) = (int)m_anLBSPThreshold_8bitLUT[t];
+	mModel["lbspThresholds"] = oLBSPThresholds;
+	mModel["frameIndex"] = cv::Mat(1,1,CV_64FC1,cv::Scalar((double)m_nFrameIndex));
+}
+
+bool BackgroundSubtractorLBSP::importBaseModel(const ModelMats& mModel) {
+	auto itLastColor = mModel.find("lastColor");
+	auto itROI = mModel.find("roi");
+	if(itLastColor==mModel.end() || itROI==mModel.end() || itLastColor->second.empty()
+		|| (itLastColor->second.type()!=CV_8UC1 && itLastColor->second.type()!=CV_8UC3)
+		|| itROI->second.size()!=itLastColor->second.size() || itROI->second.type()!=CV_8UC1)
+		return false;
+	initialize(itLastColor->second.clone(),itROI->second.clone());
+	if(!importModelMat(mModel,"lastDesc",m_oLastDescFrame) || !importModelMat(mModel,"lastFGMask",m_oLastFGMask))
+		return false;
+	auto itLUT = mModel.find("lbspThresholds");
+	if(itLUT==mModel.end() || itLUT->second.type()!=CV_32SC1 || itLUT->second.total()!=UCHAR_MAX+1)
+		return false;
+	for(size_t t=0; t<=UCHAR_MAX; ++t)
+		m_anLBSPThreshold_8bitLUT[t] = (size_t)itLUT->second.at<int>(0,(int)t);
+	auto itFrameIndex = mModel.find("frameIndex");
+	if(itFrameIndex!=mModel.end() && itFrameIndex->second.type()==CV_64FC1 && itFrameIndex->second.total()==1)
+		m_nFrameIndex = (size_t)itFrameIndex->second.at<double>(0,0);
+	return true;
+}
+
+void BackgroundSubtractorLBSP::exportSamples(ModelMats& mModel, const std::vector<cv::Mat>& voColorSamples, const std::vector<cv::Mat>& voDescSamples) {
+	for(size_t s=0; s<voColorSamples.size(); ++s)
+		mModel["color_"+std::to_string(s)] = voColorSamples[s].clone();
+	for(size_t s=0; s<voDescSamples.size(); ++s)
+		mModel["desc_"+std::to_string(s)] = voDescSamples[s].clone();
+}
+
+bool BackgroundSubtractorLBSP::importSamples(const ModelMats& mModel, std::vector<cv::Mat>& voColorSamples, std::vector<cv::Mat>& voDescSamples) {
+	for(size_t s=0; s<voColorSamples.size(); ++s)
+		if(!importModelMat(mModel,"color_"+std::to_string(s),voColorSamples[s]))
+			return false;
+	for(size_t s=0; s<voDescSamples.size(); ++s)
+		if(!importModelMat(mModel,"desc_"+std::to_string(s),voDescSamples[s]))
+			return false;
+	return true;
+}
+
+bool BackgroundSubtractorLBSP::importModelMat(const ModelMats& mModel, const std::string& sName, cv::Mat& oDst) {
+	auto it = mModel.find(sName);
+	if(it==mModel.end() || it->second.size()!=oDst.size() || it->second.type()!=oDst.type()) {
+		std::cerr << "BackgroundSubtractorLBSP: the saved model has no matrix " << sName << " of the current size and type" << std::endl;
+		return false;
+	}
+	it->second.copyTo(oDst);
+	return true;
+}
+
 void BackgroundSubtractorLBSP::setAutomaticModelReset(bool bVal) {
 	m_bAutoModelResetEnabled = bVal;
 }
@@ -1,7 +1,12 @@
 #pragma once
 
 #include <opencv2/opencv.hpp>
+#include <vector>
+#include <map>
+#include <string>
 #include "LBSP.h"
+#include "RandUtils.h"
+#include "task_scheduler.h"
 
 /*!
 	Local Binary Similarity Pattern (LBSP)-based change detection algorithm (abstract version/base class).
@@ -34,6 +39,13 @@ public:
 	//! turns automatic model reset on or off
 	void setAutomaticModelReset(bool);
 
+	//! named matrices of the model state, used to save and restore the learned model
+	typedef std::map<std::string, cv::Mat> ModelMats;
+	//! exports the copy of the learned model state
+	virtual void exportModel(ModelMats& mModel) const = 0;
+	//! restores the model exported by exportModel (the model is initialized by the saved last frame first); returns false if the saved model doesn't fit
+	virtual bool importModel(const ModelMats& mModel) = 0;
+
 protected:
 	struct PxInfoBase {
 		int nImgCoord_Y;
@@ -76,6 +88,46 @@ protected:
 	cv::Mat m_oLastDescFrame;
 	//! the foreground mask generated by the method at [t-1]
 	cv::Mat m_oLastFGMask;
+	//! model indexes of the row bands bounds, the band b is [m_vnBandModelIdx[b], m_vnBandModelIdx[b+1])
+	std::vector<size_t> m_vnBandModelIdx;
+	//! counter of the processBands calls, used for the band generators seeds
+	size_t m_nBandsRunIdx = 0;
+
+	//! splits the relevant pixels into the row bands; needs to be called after the LUTs initialization
+	void initBands();
+	//! exports the state common for the LBSP-based algorithms: the last frames, the LBSP thresholds LUT and the frame index
+	void exportBaseModel(ModelMats& mModel) const;
+	//! initializes the model by the saved last frame and restores the common state
+	bool importBaseModel(const ModelMats& mModel);
+	//! exports the color and descriptor samples as "color_N" and "desc_N"
+	static void exportSamples(ModelMats& mModel, const std::vector<cv::Mat>& voColorSamples, const std::vector<cv::Mat>& voDescSamples);
+	//! restores the samples exported by exportSamples
+	static bool importSamples(const ModelMats& mModel, std::vector<cv::Mat>& voColorSamples, std::vector<cv::Mat>& voDescSamples);
+	//! copies the saved matrix to the allocated oDst of the same size and type
+	static bool importModelMat(const ModelMats& mModel, const std::string& sName, cv::Mat& oDst);
+	//! processes the row bands in parallel and returns the sum of the band results
+	/*!
+		The model update writes the samples of the neighbors up to BAND_HALO rows away, so the bands are
+		at least 2*BAND_HALO rows high and the even bands are processed before the odd ones: the bands of
+		one pass never touch the same rows.
+		bandFunc(nModelIterBegin, nModelIterEnd, BandRand& rnd) -> size_t
+	 */
+	template<typename TBandFunc>
+	size_t processBands(TBandFunc&& bandFunc) {
+		const int nBands = static_cast<int>(m_vnBandModelIdx.size()) - 1;
+		const size_t nRunIdx = m_nBandsRunIdx++;
+		std::atomic<size_t> nRes(0);
+		for(int nPass=0; nPass<2; ++nPass) {
+			tasks::ParallelFor(0,(nBands-nPass+1)/2,[&](int k) {
+				const int nBand = nPass+2*k;
+				BandRand rnd(nRunIdx, static_cast<size_t>(nBand));
+				nRes += bandFunc(m_vnBandModelIdx[nBand],m_vnBandModelIdx[nBand+1],rnd);
+			},1);
+		}
+		return nRes;
+	}
+	//! rows of the neighborhood written by the model update (5x5 spread)
+	static constexpr int BAND_HALO = 2;
 
 public:
 	// ######## DEBUG PURPOSES ONLY ##########
@@ -120,6 +120,7 @@ void BackgroundSubtractorLOBSTER::initialize(const cv::Mat& oInitImg, const cv::
 			}
 		}
 	}
+	initBands();
 	m_bInitialized = true;
 	refreshModel(1.0f);
 }
@@ -179,48 +180,51 @@ void BackgroundSubtractorLOBSTER::operator()(cv::InputArray _image, cv::OutputAr
 	oCurrFGMask = cv::Scalar_<uchar>(0);
 	const size_t nLearningRate = (size_t)ceil(learningRate);
 	if(m_nImgChannels==1) {
-		for(size_t nModelIter=0; nModelIter<m_nTotRelevantPxCount; ++nModelIter) {
-			const size_t nPxIter = m_aPxIdxLUT[nModelIter];
-			const size_t nDescIter = nPxIter*2;
-			const int nCurrImgCoord_X = m_aPxInfoLUT[nPxIter].nImgCoord_X;
-			const int nCurrImgCoord_Y = m_aPxInfoLUT[nPxIter].nImgCoord_Y;
-			const uchar nCurrColor = oInputImg.data[nPxIter];
-			size_t nGoodSamplesCount=0, nModelIdx=0;
-			ushort nCurrInputDesc;
-			while(nGoodSamplesCount<m_nRequiredBGSamples && nModelIdx<m_nBGSamples) {
-				const uchar nBGColor = m_voBGColorSamples[nModelIdx].data[nPxIter];
-				{
-					const size_t nColorDist = L1dist(nCurrColor,nBGColor);
-					if(nColorDist>m_nColorDistThreshold/2)
-						goto failedcheck1ch;
-					LBSP::computeGrayscaleDescriptor(oInputImg,nBGColor,nCurrImgCoord_X,nCurrImgCoord_Y,m_anLBSPThreshold_8bitLUT[nBGColor],nCurrInputDesc);
-					const size_t nDescDist = hdist(nCurrInputDesc,*((ushort*)(m_voBGDescSamples[nModelIdx].data+nDescIter)));
-					if(nDescDist>m_nDescDistThreshold)
-						goto failedcheck1ch;
-					nGoodSamplesCount++;
-				}
-				failedcheck1ch:
-				nModelIdx++;
-			}
-			if(nGoodSamplesCount<m_nRequiredBGSamples)
-				oCurrFGMask.data[nPxIter] = UCHAR_MAX;
-			else {
-				if((rand()%nLearningRate)==0) {
-					const size_t nSampleModelIdx = rand()%m_nBGSamples;
-					ushort& nRandInputDesc = *((ushort*)(m_voBGDescSamples[nSampleModelIdx].data+nDescIter));
-					LBSP::computeGrayscaleDescriptor(oInputImg,nCurrColor,nCurrImgCoord_X,nCurrImgCoord_Y,m_anLBSPThreshold_8bitLUT[nCurrColor],nRandInputDesc);
-					m_voBGColorSamples[nSampleModelIdx].data[nPxIter] = nCurrColor;
+		processBands([&](size_t nModelIterBegin, size_t nModelIterEnd, BandRand& rnd) -> size_t {
+			for(size_t nModelIter=nModelIterBegin; nModelIter<nModelIterEnd; ++nModelIter) {
+				const size_t nPxIter = m_aPxIdxLUT[nModelIter];
+				const size_t nDescIter = nPxIter*2;
+				const int nCurrImgCoord_X = m_aPxInfoLUT[nPxIter].nImgCoord_X;
+				const int nCurrImgCoord_Y = m_aPxInfoLUT[nPxIter].nImgCoord_Y;
+				const uchar nCurrColor = oInputImg.data[nPxIter];
+				size_t nGoodSamplesCount=0, nModelIdx=0;
+				ushort nCurrInputDesc;
+				while(nGoodSamplesCount<m_nRequiredBGSamples && nModelIdx<m_nBGSamples) {
+					const uchar nBGColor = m_voBGColorSamples[nModelIdx].data[nPxIter];
+					{
+						const size_t nColorDist = L1dist(nCurrColor,nBGColor);
+						if(nColorDist>m_nColorDistThreshold/2)
+							goto failedcheck1ch;
+						LBSP::computeGrayscaleDescriptor(oInputImg,nBGColor,nCurrImgCoord_X,nCurrImgCoord_Y,m_anLBSPThreshold_8bitLUT[nBGColor],nCurrInputDesc);
+						const size_t nDescDist = hdist(nCurrInputDesc,*((ushort*)(m_voBGDescSamples[nModelIdx].data+nDescIter)));
+						if(nDescDist>m_nDescDistThreshold)
+							goto failedcheck1ch;
+						nGoodSamplesCount++;
+					}
+					failedcheck1ch:
+					nModelIdx++;
 				}
-				if((rand()%nLearningRate)==0) {
-					int nSampleImgCoord_Y, nSampleImgCoord_X;
-					getRandNeighborPosition_3x3(nSampleImgCoord_X,nSampleImgCoord_Y,nCurrImgCoord_X,nCurrImgCoord_Y,LBSP::PATCH_SIZE/2,m_oImgSize);
-					const size_t nSampleModelIdx = rand()%m_nBGSamples;
-					ushort& nRandInputDesc = m_voBGDescSamples[nSampleModelIdx].at<ushort>(nSampleImgCoord_Y,nSampleImgCoord_X);
-					LBSP::computeGrayscaleDescriptor(oInputImg,nCurrColor,nCurrImgCoord_X,nCurrImgCoord_Y,m_anLBSPThreshold_8bitLUT[nCurrColor],nRandInputDesc);
-					m_voBGColorSamples[nSampleModelIdx].at<uchar>(nSampleImgCoord_Y,nSampleImgCoord_X) = nCurrColor;
+				if(nGoodSamplesCount<m_nRequiredBGSamples)
+					oCurrFGMask.data[nPxIter] = UCHAR_MAX;
+				else {
+					if((rnd()%nLearningRate)==0) {
+						const size_t nSampleModelIdx = rnd()%m_nBGSamples;
+						ushort& nRandInputDesc = *((ushort*)(m_voBGDescSamples[nSampleModelIdx].data+nDescIter));
+						LBSP::computeGrayscaleDescriptor(oInputImg,nCurrColor,nCurrImgCoord_X,nCurrImgCoord_Y,m_anLBSPThreshold_8bitLUT[nCurrColor],nRandInputDesc);
+						m_voBGColorSamples[nSampleModelIdx].data[nPxIter] = nCurrColor;
+					}
+					if((rnd()%nLearningRate)==0) {
+						int nSampleImgCoord_Y, nSampleImgCoord_X;
+						getRandNeighborPosition_3x3(nSampleImgCoord_X,nSampleImgCoord_Y,nCurrImgCoord_X,nCurrImgCoord_Y,LBSP::PATCH_SIZE/2,m_oImgSize,rnd);
+						const size_t nSampleModelIdx = rnd()%m_nBGSamples;
+						ushort& nRandInputDesc = m_voBGDescSamples[nSampleModelIdx].at<ushort>(nSampleImgCoord_Y,nSampleImgCoord_X);
+						LBSP::computeGrayscaleDescriptor(oInputImg,nCurrColor,nCurrImgCoord_X,nCurrImgCoord_Y,m_anLBSPThreshold_8bitLUT[nCurrColor],nRandInputDesc);
+						m_voBGColorSamples[nSampleModelIdx].at<uchar>(nSampleImgCoord_Y,nSampleImgCoord_X) = nCurrColor;
+					}
 				}
 			}
-		}
+			return 0;
+		});
 	}
 	else { //m_nImgChannels==3
 		const size_t nCurrDescDistThreshold = m_nDescDistThreshold*3;
@@ -229,59 +233,62 @@ void BackgroundSubtractorLOBSTER::operator()(cv::InputArray _image, cv::OutputAr
 		const size_t nCurrSCColorDistThreshold = nCurrColorDistThreshold/2;
 		const size_t desc_row_step = m_voBGDescSamples[0].step.p[0];
 		const size_t img_row_step = m_voBGColorSamples[0].step.p[0];
-		for(size_t nModelIter=0; nModelIter<m_nTotRelevantPxCount; ++nModelIter) {
-			const size_t nPxIter = m_aPxIdxLUT[nModelIter];
-			const int nCurrImgCoord_X = m_aPxInfoLUT[nPxIter].nImgCoord_X;
-			const int nCurrImgCoord_Y = m_aPxInfoLUT[nPxIter].nImgCoord_Y;
-			const size_t nPxIterRGB = nPxIter*3;
-			const size_t nDescIterRGB = nPxIterRGB*2;
-			const uchar* const anCurrColor = oInputImg.data+nPxIterRGB;
-			size_t nGoodSamplesCount=0, nModelIdx=0;
-			ushort anCurrInputDesc[3];
-			while(nGoodSamplesCount<m_nRequiredBGSamples && nModelIdx<m_nBGSamples) {
-				const ushort* const anBGDesc = (ushort*)(m_voBGDescSamples[nModelIdx].data+nDescIterRGB);
-				const uchar* const anBGColor = m_voBGColorSamples[nModelIdx].data+nPxIterRGB;
-				size_t nTotColorDist = 0;
-				size_t nTotDescDist = 0;
-				for(size_t c=0;c<3; ++c) {
-					const size_t nColorDist = L1dist(anCurrColor[c],anBGColor[c]);
-					if(nColorDist>nCurrSCColorDistThreshold)
-						goto failedcheck3ch;
-					LBSP::computeSingleRGBDescriptor(oInputImg,anBGColor[c],nCurrImgCoord_X,nCurrImgCoord_Y,c,m_anLBSPThreshold_8bitLUT[anBGColor[c]],anCurrInputDesc[c]);
-					const size_t nDescDist = hdist(anCurrInputDesc[c],anBGDesc[c]);
-					if(nDescDist>nCurrSCDescDistThreshold)
-						goto failedcheck3ch;
-					nTotColorDist += nColorDist;
-					nTotDescDist += nDescDist;
-				}
-				if(nTotDescDist<=nCurrDescDistThreshold && nTotColorDist<=nCurrColorDistThreshold)
-					nGoodSamplesCount++;
-				failedcheck3ch:
-				nModelIdx++;
-			}
-			if(nGoodSamplesCount<m_nRequiredBGSamples)
-				oCurrFGMask.data[nPxIter] = UCHAR_MAX;
-			else {
-				if((rand()%nLearningRate)==0) {
-					const size_t nSampleModelIdx = rand()%m_nBGSamples;
-					ushort* anRandInputDesc = ((ushort*)(m_voBGDescSamples[nSampleModelIdx].data+nDescIterRGB));
-					const size_t anCurrIntraLBSPThresholds[3] = {m_anLBSPThreshold_8bitLUT[anCurrColor[0]],m_anLBSPThreshold_8bitLUT[anCurrColor[1]],m_anLBSPThreshold_8bitLUT[anCurrColor[2]]};
-					LBSP::computeRGBDescriptor(oInputImg,anCurrColor,nCurrImgCoord_X,nCurrImgCoord_Y,anCurrIntraLBSPThresholds,anRandInputDesc);
-					for(size_t c=0; c<3; ++c)
-						*(m_voBGColorSamples[nSampleModelIdx].data+nPxIterRGB+c) = anCurrColor[c];
+		processBands([&](size_t nModelIterBegin, size_t nModelIterEnd, BandRand& rnd) -> size_t {
+			for(size_t nModelIter=nModelIterBegin; nModelIter<nModelIterEnd; ++nModelIter) {
+				const size_t nPxIter = m_aPxIdxLUT[nModelIter];
+				const int nCurrImgCoord_X = m_aPxInfoLUT[nPxIter].nImgCoord_X;
+				const int nCurrImgCoord_Y = m_aPxInfoLUT[nPxIter].nImgCoord_Y;
+				const size_t nPxIterRGB = nPxIter*3;
+				const size_t nDescIterRGB = nPxIterRGB*2;
+				const uchar* const anCurrColor = oInputImg.data+nPxIterRGB;
+				size_t nGoodSamplesCount=0, nModelIdx=0;
+				ushort anCurrInputDesc[3];
+				while(nGoodSamplesCount<m_nRequiredBGSamples && nModelIdx<m_nBGSamples) {
+					const ushort* const anBGDesc = (ushort*)(m_voBGDescSamples[nModelIdx].data+nDescIterRGB);
+					const uchar* const anBGColor = m_voBGColorSamples[nModelIdx].data+nPxIterRGB;
+					size_t nTotColorDist = 0;
+					size_t nTotDescDist = 0;
+					for(size_t c=0;c<3; ++c) {
+						const size_t nColorDist = L1dist(anCurrColor[c],anBGColor[c]);
+						if(nColorDist>nCurrSCColorDistThreshold)
+							goto failedcheck3ch;
+						LBSP::computeSingleRGBDescriptor(oInputImg,anBGColor[c],nCurrImgCoord_X,nCurrImgCoord_Y,c,m_anLBSPThreshold_8bitLUT[anBGColor[c]],anCurrInputDesc[c]);
+						const size_t nDescDist = hdist(anCurrInputDesc[c],anBGDesc[c]);
+						if(nDescDist>nCurrSCDescDistThreshold)
+							goto failedcheck3ch;
+						nTotColorDist += nColorDist;
+						nTotDescDist += nDescDist;
+					}
+					if(nTotDescDist<=nCurrDescDistThreshold && nTotColorDist<=nCurrColorDistThreshold)
+						nGoodSamplesCount++;
+					failedcheck3ch:
+					nModelIdx++;
 				}
-				if((rand()%nLearningRate)==0) {
-					int nSampleImgCoord_Y, nSampleImgCoord_X;
-					getRandNeighborPosition_3x3(nSampleImgCoord_X,nSampleImgCoord_Y,nCurrImgCoord_X,nCurrImgCoord_Y,LBSP::PATCH_SIZE/2,m_oImgSize);
-					const size_t nSampleModelIdx = rand()%m_nBGSamples;
-					ushort* anRandInputDesc = ((ushort*)(m_voBGDescSamples[nSampleModelIdx].data + desc_row_step*nSampleImgCoord_Y + 6*nSampleImgCoord_X));
-					const size_t anCurrIntraLBSPThresholds[3] = {m_anLBSPThreshold_8bitLUT[anCurrColor[0]],m_anLBSPThreshold_8bitLUT[anCurrColor[1]],m_anLBSPThreshold_8bitLUT[anCurrColor[2]]};
-					LBSP::computeRGBDescriptor(oInputImg,anCurrColor,nCurrImgCoord_X,nCurrImgCoord_Y,anCurrIntraLBSPThresholds,anRandInputDesc);
-					for(size_t c=0; c<3; ++c)
-						*(m_voBGColorSamples[nSampleModelIdx].data + img_row_step*nSampleImgCoord_Y + 3*nSampleImgCoord_X + c) = anCurrColor[c];
+				if(nGoodSamplesCount<m_nRequiredBGSamples)
+					oCurrFGMask.data[nPxIter] = UCHAR_MAX;
+				else {
+					if((rnd()%nLearningRate)==0) {
+						const size_t nSampleModelIdx = rnd()%m_nBGSamples;
+						ushort* anRandInputDesc = ((ushort*)(m_voBGDescSamples[nSampleModelIdx].data+nDescIterRGB));
+						const size_t anCurrIntraLBSPThresholds[3] = {m_anLBSPThreshold_8bitLUT[anCurrColor[0]],m_anLBSPThreshold_8bitLUT[anCurrColor[1]],m_anLBSPThreshold_8bitLUT[anCurrColor[2]]};
+						LBSP::computeRGBDescriptor(oInputImg,anCurrColor,nCurrImgCoord_X,nCurrImgCoord_Y,anCurrIntraLBSPThresholds,anRandInputDesc);
+						for(size_t c=0; c<3; ++c)
+							*(m_voBGColorSamples[nSampleModelIdx].data+nPxIterRGB+c) = anCurrColor[c];
+					}
+					if((rnd()%nLearningRate)==0) {
+						int nSampleImgCoord_Y, nSampleImgCoord_X;
+						getRandNeighborPosition_3x3(nSampleImgCoord_X,nSampleImgCoord_Y,nCurrImgCoord_X,nCurrImgCoord_Y,LBSP::PATCH_SIZE/2,m_oImgSize,rnd);
+						const size_t nSampleModelIdx = rnd()%m_nBGSamples;
+						ushort* anRandInputDesc = ((ushort*)(m_voBGDescSamples[nSampleModelIdx].data + desc_row_step*nSampleImgCoord_Y + 6*nSampleImgCoord_X));
+						const size_t anCurrIntraLBSPThresholds[3] = {m_anLBSPThreshold_8bitLUT[anCurrColor[0]],m_anLBSPThreshold_8bitLUT[anCurrColor[1]],m_anLBSPThreshold_8bitLUT[anCurrColor[2]]};
+						LBSP::computeRGBDescriptor(oInputImg,anCurrColor,nCurrImgCoord_X,nCurrImgCoord_Y,anCurrIntraLBSPThresholds,anRandInputDesc);
+						for(size_t c=0; c<3; ++c)
+							*(m_voBGColorSamples[nSampleModelIdx].data + img_row_step*nSampleImgCoord_Y + 3*nSampleImgCoord_X + c) = anCurrColor[c];
+					}
 				}
 			}
-		}
+			return 0;
+		});
 	}
 	cv::medianBlur(oCurrFGMask,m_oLastFGMask,m_nDefaultMedianBlurKernelSize);
 	m_oLastFGMask.copyTo(oCurrFGMask);
@@ -335,3 +342,12 @@ void BackgroundSubtractorLOBSTER::apply(cv::InputArray image, cv::OutputArray fg
 	else
 		initialize(image.getMat(), cv::Mat());
 }
+
+void BackgroundSubtractorLOBSTER::exportModel(ModelMats& mModel) const {
+	exportBaseModel(mModel);
+	exportSamples(mModel,m_voBGColorSamples,m_voBGDescSamples);
+}
+
+bool BackgroundSubtractorLOBSTER::importModel(const ModelMats& mModel) {
+	return importBaseModel(mModel) && importSamples(mModel,m_voBGColorSamples,m_voBGDescSamples);
+}
@@ -51,6 +51,10 @@ public:
 	virtual void getBackgroundDescriptorsImage(cv::OutputArray backgroundDescImage) const;
     //! compute foreground mask
     virtual void apply(cv::InputArray image, cv::OutputArray fgmask, double learningRateOverride=BGSLOBSTER_DEFAULT_LEARNING_RATE);
+	//! exports the copy of the learned model state
+	virtual void exportModel(ModelMats& mModel) const;
+	//! restores the model exported by exportModel
+	virtual bool importModel(const ModelMats& mModel);
     
 protected:
 	//! absolute color distance threshold
@@ -1,6 +1,7 @@
 #include "BackgroundSubtractorSuBSENSE.h"
 #include "DistanceUtils.h"
 #include "RandUtils.h"
+#include "task_scheduler.h"
 #include <iostream>
 #include <iomanip>
 
@@ -241,6 +242,7 @@ void BackgroundSubtractorSuBSENSE::initialize(const cv::Mat& oInitImg, const cv:
 			}
 		}
 	}
+	initBands();
 	m_bInitialized = true;
 	refreshModel(1.0f);
 }
@@ -289,6 +291,28 @@ void BackgroundSubtractorSuBSENSE::refreshModel(float fSamplesRefreshFrac, bool
 	}
 }
 
+void BackgroundSubtractorSuBSENSE::computeIntraDescFrame(const cv::Mat& oInputImg) {
+	m_oCurrIntraDescFrame.create(m_oImgSize,CV_16UC((int)m_nImgChannels));
+	const int nBorder = (int)LBSP::PATCH_SIZE/2;
+	const int nRowLength = (int)m_nImgChannels*(m_oImgSize.width-2*nBorder);
+	if(nRowLength<=0)
+		return;
+	tasks::ParallelForRange(nBorder,m_oImgSize.height-nBorder,[&](int nRowBegin, int nRowEnd) {
+		// thresholds of the row values from the LUT, the descriptors loop is vectorized over them
+		std::vector<uchar> vnThresholds((size_t)nRowLength);
+		for(int y=nRowBegin; y<nRowEnd; ++y) {
+			const uchar* const anRow = oInputImg.ptr<uchar>(y)+m_nImgChannels*nBorder;
+			for(int i=0; i<nRowLength; ++i)
+				vnThresholds[i] = (uchar)m_anLBSPThreshold_8bitLUT[anRow[i]];
+			ushort* const anDescRow = m_oCurrIntraDescFrame.ptr<ushort>(y)+m_nImgChannels*nBorder;
+			if(m_nImgChannels==1)
+				LBSP::computeDescriptorsRow<1>(oInputImg,y,nBorder,m_oImgSize.width-nBorder,vnThresholds.data(),anDescRow);
+			else
+				LBSP::computeDescriptorsRow<3>(oInputImg,y,nBorder,m_oImgSize.width-nBorder,vnThresholds.data(),anDescRow);
+		}
+	});
+}
+
 void BackgroundSubtractorSuBSENSE::operator()(cv::InputArray _image, cv::OutputArray _fgmask, double learningRateOverride) {
 	// == process
 	CV_Assert(m_bInitialized);
@@ -301,285 +325,293 @@ void BackgroundSubtractorSuBSENSE::operator()(cv::InputArray _image, cv::OutputA
 	size_t nNonZeroDescCount = 0;
 	const float fRollAvgFactor_LT = 1.0f/std::min(++m_nFrameIndex,m_nSamplesForMovingAvgs);
 	const float fRollAvgFactor_ST = 1.0f/std::min(m_nFrameIndex,m_nSamplesForMovingAvgs/4);
+	computeIntraDescFrame(oInputImg);
 	if(m_nImgChannels==1) {
-		for(size_t nModelIter=0; nModelIter<m_nTotRelevantPxCount; ++nModelIter) {
-			const size_t nPxIter = m_aPxIdxLUT[nModelIter];
-			const size_t nDescIter = nPxIter*2;
-			const size_t nFloatIter = nPxIter*4;
-			const int nCurrImgCoord_X = m_aPxInfoLUT[nPxIter].nImgCoord_X;
-			const int nCurrImgCoord_Y = m_aPxInfoLUT[nPxIter].nImgCoord_Y;
-			const uchar nCurrColor = oInputImg.data[nPxIter];
-			size_t nMinDescDist = s_nDescMaxDataRange_1ch;
-			size_t nMinSumDist = s_nColorMaxDataRange_1ch;
-			float* pfCurrDistThresholdFactor = (float*)(m_oDistThresholdFrame.data+nFloatIter);
-			float* pfCurrVariationFactor = (float*)(m_oVariationModulatorFrame.data+nFloatIter);
-			float* pfCurrLearningRate = ((float*)(m_oUpdateRateFrame.data+nFloatIter));
-			float* pfCurrMeanLastDist = ((float*)(m_oMeanLastDistFrame.data+nFloatIter));
-			float* pfCurrMeanMinDist_LT = ((float*)(m_oMeanMinDistFrame_LT.data+nFloatIter));
-			float* pfCurrMeanMinDist_ST = ((float*)(m_oMeanMinDistFrame_ST.data+nFloatIter));
-			float* pfCurrMeanRawSegmRes_LT = ((float*)(m_oMeanRawSegmResFrame_LT.data+nFloatIter));
-			float* pfCurrMeanRawSegmRes_ST = ((float*)(m_oMeanRawSegmResFrame_ST.data+nFloatIter));
-			float* pfCurrMeanFinalSegmRes_LT = ((float*)(m_oMeanFinalSegmResFrame_LT.data+nFloatIter));
-			float* pfCurrMeanFinalSegmRes_ST = ((float*)(m_oMeanFinalSegmResFrame_ST.data+nFloatIter));
-			ushort& nLastIntraDesc = *((ushort*)(m_oLastDescFrame.data+nDescIter));
-			uchar& nLastColor = m_oLastColorFrame.data[nPxIter];
-			const size_t nCurrColorDistThreshold = (size_t)(((*pfCurrDistThresholdFactor)*m_nMinColorDistThreshold)-((!m_oUnstableRegionMask.data[nPxIter])*STAB_COLOR_DIST_OFFSET))/2;
-			const size_t nCurrDescDistThreshold = ((size_t)1<<((size_t)floor(*pfCurrDistThresholdFactor+0.5f)))+m_nDescDistThresholdOffset+(m_oUnstableRegionMask.data[nPxIter]*UNSTAB_DESC_DIST_OFFSET);
-			ushort nCurrInterDesc, nCurrIntraDesc;
-			LBSP::computeGrayscaleDescriptor(oInputImg,nCurrColor,nCurrImgCoord_X,nCurrImgCoord_Y,m_anLBSPThreshold_8bitLUT[nCurrColor],nCurrIntraDesc);
-			m_oUnstableRegionMask.data[nPxIter] = ((*pfCurrDistThresholdFactor)>UNSTABLE_REG_RDIST_MIN || (*pfCurrMeanRawSegmRes_LT-*pfCurrMeanFinalSegmRes_LT)>UNSTABLE_REG_RATIO_MIN || (*pfCurrMeanRawSegmRes_ST-*pfCurrMeanFinalSegmRes_ST)>UNSTABLE_REG_RATIO_MIN)?1:0;
-			size_t nGoodSamplesCount=0, nSampleIdx=0;
-			while(nGoodSamplesCount<m_nRequiredBGSamples && nSampleIdx<m_nBGSamples) {
-				const uchar& nBGColor = m_voBGColorSamples[nSampleIdx].data[nPxIter];
-				{
-					const size_t nColorDist = L1dist(nCurrColor,nBGColor);
-					if(nColorDist>nCurrColorDistThreshold)
-						goto failedcheck1ch;
-					const ushort& nBGIntraDesc = *((ushort*)(m_voBGDescSamples[nSampleIdx].data+nDescIter));
-					const size_t nIntraDescDist = hdist(nCurrIntraDesc,nBGIntraDesc);
-					LBSP::computeGrayscaleDescriptor(oInputImg,nBGColor,nCurrImgCoord_X,nCurrImgCoord_Y,m_anLBSPThreshold_8bitLUT[nBGColor],nCurrInterDesc);
-					const size_t nInterDescDist = hdist(nCurrInterDesc,nBGIntraDesc);
-					const size_t nDescDist = (nIntraDescDist+nInterDescDist)/2;
-					if(nDescDist>nCurrDescDistThreshold)
-						goto failedcheck1ch;
-					const size_t nSumDist = std::min((nDescDist/4)*(s_nColorMaxDataRange_1ch/s_nDescMaxDataRange_1ch)+nColorDist,s_nColorMaxDataRange_1ch);
-					if(nSumDist>nCurrColorDistThreshold)
-						goto failedcheck1ch;
-					if(nMinDescDist>nDescDist)
-						nMinDescDist = nDescDist;
-					if(nMinSumDist>nSumDist)
-						nMinSumDist = nSumDist;
-					nGoodSamplesCount++;
+		nNonZeroDescCount = processBands([&](size_t nModelIterBegin, size_t nModelIterEnd, BandRand& rnd) -> size_t {
+			size_t nBandNonZeroDescCount = 0;
+			for(size_t nModelIter=nModelIterBegin; nModelIter<nModelIterEnd; ++nModelIter) {
+				const size_t nPxIter = m_aPxIdxLUT[nModelIter];
+				const size_t nDescIter = nPxIter*2;
+				const size_t nFloatIter = nPxIter*4;
+				const int nCurrImgCoord_X = m_aPxInfoLUT[nPxIter].nImgCoord_X;
+				const int nCurrImgCoord_Y = m_aPxInfoLUT[nPxIter].nImgCoord_Y;
+				const uchar nCurrColor = oInputImg.data[nPxIter];
+				size_t nMinDescDist = s_nDescMaxDataRange_1ch;
+				size_t nMinSumDist = s_nColorMaxDataRange_1ch;
+				float* pfCurrDistThresholdFactor = (float*)(m_oDistThresholdFrame.data+nFloatIter);
+				float* pfCurrVariationFactor = (float*)(m_oVariationModulatorFrame.data+nFloatIter);
+				float* pfCurrLearningRate = ((float*)(m_oUpdateRateFrame.data+nFloatIter));
+				float* pfCurrMeanLastDist = ((float*)(m_oMeanLastDistFrame.data+nFloatIter));
+				float* pfCurrMeanMinDist_LT = ((float*)(m_oMeanMinDistFrame_LT.data+nFloatIter));
+				float* pfCurrMeanMinDist_ST = ((float*)(m_oMeanMinDistFrame_ST.data+nFloatIter));
+				float* pfCurrMeanRawSegmRes_LT = ((float*)(m_oMeanRawSegmResFrame_LT.data+nFloatIter));
+				float* pfCurrMeanRawSegmRes_ST = ((float*)(m_oMeanRawSegmResFrame_ST.data+nFloatIter));
+				float* pfCurrMeanFinalSegmRes_LT = ((float*)(m_oMeanFinalSegmResFrame_LT.data+nFloatIter));
+				float* pfCurrMeanFinalSegmRes_ST = ((float*)(m_oMeanFinalSegmResFrame_ST.data+nFloatIter));
+				ushort& nLastIntraDesc = *((ushort*)(m_oLastDescFrame.data+nDescIter));
+				uchar& nLastColor = m_oLastColorFrame.data[nPxIter];
+				const size_t nCurrColorDistThreshold = (size_t)(((*pfCurrDistThresholdFactor)*m_nMinColorDistThreshold)-((!m_oUnstableRegionMask.data[nPxIter])*STAB_COLOR_DIST_OFFSET))/2;
+				const size_t nCurrDescDistThreshold = ((size_t)1<<((size_t)floor(*pfCurrDistThresholdFactor+0.5f)))+m_nDescDistThresholdOffset+(m_oUnstableRegionMask.data[nPxIter]*UNSTAB_DESC_DIST_OFFSET);
+				ushort nCurrInterDesc;
+				const ushort nCurrIntraDesc = *((const ushort*)(m_oCurrIntraDescFrame.data+nDescIter));
+				m_oUnstableRegionMask.data[nPxIter] = ((*pfCurrDistThresholdFactor)>UNSTABLE_REG_RDIST_MIN || (*pfCurrMeanRawSegmRes_LT-*pfCurrMeanFinalSegmRes_LT)>UNSTABLE_REG_RATIO_MIN || (*pfCurrMeanRawSegmRes_ST-*pfCurrMeanFinalSegmRes_ST)>UNSTABLE_REG_RATIO_MIN)?1:0;
+				size_t nGoodSamplesCount=0, nSampleIdx=0;
+				while(nGoodSamplesCount<m_nRequiredBGSamples && nSampleIdx<m_nBGSamples) {
+					const uchar& nBGColor = m_voBGColorSamples[nSampleIdx].data[nPxIter];
+					{
+						const size_t nColorDist = L1dist(nCurrColor,nBGColor);
+						if(nColorDist>nCurrColorDistThreshold)
+							goto failedcheck1ch;
+						const ushort& nBGIntraDesc = *((ushort*)(m_voBGDescSamples[nSampleIdx].data+nDescIter));
+						const size_t nIntraDescDist = hdist(nCurrIntraDesc,nBGIntraDesc);
+						LBSP::computeGrayscaleDescriptor(oInputImg,nBGColor,nCurrImgCoord_X,nCurrImgCoord_Y,m_anLBSPThreshold_8bitLUT[nBGColor],nCurrInterDesc);
+						const size_t nInterDescDist = hdist(nCurrInterDesc,nBGIntraDesc);
+						const size_t nDescDist = (nIntraDescDist+nInterDescDist)/2;
+						if(nDescDist>nCurrDescDistThreshold)
+							goto failedcheck1ch;
+						const size_t nSumDist = std::min((nDescDist/4)*(s_nColorMaxDataRange_1ch/s_nDescMaxDataRange_1ch)+nColorDist,s_nColorMaxDataRange_1ch);
+						if(nSumDist>nCurrColorDistThreshold)
+							goto failedcheck1ch;
+						if(nMinDescDist>nDescDist)
+							nMinDescDist = nDescDist;
+						if(nMinSumDist>nSumDist)
+							nMinSumDist = nSumDist;
+						nGoodSamplesCount++;
+					}
+					failedcheck1ch:
+					nSampleIdx++;
 				}
-				failedcheck1ch:
-				nSampleIdx++;
-			}
-			const float fNormalizedLastDist = ((float)L1dist(nLastColor,nCurrColor)/s_nColorMaxDataRange_1ch+(float)hdist(nLastIntraDesc,nCurrIntraDesc)/s_nDescMaxDataRange_1ch)/2;
-			*pfCurrMeanLastDist = (*pfCurrMeanLastDist)*(1.0f-fRollAvgFactor_ST) + fNormalizedLastDist*fRollAvgFactor_ST;
-			if(nGoodSamplesCount<m_nRequiredBGSamples) {
-				// == foreground
-				const float fNormalizedMinDist = std::min(1.0f,((float)nMinSumDist/s_nColorMaxDataRange_1ch+(float)nMinDescDist/s_nDescMaxDataRange_1ch)/2 + (float)(m_nRequiredBGSamples-nGoodSamplesCount)/m_nRequiredBGSamples);
-				*pfCurrMeanMinDist_LT = (*pfCurrMeanMinDist_LT)*(1.0f-fRollAvgFactor_LT) + fNormalizedMinDist*fRollAvgFactor_LT;
-				*pfCurrMeanMinDist_ST = (*pfCurrMeanMinDist_ST)*(1.0f-fRollAvgFactor_ST) + fNormalizedMinDist*fRollAvgFactor_ST;
-				*pfCurrMeanRawSegmRes_LT = (*pfCurrMeanRawSegmRes_LT)*(1.0f-fRollAvgFactor_LT) + fRollAvgFactor_LT;
-				*pfCurrMeanRawSegmRes_ST = (*pfCurrMeanRawSegmRes_ST)*(1.0f-fRollAvgFactor_ST) + fRollAvgFactor_ST;
-				oCurrFGMask.data[nPxIter] = UCHAR_MAX;
-				if(m_nModelResetCooldown && (rand()%(size_t)FEEDBACK_T_LOWER)==0) {
-					const size_t s_rand = rand()%m_nBGSamples;
-					*((ushort*)(m_voBGDescSamples[s_rand].data+nDescIter)) = nCurrIntraDesc;
-					m_voBGColorSamples[s_rand].data[nPxIter] = nCurrColor;
+				const float fNormalizedLastDist = ((float)L1dist(nLastColor,nCurrColor)/s_nColorMaxDataRange_1ch+(float)hdist(nLastIntraDesc,nCurrIntraDesc)/s_nDescMaxDataRange_1ch)/2;
+				*pfCurrMeanLastDist = (*pfCurrMeanLastDist)*(1.0f-fRollAvgFactor_ST) + fNormalizedLastDist*fRollAvgFactor_ST;
+				if(nGoodSamplesCount<m_nRequiredBGSamples) {
+					// == foreground
+					const float fNormalizedMinDist = std::min(1.0f,((float)nMinSumDist/s_nColorMaxDataRange_1ch+(float)nMinDescDist/s_nDescMaxDataRange_1ch)/2 + (float)(m_nRequiredBGSamples-nGoodSamplesCount)/m_nRequiredBGSamples);
+					*pfCurrMeanMinDist_LT = (*pfCurrMeanMinDist_LT)*(1.0f-fRollAvgFactor_LT) + fNormalizedMinDist*fRollAvgFactor_LT;
+					*pfCurrMeanMinDist_ST = (*pfCurrMeanMinDist_ST)*(1.0f-fRollAvgFactor_ST) + fNormalizedMinDist*fRollAvgFactor_ST;
+					*pfCurrMeanRawSegmRes_LT = (*pfCurrMeanRawSegmRes_LT)*(1.0f-fRollAvgFactor_LT) + fRollAvgFactor_LT;
+					*pfCurrMeanRawSegmRes_ST = (*pfCurrMeanRawSegmRes_ST)*(1.0f-fRollAvgFactor_ST) + fRollAvgFactor_ST;
+					oCurrFGMask.data[nPxIter] = UCHAR_MAX;
+					if(m_nModelResetCooldown && (rnd()%(size_t)FEEDBACK_T_LOWER)==0) {
+						const size_t s_rand = rnd()%m_nBGSamples;
+						*((ushort*)(m_voBGDescSamples[s_rand].data+nDescIter)) = nCurrIntraDesc;
+						m_voBGColorSamples[s_rand].data[nPxIter] = nCurrColor;
+					}
 				}
-			}
-			else {
-				// == background
-				const float fNormalizedMinDist = ((float)nMinSumDist/s_nColorMaxDataRange_1ch+(float)nMinDescDist/s_nDescMaxDataRange_1ch)/2;
-				*pfCurrMeanMinDist_LT = (*pfCurrMeanMinDist_LT)*(1.0f-fRollAvgFactor_LT) + fNormalizedMinDist*fRollAvgFactor_LT;
-				*pfCurrMeanMinDist_ST = (*pfCurrMeanMinDist_ST)*(1.0f-fRollAvgFactor_ST) + fNormalizedMinDist*fRollAvgFactor_ST;
-				*pfCurrMeanRawSegmRes_LT = (*pfCurrMeanRawSegmRes_LT)*(1.0f-fRollAvgFactor_LT);
-				*pfCurrMeanRawSegmRes_ST = (*pfCurrMeanRawSegmRes_ST)*(1.0f-fRollAvgFactor_ST);
-				const size_t nLearningRate = learningRateOverride>0?(size_t)ceil(learningRateOverride):(size_t)ceil(*pfCurrLearningRate);
-				if((rand()%nLearningRate)==0) {
-					const size_t s_rand = rand()%m_nBGSamples;
-					*((ushort*)(m_voBGDescSamples[s_rand].data+nDescIter)) = nCurrIntraDesc;
-					m_voBGColorSamples[s_rand].data[nPxIter] = nCurrColor;
+				else {
+					// == background
+					const float fNormalizedMinDist = ((float)nMinSumDist/s_nColorMaxDataRange_1ch+(float)nMinDescDist/s_nDescMaxDataRange_1ch)/2;
+					*pfCurrMeanMinDist_LT = (*pfCurrMeanMinDist_LT)*(1.0f-fRollAvgFactor_LT) + fNormalizedMinDist*fRollAvgFactor_LT;
+					*pfCurrMeanMinDist_ST = (*pfCurrMeanMinDist_ST)*(1.0f-fRollAvgFactor_ST) + fNormalizedMinDist*fRollAvgFactor_ST;
+					*pfCurrMeanRawSegmRes_LT = (*pfCurrMeanRawSegmRes_LT)*(1.0f-fRollAvgFactor_LT);
+					*pfCurrMeanRawSegmRes_ST = (*pfCurrMeanRawSegmRes_ST)*(1.0f-fRollAvgFactor_ST);
+					const size_t nLearningRate = learningRateOverride>0?(size_t)ceil(learningRateOverride):(size_t)ceil(*pfCurrLearningRate);
+					if((rnd()%nLearningRate)==0) {
+						const size_t s_rand = rnd()%m_nBGSamples;
+						*((ushort*)(m_voBGDescSamples[s_rand].data+nDescIter)) = nCurrIntraDesc;
+						m_voBGColorSamples[s_rand].data[nPxIter] = nCurrColor;
+					}
+					int nSampleImgCoord_Y, nSampleImgCoord_X;
+					const bool bCurrUsing3x3Spread = m_bUse3x3Spread && !m_oUnstableRegionMask.data[nPxIter];
+					if(bCurrUsing3x3Spread)
+						getRandNeighborPosition_3x3(nSampleImgCoord_X,nSampleImgCoord_Y,nCurrImgCoord_X,nCurrImgCoord_Y,LBSP::PATCH_SIZE/2,m_oImgSize,rnd);
+					else
+						getRandNeighborPosition_5x5(nSampleImgCoord_X,nSampleImgCoord_Y,nCurrImgCoord_X,nCurrImgCoord_Y,LBSP::PATCH_SIZE/2,m_oImgSize,rnd);
+					const size_t n_rand = rnd();
+					const size_t idx_rand_uchar = m_oImgSize.width*nSampleImgCoord_Y + nSampleImgCoord_X;
+					const size_t idx_rand_flt32 = idx_rand_uchar*4;
+					const float fRandMeanLastDist = *((float*)(m_oMeanLastDistFrame.data+idx_rand_flt32));
+					const float fRandMeanRawSegmRes = *((float*)(m_oMeanRawSegmResFrame_ST.data+idx_rand_flt32));
+					if((n_rand%(bCurrUsing3x3Spread?nLearningRate:(nLearningRate/2+1)))==0
+						|| (fRandMeanRawSegmRes>GHOSTDET_S_MIN && fRandMeanLastDist<GHOSTDET_D_MAX && (n_rand%((size_t)m_fCurrLearningRateLowerCap))==0)) {
+						const size_t idx_rand_ushrt = idx_rand_uchar*2;
+						const size_t s_rand = rnd()%m_nBGSamples;
+						*((ushort*)(m_voBGDescSamples[s_rand].data+idx_rand_ushrt)) = nCurrIntraDesc;
+						m_voBGColorSamples[s_rand].data[idx_rand_uchar] = nCurrColor;
+					}
 				}
-				int nSampleImgCoord_Y, nSampleImgCoord_X;
-				const bool bCurrUsing3x3Spread = m_bUse3x3Spread && !m_oUnstableRegionMask.data[nPxIter];
-				if(bCurrUsing3x3Spread)
-					getRandNeighborPosition_3x3(nSampleImgCoord_X,nSampleImgCoord_Y,nCurrImgCoord_X,nCurrImgCoord_Y,LBSP::PATCH_SIZE/2,m_oImgSize);
-				else
-					getRandNeighborPosition_5x5(nSampleImgCoord_X,nSampleImgCoord_Y,nCurrImgCoord_X,nCurrImgCoord_Y,LBSP::PATCH_SIZE/2,m_oImgSize);
-				const size_t n_rand = rand();
-				const size_t idx_rand_uchar = m_oImgSize.width*nSampleImgCoord_Y + nSampleImgCoord_X;
-				const size_t idx_rand_flt32 = idx_rand_uchar*4;
-				const float fRandMeanLastDist = *((float*)(m_oMeanLastDistFrame.data+idx_rand_flt32));
-				const float fRandMeanRawSegmRes = *((float*)(m_oMeanRawSegmResFrame_ST.data+idx_rand_flt32));
-				if((n_rand%(bCurrUsing3x3Spread?nLearningRate:(nLearningRate/2+1)))==0
-					|| (fRandMeanRawSegmRes>GHOSTDET_S_MIN && fRandMeanLastDist<GHOSTDET_D_MAX && (n_rand%((size_t)m_fCurrLearningRateLowerCap))==0)) {
-					const size_t idx_rand_ushrt = idx_rand_uchar*2;
-					const size_t s_rand = rand()%m_nBGSamples;
-					*((ushort*)(m_voBGDescSamples[s_rand].data+idx_rand_ushrt)) = nCurrIntraDesc;
-					m_voBGColorSamples[s_rand].data[idx_rand_uchar] = nCurrColor;
+				if(m_oLastFGMask.data[nPxIter] || (std::min(*pfCurrMeanMinDist_LT,*pfCurrMeanMinDist_ST)<UNSTABLE_REG_RATIO_MIN && oCurrFGMask.data[nPxIter])) {
+					if((*pfCurrLearningRate)<m_fCurrLearningRateUpperCap)
+						*pfCurrLearningRate += FEEDBACK_T_INCR/(std::max(*pfCurrMeanMinDist_LT,*pfCurrMeanMinDist_ST)*(*pfCurrVariationFactor));
 				}
+				else if((*pfCurrLearningRate)>m_fCurrLearningRateLowerCap)
+					*pfCurrLearningRate -= FEEDBACK_T_DECR*(*pfCurrVariationFactor)/std::max(*pfCurrMeanMinDist_LT,*pfCurrMeanMinDist_ST);
+				if((*pfCurrLearningRate)<m_fCurrLearningRateLowerCap)
+					*pfCurrLearningRate = m_fCurrLearningRateLowerCap;
+				else if((*pfCurrLearningRate)>m_fCurrLearningRateUpperCap)
+					*pfCurrLearningRate = m_fCurrLearningRateUpperCap;
+				if(std::max(*pfCurrMeanMinDist_LT,*pfCurrMeanMinDist_ST)>UNSTABLE_REG_RATIO_MIN && m_oBlinksFrame.data[nPxIter])
+					(*pfCurrVariationFactor) += FEEDBACK_V_INCR;
+				else if((*pfCurrVariationFactor)>FEEDBACK_V_DECR) {
+					(*pfCurrVariationFactor) -= m_oLastFGMask.data[nPxIter]?FEEDBACK_V_DECR/4:m_oUnstableRegionMask.data[nPxIter]?FEEDBACK_V_DECR/2:FEEDBACK_V_DECR;
+					if((*pfCurrVariationFactor)<FEEDBACK_V_DECR)
+						(*pfCurrVariationFactor) = FEEDBACK_V_DECR;
+				}
+				if((*pfCurrDistThresholdFactor)<std::pow(1.0f+std::min(*pfCurrMeanMinDist_LT,*pfCurrMeanMinDist_ST)*2,2))
+					(*pfCurrDistThresholdFactor) += FEEDBACK_R_VAR*(*pfCurrVariationFactor-FEEDBACK_V_DECR);
+				else {
+					(*pfCurrDistThresholdFactor) -= FEEDBACK_R_VAR/(*pfCurrVariationFactor);
+					if((*pfCurrDistThresholdFactor)<1.0f)
+						(*pfCurrDistThresholdFactor) = 1.0f;
+				}
+				if(popcount(nCurrIntraDesc)>=2)
+					++nBandNonZeroDescCount;
+				nLastIntraDesc = nCurrIntraDesc;
+				nLastColor = nCurrColor;
 			}
-			if(m_oLastFGMask.data[nPxIter] || (std::min(*pfCurrMeanMinDist_LT,*pfCurrMeanMinDist_ST)<UNSTABLE_REG_RATIO_MIN && oCurrFGMask.data[nPxIter])) {
-				if((*pfCurrLearningRate)<m_fCurrLearningRateUpperCap)
-					*pfCurrLearningRate += FEEDBACK_T_INCR/(std::max(*pfCurrMeanMinDist_LT,*pfCurrMeanMinDist_ST)*(*pfCurrVariationFactor));
-			}
-			else if((*pfCurrLearningRate)>m_fCurrLearningRateLowerCap)
-				*pfCurrLearningRate -= FEEDBACK_T_DECR*(*pfCurrVariationFactor)/std::max(*pfCurrMeanMinDist_LT,*pfCurrMeanMinDist_ST);
-			if((*pfCurrLearningRate)<m_fCurrLearningRateLowerCap)
-				*pfCurrLearningRate = m_fCurrLearningRateLowerCap;
-			else if((*pfCurrLearningRate)>m_fCurrLearningRateUpperCap)
-				*pfCurrLearningRate = m_fCurrLearningRateUpperCap;
-			if(std::max(*pfCurrMeanMinDist_LT,*pfCurrMeanMinDist_ST)>UNSTABLE_REG_RATIO_MIN && m_oBlinksFrame.data[nPxIter])
-				(*pfCurrVariationFactor) += FEEDBACK_V_INCR;
-			else if((*pfCurrVariationFactor)>FEEDBACK_V_DECR) {
-				(*pfCurrVariationFactor) -= m_oLastFGMask.data[nPxIter]?FEEDBACK_V_DECR/4:m_oUnstableRegionMask.data[nPxIter]?FEEDBACK_V_DECR/2:FEEDBACK_V_DECR;
-				if((*pfCurrVariationFactor)<FEEDBACK_V_DECR)
-					(*pfCurrVariationFactor) = FEEDBACK_V_DECR;
-			}
-			if((*pfCurrDistThresholdFactor)<std::pow(1.0f+std::min(*pfCurrMeanMinDist_LT,*pfCurrMeanMinDist_ST)*2,2))
-				(*pfCurrDistThresholdFactor) += FEEDBACK_R_VAR*(*pfCurrVariationFactor-FEEDBACK_V_DECR);
-			else {
-				(*pfCurrDistThresholdFactor) -= FEEDBACK_R_VAR/(*pfCurrVariationFactor);
-				if((*pfCurrDistThresholdFactor)<1.0f)
-					(*pfCurrDistThresholdFactor) = 1.0f;
-			}
-			if(popcount(nCurrIntraDesc)>=2)
-				++nNonZeroDescCount;
-			nLastIntraDesc = nCurrIntraDesc;
-			nLastColor = nCurrColor;
-		}
+			return nBandNonZeroDescCount;
+		});
 	}
 	else { //m_nImgChannels==3
-		for(size_t nModelIter=0; nModelIter<m_nTotRelevantPxCount; ++nModelIter) {
-			const size_t nPxIter = m_aPxIdxLUT[nModelIter];
-			const int nCurrImgCoord_X = m_aPxInfoLUT[nPxIter].nImgCoord_X;
-			const int nCurrImgCoord_Y = m_aPxInfoLUT[nPxIter].nImgCoord_Y;
-			const size_t nPxIterRGB = nPxIter*3;
-			const size_t nDescIterRGB = nPxIterRGB*2;
-			const size_t nFloatIter = nPxIter*4;
-			const uchar* const anCurrColor = oInputImg.data+nPxIterRGB;
-			size_t nMinTotDescDist=s_nDescMaxDataRange_3ch;
-			size_t nMinTotSumDist=s_nColorMaxDataRange_3ch;
-			float* pfCurrDistThresholdFactor = (float*)(m_oDistThresholdFrame.data+nFloatIter);
-			float* pfCurrVariationFactor = (float*)(m_oVariationModulatorFrame.data+nFloatIter);
-			float* pfCurrLearningRate = ((float*)(m_oUpdateRateFrame.data+nFloatIter));
-			float* pfCurrMeanLastDist = ((float*)(m_oMeanLastDistFrame.data+nFloatIter));
-			float* pfCurrMeanMinDist_LT = ((float*)(m_oMeanMinDistFrame_LT.data+nFloatIter));
-			float* pfCurrMeanMinDist_ST = ((float*)(m_oMeanMinDistFrame_ST.data+nFloatIter));
-			float* pfCurrMeanRawSegmRes_LT = ((float*)(m_oMeanRawSegmResFrame_LT.data+nFloatIter));
-			float* pfCurrMeanRawSegmRes_ST = ((float*)(m_oMeanRawSegmResFrame_ST.data+nFloatIter));
-			float* pfCurrMeanFinalSegmRes_LT = ((float*)(m_oMeanFinalSegmResFrame_LT.data+nFloatIter));
-			float* pfCurrMeanFinalSegmRes_ST = ((float*)(m_oMeanFinalSegmResFrame_ST.data+nFloatIter));
-			ushort* anLastIntraDesc = ((ushort*)(m_oLastDescFrame.data+nDescIterRGB));
-			uchar* anLastColor = m_oLastColorFrame.data+nPxIterRGB;
-			const size_t nCurrColorDistThreshold = (size_t)(((*pfCurrDistThresholdFactor)*m_nMinColorDistThreshold)-((!m_oUnstableRegionMask.data[nPxIter])*STAB_COLOR_DIST_OFFSET));
-			const size_t nCurrDescDistThreshold = ((size_t)1<<((size_t)floor(*pfCurrDistThresholdFactor+0.5f)))+m_nDescDistThresholdOffset+(m_oUnstableRegionMask.data[nPxIter]*UNSTAB_DESC_DIST_OFFSET);
-			const size_t nCurrTotColorDistThreshold = nCurrColorDistThreshold*3;
-			const size_t nCurrTotDescDistThreshold = nCurrDescDistThreshold*3;
-			const size_t nCurrSCColorDistThreshold = nCurrTotColorDistThreshold/2;
-			ushort anCurrInterDesc[3], anCurrIntraDesc[3];
-			const size_t anCurrIntraLBSPThresholds[3] = {m_anLBSPThreshold_8bitLUT[anCurrColor[0]],m_anLBSPThreshold_8bitLUT[anCurrColor[1]],m_anLBSPThreshold_8bitLUT[anCurrColor[2]]};
-			LBSP::computeRGBDescriptor(oInputImg,anCurrColor,nCurrImgCoord_X,nCurrImgCoord_Y,anCurrIntraLBSPThresholds,anCurrIntraDesc);
-			m_oUnstableRegionMask.data[nPxIter] = ((*pfCurrDistThresholdFactor)>UNSTABLE_REG_RDIST_MIN || (*pfCurrMeanRawSegmRes_LT-*pfCurrMeanFinalSegmRes_LT)>UNSTABLE_REG_RATIO_MIN || (*pfCurrMeanRawSegmRes_ST-*pfCurrMeanFinalSegmRes_ST)>UNSTABLE_REG_RATIO_MIN)?1:0;
-			size_t nGoodSamplesCount=0, nSampleIdx=0;
-			while(nGoodSamplesCount<m_nRequiredBGSamples && nSampleIdx<m_nBGSamples) {
-				const ushort* const anBGIntraDesc = (ushort*)(m_voBGDescSamples[nSampleIdx].data+nDescIterRGB);
-				const uchar* const anBGColor = m_voBGColorSamples[nSampleIdx].data+nPxIterRGB;
-				size_t nTotDescDist = 0;
-				size_t nTotSumDist = 0;
-				for(size_t c=0;c<3; ++c) {
-					const size_t nColorDist = L1dist(anCurrColor[c],anBGColor[c]);
-					if(nColorDist>nCurrSCColorDistThreshold)
-						goto failedcheck3ch;
-					const size_t nIntraDescDist = hdist(anCurrIntraDesc[c],anBGIntraDesc[c]);
-					LBSP::computeSingleRGBDescriptor(oInputImg,anBGColor[c],nCurrImgCoord_X,nCurrImgCoord_Y,c,m_anLBSPThreshold_8bitLUT[anBGColor[c]],anCurrInterDesc[c]);
-					const size_t nInterDescDist = hdist(anCurrInterDesc[c],anBGIntraDesc[c]);
-					const size_t nDescDist = (nIntraDescDist+nInterDescDist)/2;
-					const size_t nSumDist = std::min((nDescDist/2)*(s_nColorMaxDataRange_1ch/s_nDescMaxDataRange_1ch)+nColorDist,s_nColorMaxDataRange_1ch);
-					if(nSumDist>nCurrSCColorDistThreshold)
+		nNonZeroDescCount = processBands([&](size_t nModelIterBegin, size_t nModelIterEnd, BandRand& rnd) -> size_t {
+			size_t nBandNonZeroDescCount = 0;
+			for(size_t nModelIter=nModelIterBegin; nModelIter<nModelIterEnd; ++nModelIter) {
+				const size_t nPxIter = m_aPxIdxLUT[nModelIter];
+				const int nCurrImgCoord_X = m_aPxInfoLUT[nPxIter].nImgCoord_X;
+				const int nCurrImgCoord_Y = m_aPxInfoLUT[nPxIter].nImgCoord_Y;
+				const size_t nPxIterRGB = nPxIter*3;
+				const size_t nDescIterRGB = nPxIterRGB*2;
+				const size_t nFloatIter = nPxIter*4;
+				const uchar* const anCurrColor = oInputImg.data+nPxIterRGB;
+				size_t nMinTotDescDist=s_nDescMaxDataRange_3ch;
+				size_t nMinTotSumDist=s_nColorMaxDataRange_3ch;
+				float* pfCurrDistThresholdFactor = (float*)(m_oDistThresholdFrame.data+nFloatIter);
+				float* pfCurrVariationFactor = (float*)(m_oVariationModulatorFrame.data+nFloatIter);
+				float* pfCurrLearningRate = ((float*)(m_oUpdateRateFrame.data+nFloatIter));
+				float* pfCurrMeanLastDist = ((float*)(m_oMeanLastDistFrame.data+nFloatIter));
+				float* pfCurrMeanMinDist_LT = ((float*)(m_oMeanMinDistFrame_LT.data+nFloatIter));
+				float* pfCurrMeanMinDist_ST = ((float*)(m_oMeanMinDistFrame_ST.data+nFloatIter));
+				float* pfCurrMeanRawSegmRes_LT = ((float*)(m_oMeanRawSegmResFrame_LT.data+nFloatIter));
+				float* pfCurrMeanRawSegmRes_ST = ((float*)(m_oMeanRawSegmResFrame_ST.data+nFloatIter));
+				float* pfCurrMeanFinalSegmRes_LT = ((float*)(m_oMeanFinalSegmResFrame_LT.data+nFloatIter));
+				float* pfCurrMeanFinalSegmRes_ST = ((float*)(m_oMeanFinalSegmResFrame_ST.data+nFloatIter));
+				ushort* anLastIntraDesc = ((ushort*)(m_oLastDescFrame.data+nDescIterRGB));
+				uchar* anLastColor = m_oLastColorFrame.data+nPxIterRGB;
+				const size_t nCurrColorDistThreshold = (size_t)(((*pfCurrDistThresholdFactor)*m_nMinColorDistThreshold)-((!m_oUnstableRegionMask.data[nPxIter])*STAB_COLOR_DIST_OFFSET));
+				const size_t nCurrDescDistThreshold = ((size_t)1<<((size_t)floor(*pfCurrDistThresholdFactor+0.5f)))+m_nDescDistThresholdOffset+(m_oUnstableRegionMask.data[nPxIter]*UNSTAB_DESC_DIST_OFFSET);
+				const size_t nCurrTotColorDistThreshold = nCurrColorDistThreshold*3;
+				const size_t nCurrTotDescDistThreshold = nCurrDescDistThreshold*3;
+				const size_t nCurrSCColorDistThreshold = nCurrTotColorDistThreshold/2;
+				ushort anCurrInterDesc[3];
+				const ushort* const anCurrIntraDesc = (const ushort*)(m_oCurrIntraDescFrame.data+nDescIterRGB);
+				m_oUnstableRegionMask.data[nPxIter] = ((*pfCurrDistThresholdFactor)>UNSTABLE_REG_RDIST_MIN || (*pfCurrMeanRawSegmRes_LT-*pfCurrMeanFinalSegmRes_LT)>UNSTABLE_REG_RATIO_MIN || (*pfCurrMeanRawSegmRes_ST-*pfCurrMeanFinalSegmRes_ST)>UNSTABLE_REG_RATIO_MIN)?1:0;
+				size_t nGoodSamplesCount=0, nSampleIdx=0;
+				while(nGoodSamplesCount<m_nRequiredBGSamples && nSampleIdx<m_nBGSamples) {
+					const ushort* const anBGIntraDesc = (ushort*)(m_voBGDescSamples[nSampleIdx].data+nDescIterRGB);
+					const uchar* const anBGColor = m_voBGColorSamples[nSampleIdx].data+nPxIterRGB;
+					size_t nTotDescDist = 0;
+					size_t nTotSumDist = 0;
+					for(size_t c=0;c<3; ++c) {
+						const size_t nColorDist = L1dist(anCurrColor[c],anBGColor[c]);
+						if(nColorDist>nCurrSCColorDistThreshold)
+							goto failedcheck3ch;
+						const size_t nIntraDescDist = hdist(anCurrIntraDesc[c],anBGIntraDesc[c]);
+						LBSP::computeSingleRGBDescriptor(oInputImg,anBGColor[c],nCurrImgCoord_X,nCurrImgCoord_Y,c,m_anLBSPThreshold_8bitLUT[anBGColor[c]],anCurrInterDesc[c]);
+						const size_t nInterDescDist = hdist(anCurrInterDesc[c],anBGIntraDesc[c]);
+						const size_t nDescDist = (nIntraDescDist+nInterDescDist)/2;
+						const size_t nSumDist = std::min((nDescDist/2)*(s_nColorMaxDataRange_1ch/s_nDescMaxDataRange_1ch)+nColorDist,s_nColorMaxDataRange_1ch);
+						if(nSumDist>nCurrSCColorDistThreshold)
+							goto failedcheck3ch;
+						nTotDescDist += nDescDist;
+						nTotSumDist += nSumDist;
+					}
+					if(nTotDescDist>nCurrTotDescDistThreshold || nTotSumDist>nCurrTotColorDistThreshold)
 						goto failedcheck3ch;
-					nTotDescDist += nDescDist;
-					nTotSumDist += nSumDist;
+					if(nMinTotDescDist>nTotDescDist)
+						nMinTotDescDist = nTotDescDist;
+					if(nMinTotSumDist>nTotSumDist)
+						nMinTotSumDist = nTotSumDist;
+					nGoodSamplesCount++;
+					failedcheck3ch:
+					nSampleIdx++;
 				}
-				if(nTotDescDist>nCurrTotDescDistThreshold || nTotSumDist>nCurrTotColorDistThreshold)
-					goto failedcheck3ch;
-				if(nMinTotDescDist>nTotDescDist)
-					nMinTotDescDist = nTotDescDist;
-				if(nMinTotSumDist>nTotSumDist)
-					nMinTotSumDist = nTotSumDist;
-				nGoodSamplesCount++;
-				failedcheck3ch:
-				nSampleIdx++;
-			}
-			const float fNormalizedLastDist = ((float)L1dist<3>(anLastColor,anCurrColor)/s_nColorMaxDataRange_3ch+(float)hdist<3>(anLastIntraDesc,anCurrIntraDesc)/s_nDescMaxDataRange_3ch)/2;
-			*pfCurrMeanLastDist = (*pfCurrMeanLastDist)*(1.0f-fRollAvgFactor_ST) + fNormalizedLastDist*fRollAvgFactor_ST;
-			if(nGoodSamplesCount<m_nRequiredBGSamples) {
-				// == foreground
-				const float fNormalizedMinDist = std::min(1.0f,((float)nMinTotSumDist/s_nColorMaxDataRange_3ch+(float)nMinTotDescDist/s_nDescMaxDataRange_3ch)/2 + (float)(m_nRequiredBGSamples-nGoodSamplesCount)/m_nRequiredBGSamples);
-				*pfCurrMeanMinDist_LT = (*pfCurrMeanMinDist_LT)*(1.0f-fRollAvgFactor_LT) + fNormalizedMinDist*fRollAvgFactor_LT;
-				*pfCurrMeanMinDist_ST = (*pfCurrMeanMinDist_ST)*(1.0f-fRollAvgFactor_ST) + fNormalizedMinDist*fRollAvgFactor_ST;
-				*pfCurrMeanRawSegmRes_LT = (*pfCurrMeanRawSegmRes_LT)*(1.0f-fRollAvgFactor_LT) + fRollAvgFactor_LT;
-				*pfCurrMeanRawSegmRes_ST = (*pfCurrMeanRawSegmRes_ST)*(1.0f-fRollAvgFactor_ST) + fRollAvgFactor_ST;
-				oCurrFGMask.data[nPxIter] = UCHAR_MAX;
-				if(m_nModelResetCooldown && (rand()%(size_t)FEEDBACK_T_LOWER)==0) {
-					const size_t s_rand = rand()%m_nBGSamples;
-					for(size_t c=0; c<3; ++c) {
-						*((ushort*)(m_voBGDescSamples[s_rand].data+nDescIterRGB+2*c)) = anCurrIntraDesc[c];
-						*(m_voBGColorSamples[s_rand].data+nPxIterRGB+c) = anCurrColor[c];
+				const float fNormalizedLastDist = ((float)L1dist<3>(anLastColor,anCurrColor)/s_nColorMaxDataRange_3ch+(float)hdist<3>(anLastIntraDesc,anCurrIntraDesc)/s_nDescMaxDataRange_3ch)/2;
+				*pfCurrMeanLastDist = (*pfCurrMeanLastDist)*(1.0f-fRollAvgFactor_ST) + fNormalizedLastDist*fRollAvgFactor_ST;
+				if(nGoodSamplesCount<m_nRequiredBGSamples) {
+					// == foreground
+					const float fNormalizedMinDist = std::min(1.0f,((float)nMinTotSumDist/s_nColorMaxDataRange_3ch+(float)nMinTotDescDist/s_nDescMaxDataRange_3ch)/2 + (float)(m_nRequiredBGSamples-nGoodSamplesCount)/m_nRequiredBGSamples);
+					*pfCurrMeanMinDist_LT = (*pfCurrMeanMinDist_LT)*(1.0f-fRollAvgFactor_LT) + fNormalizedMinDist*fRollAvgFactor_LT;
+					*pfCurrMeanMinDist_ST = (*pfCurrMeanMinDist_ST)*(1.0f-fRollAvgFactor_ST) + fNormalizedMinDist*fRollAvgFactor_ST;
+					*pfCurrMeanRawSegmRes_LT = (*pfCurrMeanRawSegmRes_LT)*(1.0f-fRollAvgFactor_LT) + fRollAvgFactor_LT;
+					*pfCurrMeanRawSegmRes_ST = (*pfCurrMeanRawSegmRes_ST)*(1.0f-fRollAvgFactor_ST) + fRollAvgFactor_ST;
+					oCurrFGMask.data[nPxIter] = UCHAR_MAX;
+					if(m_nModelResetCooldown && (rnd()%(size_t)FEEDBACK_T_LOWER)==0) {
+						const size_t s_rand = rnd()%m_nBGSamples;
+						for(size_t c=0; c<3; ++c) {
+							*((ushort*)(m_voBGDescSamples[s_rand].data+nDescIterRGB+2*c)) = anCurrIntraDesc[c];
+							*(m_voBGColorSamples[s_rand].data+nPxIterRGB+c) = anCurrColor[c];
+						}
 					}
 				}
-			}
-			else {
-				// == background
-				const float fNormalizedMinDist = ((float)nMinTotSumDist/s_nColorMaxDataRange_3ch+(float)nMinTotDescDist/s_nDescMaxDataRange_3ch)/2;
-				*pfCurrMeanMinDist_LT = (*pfCurrMeanMinDist_LT)*(1.0f-fRollAvgFactor_LT) + fNormalizedMinDist*fRollAvgFactor_LT;
-				*pfCurrMeanMinDist_ST = (*pfCurrMeanMinDist_ST)*(1.0f-fRollAvgFactor_ST) + fNormalizedMinDist*fRollAvgFactor_ST;
-				*pfCurrMeanRawSegmRes_LT = (*pfCurrMeanRawSegmRes_LT)*(1.0f-fRollAvgFactor_LT);
-				*pfCurrMeanRawSegmRes_ST = (*pfCurrMeanRawSegmRes_ST)*(1.0f-fRollAvgFactor_ST);
-				const size_t nLearningRate = learningRateOverride>0?(size_t)ceil(learningRateOverride):(size_t)ceil(*pfCurrLearningRate);
-				if((rand()%nLearningRate)==0) {
-					const size_t s_rand = rand()%m_nBGSamples;
-					for(size_t c=0; c<3; ++c) {
-						*((ushort*)(m_voBGDescSamples[s_rand].data+nDescIterRGB+2*c)) = anCurrIntraDesc[c];
-						*(m_voBGColorSamples[s_rand].data+nPxIterRGB+c) = anCurrColor[c];
+				else {
+					// == background
+					const float fNormalizedMinDist = ((float)nMinTotSumDist/s_nColorMaxDataRange_3ch+(float)nMinTotDescDist/s_nDescMaxDataRange_3ch)/2;
+					*pfCurrMeanMinDist_LT = (*pfCurrMeanMinDist_LT)*(1.0f-fRollAvgFactor_LT) + fNormalizedMinDist*fRollAvgFactor_LT;
+					*pfCurrMeanMinDist_ST = (*pfCurrMeanMinDist_ST)*(1.0f-fRollAvgFactor_ST) + fNormalizedMinDist*fRollAvgFactor_ST;
+					*pfCurrMeanRawSegmRes_LT = (*pfCurrMeanRawSegmRes_LT)*(1.0f-fRollAvgFactor_LT);
+					*pfCurrMeanRawSegmRes_ST = (*pfCurrMeanRawSegmRes_ST)*(1.0f-fRollAvgFactor_ST);
+					const size_t nLearningRate = learningRateOverride>0?(size_t)ceil(learningRateOverride):(size_t)ceil(*pfCurrLearningRate);
+					if((rnd()%nLearningRate)==0) {
+						const size_t s_rand = rnd()%m_nBGSamples;
+						for(size_t c=0; c<3; ++c) {
+							*((ushort*)(m_voBGDescSamples[s_rand].data+nDescIterRGB+2*c)) = anCurrIntraDesc[c];
+							*(m_voBGColorSamples[s_rand].data+nPxIterRGB+c) = anCurrColor[c];
+						}
 					}
-				}
-				int nSampleImgCoord_Y, nSampleImgCoord_X;
-				const bool bCurrUsing3x3Spread = m_bUse3x3Spread && !m_oUnstableRegionMask.data[nPxIter];
-				if(bCurrUsing3x3Spread)
-					getRandNeighborPosition_3x3(nSampleImgCoord_X,nSampleImgCoord_Y,nCurrImgCoord_X,nCurrImgCoord_Y,LBSP::PATCH_SIZE/2,m_oImgSize);
-				else
-					getRandNeighborPosition_5x5(nSampleImgCoord_X,nSampleImgCoord_Y,nCurrImgCoord_X,nCurrImgCoord_Y,LBSP::PATCH_SIZE/2,m_oImgSize);
-				const size_t n_rand = rand();
-				const size_t idx_rand_uchar = m_oImgSize.width*nSampleImgCoord_Y + nSampleImgCoord_X;
-				const size_t idx_rand_flt32 = idx_rand_uchar*4;
-				const float fRandMeanLastDist = *((float*)(m_oMeanLastDistFrame.data+idx_rand_flt32));
-				const float fRandMeanRawSegmRes = *((float*)(m_oMeanRawSegmResFrame_ST.data+idx_rand_flt32));
-				if((n_rand%(bCurrUsing3x3Spread?nLearningRate:(nLearningRate/2+1)))==0
-					|| (fRandMeanRawSegmRes>GHOSTDET_S_MIN && fRandMeanLastDist<GHOSTDET_D_MAX && (n_rand%((size_t)m_fCurrLearningRateLowerCap))==0)) {
-					const size_t idx_rand_uchar_rgb = idx_rand_uchar*3;
-					const size_t idx_rand_ushrt_rgb = idx_rand_uchar_rgb*2;
-					const size_t s_rand = rand()%m_nBGSamples;
-					for(size_t c=0; c<3; ++c) {
-						*((ushort*)(m_voBGDescSamples[s_rand].data+idx_rand_ushrt_rgb+2*c)) = anCurrIntraDesc[c];
-						*(m_voBGColorSamples[s_rand].data+idx_rand_uchar_rgb+c) = anCurrColor[c];
+					int nSampleImgCoord_Y, nSampleImgCoord_X;
+					const bool bCurrUsing3x3Spread = m_bUse3x3Spread && !m_oUnstableRegionMask.data[nPxIter];
+					if(bCurrUsing3x3Spread)
+						getRandNeighborPosition_3x3(nSampleImgCoord_X,nSampleImgCoord_Y,nCurrImgCoord_X,nCurrImgCoord_Y,LBSP::PATCH_SIZE/2,m_oImgSize,rnd);
+					else
+						getRandNeighborPosition_5x5(nSampleImgCoord_X,nSampleImgCoord_Y,nCurrImgCoord_X,nCurrImgCoord_Y,LBSP::PATCH_SIZE/2,m_oImgSize,rnd);
+					const size_t n_rand = rnd();
+					const size_t idx_rand_uchar = m_oImgSize.width*nSampleImgCoord_Y + nSampleImgCoord_X;
+					const size_t idx_rand_flt32 = idx_rand_uchar*4;
+					const float fRandMeanLastDist = *((float*)(m_oMeanLastDistFrame.data+idx_rand_flt32));
+					const float fRandMeanRawSegmRes = *((float*)(m_oMeanRawSegmResFrame_ST.data+idx_rand_flt32));
+					if((n_rand%(bCurrUsing3x3Spread?nLearningRate:(nLearningRate/2+1)))==0
+						|| (fRandMeanRawSegmRes>GHOSTDET_S_MIN && fRandMeanLastDist<GHOSTDET_D_MAX && (n_rand%((size_t)m_fCurrLearningRateLowerCap))==0)) {
+						const size_t idx_rand_uchar_rgb = idx_rand_uchar*3;
+						const size_t idx_rand_ushrt_rgb = idx_rand_uchar_rgb*2;
+						const size_t s_rand = rnd()%m_nBGSamples;
+						for(size_t c=0; c<3; ++c) {
+							*((ushort*)(m_voBGDescSamples[s_rand].data+idx_rand_ushrt_rgb+2*c)) = anCurrIntraDesc[c];
+							*(m_voBGColorSamples[s_rand].data+idx_rand_uchar_rgb+c) = anCurrColor[c];
+						}
 					}
 				}
+				if(m_oLastFGMask.data[nPxIter] || (std::min(*pfCurrMeanMinDist_LT,*pfCurrMeanMinDist_ST)<UNSTABLE_REG_RATIO_MIN && oCurrFGMask.data[nPxIter])) {
+					if((*pfCurrLearningRate)<m_fCurrLearningRateUpperCap)
+						*pfCurrLearningRate += FEEDBACK_T_INCR/(std::max(*pfCurrMeanMinDist_LT,*pfCurrMeanMinDist_ST)*(*pfCurrVariationFactor));
+				}
+				else if((*pfCurrLearningRate)>m_fCurrLearningRateLowerCap)
+					*pfCurrLearningRate -= FEEDBACK_T_DECR*(*pfCurrVariationFactor)/std::max(*pfCurrMeanMinDist_LT,*pfCurrMeanMinDist_ST);
+				if((*pfCurrLearningRate)<m_fCurrLearningRateLowerCap)
+					*pfCurrLearningRate = m_fCurrLearningRateLowerCap;
+				else if((*pfCurrLearningRate)>m_fCurrLearningRateUpperCap)
+					*pfCurrLearningRate = m_fCurrLearningRateUpperCap;
+				if(std::max(*pfCurrMeanMinDist_LT,*pfCurrMeanMinDist_ST)>UNSTABLE_REG_RATIO_MIN && m_oBlinksFrame.data[nPxIter])
+					(*pfCurrVariationFactor) += FEEDBACK_V_INCR;
+				else if((*pfCurrVariationFactor)>FEEDBACK_V_DECR) {
+					(*pfCurrVariationFactor) -= m_oLastFGMask.data[nPxIter]?FEEDBACK_V_DECR/4:m_oUnstableRegionMask.data[nPxIter]?FEEDBACK_V_DECR/2:FEEDBACK_V_DECR;
+					if((*pfCurrVariationFactor)<FEEDBACK_V_DECR)
+						(*pfCurrVariationFactor) = FEEDBACK_V_DECR;
+				}
+				if((*pfCurrDistThresholdFactor)<std::pow(1.0f+std::min(*pfCurrMeanMinDist_LT,*pfCurrMeanMinDist_ST)*2,2))
+					(*pfCurrDistThresholdFactor) += FEEDBACK_R_VAR*(*pfCurrVariationFactor-FEEDBACK_V_DECR);
+				else {
+					(*pfCurrDistThresholdFactor) -= FEEDBACK_R_VAR/(*pfCurrVariationFactor);
+					if((*pfCurrDistThresholdFactor)<1.0f)
+						(*pfCurrDistThresholdFactor) = 1.0f;
+				}
+				if(popcount<3>(anCurrIntraDesc)>=4)
+					++nBandNonZeroDescCount;
+				for(size_t c=0; c<3; ++c) {
+					anLastIntraDesc[c] = anCurrIntraDesc[c];
+					anLastColor[c] = anCurrColor[c];
+				}
 			}
-			if(m_oLastFGMask.data[nPxIter] || (std::min(*pfCurrMeanMinDist_LT,*pfCurrMeanMinDist_ST)<UNSTABLE_REG_RATIO_MIN && oCurrFGMask.data[nPxIter])) {
-				if((*pfCurrLearningRate)<m_fCurrLearningRateUpperCap)
-					*pfCurrLearningRate += FEEDBACK_T_INCR/(std::max(*pfCurrMeanMinDist_LT,*pfCurrMeanMinDist_ST)*(*pfCurrVariationFactor));
-			}
-			else if((*pfCurrLearningRate)>m_fCurrLearningRateLowerCap)
-				*pfCurrLearningRate -= FEEDBACK_T_DECR*(*pfCurrVariationFactor)/std::max(*pfCurrMeanMinDist_LT,*pfCurrMeanMinDist_ST);
-			if((*pfCurrLearningRate)<m_fCurrLearningRateLowerCap)
-				*pfCurrLearningRate = m_fCurrLearningRateLowerCap;
-			else if((*pfCurrLearningRate)>m_fCurrLearningRateUpperCap)
-				*pfCurrLearningRate = m_fCurrLearningRateUpperCap;
-			if(std::max(*pfCurrMeanMinDist_LT,*pfCurrMeanMinDist_ST)>UNSTABLE_REG_RATIO_MIN && m_oBlinksFrame.data[nPxIter])
-				(*pfCurrVariationFactor) += FEEDBACK_V_INCR;
-			else if((*pfCurrVariationFactor)>FEEDBACK_V_DECR) {
-				(*pfCurrVariationFactor) -= m_oLastFGMask.data[nPxIter]?FEEDBACK_V_DECR/4:m_oUnstableRegionMask.data[nPxIter]?FEEDBACK_V_DECR/2:FEEDBACK_V_DECR;
-				if((*pfCurrVariationFactor)<FEEDBACK_V_DECR)
-					(*pfCurrVariationFactor) = FEEDBACK_V_DECR;
-			}
-			if((*pfCurrDistThresholdFactor)<std::pow(1.0f+std::min(*pfCurrMeanMinDist_LT,*pfCurrMeanMinDist_ST)*2,2))
-				(*pfCurrDistThresholdFactor) += FEEDBACK_R_VAR*(*pfCurrVariationFactor-FEEDBACK_V_DECR);
-			else {
-				(*pfCurrDistThresholdFactor) -= FEEDBACK_R_VAR/(*pfCurrVariationFactor);
-				if((*pfCurrDistThresholdFactor)<1.0f)
-					(*pfCurrDistThresholdFactor) = 1.0f;
-			}
-			if(popcount<3>(anCurrIntraDesc)>=4)
-				++nNonZeroDescCount;
-			for(size_t c=0; c<3; ++c) {
-				anLastIntraDesc[c] = anCurrIntraDesc[c];
-				anLastColor[c] = anCurrColor[c];
-			}
-		}
+			return nBandNonZeroDescCount;
+		});
 	}
 #if DISPLAY_SUBSENSE_DEBUG_INFO
 	std::cout << std::endl;
@@ -655,19 +687,24 @@ void BackgroundSubtractorSuBSENSE::operator()(cv::InputArray _image, cv::OutputA
 		cv::resize(oInputImg,m_oDownSampledFrame_MotionAnalysis,m_oDownSampledFrameSize,0,0,cv::INTER_AREA);
 		cv::accumulateWeighted(m_oDownSampledFrame_MotionAnalysis,m_oMeanDownSampledLastDistFrame_LT,fRollAvgFactor_LT);
 		cv::accumulateWeighted(m_oDownSampledFrame_MotionAnalysis,m_oMeanDownSampledLastDistFrame_ST,fRollAvgFactor_ST);
-		size_t nTotColorDiff = 0;
-		for(int i=0; i<m_oMeanDownSampledLastDistFrame_ST.rows; ++i) {
-			const size_t idx1 = m_oMeanDownSampledLastDistFrame_ST.step.p[0]*i;
-			for(int j=0; j<m_oMeanDownSampledLastDistFrame_ST.cols; ++j) {
-				const size_t idx2 = idx1+m_oMeanDownSampledLastDistFrame_ST.step.p[1]*j;
-				nTotColorDiff += (m_nImgChannels==1)?
-					(size_t)fabs((*(float*)(m_oMeanDownSampledLastDistFrame_ST.data+idx2))-(*(float*)(m_oMeanDownSampledLastDistFrame_LT.data+idx2)))/2
-							:  //(m_nImgChannels==3)
-						std::max((size_t)fabs((*(float*)(m_oMeanDownSampledLastDistFrame_ST.data+idx2))-(*(float*)(m_oMeanDownSampledLastDistFrame_LT.data+idx2))),
-							std::max((size_t)fabs((*(float*)(m_oMeanDownSampledLastDistFrame_ST.data+idx2+4))-(*(float*)(m_oMeanDownSampledLastDistFrame_LT.data+idx2+4))),
-										(size_t)fabs((*(float*)(m_oMeanDownSampledLastDistFrame_ST.data+idx2+8))-(*(float*)(m_oMeanDownSampledLastDistFrame_LT.data+idx2+8)))));
+		std::atomic<size_t> nTotColorDiffSum(0);
+		tasks::ParallelForRange(0,m_oMeanDownSampledLastDistFrame_ST.rows,[&](int nRowBegin, int nRowEnd) {
+			size_t nTotColorDiff = 0;
+			for(int i=nRowBegin; i<nRowEnd; ++i) {
+				const size_t idx1 = m_oMeanDownSampledLastDistFrame_ST.step.p[0]*i;
+				for(int j=0; j<m_oMeanDownSampledLastDistFrame_ST.cols; ++j) {
+					const size_t idx2 = idx1+m_oMeanDownSampledLastDistFrame_ST.step.p[1]*j;
+					nTotColorDiff += (m_nImgChannels==1)?
+						(size_t)fabs((*(float*)(m_oMeanDownSampledLastDistFrame_ST.data+idx2))-(*(float*)(m_oMeanDownSampledLastDistFrame_LT.data+idx2)))/2
+								:  //(m_nImgChannels==3)
+							std::max((size_t)fabs((*(float*)(m_oMeanDownSampledLastDistFrame_ST.data+idx2))-(*(float*)(m_oMeanDownSampledLastDistFrame_LT.data+idx2))),
+								std::max((size_t)fabs((*(float*)(m_oMeanDownSampledLastDistFrame_ST.data+idx2+4))-(*(float*)(m_oMeanDownSampledLastDistFrame_LT.data+idx2+4))),
+											(size_t)fabs((*(float*)(m_oMeanDownSampledLastDistFrame_ST.data+idx2+8))-(*(float*)(m_oMeanDownSampledLastDistFrame_LT.data+idx2+8)))));
+				}
 			}
-		}
+			nTotColorDiffSum += nTotColorDiff;
+		});
+		const size_t nTotColorDiff = nTotColorDiffSum;
 		const float fCurrColorDiffRatio = (float)nTotColorDiff/(m_oMeanDownSampledLastDistFrame_ST.rows*m_oMeanDownSampledLastDistFrame_ST.cols);
 		if(m_bAutoModelResetEnabled) {
 			if(m_nFramesSinceLastReset>1000)
@@ -742,3 +779,60 @@ void BackgroundSubtractorSuBSENSE::apply(cv::InputArray image, cv::OutputArray f
 	else
 		initialize(image.getMat(), cv::Mat());
 }
+
+void BackgroundSubtractorSuBSENSE::exportModel(ModelMats& mModel) const {
+	exportBaseModel(mModel);
+	exportSamples(mModel,m_voBGColorSamples,m_voBGDescSamples);
+	mModel["updateRate"] = m_oUpdateRateFrame.clone();
+	mModel["distThreshold"] = m_oDistThresholdFrame.clone();
+	mModel["variationModulator"] = m_oVariationModulatorFrame.clone();
+	mModel["meanLastDist"] = m_oMeanLastDistFrame.clone();
+	mModel["meanMinDist_LT"] = m_oMeanMinDistFrame_LT.clone();
+	mModel["meanMinDist_ST"] = m_oMeanMinDistFrame_ST.clone();
+	mModel["meanDownSampledLastDist_LT"] = m_oMeanDownSampledLastDistFrame_LT.clone();
+	mModel["meanDownSampledLastDist_ST"] = m_oMeanDownSampledLastDistFrame_ST.clone();
+	mModel["meanRawSegmRes_LT"] = m_oMeanRawSegmResFrame_LT.clone();
+	mModel["meanRawSegmRes_ST"] = m_oMeanRawSegmResFrame_ST.clone();
+	mModel["meanFinalSegmRes_LT"] = m_oMeanFinalSegmResFrame_LT.clone();
+	mModel["meanFinalSegmRes_ST"] = m_oMeanFinalSegmResFrame_ST.clone();
+	mModel["unstableRegionMask"] = m_oUnstableRegionMask.clone();
+	mModel["blinks"] = m_oBlinksFrame.clone();
+	mModel["lastRawFGMask"] = m_oLastRawFGMask.clone();
+	mModel["lastRawFGBlinkMask"] = m_oLastRawFGBlinkMask.clone();
+	mModel["scalars"] = (cv::Mat_<double>(1,3) << m_fLastNonZeroDescRatio, m_fCurrLearningRateLowerCap, m_fCurrLearningRateUpperCap);
+}
+
+bool BackgroundSubtractorSuBSENSE::importModel(const ModelMats& mModel) {
+	if(!importBaseModel(mModel) || !importSamples(mModel,m_voBGColorSamples,m_voBGDescSamples))
+		return false;
+	const std::pair<const char*, cv::Mat*> aFrames[] = {
+		{"updateRate", &m_oUpdateRateFrame},
+		{"distThreshold", &m_oDistThresholdFrame},
+		{"variationModulator", &m_oVariationModulatorFrame},
+		{"meanLastDist", &m_oMeanLastDistFrame},
+		{"meanMinDist_LT", &m_oMeanMinDistFrame_LT},
+		{"meanMinDist_ST", &m_oMeanMinDistFrame_ST},
+		{"meanDownSampledLastDist_LT", &m_oMeanDownSampledLastDistFrame_LT},
+		{"meanDownSampledLastDist_ST", &m_oMeanDownSampledLastDistFrame_ST},
+		{"meanRawSegmRes_LT", &m_oMeanRawSegmResFrame_LT},
+		{"meanRawSegmRes_ST", &m_oMeanRawSegmResFrame_ST},
+		{"meanFinalSegmRes_LT", &m_oMeanFinalSegmResFrame_LT},
+		{"meanFinalSegmRes_ST", &m_oMeanFinalSegmResFrame_ST},
+		{"unstableRegionMask", &m_oUnstableRegionMask},
+		{"blinks", &m_oBlinksFrame},
+		{"lastRawFGMask", &m_oLastRawFGMask},
+		{"lastRawFGBlinkMask", &m_oLastRawFGBlinkMask}
+	};
+	for(const auto& oFrame : aFrames)
+		if(!importModelMat(mModel,oFrame.first,*oFrame.second))
+			return false;
+	auto itScalars = mModel.find("scalars");
+	if(itScalars!=mModel.end() && itScalars->second.type()==CV_64FC1 && itScalars->second.total()==3) {
+		m_fLastNonZeroDescRatio = (float)itScalars->second.at<double>(0,0);
+		m_fCurrLearningRateLowerCap = (float)itScalars->second.at<double>(0,1);
+		m_fCurrLearningRateUpperCap = (float)itScalars->second.at<double>(0,2);
+	}
+	cv::dilate(m_oLastFGMask,m_oLastFGMask_dilated,m_defaultMorphologyKernel,cv::Point(-1,-1),3);
+	cv::bitwise_not(m_oLastFGMask_dilated,m_oLastFGMask_dilated_inverted);
+	return true;
+}
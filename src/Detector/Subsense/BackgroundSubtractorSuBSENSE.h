@@ -49,6 +49,10 @@ public:
 	void getBackgroundDescriptorsImage(cv::OutputArray backgroundDescImage) const;
     //! compute foreground mask
     virtual void apply(cv::InputArray image, cv::OutputArray fgmask, double learningRateOverride=0);
+	//! exports the copy of the learned model state
+	virtual void exportModel(ModelMats& mModel) const;
+	//! restores the model exported by exportModel
+	virtual bool importModel(const ModelMats& mModel);
 
 protected:
 	//! absolute minimal color distance threshold ('R' or 'radius' in the original ViBe paper, used as the default/initial 'R(x)' value here)
@@ -111,6 +115,11 @@ protected:
 	cv::Mat m_oLastFGMask_dilated_inverted;
 	cv::Mat m_oCurrRawFGBlinkMask;
 	cv::Mat m_oLastRawFGBlinkMask;
+	//! intra-frame LBSP descriptors of the current frame, computed by rows before the per-pixel analysis
+	cv::Mat m_oCurrIntraDescFrame;
+
+	//! computes m_oCurrIntraDescFrame with the current LBSP thresholds LUT
+	void computeIntraDescFrame(const cv::Mat& oInputImg);
     
     //! default kernel for morphology operations
     cv::Mat m_defaultMorphologyKernel;
@@ -273,16 +273,21 @@ static const uchar popcount_LUT8[256] = {
 	4, 5, 5, 6, 5, 6, 6, 7, 5, 6, 6, 7, 6, 7, 7, 8,
 };
 
-//! computes the population count of an N-byte vector using an 8-bit popcount LUT
+//! computes the population count of an N-byte vector using the popcnt instruction (or an 8-bit popcount LUT without the compiler builtin)
 template<typename T> static inline size_t popcount(T x) {
+#if defined(__GNUC__) || defined(__clang__)
+	static_assert(sizeof(T)<=sizeof(unsigned long long), "popcount: the vector is too long");
+	return (size_t)__builtin_popcountll((unsigned long long)x & (~0ull>>(64-8*sizeof(T))));
+#else
 	size_t nBytes = sizeof(T);
 	size_t nResult = 0;
 	for(size_t l=0; l<nBytes; ++l)
 		nResult += popcount_LUT8[(uchar)(x>>l*8)];
 	return nResult;
+#endif
 }
 
-//! computes the hamming distance between two N-byte vectors using an 8-bit popcount LUT
+//! computes the hamming distance between two N-byte vectors using popcount
 template<typename T> static inline size_t hdist(T a, T b) {
 	return popcount(a^b);
 }
@@ -292,22 +297,20 @@ template<typename T> static inline size_t gdist(T a, T b) {
 	return L1dist(popcount(a),popcount(b));
 }
 
-//! computes the population count of a (nChannels*N)-byte vector using an 8-bit popcount LUT
+//! computes the population count of a (nChannels*N)-byte vector using the popcnt instruction (or an 8-bit popcount LUT)
 template<size_t nChannels, typename T> static inline size_t popcount(const T* x) {
-	size_t nBytes = sizeof(T);
 	size_t nResult = 0;
 	for(size_t c=0; c<nChannels; ++c)
-		for(size_t l=0; l<nBytes; ++l)
-			nResult += popcount_LUT8[(uchar)(*(x+c)>>l*8)];
+		nResult += popcount(x[c]);
 	return nResult;
 }
 
-//! computes the hamming distance between two (nChannels*N)-byte vectors using an 8-bit popcount LUT
+//! computes the hamming distance between two (nChannels*N)-byte vectors using popcount
 template<size_t nChannels, typename T> static inline size_t hdist(const T* a, const T* b) {
-	T xor_array[nChannels];
+	size_t nResult = 0;
 	for(size_t c=0; c<nChannels; ++c)
-		xor_array[c] = a[c]^b[c];
-	return popcount<nChannels>(xor_array);
+		nResult += popcount((T)(a[c]^b[c]));
+	return nResult;
 }
 
 //! computes the gradient magnitude distance between two (nChannels*N)-byte vectors using an 8-bit popcount LUT
@@ -94,6 +94,50 @@ public:
 		#include "LBSP_16bits_dbcross_s3ch.i"
 	}
 
+	//! utility function, row version of the intra-frame LBSP computation: the descriptors of the pixels [_xBegin, _xEnd) of row _y use their own values as references
+	/*!
+		Branch-free version of the LBSP_16bits_dbcross_1ch.i / LBSP_16bits_dbcross_3ch3t.i patterns, the channels are processed as
+		one interleaved row so the loop is vectorized for both the grayscale and the RGB images.
+		_t - thresholds of all the row values (nChannels*(_xEnd-_xBegin)), _res - the row descriptors (nChannels*(_xEnd-_xBegin))
+	 */
+	template<int nChannels>
+	static void computeDescriptorsRow(const cv::Mat& oInputImg, const int _y, const int _xBegin, const int _xEnd, const uchar* const _t, ushort* const _res) {
+		CV_DbgAssert(!oInputImg.empty());
+		CV_DbgAssert(oInputImg.type()==CV_8UC(nChannels));
+		CV_DbgAssert(LBSP::DESC_SIZE==2); // @@@ also relies on a constant desc size
+		CV_DbgAssert(_xBegin>=(int)LBSP::PATCH_SIZE/2 && _y>=(int)LBSP::PATCH_SIZE/2);
+		CV_DbgAssert(_xEnd<=oInputImg.cols-(int)LBSP::PATCH_SIZE/2 && _y<oInputImg.rows-(int)LBSP::PATCH_SIZE/2);
+		constexpr int c1 = nChannels;
+		constexpr int c2 = 2*nChannels;
+		const uchar* const r_2 = oInputImg.ptr<uchar>(_y-2) + nChannels*_xBegin;
+		const uchar* const r_1 = oInputImg.ptr<uchar>(_y-1) + nChannels*_xBegin;
+		const uchar* const r0 = oInputImg.ptr<uchar>(_y) + nChannels*_xBegin;
+		const uchar* const r1 = oInputImg.ptr<uchar>(_y+1) + nChannels*_xBegin;
+		const uchar* const r2 = oInputImg.ptr<uchar>(_y+2) + nChannels*_xBegin;
+		const int nLength = nChannels*(_xEnd-_xBegin);
+#pragma omp simd
+		for(int i=0; i<nLength; ++i) {
+			const int _ref = r0[i];
+			const int _thr = _t[i];
+			_res[i] = (ushort)(((std::abs(r1[i-c1]-_ref) > _thr) << 15)
+			                 | ((std::abs(r_1[i+c1]-_ref) > _thr) << 14)
+			                 | ((std::abs(r1[i+c1]-_ref) > _thr) << 13)
+			                 | ((std::abs(r_1[i-c1]-_ref) > _thr) << 12)
+			                 | ((std::abs(r0[i+c1]-_ref) > _thr) << 11)
+			                 | ((std::abs(r_1[i]-_ref) > _thr) << 10)
+			                 | ((std::abs(r0[i-c1]-_ref) > _thr) << 9)
+			                 | ((std::abs(r1[i]-_ref) > _thr) << 8)
+			                 | ((std::abs(r_2[i-c2]-_ref) > _thr) << 7)
+			                 | ((std::abs(r2[i+c2]-_ref) > _thr) << 6)
+			                 | ((std::abs(r_2[i+c2]-_ref) > _thr) << 5)
+			                 | ((std::abs(r2[i-c2]-_ref) > _thr) << 4)
+			                 | ((std::abs(r2[i]-_ref) > _thr) << 3)
+			                 | ((std::abs(r_2[i]-_ref) > _thr) << 2)
+			                 | ((std::abs(r0[i+c2]-_ref) > _thr) << 1)
+			                 | ((std::abs(r0[i-c2]-_ref) > _thr)));
+		}
+	}
+
 	//! utility function, used to reshape a descriptors matrix to its input image size via their keypoint locations
 	static void reshapeDesc(cv::Size oSize, const std::vector<cv::KeyPoint>& voKeypoints, const cv::Mat& oDescriptors, cv::Mat& oOutput);
 	//! utility function, used to illustrate the difference between two descriptor images
@@ -1,5 +1,37 @@
 #pragma once
 
+#include <cstdint>
+#include <cstddef>
+
+//! xorshift generator with the rand()-like interface; rand() isn't thread-safe, so each parallel band of pixels owns its generator
+class BandRand {
+public:
+    BandRand(size_t nSeed1, size_t nSeed2) {
+        // splitmix64 of both seeds, the state must be non zero
+        uint64_t z = (uint64_t)nSeed1*0x9E3779B97F4A7C15ull + (uint64_t)nSeed2 + 0x632BE59BD9B4E019ull;
+        z = (z^(z>>30))*0xBF58476D1CE4E5B9ull;
+        z = (z^(z>>27))*0x94D049BB133111EBull;
+        z ^= z>>31;
+        m_nState = (uint32_t)(z^(z>>32));
+        if(!m_nState)
+            m_nState = 0x9E3779B9u;
+    }
+    //! returns a non negative value as rand() does
+    int operator()() {
+        m_nState ^= m_nState<<13;
+        m_nState ^= m_nState>>17;
+        m_nState ^= m_nState<<5;
+        return (int)(m_nState>>1);
+    }
+private:
+    uint32_t m_nState;
+};
+
+//! default random source of the sampling functions
+struct StdRand {
+    int operator()() const { return rand(); }
+};
+
 /*// gaussian 3x3 pattern, based on 'floor(fspecial('gaussian', 3, 1)*256)'
 static const int s_nSamplesInitPatternWidth = 3;
 static const int s_nSamplesInitPatternHeight = 3;
@@ -56,8 +88,9 @@ static const int s_anNeighborPattern_3x3[8][2] = {
 };
 
 //! returns a random neighbor position for the specified pixel position; also guards against out-of-bounds values via image/border size check.
-static inline void getRandNeighborPosition_3x3(int& x_neighbor, int& y_neighbor, const int x_orig, const int y_orig, const int border, const cv::Size& imgsize) {
-    int r = rand()%s_anNeighborPatternSize_3x3;
+template<typename TRand = StdRand>
+static inline void getRandNeighborPosition_3x3(int& x_neighbor, int& y_neighbor, const int x_orig, const int y_orig, const int border, const cv::Size& imgsize, TRand&& rnd = TRand()) {
+    int r = rnd()%s_anNeighborPatternSize_3x3;
     x_neighbor = x_orig+s_anNeighborPattern_3x3[r][0];
     y_neighbor = y_orig+s_anNeighborPattern_3x3[r][1];
     if(x_neighbor<border)
@@ -81,8 +114,9 @@ static const int s_anNeighborPattern_5x5[24][2] = {
 };
 
 //! returns a random neighbor position for the specified pixel position; also guards against out-of-bounds values via image/border size check.
-static inline void getRandNeighborPosition_5x5(int& x_neighbor, int& y_neighbor, const int x_orig, const int y_orig, const int border, const cv::Size& imgsize) {
-    int r = rand()%s_anNeighborPatternSize_5x5;
+template<typename TRand = StdRand>
+static inline void getRandNeighborPosition_5x5(int& x_neighbor, int& y_neighbor, const int x_orig, const int y_orig, const int border, const cv::Size& imgsize, TRand&& rnd = TRand()) {
+    int r = rnd()%s_anNeighborPatternSize_5x5;
     x_neighbor = x_orig+s_anNeighborPattern_5x5[r][0];
     y_neighbor = y_orig+s_anNeighborPattern_5x5[r][1];
     if(x_neighbor<border)
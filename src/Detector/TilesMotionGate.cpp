@@ -0,0 +1,196 @@
+#include <iostream>
+#include "TilesMotionGate.h"
+#include "execution_policy.h"
+#include "BackgroundSubtract.h"
+
+///
+/// \brief TilesMotionGate::TilesMotionGate
+///
+TilesMotionGate::TilesMotionGate() = default;
+
+///
+/// \brief TilesMotionGate::~TilesMotionGate
+///
+TilesMotionGate::~TilesMotionGate() = default;
+
+///
+/// \brief TilesMotionGate::Init
+/// \param config
+/// \return
+///
+bool TilesMotionGate::Init(const config_t& config)
+{
+    auto tilesMotionGate = config.find("tilesMotionGate");
+    m_motionGate = (tilesMotionGate != config.end()) && (std::stoi(tilesMotionGate->second) != 0);
+
+    auto tilesCache = config.find("tilesCache");
+    m_cache = (tilesCache != config.end()) && (std::stoi(tilesCache->second) != 0);
+
+    auto tilesRefreshPeriod = config.find("tilesRefreshPeriod");
+    if (tilesRefreshPeriod != config.end())
+        m_refreshPeriod = std::max(1, std::stoi(tilesRefreshPeriod->second));
+
+    auto tilesMotionScale = config.find("tilesMotionScale");
+    if (tilesMotionScale != config.end())
+        m_motionScale = std::min(1., std::max(0.05, std::stod(tilesMotionScale->second)));
+
+    auto tilesMotionThreshold = config.find("tilesMotionThreshold");
+    if (tilesMotionThreshold != config.end())
+        m_motionThreshold = std::max(0., std::stod(tilesMotionThreshold->second));
+
+    auto tilesCacheThreshold = config.find("tilesCacheThreshold");
+    if (tilesCacheThreshold != config.end())
+        m_cacheThreshold = std::max(0., std::stod(tilesCacheThreshold->second));
+
+    m_crops.clear();
+    m_backgroundSubst.reset();
+    if (m_motionGate)
+        m_backgroundSubst = std::make_unique<BackgroundSubtract>(BackgroundSubtract::BGFG_ALGS::ALG_VIBE, 1);
+    return true;
+}
+
+///
+/// \brief TilesMotionGate::Select
+/// \param frame
+/// \param crops
+/// \param needDetect
+///
+void TilesMotionGate::Select(const cv::Mat& frame, const std::vector<cv::Rect>& crops, std::vector<char>& needDetect)
+{
+    needDetect.assign(crops.size(), 1);
+    if (!Enabled())
+        return;
+
+    // New frame size: the all crops are detected
+    if (m_crops != crops)
+    {
+        m_crops = crops;
+        m_framesFromDetect.assign(crops.size(), m_refreshPeriod);
+        m_cropsRegions.assign(crops.size(), regions_t());
+        m_cropsPixels.assign(crops.size(), cv::Mat());
+    }
+
+    cv::resize(frame, m_smallFrame, cv::Size(), m_motionScale, m_motionScale, cv::INTER_AREA);
+    cv::Mat foreground;
+    if (m_motionGate)
+    {
+        // The background model is updated on the every frame
+        m_backgroundSubst->Subtract(m_smallFrame, m_foreground);
+        foreground = exec::MapToHost(m_foreground, "TilesMotionGate::Select");
+    }
+    cv::Mat smallFrame;
+    if (m_cache)
+        smallFrame = exec::MapToHost(m_smallFrame, "TilesMotionGate::Select");
+    const cv::Rect smallRect(0, 0, m_smallFrame.cols, m_smallFrame.rows);
+
+    std::vector<cv::Rect> trackedRects;
+    if (m_motionGate)
+    {
+        std::lock_guard<std::mutex> lock(m_trackedMutex);
+        trackedRects = m_trackedRects;
+    }
+
+    size_t detected = 0;
+    size_t cached = 0;
+    for (size_t i = 0; i < crops.size(); ++i)
+    {
+        const cv::Rect& crop = crops[i];
+        const cv::Rect smallCrop = cv::Rect(cvRound(m_motionScale * crop.x), cvRound(m_motionScale * crop.y),
+                                            cvRound(m_motionScale * crop.width), cvRound(m_motionScale * crop.height)) & smallRect;
+        const bool refresh = ++m_framesFromDetect[i] > m_refreshPeriod;
+
+        // Without the motion gate the all crops are the candidates of the cache
+        bool need = refresh || !m_motionGate;
+        for (size_t j = 0; j < trackedRects.size() && !need; ++j)
+        {
+            need = (crop & trackedRects[j]).area() > 0;
+        }
+        if (!need && smallCrop.area() > 0)
+            need = cv::countNonZero(foreground(smallCrop)) > m_motionThreshold * smallCrop.area();
+
+        // The crop with the same pixels as on its last detection keeps the regions
+        if (need && !refresh && m_cache && !Changed(i, smallFrame(smallCrop)))
+        {
+            need = false;
+            ++cached;
+        }
+
+        needDetect[i] = need ? 1 : 0;
+        if (need)
+        {
+            m_framesFromDetect[i] = 0;
+            if (m_cache)
+                smallFrame(smallCrop).copyTo(m_cropsPixels[i]);
+            ++detected;
+        }
+    }
+
+    m_detectedCrops += detected;
+    m_cachedCrops += cached;
+    if (++m_framesCount % 100 == 0)
+    {
+        std::cout << "TilesMotionGate: " << (static_cast<double>(m_detectedCrops) / (m_framesCount * crops.size())) << " of crops are detected";
+        if (m_cache)
+            std::cout << ", " << (static_cast<double>(m_cachedCrops) / (m_framesCount * crops.size())) << " are taken from the cache";
+        std::cout << std::endl;
+        m_framesCount = 0;
+        m_detectedCrops = 0;
+        m_cachedCrops = 0;
+    }
+}
+
+///
+/// \brief TilesMotionGate::Changed
+/// \param cropInd
+/// \param smallCrop - downscaled pixels of the crop on the current frame
+/// \return true if the crop wasn't detected or the mean absolute difference with its last detection is above the threshold
+///
+bool TilesMotionGate::Changed(size_t cropInd, const cv::Mat& smallCrop) const
+{
+    const cv::Mat& cropPixels = m_cropsPixels[cropInd];
+    if (cropPixels.empty() || cropPixels.size() != smallCrop.size() || cropPixels.type() != smallCrop.type())
+        return true;
+
+    cv::Mat diff;
+    cv::absdiff(smallCrop, cropPixels, diff);
+    const cv::Scalar meanDiff = cv::mean(diff);
+    double diffSum = 0;
+    for (int c = 0; c < smallCrop.channels(); ++c)
+    {
+        diffSum += meanDiff[c];
+    }
+    return diffSum > m_cacheThreshold * smallCrop.channels();
+}
+
+///
+/// \brief TilesMotionGate::SetRegions
+/// \param cropInd
+/// \param regions
+///
+void TilesMotionGate::SetRegions(size_t cropInd, regions_t&& regions)
+{
+    if (cropInd < m_cropsRegions.size())
+        m_cropsRegions[cropInd] = std::move(regions);
+}
+
+///
+/// \brief TilesMotionGate::Collect
+/// \param regions
+///
+void TilesMotionGate::Collect(regions_t& regions) const
+{
+    for (const auto& cropRegions : m_cropsRegions)
+    {
+        regions.insert(std::end(regions), std::begin(cropRegions), std::end(cropRegions));
+    }
+}
+
+///
+/// \brief TilesMotionGate::SetTrackedRects
+/// \param rects
+///
+void TilesMotionGate::SetTrackedRects(const std::vector<cv::Rect>& rects)
+{
+    std::lock_guard<std::mutex> lock(m_trackedMutex);
+    m_trackedRects = rects;
+}
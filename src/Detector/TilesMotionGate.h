@@ -0,0 +1,92 @@
+#pragma once
+
+#include <mutex>
+#include <memory>
+#include "defines.h"
+
+class BackgroundSubtract;
+
+///
+/// \brief The TilesMotionGate class
+/// Selection of the crops of GetCrops which need the inference on the current frame of the fixed camera:
+/// the crops with the motion on the low resolution foreground mask, with the tracked objects or not detected
+/// during refreshPeriod frames. The other crops keep the regions of their last detection.
+/// With the detection cache the crop is detected only if its downscaled pixels differ from the pixels of its last
+/// detection: the parked cars and the other static objects aren't re-detected. The cache works without the motion
+/// gate too, then it takes the all crops.
+/// The frames are of one camera in the order of the capture
+///
+class TilesMotionGate
+{
+public:
+    TilesMotionGate();
+    ~TilesMotionGate();
+
+    ///
+    /// \brief Init
+    /// \param config - "tilesMotionGate", "tilesRefreshPeriod", "tilesMotionScale", "tilesMotionThreshold",
+    /// "tilesCache", "tilesCacheThreshold"
+    /// \return
+    ///
+    bool Init(const config_t& config);
+
+    ///
+    bool Enabled() const
+    {
+        return m_motionGate || m_cache;
+    }
+
+    ///
+    /// \brief Select
+    /// \param frame - color or gray frame
+    /// \param crops - crops of the frame
+    /// \param needDetect - true for the crops which need the inference
+    ///
+    void Select(const cv::Mat& frame, const std::vector<cv::Rect>& crops, std::vector<char>& needDetect);
+
+    ///
+    /// \brief SetRegions
+    /// \param cropInd - detected crop
+    /// \param regions - in the coordinates of the frame, they replace the previous regions of the crop
+    ///
+    void SetRegions(size_t cropInd, regions_t&& regions);
+
+    ///
+    /// \brief Collect
+    /// \param regions - the regions of the all crops, new and kept
+    ///
+    void Collect(regions_t& regions) const;
+
+    ///
+    /// \brief SetTrackedRects
+    /// The crops with the tracked objects are detected on the every frame
+    /// \param rects
+    ///
+    void SetTrackedRects(const std::vector<cv::Rect>& rects);
+
+private:
+    bool m_motionGate = false;
+    bool m_cache = false;
+    int m_refreshPeriod = 10;
+    double m_motionScale = 0.25;       // Scale of the foreground mask and of the cached pixels
+    double m_motionThreshold = 0.002;
+    double m_cacheThreshold = 2.;      // Mean absolute difference of the cached pixels per channel
+
+    bool Changed(size_t cropInd, const cv::Mat& smallCrop) const;
+
+    std::unique_ptr<BackgroundSubtract> m_backgroundSubst;
+    cv::UMat m_smallFrame;
+    cv::UMat m_foreground;
+
+    std::vector<cv::Rect> m_crops;
+    std::vector<int> m_framesFromDetect;
+    std::vector<regions_t> m_cropsRegions;
+    std::vector<cv::Mat> m_cropsPixels; // Downscaled pixels of the crops on their last detection
+
+    std::mutex m_trackedMutex;
+    std::vector<cv::Rect> m_trackedRects;
+
+    size_t m_framesCount = 0;
+    size_t m_detectedCrops = 0;
+    size_t m_cachedCrops = 0;
+};
@@ -71,16 +71,15 @@ bool YoloDarknetDetector::Init(const config_t& config)
     if (maxCropRatio != config.end())
         m_maxCropRatio = std::stof(maxCropRatio->second);
 
-    m_classesWhiteList.clear();
-	auto whiteRange = config.equal_range("white_list");
-	for (auto it = whiteRange.first; it != whiteRange.second; ++it)
-	{
-		m_classesWhiteList.insert(std::stoi(it->second));
-	}
+	// Classes are decoded and suppressed inside darknet with the minimal threshold, the other thresholds are checked on its results
+	ReadClassesFilter(config);
+	UpdateNetClassesThresholds(m_confidenceThreshold);
 
 	bool correct = m_detector.get() != nullptr;
     
 	m_netSize = cv::Size(m_detector->get_net_width(), m_detector->get_net_height());
+	// The input of the whole batch is allocated once
+	m_tmpBuf.resize(m_batchSize * 3 * static_cast<size_t>(m_netSize.area()));
 	
 	return correct;
 }
@@ -91,60 +90,98 @@ bool YoloDarknetDetector::Init(const config_t& config)
 ///
 void YoloDarknetDetector::Detect(const cv::UMat& colorFrame)
 {
+    static metrics::Histogram& detectTime = DetectHistogram("yolo_darknet", false);
+    metrics::ScopedTimer timer(detectTime);
+
 	m_regions.clear();
-	cv::Mat colorMat = colorFrame.getMat(cv::ACCESS_READ);
+	cv::Mat colorMat = exec::MapToHost(colorFrame, "YoloDarknetDetector::Detect");
 
-	if (m_maxCropRatio <= 0)
+	// The net input is fixed, only the crops follow the sizes of the tracked objects
+	float cropRatio = m_maxCropRatio;
+	m_adaptiveInput.Select({ m_netSize }, colorMat.size(), cropRatio);
+	if (cropRatio <= 0)
 	{
-		Detect(colorMat, m_regions);
+		// The detection is only in the bounding rect of the detection mask
+		if (!m_detectionMask.Enabled())
+			Detect(colorMat, m_regions);
+		else if (!m_detectionMask.BoundingRect(colorMat.size()).empty())
+			DetectInCrop(colorMat, m_detectionMask.BoundingRect(colorMat.size()), m_regions);
 	}
 	else
 	{
-        std::vector<cv::Rect> crops = GetCrops(m_maxCropRatio, m_netSize, colorMat.size());
-        std::cout << "Image on " << crops.size() << " crops with size " << crops.front().size() << ", input size " << m_netSize << ", batch " << m_batchSize << ", frame " << colorMat.size() << std::endl;
-        regions_t tmpRegions;
+        std::vector<cv::Rect> crops = GetCrops(cropRatio, m_netSize, colorMat.size());
+        if (!crops.empty())
+            std::cout << "Image on " << crops.size() << " crops with size " << crops.front().size() << ", input size " << m_netSize << ", batch " << m_batchSize << ", frame " << colorMat.size() << std::endl;
+        // Only the crops with the motion or with the tracked objects
+        std::vector<char> needDetect;
+        m_tilesGate.Select(colorMat, crops, needDetect);
+        std::vector<size_t> cropsInds;
+        for (size_t i = 0; i < crops.size(); ++i)
+        {
+            if (needDetect[i])
+                cropsInds.push_back(i);
+        }
+        std::vector<regions_t> cropsRegions(crops.size());
+        // The small crops are detected on the canvases, the other crops are detected alone
+        std::vector<size_t> aloneInds;
+        if (m_cropsMosaic.Enabled() && cropsInds.size() > 1)
+            DetectMosaic(colorMat, crops, cropsInds, cropsRegions, aloneInds);
+        else
+            aloneInds = cropsInds;
 		if (m_batchSize > 1)
 		{
-			std::vector<cv::Mat> batch;
-			batch.reserve(m_batchSize);
-				
-			for (size_t i = 0; i < crops.size(); i += m_batchSize)
+			for (size_t i = 0; i < aloneInds.size(); i += m_batchSize)
 			{
-				size_t batchSize = std::min(static_cast<size_t>(m_batchSize), crops.size() - i);
-				batch.clear();
+				size_t batchSize = std::min(static_cast<size_t>(m_batchSize), aloneInds.size() - i);
 				for (size_t j = 0; j < batchSize; ++j)
 				{
-					batch.emplace_back(colorMat, crops[i + j]);
+					FillBatchImg(colorMat(crops[aloneInds[i + j]]), j);
 				}
 
 				image_t detImage;
-				FillBatchImg(batch, detImage);
-				std::vector<std::vector<bbox_t>> result_vec = m_detector->detectBatch(detImage, static_cast<int>(batchSize), m_netSize.width, m_netSize.height, m_confidenceThreshold);
+				MakeImg(detImage);
+				std::vector<std::vector<bbox_t>> result_vec;
+				{
+					StageTimer inferenceTime(m_stages.m_inference);
+					result_vec = m_detector->detectBatch(detImage, static_cast<int>(batchSize), m_netSize.width, m_netSize.height, NetMinThreshold());
+				}
 
-				const float wk = static_cast<float>(crops[i].width) / m_netSize.width;
-				const float hk = static_cast<float>(crops[i].height) / m_netSize.height;
+				const float wk = static_cast<float>(crops[aloneInds[i]].width) / m_netSize.width;
+				const float hk = static_cast<float>(crops[aloneInds[i]].height) / m_netSize.height;
 				for (size_t j = 0; j < batchSize; ++j)
 				{
+					const auto& crop = crops[aloneInds[i + j]];
 					for (const auto& bbox : result_vec[j])
 					{
-						if (m_classesWhiteList.empty() || m_classesWhiteList.find(T2T(bbox.obj_id)) != std::end(m_classesWhiteList))
-							tmpRegions.emplace_back(cv::Rect(crops[i + j].x + cvRound(wk * bbox.x), crops[i + j].y + cvRound(hk * bbox.y),
-								                             cvRound(wk * bbox.w), cvRound(hk * bbox.h)),
-								                    T2T(bbox.obj_id), bbox.prob);
+						if (bbox.prob > NetClassThreshold(bbox.obj_id))
+							cropsRegions[aloneInds[i + j]].emplace_back(cv::Rect(crop.x + cvRound(wk * bbox.x), crop.y + cvRound(hk * bbox.y),
+								                                                 cvRound(wk * bbox.w), cvRound(hk * bbox.h)),
+								                                        T2T(bbox.obj_id), bbox.prob);
 					}
 				}
 			}
 		}
 		else
 		{
-			for (size_t i = 0; i < crops.size(); ++i)
+			for (size_t ind : aloneInds)
 			{
-				const auto& crop = crops[i];
-				//std::cout << "Crop " << i << ": " << crop << std::endl;
-				DetectInCrop(colorMat, crop, tmpRegions);
+				//std::cout << "Crop " << ind << ": " << crops[ind] << std::endl;
+				DetectInCrop(colorMat, crops[ind], cropsRegions[ind]);
 			}
 		}
 
+        // The skipped crops keep the regions of their last detection
+        regions_t tmpRegions;
+        for (size_t ind : cropsInds)
+        {
+            if (m_tilesGate.Enabled())
+                m_tilesGate.SetRegions(ind, std::move(cropsRegions[ind]));
+            else
+                tmpRegions.insert(std::end(tmpRegions), std::begin(cropsRegions[ind]), std::end(cropsRegions[ind]));
+        }
+        if (m_tilesGate.Enabled())
+            m_tilesGate.Collect(tmpRegions);
+
 		if (crops.size() > 1 || m_batchSize > 1)
 		{
 			nms3<CRegion>(tmpRegions, m_regions, 0.4f,
@@ -154,7 +191,12 @@ void YoloDarknetDetector::Detect(const cv::UMat& colorFrame)
 				0, 0.f);
 			//std::cout << "nms for " << tmpRegions.size() << " objects - result " << m_regions.size() << std::endl;
 		}
+		else
+		{
+			m_regions.assign(std::begin(tmpRegions), std::end(tmpRegions));
+		}
 	}
+	m_detectionMask.Filter(m_regions, colorMat.size());
 	//std::cout << "Finally " << m_regions.size() << " objects, " << colorMat.u->refcount << ", " << colorMat.u->urefcount << std::endl;
 }
 
@@ -166,29 +208,76 @@ void YoloDarknetDetector::Detect(const cv::UMat& colorFrame)
 ///
 void YoloDarknetDetector::DetectInCrop(const cv::Mat& colorFrame, const cv::Rect& crop, regions_t& tmpRegions)
 {
-	if (crop.width == m_netSize.width && crop.height == m_netSize.height)
-		m_tmpImg = colorFrame(crop);
-	else
-		cv::resize(colorFrame(crop), m_tmpImg, m_netSize, 0, 0, cv::INTER_LINEAR);
-	
+	FillBatchImg(colorFrame(crop), 0);
 	image_t detImage;
-	FillImg(detImage);
+	MakeImg(detImage);
 
-	std::vector<bbox_t> detects = m_detector->detect(detImage, m_confidenceThreshold, false);
+	std::vector<bbox_t> detects;
+	{
+		StageTimer inferenceTime(m_stages.m_inference);
+		detects = m_detector->detect(detImage, NetMinThreshold(), false);
+	}
 
 	float wk = (float)crop.width / detImage.w;
 	float hk = (float)crop.height / detImage.h;
 
 	for (const bbox_t& bbox : detects)
 	{
-		if (m_classesWhiteList.empty() || m_classesWhiteList.find(T2T(bbox.obj_id)) != std::end(m_classesWhiteList))
+		if (bbox.prob > NetClassThreshold(bbox.obj_id))
 			tmpRegions.emplace_back(cv::Rect(cvRound(wk * bbox.x) + crop.x, cvRound(hk * bbox.y) + crop.y, cvRound(wk * bbox.w), cvRound(hk * bbox.h)), T2T(bbox.obj_id), bbox.prob);
 	}
-	if (crop.width == m_netSize.width && crop.height == m_netSize.height)
-		m_tmpImg.release();
 	//std::cout << "Detected " << detects.size() << " objects" << std::endl;
 }
 
+///
+/// \brief YoloDarknetDetector::DetectMosaic
+/// The canvases have the network size and aren't resized
+/// \param colorFrame
+/// \param crops
+/// \param cropsInds - crops for the detection
+/// \param cropsRegions
+/// \param aloneInds - crops out of the canvases
+///
+void YoloDarknetDetector::DetectMosaic(const cv::Mat& colorFrame, const std::vector<cv::Rect>& crops, const std::vector<size_t>& cropsInds,
+	                                   std::vector<regions_t>& cropsRegions, std::vector<size_t>& aloneInds)
+{
+	std::vector<cv::Size> sizes;
+	std::vector<cv::Rect> packedRects;
+	std::vector<cv::Mat> packedPixels;
+	for (size_t ind : cropsInds)
+	{
+		sizes.emplace_back(crops[ind].size());
+		packedRects.emplace_back(crops[ind]);
+		packedPixels.emplace_back(colorFrame, crops[ind]);
+	}
+	std::vector<CropsMosaic::Canvas> canvases;
+	std::vector<size_t> single;
+	m_cropsMosaic.Pack(sizes, m_netSize, canvases, single);
+
+	std::vector<regions_t> packedRegions(cropsInds.size());
+	cv::Mat canvasImg;
+	for (const auto& canvas : canvases)
+	{
+		{
+			StageTimer preprocessTime(m_stages.m_preprocess);
+			m_cropsMosaic.Render(packedPixels, canvas, m_netSize, canvasImg);
+		}
+		regions_t canvasRegions;
+		Detect(canvasImg, canvasRegions);
+		m_cropsMosaic.ToCrops(canvasRegions, canvas, packedRects, packedRegions);
+	}
+	for (size_t i = 0; i < cropsInds.size(); ++i)
+	{
+		cropsRegions[cropsInds[i]] = std::move(packedRegions[i]);
+	}
+
+	aloneInds.clear();
+	for (size_t ind : single)
+	{
+		aloneInds.push_back(cropsInds[ind]);
+	}
+}
+
 ///
 /// \brief YoloDarknetDetector::Detect
 /// \param colorFrame
@@ -197,105 +286,71 @@ void YoloDarknetDetector::DetectInCrop(const cv::Mat& colorFrame, const cv::Rect
 ///
 void YoloDarknetDetector::Detect(const cv::Mat& colorFrame, regions_t& tmpRegions)
 {
-	if (colorFrame.cols == m_netSize.width && colorFrame.rows == m_netSize.height)
-		m_tmpImg = colorFrame;
-	else
-		cv::resize(colorFrame, m_tmpImg, m_netSize, 0, 0, cv::INTER_LINEAR);
-
+	FillBatchImg(colorFrame, 0);
 	image_t detImage;
-	FillImg(detImage);
+	MakeImg(detImage);
 
-	std::vector<bbox_t> detects = m_detector->detect(detImage, m_confidenceThreshold, false);
+	std::vector<bbox_t> detects;
+	{
+		StageTimer inferenceTime(m_stages.m_inference);
+		detects = m_detector->detect(detImage, NetMinThreshold(), false);
+	}
 
 	float wk = (float)colorFrame.cols / detImage.w;
 	float hk = (float)colorFrame.rows / detImage.h;
 
 	for (const bbox_t& bbox : detects)
 	{
-		if (m_classesWhiteList.empty() || m_classesWhiteList.find(T2T(bbox.obj_id)) != std::end(m_classesWhiteList))
+		if (bbox.prob > NetClassThreshold(bbox.obj_id))
 			tmpRegions.emplace_back(cv::Rect(cvRound(wk * bbox.x), cvRound(hk * bbox.y), cvRound(wk * bbox.w), cvRound(hk * bbox.h)), T2T(bbox.obj_id), bbox.prob);
 	}
 	//std::cout << "Detected " << detects.size() << " objects" << std::endl;
 }
 
 ///
-/// \brief YoloDarknetDetector::FillImg
-/// \param detImage
+/// \brief YoloDarknetDetector::FillBatchImg
+/// The image is resized only if its size differs from the network input, the channels are split in the reverse order
+/// and converted by OpenCV straight into the planes of the batch element: m_tmpBuf is wrapped without the copy
+/// \param img - BGR
+/// \param ind - index in the batch
 ///
-void YoloDarknetDetector::FillImg(image_t& detImage)
+void YoloDarknetDetector::FillBatchImg(const cv::Mat& img, size_t ind)
 {
-	detImage.w = m_tmpImg.cols;
-	detImage.h = m_tmpImg.rows;
-	detImage.c = m_tmpImg.channels();
-	assert(detImage.c == 3);
-	size_t newSize = static_cast<size_t>(detImage.w * detImage.h * detImage.c);
-	if (newSize != m_tmpBuf.size())
-		m_tmpBuf.resize(newSize);
-	detImage.data = &m_tmpBuf[0];
-
-	const int h = detImage.h;
-	const int w = detImage.w;
-	constexpr float knorm = 1.f / 255.f;
-	for (int y = 0; y < h; ++y)
+	StageTimer preprocessTime(m_stages.m_preprocess);
+
+	assert(img.channels() == 3);
+	const size_t planeSize = static_cast<size_t>(m_netSize.area());
+	const size_t imgSize = 3 * planeSize;
+	if (m_tmpBuf.size() < (ind + 1) * imgSize)
+		m_tmpBuf.resize((ind + 1) * imgSize);
+
+	const cv::Mat* src = &img;
+	if (img.size() != m_netSize)
 	{
-		for (int c = 0; c < 3; ++c)
-		{
-			const unsigned char *data = m_tmpImg.ptr(y) + 2 - c;
-			float* fdata = detImage.data + static_cast<ptrdiff_t>(c * w * h) + static_cast<ptrdiff_t>(y * w);
-			for (int x = 0; x < w; ++x)
-			{
-				*fdata = knorm * data[0];
-				++fdata;
-				data += 3;
-			}
-		}
+		cv::resize(img, m_tmpImg, m_netSize, 0, 0, cv::INTER_LINEAR);
+		src = &m_tmpImg;
+	}
+	cv::split(*src, m_tmpPlanes);
+
+	constexpr double knorm = 1. / 255.;
+	float* data = m_tmpBuf.data() + ind * imgSize;
+	for (int c = 0; c < 3; ++c)
+	{
+		cv::Mat plane(m_netSize, CV_32FC1, data + (2 - c) * planeSize);
+		m_tmpPlanes[c].convertTo(plane, CV_32F, knorm);
 	}
 }
 
 ///
-/// \brief YoloDarknetDetector::FillBatchImg
-/// \param batch
-/// \param detImage
+/// \brief YoloDarknetDetector::MakeImg
+/// \param detImage - the batch of m_tmpBuf
 ///
-void YoloDarknetDetector::FillBatchImg(const std::vector<cv::Mat>& batch, image_t& detImage)
+void YoloDarknetDetector::MakeImg(image_t& detImage)
 {
 	detImage.w = m_netSize.width;
 	detImage.h = m_netSize.height;
 	detImage.c = 3;
-	assert(detImage.c == 3);
-	size_t imgSize = static_cast<size_t>(detImage.w * detImage.h * detImage.c);
-	size_t newSize = batch.size() * imgSize;
-	if (newSize > m_tmpBuf.size())
-		m_tmpBuf.resize(newSize);
-	detImage.data = &m_tmpBuf[0];
-
-	for (size_t i = 0; i < batch.size(); ++i)
-	{
-		if (batch[i].cols == m_netSize.width && batch[i].rows == m_netSize.height)
-			m_tmpImg = batch[i];
-		else
-			cv::resize(batch[i], m_tmpImg, m_netSize, 0, 0, cv::INTER_LINEAR);
-
-		float* fImgStart = detImage.data + i * imgSize;
-
-		const int h = m_tmpImg.rows;
-		const int w = m_tmpImg.cols;
-		constexpr float knorm = 1.f / 255.f;
-		for (int y = 0; y < h; ++y)
-		{
-			for (int c = 0; c < 3; ++c)
-			{
-				const unsigned char* data = m_tmpImg.ptr(y) + 2 - c;
-				float* fdata = fImgStart + static_cast<ptrdiff_t>(c * w * h) + static_cast<ptrdiff_t>(y * w);
-				for (int x = 0; x < w; ++x)
-				{
-					*fdata = knorm * data[0];
-					++fdata;
-					data += 3;
-				}
-			}
-		}
-	}
+	detImage.data = m_tmpBuf.data();
 }
 
 ///
@@ -305,35 +360,52 @@ void YoloDarknetDetector::FillBatchImg(const std::vector<cv::Mat>& batch, image_
 ///
 void YoloDarknetDetector::Detect(const std::vector<cv::UMat>& frames, std::vector<regions_t>& regions)
 {
+    static metrics::Histogram& detectTime = DetectHistogram("yolo_darknet", true);
+    metrics::ScopedTimer timer(detectTime);
+
 	if (frames.size() == 1)
 	{
 		Detect(frames[0]);
-		regions[0] = m_regions;
+		TakeDetects(regions[0]);
 
 	}
 	else
 	{
-		std::vector<cv::Mat> batch;
-		for (const auto& frame : frames)
+		// The frames of one camera have the same bounding rect of the detection mask
+		const cv::Rect area = m_detectionMask.BoundingRect(frames[0].size());
+		if (area.empty())
+		{
+			for (auto& frameRegions : regions)
+			{
+				frameRegions.clear();
+			}
+			m_regions.clear();
+			return;
+		}
+		for (size_t i = 0; i < frames.size(); ++i)
 		{
-			batch.emplace_back(frame.getMat(cv::ACCESS_READ));
+			FillBatchImg(exec::MapToHost(frames[i], "YoloDarknetDetector::Detect(batch)")(area), i);
 		}
 
 		image_t detImage;
-		FillBatchImg(batch, detImage);
-		std::vector<std::vector<bbox_t>> result_vec = m_detector->detectBatch(detImage, static_cast<int>(frames.size()), m_netSize.width, m_netSize.height, m_confidenceThreshold);
+		MakeImg(detImage);
+		std::vector<std::vector<bbox_t>> result_vec;
+		{
+			StageTimer inferenceTime(m_stages.m_inference);
+			result_vec = m_detector->detectBatch(detImage, static_cast<int>(frames.size()), m_netSize.width, m_netSize.height, NetMinThreshold());
+		}
 
 		regions_t tmpRegions;
 		tmpRegions.reserve(result_vec[0].size() + 16);
-		float wk = static_cast<float>(frames[0].cols) / m_netSize.width;
-		float hk = static_cast<float>(frames[0].rows) / m_netSize.height;
+		float wk = static_cast<float>(area.width) / m_netSize.width;
+		float hk = static_cast<float>(area.height) / m_netSize.height;
 		for (size_t i = 0; i < regions.size(); ++i)
 		{
 			tmpRegions.clear();
 			for (const auto& bbox : result_vec[i])
 			{
-				if (m_classesWhiteList.empty() || m_classesWhiteList.find(T2T(bbox.obj_id)) != std::end(m_classesWhiteList))
-					tmpRegions.emplace_back(cv::Rect(cvRound(wk * bbox.x), cvRound(hk * bbox.y), cvRound(wk * bbox.w), cvRound(hk * bbox.h)), T2T(bbox.obj_id), bbox.prob);
+				if (bbox.prob > NetClassThreshold(bbox.obj_id))
+					tmpRegions.emplace_back(cv::Rect(area.x + cvRound(wk * bbox.x), area.y + cvRound(hk * bbox.y), cvRound(wk * bbox.w), cvRound(hk * bbox.h)), T2T(bbox.obj_id), bbox.prob);
 			}
 
 			nms3<CRegion>(tmpRegions, regions[i], 0.4f,
@@ -341,8 +413,9 @@ void YoloDarknetDetector::Detect(const std::vector<cv::UMat>& frames, std::vecto
 				[](const CRegion& reg) { return reg.m_confidence; },
 				[](const CRegion& reg) { return reg.m_type; },
 				0, 0.f);
+			m_detectionMask.Filter(regions[i], frames[i].size());
 		}
 
-		m_regions.assign(std::begin(regions.back()), std::end(regions.back()));
+		KeepLastDetects(regions);
 	}
 }
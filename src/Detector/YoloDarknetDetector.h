@@ -16,7 +16,7 @@ class YoloDarknetDetector final : public BaseDetector
 {
 public:
     YoloDarknetDetector(const cv::UMat& colorFrame);
-	~YoloDarknetDetector(void) = default;
+	~YoloDarknetDetector(void) { StopAsync(); }
 
 	bool Init(const config_t& config);
 
@@ -39,9 +39,12 @@ private:
 
 	void DetectInCrop(const cv::Mat& colorFrame, const cv::Rect& crop, regions_t& tmpRegions);
 	void Detect(const cv::Mat& colorFrame, regions_t& tmpRegions);
-	void FillImg(image_t& detImage);
-	void FillBatchImg(const std::vector<cv::Mat>& batch, image_t& detImage);
-
-	cv::Mat m_tmpImg;
-	std::vector<float> m_tmpBuf;
+	void DetectMosaic(const cv::Mat& colorFrame, const std::vector<cv::Rect>& crops, const std::vector<size_t>& cropsInds,
+		              std::vector<regions_t>& cropsRegions, std::vector<size_t>& aloneInds);
+	void FillBatchImg(const cv::Mat& img, size_t ind);
+	void MakeImg(image_t& detImage);
+
+	cv::Mat m_tmpImg;                  // Resized image
+	cv::Mat m_tmpPlanes[3];            // Channels of the resized image
+	std::vector<float> m_tmpBuf;       // Planar RGB input of the batch, it's allocated for m_batchSize in Init
 };
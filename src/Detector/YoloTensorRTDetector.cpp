@@ -1,4 +1,6 @@
 #include <fstream>
+#include <sstream>
+#include <algorithm>
 #include "YoloTensorRTDetector.h"
 #include "nms.h"
 
@@ -16,21 +18,32 @@ YoloTensorRTDetector::YoloTensorRTDetector(const cv::UMat& colorFrame)
                      "motorbike", "person", "pottedplant",
                      "sheep", "sofa", "train", "tvmonitor" };
 
-	m_localConfig.calibration_image_list_file_txt = "";
-	m_localConfig.inference_precison = tensor_rt::FP32;
-	m_localConfig.net_type = tensor_rt::YOLOV4;
-	m_localConfig.detect_thresh = 0.5f;
-	m_localConfig.gpu_id = 0;
+	m_localConfig = DefaultConfig();
 }
 
 ///
-/// \brief YoloDarknetDetector::Init
+/// \brief YoloTensorRTDetector::DefaultConfig
 /// \return
 ///
-bool YoloTensorRTDetector::Init(const config_t& config)
+tensor_rt::Config YoloTensorRTDetector::DefaultConfig()
 {
-	m_detector.reset();
+	tensor_rt::Config localConfig;
+	localConfig.calibration_image_list_file_txt = "";
+	localConfig.inference_precison = tensor_rt::FP32;
+	localConfig.net_type = tensor_rt::YOLOV4;
+	localConfig.detect_thresh = 0.5f;
+	localConfig.gpu_id = 0;
+	return localConfig;
+}
 
+///
+/// \brief YoloTensorRTDetector::ReadConfig
+/// \param config
+/// \param localConfig - settings of the engine
+/// \return
+///
+bool YoloTensorRTDetector::ReadConfig(const config_t& config, tensor_rt::Config& localConfig)
+{
 	auto modelConfiguration = config.find("modelConfiguration");
 	auto modelBinary = config.find("modelBinary");
 	if (modelConfiguration == config.end() || modelBinary == config.end())
@@ -38,19 +51,22 @@ bool YoloTensorRTDetector::Init(const config_t& config)
 
 	auto confidenceThreshold = config.find("confidenceThreshold");
 	if (confidenceThreshold != config.end())
-		m_localConfig.detect_thresh = std::stof(confidenceThreshold->second);
+		localConfig.detect_thresh = std::stof(confidenceThreshold->second);
 
 	auto gpuId = config.find("gpuId");
 	if (gpuId != config.end())
-		m_localConfig.gpu_id = std::max(0, std::stoi(gpuId->second));
+		localConfig.gpu_id = std::max(0, std::stoi(gpuId->second));
+
+	auto dlaCore = config.find("dlaCore");
+	if (dlaCore != config.end())
+		localConfig.dla_core = std::stoi(dlaCore->second);
 
 	auto maxBatch = config.find("maxBatch");
 	if (maxBatch != config.end())
-        m_batchSize = std::max(1, std::stoi(maxBatch->second));
-	m_localConfig.batch_size = static_cast<uint32_t>(m_batchSize);
+		localConfig.batch_size = static_cast<uint32_t>(std::max(1, std::stoi(maxBatch->second)));
 	
-	m_localConfig.file_model_cfg = modelConfiguration->second;
-	m_localConfig.file_model_weights = modelBinary->second;
+	localConfig.file_model_cfg = modelConfiguration->second;
+	localConfig.file_model_weights = modelBinary->second;
 
 	auto inference_precison = config.find("inference_precison");
 	if (inference_precison != config.end())
@@ -61,7 +77,7 @@ bool YoloTensorRTDetector::Init(const config_t& config)
 		dictPrecison["FP32"] = tensor_rt::FP32;
 		auto precison = dictPrecison.find(inference_precison->second);
 		if (precison != dictPrecison.end())
-			m_localConfig.inference_precison = precison->second;
+			localConfig.inference_precison = precison->second;
 	}
 
 	auto net_type = config.find("net_type");
@@ -78,9 +94,61 @@ bool YoloTensorRTDetector::Init(const config_t& config)
 
 		auto netType = dictNetType.find(net_type->second);
 		if (netType != dictNetType.end())
-			m_localConfig.net_type = netType->second;
+			localConfig.net_type = netType->second;
 	}
 
+	auto gpuPreprocessing = config.find("gpuPreprocessing");
+	if (gpuPreprocessing != config.end())
+		localConfig.gpu_preprocessing = std::stoi(gpuPreprocessing->second) != 0;
+
+	auto pipelineDepth = config.find("pipelineDepth");
+	if (pipelineDepth != config.end())
+		localConfig.pipeline_depth = static_cast<uint32_t>(std::max(1, std::stoi(pipelineDepth->second)));
+
+	auto gpuPostprocessing = config.find("gpuPostprocessing");
+	if (gpuPostprocessing != config.end())
+		localConfig.gpu_postprocessing = std::stoi(gpuPostprocessing->second) != 0;
+
+	auto cudaGraphs = config.find("cudaGraphs");
+	if (cudaGraphs != config.end())
+		localConfig.cuda_graphs = std::stoi(cudaGraphs->second) != 0;
+
+	auto calibrationImages = config.find("calibrationImages");
+	if (calibrationImages != config.end())
+		localConfig.calibration_image_list_file_txt = calibrationImages->second;
+
+	auto int8Calibration = config.find("int8Calibration");
+	if (int8Calibration != config.end())
+		localConfig.int8_calibration = std::stoi(int8Calibration->second) != 0;
+	return true;
+}
+
+///
+/// \brief YoloTensorRTDetector::Prefetch
+/// Hashing of the model and loading of the cached engine start in the background, for example while the capture is opened
+/// \param config - the same as for Init
+///
+void YoloTensorRTDetector::Prefetch(const config_t& config)
+{
+	tensor_rt::Config localConfig = DefaultConfig();
+	if (ReadConfig(config, localConfig))
+		tensor_rt::Detector::prefetch(localConfig);
+}
+
+///
+/// \brief YoloDarknetDetector::Init
+/// \return
+///
+bool YoloTensorRTDetector::Init(const config_t& config)
+{
+	m_detector.reset();
+	m_smallEngines.clear();
+	m_enginesSizes.clear();
+
+	if (!ReadConfig(config, m_localConfig))
+		return false;
+	m_batchSize = m_localConfig.batch_size;
+
 	auto classNames = config.find("classNames");
 	if (classNames != config.end())
 	{
@@ -101,12 +169,12 @@ bool YoloTensorRTDetector::Init(const config_t& config)
 		}
 	}
 
-	m_classesWhiteList.clear();
-	auto whiteRange = config.equal_range("white_list");
-	for (auto it = whiteRange.first; it != whiteRange.second; ++it)
-	{
-		m_classesWhiteList.insert(std::stoi(it->second));
-	}
+	// White list and thresholds of the classes are applied by the decoding on GPU or CPU before NMS
+	ReadClassesFilter(config);
+	UpdateNetClassesThresholds(m_localConfig.detect_thresh);
+	m_localConfig.class_thresh = NetClassesThresholds();
+	m_localConfig.detect_thresh = NetMinThreshold();
+	m_localConfig.top_k = static_cast<uint32_t>(m_topK);
 
 	auto maxCropRatio = config.find("maxCropRatio");
 	if (maxCropRatio != config.end())
@@ -115,7 +183,53 @@ bool YoloTensorRTDetector::Init(const config_t& config)
 	m_detector = std::make_unique<tensor_rt::Detector>();
 	if (m_detector)
         m_detector->init(m_localConfig);
-	return m_detector.get() != nullptr;
+	if (!m_detector)
+		return false;
+
+	// The cfg files of the same weights with the other width and height, the engines are sorted by the input
+	auto adaptiveConfigs = config.find("adaptiveConfigs");
+	if (adaptiveConfigs != config.end())
+	{
+		std::istringstream cfgs(adaptiveConfigs->second);
+		std::string cfg;
+		while (std::getline(cfgs, cfg, ','))
+		{
+			if (cfg.empty())
+				continue;
+			tensor_rt::Config engineConfig = m_localConfig;
+			engineConfig.file_model_cfg = cfg;
+			m_smallEngines.emplace_back(std::make_unique<tensor_rt::Detector>());
+			m_smallEngines.back()->init(engineConfig);
+		}
+		const cv::Size mainSize = m_detector->get_input_size();
+		m_smallEngines.erase(std::remove_if(m_smallEngines.begin(), m_smallEngines.end(), [mainSize](const std::unique_ptr<tensor_rt::Detector>& engine)
+		{
+			return engine->get_input_size().area() >= mainSize.area();
+		}), m_smallEngines.end());
+		std::sort(m_smallEngines.begin(), m_smallEngines.end(), [](const std::unique_ptr<tensor_rt::Detector>& e1, const std::unique_ptr<tensor_rt::Detector>& e2)
+		{
+			return e1->get_input_size().area() < e2->get_input_size().area();
+		});
+	}
+	for (const auto& engine : m_smallEngines)
+	{
+		m_enginesSizes.emplace_back(engine->get_input_size());
+	}
+	m_enginesSizes.emplace_back(m_detector->get_input_size());
+	return true;
+}
+
+///
+/// \brief YoloTensorRTDetector::SelectEngine
+/// \param frameSize
+/// \param cropRatio - gets the crop ratio of the engine, <= 0 - the whole frame
+/// \return The engine for the sizes of the tracked objects or m_detector
+///
+tensor_rt::Detector* YoloTensorRTDetector::SelectEngine(cv::Size frameSize, float& cropRatio)
+{
+	cropRatio = m_maxCropRatio;
+	const size_t engineInd = m_adaptiveInput.Select(m_enginesSizes, frameSize, cropRatio);
+	return (engineInd < m_smallEngines.size()) ? m_smallEngines[engineInd].get() : m_detector.get();
 }
 
 ///
@@ -124,97 +238,326 @@ bool YoloTensorRTDetector::Init(const config_t& config)
 ///
 void YoloTensorRTDetector::Detect(const cv::UMat& colorFrame)
 {
+    static metrics::Histogram& detectTime = DetectHistogram("yolo_tensorrt", false);
+    metrics::ScopedTimer timer(detectTime);
+
     m_regions.clear();
-	cv::Mat colorMat = colorFrame.getMat(cv::ACCESS_READ);
+	std::vector<cv::Mat> frames = { exec::MapToHost(colorFrame, "YoloTensorRTDetector::Detect") };
+	std::vector<regions_t> regions(1);
+	DetectFrames(frames, regions);
+	m_regions.swap(regions.front());
+}
 
-    if (m_maxCropRatio <= 0)
+///
+/// \brief YoloTensorRTDetector::Detect
+/// \param frames
+/// \param regions
+///
+void YoloTensorRTDetector::Detect(const std::vector<cv::UMat>& frames, std::vector<regions_t>& regions)
+{
+    static metrics::Histogram& detectTime = DetectHistogram("yolo_tensorrt", true);
+    metrics::ScopedTimer timer(detectTime);
+
+    std::vector<cv::Mat> mats;
+    mats.reserve(frames.size());
+    for (const auto& frame : frames)
     {
-        std::vector<cv::Mat> batch = { colorMat };
-        std::vector<tensor_rt::BatchResult> detects;
-        m_detector->detect(batch, detects);
-        for (const tensor_rt::BatchResult& dets : detects)
+        mats.emplace_back(exec::MapToHost(frame, "YoloTensorRTDetector::Detect(batch)"));
+    }
+    regions.resize(frames.size());
+    DetectFrames(mats, regions);
+    KeepLastDetects(regions);
+}
+
+///
+/// \brief YoloTensorRTDetector::DetectFrames
+/// The whole frames or the crops of all frames are packed into the batches up to m_batchSize,
+/// the engine runs at the real size of the every batch and the last batch isn't padded.
+/// With cropsMosaic the small crops of the all frames are packed into the canvases of the input size first
+/// \param frames
+/// \param regions
+///
+void YoloTensorRTDetector::DetectFrames(const std::vector<cv::Mat>& frames, std::vector<regions_t>& regions)
+{
+    struct Tile
+    {
+        size_t m_frameInd = 0;
+        size_t m_cropInd = 0;
+        cv::Rect m_rect;
+        Tile(size_t frameInd, size_t cropInd, const cv::Rect& rect) : m_frameInd(frameInd), m_cropInd(cropInd), m_rect(rect) {}
+    };
+    // The letterbox of the engine input is the part of the inference
+    StageTimer preprocessTime(m_stages.m_preprocess);
+    float cropRatio = m_maxCropRatio;
+    tensor_rt::Detector* engine = SelectEngine(frames.empty() ? cv::Size() : frames.front().size(), cropRatio);
+    std::vector<Tile> tiles;
+    std::vector<size_t> tilesCount(frames.size(), 0);
+    std::vector<size_t> firstTile(frames.size() + 1, 0);
+    std::vector<char> needDetect;
+    const bool gated = (cropRatio > 0) && m_tilesGate.Enabled();
+    for (size_t i = 0; i < frames.size(); ++i)
+    {
+        firstTile[i] = tiles.size();
+        if (cropRatio <= 0)
         {
-            for (const tensor_rt::Result& bbox : dets)
+            // The detection is only in the bounding rect of the detection mask
+            const cv::Rect area = m_detectionMask.BoundingRect(frames[i].size());
+            if (!area.empty())
+                tiles.emplace_back(i, 0, area);
+            tilesCount[i] = 1;
+        }
+        else
+        {
+            std::vector<cv::Rect> crops = GetCrops(cropRatio, engine->get_input_size(), frames[i].size());
+            if (!crops.empty())
+                std::cout << "Image on " << crops.size() << " crops with size " << crops.front().size() << ", input size " << engine->get_input_size() << ", batch " << m_batchSize << ", frame " << frames[i].size() << std::endl;
+            // Only the crops with the motion or with the tracked objects
+            m_tilesGate.Select(frames[i], crops, needDetect);
+            for (size_t j = 0; j < crops.size(); ++j)
             {
-				if (m_classesWhiteList.empty() || m_classesWhiteList.find(T2T(bbox.id)) != std::end(m_classesWhiteList))
-					m_regions.emplace_back(bbox.rect, T2T(bbox.id), bbox.prob);
+                if (needDetect[j])
+                    tiles.emplace_back(i, j, crops[j]);
             }
+            tilesCount[i] = crops.size();
+        }
+    }
+    firstTile[frames.size()] = tiles.size();
+
+    // The network inputs: the tiles or the canvases with the small tiles of the all frames
+    std::vector<cv::Mat> inputs;
+    std::vector<int> inputsTiles; // Index of the tile or -(canvas + 1)
+    std::vector<CropsMosaic::Canvas> canvases;
+    std::vector<cv::Rect> tilesRects;
+    std::vector<cv::Mat> tilesPixels;
+    tilesRects.reserve(tiles.size());
+    tilesPixels.reserve(tiles.size());
+    for (const auto& tile : tiles)
+    {
+        tilesRects.emplace_back(tile.m_rect);
+        tilesPixels.emplace_back(frames[tile.m_frameInd], tile.m_rect);
+    }
+    if (m_cropsMosaic.Enabled() && cropRatio > 0 && tiles.size() > 1)
+    {
+        std::vector<cv::Size> sizes;
+        sizes.reserve(tiles.size());
+        for (const auto& rect : tilesRects)
+        {
+            sizes.emplace_back(rect.size());
+        }
+        std::vector<size_t> single;
+        m_cropsMosaic.Pack(sizes, engine->get_input_size(), canvases, single);
+        for (size_t i = 0; i < canvases.size(); ++i)
+        {
+            inputs.emplace_back();
+            m_cropsMosaic.Render(tilesPixels, canvases[i], engine->get_input_size(), inputs.back());
+            inputsTiles.push_back(-static_cast<int>(i) - 1);
+        }
+        for (size_t ind : single)
+        {
+            inputs.emplace_back(tilesPixels[ind]);
+            inputsTiles.push_back(static_cast<int>(ind));
         }
     }
     else
     {
-        std::vector<cv::Rect> crops = GetCrops(m_maxCropRatio, m_detector->get_input_size(), colorMat.size());
-        std::cout << "Image on " << crops.size() << " crops with size " << crops.front().size() << ", input size " << m_detector->get_input_size() << ", batch " << m_batchSize << ", frame " << colorMat.size() << std::endl;
+        inputs = tilesPixels;
+        for (size_t i = 0; i < tiles.size(); ++i)
+        {
+            inputsTiles.push_back(static_cast<int>(i));
+        }
+    }
+
+    preprocessTime.Stop();
+
+    std::vector<regions_t> tilesRegions(tiles.size());
+    const size_t maxBatch = std::max<size_t>(1, m_batchSize);
+    std::vector<cv::Mat> batch;
+    batch.reserve(maxBatch);
+    for (size_t i = 0; i < inputs.size(); i += maxBatch)
+    {
+        const size_t batchSize = std::min(maxBatch, inputs.size() - i);
+        batch.assign(inputs.begin() + i, inputs.begin() + i + batchSize);
+        std::vector<tensor_rt::BatchResult> detects;
+        {
+            StageTimer inferenceTime(m_stages.m_inference);
+            engine->detect(batch, detects);
+        }
+
+        for (size_t j = 0; j < std::min(batchSize, detects.size()); ++j)
+        {
+            const int tileInd = inputsTiles[i + j];
+            if (tileInd >= 0)
+            {
+                AddRegions(detects[j], tilesRects[tileInd], tilesRegions[tileInd]);
+            }
+            else
+            {
+                regions_t canvasRegions;
+                AddRegions(detects[j], cv::Rect(), canvasRegions);
+                m_cropsMosaic.ToCrops(canvasRegions, canvases[-tileInd - 1], tilesRects, tilesRegions);
+            }
+        }
+    }
+
+    // The gate gets the new regions of the crops in the order of the frames and keeps the regions of the skipped crops
+    for (size_t i = 0; i < frames.size(); ++i)
+    {
         regions_t tmpRegions;
-		std::vector<cv::Mat> batch;
-		batch.reserve(m_batchSize);
-        for (size_t i = 0; i < crops.size(); i += m_batchSize)
+        for (size_t t = firstTile[i]; t < firstTile[i + 1]; ++t)
         {
-            size_t batchSize = std::min(static_cast<size_t>(m_batchSize), crops.size() - i);
-			batch.clear();
-			for (size_t j = 0; j < batchSize; ++j)
-			{
-				batch.emplace_back(colorMat, crops[i + j]);
-			}
-			std::vector<tensor_rt::BatchResult> detects;
-			m_detector->detect(batch, detects);
-			
-			for (size_t j = 0; j < batchSize; ++j)
-			{
-				const auto& crop = crops[i + j];
-				//std::cout << "Crop " << (i + j) << ": " << crop << std::endl;
-
-				for (const tensor_rt::Result& bbox : detects[j])
-				{
-					if (m_classesWhiteList.empty() || m_classesWhiteList.find(T2T(bbox.id)) != std::end(m_classesWhiteList))
-						tmpRegions.emplace_back(cv::Rect(bbox.rect.x + crop.x, bbox.rect.y + crop.y, bbox.rect.width, bbox.rect.height), T2T(bbox.id), bbox.prob);
-				}
-			}
+            if (gated)
+                m_tilesGate.SetRegions(tiles[t].m_cropInd, std::move(tilesRegions[t]));
+            else
+                tmpRegions.insert(std::end(tmpRegions), std::begin(tilesRegions[t]), std::end(tilesRegions[t]));
         }
+        if (gated)
+            m_tilesGate.Collect(tmpRegions);
 
-		if (crops.size() > 1)
-		{
-			nms3<CRegion>(tmpRegions, m_regions, 0.4f,
-				[](const CRegion& reg) { return reg.m_brect; },
-				[](const CRegion& reg) { return reg.m_confidence; },
-				[](const CRegion& reg) { return reg.m_type; },
-				0, 0.f);
-			//std::cout << "nms for " << tmpRegions.size() << " objects - result " << m_regions.size() << std::endl;
-		}
+        regions[i].clear();
+        if (tilesCount[i] > 1)
+        {
+            nms3<CRegion>(tmpRegions, regions[i], 0.4f,
+                [](const CRegion& reg) { return reg.m_brect; },
+                [](const CRegion& reg) { return reg.m_confidence; },
+                [](const CRegion& reg) { return reg.m_type; },
+                0, 0.f);
+        }
+        else
+        {
+            regions[i] = std::move(tmpRegions);
+        }
+        m_detectionMask.Filter(regions[i], frames[i].size());
     }
 }
 
 ///
-/// \brief YoloTensorRTDetector::Detect
-/// \param frames
+/// \brief YoloTensorRTDetector::AddRegions
+/// \param detects
+/// \param tileRect
 /// \param regions
 ///
-void YoloTensorRTDetector::Detect(const std::vector<cv::UMat>& frames, std::vector<regions_t>& regions)
+void YoloTensorRTDetector::AddRegions(const tensor_rt::BatchResult& detects, const cv::Rect& tileRect, regions_t& regions) const
 {
-    if (frames.size() == 1)
+    for (const tensor_rt::Result& bbox : detects)
     {
-        Detect(frames.front());
-        regions[0].assign(std::begin(m_regions), std::end(m_regions));
+        if (m_classesWhiteList.empty() || m_classesWhiteList.find(T2T(bbox.id)) != std::end(m_classesWhiteList))
+            regions.emplace_back(cv::Rect(bbox.rect.x + tileRect.x, bbox.rect.y + tileRect.y, bbox.rect.width, bbox.rect.height), T2T(bbox.id), bbox.prob);
+    }
+}
+
+///
+/// \brief YoloTensorRTDetector::DetectDevice
+/// The frame and its crops stay in the device memory: the crops are the views with the offset of the frame pointer.
+/// The tiles gate needs the host frame for the motion, so all crops are detected here
+/// \param frame
+/// \return
+///
+bool YoloTensorRTDetector::DetectDevice(const DeviceFrame& frame)
+{
+    if (!CanDeviceProcessing() || frame.empty())
+        return false;
+
+    static metrics::Histogram& detectTime = DetectHistogram("yolo_tensorrt_device", false);
+    metrics::ScopedTimer timer(detectTime);
+
+    float cropRatio = m_maxCropRatio;
+    tensor_rt::Detector* engine = SelectEngine(frame.size(), cropRatio);
+    std::vector<cv::Rect> tiles;
+    if (cropRatio <= 0)
+    {
+        const cv::Rect area = m_detectionMask.BoundingRect(frame.size());
+        if (!area.empty())
+            tiles.emplace_back(area);
     }
     else
     {
-        std::vector<cv::Mat> batch;
-        for (const auto& frame : frames)
+        tiles = GetCrops(cropRatio, engine->get_input_size(), frame.size());
+    }
+
+    regions_t tmpRegions;
+    const size_t maxBatch = std::max<size_t>(1, m_batchSize);
+    std::vector<tensor_rt::DeviceImage> batch;
+    batch.reserve(maxBatch);
+    for (size_t i = 0; i < tiles.size(); i += maxBatch)
+    {
+        const size_t batchSize = std::min(maxBatch, tiles.size() - i);
+        batch.clear();
+        for (size_t j = 0; j < batchSize; ++j)
+        {
+            const cv::Rect& tile = tiles[i + j];
+            tensor_rt::DeviceImage img;
+            img.data = frame.m_data + tile.y * frame.m_pitch + tile.x * frame.m_channels;
+            img.width = tile.width;
+            img.height = tile.height;
+            img.pitch = frame.m_pitch;
+            img.channels = frame.m_channels;
+            img.stream = (i == 0) ? frame.m_stream : nullptr;
+            batch.emplace_back(img);
+        }
+        std::vector<tensor_rt::BatchResult> detects;
+        {
+            StageTimer inferenceTime(m_stages.m_inference);
+            engine->detect(batch, detects);
+        }
+
+        for (size_t j = 0; j < std::min(batchSize, detects.size()); ++j)
         {
-            batch.emplace_back(frame.getMat(cv::ACCESS_READ));
+            AddRegions(detects[j], tiles[i + j], tmpRegions);
         }
+    }
 
+    m_regions.clear();
+    if (tiles.size() > 1)
+    {
+        nms3<CRegion>(tmpRegions, m_regions, 0.4f,
+            [](const CRegion& reg) { return reg.m_brect; },
+            [](const CRegion& reg) { return reg.m_confidence; },
+            [](const CRegion& reg) { return reg.m_type; },
+            0, 0.f);
+    }
+    else
+    {
+        m_regions = std::move(tmpRegions);
+    }
+    m_detectionMask.Filter(m_regions, frame.size());
+    return true;
+}
+
+///
+/// \brief YoloTensorRTDetector::DetectAsync
+/// Frame without crops is started on the free inference slot of the engine: the copies and the inference of the frames overlap.
+/// The futures are read by the thread of DetectAsync
+/// \param colorFrame
+/// \return
+///
+std::future<regions_t> YoloTensorRTDetector::DetectAsync(const cv::UMat& colorFrame)
+{
+    float cropRatio = m_maxCropRatio;
+    tensor_rt::Detector* engine = SelectEngine(colorFrame.size(), cropRatio);
+    if (cropRatio > 0)
+        return BaseDetector::DetectAsync(colorFrame);
+
+    int ticket = 0;
+    {
+        cv::Mat colorMat = exec::MapToHost(colorFrame, "YoloTensorRTDetector::DetectAsync");
+        std::vector<cv::Mat> batch = { colorMat };
+        ticket = engine->detect_async(batch);
+    }
+
+    return std::async(std::launch::deferred, [this, engine, ticket]()
+    {
         std::vector<tensor_rt::BatchResult> detects;
-        m_detector->detect(batch, detects);
-        for (size_t i = 0; i < detects.size(); ++i)
+        engine->get_results(ticket, detects);
+
+        regions_t regions;
+        for (const tensor_rt::BatchResult& dets : detects)
         {
-            const tensor_rt::BatchResult& dets = detects[i];
             for (const tensor_rt::Result& bbox : dets)
             {
                 if (m_classesWhiteList.empty() || m_classesWhiteList.find(T2T(bbox.id)) != std::end(m_classesWhiteList))
-                    regions[i].emplace_back(bbox.rect, T2T(bbox.id), bbox.prob);
+                    regions.emplace_back(bbox.rect, T2T(bbox.id), bbox.prob);
             }
         }
-        m_regions.assign(std::begin(regions.back()), std::end(regions.back()));
-    }
+        return regions;
+    });
 }
@@ -10,20 +10,46 @@ class YoloTensorRTDetector final : public BaseDetector
 {
 public:
 	YoloTensorRTDetector(const cv::UMat& colorFrame);
-	~YoloTensorRTDetector(void) = default;
+	~YoloTensorRTDetector(void) { StopAsync(); }
 
 	bool Init(const config_t& config);
 
+	static void Prefetch(const config_t& config);
+
 	void Detect(const cv::UMat& colorFrame);
     void Detect(const std::vector<cv::UMat>& frames, std::vector<regions_t>& regions);
 
+	std::future<regions_t> DetectAsync(const cv::UMat& colorFrame);
+
+	bool DetectDevice(const DeviceFrame& frame);
+	bool CanDeviceProcessing() const
+	{
+		return m_detector && m_localConfig.gpu_preprocessing;
+	}
+
 	bool CanGrayProcessing() const
 	{
 		return false;
 	}
 
+	size_t MaxBatchSize() const
+	{
+		return m_batchSize;
+	}
+
 private:
 	std::unique_ptr<tensor_rt::Detector> m_detector;
+	// Engines of "adaptiveConfigs": the same model with the smaller inputs for the adaptiveInput
+	std::vector<std::unique_ptr<tensor_rt::Detector>> m_smallEngines;
+	std::vector<cv::Size> m_enginesSizes; // Inputs of m_smallEngines and m_detector in the ascending order of the area
+
+	tensor_rt::Detector* SelectEngine(cv::Size frameSize, float& cropRatio);
+
+	static tensor_rt::Config DefaultConfig();
+	static bool ReadConfig(const config_t& config, tensor_rt::Config& localConfig);
+
+	void DetectFrames(const std::vector<cv::Mat>& frames, std::vector<regions_t>& regions);
+	void AddRegions(const tensor_rt::BatchResult& detects, const cv::Rect& tileRect, regions_t& regions) const;
 
     float m_maxCropRatio = 3.0f;
 	std::vector<std::string> m_classNames;
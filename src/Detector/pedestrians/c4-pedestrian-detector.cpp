@@ -7,30 +7,26 @@
 // ---------------------------------------------------------------------
 // Helper functions
 
-// compute the Sobel image "ct" from "original"
-void ComputeCT(IntImage<double>& original,IntImage<int>& ct)
+// compute the Census Transform image "ct" from the Sobel image "original"
+// the comparisons are branch free for the vectorization
+void ComputeCT(const IntImage<double>& original,IntImage<int>& ct)
 {
     ct.Create(original.nrow,original.ncol);
-    for(int i=2; i<original.nrow-2; i++)
+    tasks::ParallelFor(2, original.nrow-2, [&](int i)
     {
-        double* p1 = original.p[i-1];
-        double* p2 = original.p[i];
-        double* p3 = original.p[i+1];
+        const double* p1 = original.p[i-1];
+        const double* p2 = original.p[i];
+        const double* p3 = original.p[i+1];
         int* ctp = ct.p[i];
+#pragma omp simd
         for(int j=2; j<original.ncol-2; j++)
         {
-            int index = 0;
-            if(p2[j]<=p1[j-1]) index += 0x80;
-            if(p2[j]<=p1[j]) index += 0x40;
-            if(p2[j]<=p1[j+1]) index += 0x20;
-            if(p2[j]<=p2[j-1]) index += 0x10;
-            if(p2[j]<=p2[j+1]) index += 0x08;
-            if(p2[j]<=p3[j-1]) index += 0x04;
-            if(p2[j]<=p3[j]) index += 0x02;
-            if(p2[j]<=p3[j+1]) index ++;
-            ctp[j] = index;
+            const double c = p2[j];
+            ctp[j] = (int(c<=p1[j-1]) << 7) | (int(c<=p1[j]) << 6) | (int(c<=p1[j+1]) << 5) |
+                     (int(c<=p2[j-1]) << 4) | (int(c<=p2[j+1]) << 3) |
+                     (int(c<=p3[j-1]) << 2) | (int(c<=p3[j]) << 1) | int(c<=p3[j+1]);
         }
-    }
+    });
 }
 
 // Load SVM models -- linear SVM trained using LIBLINEAR
@@ -135,8 +131,6 @@ void DetectionScanner::LoadDetector(std::vector<NodeDetector::NodeType>& types,s
     assert(xdiv>0 && ydiv>0);
     for(size_t i=0; i<depth; i++)
         cascade->AddNode(types[i],(xdiv-EXT)*(ydiv-EXT)*baseflength,upper_bounds[i],filenames[i].c_str());
-
-    hist.Create(1,baseflength*(xdiv-EXT)*(ydiv-EXT));
 }
 
 void NodeDetector::Load(const NodeType _type,const int _featurelength,const int _upper_bound,const int _index,const char* _filename)
@@ -177,41 +171,59 @@ void CascadeDetector::AddNode(const NodeDetector::NodeType _type,const int _feat
 // ---------------------------------------------------------------------
 // Detection functions
 
-// initialization -- compute the Census Tranform image for CENTRIST
-void DetectionScanner::InitImage(IntImage<double>& original)
+// initialization -- the image pyramid from "original" while the window fits the image
+size_t DetectionScanner::InitLevels(IntImage<double>& original)
 {
-    image = original;
-    image.Sobel(sobel,false,false);
-    ComputeCT(sobel,ct);
+    size_t count = 0;
+    for(;;)
+    {
+        if(levels.size()<=count)
+            levels.emplace_back(std::make_unique<Level>());
+        if(count==0)
+            levels[0]->image = original;
+        else
+            levels[count-1]->image.Resize(levels[count]->image,ratio);
+        if(levels[count]->image.nrow<height || levels[count]->image.ncol<width)
+            break;
+        ++count;
+    }
+    return count;
 }
 
 // combine the (xdiv-1)*(ydiv-1) integral images into a single one
-void DetectionScanner::InitIntegralImages(const int stepsize)
+// the rows are independent, every element sums the weights in the same order as the sequential loops
+void DetectionScanner::InitIntegralImages(Level& level,const int stepsize) const
 {
     if(cascade->nodes[0]->type!=NodeDetector::LINEAR)
         return; // No need to prepare integral images
 
+    const IntImage<int>& ct = level.ct;
+    IntImage<double>& scores = level.scores;
     const int hd = height/xdiv*2-2;
     const int wd = width/ydiv*2-2;
     scores.Create(ct.nrow,ct.ncol);
     scores.Zero(cascade->nodes[0]->thresh/hd/wd);
-    double* linearweights = cascade->nodes[0]->classifier.buf;
-    for(int i=0; i<xdiv-EXT; i++)
+    const double* weights = cascade->nodes[0]->classifier.buf;
+    tasks::ParallelFor(2, ct.nrow-2, [&](int x)
     {
-        const int xoffset = height/xdiv*i;
-        for(int j=0; j<ydiv-EXT; j++)
+        double* tempp = scores.p[x];
+        const double* linearweights = weights;
+        for(int i=0; i<xdiv-EXT; i++)
         {
-            const int yoffset = width/ydiv*j;
-            for(int x=2; x<ct.nrow-2-xoffset; x++)
+            const int xoffset = height/xdiv*i;
+            for(int j=0; j<ydiv-EXT; j++)
             {
-                int* ctp = ct.p[x+xoffset]+yoffset;
-                double* tempp = scores.p[x];
-                for(int y=2; y<ct.ncol-2-yoffset; y++)
-                    tempp[y] += linearweights[ctp[y]];
+                const int yoffset = width/ydiv*j;
+                if(x<ct.nrow-2-xoffset)
+                {
+                    const int* ctp = ct.p[x+xoffset]+yoffset;
+                    for(int y=2; y<ct.ncol-2-yoffset; y++)
+                        tempp[y] += linearweights[ctp[y]];
+                }
+                linearweights += baseflength;
             }
-            linearweights += baseflength;
         }
-    }
+    });
     scores.CalcIntegralImageInPlace();
     for(int i=2; i<ct.nrow-2-height; i+=stepsize)
     {
@@ -222,68 +234,85 @@ void DetectionScanner::InitIntegralImages(const int stepsize)
     }
 }
 
-// Resize the input image and then re-compute Sobel image etc
-void DetectionScanner::ResizeImage()
+// scan the windows of the row "i" of the level which pass the linear classifier by the histogram classifier
+void DetectionScanner::ScanRow(const Level& level,const int i,const int stepsize,const int oheight,const int owidth,
+                               std::vector<int>& rowhist,std::vector<cv::Rect>& results) const
 {
-    image.Resize(sobel,ratio);
-    image.Swap(sobel);
-    image.Sobel(sobel,false,false);
-    ComputeCT(sobel,ct);
-}
-
-// The function that does the real detection
-int DetectionScanner::FastScan(IntImage<double>& original,std::vector<cv::Rect>& results,const int stepsize)
-{
-    if(original.nrow<height+5 || original.ncol<width+5) return 0;
     const int hd = height/xdiv;
     const int wd = width/ydiv;
-    InitImage(original);
-    results.clear();
-
-    hist.Create(1,baseflength*(xdiv-EXT)*(ydiv-EXT));
-
-    NodeDetector* node = cascade->nodes[1];
+    const NodeDetector* node = cascade->nodes[1];
     double** pc = node->classifier.p;
-    int oheight = original.nrow, owidth = original.ncol;
+    const IntImage<double>& image = level.image;
+    const IntImage<int>& ct = level.ct;
+    const double* sp = level.scores.p[i];
     cv::Rect rect;
-    while(image.nrow>=height && image.ncol>=width)
+    for(int j=2; j+width<image.ncol-2; j+=stepsize)
     {
-        InitIntegralImages(stepsize);
-        for(int i=2; i+height<image.nrow-2; i+=stepsize)
+        if(sp[j]<=0) continue;
+        int* p = rowhist.data();
+        std::fill(std::begin(rowhist),std::end(rowhist),0);
+        for(int k=0; k<xdiv-EXT; k++)
         {
-            const double* sp = scores.p[i];
-            for(int j=2; j+width<image.ncol-2; j+=stepsize)
+            for(int t=0; t<ydiv-EXT; t++)
             {
-                if(sp[j]<=0) continue;
-                int* p = hist.buf;
-                hist.Zero();
-                for(int k=0; k<xdiv-EXT; k++)
-                {
-                    for(int t=0; t<ydiv-EXT; t++)
-                    {
-                        for(int x=i+k*hd+1; x<i+(k+1+EXT)*hd-1; x++)
-                        {
-                            int* ctp = ct.p[x];
-                            for(int y=j+t*wd+1; y<j+(t+1+EXT)*wd-1; y++)
-                                p[ctp[y]]++;
-                        }
-                        p += baseflength;
-                    }
-                }
-                double score = node->thresh;
-                for(int k=0; k<node->classifier.nrow; k++) score += pc[k][hist.buf[k]];
-                if(score>0)
+                for(int x=i+k*hd+1; x<i+(k+1+EXT)*hd-1; x++)
                 {
-                    rect.y = i * oheight / image.nrow;
-                    rect.height = (oheight * height) / image.nrow + 1;
-                    rect.x = j * owidth / image.ncol;
-                    rect.width = (width * owidth) /image.ncol + 1;
-                    results.push_back(rect);
+                    const int* ctp = ct.p[x];
+                    for(int y=j+t*wd+1; y<j+(t+1+EXT)*wd-1; y++)
+                        p[ctp[y]]++;
                 }
+                p += baseflength;
             }
         }
-        ResizeImage();
+        double score = node->thresh;
+        for(int k=0; k<node->classifier.nrow; k++) score += pc[k][rowhist[k]];
+        if(score>0)
+        {
+            rect.y = i * oheight / image.nrow;
+            rect.height = (oheight * height) / image.nrow + 1;
+            rect.x = j * owidth / image.ncol;
+            rect.width = (width * owidth) /image.ncol + 1;
+            results.push_back(rect);
+        }
     }
+}
+
+// The function that does the real detection
+// the scales are prepared in parallel, then the rows of the all scales are scanned in parallel
+// the results are in the same order as the sequential scan from the largest scale
+int DetectionScanner::FastScan(IntImage<double>& original,std::vector<cv::Rect>& results,const int stepsize)
+{
+    if(original.nrow<height+5 || original.ncol<width+5) return 0;
+    results.clear();
+
+    const int levelsCount = static_cast<int>(InitLevels(original));
+    tasks::ParallelFor(0, levelsCount, [&](int l)
+    {
+        Level& level = *levels[l];
+        level.image.Sobel(level.sobel,false,false);
+        ComputeCT(level.sobel,level.ct);
+        InitIntegralImages(level,stepsize);
+    }, 1);
+
+    std::vector<std::pair<int, int>> rows; // level and row
+    for(int l=0; l<levelsCount; l++)
+    {
+        for(int i=2; i+height<levels[l]->image.nrow-2; i+=stepsize)
+            rows.emplace_back(l,i);
+    }
+
+    const int oheight = original.nrow, owidth = original.ncol;
+    const size_t histSize = static_cast<size_t>(baseflength)*(xdiv-EXT)*(ydiv-EXT);
+    std::vector<std::vector<cv::Rect>> rowsResults(rows.size());
+    const int rowsCount = static_cast<int>(rows.size());
+    tasks::ParallelForRange(0, rowsCount, [&](int rowBegin, int rowEnd)
+    {
+        std::vector<int> rowhist(histSize);
+        for(int r=rowBegin; r<rowEnd; r++)
+            ScanRow(*levels[rows[r].first],rows[r].second,stepsize,oheight,owidth,rowhist,rowsResults[r]);
+    }, 4);
+    for(const auto& rowResults : rowsResults)
+        results.insert(results.end(),rowResults.begin(),rowResults.end());
     return 0;
 }
 
@@ -8,9 +8,12 @@
 #include <string>
 #include <cmath>
 #include <vector>
+#include <memory>
 
 #include <opencv2/opencv.hpp>
 
+#include "task_scheduler.h"
+
 #define USE_DOUBLE
 
 #ifdef USE_DOUBLE
@@ -403,12 +406,13 @@ void IntImage<T>::Sobel(IntImage<REAL>& result,const bool useSqrt,const bool nor
     for(int i=0; i<nrow; i++) result.p[i][0] = result.p[i][ncol-1] = 0;
     std::fill(result.p[0],result.p[0]+ncol,0.0);
     std::fill(result.p[nrow-1],result.p[nrow-1]+ncol,0.0);
-    for(int i=1; i<nrow-1; i++)
+    tasks::ParallelFor(1, nrow-1, [&](int i)
     {
-        T* p1 = p[i-1];
-        T* p2 = p[i];
-        T* p3 = p[i+1];
+        const T* p1 = p[i-1];
+        const T* p2 = p[i];
+        const T* p3 = p[i+1];
         REAL* pr = result.p[i];
+#pragma omp simd
         for(int j=1; j<ncol-1; j++)
         {
             REAL gx =     p1[j-1] - p1[j+1]
@@ -419,7 +423,7 @@ void IntImage<T>::Sobel(IntImage<REAL>& result,const bool useSqrt,const bool nor
                           +    p1[j+1] - p3[j+1];
             pr[j] = gx*gx+gy*gy;
         }
-    }
+    });
     if(useSqrt || normalize ) // if we want to normalize the result image, we'd better use the true Sobel gradient
         for(int i=1; i<nrow-1; i++)
             for(int j=1; j<ncol-1; j++)
@@ -547,15 +551,22 @@ public:
     CascadeDetector* cascade;
 
 private:
+    // One scale of the image pyramid, the scales are scanned in parallel
+    struct Level
+    {
+        IntImage<double> image;
+        IntImage<double> sobel;
+        IntImage<int> ct;
+        IntImage<double> scores;
+    };
+
     IntImage<double>* integrals;
-    IntImage<double> image,sobel;
-    IntImage<int> ct;
-    Array2dC<int> hist;
-    IntImage<double> scores;
-
-    void InitImage(IntImage<double>& original);
-    void InitIntegralImages(const int stepsize);
-    void ResizeImage();
+    std::vector<std::unique_ptr<Level>> levels;
+
+    size_t InitLevels(IntImage<double>& original);
+    void InitIntegralImages(Level& level,const int stepsize) const;
+    void ScanRow(const Level& level,const int i,const int stepsize,const int oheight,const int owidth,
+                 std::vector<int>& rowhist,std::vector<cv::Rect>& results) const;
 };
 
 void LoadCascade(std::string cascade1, std::string cascade2, DetectionScanner& ds);
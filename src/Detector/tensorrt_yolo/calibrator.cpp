@@ -28,6 +28,7 @@ SOFTWARE.
 #include <iostream>
 #include <iterator>
 #include <random>
+#include <thread>
 
 Int8EntropyCalibrator::Int8EntropyCalibrator(const uint32_t& batchSize, const std::string& calibImages,
                                              const std::string& calibImagesPath,
@@ -55,26 +56,62 @@ Int8EntropyCalibrator::Int8EntropyCalibrator(const uint32_t& batchSize, const st
     }
 
     NV_CUDA_CHECK(cudaMalloc(&m_DeviceInput, m_InputCount * sizeof(float)));
+    if (!m_ImageList.empty())
+    {
+        NV_CUDA_CHECK(cudaMallocHost(&m_HostInput, m_InputCount * sizeof(float)));
+        NV_CUDA_CHECK(cudaStreamCreate(&m_CudaStream));
+    }
+}
+
+Int8EntropyCalibrator::~Int8EntropyCalibrator()
+{
+    if (m_NextBatch.valid())
+        m_NextBatch.wait();
+    if (m_CudaStream)
+        NV_CUDA_CHECK(cudaStreamDestroy(m_CudaStream));
+    if (m_HostInput)
+        NV_CUDA_CHECK(cudaFreeHost(m_HostInput));
+    NV_CUDA_CHECK(cudaFree(m_DeviceInput));
 }
 
-Int8EntropyCalibrator::~Int8EntropyCalibrator() { NV_CUDA_CHECK(cudaFree(m_DeviceInput)); }
+cv::Mat Int8EntropyCalibrator::loadBatch(const uint32_t imageIndex) const
+{
+    // Decoding and letterbox of the images of the batch on the all cores
+    std::vector<DsImage> dsImages(m_BatchSize);
+    const uint32_t threadsCount = std::max(1u, std::min(m_BatchSize, std::thread::hardware_concurrency()));
+    std::vector<std::thread> threads;
+    threads.reserve(threadsCount);
+    for (uint32_t t = 0; t < threadsCount; ++t)
+    {
+        threads.emplace_back([this, &dsImages, imageIndex, threadsCount, t]()
+        {
+            for (uint32_t j = t; j < m_BatchSize; j += threadsCount)
+            {
+                dsImages[j] = DsImage(m_ImageList.at(imageIndex + j), _s_net_type, m_InputH, m_InputW);
+            }
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    return blobFromDsImages(dsImages, m_InputH, m_InputW);
+}
 
 bool Int8EntropyCalibrator::getBatch(void* bindings[], const char* names[], int /*nbBindings*/)
 {
     if (m_ImageIndex + m_BatchSize >= m_ImageList.size()) return false;
 
     // Load next batch
-    std::vector<DsImage> dsImages(m_BatchSize);
-    for (uint32_t j = m_ImageIndex; j < m_ImageIndex + m_BatchSize; ++j)
-    {
-        dsImages.at(j - m_ImageIndex) = DsImage(m_ImageList.at(j), _s_net_type, m_InputH, m_InputW);
-    }
+    cv::Mat trtInput = m_NextBatch.valid() ? m_NextBatch.get() : loadBatch(m_ImageIndex);
     m_ImageIndex += m_BatchSize;
+    if (m_ImageIndex + m_BatchSize < m_ImageList.size())
+        m_NextBatch = std::async(std::launch::async, &Int8EntropyCalibrator::loadBatch, this, m_ImageIndex);
 
-    cv::Mat trtInput = blobFromDsImages(dsImages, m_InputH, m_InputW);
-
-    NV_CUDA_CHECK(cudaMemcpy(m_DeviceInput, trtInput.ptr<float>(0), m_InputCount * sizeof(float),
-                             cudaMemcpyHostToDevice));
+    memcpy(m_HostInput, trtInput.ptr<float>(0), m_InputCount * sizeof(float));
+    NV_CUDA_CHECK(cudaMemcpyAsync(m_DeviceInput, m_HostInput, m_InputCount * sizeof(float),
+                                  cudaMemcpyHostToDevice, m_CudaStream));
+    NV_CUDA_CHECK(cudaStreamSynchronize(m_CudaStream));
     assert(!strcmp(names[0], m_InputBlobName.c_str()));
     bindings[0] = m_DeviceInput;
     return true;
@@ -26,6 +26,7 @@ SOFTWARE.
 #define _CALIBRATOR_H_
 
 #include "NvInfer.h"
+#include <future>
 #include "ds_image.h"
 #include "trt_utils.h"
 
@@ -55,8 +56,14 @@ private:
     uint32_t m_ImageIndex;
     bool m_ReadCache{true};
     void* m_DeviceInput{nullptr};
+    float* m_HostInput{nullptr};
+    cudaStream_t m_CudaStream{nullptr};
     std::vector<std::string> m_ImageList;
     std::vector<char> m_CalibrationCache;
+
+    // The next batch is read and preprocessed while TensorRT calibrates on the current one
+    std::future<cv::Mat> m_NextBatch;
+    cv::Mat loadBatch(const uint32_t imageIndex) const;
 };
 
 #endif
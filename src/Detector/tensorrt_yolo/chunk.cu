@@ -65,8 +65,8 @@ namespace nvinfer1
 		//batch
 		for (int b = 0; b < batchSize; ++b)
 		{
-			NV_CUDA_CHECK(cudaMemcpy((char*)outputs[0] + b * _n_size_split, (char*)inputs[0] + b * 2 * _n_size_split, _n_size_split, cudaMemcpyDeviceToDevice));
-			NV_CUDA_CHECK(cudaMemcpy((char*)outputs[1] + b * _n_size_split, (char*)inputs[0] + b * 2 * _n_size_split + _n_size_split, _n_size_split, cudaMemcpyDeviceToDevice));
+			NV_CUDA_CHECK(cudaMemcpyAsync((char*)outputs[0] + b * _n_size_split, (char*)inputs[0] + b * 2 * _n_size_split, _n_size_split, cudaMemcpyDeviceToDevice, stream));
+			NV_CUDA_CHECK(cudaMemcpyAsync((char*)outputs[1] + b * _n_size_split, (char*)inputs[0] + b * 2 * _n_size_split + _n_size_split, _n_size_split, cudaMemcpyDeviceToDevice, stream));
 		}
 	//	NV_CUDA_CHECK(cudaMemcpy(outputs[0], inputs[0], _n_size_split, cudaMemcpyDeviceToDevice));
 	//	NV_CUDA_CHECK(cudaMemcpy(outputs[1], (void*)((char*)inputs[0] + _n_size_split), _n_size_split, cudaMemcpyDeviceToDevice));
@@ -112,7 +112,7 @@ namespace nvinfer1
 		int nbInputs) const
 	{
 		assert(index == 0 || index == 1);
-		return DataType::kFLOAT;
+		return inputTypes[0];
 	}
 
 	bool Chunk::isOutputBroadcastAcrossBatch(int outputIndex, const bool* inputIsBroadcasted, int nbInputs) const
@@ -129,7 +129,8 @@ namespace nvinfer1
 
 	void Chunk::configurePlugin(const PluginTensorDesc* in, int nbInput, const PluginTensorDesc* out, int nbOutput)
 	{
-		_n_size_split = in->dims.d[0] / 2 * in->dims.d[1] * in->dims.d[2] *sizeof(float);
+		const int elemSize = (in->type == DataType::kHALF) ? 2 : static_cast<int>(sizeof(float));
+		_n_size_split = in->dims.d[0] / 2 * in->dims.d[1] * in->dims.d[2] * elemSize;
 	}
 	void Chunk::detachFromContext() {}
 
@@ -46,12 +46,15 @@ namespace nvinfer1
 		void detachFromContext() override;
 		bool supportsFormatCombination(int pos, const PluginTensorDesc* inOut, int /*nbInputs*/, int /*nbOutputs*/) const override
 		{
-			return inOut[pos].format == TensorFormat::kLINEAR && inOut[pos].type == DataType::kFLOAT;
+			// Only the copy of the halves: any type of the input, the same for the outputs
+			return inOut[pos].format == TensorFormat::kLINEAR &&
+				(inOut[pos].type == DataType::kFLOAT || inOut[pos].type == DataType::kHALF) &&
+				inOut[pos].type == inOut[0].type;
 		}
 		IPluginV2IOExt* clone() const override;
 	private:
 		std::string _s_plugin_namespace;
-		int _n_size_split;
+		int _n_size_split; // Bytes of the half
 	};
 
 	class ChunkPluginCreator : public IPluginCreator
@@ -31,11 +31,36 @@ namespace tensor_rt
 		_impl->_detector.init(config);
 	}
 
+	void Detector::prefetch(const Config &config)
+	{
+		YoloDectector::prefetch(config);
+	}
+
 	void Detector::detect(const std::vector<cv::Mat> &mat_image, std::vector<BatchResult> &vec_batch_result)
 	{
 		_impl->_detector.detect(mat_image, vec_batch_result);
 	}
 
+	int Detector::detect_async(const std::vector<cv::Mat> &mat_image)
+	{
+		return _impl->_detector.detect_async(mat_image);
+	}
+
+	void Detector::detect(const std::vector<DeviceImage> &device_image, std::vector<BatchResult> &vec_batch_result)
+	{
+		_impl->_detector.detect(device_image, vec_batch_result);
+	}
+
+	int Detector::detect_async(const std::vector<DeviceImage> &device_image)
+	{
+		return _impl->_detector.detect_async(device_image);
+	}
+
+	void Detector::get_results(int ticket, std::vector<BatchResult> &vec_batch_result)
+	{
+		_impl->_detector.get_results(ticket, vec_batch_result);
+	}
+
 	cv::Size Detector::get_input_size() const
 	{
 		return _impl->_detector.get_input_size();
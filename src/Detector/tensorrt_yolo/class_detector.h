@@ -21,6 +21,17 @@ namespace tensor_rt
 	
 	typedef std::vector<Result> BatchResult;
 
+	// Frame in the device memory of the detector GPU, for example the BGRA frame of NVDEC: it's preprocessed in place without the upload
+	struct DeviceImage
+	{
+		const unsigned char* data = nullptr;
+		int width = 0;
+		int height = 0;
+		size_t pitch = 0;       // Bytes of the row
+		int channels = 3;       // BGR or BGRA
+		void* stream = nullptr; // cudaStream_t of the frame producer, it's finished before the preprocessing
+	};
+
 	enum ModelType
 	{
         YOLOV2 = 0,
@@ -47,15 +58,41 @@ namespace tensor_rt
 
 		float detect_thresh = 0.9f;
 
+		// Thresholds of the every class of the model, the classes with the threshold over 1 aren't decoded.
+		// Empty for detect_thresh of all classes, otherwise detect_thresh must be the minimum of them
+		std::vector<float> class_thresh;
+
+		// Maximum candidates of the image before NMS, 0 - without limit
+		uint32_t top_k = 0;
+
 		ModelType	net_type = YOLOV3;
 
 		Precision	inference_precison = FP32;
 
 		int	gpu_id = 0;
 
+		// DLA core of Jetson Xavier or Orin for the engine, -1 - GPU. DLA runs FP16 or INT8, FP32 is built as FP16.
+		// The layers which DLA can't run fall back to GPU
+		int dla_core = -1;
+
 		uint32_t batch_size = 1;
 
+		bool gpu_preprocessing = true;
+
+		// Decoding and NMS on GPU for YOLOv3, YOLOv4 and YOLOv5, only with gpu_preprocessing
+		bool gpu_postprocessing = true;
+
+		// Batches in flight of detect_async, every one has own execution context and CUDA stream
+		uint32_t pipeline_depth = 2;
+
+		// Replay of the captured CUDA graphs for the batches of the same frames geometry: less launch overhead of the small models
+		bool cuda_graphs = false;
+
 		std::string calibration_image_list_file_txt = "configs/calibration_images.txt";
+
+		// INT8 without the calibration table of the images list is calibrated in init, otherwise FP16 is used.
+		// The table is created offline by yolo_rt_calibrate
+		bool int8_calibration = true;
 	};
 
 	class API Detector
@@ -67,8 +104,20 @@ namespace tensor_rt
 
 		void init(const Config &config);
 
+		// Starts the hashing of the model and the loading of the cached engine for init with the same config
+		static void prefetch(const Config &config);
+
 		void detect(const std::vector<cv::Mat> &mat_image, std::vector<BatchResult> &vec_batch_result);
 
+		// Starts the batch without waiting, the returned ticket is used by get_results
+		int detect_async(const std::vector<cv::Mat> &mat_image);
+
+		// The frames stay on GPU, only the boxes are copied to the host. It needs gpu_preprocessing
+		void detect(const std::vector<DeviceImage> &device_image, std::vector<BatchResult> &vec_batch_result);
+		int detect_async(const std::vector<DeviceImage> &device_image);
+
+		void get_results(int ticket, std::vector<BatchResult> &vec_batch_result);
+
 		cv::Size get_input_size() const;
 
 	private:
@@ -13,6 +13,8 @@
 #include <fstream>
 #include <string>
 #include <chrono>
+#include <map>
+#include <algorithm>
 #include <stdio.h>  /* defines FILENAME_MAX */
 
 #include "class_detector.h"
@@ -40,27 +42,154 @@ public:
 		this->build_net();
 	}
 
+	// The engine of init with the same config is loaded in the background
+	static void prefetch(const tensor_rt::Config &config)
+	{
+		// The engine of DLA is loaded by init on its core
+		if (config.dla_core >= 0)
+			return;
+		YoloDectector detector;
+		detector._config = config;
+		detector.parse_config();
+		prefetchTRTEngine(detector._yolo_info.data_path, detector._yolo_info.configFilePath, detector._yolo_info.wtsFilePath,
+			detector._yolo_info.precision, detector._infer_param.batchSize, config.gpu_id,
+			(detector._yolo_info.precision == "kINT8") ? detector._yolo_info.calibrationTablePath : std::string());
+	}
+
 	void detect(const std::vector<cv::Mat>	&vec_image,
 				std::vector<tensor_rt::BatchResult> &vec_batch_result)
 	{
-		std::vector<DsImage> vec_ds_images;
+		get_results(detect_async(vec_image), vec_batch_result);
+	}
+
+	// The batch is started on the free inference slot, the results of the tickets are read by get_results in any order
+	int detect_async(const std::vector<cv::Mat> &vec_image)
+	{
+		make_room();
+
+		Pending pending;
+		for (const auto &img : vec_image)
+		{
+			pending.sizes.emplace_back(img.cols, img.rows);
+		}
+		if (_config.gpu_preprocessing)
+		{
+			pending.slot = _p_net->enqueueInference(vec_image);
+		}
+		else
+		{
+			std::vector<DsImage> vec_ds_images;
+			for (const auto &img:vec_image)
+			{
+				vec_ds_images.emplace_back(img, _vec_net_type[_config.net_type], _p_net->getInputH(), _p_net->getInputW());
+			}
+			cv::Mat trtInput = blobFromDsImages(vec_ds_images, _p_net->getInputH(),_p_net->getInputW());
+			pending.slot = _p_net->enqueueInference(trtInput.data, static_cast<uint32_t>(vec_ds_images.size()));
+		}
+		const int ticket = _next_ticket++;
+		_pending.emplace(ticket, std::move(pending));
+		return ticket;
+	}
+
+	void detect(const std::vector<tensor_rt::DeviceImage> &vec_image,
+				std::vector<tensor_rt::BatchResult> &vec_batch_result)
+	{
+		get_results(detect_async(vec_image), vec_batch_result);
+	}
+
+	// The device frames are letterboxed by the GPU preprocessing in place: without the host staging and the upload
+	int detect_async(const std::vector<tensor_rt::DeviceImage> &vec_image)
+	{
+		if (!_config.gpu_preprocessing)
+		{
+			std::cerr << "Detection of the device frames needs gpu_preprocessing" << std::endl;
+			return -1;
+		}
+		make_room();
+
+		Pending pending;
+		for (const auto &img : vec_image)
+		{
+			pending.sizes.emplace_back(img.width, img.height);
+		}
+		pending.slot = _p_net->enqueueInference(vec_image);
+		const int ticket = _next_ticket++;
+		_pending.emplace(ticket, std::move(pending));
+		return ticket;
+	}
+
+	void get_results(int ticket, std::vector<tensor_rt::BatchResult> &vec_batch_result)
+	{
 		vec_batch_result.clear();
-		if (vec_batch_result.capacity() < vec_image.size())
-			vec_batch_result.reserve(vec_image.size());
-		for (const auto &img:vec_image)
+		auto it = _pending.find(ticket);
+		if (it == std::end(_pending))
+			return;
+		if (!it->second.ready)
+			finish(it->second);
+		vec_batch_result = std::move(it->second.results);
+		_pending.erase(it);
+	}
+
+	cv::Size get_input_size() const
+	{
+		return cv::Size(_p_net->getInputH(), _p_net->getInputW());
+	}
+
+private:
+
+	struct Pending
+	{
+		int slot = -1;
+		std::vector<cv::Size> sizes;
+		bool ready = false;
+		std::vector<tensor_rt::BatchResult> results;
+	};
+
+	// All slots are in flight: the oldest batch is finished and its results wait for get_results
+	void make_room()
+	{
+		if (_p_net->getFreeSlot() < 0)
 		{
-			vec_ds_images.emplace_back(img, _vec_net_type[_config.net_type], _p_net->getInputH(), _p_net->getInputW());
+			for (auto& pending : _pending)
+			{
+				if (!pending.second.ready)
+				{
+					finish(pending.second);
+					break;
+				}
+			}
 		}
-		cv::Mat trtInput = blobFromDsImages(vec_ds_images, _p_net->getInputH(),_p_net->getInputW());
-		_p_net->doInference(trtInput.data, static_cast<uint32_t>(vec_ds_images.size()));
-		for (size_t i = 0; i < vec_ds_images.size(); ++i)
+	}
+
+	void finish(Pending &pending)
+	{
+		_p_net->waitInference(pending.slot);
+		pending.ready = true;
+
+		const bool gpuDetections = _config.gpu_preprocessing && _p_net->isGpuPostprocessing();
+		pending.results.reserve(pending.sizes.size());
+		for (size_t i = 0; i < pending.sizes.size(); ++i)
 		{
-			auto curImage = vec_ds_images.at(i);
-			auto binfo = _p_net->decodeDetections(static_cast<int>(i), curImage.getImageHeight(), curImage.getImageWidth());
-			auto remaining = nmsAllClasses(_p_net->getNMSThresh(),
-				binfo,
-				_p_net->getNumClasses(),
-				_vec_net_type[_config.net_type]);
+			std::vector<BBoxInfo> remaining;
+			if (gpuDetections)
+			{
+				remaining = _p_net->getGpuDetections(static_cast<int>(i));
+			}
+			else
+			{
+				auto binfo = _p_net->decodeDetections(static_cast<int>(i), pending.sizes[i].height, pending.sizes[i].width);
+				const size_t topK = _p_net->getTopK();
+				if (topK && binfo.size() > topK)
+				{
+					std::nth_element(binfo.begin(), binfo.begin() + topK, binfo.end(),
+						[](const BBoxInfo& b1, const BBoxInfo& b2) { return b1.prob > b2.prob; });
+					binfo.resize(topK);
+				}
+				remaining = nmsAllClasses(_p_net->getNMSThresh(),
+					binfo,
+					_p_net->getNumClasses(),
+					_vec_net_type[_config.net_type]);
+			}
 
 			std::vector<tensor_rt::Result> vec_result;
 			if (!remaining.empty())
@@ -75,17 +204,10 @@ public:
 					vec_result.emplace_back(b.label, b.prob, cv::Rect(x, y, w, h));
 				}
 			}
-			vec_batch_result.emplace_back(vec_result);
+			pending.results.emplace_back(vec_result);
 		}
 	}
 
-	cv::Size get_input_size() const
-	{
-		return cv::Size(_p_net->getInputH(), _p_net->getInputW());
-	}
-
-private:
-
 	void set_gpu_id(const int id = 0)
 	{
 		cudaError_t status = cudaSetDevice(id);
@@ -102,12 +224,23 @@ private:
 		_yolo_info.configFilePath = _config.file_model_cfg;
 		_yolo_info.wtsFilePath = _config.file_model_weights;
 		_yolo_info.precision = _vec_precision[_config.inference_precison];
-		_yolo_info.deviceType = "kGPU";
+		_yolo_info.deviceType = (_config.dla_core >= 0) ? "kDLA" : "kGPU";
+		_yolo_info.dlaCore = _config.dla_core;
+		if (_config.dla_core >= 0 && _yolo_info.precision == "kFLOAT")
+		{
+			std::cout << "DLA doesn't run FP32, FP16 is used" << std::endl;
+			_yolo_info.precision = "kHALF";
+		}
 		auto npos = _yolo_info.wtsFilePath.find(".weights");
 		assert(npos != std::string::npos
 			&& "wts file file not recognised. File needs to be of '.weights' format");
 		_yolo_info.data_path = _yolo_info.wtsFilePath.substr(0, npos);
-		_yolo_info.calibrationTablePath = _yolo_info.data_path + "-calibration.table";
+		_yolo_info.calibrationTablePath = getCalibrationTablePath(_yolo_info.data_path, _config.calibration_image_list_file_txt);
+		if (_yolo_info.precision == "kINT8" && !_config.int8_calibration && !fileExists(_yolo_info.calibrationTablePath, false))
+		{
+			std::cerr << "INT8 calibration table " << _yolo_info.calibrationTablePath << " not found, FP16 is used. Run yolo_rt_calibrate for it" << std::endl;
+			_yolo_info.precision = "kHALF";
+		}
 		_yolo_info.inputBlobName = "data";
 
 		_infer_param.printPerfInfo = false;
@@ -117,6 +250,8 @@ private:
 		_infer_param.probThresh = _config.detect_thresh;
 		_infer_param.nmsThresh = 0.5;
 		_infer_param.batchSize = _config.batch_size;
+		_infer_param.classThresh = _config.class_thresh;
+		_infer_param.topK = _config.top_k;
 	}
 
 	void build_net()
@@ -141,6 +276,12 @@ private:
 		{
 			assert(false && "Unrecognised network_type.");
 		}
+		if (_p_net)
+		{
+			_p_net->setPipelineDepth(_config.pipeline_depth);
+			_p_net->setGpuPostprocessing(_config.gpu_postprocessing && _config.gpu_preprocessing);
+			_p_net->setCudaGraphs(_config.cuda_graphs);
+		}
 	}
 
 private:
@@ -150,6 +291,8 @@ private:
 	std::vector<std::string> _vec_net_type{ "yolov2", "yolov3", "yolov2-tiny", "yolov3-tiny", "yolov4", "yolov4-tiny", "yolov5" };
 	std::vector<std::string> _vec_precision{ "kINT8","kHALF","kFLOAT" };
 	std::unique_ptr<Yolo> _p_net = nullptr;
+	std::map<int, Pending> _pending;
+	int _next_ticket = 0;
 	Timer _m_timer;
 };
 
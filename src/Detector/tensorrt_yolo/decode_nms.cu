@@ -0,0 +1,200 @@
+#include <cuda.h>
+#include <cuda_runtime.h>
+#include <stdint.h>
+#include "decode_nms.h"
+
+inline __device__ float clampGPU(const float val, const float minVal, const float maxVal)
+{
+    return fminf(fmaxf(val, minVal), maxVal);
+}
+
+// The same decoding as decodeTensor of YoloV3, YoloV4 and YoloV5: one thread for one box of one cell
+__global__ void gpuDecodeYolo(const float* input, const YoloDecodeParams params, GpuBBox* candidates, int* count)
+{
+    const int cell = blockIdx.x * blockDim.x + threadIdx.x;
+    const int b = blockIdx.y;
+    const int numGridCells = params.gridH * params.gridW;
+    if (cell >= numGridCells || b >= params.numBBoxes)
+        return;
+
+    const float* data = input + cell + numGridCells * (b * (5 + params.numClasses));
+
+    // Probabilities of the classes aren't greater than 1
+    const float objectness = data[numGridCells * 4];
+    if (!(objectness > params.probThresh))
+        return;
+
+    float maxProb = 0.0f;
+    int maxIndex = -1;
+    for (int i = 0; i < params.numClasses; ++i)
+    {
+        const float prob = data[numGridCells * (5 + i)];
+        if (prob > maxProb && (!params.useClassThresh || i >= kMaxGpuClasses || params.classThresh[i] <= 1.f))
+        {
+            maxProb = prob;
+            maxIndex = i;
+        }
+    }
+    maxProb *= objectness;
+    const float thresh = (params.useClassThresh && maxIndex >= 0 && maxIndex < kMaxGpuClasses) ? params.classThresh[maxIndex] : params.probThresh;
+    if (maxIndex < 0 || !(maxProb > thresh))
+        return;
+
+    const int x = cell % params.gridW;
+    const int y = cell / params.gridW;
+    const float bx = (x + data[0]) * params.strideW;
+    const float by = (y + data[numGridCells]) * params.strideH;
+    const float bw = params.anchors[2 * b] * data[2 * numGridCells];
+    const float bh = params.anchors[2 * b + 1] * data[3 * numGridCells];
+
+    GpuBBox box;
+    box.x1 = clampGPU(bx - bw / 2, 0.f, params.netW);
+    box.x2 = clampGPU(bx + bw / 2, 0.f, params.netW);
+    box.y1 = clampGPU(by - bh / 2, 0.f, params.netH);
+    box.y2 = clampGPU(by + bh / 2, 0.f, params.netH);
+    if ((box.x1 > box.x2) || (box.y1 > box.y2))
+        return;
+
+    if (params.letterbox)
+    {
+        box.x1 = (box.x1 - params.xOffset) / params.scaleW;
+        box.x2 = (box.x2 - params.xOffset) / params.scaleW;
+        box.y1 = (box.y1 - params.yOffset) / params.scaleH;
+        box.y2 = (box.y2 - params.yOffset) / params.scaleH;
+    }
+    else
+    {
+        box.x1 = (box.x1 / params.netW) * params.imageW;
+        box.x2 = (box.x2 / params.netW) * params.imageW;
+        box.y1 = (box.y1 / params.netH) * params.imageH;
+        box.y2 = (box.y2 / params.netH) * params.imageH;
+    }
+    box.prob = maxProb;
+    box.label = maxIndex;
+
+    const int ind = atomicAdd(count, 1);
+    if (ind < kMaxGpuCandidates)
+        candidates[ind] = box;
+}
+
+// IoU as in nonMaximumSuppression or IoU minus the distance penalty as in diou_nms
+inline __device__ float overlapGPU(const GpuBBox& b1, const GpuBBox& b2, const bool diou)
+{
+    const float overlapX = fmaxf(0.f, fminf(b1.x2, b2.x2) - fmaxf(b1.x1, b2.x1));
+    const float overlapY = fmaxf(0.f, fminf(b1.y2, b2.y2) - fmaxf(b1.y1, b2.y1));
+    const float area1 = (b1.x2 - b1.x1) * (b1.y2 - b1.y1);
+    const float area2 = (b2.x2 - b2.x1) * (b2.y2 - b2.y1);
+    const float overlap2D = overlapX * overlapY;
+    const float u = area1 + area2 - overlap2D;
+    float res = (u == 0) ? 0 : overlap2D / u;
+    if (diou)
+    {
+        const float dx = (b1.x1 + b1.x2 - b2.x1 - b2.x2) / 2.f;
+        const float dy = (b1.y1 + b1.y2 - b2.y1 - b2.y2) / 2.f;
+        const float diagX = fmaxf(b1.x2, b2.x2) - fminf(b1.x1, b2.x1);
+        const float diagY = fmaxf(b1.y2, b2.y2) - fminf(b1.y1, b2.y1);
+        const float diag = diagX * diagX + diagY * diagY;
+        if (diag > 0)
+            res -= (dx * dx + dy * dy) / diag;
+    }
+    return res;
+}
+
+// One block for one image: bitonic sort of the candidates by the probability and greedy suppression inside the classes
+__global__ void gpuNmsYolo(const GpuBBox* candidates, int* counts, GpuBBox* results, const float nmsThresh, const bool diou, const int topK)
+{
+    __shared__ float keys[kMaxGpuCandidates];
+    __shared__ short inds[kMaxGpuCandidates];
+    __shared__ unsigned char alive[kMaxGpuCandidates];
+
+    candidates += blockIdx.x * kMaxGpuCandidates;
+    results += blockIdx.x * kMaxGpuCandidates;
+    int* imageCounts = counts + 2 * blockIdx.x;
+
+    const int n = min(imageCounts[0], kMaxGpuCandidates);
+    int sortSize = 1;
+    while (sortSize < n)
+    {
+        sortSize <<= 1;
+    }
+
+    for (int i = threadIdx.x; i < sortSize; i += blockDim.x)
+    {
+        keys[i] = (i < n) ? candidates[i].prob : -1.f;
+        inds[i] = static_cast<short>(i);
+        alive[i] = 1;
+    }
+    __syncthreads();
+
+    // Descending order
+    for (int k = 2; k <= sortSize; k <<= 1)
+    {
+        for (int j = k >> 1; j > 0; j >>= 1)
+        {
+            for (int i = threadIdx.x; i < sortSize; i += blockDim.x)
+            {
+                const int ixj = i ^ j;
+                if (ixj > i && ((keys[i] < keys[ixj]) == ((i & k) == 0)))
+                {
+                    const float key = keys[i];
+                    keys[i] = keys[ixj];
+                    keys[ixj] = key;
+                    const short ind = inds[i];
+                    inds[i] = inds[ixj];
+                    inds[ixj] = ind;
+                }
+            }
+            __syncthreads();
+        }
+    }
+
+    // Top-K cap after the sorting: the suppression is quadratic in the candidates count
+    const int nmsCount = (topK > 0) ? min(n, topK) : n;
+
+    // Every kept box suppresses the weaker boxes of its class in parallel
+    for (int i = 0; i < nmsCount; ++i)
+    {
+        if (alive[i])
+        {
+            const GpuBBox bi = candidates[inds[i]];
+            for (int j = i + 1 + threadIdx.x; j < nmsCount; j += blockDim.x)
+            {
+                if (alive[j])
+                {
+                    const GpuBBox bj = candidates[inds[j]];
+                    if (bj.label == bi.label && overlapGPU(bi, bj, diou) > nmsThresh)
+                        alive[j] = 0;
+                }
+            }
+        }
+        __syncthreads();
+    }
+
+    if (threadIdx.x == 0)
+    {
+        int resCount = 0;
+        for (int i = 0; i < nmsCount; ++i)
+        {
+            if (alive[i])
+                results[resCount++] = candidates[inds[i]];
+        }
+        imageCounts[1] = resCount;
+    }
+}
+
+cudaError_t cudaDecodeYolo(const void* input, const YoloDecodeParams& params, void* candidates, int* count, cudaStream_t stream)
+{
+    dim3 threads_per_block(256);
+    dim3 number_of_blocks((params.gridH * params.gridW + threads_per_block.x - 1) / threads_per_block.x, params.numBBoxes);
+    gpuDecodeYolo<<<number_of_blocks, threads_per_block, 0, stream>>>(
+        reinterpret_cast<const float*>(input), params, reinterpret_cast<GpuBBox*>(candidates), count);
+    return cudaGetLastError();
+}
+
+cudaError_t cudaNmsYolo(const void* candidates, int* counts, void* results, const uint32_t batchSize,
+                        const float nmsThresh, const bool diou, const int topK, cudaStream_t stream)
+{
+    gpuNmsYolo<<<batchSize, 1024, 0, stream>>>(
+        reinterpret_cast<const GpuBBox*>(candidates), counts, reinterpret_cast<GpuBBox*>(results), nmsThresh, diou, topK);
+    return cudaGetLastError();
+}
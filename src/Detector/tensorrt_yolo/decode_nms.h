@@ -0,0 +1,56 @@
+#ifndef _DECODE_NMS_H_
+#define _DECODE_NMS_H_
+
+#include <cuda_runtime_api.h>
+#include <stdint.h>
+
+// Capacity of the candidates of one image after the confidence filter, the extra candidates are dropped
+constexpr int kMaxGpuCandidates = 4096;
+constexpr int kMaxGpuAnchors = 16;
+// Classes with the own thresholds of the decoding, the next classes have probThresh
+constexpr int kMaxGpuClasses = 256;
+
+// Box in the coordinates of the image
+struct GpuBBox
+{
+	float x1;
+	float y1;
+	float x2;
+	float y2;
+	float prob;
+	int label;
+};
+
+// One output tensor of YOLOv3, YOLOv4 and YOLOv5 for one image
+struct YoloDecodeParams
+{
+	int gridH = 0;
+	int gridW = 0;
+	int numBBoxes = 0;
+	int numClasses = 0;
+	float strideH = 0;
+	float strideW = 0;
+	float anchors[2 * kMaxGpuAnchors];  // Width and height of the every box of the tensor
+	float netW = 0;
+	float netH = 0;
+	float imageW = 0;
+	float imageH = 0;
+	int letterbox = 0;                  // Boxes are undone from the letterbox of yolov5
+	float scaleH = 1;
+	float scaleW = 1;
+	float xOffset = 0;
+	float yOffset = 0;
+	float probThresh = 0;               // Minimal threshold, boxes with the lower objectness are skipped without the classes
+	int useClassThresh = 0;
+	float classThresh[kMaxGpuClasses];  // Thresholds of the classes, the classes over 1 are out of the white list
+};
+
+// Appends boxes with the probability over the threshold to the candidates of the image
+cudaError_t cudaDecodeYolo(const void* input, const YoloDecodeParams& params, void* candidates, int* count, cudaStream_t stream);
+
+// Class-aware NMS of the candidates of every image, counts are pairs (candidates, results) of the every image.
+// Only topK best candidates are suppressed if topK > 0
+cudaError_t cudaNmsYolo(const void* candidates, int* counts, void* results, const uint32_t batchSize,
+	const float nmsThresh, const bool diou, const int topK, cudaStream_t stream);
+
+#endif
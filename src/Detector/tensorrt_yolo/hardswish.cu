@@ -7,6 +7,7 @@
 #include <cuda.h>
 #include <stdint.h>
 #include <string.h>
+#include <cuda_fp16.h>
 //my
 #include "hardswish.h"
 
@@ -34,6 +35,9 @@ namespace nvinfer1
 		const char *d = reinterpret_cast<const char*>(data), *a = d;
 		r(d, _n_max_thread_pre_block);
 		r(d, _n_output_size);
+		// FP16 engines have the data type after the size
+		if (d < a + length)
+			r(d, _data_type);
 		assert(d == a + length);
 	}
 
@@ -58,15 +62,30 @@ namespace nvinfer1
 		}
 	}
 
+	__global__ void kernel_hardswish_half(const __half *input_, __half *output_, int n_data_size_)
+	{
+		int i = threadIdx.x + blockIdx.x * blockDim.x;
+		if (i >= n_data_size_)return;
+		const float x = __half2float(input_[i]);
+		output_[i] = __float2half(x * fminf(fmaxf(x + 3.0f, 0.0f), 6.0f) / 6.0f);
+	}
+
 	cudaError_t cuda_hardswish_layer(const void* input_,
 		void* output_,
 		const int n_batch_size_,
 		const int n_output_size_,
 		const int threads_,
+		const DataType data_type_,
 		cudaStream_t stream_)
 	{
 		int n_data_size = n_batch_size_ * n_output_size_;
-		kernel_hardswish << <(n_data_size + threads_ -1)/threads_, threads_ >> >(
+		if (data_type_ == DataType::kHALF)
+			kernel_hardswish_half << <(n_data_size + threads_ - 1) / threads_, threads_, 0, stream_ >> >(
+				reinterpret_cast<const __half*>(input_),
+				reinterpret_cast<__half*>(output_),
+				n_data_size);
+		else
+			kernel_hardswish << <(n_data_size + threads_ -1)/threads_, threads_, 0, stream_ >> >(
 				reinterpret_cast<const float*>(input_),
 				reinterpret_cast<float*>(output_),
 				n_data_size);
@@ -77,13 +96,13 @@ namespace nvinfer1
 		cudaStream_t stream)
 	{
 		//printf("batch_size:%d,output_size:%d,threads:%d\n", batchSize, _n_output_size, _n_max_thread_pre_block);
-		NV_CUDA_CHECK(cuda_hardswish_layer(inputs[0], outputs[0], batchSize, _n_output_size , _n_max_thread_pre_block,stream));
+		NV_CUDA_CHECK(cuda_hardswish_layer(inputs[0], outputs[0], batchSize, _n_output_size , _n_max_thread_pre_block, _data_type, stream));
 		return 0;
 	}
 
 	size_t Hardswish::getSerializationSize() const
 	{
-		return sizeof(_n_max_thread_pre_block) +sizeof(_n_output_size);
+		return sizeof(_n_max_thread_pre_block) +sizeof(_n_output_size) + sizeof(_data_type);
 	}
 
 	void Hardswish::serialize(void *buffer) const
@@ -91,6 +110,7 @@ namespace nvinfer1
 		char *d = static_cast<char*>(buffer), *a = d;
 		w(d, _n_max_thread_pre_block);
 		w(d, _n_output_size);
+		w(d, _data_type);
 		assert(d == a + getSerializationSize());
 	}
 
@@ -98,6 +118,7 @@ namespace nvinfer1
 	{
 		
 		_n_output_size = in->dims.d[0] * in->dims.d[1] * in->dims.d[2];
+		_data_type = in->type;
 	//	printf("output_size:%d,threads:%d\n", _n_output_size, _n_max_thread_pre_block);
 	}
 	IPluginV2IOExt* Hardswish::clone() const
@@ -106,6 +127,7 @@ namespace nvinfer1
 		p->setPluginNamespace(_s_plugin_namespace.c_str());
 		p->_n_max_thread_pre_block = _n_max_thread_pre_block;
 		p->_n_output_size = _n_output_size;
+		p->_data_type = _data_type;
 		return p;
 	}
 
@@ -70,9 +70,9 @@ namespace nvinfer1
 		{
 			return _s_plugin_namespace.c_str();
 		}
-        DataType getOutputDataType(int /*index*/, const nvinfer1::DataType* /*inputTypes*/, int /*nbInputs*/) const override
+        DataType getOutputDataType(int /*index*/, const nvinfer1::DataType* inputTypes, int /*nbInputs*/) const override
 		{
-			return DataType::kFLOAT;
+			return inputTypes[0];
 		}
         bool isOutputBroadcastAcrossBatch(int /*outputIndex*/, const bool* /*inputIsBroadcasted*/, int /*nbInputs*/) const override
 		{
@@ -90,11 +90,15 @@ namespace nvinfer1
 		{}
         bool supportsFormatCombination(int pos, const PluginTensorDesc* inOut, int /*nbInputs*/, int /*nbOutputs*/) const override
 		{
-			return inOut[pos].format == TensorFormat::kLINEAR && inOut[pos].type == DataType::kFLOAT;
+			return inOut[pos].format == TensorFormat::kLINEAR &&
+				(inOut[pos].type == DataType::kFLOAT || inOut[pos].type == DataType::kHALF) &&
+				inOut[pos].type == inOut[0].type;
 		}
 		IPluginV2IOExt* clone() const override;
 	private:
 
+		DataType _data_type = DataType::kFLOAT;
+
 		uint32_t _n_max_thread_pre_block;
 		uint32_t _n_output_size;
 		std::string _s_plugin_namespace;
@@ -2,6 +2,7 @@
 #include <stdio.h>
 #include <cassert>
 #include <iostream>
+#include <cuda_fp16.h>
 #include "mish.h"
 
 namespace nvinfer1
@@ -17,18 +18,22 @@ namespace nvinfer1
     // create the plugin at runtime from a byte stream
     MishPlugin::MishPlugin(const void* data, size_t length)
     {
-        assert(length == sizeof(input_size_));
-        input_size_ = *reinterpret_cast<const int*>(data);
+        // The engines of the previous versions have only the size and FP32
+        assert(length == sizeof(input_size_) || length == sizeof(input_size_) + sizeof(int));
+        input_size_ = reinterpret_cast<const int*>(data)[0];
+        if (length > sizeof(input_size_))
+            data_type_ = static_cast<DataType>(reinterpret_cast<const int*>(data)[1]);
     }
 
     void MishPlugin::serialize(void* buffer) const
     {
-        *reinterpret_cast<int*>(buffer) = input_size_;
+        reinterpret_cast<int*>(buffer)[0] = input_size_;
+        reinterpret_cast<int*>(buffer)[1] = static_cast<int>(data_type_);
     }
 
     size_t MishPlugin::getSerializationSize() const
     {  
-        return sizeof(input_size_);
+        return sizeof(input_size_) + sizeof(int);
     }
 
     int MishPlugin::initialize()
@@ -59,7 +64,7 @@ namespace nvinfer1
     // Return the DataType of the plugin output at the requested index
     DataType MishPlugin::getOutputDataType(int index, const nvinfer1::DataType* inputTypes, int nbInputs) const
     {
-        return DataType::kFLOAT;
+        return inputTypes[0];
     }
 
     // Return true if output tensor is broadcast across a batch.
@@ -76,6 +81,7 @@ namespace nvinfer1
 
     void MishPlugin::configurePlugin(const PluginTensorDesc* in, int nbInput, const PluginTensorDesc* out, int nbOutput)
     {
+        data_type_ = in[0].type;
     }
 
     // Attach the plugin object to an execution context and grant the plugin the access to some context resource.
@@ -106,6 +112,7 @@ namespace nvinfer1
     {
         MishPlugin *p = new MishPlugin();
         p->input_size_ = input_size_;
+        p->data_type_ = data_type_;
         p->setPluginNamespace(mPluginNamespace);
         return p;
     }
@@ -135,10 +142,39 @@ namespace nvinfer1
         output[idx] = input[idx] * tanh_activate_kernel(softplus_kernel(input[idx]));
     }
 
-    void MishPlugin::forwardGpu(const float *const * inputs, float* output, cudaStream_t stream, int batchSize) {
+    // Half precision in the memory, the activation is calculated in FP32: two values per thread
+    __global__ void mish_kernel_half(const __half2 *input, __half2 *output, int num_elem2) {
+
+        int idx = threadIdx.x + blockDim.x * blockIdx.x;
+        if (idx >= num_elem2) return;
+
+        const float2 x = __half22float2(input[idx]);
+        output[idx] = __floats2half2_rn(x.x * tanh_activate_kernel(softplus_kernel(x.x)),
+                                        x.y * tanh_activate_kernel(softplus_kernel(x.y)));
+    }
+
+    __global__ void mish_kernel_half_tail(const __half *input, __half *output, int ind) {
+        const float x = __half2float(input[ind]);
+        output[ind] = __float2half(x * tanh_activate_kernel(softplus_kernel(x)));
+    }
+
+    void MishPlugin::forwardGpu(const void *const * inputs, void* output, cudaStream_t stream, int batchSize) {
         int block_size = thread_count_;
-        int grid_size = (input_size_ * batchSize + block_size - 1) / block_size;
-        mish_kernel<<<grid_size, block_size>>>(inputs[0], output, input_size_ * batchSize);
+        const int num_elem = input_size_ * batchSize;
+        if (data_type_ == DataType::kHALF)
+        {
+            const int num_elem2 = num_elem / 2;
+            int grid_size = (num_elem2 + block_size - 1) / block_size;
+            if (num_elem2)
+                mish_kernel_half<<<grid_size, block_size, 0, stream>>>(reinterpret_cast<const __half2*>(inputs[0]), reinterpret_cast<__half2*>(output), num_elem2);
+            if (num_elem % 2)
+                mish_kernel_half_tail<<<1, 1, 0, stream>>>(reinterpret_cast<const __half*>(inputs[0]), reinterpret_cast<__half*>(output), num_elem - 1);
+        }
+        else
+        {
+            int grid_size = (num_elem + block_size - 1) / block_size;
+            mish_kernel<<<grid_size, block_size, 0, stream>>>(reinterpret_cast<const float*>(inputs[0]), reinterpret_cast<float*>(output), num_elem);
+        }
     }
 
     int MishPlugin::enqueue(int batchSize, const void*const * inputs, void** outputs, void* workspace, cudaStream_t stream)
@@ -146,7 +182,7 @@ namespace nvinfer1
         //assert(batchSize == 1);
         //GPU
         //CUDA_CHECK(cudaStreamSynchronize(stream));
-        forwardGpu((const float *const *)inputs, (float*)outputs[0], stream, batchSize);
+        forwardGpu(inputs, outputs[0], stream, batchSize);
         return 0;
     }
 
@@ -36,8 +36,11 @@ namespace nvinfer1
 
             virtual void serialize(void* buffer) const override;
 
+            // FP32 or FP16, the output has the type of the input: the half precision engine doesn't reformat around the plugin
             bool supportsFormatCombination(int pos, const PluginTensorDesc* inOut, int /*nbInputs*/, int /*nbOutputs*/) const override {
-                return inOut[pos].format == TensorFormat::kLINEAR && inOut[pos].type == DataType::kFLOAT;
+                return inOut[pos].format == TensorFormat::kLINEAR &&
+                    (inOut[pos].type == DataType::kFLOAT || inOut[pos].type == DataType::kHALF) &&
+                    inOut[pos].type == inOut[0].type;
             }
 
             const char* getPluginType() const override;
@@ -67,7 +70,8 @@ namespace nvinfer1
 
             int input_size_;
         private:
-            void forwardGpu(const float *const * inputs, float* output, cudaStream_t stream, int batchSize = 1);
+            void forwardGpu(const void *const * inputs, void* output, cudaStream_t stream, int batchSize = 1);
+            DataType data_type_ = DataType::kFLOAT;
             int thread_count_ = 256;
             const char* mPluginNamespace;
     };
@@ -50,6 +50,12 @@ cudaError_t cudaYoloLayerV3(const void* input, void* output, const uint32_t& bat
 	const uint32_t& numOutputClasses, const uint32_t& numBBoxes,
 	uint64_t outputSize, cudaStream_t stream);
 
+// BGR (srcChannels = 3) or BGRA (4, NVDEC) source frame in the device memory
+cudaError_t cudaLetterboxBGR2CHW(const void* src, const int srcW, const int srcH, const size_t srcPitch, const int srcChannels,
+	void* dst, const int dstW, const int dstH,
+	const int resizeW, const int resizeH, const int xOffset, const int yOffset,
+	const float padValue, const float scale, cudaStream_t stream);
+
 class PluginFactory : public nvinfer1::IPluginFactory
 {
 
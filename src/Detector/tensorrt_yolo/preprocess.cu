@@ -0,0 +1,74 @@
+#include <cuda.h>
+#include <cuda_runtime.h>
+#include <stdint.h>
+
+// Letterbox resize, BGR to RGB and HWC to CHW in one pass: every thread writes three planes of one pixel of the network input
+__global__ void gpuLetterboxBGR2CHW(const unsigned char* src, const int srcW, const int srcH, const size_t srcPitch, const int srcChannels,
+                                    float* dst, const int dstW, const int dstH,
+                                    const int resizeW, const int resizeH, const int xOffset, const int yOffset,
+                                    const float padValue, const float scale)
+{
+    const int x = blockIdx.x * blockDim.x + threadIdx.x;
+    const int y = blockIdx.y * blockDim.y + threadIdx.y;
+    if (x >= dstW || y >= dstH)
+        return;
+
+    const int planeSize = dstW * dstH;
+    float* dstPixel = dst + y * dstW + x;
+
+    const int rx = x - xOffset;
+    const int ry = y - yOffset;
+    if (rx < 0 || ry < 0 || rx >= resizeW || ry >= resizeH)
+    {
+        dstPixel[0] = padValue;
+        dstPixel[planeSize] = padValue;
+        dstPixel[2 * planeSize] = padValue;
+        return;
+    }
+
+    // Bilinear interpolation with the pixel centers like cv::INTER_LINEAR
+    float sx = (rx + 0.5f) * (static_cast<float>(srcW) / resizeW) - 0.5f;
+    float sy = (ry + 0.5f) * (static_cast<float>(srcH) / resizeH) - 0.5f;
+    sx = fminf(fmaxf(sx, 0.f), static_cast<float>(srcW - 1));
+    sy = fminf(fmaxf(sy, 0.f), static_cast<float>(srcH - 1));
+    const int x0 = static_cast<int>(sx);
+    const int y0 = static_cast<int>(sy);
+    const int x1 = min(x0 + 1, srcW - 1);
+    const int y1 = min(y0 + 1, srcH - 1);
+    const float ax = sx - x0;
+    const float ay = sy - y0;
+
+    const unsigned char* row0 = src + y0 * srcPitch;
+    const unsigned char* row1 = src + y1 * srcPitch;
+    const unsigned char* p00 = row0 + srcChannels * x0;
+    const unsigned char* p01 = row0 + srcChannels * x1;
+    const unsigned char* p10 = row1 + srcChannels * x0;
+    const unsigned char* p11 = row1 + srcChannels * x1;
+
+    const float w00 = (1.f - ax) * (1.f - ay);
+    const float w01 = ax * (1.f - ay);
+    const float w10 = (1.f - ax) * ay;
+    const float w11 = ax * ay;
+
+    // The input of the network is RGB
+    for (int c = 0; c < 3; ++c)
+    {
+        const float val = w00 * p00[c] + w01 * p01[c] + w10 * p10[c] + w11 * p11[c];
+        dstPixel[(2 - c) * planeSize] = scale * val;
+    }
+}
+
+cudaError_t cudaLetterboxBGR2CHW(const void* src, const int srcW, const int srcH, const size_t srcPitch, const int srcChannels,
+                                 void* dst, const int dstW, const int dstH,
+                                 const int resizeW, const int resizeH, const int xOffset, const int yOffset,
+                                 const float padValue, const float scale, cudaStream_t stream)
+{
+    dim3 threads_per_block(32, 8);
+    dim3 number_of_blocks((dstW + threads_per_block.x - 1) / threads_per_block.x,
+                          (dstH + threads_per_block.y - 1) / threads_per_block.y);
+    gpuLetterboxBGR2CHW<<<number_of_blocks, threads_per_block, 0, stream>>>(
+        reinterpret_cast<const unsigned char*>(src), srcW, srcH, srcPitch, srcChannels,
+        reinterpret_cast<float*>(dst), dstW, dstH,
+        resizeW, resizeH, xOffset, yOffset, padValue, scale);
+    return cudaGetLastError();
+}
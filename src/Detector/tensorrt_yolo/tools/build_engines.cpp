@@ -0,0 +1,134 @@
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <sstream>
+#include <opencv2/opencv.hpp>
+#include "../class_detector.h"
+
+// Offline building of the engines of the model for the several batch sizes and precisions: the builds run in parallel
+// and share the timing cache of the GPU, the detectors with the same configs load the cached engines
+
+const char* keys =
+{
+    "{ c config         |                    | Config file of neural network: yolov4.cfg | }"
+    "{ w weights        |                    | Weights of neural network: yolov4.weights | }"
+    "{ t net_type       |YOLOV4              | YOLOV2, YOLOV3, YOLOV2_TINY, YOLOV3_TINY, YOLOV4, YOLOV4_TINY or YOLOV5 | }"
+    "{ p precisions     |FP16                | Comma separated precisions of the engines: FP32, FP16, INT8 | }"
+    "{ bs batch_sizes   |1                   | Comma separated batch sizes of the engines | }"
+    "{ i images         |                    | Text file with the list of the calibration images for INT8 | }"
+    "{ j jobs           |2                   | Parallel builds | }"
+    "{ g gpu            |0                   | GPU id | }"
+};
+
+///
+/// \brief SplitList
+/// \param str
+/// \return Not empty items of the comma separated list
+///
+std::vector<std::string> SplitList(const std::string& str)
+{
+    std::vector<std::string> items;
+    std::stringstream ss(str);
+    std::string item;
+    while (std::getline(ss, item, ','))
+    {
+        item.erase(0, item.find_first_not_of(" \t"));
+        item.erase(item.find_last_not_of(" \t") + 1);
+        if (!item.empty())
+            items.emplace_back(item);
+    }
+    return items;
+}
+
+int main(int argc, char** argv)
+{
+    cv::CommandLineParser parser(argc, argv, keys);
+    parser.about("Building of the YOLO TensorRT engines");
+
+    tensor_rt::Config baseConfig;
+    baseConfig.file_model_cfg = parser.get<std::string>("config");
+    baseConfig.file_model_weights = parser.get<std::string>("weights");
+    baseConfig.calibration_image_list_file_txt = parser.get<std::string>("images");
+    baseConfig.gpu_id = std::max(0, parser.get<int>("gpu"));
+    const size_t jobs = static_cast<size_t>(std::max(1, parser.get<int>("jobs")));
+
+    std::map<std::string, tensor_rt::ModelType> dictNetType;
+    dictNetType["YOLOV2"] = tensor_rt::YOLOV2;
+    dictNetType["YOLOV3"] = tensor_rt::YOLOV3;
+    dictNetType["YOLOV2_TINY"] = tensor_rt::YOLOV2_TINY;
+    dictNetType["YOLOV3_TINY"] = tensor_rt::YOLOV3_TINY;
+    dictNetType["YOLOV4"] = tensor_rt::YOLOV4;
+    dictNetType["YOLOV4_TINY"] = tensor_rt::YOLOV4_TINY;
+    dictNetType["YOLOV5"] = tensor_rt::YOLOV5;
+    auto netType = dictNetType.find(parser.get<std::string>("net_type"));
+
+    std::map<std::string, tensor_rt::Precision> dictPrecision;
+    dictPrecision["FP32"] = tensor_rt::FP32;
+    dictPrecision["FP16"] = tensor_rt::FP16;
+    dictPrecision["INT8"] = tensor_rt::INT8;
+
+    // The all combinations of the precisions and the batch sizes
+    std::vector<tensor_rt::Config> configs;
+    std::vector<std::string> names;
+    bool validLists = true;
+    for (const auto& precisionName : SplitList(parser.get<std::string>("precisions")))
+    {
+        auto precision = dictPrecision.find(precisionName);
+        if (precision == dictPrecision.end())
+        {
+            std::cerr << "Unknown precision " << precisionName << std::endl;
+            validLists = false;
+            continue;
+        }
+        for (const auto& batchSize : SplitList(parser.get<std::string>("batch_sizes")))
+        {
+            tensor_rt::Config config = baseConfig;
+            config.inference_precison = precision->second;
+            config.batch_size = static_cast<uint32_t>(std::max(1, atoi(batchSize.c_str())));
+            config.int8_calibration = (precision->second == tensor_rt::INT8);
+            configs.emplace_back(config);
+            names.emplace_back(precisionName + ", batch size " + std::to_string(config.batch_size));
+        }
+    }
+
+    if (!parser.check() || baseConfig.file_model_cfg.empty() || baseConfig.file_model_weights.empty() ||
+            netType == dictNetType.end() || !validLists || configs.empty())
+    {
+        parser.printErrors();
+        parser.printMessage();
+        return 1;
+    }
+    for (auto& config : configs)
+    {
+        config.net_type = netType->second;
+    }
+
+    // Every job takes the next config: the short builds don't wait for the long ones
+    std::atomic<size_t> nextConfig { 0 };
+    std::mutex outMutex;
+    auto BuildEngines = [&]()
+    {
+        for (size_t i = nextConfig++; i < configs.size(); i = nextConfig++)
+        {
+            {
+                std::lock_guard<std::mutex> lock(outMutex);
+                std::cout << "Building the engine " << (i + 1) << " of " << configs.size() << ": " << names[i] << std::endl;
+            }
+            tensor_rt::Detector detector;
+            detector.init(configs[i]);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < std::min(jobs, configs.size()); ++i)
+    {
+        threads.emplace_back(BuildEngines);
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    std::cout << "Building is finished: " << configs.size() << " engines" << std::endl;
+    return 0;
+}
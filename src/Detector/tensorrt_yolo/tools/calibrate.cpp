@@ -0,0 +1,55 @@
+#include <map>
+#include <opencv2/opencv.hpp>
+#include "../class_detector.h"
+
+// Offline INT8 calibration: creates the calibration table of the images list and the INT8 engine,
+// the detector with the same config and int8_calibration = false loads them without the calibration
+
+const char* keys =
+{
+    "{ c config         |                    | Config file of neural network: yolov4.cfg | }"
+    "{ w weights        |                    | Weights of neural network: yolov4.weights | }"
+    "{ t net_type       |YOLOV4              | YOLOV2, YOLOV3, YOLOV2_TINY, YOLOV3_TINY, YOLOV4, YOLOV4_TINY or YOLOV5 | }"
+    "{ i images         |                    | Text file with the list of the calibration images | }"
+    "{ bs batch_size    |1                   | Batch size of the engine | }"
+    "{ g gpu            |0                   | GPU id | }"
+};
+
+int main(int argc, char** argv)
+{
+    cv::CommandLineParser parser(argc, argv, keys);
+    parser.about("INT8 calibration of the YOLO TensorRT engine");
+
+    tensor_rt::Config config;
+    config.file_model_cfg = parser.get<std::string>("config");
+    config.file_model_weights = parser.get<std::string>("weights");
+    config.calibration_image_list_file_txt = parser.get<std::string>("images");
+    config.batch_size = static_cast<uint32_t>(std::max(1, parser.get<int>("batch_size")));
+    config.gpu_id = std::max(0, parser.get<int>("gpu"));
+    config.inference_precison = tensor_rt::INT8;
+    config.int8_calibration = true;
+
+    std::map<std::string, tensor_rt::ModelType> dictNetType;
+    dictNetType["YOLOV2"] = tensor_rt::YOLOV2;
+    dictNetType["YOLOV3"] = tensor_rt::YOLOV3;
+    dictNetType["YOLOV2_TINY"] = tensor_rt::YOLOV2_TINY;
+    dictNetType["YOLOV3_TINY"] = tensor_rt::YOLOV3_TINY;
+    dictNetType["YOLOV4"] = tensor_rt::YOLOV4;
+    dictNetType["YOLOV4_TINY"] = tensor_rt::YOLOV4_TINY;
+    dictNetType["YOLOV5"] = tensor_rt::YOLOV5;
+    auto netType = dictNetType.find(parser.get<std::string>("net_type"));
+
+    if (!parser.check() || config.file_model_cfg.empty() || config.file_model_weights.empty() ||
+            config.calibration_image_list_file_txt.empty() || netType == dictNetType.end())
+    {
+        parser.printErrors();
+        parser.printMessage();
+        return 1;
+    }
+    config.net_type = netType->second;
+
+    tensor_rt::Detector detector;
+    detector.init(config);
+    std::cout << "Calibration is finished" << std::endl;
+    return 0;
+}
@@ -24,6 +24,7 @@ SOFTWARE.
 */
 
 #include "trt_utils.h"
+#include "mapped_file.h"
 #include <NvInferRuntimeCommon.h>
 
 #ifdef HAVE_FILESYSTEM
@@ -36,6 +37,9 @@ namespace fs = std::experimental::filesystem;
 
 #include <fstream>
 #include <iomanip>
+#include <future>
+#include <mutex>
+#include <thread>
 using namespace nvinfer1;
 REGISTER_TENSORRT_PLUGIN(MishPluginCreator);
 REGISTER_TENSORRT_PLUGIN(ChunkPluginCreator);
@@ -328,11 +332,25 @@ std::vector<BBoxInfo> nonMaximumSuppression(const float nmsThresh, std::vector<B
 }
 
 nvinfer1::ICudaEngine* loadTRTEngine(const std::string planFilePath, PluginFactory* pluginFactory,
-                                     Logger& logger)
+                                     Logger& logger, int dlaCore)
 {
-    // reading the model in memory
     std::cout << "Loading TRT Engine..." << std::endl;
     assert(fileExists(planFilePath));
+
+    nvinfer1::IRuntime* runtime = nvinfer1::createInferRuntime(logger);
+    if (dlaCore >= 0)
+        runtime->setDLACore(dlaCore);
+
+    // The engine is deserialized from the shared read only mapping: the plan isn't copied to the heap of the every process
+    if (auto plan = MappedFile::Open(planFilePath))
+    {
+        nvinfer1::ICudaEngine* engine = runtime->deserializeCudaEngine(plan->Data(), plan->Bytes(), pluginFactory);
+        runtime->destroy();
+        std::cout << "Loading Complete!" << std::endl;
+        return engine;
+    }
+
+    // reading the model in memory
     std::stringstream trtModelStream;
     trtModelStream.seekg(0, trtModelStream.beg);
     std::ifstream cache(planFilePath,std::ios::binary | std::ios::in);
@@ -347,7 +365,6 @@ nvinfer1::ICudaEngine* loadTRTEngine(const std::string planFilePath, PluginFacto
     void* modelMem = malloc(modelSize);
     trtModelStream.read((char*) modelMem, modelSize);
 
-    nvinfer1::IRuntime* runtime = nvinfer1::createInferRuntime(logger);
     nvinfer1::ICudaEngine* engine
         = runtime->deserializeCudaEngine(modelMem, modelSize, pluginFactory);
     free(modelMem);
@@ -665,12 +682,28 @@ nvinfer1::ILayer* net_conv_bn_mish(int layerIdx,
 	bn->setName(bnLayerName.c_str());
 	/***** ACTIVATION LAYER *****/
 	/****************************/
+#if NV_TENSORRT_MAJOR >= 8
+	// mish(x) = x * tanh(softplus(x)) from the native layers: the builder fuses them to one pointwise kernel in any precision
+	auto softplus = network->addActivation(*bn->getOutput(0), nvinfer1::ActivationType::kSOFTPLUS);
+	assert(softplus != nullptr);
+	softplus->setAlpha(1.f);
+	softplus->setBeta(1.f);
+	softplus->setName(("softplus_" + std::to_string(layerIdx)).c_str());
+	auto tanhAct = network->addActivation(*softplus->getOutput(0), nvinfer1::ActivationType::kTANH);
+	assert(tanhAct != nullptr);
+	tanhAct->setName(("tanh_" + std::to_string(layerIdx)).c_str());
+	auto mish = network->addElementWise(*bn->getOutput(0), *tanhAct->getOutput(0), nvinfer1::ElementWiseOperation::kPROD);
+	assert(mish != nullptr);
+	mish->setName(("mish_" + std::to_string(layerIdx)).c_str());
+	return mish;
+#else
 	auto creator = getPluginRegistry()->getPluginCreator("Mish_TRT", "1");
 	const nvinfer1::PluginFieldCollection* pluginData = creator->getFieldNames();
 	nvinfer1::IPluginV2 *pluginObj = creator->createPlugin(("mish" + std::to_string(layerIdx)).c_str(), pluginData);
 	nvinfer1::ITensor* inputTensors[] = { bn->getOutput(0) };
 	auto mish = network->addPluginV2(&inputTensors[0], 1, *pluginObj);
 	return mish;
+#endif
 }
 
 nvinfer1::ILayer * layer_split(const int n_layer_index_,
@@ -823,8 +856,12 @@ nvinfer1::ILayer * layer_act(nvinfer1::ITensor* input_,
 	}
 	else if (s_act_ == "hardswish")
 	{
-		nvinfer1::IPluginV2 *hardswish_plugin = new nvinfer1::Hardswish();
-		auto act = network_->addPluginV2(&input_, 1, *hardswish_plugin);
+		// hardswish(x) = x * clip(x / 6 + 1 / 2, 0, 1): the native layers as for silu instead of the plugin
+		auto hsig = network_->addActivation(*input_, nvinfer1::ActivationType::kHARD_SIGMOID);
+		assert(hsig != nullptr);
+		hsig->setAlpha(1.f / 6.f);
+		hsig->setBeta(0.5f);
+		auto act = network_->addElementWise(*input_, *hsig->getOutput(0), ElementWiseOperation::kPROD);
 		assert(act != nullptr);
 		return act;
 	}
@@ -1330,3 +1367,292 @@ void printLayerInfo(std::string layerIndex, std::string layerName, std::string l
               << layerOutput;
     std::cout << std::setw(6) << std::left << weightPtr << std::endl;
 }
+
+// FNV-1a of the file content
+static uint64_t hashFile(const std::string& filePath, uint64_t hash)
+{
+    std::ifstream file(filePath, std::ios::binary | std::ios::in);
+    std::vector<char> buffer(1 << 20);
+    while (file)
+    {
+        file.read(buffer.data(), buffer.size());
+        const std::streamsize readed = file.gcount();
+        for (std::streamsize i = 0; i < readed; ++i)
+        {
+            hash ^= static_cast<unsigned char>(buffer[i]);
+            hash *= 1099511628211ull;
+        }
+    }
+    return hash;
+}
+
+std::string getEngineCachePath(const std::string& dataPath, const std::string& cfgFilePath,
+                               const std::string& wtsFilePath, const std::string& precision,
+                               const uint32_t batchSize, const std::string& calibTablePath)
+{
+    // Hashes of the models are calculated once for the file with the same size and time, the concurrent callers wait for it
+    static std::mutex hashesMutex;
+    static std::map<std::string, std::shared_future<uint64_t>> hashes;
+
+    std::string fileStamps;
+    for (const auto& filePath : { cfgFilePath, wtsFilePath })
+    {
+        fileStamps += filePath + ":";
+        if (fileExists(filePath, false))
+            fileStamps += std::to_string(fs::file_size(fs::path(filePath))) + ":" +
+                std::to_string(fs::last_write_time(fs::path(filePath)).time_since_epoch().count()) + ";";
+    }
+    std::shared_future<uint64_t> hashFuture;
+    {
+        std::lock_guard<std::mutex> lock(hashesMutex);
+        auto it = hashes.find(fileStamps);
+        if (it == std::end(hashes))
+            it = hashes.emplace(fileStamps, std::async(std::launch::deferred, [cfgFilePath, wtsFilePath]()
+            {
+                return hashFile(wtsFilePath, hashFile(cfgFilePath, 14695981039346656037ull));
+            }).share()).first;
+        hashFuture = it->second;
+    }
+    uint64_t modelHash = hashFuture.get();
+    for (const char c : calibTablePath)
+    {
+        modelHash ^= static_cast<unsigned char>(c);
+        modelHash *= 1099511628211ull;
+    }
+
+    // Engine is valid only for the GPU architecture and the version of TensorRT
+    int device = 0;
+    cudaDeviceProp prop;
+    NV_CUDA_CHECK(cudaGetDevice(&device));
+    NV_CUDA_CHECK(cudaGetDeviceProperties(&prop, device));
+
+    std::stringstream path;
+    path << dataPath << "-" << precision << "-batch" << batchSize
+         << "-sm" << prop.major << prop.minor
+         << "-trt" << NV_TENSORRT_MAJOR << "." << NV_TENSORRT_MINOR << "." << NV_TENSORRT_PATCH
+         << "-" << std::hex << std::setw(16) << std::setfill('0') << modelHash << ".engine";
+    return path.str();
+}
+
+std::string getCalibrationTablePath(const std::string& dataPath, const std::string& calibImagesList)
+{
+    if (calibImagesList.empty() || !fileExists(calibImagesList, false))
+        return dataPath + "-calibration.table";
+
+    std::stringstream path;
+    path << dataPath << "-" << fs::path(calibImagesList).stem().string()
+         << "-" << std::hex << std::setw(16) << std::setfill('0') << hashFile(calibImagesList, 14695981039346656037ull)
+         << "-calibration.table";
+    return path.str();
+}
+
+bool writePlanFile(const std::string planFilePath, const void* data, const size_t size)
+{
+    // Other processes see the complete engine or nothing
+    const std::string tmpPath = planFilePath + ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    {
+        std::ofstream outFile(tmpPath, std::ios::binary | std::ios::out);
+        outFile.write(static_cast<const char*>(data), size);
+        if (!outFile.good())
+        {
+            std::cout << "Can't write the plan file " << tmpPath << std::endl;
+            outFile.close();
+            std::remove(tmpPath.c_str());
+            return false;
+        }
+    }
+    std::error_code ec;
+    fs::rename(fs::path(tmpPath), fs::path(planFilePath), ec);
+    if (ec)
+    {
+        // rename doesn't replace the existing file on Windows
+        fs::remove(fs::path(planFilePath), ec);
+        fs::rename(fs::path(tmpPath), fs::path(planFilePath), ec);
+    }
+    if (ec)
+    {
+        std::cout << "Can't move the plan file to " << planFilePath << ": " << ec.message() << std::endl;
+        fs::remove(fs::path(tmpPath), ec);
+        return false;
+    }
+    return true;
+}
+
+std::string getTimingCachePath(const std::string& enginePath)
+{
+    int device = 0;
+    cudaDeviceProp prop;
+    NV_CUDA_CHECK(cudaGetDevice(&device));
+    NV_CUDA_CHECK(cudaGetDeviceProperties(&prop, device));
+
+    std::stringstream fileName;
+    fileName << "trt-sm" << prop.major << prop.minor
+             << "-trt" << NV_TENSORRT_MAJOR << "." << NV_TENSORRT_MINOR << "." << NV_TENSORRT_PATCH << ".timing.cache";
+    return (fs::path(enginePath).parent_path() / fileName.str()).string();
+}
+
+#if NV_TENSORRT_MAJOR >= 8
+namespace
+{
+    // Builds of the process are merged one by one, other processes replace the file atomically
+    std::mutex timingCacheMutex;
+
+    std::vector<char> readTimingCache(const std::string& cachePath)
+    {
+        std::vector<char> blob;
+        std::ifstream file(cachePath, std::ios::binary | std::ios::ate);
+        if (file.good())
+        {
+            blob.resize(static_cast<size_t>(file.tellg()));
+            file.seekg(0, std::ios::beg);
+            if (!file.read(blob.data(), blob.size()))
+                blob.clear();
+        }
+        return blob;
+    }
+}
+#endif
+
+BuilderTimingCache::BuilderTimingCache(nvinfer1::IBuilderConfig* config, const std::string& cachePath)
+    : m_config(config), m_cachePath(cachePath)
+{
+#if NV_TENSORRT_MAJOR >= 8
+    std::vector<char> blob;
+    {
+        std::lock_guard<std::mutex> lock(timingCacheMutex);
+        blob = readTimingCache(m_cachePath);
+    }
+    if (!blob.empty())
+    {
+        m_cache = m_config->createTimingCache(blob.data(), blob.size());
+        if (m_cache)
+            std::cout << "Using the timing cache " << m_cachePath << std::endl;
+        else
+            std::cout << "Can't load the timing cache " << m_cachePath << ", it will be rebuilt" << std::endl;
+    }
+    if (!m_cache)
+        m_cache = m_config->createTimingCache(nullptr, 0);
+    // The cache of the other version or device is rebuilt, not used
+    if (m_cache && !m_config->setTimingCache(*m_cache, false))
+    {
+        m_cache->destroy();
+        m_cache = nullptr;
+    }
+#endif
+}
+
+BuilderTimingCache::~BuilderTimingCache()
+{
+#if NV_TENSORRT_MAJOR >= 8
+    if (m_cache)
+        m_cache->destroy();
+#endif
+}
+
+bool BuilderTimingCache::save()
+{
+#if NV_TENSORRT_MAJOR >= 8
+    const nvinfer1::ITimingCache* built = m_config->getTimingCache();
+    if (!built)
+        return false;
+
+    std::lock_guard<std::mutex> lock(timingCacheMutex);
+
+    // Timings of the builds finished after the loading
+    nvinfer1::ITimingCache* merged = nullptr;
+    const std::vector<char> blob = readTimingCache(m_cachePath);
+    if (!blob.empty())
+    {
+        merged = m_config->createTimingCache(blob.data(), blob.size());
+        if (merged && !merged->combine(*built, false))
+        {
+            merged->destroy();
+            merged = nullptr;
+        }
+    }
+    nvinfer1::IHostMemory* serialized = merged ? merged->serialize() : built->serialize();
+    if (merged)
+        merged->destroy();
+    if (!serialized)
+        return false;
+
+    const bool res = writePlanFile(m_cachePath, serialized->data(), serialized->size());
+    serialized->destroy();
+    if (res)
+        std::cout << "Timing cache saved to " << m_cachePath << std::endl;
+    return res;
+#else
+    return false;
+#endif
+}
+
+namespace
+{
+    struct PrefetchedEngine
+    {
+        std::string planFilePath;
+        nvinfer1::ICudaEngine* engine = nullptr;
+        PluginFactory* pluginFactory = nullptr;
+    };
+    std::mutex g_prefetchMutex;
+    std::map<std::string, std::shared_future<PrefetchedEngine>> g_prefetched;
+
+    std::string prefetchKey(const std::string& wtsFilePath, const std::string& precision, const uint32_t batchSize, const int gpuId)
+    {
+        return wtsFilePath + "|" + precision + "|" + std::to_string(batchSize) + "|" + std::to_string(gpuId);
+    }
+}
+
+void prefetchTRTEngine(const std::string& dataPath, const std::string& cfgFilePath,
+                       const std::string& wtsFilePath, const std::string& precision,
+                       const uint32_t batchSize, const int gpuId, const std::string& calibTablePath)
+{
+    std::lock_guard<std::mutex> lock(g_prefetchMutex);
+    const std::string key = prefetchKey(wtsFilePath, precision, batchSize, gpuId);
+    if (g_prefetched.find(key) != std::end(g_prefetched))
+        return;
+
+    g_prefetched.emplace(key, std::async(std::launch::async, [=]()
+    {
+        // The current device is the property of the thread
+        NV_CUDA_CHECK(cudaSetDevice(gpuId));
+        PrefetchedEngine res;
+        res.planFilePath = getEngineCachePath(dataPath, cfgFilePath, wtsFilePath, precision, batchSize, calibTablePath);
+        if (fileExists(res.planFilePath, false))
+        {
+            static Logger logger;
+            res.pluginFactory = new PluginFactory;
+            res.engine = loadTRTEngine(res.planFilePath, res.pluginFactory, logger);
+        }
+        return res;
+    }).share());
+}
+
+bool takePrefetchedTRTEngine(const std::string& wtsFilePath, const std::string& precision, const uint32_t batchSize,
+                             const std::string& planFilePath, nvinfer1::ICudaEngine*& engine, PluginFactory*& pluginFactory)
+{
+    int gpuId = 0;
+    NV_CUDA_CHECK(cudaGetDevice(&gpuId));
+
+    std::shared_future<PrefetchedEngine> prefetched;
+    {
+        std::lock_guard<std::mutex> lock(g_prefetchMutex);
+        auto it = g_prefetched.find(prefetchKey(wtsFilePath, precision, batchSize, gpuId));
+        if (it == std::end(g_prefetched))
+            return false;
+        prefetched = it->second;
+        g_prefetched.erase(it);
+    }
+    const PrefetchedEngine& res = prefetched.get();
+    if (!res.engine || res.planFilePath != planFilePath)
+    {
+        if (res.engine)
+            res.engine->destroy();
+        if (res.pluginFactory)
+            res.pluginFactory->destroy();
+        return false;
+    }
+    engine = res.engine;
+    pluginFactory = res.pluginFactory;
+    return true;
+}
@@ -150,8 +150,47 @@ std::vector<BBoxInfo> diou_nms(const float numThresh, std::vector<BBoxInfo> binf
 std::vector<BBoxInfo> nmsAllClasses(const float nmsThresh, std::vector<BBoxInfo>& binfo,
                                     const uint32_t numClasses, const std::string &model_type);
 std::vector<BBoxInfo> nonMaximumSuppression(const float nmsThresh, std::vector<BBoxInfo> binfo);
+// The engine of DLA is deserialized on its core, dlaCore < 0 for GPU
 nvinfer1::ICudaEngine* loadTRTEngine(const std::string planFilePath, PluginFactory* pluginFactory,
-                                     Logger& logger);
+                                     Logger& logger, int dlaCore = -1);
+// Engine of the model for the current GPU, precision, batch size and TensorRT version, INT8 engine also for the calibration table
+std::string getEngineCachePath(const std::string& dataPath, const std::string& cfgFilePath,
+                               const std::string& wtsFilePath, const std::string& precision,
+                               const uint32_t batchSize, const std::string& calibTablePath = std::string());
+// Calibration table of the model for the list of the calibration images: the tables of the different datasets are kept together
+std::string getCalibrationTablePath(const std::string& dataPath, const std::string& calibImagesList);
+// Atomic write: the temporary file is renamed to the plan file
+bool writePlanFile(const std::string planFilePath, const void* data, const size_t size);
+// Timing cache of the builder near the engines: one for the GPU architecture and the version of TensorRT
+std::string getTimingCachePath(const std::string& enginePath);
+
+// Kernel timings of the previous builds for the builder config, the new timings are merged to the file after the build.
+// The cache is shared by the all models, precisions and batch sizes, without TensorRT 8 it does nothing
+class BuilderTimingCache
+{
+public:
+    BuilderTimingCache(nvinfer1::IBuilderConfig* config, const std::string& cachePath);
+    ~BuilderTimingCache();
+
+    BuilderTimingCache(const BuilderTimingCache&) = delete;
+    BuilderTimingCache& operator=(const BuilderTimingCache&) = delete;
+
+    // Merges the cache of the config with the file: the concurrent builds don't overwrite the timings of each other
+    bool save();
+
+private:
+    nvinfer1::IBuilderConfig* m_config = nullptr;
+    std::string m_cachePath;
+#if NV_TENSORRT_MAJOR >= 8
+    nvinfer1::ITimingCache* m_cache = nullptr;
+#endif
+};
+// Hashing of the model and deserialization of the cached engine in the background, takePrefetchedTRTEngine waits for it
+void prefetchTRTEngine(const std::string& dataPath, const std::string& cfgFilePath,
+                       const std::string& wtsFilePath, const std::string& precision,
+                       const uint32_t batchSize, const int gpuId, const std::string& calibTablePath = std::string());
+bool takePrefetchedTRTEngine(const std::string& wtsFilePath, const std::string& precision, const uint32_t batchSize,
+                             const std::string& planFilePath, nvinfer1::ICudaEngine*& engine, PluginFactory*& pluginFactory);
 std::vector<float> loadWeights(const std::string weightsFilePath, const std::string& networkType);
 std::string dimsToString(const nvinfer1::Dims d);
 void displayDimType(const nvinfer1::Dims d);
@@ -16,6 +16,7 @@ Yolo::Yolo( const NetworkInfo& networkInfo, const InferParams& inferParams) :
 	m_LabelsFilePath(networkInfo.labelsFilePath),
 	m_Precision(networkInfo.precision),
 	m_DeviceType(networkInfo.deviceType),
+	m_DlaCore(networkInfo.dlaCore),
 	m_CalibImages(inferParams.calibImages),
 	m_CalibImagesFilePath(inferParams.calibImagesPath),
 	m_CalibTableFilePath(networkInfo.calibrationTablePath),
@@ -26,6 +27,8 @@ Yolo::Yolo( const NetworkInfo& networkInfo, const InferParams& inferParams) :
 	m_InputSize(0),
 	m_ProbThresh(inferParams.probThresh),
 	m_NMSThresh(inferParams.nmsThresh),
+	m_ClassThresh(inferParams.classThresh),
+	m_TopK(inferParams.topK),
 	m_PrintPerfInfo(inferParams.printPerfInfo),
 	m_PrintPredictions(inferParams.printPredictionInfo),
 	m_BatchSize(inferParams.batchSize),
@@ -34,9 +37,7 @@ Yolo::Yolo( const NetworkInfo& networkInfo, const InferParams& inferParams) :
 	m_Builder(nullptr),
 	m_ModelStream(nullptr),
 	m_Engine(nullptr),
-	m_Context(nullptr),
 	m_InputBindingIndex(-1),
-	m_CudaStream(nullptr),
 	m_PluginFactory(new PluginFactory),
 	m_TinyMaxpoolPaddingFormula(new YoloTinyMaxpoolPaddingFormula),
 	_n_yolo_ind(0)
@@ -52,7 +53,18 @@ Yolo::Yolo( const NetworkInfo& networkInfo, const InferParams& inferParams) :
 	{
 		parseConfigBlocks();
 	}
-	m_EnginePath = networkInfo.data_path + "-" + m_Precision + "-batch" + std::to_string(m_BatchSize) + ".engine";
+	m_EnginePath = getEngineCachePath(networkInfo.data_path, m_ConfigFilePath, m_WtsFilePath, m_Precision, m_BatchSize,
+		(m_Precision == "kINT8") ? m_CalibTableFilePath : std::string());
+	if (m_DlaCore >= 0)
+	{
+		// The engine of DLA is built for the core
+		const size_t extPos = m_EnginePath.find_last_of('.');
+		const std::string dlaSuffix = "-dla" + std::to_string(m_DlaCore);
+		if (extPos == std::string::npos)
+			m_EnginePath += dlaSuffix;
+		else
+			m_EnginePath.insert(extPos, dlaSuffix);
+	}
 	if (m_Precision == "kFLOAT")
 	{
 		if ("yolov5" == m_NetworkType)
@@ -65,8 +77,9 @@ Yolo::Yolo( const NetworkInfo& networkInfo, const InferParams& inferParams) :
 			createYOLOEngine();
 		}
 	}
-	else if (m_Precision == "kINT8")
+	else if (m_Precision == "kINT8" && !fileExists(m_EnginePath, false))
 	{
+		// The calibrator reads the images only without the calibration table
 		Int8EntropyCalibrator calibrator(m_BatchSize, m_CalibImages, m_CalibImagesFilePath,
 			m_CalibTableFilePath, m_InputSize, m_InputH, m_InputW,
 			m_InputBlobName, m_NetworkType);
@@ -79,6 +92,10 @@ Yolo::Yolo( const NetworkInfo& networkInfo, const InferParams& inferParams) :
 			createYOLOEngine(nvinfer1::DataType::kINT8, &calibrator);
 		}
 	}
+	else if (m_Precision == "kINT8")
+	{
+		std::cout << "Using previously generated plan file located at " << m_EnginePath << std::endl;
+	}
 	else if (m_Precision == "kHALF")
 	{
 		if ("yolov5" == m_NetworkType)
@@ -97,28 +114,31 @@ Yolo::Yolo( const NetworkInfo& networkInfo, const InferParams& inferParams) :
 	}
 
 	assert(m_PluginFactory != nullptr);
-	m_Engine = loadTRTEngine(m_EnginePath, m_PluginFactory, m_Logger);
+	PluginFactory* prefetchedFactory = nullptr;
+	if (takePrefetchedTRTEngine(m_WtsFilePath, m_Precision, m_BatchSize, m_EnginePath, m_Engine, prefetchedFactory))
+	{
+		m_PluginFactory->destroy();
+		m_PluginFactory = prefetchedFactory;
+	}
+	else
+	{
+		m_Engine = loadTRTEngine(m_EnginePath, m_PluginFactory, m_Logger, m_DlaCore);
+	}
 	assert(m_Engine != nullptr);
-	m_Context = m_Engine->createExecutionContext();
-	assert(m_Context != nullptr);
 	m_InputBindingIndex = m_Engine->getBindingIndex(m_InputBlobName.c_str());
 	assert(m_InputBindingIndex != -1);
 	assert(m_BatchSize <= static_cast<uint32_t>(m_Engine->getMaxBatchSize()));
 	allocateBuffers();
-	NV_CUDA_CHECK(cudaStreamCreate(&m_CudaStream));
 	assert(verifyYoloEngine());
 }
 
 Yolo::~Yolo()
 {
-    for (auto& tensor : m_OutputTensors) NV_CUDA_CHECK(cudaFreeHost(tensor.hostBuffer));
-    for (auto& deviceBuffer : m_DeviceBuffers) NV_CUDA_CHECK(cudaFree(deviceBuffer));
-    NV_CUDA_CHECK(cudaStreamDestroy(m_CudaStream));
-    if (m_Context)
+    for (auto& slot : m_Slots)
     {
-        m_Context->destroy();
-        m_Context = nullptr;
+        if (slot.stream) cudaStreamSynchronize(slot.stream);
     }
+    releaseSlots();
 
     if (m_Engine)
     {
@@ -463,27 +483,15 @@ void Yolo::createYOLOEngine(const nvinfer1::DataType dataType, Int8EntropyCalibr
      //   m_Builder->setHalf2Mode(true);
     }
 
-    m_Builder->allowGPUFallback(true);
-    int nbLayers = m_Network->getNbLayers();
-    int layersOnDLA = 0;
- //   std::cout << "Total number of layers: " << nbLayers << std::endl;
-    for (int i = 0; i < nbLayers; i++)
-    {
-        nvinfer1::ILayer* curLayer = m_Network->getLayer(i);
-        if (m_DeviceType == "kDLA" && m_Builder->canRunOnDLA(curLayer))
-        {
-            m_Builder->setDeviceType(curLayer, nvinfer1::DeviceType::kDLA);
-            layersOnDLA++;
-            std::cout << "Set layer " << curLayer->getName() << " to run on DLA" << std::endl;
-        }
-    }
- //   std::cout << "Total number of layers on DLA: " << layersOnDLA << std::endl;
+    setDeviceConfig(config);
 
     // Build the engine
     std::cout << "Building the TensorRT Engine..." << std::endl;
+    BuilderTimingCache timingCache(config, getTimingCachePath(m_EnginePath));
     m_Engine = m_Builder->buildEngineWithConfig(*m_Network,*config);
     assert(m_Engine != nullptr);
     std::cout << "Building complete!" << std::endl;
+    timingCache.save();
 
     // Serialize the engine
     writePlanFileToDisk();
@@ -492,6 +500,34 @@ void Yolo::createYOLOEngine(const nvinfer1::DataType dataType, Int8EntropyCalibr
     destroyNetworkUtils(trtWeights);
 }
 
+// The layers of the DLA engine which the DLA can't run (the mish and yolo plugins, some activations) fall back to GPU
+void Yolo::setDeviceConfig(nvinfer1::IBuilderConfig* config)
+{
+	if (m_DeviceType != "kDLA" || m_DlaCore < 0)
+		return;
+
+	if (m_Builder->getNbDLACores() <= m_DlaCore)
+	{
+		std::cerr << "DLA core " << m_DlaCore << " isn't available, the engine is built for GPU" << std::endl;
+		return;
+	}
+	config->setDefaultDeviceType(nvinfer1::DeviceType::kDLA);
+	config->setDLACore(m_DlaCore);
+	config->setFlag(nvinfer1::BuilderFlag::kGPU_FALLBACK);
+
+	const int nbLayers = m_Network->getNbLayers();
+	int layersOnDLA = 0;
+	for (int i = 0; i < nbLayers; i++)
+	{
+		nvinfer1::ILayer* curLayer = m_Network->getLayer(i);
+		if (config->canRunOnDLA(curLayer))
+			++layersOnDLA;
+		else
+			config->setDeviceType(curLayer, nvinfer1::DeviceType::kGPU);
+	}
+	std::cout << "DLA core " << m_DlaCore << ": " << layersOnDLA << " of " << nbLayers << " layers, the others on GPU" << std::endl;
+}
+
 int make_division(const float f_in_, const int n_divisor_)
 {
 	return ceil(f_in_ / n_divisor_)*n_divisor_;
@@ -916,27 +952,15 @@ void Yolo::create_engine_yolov5(const nvinfer1::DataType dataType,
 		//   m_Builder->setHalf2Mode(true);
 	}
 
-	m_Builder->allowGPUFallback(true);
-	int nbLayers = m_Network->getNbLayers();
-	int layersOnDLA = 0;
-	//   std::cout << "Total number of layers: " << nbLayers << std::endl;
-	for (int i = 0; i < nbLayers; i++)
-	{
-		nvinfer1::ILayer* curLayer = m_Network->getLayer(i);
-		if (m_DeviceType == "kDLA" && m_Builder->canRunOnDLA(curLayer))
-		{
-			m_Builder->setDeviceType(curLayer, nvinfer1::DeviceType::kDLA);
-			layersOnDLA++;
-			std::cout << "Set layer " << curLayer->getName() << " to run on DLA" << std::endl;
-		}
-	}
-	//   std::cout << "Total number of layers on DLA: " << layersOnDLA << std::endl;
+	setDeviceConfig(config);
 
 	// Build the engine
 	std::cout << "Building the TensorRT Engine..." << std::endl;
+	BuilderTimingCache timingCache(config, getTimingCachePath(m_EnginePath));
 	m_Engine = m_Builder->buildEngineWithConfig(*m_Network, *config);
 	assert(m_Engine != nullptr);
 	std::cout << "Building complete!" << std::endl;
+	timingCache.save();
 
 	// Serialize the engine
 	writePlanFileToDisk();
@@ -970,23 +994,482 @@ void Yolo::load_weights_v5(const std::string s_weights_path_,
 	}
 	std::cout << "Loading complete!" << std::endl;
 }
+void Yolo::setPipelineDepth(uint32_t depth)
+{
+    depth = std::max(1u, depth);
+    for (auto& slot : m_Slots)
+    {
+        if (slot.busy)
+            waitInference(static_cast<int>(&slot - m_Slots.data()));
+    }
+    releaseSlots();
+
+    m_Slots.resize(depth);
+    for (auto& slot : m_Slots)
+    {
+        // Execution contexts of one engine share its weights
+        slot.context = m_Engine->createExecutionContext();
+        assert(slot.context != nullptr);
+        NV_CUDA_CHECK(cudaStreamCreate(&slot.stream));
+
+        slot.deviceBuffers.resize(m_Engine->getNbBindings(), nullptr);
+        NV_CUDA_CHECK(cudaMalloc(&slot.deviceBuffers.at(m_InputBindingIndex),
+                                 m_BatchSize * m_InputSize * sizeof(float)));
+        NV_CUDA_CHECK(cudaMallocHost(&slot.hostInput, m_BatchSize * m_InputSize * sizeof(float)));
+        for (auto& tensor : m_OutputTensors)
+        {
+            NV_CUDA_CHECK(cudaMalloc(&slot.deviceBuffers.at(tensor.bindingIndex),
+                                     m_BatchSize * tensor.volume * sizeof(float)));
+            float* hostOutput = nullptr;
+            NV_CUDA_CHECK(cudaMallocHost(&hostOutput, tensor.volume * m_BatchSize * sizeof(float)));
+            slot.hostOutputs.push_back(hostOutput);
+        }
+    }
+    m_NextSlot = 0;
+    allocateGpuPostprocessing();
+
+    for (size_t i = 0; i < m_OutputTensors.size(); ++i)
+    {
+        m_OutputTensors[i].hostBuffer = m_Slots[0].hostOutputs[i];
+    }
+}
+
+void Yolo::releaseSlots()
+{
+    releaseGraphs();
+    for (auto& slot : m_Slots)
+    {
+        for (auto& hostOutput : slot.hostOutputs) NV_CUDA_CHECK(cudaFreeHost(hostOutput));
+        for (auto& deviceBuffer : slot.deviceBuffers) NV_CUDA_CHECK(cudaFree(deviceBuffer));
+        if (slot.hostInput) NV_CUDA_CHECK(cudaFreeHost(slot.hostInput));
+        if (slot.deviceFrame) NV_CUDA_CHECK(cudaFree(slot.deviceFrame));
+        if (slot.hostFrame) NV_CUDA_CHECK(cudaFreeHost(slot.hostFrame));
+        if (slot.deviceCandidates) NV_CUDA_CHECK(cudaFree(slot.deviceCandidates));
+        if (slot.deviceResults) NV_CUDA_CHECK(cudaFree(slot.deviceResults));
+        if (slot.deviceCounts) NV_CUDA_CHECK(cudaFree(slot.deviceCounts));
+        if (slot.hostResults) NV_CUDA_CHECK(cudaFreeHost(slot.hostResults));
+        if (slot.hostCounts) NV_CUDA_CHECK(cudaFreeHost(slot.hostCounts));
+        if (slot.stream) NV_CUDA_CHECK(cudaStreamDestroy(slot.stream));
+        if (slot.context) slot.context->destroy();
+    }
+    m_Slots.clear();
+    for (auto& tensor : m_OutputTensors)
+    {
+        tensor.hostBuffer = nullptr;
+    }
+}
+
+int Yolo::getFreeSlot() const
+{
+    for (size_t i = 0; i < m_Slots.size(); ++i)
+    {
+        const size_t ind = (m_NextSlot + i) % m_Slots.size();
+        if (!m_Slots[ind].busy)
+            return static_cast<int>(ind);
+    }
+    return -1;
+}
+
+int Yolo::startSlot()
+{
+    int slotInd = getFreeSlot();
+    if (slotInd < 0)
+    {
+        // The caller doesn't read the results of the oldest batch, they are lost
+        slotInd = static_cast<int>(m_NextSlot);
+        std::cout << "All " << m_Slots.size() << " inference slots are busy, results of the slot " << slotInd << " are dropped" << std::endl;
+        waitInference(slotInd);
+    }
+    m_NextSlot = (slotInd + 1) % m_Slots.size();
+    m_Slots[slotInd].busy = true;
+    return slotInd;
+}
+
 void Yolo::doInference(const unsigned char* input, const uint32_t batchSize)
+{
+    waitInference(enqueueInference(input, batchSize));
+}
+
+int Yolo::enqueueInference(const unsigned char* input, const uint32_t batchSize)
 {
 	//Timer timer;
     assert(batchSize <= m_BatchSize && "Image batch size exceeds TRT engines batch size");
-    NV_CUDA_CHECK(cudaMemcpyAsync(m_DeviceBuffers.at(m_InputBindingIndex), input,
-                                  batchSize * m_InputSize * sizeof(float), cudaMemcpyHostToDevice,
-                                  m_CudaStream));
-	
-    m_Context->enqueue(batchSize, m_DeviceBuffers.data(), m_CudaStream, nullptr);
-    for (auto& tensor : m_OutputTensors)
+    const int slotInd = startSlot();
+    InferSlot& slot = m_Slots[slotInd];
+    slot.batchSize = batchSize;
+    slot.gpuDecoded = false;
+
+    // The pinned copy of the blob is transferred asynchronously
+    memcpy(slot.hostInput, input, batchSize * m_InputSize * sizeof(float));
+    runBatchWork(slot, { 0 }, [&]()
     {
-        NV_CUDA_CHECK(cudaMemcpyAsync(tensor.hostBuffer, m_DeviceBuffers.at(tensor.bindingIndex),
-                                      batchSize * tensor.volume * sizeof(float),
-                                      cudaMemcpyDeviceToHost, m_CudaStream));
-    }
-    cudaStreamSynchronize(m_CudaStream);
+        NV_CUDA_CHECK(cudaMemcpyAsync(slot.deviceBuffers.at(m_InputBindingIndex), slot.hostInput,
+                                      batchSize * m_InputSize * sizeof(float), cudaMemcpyHostToDevice,
+                                      slot.stream));
+
+        slot.context->enqueue(batchSize, slot.deviceBuffers.data(), slot.stream, nullptr);
+        copyOutputs(slot);
+    });
 	//timer.out("inference");
+    return slotInd;
+}
+
+void Yolo::doInference(const std::vector<cv::Mat>& images)
+{
+    waitInference(enqueueInference(images));
+}
+
+int Yolo::enqueueInference(const std::vector<cv::Mat>& images)
+{
+    const uint32_t batchSize = static_cast<uint32_t>(images.size());
+    assert(batchSize <= m_BatchSize && "Image batch size exceeds TRT engines batch size");
+    const int slotInd = startSlot();
+    InferSlot& slot = m_Slots[slotInd];
+    slot.batchSize = batchSize;
+    slot.gpuDecoded = false;
+
+    // All frames of the batch are staged in the pinned memory, so their uploads don't wait for each other
+    size_t framesSize = 0;
+    for (const auto& img : images)
+    {
+        framesSize += img.cols * img.elemSize() * img.rows;
+    }
+    if (slot.hostFrameSize < framesSize)
+    {
+        if (slot.hostFrame) NV_CUDA_CHECK(cudaFreeHost(slot.hostFrame));
+        if (slot.deviceFrame) NV_CUDA_CHECK(cudaFree(slot.deviceFrame));
+        NV_CUDA_CHECK(cudaMallocHost(&slot.hostFrame, framesSize));
+        NV_CUDA_CHECK(cudaMalloc(&slot.deviceFrame, framesSize));
+        slot.hostFrameSize = framesSize;
+    }
+
+    std::vector<cv::Size> sizes;
+    sizes.reserve(batchSize);
+    std::vector<uint64_t> signature { 1, reinterpret_cast<uint64_t>(slot.hostFrame), reinterpret_cast<uint64_t>(slot.deviceFrame) };
+    size_t frameOffset = 0;
+    for (uint32_t i = 0; i < batchSize; ++i)
+    {
+        const cv::Mat& img = images[i];
+        assert(img.type() == CV_8UC3 && "GPU preprocessing supports only BGR images");
+
+        const size_t rowSize = img.cols * img.elemSize();
+        cv::Mat(img.rows, img.cols, img.type(), slot.hostFrame + frameOffset, rowSize) = img;
+        frameOffset += rowSize * img.rows;
+        sizes.emplace_back(img.cols, img.rows);
+        signature.push_back(static_cast<uint64_t>(img.cols));
+        signature.push_back(static_cast<uint64_t>(img.rows));
+    }
+    return finishEnqueue(slotInd, sizes, signature, [&]()
+    {
+        size_t offset = 0;
+        for (uint32_t i = 0; i < batchSize; ++i)
+        {
+            const size_t rowSize = sizes[i].width * 3;
+            unsigned char* deviceFrame = reinterpret_cast<unsigned char*>(slot.deviceFrame) + offset;
+            NV_CUDA_CHECK(cudaMemcpyAsync(deviceFrame, slot.hostFrame + offset, rowSize * sizes[i].height, cudaMemcpyHostToDevice, slot.stream));
+            offset += rowSize * sizes[i].height;
+
+            letterboxOnGpu(slot, i, deviceFrame, sizes[i].width, sizes[i].height, rowSize, 3);
+        }
+    });
+}
+
+int Yolo::enqueueInference(const std::vector<tensor_rt::DeviceImage>& images)
+{
+    const uint32_t batchSize = static_cast<uint32_t>(images.size());
+    assert(batchSize <= m_BatchSize && "Image batch size exceeds TRT engines batch size");
+    const int slotInd = startSlot();
+    InferSlot& slot = m_Slots[slotInd];
+    slot.batchSize = batchSize;
+    slot.gpuDecoded = false;
+
+    std::vector<cv::Size> sizes;
+    sizes.reserve(batchSize);
+    std::vector<uint64_t> signature { 2 };
+    for (uint32_t i = 0; i < batchSize; ++i)
+    {
+        const tensor_rt::DeviceImage& img = images[i];
+        assert((img.channels == 3 || img.channels == 4) && "GPU preprocessing supports only BGR and BGRA images");
+
+        // The frame is written by the decoder on the other stream
+        if (img.stream)
+            NV_CUDA_CHECK(cudaStreamSynchronize(reinterpret_cast<cudaStream_t>(img.stream)));
+
+        sizes.emplace_back(img.width, img.height);
+        signature.insert(signature.end(), { reinterpret_cast<uint64_t>(img.data), static_cast<uint64_t>(img.width),
+                                            static_cast<uint64_t>(img.height), static_cast<uint64_t>(img.pitch),
+                                            static_cast<uint64_t>(img.channels) });
+    }
+    return finishEnqueue(slotInd, sizes, signature, [&]()
+    {
+        for (uint32_t i = 0; i < batchSize; ++i)
+        {
+            const tensor_rt::DeviceImage& img = images[i];
+            letterboxOnGpu(slot, i, img.data, img.width, img.height, img.pitch, img.channels);
+        }
+    });
+}
+
+void Yolo::letterboxOnGpu(InferSlot& slot, const uint32_t imageIdx, const void* deviceFrame, const int width, const int height,
+                          const size_t pitch, const int channels)
+{
+    float* input = reinterpret_cast<float*>(slot.deviceBuffers.at(m_InputBindingIndex));
+
+    // Geometry of the letterbox is the same as in DsImage and decodeTensor of yolov5
+    int resizeW = static_cast<int>(m_InputW);
+    int resizeH = static_cast<int>(m_InputH);
+    int xOffset = 0;
+    int yOffset = 0;
+    if ("yolov5" == m_NetworkType)
+    {
+        float sh = 1.f;
+        float sw = 1.f;
+        calcuate_letterbox_message(m_InputH, m_InputW, height, width, sh, sw, xOffset, yOffset);
+        resizeW = static_cast<int>(m_InputW) - 2 * xOffset;
+        resizeH = static_cast<int>(m_InputH) - 2 * yOffset;
+    }
+    // The division by 255 is the first layer of the network
+    NV_CUDA_CHECK(cudaLetterboxBGR2CHW(deviceFrame, width, height, pitch, channels,
+                                       input + imageIdx * m_InputSize, m_InputW, m_InputH,
+                                       resizeW, resizeH, xOffset, yOffset, 128.f, 1.f, slot.stream));
+}
+
+int Yolo::finishEnqueue(const int slotInd, const std::vector<cv::Size>& sizes, const std::vector<uint64_t>& signature,
+                        const std::function<void()>& preprocess)
+{
+    InferSlot& slot = m_Slots[slotInd];
+    runBatchWork(slot, signature, [&]()
+    {
+        preprocess();
+        slot.context->enqueue(slot.batchSize, slot.deviceBuffers.data(), slot.stream, nullptr);
+        if (m_GpuPostprocessing)
+            decodeOnGpu(slot, sizes);
+        else
+            copyOutputs(slot);
+    });
+    slot.gpuDecoded = m_GpuPostprocessing;
+    return slotInd;
+}
+
+void Yolo::runBatchWork(InferSlot& slot, const std::vector<uint64_t>& signature, const std::function<void()>& work)
+{
+    if (!m_CudaGraphs)
+    {
+        work();
+        return;
+    }
+
+    InferGraph& graph = slot.graphs[slot.batchSize];
+    if (graph.exec && graph.signature == signature)
+    {
+        NV_CUDA_CHECK(cudaGraphLaunch(graph.exec, slot.stream));
+        return;
+    }
+    // The new batch runs directly: the first enqueue initializes the context and the changing frames aren't captured every time
+    if (graph.pending != signature)
+    {
+        graph.pending = signature;
+        work();
+        return;
+    }
+
+    cudaGraph_t captured = nullptr;
+    NV_CUDA_CHECK(cudaStreamBeginCapture(slot.stream, cudaStreamCaptureModeThreadLocal));
+    work();
+    cudaError_t status = cudaStreamEndCapture(slot.stream, &captured);
+    if (status == cudaSuccess)
+    {
+        if (graph.exec)
+            NV_CUDA_CHECK(cudaGraphExecDestroy(graph.exec));
+        graph.exec = nullptr;
+#if CUDART_VERSION >= 12000
+        status = cudaGraphInstantiate(&graph.exec, captured, 0);
+#else
+        status = cudaGraphInstantiate(&graph.exec, captured, nullptr, nullptr, 0);
+#endif
+        NV_CUDA_CHECK(cudaGraphDestroy(captured));
+    }
+    if (status != cudaSuccess)
+    {
+        // Nothing of the captured work is executed
+        std::cout << "CUDA graph capture of the batch failed: " << cudaGetErrorString(status) << ", the graphs are disabled" << std::endl;
+        cudaGetLastError();
+        graph.exec = nullptr;
+        releaseGraphs();
+        m_CudaGraphs = false;
+        work();
+        return;
+    }
+    graph.signature = signature;
+    NV_CUDA_CHECK(cudaGraphLaunch(graph.exec, slot.stream));
+}
+
+void Yolo::setCudaGraphs(bool enable)
+{
+    releaseGraphs();
+    m_CudaGraphs = enable;
+}
+
+void Yolo::releaseGraphs()
+{
+    for (auto& slot : m_Slots)
+    {
+        for (auto& graph : slot.graphs)
+        {
+            if (graph.second.exec) NV_CUDA_CHECK(cudaGraphExecDestroy(graph.second.exec));
+        }
+        slot.graphs.clear();
+    }
+}
+
+void Yolo::copyOutputs(InferSlot& slot)
+{
+    for (size_t i = 0; i < m_OutputTensors.size(); ++i)
+    {
+        const auto& tensor = m_OutputTensors[i];
+        NV_CUDA_CHECK(cudaMemcpyAsync(slot.hostOutputs[i], slot.deviceBuffers.at(tensor.bindingIndex),
+                                      slot.batchSize * tensor.volume * sizeof(float),
+                                      cudaMemcpyDeviceToHost, slot.stream));
+    }
+}
+
+void Yolo::decodeOnGpu(InferSlot& slot, const std::vector<cv::Size>& sizes)
+{
+    const uint32_t batchSize = slot.batchSize;
+    NV_CUDA_CHECK(cudaMemsetAsync(slot.deviceCounts, 0, 2 * batchSize * sizeof(int), slot.stream));
+    for (uint32_t i = 0; i < batchSize; ++i)
+    {
+        YoloDecodeParams params;
+        params.netW = static_cast<float>(m_InputW);
+        params.netH = static_cast<float>(m_InputH);
+        params.imageW = static_cast<float>(sizes[i].width);
+        params.imageH = static_cast<float>(sizes[i].height);
+        params.probThresh = m_ProbThresh;
+        params.useClassThresh = m_ClassThresh.empty() ? 0 : 1;
+        for (size_t c = 0; c < m_ClassThresh.size() && c < static_cast<size_t>(kMaxGpuClasses); ++c)
+        {
+            params.classThresh[c] = m_ClassThresh[c];
+        }
+        if ("yolov5" == m_NetworkType)
+        {
+            int xOffset = 0;
+            int yOffset = 0;
+            calcuate_letterbox_message(m_InputH, m_InputW, sizes[i].height, sizes[i].width, params.scaleH, params.scaleW, xOffset, yOffset);
+            params.letterbox = 1;
+            params.xOffset = static_cast<float>(xOffset);
+            params.yOffset = static_cast<float>(yOffset);
+        }
+        for (const auto& tensor : m_OutputTensors)
+        {
+            params.gridH = static_cast<int>(tensor.grid_h);
+            params.gridW = static_cast<int>(tensor.grid_w);
+            params.numBBoxes = static_cast<int>(tensor.numBBoxes);
+            params.numClasses = static_cast<int>(tensor.numClasses);
+            params.strideH = static_cast<float>(tensor.stride_h);
+            params.strideW = static_cast<float>(tensor.stride_w);
+            for (uint32_t b = 0; b < tensor.numBBoxes; ++b)
+            {
+                params.anchors[2 * b] = tensor.anchors[tensor.masks[b] * 2];
+                params.anchors[2 * b + 1] = tensor.anchors[tensor.masks[b] * 2 + 1];
+            }
+            const float* output = reinterpret_cast<const float*>(slot.deviceBuffers.at(tensor.bindingIndex)) + i * tensor.volume;
+            NV_CUDA_CHECK(cudaDecodeYolo(output, params, slot.deviceCandidates + i * kMaxGpuCandidates, slot.deviceCounts + 2 * i, slot.stream));
+        }
+    }
+    NV_CUDA_CHECK(cudaNmsYolo(slot.deviceCandidates, slot.deviceCounts, slot.deviceResults, batchSize, m_NMSThresh, "yolov5" == m_NetworkType, static_cast<int>(m_TopK), slot.stream));
+
+    // Only the counts and the final boxes are copied back, the boxes count of the image is bounded by the capacity
+    NV_CUDA_CHECK(cudaMemcpyAsync(slot.hostCounts, slot.deviceCounts, 2 * batchSize * sizeof(int), cudaMemcpyDeviceToHost, slot.stream));
+}
+
+void Yolo::waitInference(const int slotInd)
+{
+    InferSlot& slot = m_Slots.at(slotInd);
+    cudaStreamSynchronize(slot.stream);
+    slot.busy = false;
+
+    // Decoding on the host reads the outputs of the last waited slot
+    for (size_t i = 0; i < m_OutputTensors.size(); ++i)
+    {
+        m_OutputTensors[i].hostBuffer = slot.hostOutputs[i];
+    }
+    if (!slot.gpuDecoded)
+        return;
+
+    const uint32_t batchSize = slot.batchSize;
+    for (uint32_t i = 0; i < batchSize; ++i)
+    {
+        if (slot.hostCounts[2 * i + 1] > 0)
+            NV_CUDA_CHECK(cudaMemcpyAsync(slot.hostResults + i * kMaxGpuCandidates, slot.deviceResults + i * kMaxGpuCandidates,
+                                          slot.hostCounts[2 * i + 1] * sizeof(GpuBBox), cudaMemcpyDeviceToHost, slot.stream));
+    }
+    cudaStreamSynchronize(slot.stream);
+
+    m_GpuDetections.resize(batchSize);
+    for (uint32_t i = 0; i < batchSize; ++i)
+    {
+        if (slot.hostCounts[2 * i] > kMaxGpuCandidates)
+            std::cout << "GPU decode: " << slot.hostCounts[2 * i] << " candidates over the capacity " << kMaxGpuCandidates << std::endl;
+
+        std::vector<BBoxInfo>& binfo = m_GpuDetections[i];
+        binfo.clear();
+        for (int j = 0; j < slot.hostCounts[2 * i + 1]; ++j)
+        {
+            const GpuBBox& gbox = slot.hostResults[i * kMaxGpuCandidates + j];
+            BBoxInfo bbi;
+            bbi.box.x1 = gbox.x1;
+            bbi.box.y1 = gbox.y1;
+            bbi.box.x2 = gbox.x2;
+            bbi.box.y2 = gbox.y2;
+            bbi.label = gbox.label;
+            bbi.prob = gbox.prob;
+            bbi.classId = getClassId(gbox.label);
+            binfo.push_back(bbi);
+        }
+    }
+}
+
+void Yolo::setGpuPostprocessing(bool enable)
+{
+    // The decoding of YOLOv2 differs and stays on the host
+    const bool supported = m_NetworkType.find("yolov2") != 0;
+    for (const auto& tensor : m_OutputTensors)
+    {
+        if (tensor.numBBoxes > static_cast<uint32_t>(kMaxGpuAnchors))
+            enable = false;
+    }
+    m_GpuPostprocessing = enable && supported;
+    // The graphs have the pointers of the decoding buffers
+    releaseGraphs();
+    allocateGpuPostprocessing();
+}
+
+void Yolo::allocateGpuPostprocessing()
+{
+    for (auto& slot : m_Slots)
+    {
+        if (m_GpuPostprocessing && !slot.deviceCandidates)
+        {
+            NV_CUDA_CHECK(cudaMalloc(&slot.deviceCandidates, m_BatchSize * kMaxGpuCandidates * sizeof(GpuBBox)));
+            NV_CUDA_CHECK(cudaMalloc(&slot.deviceResults, m_BatchSize * kMaxGpuCandidates * sizeof(GpuBBox)));
+            NV_CUDA_CHECK(cudaMalloc(&slot.deviceCounts, 2 * m_BatchSize * sizeof(int)));
+            NV_CUDA_CHECK(cudaMallocHost(&slot.hostResults, m_BatchSize * kMaxGpuCandidates * sizeof(GpuBBox)));
+            NV_CUDA_CHECK(cudaMallocHost(&slot.hostCounts, 2 * m_BatchSize * sizeof(int)));
+        }
+        else if (!m_GpuPostprocessing && slot.deviceCandidates)
+        {
+            NV_CUDA_CHECK(cudaFree(slot.deviceCandidates));
+            NV_CUDA_CHECK(cudaFree(slot.deviceResults));
+            NV_CUDA_CHECK(cudaFree(slot.deviceCounts));
+            NV_CUDA_CHECK(cudaFreeHost(slot.hostResults));
+            NV_CUDA_CHECK(cudaFreeHost(slot.hostCounts));
+            slot.deviceCandidates = nullptr;
+            slot.deviceResults = nullptr;
+            slot.deviceCounts = nullptr;
+            slot.hostResults = nullptr;
+            slot.hostCounts = nullptr;
+        }
+    }
 }
 
 std::vector<BBoxInfo> Yolo::decodeDetections(const int& imageIdx,
@@ -1247,20 +1730,14 @@ void Yolo::parse_cfg_blocks_v5(const  std::vector<std::map<std::string, std::str
 }
 void Yolo::allocateBuffers()
 {
-    m_DeviceBuffers.resize(m_Engine->getNbBindings(), nullptr);
     assert(m_InputBindingIndex != -1 && "Invalid input binding index");
-    NV_CUDA_CHECK(cudaMalloc(&m_DeviceBuffers.at(m_InputBindingIndex),
-                             m_BatchSize * m_InputSize * sizeof(float)));
-
     for (auto& tensor : m_OutputTensors)
     {
         tensor.bindingIndex = m_Engine->getBindingIndex(tensor.blobName.c_str());
         assert((tensor.bindingIndex != -1) && "Invalid output binding index");
-        NV_CUDA_CHECK(cudaMalloc(&m_DeviceBuffers.at(tensor.bindingIndex),
-                                 m_BatchSize * tensor.volume * sizeof(float)));
-        NV_CUDA_CHECK(
-            cudaMallocHost(&tensor.hostBuffer, tensor.volume * m_BatchSize * sizeof(float)));
     }
+    // Buffers of the every inference slot, one slot until setPipelineDepth
+    setPipelineDepth(1);
 }
 
 bool Yolo::verifyYoloEngine()
@@ -1307,13 +1784,8 @@ void Yolo::writePlanFileToDisk()
     assert(!m_EnginePath.empty() && "Enginepath is empty");
 
     // write data to output file
-    std::stringstream gieModelStream;
-    gieModelStream.seekg(0, gieModelStream.beg);
-    gieModelStream.write(static_cast<const char*>(m_ModelStream->data()), m_ModelStream->size());
-    std::ofstream outFile;
-    outFile.open(m_EnginePath, std::ios::binary | std::ios::out);
-    outFile << gieModelStream.rdbuf();
-    outFile.close();
+    if (!writePlanFile(m_EnginePath, m_ModelStream->data(), m_ModelStream->size()))
+        return;
 
     std::cout << "Serialized plan file cached at location : " << m_EnginePath << std::endl;
 }
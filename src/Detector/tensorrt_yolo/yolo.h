@@ -37,9 +37,13 @@ SOFTWARE.
 #include <stdint.h>
 #include <string>
 #include <vector>
+#include <map>
+#include <functional>
 #include "class_timer.hpp"
 #include "opencv2/opencv.hpp"
 #include "detect.h"
+#include "decode_nms.h"
+#include "class_detector.h"
 //#include "logging.h"
 
 /**
@@ -53,6 +57,7 @@ struct NetworkInfo
     std::string labelsFilePath;
     std::string precision;
     std::string deviceType;
+    int dlaCore = -1;
     std::string calibrationTablePath;
     std::string enginePath;
     std::string inputBlobName;
@@ -71,6 +76,10 @@ struct InferParams
     float probThresh = 0.5f;
     float nmsThresh = 0.5f;
     uint32_t batchSize = 1;
+    // Thresholds of the every class instead of probThresh, the classes over 1 aren't decoded. probThresh is the minimum of them
+    std::vector<float> classThresh;
+    // Maximum candidates of the image before NMS, 0 - without limit
+    uint32_t topK = 0;
 };
 
 /**
@@ -94,11 +103,45 @@ struct TensorInfo
     float* hostBuffer{nullptr};
 };
 
+// Resources of one batch in flight: the copies and the inference of the different slots overlap on GPU
+// CUDA graph of the GPU work of the batch: copies, preprocessing, enqueue and decoding
+struct InferGraph
+{
+    std::vector<uint64_t> signature; // Batch of the captured graph: sizes and pointers of the images
+    std::vector<uint64_t> pending;   // Batch of the last direct run, it's captured on the next same batch
+    cudaGraphExec_t exec{nullptr};
+};
+
+struct InferSlot
+{
+    nvinfer1::IExecutionContext* context{nullptr};
+    cudaStream_t stream{nullptr};
+    std::vector<void*> deviceBuffers;
+    std::vector<float*> hostOutputs;   // Pinned outputs of the every tensor
+    float* hostInput{nullptr};         // Pinned blob of the CPU preprocessing
+    unsigned char* hostFrame{nullptr}; // Pinned raw frames of the GPU preprocessing
+    void* deviceFrame{nullptr};
+    size_t hostFrameSize{0};
+    GpuBBox* deviceCandidates{nullptr}; // kMaxGpuCandidates for the every image of the batch
+    GpuBBox* deviceResults{nullptr};
+    int* deviceCounts{nullptr};         // Candidates and results of the every image
+    GpuBBox* hostResults{nullptr};
+    int* hostCounts{nullptr};
+    std::map<uint32_t, InferGraph> graphs; // By the batch size
+    uint32_t batchSize{0};
+    bool gpuDecoded{false};
+    bool busy{false};
+};
+
 class Yolo
 {
 public:
     std::string getNetworkType() const { return m_NetworkType; }
     float getNMSThresh() const { return m_NMSThresh; }
+    uint32_t getTopK() const { return m_TopK; }
+    // Classes out of the white list have the threshold over 1
+    bool isClassEnabled(const uint32_t label) const { return label >= m_ClassThresh.size() || m_ClassThresh[label] <= 1.f; }
+    float getClassThresh(const int label) const { return (label >= 0 && static_cast<size_t>(label) < m_ClassThresh.size()) ? m_ClassThresh[label] : m_ProbThresh; }
     std::string getClassName(const int& label) const { return m_ClassNames.at(label); }
     int getClassId(const int& label) const { return m_ClassIds.at(label); }
     uint32_t getInputH() const { return m_InputH; }
@@ -107,6 +150,26 @@ public:
     bool isPrintPredictions() const { return m_PrintPredictions; }
     bool isPrintPerfInfo() const { return m_PrintPerfInfo; }
     void doInference(const unsigned char* input, const uint32_t batchSize);
+    // Raw BGR frames are uploaded and preprocessed on GPU directly into the input binding
+    void doInference(const std::vector<cv::Mat>& images);
+    // Asynchronous variants of doInference return the slot, decodeDetections and getGpuDetections are valid after waitInference
+    int enqueueInference(const unsigned char* input, const uint32_t batchSize);
+    int enqueueInference(const std::vector<cv::Mat>& images);
+    // Frames in the device memory are preprocessed in place, without the host staging and the upload
+    int enqueueInference(const std::vector<tensor_rt::DeviceImage>& images);
+    void waitInference(const int slotInd);
+    // Count of the batches in flight: every slot has own execution context, stream and pinned buffers
+    void setPipelineDepth(uint32_t depth);
+    uint32_t getPipelineDepth() const { return static_cast<uint32_t>(m_Slots.size()); }
+    int getFreeSlot() const;
+    // Decode and NMS of doInference(images) on GPU, only the final boxes are copied to the host
+    void setGpuPostprocessing(bool enable);
+    bool isGpuPostprocessing() const { return m_GpuPostprocessing; }
+    // The batches with the same sizes and frame pointers are replayed by the captured CUDA graph:
+    // lower launch overhead of the small batches, it's disabled if the engine can't be captured
+    void setCudaGraphs(bool enable);
+    bool isCudaGraphs() const { return m_CudaGraphs; }
+    const std::vector<BBoxInfo>& getGpuDetections(const int& imageIdx) const { return m_GpuDetections.at(imageIdx); }
     std::vector<BBoxInfo> decodeDetections(const int& imageIdx,
 											const int& imageH,
                                            const int& imageW);
@@ -122,6 +185,7 @@ protected:
     const std::string m_LabelsFilePath;
     const std::string m_Precision;
     const std::string m_DeviceType;
+    const int m_DlaCore;
     const std::string m_CalibImages;
     const std::string m_CalibImagesFilePath;
     std::string m_CalibTableFilePath;
@@ -137,6 +201,8 @@ protected:
 	float _f_width_multiple = 0;
     const float m_ProbThresh;
     const float m_NMSThresh;
+    const std::vector<float> m_ClassThresh;
+    const uint32_t m_TopK;
     std::vector<std::string> m_ClassNames;
     // Class ids for coco benchmarking
     const std::vector<int> m_ClassIds{
@@ -153,10 +219,12 @@ protected:
     nvinfer1::IBuilder* m_Builder;
     nvinfer1::IHostMemory* m_ModelStream;
     nvinfer1::ICudaEngine* m_Engine;
-    nvinfer1::IExecutionContext* m_Context;
-    std::vector<void*> m_DeviceBuffers;
     int m_InputBindingIndex;
-    cudaStream_t m_CudaStream;
+    std::vector<InferSlot> m_Slots;
+    size_t m_NextSlot = 0;
+    bool m_GpuPostprocessing = false;
+    bool m_CudaGraphs = false;
+    std::vector<std::vector<BBoxInfo>> m_GpuDetections;
     PluginFactory* m_PluginFactory;
     std::unique_ptr<YoloTinyMaxpoolPaddingFormula> m_TinyMaxpoolPaddingFormula;
 
@@ -275,10 +343,22 @@ private:
                           Int8EntropyCalibrator* calibrator = nullptr);
 	void create_engine_yolov5(const nvinfer1::DataType dataType = nvinfer1::DataType::kFLOAT,
 		Int8EntropyCalibrator* calibrator = nullptr);
+    void setDeviceConfig(nvinfer1::IBuilderConfig* config);
     std::vector<std::map<std::string, std::string>> parseConfigFile(const std::string cfgFilePath);
     void parseConfigBlocks();
 	void parse_cfg_blocks_v5(const  std::vector<std::map<std::string, std::string>> &vec_block_);
     void allocateBuffers();
+    void releaseSlots();
+    int startSlot();
+    void copyOutputs(InferSlot& slot);
+    void letterboxOnGpu(InferSlot& slot, const uint32_t imageIdx, const void* deviceFrame, const int width, const int height,
+                        const size_t pitch, const int channels);
+    int finishEnqueue(const int slotInd, const std::vector<cv::Size>& sizes, const std::vector<uint64_t>& signature,
+                      const std::function<void()>& preprocess);
+    void runBatchWork(InferSlot& slot, const std::vector<uint64_t>& signature, const std::function<void()>& work);
+    void releaseGraphs();
+    void decodeOnGpu(InferSlot& slot, const std::vector<cv::Size>& sizes);
+    void allocateGpuPostprocessing();
     bool verifyYoloEngine();
     void destroyNetworkUtils(std::vector<nvinfer1::Weights>& trtWeights);
     void writePlanFileToDisk();
@@ -62,6 +62,9 @@ std::vector<BBoxInfo> YoloV2::decodeTensor(const int imageIdx, const int imageH,
 
                 const float objectness
                     = detections[bbindex + numGridCells * (b * (5 + tensor.numClasses) + 4)];
+                // Probabilities of the classes aren't greater than 1
+                if (objectness <= m_ProbThresh)
+                    continue;
                 float maxProb = 0.0f;
                 int maxIndex = -1;
 
@@ -71,7 +74,7 @@ std::vector<BBoxInfo> YoloV2::decodeTensor(const int imageIdx, const int imageH,
                         = detections[bbindex
                                      + numGridCells * (b * (5 + tensor.numClasses) + (5 + i))];
 
-                    if (prob > maxProb)
+                    if (prob > maxProb && isClassEnabled(i))
                     {
                         maxProb = prob;
                         maxIndex = i;
@@ -80,7 +83,7 @@ std::vector<BBoxInfo> YoloV2::decodeTensor(const int imageIdx, const int imageH,
 
                 maxProb = objectness * maxProb;
 
-                if (maxProb > m_ProbThresh)
+                if (maxIndex >= 0 && maxProb > getClassThresh(maxIndex))
                 {
                     addBBoxProposal(bx, by, bw, bh, tensor.stride, scalingFactor, xOffset, yOffset,
                                     maxIndex, maxProb,imageW,imageH, binfo);
@@ -64,6 +64,9 @@ std::vector<BBoxInfo> YoloV3::decodeTensor(const int imageIdx,
 
                 const float objectness
                     = detections[bbindex + numGridCells * (b * (5 + tensor.numClasses) + 4)];
+                // Probabilities of the classes aren't greater than 1
+                if (objectness <= m_ProbThresh)
+                    continue;
 
                 float maxProb = 0.0f;
                 int maxIndex = -1;
@@ -74,7 +77,7 @@ std::vector<BBoxInfo> YoloV3::decodeTensor(const int imageIdx,
                         = (detections[bbindex
                                       + numGridCells * (b * (5 + tensor.numClasses) + (5 + i))]);
 
-                    if (prob > maxProb)
+                    if (prob > maxProb && isClassEnabled(i))
                     {
                         maxProb = prob;
                         maxIndex = i;
@@ -82,7 +85,7 @@ std::vector<BBoxInfo> YoloV3::decodeTensor(const int imageIdx,
                 }
                 maxProb = objectness * maxProb;
 
-                if (maxProb > m_ProbThresh)
+                if (maxIndex >= 0 && maxProb > getClassThresh(maxIndex))
                 {
 					add_bbox_proposal(bx, by, bw, bh, tensor.stride_h, tensor.stride_w, scale_h, scale_w, xOffset, yOffset, maxIndex, maxProb, imageW, imageH, binfo);
                 }
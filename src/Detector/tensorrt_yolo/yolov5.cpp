@@ -40,6 +40,9 @@ std::vector<BBoxInfo> YoloV5::decodeTensor(const int imageIdx, const int imageH,
 
 				const float objectness
 					= detections[bbindex + numGridCells * (b * (5 + tensor.numClasses) + 4)];
+				// Probabilities of the classes aren't greater than 1
+				if (objectness <= m_ProbThresh)
+					continue;
 
 				float maxProb = 0.0f;
 				int maxIndex = -1;
@@ -50,7 +53,7 @@ std::vector<BBoxInfo> YoloV5::decodeTensor(const int imageIdx, const int imageH,
 						= (detections[bbindex
 							+ numGridCells * (b * (5 + tensor.numClasses) + (5 + i))]);
 
-					if (prob > maxProb)
+					if (prob > maxProb && isClassEnabled(i))
 					{
 						maxProb = prob;
 						maxIndex = i;
@@ -58,7 +61,7 @@ std::vector<BBoxInfo> YoloV5::decodeTensor(const int imageIdx, const int imageH,
 				}
 				maxProb = objectness * maxProb;
 
-				if (maxProb > m_ProbThresh)
+				if (maxIndex >= 0 && maxProb > getClassThresh(maxIndex))
 				{
 					add_bbox_proposal(bx, by, bw, bh, tensor.stride_h, tensor.stride_w, scale_h, scale_w,xOffset, yOffset, maxIndex, maxProb, imageW, imageH, binfo);
 				}
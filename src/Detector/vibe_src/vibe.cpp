@@ -2,16 +2,48 @@
 #include <opencv2/core/core.hpp>
 #include <random>
 
+#include "task_scheduler.h"
+
 namespace vibe
 {
+	namespace
+	{
+		///
+		/// \brief The XorShift struct
+		/// Random stream of the one row of the one frame: the result doesn't depend on the threads count
+		///
+		struct XorShift
+		{
+			uint32_t m_state;
+
+			XorShift(uint64_t frame, int row)
+			{
+				// SplitMix64 of the frame and the row as the seed
+				uint64_t z = (frame << 32) + static_cast<uint64_t>(row) + 0x9E3779B97F4A7C15ull;
+				z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+				z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+				z ^= z >> 31;
+				m_state = static_cast<uint32_t>(z) | 1u;
+			}
+
+			uint32_t operator()()
+			{
+				m_state ^= m_state << 13;
+				m_state ^= m_state >> 17;
+				m_state ^= m_state << 5;
+				return m_state;
+			}
+		};
+	}
+
 	///
 	VIBE::VIBE(int channels, int samples, int pixel_neighbor, int distance_threshold, int matching_threshold, int update_factor) :
-		m_samples(samples),
+		m_samples(std::min(samples, 255)),
 		m_channels(channels),
 		m_pixelNeighbor(pixel_neighbor),
 		m_distanceThreshold(distance_threshold),
 		m_matchingThreshold(matching_threshold),
-		m_updateFactor(update_factor)
+		m_updateFactor(std::max(1, update_factor))
 	{
 		//srand(0);
 		for (int i = 0; i < RANDOM_BUFFER_SIZE; i++)
@@ -42,33 +74,122 @@ namespace vibe
 
 		const size_t imWidth = static_cast<size_t>(m_size.width);
 		const size_t imHeight = static_cast<size_t>(m_size.height);
-		const size_t chanSampl = static_cast<size_t>(m_channels * m_samples);
 
-		m_model.resize(m_channels * static_cast<size_t>(m_samples) * imWidth * imHeight, 0);
+		m_planeSize = m_channels * imWidth * imHeight;
+		m_model.resize(m_samples * m_planeSize, 0);
+		m_framesCount = 0;
 
 		m_mask = cv::Mat(m_size, CV_8UC1, cv::Scalar::all(0));
 
-		const uchar* image = img.data;
 		for (size_t i = 0; i < imHeight; ++i)
 		{
+			const uchar* img_ptr = img.ptr(static_cast<int>(i));
+			std::copy(img_ptr, img_ptr + m_channels * imWidth, &m_model[m_channels * imWidth * i]);
+
 			for (size_t j = 0; j < imWidth; j++)
 			{
-                for (size_t c = 0; c < m_channels; ++c)
-				{
-					m_model[chanSampl * (imWidth * i + j) + c] = image[m_channels * imWidth * i + m_channels * j + c];
-				}
                 for (size_t s = 1; s < m_samples; ++s)
 				{
 					cv::Vec<size_t, 2> rnd_pos = getRndNeighbor(static_cast<int>(i), static_cast<int>(j));
-					size_t img_idx = m_channels * imWidth * rnd_pos[0] + m_channels * rnd_pos[1];
-					size_t model_idx = chanSampl * (imWidth * i + j) + m_channels * s;
+					const uchar* rnd_ptr = img.ptr(static_cast<int>(rnd_pos[0])) + m_channels * rnd_pos[1];
+					size_t model_idx = s * m_planeSize + m_channels * (imWidth * i + j);
                     for (size_t c = 0; c < m_channels; ++c)
 					{
-						m_model[model_idx + c] = image[img_idx + c];
+						m_model[model_idx + c] = rnd_ptr[c];
+					}
+				}
+			}
+		}
+	}
+
+	///
+	/// \brief VIBE::matchRow
+	/// Counts of the matched samples are calculated by the whole rows of the sample planes, the loops are vectorized
+	///
+	void VIBE::matchRow(const uchar* img_ptr, int i, uchar* counts, uchar* matches, uchar* mask_ptr) const
+	{
+		const int cols = m_size.width;
+		const int rowLength = static_cast<int>(m_channels) * cols;
+		const int threshold = m_distanceThreshold;
+		std::fill(counts, counts + cols, 0);
+
+		for (size_t s = 0; s < m_samples; ++s)
+		{
+			const uchar* sample_ptr = &m_model[s * m_planeSize + static_cast<size_t>(rowLength) * i];
+			if (m_channels == 1)
+			{
+#pragma omp simd
+				for (int j = 0; j < cols; ++j)
+				{
+					counts[j] += static_cast<uchar>(std::abs(static_cast<int>(sample_ptr[j]) - static_cast<int>(img_ptr[j])) < threshold);
+				}
+			}
+			else
+			{
+#pragma omp simd
+				for (int k = 0; k < rowLength; ++k)
+				{
+					matches[k] = static_cast<uchar>(std::abs(static_cast<int>(sample_ptr[k]) - static_cast<int>(img_ptr[k])) < threshold);
+				}
+				for (int j = 0; j < cols; ++j)
+				{
+					uchar matched = 1;
+					for (size_t c = 0; c < m_channels; ++c)
+					{
+						matched &= matches[m_channels * j + c];
 					}
+					counts[j] += matched;
 				}
 			}
 		}
+
+		const int matchingThreshold = m_matchingThreshold;
+#pragma omp simd
+		for (int j = 0; j < cols; ++j)
+		{
+			mask_ptr[j] = (counts[j] > matchingThreshold) ? 0 : 255;
+		}
+	}
+
+	///
+	/// \brief VIBE::updateRow
+	/// The background pixels of the row replace a random sample of themselves and of a random neighbor.
+	/// The updated pixels are chosen by the random jumps with the mean length m_updateFactor
+	///
+	void VIBE::updateRow(const cv::Mat& img, int i)
+	{
+		XorShift rng(m_framesCount, i);
+
+		const int cols = m_size.width;
+		const int area = m_pixelNeighbor * 2 + 1;
+		const uint32_t neighborCount = static_cast<uint32_t>(area * area);
+		const uint32_t maxJump = static_cast<uint32_t>(2 * m_updateFactor - 1);
+		const uchar* img_ptr = img.ptr(i);
+		const uchar* mask_ptr = m_mask.ptr(i);
+
+		for (int j = static_cast<int>(rng() % static_cast<uint32_t>(m_updateFactor)); j < cols; j += 1 + static_cast<int>(rng() % maxJump))
+		{
+			if (mask_ptr[j])
+				continue;
+
+			const uchar* pixel = img_ptr + m_channels * j;
+			size_t sample = rng() % m_samples;
+			size_t model_idx = sample * m_planeSize + m_channels * (static_cast<size_t>(cols) * i + j);
+            for (size_t c = 0; c < m_channels; ++c)
+			{
+				m_model[model_idx + c] = pixel[c];
+			}
+
+			const int rnd = static_cast<int>(rng() % neighborCount);
+			const int ni = std::max(std::min(i - m_pixelNeighbor + rnd / area, m_size.height - 1), 0);
+			const int nj = std::max(std::min(j - m_pixelNeighbor + rnd % area, cols - 1), 0);
+			sample = rng() % m_samples;
+			model_idx = sample * m_planeSize + m_channels * (static_cast<size_t>(cols) * ni + nj);
+            for (size_t c = 0; c < m_channels; ++c)
+			{
+				m_model[model_idx + c] = pixel[c];
+			}
+		}
 	}
 
 	///
@@ -80,71 +201,68 @@ namespace vibe
 			return;
 		}
 
-		int rowsCount = img.rows;
-#pragma omp parallel for
-		for (int i = 0; i < rowsCount; i++)
+		const int rowsCount = img.rows;
+
+		// Foreground mask: the model is only read
+		tasks::ParallelForRange(0, rowsCount, [&](int from, int to)
 		{
-			const uchar* img_ptr = img.ptr(i);
-			uchar* mask_ptr = m_mask.ptr(i);
+			std::vector<uchar> counts(m_size.width);
+			std::vector<uchar> matches((m_channels > 1) ? m_channels * m_size.width : 0);
+			for (int i = from; i < to; i++)
+			{
+				matchRow(img.ptr(i), i, counts.data(), matches.data(), m_mask.ptr(i));
+			}
+		});
 
-			for (int j = 0; j < img.cols; j++)
+		// Model update: the row updates the samples of the rows [i - m_pixelNeighbor, i + m_pixelNeighbor],
+		// the rows of one pass are far enough for the parallel threads
+		const int passes = 2 * m_pixelNeighbor + 1;
+		for (int pass = 0; pass < passes; ++pass)
+		{
+			const int passRows = (rowsCount - pass + passes - 1) / passes;
+			tasks::ParallelFor(0, passRows, [&](int k)
 			{
-				bool flag = false;
-				int matching_counter = 0;
-				model_t::value_type* model_ptr = &m_model[m_channels * m_samples * m_size.width * i + m_channels * m_samples * j];
-                for (size_t s = 0; s < m_samples; ++s)
-				{
-                    size_t channels_counter = 0;
-                    for (size_t c = 0; c < m_channels; ++c)
-					{
-						if (std::abs((int)model_ptr[c] - img_ptr[c]) < m_distanceThreshold)
-							++channels_counter;
-					}
-					if (channels_counter == m_channels)
-					{
-						if (++matching_counter > m_matchingThreshold)
-						{
-							flag = true;
-							break;
-						}
-					}
-					model_ptr += m_channels;
-				}
+				updateRow(img, pass + k * passes);
+			});
+		}
+		++m_framesCount;
+	}
 
-				if (flag)
-				{
-					mask_ptr[0] = 0;
-					if (0 == m_rng[m_rngIdx = (m_rngIdx + 1) % RANDOM_BUFFER_SIZE] % m_updateFactor)
-					{
-						int sample = m_rng[m_rngIdx = (m_rngIdx + 1) % RANDOM_BUFFER_SIZE] % m_samples;
-						size_t model_idx = m_channels * m_samples * m_size.width * i + m_channels * m_samples * j + m_channels * sample;
-                        for (size_t c = 0; c < m_channels; ++c)
-						{
-							m_model[model_idx + c] = img_ptr[c];
-						}
+	///
+	cv::Mat VIBE::GetModel() const
+	{
+		if (m_useOCL)
+			return m_modelOCL.getMat(cv::ACCESS_READ).clone();
 
-						cv::Vec2i rnd_pos = getRndNeighbor(i, j);
-						sample = m_rng[m_rngIdx = (m_rngIdx + 1) % RANDOM_BUFFER_SIZE] % m_samples;
-						model_idx = m_channels * m_samples * m_size.width * rnd_pos[0] + m_channels * m_samples * rnd_pos[1] + m_channels * sample;
-                        for (size_t c = 0; c < m_channels; ++c)
-						{
-							m_model[model_idx + c] = img_ptr[c];
-						}
-					}
-				}
-				else
-				{
-					mask_ptr[0] = 255;
-				}
-				img_ptr += m_channels;
-				++mask_ptr;
-			}
-		}
+		if (m_model.empty())
+			return cv::Mat();
+		return cv::Mat(static_cast<int>(m_samples) * m_size.height, m_size.width, CV_8UC(static_cast<int>(m_channels)), const_cast<uchar*>(m_model.data())).clone();
+	}
+
+	///
+	bool VIBE::SetModel(const cv::Mat& model)
+	{
+		if (model.empty() || model.type() != CV_8UC(static_cast<int>(m_channels)) || model.rows % static_cast<int>(m_samples) != 0)
+			return false;
+
+		m_size = cv::Size(model.cols, model.rows / static_cast<int>(m_samples));
+		m_planeSize = m_channels * static_cast<size_t>(m_size.area());
+		m_model.resize(m_samples * m_planeSize);
+		cv::Mat modelHeader(model.rows, model.cols, model.type(), m_model.data());
+		model.copyTo(modelHeader);
+		m_framesCount = 0;
+		m_mask = cv::Mat(m_size, CV_8UC1, cv::Scalar::all(0));
+
+		// The OpenCL model is uploaded from m_model on the next frame
+		m_useOCL = false;
+		return true;
 	}
 
 	///
 	cv::Mat& VIBE::getMask()
 	{
+		if (m_useOCL)
+			m_maskOCL.copyTo(m_mask);
 		return m_mask;
 	}
 
@@ -165,9 +283,10 @@ namespace vibe
 				if (*mask_ptr)
 				{
 					int matching_counter = 0;
-					model_t::value_type* model_ptr = &m_model[m_channels * m_samples * m_size.width * i + m_channels * m_samples * j];
+					size_t model_idx = m_channels * (static_cast<size_t>(m_size.width) * i + j);
                     for (size_t s = 0; s < m_samples; ++s)
 					{
+						model_t::value_type* model_ptr = &m_model[s * m_planeSize + model_idx];
                         size_t channels_counter = 0;
                         for (size_t c = 0; c < m_channels; ++c)
 						{
@@ -182,7 +301,6 @@ namespace vibe
 							if (++matching_counter > m_matchingThreshold)
 								break;
 						}
-						model_ptr += m_channels;
 					}
 				}
 
@@ -2,7 +2,10 @@
 #define __VIBE_HPP__
 
 #include <opencv2/core/core.hpp>
+#include <opencv2/core/ocl.hpp>
 #include <memory>
+#include <cstdint>
+#include <algorithm>
 
 namespace vibe
 {
@@ -20,6 +23,42 @@ public:
 
 	void ResetModel(const cv::Mat& img, const cv::Rect& roiRect);
 
+    ///
+    /// \brief update
+    /// With OpenCL the model stays on the device and the frames are processed by the kernels,
+    /// otherwise the frame is mapped to the host
+    ///
+    void update(const cv::UMat& img);
+    cv::UMat getMaskUMat();
+	void ResetModel(const cv::UMat& img, const cv::Rect& roiRect);
+
+    ///
+    /// \brief GetModel
+    /// \return Copy of the samples: (samples * rows) x cols matrix of CV_8UC(channels), the sample s is the rows [s * rows, (s + 1) * rows).
+    ///         Empty before the first frame
+    ///
+    cv::Mat GetModel() const;
+    ///
+    /// \brief SetModel
+    /// Restores the model saved by GetModel, the next frames must have the same size
+    /// \param model
+    /// \return false if the model doesn't fit the samples and channels count
+    ///
+    bool SetModel(const cv::Mat& model);
+
+    ///
+    /// \brief SetTiles
+    /// The image is the stack of the independent images of tileRows rows with the step tilePitch (the multi-stream atlas):
+    /// the OpenCL kernels take the neighbors only in the tile, the rows between the tiles are the background
+    /// \param tileRows - 0 for the one image
+    /// \param tilePitch
+    ///
+    void SetTiles(int tileRows, int tilePitch)
+    {
+        m_tileRows = tileRows;
+        m_tilePitch = tilePitch;
+    }
+
 private:
     size_t m_samples = 20;
     size_t m_channels = 1;
@@ -30,15 +69,42 @@ private:
 
     cv::Size m_size;
 	typedef std::vector<uchar> model_t;
-    model_t m_model;
+    model_t m_model;     // Sample-major: the every sample is a plane with the layout of the image
+    size_t m_planeSize = 0;
+    uint64_t m_framesCount = 0;
 
     cv::Mat m_mask;
 
     unsigned int m_rng[RANDOM_BUFFER_SIZE];
     int m_rngIdx = 0;
 
+    // OpenCL model: the samples are (m_samples * rows) x cols, sample s is the rows [s * rows, (s + 1) * rows)
+    bool m_useOCL = false;
+    bool m_oclFailed = false;
+    cv::UMat m_modelOCL;
+    cv::UMat m_maskOCL;
+    cv::ocl::Kernel m_initKernel;
+    cv::ocl::Kernel m_matchKernel;
+    cv::ocl::Kernel m_updateKernel;
+    cv::ocl::Kernel m_resetKernel;
+
+    int m_tileRows = 0;
+    int m_tilePitch = 0;
+    int TileRows(int rows) const
+    {
+        return (m_tileRows > 0) ? m_tileRows : rows;
+    }
+    int TilePitch(int rows) const
+    {
+        return (m_tileRows > 0) ? std::max(m_tilePitch, m_tileRows) : rows;
+    }
+
+    bool initOCL(const cv::UMat& img);
+
     cv::Vec<size_t, 2> getRndNeighbor(int i, int j);
 	void init(const cv::Mat& img);
+	void matchRow(const uchar* img_ptr, int i, uchar* counts, uchar* matches, uchar* mask_ptr) const;
+	void updateRow(const cv::Mat& img, int i);
 };
 }
 
@@ -0,0 +1,259 @@
+#include "vibe.hpp"
+#include <iostream>
+#include <string>
+
+namespace vibe
+{
+	namespace
+	{
+		// CN, SAMPLES, NEIGHBOR, DISTANCE, MATCHING and UPDATE are defined by the build options.
+		// The image is the stack of the tiles of tile_rows rows with the step tile_pitch: the neighbors are taken only in the tile
+		// and the rows between the tiles are the background
+		const char* vibeKernelsSource = R"CLC(
+#define AREA (2 * NEIGHBOR + 1)
+
+inline uint vibe_hash(uint x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352dU;
+    x ^= x >> 15;
+    x *= 0x846ca68bU;
+    x ^= x >> 16;
+    return x;
+}
+
+__kernel void vibe_init(__global const uchar* img, int img_step, int img_offset,
+                        __global uchar* model, int model_step, int model_offset,
+                        int rows, int cols, int tile_rows, int tile_pitch, uint seed)
+{
+    const int x = get_global_id(0);
+    const int y = get_global_id(1);
+    if (x >= cols || y >= rows)
+        return;
+    const int tile_top = (y / tile_pitch) * tile_pitch;
+
+    for (int s = 0; s < SAMPLES; ++s)
+    {
+        int sx = x;
+        int sy = y;
+        if (s > 0 && y - tile_top < tile_rows)
+        {
+            const int rnd = vibe_hash(seed ^ vibe_hash((uint)((y * cols + x) * SAMPLES + s))) % (AREA * AREA);
+            sy = clamp(y - NEIGHBOR + rnd / AREA, tile_top, min(tile_top + tile_rows, rows) - 1);
+            sx = clamp(x - NEIGHBOR + rnd % AREA, 0, cols - 1);
+        }
+        __global const uchar* src = img + img_offset + sy * img_step + sx * CN;
+        __global uchar* dst = model + model_offset + (s * rows + y) * model_step + x * CN;
+        for (int c = 0; c < CN; ++c)
+        {
+            dst[c] = src[c];
+        }
+    }
+}
+
+__kernel void vibe_match(__global const uchar* img, int img_step, int img_offset,
+                         __global const uchar* model, int model_step, int model_offset,
+                         __global uchar* mask, int mask_step, int mask_offset,
+                         int rows, int cols, int tile_rows, int tile_pitch)
+{
+    const int x = get_global_id(0);
+    const int y = get_global_id(1);
+    if (x >= cols || y >= rows)
+        return;
+    if (y % tile_pitch >= tile_rows)
+    {
+        mask[mask_offset + y * mask_step + x] = 0;
+        return;
+    }
+
+    __global const uchar* src = img + img_offset + y * img_step + x * CN;
+    int count = 0;
+    for (int s = 0; s < SAMPLES; ++s)
+    {
+        __global const uchar* sample = model + model_offset + (s * rows + y) * model_step + x * CN;
+        int matched = 1;
+        for (int c = 0; c < CN; ++c)
+        {
+            matched &= abs((int)sample[c] - (int)src[c]) < DISTANCE;
+        }
+        count += matched;
+    }
+    mask[mask_offset + y * mask_step + x] = (count > MATCHING) ? 0 : 255;
+}
+
+__kernel void vibe_update(__global const uchar* img, int img_step, int img_offset,
+                          __global uchar* model, int model_step, int model_offset,
+                          __global const uchar* mask, int mask_step, int mask_offset,
+                          int rows, int cols, int tile_rows, int tile_pitch, uint seed)
+{
+    const int x = get_global_id(0);
+    const int y = get_global_id(1);
+    if (x >= cols || y >= rows || mask[mask_offset + y * mask_step + x])
+        return;
+    const int tile_top = (y / tile_pitch) * tile_pitch;
+    if (y - tile_top >= tile_rows)
+        return;
+
+    uint rnd = vibe_hash(seed ^ vibe_hash((uint)(y * cols + x)));
+    if (rnd % UPDATE != 0)
+        return;
+
+    __global const uchar* src = img + img_offset + y * img_step + x * CN;
+
+    rnd = vibe_hash(rnd);
+    __global uchar* dst = model + model_offset + ((rnd % SAMPLES) * rows + y) * model_step + x * CN;
+    for (int c = 0; c < CN; ++c)
+    {
+        dst[c] = src[c];
+    }
+
+    rnd = vibe_hash(rnd);
+    const int pos = rnd % (AREA * AREA);
+    const int ny = clamp(y - NEIGHBOR + pos / AREA, tile_top, min(tile_top + tile_rows, rows) - 1);
+    const int nx = clamp(x - NEIGHBOR + pos % AREA, 0, cols - 1);
+    rnd = vibe_hash(rnd);
+    dst = model + model_offset + ((rnd % SAMPLES) * rows + ny) * model_step + nx * CN;
+    for (int c = 0; c < CN; ++c)
+    {
+        dst[c] = src[c];
+    }
+}
+
+__kernel void vibe_reset(__global const uchar* img, int img_step, int img_offset,
+                         __global uchar* model, int model_step, int model_offset,
+                         __global const uchar* mask, int mask_step, int mask_offset,
+                         int rows, int left, int top, int width, int height)
+{
+    const int x = left + get_global_id(0);
+    const int y = top + get_global_id(1);
+    if (x >= left + width || y >= top + height || !mask[mask_offset + y * mask_step + x])
+        return;
+
+    __global const uchar* src = img + img_offset + y * img_step + x * CN;
+    int count = 0;
+    for (int s = 0; s < SAMPLES && count <= MATCHING; ++s)
+    {
+        __global uchar* sample = model + model_offset + (s * rows + y) * model_step + x * CN;
+        int replaced = 0;
+        for (int c = 0; c < CN; ++c)
+        {
+            if (abs((int)sample[c] - (int)src[c]) >= DISTANCE)
+            {
+                sample[c] = src[c];
+                ++replaced;
+            }
+        }
+        if (replaced == CN)
+            ++count;
+    }
+}
+)CLC";
+	}
+
+	///
+	/// \brief VIBE::initOCL
+	/// Builds the kernels on the first call and initializes the model on the device: uploads the host model of the same size or initializes by the frame
+	/// \param img
+	/// \return false if OpenCL can't be used
+	///
+	bool VIBE::initOCL(const cv::UMat& img)
+	{
+		if (m_initKernel.empty())
+		{
+			const std::string options = "-D CN=" + std::to_string(m_channels) +
+				" -D SAMPLES=" + std::to_string(m_samples) +
+				" -D NEIGHBOR=" + std::to_string(m_pixelNeighbor) +
+				" -D DISTANCE=" + std::to_string(m_distanceThreshold) +
+				" -D MATCHING=" + std::to_string(m_matchingThreshold) +
+				" -D UPDATE=" + std::to_string(m_updateFactor);
+			cv::ocl::ProgramSource source(vibeKernelsSource);
+			if (!m_initKernel.create("vibe_init", source, options) ||
+				!m_matchKernel.create("vibe_match", source, options) ||
+				!m_updateKernel.create("vibe_update", source, options) ||
+				!m_resetKernel.create("vibe_reset", source, options))
+			{
+				std::cerr << "VIBE: OpenCL kernels weren't built, CPU is used" << std::endl;
+				m_initKernel = cv::ocl::Kernel();
+				return false;
+			}
+		}
+
+		const bool hostModel = (m_size == img.size()) && (m_model.size() == m_samples * m_channels * static_cast<size_t>(img.cols) * static_cast<size_t>(img.rows));
+		m_size = img.size();
+		m_modelOCL.create(static_cast<int>(m_samples) * img.rows, img.cols, CV_8UC(static_cast<int>(m_channels)));
+		m_maskOCL.create(img.size(), CV_8UC1);
+		m_maskOCL.setTo(cv::Scalar::all(0));
+		if (hostModel)
+		{
+			cv::Mat(m_modelOCL.rows, m_modelOCL.cols, m_modelOCL.type(), m_model.data()).copyTo(m_modelOCL);
+			return true;
+		}
+		m_framesCount = 0;
+
+		size_t globalSize[2] = { static_cast<size_t>(img.cols), static_cast<size_t>(img.rows) };
+		m_initKernel.args(cv::ocl::KernelArg::ReadOnlyNoSize(img), cv::ocl::KernelArg::ReadWriteNoSize(m_modelOCL),
+			img.rows, img.cols, TileRows(img.rows), TilePitch(img.rows), static_cast<unsigned int>(rand()));
+		return m_initKernel.run(2, globalSize, nullptr, false);
+	}
+
+	///
+	void VIBE::update(const cv::UMat& img)
+	{
+		if (!cv::ocl::useOpenCL() || m_oclFailed || img.channels() != static_cast<int>(m_channels))
+		{
+			m_useOCL = false;
+			update(img.getMat(cv::ACCESS_READ));
+			return;
+		}
+
+		if (!m_useOCL || m_size != img.size())
+		{
+			m_useOCL = initOCL(img);
+			if (!m_useOCL)
+			{
+				m_oclFailed = true;
+				m_size = cv::Size();
+				update(img.getMat(cv::ACCESS_READ));
+			}
+			return;
+		}
+
+		size_t globalSize[2] = { static_cast<size_t>(img.cols), static_cast<size_t>(img.rows) };
+		m_matchKernel.args(cv::ocl::KernelArg::ReadOnlyNoSize(img), cv::ocl::KernelArg::ReadOnlyNoSize(m_modelOCL),
+			cv::ocl::KernelArg::WriteOnlyNoSize(m_maskOCL), img.rows, img.cols, TileRows(img.rows), TilePitch(img.rows));
+		bool res = m_matchKernel.run(2, globalSize, nullptr, false);
+
+		// Other work items write the samples of the neighbors, so the update is the next kernel
+		const unsigned int seed = static_cast<unsigned int>(m_framesCount * 0x9E3779B9ull);
+		m_updateKernel.args(cv::ocl::KernelArg::ReadOnlyNoSize(img), cv::ocl::KernelArg::ReadWriteNoSize(m_modelOCL),
+			cv::ocl::KernelArg::ReadOnlyNoSize(m_maskOCL), img.rows, img.cols, TileRows(img.rows), TilePitch(img.rows), seed);
+		res = res && m_updateKernel.run(2, globalSize, nullptr, false);
+		if (!res)
+			std::cerr << "VIBE: OpenCL kernels failed" << std::endl;
+		++m_framesCount;
+	}
+
+	///
+	cv::UMat VIBE::getMaskUMat()
+	{
+		return m_useOCL ? m_maskOCL : m_mask.getUMat(cv::ACCESS_READ);
+	}
+
+	///
+	void VIBE::ResetModel(const cv::UMat& img, const cv::Rect& roiRect)
+	{
+		if (!m_useOCL)
+		{
+			ResetModel(img.getMat(cv::ACCESS_READ), roiRect);
+			return;
+		}
+
+		const cv::Rect roi = roiRect & cv::Rect(0, 0, img.cols, img.rows);
+		if (roi.empty())
+			return;
+		size_t globalSize[2] = { static_cast<size_t>(roi.width), static_cast<size_t>(roi.height) };
+		m_resetKernel.args(cv::ocl::KernelArg::ReadOnlyNoSize(img), cv::ocl::KernelArg::ReadWriteNoSize(m_modelOCL),
+			cv::ocl::KernelArg::ReadOnlyNoSize(m_maskOCL), img.rows, roi.x, roi.y, roi.width, roi.height);
+		m_resetKernel.run(2, globalSize, nullptr, false);
+	}
+}
@@ -0,0 +1,310 @@
+#include <cmath>
+#include <iostream>
+#include <algorithm>
+#include "BestCrops.h"
+
+///
+/// \brief CropsEncoder::Instance
+/// \return
+///
+std::shared_ptr<CropsEncoder> CropsEncoder::Instance()
+{
+    static std::mutex instanceMutex;
+    static std::weak_ptr<CropsEncoder> instance;
+
+    std::lock_guard<std::mutex> lock(instanceMutex);
+    std::shared_ptr<CropsEncoder> encoder = instance.lock();
+    if (!encoder)
+    {
+        encoder = std::shared_ptr<CropsEncoder>(new CropsEncoder());
+        instance = encoder;
+    }
+    return encoder;
+}
+
+///
+/// \brief CropsEncoder::CropsEncoder
+///
+CropsEncoder::CropsEncoder()
+    : m_refillTime(std::chrono::steady_clock::now())
+{
+    m_thread = std::thread(&CropsEncoder::Worker, this);
+}
+
+///
+/// \brief CropsEncoder::~CropsEncoder
+/// The not encoded crops are dropped: their trackers are removed
+///
+CropsEncoder::~CropsEncoder()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cond.notify_all();
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+///
+/// \brief CropsEncoder::SetLimits
+/// \param maxBytes
+/// \param encodesPerSecond
+///
+void CropsEncoder::SetLimits(size_t maxBytes, float encodesPerSecond)
+{
+    m_budget.SetMaxBytes(maxBytes);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_encodesPerSecond = std::max(0., static_cast<double>(encodesPerSecond));
+    m_tokens = std::min(m_tokens, std::max(1., m_encodesPerSecond));
+}
+
+///
+/// \brief CropsEncoder::Submit
+/// \param image
+/// \param bytes
+/// \param crop
+/// \param quality
+/// \param output
+/// \param force
+/// \return
+///
+bool CropsEncoder::Submit(cv::Mat& image, size_t bytes, const TrackCrop& crop, int quality, const std::shared_ptr<Output>& output, bool force)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_jobs.size() >= MaxJobs)
+            return false;
+
+        if (m_encodesPerSecond > 0)
+        {
+            const auto now = std::chrono::steady_clock::now();
+            const double elapsed = std::chrono::duration<double>(now - m_refillTime).count();
+            m_refillTime = now;
+            m_tokens = std::min(std::max(1., m_encodesPerSecond), m_tokens + elapsed * m_encodesPerSecond);
+            if (m_tokens < 1 && !force)
+                return false;
+            m_tokens = std::max(0., m_tokens - 1);
+        }
+
+        Job job;
+        job.m_image = image;
+        job.m_bytes = bytes;
+        job.m_crop = crop;
+        job.m_quality = quality;
+        job.m_output = output;
+        m_jobs.emplace_back(std::move(job));
+    }
+    m_cond.notify_one();
+    image = cv::Mat();
+    return true;
+}
+
+///
+/// \brief CropsEncoder::Worker
+///
+void CropsEncoder::Worker()
+{
+    const std::string ext = ".jpg";
+    for (;;)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cond.wait(lock, [this]() { return m_stop || !m_jobs.empty(); });
+            if (m_stop)
+            {
+                for (const auto& dropped : m_jobs)
+                {
+                    m_budget.Release(dropped.m_bytes);
+                }
+                m_jobs.clear();
+                break;
+            }
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+
+        bool encoded = false;
+        try
+        {
+            encoded = cv::imencode(ext, job.m_image, job.m_crop.m_jpeg, { cv::IMWRITE_JPEG_QUALITY, job.m_quality });
+        }
+        catch (const cv::Exception& ex)
+        {
+            std::cerr << "CropsEncoder: " << ex.what() << std::endl;
+        }
+        job.m_image.release();
+        m_budget.Release(job.m_bytes);
+
+        if (!encoded)
+        {
+            std::cerr << "CropsEncoder: crop of the track " << job.m_crop.m_trackID.ID2Str() << " wasn't encoded" << std::endl;
+            continue;
+        }
+        std::lock_guard<std::mutex> lock(job.m_output->m_mutex);
+        job.m_output->m_crops.emplace_back(std::move(job.m_crop));
+    }
+}
+
+///
+/// \brief BestCrops::BestCrops
+/// \param settings
+///
+BestCrops::BestCrops(const TrackerSettings& settings)
+    : m_encoder(CropsEncoder::Instance()), m_output(std::make_shared<CropsEncoder::Output>())
+{
+    ApplySettings(settings);
+}
+
+///
+/// \brief BestCrops::~BestCrops
+/// The not submitted candidates are dropped, the queued ones are encoded to the output without the tracker
+///
+BestCrops::~BestCrops()
+{
+    for (const auto& it : m_candidates)
+    {
+        m_encoder->Budget().Release(it.second.m_bytes);
+    }
+}
+
+///
+/// \brief BestCrops::ApplySettings
+/// \param settings
+///
+void BestCrops::ApplySettings(const TrackerSettings& settings)
+{
+    m_maxSide = settings.m_bestCropsMaxSide;
+    m_quality = settings.m_bestCropsQuality;
+    m_encoder->SetLimits(settings.m_bestCropsMaxMem << 20, settings.m_bestCropsEncodeFps);
+}
+
+///
+/// \brief BestCrops::Update
+/// \param tracks
+/// \param currFrame
+/// \param fps
+///
+void BestCrops::Update(const tracks_t& tracks, cv::UMat currFrame, float fps)
+{
+    ++m_frameInd;
+    const size_t stableFrames = static_cast<size_t>(std::max(1, cvRound(fps)));
+
+    for (const auto& track : tracks)
+    {
+        Candidate& candidate = m_candidates[track->GetID()];
+        candidate.m_frameInd = m_frameInd;
+        if (track->SkippedFrames() == 0)
+            Capture(*track, currFrame, candidate);
+        if (candidate.m_pending && m_frameInd - candidate.m_bestFrame >= stableFrames)
+            Submit(candidate, false);
+    }
+
+    // Removed tracks: the last candidate is final
+    for (auto it = std::begin(m_candidates); it != std::end(m_candidates);)
+    {
+        if (it->second.m_frameInd == m_frameInd)
+        {
+            ++it;
+            continue;
+        }
+        if (!it->second.m_pending || !Submit(it->second, true))
+            m_encoder->Budget().Release(it->second.m_bytes);
+        it = m_candidates.erase(it);
+    }
+}
+
+///
+/// \brief BestCrops::Capture
+/// \param track
+/// \param frame
+/// \param candidate
+///
+void BestCrops::Capture(const CTrack& track, cv::UMat frame, Candidate& candidate)
+{
+    constexpr float margin = 0.1f;
+    constexpr double sharpnessHalf = 100.;  // Variance of the Laplacian with the weight 0.5
+
+    const CRegion& region = track.LastRegion();
+    const float confidence = (region.m_confidence < 0) ? 1.f : region.m_confidence;
+    const cv::Rect& brect = region.m_brect;
+
+    // The sharpness weight is less than 1, so the crop can't be better than this
+    const float maxScore = confidence * std::sqrt(static_cast<float>(std::max(0, brect.area())));
+    if (maxScore <= candidate.m_crop.m_score)
+        return;
+
+    const int dx = cvRound(margin * brect.width);
+    const int dy = cvRound(margin * brect.height);
+    const cv::Rect roi = cv::Rect(brect.x - dx, brect.y - dy, brect.width + 2 * dx, brect.height + 2 * dy) & cv::Rect(0, 0, frame.cols, frame.rows);
+    if (roi.empty())
+        return;
+
+    const double scale = std::min(1., static_cast<double>(m_maxSide) / std::max(roi.width, roi.height));
+    const cv::Size size(std::max(1, cvRound(scale * roi.width)), std::max(1, cvRound(scale * roi.height)));
+    cv::UMat roiFrame(frame, roi);
+    if (size == roi.size())
+        roiFrame.copyTo(m_roiImage);
+    else
+        cv::resize(roiFrame, m_roiImage, size, 0, 0, cv::INTER_AREA);
+
+    if (m_roiImage.channels() == 1)
+        cv::Laplacian(m_roiImage, m_laplacian, CV_16S);
+    else
+    {
+        cv::cvtColor(m_roiImage, m_gray, (m_roiImage.channels() == 4) ? cv::COLOR_BGRA2GRAY : cv::COLOR_BGR2GRAY);
+        cv::Laplacian(m_gray, m_laplacian, CV_16S);
+    }
+    cv::Scalar mean;
+    cv::Scalar stddev;
+    cv::meanStdDev(m_laplacian, mean, stddev);
+    const double variance = stddev[0] * stddev[0];
+    const float score = static_cast<float>(maxScore * variance / (variance + sharpnessHalf));
+    if (score <= candidate.m_crop.m_score)
+        return;
+
+    // The new image is acquired before the previous one is released
+    const size_t bytes = m_roiImage.total() * m_roiImage.elemSize();
+    if (!m_encoder->Budget().Acquire(bytes))
+        return;
+    m_encoder->Budget().Release(candidate.m_bytes);
+    candidate.m_bytes = bytes;
+    std::swap(candidate.m_image, m_roiImage);
+
+    candidate.m_crop.m_trackID = track.GetID();
+    candidate.m_crop.m_type = region.m_type;
+    candidate.m_crop.m_rect = roi;
+    candidate.m_crop.m_confidence = region.m_confidence;
+    candidate.m_crop.m_score = score;
+    candidate.m_bestFrame = m_frameInd;
+    candidate.m_pending = true;
+}
+
+///
+/// \brief BestCrops::Submit
+/// \param candidate
+/// \param final
+/// \return false if the encoder didn't get the crop, the candidate keeps it
+///
+bool BestCrops::Submit(Candidate& candidate, bool final)
+{
+    candidate.m_crop.m_final = final;
+    if (!m_encoder->Submit(candidate.m_image, candidate.m_bytes, candidate.m_crop, m_quality, m_output, final))
+        return false;
+    candidate.m_bytes = 0;
+    candidate.m_pending = false;
+    return true;
+}
+
+///
+/// \brief BestCrops::Collect
+/// \param crops
+///
+void BestCrops::Collect(std::vector<TrackCrop>& crops)
+{
+    crops.clear();
+    std::lock_guard<std::mutex> lock(m_output->m_mutex);
+    crops.swap(m_output->m_crops);
+}
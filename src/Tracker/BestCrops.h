@@ -0,0 +1,150 @@
+#pragma once
+#include <deque>
+#include <mutex>
+#include <chrono>
+#include <thread>
+#include <unordered_map>
+#include <condition_variable>
+#include "Ctracker.h"
+#include "track.h"
+#include "StaticSnapshot.h"
+
+///
+/// \brief The CropsEncoder class
+/// JPEG encoding of the best crops on the worker thread, it's shared by the all trackers of the process: the memory
+/// of the not encoded crops and the rate of the encodings are limited for the process, the last settings are applied
+///
+class CropsEncoder
+{
+public:
+    ///
+    /// \brief The Output struct
+    /// Encoded crops of one tracker, the queued jobs keep it after the tracker removal
+    ///
+    struct Output
+    {
+        std::mutex m_mutex;
+        std::vector<TrackCrop> m_crops;
+    };
+
+    ///
+    /// \brief Instance
+    /// \return The encoder of the process, it's created by the first tracker and removed with the last one
+    ///
+    static std::shared_ptr<CropsEncoder> Instance();
+
+    CropsEncoder(const CropsEncoder&) = delete;
+    CropsEncoder& operator=(const CropsEncoder&) = delete;
+    ~CropsEncoder();
+
+    ///
+    /// \brief SetLimits
+    /// \param maxBytes - of the not encoded crops, 0 for the unlimited memory
+    /// \param encodesPerSecond - 0 for the unlimited rate
+    ///
+    void SetLimits(size_t maxBytes, float encodesPerSecond);
+
+    ///
+    StaticSnapshotsBudget& Budget()
+    {
+        return m_budget;
+    }
+
+    ///
+    /// \brief Submit
+    /// \param image - it's moved to the job only on success
+    /// \param bytes - acquired from the Budget, they are released after the encoding
+    /// \param crop
+    /// \param quality
+    /// \param output
+    /// \param force - the final crop doesn't wait for the rate limit
+    /// \return false if the queue is full or the rate is exceeded
+    ///
+    bool Submit(cv::Mat& image, size_t bytes, const TrackCrop& crop, int quality, const std::shared_ptr<Output>& output, bool force);
+
+private:
+    CropsEncoder();
+
+    struct Job
+    {
+        cv::Mat m_image;
+        size_t m_bytes = 0;
+        TrackCrop m_crop;
+        int m_quality = 90;
+        std::shared_ptr<Output> m_output;
+    };
+    static constexpr size_t MaxJobs = 256;
+
+    StaticSnapshotsBudget m_budget{ 0 };
+
+    std::mutex m_mutex;  // Of the all members below
+    std::condition_variable m_cond;
+    std::deque<Job> m_jobs;
+    bool m_stop = false;
+    double m_encodesPerSecond = 0;
+    double m_tokens = 0; // Encodings allowed now, they are refilled by the rate up to a second of the encodings
+    std::chrono::steady_clock::time_point m_refillTime;
+
+    std::thread m_thread;
+    void Worker();
+};
+
+///
+/// \brief The BestCrops class
+/// Best crop of the every track by confidence * sqrt(area) weighted by the sharpness. The candidate is downscaled
+/// to the max side and kept in memory, it's encoded when it wasn't improved for a second or when the track is removed
+///
+class BestCrops
+{
+public:
+    BestCrops(const TrackerSettings& settings);
+    BestCrops(const BestCrops&) = delete;
+    BestCrops& operator=(const BestCrops&) = delete;
+    ~BestCrops();
+
+    ///
+    /// \brief ApplySettings
+    /// \param settings
+    ///
+    void ApplySettings(const TrackerSettings& settings);
+
+    ///
+    /// \brief Update
+    /// It's called at the end of the tracker Update
+    /// \param tracks
+    /// \param currFrame - frame of the caller, the rects of the tracks are on it
+    /// \param fps
+    ///
+    void Update(const tracks_t& tracks, cv::UMat currFrame, float fps);
+
+    ///
+    /// \brief Collect
+    /// \param crops - encoded after the previous call
+    ///
+    void Collect(std::vector<TrackCrop>& crops);
+
+private:
+    struct Candidate
+    {
+        cv::Mat m_image;        // Not encoded crop
+        size_t m_bytes = 0;     // Of m_image acquired from the budget
+        TrackCrop m_crop;       // m_score is the best score of the track, the encoded crops too
+        size_t m_bestFrame = 0;
+        size_t m_frameInd = 0;  // Last Update with the track
+        bool m_pending = false;
+    };
+    std::unordered_map<track_id_t, Candidate> m_candidates;
+
+    std::shared_ptr<CropsEncoder> m_encoder;
+    std::shared_ptr<CropsEncoder::Output> m_output;
+    int m_maxSide = 256;
+    int m_quality = 90;
+    size_t m_frameInd = 0;
+
+    cv::Mat m_roiImage;
+    cv::Mat m_gray;
+    cv::Mat m_laplacian;
+
+    void Capture(const CTrack& track, cv::UMat frame, Candidate& candidate);
+    bool Submit(Candidate& candidate, bool final);
+};
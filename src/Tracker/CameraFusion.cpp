@@ -0,0 +1,333 @@
+#include <iostream>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include "CameraFusion.h"
+#include "trace_events.h"
+
+namespace
+{
+constexpr double DegToRad = 0.017453292519943295769236907684886;
+constexpr double MetersPerDegLat = 6372797.560856 * DegToRad;
+constexpr size_t NoTrack = std::numeric_limits<size_t>::max();
+}
+
+///
+/// \brief CameraFusion::CameraFusion
+/// \param settings
+///
+CameraFusion::CameraFusion(const FusionSettings& settings)
+    : m_settings(settings)
+{
+    m_settings.m_maxDist = std::max(1e-3, m_settings.m_maxDist);
+    m_settings.m_bucketSeconds = std::max(1e-3, m_settings.m_bucketSeconds);
+}
+
+///
+/// \brief CameraFusion::AddCamera
+/// \param pixToWorld
+/// \return
+///
+size_t CameraFusion::AddCamera(const cv::Matx33d& pixToWorld)
+{
+    m_cameras.emplace_back(pixToWorld);
+    m_members.emplace_back();
+    return m_cameras.size() - 1;
+}
+
+///
+/// \brief CameraFusion::ToWorld
+/// \param camera
+/// \param track
+/// \return Meters on the plane from the origin
+///
+cv::Point2d CameraFusion::ToWorld(size_t camera, const TrackingObject& track)
+{
+    // The bottom center of the track is on the ground plane
+    const cv::Rect2f brect = track.m_rrect.boundingRect2f();
+    const cv::Vec3d p(brect.x + 0.5 * brect.width, brect.y + brect.height, 1.);
+    const cv::Vec3d g = m_cameras[camera] * p;
+    const double w = (std::abs(g[2]) > std::numeric_limits<double>::epsilon()) ? g[2] : std::numeric_limits<double>::epsilon();
+    const cv::Point2d world(g[0] / w, g[1] / w);
+
+    if (!m_hasOrigin)
+    {
+        m_hasOrigin = true;
+        m_origin = world;
+        m_metersPerDegLon = m_settings.m_geoDegrees ? (MetersPerDegLat * cos(world.x * DegToRad)) : 1.;
+    }
+    if (!m_settings.m_geoDegrees)
+        return world - m_origin;
+
+    // Equirectangular projection of (latitude, longitude) near the origin: the cameras cover a small area
+    return cv::Point2d((world.y - m_origin.y) * m_metersPerDegLon, (world.x - m_origin.x) * MetersPerDegLat);
+}
+
+///
+/// \brief CameraFusion::CellKey
+/// \param pos
+/// \param dx
+/// \param dy
+/// \return
+///
+uint64_t CameraFusion::CellKey(const cv::Point2d& pos, int dx, int dy) const
+{
+    const int64_t cx = static_cast<int64_t>(std::floor(pos.x / m_settings.m_maxDist)) + dx;
+    const int64_t cy = static_cast<int64_t>(std::floor(pos.y / m_settings.m_maxDist)) + dy;
+    return (static_cast<uint64_t>(static_cast<uint32_t>(cx)) << 32) | static_cast<uint32_t>(cy);
+}
+
+///
+/// \brief CameraFusion::Bucket
+/// \param index
+/// \return
+///
+CameraFusion::TimeBucket& CameraFusion::Bucket(int64_t index)
+{
+    return m_buckets[((index % 2) + 2) % 2];
+}
+
+///
+/// \brief CameraFusion::Index
+/// The late updates of the older buckets aren't indexed
+/// \param trackInd
+/// \param bucketIndex
+///
+void CameraFusion::Index(size_t trackInd, int64_t bucketIndex)
+{
+    TimeBucket& bucket = Bucket(bucketIndex);
+    if (bucket.m_index > bucketIndex)
+        return;
+    if (bucket.m_index < bucketIndex)
+    {
+        for (auto& cell : bucket.m_cells)
+        {
+            cell.second.clear();
+        }
+        bucket.m_index = bucketIndex;
+    }
+    const uint64_t key = CellKey(m_tracks[trackInd].m_pos, 0, 0);
+    auto& indexed = m_indexed[trackInd];
+    if (indexed.first == bucketIndex && indexed.second == key)
+        return;
+    indexed = std::make_pair(bucketIndex, key);
+    bucket.m_cells[key].push_back(trackInd);
+}
+
+///
+/// \brief CameraFusion::FindMatch
+/// The nearest world track of the neighbour cells of the current and the previous buckets without the track of this camera
+/// \param camera
+/// \param pos
+/// \param type
+/// \param timestamp
+/// \param bucketIndex
+/// \return
+///
+size_t CameraFusion::FindMatch(size_t camera, const cv::Point2d& pos, objtype_t type, double timestamp, int64_t bucketIndex) const
+{
+    size_t bestInd = NoTrack;
+    double bestDist = m_settings.m_maxDist;
+    const double maxGap = 2. * m_settings.m_bucketSeconds;
+
+    for (int64_t bi = bucketIndex - 1; bi <= bucketIndex; ++bi)
+    {
+        const TimeBucket& bucket = m_buckets[((bi % 2) + 2) % 2];
+        if (bucket.m_index != bi)
+            continue;
+        for (int dy = -1; dy <= 1; ++dy)
+        {
+            for (int dx = -1; dx <= 1; ++dx)
+            {
+                auto cell = bucket.m_cells.find(CellKey(pos, dx, dy));
+                if (cell == std::end(bucket.m_cells))
+                    continue;
+                for (size_t ind : cell->second)
+                {
+                    const WorldTrack& track = m_tracks[ind];
+                    if (track.m_ID.m_val == 0 || std::abs(timestamp - track.m_time) > maxGap)
+                        continue;
+                    if (type != bad_type && track.m_type != bad_type && type != track.m_type)
+                        continue;
+                    const double dist = cv::norm(track.m_pos - pos);
+                    if (dist >= bestDist)
+                        continue;
+                    bool sameCamera = false;
+                    for (const auto& member : track.m_members)
+                    {
+                        if (member.first == camera)
+                        {
+                            sameCamera = true;
+                            break;
+                        }
+                    }
+                    if (!sameCamera)
+                    {
+                        bestDist = dist;
+                        bestInd = ind;
+                    }
+                }
+            }
+        }
+    }
+    return bestInd;
+}
+
+///
+/// \brief CameraFusion::Detach
+/// The world track without the camera tracks lives up to m_maxAge and it can be matched again
+/// \param camera
+/// \param localID
+///
+void CameraFusion::Detach(size_t camera, track_id_t localID)
+{
+    auto& members = m_members[camera];
+    auto it = members.find(localID);
+    if (it == std::end(members))
+        return;
+
+    auto& trackMembers = m_tracks[it->second].m_members;
+    for (auto mit = std::begin(trackMembers); mit != std::end(trackMembers); ++mit)
+    {
+        if (mit->first == camera && mit->second == localID)
+        {
+            trackMembers.erase(mit);
+            break;
+        }
+    }
+    members.erase(it);
+}
+
+///
+/// \brief CameraFusion::Expire
+/// \param timestamp
+///
+void CameraFusion::Expire(double timestamp)
+{
+    for (size_t ind = 0; ind < m_tracks.size(); ++ind)
+    {
+        WorldTrack& track = m_tracks[ind];
+        if (track.m_ID.m_val == 0 || timestamp - track.m_time <= m_settings.m_maxAge)
+            continue;
+
+        for (const auto& member : track.m_members)
+        {
+            m_members[member.first].erase(member.second);
+        }
+        track.m_members.clear();
+        track.m_ID = 0;
+        m_indexed[ind] = std::make_pair(int64_t(-1), uint64_t(0));
+        m_freeTracks.push_back(ind);
+    }
+}
+
+///
+/// \brief CameraFusion::Update
+/// \param camera
+/// \param timestamp
+/// \param tracks
+/// \param removedTracks
+///
+void CameraFusion::Update(size_t camera, double timestamp, const std::vector<TrackingObject>& tracks, const std::vector<track_id_t>& removedTracks)
+{
+    if (camera >= m_cameras.size())
+    {
+        std::cerr << "CameraFusion::Update: unknown camera " << camera << std::endl;
+        return;
+    }
+    TRACE_SPAN("camera_fusion", "tracker");
+
+    for (const auto& id : removedTracks)
+    {
+        Detach(camera, id);
+    }
+
+    const int64_t bucketIndex = static_cast<int64_t>(std::floor(timestamp / m_settings.m_bucketSeconds));
+    if (bucketIndex > m_lastExpired)
+    {
+        m_lastExpired = bucketIndex;
+        Expire(timestamp);
+    }
+
+    auto& members = m_members[camera];
+    for (const auto& track : tracks)
+    {
+        const cv::Point2d pos = ToWorld(camera, track);
+
+        size_t ind = NoTrack;
+        auto it = members.find(track.m_ID);
+        if (it != std::end(members))
+        {
+            ind = it->second;
+            // The camera track left the fused object
+            if (m_tracks[ind].m_members.size() > 1 && cv::norm(m_tracks[ind].m_pos - pos) > 2. * m_settings.m_maxDist)
+            {
+                Detach(camera, track.m_ID);
+                ind = NoTrack;
+            }
+        }
+        if (ind == NoTrack)
+        {
+            ind = FindMatch(camera, pos, track.m_type, timestamp, bucketIndex);
+            if (ind == NoTrack)
+            {
+                if (m_freeTracks.empty())
+                {
+                    ind = m_tracks.size();
+                    m_tracks.emplace_back();
+                    m_indexed.emplace_back(-1, 0);
+                }
+                else
+                {
+                    ind = m_freeTracks.back();
+                    m_freeTracks.pop_back();
+                }
+                m_tracks[ind].m_ID = m_nextID++;
+                m_tracks[ind].m_pos = pos;
+                m_tracks[ind].m_time = timestamp;
+            }
+            m_tracks[ind].m_members.emplace_back(camera, track.m_ID);
+            members[track.m_ID] = ind;
+        }
+
+        WorldTrack& worldTrack = m_tracks[ind];
+        // The position of the object seen by the several cameras is averaged
+        if (worldTrack.m_members.size() > 1 && std::abs(timestamp - worldTrack.m_time) < m_settings.m_bucketSeconds)
+            worldTrack.m_pos = 0.5 * (worldTrack.m_pos + pos);
+        else
+            worldTrack.m_pos = pos;
+        worldTrack.m_time = std::max(worldTrack.m_time, timestamp);
+        if (track.m_type != bad_type)
+            worldTrack.m_type = track.m_type;
+
+        Index(ind, bucketIndex);
+    }
+}
+
+///
+/// \brief CameraFusion::GlobalID
+/// \param camera
+/// \param localID
+/// \return
+///
+track_id_t CameraFusion::GlobalID(size_t camera, track_id_t localID) const
+{
+    if (camera >= m_members.size())
+        return track_id_t(0);
+    auto it = m_members[camera].find(localID);
+    return (it != std::end(m_members[camera])) ? m_tracks[it->second].m_ID : track_id_t(0);
+}
+
+///
+/// \brief CameraFusion::GetWorldTracks
+/// \param tracks
+///
+void CameraFusion::GetWorldTracks(std::vector<WorldTrack>& tracks) const
+{
+    tracks.clear();
+    for (const auto& track : m_tracks)
+    {
+        if (track.m_ID.m_val != 0)
+            tracks.push_back(track);
+    }
+}
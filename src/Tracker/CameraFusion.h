@@ -0,0 +1,108 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+
+#include "defines.h"
+#include "trajectory.h"
+
+///
+/// \brief The FusionSettings struct
+///
+struct FusionSettings
+{
+    double m_maxDist = 2.0;        // Max distance in meters between the tracks of the same object on the different cameras
+    double m_bucketSeconds = 0.5;  // Time bucket of the index: the tracks are matched with the world tracks of the current and the previous buckets
+    double m_maxAge = 2.0;         // Seconds of the world track without the camera tracks before the removal
+    bool m_geoDegrees = true;      // The homographies project to (latitude, longitude) of GeoParams, else to the meters of the plane
+};
+
+///
+/// \brief The CameraFusion class
+/// Fusion of the tracks of the overlapped cameras: the bottom centers of the tracks are projected to the world plane by the homographies
+/// of the cameras and the camera tracks of the same object are associated to one world track with the global ID.
+/// The world tracks are indexed by the time buckets with the hash grid of m_maxDist cells in every bucket, so the new camera track
+/// is compared only with the world tracks of the neighbour cells: the time is linear in the total count of the tracks.
+/// The association is incremental: the camera track keeps its world track until it moves away on 2 * m_maxDist
+///
+class CameraFusion
+{
+public:
+    CameraFusion(const FusionSettings& settings);
+
+    ///
+    /// \brief AddCamera
+    /// \param pixToWorld - homography of the frame pixels to the world, for example the to geo transform of GeoParams
+    /// \return Index of the camera
+    ///
+    size_t AddCamera(const cv::Matx33d& pixToWorld);
+
+    ///
+    /// \brief Update
+    /// The cameras can be updated in any order with the not decreasing timestamps of the every camera
+    /// \param camera
+    /// \param timestamp - of the frame in seconds, the clocks of the cameras are synchronized
+    /// \param tracks
+    /// \param removedTracks - removed by the tracker of the camera after the previous update
+    ///
+    void Update(size_t camera, double timestamp, const std::vector<TrackingObject>& tracks, const std::vector<track_id_t>& removedTracks);
+
+    ///
+    /// \brief GlobalID
+    /// \param camera
+    /// \param localID - ID of the track of the camera tracker
+    /// \return ID of the world track or 0 if the track is unknown
+    ///
+    track_id_t GlobalID(size_t camera, track_id_t localID) const;
+
+    ///
+    /// \brief The WorldTrack struct
+    ///
+    struct WorldTrack
+    {
+        track_id_t m_ID = 0;
+        cv::Point2d m_pos;       // Meters on the world plane from the first projected point
+        double m_time = 0;       // Of the last camera update
+        objtype_t m_type = bad_type;
+        std::vector<std::pair<size_t, track_id_t>> m_members; // Cameras and the IDs of their tracks
+    };
+
+    ///
+    /// \brief GetWorldTracks
+    /// \param tracks - alive world tracks
+    ///
+    void GetWorldTracks(std::vector<WorldTrack>& tracks) const;
+
+private:
+    FusionSettings m_settings;
+    std::vector<cv::Matx33d> m_cameras;
+
+    bool m_hasOrigin = false;
+    cv::Point2d m_origin;         // World coordinates of the first point
+    double m_metersPerDegLon = 1.;
+
+    std::vector<WorldTrack> m_tracks;
+    std::vector<std::pair<int64_t, uint64_t>> m_indexed; // Last bucket and cell of the world track
+    std::vector<size_t> m_freeTracks;
+    std::vector<std::unordered_map<track_id_t, size_t>> m_members; // Camera -> local ID -> world track
+    track_id_t::value_type m_nextID = 1;
+
+    ///
+    /// \brief The TimeBucket struct
+    /// World tracks updated in the bucket by the cells of the hash grid
+    ///
+    struct TimeBucket
+    {
+        int64_t m_index = -1;
+        std::unordered_map<uint64_t, std::vector<size_t>> m_cells;
+    };
+    TimeBucket m_buckets[2];
+    int64_t m_lastExpired = -1;
+
+    cv::Point2d ToWorld(size_t camera, const TrackingObject& track);
+    uint64_t CellKey(const cv::Point2d& pos, int dx, int dy) const;
+    TimeBucket& Bucket(int64_t index);
+    void Index(size_t trackInd, int64_t bucketIndex);
+    size_t FindMatch(size_t camera, const cv::Point2d& pos, objtype_t type, double timestamp, int64_t bucketIndex) const;
+    void Detach(size_t camera, track_id_t localID);
+    void Expire(double timestamp);
+};
@@ -1,7 +1,84 @@
 #include "Ctracker.h"
+#include "FlowTracker.h"
+#include "ShardedTracker.h"
 #include "ShortPathCalculator.h"
 #include "EmbeddingsCalculator.hpp"
 #include "track.h"
+#include "spatial_grid.h"
+#include "RegionHistograms.h"
+#include "LostTracksFlow.h"
+#include "LostTracksCorrelation.h"
+#include "metrics.h"
+#include "execution_policy.h"
+#include "task_scheduler.h"
+#include "trace_events.h"
+#include "TrackIDAllocator.h"
+#include "ReIDGallery.h"
+#include "TrackerCheckpoint.h"
+#include "TrackEvents.h"
+#include "BestCrops.h"
+#include "FlightRecorder.h"
+#include "memory_arena.h"
+
+#include <set>
+#include <mutex>
+#include <atomic>
+#include <future>
+#include <chrono>
+#include <utility>
+#include <numeric>
+#include <algorithm>
+#include <opencv2/core/ocl.hpp>
+
+///
+/// \brief The TrackerMetrics struct
+/// Stages of the CTracker::Update, they are shared by the all trackers of the process
+///
+struct TrackerMetrics
+{
+    metrics::Histogram& m_embeddings;
+    metrics::Histogram& m_costMatrix;
+    metrics::Histogram& m_solve;
+    metrics::Histogram& m_tracksUpdate;
+    metrics::Counter& m_createdTracks;
+    metrics::Counter& m_removedTracks;
+    metrics::Gauge& m_tracksMemory;
+    metrics::Counter& m_memoryReductions;
+    metrics::Counter& m_reidGalleryHits;
+    metrics::Counter& m_skippedEmbeddings;
+    metrics::Counter& m_parkedTracks;
+    metrics::Counter& m_arenaAllocations;
+    metrics::Counter& m_embeddingsSwaps;
+
+    static TrackerMetrics& Instance()
+    {
+        static TrackerMetrics trackerMetrics;
+        return trackerMetrics;
+    }
+
+private:
+    TrackerMetrics()
+        : m_embeddings(StageHistogram("embeddings")),
+          m_costMatrix(StageHistogram("cost_matrix")),
+          m_solve(StageHistogram("solve")),
+          m_tracksUpdate(StageHistogram("tracks_update")),
+          m_createdTracks(metrics::Registry::Instance().GetCounter("mtracker_tracks_created_total", "Created tracks")),
+          m_removedTracks(metrics::Registry::Instance().GetCounter("mtracker_tracks_removed_total", "Removed tracks")),
+          m_tracksMemory(metrics::Registry::Instance().GetGauge("mtracker_tracks_memory_bytes", "Memory of the tracks of all trackers")),
+          m_memoryReductions(metrics::Registry::Instance().GetCounter("mtracker_tracks_memory_reductions_total", "Tracks degraded by the memory budget")),
+          m_reidGalleryHits(metrics::Registry::Instance().GetCounter("mtracker_reid_gallery_hits_total", "New tracks with the ID of the removed track")),
+          m_skippedEmbeddings(metrics::Registry::Instance().GetCounter("mtracker_embeddings_skipped_total", "Regions matched without embeddings by the lazy re-ID")),
+          m_parkedTracks(metrics::Registry::Instance().GetCounter("mtracker_static_tracks_parked_total", "Static tracks updated without the association")),
+          m_arenaAllocations(metrics::Registry::Instance().GetCounter("mtracker_frame_arena_allocations_total", "Allocations of the frame scratch out of the arena buffer, it doesn't grow on the steady state")),
+          m_embeddingsSwaps(metrics::Registry::Instance().GetCounter("mtracker_embeddings_swaps_total", "Hot swaps of the re-ID networks"))
+    {
+    }
+
+    static metrics::Histogram& StageHistogram(const std::string& stage)
+    {
+        return metrics::Registry::Instance().GetHistogram("mtracker_tracker_stage_seconds{stage=\"" + stage + "\"}", "Time of the CTracker::Update stages");
+    }
+};
 
 ///
 /// \brief The CTracker class
@@ -15,35 +92,225 @@ public:
 	CTracker& operator=(const CTracker&) = delete;
 	CTracker& operator=(CTracker&&) = delete;
 	
-	~CTracker(void) = default;
+	~CTracker(void);
 
     void Update(const regions_t& regions, cv::UMat currFrame, float fps) override;
+    void Update(const regions_t& regions, const std::vector<RegionEmbedding>& regionEmbeddings, cv::UMat currFrame, float fps) override;
+    void UpdateAt(const regions_t& regions, cv::UMat currFrame, double timestamp) override;
+    void CalcEmbeddings(std::vector<RegionEmbedding>& regionEmbeddings, const regions_t& regions, cv::UMat currFrame) const override;
 
     bool CanGrayFrameToTrack() const override;
 	bool CanColorFrameToTrack() const override;
     size_t GetTracksCount() const override;
 	void GetTracks(std::vector<TrackingObject>& tracks) const override;
+    void QueryTracks(const TracksQuery& query, std::vector<TrackingObject>& tracks) const override;
+    void GetPredictedRects(std::vector<cv::Rect>& rects) const override;
     void GetRemovedTracks(std::vector<track_id_t>& trackIDs) const override;
+    void GetTracksDelta(TracksDelta& delta, bool withTrajectory) override;
+    void ApplySettings(const TrackerSettings& settings) override;
+    size_t MemoryBytes() const override;
+    bool Serialize(std::vector<uchar>& data) const override;
+    bool Deserialize(const std::vector<uchar>& data) override;
+    void SetEventsHandler(const TrackEventsParams& params, TrackEventsHandler handler) override;
+    void GetTrackCrops(std::vector<TrackCrop>& crops) override;
+    bool DumpFlightRecord(const std::string& fileName) override;
 
 private:
     TrackerSettings m_settings;
 
+    std::mutex m_pendingMutex;
+    std::unique_ptr<TrackerSettings> m_pendingSettings; // ApplySettings from another thread, it's swapped on the next Update
+    std::atomic<bool> m_hasPendingSettings{ false };
+    void ApplyPendingSettings();
+    void UpdateDistRow();
+    void CreateTrackersPool();
+    void CreateEmbeddingsNets();
+    void StartEmbeddingsSwap();
+    void SwapEmbeddingsNets();
+
+    size_t m_memoryBytes = 0;           // Accounted by the last Update, it's added to the process gauge
+    std::vector<size_t> m_memoryOrder;  // Tracks in the order of the degradation
+    void AccountMemory(float fps);
+
+    std::unique_ptr<checkpoint::BackgroundWriter> m_checkpointWriter;
+    std::vector<uchar> m_checkpointData; // Buffer of the last checkpoint, it's swapped with the buffer of the writer
+    size_t m_updatesCount = 0;
+    void RestoreCheckpoint();
+    void PostCheckpoint();
+
 	tracks_t m_tracks;
 
-    track_id_t m_nextTrackID = 0;
+    std::shared_ptr<TrackIDAllocator> m_idAllocator;
     std::vector<track_id_t> m_removedObjects;
 
-    cv::UMat m_prevFrame;
+    std::unique_ptr<ReIDGallery> m_reidGallery; // Embeddings of the removed tracks for the re-identification of the new ones
+    double m_reidTime = 0;                      // Time of the stream in seconds by the fps of the frames
+    void CreateReIDGallery();
+
+    FrameTiming m_timing;
+    track_t m_timeScale = 1; // Interval of the current update in the nominal frames, it's set by UpdateAt
+
+    bool m_deltaPolled = false;                   // After the first GetTracksDelta removed tracks are collected until the next poll
+    std::vector<track_id_t> m_removedSincePoll;
+
+    std::unique_ptr<TrackEvents> m_events;        // Only with the handler of the events
+    std::unique_ptr<BestCrops> m_bestCrops;       // Only with m_settings.m_bestCrops
+
+    std::unique_ptr<flight::Recorder> m_flightRecorder; // Only with m_settings.m_flightRecorderSeconds
+    std::mutex m_flightMutex;                           // Of m_flightRecorder for DumpFlightRecord from another thread
+    std::chrono::steady_clock::time_point m_updateStart;
+    double m_updateTimestamp = -1.;                     // Of UpdateAt for the flight recorder
+    void CreateFlightRecorder();
+
+    cv::UMat m_prevFrame;     // Shares data with the previous working frame, the caller frame or m_prevFrameCopy
+    cv::UMat m_prevFrameCopy; // Own copy of the caller frame for the batched trackers of the lost tracks
+    cv::UMat m_workFrames[2]; // Frames on m_processingScale: the previous one is kept in m_prevFrame
+    size_t m_workInd = 0;
+    cv::UMat WorkFrame(cv::UMat currFrame);
 
     std::unique_ptr<ShortPathCalculator> m_SPCalculator;
-    std::map<objtype_t, std::shared_ptr<EmbeddingsCalculator>> m_embCalculators;
+    std::vector<track_id_t> m_trackIDs; // Rows of the assignment for the warm start of the solver
+
+    // Assignment by the groups of the compatible types
+    struct TypeGroup
+    {
+        std::unique_ptr<ShortPathCalculator> m_solver;
+        std::vector<int> m_rows;
+        std::vector<int> m_cols;
+        distMatrix_t m_costMatrix;
+        assignments_t m_assignment;
+    };
+    std::vector<TypeGroup> m_typeGroups;
+    std::vector<objtype_t> m_groupTypes;
+    std::vector<size_t> m_typeParents;
+
+    std::unique_ptr<ShortPathCalculator> CreateSPCalculator() const;
+    cv::RotatedRect PredictedArea(const CTrack& track) const;
+    void SolveByTypeGroups(const regions_t& regions, const distMatrix_t& costMatrix, assignments_t& assignment, track_t maxCost);
+    ///
+    /// \brief The EmbeddingsNet struct
+    /// Network of the m_embParams element, it's loaded in the constructor, in the background or on the first use
+    ///
+    struct EmbeddingsNet
+    {
+        std::shared_ptr<EmbeddingsCalculator> m_calc;
+        std::future<bool> m_loading;  // Valid while the background loading isn't joined
+        size_t m_paramsInd = 0;
+        bool m_loaded = false;        // Initialize was finished, the network can be empty after the error
+    };
+    mutable std::vector<EmbeddingsNet> m_embNets;
+    std::vector<TrackerSettings::EmbeddingParams> m_embParams; // Of m_embNets, m_settings has the params of the swapped networks while they are loading
+    std::map<objtype_t, size_t> m_embCalculators; // Object type -> index in m_embNets
+    void LoadEmbeddingsNets(const std::vector<TrackerSettings::EmbeddingParams>& params, int loading,
+                            std::vector<EmbeddingsNet>& nets, std::map<objtype_t, size_t>& calculators) const;
+
+    // Hot swap: the new networks are loaded and warmed up in the background, the working ones are used until the swap between the frames
+    std::vector<EmbeddingsNet> m_swapNets;
+    std::vector<TrackerSettings::EmbeddingParams> m_swapParams;
+    std::map<objtype_t, size_t> m_swapCalculators;
+    bool m_swapping = false;
+    std::future<void> m_netsRelease; // The old networks are released in the background
+    EmbeddingsCalculator* GetEmbeddingsCalculator(objtype_t type) const;
+    mutable RegionHistograms m_regionHists;
+    mutable std::mutex m_embMutex; // Histograms buffers and networks of the calculators aren't reentrant: CalcEmbeddings can be called from another thread
+
+    FrameArena m_frameArena;     // Scratch vectors of one Update, it's reset at the end of Update
+    distMatrix_t m_costMatrix;
+    assignments_t m_assignment;  // Regions -> tracks
 
-    void CreateDistaceMatrix(const regions_t& regions, const std::vector<RegionEmbedding>& regionEmbeddings, distMatrix_t& costMatrix, track_t maxPossibleCost, track_t& maxCost);
-    void UpdateTrackingState(const regions_t& regions, cv::UMat currFrame, float fps);
-	void CalcEmbeddins(std::vector<RegionEmbedding>& regionEmbeddings, const regions_t& regions, cv::UMat currFrame) const;
+    SpatialGrid m_regionsGrid;
+    DynamicSpatialGrid<track_id_t, size_t> m_tracksGrid; // Centers of the tracks after the Update -> the index in m_tracks
+    void IndexTracks(cv::Size frameSize);
+    SparsePairs m_sparsePairs;
+    TracksHotStore m_tracksHot;
+    std::vector<bool> m_regionsUsed;
+    std::shared_ptr<KalmanBatch> m_kalmanBatch; // Shared by the tracks with the constant velocity linear Kalman
+    StaticSnapshot::Settings m_staticSnapshot;  // Memory budget is shared by the snapshots of all static tracks
+    std::shared_ptr<FramePyramid> m_framePyramid; // Shared by the visual trackers of the lost tracks
+    std::shared_ptr<VisualTrackersPool> m_trackersPool; // Released OpenCV trackers of the lost tracks
+
+    // Budget of the visual trackers for the lost tracks: the lost tracks are updated first in the order of priority
+    std::vector<ptrdiff_t> m_updateOrder;
+    std::vector<char> m_externalTrackerAllowed;
+    std::vector<std::pair<track_t, ptrdiff_t>> m_lostPriorities;
+    void ScheduleLostTracks(const assignments_t& assignment, cv::Size frameSize);
+
+    // Lost tracks propagation for tracking::TrackBatchedLK and TrackBatchedMOSSE
+    std::unique_ptr<LostTracksFlow> m_lostFlow;
+    std::unique_ptr<LostTracksCorrelation> m_lostCorrelation;
+    std::vector<size_t> m_lostInds;
+    std::vector<track_id_t> m_lostIds;
+    std::vector<cv::RotatedRect> m_lostRects;
+    std::vector<cv::RotatedRect> m_lostTracked;
+    std::vector<char> m_lostFound;
+
+    distMatrix_t m_cosineDists;         // Tracks x regions in the cost matrix layout, negative if the pair hasn't embeddings
+    cv::Mat m_tracksEmb;
+    cv::Mat m_regionsEmb;
+    cv::Mat m_embDots;
+
+    distMatrix_t m_histDists;           // Tracks x regions, it's calculated for the dense matrix without the spatial gating
+    cv::Mat m_tracksHist;
+    cv::Mat m_regionsHist;
+    cv::Mat m_histDots;
+
+    // Distances between the track and the regions: cols == nullptr means all regions
+    typedef track_t (CTracker::*DistRowFunc)(size_t i, const regions_t& regions, const std::vector<RegionEmbedding>& regionEmbeddings,
+                                             const int* cols, size_t colsCount, distMatrix_t& costMatrix, track_t maxPossibleCost) const;
+    DistRowFunc m_distRow = nullptr; // Specialization for the enabled distances
+
+    template<unsigned DISTS>
+    track_t CalcDistRow(size_t i, const regions_t& regions, const std::vector<RegionEmbedding>& regionEmbeddings,
+                        const int* cols, size_t colsCount, distMatrix_t& costMatrix, track_t maxPossibleCost) const;
+    template<unsigned... DISTS>
+    static DistRowFunc SelectDistRow(unsigned dists, std::integer_sequence<unsigned, DISTS...>);
+
+    void CreateDistaceMatrix(const regions_t& regions, const std::vector<RegionEmbedding>& regionEmbeddings, distMatrix_t& costMatrix, track_t maxPossibleCost, track_t& maxCost, cv::Size frameSize);
+    void CalcCosineMatrix(const regions_t& regions, const std::vector<RegionEmbedding>& regionEmbeddings);
+    void CalcHistMatrix(const regions_t& regions, const std::vector<RegionEmbedding>& regionEmbeddings);
+    void UpdateFrames(const regions_t& regions, const std::vector<RegionEmbedding>& regionEmbeddings, cv::UMat currFrame, cv::UMat workFrame, float fps);
+    void UpdateTrackingState(const regions_t& regions, const std::vector<RegionEmbedding>& regionEmbeddings, cv::UMat currFrame, cv::UMat workFrame, float fps);
+	void CalcEmbeddins(std::vector<RegionEmbedding>& regionEmbeddings, const regions_t& regions, cv::UMat currFrame, const std::vector<char>* needEmbeddings = nullptr) const;
+
+    // Lazy re-ID: regions that need the embeddings after the geometric association
+    std::vector<char> m_needEmbeddings;
+    std::vector<int> m_trackCandidates;
+    std::vector<int> m_regionCandidates;
+    std::vector<int> m_regionTrack;
+    std::vector<track_t> m_regionIoU;
+    size_t SelectLazyEmbeddings(const regions_t& regions);
+
+    // Level of detail for the static tracks: they are updated without the association between the periodic full updates
+    tracks_t m_parkedTracks;
+    std::vector<size_t> m_parkCandidates;
+    std::vector<std::pair<size_t, int>> m_parkedPairs; // Track and its region or -1
+    std::vector<char> m_claimedRegions;
+    std::vector<char> m_parkedFlags;
+    regions_t m_unparkedRegions;
+    std::vector<RegionEmbedding> m_unparkedEmbeddings;
+    bool ParkStaticTracks(const regions_t& regions, const std::vector<RegionEmbedding>& regionEmbeddings, cv::UMat workFrame, float fps);
+    void UnparkStaticTracks();
 };
 // ----------------------------------------------------------------------
 
+///
+/// \brief InitEmbeddingsCalculator
+/// \param embCalc
+/// \param embParam
+/// \return
+///
+static bool InitEmbeddingsCalculator(EmbeddingsCalculator& embCalc, const TrackerSettings::EmbeddingParams& embParam)
+{
+    if (!embCalc.Initialize(embParam.m_embeddingCfgName, embParam.m_embeddingWeightsName, embParam.m_inputLayer, embParam.m_maxBatch,
+                            embParam.m_dnnBackend, embParam.m_dnnTarget))
+    {
+        std::cerr << "EmbeddingsCalculator initialization error: " << embParam.m_embeddingCfgName << ", " << embParam.m_embeddingWeightsName << std::endl;
+        return false;
+    }
+    embCalc.SetPreprocessing(embParam.m_interpolation, embParam.m_scale, embParam.m_mean, embParam.m_swapRB);
+    return true;
+}
+
 ///
 /// \brief CTracker::CTracker
 /// Tracker. Manage tracks. Create, remove, update.
@@ -52,36 +319,402 @@ private:
 CTracker::CTracker(const TrackerSettings& settings)
     : m_settings(settings)
 {
-    m_SPCalculator.reset();
-    SPSettings spSettings = { settings.m_distThres, 12 };
-    switch (m_settings.m_matchType)
+    m_idAllocator = TrackIDAllocator::CreateAllocator(m_settings);
+    m_SPCalculator = CreateSPCalculator();
+    UpdateDistRow();
+
+    if (m_settings.m_batchedKalman && m_settings.m_kalmanType == tracking::KalmanLinear && !m_settings.m_useAcceleration)
+        m_kalmanBatch = std::make_shared<KalmanBatch>((m_settings.m_filterGoal == tracking::FilterRect) ? 4 : 2, m_settings.m_dt, m_settings.m_accelNoiseMag);
+    CreateReIDGallery();
+
+    m_staticSnapshot.m_margin = m_settings.m_staticSnapshotMargin;
+    m_staticSnapshot.m_scale = m_settings.m_staticSnapshotScale;
+    m_staticSnapshot.m_budget = std::make_shared<StaticSnapshotsBudget>(m_settings.m_staticSnapshotsMaxMem << 20);
+
+    if (m_settings.m_bestCrops)
+        m_bestCrops = std::make_unique<BestCrops>(m_settings);
+    CreateFlightRecorder();
+
+    if ((m_settings.m_lostTrackPyramid || m_settings.m_lostTrackMaxSize > 0) && m_settings.m_filterGoal == tracking::FilterRect && m_settings.m_lostTrackType != tracking::TrackNone)
+        m_framePyramid = std::make_shared<FramePyramid>(m_settings.m_lostTrackPyramid ? m_settings.m_lostTrackMinSize : 0, m_settings.m_lostTrackMaxSize);
+
+    CreateTrackersPool();
+
+    if (m_settings.m_filterGoal == tracking::FilterRect && m_settings.m_lostTrackType == tracking::TrackBatchedLK)
+        m_lostFlow = std::make_unique<LostTracksFlow>(LostTracksFlow::Settings());
+    if (m_settings.m_filterGoal == tracking::FilterRect && m_settings.m_lostTrackType == tracking::TrackBatchedMOSSE)
+        m_lostCorrelation = std::make_unique<LostTracksCorrelation>(LostTracksCorrelation::Settings());
+
+    CreateEmbeddingsNets();
+
+    if (!m_settings.m_checkpointFile.empty())
     {
-    case tracking::MatchHungrian:
-        m_SPCalculator = std::make_unique<SPHungrian>(spSettings);
-        break;
-    case tracking::MatchBipart:
-        m_SPCalculator = std::make_unique<SPBipart>(spSettings);
-        break;
+        if (m_settings.m_checkpointRestore)
+            RestoreCheckpoint();
+        m_checkpointWriter = std::make_unique<checkpoint::BackgroundWriter>(m_settings.m_checkpointFile);
+    }
+}
+
+///
+/// \brief CTracker::~CTracker
+///
+CTracker::~CTracker(void)
+{
+    TrackerMetrics::Instance().m_tracksMemory.Add(-static_cast<int64_t>(m_memoryBytes));
+}
+
+///
+/// \brief CTracker::UpdateDistRow
+/// The mask of the enabled distances selects the kernel of the cost matrix row
+///
+void CTracker::UpdateDistRow()
+{
+    unsigned dists = 0;
+    for (size_t ind = 0; ind < tracking::DistsCount; ++ind)
+    {
+        if (m_settings.m_distType[ind] > 0.0f)
+            dists |= 1u << ind;
+    }
+    m_distRow = SelectDistRow(dists, std::make_integer_sequence<unsigned, 1u << tracking::DistsCount>());
+}
+
+///
+/// \brief CTracker::CreateTrackersPool
+/// The tracks keep the previous pool until their removal
+///
+void CTracker::CreateTrackersPool()
+{
+    m_trackersPool.reset();
+    if (m_settings.m_lostTrackersPoolSize && m_settings.m_filterGoal == tracking::FilterRect)
+    {
+        switch (m_settings.m_lostTrackType)
+        {
+        case tracking::TrackKCF:
+        case tracking::TrackMIL:
+        case tracking::TrackMedianFlow:
+        case tracking::TrackGOTURN:
+        case tracking::TrackCSRT:
+            m_trackersPool = std::make_shared<VisualTrackersPool>(m_settings.m_lostTrackersPoolSize);
+            break;
+        default:
+            break;
+        }
     }
-    assert(m_SPCalculator);
+}
+
+///
+/// \brief SameEmbeddings
+/// \param params1
+/// \param params2
+/// \return true if the networks don't need the reloading
+///
+static bool SameEmbeddings(const std::vector<TrackerSettings::EmbeddingParams>& params1, const std::vector<TrackerSettings::EmbeddingParams>& params2)
+{
+    return std::equal(std::begin(params1), std::end(params1), std::begin(params2), std::end(params2),
+                      [](const TrackerSettings::EmbeddingParams& p1, const TrackerSettings::EmbeddingParams& p2)
+    {
+        return p1.m_embeddingCfgName == p2.m_embeddingCfgName && p1.m_embeddingWeightsName == p2.m_embeddingWeightsName &&
+                p1.m_inputLayer == p2.m_inputLayer && p1.m_objectTypes == p2.m_objectTypes && p1.m_maxBatch == p2.m_maxBatch &&
+                p1.m_dnnTarget == p2.m_dnnTarget && p1.m_dnnBackend == p2.m_dnnBackend;
+    });
+}
+
+///
+/// \brief CTracker::CreateEmbeddingsNets
+///
+void CTracker::CreateEmbeddingsNets()
+{
+    m_embNets.clear();
+    m_embCalculators.clear();
+    m_embParams = m_settings.m_embeddings;
+    LoadEmbeddingsNets(m_embParams, m_settings.m_embeddingsLoading, m_embNets, m_embCalculators);
+}
 
-	for (const auto& embParam : settings.m_embeddings)
+///
+/// \brief CTracker::LoadEmbeddingsNets
+/// \param params
+/// \param loading - as m_embeddingsLoading
+/// \param nets
+/// \param calculators - object type -> index in nets
+///
+void CTracker::LoadEmbeddingsNets(const std::vector<TrackerSettings::EmbeddingParams>& params, int loading,
+                                  std::vector<EmbeddingsNet>& nets, std::map<objtype_t, size_t>& calculators) const
+{
+	// The networks are loaded in parallel with each other and with the detector initialization, the lazy ones wait for the first region of the type
+	for (size_t i = 0; i < params.size(); ++i)
 	{
-		std::shared_ptr<EmbeddingsCalculator> embCalc = std::make_shared<EmbeddingsCalculator>();
-		if (!embCalc->Initialize(embParam.m_embeddingCfgName, embParam.m_embeddingWeightsName, embParam.m_inputLayer))
+		const auto& embParam = params[i];
+		EmbeddingsNet net;
+		net.m_calc = std::make_shared<EmbeddingsCalculator>();
+		net.m_paramsInd = i;
+		switch (loading)
 		{
-			std::cerr << "EmbeddingsCalculator initialization error: " << embParam.m_embeddingCfgName << ", " << embParam.m_embeddingWeightsName << std::endl;
+		case 0:
+			net.m_loaded = true;
+			if (!InitEmbeddingsCalculator(*net.m_calc, embParam))
+				continue;
+			break;
+		case 1:
+			net.m_loading = std::async(std::launch::async, [calc = net.m_calc, embParam]()
+			{
+				TRACE_THREAD_NAME("embeddings_loading");
+				if (!InitEmbeddingsCalculator(*calc, embParam))
+					return false;
+				calc->WarmUp();
+				return true;
+			});
+			break;
+		default:
+			break;
 		}
-		else
+		for (auto objType : embParam.m_objectTypes)
 		{
-			for (auto objType : embParam.m_objectTypes)
-			{
-				m_embCalculators.try_emplace((objtype_t)objType, embCalc);
-			}
+			calculators.try_emplace((objtype_t)objType, nets.size());
 		}
+		nets.emplace_back(std::move(net));
 	}
 }
 
+///
+/// \brief CTracker::StartEmbeddingsSwap
+/// The working networks are used until the new ones are loaded, the tracker without them creates the new ones at once.
+/// m_embMutex must be locked
+///
+void CTracker::StartEmbeddingsSwap()
+{
+    const bool working = !m_embNets.empty() &&
+            std::all_of(std::begin(m_embNets), std::end(m_embNets), [](const EmbeddingsNet& net) { return net.m_loaded; });
+    if (!working)
+    {
+        CreateEmbeddingsNets();
+        return;
+    }
+    // The swap in progress is finished first, SwapEmbeddingsNets starts the loading of the last settings after it
+    if (m_swapping)
+        return;
+
+    m_swapping = true;
+    m_swapParams = m_settings.m_embeddings;
+    m_swapCalculators.clear();
+    LoadEmbeddingsNets(m_swapParams, 1, m_swapNets, m_swapCalculators);
+    std::cout << "CTracker: loading of the new embeddings networks was started" << std::endl;
+}
+
+///
+/// \brief CTracker::SwapEmbeddingsNets
+/// Is called between the frames: the loaded networks replace the working ones. The signatures of the tracks and of the re-ID gallery
+/// are dropped for the types of the network with the other m_embeddingSpace, the old networks are released in the background
+///
+void CTracker::SwapEmbeddingsNets()
+{
+    for (auto& net : m_swapNets)
+    {
+        if (net.m_loading.valid() && net.m_loading.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            return;
+    }
+    for (auto& net : m_swapNets)
+    {
+        if (net.m_loading.valid())
+            net.m_loading.get();
+        net.m_loaded = true;
+    }
+
+    auto ReleaseNets = [this]()
+    {
+        m_netsRelease = std::async(std::launch::async, [](std::vector<EmbeddingsNet> nets)
+        {
+            TRACE_THREAD_NAME("embeddings_release");
+            nets.clear();
+        }, std::move(m_swapNets));
+        m_swapNets.clear();
+        m_swapParams.clear();
+        m_swapCalculators.clear();
+        m_swapping = false;
+    };
+
+    // The settings were changed again while the loading
+    if (!SameEmbeddings(m_swapParams, m_settings.m_embeddings))
+    {
+        ReleaseNets();
+        std::lock_guard<std::mutex> lock(m_embMutex);
+        StartEmbeddingsSwap();
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_embMutex);
+        m_embNets.swap(m_swapNets);
+        m_embParams.swap(m_swapParams);
+        m_embCalculators.swap(m_swapCalculators);
+    }
+
+    // m_swap* have the old networks
+    auto Space = [](const std::vector<EmbeddingsNet>& nets, const std::vector<TrackerSettings::EmbeddingParams>& params,
+                    const std::map<objtype_t, size_t>& calculators, objtype_t type) -> const std::string*
+    {
+        auto it = calculators.find(type);
+        return (it != std::end(calculators)) ? &params[nets[it->second].m_paramsInd].m_embeddingSpace : nullptr;
+    };
+    std::set<objtype_t> resetTypes;
+    for (const auto* calcs : { &m_embCalculators, &m_swapCalculators })
+    {
+        for (const auto& calc : *calcs)
+        {
+            const std::string* oldSpace = Space(m_swapNets, m_swapParams, m_swapCalculators, calc.first);
+            const std::string* newSpace = Space(m_embNets, m_embParams, m_embCalculators, calc.first);
+            if (!oldSpace || !newSpace || oldSpace->empty() || *oldSpace != *newSpace)
+                resetTypes.insert(calc.first);
+        }
+    }
+    for (auto& track : m_tracks)
+    {
+        if (resetTypes.count(track->LastRegion().m_type))
+            track->ResetEmbedding();
+    }
+    if (m_reidGallery)
+    {
+        for (auto type : resetTypes)
+        {
+            m_reidGallery->Clear(type);
+        }
+    }
+
+    ReleaseNets();
+    TrackerMetrics::Instance().m_embeddingsSwaps.Add();
+    std::cout << "CTracker: embeddings networks were swapped, signatures of " << resetTypes.size() << " types were reset" << std::endl;
+}
+
+///
+/// \brief CTracker::GetEmbeddingsCalculator
+/// Waits the background loading or loads the network on the first call, m_embMutex must be locked
+/// \param type
+/// \return nullptr if the type hasn't network or it wasn't loaded
+///
+EmbeddingsCalculator* CTracker::GetEmbeddingsCalculator(objtype_t type) const
+{
+    auto embCalc = m_embCalculators.find(type);
+    if (embCalc == std::end(m_embCalculators))
+        return nullptr;
+
+    EmbeddingsNet& net = m_embNets[embCalc->second];
+    if (!net.m_loaded)
+    {
+        TRACE_SPAN("embeddings_loading", "tracker");
+        if (net.m_loading.valid())
+            net.m_loading.get();
+        else
+            InitEmbeddingsCalculator(*net.m_calc, m_embParams[net.m_paramsInd]);
+        net.m_loaded = true;
+    }
+    return net.m_calc->IsInitialized() ? net.m_calc.get() : nullptr;
+}
+
+///
+/// \brief CTracker::ApplySettings
+/// \param settings
+///
+void CTracker::ApplySettings(const TrackerSettings& settings)
+{
+    std::lock_guard<std::mutex> lock(m_pendingMutex);
+    m_pendingSettings = std::make_unique<TrackerSettings>(settings);
+    m_hasPendingSettings.store(true, std::memory_order_release);
+}
+
+///
+/// \brief CTracker::ApplyPendingSettings
+/// Thresholds are swapped between the frames, the heavy components are recreated only after the change of their parameters,
+/// the embeddings networks are swapped after their loading in the background
+///
+void CTracker::ApplyPendingSettings()
+{
+    if (m_swapping)
+        SwapEmbeddingsNets();
+
+    if (!m_hasPendingSettings.load(std::memory_order_acquire))
+        return;
+
+    std::unique_ptr<TrackerSettings> settings;
+    {
+        std::lock_guard<std::mutex> lock(m_pendingMutex);
+        settings = std::move(m_pendingSettings);
+        m_hasPendingSettings.store(false, std::memory_order_relaxed);
+    }
+    if (!settings)
+        return;
+    TRACE_SPAN("apply_settings", "tracker");
+
+    // Motion model and the frames of the lost tracks are shared by the existing tracks: they are changed only with the new tracker
+    bool needRestart = false;
+    auto KeepValue = [&needRestart](auto& newValue, const auto& currValue)
+    {
+        if (!(newValue == currValue))
+        {
+            newValue = currValue;
+            needRestart = true;
+        }
+    };
+    KeepValue(settings->m_filterGoal, m_settings.m_filterGoal);
+    KeepValue(settings->m_kalmanType, m_settings.m_kalmanType);
+    KeepValue(settings->m_useAcceleration, m_settings.m_useAcceleration);
+    KeepValue(settings->m_dt, m_settings.m_dt);
+    KeepValue(settings->m_accelNoiseMag, m_settings.m_accelNoiseMag);
+    KeepValue(settings->m_batchedKalman, m_settings.m_batchedKalman);
+    KeepValue(settings->m_lostTrackType, m_settings.m_lostTrackType);
+    KeepValue(settings->m_lostTrackPyramid, m_settings.m_lostTrackPyramid);
+    KeepValue(settings->m_lostTrackMinSize, m_settings.m_lostTrackMinSize);
+    KeepValue(settings->m_lostTrackMaxSize, m_settings.m_lostTrackMaxSize);
+    KeepValue(settings->m_processingScale, m_settings.m_processingScale);
+    KeepValue(settings->m_flowWindow, m_settings.m_flowWindow);
+    KeepValue(settings->m_trackIDMode, m_settings.m_trackIDMode);
+    KeepValue(settings->m_streamID, m_settings.m_streamID);
+    KeepValue(settings->m_trackIDAllocator, m_settings.m_trackIDAllocator);
+    if (needRestart)
+        std::cerr << "CTracker::ApplySettings: filter, Kalman, lost track type and track IDs parameters are applied only to the new tracker" << std::endl;
+
+    const bool embeddingsChanged = !SameEmbeddings(m_settings.m_embeddings, settings->m_embeddings);
+    const bool poolChanged = m_settings.m_lostTrackersPoolSize != settings->m_lostTrackersPoolSize;
+
+    // CalcEmbeddings reads the settings from another thread
+    std::lock_guard<std::mutex> lock(m_embMutex);
+    m_settings = std::move(*settings);
+
+    m_SPCalculator = CreateSPCalculator();
+    m_typeGroups.clear();
+    UpdateDistRow();
+
+    m_staticSnapshot.m_margin = m_settings.m_staticSnapshotMargin;
+    m_staticSnapshot.m_scale = m_settings.m_staticSnapshotScale;
+    m_staticSnapshot.m_budget->SetMaxBytes(m_settings.m_staticSnapshotsMaxMem << 20);
+    CreateReIDGallery();
+
+    if (!m_settings.m_bestCrops)
+        m_bestCrops.reset();
+    else if (m_bestCrops)
+        m_bestCrops->ApplySettings(m_settings);
+    else
+        m_bestCrops = std::make_unique<BestCrops>(m_settings);
+    CreateFlightRecorder();
+
+    if (poolChanged)
+        CreateTrackersPool();
+    if (embeddingsChanged)
+        StartEmbeddingsSwap();
+}
+
+///
+/// \brief CTracker::CreateReIDGallery
+/// The gallery keeps the signatures on the settings changes
+///
+void CTracker::CreateReIDGallery()
+{
+    if (!m_settings.m_reidGallerySize)
+        m_reidGallery.reset();
+    else if (m_reidGallery)
+        m_reidGallery->SetParams(m_settings.m_reidGallerySize, m_settings.m_reidGalleryTime, m_settings.m_reidGalleryDist);
+    else
+        m_reidGallery = std::make_unique<ReIDGallery>(m_settings.m_reidGallerySize, m_settings.m_reidGalleryTime, m_settings.m_reidGalleryDist);
+}
+
 ///
     /// \brief CanGrayFrameToTrack
     /// \return
@@ -130,66 +763,406 @@ void CTracker::GetTracks(std::vector<TrackingObject>& tracks) const
 }
 
 ///
-/// \brief GetRemovedTracks
-/// \return
+/// \brief CTracker::QueryTracks
+/// \param query
+/// \param tracks
 ///
-void CTracker::GetRemovedTracks(std::vector<track_id_t>& trackIDs) const
+void CTracker::QueryTracks(const TracksQuery& query, std::vector<TrackingObject>& tracks) const
 {
-    trackIDs.assign(std::begin(m_removedObjects), std::end(m_removedObjects));
+    tracks.clear();
+
+    auto AddTrack = [&](const CTrack& track)
+    {
+        const cv::RotatedRect rrect = track.GetLastRect();
+        if (!query.Match(rrect, track.GetCurrType(), track.GetTrace(), track.IsOutOfTheFrame()))
+            return;
+        tracks.emplace_back(track.ConstructObject(query.m_tailSize));
+        tracks.back().m_lastRobust = query.m_robustOnly;
+    };
+
+    // The spatial query visits only the cells of its area, the index is valid between the Updates
+    if (query.IsSpatial() && !m_tracks.empty() && m_tracksGrid.Size() == m_tracks.size())
+    {
+        std::vector<size_t> inds;
+        m_tracksGrid.Query(query.Area(), [&](const track_id_t& /*id*/, size_t ind, const cv::Point2f& /*pt*/)
+        {
+            inds.push_back(ind);
+        });
+        std::sort(std::begin(inds), std::end(inds));
+        for (size_t ind : inds)
+        {
+            AddTrack(*m_tracks[ind]);
+        }
+        return;
+    }
+
+    for (const auto& track : m_tracks)
+    {
+        AddTrack(*track);
+    }
 }
 
 ///
-/// \brief CTracker::Update
-/// \param regions
-/// \param currFrame
-/// \param fps
+/// \brief CTracker::IndexTracks
+/// The tracks are moved in the grid only when they leave their cells, the removed tracks are removed from it
+/// \param frameSize
 ///
-void CTracker::Update(const regions_t& regions, cv::UMat currFrame, float fps)
+void CTracker::IndexTracks(cv::Size frameSize)
 {
-    m_removedObjects.clear();
+    if (frameSize.empty())
+        return;
 
-    UpdateTrackingState(regions, currFrame, fps);
+    if (frameSize != m_tracksGrid.Area())
+        m_tracksGrid.Reset(frameSize, std::max(16, std::max(frameSize.width, frameSize.height) / 16));
+
+    for (const auto& trackID : m_removedObjects)
+    {
+        m_tracksGrid.Remove(trackID);
+    }
+    for (size_t i = 0; i < m_tracks.size(); ++i)
+    {
+        m_tracksGrid.Update(m_tracks[i]->GetID(), m_tracks[i]->GetLastRect().center, i);
+    }
 
-    currFrame.copyTo(m_prevFrame);
+    // The tracks were replaced without the removal, for example by Deserialize
+    if (m_tracksGrid.Size() != m_tracks.size())
+    {
+        m_tracksGrid.Clear();
+        for (size_t i = 0; i < m_tracks.size(); ++i)
+        {
+            m_tracksGrid.Update(m_tracks[i]->GetID(), m_tracks[i]->GetLastRect().center, i);
+        }
+    }
 }
 
-#define DRAW_DBG_ASSIGNMENT 0
+///
+/// \brief CTracker::PredictedArea
+/// \param track
+/// \return Ellipse where the track is looked for the regions of the next frame
+///
+cv::RotatedRect CTracker::PredictedArea(const CTrack& track) const
+{
+    cv::Size_<track_t> minRadius;
+    if (m_settings.m_minAreaRadiusPix < 0)
+    {
+        minRadius.width = m_settings.m_minAreaRadiusK * track.LastRegion().m_rrect.size.width;
+        minRadius.height = m_settings.m_minAreaRadiusK * track.LastRegion().m_rrect.size.height;
+    }
+    else
+    {
+        minRadius.width = m_settings.m_minAreaRadiusPix;
+        minRadius.height = m_settings.m_minAreaRadiusPix;
+    }
+    return track.CalcPredictionEllipse(minRadius);
+}
 
 ///
-/// \brief CTracker::UpdateTrackingState
-/// \param regions
-/// \param currFrame
-/// \param fps
+/// \brief CTracker::GetPredictedRects
+/// \param rects
 ///
-void CTracker::UpdateTrackingState(const regions_t& regions,
-                                   cv::UMat currFrame,
-                                   float fps)
+void CTracker::GetPredictedRects(std::vector<cv::Rect>& rects) const
 {
-    const size_t N = m_tracks.size();	// Tracking objects
-    const size_t M = regions.size();	// Detections or regions
+    rects.clear();
+    rects.reserve(m_tracks.size());
+    for (const auto& track : m_tracks)
+    {
+        rects.emplace_back(PredictedArea(*track).boundingRect() | track->LastRegion().m_brect);
+    }
+}
 
-    assignments_t assignment(N, -1); // Assignments regions -> tracks
+///
+/// \brief GetRemovedTracks
+/// \return
+///
+void CTracker::GetRemovedTracks(std::vector<track_id_t>& trackIDs) const
+{
+    trackIDs.assign(std::begin(m_removedObjects), std::end(m_removedObjects));
+}
 
-    std::vector<RegionEmbedding> regionEmbeddings;
-    CalcEmbeddins(regionEmbeddings, regions, currFrame);
+///
+/// \brief CTracker::GetTracksDelta
+/// \param delta
+/// \param withTrajectory
+///
+void CTracker::GetTracksDelta(TracksDelta& delta, bool withTrajectory)
+{
+    delta.Clear();
 
-#if DRAW_DBG_ASSIGNMENT
-    cv::Mat dbgAssignment = currFrame.getMat(cv::ACCESS_READ).clone();
+    for (auto& track : m_tracks)
     {
-        cv::Mat foreground(dbgAssignment.size(), CV_8UC1, cv::Scalar(0, 0, 100));
-        for (const auto& track : m_tracks)
-        {
-#if (CV_VERSION_MAJOR < 4)
-            cv::ellipse(foreground, track->GetLastRect(), cv::Scalar(255, 255, 255), CV_FILLED);
-#else
-            cv::ellipse(foreground, track->GetLastRect(), cv::Scalar(255, 255, 255), cv::FILLED);
-#endif
-        }
+        size_t& polledPoints = track->PolledPoints();
+        const size_t tailSize = withTrajectory ? track->NewPointsCount(polledPoints) : 0;
 
-        const int chans = dbgAssignment.channels();
+        if (polledPoints)
+            delta.m_updatedTracks.emplace_back(track->ConstructObject(tailSize));
+        else
+            delta.m_newTracks.emplace_back(track->ConstructObject(tailSize));
+
+        polledPoints = track->TotalPointsCount();
+    }
+
+    if (m_deltaPolled)
+        delta.m_removedTracks.swap(m_removedSincePoll);
+    else
+        m_deltaPolled = true;
+    m_removedSincePoll.clear();
+}
+
+///
+/// \brief CTracker::SetEventsHandler
+/// The current tracks are the created tracks of the first Update with the handler
+/// \param params
+/// \param handler
+///
+void CTracker::SetEventsHandler(const TrackEventsParams& params, TrackEventsHandler handler)
+{
+    if (handler)
+        m_events = std::make_unique<TrackEvents>(params, std::move(handler));
+    else
+        m_events.reset();
+}
+
+///
+/// \brief CTracker::GetTrackCrops
+/// \param crops
+///
+void CTracker::GetTrackCrops(std::vector<TrackCrop>& crops)
+{
+    if (m_bestCrops)
+        m_bestCrops->Collect(crops);
+    else
+        crops.clear();
+}
+
+///
+/// \brief CTracker::CreateFlightRecorder
+/// The recorder keeps the ring on the settings changes
+///
+void CTracker::CreateFlightRecorder()
+{
+    std::lock_guard<std::mutex> lock(m_flightMutex);
+    if (m_settings.m_flightRecorderSeconds <= 0)
+        m_flightRecorder.reset();
+    else if (m_flightRecorder)
+        m_flightRecorder->ApplySettings(m_settings);
+    else
+        m_flightRecorder = std::make_unique<flight::Recorder>(m_settings);
+}
+
+///
+/// \brief CTracker::DumpFlightRecord
+/// \param fileName
+/// \return
+///
+bool CTracker::DumpFlightRecord(const std::string& fileName)
+{
+    std::lock_guard<std::mutex> lock(m_flightMutex);
+    if (!m_flightRecorder)
+    {
+        std::cerr << "CTracker::DumpFlightRecord: the flight recorder is disabled, flight_recorder_seconds = 0" << std::endl;
+        return false;
+    }
+    m_flightRecorder->RequestDump(fileName);
+    return true;
+}
+
+///
+/// \brief CTracker::Update
+/// \param regions
+/// \param currFrame
+/// \param fps
+///
+void CTracker::Update(const regions_t& regions, cv::UMat currFrame, float fps)
+{
+    m_updateStart = std::chrono::steady_clock::now();
+    ApplyPendingSettings();
+    cv::UMat workFrame = WorkFrame(currFrame);
+
+    std::vector<RegionEmbedding> regionEmbeddings;
+    {
+        TRACE_SPAN("embeddings", "tracker");
+        metrics::ScopedTimer timer(TrackerMetrics::Instance().m_embeddings);
+        if (m_settings.m_lazyEmbeddings && m_settings.m_distType[tracking::DistFeatureCos] > 0.0f)
+        {
+            TrackerMetrics::Instance().m_skippedEmbeddings.Add(SelectLazyEmbeddings(regions));
+            CalcEmbeddins(regionEmbeddings, regions, workFrame, &m_needEmbeddings);
+        }
+        else
+        {
+            CalcEmbeddins(regionEmbeddings, regions, workFrame);
+        }
+    }
+
+    UpdateFrames(regions, regionEmbeddings, currFrame, workFrame, fps);
+}
+
+///
+/// \brief CTracker::UpdateAt
+/// \param regions
+/// \param currFrame
+/// \param timestamp
+///
+void CTracker::UpdateAt(const regions_t& regions, cv::UMat currFrame, double timestamp)
+{
+    m_timing.Next(timestamp, m_settings.m_nominalFps);
+
+    m_timeScale = m_timing.TimeScale();
+    m_updateTimestamp = timestamp;
+    Update(regions, currFrame, m_timing.Fps((m_settings.m_nominalFps > 0) ? m_settings.m_nominalFps : 25.f));
+    m_updateTimestamp = -1.;
+    m_timeScale = 1;
+}
+
+///
+/// \brief CTracker::Update
+/// \param regions
+/// \param regionEmbeddings
+/// \param currFrame
+/// \param fps
+///
+void CTracker::Update(const regions_t& regions, const std::vector<RegionEmbedding>& regionEmbeddings, cv::UMat currFrame, float fps)
+{
+    m_updateStart = std::chrono::steady_clock::now();
+    ApplyPendingSettings();
+    UpdateFrames(regions, regionEmbeddings, currFrame, WorkFrame(currFrame), fps);
+}
+
+///
+/// \brief CTracker::WorkFrame
+/// \param currFrame
+/// \return The frame of the image operations: currFrame or its copy on m_processingScale
+///
+cv::UMat CTracker::WorkFrame(cv::UMat currFrame)
+{
+    if (m_settings.m_processingScale >= 1.f)
+        return currFrame;
+
+    TRACE_SPAN("work_frame", "tracker");
+    m_workInd = 1 - m_workInd;
+    ScaleFrame(currFrame, m_settings.m_processingScale, m_workFrames[m_workInd]);
+    return m_workFrames[m_workInd];
+}
+
+///
+/// \brief CTracker::UpdateFrames
+/// \param regions
+/// \param regionEmbeddings
+/// \param currFrame - the geometry of the tracks
+/// \param workFrame - the image operations
+/// \param fps
+///
+void CTracker::UpdateFrames(const regions_t& regions, const std::vector<RegionEmbedding>& regionEmbeddings, cv::UMat currFrame, cv::UMat workFrame, float fps)
+{
+    TRACE_SPAN("tracker_update", "tracker");
+    m_removedObjects.clear();
+
+    const std::vector<RegionEmbedding>* embeddings = &regionEmbeddings;
+    std::vector<RegionEmbedding> newEmbeddings;
+    if (regionEmbeddings.size() != regions.size())
+    {
+        std::cerr << "CTracker::Update: embeddings count " << regionEmbeddings.size() << " != regions count " << regions.size() << ", recalculate them" << std::endl;
+        {
+            TRACE_SPAN("embeddings", "tracker");
+            metrics::ScopedTimer timer(TrackerMetrics::Instance().m_embeddings);
+            CalcEmbeddins(newEmbeddings, regions, workFrame);
+        }
+        embeddings = &newEmbeddings;
+    }
+
+    // The parked static tracks and their regions don't take part in the association
+    if (m_settings.m_staticUpdatePeriod > 1 && ParkStaticTracks(regions, *embeddings, workFrame, fps))
+        UpdateTrackingState(m_unparkedRegions, m_unparkedEmbeddings, currFrame, workFrame, fps);
+    else
+        UpdateTrackingState(regions, *embeddings, currFrame, workFrame, fps);
+    UnparkStaticTracks();
+
+    if (m_events)
+        m_events->Update(m_tracks);
+    if (m_bestCrops)
+        m_bestCrops->Update(m_tracks, currFrame, fps);
+
+    AccountMemory(fps);
+
+    // The batched trackers of the lost tracks read the pixels of the previous frame and the caller can refill
+    // its buffer, so they get the own copy. The other trackers use only the size of the previous frame
+    // and the working frames on m_processingScale are own buffers: keep the header without deep copy
+    if (m_settings.m_lostTrackType == tracking::TrackNone)
+    {
+        m_prevFrame.release();
+    }
+    else if ((m_lostFlow || m_lostCorrelation) && m_settings.m_processingScale >= 1.f)
+    {
+        workFrame.copyTo(m_prevFrameCopy);
+        m_prevFrame = m_prevFrameCopy;
+    }
+    else
+    {
+        m_prevFrame = workFrame;
+    }
+
+    PostCheckpoint();
+
+    if (m_flightRecorder)
+    {
+        // The latency of the Update with the embeddings but without the recording
+        const double latencyMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_updateStart).count();
+        std::lock_guard<std::mutex> lock(m_flightMutex);
+        m_flightRecorder->Add(regions, *embeddings, currFrame, fps, m_updateTimestamp, latencyMs);
+    }
+
+    IndexTracks(currFrame.size());
+
+    if (m_settings.m_publishSnapshots)
+    {
+        TracksQuery query;
+        query.m_tailSize = m_settings.m_snapshotTail;
+        PublishSnapshot(query, m_updateTimestamp);
+    }
+
+    TrackerMetrics::Instance().m_arenaAllocations.Add(m_frameArena.Reset());
+}
+
+#define DRAW_DBG_ASSIGNMENT 0
+
+///
+/// \brief CTracker::UpdateTrackingState
+/// \param regions
+/// \param regionEmbeddings
+/// \param currFrame
+/// \param workFrame
+/// \param fps
+///
+void CTracker::UpdateTrackingState(const regions_t& regions,
+                                   const std::vector<RegionEmbedding>& regionEmbeddings,
+                                   cv::UMat currFrame,
+                                   cv::UMat workFrame,
+                                   float fps)
+{
+    const size_t N = m_tracks.size();	// Tracking objects
+    const size_t M = regions.size();	// Detections or regions
+    TrackerMetrics& trackerMetrics = TrackerMetrics::Instance();
+    if (fps > 0)
+        m_reidTime += 1. / fps;
+
+    assignments_t& assignment = m_assignment;
+    assignment.assign(N, -1);
+
+#if DRAW_DBG_ASSIGNMENT
+    cv::Mat dbgAssignment = exec::MapToHost(currFrame, "CTracker::dbgAssignment").clone();
+    {
+        cv::Mat foreground(dbgAssignment.size(), CV_8UC1, cv::Scalar(0, 0, 100));
+        for (const auto& track : m_tracks)
+        {
+#if (CV_VERSION_MAJOR < 4)
+            cv::ellipse(foreground, track->GetLastRect(), cv::Scalar(255, 255, 255), CV_FILLED);
+#else
+            cv::ellipse(foreground, track->GetLastRect(), cv::Scalar(255, 255, 255), cv::FILLED);
+#endif
+        }
+
+        const int chans = dbgAssignment.channels();
         const int height = dbgAssignment.rows;
-#pragma omp parallel for
-        for (int y = 0; y < height; ++y)
+        tasks::ParallelFor(0, height, [&](int y)
         {
             uchar* imgPtr = dbgAssignment.ptr(y);
             const uchar* frgrndPtr = foreground.ptr(y);
@@ -202,7 +1175,7 @@ void CTracker::UpdateTrackingState(const regions_t& regions,
                 imgPtr += chans;
                 ++frgrndPtr;
             }
-        }
+        });
 
         for (const auto& reg : regions)
         {
@@ -214,13 +1187,35 @@ void CTracker::UpdateTrackingState(const regions_t& regions,
     if (!m_tracks.empty())
     {
         // Distance matrix between all tracks to all regions
-        distMatrix_t costMatrix(N * M);
+        distMatrix_t& costMatrix = m_costMatrix;
+        costMatrix.Assign(N, M, 0);
         const track_t maxPossibleCost = static_cast<track_t>(currFrame.cols * currFrame.rows);
         track_t maxCost = 0;
-        CreateDistaceMatrix(regions, regionEmbeddings, costMatrix, maxPossibleCost, maxCost);
+        {
+            TRACE_SPAN("cost_matrix", "tracker");
+            metrics::ScopedTimer timer(trackerMetrics.m_costMatrix);
+            CreateDistaceMatrix(regions, regionEmbeddings, costMatrix, maxPossibleCost, maxCost, currFrame.size());
+        }
 
         // Solving assignment problem (shortest paths)
-        m_SPCalculator->Solve(costMatrix, N, M, assignment, maxCost);
+        {
+            TRACE_SPAN("solve", "tracker");
+            metrics::ScopedTimer timer(trackerMetrics.m_solve);
+            if (m_settings.m_typeGroupsAssignment)
+            {
+                SolveByTypeGroups(regions, costMatrix, assignment, maxCost);
+            }
+            else
+            {
+                m_trackIDs.clear();
+                for (const auto& track : m_tracks)
+                {
+                    m_trackIDs.emplace_back(track->GetID());
+                }
+                m_SPCalculator->SetTrackIDs(m_trackIDs);
+                m_SPCalculator->Solve(costMatrix, N, M, assignment, maxCost, m_settings.m_useSpatialGating ? &m_sparsePairs : nullptr);
+            }
+        }
 
         // clean assignment from pairs with large distance
         for (size_t i = 0; i < assignment.size(); i++)
@@ -229,9 +1224,9 @@ void CTracker::UpdateTrackingState(const regions_t& regions,
             std::stringstream ss;
             if (assignment[i] != -1)
             {
-                ss << std::fixed << std::setprecision(2) << costMatrix[i + assignment[i] * N];
+                ss << std::fixed << std::setprecision(2) << costMatrix(i, assignment[i]);
 
-				if (costMatrix[i + assignment[i] * N] > m_settings.m_distThres)
+				if (costMatrix(i, assignment[i]) > m_settings.m_distThres)
                 {
                     ss << ">" << m_settings.m_distThres;
                     cv::line(dbgAssignment, m_tracks[i]->GetLastRect().center, regions[assignment[i]].m_rrect.center, cv::Scalar(0, 0, 255), 1);
@@ -246,10 +1241,10 @@ void CTracker::UpdateTrackingState(const regions_t& regions,
 
                 for (size_t ri = 0; ri < regions.size(); ++ri)
                 {
-                    if (ri != assignment[i] && costMatrix[i + ri * N] < 1)
+                    if (ri != assignment[i] && costMatrix(i, ri) < 1)
                     {
                         std::stringstream liness;
-                        liness << std::fixed << std::setprecision(2) << costMatrix[i + ri * N];
+                        liness << std::fixed << std::setprecision(2) << costMatrix(i, ri);
                         auto p1 = m_tracks[i]->GetLastRect().center;
                         auto p2 = regions[ri].m_rrect.center;
                         cv::line(dbgAssignment, p1, p2, cv::Scalar(255, 0, 255), 1);
@@ -263,10 +1258,10 @@ void CTracker::UpdateTrackingState(const regions_t& regions,
                 cv::rectangle(dbgAssignment, m_tracks[i]->LastRegion().m_brect, cv::Scalar(255, 0, 255), 1);
                 for (size_t ri = 0; ri < regions.size(); ++ri)
                 {
-                    if (costMatrix[i + ri * N] < 1)
+                    if (costMatrix(i, ri) < 1)
                     {
                         std::stringstream liness;
-                        liness << std::fixed << std::setprecision(2) << costMatrix[i + ri * N];
+                        liness << std::fixed << std::setprecision(2) << costMatrix(i, ri);
                         auto p1 = m_tracks[i]->GetLastRect().center;
                         auto p2 = regions[ri].m_rrect.center;
                         cv::line(dbgAssignment, p1, p2, cv::Scalar(255, 0, 255), 1);
@@ -283,7 +1278,7 @@ void CTracker::UpdateTrackingState(const regions_t& regions,
 
             if (assignment[i] != -1)
             {
-				if (costMatrix[i + assignment[i] * N] > m_settings.m_distThres)
+				if (costMatrix(i, assignment[i]) > m_settings.m_distThres)
                 {
                     assignment[i] = -1;
                     m_tracks[i]->SkippedFrames()++;
@@ -296,38 +1291,74 @@ void CTracker::UpdateTrackingState(const regions_t& regions,
             }
         }
 
-        // If track didn't get detects long time, remove it.
-        for (size_t i = 0; i < m_tracks.size();)
+        // If track didn't get detects long time, remove it. Alive tracks are compacted in one pass
+        size_t aliveCount = 0;
+        for (size_t i = 0; i < m_tracks.size(); ++i)
         {
             if (m_tracks[i]->SkippedFrames() > m_settings.m_maximumAllowedSkippedFrames ||
 				m_tracks[i]->IsOutOfTheFrame() ||
                     m_tracks[i]->IsStaticTimeout(cvRound(fps * (m_settings.m_maxStaticTime - m_settings.m_minStaticTime))))
             {
                 m_removedObjects.push_back(m_tracks[i]->GetID());
-                m_tracks.erase(m_tracks.begin() + i);
-                assignment.erase(assignment.begin() + i);
+                if (m_deltaPolled && m_tracks[i]->PolledPoints())
+                    m_removedSincePoll.push_back(m_tracks[i]->GetID());
+                if (m_reidGallery && !m_tracks[i]->IsOutOfTheFrame())
+                {
+                    const auto& trackEmbedding = m_tracks[i]->GetRegionEmbedding();
+                    if (!trackEmbedding.m_embedding.empty())
+                        m_reidGallery->Add(m_tracks[i]->GetID(), m_tracks[i]->LastRegion().m_type, trackEmbedding.m_embedding, m_reidTime);
+                }
             }
 			else
 			{
-				++i;
+                if (aliveCount != i)
+                {
+                    m_tracks[aliveCount] = std::move(m_tracks[i]);
+                    assignment[aliveCount] = assignment[i];
+                }
+				++aliveCount;
 			}
         }
+        trackerMetrics.m_removedTracks.Add(m_tracks.size() - aliveCount);
+        m_tracks.resize(aliveCount);
+        assignment.resize(aliveCount);
     }
+    TRACE_SPAN("tracks_update", "tracker");
+    metrics::ScopedTimer tracksUpdateTimer(trackerMetrics.m_tracksUpdate);
 
     // Search for unassigned detects and start new tracks for them.
+    m_regionsUsed.assign(regions.size(), false);
+    for (auto reg : assignment)
+    {
+        if (reg != -1)
+            m_regionsUsed[reg] = true;
+    }
+    const EmbeddingMemory embeddingMemory(m_settings.m_embeddingsEMA, m_settings.m_embeddingsFP16);
     for (size_t i = 0; i < regions.size(); ++i)
     {
-        if (find(assignment.begin(), assignment.end(), i) == assignment.end())
+        if (!m_regionsUsed[i])
         {
+            track_id_t trackID;
+            if (m_reidGallery && !regionEmbeddings.empty() && !regionEmbeddings[i].m_embedding.empty() &&
+                    m_reidGallery->Take(regionEmbeddings[i].m_embedding, regions[i].m_type, m_reidTime, trackID))
+                trackerMetrics.m_reidGalleryHits.Add();
+            else
+                trackID = m_idAllocator->NextID();
             if (regionEmbeddings.empty())
                 m_tracks.push_back(std::make_unique<CTrack>(regions[i],
                                                             m_settings.m_kalmanType,
                                                             m_settings.m_dt,
                                                             m_settings.m_accelNoiseMag,
                                                             m_settings.m_useAcceleration,
-                                                            m_nextTrackID,
+                                                            m_settings.m_kalmanSteadyState,
+                                                            trackID,
                                                             m_settings.m_filterGoal == tracking::FilterRect,
-                                                            m_settings.m_lostTrackType));
+                                                            m_settings.m_lostTrackType,
+                                                            embeddingMemory,
+                                                            m_staticSnapshot,
+                                                            m_kalmanBatch,
+                                                            m_framePyramid,
+                                                            m_trackersPool));
             else
                 m_tracks.push_back(std::make_unique<CTrack>(regions[i],
                                                             regionEmbeddings[i],
@@ -335,17 +1366,68 @@ void CTracker::UpdateTrackingState(const regions_t& regions,
                                                             m_settings.m_dt,
                                                             m_settings.m_accelNoiseMag,
                                                             m_settings.m_useAcceleration,
-                                                            m_nextTrackID,
+                                                            m_settings.m_kalmanSteadyState,
+                                                            trackID,
                                                             m_settings.m_filterGoal == tracking::FilterRect,
-                                                            m_settings.m_lostTrackType));
-            m_nextTrackID = m_nextTrackID.NextID();
+                                                            m_settings.m_lostTrackType,
+                                                            embeddingMemory,
+                                                            m_staticSnapshot,
+                                                            m_kalmanBatch,
+                                                            m_framePyramid,
+                                                            m_trackersPool));
+            trackerMetrics.m_createdTracks.Add();
+        }
+    }
+
+    // The motion models predict on the interval from the previous update
+    for (auto& track : m_tracks)
+    {
+        track->SetTimeScale(m_timeScale);
+        track->SetFrameGeometry(currFrame.size(), m_settings.m_processingScale);
+        track->SetTraceHistory(m_settings.m_traceHistoryError, m_settings.m_traceHistoryLength);
+    }
+
+    // Prediction of the batched Kalman filters in one pass, tracks will only read it
+    if (m_kalmanBatch)
+        m_kalmanBatch->Predict();
+
+    // Levels of the pyramid are calculated by the first visual tracker that needs them
+    if (m_framePyramid)
+        m_framePyramid->Build(workFrame);
+
+    const bool budgeted = (m_settings.m_lostTracksMaxUpdates || m_settings.m_lostTracksTimeBudget > 0) &&
+            m_settings.m_filterGoal == tracking::FilterRect && m_settings.m_lostTrackType != tracking::TrackNone;
+    if (budgeted)
+        ScheduleLostTracks(assignment, currFrame.size());
+    const auto updateStart = std::chrono::steady_clock::now();
+
+    if (m_lostFlow || m_lostCorrelation)
+    {
+        m_lostInds.clear();
+        m_lostIds.clear();
+        m_lostRects.clear();
+        for (size_t i = 0; i < assignment.size(); ++i)
+        {
+            if (assignment[i] == -1 && (!budgeted || m_externalTrackerAllowed[i]))
+            {
+                m_lostInds.push_back(i);
+                m_lostIds.push_back(m_tracks[i]->GetID());
+                m_lostRects.push_back(ScaleRRect(m_tracks[i]->GetLastRect(), m_settings.m_processingScale));
+            }
+        }
+        if (m_lostFlow)
+            m_lostFlow->Track(m_prevFrame, workFrame, m_lostRects, m_lostTracked, m_lostFound);
+        else
+            m_lostCorrelation->Track(m_prevFrame, workFrame, m_lostIds, m_lostRects, m_lostTracked, m_lostFound);
+        for (size_t k = 0; k < m_lostInds.size(); ++k)
+        {
+            if (m_lostFound[k])
+                m_tracks[m_lostInds[k]]->SetBatchedRect(ScaleRRect(m_lostTracked[k], 1.f / m_settings.m_processingScale));
         }
     }
 
     // Update Kalman Filters state
-    const ptrdiff_t stop_i = static_cast<ptrdiff_t>(assignment.size());
-//#pragma omp parallel for
-    for (ptrdiff_t i = 0; i < stop_i; ++i)
+    auto UpdateTrack = [&](ptrdiff_t i)
     {
         // If track updated less than one time, than filter state is not correct.
         if (assignment[i] != -1) // If we have assigned detect, then update using its coordinates,
@@ -355,17 +1437,53 @@ void CTracker::UpdateTrackingState(const regions_t& regions,
             if (regionEmbeddings.empty())
                 m_tracks[i]->Update(regions[assignment[i]],
                         true, m_settings.m_maxTraceLength,
-                        m_prevFrame, currFrame,
+                        m_prevFrame, workFrame,
                         m_settings.m_useAbandonedDetection ? cvRound(m_settings.m_minStaticTime * fps) : 0, m_settings.m_maxSpeedForStatic);
             else
                 m_tracks[i]->Update(regions[assignment[i]], regionEmbeddings[assignment[i]],
                         true, m_settings.m_maxTraceLength,
-                        m_prevFrame, currFrame,
+                        m_prevFrame, workFrame,
                         m_settings.m_useAbandonedDetection ? cvRound(m_settings.m_minStaticTime * fps) : 0, m_settings.m_maxSpeedForStatic);
         }
         else				     // if not continue using predictions
         {
-            m_tracks[i]->Update(CRegion(), false, m_settings.m_maxTraceLength, m_prevFrame, currFrame, 0, m_settings.m_maxSpeedForStatic);
+            bool useExternalTracker = true;
+            if (budgeted)
+            {
+                useExternalTracker = m_externalTrackerAllowed[i] != 0;
+                if (useExternalTracker && m_settings.m_lostTracksTimeBudget > 0)
+                    useExternalTracker = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - updateStart).count() < m_settings.m_lostTracksTimeBudget;
+            }
+            m_tracks[i]->Update(CRegion(), false, m_settings.m_maxTraceLength, m_prevFrame, workFrame, 0, m_settings.m_maxSpeedForStatic, useExternalTracker);
+        }
+    };
+
+    const ptrdiff_t stop_i = static_cast<ptrdiff_t>(assignment.size());
+    if (m_settings.m_parallelTracksUpdate && stop_i > 1)
+    {
+        // Tracks are independent, but all of them read the same frames.
+        // Frames are mapped to the host memory once and the workers don't run OpenCL on the shared buffers.
+        // The host views aren't read here: they only keep the mappings alive until the end of the parallel loop
+        cv::Mat prevFrameMapped;
+        if (!m_prevFrame.empty())
+            prevFrameMapped = exec::MapToHost(m_prevFrame, "CTracker::UpdateTracks(prev)");
+        cv::Mat workFrameMapped = exec::MapToHost(workFrame, "CTracker::UpdateTracks(curr)");
+        tasks::ParallelForRange(0, static_cast<int>(stop_i), [&](int from, int to)
+        {
+            const bool useOCL = cv::ocl::useOpenCL(); // Thread local
+            cv::ocl::setUseOpenCL(false);
+            for (ptrdiff_t i = from; i < to; ++i)
+            {
+                UpdateTrack(budgeted ? m_updateOrder[i] : i);
+            }
+            cv::ocl::setUseOpenCL(useOCL);
+        }, 1);
+    }
+    else
+    {
+        for (ptrdiff_t i = 0; i < stop_i; ++i)
+        {
+            UpdateTrack(budgeted ? m_updateOrder[i] : i);
         }
     }
 
@@ -377,177 +1495,747 @@ void CTracker::UpdateTrackingState(const regions_t& regions,
 }
 
 ///
-/// \brief CTracker::CreateDistaceMatrix
-/// \param regions
-/// \param costMatrix
-/// \param maxPossibleCost
-/// \param maxCost
+/// \brief CTracker::AccountMemory
+/// Memory of the tracks for the metrics and the degradation of the tracks over the budget
+/// \param fps
 ///
-void CTracker::CreateDistaceMatrix(const regions_t& regions,
-                                   const std::vector<RegionEmbedding>& regionEmbeddings,
-                                   distMatrix_t& costMatrix,
-                                   track_t maxPossibleCost,
-                                   track_t& maxCost)
+void CTracker::AccountMemory(float fps)
 {
-    const size_t N = m_tracks.size();	// Tracking objects
-    maxCost = 0;
-
-	for (size_t i = 0; i < N; ++i)
-	{
-		const auto& track = m_tracks[i];
-
-		// Calc predicted area for track
-		cv::Size_<track_t> minRadius;
-		if (m_settings.m_minAreaRadiusPix < 0)
-		{
-			minRadius.width = m_settings.m_minAreaRadiusK * track->LastRegion().m_rrect.size.width;
-			minRadius.height = m_settings.m_minAreaRadiusK * track->LastRegion().m_rrect.size.height;
-		}
-		else
-		{
-			minRadius.width = m_settings.m_minAreaRadiusPix;
-			minRadius.height = m_settings.m_minAreaRadiusPix;
-		}
-		cv::RotatedRect predictedArea = track->CalcPredictionEllipse(minRadius);
-
-		// Calc distance between track and regions
-		for (size_t j = 0; j < regions.size(); ++j)
-		{
-			const auto& reg = regions[j];
+    size_t bytes = 0;
+    for (const auto& track : m_tracks)
+    {
+        bytes += track->MemoryBytes();
+    }
 
-			auto dist = maxPossibleCost;
-			if (m_settings.CheckType(m_tracks[i]->LastRegion().m_type, reg.m_type))
-			{
-				dist = 0;
-				size_t ind = 0;
-				// Euclidean distance between centers
-				if (m_settings.m_distType[ind] > 0.0f && ind == tracking::DistCenters)
-				{
-#if 1
-                    track_t ellipseDist = track->IsInsideArea(reg.m_rrect.center, predictedArea);
-                    if (ellipseDist > 1)
-                        dist += m_settings.m_distType[ind];
-                    else
-                        dist += ellipseDist * m_settings.m_distType[ind];
-#else
-					dist += m_settings.m_distType[ind] * track->CalcDistCenter(reg);
-#endif
-				}
-				++ind;
-
-				// Euclidean distance between bounding rectangles
-				if (m_settings.m_distType[ind] > 0.0f && ind == tracking::DistRects)
-				{
-#if 1
-                    track_t ellipseDist = track->IsInsideArea(reg.m_rrect.center, predictedArea);
-					if (ellipseDist < 1)
-					{
-						track_t dw = track->WidthDist(reg);
-						track_t dh = track->HeightDist(reg);
-						dist += m_settings.m_distType[ind] * (1 - (1 - ellipseDist) * (dw + dh) * 0.5f);
-					}
-					else
-					{
-						dist += m_settings.m_distType[ind];
-					}
-					//std::cout << "dist = " << dist << ", ed = " << ellipseDist << ", dw = " << dw << ", dh = " << dh << std::endl;
-#else
-					dist += m_settings.m_distType[ind] * track->CalcDistRect(reg);
-#endif
-				}
-				++ind;
+    const size_t budget = m_settings.m_tracksMaxMem << 20;
+    if (budget && bytes > budget)
+    {
+        TRACE_SPAN("reduce_memory", "tracker");
 
-				// Intersection over Union, IoU
-				if (m_settings.m_distType[ind] > 0.0f && ind == tracking::DistJaccard)
-					dist += m_settings.m_distType[ind] * track->CalcDistJaccard(reg);
-				++ind;
+        // Lost tracks are degraded first, then the oldest
+        m_memoryOrder.resize(m_tracks.size());
+        std::iota(std::begin(m_memoryOrder), std::end(m_memoryOrder), 0);
+        std::sort(std::begin(m_memoryOrder), std::end(m_memoryOrder), [this](size_t i1, size_t i2)
+        {
+            if (m_tracks[i1]->SkippedFrames() != m_tracks[i2]->SkippedFrames())
+                return m_tracks[i1]->SkippedFrames() > m_tracks[i2]->SkippedFrames();
+            return m_tracks[i1]->TotalPointsCount() > m_tracks[i2]->TotalPointsCount();
+        });
 
-				// Bhatacharia distance between histograms
-				if (m_settings.m_distType[ind] > 0.0f && ind == tracking::DistHist)
+        // The static objects need the trajectory of the min static time
+        const size_t minTraceLen = m_settings.m_useAbandonedDetection ? static_cast<size_t>(std::max(0, cvRound(m_settings.m_minStaticTime * fps))) : 0;
+        size_t reduced = 0;
+        for (int level = 1; level <= 3 && bytes > budget; ++level)
+        {
+            for (size_t i : m_memoryOrder)
+            {
+                if (bytes <= budget)
+                    break;
+                const size_t trackBytes = m_tracks[i]->MemoryBytes();
+                if (m_tracks[i]->ReduceMemory(level, minTraceLen))
                 {
-                    dist += m_settings.m_distType[ind] * track->CalcDistHist(regionEmbeddings[j]);
+                    bytes = bytes - trackBytes + m_tracks[i]->MemoryBytes();
+                    ++reduced;
                 }
-				++ind;
+            }
+        }
+        TrackerMetrics::Instance().m_memoryReductions.Add(reduced);
+    }
 
-				// Cosine distance between embeddings
-                if (m_settings.m_distType[ind] > 0.0f && ind == tracking::DistFeatureCos)
-                {
-                    if (reg.m_type == track->LastRegion().m_type)
-                    {
-                        auto resCos = track->CalcCosine(regionEmbeddings[j]);
-                        if (resCos)
-                        {
-                            dist += m_settings.m_distType[ind] * resCos.value();
-                            //std::cout << "CalcCosine: " << TypeConverter::Type2Str(track->LastRegion().m_type) << ", reg = " << reg.m_brect << ", track = " << track->LastRegion().m_brect << ": res = " << resCos.value() << ", dist = " << dist << std::endl;
-                        }
-                        else
-                        {
-                            dist /= m_settings.m_distType[ind];
-                            //std::cout << "CalcCosine: " << TypeConverter::Type2Str(track->LastRegion().m_type) << ", reg = " << reg.m_brect << ", track = " << track->LastRegion().m_brect << ": res = 1, weight = " << m_settings.m_distType[ind] << ", dist = " << dist << std::endl;
-                        }
-                    }
-                }
-				++ind;
-				assert(ind == tracking::DistsCount);
-			}
+    TrackerMetrics::Instance().m_tracksMemory.Add(static_cast<int64_t>(bytes) - static_cast<int64_t>(m_memoryBytes));
+    m_memoryBytes = bytes;
+}
 
-			costMatrix[i + j * N] = dist;
-			if (dist > maxCost)
-				maxCost = dist;
-		}
-	}
+///
+/// \brief CTracker::MemoryBytes
+/// \return
+///
+size_t CTracker::MemoryBytes() const
+{
+    return m_memoryBytes;
 }
 
 ///
-/// \brief CTracker::CalcEmbeddins
-/// \param regionEmbeddings
-/// \param regions
-/// \param currFrame
+/// \brief CTracker::Serialize
+/// The parked static tracks are returned to m_tracks at the end of Update, so the tracks are all in m_tracks here
+/// \param data
+/// \return
 ///
-void CTracker::CalcEmbeddins(std::vector<RegionEmbedding>& regionEmbeddings, const regions_t& regions, cv::UMat currFrame) const
+bool CTracker::Serialize(std::vector<uchar>& data) const
 {
-    if (!regions.empty())
+    data.clear();
+    checkpoint::Writer writer(data);
+    writer.Header();
+    writer.Pod(static_cast<uint64_t>(m_idAllocator->Peek()));
+    writer.Pod(m_reidTime);
+    writer.Pod(static_cast<uint64_t>(m_tracks.size()));
+    for (const auto& track : m_tracks)
     {
-        regionEmbeddings.resize(regions.size());
-        // Bhatacharia distance between histograms
-        if (m_settings.m_distType[tracking::DistHist] > 0.0f)
-        {
-            for (size_t j = 0; j < regions.size(); ++j)
-            {
-                    int bins = 64;
-                    std::vector<int> histSize;
-                    std::vector<float> ranges;
-                    std::vector<int> channels;
-
-                    for (int i = 0, stop = currFrame.channels(); i < stop; ++i)
-                    {
-                        histSize.push_back(bins);
-                        ranges.push_back(0);
-                        ranges.push_back(255);
-                        channels.push_back(i);
-                    }
+        track->Save(writer, m_settings.m_checkpointTrace);
+    }
+    return true;
+}
 
-                    std::vector<cv::UMat> regROI = { currFrame(regions[j].m_brect) };
-                    cv::calcHist(regROI, channels, cv::Mat(), regionEmbeddings[j].m_hist, histSize, ranges, false);
-                    cv::normalize(regionEmbeddings[j].m_hist, regionEmbeddings[j].m_hist, 0, 1, cv::NORM_MINMAX, -1, cv::Mat());
+///
+/// \brief CTracker::Deserialize
+/// The tracks are created with the current settings and take the state of the checkpoint
+/// \param data
+/// \return
+///
+bool CTracker::Deserialize(const std::vector<uchar>& data)
+{
+    checkpoint::Reader reader(data);
+    uint64_t nextID = 0;
+    double reidTime = 0;
+    uint64_t tracksCount = 0;
+    if (!reader.Header() || !reader.Pod(nextID) || !reader.Pod(reidTime) || !reader.Pod(tracksCount))
+    {
+        std::cerr << "CTracker::Deserialize: wrong header of the checkpoint" << std::endl;
+        return false;
+    }
+
+    const EmbeddingMemory embeddingMemory(m_settings.m_embeddingsEMA, m_settings.m_embeddingsFP16);
+    tracks_t tracks;
+    for (uint64_t i = 0; i < tracksCount; ++i)
+    {
+        tracks.push_back(std::make_unique<CTrack>(CRegion(),
+                                                  m_settings.m_kalmanType,
+                                                  m_settings.m_dt,
+                                                  m_settings.m_accelNoiseMag,
+                                                  m_settings.m_useAcceleration,
+                                                  m_settings.m_kalmanSteadyState,
+                                                  track_id_t(0),
+                                                  m_settings.m_filterGoal == tracking::FilterRect,
+                                                  m_settings.m_lostTrackType,
+                                                  embeddingMemory,
+                                                  m_staticSnapshot,
+                                                  m_kalmanBatch,
+                                                  m_framePyramid,
+                                                  m_trackersPool));
+        if (!tracks.back()->Restore(reader))
+        {
+            std::cerr << "CTracker::Deserialize: the track " << i << " of " << tracksCount << " is corrupted" << std::endl;
+            return false;
+        }
+    }
+
+    m_tracks.swap(tracks);
+    m_idAllocator->Resume(static_cast<track_id_t::value_type>(nextID));
+    m_reidTime = reidTime;
+    m_removedObjects.clear();
+    m_removedSincePoll.clear();
+    m_tracksGrid.Clear();
+    IndexTracks(m_tracksGrid.Area());
+    return true;
+}
+
+///
+/// \brief CTracker::RestoreCheckpoint
+///
+void CTracker::RestoreCheckpoint()
+{
+    std::vector<uchar> data;
+    if (!checkpoint::LoadFile(m_settings.m_checkpointFile, data))
+    {
+        std::cout << "CTracker: checkpoint " << m_settings.m_checkpointFile << " isn't found, the tracker starts without the tracks" << std::endl;
+        return;
+    }
+    if (Deserialize(data))
+        std::cout << "CTracker: " << m_tracks.size() << " tracks are restored from " << m_settings.m_checkpointFile << std::endl;
+}
+
+///
+/// \brief CTracker::PostCheckpoint
+/// The state is copied in the thread of Update, the file is written by the writer thread
+///
+void CTracker::PostCheckpoint()
+{
+    if (!m_checkpointWriter || m_settings.m_checkpointPeriod <= 0)
+        return;
+    if (++m_updatesCount % static_cast<size_t>(m_settings.m_checkpointPeriod) != 0)
+        return;
+
+    TRACE_SPAN("checkpoint", "tracker");
+    if (Serialize(m_checkpointData))
+        m_checkpointWriter->Post(m_checkpointData);
+}
+
+///
+/// \brief CTracker::CreateSPCalculator
+/// \return Solver of the assignment problem by the settings
+///
+std::unique_ptr<ShortPathCalculator> CTracker::CreateSPCalculator() const
+{
+    std::unique_ptr<ShortPathCalculator> spCalculator;
+    SPSettings spSettings = { m_settings.m_distThres, 12 };
+    switch (m_settings.m_matchType)
+    {
+    case tracking::MatchHungrian:
+        spCalculator = std::make_unique<SPHungrian>(spSettings);
+        break;
+    case tracking::MatchBipart:
+        spCalculator = std::make_unique<SPBipart>(spSettings);
+        break;
+    case tracking::MatchLAPJV:
+        spCalculator = std::make_unique<SPLAPJV>(spSettings);
+        break;
+    case tracking::MatchGreedy:
+        spCalculator = std::make_unique<SPGreedy>(spSettings, std::make_unique<SPHungrian>(spSettings));
+        break;
+    case tracking::MatchAuto:
+        spCalculator = std::make_unique<SPAdaptive>(spSettings);
+        break;
+    }
+    assert(spCalculator);
+    if (m_settings.m_splitAssignment)
+        spCalculator = std::make_unique<SPComponents>(spSettings, std::move(spCalculator));
+    return spCalculator;
+}
+
+///
+/// \brief CTracker::SolveByTypeGroups
+/// Types are joined in one group if CheckType allows to match them in any order, so the pairs between
+/// the groups are forbidden and every group is an independent assignment problem
+/// \param regions
+/// \param costMatrix
+/// \param assignment
+/// \param maxCost
+///
+void CTracker::SolveByTypeGroups(const regions_t& regions, const distMatrix_t& costMatrix, assignments_t& assignment, track_t maxCost)
+{
+    const size_t N = m_tracks.size();
+    const size_t M = regions.size();
+    assignment.assign(N, -1);
+
+    // Types of the tracks and regions
+    m_groupTypes.clear();
+    auto AddType = [&](objtype_t type)
+    {
+        if (std::find(std::begin(m_groupTypes), std::end(m_groupTypes), type) == std::end(m_groupTypes))
+            m_groupTypes.push_back(type);
+    };
+    for (size_t i = 0; i < N; ++i)
+    {
+        AddType(m_tracksHot.m_types[i]);
+    }
+    for (size_t j = 0; j < M; ++j)
+    {
+        AddType(regions[j].m_type);
+    }
+
+    // Union-find on the types
+    const size_t typesCount = m_groupTypes.size();
+    m_typeParents.resize(typesCount);
+    for (size_t t = 0; t < typesCount; ++t)
+    {
+        m_typeParents[t] = t;
+    }
+    auto FindRoot = [&](size_t t)
+    {
+        while (m_typeParents[t] != t)
+        {
+            m_typeParents[t] = m_typeParents[m_typeParents[t]];
+            t = m_typeParents[t];
+        }
+        return t;
+    };
+    for (size_t t1 = 0; t1 < typesCount; ++t1)
+    {
+        for (size_t t2 = t1 + 1; t2 < typesCount; ++t2)
+        {
+            if (m_settings.CheckType(m_groupTypes[t1], m_groupTypes[t2]) || m_settings.CheckType(m_groupTypes[t2], m_groupTypes[t1]))
+                m_typeParents[FindRoot(t2)] = FindRoot(t1);
+        }
+    }
+    auto GroupOf = [&](objtype_t type)
+    {
+        return FindRoot(static_cast<size_t>(std::find(std::begin(m_groupTypes), std::end(m_groupTypes), type) - std::begin(m_groupTypes)));
+    };
+
+    // Groups are indexed by the root type, solvers are reused between the frames
+    if (m_typeGroups.size() < typesCount)
+        m_typeGroups.resize(typesCount);
+    for (size_t t = 0; t < typesCount; ++t)
+    {
+        m_typeGroups[t].m_rows.clear();
+        m_typeGroups[t].m_cols.clear();
+    }
+    for (size_t i = 0; i < N; ++i)
+    {
+        m_typeGroups[GroupOf(m_tracksHot.m_types[i])].m_rows.push_back(static_cast<int>(i));
+    }
+    for (size_t j = 0; j < M; ++j)
+    {
+        m_typeGroups[GroupOf(regions[j].m_type)].m_cols.push_back(static_cast<int>(j));
+    }
+
+    tasks::ParallelFor(0, static_cast<int>(typesCount), [&](int t)
+    {
+        TypeGroup& group = m_typeGroups[t];
+        if (group.m_rows.empty() || group.m_cols.empty())
+            return;
+
+        const size_t subN = group.m_rows.size();
+        const size_t subM = group.m_cols.size();
+        group.m_costMatrix.Resize(subN, subM);
+        for (size_t i = 0; i < subN; ++i)
+        {
+            const track_t* costRow = costMatrix.Row(group.m_rows[i]);
+            track_t* groupRow = group.m_costMatrix.Row(i);
+            for (size_t j = 0; j < subM; ++j)
+            {
+                groupRow[j] = costRow[group.m_cols[j]];
+            }
+        }
+        if (!group.m_solver)
+            group.m_solver = CreateSPCalculator();
+        group.m_assignment.assign(subN, -1);
+        group.m_solver->Solve(group.m_costMatrix, subN, subM, group.m_assignment, maxCost, nullptr);
+    }, 1);
+
+    for (size_t t = 0; t < typesCount; ++t)
+    {
+        const TypeGroup& group = m_typeGroups[t];
+        if (group.m_rows.empty() || group.m_cols.empty())
+            continue;
+        for (size_t i = 0; i < group.m_rows.size(); ++i)
+        {
+            if (group.m_assignment[i] >= 0)
+                assignment[group.m_rows[i]] = group.m_cols[group.m_assignment[i]];
+        }
+    }
+}
+
+///
+/// \brief CTracker::SelectDistRow
+/// \param dists - bit mask of the enabled tracking::DistType
+/// \return
+///
+template<unsigned... DISTS>
+CTracker::DistRowFunc CTracker::SelectDistRow(unsigned dists, std::integer_sequence<unsigned, DISTS...>)
+{
+    static constexpr DistRowFunc kernels[] = { &CTracker::CalcDistRow<DISTS>... };
+    return kernels[dists];
+}
+
+///
+/// \brief CTracker::CalcDistRow
+/// Distances between the track and the regions with the compile time set of the enabled terms:
+/// geometry from the hot store, tracks are used only for the histograms
+/// \param i - track index
+/// \param regions
+/// \param regionEmbeddings
+/// \param cols - indexes of the regions or nullptr for all regions
+/// \param colsCount
+/// \param costMatrix
+/// \param maxPossibleCost
+/// \return Maximum distance in the row
+///
+template<unsigned DISTS>
+track_t CTracker::CalcDistRow(size_t i,
+                              const regions_t& regions,
+                              const std::vector<RegionEmbedding>& regionEmbeddings,
+                              const int* cols,
+                              size_t colsCount,
+                              distMatrix_t& costMatrix,
+                              track_t maxPossibleCost) const
+{
+    constexpr bool useCenters = (DISTS & (1u << tracking::DistCenters)) != 0;
+    constexpr bool useRects = (DISTS & (1u << tracking::DistRects)) != 0;
+    constexpr bool useJaccard = (DISTS & (1u << tracking::DistJaccard)) != 0;
+    constexpr bool useHist = (DISTS & (1u << tracking::DistHist)) != 0;
+    constexpr bool useCos = (DISTS & (1u << tracking::DistFeatureCos)) != 0;
+
+    const track_t wCenters = m_settings.m_distType[tracking::DistCenters];
+    const track_t wRects = m_settings.m_distType[tracking::DistRects];
+    const track_t wJaccard = m_settings.m_distType[tracking::DistJaccard];
+    const track_t wHist = m_settings.m_distType[tracking::DistHist];
+    const track_t wCos = m_settings.m_distType[tracking::DistFeatureCos];
+
+    const objtype_t trackType = m_tracksHot.m_types[i];
+    const EllipseTransform& ellipse = m_tracksHot.m_ellipses[i];
+    const cv::Size2f& lastSize = m_tracksHot.m_lastSizes[i];
+    const cv::Rect& lastBRect = m_tracksHot.m_lastBRects[i];
+
+    track_t* costRow = costMatrix.Row(i);
+    const track_t* cosineRow = useCos ? m_cosineDists.Row(i) : nullptr;
+    const track_t* histRow = (useHist && !m_settings.m_useSpatialGating) ? m_histDists.Row(i) : nullptr;
+    track_t rowMaxCost = 0;
+    for (size_t k = 0; k < colsCount; ++k)
+    {
+        const size_t j = cols ? static_cast<size_t>(cols[k]) : k;
+        const auto& reg = regions[j];
+
+        auto dist = maxPossibleCost;
+        if (m_settings.CheckType(trackType, reg.m_type))
+        {
+            dist = 0;
+
+            // One ellipse distance for the centers and rects terms
+            track_t ellipseDist = 0;
+            if constexpr (useCenters || useRects)
+                ellipseDist = DistEllipse(reg.m_rrect.center, ellipse);
+
+            // Euclidean distance between centers
+            if constexpr (useCenters)
+                dist += (ellipseDist > 1) ? wCenters : (ellipseDist * wCenters);
+
+            // Euclidean distance between bounding rectangles
+            if constexpr (useRects)
+            {
+                if (ellipseDist < 1)
+                {
+                    track_t dw = SizeRatio(lastSize.width, reg.m_rrect.size.width);
+                    track_t dh = SizeRatio(lastSize.height, reg.m_rrect.size.height);
+                    dist += wRects * (1 - (1 - ellipseDist) * (dw + dh) * 0.5f);
+                }
+                else
+                {
+                    dist += wRects;
+                }
+            }
+
+            // Intersection over Union, IoU
+            if constexpr (useJaccard)
+                dist += wJaccard * DistJaccard(reg.m_brect, lastBRect);
+
+            // Bhatacharia distance between histograms
+            if constexpr (useHist)
+                dist += wHist * (histRow ? histRow[j] : m_tracks[i]->CalcDistHist(regionEmbeddings[j]));
+
+            // Cosine distance between embeddings
+            if constexpr (useCos)
+            {
+                if (reg.m_type == trackType)
+                {
+                    const track_t resCos = cosineRow[j];
+                    if (resCos >= 0)
+                        dist += wCos * resCos;
+                    else
+                        dist /= wCos;
+                }
+            }
+        }
+        costRow[j] = dist;
+        if (dist > rowMaxCost)
+            rowMaxCost = dist;
+    }
+    return rowMaxCost;
+}
+
+///
+/// \brief CTracker::CreateDistaceMatrix
+/// \param regions
+/// \param costMatrix
+/// \param maxPossibleCost
+/// \param maxCost
+///
+void CTracker::CreateDistaceMatrix(const regions_t& regions,
+                                   const std::vector<RegionEmbedding>& regionEmbeddings,
+                                   distMatrix_t& costMatrix,
+                                   track_t maxPossibleCost,
+                                   track_t& maxCost,
+                                   cv::Size frameSize)
+{
+    const size_t N = m_tracks.size();	// Tracking objects
+    maxCost = 0;
+
+    // Calc predicted area for track
+    auto CalcPredictedArea = [&](const CTrack& track)
+    {
+        return PredictedArea(track);
+    };
+
+    // Rows are independent: every chunk fills own rows and reduces own maximum
+    auto CalcRows = [&](auto CalcRow)
+    {
+        if (m_settings.m_parallelDistMatrix)
+        {
+            std::mutex maxCostMutex;
+            tasks::ParallelForRange(0, static_cast<int>(N), [&](int from, int to)
+            {
+                track_t chunkMaxCost = 0;
+                for (int i = from; i < to; ++i)
+                {
+                    chunkMaxCost = std::max(chunkMaxCost, CalcRow(static_cast<size_t>(i)));
+                }
+                std::lock_guard<std::mutex> lock(maxCostMutex);
+                maxCost = std::max(maxCost, chunkMaxCost);
+            });
+        }
+        else
+        {
+            for (size_t i = 0; i < N; ++i)
+            {
+                maxCost = std::max(maxCost, CalcRow(i));
+            }
+        }
+    };
+
+    // Refresh the hot data of the tracks
+    m_tracksHot.Resize(N);
+    for (size_t i = 0; i < N; ++i)
+    {
+        m_tracksHot.Set(i, m_tracks[i]->LastRegion(), CalcPredictedArea(*m_tracks[i]));
+    }
+
+    if (m_settings.m_distType[tracking::DistFeatureCos] > 0.0f)
+        CalcCosineMatrix(regions, regionEmbeddings);
+
+    if (!m_settings.m_useSpatialGating && m_settings.m_distType[tracking::DistHist] > 0.0f)
+        CalcHistMatrix(regions, regionEmbeddings);
+
+    if (!m_settings.m_useSpatialGating)
+    {
+        CalcRows([&](size_t i)
+        {
+            // Calc distance between track and all regions
+            return (this->*m_distRow)(i, regions, regionEmbeddings, nullptr, regions.size(), costMatrix, maxPossibleCost);
+        });
+        return;
+    }
+
+    // Spatial gating: distances are calculated only for the regions inside the bounding box of the prediction area
+    costMatrix.Fill(maxPossibleCost);
+    m_sparsePairs.Clear();
+
+    int cellSize = 0;
+    for (const auto& reg : regions)
+    {
+        cellSize += std::max(reg.m_brect.width, reg.m_brect.height);
+    }
+    cellSize = std::max(8, regions.empty() ? 0 : cellSize / static_cast<int>(regions.size()));
+    m_regionsGrid.Build(regions, frameSize, cellSize, [](const CRegion& reg) { return reg.m_rrect.center; });
+
+    std::pmr::vector<int> gatedRegions(m_frameArena.Resource());
+    for (size_t i = 0; i < N; ++i)
+    {
+        const cv::RotatedRect& predictedArea = m_tracksHot.m_predictedAreas[i];
+
+        // Bounding box of the ellipse: DistEllipse uses the size as the semi-axes and the angle in radians
+        const track_t cosA = m_tracksHot.m_ellipses[i].m_cosA;
+        const track_t sinA = m_tracksHot.m_ellipses[i].m_sinA;
+        const track_t halfW = sqrtf(sqr(predictedArea.size.width * cosA) + sqr(predictedArea.size.height * sinA));
+        const track_t halfH = sqrtf(sqr(predictedArea.size.width * sinA) + sqr(predictedArea.size.height * cosA));
+        cv::Rect2f gateRect(predictedArea.center.x - halfW, predictedArea.center.y - halfH, 2 * halfW, 2 * halfH);
+
+        gatedRegions.clear();
+        m_regionsGrid.Query(gateRect, [&](size_t j)
+        {
+            if (m_settings.CheckType(m_tracksHot.m_types[i], regions[j].m_type))
+                gatedRegions.push_back(static_cast<int>(j));
+        });
+        std::sort(std::begin(gatedRegions), std::end(gatedRegions));
+
+        for (int j : gatedRegions)
+        {
+            m_sparsePairs.AddCol(j);
+        }
+        m_sparsePairs.FinishRow();
+    }
+
+    CalcRows([&](size_t i)
+    {
+        const int* cols = m_sparsePairs.RowBegin(i);
+        return (this->*m_distRow)(i, regions, regionEmbeddings, cols, static_cast<size_t>(m_sparsePairs.RowEnd(i) - cols), costMatrix, maxPossibleCost);
+    });
+    if (m_sparsePairs.m_cols.size() < N * regions.size())
+        maxCost = std::max(maxCost, maxPossibleCost);
+}
+
+///
+/// \brief CTracker::CalcCosineMatrix
+/// Cosine distances between all tracks and regions: embeddings are stacked in two matrices
+/// and all dot products are one matrix multiplication for each object type
+/// \param regions
+/// \param regionEmbeddings
+///
+void CTracker::CalcCosineMatrix(const regions_t& regions, const std::vector<RegionEmbedding>& regionEmbeddings)
+{
+    const size_t N = m_tracks.size();
+    const size_t M = regions.size();
+    m_cosineDists.Assign(N, M, -1.f);
+
+    // Embeddings of the different types are calculated by the different networks
+    std::pmr::vector<objtype_t> types(m_frameArena.Resource());
+    for (size_t j = 0; j < M; ++j)
+    {
+        if (!regionEmbeddings[j].m_embedding.empty() && std::find(std::begin(types), std::end(types), regions[j].m_type) == std::end(types))
+            types.push_back(regions[j].m_type);
+    }
+
+    std::pmr::vector<size_t> tracksInds(m_frameArena.Resource());
+    std::pmr::vector<size_t> regionsInds(m_frameArena.Resource());
+    for (objtype_t type : types)
+    {
+        regionsInds.clear();
+        size_t embSize = 0;
+        for (size_t j = 0; j < M; ++j)
+        {
+            const cv::Mat& emb = regionEmbeddings[j].m_embedding;
+            if (regions[j].m_type != type || emb.empty())
+                continue;
+            if (!embSize)
+                embSize = emb.total() * emb.channels();
+            if (emb.total() * emb.channels() == embSize)
+                regionsInds.push_back(j);
+        }
+        tracksInds.clear();
+        for (size_t i = 0; i < N; ++i)
+        {
+            const cv::Mat& emb = m_tracks[i]->GetRegionEmbedding().m_embedding;
+            if (m_tracksHot.m_types[i] == type && !emb.empty() && emb.total() * emb.channels() == embSize)
+                tracksInds.push_back(i);
+        }
+        if (tracksInds.empty())
+            continue;
+
+        auto StackRows = [embSize](cv::Mat& dst, const std::pmr::vector<size_t>& inds, auto GetEmbedding)
+        {
+            dst.create(static_cast<int>(inds.size()), static_cast<int>(embSize), CV_32FC1);
+            for (size_t k = 0; k < inds.size(); ++k)
+            {
+                cv::Mat row = dst.row(static_cast<int>(k));
+                GetEmbedding(inds[k]).reshape(1, 1).convertTo(row, CV_32F);
+            }
+        };
+        StackRows(m_tracksEmb, tracksInds, [&](size_t i) { return m_tracks[i]->GetRegionEmbedding().m_embedding; });
+        StackRows(m_regionsEmb, regionsInds, [&](size_t j) { return regionEmbeddings[j].m_embedding; });
+
+        // Dot products of all pairs: tracks x regions
+        cv::gemm(m_tracksEmb, m_regionsEmb, 1., cv::noArray(), 0., m_embDots, cv::GEMM_2_T);
+
+        for (size_t k = 0; k < tracksInds.size(); ++k)
+        {
+            const size_t i = tracksInds[k];
+            const double trackEmbDot = m_tracks[i]->GetRegionEmbedding().m_embDot;
+            const float* dots = m_embDots.ptr<float>(static_cast<int>(k));
+            track_t* cosineRow = m_cosineDists.Row(i);
+            for (size_t l = 0; l < regionsInds.size(); ++l)
+            {
+                const size_t j = regionsInds[l];
+                cosineRow[j] = CTrack::CosineDist(dots[l], regionEmbeddings[j].m_embDot, trackEmbDot);
+            }
+        }
+    }
+}
+
+///
+/// \brief CTracker::CalcHistMatrix
+/// Bhattacharyya distances between all tracks and regions by one matrix multiplication of the square rooted histograms.
+/// It's used for the dense matrix: with the spatial gating the gated pairs are calculated by CTrack::CalcDistHist
+/// \param regions
+/// \param regionEmbeddings
+///
+void CTracker::CalcHistMatrix(const regions_t& regions, const std::vector<RegionEmbedding>& regionEmbeddings)
+{
+    const size_t N = m_tracks.size();
+    const size_t M = regions.size();
+    m_histDists.Assign(N, M, 1.f);
+
+    // The histograms have the same size on the frames of one stream, the others keep the max distance
+    size_t histSize = 0;
+    std::pmr::vector<size_t> regionsInds(m_frameArena.Resource());
+    for (size_t j = 0; j < M; ++j)
+    {
+        const cv::Mat& hist = regionEmbeddings[j].m_hist;
+        if (!histSize && !hist.empty())
+            histSize = hist.total();
+        if (!hist.empty() && hist.total() == histSize)
+            regionsInds.push_back(j);
+    }
+    std::pmr::vector<size_t> tracksInds(m_frameArena.Resource());
+    for (size_t i = 0; i < N; ++i)
+    {
+        const cv::Mat& hist = m_tracks[i]->GetRegionEmbedding().m_hist;
+        if (!hist.empty() && hist.total() == histSize)
+            tracksInds.push_back(i);
+    }
+    if (tracksInds.empty() || regionsInds.empty())
+        return;
+
+    auto StackRows = [histSize](cv::Mat& dst, const std::pmr::vector<size_t>& inds, auto GetHist)
+    {
+        dst.create(static_cast<int>(inds.size()), static_cast<int>(histSize), CV_32FC1);
+        for (size_t k = 0; k < inds.size(); ++k)
+        {
+            cv::Mat row = dst.row(static_cast<int>(k));
+            GetHist(inds[k]).reshape(1, 1).copyTo(row);
+        }
+    };
+    StackRows(m_tracksHist, tracksInds, [&](size_t i) { return m_tracks[i]->GetRegionEmbedding().m_hist; });
+    StackRows(m_regionsHist, regionsInds, [&](size_t j) { return regionEmbeddings[j].m_hist; });
+
+    // Bhattacharyya coefficients of all pairs: tracks x regions
+    cv::gemm(m_tracksHist, m_regionsHist, 1., cv::noArray(), 0., m_histDots, cv::GEMM_2_T);
+
+    for (size_t k = 0; k < tracksInds.size(); ++k)
+    {
+        const float* dots = m_histDots.ptr<float>(static_cast<int>(k));
+        track_t* histRow = m_histDists.Row(tracksInds[k]);
+        for (size_t l = 0; l < regionsInds.size(); ++l)
+        {
+            histRow[regionsInds[l]] = RegionHistograms::Bhattacharyya(dots[l]);
+        }
+    }
+}
+
+///
+/// \brief CTracker::CalcEmbeddins
+/// \param regionEmbeddings
+/// \param regions
+/// \param currFrame - on m_processingScale, the regions are on the original frame
+/// \param needEmbeddings - regions for the cosine distance, all regions if it's empty
+///
+void CTracker::CalcEmbeddins(std::vector<RegionEmbedding>& regionEmbeddings, const regions_t& regions, cv::UMat currFrame, const std::vector<char>* needEmbeddings) const
+{
+    if (!regions.empty())
+    {
+        std::lock_guard<std::mutex> lock(m_embMutex);
+
+        regionEmbeddings.resize(regions.size());
+        // Bhatacharia distance between histograms
+        if (m_settings.m_distType[tracking::DistHist] > 0.0f)
+        {
+            // The frame is quantized once for all regions
+            m_regionHists.Build(currFrame);
+            for (size_t j = 0; j < regions.size(); ++j)
+            {
+                m_regionHists.Calc(ScaleRect(regions[j].m_brect, m_settings.m_processingScale), regionEmbeddings[j].m_hist);
+                RegionHistograms::SqrtNormalize(regionEmbeddings[j].m_hist);
             }
         }
 
         // Cosine distance between embeddings
         if (m_settings.m_distType[tracking::DistFeatureCos] > 0.0f)
         {
+            // Regions are grouped by the calculators: one batch for each network
+            struct EmbeddingsBatch
+            {
+                EmbeddingsCalculator* m_calc = nullptr;
+                std::vector<size_t> m_regions;
+                std::vector<cv::Rect> m_rects;
+                std::vector<cv::Mat> m_embeddings;
+            };
+            std::vector<EmbeddingsBatch> batches;
+
             for (size_t j = 0; j < regions.size(); ++j)
             {
-                if (regionEmbeddings[j].m_embedding.empty())
+                if (regionEmbeddings[j].m_embedding.empty() && (!needEmbeddings || (*needEmbeddings)[j]))
                 {
                     //std::cout << "Search embCalc for " << TypeConverter::Type2Str(regions[j].m_type) << ": ";
-                    auto embCalc = m_embCalculators.find(regions[j].m_type);
-                    if (embCalc != std::end(m_embCalculators))
+                    EmbeddingsCalculator* embCalc = GetEmbeddingsCalculator(regions[j].m_type);
+                    if (embCalc)
                     {
-                        embCalc->second->Calc(currFrame, regions[j].m_brect, regionEmbeddings[j].m_embedding);
-                        regionEmbeddings[j].m_embDot = regionEmbeddings[j].m_embedding.dot(regionEmbeddings[j].m_embedding);
-
-                        //std::cout << "Founded! m_embedding = " << regionEmbeddings[j].m_embedding.size() << ", m_embDot = " << regionEmbeddings[j].m_embDot << std::endl;
+                        auto batch = std::find_if(std::begin(batches), std::end(batches), [&](const EmbeddingsBatch& b) { return b.m_calc == embCalc; });
+                        if (batch == std::end(batches))
+                        {
+                            batches.emplace_back();
+                            batch = std::prev(std::end(batches));
+                            batch->m_calc = embCalc;
+                        }
+                        batch->m_regions.push_back(j);
+                        batch->m_rects.push_back(ScaleRect(regions[j].m_brect, m_settings.m_processingScale));
                     }
                     else
                     {
@@ -555,8 +2243,273 @@ void CTracker::CalcEmbeddins(std::vector<RegionEmbedding>& regionEmbeddings, con
                     }
                 }
             }
+
+            for (auto& batch : batches)
+            {
+                batch.m_calc->Calc(currFrame, batch.m_rects, batch.m_embeddings);
+                for (size_t i = 0; i < batch.m_regions.size(); ++i)
+                {
+                    RegionEmbedding& regEmb = regionEmbeddings[batch.m_regions[i]];
+                    regEmb.m_embedding = batch.m_embeddings[i];
+                    regEmb.m_embDot = regEmb.m_embedding.dot(regEmb.m_embedding);
+
+                    //std::cout << "Founded! m_embedding = " << regEmb.m_embedding.size() << ", m_embDot = " << regEmb.m_embDot << std::endl;
+                }
+            }
+        }
+    }
+}
+
+///
+/// \brief CTracker::SelectLazyEmbeddings
+/// Geometric association by IoU: the region needs the embedding if it hasn't the track candidate (new track),
+/// if it has several candidates or its candidate has several regions or if the IoU of the one to one pair is low
+/// \param regions
+/// \return Count of the regions without embeddings
+///
+size_t CTracker::SelectLazyEmbeddings(const regions_t& regions)
+{
+    const size_t N = m_tracks.size();
+    const size_t M = regions.size();
+    m_needEmbeddings.assign(M, 1);
+    m_trackCandidates.assign(N, 0);
+    m_regionCandidates.assign(M, 0);
+    m_regionTrack.assign(M, -1);
+    m_regionIoU.assign(M, 0.f);
+
+    for (size_t i = 0; i < N; ++i)
+    {
+        const CRegion& trackRegion = m_tracks[i]->LastRegion();
+        const cv::Rect& trackRect = trackRegion.m_brect;
+        for (size_t j = 0; j < M; ++j)
+        {
+            const cv::Rect& regRect = regions[j].m_brect;
+            if (!m_settings.CheckType(trackRegion.m_type, regions[j].m_type) || (trackRect & regRect).empty())
+                continue;
+
+            const track_t iou = 1 - DistJaccard(trackRect, regRect);
+            if (1 - iou >= m_settings.m_distThres)
+                continue;
+
+            ++m_trackCandidates[i];
+            ++m_regionCandidates[j];
+            // Tracks without the signature can't use the cosine distance but the region still needs it for the own track
+            m_regionTrack[j] = m_tracks[i]->GetRegionEmbedding().m_embedding.empty() ? -1 : static_cast<int>(i);
+            m_regionIoU[j] = iou;
+        }
+    }
+
+    size_t skipped = 0;
+    for (size_t j = 0; j < M; ++j)
+    {
+        if (m_regionCandidates[j] == 1 && m_regionTrack[j] >= 0 && m_trackCandidates[m_regionTrack[j]] == 1 &&
+                m_regionIoU[j] >= m_settings.m_lazyEmbeddingsIoU)
+        {
+            m_needEmbeddings[j] = 0;
+            ++skipped;
+        }
+    }
+    return skipped;
+}
+
+///
+/// \brief CTracker::ParkStaticTracks
+/// The static track is parked between the full updates if it's still there: the frame in the snapshot area isn't changed
+/// (or the region of the object is detected without the snapshot) and there are no moving tracks over it.
+/// The region with the high IoU is given to the parked track and removed from the association
+/// \param regions
+/// \param regionEmbeddings
+/// \param workFrame
+/// \param fps
+/// \return true if m_unparkedRegions and m_unparkedEmbeddings are used instead of the all regions
+///
+bool CTracker::ParkStaticTracks(const regions_t& regions, const std::vector<RegionEmbedding>& regionEmbeddings, cv::UMat workFrame, float fps)
+{
+    constexpr track_t minIoU = 0.5f;
+    const int period = m_settings.m_staticUpdatePeriod;
+    const int staticTimeout = cvRound(fps * (m_settings.m_maxStaticTime - m_settings.m_minStaticTime));
+
+    // Timeouted tracks need the full update for the removing
+    m_parkCandidates.clear();
+    for (size_t i = 0; i < m_tracks.size(); ++i)
+    {
+        const CTrack& track = *m_tracks[i];
+        if (track.IsStatic() && (track.StaticFrames() % period) != 0 && !track.IsStaticTimeout(staticTimeout) && !track.StaticRect().empty())
+            m_parkCandidates.push_back(i);
+    }
+    if (m_parkCandidates.empty())
+        return false;
+
+    m_parkedPairs.clear();
+    m_claimedRegions.assign(regions.size(), 0);
+    for (size_t i : m_parkCandidates)
+    {
+        const CTrack& track = *m_tracks[i];
+        const cv::Rect& staticRect = track.StaticRect();
+
+        bool motion = false;
+        for (size_t k = 0; k < m_tracks.size() && !motion; ++k)
+        {
+            motion = !m_tracks[k]->IsStatic() && !(m_tracks[k]->LastRegion().m_brect & staticRect).empty();
+        }
+        if (motion)
+            continue;
+
+        int regionInd = -1;
+        track_t bestIoU = minIoU;
+        for (size_t j = 0; j < regions.size(); ++j)
+        {
+            const cv::Rect& regRect = regions[j].m_brect;
+            if (m_claimedRegions[j] || (regRect & staticRect).empty() || !m_settings.CheckType(track.LastRegion().m_type, regions[j].m_type))
+                continue;
+            const track_t iou = 1 - DistJaccard(regRect, staticRect);
+            if (iou >= bestIoU)
+            {
+                bestIoU = iou;
+                regionInd = static_cast<int>(j);
+            }
         }
+
+        const double diff = track.StaticDiff(workFrame);
+        if ((diff >= 0) ? (diff > m_settings.m_staticMaxDiff) : (regionInd < 0))
+            continue;
+
+        if (regionInd >= 0)
+            m_claimedRegions[regionInd] = 1;
+        m_parkedPairs.emplace_back(i, regionInd);
+    }
+    if (m_parkedPairs.empty())
+        return false;
+
+    m_parkedFlags.assign(m_tracks.size(), 0);
+    for (const auto& parked : m_parkedPairs)
+    {
+        m_tracks[parked.first]->KeepStatic((parked.second >= 0) ? &regions[parked.second] : nullptr);
+        m_parkedFlags[parked.first] = 1;
+    }
+    TrackerMetrics::Instance().m_parkedTracks.Add(m_parkedPairs.size());
+
+    size_t activeCount = 0;
+    for (size_t i = 0; i < m_tracks.size(); ++i)
+    {
+        if (m_parkedFlags[i])
+            m_parkedTracks.push_back(std::move(m_tracks[i]));
+        else
+            m_tracks[activeCount++] = std::move(m_tracks[i]);
     }
+    m_tracks.resize(activeCount);
+
+    m_unparkedRegions.clear();
+    m_unparkedEmbeddings.clear();
+    for (size_t j = 0; j < regions.size(); ++j)
+    {
+        if (m_claimedRegions[j])
+            continue;
+        m_unparkedRegions.push_back(regions[j]);
+        if (!regionEmbeddings.empty())
+            m_unparkedEmbeddings.push_back(regionEmbeddings[j]);
+    }
+    return true;
+}
+
+///
+/// \brief CTracker::UnparkStaticTracks
+///
+void CTracker::UnparkStaticTracks()
+{
+    for (auto& track : m_parkedTracks)
+    {
+        m_tracks.push_back(std::move(track));
+    }
+    m_parkedTracks.clear();
+}
+
+///
+/// \brief CTracker::ScheduleLostTracks
+/// Priority of the lost track for the visual tracker: old tracks are more valuable, recently lost are easier
+/// to restore and tracks near the frame border are probably leaving it
+/// \param assignment
+/// \param frameSize
+///
+void CTracker::ScheduleLostTracks(const assignments_t& assignment, cv::Size frameSize)
+{
+    const size_t tracksCount = assignment.size();
+    m_updateOrder.clear();
+    m_externalTrackerAllowed.assign(tracksCount, 1);
+    m_lostPriorities.clear();
+
+    for (size_t i = 0; i < tracksCount; ++i)
+    {
+        if (assignment[i] != -1)
+            continue;
+
+        const CTrack& track = *m_tracks[i];
+        const track_t age = std::min(1.f, track.TotalPointsCount() / static_cast<track_t>(std::max<size_t>(1, m_settings.m_maxTraceLength)));
+        const track_t fresh = 1.f - track.SkippedFrames() / static_cast<track_t>(m_settings.m_maximumAllowedSkippedFrames + 1);
+        const cv::Rect brect = track.GetLastRect().boundingRect();
+        const int borderDist = std::min(std::min(brect.x, brect.y), std::min(frameSize.width - brect.x - brect.width, frameSize.height - brect.y - brect.height));
+        const track_t inside = std::clamp(borderDist / static_cast<track_t>(std::max(1, std::min(brect.width, brect.height))), 0.f, 1.f);
+
+        m_lostPriorities.emplace_back(age + fresh + inside, static_cast<ptrdiff_t>(i));
+    }
+    std::sort(std::begin(m_lostPriorities), std::end(m_lostPriorities), [](const auto& p1, const auto& p2) { return p1.first > p2.first; });
+
+    for (size_t k = 0; k < m_lostPriorities.size(); ++k)
+    {
+        const ptrdiff_t i = m_lostPriorities[k].second;
+        m_updateOrder.push_back(i);
+        if (m_settings.m_lostTracksMaxUpdates && k >= m_settings.m_lostTracksMaxUpdates)
+            m_externalTrackerAllowed[i] = 0;
+    }
+    for (size_t i = 0; i < tracksCount; ++i)
+    {
+        if (assignment[i] != -1)
+            m_updateOrder.push_back(static_cast<ptrdiff_t>(i));
+    }
+}
+
+///
+/// \brief CTracker::CalcEmbeddings
+/// \param regionEmbeddings
+/// \param regions
+/// \param currFrame
+///
+void CTracker::CalcEmbeddings(std::vector<RegionEmbedding>& regionEmbeddings, const regions_t& regions, cv::UMat currFrame) const
+{
+    regionEmbeddings.clear();
+    // m_processingScale isn't changed by the settings reload
+    cv::UMat workFrame;
+    ScaleFrame(currFrame, m_settings.m_processingScale, workFrame);
+    CalcEmbeddins(regionEmbeddings, regions, workFrame);
+}
+
+///
+/// \brief BaseTracker::PublishSnapshot
+/// \param query
+/// \param timestamp
+///
+void BaseTracker::PublishSnapshot(const TracksQuery& query, double timestamp)
+{
+    // The reader can't get the retired snapshot again, so it's free when it has the only owner.
+    // use_count is a relaxed load: the acquire fence orders the reuse after the reads of the reader
+    // which has released its pointer (the release of shared_ptr decrements the count with acq_rel)
+    std::shared_ptr<TracksSnapshot> snapshot;
+    if (m_retiredSnapshot && m_retiredSnapshot.use_count() == 1)
+    {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        snapshot = std::move(m_retiredSnapshot);
+    }
+    else
+        snapshot = std::make_shared<TracksSnapshot>();
+    m_retiredSnapshot.reset();
+
+    snapshot->m_updateInd = ++m_snapshotsCount;
+    snapshot->m_timestamp = timestamp;
+    QueryTracks(query, snapshot->m_tracks);
+    GetRemovedTracks(snapshot->m_removedTracks);
+
+    std::shared_ptr<const TracksSnapshot> prev = std::atomic_exchange(&m_snapshot, std::shared_ptr<const TracksSnapshot>(snapshot));
+    m_retiredSnapshot = std::const_pointer_cast<TracksSnapshot>(prev);
 }
 
 ///
@@ -564,5 +2517,9 @@ void CTracker::CalcEmbeddins(std::vector<RegionEmbedding>& regionEmbeddings, con
 ///
 std::unique_ptr<BaseTracker> BaseTracker::CreateTracker(const TrackerSettings& settings)
 {
+    if (settings.m_shardsCols * settings.m_shardsRows > 1)
+        return std::make_unique<ShardedTracker>(settings);
+    if (settings.m_flowWindow > 1)
+        return std::make_unique<CFlowTracker>(settings);
     return std::make_unique<CTracker>(settings);
 }
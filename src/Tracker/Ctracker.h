@@ -1,12 +1,253 @@
 #pragma once
 
 #include <vector>
+#include <iostream>
 #include <memory>
+#include <limits>
+#include <algorithm>
+#include <functional>
+#include <atomic>
 
 #include "defines.h"
 #include "trajectory.h"
 #include "TrackerSettings.h"
 
+///
+/// \brief The TracksDelta struct
+/// Changes of the tracks since the previous call of BaseTracker::GetTracksDelta
+///
+struct TracksDelta
+{
+    std::vector<TrackingObject> m_newTracks;     // Tracks created after the previous poll
+    std::vector<TrackingObject> m_updatedTracks; // Current state of the other alive tracks
+    std::vector<track_id_t> m_removedTracks;     // Tracks removed after the previous poll
+
+    ///
+    void Clear()
+    {
+        m_newTracks.clear();
+        m_updatedTracks.clear();
+        m_removedTracks.clear();
+    }
+};
+
+///
+/// \brief The TracksQuery struct
+/// Filter of BaseTracker::QueryTracks: the predicates are checked on the state of the tracks, so the rejected tracks
+/// aren't constructed and the trajectory isn't copied longer than m_tailSize
+///
+struct TracksQuery
+{
+    bool m_robustOnly = false;        // TrackingObject::IsRobust with the parameters below
+    int m_minTraceSize = 0;
+    float m_minRawRatio = 0.f;
+    cv::Size2f m_sizeRatio;           // Range of width/height, 0 - not limited
+    std::vector<objtype_t> m_types;   // Empty - the all types
+    cv::Rect m_roi;                   // Empty - the all frame, else the center of the track is inside
+    std::vector<cv::Point2f> m_polygon; // Empty - not limited, else the center of the track is inside (and inside m_roi)
+    size_t m_tailSize = std::numeric_limits<size_t>::max(); // Last trajectory points of the result, 0 - without trajectory
+
+    ///
+    /// \brief Match
+    /// \return true if the track passes the filter, the cheap predicates are first
+    ///
+    bool Match(const cv::RotatedRect& rrect, objtype_t type, const Trace& trace, bool outOfTheFrame) const
+    {
+        if (!m_types.empty() && std::find(std::begin(m_types), std::end(m_types), type) == std::end(m_types))
+            return false;
+        if (!m_roi.empty() && !cv::Rect2f(m_roi).contains(rrect.center))
+            return false;
+        if (m_polygon.size() > 2 && cv::pointPolygonTest(m_polygon, rrect.center, false) < 0)
+            return false;
+        if (m_robustOnly && !TrackingObject::IsRobust(trace, rrect, outOfTheFrame, m_minTraceSize, m_minRawRatio, m_sizeRatio))
+            return false;
+        return true;
+    }
+
+    ///
+    /// \brief IsSpatial
+    /// \return true if the query is limited by m_roi or m_polygon
+    ///
+    bool IsSpatial() const
+    {
+        return !m_roi.empty() || m_polygon.size() > 2;
+    }
+
+    ///
+    /// \brief Area
+    /// \return Bounding rect of m_roi and m_polygon for the spatial index
+    ///
+    cv::Rect2f Area() const
+    {
+        cv::Rect2f area;
+        if (m_polygon.size() > 2)
+        {
+            cv::Point2f tl = m_polygon.front();
+            cv::Point2f br = m_polygon.front();
+            for (const auto& pt : m_polygon)
+            {
+                tl.x = std::min(tl.x, pt.x);
+                tl.y = std::min(tl.y, pt.y);
+                br.x = std::max(br.x, pt.x);
+                br.y = std::max(br.y, pt.y);
+            }
+            area = cv::Rect2f(tl, br);
+            if (!m_roi.empty())
+                area &= cv::Rect2f(m_roi);
+        }
+        else
+        {
+            area = cv::Rect2f(m_roi);
+        }
+        return area;
+    }
+};
+
+///
+/// \brief The TracksSnapshot struct
+/// Immutable state of the tracks after the Update, see BaseTracker::GetSnapshot
+///
+struct TracksSnapshot
+{
+    uint64_t m_updateInd = 0;                // Count of the Updates with the snapshot
+    double m_timestamp = -1.;                // Of UpdateAt, -1 for Update
+    std::vector<TrackingObject> m_tracks;    // By TracksQuery::m_tailSize = m_snapshotTail
+    std::vector<track_id_t> m_removedTracks; // Removed on this Update
+};
+
+///
+/// \brief The TrackEvent struct
+/// Change of the track state found by the tracker on the Update, see BaseTracker::SetEventsHandler
+///
+struct TrackEvent
+{
+    enum Types
+    {
+        Created = 0,   // New track
+        Robust,        // The track passed TrackingObject::IsRobust with the params of the events for the first time
+        Static,        // The track became static
+        LeftFrame,     // The track went out of the frame
+        Removed,       // The track was removed, m_center is its last center
+        LineCrossed,   // m_areaID is the line, m_direction is the side of the line after the crossing
+        ZoneEntered,   // m_areaID is the zone
+        ZoneLeft
+    };
+    Types m_type = Created;
+    track_id_t m_trackID;
+    objtype_t m_objType = bad_type;
+    cv::Point2f m_center;
+    size_t m_frameInd = 0; // Updates of the tracker after SetEventsHandler
+    int m_areaID = -1;
+    int m_direction = 0;   // 1 - to the right side of the line from m_pt1 to m_pt2 (in the image coordinates), -1 - to the left side
+};
+
+///
+/// \brief The TrackEventsParams struct
+/// Lines and zones are in the pixels of the frames passed to Update
+///
+struct TrackEventsParams
+{
+    struct Line
+    {
+        int m_id = 0;
+        cv::Point2f m_pt1;
+        cv::Point2f m_pt2;
+    };
+    struct Zone
+    {
+        int m_id = 0;
+        std::vector<cv::Point2f> m_polygon;
+    };
+    std::vector<Line> m_lines;
+    std::vector<Zone> m_zones;
+
+    // TrackingObject::IsRobust for TrackEvent::Robust
+    int m_robustMinTraceSize = 10;
+    float m_robustMinRawRatio = 0.5f;
+    cv::Size2f m_robustSizeRatio;
+};
+
+///
+/// Events of the one Update, it's called by the thread of the Update
+///
+typedef std::function<void(const std::vector<TrackEvent>& events)> TrackEventsHandler;
+
+///
+/// \brief The TrackCrop struct
+/// Best crop of the track encoded to JPEG, see TrackerSettings::m_bestCrops
+///
+struct TrackCrop
+{
+    track_id_t m_trackID;
+    objtype_t m_type = bad_type;
+    cv::Rect m_rect;            // Crop on the frame
+    float m_confidence = 0;
+    float m_score = 0;          // Confidence * sqrt(area) * sharpness weight
+    bool m_final = false;       // The track was removed, there will be no better crop
+    std::vector<uchar> m_jpeg;
+};
+
+///
+/// \brief The FrameTiming class
+/// Intervals between the timestamps of the updates: the smoothed rate of the calls for the counters in frames
+/// and the interval in the nominal frames for the motion model
+///
+class FrameTiming
+{
+public:
+    ///
+    /// \brief Next
+    /// \param timestamp - in seconds
+    /// \param nominalFps - 0 for the minimal interval between the timestamps
+    /// \return false for the first timestamp or the timestamp that isn't after the previous one
+    ///
+    bool Next(double timestamp, float nominalFps)
+    {
+        if (!m_started || timestamp <= m_lastTimestamp)
+        {
+            m_started = true;
+            m_lastTimestamp = timestamp;
+            m_timeScale = 1;
+            return false;
+        }
+        const double interval = timestamp - m_lastTimestamp;
+        m_lastTimestamp = timestamp;
+
+        m_minInterval = (m_minInterval > 0) ? std::min(m_minInterval, interval) : interval;
+        m_interval = (m_interval > 0) ? (0.9 * m_interval + 0.1 * interval) : interval;
+
+        const double frameInterval = (nominalFps > 0) ? (1. / nominalFps) : m_minInterval;
+        m_timeScale = static_cast<track_t>(interval / frameInterval);
+        return true;
+    }
+
+    ///
+    /// \brief Fps
+    /// \param defaultFps - before the second timestamp
+    /// \return Smoothed rate of the calls
+    ///
+    float Fps(float defaultFps) const
+    {
+        return (m_interval > 0) ? static_cast<float>(1. / m_interval) : defaultFps;
+    }
+
+    ///
+    /// \brief TimeScale
+    /// \return Last interval in the nominal frames
+    ///
+    track_t TimeScale() const
+    {
+        return m_timeScale;
+    }
+
+private:
+    bool m_started = false;
+    double m_lastTimestamp = 0;
+    double m_minInterval = 0;
+    double m_interval = 0;
+    track_t m_timeScale = 1;
+};
+
 ///
 /// \brief The CTracker class
 ///
@@ -24,11 +265,179 @@ public:
 	}
 
     virtual void Update(const regions_t& regions, cv::UMat currFrame, float fps) = 0;
+    ///
+    /// \brief Update
+    /// \param regions
+    /// \param regionEmbeddings - precomputed by CalcEmbeddings for the same regions and frame
+    /// \param currFrame
+    /// \param fps
+    ///
+    virtual void Update(const regions_t& regions, const std::vector<RegionEmbedding>& regionEmbeddings, cv::UMat currFrame, float fps) = 0;
+    ///
+    /// \brief UpdateAt
+    /// Update by the time of the frame instead of the fps: the detection can skip the frames or run with the irregular rate.
+    /// The motion model predicts the tracks on the real interval from the previous update
+    /// \param regions
+    /// \param currFrame
+    /// \param timestamp - time of the frame in seconds
+    ///
+    virtual void UpdateAt(const regions_t& regions, cv::UMat currFrame, double timestamp) = 0;
+    ///
+    /// \brief CalcEmbeddings
+    /// Histograms and DNN embeddings of the regions for Update. It can be called from another thread
+    /// concurrently with Update, for example right after the detection of the frame
+    /// \param regionEmbeddings
+    /// \param regions
+    /// \param currFrame - the same frame as for Update: color or gray by CanColorFrameToTrack
+    ///
+    virtual void CalcEmbeddings(std::vector<RegionEmbedding>& regionEmbeddings, const regions_t& regions, cv::UMat currFrame) const = 0;
     virtual bool CanGrayFrameToTrack() const = 0;
 	virtual bool CanColorFrameToTrack() const = 0;
 	virtual size_t GetTracksCount() const = 0;
 	virtual void GetTracks(std::vector<TrackingObject>& tracks) const = 0;
+    ///
+    /// \brief QueryTracks
+    /// The tracks which pass the filter, without the construction of the others
+    /// \param query
+    /// \param tracks
+    ///
+    virtual void QueryTracks(const TracksQuery& query, std::vector<TrackingObject>& tracks) const
+    {
+        std::vector<TrackingObject> allTracks;
+        GetTracks(allTracks);
+        tracks.clear();
+        for (auto& track : allTracks)
+        {
+            if (!query.Match(track.m_rrect, track.m_type, track.m_trace, track.m_outOfTheFrame))
+                continue;
+            if (query.m_tailSize < track.m_trace.size())
+                track.m_trace = track.m_trace.Tail(query.m_tailSize);
+            track.m_lastRobust = query.m_robustOnly;
+            tracks.emplace_back(std::move(track));
+        }
+    }
+    ///
+    /// \brief GetPredictedRects
+    /// \param rects - areas where the tracks are expected on the next frame
+    ///
+    virtual void GetPredictedRects(std::vector<cv::Rect>& rects) const
+    {
+        std::vector<TrackingObject> tracks;
+        GetTracks(tracks);
+        rects.clear();
+        for (const auto& track : tracks)
+        {
+            rects.emplace_back(track.m_rrect.boundingRect());
+        }
+    }
     virtual void GetRemovedTracks(std::vector<track_id_t>& trackIDs) const = 0;
+    ///
+    /// \brief GetTracksDelta
+    /// \param delta
+    /// \param withTrajectory - if true then m_trace contains only points added after the previous poll, else it's empty
+    ///
+    virtual void GetTracksDelta(TracksDelta& delta, bool withTrajectory) = 0;
+    ///
+    /// \brief ApplySettings
+    /// New thresholds (distances, gating, skipped frames, trace length etc) are used from the next Update without the loss of the tracks.
+    /// Embeddings networks and the pool of the lost trackers are recreated only after the change of their parameters, the motion model
+    /// and the lost track type parameters are kept until the tracker recreation. It can be called from another thread
+    /// \param settings
+    ///
+    virtual void ApplySettings(const TrackerSettings& settings) = 0;
+    ///
+    /// \brief MemoryBytes
+    /// \return Memory of the tracks after the last Update
+    ///
+    virtual size_t MemoryBytes() const
+    {
+        return 0;
+    }
+    ///
+    /// \brief Serialize
+    /// Checkpoint of the tracks and the IDs for the restart or the failover to the standby process.
+    /// It's called between the Updates and only copies the state, the file is written by checkpoint::BackgroundWriter
+    /// \param data
+    /// \return false if the tracker doesn't support the checkpoints
+    ///
+    virtual bool Serialize(std::vector<uchar>& data) const
+    {
+        data.clear();
+        std::cerr << "Serialize: the tracker doesn't support the checkpoints" << std::endl;
+        return false;
+    }
+    ///
+    /// \brief Deserialize
+    /// The tracks of the checkpoint replace the current tracks, the next IDs continue the IDs of the checkpoint
+    /// \param data
+    /// \return false if the data is corrupted or of the other version, the tracker state isn't changed then
+    ///
+    virtual bool Deserialize(const std::vector<uchar>& data)
+    {
+        std::cerr << "Deserialize: the tracker doesn't support the checkpoints (" << data.size() << " bytes)" << std::endl;
+        return false;
+    }
+
+    ///
+    /// \brief GetTrackCrops
+    /// Crops encoded after the previous call: the track gets the new crop when the best crop wasn't improved for a second
+    /// and when it's removed with a better not encoded crop
+    /// \param crops
+    ///
+    virtual void GetTrackCrops(std::vector<TrackCrop>& crops)
+    {
+        crops.clear();
+    }
+
+    ///
+    /// \brief SetEventsHandler
+    /// The events are found by the tracker from the states of the tracks on the previous Update, the handler is called
+    /// only on the Updates with the events. It's called between the Updates, the empty handler disables the events
+    /// \param params
+    /// \param handler
+    ///
+    virtual void SetEventsHandler(const TrackEventsParams& params, TrackEventsHandler handler)
+    {
+        std::cerr << "SetEventsHandler: the tracker doesn't support the events (" << params.m_lines.size() << " lines, " << (handler ? "set" : "reset") << ")" << std::endl;
+    }
+
+    ///
+    /// \brief DumpFlightRecord
+    /// The last inputs of the flight recorder (m_flightRecorderSeconds) are dumped at the end of the next Update,
+    /// the file is replayed by TrackerBench. It can be called from another thread
+    /// \param fileName - empty for m_flightRecorderFile
+    /// \return false if the recorder is disabled
+    ///
+    virtual bool DumpFlightRecord(const std::string& fileName)
+    {
+        std::cerr << "DumpFlightRecord: the tracker doesn't support the flight recorder (" << fileName << ")" << std::endl;
+        return false;
+    }
+
+    ///
+    /// \brief GetSnapshot
+    /// The last published snapshot (m_publishSnapshots): it can be called from any thread concurrently with Update without the locks,
+    /// the snapshot isn't changed while the reader holds it and the Update doesn't wait for the readers
+    /// \return nullptr before the first Update or without m_publishSnapshots
+    ///
+    std::shared_ptr<const TracksSnapshot> GetSnapshot() const
+    {
+        return std::atomic_load(&m_snapshot);
+    }
 
 	static std::unique_ptr<BaseTracker> CreateTracker(const TrackerSettings& settings);
+
+protected:
+    ///
+    /// \brief PublishSnapshot
+    /// Is called at the end of the Update: the previous snapshot is reused if the readers have released it
+    /// \param query - usually only m_tailSize
+    /// \param timestamp
+    ///
+    void PublishSnapshot(const TracksQuery& query, double timestamp);
+
+private:
+    std::shared_ptr<const TracksSnapshot> m_snapshot;   // Only by std::atomic_load and std::atomic_exchange
+    std::shared_ptr<TracksSnapshot> m_retiredSnapshot;  // Previous snapshot, is reused if there are no readers
+    uint64_t m_snapshotsCount = 0;
 };
@@ -0,0 +1,122 @@
+#pragma once
+#include <cmath>
+#include <algorithm>
+#include "defines.h"
+
+///
+/// \brief The EmbeddingMemory class
+/// Re-ID signature of the track: exponential moving average of the L2 normalized embeddings.
+/// The buffer is allocated once with the first embedding and every next one is blended into it in place.
+/// In FP16 mode the buffer takes half of the memory, the blending is in FP32
+///
+class EmbeddingMemory
+{
+public:
+    ///
+    /// \brief EmbeddingMemory
+    /// \param alpha - weight of the accumulated signature, 0 - the last embedding only
+    /// \param fp16 - store the signature in half precision
+    ///
+    EmbeddingMemory(track_t alpha = 0, bool fp16 = false)
+        : m_alpha(std::min(std::max(alpha, 0.f), 1.f))
+    {
+#if (CV_VERSION_MAJOR >= 4)
+        m_type = fp16 ? CV_16FC1 : CV_32FC1;
+#else
+        (void)fp16; // CV_16F isn't supported by OpenCV 3
+#endif
+    }
+
+    ///
+    /// \brief Update
+    /// \param embedding - new embedding of the track, any float type and shape
+    /// \param signature - values of the signature are written to m_embedding and m_embDot
+    ///
+    void Update(const cv::Mat& embedding, RegionEmbedding& signature)
+    {
+        if (embedding.empty())
+            return;
+
+        cv::Mat src = embedding.reshape(1, 1);
+        if (src.depth() != CV_32F)
+            src.convertTo(src, CV_32F);
+
+        const int embSize = src.cols;
+        const float* srcVals = src.ptr<float>(0);
+
+        double srcDot = 0;
+        for (int k = 0; k < embSize; ++k)
+        {
+            srcDot += srcVals[k] * srcVals[k];
+        }
+        const float srcNorm = static_cast<float>(1. / (std::sqrt(srcDot) + 1e-6));
+
+        // The first embedding or the network was changed: the buffer is allocated again
+        const bool reset = m_signature.cols != embSize || m_signature.rows != 1 || m_signature.type() != m_type;
+        if (reset)
+            m_signature.create(1, embSize, m_type);
+        const float prevK = reset ? 0.f : m_alpha;
+        const float newK = (1.f - prevK) * srcNorm;
+
+        double dot = 0;
+#if (CV_VERSION_MAJOR >= 4)
+        if (m_type == CV_16FC1)
+        {
+            cv::float16_t* vals = m_signature.ptr<cv::float16_t>(0);
+            for (int k = 0; k < embSize; ++k)
+            {
+                const float v = prevK * static_cast<float>(vals[k]) + newK * srcVals[k];
+                vals[k] = cv::float16_t(v);
+                dot += v * v;
+            }
+        }
+        else
+#endif
+        {
+            float* vals = m_signature.ptr<float>(0);
+            for (int k = 0; k < embSize; ++k)
+            {
+                vals[k] = prevK * vals[k] + newK * srcVals[k];
+                dot += vals[k] * vals[k];
+            }
+        }
+
+        signature.m_embedding = m_signature;
+        signature.m_embDot = dot;
+    }
+
+    ///
+    /// \brief Restore
+    /// The accumulated signature of the checkpoint is continued by the next Update
+    /// \param values - the signature in FP32 or FP16
+    /// \param signature
+    ///
+    void Restore(const cv::Mat& values, RegionEmbedding& signature)
+    {
+        if (values.empty())
+            return;
+        values.reshape(1, 1).convertTo(m_signature, m_type);
+
+        cv::Mat vals;
+        m_signature.convertTo(vals, CV_32F);
+        signature.m_embedding = m_signature;
+        signature.m_embDot = vals.dot(vals);
+    }
+
+    ///
+    /// \brief Reset
+    /// The signature of the other feature space isn't continued: the next Update starts the new one
+    /// \param signature
+    ///
+    void Reset(RegionEmbedding& signature)
+    {
+        m_signature.release();
+        signature.m_embedding.release();
+        signature.m_embDot = 0.;
+    }
+
+private:
+    track_t m_alpha = 0;
+    int m_type = CV_32FC1;
+    cv::Mat m_signature;
+};
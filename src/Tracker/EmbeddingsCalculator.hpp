@@ -1,5 +1,9 @@
 #pragma once
 
+#ifdef USE_OCV_EMBEDDINGS
+#include "dnn_mapped.h"
+#endif
+
 ///
 /// \brief The EmbeddingsCalculator class
 ///
@@ -10,20 +14,49 @@ public:
     virtual ~EmbeddingsCalculator() = default;
 
 	///
-	bool Initialize(const std::string& cfgName, const std::string& weightsName, const cv::Size& inputLayer)
+	bool Initialize(const std::string& cfgName, const std::string& weightsName, const cv::Size& inputLayer, size_t maxBatch = 1,
+		            const std::string& dnnBackend = "DNN_BACKEND_INFERENCE_ENGINE", const std::string& dnnTarget = "DNN_TARGET_CPU")
 	{
 #ifdef USE_OCV_EMBEDDINGS
         m_inputLayer = inputLayer;
+        m_maxBatch = std::max<size_t>(1, maxBatch);
 
 #if 1
-		m_net = cv::dnn::readNet(weightsName, cfgName);
+		m_net = dnn_mapped::ReadNet(weightsName, cfgName);
 #else
 		m_net = cv::dnn::readNetFromTensorflow(weightsName, cfgName);
 #endif
 		if (!m_net.empty())
 		{
-			m_net.setPreferableBackend(cv::dnn::DNN_BACKEND_INFERENCE_ENGINE);
-			m_net.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+			std::map<std::string, cv::dnn::Backend> backends;
+			backends["DNN_BACKEND_DEFAULT"] = cv::dnn::DNN_BACKEND_DEFAULT;
+			backends["DNN_BACKEND_INFERENCE_ENGINE"] = cv::dnn::DNN_BACKEND_INFERENCE_ENGINE;
+			backends["DNN_BACKEND_OPENCV"] = cv::dnn::DNN_BACKEND_OPENCV;
+#if (((CV_VERSION_MAJOR == 4) && (CV_VERSION_MINOR >= 2)) || (CV_VERSION_MAJOR > 4))
+			backends["DNN_BACKEND_CUDA"] = cv::dnn::DNN_BACKEND_CUDA;
+#endif
+			auto backend = backends.find(dnnBackend);
+			if (backend != std::end(backends))
+				m_net.setPreferableBackend(backend->second);
+			else
+				std::cerr << "EmbeddingsCalculator: unknown backend " << dnnBackend << std::endl;
+
+			std::map<std::string, cv::dnn::Target> targets;
+			targets["DNN_TARGET_CPU"] = cv::dnn::DNN_TARGET_CPU;
+			targets["DNN_TARGET_OPENCL"] = cv::dnn::DNN_TARGET_OPENCL;
+#if (CV_VERSION_MAJOR >= 4)
+			targets["DNN_TARGET_OPENCL_FP16"] = cv::dnn::DNN_TARGET_OPENCL_FP16;
+			targets["DNN_TARGET_MYRIAD"] = cv::dnn::DNN_TARGET_MYRIAD;
+#endif
+#if (((CV_VERSION_MAJOR == 4) && (CV_VERSION_MINOR >= 2)) || (CV_VERSION_MAJOR > 4))
+			targets["DNN_TARGET_CUDA"] = cv::dnn::DNN_TARGET_CUDA;
+			targets["DNN_TARGET_CUDA_FP16"] = cv::dnn::DNN_TARGET_CUDA_FP16;
+#endif
+			auto target = targets.find(dnnTarget);
+			if (target != std::end(targets))
+				m_net.setPreferableTarget(target->second);
+			else
+				std::cerr << "EmbeddingsCalculator: unknown target " << dnnTarget << std::endl;
 		}
 		return !m_net.empty();
 #else
@@ -42,10 +75,164 @@ public:
 #endif
 	}
 
+	///
+	/// \brief WarmUp
+	/// Forward pass of the full batch: the backend allocates its buffers and compiles the kernels before the first frame,
+	/// it's called in the loading thread of the network
+	///
+	void WarmUp()
+	{
+#ifdef USE_OCV_EMBEDDINGS
+		if (m_net.empty())
+			return;
+		const int sizes[] = { static_cast<int>(m_maxBatch), 3, m_inputLayer.height, m_inputLayer.width };
+		cv::Mat blob(4, sizes, CV_32F, cv::Scalar(0));
+		m_net.setInput(blob);
+		m_net.forward();
+#endif
+	}
+
+	///
+	/// \brief SetPreprocessing
+	/// The input blob is (pixel - mean) * scale like in cv::dnn::blobFromImage
+	/// \param interpolation - cv::InterpolationFlags of the crops resize
+	/// \param scale
+	/// \param mean
+	/// \param swapRB
+	///
+	void SetPreprocessing(int interpolation, double scale, const cv::Scalar& mean, bool swapRB)
+	{
+#ifdef USE_OCV_EMBEDDINGS
+		m_interpolation = interpolation;
+		m_scale = scale;
+		m_mean = mean;
+		m_swapRB = swapRB;
+#endif
+	}
+
 	///
 	void Calc(const cv::UMat& img, cv::Rect rect, cv::Mat& embedding)
     {
 #ifdef USE_OCV_EMBEDDINGS
+		cv::Mat blob;
+		MakeBlob(img, &rect, 1, blob);
+
+		m_net.setInput(blob);
+		embedding = m_net.forward();
+		//std::cout << "embedding: " << embedding.size() << ", chans = " << embedding.channels() << std::endl;
+#else
+        std::cerr << "EmbeddingsCalculator was disabled in CMAKE! Check SetDistances params." << std::endl;
+#endif
+	}
+
+	///
+	/// \brief Calc
+	/// Embeddings for many regions: one forward pass for each m_maxBatch regions
+	/// \param img
+	/// \param rects
+	/// \param embeddings - one row for each rect
+	///
+	void Calc(const cv::UMat& img, const std::vector<cv::Rect>& rects, std::vector<cv::Mat>& embeddings)
+	{
+		embeddings.resize(rects.size());
+#ifdef USE_OCV_EMBEDDINGS
+		if (m_maxBatch < 2)
+		{
+			for (size_t i = 0; i < rects.size(); ++i)
+			{
+				Calc(img, rects[i], embeddings[i]);
+			}
+			return;
+		}
+
+		for (size_t first = 0; first < rects.size(); first += m_maxBatch)
+		{
+			const size_t batchSize = std::min(m_maxBatch, rects.size() - first);
+
+			cv::Mat blob;
+			MakeBlob(img, &rects[first], batchSize, blob);
+
+			m_net.setInput(blob);
+			cv::Mat output = m_net.forward();
+
+			// The first dimension of the output is the batch
+			cv::Mat rows = output.reshape(1, static_cast<int>(batchSize));
+			for (size_t i = 0; i < batchSize; ++i)
+			{
+				embeddings[first + i] = rows.row(static_cast<int>(i)).clone();
+			}
+		}
+#else
+		std::cerr << "EmbeddingsCalculator was disabled in CMAKE! Check SetDistances params." << std::endl;
+#endif
+	}
+
+private:
+#ifdef USE_OCV_EMBEDDINGS
+    cv::dnn::Net m_net;
+    cv::Size m_inputLayer{ 128, 256 };
+    size_t m_maxBatch = 1;
+
+    int m_interpolation = cv::INTER_LINEAR;
+    double m_scale = 1.;
+    cv::Scalar m_mean;
+    bool m_swapRB = false;
+
+    cv::UMat m_stack;   // Resized crops one under another
+    cv::UMat m_stackF;  // Normalized crops
+    std::vector<cv::Mat> m_planes;
+
+	///
+	/// \brief MakeBlob
+	/// The crops are resized into one stack and normalized by one pass on the stack (OpenCL with UMat),
+	/// the stack is mapped to the host once and split to the NCHW planes of the blob
+	/// \param img
+	/// \param rects
+	/// \param batchSize
+	/// \param blob
+	///
+	void MakeBlob(const cv::UMat& img, const cv::Rect* rects, size_t batchSize, cv::Mat& blob)
+	{
+		const int w = m_inputLayer.width;
+		const int h = m_inputLayer.height;
+		m_stack.create(static_cast<int>(batchSize) * h, w, img.type());
+		for (size_t i = 0; i < batchSize; ++i)
+		{
+			cv::Rect rect = rects[i];
+			ClampRect(rect, img.size());
+			cv::UMat dst = m_stack(cv::Rect(0, static_cast<int>(i) * h, w, h));
+			cv::resize(img(rect), dst, m_inputLayer, 0., 0., m_interpolation);
+		}
+		if (m_mean == cv::Scalar())
+		{
+			m_stack.convertTo(m_stackF, CV_32F, m_scale);
+		}
+		else
+		{
+			cv::subtract(m_stack, m_mean, m_stackF, cv::noArray(), CV_32F);
+			if (m_scale != 1.)
+				cv::multiply(m_stackF, cv::Scalar::all(m_scale), m_stackF);
+		}
+
+		cv::Mat stackF = exec::MapToHost(m_stackF, "EmbeddingsCalculator::MakeBlob");
+		const int cn = stackF.channels();
+		const int sizes[] = { static_cast<int>(batchSize), cn, h, w };
+		blob.create(4, sizes, CV_32F);
+		m_planes.resize(cn);
+		for (size_t i = 0; i < batchSize; ++i)
+		{
+			for (int c = 0; c < cn; ++c)
+			{
+				const int dstChannel = (m_swapRB && cn >= 3 && c < 3) ? (2 - c) : c;
+				m_planes[c] = cv::Mat(h, w, CV_32F, blob.ptr<float>(static_cast<int>(i), dstChannel));
+			}
+			cv::split(stackF.rowRange(static_cast<int>(i) * h, static_cast<int>(i + 1) * h), m_planes);
+		}
+	}
+
+	///
+	static void ClampRect(cv::Rect& rect, cv::Size frameSize)
+	{
 		auto Clamp = [](int& v, int& size, int hi) -> int
 		{
 			int res = 0;
@@ -69,24 +256,8 @@ public:
 			}
 			return res;
 		};
-		Clamp(rect.x, rect.width, img.cols);
-		Clamp(rect.y, rect.height, img.rows);
-
-		cv::UMat obj;
-		cv::resize(img(rect), obj, m_inputLayer, 0., 0., cv::INTER_LANCZOS4);
-		cv::Mat blob = cv::dnn::blobFromImage(obj, 1.0, cv::Size(), cv::Scalar(), false, false);
-		
-		m_net.setInput(blob);
-		embedding = m_net.forward();
-		//std::cout << "embedding: " << embedding.size() << ", chans = " << embedding.channels() << std::endl;
-#else
-        std::cerr << "EmbeddingsCalculator was disabled in CMAKE! Check SetDistances params." << std::endl;
-#endif
+		Clamp(rect.x, rect.width, frameSize.width);
+		Clamp(rect.y, rect.height, frameSize.height);
 	}
-
-private:
-#ifdef USE_OCV_EMBEDDINGS
-    cv::dnn::Net m_net;
-    cv::Size m_inputLayer{ 128, 256 };
 #endif
 };
@@ -0,0 +1,91 @@
+#include "EmbeddingsPool.h"
+
+///
+/// \brief EmbeddingsPool::EmbeddingsPool
+/// \param settings
+/// \param workersCount
+///
+EmbeddingsPool::EmbeddingsPool(const TrackerSettings& settings, size_t workersCount)
+    : m_settings(settings)
+{
+    workersCount = std::max<size_t>(1, workersCount);
+    m_workers.reserve(workersCount);
+    for (size_t i = 0; i < workersCount; ++i)
+    {
+        m_workers.emplace_back(&EmbeddingsPool::WorkerThread, this);
+    }
+}
+
+///
+/// \brief EmbeddingsPool::~EmbeddingsPool
+///
+EmbeddingsPool::~EmbeddingsPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cond.notify_all();
+    for (auto& worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+///
+/// \brief EmbeddingsPool::NeedEmbeddings
+/// \param settings
+/// \return
+///
+bool EmbeddingsPool::NeedEmbeddings(const TrackerSettings& settings)
+{
+    return (!settings.m_embeddings.empty() && settings.m_distType[tracking::DistFeatureCos] > 0.0f) ||
+            settings.m_distType[tracking::DistHist] > 0.0f;
+}
+
+///
+/// \brief EmbeddingsPool::Calc
+/// \param regions
+/// \param frame
+/// \return
+///
+std::future<std::vector<RegionEmbedding>> EmbeddingsPool::Calc(const regions_t& regions, cv::UMat frame)
+{
+    std::future<std::vector<RegionEmbedding>> res;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_tasks.emplace_back();
+        Task& task = m_tasks.back();
+        task.m_regions = regions;
+        task.m_frame = frame;
+        res = task.m_result.get_future();
+    }
+    m_cond.notify_one();
+    return res;
+}
+
+///
+/// \brief EmbeddingsPool::WorkerThread
+///
+void EmbeddingsPool::WorkerThread()
+{
+    // The networks of the every worker: they aren't shared between the threads
+    std::unique_ptr<BaseTracker> calculator = BaseTracker::CreateTracker(m_settings);
+
+    for (;;)
+    {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cond.wait(lock, [this]() { return m_stop || !m_tasks.empty(); });
+            if (m_tasks.empty())
+                break;
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+
+        std::vector<RegionEmbedding> embeddings;
+        calculator->CalcEmbeddings(embeddings, task.m_regions, task.m_frame);
+        task.m_result.set_value(std::move(embeddings));
+    }
+}
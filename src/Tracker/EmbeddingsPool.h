@@ -0,0 +1,67 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <future>
+#include <condition_variable>
+
+#include "Ctracker.h"
+
+///
+/// \brief The EmbeddingsPool class
+/// Re-identification networks for the frames of many streams: the every worker thread owns the tracker with the
+/// embeddings networks of the settings and only calculates the region embeddings. The trackers of the streams
+/// get the settings without m_embeddings and the ready embeddings, so the networks are loaded once per pool
+///
+class EmbeddingsPool
+{
+public:
+    ///
+    /// \brief EmbeddingsPool
+    /// \param settings - the tracker settings with the embeddings networks
+    /// \param workersCount - at least 1
+    ///
+    EmbeddingsPool(const TrackerSettings& settings, size_t workersCount);
+    EmbeddingsPool(const EmbeddingsPool&) = delete;
+    EmbeddingsPool& operator=(const EmbeddingsPool&) = delete;
+    ///
+    /// \brief ~EmbeddingsPool
+    /// Queued frames are processed before the stop
+    ///
+    ~EmbeddingsPool();
+
+    ///
+    /// \brief NeedEmbeddings
+    /// \param settings
+    /// \return true if the tracker uses the embeddings or the histograms of the regions
+    ///
+    static bool NeedEmbeddings(const TrackerSettings& settings);
+
+    ///
+    /// \brief Calc
+    /// \param regions
+    /// \param frame - isn't copied, the caller doesn't change it until the future is ready
+    /// \return Embeddings of the regions
+    ///
+    std::future<std::vector<RegionEmbedding>> Calc(const regions_t& regions, cv::UMat frame);
+
+private:
+    struct Task
+    {
+        regions_t m_regions;
+        cv::UMat m_frame;
+        std::promise<std::vector<RegionEmbedding>> m_result;
+    };
+
+    TrackerSettings m_settings;
+    std::deque<Task> m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    bool m_stop = false;
+    std::vector<std::thread> m_workers;
+
+    void WorkerThread();
+};
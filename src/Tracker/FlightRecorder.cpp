@@ -0,0 +1,319 @@
+#include <iostream>
+#include <algorithm>
+#include "FlightRecorder.h"
+#include "TrackerCheckpoint.h"
+#include "trace_events.h"
+
+namespace flight
+{
+///
+/// \brief Record::Bytes
+/// \return
+///
+size_t Record::Bytes() const
+{
+    size_t bytes = m_regions.size() * sizeof(CRegion) + m_frame.total() * m_frame.elemSize();
+    for (const auto& emb : m_embeddings)
+    {
+        bytes += sizeof(RegionEmbedding) + emb.m_hist.total() * emb.m_hist.elemSize() + emb.m_embedding.total() * emb.m_embedding.elemSize();
+    }
+    return bytes;
+}
+
+///
+/// \brief SaveRecord
+/// \param writer
+/// \param record
+///
+static void SaveRecord(checkpoint::Writer& writer, const Record& record)
+{
+    writer.Pod(record.m_updateInd);
+    writer.Pod(record.m_time);
+    writer.Pod(record.m_timestamp);
+    writer.Pod(record.m_fps);
+    writer.Pod(record.m_latencyMs);
+    writer.Pod(static_cast<int32_t>(record.m_frameSize.width));
+    writer.Pod(static_cast<int32_t>(record.m_frameSize.height));
+
+    writer.Pod(static_cast<uint64_t>(record.m_regions.size()));
+    for (const auto& region : record.m_regions)
+    {
+        writer.Pod(region.m_type);
+        writer.RotatedRect(region.m_rrect);
+        writer.Rect(region.m_brect);
+        writer.Pod(region.m_confidence);
+    }
+    writer.Pod(static_cast<uint64_t>(record.m_embeddings.size()));
+    for (const auto& emb : record.m_embeddings)
+    {
+        writer.Mat(emb.m_hist);
+        writer.Mat(emb.m_embedding);
+        writer.Pod(emb.m_embDot);
+    }
+    writer.Mat(record.m_frame);
+}
+
+///
+/// \brief LoadRecord
+/// \param reader
+/// \param record
+/// \return
+///
+static bool LoadRecord(checkpoint::Reader& reader, Record& record)
+{
+    int32_t width = 0;
+    int32_t height = 0;
+    reader.Pod(record.m_updateInd);
+    reader.Pod(record.m_time);
+    reader.Pod(record.m_timestamp);
+    reader.Pod(record.m_fps);
+    reader.Pod(record.m_latencyMs);
+    reader.Pod(width);
+    reader.Pod(height);
+    record.m_frameSize = cv::Size(width, height);
+
+    uint64_t regionsCount = 0;
+    if (!reader.Pod(regionsCount) || regionsCount > (1u << 20))
+        return false;
+    record.m_regions.resize(static_cast<size_t>(regionsCount));
+    for (auto& region : record.m_regions)
+    {
+        reader.Pod(region.m_type);
+        reader.RotatedRect(region.m_rrect);
+        reader.Rect(region.m_brect);
+        reader.Pod(region.m_confidence);
+    }
+    uint64_t embeddingsCount = 0;
+    if (!reader.Pod(embeddingsCount) || (embeddingsCount && embeddingsCount != regionsCount))
+        return false;
+    record.m_embeddings.resize(static_cast<size_t>(embeddingsCount));
+    for (auto& emb : record.m_embeddings)
+    {
+        reader.Mat(emb.m_hist);
+        reader.Mat(emb.m_embedding);
+        reader.Pod(emb.m_embDot);
+    }
+    reader.Mat(record.m_frame);
+    return reader.Ok();
+}
+
+///
+/// \brief Load
+/// \param fileName
+/// \param settingsHash
+/// \param records
+/// \return
+///
+bool Load(const std::string& fileName, uint64_t& settingsHash, std::vector<Record>& records)
+{
+    records.clear();
+    settingsHash = 0;
+
+    std::vector<uchar> data;
+    if (!checkpoint::LoadFile(fileName, data))
+        return false;
+
+    checkpoint::Reader reader(data);
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    uint32_t valueSize = 0;
+    uint64_t recordsCount = 0;
+    if (!reader.Pod(magic) || !reader.Pod(version) || !reader.Pod(valueSize) || !reader.Pod(settingsHash) || !reader.Pod(recordsCount))
+        return false;
+    if (magic != Magic || version != Version || valueSize != sizeof(track_t))
+    {
+        std::cerr << "flight::Load: " << fileName << " isn't the flight record of this version" << std::endl;
+        return false;
+    }
+    records.resize(static_cast<size_t>(std::min<uint64_t>(recordsCount, data.size())));
+    for (auto& record : records)
+    {
+        if (!LoadRecord(reader, record))
+        {
+            std::cerr << "flight::Load: " << fileName << " is corrupted" << std::endl;
+            records.clear();
+            return false;
+        }
+    }
+    return true;
+}
+
+///
+/// \brief Recorder::Recorder
+/// \param settings
+///
+Recorder::Recorder(const TrackerSettings& settings)
+    : m_startTime(std::chrono::steady_clock::now())
+{
+    ApplySettings(settings);
+}
+
+///
+/// \brief Recorder::~Recorder
+/// The written dump is finished
+///
+Recorder::~Recorder()
+{
+    if (m_writeThread.joinable())
+        m_writeThread.join();
+}
+
+///
+/// \brief Recorder::ApplySettings
+/// \param settings
+///
+void Recorder::ApplySettings(const TrackerSettings& settings)
+{
+    m_seconds = std::max<double>(0., settings.m_flightRecorderSeconds);
+    m_frameScale = std::max<double>(0., settings.m_flightRecorderFrameScale);
+    m_maxBytes = settings.m_flightRecorderMaxMem << 20;
+    m_fileName = settings.m_flightRecorderFile;
+    m_sloMs = settings.m_flightRecorderSloMs;
+    m_settingsHash = settings.m_settingsHash;
+    Trim();
+}
+
+///
+/// \brief Recorder::Add
+/// \param regions
+/// \param embeddings
+/// \param currFrame
+/// \param fps
+/// \param timestamp
+/// \param latencyMs
+///
+void Recorder::Add(const regions_t& regions, const std::vector<RegionEmbedding>& embeddings, cv::UMat currFrame, float fps, double timestamp, double latencyMs)
+{
+    TRACE_SPAN("flight_record", "tracker");
+
+    Record record;
+    if (!m_spare.empty())
+    {
+        record = std::move(m_spare.back());
+        m_spare.pop_back();
+    }
+    const auto now = std::chrono::steady_clock::now();
+    record.m_updateInd = m_updatesCount++;
+    record.m_time = std::chrono::duration<double>(now - m_startTime).count();
+    record.m_timestamp = timestamp;
+    record.m_fps = fps;
+    record.m_latencyMs = latencyMs;
+    record.m_frameSize = currFrame.size();
+    record.m_regions.assign(std::begin(regions), std::end(regions));
+
+    // The tracks share the embeddings with the caller, so they are copied
+    record.m_embeddings.resize(embeddings.size());
+    for (size_t i = 0; i < embeddings.size(); ++i)
+    {
+        embeddings[i].m_hist.copyTo(record.m_embeddings[i].m_hist);
+        embeddings[i].m_embedding.copyTo(record.m_embeddings[i].m_embedding);
+        record.m_embeddings[i].m_embDot = embeddings[i].m_embDot;
+    }
+
+    if (m_frameScale <= 0 || currFrame.empty())
+        record.m_frame.release();
+    else if (m_frameScale >= 1.)
+        currFrame.copyTo(record.m_frame);
+    else
+        cv::resize(currFrame, record.m_frame, cv::Size(), m_frameScale, m_frameScale, cv::INTER_AREA);
+
+    m_bytes += record.Bytes();
+    m_records.emplace_back(std::move(record));
+    Trim();
+
+    if (m_writing.load(std::memory_order_acquire))
+        return;
+
+    if (m_hasRequest.load(std::memory_order_acquire))
+    {
+        std::string fileName;
+        {
+            std::lock_guard<std::mutex> lock(m_requestMutex);
+            fileName.swap(m_requestedFile);
+            m_hasRequest.store(false, std::memory_order_relaxed);
+        }
+        Dump(fileName.empty() ? m_fileName : fileName);
+    }
+    else if (m_sloMs > 0 && latencyMs > m_sloMs && m_sloDumps < MaxSloDumps && !m_fileName.empty() &&
+             (!m_sloDumps || std::chrono::duration_cast<std::chrono::milliseconds>(now - m_lastSloDump).count() >= MinDumpIntervalMs))
+    {
+        m_lastSloDump = now;
+        std::string base = m_fileName;
+        if (base.size() > 5 && base.compare(base.size() - 5, 5, ".mtfr") == 0)
+            base.resize(base.size() - 5);
+        std::cerr << "FlightRecorder: update latency " << latencyMs << " ms > " << m_sloMs << " ms" << std::endl;
+        Dump(base + "_" + std::to_string(m_sloDumps++) + ".mtfr");
+    }
+}
+
+///
+/// \brief Recorder::RequestDump
+/// \param fileName
+///
+void Recorder::RequestDump(const std::string& fileName)
+{
+    std::lock_guard<std::mutex> lock(m_requestMutex);
+    m_requestedFile = fileName;
+    m_hasRequest.store(true, std::memory_order_release);
+}
+
+///
+/// \brief Recorder::Trim
+/// The last record is kept
+///
+void Recorder::Trim()
+{
+    constexpr size_t maxSpare = 4;
+
+    while (m_records.size() > 1 &&
+           (m_records.back().m_time - m_records.front().m_time > m_seconds || (m_maxBytes && m_bytes > m_maxBytes)))
+    {
+        m_bytes -= m_records.front().Bytes();
+        if (m_spare.size() < maxSpare)
+            m_spare.emplace_back(std::move(m_records.front()));
+        m_records.pop_front();
+    }
+}
+
+///
+/// \brief Recorder::Dump
+/// \param fileName
+/// \return false if the dump isn't started
+///
+bool Recorder::Dump(const std::string& fileName)
+{
+    if (fileName.empty())
+    {
+        std::cerr << "FlightRecorder: empty file name of the dump" << std::endl;
+        return false;
+    }
+    TRACE_SPAN("flight_dump", "tracker");
+
+    std::vector<uchar> data;
+    data.reserve(m_bytes + 64 * m_records.size() + 64);
+    checkpoint::Writer writer(data);
+    writer.Pod(Magic);
+    writer.Pod(Version);
+    writer.Pod(static_cast<uint32_t>(sizeof(track_t)));
+    writer.Pod(m_settingsHash);
+    writer.Pod(static_cast<uint64_t>(m_records.size()));
+    for (const auto& record : m_records)
+    {
+        SaveRecord(writer, record);
+    }
+
+    if (m_writeThread.joinable())
+        m_writeThread.join();
+    m_writing.store(true, std::memory_order_release);
+    const size_t recordsCount = m_records.size();
+    m_writeThread = std::thread([this, fileName, recordsCount](std::vector<uchar> data)
+    {
+        if (checkpoint::SaveFile(fileName, data))
+            std::cout << "FlightRecorder: " << recordsCount << " updates are dumped to " << fileName << std::endl;
+        else
+            std::cerr << "FlightRecorder: " << fileName << " wasn't written" << std::endl;
+        m_writing.store(false, std::memory_order_release);
+    }, std::move(data));
+    return true;
+}
+}
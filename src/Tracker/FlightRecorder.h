@@ -0,0 +1,124 @@
+#pragma once
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <string>
+#include <vector>
+
+#include "defines.h"
+#include "TrackerSettings.h"
+
+///
+/// Flight recorder of the tracker inputs for the reproduction of the performance incidents:
+///
+///     tracker->DumpFlightRecord("incident.mtfr");   // Or by the SLO of the Update latency
+///     ...
+///     ./TrackerBench incident.mtfr --settings=<ini of the stream>   // The same inputs in the same order
+///
+/// The dump is the little endian binary: the header (magic, version, track_t size, settings hash) and the records of the updates
+///
+namespace flight
+{
+constexpr uint32_t Magic = 0x5246544D; // "MTFR"
+constexpr uint32_t Version = 1;
+
+///
+/// \brief The Record struct
+/// Inputs of the one Update
+///
+struct Record
+{
+    uint64_t m_updateInd = 0;
+    double m_time = 0;              // Seconds from the start of the recorder by the steady clock
+    double m_timestamp = -1.;       // Of UpdateAt, negative for Update by the fps
+    float m_fps = 0;
+    double m_latencyMs = 0;         // Of the recorded Update
+    cv::Size m_frameSize;           // Of the caller frame, the regions are on it
+    regions_t m_regions;
+    std::vector<RegionEmbedding> m_embeddings;
+    cv::Mat m_frame;                // Downscaled frame or empty
+
+    ///
+    size_t Bytes() const;
+};
+
+///
+/// \brief Load
+/// \param fileName
+/// \param settingsHash - of the ini file of the recorded tracker, 0 if it's unknown
+/// \param records
+/// \return false if the file is corrupted or of the other version
+///
+bool Load(const std::string& fileName, uint64_t& settingsHash, std::vector<Record>& records);
+
+///
+/// \brief The Recorder class
+/// The last seconds of the inputs in the ring: the records are dropped by the age and by the memory limit.
+/// The embeddings are copied to the recycled buffers of the dropped records, so the recording doesn't allocate on the steady state.
+/// The dump is serialized in the thread of Update and written in the background, only one dump is written at once
+///
+class Recorder
+{
+public:
+    Recorder(const TrackerSettings& settings);
+    Recorder(const Recorder&) = delete;
+    Recorder& operator=(const Recorder&) = delete;
+    ~Recorder();
+
+    ///
+    /// \brief ApplySettings
+    /// \param settings
+    ///
+    void ApplySettings(const TrackerSettings& settings);
+
+    ///
+    /// \brief Add
+    /// It's called at the end of the tracker Update, the breach of the SLO dumps the ring with this update
+    /// \param regions
+    /// \param embeddings
+    /// \param currFrame - frame of the caller
+    /// \param fps
+    /// \param timestamp - of UpdateAt or negative
+    /// \param latencyMs
+    ///
+    void Add(const regions_t& regions, const std::vector<RegionEmbedding>& embeddings, cv::UMat currFrame, float fps, double timestamp, double latencyMs);
+
+    ///
+    /// \brief RequestDump
+    /// It can be called from another thread, the ring is dumped on the next Add
+    /// \param fileName - empty for m_flightRecorderFile
+    ///
+    void RequestDump(const std::string& fileName);
+
+private:
+    std::deque<Record> m_records;
+    std::vector<Record> m_spare;  // Dropped records with their buffers
+    size_t m_bytes = 0;
+    uint64_t m_updatesCount = 0;
+    std::chrono::steady_clock::time_point m_startTime;
+
+    double m_seconds = 10.;
+    double m_frameScale = 0.;
+    size_t m_maxBytes = 0;
+    std::string m_fileName;
+    double m_sloMs = 0.;
+    uint64_t m_settingsHash = 0;
+
+    static constexpr int64_t MinDumpIntervalMs = 5000;
+    static constexpr size_t MaxSloDumps = 10;
+    size_t m_sloDumps = 0;
+    std::chrono::steady_clock::time_point m_lastSloDump;
+
+    std::mutex m_requestMutex;
+    std::string m_requestedFile;
+    std::atomic<bool> m_hasRequest{ false };
+
+    std::thread m_writeThread;
+    std::atomic<bool> m_writing{ false };
+
+    void Trim();
+    bool Dump(const std::string& fileName);
+};
+}
@@ -0,0 +1,549 @@
+#include "FlowTracker.h"
+#include "TracksHotStore.h"
+#include "TrackIDAllocator.h"
+
+#include <iostream>
+#include <algorithm>
+#include <limits>
+
+///
+/// \brief CFlowTracker::CFlowTracker
+/// \param settings
+///
+CFlowTracker::CFlowTracker(const TrackerSettings& settings)
+    : m_settings(settings), m_idAllocator(TrackIDAllocator::CreateAllocator(settings))
+{
+}
+
+///
+/// \brief CFlowTracker::ApplySettings
+/// \param settings
+///
+void CFlowTracker::ApplySettings(const TrackerSettings& settings)
+{
+    std::lock_guard<std::mutex> lock(m_pendingMutex);
+    m_pendingSettings = std::make_unique<TrackerSettings>(settings);
+}
+
+///
+/// \brief CFlowTracker::ApplyPendingSettings
+///
+void CFlowTracker::ApplyPendingSettings()
+{
+    std::unique_ptr<TrackerSettings> settings;
+    {
+        std::lock_guard<std::mutex> lock(m_pendingMutex);
+        settings = std::move(m_pendingSettings);
+    }
+    if (!settings)
+        return;
+
+    // Window of the network is filled for the current length
+    if (settings->m_flowWindow != m_settings.m_flowWindow)
+    {
+        std::cerr << "CFlowTracker::ApplySettings: flow window is applied only to the new tracker" << std::endl;
+        settings->m_flowWindow = m_settings.m_flowWindow;
+    }
+    settings->m_trackIDMode = m_settings.m_trackIDMode;
+    settings->m_streamID = m_settings.m_streamID;
+    settings->m_trackIDAllocator = m_settings.m_trackIDAllocator;
+    m_settings = std::move(*settings);
+}
+
+///
+/// \brief CFlowTracker::CanGrayFrameToTrack
+/// \return
+///
+bool CFlowTracker::CanGrayFrameToTrack() const
+{
+    return true;
+}
+
+///
+/// \brief CFlowTracker::CanColorFrameToTrack
+/// \return
+///
+bool CFlowTracker::CanColorFrameToTrack() const
+{
+    return false;
+}
+
+///
+/// \brief CFlowTracker::GetTracksCount
+/// \return
+///
+size_t CFlowTracker::GetTracksCount() const
+{
+    return m_tracks.size();
+}
+
+///
+/// \brief CFlowTracker::GetTracks
+/// \param tracks
+///
+void CFlowTracker::GetTracks(std::vector<TrackingObject>& tracks) const
+{
+    tracks.clear();
+
+    if (m_tracks.size() > tracks.capacity())
+        tracks.reserve(m_tracks.size());
+    for (const auto& track : m_tracks)
+    {
+        tracks.emplace_back(track->ConstructObject(track->m_trace.size()));
+    }
+}
+
+///
+/// \brief CFlowTracker::QueryTracks
+/// \param query
+/// \param tracks
+///
+void CFlowTracker::QueryTracks(const TracksQuery& query, std::vector<TrackingObject>& tracks) const
+{
+    tracks.clear();
+
+    for (const auto& track : m_tracks)
+    {
+        if (!query.Match(track->m_lastRegion.m_rrect, track->m_lastRegion.m_type, track->m_trace, false))
+            continue;
+        tracks.emplace_back(track->ConstructObject(query.m_tailSize));
+        tracks.back().m_lastRobust = query.m_robustOnly;
+    }
+}
+
+///
+/// \brief CFlowTracker::GetRemovedTracks
+/// \param trackIDs
+///
+void CFlowTracker::GetRemovedTracks(std::vector<track_id_t>& trackIDs) const
+{
+    trackIDs.assign(std::begin(m_removedObjects), std::end(m_removedObjects));
+}
+
+///
+/// \brief CFlowTracker::GetTracksDelta
+/// \param delta
+/// \param withTrajectory
+///
+void CFlowTracker::GetTracksDelta(TracksDelta& delta, bool withTrajectory)
+{
+    delta.Clear();
+
+    for (auto& track : m_tracks)
+    {
+        const size_t totalPoints = track->m_trace.GetTotalCount();
+        const size_t tailSize = withTrajectory ? std::min(track->m_trace.size(), totalPoints - track->m_polledPoints) : 0;
+
+        if (track->m_polledPoints)
+            delta.m_updatedTracks.emplace_back(track->ConstructObject(tailSize));
+        else
+            delta.m_newTracks.emplace_back(track->ConstructObject(tailSize));
+
+        track->m_polledPoints = totalPoints;
+    }
+
+    if (m_deltaPolled)
+        delta.m_removedTracks.swap(m_removedSincePoll);
+    else
+        m_deltaPolled = true;
+    m_removedSincePoll.clear();
+}
+
+///
+/// \brief CFlowTracker::CalcEmbeddings
+/// Association uses only the geometry of the regions
+/// \param regionEmbeddings
+///
+void CFlowTracker::CalcEmbeddings(std::vector<RegionEmbedding>& regionEmbeddings, const regions_t& /*regions*/, cv::UMat /*currFrame*/) const
+{
+    regionEmbeddings.clear();
+}
+
+///
+/// \brief CFlowTracker::Update
+/// \param regions
+/// \param currFrame
+/// \param fps
+///
+void CFlowTracker::Update(const regions_t& regions, cv::UMat currFrame, float fps)
+{
+    Update(regions, std::vector<RegionEmbedding>(), currFrame, fps);
+}
+
+///
+/// \brief CFlowTracker::Update
+/// \param regions
+/// \param currFrame
+/// \param fps
+///
+void CFlowTracker::Update(const regions_t& regions, const std::vector<RegionEmbedding>& /*regionEmbeddings*/, cv::UMat /*currFrame*/, float fps)
+{
+    ApplyPendingSettings();
+
+    m_removedObjects.clear();
+    if (fps > 0)
+        m_fps = fps;
+
+    if (!m_window.empty())
+        ++m_frameInd;
+    m_window.push_back(regions);
+    if (m_window.size() < m_settings.m_flowWindow)
+        return;
+
+    BuildNetwork();
+    InitPotentials();
+    while (AugmentShortestPath())
+    {
+    }
+    CommitOldestFrame();
+
+    m_window.pop_front();
+
+    // The tracks of the oldest frame of the window, its time is unknown here
+    if (m_settings.m_publishSnapshots)
+    {
+        TracksQuery query;
+        query.m_tailSize = m_settings.m_snapshotTail;
+        PublishSnapshot(query, -1.);
+    }
+}
+
+///
+/// \brief CFlowTracker::UpdateAt
+/// The flow network uses only the order of the frames, the timestamps give the fps
+/// \param regions
+/// \param currFrame
+/// \param timestamp
+///
+void CFlowTracker::UpdateAt(const regions_t& regions, cv::UMat currFrame, double timestamp)
+{
+    m_timing.Next(timestamp, m_settings.m_nominalFps);
+    Update(regions, currFrame, m_timing.Fps(m_fps));
+}
+
+///
+/// \brief CFlowTracker::AddEdge
+/// \param from
+/// \param to
+/// \param cost
+///
+void CFlowTracker::AddEdge(int from, int to, track_t cost)
+{
+    m_edgeTo.push_back(to);
+    m_edgeCap.push_back(1);
+    m_edgeCost.push_back(cost);
+    m_edgeNext.push_back(m_nodeEdges[from]);
+    m_nodeEdges[from] = static_cast<int>(m_edgeTo.size()) - 1;
+
+    m_edgeTo.push_back(from);
+    m_edgeCap.push_back(0);
+    m_edgeCost.push_back(-cost);
+    m_edgeNext.push_back(m_nodeEdges[to]);
+    m_nodeEdges[to] = static_cast<int>(m_edgeTo.size()) - 1;
+}
+
+///
+/// \brief CFlowTracker::TransitionCost
+/// \param from
+/// \param to
+/// \param gap - frames between the regions, >= 1
+/// \return Cost of the link or -1 if the link is impossible
+///
+track_t CFlowTracker::TransitionCost(const CRegion& from, const CRegion& to, size_t gap) const
+{
+    if (!m_settings.CheckType(from.m_type, to.m_type))
+        return -1;
+
+    // The centers distance is normalized by the object size and by the time between the frames,
+    // so the link over the missed detections isn't more expensive for the moving object
+    const Point_t diff = to.m_rrect.center - from.m_rrect.center;
+    const track_t fromArea = from.m_rrect.size.area();
+    const track_t toArea = to.m_rrect.size.area();
+    const track_t objSize = std::max(0.5f * (std::sqrt(fromArea) + std::sqrt(toArea)), 1.f);
+    const track_t distCenters = std::min(1.f, std::sqrt(diff.x * diff.x + diff.y * diff.y) / (gap * objSize));
+    const track_t distSize = (fromArea > 0 && toArea > 0) ? (1 - SizeRatio(fromArea, toArea)) : 1;
+
+    const track_t cost = 0.5f * (distCenters + distSize);
+    if (cost > m_settings.m_distThres)
+        return -1;
+
+    // Penalty for every missed detection: the direct link is preferred
+    constexpr track_t missCost = 0.05f;
+    return cost + missCost * static_cast<track_t>(gap - 1);
+}
+
+///
+/// \brief CFlowTracker::BuildNetwork
+/// Source -> head of the track or the detection (birth), detection in -> out (reward),
+/// out -> sink, head or out -> in of the detection in the next frames (transition)
+///
+void CFlowTracker::BuildNetwork()
+{
+    const size_t framesCount = m_window.size();
+    const size_t firstFrameInd = m_frameInd + 1 - framesCount;
+    const size_t maxGap = m_settings.m_maximumAllowedSkippedFrames + 1;
+    constexpr track_t detectionCost = -1.f;
+
+    m_frameFirstRegion.resize(framesCount + 1);
+    m_frameFirstRegion[0] = 0;
+    for (size_t fi = 0; fi < framesCount; ++fi)
+    {
+        m_frameFirstRegion[fi + 1] = m_frameFirstRegion[fi] + m_window[fi].size();
+    }
+    m_firstDetNode = HeadNode(m_tracks.size());
+    const size_t nodesCount = static_cast<size_t>(m_firstDetNode) + 2 * m_frameFirstRegion[framesCount];
+
+    // Buffers keep the capacity of the previous windows
+    m_nodeEdges.assign(nodesCount, -1);
+    m_edgeNext.clear();
+    m_edgeTo.clear();
+    m_edgeCap.clear();
+    m_edgeCost.clear();
+
+    constexpr int source = 0;
+    constexpr int sink = 1;
+
+    for (size_t ti = 0; ti < m_tracks.size(); ++ti)
+    {
+        const FlowTrack& track = *m_tracks[ti];
+        AddEdge(source, HeadNode(ti), 0);
+
+        for (size_t fi = 0; fi < framesCount; ++fi)
+        {
+            const size_t gap = firstFrameInd + fi - track.m_lastFrame;
+            if (gap > maxGap)
+                break;
+            for (size_t ri = 0; ri < m_window[fi].size(); ++ri)
+            {
+                const track_t cost = TransitionCost(track.m_lastRegion, m_window[fi][ri], gap);
+                if (cost >= 0)
+                    AddEdge(HeadNode(ti), InNode(fi, ri), cost);
+            }
+        }
+    }
+
+    for (size_t fi = 0; fi < framesCount; ++fi)
+    {
+        for (size_t ri = 0; ri < m_window[fi].size(); ++ri)
+        {
+            const int inNode = InNode(fi, ri);
+            const int outNode = OutNode(fi, ri);
+            AddEdge(source, inNode, m_settings.m_flowBirthCost);
+            AddEdge(inNode, outNode, detectionCost);
+            AddEdge(outNode, sink, 0);
+
+            for (size_t fj = fi + 1; fj < framesCount && fj - fi <= maxGap; ++fj)
+            {
+                for (size_t rj = 0; rj < m_window[fj].size(); ++rj)
+                {
+                    const track_t cost = TransitionCost(m_window[fi][ri], m_window[fj][rj], fj - fi);
+                    if (cost >= 0)
+                        AddEdge(outNode, InNode(fj, rj), cost);
+                }
+            }
+        }
+    }
+}
+
+///
+/// \brief CFlowTracker::InitPotentials
+/// Shortest distances from the source in the acyclic network: nodes are numbered in the topological order
+/// except the sink without outgoing edges
+///
+void CFlowTracker::InitPotentials()
+{
+    constexpr track_t inf = std::numeric_limits<track_t>::max();
+    const size_t nodesCount = m_nodeEdges.size();
+
+    m_potentials.assign(nodesCount, inf);
+    m_potentials[0] = 0;
+    for (size_t node = 0; node < nodesCount; ++node)
+    {
+        if (node == 1 || m_potentials[node] == inf)
+            continue;
+        for (int e = m_nodeEdges[node]; e >= 0; e = m_edgeNext[e])
+        {
+            const int to = m_edgeTo[e];
+            if (m_edgeCap[e] > 0 && m_potentials[node] + m_edgeCost[e] < m_potentials[to])
+                m_potentials[to] = m_potentials[node] + m_edgeCost[e];
+        }
+    }
+}
+
+///
+/// \brief CFlowTracker::AugmentShortestPath
+/// Dijkstra on the reduced costs and one unit of flow along the found path
+/// \return false if the path doesn't decrease the total cost
+///
+bool CFlowTracker::AugmentShortestPath()
+{
+    constexpr track_t inf = std::numeric_limits<track_t>::max();
+    constexpr int source = 0;
+    constexpr int sink = 1;
+    const size_t nodesCount = m_nodeEdges.size();
+
+    m_dists.assign(nodesCount, inf);
+    m_prevEdge.assign(nodesCount, -1);
+    m_heap.clear();
+
+    auto heapCmp = [](const std::pair<track_t, int>& a, const std::pair<track_t, int>& b) { return a.first > b.first; };
+
+    m_dists[source] = 0;
+    m_heap.emplace_back(0.f, source);
+    while (!m_heap.empty())
+    {
+        std::pop_heap(std::begin(m_heap), std::end(m_heap), heapCmp);
+        const auto top = m_heap.back();
+        m_heap.pop_back();
+
+        const int node = top.second;
+        if (top.first > m_dists[node])
+            continue;
+
+        for (int e = m_nodeEdges[node]; e >= 0; e = m_edgeNext[e])
+        {
+            if (m_edgeCap[e] <= 0)
+                continue;
+            const int to = m_edgeTo[e];
+            if (m_potentials[to] == inf)
+                continue;
+            // Reduced costs are non negative up to the rounding errors
+            const track_t reducedCost = std::max(0.f, m_edgeCost[e] + m_potentials[node] - m_potentials[to]);
+            const track_t dist = m_dists[node] + reducedCost;
+            if (dist < m_dists[to])
+            {
+                m_dists[to] = dist;
+                m_prevEdge[to] = e;
+                m_heap.emplace_back(dist, to);
+                std::push_heap(std::begin(m_heap), std::end(m_heap), heapCmp);
+            }
+        }
+    }
+
+    if (m_dists[sink] == inf)
+        return false;
+
+    for (size_t node = 0; node < nodesCount; ++node)
+    {
+        if (m_dists[node] != inf)
+            m_potentials[node] += m_dists[node];
+    }
+
+    // Potential of the sink is the real cost of the path
+    if (m_potentials[sink] >= 0)
+        return false;
+
+    for (int node = sink; node != source; node = m_edgeTo[m_prevEdge[node] ^ 1])
+    {
+        const int e = m_prevEdge[node];
+        --m_edgeCap[e];
+        ++m_edgeCap[e ^ 1];
+    }
+    return true;
+}
+
+///
+/// \brief CFlowTracker::CommitOldestFrame
+/// Detections of the oldest frame on the found paths continue the tracks or start the new ones,
+/// the other detections are false alarms
+///
+void CFlowTracker::CommitOldestFrame()
+{
+    constexpr int source = 0;
+    const size_t frameInd = m_frameInd + 1 - m_window.size();
+    const size_t tracksCount = m_tracks.size();
+
+    std::vector<char> updated(tracksCount, 0);
+    const regions_t& regions = m_window.front();
+    for (size_t ri = 0; ri < regions.size(); ++ri)
+    {
+        // Flow on the forward edge into the in node is the capacity of its reverse edge
+        int fromNode = -1;
+        for (int e = m_nodeEdges[InNode(0, ri)]; e >= 0; e = m_edgeNext[e])
+        {
+            if ((e & 1) && m_edgeCap[e] > 0)
+            {
+                fromNode = m_edgeTo[e];
+                break;
+            }
+        }
+        if (fromNode < 0)
+            continue;
+
+        const CRegion& region = regions[ri];
+        if (fromNode == source)
+        {
+            auto track = std::make_unique<FlowTrack>();
+            track->m_ID = m_idAllocator->NextID();
+            track->m_lastRegion = region;
+            track->m_lastFrame = frameInd;
+            track->m_trace.SetCapacity(m_settings.m_maxTraceLength);
+            track->m_trace.SetHistory(m_settings.m_traceHistoryError, m_settings.m_traceHistoryLength);
+            track->m_trace.push_back(region.m_rrect.center, region.m_rrect.center);
+            track->m_motionStats.Add(region.m_rrect.center);
+            m_tracks.emplace_back(std::move(track));
+        }
+        else
+        {
+            const size_t ti = static_cast<size_t>(fromNode - HeadNode(0));
+            FlowTrack& track = *m_tracks[ti];
+            const track_t timeK = m_fps / static_cast<track_t>(frameInd - track.m_lastFrame);
+            const Point_t diff = region.m_rrect.center - track.m_lastRegion.m_rrect.center;
+            track.m_velocity = cv::Vec<track_t, 2>(diff.x * timeK, diff.y * timeK);
+            track.m_lastRegion = region;
+            track.m_lastFrame = frameInd;
+            track.m_trace.push_back(region.m_rrect.center, region.m_rrect.center);
+            track.m_motionStats.Add(region.m_rrect.center);
+            updated[ti] = 1;
+        }
+    }
+
+    for (size_t ti = 0; ti < tracksCount; ++ti)
+    {
+        if (!updated[ti])
+        {
+            m_tracks[ti]->m_trace.push_back(m_tracks[ti]->m_lastRegion.m_rrect.center);
+            m_tracks[ti]->m_motionStats.Add(m_tracks[ti]->m_lastRegion.m_rrect.center);
+        }
+    }
+
+    RemoveLostTracks(frameInd);
+}
+
+///
+/// \brief CFlowTracker::RemoveLostTracks
+/// \param frameInd - committed frame
+///
+void CFlowTracker::RemoveLostTracks(size_t frameInd)
+{
+    size_t aliveCount = 0;
+    for (size_t ti = 0; ti < m_tracks.size(); ++ti)
+    {
+        if (frameInd - m_tracks[ti]->m_lastFrame > m_settings.m_maximumAllowedSkippedFrames)
+        {
+            m_removedObjects.push_back(m_tracks[ti]->m_ID);
+            if (m_deltaPolled && m_tracks[ti]->m_polledPoints)
+                m_removedSincePoll.push_back(m_tracks[ti]->m_ID);
+        }
+        else
+        {
+            if (aliveCount != ti)
+                m_tracks[aliveCount] = std::move(m_tracks[ti]);
+            ++aliveCount;
+        }
+    }
+    m_tracks.resize(aliveCount);
+}
+
+///
+/// \brief CFlowTracker::FlowTrack::ConstructObject
+/// \param tailSize - count of the last trajectory points
+/// \return
+///
+TrackingObject CFlowTracker::FlowTrack::ConstructObject(size_t tailSize) const
+{
+    TrackingObject obj(m_lastRegion.m_rrect, m_ID, m_trace.Tail(tailSize), false, false,
+                       m_lastRegion.m_type, m_lastRegion.m_confidence, m_velocity);
+    obj.m_motion = m_motionStats.Motion();
+    return obj;
+}
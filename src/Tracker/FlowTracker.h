@@ -0,0 +1,118 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <memory>
+#include <utility>
+
+#include "Ctracker.h"
+
+///
+/// \brief The CFlowTracker class
+/// Global data association in the sliding window of m_flowWindow frames: detections of the window and
+/// the last detections of the alive tracks are the nodes of the min-cost flow network, every unit
+/// of flow is a trajectory. The flow is found by the successive shortest paths with potentials,
+/// the network buffers are reused by all windows.
+/// After the solution the oldest frame of the window is committed to the tracks: output has the fixed
+/// lag of m_flowWindow - 1 frames, but the track on the oldest frame is chosen with knowledge of the future frames
+///
+class CFlowTracker final : public BaseTracker
+{
+public:
+    CFlowTracker(const TrackerSettings& settings);
+    CFlowTracker(const CFlowTracker&) = delete;
+    CFlowTracker(CFlowTracker&&) = delete;
+    CFlowTracker& operator=(const CFlowTracker&) = delete;
+    CFlowTracker& operator=(CFlowTracker&&) = delete;
+
+    ~CFlowTracker(void) = default;
+
+    void Update(const regions_t& regions, cv::UMat currFrame, float fps) override;
+    void Update(const regions_t& regions, const std::vector<RegionEmbedding>& regionEmbeddings, cv::UMat currFrame, float fps) override;
+    void UpdateAt(const regions_t& regions, cv::UMat currFrame, double timestamp) override;
+    void CalcEmbeddings(std::vector<RegionEmbedding>& regionEmbeddings, const regions_t& regions, cv::UMat currFrame) const override;
+
+    bool CanGrayFrameToTrack() const override;
+    bool CanColorFrameToTrack() const override;
+    size_t GetTracksCount() const override;
+    void GetTracks(std::vector<TrackingObject>& tracks) const override;
+    void QueryTracks(const TracksQuery& query, std::vector<TrackingObject>& tracks) const override;
+    void GetRemovedTracks(std::vector<track_id_t>& trackIDs) const override;
+    void GetTracksDelta(TracksDelta& delta, bool withTrajectory) override;
+    void ApplySettings(const TrackerSettings& settings) override;
+
+private:
+    TrackerSettings m_settings;
+
+    std::mutex m_pendingMutex;
+    std::unique_ptr<TrackerSettings> m_pendingSettings; // Swapped on the next Update
+    void ApplyPendingSettings();
+
+    FrameTiming m_timing;
+
+    ///
+    /// \brief The FlowTrack struct
+    /// Committed part of the trajectory
+    ///
+    struct FlowTrack
+    {
+        track_id_t m_ID = 0;
+        CRegion m_lastRegion;
+        size_t m_lastFrame = 0;      // Frame of m_lastRegion
+        Trace m_trace;
+        MotionStats m_motionStats;
+        cv::Vec<track_t, 2> m_velocity;
+        size_t m_polledPoints = 0;
+
+        TrackingObject ConstructObject(size_t tailSize) const;
+    };
+    std::vector<std::unique_ptr<FlowTrack>> m_tracks;
+
+    std::shared_ptr<TrackIDAllocator> m_idAllocator;
+    std::vector<track_id_t> m_removedObjects;
+
+    bool m_deltaPolled = false;
+    std::vector<track_id_t> m_removedSincePoll;
+
+    std::deque<regions_t> m_window; // The oldest frame is the first
+    size_t m_frameInd = 0;          // Number of the last frame of the window
+    float m_fps = 25.f;
+
+    // Residual network: edge e and e ^ 1 are the forward and the reverse edges
+    std::vector<int> m_nodeEdges; // Head of the edge list of the node
+    std::vector<int> m_edgeNext;
+    std::vector<int> m_edgeTo;
+    std::vector<int> m_edgeCap;
+    std::vector<track_t> m_edgeCost;
+
+    int m_firstDetNode = 2;                 // Nodes: source, sink, heads of the tracks, pairs of in/out nodes of the detections
+    std::vector<size_t> m_frameFirstRegion; // First detection of the frame in the window, + 1 element for the end
+    std::vector<track_t> m_potentials;
+    std::vector<track_t> m_dists;
+    std::vector<int> m_prevEdge;
+    std::vector<std::pair<track_t, int>> m_heap;
+
+    void AddEdge(int from, int to, track_t cost);
+    track_t TransitionCost(const CRegion& from, const CRegion& to, size_t gap) const;
+    void BuildNetwork();
+    void InitPotentials();
+    bool AugmentShortestPath();
+    void CommitOldestFrame();
+    void RemoveLostTracks(size_t frameInd);
+
+    ///
+    int HeadNode(size_t trackInd) const
+    {
+        return 2 + static_cast<int>(trackInd);
+    }
+    ///
+    int InNode(size_t windowFrame, size_t regionInd) const
+    {
+        return m_firstDetNode + static_cast<int>(2 * (m_frameFirstRegion[windowFrame] + regionInd));
+    }
+    ///
+    int OutNode(size_t windowFrame, size_t regionInd) const
+    {
+        return InNode(windowFrame, regionInd) + 1;
+    }
+};
@@ -0,0 +1,197 @@
+#pragma once
+#include <vector>
+#include <mutex>
+#include <algorithm>
+#include "defines.h"
+
+///
+/// \brief ScaleRect
+/// \param rect - on the original frame
+/// \param scale - of the resized frame
+/// \return The rect on the resized frame
+///
+inline cv::Rect ScaleRect(const cv::Rect& rect, track_t scale)
+{
+    if (scale == 1.f)
+        return rect;
+    return cv::Rect(cvRound(rect.x * scale), cvRound(rect.y * scale), std::max(1, cvRound(rect.width * scale)), std::max(1, cvRound(rect.height * scale)));
+}
+
+///
+/// \brief ScaleRRect
+/// \param rrect
+/// \param scale - the inverse scale returns the rect to the original frame
+/// \return
+///
+inline cv::RotatedRect ScaleRRect(const cv::RotatedRect& rrect, track_t scale)
+{
+    return cv::RotatedRect(rrect.center * scale, cv::Size2f(rrect.size.width * scale, rrect.size.height * scale), rrect.angle);
+}
+
+///
+/// \brief ScaleFrame
+/// Working frame of the image operations on the internal resolution
+/// \param frame
+/// \param scale - (0, 1], 1 - the frame is shared without the copy
+/// \param scaled
+///
+inline void ScaleFrame(cv::UMat frame, track_t scale, cv::UMat& scaled)
+{
+    if (scale >= 1.f || frame.empty())
+    {
+        scaled = frame;
+        return;
+    }
+    cv::resize(frame, scaled, cv::Size(std::max(1, cvRound(frame.cols * scale)), std::max(1, cvRound(frame.rows * scale))), 0, 0, cv::INTER_AREA);
+}
+
+///
+/// \brief The FramePyramid class
+/// Image pyramid of the current frame shared by the visual trackers of the lost tracks.
+/// Levels and their gray and float variants are calculated on the first request and only once per frame,
+/// so dozens of trackers don't repeat the same resize and color conversion. Thread safe
+///
+class FramePyramid
+{
+public:
+    static constexpr int MaxLevels = 6;
+
+    ///
+    /// \brief FramePyramid
+    /// \param minObjectSize - minimal side of the object on the selected level, 0 - the level is selected only by maxObjectSize
+    /// \param maxObjectSize - maximal side of the object on the selected level, 0 - not limited
+    ///
+    FramePyramid(int minObjectSize, int maxObjectSize = 0)
+        : m_minObjectSize(std::max(0, minObjectSize)), m_maxObjectSize(std::max(0, maxObjectSize))
+    {
+    }
+    FramePyramid(const FramePyramid&) = delete;
+    FramePyramid& operator=(const FramePyramid&) = delete;
+
+    ///
+    /// \brief Build
+    /// New frame, the level 0 shares data with it
+    /// \param frame
+    ///
+    void Build(cv::UMat frame)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_levels.resize(MaxLevels);
+        for (auto& level : m_levels)
+        {
+            level = LevelImages();
+        }
+        m_levels[0].m_native = frame;
+    }
+
+    ///
+    /// \brief SelectLevel
+    /// \param objSize
+    /// \return The smallest level where the object isn't less than minObjectSize, the max side of the object
+    /// on it isn't more than maxObjectSize while there are levels
+    ///
+    int SelectLevel(cv::Size objSize) const
+    {
+        int level = 0;
+        if (m_minObjectSize > 0)
+        {
+            const int objSide = std::min(objSize.width, objSize.height);
+            while (level + 1 < MaxLevels && (objSide >> (level + 1)) >= m_minObjectSize)
+            {
+                ++level;
+            }
+        }
+        if (m_maxObjectSize > 0)
+        {
+            const int objSide = std::max(objSize.width, objSize.height);
+            while (level + 1 < MaxLevels && (objSide >> level) > m_maxObjectSize)
+            {
+                ++level;
+            }
+        }
+        return level;
+    }
+
+    ///
+    /// \brief Scale
+    /// \param level
+    /// \return Size of the level pixel on the frame
+    ///
+    static track_t Scale(int level)
+    {
+        return static_cast<track_t>(1 << level);
+    }
+
+    ///
+    /// \brief Level
+    /// \param level
+    /// \return Image with the frame type
+    ///
+    cv::UMat Level(int level)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return GetNative(level);
+    }
+
+    ///
+    /// \brief Gray
+    /// \param level
+    /// \return 8-bit 1 channel image
+    ///
+    cv::UMat Gray(int level)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return GetGray(level);
+    }
+
+    ///
+    /// \brief Float
+    /// \param level
+    /// \return CV_32F image with the frame channels in [0, 1]
+    ///
+    cv::UMat Float(int level)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        LevelImages& images = m_levels[level];
+        if (images.m_float.empty())
+            GetNative(level).convertTo(images.m_float, CV_32F, 1. / 255.);
+        return images.m_float;
+    }
+
+private:
+    int m_minObjectSize = 1;
+    int m_maxObjectSize = 0;
+
+    struct LevelImages
+    {
+        cv::UMat m_native;
+        cv::UMat m_gray;
+        cv::UMat m_float;
+    };
+    std::vector<LevelImages> m_levels;
+    std::mutex m_mutex;
+
+    ///
+    cv::UMat GetNative(int level)
+    {
+        LevelImages& images = m_levels[level];
+        if (images.m_native.empty() && level > 0)
+            cv::pyrDown(GetNative(level - 1), images.m_native);
+        return images.m_native;
+    }
+
+    ///
+    cv::UMat GetGray(int level)
+    {
+        LevelImages& images = m_levels[level];
+        if (images.m_gray.empty())
+        {
+            cv::UMat native = GetNative(level);
+            if (native.channels() == 1)
+                images.m_gray = native;
+            else
+                cv::cvtColor(native, images.m_gray, cv::COLOR_BGR2GRAY);
+        }
+        return images.m_gray;
+    }
+};
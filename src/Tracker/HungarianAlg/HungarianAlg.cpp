@@ -1,5 +1,6 @@
 #include "HungarianAlg.h"
 #include <limits>
+#include <algorithm>
 
 // --------------------------------------------------------------------------
 //
@@ -42,16 +43,22 @@ void AssignmentProblemSolver::assignmentoptimal(assignments_t& assignment, track
 
 	// Total elements number
     const size_t nOfElements = nOfRows * nOfColumns;
-	// Memory allocation
-    m_distMatrix.assign(std::begin(distMatrixIn), std::end(distMatrixIn));
-    const track_t* distMatrixEnd = m_distMatrix.data() + nOfElements;
+	// Working copy has the same layout: the copy of the whole buffer
+    m_distMatrix = distMatrixIn;
 
-	// Memory allocation
-	bool* coveredColumns = (bool*)calloc(nOfColumns, sizeof(bool));
-	bool* coveredRows = (bool*)calloc(nOfRows, sizeof(bool));
-	bool* starMatrix = (bool*)calloc(nOfElements, sizeof(bool));
-	bool* primeMatrix = (bool*)calloc(nOfElements, sizeof(bool));
-	bool* newStarMatrix = (bool*)calloc(nOfElements, sizeof(bool)); /* used in step4 */
+	// Memory allocation: scratch buffer grows only, all flags are cleared
+	const size_t nOfBools = nOfColumns + nOfRows + 3 * nOfElements;
+	if (m_boolsCapacity < nOfBools)
+	{
+		m_bools = std::make_unique<bool[]>(nOfBools);
+		m_boolsCapacity = nOfBools;
+	}
+	std::fill_n(m_bools.get(), nOfBools, false);
+	bool* coveredColumns = m_bools.get();
+	bool* coveredRows = coveredColumns + nOfColumns;
+	bool* starMatrix = coveredRows + nOfRows;
+	bool* primeMatrix = starMatrix + nOfElements;
+	bool* newStarMatrix = primeMatrix + nOfElements; /* used in step4 */
 
 	/* preliminary steps */
 	if (nOfRows <= nOfColumns)
@@ -59,23 +66,12 @@ void AssignmentProblemSolver::assignmentoptimal(assignments_t& assignment, track
         for (size_t row = 0; row < nOfRows; ++row)
 		{
 			/* find the smallest element in the row */
-            track_t* distMatrixTemp = m_distMatrix.data() + row;
-            track_t  minValue = *distMatrixTemp;
-			distMatrixTemp += nOfRows;
-			while (distMatrixTemp < distMatrixEnd)
-			{
-				track_t value = *distMatrixTemp;
-				if (value < minValue)
-					minValue = value;
-
-				distMatrixTemp += nOfRows;
-			}
+            track_t* distRow = m_distMatrix.Row(row);
+            const track_t minValue = *std::min_element(distRow, distRow + nOfColumns);
 			/* subtract the smallest element from each element of the row */
-            distMatrixTemp = m_distMatrix.data() + row;
-			while (distMatrixTemp < distMatrixEnd)
+            for (size_t col = 0; col < nOfColumns; ++col)
 			{
-				*distMatrixTemp -= minValue;
-				distMatrixTemp += nOfRows;
+				distRow[col] -= minValue;
 			}
 		}
 		/* Steps 1 and 2a */
@@ -83,7 +79,7 @@ void AssignmentProblemSolver::assignmentoptimal(assignments_t& assignment, track
 		{
             for (size_t col = 0; col < nOfColumns; ++col)
 			{
-                if (m_distMatrix[row + nOfRows*col] == 0)
+                if (m_distMatrix(row, col) == 0)
 				{
 					if (!coveredColumns[col])
 					{
@@ -97,23 +93,23 @@ void AssignmentProblemSolver::assignmentoptimal(assignments_t& assignment, track
 	}
 	else /* if(nOfRows > nOfColumns) */
 	{
-        for (size_t col = 0; col < nOfColumns; ++col)
+		/* find the smallest element in the every column by the rows */
+        m_colMin.assign(m_distMatrix.Row(0), m_distMatrix.Row(0) + nOfColumns);
+        for (size_t row = 1; row < nOfRows; ++row)
 		{
-			/* find the smallest element in the column */
-            track_t* distMatrixTemp = m_distMatrix.data() + nOfRows*col;
-			track_t* columnEnd = distMatrixTemp + nOfRows;
-			track_t  minValue = *distMatrixTemp++;
-			while (distMatrixTemp < columnEnd)
+            const track_t* distRow = m_distMatrix.Row(row);
+            for (size_t col = 0; col < nOfColumns; ++col)
 			{
-				track_t value = *distMatrixTemp++;
-				if (value < minValue)
-					minValue = value;
+				m_colMin[col] = std::min(m_colMin[col], distRow[col]);
 			}
-			/* subtract the smallest element from each element of the column */
-            distMatrixTemp = m_distMatrix.data() + nOfRows*col;
-			while (distMatrixTemp < columnEnd)
+		}
+		/* subtract the smallest element from each element of the column */
+        for (size_t row = 0; row < nOfRows; ++row)
+		{
+            track_t* distRow = m_distMatrix.Row(row);
+            for (size_t col = 0; col < nOfColumns; ++col)
 			{
-				*distMatrixTemp++ -= minValue;
+				distRow[col] -= m_colMin[col];
 			}
 		}
 		/* Steps 1 and 2a */
@@ -121,7 +117,7 @@ void AssignmentProblemSolver::assignmentoptimal(assignments_t& assignment, track
 		{
             for (size_t row = 0; row < nOfRows; ++row)
 			{
-                if (m_distMatrix[row + nOfRows*col] == 0)
+                if (m_distMatrix(row, col) == 0)
 				{
 					if (!coveredRows[row])
 					{
@@ -143,13 +139,6 @@ void AssignmentProblemSolver::assignmentoptimal(assignments_t& assignment, track
     step2b(assignment, starMatrix, newStarMatrix, primeMatrix, coveredColumns, coveredRows, nOfRows, nOfColumns, (nOfRows <= nOfColumns) ? nOfRows : nOfColumns);
 	/* compute cost and remove invalid assignments */
 	computeassignmentcost(assignment, cost, distMatrixIn, nOfRows);
-	/* free allocated memory */
-	free(coveredColumns);
-	free(coveredRows);
-	free(starMatrix);
-	free(primeMatrix);
-	free(newStarMatrix);
-	return;
 }
 // --------------------------------------------------------------------------
 //
@@ -177,7 +166,7 @@ void AssignmentProblemSolver::computeassignmentcost(const assignments_t& assignm
 	{
 		const int col = assignment[row];
 		if (col >= 0)
-			cost += distMatrixIn[row + nOfRows * col];
+			cost += distMatrixIn(row, static_cast<size_t>(col));
 	}
 }
 
@@ -241,7 +230,7 @@ void AssignmentProblemSolver::step3_5(assignments_t& assignment, bool *starMatri
 				{
                     for (size_t row = 0; row < nOfRows; ++row)
 					{
-                        if ((!coveredRows[row]) && (m_distMatrix[row + nOfRows*col] == 0))
+                        if ((!coveredRows[row]) && (m_distMatrix(row, col) == 0))
 						{
 							/* prime zero */
 							primeMatrix[row + nOfRows*col] = true;
@@ -280,33 +269,21 @@ void AssignmentProblemSolver::step3_5(assignments_t& assignment, bool *starMatri
 				{
 					if (!coveredColumns[col])
 					{
-                        const track_t value = m_distMatrix[row + nOfRows*col];
+                        const track_t value = m_distMatrix(row, col);
 						if (value < h)
 							h = value;
 					}
 				}
 			}
 		}
-		/* add h to each covered row */
+		/* add h to each covered row and subtract h from each uncovered column */
         for (size_t row = 0; row < nOfRows; ++row)
 		{
-			if (coveredRows[row])
-			{
-                for (size_t col = 0; col < nOfColumns; ++col)
-				{
-                    m_distMatrix[row + nOfRows*col] += h;
-				}
-			}
-		}
-		/* subtract h from each uncovered column */
-        for (size_t col = 0; col < nOfColumns; ++col)
-		{
-			if (!coveredColumns[col])
+            track_t* distRow = m_distMatrix.Row(row);
+            const track_t rowAdd = coveredRows[row] ? h : 0;
+            for (size_t col = 0; col < nOfColumns; ++col)
 			{
-                for (size_t row = 0; row < nOfRows; ++row)
-				{
-                    m_distMatrix[row + nOfRows*col] -= h;
-				}
+                distRow[col] += coveredColumns[col] ? rowAdd : (rowAdd - h);
 			}
 		}
 	}
@@ -319,10 +296,7 @@ void AssignmentProblemSolver::step4(assignments_t& assignment, bool *starMatrix,
 {
 	const size_t nOfElements = nOfRows * nOfColumns;
 	/* generate temporary copy of starMatrix */
-    for (size_t n = 0; n < nOfElements; ++n)
-	{
-		newStarMatrix[n] = starMatrix[n];
-	}
+	std::copy_n(starMatrix, nOfElements, newStarMatrix);
 	/* star current zero */
 	newStarMatrix[row + nOfRows*col] = true;
 	/* find starred zero in current column */
@@ -357,15 +331,9 @@ void AssignmentProblemSolver::step4(assignments_t& assignment, bool *starMatrix,
 	}
 	/* use temporary copy as new starMatrix */
 	/* delete all primes, uncover all rows */
-    for (size_t n = 0; n < nOfElements; ++n)
-	{
-		primeMatrix[n] = false;
-		starMatrix[n] = newStarMatrix[n];
-	}
-    for (size_t n = 0; n < nOfRows; ++n)
-	{
-		coveredRows[n] = false;
-	}
+	std::fill_n(primeMatrix, nOfElements, false);
+	std::copy_n(newStarMatrix, nOfElements, starMatrix);
+	std::fill_n(coveredRows, nOfRows, false);
 	/* move to step 2a */
     step2a(assignment, starMatrix, newStarMatrix, primeMatrix, coveredColumns, coveredRows, nOfRows, nOfColumns, minDim);
 }
@@ -376,7 +344,7 @@ void AssignmentProblemSolver::step4(assignments_t& assignment, bool *starMatrix,
 void AssignmentProblemSolver::assignmentsuboptimal2(assignments_t& assignment, track_t& cost, const distMatrix_t& distMatrixIn, size_t nOfRows, size_t nOfColumns)
 {
 	/* make working copy of distance Matrix */
-    m_distMatrix.assign(std::begin(distMatrixIn), std::end(distMatrixIn));
+    m_distMatrix = distMatrixIn;
 
 	/* recursively search for the minimum element and do the assignment */
 	for (;;)
@@ -389,7 +357,7 @@ void AssignmentProblemSolver::assignmentsuboptimal2(assignments_t& assignment, t
 		{
             for (size_t col = 0; col < nOfColumns; ++col)
 			{
-                const track_t value = m_distMatrix[row + nOfRows*col];
+                const track_t value = m_distMatrix(row, col);
 				if (value != std::numeric_limits<track_t>::max() && (value < minValue))
 				{
 					minValue = value;
@@ -405,11 +373,11 @@ void AssignmentProblemSolver::assignmentsuboptimal2(assignments_t& assignment, t
 			cost += minValue;
             for (size_t n = 0; n < nOfRows; ++n)
 			{
-                m_distMatrix[n + nOfRows*tmpCol] = std::numeric_limits<track_t>::max();
+                m_distMatrix(n, tmpCol) = std::numeric_limits<track_t>::max();
 			}
             for (size_t n = 0; n < nOfColumns; ++n)
 			{
-                m_distMatrix[tmpRow + nOfRows*n] = std::numeric_limits<track_t>::max();
+                m_distMatrix(tmpRow, n) = std::numeric_limits<track_t>::max();
 			}
 		}
 		else
@@ -424,11 +392,13 @@ void AssignmentProblemSolver::assignmentsuboptimal2(assignments_t& assignment, t
 void AssignmentProblemSolver::assignmentsuboptimal1(assignments_t& assignment, track_t& cost, const distMatrix_t& distMatrixIn, size_t nOfRows, size_t nOfColumns)
 {
 	/* make working copy of distance Matrix */
-    m_distMatrix.assign(std::begin(distMatrixIn), std::end(distMatrixIn));
+    m_distMatrix = distMatrixIn;
 
 	/* allocate memory */
-	int* nOfValidObservations = (int *)calloc(nOfRows, sizeof(int));
-	int* nOfValidTracks = (int *)calloc(nOfColumns, sizeof(int));
+	m_validObservations.assign(nOfRows, 0);
+	m_validTracks.assign(nOfColumns, 0);
+	int* nOfValidObservations = m_validObservations.data();
+	int* nOfValidTracks = m_validTracks.data();
 
 	/* compute number of validations */
 	bool infiniteValueFound = false;
@@ -437,7 +407,7 @@ void AssignmentProblemSolver::assignmentsuboptimal1(assignments_t& assignment, t
 	{
         for (size_t col = 0; col < nOfColumns; ++col)
 		{
-            if (m_distMatrix[row + nOfRows*col] != std::numeric_limits<track_t>::max())
+            if (m_distMatrix(row, col) != std::numeric_limits<track_t>::max())
 			{
 				nOfValidTracks[col] += 1;
 				nOfValidObservations[row] += 1;
@@ -453,12 +423,7 @@ void AssignmentProblemSolver::assignmentsuboptimal1(assignments_t& assignment, t
 	if (infiniteValueFound)
 	{
 		if (!finiteValueFound)
-		{
-            /* free allocated memory */
-            free(nOfValidObservations);
-            free(nOfValidTracks);
 			return;
-		}
 		bool repeatSteps = true;
 
 		while (repeatSteps)
@@ -471,7 +436,7 @@ void AssignmentProblemSolver::assignmentsuboptimal1(assignments_t& assignment, t
 				bool singleValidationFound = false;
                 for (size_t row = 0; row < nOfRows; ++row)
 				{
-                    if (m_distMatrix[row + nOfRows * col] != std::numeric_limits<track_t>::max() && (nOfValidObservations[row] == 1))
+                    if (m_distMatrix(row, col) != std::numeric_limits<track_t>::max() && (nOfValidObservations[row] == 1))
 					{
 						singleValidationFound = true;
 						break;
@@ -480,9 +445,9 @@ void AssignmentProblemSolver::assignmentsuboptimal1(assignments_t& assignment, t
 				if (singleValidationFound)
 				{
                     for (size_t nestedRow = 0; nestedRow < nOfRows; ++nestedRow)
-                        if ((nOfValidObservations[nestedRow] > 1) && m_distMatrix[nestedRow + nOfRows * col] != std::numeric_limits<track_t>::max())
+                        if ((nOfValidObservations[nestedRow] > 1) && m_distMatrix(nestedRow, col) != std::numeric_limits<track_t>::max())
 						{
-                            m_distMatrix[nestedRow + nOfRows * col] = std::numeric_limits<track_t>::max();
+                            m_distMatrix(nestedRow, col) = std::numeric_limits<track_t>::max();
 							nOfValidObservations[nestedRow] -= 1;
 							nOfValidTracks[col] -= 1;
 							repeatSteps = true;
@@ -498,7 +463,7 @@ void AssignmentProblemSolver::assignmentsuboptimal1(assignments_t& assignment, t
 					bool singleValidationFound = false;
                     for (size_t col = 0; col < nOfColumns; ++col)
 					{
-                        if (m_distMatrix[row + nOfRows*col] != std::numeric_limits<track_t>::max() && (nOfValidTracks[col] == 1))
+                        if (m_distMatrix(row, col) != std::numeric_limits<track_t>::max() && (nOfValidTracks[col] == 1))
 						{
 							singleValidationFound = true;
 							break;
@@ -509,9 +474,9 @@ void AssignmentProblemSolver::assignmentsuboptimal1(assignments_t& assignment, t
 					{
                         for (size_t col = 0; col < nOfColumns; ++col)
 						{
-                            if ((nOfValidTracks[col] > 1) && m_distMatrix[row + nOfRows*col] != std::numeric_limits<track_t>::max())
+                            if ((nOfValidTracks[col] > 1) && m_distMatrix(row, col) != std::numeric_limits<track_t>::max())
 							{
-                                m_distMatrix[row + nOfRows*col] = std::numeric_limits<track_t>::max();
+                                m_distMatrix(row, col) = std::numeric_limits<track_t>::max();
 								nOfValidObservations[row] -= 1;
 								nOfValidTracks[col] -= 1;
 								repeatSteps = true;
@@ -533,7 +498,7 @@ void AssignmentProblemSolver::assignmentsuboptimal1(assignments_t& assignment, t
 				size_t tmpCol = 0;
                 for (size_t col = 0; col < nOfColumns; ++col)
 				{
-                    const track_t value = m_distMatrix[row + nOfRows*col];
+                    const track_t value = m_distMatrix(row, col);
 					if (value != std::numeric_limits<track_t>::max())
 					{
 						if (nOfValidTracks[col] > 1)
@@ -555,11 +520,11 @@ void AssignmentProblemSolver::assignmentsuboptimal1(assignments_t& assignment, t
 					cost += minValue;
                     for (size_t n = 0; n < nOfRows; ++n)
 					{
-                        m_distMatrix[n + nOfRows*tmpCol] = std::numeric_limits<track_t>::max();
+                        m_distMatrix(n, tmpCol) = std::numeric_limits<track_t>::max();
 					}
                     for (size_t n = 0; n < nOfColumns; ++n)
 					{
-                        m_distMatrix[row + nOfRows*n] = std::numeric_limits<track_t>::max();
+                        m_distMatrix(row, n) = std::numeric_limits<track_t>::max();
 					}
 				}
 			}
@@ -575,7 +540,7 @@ void AssignmentProblemSolver::assignmentsuboptimal1(assignments_t& assignment, t
 				size_t tmpRow = 0;
                 for (size_t row = 0; row < nOfRows; ++row)
 				{
-                    const track_t value = m_distMatrix[row + nOfRows*col];
+                    const track_t value = m_distMatrix(row, col);
 					if (value != std::numeric_limits<track_t>::max())
 					{
 						if (nOfValidObservations[row] > 1)
@@ -597,11 +562,11 @@ void AssignmentProblemSolver::assignmentsuboptimal1(assignments_t& assignment, t
 					cost += minValue;
                     for (size_t n = 0; n < nOfRows; ++n)
 					{
-                        m_distMatrix[n + nOfRows*col] = std::numeric_limits<track_t>::max();
+                        m_distMatrix(n, col) = std::numeric_limits<track_t>::max();
 					}
                     for (size_t n = 0; n < nOfColumns; ++n)
 					{
-                        m_distMatrix[tmpRow + nOfRows*n] = std::numeric_limits<track_t>::max();
+                        m_distMatrix(tmpRow, n) = std::numeric_limits<track_t>::max();
 					}
 				}
 			}
@@ -620,7 +585,7 @@ void AssignmentProblemSolver::assignmentsuboptimal1(assignments_t& assignment, t
 		{
             for (size_t col = 0; col < nOfColumns; ++col)
 			{
-                const track_t value = m_distMatrix[row + nOfRows*col];
+                const track_t value = m_distMatrix(row, col);
 				if (value != std::numeric_limits<track_t>::max() && (value < minValue))
 				{
 					minValue = value;
@@ -636,11 +601,11 @@ void AssignmentProblemSolver::assignmentsuboptimal1(assignments_t& assignment, t
 			cost += minValue;
             for (size_t n = 0; n < nOfRows; ++n)
 			{
-                m_distMatrix[n + nOfRows*tmpCol] = std::numeric_limits<track_t>::max();
+                m_distMatrix(n, tmpCol) = std::numeric_limits<track_t>::max();
 			}
             for (size_t n = 0; n < nOfColumns; ++n)
 			{
-                m_distMatrix[tmpRow + nOfRows*n] = std::numeric_limits<track_t>::max();
+                m_distMatrix(tmpRow, n) = std::numeric_limits<track_t>::max();
 			}
 		}
 		else
@@ -648,8 +613,4 @@ void AssignmentProblemSolver::assignmentsuboptimal1(assignments_t& assignment, t
 			break;
 		}
 	}
-
-	/* free allocated memory */
-	free(nOfValidObservations);
-	free(nOfValidTracks);
 }
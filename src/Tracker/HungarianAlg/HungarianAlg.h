@@ -1,4 +1,5 @@
 #include <vector>
+#include <memory>
 #include <iostream>
 #include <limits>
 #include <time.h>
@@ -37,5 +38,11 @@ private:
 	// Computes a suboptimal solution. Good for cases with many forbidden assignments.
 	void assignmentsuboptimal2(assignments_t& assignment, track_t& cost, const distMatrix_t& distMatrixIn, size_t nOfRows, size_t nOfColumns);
 
-    std::vector<track_t> m_distMatrix;
+    // Scratch buffers are kept between the calls and grow only
+    distMatrix_t m_distMatrix;     // Working copy, the solver changes the costs
+    std::vector<track_t> m_colMin;
+    std::unique_ptr<bool[]> m_bools;
+    size_t m_boolsCapacity = 0;
+    std::vector<int> m_validObservations;
+    std::vector<int> m_validTracks;
 };
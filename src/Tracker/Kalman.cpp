@@ -1,6 +1,7 @@
 #include "Kalman.h"
 #include <iostream>
 #include <vector>
+#include <algorithm>
 
 #ifdef USE_OCV_UKF
 #if (((CV_VERSION_MAJOR == 4) && (CV_VERSION_MINOR < 5)) || ((CV_VERSION_MAJOR == 4) && (CV_VERSION_MINOR == 5) && (CV_VERSION_REVISION < 1)) || (CV_VERSION_MAJOR == 3))
@@ -10,12 +11,167 @@ namespace kalman = cv::detail::tracking;
 #endif
 #endif
 
+namespace
+{
+///
+/// \brief ConstantVelocityPointModel
+/// \param deltaTime - time step of the transition matrix
+/// \param noiseDeltaTime - time step of the process noise
+/// \param accelNoiseMag
+/// \param transition - 4 x 4 values
+/// \param processNoise - 4 x 4 values
+///
+void ConstantVelocityPointModel(track_t deltaTime, track_t noiseDeltaTime, track_t accelNoiseMag, track_t* transition, track_t* processNoise)
+{
+    // 4 state variables, 2 measurements
+    const track_t dt = deltaTime;
+    const track_t transitionVals[] = {
+        1, 0, dt, 0,
+        0, 1, 0,  dt,
+        0, 0, 1,  0,
+        0, 0, 0,  1 };
+
+    const track_t n1 = accelNoiseMag * pow(noiseDeltaTime, 4.f) / 4.f;
+    const track_t n2 = accelNoiseMag * pow(noiseDeltaTime, 3.f) / 2.f;
+    const track_t n3 = accelNoiseMag * pow(noiseDeltaTime, 2.f);
+    const track_t processNoiseVals[] = {
+        n1, 0,  n2, 0,
+        0,  n1, 0,  n2,
+        n2, 0,  n3, 0,
+        0,  n2, 0,  n3 };
+    std::copy(std::begin(transitionVals), std::end(transitionVals), transition);
+    std::copy(std::begin(processNoiseVals), std::end(processNoiseVals), processNoise);
+}
+
+///
+/// \brief ConstantVelocityRectModel
+/// \param deltaTime - time step of the transition matrix
+/// \param noiseDeltaTime - time step of the process noise
+/// \param accelNoiseMag
+/// \param transition - 8 x 8 values
+/// \param processNoise - 8 x 8 values
+///
+void ConstantVelocityRectModel(track_t deltaTime, track_t noiseDeltaTime, track_t accelNoiseMag, track_t* transition, track_t* processNoise)
+{
+    // 8 state variables (x, y, width, height, vx, vy, vw, vh), 4 measurements (x, y, width, height)
+    const track_t dt = deltaTime;
+    const track_t transitionVals[] = {
+        1, 0, 0, 0, dt, 0,  0,  0,
+        0, 1, 0, 0, 0,  dt, 0,  0,
+        0, 0, 1, 0, 0,  0,  dt, 0,
+        0, 0, 0, 1, 0,  0,  0,  dt,
+        0, 0, 0, 0, 1,  0,  0,  0,
+        0, 0, 0, 0, 0,  1,  0,  0,
+        0, 0, 0, 0, 0,  0,  1,  0,
+        0, 0, 0, 0, 0,  0,  0,  1 };
+
+    const track_t n1 = accelNoiseMag * pow(noiseDeltaTime, 4.f) / 4.f;
+    const track_t n2 = accelNoiseMag * pow(noiseDeltaTime, 3.f) / 2.f;
+    const track_t n3 = accelNoiseMag * pow(noiseDeltaTime, 2.f);
+    const track_t processNoiseVals[] = {
+        n1, 0,  0,  0,  n2, 0,  0,  0,
+        0,  n1, 0,  0,  0,  n2, 0,  0,
+        0,  0,  n1, 0,  0,  0,  n2, 0,
+        0,  0,  0,  n1, 0,  0,  0,  n2,
+        n2, 0,  0,  0,  n3, 0,  0,  0,
+        0,  n2, 0,  0,  0,  n3, 0,  0,
+        0,  0,  n2, 0,  0,  0,  n3, 0,
+        0,  0,  0,  n2, 0,  0,  0,  n3 };
+    std::copy(std::begin(transitionVals), std::end(transitionVals), transition);
+    std::copy(std::begin(processNoiseVals), std::end(processNoiseVals), processNoise);
+}
+
+///
+/// \brief ConstantAccelerationPointModel
+/// \param deltaTime - time step of the transition matrix
+/// \param noiseDeltaTime - time step of the process noise
+/// \param accelNoiseMag
+/// \param transition - 6 x 6 values
+/// \param processNoise - 6 x 6 values
+///
+void ConstantAccelerationPointModel(track_t deltaTime, track_t noiseDeltaTime, track_t accelNoiseMag, track_t* transition, track_t* processNoise)
+{
+    // 6 state variables, 2 measurements
+    const track_t dt = deltaTime;
+    const track_t dt2 = 0.5f * deltaTime * deltaTime;
+    const track_t transitionVals[] = {
+        1, 0, dt, 0,  dt2, 0,
+        0, 1, 0,  dt, 0,   dt2,
+        0, 0, 1,  0,  dt,  0,
+        0, 0, 0,  1,  0,   dt,
+        0, 0, 0,  0,  1,   0,
+        0, 0, 0,  0,  0,   1 };
+
+    const track_t n1 = accelNoiseMag * pow(noiseDeltaTime, 4.f) / 4.f;
+    const track_t n2 = accelNoiseMag * pow(noiseDeltaTime, 3.f) / 2.f;
+    const track_t n3 = accelNoiseMag * pow(noiseDeltaTime, 2.f);
+    const track_t processNoiseVals[] = {
+        n1, 0, n2, 0, n2, 0,
+        0, n1, 0, n2, 0, n2,
+        n2, 0, n3, 0, n3, 0,
+        0, n2, 0, n3, 0, n3,
+        0, 0, n2, 0, n3, 0,
+        0, 0, 0, n2, 0, n3 };
+    std::copy(std::begin(transitionVals), std::end(transitionVals), transition);
+    std::copy(std::begin(processNoiseVals), std::end(processNoiseVals), processNoise);
+}
+
+///
+/// \brief ConstantAccelerationRectModel
+/// \param deltaTime - time step of the transition matrix
+/// \param noiseDeltaTime - time step of the process noise
+/// \param accelNoiseMag
+/// \param transition - 12 x 12 values
+/// \param processNoise - 12 x 12 values
+///
+void ConstantAccelerationRectModel(track_t deltaTime, track_t noiseDeltaTime, track_t accelNoiseMag, track_t* transition, track_t* processNoise)
+{
+    // 12 state variables (x, y, width, height, vx, vy, vw, vh, ax, ay, aw, ah), 4 measurements (x, y, width, height)
+    const track_t dt = deltaTime;
+    const track_t dt2 = 0.5f * deltaTime * deltaTime;
+    const track_t transitionVals[] = {
+        1, 0, 0, 0, dt, 0,  0,  0,  dt2, 0,   dt2, 0,
+        0, 1, 0, 0, 0,  dt, 0,  0,  0,   dt2, 0,   dt2,
+        0, 0, 1, 0, 0,  0,  dt, 0,  0,   0,   dt2, 0,
+        0, 0, 0, 1, 0,  0,  0,  dt, 0,   0,   0,   dt2,
+        0, 0, 0, 0, 1,  0,  0,  0,  dt,  0,   0,   0,
+        0, 0, 0, 0, 0,  1,  0,  0,  0,   dt,  0,   0,
+        0, 0, 0, 0, 0,  0,  1,  0,  0,   0,   dt,  0,
+        0, 0, 0, 0, 0,  0,  0,  1,  0,   0,   0,   dt,
+        0, 0, 0, 0, 0,  0,  0,  0,  1,   0,   0,   0,
+        0, 0, 0, 0, 0,  0,  0,  0,  0,   1,   0,   0,
+        0, 0, 0, 0, 0,  0,  0,  0,  0,   0,   1,   0,
+        0, 0, 0, 0, 0,  0,  0,  0,  0,   0,   0,   1 };
+
+    const track_t n1 = accelNoiseMag * pow(noiseDeltaTime, 4.f) / 4.f;
+    const track_t n2 = accelNoiseMag * pow(noiseDeltaTime, 3.f) / 2.f;
+    const track_t n3 = accelNoiseMag * pow(noiseDeltaTime, 2.f);
+    const track_t processNoiseVals[] = {
+        n1, 0,  0,  0,  n2, 0,  0,  0,  n2, 0,  n2, 0,
+        0,  n1, 0,  0,  0,  n2, 0,  0,  0,  n2, 0,  n2,
+        0,  0,  n1, 0,  0,  0,  n2, 0,  0,  0,  n2, 0,
+        0,  0,  0,  n1, 0,  0,  0,  n2, 0,  0,  0,  n2,
+        n2, 0,  0,  0,  n3, 0,  0,  0,  n3, 0,  n3, 0,
+        0,  n2, 0,  0,  0,  n3, 0,  0,  0,  n3, 0,  n3,
+        0,  0,  n2, 0,  0,  0,  n3, 0,  0,  0,  n3, 0,
+        0,  0,  0,  n2, 0,  0,  0,  n3, 0,  0,  0,  n3,
+        n2, 0,  0,  0,  n3, 0,  0,  0,  n3, 0,  0,  0,
+        0,  n2, 0,  0,  0,  n3, 0,  0,  0,  n3, 0,  0,
+        0,  0,  n2, 0,  0,  0,  n3, 0,  0,  0,  n3, 0,
+        0,  0,  0,  n2, 0,  0,  0,  n3, 0,  0,  0,  n3 };
+    std::copy(std::begin(transitionVals), std::end(transitionVals), transition);
+    std::copy(std::begin(processNoiseVals), std::end(processNoiseVals), processNoise);
+}
+}
+
 //---------------------------------------------------------------------------
 TKalmanFilter::TKalmanFilter(
         tracking::KalmanType type,
 	    bool useAcceleration,
         track_t deltaTime, // time increment (lower values makes target more "massive")
-        track_t accelNoiseMag
+        track_t accelNoiseMag,
+        bool steadyStateGain,
+        std::shared_ptr<KalmanBatch> batch
         )
     :
       m_accelNoiseMag(accelNoiseMag),
@@ -23,9 +179,23 @@ TKalmanFilter::TKalmanFilter(
       m_deltaTimeMin(deltaTime),
       m_deltaTimeMax(2 * deltaTime),
       m_type(type),
-      m_useAcceleration(useAcceleration)
+      m_useAcceleration(useAcceleration),
+      m_steadyStateGain(steadyStateGain)
 {
     m_deltaStep = (m_deltaTimeMax - m_deltaTimeMin) / m_deltaStepsCount;
+
+    if (batch && m_type == tracking::KalmanLinear && !m_useAcceleration)
+    {
+        m_batch = batch;
+        m_batchSlot = m_batch->Acquire();
+    }
+}
+
+//---------------------------------------------------------------------------
+TKalmanFilter::~TKalmanFilter()
+{
+    if (m_batch)
+        m_batch->Release(m_batchSlot);
 }
 
 //---------------------------------------------------------------------------
@@ -36,41 +206,27 @@ void TKalmanFilter::CreateLinear(Point_t xy0, Point_t xyv0)
     // Process noise. (standard deviation of acceleration: m/s^2)
     // shows, woh much target can accelerate.
 
+    if (m_batch)
+    {
+        m_lastPointResult = xy0;
+        const track_t pos[] = { xy0.x, xy0.y };
+        const track_t vel[] = { xyv0.x, xyv0.y };
+        m_batch->Init(m_batchSlot, pos, vel, m_deltaTime * m_timeScale);
+        m_batch->SetTimeScale(m_batchSlot, m_timeScale);
+        m_initialized = true;
+        return;
+    }
+
     // 4 state variables, 2 measurements
-    m_linearKalman.init(4, 2, 0, El_t);
-    // Transition cv::Matrix
-    m_linearKalman.transitionMatrix = (cv::Mat_<track_t>(4, 4) <<
-                                        1, 0, m_deltaTime, 0,
-                                        0, 1, 0, m_deltaTime,
-                                        0, 0, 1, 0,
-                                        0, 0, 0, 1);
+    track_t transition[4 * 4];
+    track_t processNoise[4 * 4];
+    ConstantVelocityPointModel(m_deltaTime, m_deltaTime, m_accelNoiseMag, transition, processNoise);
 
     // init...
     m_lastPointResult = xy0;
-    m_linearKalman.statePre.at<track_t>(0) = xy0.x;  // x
-    m_linearKalman.statePre.at<track_t>(1) = xy0.y;  // y
-    m_linearKalman.statePre.at<track_t>(2) = xyv0.x; // vx
-    m_linearKalman.statePre.at<track_t>(3) = xyv0.y; // vy
+    const track_t state0[] = { xy0.x, xy0.y, xyv0.x, xyv0.y };
 
-    m_linearKalman.statePost.at<track_t>(0) = xy0.x;
-    m_linearKalman.statePost.at<track_t>(1) = xy0.y;
-    m_linearKalman.statePost.at<track_t>(2) = xyv0.x;
-    m_linearKalman.statePost.at<track_t>(3) = xyv0.y;
-
-    cv::setIdentity(m_linearKalman.measurementMatrix);
-
-    m_linearKalman.processNoiseCov = (cv::Mat_<track_t>(4, 4) <<
-                                       pow(m_deltaTime,4.0)/4.0	,0						,pow(m_deltaTime,3.0)/2.0		,0,
-                                       0						,pow(m_deltaTime,4.0)/4.0	,0							,pow(m_deltaTime,3.0)/2.0,
-                                       pow(m_deltaTime,3.0)/2.0	,0						,pow(m_deltaTime,2.0)			,0,
-                                       0						,pow(m_deltaTime,3.0)/2.0	,0							,pow(m_deltaTime,2.0));
-
-
-    m_linearKalman.processNoiseCov *= m_accelNoiseMag;
-
-    cv::setIdentity(m_linearKalman.measurementNoiseCov, cv::Scalar::all(0.1));
-
-    cv::setIdentity(m_linearKalman.errorCovPost, cv::Scalar::all(.1));
+    m_linearKalman = std::make_unique<KalmanModel<4, 2>>(transition, processNoise, state0, 0.1f, 0.1f, m_steadyStateGain);
 
 	m_initialPoints.reserve(MIN_INIT_VALS);
 
@@ -85,58 +241,25 @@ void TKalmanFilter::CreateLinear(cv::Rect_<track_t> rect0, Point_t rectv0)
     // Process noise. (standard deviation of acceleration: m/s^2)
     // shows, woh much target can accelerate.
 
-    // 8 state variables (x, y, vx, vy, width, height, vw, vh), 4 measurements (x, y, width, height)
-    m_linearKalman.init(8, 4, 0, El_t);
-    // Transition cv::Matrix
-    m_linearKalman.transitionMatrix = (cv::Mat_<track_t>(8, 8) <<
-                                        1, 0, 0, 0, m_deltaTime, 0,           0,           0,
-                                        0, 1, 0, 0, 0,           m_deltaTime, 0,           0,
-                                        0, 0, 1, 0, 0,           0,           m_deltaTime, 0,
-                                        0, 0, 0, 1, 0,           0,           0,           m_deltaTime,
-                                        0, 0, 0, 0, 1,           0,           0,           0,
-                                        0, 0, 0, 0, 0,           1,           0,           0,
-                                        0, 0, 0, 0, 0,           0,           1,           0,
-                                        0, 0, 0, 0, 0,           0,           0,           1);
+    if (m_batch)
+    {
+        const track_t pos[] = { rect0.x, rect0.y, rect0.width, rect0.height };
+        const track_t vel[] = { rectv0.x, rectv0.y, 0, 0 };
+        m_batch->Init(m_batchSlot, pos, vel, m_deltaTime * m_timeScale);
+        m_batch->SetTimeScale(m_batchSlot, m_timeScale);
+        m_initialized = true;
+        return;
+    }
+
+    // 8 state variables (x, y, width, height, vx, vy, vw, vh), 4 measurements (x, y, width, height)
+    track_t transition[8 * 8];
+    track_t processNoise[8 * 8];
+    ConstantVelocityRectModel(m_deltaTime, m_deltaTime, m_accelNoiseMag, transition, processNoise);
 
     // init...
-    m_linearKalman.statePre.at<track_t>(0) = rect0.x;      // x
-    m_linearKalman.statePre.at<track_t>(1) = rect0.y;      // y
-    m_linearKalman.statePre.at<track_t>(2) = rect0.width;  // width
-    m_linearKalman.statePre.at<track_t>(3) = rect0.height; // height
-    m_linearKalman.statePre.at<track_t>(4) = rectv0.x;     // dx
-    m_linearKalman.statePre.at<track_t>(5) = rectv0.y;     // dy
-    m_linearKalman.statePre.at<track_t>(6) = 0;            // dw
-    m_linearKalman.statePre.at<track_t>(7) = 0;            // dh
-
-    m_linearKalman.statePost.at<track_t>(0) = rect0.x;
-    m_linearKalman.statePost.at<track_t>(1) = rect0.y;
-    m_linearKalman.statePost.at<track_t>(2) = rect0.width;
-    m_linearKalman.statePost.at<track_t>(3) = rect0.height;
-    m_linearKalman.statePost.at<track_t>(4) = rectv0.x;
-    m_linearKalman.statePost.at<track_t>(5) = rectv0.y;
-    m_linearKalman.statePost.at<track_t>(6) = 0;
-    m_linearKalman.statePost.at<track_t>(7) = 0;
-
-    cv::setIdentity(m_linearKalman.measurementMatrix);
-
-    track_t n1 = pow(m_deltaTime, 4.f) / 4.f;
-    track_t n2 = pow(m_deltaTime, 3.f) / 2.f;
-    track_t n3 = pow(m_deltaTime, 2.f);
-    m_linearKalman.processNoiseCov = (cv::Mat_<track_t>(8, 8) <<
-                                       n1, 0,  0,  0,  n2, 0,  0,  0,
-                                       0,  n1, 0,  0,  0,  n2, 0,  0,
-                                       0,  0,  n1, 0,  0,  0,  n2, 0,
-                                       0,  0,  0,  n1, 0,  0,  0,  n2,
-                                       n2, 0,  0,  0,  n3, 0,  0,  0,
-                                       0,  n2, 0,  0,  0,  n3, 0,  0,
-                                       0,  0,  n2, 0,  0,  0,  n3, 0,
-                                       0,  0,  0,  n2, 0,  0,  0,  n3);
-
-    m_linearKalman.processNoiseCov *= m_accelNoiseMag;
-
-    cv::setIdentity(m_linearKalman.measurementNoiseCov, cv::Scalar::all(0.1));
-
-    cv::setIdentity(m_linearKalman.errorCovPost, cv::Scalar::all(.1));
+    const track_t state0[] = { rect0.x, rect0.y, rect0.width, rect0.height, rectv0.x, rectv0.y, 0, 0 };
+
+    m_linearKalman = std::make_unique<KalmanModel<8, 4>>(transition, processNoise, state0, 0.1f, 0.1f, m_steadyStateGain);
 
 	m_initialRects.reserve(MIN_INIT_VALS);
 
@@ -147,52 +270,15 @@ void TKalmanFilter::CreateLinear(cv::Rect_<track_t> rect0, Point_t rectv0)
 void TKalmanFilter::CreateLinearAcceleration(Point_t xy0, Point_t xyv0)
 {
 	// 6 state variables, 2 measurements
-	m_linearKalman.init(6, 2, 0, El_t);
-	// Transition cv::Matrix
-	const track_t dt = m_deltaTime;
-	const track_t dt2 = 0.5f * m_deltaTime * m_deltaTime;
-	m_linearKalman.transitionMatrix = (cv::Mat_<track_t>(6, 6) <<
-		1, 0, dt, 0,  dt2, 0,
-		0, 1, 0,  dt, 0,   dt2,
-		0, 0, 1,  0,  dt,  0,
-		0, 0, 0,  1,  0,   dt,
-	    0, 0, 0,  0,  1,   0,
-	    0, 0, 0,  0,  0,   1);
+	track_t transition[6 * 6];
+	track_t processNoise[6 * 6];
+	ConstantAccelerationPointModel(m_deltaTime, m_deltaTime, m_accelNoiseMag, transition, processNoise);
 
 	// init...
 	m_lastPointResult = xy0;
-	m_linearKalman.statePre.at<track_t>(0) = xy0.x;  // x
-	m_linearKalman.statePre.at<track_t>(1) = xy0.y;  // y
-	m_linearKalman.statePre.at<track_t>(2) = xyv0.x; // vx
-	m_linearKalman.statePre.at<track_t>(3) = xyv0.y; // vy
-	m_linearKalman.statePre.at<track_t>(4) = 0;      // ax
-	m_linearKalman.statePre.at<track_t>(5) = 0;      // ay
-
-	m_linearKalman.statePost.at<track_t>(0) = xy0.x;
-	m_linearKalman.statePost.at<track_t>(1) = xy0.y;
-	m_linearKalman.statePost.at<track_t>(2) = xyv0.x;
-	m_linearKalman.statePost.at<track_t>(3) = xyv0.y;
-	m_linearKalman.statePost.at<track_t>(4) = 0;
-	m_linearKalman.statePost.at<track_t>(5) = 0;
-
-	cv::setIdentity(m_linearKalman.measurementMatrix);
-
-	track_t n1 = pow(m_deltaTime, 4.f) / 4.f;
-	track_t n2 = pow(m_deltaTime, 3.f) / 2.f;
-	track_t n3 = pow(m_deltaTime, 2.f);
-	m_linearKalman.processNoiseCov = (cv::Mat_<track_t>(6, 6) <<
-		n1, 0, n2, 0, n2, 0,
-		0, n1, 0, n2, 0, n2,
-		n2, 0, n3, 0, n3, 0,
-		0, n2, 0, n3, 0, n3,
-		0, 0, n2, 0, n3, 0,
-		0, 0, 0, n2, 0, n3);
-
-	m_linearKalman.processNoiseCov *= m_accelNoiseMag;
-
-	cv::setIdentity(m_linearKalman.measurementNoiseCov, cv::Scalar::all(0.1));
-
-	cv::setIdentity(m_linearKalman.errorCovPost, cv::Scalar::all(.1));
+	const track_t state0[] = { xy0.x, xy0.y, xyv0.x, xyv0.y, 0, 0 };
+
+	m_linearKalman = std::make_unique<KalmanModel<6, 2>>(transition, processNoise, state0, 0.1f, 0.1f, m_steadyStateGain);
 
 	m_initialPoints.reserve(MIN_INIT_VALS);
 
@@ -202,76 +288,15 @@ void TKalmanFilter::CreateLinearAcceleration(Point_t xy0, Point_t xyv0)
 //---------------------------------------------------------------------------
 void TKalmanFilter::CreateLinearAcceleration(cv::Rect_<track_t> rect0, Point_t rectv0)
 {
-	// 12 state variables (x, y, vx, vy, ax, ay, width, height, vw, vh, aw, ah), 4 measurements (x, y, width, height)
-	m_linearKalman.init(12, 4, 0, El_t);
-	// Transition cv::Matrix
-	const track_t dt = m_deltaTime;
-	const track_t dt2 = 0.5f * m_deltaTime * m_deltaTime;
-	m_linearKalman.transitionMatrix = (cv::Mat_<track_t>(12, 12) <<
-		1, 0, 0, 0, dt, 0,  0,  0,  dt2, 0,   dt2, 0,
-		0, 1, 0, 0, 0,  dt, 0,  0,  0,   dt2, 0,   dt2,
-		0, 0, 1, 0, 0,  0,  dt, 0,  0,   0,   dt2, 0,
-		0, 0, 0, 1, 0,  0,  0,  dt, 0,   0,   0,   dt2,
-		0, 0, 0, 0, 1,  0,  0,  0,  dt,  0,   0,   0,
-		0, 0, 0, 0, 0,  1,  0,  0,  0,   dt,  0,   0,
-		0, 0, 0, 0, 0,  0,  1,  0,  0,   0,   dt,  0,
-		0, 0, 0, 0, 0,  0,  0,  1,  0,   0,   0,   dt,
-		0, 0, 0, 0, 0,  0,  0,  0,  1,   0,   0,   0,
-		0, 0, 0, 0, 0,  0,  0,  0,  0,   1,   0,   0,
-		0, 0, 0, 0, 0,  0,  0,  0,  0,   0,   1,   0,
-		0, 0, 0, 0, 0,  0,  0,  0,  0,   0,   0,   1);
+	// 12 state variables (x, y, width, height, vx, vy, vw, vh, ax, ay, aw, ah), 4 measurements (x, y, width, height)
+	track_t transition[12 * 12];
+	track_t processNoise[12 * 12];
+	ConstantAccelerationRectModel(m_deltaTime, m_deltaTime, m_accelNoiseMag, transition, processNoise);
 
 	// init...
-	m_linearKalman.statePre.at<track_t>(0) = rect0.x;      // x
-	m_linearKalman.statePre.at<track_t>(1) = rect0.y;      // y
-	m_linearKalman.statePre.at<track_t>(2) = rect0.width;  // width
-	m_linearKalman.statePre.at<track_t>(3) = rect0.height; // height
-	m_linearKalman.statePre.at<track_t>(4) = rectv0.x;     // dx
-	m_linearKalman.statePre.at<track_t>(5) = rectv0.y;     // dy
-	m_linearKalman.statePre.at<track_t>(6) = 0;            // dw
-	m_linearKalman.statePre.at<track_t>(7) = 0;            // dh
-	m_linearKalman.statePre.at<track_t>(8) = 0;            // ax
-	m_linearKalman.statePre.at<track_t>(9) = 0;            // ay
-	m_linearKalman.statePre.at<track_t>(10) = 0;           // aw
-	m_linearKalman.statePre.at<track_t>(11) = 0;           // ah
-
-	m_linearKalman.statePost.at<track_t>(0) = rect0.x;
-	m_linearKalman.statePost.at<track_t>(1) = rect0.y;
-	m_linearKalman.statePost.at<track_t>(2) = rect0.width;
-	m_linearKalman.statePost.at<track_t>(3) = rect0.height;
-	m_linearKalman.statePost.at<track_t>(4) = rectv0.x;
-	m_linearKalman.statePost.at<track_t>(5) = rectv0.y;
-	m_linearKalman.statePost.at<track_t>(6) = 0;
-	m_linearKalman.statePost.at<track_t>(7) = 0;
-	m_linearKalman.statePost.at<track_t>(8) = 0;
-	m_linearKalman.statePost.at<track_t>(9) = 0;
-	m_linearKalman.statePost.at<track_t>(10) = 0;
-	m_linearKalman.statePost.at<track_t>(11) = 0;
-
-	cv::setIdentity(m_linearKalman.measurementMatrix);
-
-	track_t n1 = pow(m_deltaTime, 4.f) / 4.f;
-	track_t n2 = pow(m_deltaTime, 3.f) / 2.f;
-	track_t n3 = pow(m_deltaTime, 2.f);
-	m_linearKalman.processNoiseCov = (cv::Mat_<track_t>(12, 12) <<
-		n1, 0,  0,  0,  n2, 0,  0,  0,  n2, 0,  n2, 0,
-		0,  n1, 0,  0,  0,  n2, 0,  0,  0,  n2, 0,  n2,
-		0,  0,  n1, 0,  0,  0,  n2, 0,  0,  0,  n2, 0,
-		0,  0,  0,  n1, 0,  0,  0,  n2, 0,  0,  0,  n2,
-		n2, 0,  0,  0,  n3, 0,  0,  0,  n3, 0,  n3, 0,
-		0,  n2, 0,  0,  0,  n3, 0,  0,  0,  n3, 0,  n3,
-		0,  0,  n2, 0,  0,  0,  n3, 0,  0,  0,  n3, 0,
-		0,  0,  0,  n2, 0,  0,  0,  n3, 0,  0,  0,  n3,
-		n2, 0,  0,  0,  n3, 0,  0,  0,  n3, 0,  0,  0,
-		0,  n2, 0,  0,  0,  n3, 0,  0,  0,  n3, 0,  0,
-		0,  0,  n2, 0,  0,  0,  n3, 0,  0,  0,  n3, 0,
-		0,  0,  0,  n2, 0,  0,  0,  n3, 0,  0,  0,  n3);
-
-	m_linearKalman.processNoiseCov *= m_accelNoiseMag;
-
-	cv::setIdentity(m_linearKalman.measurementNoiseCov, cv::Scalar::all(0.1));
-
-	cv::setIdentity(m_linearKalman.errorCovPost, cv::Scalar::all(.1));
+	const track_t state0[] = { rect0.x, rect0.y, rect0.width, rect0.height, rectv0.x, rectv0.y, 0, 0, 0, 0, 0, 0 };
+
+	m_linearKalman = std::make_unique<KalmanModel<12, 4>>(transition, processNoise, state0, 0.1f, 0.1f, m_steadyStateGain);
 
 	m_initialRects.reserve(MIN_INIT_VALS);
 
@@ -538,33 +563,92 @@ void TKalmanFilter::CreateAugmentedUnscented(cv::Rect_<track_t> rect0, Point_t r
 
     m_initialized = true;
 }
+
+#else
+//---------------------------------------------------------------------------
+void TKalmanFilter::CreateUnscented(Point_t xy0, Point_t xyv0)
+{
+    // The same state and noises as with opencv_contrib: x, y, vx, vy, ax, ay
+    const track_t state0[] = { xy0.x, xy0.y, xyv0.x, xyv0.y, 0, 0 };
+    const track_t processNoise[] = { 1e-14f, 1e-14f, 1e-6f, 1e-6f, 1e-6f, 1e-6f };
+    m_unscentedKalman = std::make_unique<UnscentedModel<6, 2, false>>(state0, processNoise, 1e-6f, 1e-6f);
+
+    m_lastPointResult = xy0;
+    m_initialized = true;
+}
+
+//---------------------------------------------------------------------------
+void TKalmanFilter::CreateUnscented(cv::Rect_<track_t> rect0, Point_t rectv0)
+{
+    // x, y, vx, vy, ax, ay, width, height
+    const track_t state0[] = { rect0.x, rect0.y, rectv0.x, rectv0.y, 0, 0, rect0.width, rect0.height };
+    const track_t processNoise[] = { 1e-3f, 1e-3f, 1e-3f, 1e-3f, 1e-3f, 1e-3f, 1e-3f, 1e-3f };
+    m_unscentedKalman = std::make_unique<UnscentedModel<8, 4, false>>(state0, processNoise, 1e-3f, 1e-3f);
+
+    m_initialized = true;
+}
+
+//---------------------------------------------------------------------------
+void TKalmanFilter::CreateAugmentedUnscented(Point_t xy0, Point_t xyv0)
+{
+    const track_t state0[] = { xy0.x, xy0.y, xyv0.x, xyv0.y, 0, 0 };
+    const track_t processNoise[] = { 1e-14f, 1e-14f, 1e-6f, 1e-6f, 1e-6f, 1e-6f };
+    m_unscentedKalman = std::make_unique<UnscentedModel<6, 2, true>>(state0, processNoise, 1e-6f, 1e-6f);
+
+    m_lastPointResult = xy0;
+    m_initialized = true;
+}
+
+//---------------------------------------------------------------------------
+void TKalmanFilter::CreateAugmentedUnscented(cv::Rect_<track_t> rect0, Point_t rectv0)
+{
+    const track_t state0[] = { rect0.x, rect0.y, rectv0.x, rectv0.y, 0, 0, rect0.width, rect0.height };
+    const track_t processNoise[] = { 1e-3f, 1e-3f, 1e-3f, 1e-3f, 1e-3f, 1e-3f, 1e-3f, 1e-3f };
+    m_unscentedKalman = std::make_unique<UnscentedModel<8, 4, true>>(state0, processNoise, 1e-3f, 1e-3f);
+
+    m_initialized = true;
+}
 #endif
 
 //---------------------------------------------------------------------------
 Point_t TKalmanFilter::GetPointPrediction()
 {
-    if (m_initialized)
+    if (m_initialized && m_batch)
+    {
+        // The batch pass could predict it already
+        if (!m_batch->ResetPredicted(m_batchSlot))
+            m_batch->Predict(m_batchSlot);
+        const track_t* pos = m_batch->Position(m_batchSlot);
+        m_lastPointResult = Point_t(pos[0], pos[1]);
+    }
+    else if (m_initialized)
     {
-        cv::Mat prediction;
+        const track_t* prediction = nullptr;
+#ifdef USE_OCV_UKF
+        cv::Mat ukfPrediction;
+#endif
+
+        if (m_linearKalman && m_timeScale != m_appliedTimeScale)
+            ApplyTimeScale();
 
         switch (m_type)
         {
         case tracking::KalmanLinear:
-            prediction = m_linearKalman.predict();
+            prediction = m_linearKalman->Predict();
             break;
 
         case tracking::KalmanUnscented:
         case tracking::KalmanAugmentedUnscented:
 #ifdef USE_OCV_UKF
-            prediction = m_uncsentedKalman->predict();
+            ukfPrediction = m_uncsentedKalman->predict();
+            prediction = ukfPrediction.ptr<track_t>();
 #else
-            prediction = m_linearKalman.predict();
-            std::cerr << "UnscentedKalmanFilter was disabled in CMAKE! Set KalmanLinear in constructor." << std::endl;
+            prediction = m_unscentedKalman->Predict(m_deltaTime * m_timeScale);
 #endif
             break;
         }
 
-        m_lastPointResult = Point_t(prediction.at<track_t>(0), prediction.at<track_t>(1));
+        m_lastPointResult = Point_t(prediction[0], prediction[1]);
     }
     return m_lastPointResult;
 }
@@ -602,67 +686,63 @@ Point_t TKalmanFilter::Update(Point_t pt, bool dataCorrect)
                 break;
 
             case tracking::KalmanUnscented:
-#ifdef USE_OCV_UKF
                 CreateUnscented(xy0, xyv0);
-#else
-				if (m_useAcceleration)
-					CreateLinearAcceleration(xy0, xyv0);
-				else
-					CreateLinear(xy0, xyv0);
-                std::cerr << "UnscentedKalmanFilter was disabled in CMAKE! Set KalmanLinear in constructor." << std::endl;
-#endif
                 break;
 
             case tracking::KalmanAugmentedUnscented:
-#ifdef USE_OCV_UKF
                 CreateAugmentedUnscented(xy0, xyv0);
-#else
-				if (m_useAcceleration)
-					CreateLinearAcceleration(xy0, xyv0);
-				else
-					CreateLinear(xy0, xyv0);
-                std::cerr << "AugmentedUnscentedKalmanFilter was disabled in CMAKE! Set KalmanLinear in constructor." << std::endl;
-#endif
                 break;
             }
             m_lastDist = 0;
         }
     }
 
-    if (m_initialized)
+    if (m_initialized && m_batch)
     {
-        cv::Mat measurement(2, 1, Mat_t(1));
+        const track_t meas[] = { dataCorrect ? pt.x : m_lastPointResult.x, dataCorrect ? pt.y : m_lastPointResult.y };
+        m_batch->Correct(m_batchSlot, meas);
+        const track_t* estimated = m_batch->Position(m_batchSlot);
+
+        // Inertia correction
+        InertiaCorrection(sqrtf(sqr(estimated[0] - pt.x) + sqr(estimated[1] - pt.y)));
+        m_batch->SetDeltaTime(m_batchSlot, m_deltaTime * m_timeScale);
+
+        m_lastPointResult.x = estimated[0];
+        m_lastPointResult.y = estimated[1];
+    }
+    else if (m_initialized)
+    {
+        track_t measurement[2];
         if (!dataCorrect)
         {
-            measurement.at<track_t>(0) = m_lastPointResult.x;  //update using prediction
-            measurement.at<track_t>(1) = m_lastPointResult.y;
+            measurement[0] = m_lastPointResult.x;  //update using prediction
+            measurement[1] = m_lastPointResult.y;
         }
         else
         {
-            measurement.at<track_t>(0) = pt.x;  //update using measurements
-            measurement.at<track_t>(1) = pt.y;
+            measurement[0] = pt.x;  //update using measurements
+            measurement[1] = pt.y;
         }
         // Correction
-        cv::Mat estimated;
+        const track_t* estimated = nullptr;
+#ifdef USE_OCV_UKF
+        cv::Mat ukfEstimated;
+#endif
         switch (m_type)
         {
         case tracking::KalmanLinear:
         {
-            estimated = m_linearKalman.correct(measurement);
+            if (!dataCorrect)
+                m_linearKalman->ResetSteadyState();
+            estimated = m_linearKalman->Correct(measurement);
 
             // Inertia correction
 			if (!m_useAcceleration)
 			{
-				track_t currDist = sqrtf(sqr(estimated.at<track_t>(0) - pt.x) + sqr(estimated.at<track_t>(1) - pt.y));
-				if (currDist > m_lastDist)
-					m_deltaTime = std::min(m_deltaTime + m_deltaStep, m_deltaTimeMax);
-				else
-					m_deltaTime = std::max(m_deltaTime - m_deltaStep, m_deltaTimeMin);
-
-				m_lastDist = currDist;
+				InertiaCorrection(sqrtf(sqr(estimated[0] - pt.x) + sqr(estimated[1] - pt.y)));
 
-				m_linearKalman.transitionMatrix.at<track_t>(0, 2) = m_deltaTime;
-				m_linearKalman.transitionMatrix.at<track_t>(1, 3) = m_deltaTime;
+				m_linearKalman->SetTransition(0, 2, m_deltaTime * m_appliedTimeScale);
+				m_linearKalman->SetTransition(1, 3, m_deltaTime * m_appliedTimeScale);
 			}
             break;
         }
@@ -670,16 +750,16 @@ Point_t TKalmanFilter::Update(Point_t pt, bool dataCorrect)
         case tracking::KalmanUnscented:
         case tracking::KalmanAugmentedUnscented:
 #ifdef USE_OCV_UKF
-            estimated = m_uncsentedKalman->correct(measurement);
+            ukfEstimated = m_uncsentedKalman->correct(cv::Mat(2, 1, Mat_t(1), measurement));
+            estimated = ukfEstimated.ptr<track_t>();
 #else
-            estimated = m_linearKalman.correct(measurement);
-            std::cerr << "UnscentedKalmanFilter was disabled in CMAKE! Set KalmanLinear in constructor." << std::endl;
+            estimated = m_unscentedKalman->Correct(measurement);
 #endif
             break;
         }
 
-        m_lastPointResult.x = estimated.at<track_t>(0);   //update using measurements
-        m_lastPointResult.y = estimated.at<track_t>(1);
+        m_lastPointResult.x = estimated[0];   //update using measurements
+        m_lastPointResult.y = estimated[1];
     }
     else
     {
@@ -692,28 +772,43 @@ Point_t TKalmanFilter::Update(Point_t pt, bool dataCorrect)
 //---------------------------------------------------------------------------
 cv::Rect TKalmanFilter::GetRectPrediction()
 {
-    if (m_initialized)
+    if (m_initialized && m_batch)
+    {
+        // The batch pass could predict it already
+        if (!m_batch->ResetPredicted(m_batchSlot))
+            m_batch->Predict(m_batchSlot);
+        const track_t* pos = m_batch->Position(m_batchSlot);
+        m_lastRectResult = cv::Rect_<track_t>(pos[0], pos[1], pos[2], pos[3]);
+    }
+    else if (m_initialized)
     {
-        cv::Mat prediction;
+        const track_t* prediction = nullptr;
+#ifdef USE_OCV_UKF
+        cv::Mat ukfPrediction;
+#endif
+
+        if (m_linearKalman && m_timeScale != m_appliedTimeScale)
+            ApplyTimeScale();
 
         switch (m_type)
         {
         case tracking::KalmanLinear:
-            prediction = m_linearKalman.predict();
+            prediction = m_linearKalman->Predict();
+            m_lastRectResult = cv::Rect_<track_t>(prediction[0], prediction[1], prediction[2], prediction[3]);
             break;
 
         case tracking::KalmanUnscented:
         case tracking::KalmanAugmentedUnscented:
 #ifdef USE_OCV_UKF
-            prediction = m_uncsentedKalman->predict();
+            ukfPrediction = m_uncsentedKalman->predict();
+            prediction = ukfPrediction.ptr<track_t>();
 #else
-            prediction = m_linearKalman.predict();
-            std::cerr << "UnscentedKalmanFilter was disabled in CMAKE! Set KalmanLinear in constructor." << std::endl;
+            prediction = m_unscentedKalman->Predict(m_deltaTime * m_timeScale);
 #endif
+            // The size is after the acceleration in the unscented state
+            m_lastRectResult = cv::Rect_<track_t>(prediction[0], prediction[1], prediction[6], prediction[7]);
             break;
         }
-
-        m_lastRectResult = cv::Rect_<track_t>(prediction.at<track_t>(0), prediction.at<track_t>(1), prediction.at<track_t>(2), prediction.at<track_t>(3));
     }
     return cv::Rect(static_cast<int>(m_lastRectResult.x), static_cast<int>(m_lastRectResult.y), static_cast<int>(m_lastRectResult.width), static_cast<int>(m_lastRectResult.height));
 }
@@ -721,6 +816,7 @@ cv::Rect TKalmanFilter::GetRectPrediction()
 //---------------------------------------------------------------------------
 cv::Rect TKalmanFilter::Update(cv::Rect rect, bool dataCorrect)
 {
+    m_rectModel = true;
     if (!m_initialized)
     {
         if (m_initialRects.size() < MIN_INIT_VALS)
@@ -765,77 +861,75 @@ cv::Rect TKalmanFilter::Update(cv::Rect rect, bool dataCorrect)
                 break;
 
             case tracking::KalmanUnscented:
-#ifdef USE_OCV_UKF
                 CreateUnscented(rect0, rectv0);
-#else
-				if (m_useAcceleration)
-					CreateLinearAcceleration(rect0, rectv0);
-				else
-					CreateLinear(rect0, rectv0);
-                std::cerr << "UnscentedKalmanFilter was disabled in CMAKE! Set KalmanLinear in constructor." << std::endl;
-#endif
                 break;
 
             case tracking::KalmanAugmentedUnscented:
-#ifdef USE_OCV_UKF
                 CreateAugmentedUnscented(rect0, rectv0);
-#else
-				if (m_useAcceleration)
-					CreateLinearAcceleration(rect0, rectv0);
-				else
-					CreateLinear(rect0, rectv0);
-                std::cerr << "AugmentedUnscentedKalmanFilter was disabled in CMAKE! Set KalmanLinear in constructor." << std::endl;
-#endif
                 break;
             }
         }
     }
 
-    if (m_initialized)
+    if (m_initialized && m_batch)
     {
-        cv::Mat measurement(4, 1, Mat_t(1));
+        const track_t meas[] = { dataCorrect ? static_cast<track_t>(rect.x) : m_lastRectResult.x,
+                                 dataCorrect ? static_cast<track_t>(rect.y) : m_lastRectResult.y,
+                                 dataCorrect ? static_cast<track_t>(rect.width) : m_lastRectResult.width,
+                                 dataCorrect ? static_cast<track_t>(rect.height) : m_lastRectResult.height };
+        m_batch->Correct(m_batchSlot, meas);
+        const track_t* estimated = m_batch->Position(m_batchSlot);
+
+        m_lastRectResult.x = estimated[0];
+        m_lastRectResult.y = estimated[1];
+        m_lastRectResult.width = estimated[2];
+        m_lastRectResult.height = estimated[3];
+
+        // Inertia correction
+        InertiaCorrection(sqrtf(sqr(estimated[0] - rect.x) + sqr(estimated[1] - rect.y) + sqr(estimated[2] - rect.width) + sqr(estimated[3] - rect.height)));
+        m_batch->SetDeltaTime(m_batchSlot, m_deltaTime * m_timeScale);
+    }
+    else if (m_initialized)
+    {
+        track_t measurement[4];
         if (!dataCorrect)
         {
-            measurement.at<track_t>(0) = m_lastRectResult.x;  // update using prediction
-            measurement.at<track_t>(1) = m_lastRectResult.y;
-            measurement.at<track_t>(2) = m_lastRectResult.width;
-            measurement.at<track_t>(3) = m_lastRectResult.height;
+            measurement[0] = m_lastRectResult.x;  // update using prediction
+            measurement[1] = m_lastRectResult.y;
+            measurement[2] = m_lastRectResult.width;
+            measurement[3] = m_lastRectResult.height;
         }
         else
         {
-            measurement.at<track_t>(0) = static_cast<track_t>(rect.x);  // update using measurements
-            measurement.at<track_t>(1) = static_cast<track_t>(rect.y);
-            measurement.at<track_t>(2) = static_cast<track_t>(rect.width);
-            measurement.at<track_t>(3) = static_cast<track_t>(rect.height);
+            measurement[0] = static_cast<track_t>(rect.x);  // update using measurements
+            measurement[1] = static_cast<track_t>(rect.y);
+            measurement[2] = static_cast<track_t>(rect.width);
+            measurement[3] = static_cast<track_t>(rect.height);
         }
         // Correction
-        cv::Mat estimated;
+        const track_t* estimated = nullptr;
         switch (m_type)
         {
         case tracking::KalmanLinear:
         {
-            estimated = m_linearKalman.correct(measurement);
+            if (!dataCorrect)
+                m_linearKalman->ResetSteadyState();
+            estimated = m_linearKalman->Correct(measurement);
 
-            m_lastRectResult.x = estimated.at<track_t>(0);   //update using measurements
-            m_lastRectResult.y = estimated.at<track_t>(1);
-            m_lastRectResult.width = estimated.at<track_t>(2);
-            m_lastRectResult.height = estimated.at<track_t>(3);
+            m_lastRectResult.x = estimated[0];   //update using measurements
+            m_lastRectResult.y = estimated[1];
+            m_lastRectResult.width = estimated[2];
+            m_lastRectResult.height = estimated[3];
 
             // Inertia correction
 			if (!m_useAcceleration)
 			{
-				track_t currDist = sqrtf(sqr(estimated.at<track_t>(0) - rect.x) + sqr(estimated.at<track_t>(1) - rect.y) + sqr(estimated.at<track_t>(2) - rect.width) + sqr(estimated.at<track_t>(3) - rect.height));
-				if (currDist > m_lastDist)
-					m_deltaTime = std::min(m_deltaTime + m_deltaStep, m_deltaTimeMax);
-				else
-					m_deltaTime = std::max(m_deltaTime - m_deltaStep, m_deltaTimeMin);
+				InertiaCorrection(sqrtf(sqr(estimated[0] - rect.x) + sqr(estimated[1] - rect.y) + sqr(estimated[2] - rect.width) + sqr(estimated[3] - rect.height)));
 
-				m_lastDist = currDist;
-
-				m_linearKalman.transitionMatrix.at<track_t>(0, 4) = m_deltaTime;
-				m_linearKalman.transitionMatrix.at<track_t>(1, 5) = m_deltaTime;
-				m_linearKalman.transitionMatrix.at<track_t>(2, 6) = m_deltaTime;
-				m_linearKalman.transitionMatrix.at<track_t>(3, 7) = m_deltaTime;
+				m_linearKalman->SetTransition(0, 4, m_deltaTime * m_appliedTimeScale);
+				m_linearKalman->SetTransition(1, 5, m_deltaTime * m_appliedTimeScale);
+				m_linearKalman->SetTransition(2, 6, m_deltaTime * m_appliedTimeScale);
+				m_linearKalman->SetTransition(3, 7, m_deltaTime * m_appliedTimeScale);
 			}
             break;
         }
@@ -843,20 +937,21 @@ cv::Rect TKalmanFilter::Update(cv::Rect rect, bool dataCorrect)
         case tracking::KalmanUnscented:
         case tracking::KalmanAugmentedUnscented:
 #ifdef USE_OCV_UKF
-            estimated = m_uncsentedKalman->correct(measurement);
+        {
+            cv::Mat ukfEstimated = m_uncsentedKalman->correct(cv::Mat(4, 1, Mat_t(1), measurement));
 
-            m_lastRectResult.x = estimated.at<track_t>(0);   //update using measurements
-            m_lastRectResult.y = estimated.at<track_t>(1);
-            m_lastRectResult.width = estimated.at<track_t>(6);
-            m_lastRectResult.height = estimated.at<track_t>(7);
+            m_lastRectResult.x = ukfEstimated.at<track_t>(0);   //update using measurements
+            m_lastRectResult.y = ukfEstimated.at<track_t>(1);
+            m_lastRectResult.width = ukfEstimated.at<track_t>(6);
+            m_lastRectResult.height = ukfEstimated.at<track_t>(7);
+        }
 #else
-            estimated = m_linearKalman.correct(measurement);
+            estimated = m_unscentedKalman->Correct(measurement);
 
-            m_lastRectResult.x = estimated.at<track_t>(0);   //update using measurements
-            m_lastRectResult.y = estimated.at<track_t>(1);
-            m_lastRectResult.width = estimated.at<track_t>(2);
-            m_lastRectResult.height = estimated.at<track_t>(3);
-            std::cerr << "UnscentedKalmanFilter was disabled in CMAKE! Set KalmanLinear in constructor." << std::endl;
+            m_lastRectResult.x = estimated[0];   //update using measurements
+            m_lastRectResult.y = estimated[1];
+            m_lastRectResult.width = estimated[6];
+            m_lastRectResult.height = estimated[7];
 #endif
             break;
         }
@@ -878,23 +973,29 @@ cv::Rect TKalmanFilter::Update(cv::Rect rect, bool dataCorrect)
 cv::Vec<track_t, 2> TKalmanFilter::GetVelocity() const
 {
     cv::Vec<track_t, 2> res(0, 0);
-    if (m_initialized)
+    if (m_initialized && m_batch)
+    {
+        const track_t* vel = m_batch->Velocity(m_batchSlot);
+        res[0] = vel[0];
+        res[1] = vel[1];
+    }
+    else if (m_initialized)
     {
         switch (m_type)
         {
         case tracking::KalmanLinear:
         {
-            if (m_linearKalman.statePre.rows > 3)
+            if (m_linearKalman->StateDim() > 3)
             {
                 int indX = 2;
                 int indY = 3;
-                if (m_linearKalman.statePre.rows > 4)
+                if (m_linearKalman->StateDim() > 4)
                 {
                     indX = 4;
                     indY = 5;
                 }
-                res[0] = m_linearKalman.statePre.at<track_t>(indX);
-                res[1] = m_linearKalman.statePre.at<track_t>(indY);
+                res[0] = m_linearKalman->StatePre()[indX];
+                res[1] = m_linearKalman->StatePre()[indY];
             }
             break;
         }
@@ -906,10 +1007,244 @@ cv::Vec<track_t, 2> TKalmanFilter::GetVelocity() const
             res[0] = state.at<track_t>(2);
             res[1] = state.at<track_t>(3);
 #else
-            std::cerr << "UnscentedKalmanFilter was disabled in CMAKE! Set KalmanLinear in constructor." << std::endl;
+            res[0] = m_unscentedKalman->State()[2];
+            res[1] = m_unscentedKalman->State()[3];
 #endif
             break;
         }
     }
     return res;
 }
+
+//---------------------------------------------------------------------------
+void TKalmanFilter::SetTimeScale(track_t timeScale)
+{
+    m_timeScale = std::max(timeScale, 1e-3f);
+    if (m_initialized && m_batch)
+    {
+        m_batch->SetDeltaTime(m_batchSlot, m_deltaTime * m_timeScale);
+        m_batch->SetTimeScale(m_batchSlot, m_timeScale);
+    }
+}
+
+//---------------------------------------------------------------------------
+void TKalmanFilter::ApplyTimeScale()
+{
+    // The same matrices as on the creation with the scaled time steps: the process noise uses the initial step, the transition is changed by the inertia correction
+    const track_t dt = m_deltaTime * m_timeScale;
+    const track_t noiseDt = m_deltaTimeMin * m_timeScale;
+    track_t transition[12 * 12];
+    track_t processNoise[12 * 12];
+    switch (m_linearKalman->StateDim())
+    {
+    case 4:
+        ConstantVelocityPointModel(dt, noiseDt, m_accelNoiseMag, transition, processNoise);
+        break;
+    case 8:
+        ConstantVelocityRectModel(dt, noiseDt, m_accelNoiseMag, transition, processNoise);
+        break;
+    case 6:
+        ConstantAccelerationPointModel(dt, noiseDt, m_accelNoiseMag, transition, processNoise);
+        break;
+    case 12:
+        ConstantAccelerationRectModel(dt, noiseDt, m_accelNoiseMag, transition, processNoise);
+        break;
+    default:
+        return;
+    }
+    m_linearKalman->SetModel(transition, processNoise);
+    m_appliedTimeScale = m_timeScale;
+}
+
+//---------------------------------------------------------------------------
+void TKalmanFilter::InertiaCorrection(track_t currDist)
+{
+    if (currDist > m_lastDist)
+        m_deltaTime = std::min(m_deltaTime + m_deltaStep, m_deltaTimeMax);
+    else
+        m_deltaTime = std::max(m_deltaTime - m_deltaStep, m_deltaTimeMin);
+
+    m_lastDist = currDist;
+}
+
+//---------------------------------------------------------------------------
+void TKalmanFilter::CreateModel(const Point_t& xy0, const cv::Rect_<track_t>& rect0, const Point_t& v0)
+{
+    switch (m_type)
+    {
+    case tracking::KalmanUnscented:
+        if (m_rectModel)
+            CreateUnscented(rect0, v0);
+        else
+            CreateUnscented(xy0, v0);
+        break;
+
+    case tracking::KalmanAugmentedUnscented:
+        if (m_rectModel)
+            CreateAugmentedUnscented(rect0, v0);
+        else
+            CreateAugmentedUnscented(xy0, v0);
+        break;
+
+    case tracking::KalmanLinear:
+        if (m_useAcceleration)
+        {
+            if (m_rectModel)
+                CreateLinearAcceleration(rect0, v0);
+            else
+                CreateLinearAcceleration(xy0, v0);
+        }
+        else
+        {
+            if (m_rectModel)
+                CreateLinear(rect0, v0);
+            else
+                CreateLinear(xy0, v0);
+        }
+        break;
+    }
+}
+
+//---------------------------------------------------------------------------
+void TKalmanFilter::Save(std::vector<track_t>& data) const
+{
+    data.clear();
+    data.push_back(m_initialized ? 1.f : 0.f);
+    data.push_back(m_rectModel ? 1.f : 0.f);
+    data.push_back(m_deltaTime);
+    data.push_back(m_lastDist);
+    data.push_back(m_lastPointResult.x);
+    data.push_back(m_lastPointResult.y);
+    data.push_back(m_lastRectResult.x);
+    data.push_back(m_lastRectResult.y);
+    data.push_back(m_lastRectResult.width);
+    data.push_back(m_lastRectResult.height);
+    const cv::Vec<track_t, 2> velocity = GetVelocity();
+    data.push_back(velocity[0]);
+    data.push_back(velocity[1]);
+
+    data.push_back(static_cast<track_t>(m_initialPoints.size()));
+    for (const auto& pt : m_initialPoints)
+    {
+        data.push_back(pt.x);
+        data.push_back(pt.y);
+    }
+    data.push_back(static_cast<track_t>(m_initialRects.size()));
+    for (const auto& rect : m_initialRects)
+    {
+        data.push_back(static_cast<track_t>(rect.x));
+        data.push_back(static_cast<track_t>(rect.y));
+        data.push_back(static_cast<track_t>(rect.width));
+        data.push_back(static_cast<track_t>(rect.height));
+    }
+
+    // 0 - without the state, else the values count of the state
+    if (m_initialized && m_batch)
+    {
+        const size_t count = 5 * m_batch->Channels();
+        data.push_back(static_cast<track_t>(count));
+        data.resize(data.size() + count);
+        m_batch->GetState(m_batchSlot, &data[data.size() - count]);
+    }
+    else if (m_initialized && m_linearKalman)
+    {
+        const size_t dim = static_cast<size_t>(m_linearKalman->StateDim());
+        const size_t count = dim + dim * dim;
+        data.push_back(static_cast<track_t>(count));
+        data.resize(data.size() + count);
+        m_linearKalman->GetState(&data[data.size() - count], &data[data.size() - count + dim]);
+    }
+#ifndef USE_OCV_UKF
+    else if (m_initialized && m_unscentedKalman)
+    {
+        const size_t dim = static_cast<size_t>(m_unscentedKalman->StateDim());
+        const size_t count = dim + dim * dim;
+        data.push_back(static_cast<track_t>(count));
+        data.resize(data.size() + count);
+        m_unscentedKalman->GetState(&data[data.size() - count], &data[data.size() - count + dim]);
+    }
+#endif
+    else
+    {
+        data.push_back(0.f);
+    }
+}
+
+//---------------------------------------------------------------------------
+bool TKalmanFilter::Restore(const std::vector<track_t>& data)
+{
+    size_t pos = 0;
+    auto Next = [&](track_t& val)
+    {
+        if (pos >= data.size())
+            return false;
+        val = data[pos++];
+        return true;
+    };
+    track_t vals[12];
+    for (auto& val : vals)
+    {
+        if (!Next(val))
+            return false;
+    }
+
+    m_initialized = false;
+    m_rectModel = vals[1] != 0;
+    m_deltaTime = std::clamp(vals[2], m_deltaTimeMin, m_deltaTimeMax);
+    m_lastDist = vals[3];
+    m_lastPointResult = Point_t(vals[4], vals[5]);
+    m_lastRectResult = cv::Rect_<track_t>(vals[6], vals[7], vals[8], vals[9]);
+    const Point_t velocity(vals[10], vals[11]);
+
+    track_t count = 0;
+    if (!Next(count) || count < 0 || count > static_cast<track_t>(MIN_INIT_VALS))
+        return false;
+    m_initialPoints.clear();
+    for (size_t i = 0; i < static_cast<size_t>(count); ++i)
+    {
+        Point_t pt;
+        if (!Next(pt.x) || !Next(pt.y))
+            return false;
+        m_initialPoints.push_back(pt);
+    }
+    if (!Next(count) || count < 0 || count > static_cast<track_t>(MIN_INIT_VALS))
+        return false;
+    m_initialRects.clear();
+    for (size_t i = 0; i < static_cast<size_t>(count); ++i)
+    {
+        track_t r[4];
+        if (!Next(r[0]) || !Next(r[1]) || !Next(r[2]) || !Next(r[3]))
+            return false;
+        m_initialRects.emplace_back(cvRound(r[0]), cvRound(r[1]), cvRound(r[2]), cvRound(r[3]));
+    }
+    track_t stateCount = 0;
+    if (!Next(stateCount) || pos + static_cast<size_t>(stateCount) > data.size())
+        return false;
+    const track_t* state = data.data() + pos;
+
+    if (vals[0] == 0)
+        return true;
+
+    // The filter is created by the last result and its state is replaced by the saved one
+    CreateModel(m_lastPointResult, m_lastRectResult, velocity);
+    if (m_batch)
+    {
+        if (static_cast<size_t>(stateCount) == 5 * m_batch->Channels())
+            m_batch->SetState(m_batchSlot, state, m_deltaTime * m_timeScale);
+    }
+    else if (m_linearKalman)
+    {
+        const size_t dim = static_cast<size_t>(m_linearKalman->StateDim());
+        if (static_cast<size_t>(stateCount) == dim + dim * dim)
+            m_linearKalman->SetState(state, state + dim);
+    }
+#ifndef USE_OCV_UKF
+    else if (m_unscentedKalman)
+    {
+        const size_t dim = static_cast<size_t>(m_unscentedKalman->StateDim());
+        if (static_cast<size_t>(stateCount) == dim + dim * dim)
+            m_unscentedKalman->SetState(state, state + dim);
+    }
+#endif
+    return true;
+}
@@ -1,5 +1,8 @@
 #pragma once
 #include "defines.h"
+#include "KalmanBatch.h"
+#include "KalmanModel.h"
+#include "UnscentedModel.h"
 #include <memory>
 #include <deque>
 
@@ -17,8 +20,19 @@
 class TKalmanFilter
 {
 public:
-    TKalmanFilter(tracking::KalmanType type, bool useAcceleration, track_t deltaTime, track_t accelNoiseMag);
-    ~TKalmanFilter() = default;
+    ///
+    /// \brief TKalmanFilter
+    /// \param type
+    /// \param useAcceleration
+    /// \param deltaTime
+    /// \param accelNoiseMag
+    /// \param steadyStateGain - linear filters switch to the cached gain after convergence
+    /// \param batch - shared storage of the constant velocity filters, used for KalmanLinear without acceleration
+    ///
+    TKalmanFilter(tracking::KalmanType type, bool useAcceleration, track_t deltaTime, track_t accelNoiseMag, bool steadyStateGain = false, std::shared_ptr<KalmanBatch> batch = nullptr);
+    TKalmanFilter(const TKalmanFilter&) = delete;
+    TKalmanFilter& operator=(const TKalmanFilter&) = delete;
+    ~TKalmanFilter();
 
     Point_t GetPointPrediction();
     Point_t Update(Point_t pt, bool dataCorrect);
@@ -28,16 +42,43 @@ public:
 
 	cv::Vec<track_t, 2> GetVelocity() const;
 
+    ///
+    /// \brief SetTimeScale
+    /// Interval of the next prediction in the nominal time steps: the transition and the process noise of the linear models are recalculated.
+    /// The unscented filters of opencv_contrib use the nominal step
+    /// \param timeScale - 1 for the regular frames, 3 after 2 skipped frames etc
+    ///
+    void SetTimeScale(track_t timeScale);
+
+    ///
+    /// \brief Save
+    /// State of the filter for the checkpoint of the tracker: the initial measurements, the last results, the adaptive time step
+    /// and the state with the covariance of the linear and the built-in unscented filters. The unscented filters of opencv_contrib keep only the position and the velocity
+    /// \param data
+    ///
+    void Save(std::vector<track_t>& data) const;
+    ///
+    /// \brief Restore
+    /// \param data - Save of the filter with the same type
+    /// \return false if the data is corrupted
+    ///
+    bool Restore(const std::vector<track_t>& data);
+
 private:
-    cv::KalmanFilter m_linearKalman;
+    std::unique_ptr<LinearKalman> m_linearKalman; // KalmanModel with the fixed dimensions of the state
 #ifdef USE_OCV_UKF
 #if (((CV_VERSION_MAJOR == 4) && (CV_VERSION_MINOR < 5)) || ((CV_VERSION_MAJOR == 4) && (CV_VERSION_MINOR == 5) && (CV_VERSION_REVISION < 1)) || (CV_VERSION_MAJOR == 3))
     cv::Ptr<cv::tracking::UnscentedKalmanFilter> m_uncsentedKalman;
 #else
     cv::Ptr<cv::detail::tracking::UnscentedKalmanFilter> m_uncsentedKalman;
 #endif
+#else
+    std::unique_ptr<UnscentedKalman> m_unscentedKalman; // UnscentedModel with the fixed dimensions of the state
 #endif
 
+    std::shared_ptr<KalmanBatch> m_batch;
+    size_t m_batchSlot = 0;
+
     static constexpr size_t MIN_INIT_VALS = 4;
     std::vector<Point_t> m_initialPoints;
     std::vector<cv::Rect> m_initialRects;
@@ -51,10 +92,20 @@ private:
     track_t m_deltaTimeMax = 2 * 0.2f;
     track_t m_lastDist = 0;
     track_t m_deltaStep = 0;
+    track_t m_timeScale = 1;
+    track_t m_appliedTimeScale = 1; // Time scale of the m_linearKalman matrices
     static constexpr int m_deltaStepsCount = 20;
     tracking::KalmanType m_type = tracking::KalmanLinear;
     bool m_useAcceleration = false; // If set true then will be used motion model x(t) = x0 + v0 * t + a * t^2 / 2
+    bool m_steadyStateGain = false;
     bool m_initialized = false;
+    bool m_rectModel = false;       // Update(cv::Rect) was called
+
+    void CreateModel(const Point_t& xy0, const cv::Rect_<track_t>& rect0, const Point_t& v0);
+
+    // Changes m_deltaTime by the distance between the estimated state and the measurement
+    void InertiaCorrection(track_t currDist);
+    void ApplyTimeScale();
 
 	// Constant velocity model
     void CreateLinear(Point_t xy0, Point_t xyv0);
@@ -65,12 +116,11 @@ private:
 	void CreateLinearAcceleration(Point_t xy0, Point_t xyv0);
 	void CreateLinearAcceleration(cv::Rect_<track_t> rect0, Point_t rectv0);
 
-#ifdef USE_OCV_UKF
+    // Constant acceleration model of the unscented filters: opencv_contrib with USE_OCV_UKF or the built-in UnscentedModel
     void CreateUnscented(Point_t xy0, Point_t xyv0);
     void CreateUnscented(cv::Rect_<track_t> rect0, Point_t rectv0);
     void CreateAugmentedUnscented(Point_t xy0, Point_t xyv0);
     void CreateAugmentedUnscented(cv::Rect_<track_t> rect0, Point_t rectv0);
-#endif
 };
 
 //---------------------------------------------------------------------------
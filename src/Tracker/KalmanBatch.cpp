@@ -0,0 +1,247 @@
+#include "KalmanBatch.h"
+
+///
+/// \brief KalmanBatch::KalmanBatch
+/// \param channels
+/// \param deltaTime
+/// \param accelNoiseMag
+///
+KalmanBatch::KalmanBatch(size_t channels, track_t deltaTime, track_t accelNoiseMag)
+    : m_channels(channels)
+{
+    // The same process noise as in TKalmanFilter::CreateLinear
+    const track_t dt2 = deltaTime * deltaTime;
+    m_q00 = accelNoiseMag * dt2 * dt2 / 4.f;
+    m_q01 = accelNoiseMag * dt2 * deltaTime / 2.f;
+    m_q11 = accelNoiseMag * dt2;
+}
+
+///
+/// \brief KalmanBatch::Acquire
+/// \return
+///
+size_t KalmanBatch::Acquire()
+{
+    size_t slot = m_active.size();
+    if (m_freeSlots.empty())
+    {
+        m_active.push_back(0);
+        m_predicted.push_back(0);
+
+        const size_t newSize = m_active.size() * m_channels;
+        m_pos.resize(newSize, 0);
+        m_vel.resize(newSize, 0);
+        m_velPre.resize(newSize, 0);
+        m_p00.resize(newSize, 0);
+        m_p01.resize(newSize, 0);
+        m_p11.resize(newSize, 0);
+        m_dt.resize(newSize, 0);
+        m_timeScale.resize(newSize, 1);
+    }
+    else
+    {
+        slot = m_freeSlots.back();
+        m_freeSlots.pop_back();
+    }
+    return slot;
+}
+
+///
+/// \brief KalmanBatch::Release
+/// \param slot
+///
+void KalmanBatch::Release(size_t slot)
+{
+    m_active[slot] = 0;
+    m_predicted[slot] = 0;
+    m_freeSlots.push_back(slot);
+}
+
+///
+/// \brief KalmanBatch::Init
+/// \param slot
+/// \param pos
+/// \param vel
+/// \param deltaTime
+///
+void KalmanBatch::Init(size_t slot, const track_t* pos, const track_t* vel, track_t deltaTime)
+{
+    const size_t first = slot * m_channels;
+    for (size_t i = 0; i < m_channels; ++i)
+    {
+        const size_t c = first + i;
+        m_pos[c] = pos[i];
+        m_vel[c] = vel[i];
+        m_velPre[c] = vel[i];
+        m_p00[c] = m_initCov;
+        m_p01[c] = 0;
+        m_p11[c] = m_initCov;
+        m_dt[c] = deltaTime;
+        m_timeScale[c] = 1;
+    }
+    m_active[slot] = 1;
+    m_predicted[slot] = 0;
+}
+
+///
+/// \brief KalmanBatch::GetState
+/// \param slot
+/// \param state
+///
+void KalmanBatch::GetState(size_t slot, track_t* state) const
+{
+    const size_t first = slot * m_channels;
+    for (size_t i = 0; i < m_channels; ++i)
+    {
+        const size_t c = first + i;
+        state[i] = m_pos[c];
+        state[m_channels + i] = m_vel[c];
+        state[2 * m_channels + i] = m_p00[c];
+        state[3 * m_channels + i] = m_p01[c];
+        state[4 * m_channels + i] = m_p11[c];
+    }
+}
+
+///
+/// \brief KalmanBatch::SetState
+/// \param slot
+/// \param state
+/// \param deltaTime
+///
+void KalmanBatch::SetState(size_t slot, const track_t* state, track_t deltaTime)
+{
+    Init(slot, state, state + m_channels, deltaTime);
+
+    const size_t first = slot * m_channels;
+    for (size_t i = 0; i < m_channels; ++i)
+    {
+        const size_t c = first + i;
+        m_p00[c] = state[2 * m_channels + i];
+        m_p01[c] = state[3 * m_channels + i];
+        m_p11[c] = state[4 * m_channels + i];
+    }
+}
+
+///
+/// \brief KalmanBatch::Predict
+///
+void KalmanBatch::Predict()
+{
+    // Free slots are predicted too: branchless loop is vectorized by the compiler (SSE/AVX/NEON)
+    // and their values are overwritten by Init
+    const int count = static_cast<int>(m_pos.size());
+    track_t* pos = m_pos.data();
+    track_t* vel = m_vel.data();
+    track_t* velPre = m_velPre.data();
+    track_t* p00 = m_p00.data();
+    track_t* p01 = m_p01.data();
+    track_t* p11 = m_p11.data();
+    const track_t* dts = m_dt.data();
+    const track_t* timeScales = m_timeScale.data();
+    const track_t q00 = m_q00;
+    const track_t q01 = m_q01;
+    const track_t q11 = m_q11;
+    for (int c = 0; c < count; ++c)
+    {
+        // x = F * x, P = F * P * F^T + Q with F = [1 dt; 0 1], Q of the dt * timeScale
+        const track_t dt = dts[c];
+        const track_t k2 = timeScales[c] * timeScales[c];
+        pos[c] += dt * vel[c];
+        velPre[c] = vel[c];
+        p00[c] += dt * (2 * p01[c] + dt * p11[c]) + q00 * k2 * k2;
+        p01[c] += dt * p11[c] + q01 * k2 * timeScales[c];
+        p11[c] += q11 * k2;
+    }
+
+    for (size_t slot = 0; slot < m_active.size(); ++slot)
+    {
+        m_predicted[slot] = m_active[slot];
+    }
+}
+
+///
+/// \brief KalmanBatch::Predict
+/// \param slot
+///
+void KalmanBatch::Predict(size_t slot)
+{
+    const size_t first = slot * m_channels;
+    for (size_t c = first; c < first + m_channels; ++c)
+    {
+        const track_t dt = m_dt[c];
+        const track_t k2 = m_timeScale[c] * m_timeScale[c];
+        m_pos[c] += dt * m_vel[c];
+        m_velPre[c] = m_vel[c];
+        m_p00[c] += dt * (2 * m_p01[c] + dt * m_p11[c]) + m_q00 * k2 * k2;
+        m_p01[c] += dt * m_p11[c] + m_q01 * k2 * m_timeScale[c];
+        m_p11[c] += m_q11 * k2;
+    }
+}
+
+///
+/// \brief KalmanBatch::ResetPredicted
+/// \param slot
+/// \return
+///
+bool KalmanBatch::ResetPredicted(size_t slot)
+{
+    const bool res = m_predicted[slot] != 0;
+    m_predicted[slot] = 0;
+    return res;
+}
+
+///
+/// \brief KalmanBatch::Correct
+/// \param slot
+/// \param meas
+///
+void KalmanBatch::Correct(size_t slot, const track_t* meas)
+{
+    const size_t first = slot * m_channels;
+    for (size_t i = 0; i < m_channels; ++i)
+    {
+        const size_t c = first + i;
+
+        // K = P * H^T / (H * P * H^T + R), H = [1 0]
+        const track_t s = m_p00[c] + m_measNoise;
+        const track_t k0 = m_p00[c] / s;
+        const track_t k1 = m_p01[c] / s;
+        const track_t residual = meas[i] - m_pos[c];
+
+        m_pos[c] += k0 * residual;
+        m_vel[c] += k1 * residual;
+
+        // P = (I - K * H) * P
+        m_p11[c] -= k1 * m_p01[c];
+        m_p01[c] *= 1 - k0;
+        m_p00[c] *= 1 - k0;
+    }
+}
+
+///
+/// \brief KalmanBatch::SetDeltaTime
+/// \param slot
+/// \param deltaTime
+///
+void KalmanBatch::SetDeltaTime(size_t slot, track_t deltaTime)
+{
+    const size_t first = slot * m_channels;
+    for (size_t c = first; c < first + m_channels; ++c)
+    {
+        m_dt[c] = deltaTime;
+    }
+}
+
+///
+/// \brief KalmanBatch::SetTimeScale
+/// \param slot
+/// \param timeScale
+///
+void KalmanBatch::SetTimeScale(size_t slot, track_t timeScale)
+{
+    const size_t first = slot * m_channels;
+    for (size_t c = first; c < first + m_channels; ++c)
+    {
+        m_timeScale[c] = timeScale;
+    }
+}
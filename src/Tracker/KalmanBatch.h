@@ -0,0 +1,152 @@
+#pragma once
+#include <vector>
+#include "defines.h"
+
+///
+/// \brief The KalmanBatch class
+/// Constant velocity linear Kalman filters of all tracks in the packed arrays.
+/// With the identity measurement matrix and the diagonal noise matrices the model
+/// [x_0..x_n, v_0..v_n] is decoupled into n independent channels (x_i, v_i) with 2x2 covariance.
+/// So the state and the covariance of each channel are 5 numbers in the structure of arrays
+/// and the prediction of all tracks is one vectorizable loop without matrix allocations
+///
+class KalmanBatch
+{
+public:
+    ///
+    /// \brief KalmanBatch
+    /// \param channels - measured values of one track: 2 for the point (x, y), 4 for the rect (x, y, width, height)
+    /// \param deltaTime - time step for the process noise
+    /// \param accelNoiseMag
+    ///
+    KalmanBatch(size_t channels, track_t deltaTime, track_t accelNoiseMag);
+    KalmanBatch(const KalmanBatch&) = delete;
+    KalmanBatch& operator=(const KalmanBatch&) = delete;
+
+    ///
+    size_t Channels() const
+    {
+        return m_channels;
+    }
+
+    ///
+    /// \brief Acquire
+    /// Not thread safe: call it from the tracks creation
+    /// \return Slot of a new filter, it isn't active before Init
+    ///
+    size_t Acquire();
+    ///
+    /// \brief Release
+    /// Not thread safe: call it from the tracks removal
+    /// \param slot
+    ///
+    void Release(size_t slot);
+
+    ///
+    /// \brief Init
+    /// \param slot
+    /// \param pos - Channels() values
+    /// \param vel - Channels() values
+    /// \param deltaTime - time step of the transition matrix
+    ///
+    void Init(size_t slot, const track_t* pos, const track_t* vel, track_t deltaTime);
+
+    ///
+    /// \brief Predict
+    /// Prediction of all active filters in one pass
+    ///
+    void Predict();
+    ///
+    /// \brief Predict
+    /// \param slot
+    ///
+    void Predict(size_t slot);
+    ///
+    /// \brief ResetPredicted
+    /// \param slot
+    /// \return true if the filter was predicted by the batch pass after the last call
+    ///
+    bool ResetPredicted(size_t slot);
+
+    ///
+    /// \brief Correct
+    /// Filters of the different slots can be corrected from the different threads
+    /// \param slot
+    /// \param meas - Channels() values
+    ///
+    void Correct(size_t slot, const track_t* meas);
+
+    ///
+    /// \brief SetDeltaTime
+    /// \param slot
+    /// \param deltaTime - time step of the transition matrix
+    ///
+    void SetDeltaTime(size_t slot, track_t deltaTime);
+    ///
+    /// \brief SetTimeScale
+    /// \param slot
+    /// \param timeScale - interval from the previous prediction in the nominal time steps, the process noise is scaled by the powers of it
+    ///
+    void SetTimeScale(size_t slot, track_t timeScale);
+
+    ///
+    /// \brief Position
+    /// \param slot
+    /// \return Channels() values of the current state
+    ///
+    const track_t* Position(size_t slot) const
+    {
+        return &m_pos[slot * m_channels];
+    }
+    ///
+    /// \brief Velocity
+    /// \param slot
+    /// \return Channels() values of the velocity after the last prediction
+    ///
+    const track_t* Velocity(size_t slot) const
+    {
+        return &m_velPre[slot * m_channels];
+    }
+
+    ///
+    /// \brief GetState
+    /// \param slot
+    /// \param state - 5 * Channels() values: positions, velocities and the covariances p00, p01, p11 of the channels
+    ///
+    void GetState(size_t slot, track_t* state) const;
+    ///
+    /// \brief SetState
+    /// The filter of the slot is activated with the state of GetState
+    /// \param slot
+    /// \param state
+    /// \param deltaTime - time step of the transition matrix
+    ///
+    void SetState(size_t slot, const track_t* state, track_t deltaTime);
+
+private:
+    size_t m_channels = 2;
+
+    // Process and measurement noise are the same for all channels
+    track_t m_q00 = 0;
+    track_t m_q01 = 0;
+    track_t m_q11 = 0;
+    track_t m_measNoise = 0.1f;
+    // TKalmanFilter corrects the initial state with the measurement before the first prediction: a priori
+    // covariance of cv::KalmanFilter is zero at this moment, so the filters start from the zero covariance
+    track_t m_initCov = 0;
+
+    // channels * slots
+    std::vector<track_t> m_pos;
+    std::vector<track_t> m_vel;
+    std::vector<track_t> m_velPre;
+    std::vector<track_t> m_p00;
+    std::vector<track_t> m_p01;
+    std::vector<track_t> m_p11;
+    std::vector<track_t> m_dt;
+    std::vector<track_t> m_timeScale;
+
+    // slots
+    std::vector<char> m_active;
+    std::vector<char> m_predicted;
+    std::vector<size_t> m_freeSlots;
+};
@@ -0,0 +1,249 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include "defines.h"
+
+///
+/// \brief The LinearKalman class
+/// Interface of the linear Kalman filter with the identity measurement matrix H = [I 0]
+///
+class LinearKalman
+{
+public:
+    virtual ~LinearKalman() = default;
+
+    ///
+    /// \brief Predict
+    /// \return A priori state: StateDim() values
+    ///
+    virtual const track_t* Predict() = 0;
+    ///
+    /// \brief Correct
+    /// \param meas - MeasDim values
+    /// \return A posteriori state: StateDim() values
+    ///
+    virtual const track_t* Correct(const track_t* meas) = 0;
+
+    ///
+    /// \brief SetTransition
+    /// Changes an element of the transition matrix, for example the time step
+    /// \param row
+    /// \param col
+    /// \param val
+    ///
+    virtual void SetTransition(int row, int col, track_t val) = 0;
+
+    ///
+    /// \brief SetModel
+    /// Replaces the transition and the process noise matrices, for example for the new time step
+    /// \param transition - StateDim() x StateDim() values, row-major
+    /// \param processNoise - StateDim() x StateDim() values, row-major
+    ///
+    virtual void SetModel(const track_t* transition, const track_t* processNoise) = 0;
+
+    ///
+    /// \brief ResetSteadyState
+    /// Returns to the full covariance update, for example after the missed measurement
+    ///
+    virtual void ResetSteadyState() = 0;
+
+    ///
+    /// \brief StatePre
+    /// \return A priori state after the last prediction
+    ///
+    virtual const track_t* StatePre() const = 0;
+    ///
+    /// \brief GetState
+    /// \param state - StateDim() values of the a posteriori state
+    /// \param errorCov - StateDim() x StateDim() values of the a posteriori error covariance
+    ///
+    virtual void GetState(track_t* state, track_t* errorCov) const = 0;
+    ///
+    /// \brief SetState
+    /// Restores the filter from GetState, the steady state gain is calculated again
+    /// \param state
+    /// \param errorCov
+    ///
+    virtual void SetState(const track_t* state, const track_t* errorCov) = 0;
+    ///
+    /// \brief StateDim
+    /// \return
+    ///
+    virtual int StateDim() const = 0;
+};
+
+///
+/// \brief The KalmanModel class
+/// Linear Kalman filter with the compile-time dimensions: matrices are on the stack and all products
+/// have the fixed sizes, so the compiler unrolls and vectorizes them.
+/// It repeats the cv::KalmanFilter equations without control input and with H = [I 0].
+/// In the steady state mode the gain is cached after the covariance has converged and
+/// only the state is updated until ResetSteadyState or the change of the transition matrix
+///
+template<int STATE_DIM, int MEAS_DIM>
+class KalmanModel final : public LinearKalman
+{
+public:
+    static_assert(MEAS_DIM <= STATE_DIM, "Measurement can't be bigger than state");
+
+    typedef cv::Matx<track_t, STATE_DIM, 1> state_t;
+    typedef cv::Matx<track_t, MEAS_DIM, 1> meas_t;
+    typedef cv::Matx<track_t, STATE_DIM, STATE_DIM> state_mat_t;
+    typedef cv::Matx<track_t, MEAS_DIM, MEAS_DIM> meas_mat_t;
+
+    ///
+    /// \brief KalmanModel
+    /// \param transition - STATE_DIM x STATE_DIM values, row-major
+    /// \param processNoise - STATE_DIM x STATE_DIM values, row-major
+    /// \param state0 - STATE_DIM values
+    /// \param measNoise - measurement noise covariance is measNoise * I
+    /// \param errorCov - a posteriori error covariance is errorCov * I
+    /// \param steadyState - use the cached gain after the convergence
+    ///
+    KalmanModel(const track_t* transition, const track_t* processNoise, const track_t* state0, track_t measNoise, track_t errorCov, bool steadyState = false)
+        : m_transition(transition),
+          m_processNoise(processNoise),
+          m_measNoise(meas_mat_t::eye() * measNoise),
+          m_statePre(state0),
+          m_statePost(state0),
+          m_errorCovPre(state_mat_t::zeros()),
+          m_errorCovPost(state_mat_t::eye() * errorCov),
+          m_steadyStateEnabled(steadyState)
+    {
+    }
+
+    ///
+    const track_t* Predict() override
+    {
+        m_statePre = m_transition * m_statePost;
+        m_statePost = m_statePre;
+
+        // In the steady state both covariances are frozen at the last full update
+        if (!m_steadyState)
+        {
+            m_errorCovPre = m_transition * m_errorCovPost * m_transition.t() + m_processNoise;
+            m_errorCovPost = m_errorCovPre;
+        }
+        return m_statePre.val;
+    }
+
+    ///
+    const track_t* Correct(const track_t* meas) override
+    {
+        const meas_t residual = meas_t(meas) - m_statePre.template get_minor<MEAS_DIM, 1>(0, 0);
+        if (m_steadyState)
+        {
+            m_statePost = m_statePre + m_gain * residual;
+            return m_statePost.val;
+        }
+
+        // With H = [I 0]: H * P is the first MEAS_DIM rows of P
+        const cv::Matx<track_t, MEAS_DIM, STATE_DIM> hp = m_errorCovPre.template get_minor<MEAS_DIM, STATE_DIM>(0, 0);
+        const meas_mat_t s = hp.template get_minor<MEAS_DIM, MEAS_DIM>(0, 0) + m_measNoise;
+
+        // K = P * H^T * S^-1, S is symmetric positive definite
+        const gain_t gain = hp.t() * s.inv(cv::DECOMP_CHOLESKY);
+
+        m_statePost = m_statePre + gain * residual;
+        m_errorCovPost = m_errorCovPre - gain * hp;
+
+        if (m_steadyStateEnabled)
+            CheckConvergence(gain);
+        return m_statePost.val;
+    }
+
+    ///
+    void SetTransition(int row, int col, track_t val) override
+    {
+        if (m_transition(row, col) != val)
+        {
+            m_transition(row, col) = val;
+            ResetSteadyState(); // The steady state gain belongs to the old model
+        }
+    }
+
+    ///
+    void SetModel(const track_t* transition, const track_t* processNoise) override
+    {
+        m_transition = state_mat_t(transition);
+        m_processNoise = state_mat_t(processNoise);
+        ResetSteadyState();
+    }
+
+    ///
+    void ResetSteadyState() override
+    {
+        m_steadyState = false;
+        m_stableCount = 0;
+    }
+
+    ///
+    const track_t* StatePre() const override
+    {
+        return m_statePre.val;
+    }
+
+    ///
+    void GetState(track_t* state, track_t* errorCov) const override
+    {
+        std::copy(m_statePost.val, m_statePost.val + STATE_DIM, state);
+        std::copy(m_errorCovPost.val, m_errorCovPost.val + STATE_DIM * STATE_DIM, errorCov);
+    }
+
+    ///
+    void SetState(const track_t* state, const track_t* errorCov) override
+    {
+        m_statePost = state_t(state);
+        m_statePre = m_statePost;
+        m_errorCovPost = state_mat_t(errorCov);
+        m_errorCovPre = m_errorCovPost;
+        ResetSteadyState();
+    }
+
+    ///
+    int StateDim() const override
+    {
+        return STATE_DIM;
+    }
+
+private:
+    typedef cv::Matx<track_t, STATE_DIM, MEAS_DIM> gain_t;
+
+    state_mat_t m_transition;
+    state_mat_t m_processNoise;
+    meas_mat_t m_measNoise;
+
+    state_t m_statePre;
+    state_t m_statePost;
+    state_mat_t m_errorCovPre;
+    state_mat_t m_errorCovPost;
+
+    bool m_steadyStateEnabled = false;
+    bool m_steadyState = false;
+    gain_t m_gain;
+    int m_stableCount = 0;
+
+    static constexpr int StableUpdates = 5; // Updates with the same gain before the switch to the steady state
+    static constexpr track_t GainEps = 1e-4f;
+
+    ///
+    /// \brief CheckConvergence
+    /// \param gain - gain of the last full update
+    ///
+    void CheckConvergence(const gain_t& gain)
+    {
+        track_t maxDiff = 0;
+        track_t maxVal = 0;
+        for (int i = 0; i < STATE_DIM * MEAS_DIM; ++i)
+        {
+            maxDiff = std::max(maxDiff, std::abs(gain.val[i] - m_gain.val[i]));
+            maxVal = std::max(maxVal, std::abs(gain.val[i]));
+        }
+        m_gain = gain;
+
+        if (maxDiff > GainEps * maxVal)
+            m_stableCount = 0;
+        else if (++m_stableCount >= StableUpdates)
+            m_steadyState = true;
+    }
+};
@@ -0,0 +1,243 @@
+/**
+The shortest augmenting path solver is adapted from rectangular_lsap.cpp of
+scipy.optimize.linear_sum_assignment, which implements the pseudocode of
+DF Crouse. On implementing 2D rectangular assignment algorithms.
+IEEE Transactions on Aerospace and Electronic Systems 52(4):1679-1696, 2016.
+
+Copyright (c) 2019 Peter M. Larsen
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its
+   contributors may be used to endorse or promote products derived from
+   this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "LAPJV.h"
+#include <limits>
+#include <algorithm>
+
+// --------------------------------------------------------------------------
+//
+// --------------------------------------------------------------------------
+track_t LAPJVSolver::Solve(const distMatrix_t& distMatrixIn,
+                           size_t nOfRows,
+                           size_t nOfColumns,
+                           assignments_t& assignment,
+                           track_t forbiddenCost,
+                           const assignments_t* warmStart)
+{
+    assignment.assign(nOfRows, -1);
+    m_warmRows = 0;
+    if (!nOfRows || !nOfColumns)
+        return 0;
+
+    // Algorithm works with rows <= cols, so the wide matrix is transposed
+    const bool transposed = nOfRows > nOfColumns;
+    const size_t nr = transposed ? nOfColumns : nOfRows;
+    const size_t nc = transposed ? nOfRows : nOfColumns;
+
+    // Forbidden pairs have the same big cost: the solver maximizes the number of the allowed pairs at first
+    // and minimizes their total cost at second. It's more than any sum of the allowed costs
+    const double bigCost = 1. + 2. * static_cast<double>(std::max<size_t>(nr, 1)) * std::max(1., static_cast<double>(forbiddenCost));
+
+    m_cost.resize(nr * nc);
+    for (size_t row = 0; row < nOfRows; ++row)
+    {
+        for (size_t col = 0; col < nOfColumns; ++col)
+        {
+            const track_t dist = distMatrixIn(row, col);
+            const double cost = (dist < forbiddenCost) ? static_cast<double>(dist) : bigCost;
+            if (transposed)
+                m_cost[col * nc + row] = cost;
+            else
+                m_cost[row * nc + col] = cost;
+        }
+    }
+
+    m_u.assign(nr, 0.);
+    m_v.assign(nc, 0.);
+    m_shortestPathCosts.resize(nc);
+    m_path.assign(nc, -1);
+    m_col4row.assign(nr, -1);
+    m_row4col.assign(nc, -1);
+    m_remaining.resize(nc);
+    m_SR.resize(nr);
+    m_SC.resize(nc);
+
+    if (warmStart && warmStart->size() == nOfRows)
+        SeedWarmStart(*warmStart, transposed, nr, nc, bigCost);
+
+    // Iteratively build the solution: one augmenting path for each free row
+    for (int curRow = 0; curRow < static_cast<int>(nr); ++curRow)
+    {
+        if (m_col4row[curRow] >= 0)
+            continue;
+
+        double minVal = 0;
+        int sink = AugmentingPath(nc, curRow, minVal);
+        if (sink < 0)
+            break;
+
+        // Update dual variables
+        m_u[curRow] += minVal;
+        for (size_t i = 0; i < nr; ++i)
+        {
+            if (m_SR[i] && static_cast<int>(i) != curRow)
+                m_u[i] += minVal - m_shortestPathCosts[m_col4row[i]];
+        }
+        for (size_t j = 0; j < nc; ++j)
+        {
+            if (m_SC[j])
+                m_v[j] -= minVal - m_shortestPathCosts[j];
+        }
+
+        // Augment previous solution
+        int j = sink;
+        for (;;)
+        {
+            const int i = m_path[j];
+            m_row4col[j] = i;
+            std::swap(m_col4row[i], j);
+            if (i == curRow)
+                break;
+        }
+    }
+
+    track_t cost = 0;
+    for (size_t i = 0; i < nr; ++i)
+    {
+        const int j = m_col4row[i];
+        if (j < 0 || m_cost[i * nc + j] >= bigCost)
+            continue;
+
+        const size_t row = transposed ? static_cast<size_t>(j) : i;
+        const size_t col = transposed ? i : static_cast<size_t>(j);
+        assignment[row] = static_cast<int>(col);
+        cost += distMatrixIn(row, col);
+    }
+    return cost;
+}
+
+// --------------------------------------------------------------------------
+// Initial duals and matching from the previous solution: u is the minimum of the row and v = 0,
+// so all reduced costs are non negative and the free columns have the maximal v. The hinted pair
+// is taken if it's tight (the minimum of its row) and the column is free, the solution stays optimal
+// and only the other rows need the augmenting paths
+// --------------------------------------------------------------------------
+void LAPJVSolver::SeedWarmStart(const assignments_t& warmStart, bool transposed, size_t nr, size_t nc, double bigCost)
+{
+    for (size_t i = 0; i < nr; ++i)
+    {
+        const double* costRow = m_cost.data() + i * nc;
+        m_u[i] = *std::min_element(costRow, costRow + nc);
+    }
+
+    for (size_t row = 0; row < warmStart.size(); ++row)
+    {
+        const int col = warmStart[row];
+        if (col < 0)
+            continue;
+
+        const size_t i = transposed ? static_cast<size_t>(col) : row;
+        const size_t j = transposed ? row : static_cast<size_t>(col);
+        if (i >= nr || j >= nc || m_col4row[i] >= 0 || m_row4col[j] >= 0)
+            continue;
+
+        const double cost = m_cost[i * nc + j];
+        if (cost < bigCost && cost <= m_u[i])
+        {
+            m_col4row[i] = static_cast<int>(j);
+            m_row4col[j] = static_cast<int>(i);
+            ++m_warmRows;
+        }
+    }
+}
+
+// --------------------------------------------------------------------------
+// Dijkstra search from the row to the nearest free column with reduced costs
+// --------------------------------------------------------------------------
+int LAPJVSolver::AugmentingPath(size_t nc, int row, double& minVal)
+{
+    constexpr double inf = std::numeric_limits<double>::infinity();
+
+    minVal = 0;
+
+    // Crouse's pseudocode uses set complements to keep track of remaining nodes,
+    // here we use a vector instead
+    size_t numRemaining = nc;
+    for (size_t it = 0; it < nc; ++it)
+    {
+        m_remaining[it] = static_cast<int>(nc - it - 1);
+    }
+
+    std::fill(std::begin(m_SR), std::end(m_SR), 0);
+    std::fill(std::begin(m_SC), std::end(m_SC), 0);
+    std::fill(std::begin(m_shortestPathCosts), std::end(m_shortestPathCosts), inf);
+
+    int i = row;
+    int sink = -1;
+    while (sink == -1)
+    {
+        size_t index = nc;
+        double lowest = inf;
+        m_SR[i] = 1;
+
+        const double* costRow = m_cost.data() + static_cast<size_t>(i) * nc;
+        for (size_t it = 0; it < numRemaining; ++it)
+        {
+            const int j = m_remaining[it];
+
+            const double r = minVal + costRow[j] - m_u[i] - m_v[j];
+            if (r < m_shortestPathCosts[j])
+            {
+                m_path[j] = i;
+                m_shortestPathCosts[j] = r;
+            }
+
+            // When multiple nodes have the minimum cost, we select one which
+            // gives us a new sink node. This is particularly important for
+            // integer cost matrices with small co-efficients.
+            if (m_shortestPathCosts[j] < lowest || (m_shortestPathCosts[j] == lowest && m_row4col[j] == -1))
+            {
+                lowest = m_shortestPathCosts[j];
+                index = it;
+            }
+        }
+
+        minVal = lowest;
+        if (index == nc || minVal == inf)
+            return -1; // Infeasible cost matrix
+
+        const int j = m_remaining[index];
+        if (m_row4col[j] == -1)
+            sink = j;
+        else
+            i = m_row4col[j];
+
+        m_SC[j] = 1;
+        m_remaining[index] = m_remaining[--numRemaining];
+    }
+    return sink;
+}
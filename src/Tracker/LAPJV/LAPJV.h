@@ -0,0 +1,54 @@
+#pragma once
+#include <vector>
+#include "defines.h"
+
+///
+/// \brief The LAPJVSolver class
+/// Linear assignment problem: shortest augmenting path algorithm of Jonker and Volgenant
+/// for the rectangular matrices (D.F. Crouse, "On implementing 2D rectangular assignment algorithms", 2016)
+/// All buffers are reused between the calls
+///
+class LAPJVSolver
+{
+public:
+    LAPJVSolver() = default;
+    ~LAPJVSolver() = default;
+
+    ///
+    /// \brief Solve
+    /// \param distMatrixIn - nOfRows x nOfColumns
+    /// \param nOfRows
+    /// \param nOfColumns
+    /// \param assignment - column for each row or -1
+    /// \param forbiddenCost - pairs with cost >= forbiddenCost are never assigned
+    /// \param warmStart - initial column for each row or -1, nullptr for the cold start
+    /// \return Total cost of the assignment
+    ///
+    track_t Solve(const distMatrix_t& distMatrixIn, size_t nOfRows, size_t nOfColumns, assignments_t& assignment, track_t forbiddenCost,
+                  const assignments_t* warmStart = nullptr);
+
+    ///
+    /// \brief WarmRows
+    /// \return Rows of the last Solve that were taken from the warm start without the augmenting paths
+    ///
+    size_t WarmRows() const
+    {
+        return m_warmRows;
+    }
+
+private:
+    int AugmentingPath(size_t nc, int row, double& minVal);
+    void SeedWarmStart(const assignments_t& warmStart, bool transposed, size_t nr, size_t nc, double bigCost);
+
+    std::vector<double> m_cost;   // Row-major, rows <= cols
+    std::vector<double> m_u;
+    std::vector<double> m_v;
+    std::vector<double> m_shortestPathCosts;
+    std::vector<int> m_path;
+    std::vector<int> m_col4row;
+    std::vector<int> m_row4col;
+    std::vector<int> m_remaining;
+    std::vector<char> m_SR;
+    std::vector<char> m_SC;
+    size_t m_warmRows = 0;
+};
@@ -0,0 +1,350 @@
+#include "LostTracksCorrelation.h"
+
+#include <algorithm>
+#include <cmath>
+
+///
+/// \brief LostTracksCorrelation::LostTracksCorrelation
+/// \param settings
+///
+LostTracksCorrelation::LostTracksCorrelation(const Settings& settings)
+    : m_settings(settings)
+{
+    m_settings.m_maxTracks = std::max(1, m_settings.m_maxTracks);
+    m_settings.m_patchSize = cv::getOptimalDFTSize(std::max(16, m_settings.m_patchSize));
+    m_settings.m_padding = std::max(1.f, m_settings.m_padding);
+    m_settings.m_learningRate = std::min(std::max(0.f, m_settings.m_learningRate), 1.f);
+    m_settings.m_sigma = std::max(0.5f, m_settings.m_sigma);
+
+    const int tiles = m_settings.m_maxTracks;
+    const int side = m_settings.m_patchSize;
+
+    m_slotIds.resize(tiles);
+    m_slotUsed.assign(tiles, 0);
+    m_windows.resize(tiles);
+    m_rates.assign(tiles, 0.f);
+
+    cv::Mat hann;
+    cv::createHanningWindow(hann, cv::Size(side, side), CV_32F);
+    cv::repeat(hann, tiles, 1, m_hann);
+
+    // Desired response is Gaussian with the peak in the center of the tile
+    cv::Mat target(side, side, CV_32FC1);
+    const float center = side / 2.f;
+    const float k = -1.f / (2.f * m_settings.m_sigma * m_settings.m_sigma);
+    for (int y = 0; y < side; ++y)
+    {
+        float* pTarget = target.ptr<float>(y);
+        for (int x = 0; x < side; ++x)
+        {
+            pTarget[x] = std::exp(k * ((x - center) * (x - center) + (y - center) * (y - center)));
+        }
+    }
+    cv::UMat targets;
+    cv::repeat(target, tiles, 1, targets);
+    ForwardDFT(targets, m_targetf);
+
+    // Unused filters are zero
+    m_numerator = cv::UMat::zeros(tiles * side, side, CV_32FC2);
+    m_denominator = cv::UMat(tiles * side, side, CV_32FC2, cv::Scalar(1, 1));
+}
+
+///
+/// \brief LostTracksCorrelation::Gray
+/// \param frame
+/// \param gray
+///
+void LostTracksCorrelation::Gray(cv::UMat frame, cv::UMat& gray)
+{
+    if (frame.channels() == 1)
+    {
+        frame.convertTo(gray, CV_32F);
+    }
+    else
+    {
+        cv::cvtColor(frame, m_tmpReal, cv::COLOR_BGR2GRAY);
+        m_tmpReal.convertTo(gray, CV_32F);
+    }
+}
+
+///
+/// \brief LostTracksCorrelation::Sample
+/// Windows of all tiles are resampled to the patches by one remap, then they are normalized and weighted by Hann window
+/// \param gray
+///
+void LostTracksCorrelation::Sample(const cv::UMat& gray)
+{
+    const int tiles = m_settings.m_maxTracks;
+    const int side = m_settings.m_patchSize;
+
+    m_mapX.create(tiles * side, side, CV_32FC1);
+    m_mapY.create(tiles * side, side, CV_32FC1);
+    for (int t = 0; t < tiles; ++t)
+    {
+        const cv::Rect2f& window = m_windows[t];
+        const float stepX = window.width / side;
+        const float stepY = window.height / side;
+        for (int y = 0; y < side; ++y)
+        {
+            float* pMapX = m_mapX.ptr<float>(t * side + y);
+            float* pMapY = m_mapY.ptr<float>(t * side + y);
+            const float mapY = window.y + (y + 0.5f) * stepY;
+            for (int x = 0; x < side; ++x)
+            {
+                pMapX[x] = window.x + (x + 0.5f) * stepX;
+                pMapY[x] = mapY;
+            }
+        }
+    }
+    cv::remap(gray, m_patches, m_mapX, m_mapY, cv::INTER_LINEAR, cv::BORDER_REPLICATE);
+
+    // log(1 + I) with zero mean and unit variance in every tile
+    cv::add(m_patches, cv::Scalar(1), m_patches);
+    cv::log(m_patches, m_patches);
+    cv::reduce(m_patches, m_column, 1, cv::REDUCE_SUM, CV_32F);
+    m_column.copyTo(m_sums);
+    cv::multiply(m_patches, m_patches, m_tmpReal);
+    cv::reduce(m_tmpReal, m_column, 1, cv::REDUCE_SUM, CV_32F);
+    m_column.copyTo(m_sqSums);
+
+    m_normScale.create(tiles * side, 1, CV_32FC1);
+    m_normOffset.create(tiles * side, 1, CV_32FC1);
+    const float area = static_cast<float>(side * side);
+    for (int t = 0; t < tiles; ++t)
+    {
+        float sum = 0.f;
+        float sqSum = 0.f;
+        for (int y = t * side; y < (t + 1) * side; ++y)
+        {
+            sum += m_sums.at<float>(y);
+            sqSum += m_sqSums.at<float>(y);
+        }
+        const float mean = sum / area;
+        const float variance = sqSum / area - mean * mean;
+        const float scale = (m_windows[t].area() > 0 && variance > 1e-6f) ? 1.f / std::sqrt(variance) : 0.f;
+        for (int y = t * side; y < (t + 1) * side; ++y)
+        {
+            m_normScale.at<float>(y) = scale;
+            m_normOffset.at<float>(y) = -mean * scale;
+        }
+    }
+    m_normScale.copyTo(m_column);
+    cv::repeat(m_column, 1, side, m_tmpReal);
+    cv::multiply(m_patches, m_tmpReal, m_patches);
+    m_normOffset.copyTo(m_column);
+    cv::repeat(m_column, 1, side, m_tmpReal);
+    cv::add(m_patches, m_tmpReal, m_patches);
+    cv::multiply(m_patches, m_hann, m_patches);
+}
+
+///
+/// \brief LostTracksCorrelation::ForwardDFT
+/// 2D DFT of all tiles: DFT of the rows, the transposition makes the columns of the tiles rows, DFT of the rows again.
+/// Result has the rows (u * maxTracks + tile) and the columns v
+/// \param patches - tiles one under another, CV_32FC1
+/// \param spectra - CV_32FC2
+///
+void LostTracksCorrelation::ForwardDFT(const cv::UMat& patches, cv::UMat& spectra)
+{
+    const int rows = m_settings.m_maxTracks * m_settings.m_patchSize;
+
+    cv::dft(patches, m_tmp, cv::DFT_ROWS | cv::DFT_COMPLEX_OUTPUT);
+    cv::transpose(m_tmp, m_tmp2);
+    cv::dft(m_tmp2.reshape(2, rows), spectra, cv::DFT_ROWS);
+}
+
+///
+/// \brief LostTracksCorrelation::InverseDFT
+/// \param spectra - layout of ForwardDFT
+/// \param real - tiles one under another, CV_32FC1
+///
+void LostTracksCorrelation::InverseDFT(const cv::UMat& spectra, cv::UMat& real)
+{
+    cv::dft(spectra, m_tmp, cv::DFT_INVERSE | cv::DFT_ROWS | cv::DFT_SCALE);
+    cv::transpose(m_tmp.reshape(2, m_settings.m_patchSize), m_tmp2);
+    cv::dft(m_tmp2, m_tmp, cv::DFT_INVERSE | cv::DFT_ROWS | cv::DFT_SCALE);
+    cv::extractChannel(m_tmp, real, 0);
+}
+
+///
+/// \brief LostTracksCorrelation::Train
+/// MOSSE update of the all filters with the tile rates: A += rate * (G * F^ - A), B += rate * (F * F^ + eps - B)
+/// \param spectra - spectra of the patches
+///
+void LostTracksCorrelation::Train(const cv::UMat& spectra)
+{
+    const int side = m_settings.m_patchSize;
+
+    cv::Mat rates(m_settings.m_maxTracks, 1, CV_32FC2);
+    for (int t = 0; t < m_settings.m_maxTracks; ++t)
+    {
+        rates.at<cv::Vec2f>(t) = cv::Vec2f(m_rates[t], m_rates[t]);
+    }
+    // Row (u * maxTracks + tile) of the layout gets the rate of the tile
+    rates.copyTo(m_column);
+    cv::UMat tileRates;
+    cv::repeat(m_column, side, side, tileRates);
+
+    cv::UMat update;
+    cv::mulSpectrums(m_targetf, spectra, update, 0, true);
+    cv::subtract(update, m_numerator, update);
+    cv::multiply(update, tileRates, update);
+    cv::add(m_numerator, update, m_numerator);
+
+    // Denominator is real, it's duplicated in both channels for the complex division
+    cv::mulSpectrums(spectra, spectra, update, 0, true);
+    cv::extractChannel(update, m_tmpReal, 0);
+    cv::add(m_tmpReal, cv::Scalar(1e-3), m_tmpReal);
+    std::vector<cv::UMat> planes = { m_tmpReal, m_tmpReal };
+    cv::merge(planes, update);
+    cv::subtract(update, m_denominator, update);
+    cv::multiply(update, tileRates, update);
+    cv::add(m_denominator, update, m_denominator);
+}
+
+///
+/// \brief LostTracksCorrelation::PSR
+/// \param response - response of one tile
+/// \param peak
+/// \return Peak to sidelobe ratio, the sidelobe is the tile without 11x11 around the peak
+///
+float LostTracksCorrelation::PSR(const cv::Mat& response, cv::Point& peak) const
+{
+    double maxVal = 0;
+    cv::minMaxLoc(response, nullptr, &maxVal, nullptr, &peak);
+
+    constexpr int peakHalf = 5;
+    const cv::Rect peakArea = cv::Rect(peak.x - peakHalf, peak.y - peakHalf, 2 * peakHalf + 1, 2 * peakHalf + 1) & cv::Rect(0, 0, response.cols, response.rows);
+    const double count = static_cast<double>(response.total() - peakArea.area());
+    if (count < 1)
+        return 0.f;
+
+    const cv::Mat peakResponse = response(peakArea);
+    const double sum = cv::sum(response)[0] - cv::sum(peakResponse)[0];
+    const double sqSum = response.dot(response) - peakResponse.dot(peakResponse);
+    const double mean = sum / count;
+    const double variance = sqSum / count - mean * mean;
+    return static_cast<float>((maxVal - mean) / std::sqrt(std::max(variance, 1e-12)));
+}
+
+///
+/// \brief LostTracksCorrelation::Track
+/// \param prevFrame
+/// \param currFrame
+/// \param ids
+/// \param rects
+/// \param tracked
+/// \param found
+///
+void LostTracksCorrelation::Track(cv::UMat prevFrame, cv::UMat currFrame, const std::vector<track_id_t>& ids, const std::vector<cv::RotatedRect>& rects,
+                                  std::vector<cv::RotatedRect>& tracked, std::vector<char>& found)
+{
+    tracked.assign(rects.size(), cv::RotatedRect());
+    found.assign(rects.size(), 0);
+
+    // Filters of the tracks which aren't lost now are removed
+    for (size_t t = 0; t < m_slotUsed.size(); ++t)
+    {
+        if (m_slotUsed[t] && std::find(std::begin(ids), std::end(ids), m_slotIds[t]) == std::end(ids))
+            m_slotUsed[t] = 0;
+    }
+
+    if (rects.empty() || prevFrame.empty() || prevFrame.size() != currFrame.size())
+    {
+        std::fill(std::begin(m_slotUsed), std::end(m_slotUsed), 0);
+        m_currGrayValid = false;
+        return;
+    }
+
+    if (m_currGrayValid)
+        std::swap(m_prevGray, m_currGray);
+    else
+        Gray(prevFrame, m_prevGray);
+    Gray(currFrame, m_currGray);
+    m_currGrayValid = true;
+
+    auto Window = [&](const cv::Point2f& center, const cv::Size2f& size)
+    {
+        const float width = std::max(8.f, m_settings.m_padding * size.width);
+        const float height = std::max(8.f, m_settings.m_padding * size.height);
+        return cv::Rect2f(center.x - width / 2.f, center.y - height / 2.f, width, height);
+    };
+
+    // New lost tracks get the free tiles, their filters are trained on the previous frame
+    bool newTracks = false;
+    std::fill(std::begin(m_windows), std::end(m_windows), cv::Rect2f());
+    std::fill(std::begin(m_rates), std::end(m_rates), 0.f);
+    m_trackSlots.assign(ids.size(), -1);
+    for (size_t i = 0; i < ids.size(); ++i)
+    {
+        auto it = std::find(std::begin(m_slotIds), std::end(m_slotIds), ids[i]);
+        int slot = (it != std::end(m_slotIds) && m_slotUsed[it - std::begin(m_slotIds)]) ? static_cast<int>(it - std::begin(m_slotIds)) : -1;
+        if (slot < 0)
+        {
+            auto freeIt = std::find(std::begin(m_slotUsed), std::end(m_slotUsed), 0);
+            if (freeIt == std::end(m_slotUsed))
+                continue;
+            slot = static_cast<int>(freeIt - std::begin(m_slotUsed));
+            m_slotUsed[slot] = 1;
+            m_slotIds[slot] = ids[i];
+            m_windows[slot] = Window(rects[i].center, rects[i].size);
+            m_rates[slot] = 1.f;
+            newTracks = true;
+        }
+        m_trackSlots[i] = slot;
+    }
+    if (newTracks)
+    {
+        Sample(m_prevGray);
+        ForwardDFT(m_patches, m_spectra);
+        Train(m_spectra);
+    }
+
+    // Correlation of all filters with the current frame
+    std::fill(std::begin(m_rates), std::end(m_rates), 0.f);
+    for (size_t i = 0; i < ids.size(); ++i)
+    {
+        if (m_trackSlots[i] >= 0)
+            m_windows[m_trackSlots[i]] = Window(rects[i].center, rects[i].size);
+    }
+    Sample(m_currGray);
+    ForwardDFT(m_patches, m_spectra);
+    cv::divide(m_numerator, m_denominator, m_tmp2);
+    cv::mulSpectrums(m_spectra, m_tmp2, m_spectra, 0, false);
+    InverseDFT(m_spectra, m_tmpReal);
+    m_tmpReal.copyTo(m_response);
+
+    const int side = m_settings.m_patchSize;
+    bool wasFound = false;
+    for (size_t i = 0; i < ids.size(); ++i)
+    {
+        const int slot = m_trackSlots[i];
+        if (slot < 0)
+            continue;
+
+        cv::Point peak;
+        const float psr = PSR(m_response.rowRange(slot * side, (slot + 1) * side), peak);
+        if (psr < m_settings.m_minPSR)
+        {
+            m_windows[slot] = cv::Rect2f();
+            continue;
+        }
+        const cv::Rect2f& window = m_windows[slot];
+        const cv::Point2f center(rects[i].center.x + (peak.x - side / 2) * window.width / side,
+                                 rects[i].center.y + (peak.y - side / 2) * window.height / side);
+        tracked[i] = cv::RotatedRect(center, rects[i].size, rects[i].angle);
+        found[i] = 1;
+
+        m_windows[slot] = Window(center, rects[i].size);
+        m_rates[slot] = m_settings.m_learningRate;
+        wasFound = true;
+    }
+
+    // Filters are updated on the found positions
+    if (wasFound && m_settings.m_learningRate > 0)
+    {
+        Sample(m_currGray);
+        ForwardDFT(m_patches, m_spectra);
+        Train(m_spectra);
+    }
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include <vector>
+#include "defines.h"
+
+///
+/// \brief The LostTracksCorrelation class
+/// MOSSE correlation filters of all lost tracks in one batch of cv::UMat operations: patches of the tracks are tiles of one image,
+/// so the sampling, the DFT, the correlation and the update of the filters are the same few OpenCL kernels for any count of the tracks.
+/// Only the correlation responses are downloaded to the CPU for the peaks search.
+/// Filter is trained on the previous frame when the track is lost and lives while the track is passed to Track on every frame
+///
+class LostTracksCorrelation
+{
+public:
+    ///
+    /// \brief The Settings struct
+    ///
+    struct Settings
+    {
+        int m_maxTracks = 64;             // Tiles in the batch, the lost tracks over it are only predicted by Kalman
+        int m_patchSize = 64;             // Side of the tile
+        track_t m_padding = 2.f;          // Sampled window in sizes of the object
+        track_t m_learningRate = 0.125f;  // Update rate of the filter on the found position
+        track_t m_sigma = 2.f;            // Gaussian of the desired response in the tile pixels
+        track_t m_minPSR = 7.f;           // Peak to sidelobe ratio below it means the lost target
+    };
+
+    LostTracksCorrelation(const Settings& settings);
+    LostTracksCorrelation(const LostTracksCorrelation&) = delete;
+    LostTracksCorrelation& operator=(const LostTracksCorrelation&) = delete;
+
+    ///
+    /// \brief Track
+    /// Must be called on every frame: filters of the tracks missed in ids are removed, empty ids only invalidate the saved frame
+    /// \param prevFrame - the filters of the new lost tracks are trained on its pixels, so it must not be rewritten by the caller
+    /// \param currFrame
+    /// \param ids - lost tracks
+    /// \param rects - boxes on the previous frame
+    /// \param tracked - boxes on the current frame, tracked[i] is valid only if found[i] != 0
+    /// \param found
+    ///
+    void Track(cv::UMat prevFrame, cv::UMat currFrame, const std::vector<track_id_t>& ids, const std::vector<cv::RotatedRect>& rects,
+               std::vector<cv::RotatedRect>& tracked, std::vector<char>& found);
+
+private:
+    Settings m_settings;
+
+    // Tiles of the batch
+    std::vector<track_id_t> m_slotIds;
+    std::vector<char> m_slotUsed;
+    std::vector<int> m_trackSlots;        // Slot of the every track from ids, -1 if the batch is full
+    std::vector<cv::Rect2f> m_windows;    // Sampled windows, empty for the unused tiles
+    std::vector<float> m_rates;           // Update rates of the filters
+
+    cv::UMat m_prevGray;
+    cv::UMat m_currGray;
+    bool m_currGrayValid = false;         // m_currGray was calculated on the previous call
+
+    // Batch layout in frequency domain is (u * maxTracks + tile, v), see ForwardDFT
+    cv::UMat m_hann;                      // Tiled Hann window
+    cv::UMat m_targetf;                   // Spectra of the desired responses
+    cv::UMat m_numerator;                 // Filters are numerator / denominator
+    cv::UMat m_denominator;
+
+    cv::Mat m_mapX;
+    cv::Mat m_mapY;
+    cv::Mat m_normScale;
+    cv::Mat m_normOffset;
+    cv::Mat m_sums;
+    cv::Mat m_sqSums;
+    cv::Mat m_response;
+    cv::UMat m_patches;
+    cv::UMat m_spectra;
+    cv::UMat m_tmp;
+    cv::UMat m_tmp2;
+    cv::UMat m_tmpReal;
+    cv::UMat m_column;
+
+    void Gray(cv::UMat frame, cv::UMat& gray);
+    void Sample(const cv::UMat& gray);
+    void ForwardDFT(const cv::UMat& patches, cv::UMat& spectra);
+    void InverseDFT(const cv::UMat& spectra, cv::UMat& real);
+    void Train(const cv::UMat& spectra);
+    float PSR(const cv::Mat& response, cv::Point& peak) const;
+};
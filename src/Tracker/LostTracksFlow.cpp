@@ -0,0 +1,174 @@
+#include "LostTracksFlow.h"
+
+#include <algorithm>
+#include <cmath>
+#include <opencv2/video/tracking.hpp>
+
+///
+/// \brief LostTracksFlow::LostTracksFlow
+/// \param settings
+///
+LostTracksFlow::LostTracksFlow(const Settings& settings)
+    : m_settings(settings)
+{
+    m_settings.m_maxPoints = std::max(1, m_settings.m_maxPoints);
+    m_settings.m_winSize = std::max(5, m_settings.m_winSize);
+    m_settings.m_maxLevel = std::max(0, m_settings.m_maxLevel);
+    m_settings.m_minPoints = std::min(std::max(1, m_settings.m_minPoints), m_settings.m_maxPoints);
+}
+
+///
+/// \brief LostTracksFlow::BuildPyramid
+/// \param frame
+/// \param pyr
+///
+void LostTracksFlow::BuildPyramid(cv::UMat frame, std::vector<cv::Mat>& pyr)
+{
+    if (frame.channels() == 1)
+        frame.copyTo(m_gray);
+    else
+        cv::cvtColor(frame, m_gray, cv::COLOR_BGR2GRAY);
+
+    // Levels are copied with borders: the pyramid doesn't depend on the frame buffer of the caller
+    cv::buildOpticalFlowPyramid(m_gray, pyr, cv::Size(m_settings.m_winSize, m_settings.m_winSize), m_settings.m_maxLevel, true,
+                                cv::BORDER_REFLECT_101, cv::BORDER_CONSTANT, false);
+}
+
+///
+/// \brief LostTracksFlow::SelectPoints
+/// Good features inside the box without its border, the regular grid if the box is flat
+/// \param prevGray
+/// \param rect
+///
+void LostTracksFlow::SelectPoints(const cv::Mat& prevGray, const cv::Rect& rect)
+{
+    const int dx = rect.width / 10;
+    const int dy = rect.height / 10;
+    const cv::Rect inner = cv::Rect(rect.x + dx, rect.y + dy, rect.width - 2 * dx, rect.height - 2 * dy) & cv::Rect(0, 0, prevGray.cols, prevGray.rows);
+    if (inner.width < 4 || inner.height < 4)
+        return;
+
+    const int gridSide = static_cast<int>(std::ceil(std::sqrt(static_cast<float>(m_settings.m_maxPoints))));
+    const double minDist = std::max(2., std::min(inner.width, inner.height) / static_cast<double>(2 * gridSide));
+
+    m_boxPoints.clear();
+    cv::goodFeaturesToTrack(prevGray(inner), m_boxPoints, m_settings.m_maxPoints, 0.01, minDist);
+    if (static_cast<int>(m_boxPoints.size()) < m_settings.m_minPoints)
+    {
+        m_boxPoints.clear();
+        for (int iy = 0; iy < gridSide; ++iy)
+        {
+            for (int ix = 0; ix < gridSide; ++ix)
+            {
+                m_boxPoints.emplace_back((ix + 0.5f) * inner.width / gridSide, (iy + 0.5f) * inner.height / gridSide);
+            }
+        }
+    }
+    for (const auto& pt : m_boxPoints)
+    {
+        m_prevPoints.emplace_back(pt.x + inner.x, pt.y + inner.y);
+    }
+}
+
+///
+/// \brief LostTracksFlow::Track
+/// \param prevFrame
+/// \param currFrame
+/// \param rects
+/// \param tracked
+/// \param found
+///
+void LostTracksFlow::Track(cv::UMat prevFrame, cv::UMat currFrame, const std::vector<cv::RotatedRect>& rects,
+                           std::vector<cv::RotatedRect>& tracked, std::vector<char>& found)
+{
+    tracked.assign(rects.size(), cv::RotatedRect());
+    found.assign(rects.size(), 0);
+
+    if (rects.empty() || prevFrame.empty() || prevFrame.size() != currFrame.size())
+    {
+        m_currPyrValid = false;
+        return;
+    }
+
+    if (m_currPyrValid)
+        std::swap(m_prevPyr, m_currPyr);
+    else
+        BuildPyramid(prevFrame, m_prevPyr);
+    BuildPyramid(currFrame, m_currPyr);
+    m_currPyrValid = true;
+
+    // The first level of the pyramid with derivatives is the image
+    const cv::Mat& prevGray = m_prevPyr[0];
+
+    m_prevPoints.clear();
+    m_firstPoints.clear();
+    for (const auto& rrect : rects)
+    {
+        m_firstPoints.push_back(m_prevPoints.size());
+        SelectPoints(prevGray, rrect.boundingRect());
+    }
+    m_firstPoints.push_back(m_prevPoints.size());
+    if (m_prevPoints.empty())
+        return;
+
+    // One call for all lost tracks
+    cv::calcOpticalFlowPyrLK(m_prevPyr, m_currPyr, m_prevPoints, m_currPoints, m_status, m_errors,
+                             cv::Size(m_settings.m_winSize, m_settings.m_winSize), m_settings.m_maxLevel);
+
+    auto Median = [](std::vector<float>& vals)
+    {
+        auto mid = std::begin(vals) + vals.size() / 2;
+        std::nth_element(std::begin(vals), mid, std::end(vals));
+        return *mid;
+    };
+
+    for (size_t i = 0; i < rects.size(); ++i)
+    {
+        m_dx.clear();
+        m_dy.clear();
+        for (size_t pi = m_firstPoints[i]; pi < m_firstPoints[i + 1]; ++pi)
+        {
+            if (!m_status[pi])
+                continue;
+            m_dx.push_back(m_currPoints[pi].x - m_prevPoints[pi].x);
+            m_dy.push_back(m_currPoints[pi].y - m_prevPoints[pi].y);
+        }
+        if (static_cast<int>(m_dx.size()) < m_settings.m_minPoints)
+            continue;
+
+        const float shiftX = Median(m_dx);
+        const float shiftY = Median(m_dy);
+
+        // Points with the shift far from the median belong to the background or to another object
+        const cv::Size2f& size = rects[i].size;
+        const float maxResidual = std::max(2.f, 0.1f * std::min(size.width, size.height));
+        m_scales.clear();
+        size_t inliers = 0;
+        for (size_t pi = m_firstPoints[i]; pi < m_firstPoints[i + 1]; ++pi)
+        {
+            if (!m_status[pi] ||
+                    std::abs(m_currPoints[pi].x - m_prevPoints[pi].x - shiftX) > maxResidual ||
+                    std::abs(m_currPoints[pi].y - m_prevPoints[pi].y - shiftY) > maxResidual)
+                continue;
+            ++inliers;
+
+            // Scale is the median ratio of the distances between the pairs of points
+            for (size_t pj = pi + 1; pj < m_firstPoints[i + 1]; ++pj)
+            {
+                if (!m_status[pj])
+                    continue;
+                const float prevDist = static_cast<float>(cv::norm(m_prevPoints[pi] - m_prevPoints[pj]));
+                if (prevDist > 1.f)
+                    m_scales.push_back(static_cast<float>(cv::norm(m_currPoints[pi] - m_currPoints[pj])) / prevDist);
+            }
+        }
+        if (static_cast<int>(inliers) < m_settings.m_minPoints || 2 * inliers < m_dx.size())
+            continue;
+
+        const float scale = m_scales.empty() ? 1.f : std::min(2.f, std::max(0.5f, Median(m_scales)));
+
+        tracked[i] = cv::RotatedRect(cv::Point2f(rects[i].center.x + shiftX, rects[i].center.y + shiftY),
+                                     cv::Size2f(scale * size.width, scale * size.height), rects[i].angle);
+        found[i] = 1;
+    }
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <vector>
+#include "defines.h"
+
+///
+/// \brief The LostTracksFlow class
+/// Propagation of all lost tracks by one sparse optical flow call: good features inside every box of the previous frame
+/// are tracked by cv::calcOpticalFlowPyrLK together, the shift and the scale of the box are the medians over its points.
+/// Pyramid of the current frame is built once and becomes the previous pyramid on the next frame
+///
+class LostTracksFlow
+{
+public:
+    ///
+    /// \brief The Settings struct
+    ///
+    struct Settings
+    {
+        int m_maxPoints = 16;  // Features inside one box
+        int m_winSize = 15;    // Window of LK on every pyramid level
+        int m_maxLevel = 3;    // Levels of the LK pyramid
+        int m_minPoints = 4;   // Box without so many tracked points isn't updated
+    };
+
+    LostTracksFlow(const Settings& settings);
+    LostTracksFlow(const LostTracksFlow&) = delete;
+    LostTracksFlow& operator=(const LostTracksFlow&) = delete;
+
+    ///
+    /// \brief Track
+    /// Must be called on every frame, empty rects only invalidate the saved pyramid
+    /// \param prevFrame - its pixels are read when the saved pyramid isn't valid, so it must not be rewritten by the caller
+    /// \param currFrame
+    /// \param rects - boxes on the previous frame
+    /// \param tracked - boxes on the current frame, tracked[i] is valid only if found[i] != 0
+    /// \param found
+    ///
+    void Track(cv::UMat prevFrame, cv::UMat currFrame, const std::vector<cv::RotatedRect>& rects,
+               std::vector<cv::RotatedRect>& tracked, std::vector<char>& found);
+
+private:
+    Settings m_settings;
+
+    std::vector<cv::Mat> m_prevPyr;
+    std::vector<cv::Mat> m_currPyr;
+    bool m_currPyrValid = false; // m_currPyr was built on the previous call
+
+    cv::Mat m_gray;
+    std::vector<cv::Point2f> m_prevPoints;
+    std::vector<cv::Point2f> m_currPoints;
+    std::vector<uchar> m_status;
+    std::vector<float> m_errors;
+    std::vector<size_t> m_firstPoints; // Index of the first point of the box, the last value is the points count
+    std::vector<cv::Point2f> m_boxPoints;
+    std::vector<float> m_dx;
+    std::vector<float> m_dy;
+    std::vector<float> m_scales;
+
+    void BuildPyramid(cv::UMat frame, std::vector<cv::Mat>& pyr);
+    void SelectPoints(const cv::Mat& prevGray, const cv::Rect& rect);
+};
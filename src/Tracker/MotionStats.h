@@ -0,0 +1,172 @@
+#pragma once
+#include <array>
+#include <cmath>
+#include "defines.h"
+
+///
+/// \brief The TrackMotion struct
+/// Motion of the track by its trajectory: the units are pixels and trajectory points, one point per tracker update
+///
+struct TrackMotion
+{
+    Point_t m_velocity;         // Slope of the linear fit on the last MotionStats::Window points, pixels/point
+    Point_t m_position;         // Linear fit on the last point
+    Point_t m_acceleration;     // Smoothed change of m_velocity, pixels/point^2
+    track_t m_speed = 0;        // Norm of m_velocity
+    track_t m_heading = 0;      // Direction of m_velocity in degrees: 0 - along x, 90 - along y
+    track_t m_windowLength = 0; // Path length of the window
+    track_t m_pathLength = 0;   // Path length of the all points
+    size_t m_points = 0;        // Points in the window
+};
+
+///
+/// \brief The MotionStats class
+/// Running sums of the trajectory: every point updates the statistics in O(1) and the analytics read TrackMotion
+/// instead of the scanning of the trace. The linear fit x(t) = kx * t + bx, y(t) = ky * t + by is on the sliding
+/// window with t = 0 on the last point, so the sums of t and t^2 depend only on the count and bx, by are the
+/// smoothed position. The sums of the points are recalculated from the window once per its length against the rounding drift
+///
+class MotionStats
+{
+public:
+    static constexpr size_t Window = 16;
+
+    ///
+    /// \brief Add
+    /// \param pt - new point of the trajectory
+    ///
+    void Add(const Point_t& pt)
+    {
+        track_t segment = 0;
+        if (m_motion.m_points)
+        {
+            segment = std::hypot(pt.x - m_last.x, pt.y - m_last.y);
+            m_pathLength += segment;
+            m_motion.m_pathLength = static_cast<track_t>(m_pathLength);
+        }
+        m_last = pt;
+
+        // Time of the all points is shifted on -1
+        m_sumTX -= m_sumX;
+        m_sumTY -= m_sumY;
+        if (m_count == Window)
+        {
+            const Sample& oldest = m_window[m_head];
+            const double t = -static_cast<double>(Window);
+            m_sumX -= oldest.m_pt.x;
+            m_sumY -= oldest.m_pt.y;
+            m_sumTX -= t * oldest.m_pt.x;
+            m_sumTY -= t * oldest.m_pt.y;
+            m_sumSegments -= oldest.m_segment;
+        }
+        else
+        {
+            ++m_count;
+        }
+        m_window[m_head] = Sample{ pt, segment };
+        m_head = (m_head + 1) % Window;
+        m_sumX += pt.x;
+        m_sumY += pt.y;
+        m_sumSegments += segment;
+
+        if (m_head == 0)
+            Recalc();
+        Fit();
+    }
+
+    ///
+    void Reset()
+    {
+        *this = MotionStats();
+    }
+
+    ///
+    const TrackMotion& Motion() const
+    {
+        return m_motion;
+    }
+
+private:
+    ///
+    struct Sample
+    {
+        Point_t m_pt;
+        track_t m_segment = 0; // Distance from the previous point
+    };
+
+    std::array<Sample, Window> m_window;
+    size_t m_head = 0;  // Place of the next point, the oldest point if the window is full
+    size_t m_count = 0;
+    double m_sumX = 0;
+    double m_sumY = 0;
+    double m_sumTX = 0;
+    double m_sumTY = 0;
+    double m_sumSegments = 0;
+    double m_pathLength = 0;
+    Point_t m_last;
+    TrackMotion m_motion;
+
+    ///
+    /// \brief Recalc
+    /// The sums by the window points
+    ///
+    void Recalc()
+    {
+        m_sumX = 0;
+        m_sumY = 0;
+        m_sumTX = 0;
+        m_sumTY = 0;
+        m_sumSegments = 0;
+        for (size_t i = 0; i < m_count; ++i)
+        {
+            // From the newest point
+            const Sample& sample = m_window[(m_head + Window - 1 - i) % Window];
+            const double t = -static_cast<double>(i);
+            m_sumX += sample.m_pt.x;
+            m_sumY += sample.m_pt.y;
+            m_sumTX += t * sample.m_pt.x;
+            m_sumTY += t * sample.m_pt.y;
+            m_sumSegments += sample.m_segment;
+        }
+    }
+
+    ///
+    /// \brief Fit
+    /// Least squares on the window: t = 0, -1, ..., 1 - count
+    ///
+    void Fit()
+    {
+        const double n = static_cast<double>(m_count);
+        const double sumT = -n * (n - 1) / 2;
+        const double sumTT = (n - 1) * n * (2 * n - 1) / 6;
+        const double det = n * sumTT - sumT * sumT;
+
+        const Point_t prevVelocity = m_motion.m_velocity;
+        if (det > 0)
+        {
+            const double kx = (n * m_sumTX - sumT * m_sumX) / det;
+            const double ky = (n * m_sumTY - sumT * m_sumY) / det;
+            m_motion.m_velocity = Point_t(static_cast<track_t>(kx), static_cast<track_t>(ky));
+            m_motion.m_position = Point_t(static_cast<track_t>((m_sumX - kx * sumT) / n), static_cast<track_t>((m_sumY - ky * sumT) / n));
+        }
+        else
+        {
+            m_motion.m_velocity = Point_t(0, 0);
+            m_motion.m_position = m_last;
+        }
+
+        // Exponential smoothing with the same period as the window
+        if (m_count > 2)
+        {
+            constexpr track_t alpha = 2.f / (Window + 1);
+            m_motion.m_acceleration += alpha * (m_motion.m_velocity - prevVelocity - m_motion.m_acceleration);
+        }
+
+        m_motion.m_speed = std::hypot(m_motion.m_velocity.x, m_motion.m_velocity.y);
+        if (m_motion.m_speed > 0)
+            m_motion.m_heading = static_cast<track_t>(std::atan2(m_motion.m_velocity.y, m_motion.m_velocity.x) * 180. / CV_PI);
+        // Without the segment from the oldest point to the removed one
+        m_motion.m_windowLength = static_cast<track_t>(m_sumSegments - m_window[(m_count == Window) ? m_head : 0].m_segment);
+        m_motion.m_points = m_count;
+    }
+};
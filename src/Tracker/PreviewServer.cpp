@@ -0,0 +1,473 @@
+#include "PreviewServer.h"
+#include "metrics.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+
+#include <opencv2/imgproc.hpp>
+#include <opencv2/imgcodecs.hpp>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef int socklen_t;
+#define SEND_FLAGS 0
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+typedef int SOCKET;
+#define INVALID_SOCKET -1
+#define SOCKET_ERROR -1
+#define closesocket close
+#define SEND_FLAGS MSG_NOSIGNAL
+#endif
+
+namespace
+{
+///
+/// \brief The PreviewMetrics struct
+///
+struct PreviewMetrics
+{
+    metrics::Counter& m_droppedFrames;
+    metrics::Counter& m_droppedTracks;
+
+    ///
+    static PreviewMetrics& Instance()
+    {
+        static PreviewMetrics instance;
+        return instance;
+    }
+
+private:
+    PreviewMetrics()
+        : m_droppedFrames(metrics::Registry::Instance().GetCounter("mtracker_preview_dropped_total{stream=\"preview\"}", "Messages of the preview server skipped for the slow clients")),
+          m_droppedTracks(metrics::Registry::Instance().GetCounter("mtracker_preview_dropped_total{stream=\"tracks\"}", "Messages of the preview server skipped for the slow clients"))
+    {
+    }
+};
+
+///
+bool SetNonBlocking(SOCKET sock)
+{
+#ifdef _WIN32
+    u_long mode = 1;
+    return ioctlsocket(sock, FIONBIO, &mode) == 0;
+#else
+    const int flags = fcntl(sock, F_GETFL, 0);
+    return flags >= 0 && fcntl(sock, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
+
+///
+bool WouldBlock()
+{
+#ifdef _WIN32
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+}
+
+///
+/// \brief AppendTrack
+/// \param json
+/// \param obj
+///
+void AppendTrack(std::string& json, const TrackingObject& obj)
+{
+    char buf[320];
+    const int len = snprintf(buf, sizeof(buf), "{\"id\":%llu,\"type\":\"%s\",\"conf\":%.3f,\"x\":%.1f,\"y\":%.1f,\"w\":%.1f,\"h\":%.1f,\"angle\":%.1f,\"vx\":%.1f,\"vy\":%.1f,\"static\":%d}",
+                             static_cast<unsigned long long>(obj.m_ID.m_val), TypeConverter::Type2Str(obj.m_type).c_str(), obj.m_confidence,
+                             obj.m_rrect.center.x, obj.m_rrect.center.y, obj.m_rrect.size.width, obj.m_rrect.size.height, obj.m_rrect.angle,
+                             static_cast<double>(obj.m_velocity[0]), static_cast<double>(obj.m_velocity[1]), obj.m_isStatic ? 1 : 0);
+    if (len > 0)
+        json.append(buf, std::min(static_cast<size_t>(len), sizeof(buf) - 1));
+}
+}
+
+///
+/// \brief PreviewServer::PreviewServer
+/// \param settings
+///
+PreviewServer::PreviewServer(const Settings& settings)
+    : m_settings(settings)
+{
+    m_jpegParams = { cv::IMWRITE_JPEG_QUALITY, std::max(1, std::min(100, m_settings.m_quality)) };
+#ifdef _WIN32
+    WSADATA wsaData;
+    WSAStartup(MAKEWORD(2, 2), &wsaData);
+#endif
+}
+
+///
+/// \brief PreviewServer::~PreviewServer
+///
+PreviewServer::~PreviewServer()
+{
+    Stop();
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+///
+/// \brief PreviewServer::Start
+/// \return
+///
+bool PreviewServer::Start()
+{
+    Stop();
+
+    SOCKET sock = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (sock == INVALID_SOCKET)
+    {
+        std::cerr << "PreviewServer: socket error" << std::endl;
+        return false;
+    }
+    int reuse = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = INADDR_ANY;
+    address.sin_port = htons(static_cast<unsigned short>(m_settings.m_port));
+    if (!SetNonBlocking(sock) ||
+        ::bind(sock, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == SOCKET_ERROR ||
+        ::listen(sock, 10) == SOCKET_ERROR)
+    {
+        std::cerr << "PreviewServer: couldn't listen on the port " << m_settings.m_port << std::endl;
+        closesocket(sock);
+        return false;
+    }
+    m_listenSocket = static_cast<intptr_t>(sock);
+
+    m_stop = false;
+    m_thread = std::thread(&PreviewServer::Worker, this);
+    std::cout << "PreviewServer: http://localhost:" << m_settings.m_port << "/preview and /tracks" << std::endl;
+    return true;
+}
+
+///
+/// \brief PreviewServer::Stop
+///
+void PreviewServer::Stop()
+{
+    m_stop = true;
+    if (m_thread.joinable())
+        m_thread.join();
+
+    for (auto& client : m_clients)
+    {
+        CloseClient(client);
+    }
+    m_clients.clear();
+    CountClients();
+    if (m_listenSocket != -1)
+    {
+        closesocket(static_cast<SOCKET>(m_listenSocket));
+        m_listenSocket = -1;
+    }
+}
+
+///
+/// \brief PreviewServer::PostFrame
+/// \param frame
+///
+void PreviewServer::PostFrame(const cv::Mat& frame)
+{
+    if (!HasPreviewClients() || frame.empty())
+        return;
+
+    const auto now = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_hasFrame)
+            return;
+        if (m_settings.m_fps > 0 && now - m_lastFrameTime < std::chrono::duration<float>(1.f / m_settings.m_fps))
+            return;
+        m_lastFrameTime = now;
+    }
+
+    // The worker doesn't touch m_pendingFrame while m_hasFrame is false
+    if (m_settings.m_width > 0 && frame.cols > m_settings.m_width)
+        cv::resize(frame, m_pendingFrame, cv::Size(m_settings.m_width, cvRound(frame.rows * static_cast<double>(m_settings.m_width) / frame.cols)), 0, 0, cv::INTER_AREA);
+    else
+        frame.copyTo(m_pendingFrame);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_hasFrame = true;
+}
+
+///
+/// \brief PreviewServer::PostTracks
+/// \param frameIndex
+/// \param delta
+///
+void PreviewServer::PostTracks(int frameIndex, const TracksDelta& delta)
+{
+    if (!HasTracksClients())
+        return;
+
+    m_json.clear();
+    m_json += "{\"frame\":" + std::to_string(frameIndex) + ",\"new\":[";
+    for (size_t i = 0; i < delta.m_newTracks.size(); ++i)
+    {
+        if (i)
+            m_json += ',';
+        AppendTrack(m_json, delta.m_newTracks[i]);
+    }
+    m_json += "],\"updated\":[";
+    for (size_t i = 0; i < delta.m_updatedTracks.size(); ++i)
+    {
+        if (i)
+            m_json += ',';
+        AppendTrack(m_json, delta.m_updatedTracks[i]);
+    }
+    m_json += "],\"removed\":[";
+    for (size_t i = 0; i < delta.m_removedTracks.size(); ++i)
+    {
+        if (i)
+            m_json += ',';
+        m_json += std::to_string(delta.m_removedTracks[i].m_val);
+    }
+    m_json += "]}\n";
+
+    message_t message = std::make_shared<const std::string>(m_json);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pendingTracks = std::move(message);
+}
+
+///
+/// \brief PreviewServer::Worker
+///
+void PreviewServer::Worker()
+{
+    while (!m_stop)
+    {
+        fd_set readSet;
+        fd_set writeSet;
+        FD_ZERO(&readSet);
+        FD_ZERO(&writeSet);
+        SOCKET maxfd = static_cast<SOCKET>(m_listenSocket);
+        FD_SET(maxfd, &readSet);
+        for (const auto& client : m_clients)
+        {
+            const SOCKET sock = static_cast<SOCKET>(client.m_socket);
+            FD_SET(sock, &readSet); // The request or the closed connection
+            if (client.m_message)
+                FD_SET(sock, &writeSet);
+            maxfd = std::max(maxfd, sock);
+        }
+
+        timeval timeout = { 0, 10000 };
+        const int ready = ::select(static_cast<int>(maxfd + 1), &readSet, &writeSet, nullptr, &timeout);
+        if (ready > 0)
+        {
+            if (FD_ISSET(static_cast<SOCKET>(m_listenSocket), &readSet))
+                Accept();
+            for (auto& client : m_clients)
+            {
+                const SOCKET sock = static_cast<SOCKET>(client.m_socket);
+                if (client.m_socket != -1 && FD_ISSET(sock, &readSet))
+                    ReadRequest(client);
+                if (client.m_socket != -1 && FD_ISSET(sock, &writeSet))
+                    Send(client);
+            }
+        }
+        m_clients.erase(std::remove_if(std::begin(m_clients), std::end(m_clients), [](const Client& client) { return client.m_socket == -1; }), std::end(m_clients));
+        CountClients();
+
+        // The messages of the processing thread
+        bool hasFrame = false;
+        message_t tracks;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_hasFrame)
+            {
+                cv::swap(m_pendingFrame, m_encodeFrame);
+                m_hasFrame = false;
+                hasFrame = true;
+            }
+            tracks.swap(m_pendingTracks);
+        }
+        if (hasFrame)
+            Broadcast(Client::Kind::Preview, EncodeFrame());
+        if (tracks)
+            Broadcast(Client::Kind::Tracks, tracks);
+    }
+}
+
+///
+/// \brief PreviewServer::Accept
+///
+void PreviewServer::Accept()
+{
+    sockaddr_in address;
+    socklen_t addrlen = sizeof(address);
+    const SOCKET sock = ::accept(static_cast<SOCKET>(m_listenSocket), reinterpret_cast<sockaddr*>(&address), &addrlen);
+    if (sock == INVALID_SOCKET)
+        return;
+    if (!SetNonBlocking(sock))
+    {
+        closesocket(sock);
+        return;
+    }
+    Client client;
+    client.m_socket = static_cast<intptr_t>(sock);
+    m_clients.emplace_back(std::move(client));
+}
+
+///
+/// \brief PreviewServer::ReadRequest
+/// The request line selects the stream, the data of the streaming clients is ignored
+/// \param client
+///
+void PreviewServer::ReadRequest(Client& client)
+{
+    char buf[1024];
+    const int n = ::recv(static_cast<SOCKET>(client.m_socket), buf, sizeof(buf), 0);
+    if (n == 0 || (n < 0 && !WouldBlock()))
+    {
+        CloseClient(client);
+        return;
+    }
+    if (n < 0 || client.m_kind != Client::Kind::Request)
+        return;
+
+    client.m_request.append(buf, static_cast<size_t>(n));
+    if (client.m_request.find("\r\n\r\n") == std::string::npos && client.m_request.find("\n\n") == std::string::npos)
+    {
+        if (client.m_request.size() > 8192)
+            CloseClient(client);
+        return;
+    }
+
+    const char* headers = "Connection: close\r\nCache-Control: no-cache, private\r\nPragma: no-cache\r\nAccess-Control-Allow-Origin: *\r\n";
+    if (client.m_request.compare(0, 13, "GET /preview ") == 0)
+    {
+        client.m_kind = Client::Kind::Preview;
+        client.m_message = std::make_shared<const std::string>(std::string("HTTP/1.0 200 OK\r\n") + headers + "Content-Type: multipart/x-mixed-replace; boundary=mjpegstream\r\n\r\n");
+    }
+    else if (client.m_request.compare(0, 12, "GET /tracks ") == 0)
+    {
+        client.m_kind = Client::Kind::Tracks;
+        client.m_message = std::make_shared<const std::string>(std::string("HTTP/1.0 200 OK\r\n") + headers + "Content-Type: application/x-ndjson\r\n\r\n");
+    }
+    else
+    {
+        client.m_message = std::make_shared<const std::string>(std::string("HTTP/1.0 404 Not Found\r\n") + headers + "Content-Type: text/plain\r\n\r\nGET /preview or /tracks\r\n");
+        client.m_close = true;
+    }
+    client.m_request.clear();
+    client.m_sent = 0;
+}
+
+///
+/// \brief PreviewServer::Send
+/// \param client
+///
+void PreviewServer::Send(Client& client)
+{
+    const std::string& message = *client.m_message;
+    const int n = ::send(static_cast<SOCKET>(client.m_socket), message.data() + client.m_sent, static_cast<int>(message.size() - client.m_sent), SEND_FLAGS);
+    if (n < 0)
+    {
+        if (!WouldBlock())
+            CloseClient(client);
+        return;
+    }
+    client.m_sent += static_cast<size_t>(n);
+    if (client.m_sent < message.size())
+        return;
+
+    client.m_message.reset();
+    client.m_sent = 0;
+    if (client.m_close)
+        CloseClient(client);
+}
+
+///
+/// \brief PreviewServer::Broadcast
+/// The client that is still sending the previous message skips this one
+/// \param kind
+/// \param message
+///
+void PreviewServer::Broadcast(Client::Kind kind, const message_t& message)
+{
+    if (!message)
+        return;
+    for (auto& client : m_clients)
+    {
+        if (client.m_kind != kind || client.m_socket == -1)
+            continue;
+        if (client.m_message)
+        {
+            (kind == Client::Kind::Preview) ? PreviewMetrics::Instance().m_droppedFrames.Add() : PreviewMetrics::Instance().m_droppedTracks.Add();
+            continue;
+        }
+        client.m_message = message;
+        client.m_sent = 0;
+        Send(client);
+    }
+}
+
+///
+/// \brief PreviewServer::EncodeFrame
+/// \return Part of the multipart stream
+///
+PreviewServer::message_t PreviewServer::EncodeFrame()
+{
+    if (m_encodeFrame.empty() || !cv::imencode(".jpg", m_encodeFrame, m_jpeg, m_jpegParams))
+        return message_t();
+
+    char head[128];
+    const int len = snprintf(head, sizeof(head), "--mjpegstream\r\nContent-Type: image/jpeg\r\nContent-Length: %zu\r\n\r\n", m_jpeg.size());
+    std::string part;
+    part.reserve(static_cast<size_t>(len) + m_jpeg.size() + 2);
+    part.append(head, static_cast<size_t>(len));
+    part.append(reinterpret_cast<const char*>(m_jpeg.data()), m_jpeg.size());
+    part.append("\r\n");
+    return std::make_shared<const std::string>(std::move(part));
+}
+
+///
+/// \brief PreviewServer::CloseClient
+/// \param client
+///
+void PreviewServer::CloseClient(Client& client)
+{
+    if (client.m_socket == -1)
+        return;
+    closesocket(static_cast<SOCKET>(client.m_socket));
+    client.m_socket = -1;
+    client.m_message.reset();
+}
+
+///
+/// \brief PreviewServer::CountClients
+///
+void PreviewServer::CountClients()
+{
+    int previewClients = 0;
+    int tracksClients = 0;
+    for (const auto& client : m_clients)
+    {
+        if (client.m_kind == Client::Kind::Preview)
+            ++previewClients;
+        else if (client.m_kind == Client::Kind::Tracks)
+            ++tracksClients;
+    }
+    m_previewClients.store(previewClients, std::memory_order_relaxed);
+    m_tracksClients.store(tracksClients, std::memory_order_relaxed);
+}
@@ -0,0 +1,123 @@
+#pragma once
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Ctracker.h"
+
+///
+/// \brief The PreviewServer class
+/// HTTP endpoint of the remote monitoring without the drawing and the video writing, the select loop of the clients
+/// is the same as in darknet http_stream:
+///
+///     GET /preview - MJPEG stream of the frames (multipart/x-mixed-replace) at the reduced resolution and frame rate
+///     GET /tracks  - stream of JSON lines, one line with the tracks delta of every frame: {"frame":N,"new":[...],"updated":[...],"removed":[...]}
+///
+/// The processing thread only posts: the frame is resized to the small preview and the delta is serialized once for
+/// the all clients, and only if any client is connected. JPEG encoding and the sending are in the server thread on the
+/// non-blocking sockets: the client that hasn't received the previous message skips the new one, so the slow clients
+/// never stall the processing loop
+///
+class PreviewServer
+{
+public:
+    ///
+    struct Settings
+    {
+        int m_port = 8090;
+        int m_width = 640;    // Width of the preview, the height keeps the aspect ratio. 0 - the frame size
+        float m_fps = 5.f;    // Maximum frame rate of the preview, 0 - the every posted frame
+        int m_quality = 70;   // JPEG quality
+    };
+
+    PreviewServer(const Settings& settings);
+    ~PreviewServer();
+
+    PreviewServer(const PreviewServer&) = delete;
+    PreviewServer& operator=(const PreviewServer&) = delete;
+
+    ///
+    /// \brief Start
+    /// \return false if the port can't be bound
+    ///
+    bool Start();
+    ///
+    void Stop();
+
+    ///
+    /// \brief PostFrame
+    /// The frame is dropped if nobody watches the preview, the interval is shorter than 1 / fps or the previous one isn't encoded
+    /// \param frame - BGR, it's resized before the return and isn't kept
+    ///
+    void PostFrame(const cv::Mat& frame);
+
+    ///
+    /// \brief PostTracks
+    /// \param delta - of BaseTracker::GetTracksDelta
+    ///
+    void PostTracks(int frameIndex, const TracksDelta& delta);
+
+    ///
+    bool HasPreviewClients() const
+    {
+        return m_previewClients.load(std::memory_order_relaxed) > 0;
+    }
+    ///
+    bool HasTracksClients() const
+    {
+        return m_tracksClients.load(std::memory_order_relaxed) > 0;
+    }
+
+private:
+    typedef std::shared_ptr<const std::string> message_t;
+
+    ///
+    struct Client
+    {
+        enum class Kind
+        {
+            Request,  // The request isn't read yet
+            Preview,
+            Tracks
+        };
+        intptr_t m_socket = -1;
+        Kind m_kind = Kind::Request;
+        std::string m_request;
+        message_t m_message;      // Being sent
+        size_t m_sent = 0;
+        bool m_close = false;     // After the message is sent
+    };
+
+    Settings m_settings;
+    intptr_t m_listenSocket = -1;
+    std::vector<Client> m_clients;
+
+    std::thread m_thread;
+    std::atomic<bool> m_stop{ false };
+    std::atomic<int> m_previewClients{ 0 };
+    std::atomic<int> m_tracksClients{ 0 };
+
+    std::mutex m_mutex;
+    cv::Mat m_pendingFrame;       // Resized frame for the encoder, it's written by PostFrame only while m_hasFrame is false
+    bool m_hasFrame = false;
+    cv::Mat m_encodeFrame;
+    message_t m_pendingTracks;
+    std::chrono::steady_clock::time_point m_lastFrameTime;
+
+    std::string m_json;           // Serialization buffer of the processing thread
+    std::vector<uchar> m_jpeg;
+    std::vector<int> m_jpegParams;
+
+    void Worker();
+    void Accept();
+    void ReadRequest(Client& client);
+    void Send(Client& client);
+    void Broadcast(Client::Kind kind, const message_t& message);
+    message_t EncodeFrame();
+    void CloseClient(Client& client);
+    void CountClients();
+};
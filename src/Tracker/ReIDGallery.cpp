@@ -0,0 +1,424 @@
+#include "ReIDGallery.h"
+
+#include <cmath>
+#include <queue>
+#include <limits>
+#include <algorithm>
+#include <functional>
+
+///
+/// \brief HNSWIndex::HNSWIndex
+/// \param dim
+/// \param M
+/// \param efConstruction
+///
+HNSWIndex::HNSWIndex(int dim, int M, int efConstruction)
+    : m_dim(std::max(0, dim)), m_M(std::max(2, M)), m_efConstruction(std::max(m_M, efConstruction))
+{
+    m_levelMult = 1. / log(static_cast<double>(m_M));
+}
+
+///
+/// \brief HNSWIndex::Dist
+/// \param vec
+/// \param node
+/// \return
+///
+float HNSWIndex::Dist(const float* vec, int node) const
+{
+    const float* nodeVec = Vector(node);
+    float dot = 0;
+    for (int i = 0; i < m_dim; ++i)
+    {
+        dot += vec[i] * nodeVec[i];
+    }
+    return 1.f - dot;
+}
+
+///
+/// \brief HNSWIndex::SearchLayer
+/// \param vec
+/// \param entries
+/// \param ef
+/// \param level
+/// \return ef nearest nodes on the level in the ascending order of the distance
+///
+std::vector<HNSWIndex::DistNode> HNSWIndex::SearchLayer(const float* vec, const std::vector<DistNode>& entries, size_t ef, int level) const
+{
+    m_visited.resize(m_ids.size(), 0);
+    if (++m_visitEpoch == 0)
+    {
+        std::fill(m_visited.begin(), m_visited.end(), 0);
+        m_visitEpoch = 1;
+    }
+
+    std::priority_queue<DistNode, std::vector<DistNode>, std::greater<DistNode>> candidates;
+    std::priority_queue<DistNode> nearest;
+    for (const auto& entry : entries)
+    {
+        m_visited[entry.second] = m_visitEpoch;
+        candidates.push(entry);
+        nearest.push(entry);
+    }
+    while (nearest.size() > ef)
+    {
+        nearest.pop();
+    }
+
+    while (!candidates.empty())
+    {
+        const DistNode curr = candidates.top();
+        if (nearest.size() >= ef && curr.first > nearest.top().first)
+            break;
+        candidates.pop();
+
+        for (int neighbor : m_links[curr.second][level])
+        {
+            if (m_visited[neighbor] == m_visitEpoch)
+                continue;
+            m_visited[neighbor] = m_visitEpoch;
+
+            const float dist = Dist(vec, neighbor);
+            if (nearest.size() < ef || dist < nearest.top().first)
+            {
+                candidates.emplace(dist, neighbor);
+                nearest.emplace(dist, neighbor);
+                if (nearest.size() > ef)
+                    nearest.pop();
+            }
+        }
+    }
+
+    std::vector<DistNode> res(nearest.size());
+    for (size_t i = res.size(); i > 0; --i)
+    {
+        res[i - 1] = nearest.top();
+        nearest.pop();
+    }
+    return res;
+}
+
+///
+/// \brief HNSWIndex::Prune
+/// \param node
+/// \param level
+/// \param maxLinks
+///
+void HNSWIndex::Prune(int node, int level, size_t maxLinks)
+{
+    auto& links = m_links[node][level];
+    const float* nodeVec = Vector(node);
+    std::vector<DistNode> dists;
+    dists.reserve(links.size());
+    for (int neighbor : links)
+    {
+        dists.emplace_back(Dist(nodeVec, neighbor), neighbor);
+    }
+    std::nth_element(dists.begin(), dists.begin() + maxLinks, dists.end());
+    links.resize(maxLinks);
+    for (size_t i = 0; i < maxLinks; ++i)
+    {
+        links[i] = dists[i].second;
+    }
+}
+
+///
+/// \brief HNSWIndex::Add
+/// \param vec
+/// \param id
+/// \return
+///
+int HNSWIndex::Add(const float* vec, track_id_t id)
+{
+    const int node = static_cast<int>(m_ids.size());
+    m_vectors.insert(m_vectors.end(), vec, vec + m_dim);
+    m_ids.push_back(id);
+    m_removed.push_back(0);
+
+    std::uniform_real_distribution<double> uniform(std::numeric_limits<double>::min(), 1.);
+    const int level = static_cast<int>(-log(uniform(m_rng)) * m_levelMult);
+    m_links.emplace_back(level + 1);
+
+    if (m_entry < 0)
+    {
+        m_entry = node;
+        m_maxLevel = level;
+        return node;
+    }
+
+    // Greedy descent on the levels above the new node
+    std::vector<DistNode> entries(1, DistNode(Dist(vec, m_entry), m_entry));
+    for (int l = m_maxLevel; l > level; --l)
+    {
+        entries = SearchLayer(vec, entries, 1, l);
+    }
+
+    for (int l = std::min(level, m_maxLevel); l >= 0; --l)
+    {
+        entries = SearchLayer(vec, entries, static_cast<size_t>(m_efConstruction), l);
+
+        const size_t maxLinks = static_cast<size_t>((l == 0) ? 2 * m_M : m_M);
+        auto& links = m_links[node][l];
+        for (size_t i = 0, stop = std::min(entries.size(), static_cast<size_t>(m_M)); i < stop; ++i)
+        {
+            const int neighbor = entries[i].second;
+            links.push_back(neighbor);
+
+            auto& neighborLinks = m_links[neighbor][l];
+            neighborLinks.push_back(node);
+            if (neighborLinks.size() > maxLinks)
+                Prune(neighbor, l, maxLinks);
+        }
+    }
+
+    if (level > m_maxLevel)
+    {
+        m_entry = node;
+        m_maxLevel = level;
+    }
+    return node;
+}
+
+///
+/// \brief HNSWIndex::Search
+/// \param vec
+/// \param ef
+/// \param similarity
+/// \return
+///
+int HNSWIndex::Search(const float* vec, size_t ef, float& similarity) const
+{
+    if (m_entry < 0 || AliveCount() == 0)
+        return -1;
+
+    std::vector<DistNode> entries(1, DistNode(Dist(vec, m_entry), m_entry));
+    for (int l = m_maxLevel; l > 0; --l)
+    {
+        entries = SearchLayer(vec, entries, 1, l);
+    }
+    entries = SearchLayer(vec, entries, std::max<size_t>(ef, 1), 0);
+
+    for (const auto& entry : entries)
+    {
+        if (!m_removed[entry.second])
+        {
+            similarity = 1.f - entry.first;
+            return entry.second;
+        }
+    }
+    return -1;
+}
+
+///
+/// \brief HNSWIndex::Remove
+/// \param node
+///
+void HNSWIndex::Remove(int node)
+{
+    if (node >= 0 && node < static_cast<int>(m_removed.size()) && !m_removed[node])
+    {
+        m_removed[node] = 1;
+        ++m_removedCount;
+    }
+}
+
+///
+/// \brief ReIDGallery::ReIDGallery
+/// \param maxSize
+/// \param maxAge
+/// \param maxDist
+///
+ReIDGallery::ReIDGallery(size_t maxSize, double maxAge, track_t maxDist)
+{
+    SetParams(maxSize, maxAge, maxDist);
+}
+
+///
+/// \brief ReIDGallery::SetParams
+/// \param maxSize
+/// \param maxAge
+/// \param maxDist
+///
+void ReIDGallery::SetParams(size_t maxSize, double maxAge, track_t maxDist)
+{
+    m_maxSize = maxSize;
+    m_maxAge = maxAge;
+    m_maxDist = maxDist;
+
+    while (m_size > m_maxSize && !m_order.empty())
+    {
+        OrderItem item = m_order.front();
+        m_order.pop_front();
+        RemoveItem(item);
+    }
+}
+
+///
+/// \brief ReIDGallery::Normalize
+/// \param embedding
+/// \return
+///
+bool ReIDGallery::Normalize(const cv::Mat& embedding)
+{
+    if (embedding.empty())
+        return false;
+
+    cv::Mat emb32f;
+    (embedding.isContinuous() ? embedding : embedding.clone()).reshape(1, 1).convertTo(emb32f, CV_32F);
+    const double norm = cv::norm(emb32f);
+    if (norm < 1e-6)
+        return false;
+
+    m_query.resize(emb32f.total());
+    const float* ptr = emb32f.ptr<float>(0);
+    for (size_t i = 0; i < m_query.size(); ++i)
+    {
+        m_query[i] = static_cast<float>(ptr[i] / norm);
+    }
+    return true;
+}
+
+///
+/// \brief ReIDGallery::RemoveItem
+/// \param item
+///
+void ReIDGallery::RemoveItem(const OrderItem& item)
+{
+    auto it = m_indexes.find(item.m_type);
+    if (it == std::end(m_indexes) || item.m_node < 0 || it->second.IsRemoved(item.m_node))
+        return;
+
+    it->second.Remove(item.m_node);
+    --m_size;
+    if (it->second.RemovedCount() > it->second.AliveCount())
+        Rebuild(item.m_type);
+}
+
+///
+/// \brief ReIDGallery::Rebuild
+/// The graph of the alive nodes only, the order of the adding is kept
+/// \param type
+///
+void ReIDGallery::Rebuild(objtype_t type)
+{
+    HNSWIndex& index = m_indexes[type];
+    HNSWIndex newIndex(index.Dim());
+
+    std::deque<OrderItem> newOrder;
+    for (const auto& item : m_order)
+    {
+        if (item.m_type != type)
+        {
+            newOrder.push_back(item);
+        }
+        else if (!index.IsRemoved(item.m_node))
+        {
+            OrderItem newItem = item;
+            newItem.m_node = newIndex.Add(index.Vector(item.m_node), index.ID(item.m_node));
+            newOrder.push_back(newItem);
+        }
+    }
+    index = std::move(newIndex);
+    m_order.swap(newOrder);
+}
+
+///
+/// \brief ReIDGallery::Expire
+/// \param time
+///
+void ReIDGallery::Expire(double time)
+{
+    while (!m_order.empty() && time - m_order.front().m_time > m_maxAge)
+    {
+        OrderItem item = m_order.front();
+        m_order.pop_front();
+        RemoveItem(item);
+    }
+}
+
+///
+/// \brief ReIDGallery::Clear
+/// \param type
+///
+void ReIDGallery::Clear(objtype_t type)
+{
+    auto it = m_indexes.find(type);
+    if (it == std::end(m_indexes))
+        return;
+
+    m_size -= it->second.AliveCount();
+    m_indexes.erase(it);
+    m_order.erase(std::remove_if(std::begin(m_order), std::end(m_order), [type](const OrderItem& item) { return item.m_type == type; }), std::end(m_order));
+}
+
+///
+/// \brief ReIDGallery::Add
+/// \param id
+/// \param type
+/// \param embedding
+/// \param time
+///
+void ReIDGallery::Add(track_id_t id, objtype_t type, const cv::Mat& embedding, double time)
+{
+    if (!m_maxSize || !Normalize(embedding))
+        return;
+
+    Expire(time);
+
+    HNSWIndex& index = m_indexes[type];
+    if (index.Dim() != static_cast<int>(m_query.size()))
+    {
+        // The embeddings network of the type was changed: the old signatures are incomparable
+        m_size -= index.AliveCount();
+        m_order.erase(std::remove_if(m_order.begin(), m_order.end(), [type](const OrderItem& item) { return item.m_type == type; }), m_order.end());
+        index = HNSWIndex(static_cast<int>(m_query.size()));
+    }
+
+    OrderItem item;
+    item.m_type = type;
+    item.m_node = index.Add(m_query.data(), id);
+    item.m_time = time;
+    m_order.push_back(item);
+    ++m_size;
+
+    while (m_size > m_maxSize && !m_order.empty())
+    {
+        item = m_order.front();
+        m_order.pop_front();
+        RemoveItem(item);
+    }
+}
+
+///
+/// \brief ReIDGallery::Take
+/// \param embedding
+/// \param type
+/// \param time
+/// \param id
+/// \return
+///
+bool ReIDGallery::Take(const cv::Mat& embedding, objtype_t type, double time, track_id_t& id)
+{
+    Expire(time);
+
+    if (!m_size || !Normalize(embedding))
+        return false;
+
+    auto it = m_indexes.find(type);
+    if (it == std::end(m_indexes) || it->second.Dim() != static_cast<int>(m_query.size()))
+        return false;
+
+    float similarity = 0;
+    const int node = it->second.Search(m_query.data(), m_efSearch, similarity);
+    if (node < 0 || 1.f - 0.5f * similarity > m_maxDist)
+        return false;
+
+    id = it->second.ID(node);
+
+    // The item stays in the order queue and is skipped there as the removed one
+    OrderItem item;
+    item.m_type = type;
+    item.m_node = node;
+    RemoveItem(item);
+    return true;
+}
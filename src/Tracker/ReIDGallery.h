@@ -0,0 +1,186 @@
+#pragma once
+#include <deque>
+#include <map>
+#include <vector>
+#include <random>
+#include "defines.h"
+
+///
+/// \brief The HNSWIndex class
+/// Hierarchical navigable small world graph over the L2 normalized vectors with the cosine similarity.
+/// The removed nodes are marked and stay in the graph for the navigation until the index is rebuilt
+///
+class HNSWIndex
+{
+public:
+    ///
+    /// \brief HNSWIndex
+    /// \param dim - size of the vectors
+    /// \param M - links of the node on the upper levels, 2 * M on the level 0
+    /// \param efConstruction - candidates of the search while the adding
+    ///
+    HNSWIndex(int dim = 0, int M = 16, int efConstruction = 64);
+
+    ///
+    /// \brief Add
+    /// \param vec - normalized vector of Dim() values
+    /// \param id - payload of the node
+    /// \return Index of the node
+    ///
+    int Add(const float* vec, track_id_t id);
+
+    ///
+    /// \brief Search
+    /// \param vec - normalized vector of Dim() values
+    /// \param ef - candidates of the search on the level 0
+    /// \param similarity - cosine similarity of the found node
+    /// \return The nearest not removed node or -1
+    ///
+    int Search(const float* vec, size_t ef, float& similarity) const;
+
+    ///
+    void Remove(int node);
+    ///
+    bool IsRemoved(int node) const
+    {
+        return m_removed[node] != 0;
+    }
+    ///
+    track_id_t ID(int node) const
+    {
+        return m_ids[node];
+    }
+    ///
+    const float* Vector(int node) const
+    {
+        return m_vectors.data() + static_cast<size_t>(node) * m_dim;
+    }
+    ///
+    int Dim() const
+    {
+        return m_dim;
+    }
+    ///
+    size_t NodesCount() const
+    {
+        return m_ids.size();
+    }
+    ///
+    size_t AliveCount() const
+    {
+        return m_ids.size() - m_removedCount;
+    }
+    ///
+    size_t RemovedCount() const
+    {
+        return m_removedCount;
+    }
+
+private:
+    typedef std::pair<float, int> DistNode; // 1 - cosine similarity and the node
+
+    int m_dim = 0;
+    int m_M = 16;
+    int m_efConstruction = 64;
+    double m_levelMult = 0;
+
+    std::vector<float> m_vectors;
+    std::vector<track_id_t> m_ids;
+    std::vector<char> m_removed;
+    size_t m_removedCount = 0;
+    std::vector<std::vector<std::vector<int>>> m_links; // Neighbors of the every node on its levels
+    int m_entry = -1;
+    int m_maxLevel = -1;
+
+    mutable std::vector<unsigned> m_visited;
+    mutable unsigned m_visitEpoch = 0;
+
+    std::mt19937 m_rng{ 0x5eed };
+
+    float Dist(const float* vec, int node) const;
+    std::vector<DistNode> SearchLayer(const float* vec, const std::vector<DistNode>& entries, size_t ef, int level) const;
+    void Prune(int node, int level, size_t maxLinks);
+};
+
+///
+/// \brief The ReIDGallery class
+/// Re-ID signatures of the recently removed tracks. The new track takes the ID of the removed one with the close signature,
+/// so the reappeared object keeps its ID. Signatures are expired by the time and the oldest ones are evicted over the capacity.
+/// The search isn't linear in the gallery size: every object type has own HNSW index
+///
+class ReIDGallery
+{
+public:
+    ///
+    /// \brief ReIDGallery
+    /// \param maxSize - capacity of the gallery
+    /// \param maxAge - lifetime of the signature in seconds
+    /// \param maxDist - maximum distance 1 - 0.5 * cos as in CTrack::CalcCosine
+    ///
+    ReIDGallery(size_t maxSize, double maxAge, track_t maxDist);
+
+    ///
+    void SetParams(size_t maxSize, double maxAge, track_t maxDist);
+
+    ///
+    /// \brief Add
+    /// \param id - ID of the removed track
+    /// \param type
+    /// \param embedding - re-ID signature of the track, any float type
+    /// \param time - current time in seconds
+    ///
+    void Add(track_id_t id, objtype_t type, const cv::Mat& embedding, double time);
+
+    ///
+    /// \brief Take
+    /// Searches the signature of the same type and removes it from the gallery
+    /// \param embedding - embedding of the new region
+    /// \param type
+    /// \param time - current time in seconds
+    /// \param id - ID of the found track
+    /// \return true if the signature is closer than maxDist
+    ///
+    bool Take(const cv::Mat& embedding, objtype_t type, double time, track_id_t& id);
+
+    ///
+    /// \brief Expire
+    /// \param time - current time in seconds
+    ///
+    void Expire(double time);
+
+    ///
+    /// \brief Clear
+    /// Signatures of the type are dropped after the swap of its re-ID network to the incompatible one
+    /// \param type
+    ///
+    void Clear(objtype_t type);
+
+    ///
+    size_t Size() const
+    {
+        return m_size;
+    }
+
+private:
+    size_t m_maxSize = 0;
+    double m_maxAge = 0;
+    track_t m_maxDist = 0;
+    size_t m_efSearch = 48;
+
+    ///
+    struct OrderItem
+    {
+        objtype_t m_type = bad_type;
+        int m_node = -1;
+        double m_time = 0;
+    };
+    std::deque<OrderItem> m_order; // Signatures in the order of the adding
+    std::map<objtype_t, HNSWIndex> m_indexes;
+    size_t m_size = 0;
+
+    std::vector<float> m_query;
+
+    bool Normalize(const cv::Mat& embedding);
+    void RemoveItem(const OrderItem& item);
+    void Rebuild(objtype_t type);
+};
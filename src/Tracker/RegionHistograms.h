@@ -0,0 +1,122 @@
+#pragma once
+#include <vector>
+#include <array>
+#include <cmath>
+#include <algorithm>
+#include <opencv2/opencv.hpp>
+
+#include "execution_policy.h"
+
+///
+/// \brief The RegionHistograms class
+/// Color histograms of many regions of one frame. The frame is quantized once into the codes of the joint
+/// histogram bins and the histogram of a region is a single counting pass over its codes, so the overlapped
+/// regions don't repeat the quantization of the same pixels. Result is the same as cv::calcHist with
+/// the uniform bins in [0, 255) for all channels. Buffers are reused between the frames
+///
+class RegionHistograms
+{
+public:
+    static constexpr int Bins = 64;
+
+    RegionHistograms() = default;
+
+    ///
+    /// \brief Build
+    /// \param frame - 8-bit frame with 1 or 3 channels
+    ///
+    void Build(cv::UMat frame)
+    {
+        cv::Mat img = exec::MapToHost(frame, "RegionHistograms::Build");
+        CV_Assert(img.depth() == CV_8U && (img.channels() == 1 || img.channels() == 3));
+
+        m_channels = img.channels();
+        m_size = img.size();
+        m_codes.resize(static_cast<size_t>(m_size.width) * static_cast<size_t>(m_size.height));
+
+        // Value 255 is outside of the upper exclusive bound of the range as in cv::calcHist
+        std::array<int, 256> lut;
+        for (int v = 0; v < 255; ++v)
+        {
+            lut[v] = (v * Bins) / 255;
+        }
+        lut[255] = -1;
+
+        for (int y = 0; y < m_size.height; ++y)
+        {
+            const uchar* src = img.ptr<uchar>(y);
+            int* codes = &m_codes[static_cast<size_t>(y) * m_size.width];
+            if (m_channels == 1)
+            {
+                for (int x = 0; x < m_size.width; ++x)
+                {
+                    codes[x] = lut[src[x]];
+                }
+            }
+            else
+            {
+                for (int x = 0; x < m_size.width; ++x, src += 3)
+                {
+                    const int b0 = lut[src[0]];
+                    const int b1 = lut[src[1]];
+                    const int b2 = lut[src[2]];
+                    codes[x] = (b0 < 0 || b1 < 0 || b2 < 0) ? -1 : (b0 * Bins + b1) * Bins + b2;
+                }
+            }
+        }
+    }
+
+    ///
+    /// \brief Calc
+    /// \param rect - region, it's clipped by the frame
+    /// \param hist - CV_32F histogram in one row with the bins of cv::calcHist: Bins for 1 channel, Bins^3 for 3 channels
+    ///
+    void Calc(const cv::Rect& rect, cv::Mat& hist) const
+    {
+        hist.create(1, (m_channels == 1) ? Bins : (Bins * Bins * Bins), CV_32FC1);
+        hist.setTo(cv::Scalar::all(0));
+
+        float* bins = hist.ptr<float>();
+        const cv::Rect r = rect & cv::Rect(0, 0, m_size.width, m_size.height);
+        for (int y = r.y; y < r.y + r.height; ++y)
+        {
+            const int* codes = &m_codes[static_cast<size_t>(y) * m_size.width + r.x];
+            for (int x = 0; x < r.width; ++x)
+            {
+                if (codes[x] >= 0)
+                    ++bins[codes[x]];
+            }
+        }
+    }
+
+    ///
+    /// \brief SqrtNormalize
+    /// Square root of the histogram normalized to the unit sum in one row: the Bhattacharyya coefficient of two histograms
+    /// is the dot product of them, so the distances of all pairs are one matrix multiplication
+    /// \param hist - in place, CV_32F continuous 2D histogram
+    ///
+    static void SqrtNormalize(cv::Mat& hist)
+    {
+        if (hist.rows != 1)
+            hist = hist.reshape(1, 1);
+        const double sum = cv::sum(hist)[0];
+        if (sum > 0)
+            hist.convertTo(hist, CV_32F, 1. / sum);
+        cv::sqrt(hist, hist);
+    }
+
+    ///
+    /// \brief Bhattacharyya
+    /// \param dot - of two square rooted normalized histograms
+    /// \return Distance in [0, 1] like cv::HISTCMP_BHATTACHARYYA
+    ///
+    static float Bhattacharyya(double dot)
+    {
+        return static_cast<float>(std::sqrt(std::max(0., 1. - dot)));
+    }
+
+private:
+    int m_channels = 1;
+    cv::Size m_size;
+    std::vector<int> m_codes;
+};
@@ -0,0 +1,424 @@
+#include "ShardedTracker.h"
+#include "TrackIDAllocator.h"
+#include "task_scheduler.h"
+#include "trace_events.h"
+
+#include <iostream>
+#include <algorithm>
+
+///
+/// \brief ShardedTracker::ShardedTracker
+/// \param settings
+///
+ShardedTracker::ShardedTracker(const TrackerSettings& settings)
+    : m_cols(std::max(1, settings.m_shardsCols)), m_rows(std::max(1, settings.m_shardsRows)), m_overlap(std::max(0.f, settings.m_shardsOverlap)),
+      m_idAllocator(TrackIDAllocator::CreateAllocator(settings)),
+      m_publishSnapshots(settings.m_publishSnapshots), m_snapshotTail(settings.m_snapshotTail)
+{
+    m_shards.resize(static_cast<size_t>(m_cols * m_rows));
+    for (size_t i = 0; i < m_shards.size(); ++i)
+    {
+        m_shards[i].m_tracker = BaseTracker::CreateTracker(ShardSettings(settings, i));
+    }
+}
+
+///
+/// \brief ShardedTracker::ShardSettings
+/// The shards have the own IDs: they are mapped to the IDs of the allocator of the settings
+/// \param settings
+/// \param shardInd
+/// \return
+///
+TrackerSettings ShardedTracker::ShardSettings(const TrackerSettings& settings, size_t shardInd)
+{
+    TrackerSettings shardSettings = settings;
+    shardSettings.m_shardsCols = 1;
+    shardSettings.m_shardsRows = 1;
+    shardSettings.m_trackIDMode = tracking::IDLocal;
+    shardSettings.m_trackIDAllocator.reset();
+    shardSettings.m_checkpointFile.clear();
+    shardSettings.m_checkpointRestore = false;
+    shardSettings.m_flightRecorderSeconds = 0.f;
+    shardSettings.m_publishSnapshots = false;
+    shardSettings.m_bestCrops = false;
+    // The embeddings are calculated by the first shard, the others load the networks only for UpdateAt
+    if (shardInd > 0)
+        shardSettings.m_embeddingsLoading = 2;
+    return shardSettings;
+}
+
+///
+/// \brief ShardedTracker::ApplySettings
+/// The grid of the shards is kept
+/// \param settings
+///
+void ShardedTracker::ApplySettings(const TrackerSettings& settings)
+{
+    if (settings.m_shardsCols != m_cols || settings.m_shardsRows != m_rows)
+        std::cerr << "ShardedTracker::ApplySettings: the grid of the shards is applied only to the new tracker" << std::endl;
+    m_publishSnapshots.store(settings.m_publishSnapshots, std::memory_order_relaxed);
+    m_snapshotTail.store(settings.m_snapshotTail, std::memory_order_relaxed);
+    for (size_t i = 0; i < m_shards.size(); ++i)
+    {
+        m_shards[i].m_tracker->ApplySettings(ShardSettings(settings, i));
+    }
+}
+
+///
+/// \brief ShardedTracker::SplitFrame
+/// \param frameSize
+///
+void ShardedTracker::SplitFrame(cv::Size frameSize)
+{
+    if (frameSize == m_frameSize)
+        return;
+    m_frameSize = frameSize;
+
+    const cv::Rect frameRect(0, 0, frameSize.width, frameSize.height);
+    for (int r = 0; r < m_rows; ++r)
+    {
+        for (int c = 0; c < m_cols; ++c)
+        {
+            Shard& shard = m_shards[static_cast<size_t>(r * m_cols + c)];
+            const int x0 = (c * frameSize.width) / m_cols;
+            const int y0 = (r * frameSize.height) / m_rows;
+            const int x1 = ((c + 1) * frameSize.width) / m_cols;
+            const int y1 = ((r + 1) * frameSize.height) / m_rows;
+            shard.m_core = cv::Rect(x0, y0, x1 - x0, y1 - y0);
+
+            const int dx = cvRound(m_overlap * shard.m_core.width);
+            const int dy = cvRound(m_overlap * shard.m_core.height);
+            shard.m_area = cv::Rect(x0 - dx, y0 - dy, shard.m_core.width + 2 * dx, shard.m_core.height + 2 * dy) & frameRect;
+        }
+    }
+}
+
+///
+/// \brief ShardedTracker::OwnerShard
+/// \param pt
+/// \return Shard with the point in its core, the points out of the frame belong to the border shards
+///
+size_t ShardedTracker::OwnerShard(const cv::Point2f& pt) const
+{
+    const int c = std::max(0, std::min(m_cols - 1, static_cast<int>(pt.x * m_cols / std::max(1, m_frameSize.width))));
+    const int r = std::max(0, std::min(m_rows - 1, static_cast<int>(pt.y * m_rows / std::max(1, m_frameSize.height))));
+    return static_cast<size_t>(r * m_cols + c);
+}
+
+///
+/// \brief ShardedTracker::SplitRegions
+/// The region is given to the every shard with its center in the area, the regions out of the frame to their owners
+/// \param regions
+/// \param regionEmbeddings
+///
+void ShardedTracker::SplitRegions(const regions_t& regions, const std::vector<RegionEmbedding>* regionEmbeddings)
+{
+    for (auto& shard : m_shards)
+    {
+        shard.m_regions.clear();
+        shard.m_embeddings.clear();
+    }
+    for (size_t j = 0; j < regions.size(); ++j)
+    {
+        const cv::Point2f& center = regions[j].m_rrect.center;
+        const size_t owner = OwnerShard(center);
+        for (size_t i = 0; i < m_shards.size(); ++i)
+        {
+            Shard& shard = m_shards[i];
+            if (i != owner && !shard.m_area.contains(cv::Point(cvRound(center.x), cvRound(center.y))))
+                continue;
+            shard.m_regions.push_back(regions[j]);
+            if (regionEmbeddings)
+                shard.m_embeddings.push_back((*regionEmbeddings)[j]);
+        }
+    }
+}
+
+///
+/// \brief ShardedTracker::Update
+/// \param regions
+/// \param currFrame
+/// \param fps
+///
+void ShardedTracker::Update(const regions_t& regions, cv::UMat currFrame, float fps)
+{
+    std::vector<RegionEmbedding> regionEmbeddings;
+    CalcEmbeddings(regionEmbeddings, regions, currFrame);
+    Update(regions, regionEmbeddings, currFrame, fps);
+}
+
+///
+/// \brief ShardedTracker::Update
+/// \param regions
+/// \param regionEmbeddings
+/// \param currFrame
+/// \param fps
+///
+void ShardedTracker::Update(const regions_t& regions, const std::vector<RegionEmbedding>& regionEmbeddings, cv::UMat currFrame, float fps)
+{
+    TRACE_SPAN("sharded_update", "tracker");
+    SplitFrame(currFrame.size());
+    SplitRegions(regions, (regionEmbeddings.size() == regions.size()) ? &regionEmbeddings : nullptr);
+
+    // The shards get the whole frame: the tracks are in the frame coordinates
+    tasks::ParallelFor(0, static_cast<int>(m_shards.size()), [&](int i)
+    {
+        Shard& shard = m_shards[static_cast<size_t>(i)];
+        if (shard.m_embeddings.size() == shard.m_regions.size())
+            shard.m_tracker->Update(shard.m_regions, shard.m_embeddings, currFrame, fps);
+        else
+            shard.m_tracker->Update(shard.m_regions, currFrame, fps);
+        shard.m_tracker->GetTracks(shard.m_tracks);
+        shard.m_tracker->GetRemovedTracks(shard.m_removed);
+    }, 1);
+
+    MapGlobalIDs();
+    MergeTracks();
+    PublishMerged(-1.);
+}
+
+///
+/// \brief ShardedTracker::UpdateAt
+/// The shards calculate the embeddings of their regions
+/// \param regions
+/// \param currFrame
+/// \param timestamp
+///
+void ShardedTracker::UpdateAt(const regions_t& regions, cv::UMat currFrame, double timestamp)
+{
+    TRACE_SPAN("sharded_update", "tracker");
+    SplitFrame(currFrame.size());
+    SplitRegions(regions, nullptr);
+
+    tasks::ParallelFor(0, static_cast<int>(m_shards.size()), [&](int i)
+    {
+        Shard& shard = m_shards[static_cast<size_t>(i)];
+        shard.m_tracker->UpdateAt(shard.m_regions, currFrame, timestamp);
+        shard.m_tracker->GetTracks(shard.m_tracks);
+        shard.m_tracker->GetRemovedTracks(shard.m_removed);
+    }, 1);
+
+    MapGlobalIDs();
+    MergeTracks();
+    PublishMerged(timestamp);
+}
+
+///
+/// \brief ShardedTracker::MapGlobalIDs
+/// The new local track takes the global ID of the track of the other shard with the same object, else the new global ID.
+/// The global ID is removed with its last local track
+///
+void ShardedTracker::MapGlobalIDs()
+{
+    for (size_t s = 0; s < m_shards.size(); ++s)
+    {
+        Shard& shard = m_shards[s];
+        for (const auto& track : shard.m_tracks)
+        {
+            if (shard.m_globalIDs.find(track.m_ID) != std::end(shard.m_globalIDs))
+                continue;
+
+            const cv::Rect rect = track.m_rrect.boundingRect();
+            track_id_t globalID;
+            track_t bestIoU = HandoffIoU;
+            bool found = false;
+            for (size_t n = 0; n < m_shards.size(); ++n)
+            {
+                const Shard& neighbour = m_shards[n];
+                if (n == s || (neighbour.m_area & rect).empty())
+                    continue;
+                for (const auto& other : neighbour.m_tracks)
+                {
+                    auto otherID = neighbour.m_globalIDs.find(other.m_ID);
+                    if (otherID == std::end(neighbour.m_globalIDs) || shard.m_usedGlobalIDs.count(otherID->second))
+                        continue;
+                    const cv::Rect otherRect = other.m_rrect.boundingRect();
+                    const int inter = (rect & otherRect).area();
+                    if (!inter)
+                        continue;
+                    const track_t iou = static_cast<track_t>(inter) / static_cast<track_t>(rect.area() + otherRect.area() - inter);
+                    if (iou > bestIoU)
+                    {
+                        bestIoU = iou;
+                        globalID = otherID->second;
+                        found = true;
+                    }
+                }
+            }
+            if (!found)
+                globalID = m_idAllocator->NextID();
+            shard.m_globalIDs.emplace(track.m_ID, globalID);
+            shard.m_usedGlobalIDs.insert(globalID);
+            ++m_globalRefs[globalID];
+        }
+    }
+
+    m_removedObjects.clear();
+    for (auto& shard : m_shards)
+    {
+        for (const auto& localID : shard.m_removed)
+        {
+            auto it = shard.m_globalIDs.find(localID);
+            if (it == std::end(shard.m_globalIDs))
+                continue;
+            const track_id_t globalID = it->second;
+            shard.m_globalIDs.erase(it);
+            shard.m_usedGlobalIDs.erase(globalID);
+
+            auto ref = m_globalRefs.find(globalID);
+            if (ref != std::end(m_globalRefs) && --ref->second == 0)
+            {
+                m_globalRefs.erase(ref);
+                m_removedObjects.push_back(globalID);
+            }
+        }
+    }
+    if (m_deltaPolled)
+        m_removedSincePoll.insert(std::end(m_removedSincePoll), std::begin(m_removedObjects), std::end(m_removedObjects));
+}
+
+///
+/// \brief ShardedTracker::MergeTracks
+/// The owners of the tracks centers are first, then the tracks that are only in the overlap of the other shards
+///
+void ShardedTracker::MergeTracks()
+{
+    ++m_updatesCount;
+    m_tracks.clear();
+    m_mergedIDs.clear();
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        for (size_t s = 0; s < m_shards.size(); ++s)
+        {
+            const Shard& shard = m_shards[s];
+            for (const auto& track : shard.m_tracks)
+            {
+                if ((OwnerShard(track.m_rrect.center) == s) != (pass == 0))
+                    continue;
+                const track_id_t globalID = shard.m_globalIDs.at(track.m_ID);
+                if (!m_mergedIDs.insert(globalID).second)
+                    continue;
+                m_tracks.emplace_back(track);
+                m_tracks.back().m_ID = globalID;
+            }
+        }
+    }
+}
+
+///
+/// \brief ShardedTracker::PublishMerged
+/// \param timestamp
+///
+void ShardedTracker::PublishMerged(double timestamp)
+{
+    if (!m_publishSnapshots.load(std::memory_order_relaxed))
+        return;
+    TracksQuery query;
+    query.m_tailSize = m_snapshotTail.load(std::memory_order_relaxed);
+    PublishSnapshot(query, timestamp);
+}
+
+///
+/// \brief ShardedTracker::CalcEmbeddings
+/// \param regionEmbeddings
+/// \param regions
+/// \param currFrame
+///
+void ShardedTracker::CalcEmbeddings(std::vector<RegionEmbedding>& regionEmbeddings, const regions_t& regions, cv::UMat currFrame) const
+{
+    m_shards.front().m_tracker->CalcEmbeddings(regionEmbeddings, regions, currFrame);
+}
+
+///
+/// \brief ShardedTracker::CanGrayFrameToTrack
+/// \return
+///
+bool ShardedTracker::CanGrayFrameToTrack() const
+{
+    return m_shards.front().m_tracker->CanGrayFrameToTrack();
+}
+
+///
+/// \brief ShardedTracker::CanColorFrameToTrack
+/// \return
+///
+bool ShardedTracker::CanColorFrameToTrack() const
+{
+    return m_shards.front().m_tracker->CanColorFrameToTrack();
+}
+
+///
+/// \brief ShardedTracker::GetTracksCount
+/// \return
+///
+size_t ShardedTracker::GetTracksCount() const
+{
+    return m_tracks.size();
+}
+
+///
+/// \brief ShardedTracker::GetTracks
+/// \param tracks
+///
+void ShardedTracker::GetTracks(std::vector<TrackingObject>& tracks) const
+{
+    tracks.assign(std::begin(m_tracks), std::end(m_tracks));
+}
+
+///
+/// \brief ShardedTracker::GetRemovedTracks
+/// \param trackIDs
+///
+void ShardedTracker::GetRemovedTracks(std::vector<track_id_t>& trackIDs) const
+{
+    trackIDs.assign(std::begin(m_removedObjects), std::end(m_removedObjects));
+}
+
+///
+/// \brief ShardedTracker::GetTracksDelta
+/// The trajectory of the track after the handoff is of the new shard, so the tail is the points of the updates after the poll
+/// \param delta
+/// \param withTrajectory
+///
+void ShardedTracker::GetTracksDelta(TracksDelta& delta, bool withTrajectory)
+{
+    delta.Clear();
+
+    std::unordered_map<track_id_t, size_t> polledUpdates;
+    polledUpdates.reserve(m_tracks.size());
+    for (const auto& track : m_tracks)
+    {
+        auto polled = m_polledUpdates.find(track.m_ID);
+        const bool isNew = (polled == std::end(m_polledUpdates));
+        const size_t newPoints = isNew ? track.m_trace.size() : std::min(track.m_trace.size(), m_updatesCount - polled->second);
+
+        TrackingObject object = track;
+        object.m_trace = withTrajectory ? track.m_trace.Tail(newPoints) : Trace();
+        if (isNew)
+            delta.m_newTracks.emplace_back(std::move(object));
+        else
+            delta.m_updatedTracks.emplace_back(std::move(object));
+        polledUpdates.emplace(track.m_ID, m_updatesCount);
+    }
+    m_polledUpdates.swap(polledUpdates);
+
+    if (m_deltaPolled)
+        delta.m_removedTracks.swap(m_removedSincePoll);
+    else
+        m_deltaPolled = true;
+    m_removedSincePoll.clear();
+}
+
+///
+/// \brief ShardedTracker::MemoryBytes
+/// \return
+///
+size_t ShardedTracker::MemoryBytes() const
+{
+    size_t bytes = 0;
+    for (const auto& shard : m_shards)
+    {
+        bytes += shard.m_tracker->MemoryBytes();
+    }
+    return bytes;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <memory>
+#include <atomic>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "Ctracker.h"
+
+///
+/// \brief The ShardedTracker class
+/// Tracker of the huge view (8K, stitched panoramas) by the grid of the spatial shards: the frame is split on the cores
+/// of m_shardsCols x m_shardsRows, the every shard gets the regions with the center in its core expanded by m_shardsOverlap
+/// and it's updated by the own tracker in parallel with the others.
+/// The tracks of the shards have the local IDs, they are mapped to the global IDs: the new track of the shard takes the ID
+/// of the track of the other shard with the same object in the overlap (by IoU), so the track crosses the border with the same ID.
+/// The merged view has the track from the shard with its center in the core, or from the other shard if the owner hasn't it yet.
+/// The checkpoints, the flight recorder, the best crops and the events of the shards aren't supported
+///
+class ShardedTracker final : public BaseTracker
+{
+public:
+    ShardedTracker(const TrackerSettings& settings);
+    ShardedTracker(const ShardedTracker&) = delete;
+    ShardedTracker(ShardedTracker&&) = delete;
+    ShardedTracker& operator=(const ShardedTracker&) = delete;
+    ShardedTracker& operator=(ShardedTracker&&) = delete;
+
+    ~ShardedTracker(void) = default;
+
+    void Update(const regions_t& regions, cv::UMat currFrame, float fps) override;
+    void Update(const regions_t& regions, const std::vector<RegionEmbedding>& regionEmbeddings, cv::UMat currFrame, float fps) override;
+    void UpdateAt(const regions_t& regions, cv::UMat currFrame, double timestamp) override;
+    void CalcEmbeddings(std::vector<RegionEmbedding>& regionEmbeddings, const regions_t& regions, cv::UMat currFrame) const override;
+
+    bool CanGrayFrameToTrack() const override;
+    bool CanColorFrameToTrack() const override;
+    size_t GetTracksCount() const override;
+    void GetTracks(std::vector<TrackingObject>& tracks) const override;
+    void GetRemovedTracks(std::vector<track_id_t>& trackIDs) const override;
+    void GetTracksDelta(TracksDelta& delta, bool withTrajectory) override;
+    void ApplySettings(const TrackerSettings& settings) override;
+    size_t MemoryBytes() const override;
+
+private:
+    static constexpr track_t HandoffIoU = 0.3f; // Min IoU of the tracks of the same object in the overlap
+
+    int m_cols = 1;
+    int m_rows = 1;
+    float m_overlap = 0.1f;
+    cv::Size m_frameSize;
+
+    ///
+    /// \brief The Shard struct
+    ///
+    struct Shard
+    {
+        std::unique_ptr<BaseTracker> m_tracker;
+        cv::Rect m_core;
+        cv::Rect m_area;                                         // Core with the overlap
+        regions_t m_regions;
+        std::vector<RegionEmbedding> m_embeddings;
+        std::vector<TrackingObject> m_tracks;                    // Of the last Update with the local IDs
+        std::vector<track_id_t> m_removed;
+        std::unordered_map<track_id_t, track_id_t> m_globalIDs;  // Local -> global
+        std::unordered_set<track_id_t> m_usedGlobalIDs;
+    };
+    std::vector<Shard> m_shards;
+
+    std::shared_ptr<TrackIDAllocator> m_idAllocator;
+    std::unordered_map<track_id_t, size_t> m_globalRefs;  // Local tracks with the global ID
+    std::vector<TrackingObject> m_tracks;                 // Merged view with the global IDs
+    std::vector<track_id_t> m_removedObjects;
+
+    size_t m_updatesCount = 0;
+    bool m_deltaPolled = false;
+    std::vector<track_id_t> m_removedSincePoll;
+    std::unordered_map<track_id_t, size_t> m_polledUpdates; // Global ID -> update of the last poll
+
+    std::unordered_set<track_id_t> m_mergedIDs;
+
+    std::atomic<bool> m_publishSnapshots{ false };   // By ApplySettings from another thread
+    std::atomic<size_t> m_snapshotTail{ 0 };
+
+    static TrackerSettings ShardSettings(const TrackerSettings& settings, size_t shardInd);
+    void SplitFrame(cv::Size frameSize);
+    size_t OwnerShard(const cv::Point2f& pt) const;
+    void SplitRegions(const regions_t& regions, const std::vector<RegionEmbedding>* regionEmbeddings);
+    void MapGlobalIDs();
+    void MergeTracks();
+    void PublishMerged(double timestamp);
+};
@@ -0,0 +1,207 @@
+#include "ShmDetectionsRing.h"
+
+#include <new>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+
+///
+/// \brief ShmDetectionsRing::~ShmDetectionsRing
+///
+ShmDetectionsRing::~ShmDetectionsRing()
+{
+    Close();
+}
+
+///
+/// \brief ShmDetectionsRing::SlotBytes
+/// \param maxRegions
+/// \param embeddingDim
+/// \return Size of the slot aligned on the cache line
+///
+size_t ShmDetectionsRing::SlotBytes(uint32_t maxRegions, uint32_t embeddingDim)
+{
+    constexpr size_t CacheLine = 64;
+    const size_t bytes = sizeof(ShmRingSlot) + maxRegions * sizeof(mt_region_t) + static_cast<size_t>(maxRegions) * embeddingDim * sizeof(float);
+    return (bytes + CacheLine - 1) / CacheLine * CacheLine;
+}
+
+///
+/// \brief ShmDetectionsRing::Create
+/// \param name
+/// \param slots
+/// \param maxRegions
+/// \param embeddingDim
+/// \return
+///
+bool ShmDetectionsRing::Create(const std::string& name, uint32_t slots, uint32_t maxRegions, uint32_t embeddingDim)
+{
+    Close();
+    if (!slots || !maxRegions)
+    {
+        std::cerr << "ShmDetectionsRing::Create: empty ring " << name << std::endl;
+        return false;
+    }
+
+    const size_t slotBytes = SlotBytes(maxRegions, embeddingDim);
+    if (!m_mapping.Map(name, sizeof(ShmRingHeader) + slots * slotBytes, true))
+        return false;
+    m_header = reinterpret_cast<ShmRingHeader*>(m_mapping.Data());
+    m_slotBytes = slotBytes;
+
+    // The consumer checks the magic after the sizes: it's written the last
+    m_header->m_magic = 0;
+    m_header->m_version = MT_API_VERSION;
+    m_header->m_slots = slots;
+    m_header->m_maxRegions = maxRegions;
+    m_header->m_embeddingDim = embeddingDim;
+    m_header->m_reserved = 0;
+    new (&m_header->m_written) std::atomic<uint64_t>(0);
+    for (uint32_t i = 0; i < slots; ++i)
+    {
+        new (&Slot(i)->m_seq) std::atomic<uint64_t>(0);
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    reinterpret_cast<std::atomic<uint32_t>*>(&m_header->m_magic)->store(Magic, std::memory_order_release);
+    return true;
+}
+
+///
+/// \brief ShmDetectionsRing::Open
+/// \param name
+/// \return
+///
+bool ShmDetectionsRing::Open(const std::string& name)
+{
+    Close();
+    if (!m_mapping.Map(name, 0, false, sizeof(ShmRingHeader)))
+        return false;
+    m_header = reinterpret_cast<ShmRingHeader*>(m_mapping.Data());
+
+    if (reinterpret_cast<std::atomic<uint32_t>*>(&m_header->m_magic)->load(std::memory_order_acquire) != Magic ||
+        m_header->m_version != MT_API_VERSION ||
+        sizeof(ShmRingHeader) + m_header->m_slots * SlotBytes(m_header->m_maxRegions, m_header->m_embeddingDim) > m_mapping.Bytes())
+    {
+        std::cerr << "ShmDetectionsRing::Open: " << name << " isn't the detections ring of the version " << MT_API_VERSION << std::endl;
+        Close();
+        return false;
+    }
+    m_slotBytes = SlotBytes(m_header->m_maxRegions, m_header->m_embeddingDim);
+
+    const uint64_t written = m_header->m_written.load(std::memory_order_acquire);
+    m_readCursor = (written > m_header->m_slots) ? (written - m_header->m_slots) : 0;
+    return true;
+}
+
+///
+/// \brief ShmDetectionsRing::Close
+///
+void ShmDetectionsRing::Close()
+{
+    m_mapping.Close();
+    m_header = nullptr;
+    m_slotBytes = 0;
+    m_readCursor = 0;
+}
+
+///
+/// \brief ShmDetectionsRing::Remove
+/// \param name
+/// \return
+///
+bool ShmDetectionsRing::Remove(const std::string& name)
+{
+    return ShmMapping::Remove(name);
+}
+
+///
+/// \brief ShmDetectionsRing::Write
+/// \param frameIndex
+/// \param timestamp
+/// \param regions
+/// \param regionsCount
+/// \param embeddings
+/// \return
+///
+bool ShmDetectionsRing::Write(uint64_t frameIndex, double timestamp, const mt_region_t* regions, size_t regionsCount, const float* embeddings)
+{
+    if (!m_header || regionsCount > m_header->m_maxRegions || (regionsCount && !regions))
+        return false;
+
+    const uint64_t n = m_header->m_written.load(std::memory_order_relaxed);
+    ShmRingSlot* slot = Slot(n);
+    slot->m_seq.store(2 * n + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot->m_frameIndex = frameIndex;
+    slot->m_timestamp = timestamp;
+    slot->m_regionsCount = static_cast<uint32_t>(regionsCount);
+    slot->m_hasEmbeddings = (embeddings && m_header->m_embeddingDim) ? 1 : 0;
+
+    uint8_t* payload = reinterpret_cast<uint8_t*>(slot) + sizeof(ShmRingSlot);
+    if (regionsCount)
+        memcpy(payload, regions, regionsCount * sizeof(mt_region_t));
+    if (slot->m_hasEmbeddings && regionsCount)
+        memcpy(payload + m_header->m_maxRegions * sizeof(mt_region_t), embeddings, regionsCount * m_header->m_embeddingDim * sizeof(float));
+
+    slot->m_seq.store(2 * n + 2, std::memory_order_release);
+    m_header->m_written.store(n + 1, std::memory_order_release);
+    return true;
+}
+
+///
+/// \brief ShmDetectionsRing::Acquire
+/// \param view
+/// \param lapped
+/// \return
+///
+bool ShmDetectionsRing::Acquire(FrameView& view, bool& lapped)
+{
+    lapped = false;
+    if (!m_header)
+        return false;
+
+    for (;;)
+    {
+        const uint64_t written = m_header->m_written.load(std::memory_order_acquire);
+        if (m_readCursor >= written)
+            return false;
+        if (written - m_readCursor > m_header->m_slots)
+        {
+            m_readCursor = written - m_header->m_slots;
+            lapped = true;
+        }
+
+        const uint64_t n = m_readCursor++;
+        const ShmRingSlot* slot = Slot(n);
+        const uint64_t seq = slot->m_seq.load(std::memory_order_acquire);
+        if (seq != 2 * n + 2)
+        {
+            // The producer is already writing this slot: the next frames are newer
+            lapped = true;
+            continue;
+        }
+
+        const uint8_t* payload = reinterpret_cast<const uint8_t*>(slot) + sizeof(ShmRingSlot);
+        view.m_seq = seq;
+        view.m_frameIndex = slot->m_frameIndex;
+        view.m_timestamp = slot->m_timestamp;
+        view.m_regionsCount = std::min<size_t>(slot->m_regionsCount, m_header->m_maxRegions);
+        view.m_regions = reinterpret_cast<const mt_region_t*>(payload);
+        view.m_embeddingDim = m_header->m_embeddingDim;
+        view.m_embeddings = slot->m_hasEmbeddings ? reinterpret_cast<const float*>(payload + m_header->m_maxRegions * sizeof(mt_region_t)) : nullptr;
+        view.m_slot = slot;
+        return true;
+    }
+}
+
+///
+/// \brief ShmDetectionsRing::Validate
+/// \param view
+/// \return
+///
+bool ShmDetectionsRing::Validate(const FrameView& view) const
+{
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return view.m_slot && view.m_slot->m_seq.load(std::memory_order_relaxed) == view.m_seq;
+}
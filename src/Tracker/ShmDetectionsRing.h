@@ -0,0 +1,115 @@
+#pragma once
+#include <atomic>
+#include <string>
+#include <cstdint>
+
+#include "mtracking_c.h"
+#include "ShmMapping.h"
+
+///
+/// \brief The ShmDetectionsRing class
+/// Ring of the frames detections in the named shared memory with one producer and one consumer.
+/// Layout: ShmRingHeader, then the slots of SlotBytes(): ShmRingSlot, max_regions of mt_region_t, max_regions x embedding_dim floats.
+/// Every slot is the seqlock: the producer marks it odd before the writing and even after it,
+/// the consumer checks the sequence before and after the reading and doesn't block the producer
+///
+class ShmDetectionsRing
+{
+public:
+    static constexpr uint32_t Magic = 0x4d545231; // "MTR1"
+
+    ///
+    struct ShmRingHeader
+    {
+        uint32_t m_magic;
+        uint32_t m_version;
+        uint32_t m_slots;
+        uint32_t m_maxRegions;
+        uint32_t m_embeddingDim;
+        uint32_t m_reserved;
+        std::atomic<uint64_t> m_written; // Count of the published frames
+    };
+
+    ///
+    struct ShmRingSlot
+    {
+        std::atomic<uint64_t> m_seq;     // 2 * n + 1 while the frame n is written, 2 * n + 2 when it's published
+        uint64_t m_frameIndex;
+        double m_timestamp;
+        uint32_t m_regionsCount;
+        uint32_t m_hasEmbeddings;
+    };
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "Shared memory needs the lock free 64-bit atomics");
+
+    ///
+    /// \brief The FrameView struct
+    /// Frame in the slot of the shared memory without the copy
+    ///
+    struct FrameView
+    {
+        uint64_t m_seq = 0;
+        uint64_t m_frameIndex = 0;
+        double m_timestamp = 0;
+        const mt_region_t* m_regions = nullptr;
+        size_t m_regionsCount = 0;
+        const float* m_embeddings = nullptr; // nullptr without the embeddings
+        size_t m_embeddingDim = 0;
+        const ShmRingSlot* m_slot = nullptr;
+    };
+
+    ShmDetectionsRing() = default;
+    ~ShmDetectionsRing();
+
+    ShmDetectionsRing(const ShmDetectionsRing&) = delete;
+    ShmDetectionsRing& operator=(const ShmDetectionsRing&) = delete;
+
+    ///
+    bool Create(const std::string& name, uint32_t slots, uint32_t maxRegions, uint32_t embeddingDim);
+    ///
+    bool Open(const std::string& name);
+    ///
+    void Close();
+    ///
+    static bool Remove(const std::string& name);
+
+    ///
+    /// \brief Write
+    /// Producer side
+    ///
+    bool Write(uint64_t frameIndex, double timestamp, const mt_region_t* regions, size_t regionsCount, const float* embeddings);
+
+    ///
+    /// \brief Acquire
+    /// Consumer side: the next published frame
+    /// \param view - regions and embeddings in the shared memory
+    /// \param lapped - the unread frames were overwritten and skipped
+    /// \return false if there aren't the new frames
+    ///
+    bool Acquire(FrameView& view, bool& lapped);
+
+    ///
+    /// \brief Validate
+    /// \return true if the producer hasn't overwritten the slot of the view after Acquire
+    ///
+    bool Validate(const FrameView& view) const;
+
+    ///
+    uint32_t EmbeddingDim() const
+    {
+        return m_header ? m_header->m_embeddingDim : 0;
+    }
+
+private:
+    ShmMapping m_mapping;
+    ShmRingHeader* m_header = nullptr;
+    size_t m_slotBytes = 0;
+    uint64_t m_readCursor = 0;
+
+    static size_t SlotBytes(uint32_t maxRegions, uint32_t embeddingDim);
+
+    ShmRingSlot* Slot(uint64_t n) const
+    {
+        return reinterpret_cast<ShmRingSlot*>(m_mapping.Data() + sizeof(ShmRingHeader) + static_cast<size_t>(n % m_header->m_slots) * m_slotBytes);
+    }
+};
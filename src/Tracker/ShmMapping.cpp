@@ -0,0 +1,155 @@
+#include "ShmMapping.h"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace
+{
+#ifdef _WIN32
+///
+std::string MappingName(const std::string& name)
+{
+    return (!name.empty() && name[0] == '/') ? name.substr(1) : name;
+}
+#endif
+}
+
+///
+/// \brief ShmMapping::~ShmMapping
+///
+ShmMapping::~ShmMapping()
+{
+    Close();
+}
+
+///
+/// \brief ShmMapping::Map
+/// \param name
+/// \param bytes
+/// \param create
+/// \param minBytes
+/// \return
+///
+bool ShmMapping::Map(const std::string& name, size_t bytes, bool create, size_t minBytes)
+{
+    Close();
+#ifdef _WIN32
+    const std::string mappingName = MappingName(name);
+    if (create)
+    {
+        const uint64_t size = bytes;
+        m_mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                       static_cast<DWORD>(size >> 32), static_cast<DWORD>(size & 0xffffffff), mappingName.c_str());
+    }
+    else
+    {
+        m_mapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, mappingName.c_str());
+    }
+    if (!m_mapping)
+    {
+        std::cerr << "ShmMapping: file mapping " << name << " error " << GetLastError() << std::endl;
+        return false;
+    }
+    m_memory = static_cast<uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_ALL_ACCESS, 0, 0, bytes));
+    if (!m_memory)
+    {
+        std::cerr << "ShmMapping: map view of " << name << " error " << GetLastError() << std::endl;
+        CloseHandle(m_mapping);
+        m_mapping = nullptr;
+        return false;
+    }
+    if (!bytes)
+    {
+        MEMORY_BASIC_INFORMATION info;
+        VirtualQuery(m_memory, &info, sizeof(info));
+        bytes = info.RegionSize;
+        if (bytes < minBytes)
+        {
+            std::cerr << "ShmMapping: " << name << " is smaller than " << minBytes << " bytes" << std::endl;
+            UnmapViewOfFile(m_memory);
+            CloseHandle(m_mapping);
+            m_memory = nullptr;
+            m_mapping = nullptr;
+            return false;
+        }
+    }
+#else
+    const int fd = create ? shm_open(name.c_str(), O_CREAT | O_RDWR, 0666) : shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0)
+    {
+        std::cerr << "ShmMapping: shm_open " << name << " failed: " << strerror(errno) << std::endl;
+        return false;
+    }
+    if (create && ftruncate(fd, static_cast<off_t>(bytes)) != 0)
+    {
+        std::cerr << "ShmMapping: ftruncate " << name << " failed: " << strerror(errno) << std::endl;
+        close(fd);
+        return false;
+    }
+    if (!bytes)
+    {
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(minBytes) || st.st_size == 0)
+        {
+            std::cerr << "ShmMapping: " << name << " is smaller than " << minBytes << " bytes" << std::endl;
+            close(fd);
+            return false;
+        }
+        bytes = static_cast<size_t>(st.st_size);
+    }
+    void* memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED)
+    {
+        std::cerr << "ShmMapping: mmap " << name << " failed: " << strerror(errno) << std::endl;
+        return false;
+    }
+    m_memory = static_cast<uint8_t*>(memory);
+#endif
+    m_bytes = bytes;
+    return true;
+}
+
+///
+/// \brief ShmMapping::Close
+///
+void ShmMapping::Close()
+{
+    if (!m_memory)
+        return;
+#ifdef _WIN32
+    UnmapViewOfFile(m_memory);
+    CloseHandle(m_mapping);
+    m_mapping = nullptr;
+#else
+    munmap(m_memory, m_bytes);
+#endif
+    m_memory = nullptr;
+    m_bytes = 0;
+}
+
+///
+/// \brief ShmMapping::Remove
+/// \param name
+/// \return
+///
+bool ShmMapping::Remove(const std::string& name)
+{
+#ifdef _WIN32
+    // The mapping is destroyed with the last handle
+    (void)name;
+    return true;
+#else
+    return shm_unlink(name.c_str()) == 0;
+#endif
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <string>
+#include <cstdint>
+
+///
+/// \brief The ShmMapping class
+/// Named shared memory object mapped for the reading and the writing: shm_open + mmap or the file mapping on Windows.
+/// It's the storage of the rings of the detections and the tracks
+///
+class ShmMapping
+{
+public:
+    ShmMapping() = default;
+    ~ShmMapping();
+
+    ShmMapping(const ShmMapping&) = delete;
+    ShmMapping& operator=(const ShmMapping&) = delete;
+
+    ///
+    /// \brief Map
+    /// \param name - name of the shared memory object, for example "/mtracking_cam1"
+    /// \param bytes - size of the new object, 0 for the size of the existing one
+    /// \param create
+    /// \param minBytes - the existing object is rejected if it's smaller
+    /// \return
+    ///
+    bool Map(const std::string& name, size_t bytes, bool create, size_t minBytes = 0);
+    ///
+    void Close();
+    ///
+    /// \brief Remove
+    /// The object stays until the last mapping is closed
+    ///
+    static bool Remove(const std::string& name);
+
+    ///
+    uint8_t* Data() const
+    {
+        return m_memory;
+    }
+    ///
+    size_t Bytes() const
+    {
+        return m_bytes;
+    }
+
+private:
+    uint8_t* m_memory = nullptr;
+    size_t m_bytes = 0;
+
+#ifdef _WIN32
+    void* m_mapping = nullptr;
+#endif
+};
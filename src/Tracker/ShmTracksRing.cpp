@@ -0,0 +1,321 @@
+#include "ShmTracksRing.h"
+
+#include <new>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+
+///
+/// \brief ShmTracksRing::~ShmTracksRing
+///
+ShmTracksRing::~ShmTracksRing()
+{
+    Close();
+}
+
+///
+/// \brief ShmTracksRing::SlotBytes
+/// \param maxTracks
+/// \param maxRemoved
+/// \return Size of the slot aligned on the cache line
+///
+size_t ShmTracksRing::SlotBytes(uint32_t maxTracks, uint32_t maxRemoved)
+{
+    constexpr size_t CacheLine = 64;
+    const size_t bytes = sizeof(ShmTracksSlot) + maxTracks * sizeof(mt_track_t) + maxRemoved * sizeof(uint64_t);
+    return (bytes + CacheLine - 1) / CacheLine * CacheLine;
+}
+
+///
+/// \brief ShmTracksRing::Create
+/// \param name
+/// \param slots
+/// \param maxTracks
+/// \param maxRemoved
+/// \return
+///
+bool ShmTracksRing::Create(const std::string& name, uint32_t slots, uint32_t maxTracks, uint32_t maxRemoved)
+{
+    Close();
+    if (!slots || !maxTracks)
+    {
+        std::cerr << "ShmTracksRing::Create: empty ring " << name << std::endl;
+        return false;
+    }
+
+    const size_t slotBytes = SlotBytes(maxTracks, maxRemoved);
+    if (!m_mapping.Map(name, sizeof(ShmTracksHeader) + slots * slotBytes, true))
+        return false;
+    m_header = reinterpret_cast<ShmTracksHeader*>(m_mapping.Data());
+    m_slotBytes = slotBytes;
+
+    // The readers check the magic after the sizes: it's written the last
+    m_header->m_magic = 0;
+    m_header->m_version = MT_API_VERSION;
+    m_header->m_slots = slots;
+    m_header->m_maxTracks = maxTracks;
+    m_header->m_maxRemoved = maxRemoved;
+    m_header->m_reserved = 0;
+    new (&m_header->m_written) std::atomic<uint64_t>(0);
+    for (uint32_t i = 0; i < slots; ++i)
+    {
+        new (&Slot(i)->m_seq) std::atomic<uint64_t>(0);
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    reinterpret_cast<std::atomic<uint32_t>*>(&m_header->m_magic)->store(Magic, std::memory_order_release);
+    return true;
+}
+
+///
+/// \brief ShmTracksRing::Open
+/// The reading starts from the last published frame
+/// \param name
+/// \return
+///
+bool ShmTracksRing::Open(const std::string& name)
+{
+    Close();
+    if (!m_mapping.Map(name, 0, false, sizeof(ShmTracksHeader)))
+        return false;
+    m_header = reinterpret_cast<ShmTracksHeader*>(m_mapping.Data());
+
+    if (reinterpret_cast<std::atomic<uint32_t>*>(&m_header->m_magic)->load(std::memory_order_acquire) != Magic ||
+        m_header->m_version != MT_API_VERSION ||
+        sizeof(ShmTracksHeader) + m_header->m_slots * SlotBytes(m_header->m_maxTracks, m_header->m_maxRemoved) > m_mapping.Bytes())
+    {
+        std::cerr << "ShmTracksRing::Open: " << name << " isn't the tracks ring of the version " << MT_API_VERSION << std::endl;
+        Close();
+        return false;
+    }
+    m_slotBytes = SlotBytes(m_header->m_maxTracks, m_header->m_maxRemoved);
+
+    const uint64_t written = m_header->m_written.load(std::memory_order_acquire);
+    m_readCursor = written ? (written - 1) : 0;
+    return true;
+}
+
+///
+/// \brief ShmTracksRing::Close
+///
+void ShmTracksRing::Close()
+{
+    m_mapping.Close();
+    m_header = nullptr;
+    m_slotBytes = 0;
+    m_readCursor = 0;
+}
+
+///
+/// \brief ShmTracksRing::Remove
+/// \param name
+/// \return
+///
+bool ShmTracksRing::Remove(const std::string& name)
+{
+    return ShmMapping::Remove(name);
+}
+
+///
+/// \brief ShmTracksRing::BeginWrite
+/// \param frameIndex
+/// \param timestamp
+/// \return The slot marked as written
+///
+ShmTracksRing::ShmTracksSlot* ShmTracksRing::BeginWrite(uint64_t frameIndex, double timestamp)
+{
+    const uint64_t n = m_header->m_written.load(std::memory_order_relaxed);
+    ShmTracksSlot* slot = Slot(n);
+    slot->m_seq.store(2 * n + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot->m_frameIndex = frameIndex;
+    slot->m_timestamp = timestamp;
+    return slot;
+}
+
+///
+/// \brief ShmTracksRing::EndWrite
+/// \param slot
+///
+void ShmTracksRing::EndWrite(ShmTracksSlot* slot)
+{
+    const uint64_t n = m_header->m_written.load(std::memory_order_relaxed);
+    slot->m_seq.store(2 * n + 2, std::memory_order_release);
+    m_header->m_written.store(n + 1, std::memory_order_release);
+}
+
+///
+/// \brief ShmTracksRing::Write
+/// \param frameIndex
+/// \param timestamp
+/// \param tracks
+/// \param tracksCount
+/// \param removed
+/// \param removedCount
+/// \return
+///
+bool ShmTracksRing::Write(uint64_t frameIndex, double timestamp, const mt_track_t* tracks, size_t tracksCount, const uint64_t* removed, size_t removedCount)
+{
+    if (!m_header || (tracksCount && !tracks) || (removedCount && !removed))
+        return false;
+
+    ShmTracksSlot* slot = BeginWrite(frameIndex, timestamp);
+    slot->m_tracksTotal = static_cast<uint32_t>(tracksCount);
+    slot->m_removedTotal = static_cast<uint32_t>(removedCount);
+    slot->m_tracksCount = static_cast<uint32_t>(std::min<size_t>(tracksCount, m_header->m_maxTracks));
+    slot->m_removedCount = static_cast<uint32_t>(std::min<size_t>(removedCount, m_header->m_maxRemoved));
+    if (slot->m_tracksCount)
+        memcpy(Tracks(slot), tracks, slot->m_tracksCount * sizeof(mt_track_t));
+    if (slot->m_removedCount)
+        memcpy(Removed(slot), removed, slot->m_removedCount * sizeof(uint64_t));
+    EndWrite(slot);
+    return true;
+}
+
+///
+/// \brief ShmTracksRing::Publish
+/// \param frameIndex
+/// \param timestamp
+/// \param delta
+/// \return
+///
+bool ShmTracksRing::Publish(uint64_t frameIndex, double timestamp, const TracksDelta& delta)
+{
+    if (!m_header)
+        return false;
+
+    ShmTracksSlot* slot = BeginWrite(frameIndex, timestamp);
+    const size_t tracksTotal = delta.m_newTracks.size() + delta.m_updatedTracks.size();
+    slot->m_tracksTotal = static_cast<uint32_t>(tracksTotal);
+    slot->m_removedTotal = static_cast<uint32_t>(delta.m_removedTracks.size());
+    slot->m_tracksCount = static_cast<uint32_t>(std::min<size_t>(tracksTotal, m_header->m_maxTracks));
+    slot->m_removedCount = static_cast<uint32_t>(std::min<size_t>(delta.m_removedTracks.size(), m_header->m_maxRemoved));
+
+    mt_track_t* tracks = Tracks(slot);
+    const size_t newCount = std::min<size_t>(delta.m_newTracks.size(), slot->m_tracksCount);
+    for (size_t i = 0; i < newCount; ++i)
+    {
+        ToTrack(delta.m_newTracks[i], tracks[i], MT_TRACK_NEW);
+    }
+    for (size_t i = newCount; i < slot->m_tracksCount; ++i)
+    {
+        ToTrack(delta.m_updatedTracks[i - newCount], tracks[i]);
+    }
+    uint64_t* removed = Removed(slot);
+    for (size_t i = 0; i < slot->m_removedCount; ++i)
+    {
+        removed[i] = static_cast<uint64_t>(delta.m_removedTracks[i].m_val);
+    }
+    EndWrite(slot);
+    return true;
+}
+
+///
+/// \brief ShmTracksRing::ReadSlot
+/// \param n
+/// \param view
+/// \return false if the producer is already writing the slot
+///
+bool ShmTracksRing::ReadSlot(uint64_t n, FrameView& view) const
+{
+    const ShmTracksSlot* slot = Slot(n);
+    const uint64_t seq = slot->m_seq.load(std::memory_order_acquire);
+    if (seq != 2 * n + 2)
+        return false;
+
+    ShmTracksSlot* data = const_cast<ShmTracksSlot*>(slot);
+    view.m_seq = seq;
+    view.m_frameIndex = slot->m_frameIndex;
+    view.m_timestamp = slot->m_timestamp;
+    view.m_tracksCount = std::min<size_t>(slot->m_tracksCount, m_header->m_maxTracks);
+    view.m_tracks = Tracks(data);
+    view.m_removedCount = std::min<size_t>(slot->m_removedCount, m_header->m_maxRemoved);
+    view.m_removed = Removed(data);
+    view.m_truncated = slot->m_tracksTotal > slot->m_tracksCount || slot->m_removedTotal > slot->m_removedCount;
+    view.m_slot = slot;
+    return true;
+}
+
+///
+/// \brief ShmTracksRing::Acquire
+/// \param view
+/// \param lapped
+/// \return
+///
+bool ShmTracksRing::Acquire(FrameView& view, bool& lapped)
+{
+    lapped = false;
+    if (!m_header)
+        return false;
+
+    for (;;)
+    {
+        const uint64_t written = m_header->m_written.load(std::memory_order_acquire);
+        if (m_readCursor >= written)
+            return false;
+        if (written - m_readCursor > m_header->m_slots)
+        {
+            m_readCursor = written - m_header->m_slots;
+            lapped = true;
+        }
+
+        // The producer is already writing this slot: the next frames are newer
+        if (ReadSlot(m_readCursor++, view))
+            return true;
+        lapped = true;
+    }
+}
+
+///
+/// \brief ShmTracksRing::AcquireLatest
+/// \param view
+/// \return
+///
+bool ShmTracksRing::AcquireLatest(FrameView& view)
+{
+    if (!m_header)
+        return false;
+
+    for (;;)
+    {
+        const uint64_t written = m_header->m_written.load(std::memory_order_acquire);
+        if (m_readCursor >= written)
+            return false;
+        m_readCursor = written;
+        if (ReadSlot(written - 1, view))
+            return true;
+    }
+}
+
+///
+/// \brief ShmTracksRing::Validate
+/// \param view
+/// \return
+///
+bool ShmTracksRing::Validate(const FrameView& view) const
+{
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return view.m_slot && view.m_slot->m_seq.load(std::memory_order_relaxed) == view.m_seq;
+}
+
+///
+/// \brief ShmTracksRing::ToTrack
+/// \param obj
+/// \param track
+/// \param flags
+///
+void ShmTracksRing::ToTrack(const TrackingObject& obj, mt_track_t& track, uint32_t flags)
+{
+    track.id = static_cast<uint64_t>(obj.m_ID.m_val);
+    track.type = static_cast<int32_t>(obj.m_type);
+    track.confidence = obj.m_confidence;
+    track.center_x = obj.m_rrect.center.x;
+    track.center_y = obj.m_rrect.center.y;
+    track.width = obj.m_rrect.size.width;
+    track.height = obj.m_rrect.size.height;
+    track.angle = obj.m_rrect.angle;
+    track.velocity_x = static_cast<float>(obj.m_velocity[0]);
+    track.velocity_y = static_cast<float>(obj.m_velocity[1]);
+    track.flags = flags | (obj.m_isStatic ? MT_TRACK_STATIC : 0) | (obj.m_outOfTheFrame ? MT_TRACK_OUT_OF_FRAME : 0) |
+        ((obj.m_estimate != TrackingObject::Estimate::Detected) ? MT_TRACK_PREDICTED : 0);
+}
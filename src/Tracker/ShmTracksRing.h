@@ -0,0 +1,152 @@
+#pragma once
+#include <atomic>
+#include <string>
+#include <cstdint>
+
+#include "mtracking_c.h"
+#include "ShmMapping.h"
+#include "Ctracker.h"
+
+///
+/// \brief The ShmTracksRing class
+/// Ring of the tracking results in the named shared memory with one producer (the tracker) and any count of the readers.
+/// Layout: ShmTracksHeader, then the slots of SlotBytes(): ShmTracksSlot, max_tracks of mt_track_t, max_removed of uint64_t IDs.
+/// The slot is the frame: the all alive tracks (MT_TRACK_NEW marks the tracks created after the previous frame) and
+/// the tracks removed after the previous frame, so the reader gets the state or the delta from one slot.
+/// Every slot is the seqlock like in ShmDetectionsRing: the producer never waits for the readers, the slow reader
+/// is lapped and skips to the oldest alive frame. The readers have the own cursors and don't write to the shared memory
+///
+class ShmTracksRing
+{
+public:
+    static constexpr uint32_t Magic = 0x4d545431; // "MTT1"
+
+    ///
+    struct ShmTracksHeader
+    {
+        uint32_t m_magic;
+        uint32_t m_version;
+        uint32_t m_slots;
+        uint32_t m_maxTracks;
+        uint32_t m_maxRemoved;
+        uint32_t m_reserved;
+        std::atomic<uint64_t> m_written; // Count of the published frames
+    };
+
+    ///
+    struct ShmTracksSlot
+    {
+        std::atomic<uint64_t> m_seq;     // 2 * n + 1 while the frame n is written, 2 * n + 2 when it's published
+        uint64_t m_frameIndex;
+        double m_timestamp;
+        uint32_t m_tracksCount;
+        uint32_t m_removedCount;
+        uint32_t m_tracksTotal;          // Above m_tracksCount if the tracks didn't fit into the slot
+        uint32_t m_removedTotal;
+    };
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "Shared memory needs the lock free 64-bit atomics");
+
+    ///
+    /// \brief The FrameView struct
+    /// Frame in the slot of the shared memory without the copy
+    ///
+    struct FrameView
+    {
+        uint64_t m_seq = 0;
+        uint64_t m_frameIndex = 0;
+        double m_timestamp = 0;
+        const mt_track_t* m_tracks = nullptr;
+        size_t m_tracksCount = 0;
+        const uint64_t* m_removed = nullptr;
+        size_t m_removedCount = 0;
+        bool m_truncated = false;        // The tracks or the removed IDs were more than the capacity of the slot
+        const ShmTracksSlot* m_slot = nullptr;
+    };
+
+    ShmTracksRing() = default;
+    ~ShmTracksRing();
+
+    ShmTracksRing(const ShmTracksRing&) = delete;
+    ShmTracksRing& operator=(const ShmTracksRing&) = delete;
+
+    ///
+    bool Create(const std::string& name, uint32_t slots, uint32_t maxTracks, uint32_t maxRemoved);
+    ///
+    bool Open(const std::string& name);
+    ///
+    void Close();
+    ///
+    static bool Remove(const std::string& name);
+
+    ///
+    /// \brief Write
+    /// Producer side: the records above the capacity of the slot are dropped and the frame is marked as truncated
+    ///
+    bool Write(uint64_t frameIndex, double timestamp, const mt_track_t* tracks, size_t tracksCount, const uint64_t* removed, size_t removedCount);
+
+    ///
+    /// \brief Publish
+    /// Producer side: the tracks are converted in place in the slot without the intermediate copy
+    /// \param delta - of BaseTracker::GetTracksDelta, the new tracks get MT_TRACK_NEW
+    ///
+    bool Publish(uint64_t frameIndex, double timestamp, const TracksDelta& delta);
+
+    ///
+    /// \brief Acquire
+    /// Reader side: the next published frame
+    /// \param view - tracks and removed IDs in the shared memory
+    /// \param lapped - the unread frames were overwritten and skipped
+    /// \return false if there aren't the new frames
+    ///
+    bool Acquire(FrameView& view, bool& lapped);
+
+    ///
+    /// \brief AcquireLatest
+    /// Reader side: the last published frame, the older unread frames are skipped
+    /// \return false if there aren't the new frames
+    ///
+    bool AcquireLatest(FrameView& view);
+
+    ///
+    /// \brief Validate
+    /// \return true if the producer hasn't overwritten the slot of the view after Acquire
+    ///
+    bool Validate(const FrameView& view) const;
+
+    ///
+    /// \brief ToTrack
+    /// \param obj
+    /// \param track - record of the C API
+    /// \param flags - added to the flags of the object state
+    ///
+    static void ToTrack(const TrackingObject& obj, mt_track_t& track, uint32_t flags = 0);
+
+private:
+    ShmMapping m_mapping;
+    ShmTracksHeader* m_header = nullptr;
+    size_t m_slotBytes = 0;
+    uint64_t m_readCursor = 0;
+
+    static size_t SlotBytes(uint32_t maxTracks, uint32_t maxRemoved);
+
+    ShmTracksSlot* BeginWrite(uint64_t frameIndex, double timestamp);
+    void EndWrite(ShmTracksSlot* slot);
+    bool ReadSlot(uint64_t n, FrameView& view) const;
+
+    ///
+    ShmTracksSlot* Slot(uint64_t n) const
+    {
+        return reinterpret_cast<ShmTracksSlot*>(m_mapping.Data() + sizeof(ShmTracksHeader) + static_cast<size_t>(n % m_header->m_slots) * m_slotBytes);
+    }
+    ///
+    mt_track_t* Tracks(ShmTracksSlot* slot) const
+    {
+        return reinterpret_cast<mt_track_t*>(reinterpret_cast<uint8_t*>(slot) + sizeof(ShmTracksSlot));
+    }
+    ///
+    uint64_t* Removed(ShmTracksSlot* slot) const
+    {
+        return reinterpret_cast<uint64_t*>(reinterpret_cast<uint8_t*>(slot) + sizeof(ShmTracksSlot) + m_header->m_maxTracks * sizeof(mt_track_t));
+    }
+};
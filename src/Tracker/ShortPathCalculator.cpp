@@ -1,64 +1,641 @@
 #include "ShortPathCalculator.h"
+#include "metrics.h"
 
-#include <GTL/GTL.h>
-#include "mygraph.h"
-#include "mwbmatching.h"
-#include "tokenise.h"
+#include <array>
+#include <algorithm>
+#include <limits>
 
 ///
 /// \brief SPBipart::Solve
+/// Maximum weight matching by the successive shortest augmenting paths: every augmentation gives the best
+/// matching of the next size, so the search stops when the best path doesn't increase the total weight
 /// \param costMatrix
 /// \param N
 /// \param M
 /// \param assignment
 /// \param maxCost
+/// \param sparsePairs
 ///
-void SPBipart::Solve(const distMatrix_t& costMatrix, size_t N, size_t M, assignments_t& assignment, track_t maxCost)
+void SPBipart::Solve(const distMatrix_t& costMatrix, size_t N, size_t M, assignments_t& assignment, track_t maxCost, const SparsePairs* sparsePairs)
 {
-    MyGraph G;
-    G.make_directed();
+    assignment.assign(N, -1);
 
-    std::vector<GTL::node> nodes(N + M);
+    // CSR graph of the feasible pairs, edge cost is the negative weight
+    m_rowStart.assign(N + 1, 0);
+    m_edgeCols.clear();
+    m_edgeCosts.clear();
+    auto AddEdge = [&](size_t i, size_t j)
+    {
+        const track_t currCost = costMatrix(i, j);
+        if (currCost < m_settings.m_distThres)
+        {
+            m_edgeCols.push_back(static_cast<int>(j));
+            m_edgeCosts.push_back(currCost - maxCost - 1);
+        }
+    };
+    for (size_t i = 0; i < N; ++i)
+    {
+        if (sparsePairs)
+        {
+            // Only pairs after the spatial gating, all other pairs have forbidden cost
+            for (const int* j = sparsePairs->RowBegin(i); j != sparsePairs->RowEnd(i); ++j)
+            {
+                AddEdge(i, static_cast<size_t>(*j));
+            }
+        }
+        else
+        {
+            for (size_t j = 0; j < M; ++j)
+            {
+                AddEdge(i, j);
+            }
+        }
+        m_rowStart[i + 1] = static_cast<int>(m_edgeCols.size());
+    }
+    if (m_edgeCols.empty())
+        return;
+
+    m_colMatch.assign(M, -1);
+    m_rowMatchCost.assign(N, 0);
+    constexpr track_t inf = std::numeric_limits<track_t>::max();
+
+    for (;;)
+    {
+        // Bellman-Ford with the queue from all free tracks on the residual graph:
+        // track -> region by the free edge, region -> track by the matched edge with the opposite cost
+        m_rowDist.assign(N, inf);
+        m_colDist.assign(M, inf);
+        m_colPrev.assign(M, -1);
+        m_inQueue.assign(N, 0);
+        m_queue.clear();
+        for (size_t i = 0; i < N; ++i)
+        {
+            if (assignment[i] < 0 && m_rowStart[i] != m_rowStart[i + 1])
+            {
+                m_rowDist[i] = 0;
+                m_inQueue[i] = 1;
+                m_queue.push_back(static_cast<int>(i));
+            }
+        }
+        for (size_t qi = 0; qi < m_queue.size(); ++qi)
+        {
+            const int i = m_queue[qi];
+            m_inQueue[i] = 0;
+            for (int e = m_rowStart[i]; e < m_rowStart[i + 1]; ++e)
+            {
+                const int j = m_edgeCols[e];
+                if (assignment[i] == j)
+                    continue;
+
+                const track_t dist = m_rowDist[i] + m_edgeCosts[e];
+                if (dist < m_colDist[j])
+                {
+                    m_colDist[j] = dist;
+                    m_colPrev[j] = i;
+
+                    const int r = m_colMatch[j];
+                    if (r >= 0 && dist - m_rowMatchCost[r] < m_rowDist[r])
+                    {
+                        m_rowDist[r] = dist - m_rowMatchCost[r];
+                        if (!m_inQueue[r])
+                        {
+                            m_inQueue[r] = 1;
+                            m_queue.push_back(r);
+                        }
+                    }
+                }
+            }
+        }
+
+        // The best path to the free region
+        int bestCol = -1;
+        track_t bestDist = 0;
+        for (size_t j = 0; j < M; ++j)
+        {
+            if (m_colMatch[j] < 0 && m_colDist[j] < bestDist)
+            {
+                bestDist = m_colDist[j];
+                bestCol = static_cast<int>(j);
+            }
+        }
+        if (bestCol < 0)
+            break;
+
+        // Flip the alternating path
+        for (int j = bestCol; j >= 0;)
+        {
+            const int i = m_colPrev[j];
+            const int prevCol = assignment[i];
+            for (int e = m_rowStart[i]; e < m_rowStart[i + 1]; ++e)
+            {
+                if (m_edgeCols[e] == j)
+                {
+                    m_rowMatchCost[i] = m_edgeCosts[e];
+                    break;
+                }
+            }
+            assignment[i] = j;
+            m_colMatch[j] = i;
+            j = prevCol;
+        }
+    }
+}
+
+///
+/// \brief SPComponents::FindRoot
+/// \param node
+/// \return
+///
+int SPComponents::FindRoot(int node)
+{
+    while (m_parents[node] != node)
+    {
+        m_parents[node] = m_parents[m_parents[node]];
+        node = m_parents[node];
+    }
+    return node;
+}
+
+///
+/// \brief SPComponents::Solve
+/// \param costMatrix
+/// \param N
+/// \param M
+/// \param assignment
+/// \param maxCost
+/// \param sparsePairs
+///
+void SPComponents::Solve(const distMatrix_t& costMatrix, size_t N, size_t M, assignments_t& assignment, track_t maxCost, const SparsePairs* sparsePairs)
+{
+    assignment.assign(N, -1);
 
-    for (size_t i = 0; i < nodes.size(); ++i)
+    const size_t nodesCount = N + M;
+    m_parents.resize(nodesCount);
+    for (size_t i = 0; i < nodesCount; ++i)
     {
-        nodes[i] = G.new_node();
+        m_parents[i] = static_cast<int>(i);
     }
 
-	GTL::edge_map<int> weights(G, 100);
-    for (size_t i = 0; i < N; i++)
+    // Join track and region with feasible distance
+    auto Join = [&](size_t i, size_t j)
     {
-        bool hasZeroEdge = false;
+        if (costMatrix(i, j) < m_settings.m_distThres)
+        {
+            int r1 = FindRoot(static_cast<int>(i));
+            int r2 = FindRoot(static_cast<int>(N + j));
+            if (r1 != r2)
+                m_parents[r2] = r1;
+        }
+    };
+    if (sparsePairs)
+    {
+        for (size_t i = 0; i < N; ++i)
+        {
+            for (const int* j = sparsePairs->RowBegin(i); j != sparsePairs->RowEnd(i); ++j)
+            {
+                Join(i, static_cast<size_t>(*j));
+            }
+        }
+    }
+    else
+    {
+        for (size_t i = 0; i < N; ++i)
+        {
+            for (size_t j = 0; j < M; ++j)
+            {
+                Join(i, j);
+            }
+        }
+    }
+
+    // Group nodes by the components
+    constexpr size_t noComp = static_cast<size_t>(-1);
+    m_rootToComp.assign(nodesCount, noComp);
+    size_t compCount = 0;
+    for (size_t i = 0; i < nodesCount; ++i)
+    {
+        size_t root = static_cast<size_t>(FindRoot(static_cast<int>(i)));
+        m_parents[i] = static_cast<int>(root);
+        if (m_rootToComp[root] == noComp)
+            m_rootToComp[root] = compCount++;
+    }
+    m_compStart.assign(compCount + 1, 0);
+    for (size_t i = 0; i < nodesCount; ++i)
+    {
+        ++m_compStart[m_rootToComp[m_parents[i]] + 1];
+    }
+    for (size_t c = 1; c < m_compStart.size(); ++c)
+    {
+        m_compStart[c] += m_compStart[c - 1];
+    }
+    m_compNodes.resize(nodesCount);
+    m_fillPos.assign(std::begin(m_compStart), std::end(m_compStart) - 1);
+    for (size_t i = 0; i < nodesCount; ++i)
+    {
+        m_compNodes[m_fillPos[m_rootToComp[m_parents[i]]]++] = static_cast<int>(i);
+    }
+
+    // Solve every component
+    for (size_t c = 0; c < compCount; ++c)
+    {
+        m_subRows.clear();
+        m_subCols.clear();
+        for (size_t k = m_compStart[c]; k < m_compStart[c + 1]; ++k)
+        {
+            const int node = m_compNodes[k];
+            if (node < static_cast<int>(N))
+                m_subRows.push_back(node);
+            else
+                m_subCols.push_back(node - static_cast<int>(N));
+        }
+        if (m_subRows.empty() || m_subCols.empty())
+            continue;
+
+        if (m_subRows.size() == 1 || m_subCols.size() == 1)
+        {
+            // Star: only one pair can be assigned, choose the best
+            int bestRow = -1;
+            int bestCol = -1;
+            track_t bestCost = m_settings.m_distThres;
+            for (int i : m_subRows)
+            {
+                for (int j : m_subCols)
+                {
+                    track_t cost = costMatrix(i, j);
+                    if (cost < bestCost)
+                    {
+                        bestCost = cost;
+                        bestRow = i;
+                        bestCol = j;
+                    }
+                }
+            }
+            if (bestRow >= 0)
+                assignment[bestRow] = bestCol;
+            continue;
+        }
 
-        for (size_t j = 0; j < M; j++)
+        const size_t subN = m_subRows.size();
+        const size_t subM = m_subCols.size();
+        m_subMatrix.Resize(subN, subM);
+        for (size_t i = 0; i < subN; ++i)
         {
-            track_t currCost = costMatrix[i + j * N];
+            const track_t* costRow = costMatrix.Row(m_subRows[i]);
+            track_t* subRow = m_subMatrix.Row(i);
+            for (size_t j = 0; j < subM; ++j)
+            {
+                subRow[j] = costRow[m_subCols[j]];
+            }
+        }
+        m_subAssignment.assign(subN, -1);
+        m_solver->Solve(m_subMatrix, subN, subM, m_subAssignment, maxCost, nullptr);
+        for (size_t i = 0; i < subN; ++i)
+        {
+            if (m_subAssignment[i] >= 0)
+                assignment[m_subRows[i]] = m_subCols[m_subAssignment[i]];
+        }
+    }
+}
 
-			GTL::edge e = G.new_edge(nodes[i], nodes[N + j]);
+///
+/// \brief SPGreedy::Solve
+/// \param costMatrix
+/// \param N
+/// \param M
+/// \param assignment
+/// \param maxCost
+/// \param sparsePairs
+///
+void SPGreedy::Solve(const distMatrix_t& costMatrix, size_t N, size_t M, assignments_t& assignment, track_t maxCost, const SparsePairs* sparsePairs)
+{
+    assignment.assign(N, -1);
 
-            if (currCost < m_settings.m_distThres)
+    // Feasible pairs and count of the candidates for every track and region
+    m_pairs.clear();
+    m_rowCandidates.assign(N, 0);
+    m_colCandidates.assign(M, 0);
+    auto AddPair = [&](size_t i, size_t j)
+    {
+        const track_t cost = costMatrix(i, j);
+        if (cost < m_settings.m_distThres)
+        {
+            m_pairs.push_back({ cost, static_cast<int>(i), static_cast<int>(j) });
+            ++m_rowCandidates[i];
+            ++m_colCandidates[j];
+        }
+    };
+    if (sparsePairs)
+    {
+        for (size_t i = 0; i < N; ++i)
+        {
+            for (const int* j = sparsePairs->RowBegin(i); j != sparsePairs->RowEnd(i); ++j)
             {
-                int weight = static_cast<int>(maxCost - currCost + 1);
-                G.set_edge_weight(e, weight);
-                weights[e] = weight;
+                AddPair(i, static_cast<size_t>(*j));
+            }
+        }
+    }
+    else
+    {
+        for (size_t i = 0; i < N; ++i)
+        {
+            for (size_t j = 0; j < M; ++j)
+            {
+                AddPair(i, j);
+            }
+        }
+    }
+
+    // The star components: one track with the own regions or one region with the own tracks
+    m_rowStar.assign(N, 1);
+    m_colStar.assign(M, 1);
+    for (const auto& pair : m_pairs)
+    {
+        if (m_colCandidates[pair.m_col] > 1)
+            m_rowStar[pair.m_row] = 0;
+        if (m_rowCandidates[pair.m_row] > 1)
+            m_colStar[pair.m_col] = 0;
+    }
+
+    // Greedy for the stars, pairs of the ambiguous clusters are collected for the solver
+    m_greedyPairs.clear();
+    m_subRows.clear();
+    m_subCols.clear();
+    m_rowToSub.assign(N, -1);
+    m_colToSub.assign(M, -1);
+    for (const auto& pair : m_pairs)
+    {
+        if (m_rowStar[pair.m_row] || m_colStar[pair.m_col])
+        {
+            m_greedyPairs.push_back(pair);
+            continue;
+        }
+        if (m_rowToSub[pair.m_row] < 0)
+        {
+            m_rowToSub[pair.m_row] = static_cast<int>(m_subRows.size());
+            m_subRows.push_back(pair.m_row);
+        }
+        if (m_colToSub[pair.m_col] < 0)
+        {
+            m_colToSub[pair.m_col] = static_cast<int>(m_subCols.size());
+            m_subCols.push_back(pair.m_col);
+        }
+    }
+
+    std::sort(std::begin(m_greedyPairs), std::end(m_greedyPairs), [](const Pair& p1, const Pair& p2) { return p1.m_cost < p2.m_cost; });
+    m_colUsed.assign(M, 0);
+    for (const auto& pair : m_greedyPairs)
+    {
+        if (assignment[pair.m_row] < 0 && !m_colUsed[pair.m_col])
+        {
+            assignment[pair.m_row] = pair.m_col;
+            m_colUsed[pair.m_col] = 1;
+        }
+    }
+
+    if (m_subRows.empty())
+        return;
+
+    // Ambiguous clusters don't share the tracks and regions with the stars
+    const size_t subN = m_subRows.size();
+    const size_t subM = m_subCols.size();
+    m_subMatrix.Resize(subN, subM);
+    for (size_t i = 0; i < subN; ++i)
+    {
+        const track_t* costRow = costMatrix.Row(m_subRows[i]);
+        track_t* subRow = m_subMatrix.Row(i);
+        for (size_t j = 0; j < subM; ++j)
+        {
+            subRow[j] = costRow[m_subCols[j]];
+        }
+    }
+    m_subAssignment.assign(subN, -1);
+    m_solver->Solve(m_subMatrix, subN, subM, m_subAssignment, maxCost, nullptr);
+    for (size_t i = 0; i < subN; ++i)
+    {
+        if (m_subAssignment[i] >= 0)
+            assignment[m_subRows[i]] = m_subCols[m_subAssignment[i]];
+    }
+}
+
+///
+/// \brief SPLAPJV::Solve
+/// \param costMatrix
+/// \param N
+/// \param M
+/// \param assignment
+/// \param sparsePairs
+///
+void SPLAPJV::Solve(const distMatrix_t& costMatrix, size_t N, size_t M, assignments_t& assignment, track_t /*maxCost*/, const SparsePairs* sparsePairs)
+{
+    const bool hasIDs = (m_trackIDs.size() == N);
+
+    // The region of the previous frame isn't known here: the hint is the nearest feasible region of the matched track
+    const assignments_t* warmStart = nullptr;
+    if (hasIDs && !m_prevMatched.empty())
+    {
+        m_warmStart.assign(N, -1);
+        for (size_t i = 0; i < N; ++i)
+        {
+            if (m_prevMatched.find(m_trackIDs[i]) == std::end(m_prevMatched))
+                continue;
+
+            track_t minDist = m_settings.m_distThres;
+            auto Check = [&](size_t j)
+            {
+                const track_t dist = costMatrix(i, j);
+                if (dist < minDist)
+                {
+                    minDist = dist;
+                    m_warmStart[i] = static_cast<int>(j);
+                }
+            };
+            if (sparsePairs)
+            {
+                for (const int* j = sparsePairs->RowBegin(i); j != sparsePairs->RowEnd(i); ++j)
+                {
+                    Check(static_cast<size_t>(*j));
+                }
             }
             else
             {
-                if (!hasZeroEdge)
+                for (size_t j = 0; j < M; ++j)
                 {
-                    G.set_edge_weight(e, 0);
-                    weights[e] = 0;
+                    Check(j);
                 }
-                hasZeroEdge = true;
             }
         }
+        warmStart = &m_warmStart;
+    }
+
+    m_solver.Solve(costMatrix, N, M, assignment, m_settings.m_distThres, warmStart);
+
+    m_prevMatched.clear();
+    if (hasIDs)
+    {
+        for (size_t i = 0; i < N; ++i)
+        {
+            if (assignment[i] >= 0)
+                m_prevMatched.insert(m_trackIDs[i]);
+        }
     }
+    m_trackIDs.clear();
+}
+
+///
+/// \brief SPAdaptive::SPAdaptive
+/// \param settings
+///
+SPAdaptive::SPAdaptive(const SPSettings& settings)
+    : SPAdaptive(settings, Thresholds())
+{
+}
+
+///
+/// \brief SPAdaptive::SPAdaptive
+/// \param settings
+/// \param thresholds
+///
+SPAdaptive::SPAdaptive(const SPSettings& settings, const Thresholds& thresholds)
+    : ShortPathCalculator(settings),
+      m_thresholds(thresholds),
+      m_munkres(settings),
+      m_greedy(settings, std::make_unique<SPHungrian>(settings)),
+      m_components(settings, std::make_unique<SPLAPJV>(settings)),
+      m_lapjv(settings)
+{
+}
+
+///
+/// \brief SPAdaptive::ChoiceName
+/// \param choice
+/// \return
+///
+const char* SPAdaptive::ChoiceName(Choice choice)
+{
+    static const char* names[] = { "empty", "munkres", "greedy", "components", "lapjv", "suboptimal" };
+    return (choice < Choice::ChoicesCount) ? names[static_cast<size_t>(choice)] : "?";
+}
+
+///
+/// \brief SPAdaptive::Choose
+/// \param costMatrix
+/// \param N
+/// \param M
+/// \param sparsePairs
+/// \return The cheapest solver with the optimal result for the matrix or the suboptimal one for the huge matrix
+///
+SPAdaptive::Choice SPAdaptive::Choose(const distMatrix_t& costMatrix, size_t N, size_t M, const SparsePairs* sparsePairs)
+{
+    m_pairRows.clear();
+    m_pairCols.clear();
+    m_rowCandidates.assign(N, 0);
+    m_colCandidates.assign(M, 0);
+    auto AddPair = [&](size_t i, size_t j)
+    {
+        if (costMatrix(i, j) < m_settings.m_distThres)
+        {
+            m_pairRows.push_back(static_cast<int>(i));
+            m_pairCols.push_back(static_cast<int>(j));
+            ++m_rowCandidates[i];
+            ++m_colCandidates[j];
+        }
+    };
+    for (size_t i = 0; i < N; ++i)
+    {
+        if (sparsePairs)
+        {
+            for (const int* j = sparsePairs->RowBegin(i); j != sparsePairs->RowEnd(i); ++j)
+            {
+                AddPair(i, static_cast<size_t>(*j));
+            }
+        }
+        else
+        {
+            for (size_t j = 0; j < M; ++j)
+            {
+                AddPair(i, j);
+            }
+        }
+    }
+    if (m_pairRows.empty())
+        return Choice::Empty;
+
+    const size_t cells = N * M;
+    if (cells <= m_thresholds.m_smallCells)
+        return Choice::Munkres;
+
+    // Greedy is optimal if every pair has the exclusive track or the exclusive region
+    bool ambiguous = false;
+    for (size_t k = 0; k < m_pairRows.size() && !ambiguous; ++k)
+    {
+        ambiguous = m_rowCandidates[m_pairRows[k]] > 1 && m_colCandidates[m_pairCols[k]] > 1;
+    }
+    if (!ambiguous)
+        return Choice::Greedy;
+
+    if (m_thresholds.m_suboptimalCells && cells >= m_thresholds.m_suboptimalCells)
+        return Choice::Suboptimal;
+
+    if (static_cast<track_t>(m_pairRows.size()) < m_thresholds.m_sparseDensity * static_cast<track_t>(cells))
+        return Choice::Components;
+
+    return Choice::LAPJV;
+}
+
+///
+/// \brief SPAdaptive::Solve
+/// \param costMatrix
+/// \param N
+/// \param M
+/// \param assignment
+/// \param maxCost
+/// \param sparsePairs
+///
+void SPAdaptive::Solve(const distMatrix_t& costMatrix, size_t N, size_t M, assignments_t& assignment, track_t maxCost, const SparsePairs* sparsePairs)
+{
+    // The metrics of the all trackers are shared
+    struct ChoiceMetrics
+    {
+        std::array<metrics::Counter*, static_cast<size_t>(Choice::ChoicesCount)> m_decisions;
+        std::array<metrics::Histogram*, static_cast<size_t>(Choice::ChoicesCount)> m_times;
+
+        ChoiceMetrics()
+        {
+            for (size_t i = 0; i < m_decisions.size(); ++i)
+            {
+                const std::string label = std::string("{solver=\"") + ChoiceName(static_cast<Choice>(i)) + "\"}";
+                m_decisions[i] = &metrics::Registry::Instance().GetCounter("mtracker_assignment_solver_total" + label, "Assignment problems by the solver chosen by MatchAuto");
+                m_times[i] = &metrics::Registry::Instance().GetHistogram("mtracker_assignment_solver_seconds" + label, "Time of the assignment by the solver chosen by MatchAuto, with the choice");
+            }
+        }
+    };
+    static ChoiceMetrics choiceMetrics;
 
-	GTL::edges_t L = MAX_WEIGHT_BIPARTITE_MATCHING(G, weights);
-    for (GTL::edges_t::iterator it = L.begin(); it != L.end(); ++it)
+    const auto start = std::chrono::steady_clock::now();
+    m_lastChoice = Choose(costMatrix, N, M, sparsePairs);
+    switch (m_lastChoice)
     {
-        GTL::node a = it->source();
-        GTL::node b = it->target();
-        assignment[b.id()] = static_cast<assignments_t::value_type>(a.id() - N);
+    case Choice::Empty:
+        assignment.assign(N, -1);
+        break;
+    case Choice::Munkres:
+        m_munkres.Solve(costMatrix, N, M, assignment, maxCost, sparsePairs);
+        break;
+    case Choice::Greedy:
+        m_greedy.Solve(costMatrix, N, M, assignment, maxCost, sparsePairs);
+        break;
+    case Choice::Components:
+        m_components.Solve(costMatrix, N, M, assignment, maxCost, sparsePairs);
+        break;
+    case Choice::LAPJV:
+        m_lapjv.Solve(costMatrix, N, M, assignment, maxCost, sparsePairs);
+        break;
+    case Choice::Suboptimal:
+    case Choice::ChoicesCount:
+        m_suboptimal.Solve(costMatrix, N, M, assignment, AssignmentProblemSolver::many_forbidden_assignments);
+        break;
     }
+    const size_t ind = static_cast<size_t>(m_lastChoice);
+    choiceMetrics.m_decisions[ind]->Add();
+    choiceMetrics.m_times[ind]->Observe(std::chrono::steady_clock::now() - start);
 }
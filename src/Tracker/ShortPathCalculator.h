@@ -1,6 +1,9 @@
 #pragma once
+#include <memory>
+#include <unordered_set>
 #include "defines.h"
 #include "HungarianAlg/HungarianAlg.h"
+#include "LAPJV/LAPJV.h"
 
 ///
 /// \brief The SPSettings struct
@@ -23,7 +26,25 @@ public:
     }
     virtual ~ShortPathCalculator() = default;
 
-    virtual void Solve(const distMatrix_t& costMatrix, size_t N, size_t M, assignments_t& assignment, track_t maxCost) = 0;
+    ///
+    /// \brief Solve
+    /// \param costMatrix - dense N x M matrix, pairs that are not in sparsePairs have forbidden cost
+    /// \param N - tracks count
+    /// \param M - regions count
+    /// \param assignment
+    /// \param maxCost
+    /// \param sparsePairs - pairs after the spatial gating or nullptr if all pairs are calculated
+    ///
+    virtual void Solve(const distMatrix_t& costMatrix, size_t N, size_t M, assignments_t& assignment, track_t maxCost, const SparsePairs* sparsePairs) = 0;
+
+    ///
+    /// \brief SetTrackIDs
+    /// IDs of the tracks in the rows of the next Solve, the solvers with the warm start keep the previous solution by them
+    /// \param ids
+    ///
+    virtual void SetTrackIDs(const std::vector<track_id_t>& /*ids*/)
+    {
+    }
 
 protected:
     SPSettings m_settings;
@@ -40,7 +61,7 @@ public:
     {
     }
 
-    void Solve(const distMatrix_t& costMatrix, size_t N, size_t M, assignments_t& assignment, track_t /*maxCost*/) override
+    void Solve(const distMatrix_t& costMatrix, size_t N, size_t M, assignments_t& assignment, track_t /*maxCost*/, const SparsePairs* /*sparsePairs*/) override
     {
         m_solver.Solve(costMatrix, N, M, assignment, AssignmentProblemSolver::optimal);
     }
@@ -51,6 +72,7 @@ private:
 
 ///
 /// \brief The SPBipart class
+/// Maximum weight bipartite matching on the feasible pairs with the weight maxCost - distance + 1
 ///
 class SPBipart final : public ShortPathCalculator
 {
@@ -60,5 +82,194 @@ public:
     {
     }
 
-    void Solve(const distMatrix_t& costMatrix, size_t N, size_t M, assignments_t& assignment, track_t maxCost) override;
+    void Solve(const distMatrix_t& costMatrix, size_t N, size_t M, assignments_t& assignment, track_t maxCost, const SparsePairs* sparsePairs) override;
+
+private:
+    // Graph of the feasible pairs and the search buffers are reused between the frames
+    std::vector<int> m_rowStart;
+    std::vector<int> m_edgeCols;
+    std::vector<track_t> m_edgeCosts;
+    std::vector<int> m_colMatch;
+    std::vector<track_t> m_rowMatchCost;
+    std::vector<track_t> m_rowDist;
+    std::vector<track_t> m_colDist;
+    std::vector<int> m_colPrev;
+    std::vector<char> m_inQueue;
+    std::vector<int> m_queue;
+};
+
+///
+/// \brief The SPComponents class
+/// Splits the bipartite graph of the feasible pairs (distance < m_distThres) on the connected components.
+/// Trivial components are resolved directly, all other are solved by the inner calculator independently
+///
+class SPComponents final : public ShortPathCalculator
+{
+public:
+    SPComponents(const SPSettings& settings, std::unique_ptr<ShortPathCalculator> solver)
+        : ShortPathCalculator(settings), m_solver(std::move(solver))
+    {
+    }
+
+    void Solve(const distMatrix_t& costMatrix, size_t N, size_t M, assignments_t& assignment, track_t maxCost, const SparsePairs* sparsePairs) override;
+
+private:
+    std::unique_ptr<ShortPathCalculator> m_solver;
+
+    std::vector<int> m_parents;         // Union-find: tracks in [0, N), regions in [N, N + M)
+    std::vector<size_t> m_compStart;    // Nodes grouped by the components
+    std::vector<int> m_compNodes;
+    std::vector<size_t> m_fillPos;
+    std::vector<size_t> m_rootToComp;
+    distMatrix_t m_subMatrix;
+    assignments_t m_subAssignment;
+    std::vector<int> m_subRows;
+    std::vector<int> m_subCols;
+
+    int FindRoot(int node);
+};
+
+///
+/// \brief The SPGreedy class
+/// Greedy matching on the sorted feasible pairs (distance < m_distThres). Greedy is optimal if the track has
+/// the exclusive candidates or the region has the exclusive candidates. Ambiguous clusters with the several
+/// candidates on both sides are solved by the inner calculator on one compact matrix
+///
+class SPGreedy final : public ShortPathCalculator
+{
+public:
+    SPGreedy(const SPSettings& settings, std::unique_ptr<ShortPathCalculator> solver)
+        : ShortPathCalculator(settings), m_solver(std::move(solver))
+    {
+    }
+
+    void Solve(const distMatrix_t& costMatrix, size_t N, size_t M, assignments_t& assignment, track_t maxCost, const SparsePairs* sparsePairs) override;
+
+private:
+    std::unique_ptr<ShortPathCalculator> m_solver;
+
+    struct Pair
+    {
+        track_t m_cost = 0;
+        int m_row = 0;
+        int m_col = 0;
+    };
+    std::vector<Pair> m_pairs;
+    std::vector<Pair> m_greedyPairs;
+    std::vector<int> m_rowCandidates;
+    std::vector<int> m_colCandidates;
+    std::vector<char> m_rowStar;        // All candidates of the row have only this row
+    std::vector<char> m_colStar;        // All candidates of the column have only this column
+    std::vector<char> m_colUsed;
+    std::vector<int> m_subRows;
+    std::vector<int> m_subCols;
+    std::vector<int> m_rowToSub;
+    std::vector<int> m_colToSub;
+    distMatrix_t m_subMatrix;
+    assignments_t m_subAssignment;
+};
+
+///
+/// \brief The SPLAPJV class
+/// Shortest augmenting path (Jonker-Volgenant), pairs with distance >= m_distThres are forbidden.
+/// With the track IDs the solver is warm started: the tracks matched on the previous frame are seeded
+/// by their nearest regions and only the conflicts and the other tracks are solved by the augmenting paths
+///
+class SPLAPJV final : public ShortPathCalculator
+{
+public:
+    SPLAPJV(const SPSettings& settings)
+        : ShortPathCalculator(settings)
+    {
+    }
+
+    void Solve(const distMatrix_t& costMatrix, size_t N, size_t M, assignments_t& assignment, track_t maxCost, const SparsePairs* sparsePairs) override;
+
+    void SetTrackIDs(const std::vector<track_id_t>& ids) override
+    {
+        m_trackIDs = ids;
+    }
+
+    ///
+    /// \brief WarmRows
+    /// \return Pairs of the last Solve taken from the warm start
+    ///
+    size_t WarmRows() const
+    {
+        return m_solver.WarmRows();
+    }
+
+private:
+    LAPJVSolver m_solver;
+
+    std::vector<track_id_t> m_trackIDs;           // Rows of the next Solve
+    std::unordered_set<track_id_t> m_prevMatched; // Tracks with the region on the previous Solve
+    assignments_t m_warmStart;
+};
+
+///
+/// \brief The SPAdaptive class
+/// Chooses the solver on the every frame by the size of the matrix and the density of the feasible pairs (distance < m_distThres):
+/// Munkres for the small matrices, greedy if all feasible pairs are unambiguous, the connected components for the sparse
+/// matrices, LAPJV for the rest and optionally the suboptimal Hungarian for the huge ones.
+/// The counts of the decisions and the time of the every solver are in the metrics
+///
+class SPAdaptive final : public ShortPathCalculator
+{
+public:
+    enum class Choice
+    {
+        Empty,
+        Munkres,
+        Greedy,
+        Components,
+        LAPJV,
+        Suboptimal,
+        ChoicesCount
+    };
+
+    ///
+    /// \brief The Thresholds struct
+    ///
+    struct Thresholds
+    {
+        size_t m_smallCells = 64;        // N * M of the matrices for Munkres
+        track_t m_sparseDensity = 0.1f;  // Fraction of the feasible pairs for the components
+        size_t m_suboptimalCells = 0;    // N * M of the matrices for the suboptimal Hungarian, 0 - disabled
+    };
+
+    SPAdaptive(const SPSettings& settings);
+    SPAdaptive(const SPSettings& settings, const Thresholds& thresholds);
+
+    void Solve(const distMatrix_t& costMatrix, size_t N, size_t M, assignments_t& assignment, track_t maxCost, const SparsePairs* sparsePairs) override;
+
+    void SetTrackIDs(const std::vector<track_id_t>& ids) override
+    {
+        m_lapjv.SetTrackIDs(ids);
+    }
+
+    ///
+    Choice LastChoice() const
+    {
+        return m_lastChoice;
+    }
+
+    static const char* ChoiceName(Choice choice);
+
+private:
+    Thresholds m_thresholds;
+    Choice m_lastChoice = Choice::Empty;
+
+    SPHungrian m_munkres;
+    SPGreedy m_greedy;
+    SPComponents m_components;
+    SPLAPJV m_lapjv;
+    AssignmentProblemSolver m_suboptimal;
+
+    std::vector<int> m_pairRows;
+    std::vector<int> m_pairCols;
+    std::vector<int> m_rowCandidates;
+    std::vector<int> m_colCandidates;
+
+    Choice Choose(const distMatrix_t& costMatrix, size_t N, size_t M, const SparsePairs* sparsePairs);
 };
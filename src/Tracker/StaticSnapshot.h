@@ -0,0 +1,197 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include "defines.h"
+
+///
+/// \brief The StaticSnapshotsBudget class
+/// Memory limit for the snapshots of all static tracks of the tracker, it's shared by the tracks and thread safe
+///
+class StaticSnapshotsBudget
+{
+public:
+    ///
+    /// \brief StaticSnapshotsBudget
+    /// \param maxBytes - 0 for the unlimited memory
+    ///
+    StaticSnapshotsBudget(size_t maxBytes)
+        : m_maxBytes(maxBytes)
+    {
+    }
+
+    ///
+    /// \brief Acquire
+    /// \param bytes
+    /// \return false if the snapshot doesn't fit in the limit
+    ///
+    bool Acquire(size_t bytes)
+    {
+        const size_t maxBytes = m_maxBytes.load(std::memory_order_relaxed);
+        size_t used = m_usedBytes.load(std::memory_order_relaxed);
+        do
+        {
+            if (maxBytes && used + bytes > maxBytes)
+                return false;
+        }
+        while (!m_usedBytes.compare_exchange_weak(used, used + bytes, std::memory_order_relaxed));
+        return true;
+    }
+
+    ///
+    /// \brief Release
+    /// \param bytes
+    ///
+    void Release(size_t bytes)
+    {
+        m_usedBytes.fetch_sub(bytes, std::memory_order_relaxed);
+    }
+
+    ///
+    /// \brief SetMaxBytes
+    /// \param maxBytes - the new limit, the already acquired snapshots aren't released
+    ///
+    void SetMaxBytes(size_t maxBytes)
+    {
+        m_maxBytes.store(maxBytes, std::memory_order_relaxed);
+    }
+
+    ///
+    size_t UsedBytes() const
+    {
+        return m_usedBytes.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<size_t> m_maxBytes{ 0 };
+    std::atomic<size_t> m_usedBytes{ 0 };
+};
+
+///
+/// \brief The StaticSnapshot class
+/// Image of the static object when it stopped: only the object rectangle with the margin in the reduced resolution,
+/// so the memory is proportional to the object size, not to the frame size
+///
+class StaticSnapshot
+{
+public:
+    ///
+    /// \brief The Settings struct
+    ///
+    struct Settings
+    {
+        track_t m_margin = 0.1f; // Margin around the object rectangle in parts of its size
+        track_t m_scale = 1.f;   // Resolution of the snapshot relative to the frame, (0, 1]
+        std::shared_ptr<StaticSnapshotsBudget> m_budget;
+    };
+
+    StaticSnapshot(const Settings& settings)
+        : m_settings(settings)
+    {
+        m_settings.m_margin = std::max(0.f, m_settings.m_margin);
+        m_settings.m_scale = std::min(std::max(m_settings.m_scale, 0.01f), 1.f);
+    }
+    StaticSnapshot(const StaticSnapshot&) = delete;
+    StaticSnapshot& operator=(const StaticSnapshot&) = delete;
+
+    ~StaticSnapshot()
+    {
+        Reset();
+    }
+
+    ///
+    /// \brief Take
+    /// \param frame
+    /// \param rect - object on the frame
+    /// \return false if the snapshot is over the memory limit of the budget
+    ///
+    bool Take(cv::UMat frame, const cv::Rect& rect)
+    {
+        Reset();
+
+        const int dx = cvRound(m_settings.m_margin * rect.width);
+        const int dy = cvRound(m_settings.m_margin * rect.height);
+        m_roi = cv::Rect(rect.x - dx, rect.y - dy, rect.width + 2 * dx, rect.height + 2 * dy) & cv::Rect(0, 0, frame.cols, frame.rows);
+        if (m_roi.empty())
+            return false;
+
+        const cv::Size snapshotSize(std::max(1, cvRound(m_settings.m_scale * m_roi.width)), std::max(1, cvRound(m_settings.m_scale * m_roi.height)));
+        const size_t bytes = static_cast<size_t>(snapshotSize.area()) * frame.elemSize();
+        if (m_settings.m_budget && !m_settings.m_budget->Acquire(bytes))
+        {
+            m_roi = cv::Rect();
+            return false;
+        }
+        m_bytes = bytes;
+
+        if (snapshotSize == m_roi.size())
+            frame(m_roi).copyTo(m_image);
+        else
+            cv::resize(frame(m_roi), m_image, snapshotSize, 0, 0, cv::INTER_AREA);
+        return true;
+    }
+
+    ///
+    /// \brief Reset
+    ///
+    void Reset()
+    {
+        m_image.release();
+        m_roi = cv::Rect();
+        if (m_bytes && m_settings.m_budget)
+            m_settings.m_budget->Release(m_bytes);
+        m_bytes = 0;
+    }
+
+    ///
+    /// \brief Diff
+    /// \param frame - the current frame of the same format as the frame of the snapshot
+    /// \return Mean absolute difference of the channel with the maximum difference between the snapshot and the same area of the frame, -1 without the snapshot
+    ///
+    double Diff(cv::UMat frame) const
+    {
+        if (m_image.empty() || (m_roi & cv::Rect(0, 0, frame.cols, frame.rows)) != m_roi || frame.type() != m_image.type())
+            return -1;
+
+        cv::UMat curr;
+        if (m_image.size() == m_roi.size())
+            curr = frame(m_roi);
+        else
+            cv::resize(frame(m_roi), curr, m_image.size(), 0, 0, cv::INTER_AREA);
+        cv::UMat diff;
+        cv::absdiff(curr, m_image, diff);
+        const cv::Scalar meanDiff = cv::mean(diff);
+        return std::max(std::max(meanDiff[0], meanDiff[1]), std::max(meanDiff[2], meanDiff[3]));
+    }
+
+    ///
+    /// \brief Image
+    /// \return Snapshot of Roi() in the scale of settings
+    ///
+    cv::UMat Image() const
+    {
+        return m_image;
+    }
+    ///
+    /// \brief Roi
+    /// \return Area of the frame
+    ///
+    const cv::Rect& Roi() const
+    {
+        return m_roi;
+    }
+    ///
+    /// \brief Bytes
+    /// \return Memory of the image acquired from the budget
+    ///
+    size_t Bytes() const
+    {
+        return m_bytes;
+    }
+
+private:
+    Settings m_settings;
+    cv::UMat m_image;
+    cv::Rect m_roi;
+    size_t m_bytes = 0;
+};
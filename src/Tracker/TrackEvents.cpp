@@ -0,0 +1,152 @@
+#include "TrackEvents.h"
+
+namespace
+{
+    ///
+    /// \brief Side
+    /// \return > 0 if the point is to the right side of the line pt1 -> pt2 in the image coordinates (y down), < 0 - to the left side
+    ///
+    float Side(const cv::Point2f& pt1, const cv::Point2f& pt2, const cv::Point2f& pt)
+    {
+        return (pt2.x - pt1.x) * (pt.y - pt1.y) - (pt2.y - pt1.y) * (pt.x - pt1.x);
+    }
+}
+
+///
+/// \brief TrackEvents::TrackEvents
+/// \param params
+/// \param handler
+///
+TrackEvents::TrackEvents(const TrackEventsParams& params, TrackEventsHandler handler)
+    : m_params(params), m_handler(std::move(handler))
+{
+}
+
+///
+/// \brief TrackEvents::AddEvent
+///
+void TrackEvents::AddEvent(TrackEvent::Types type, track_id_t trackID, const TrackState& state, int areaID, int direction)
+{
+    TrackEvent trackEvent;
+    trackEvent.m_type = type;
+    trackEvent.m_trackID = trackID;
+    trackEvent.m_objType = state.m_type;
+    trackEvent.m_center = state.m_center;
+    trackEvent.m_frameInd = m_frameInd;
+    trackEvent.m_areaID = areaID;
+    trackEvent.m_direction = direction;
+    m_events.emplace_back(trackEvent);
+}
+
+///
+/// \brief TrackEvents::CheckLines
+/// The segment from the previous center to the current center crosses the line segment
+/// \param trackID
+/// \param state - with the previous center
+/// \param center
+///
+void TrackEvents::CheckLines(track_id_t trackID, const TrackState& state, const cv::Point2f& center)
+{
+    for (const auto& line : m_params.m_lines)
+    {
+        const float prevSide = Side(line.m_pt1, line.m_pt2, state.m_center);
+        const float currSide = Side(line.m_pt1, line.m_pt2, center);
+        if ((prevSide > 0) == (currSide > 0) || currSide == 0)
+            continue;
+        const float side1 = Side(state.m_center, center, line.m_pt1);
+        const float side2 = Side(state.m_center, center, line.m_pt2);
+        if ((side1 > 0) == (side2 > 0) && side1 != 0 && side2 != 0)
+            continue;
+
+        TrackState crossState = state;
+        crossState.m_center = center;
+        AddEvent(TrackEvent::LineCrossed, trackID, crossState, line.m_id, (currSide > 0) ? 1 : -1);
+    }
+}
+
+///
+/// \brief TrackEvents::CheckZones
+/// \param trackID
+/// \param state
+/// \param center
+///
+void TrackEvents::CheckZones(track_id_t trackID, TrackState& state, const cv::Point2f& center)
+{
+    state.m_inZones.resize(m_params.m_zones.size(), 0);
+    for (size_t i = 0; i < m_params.m_zones.size(); ++i)
+    {
+        const auto& zone = m_params.m_zones[i];
+        const char inZone = (zone.m_polygon.size() > 2 && cv::pointPolygonTest(zone.m_polygon, center, false) >= 0) ? 1 : 0;
+        if (inZone != state.m_inZones[i])
+        {
+            state.m_inZones[i] = inZone;
+            AddEvent(inZone ? TrackEvent::ZoneEntered : TrackEvent::ZoneLeft, trackID, state, zone.m_id);
+        }
+    }
+}
+
+///
+/// \brief TrackEvents::Update
+/// \param tracks
+///
+void TrackEvents::Update(const tracks_t& tracks)
+{
+    ++m_frameInd;
+    m_events.clear();
+
+    for (const auto& track : tracks)
+    {
+        const track_id_t trackID = track->GetID();
+        const cv::Point2f center = track->GetLastRect().center;
+
+        auto it = m_states.find(trackID);
+        const bool created = (it == std::end(m_states));
+        if (created)
+            it = m_states.emplace(trackID, TrackState()).first;
+        TrackState& state = it->second;
+
+        if (!created)
+            CheckLines(trackID, state, center);
+
+        state.m_center = center;
+        state.m_type = track->GetCurrType();
+        state.m_frameInd = m_frameInd;
+        if (created)
+            AddEvent(TrackEvent::Created, trackID, state);
+
+        if (!state.m_robust && TrackingObject::IsRobust(track->GetTrace(), track->GetLastRect(), track->IsOutOfTheFrame(),
+                                                        m_params.m_robustMinTraceSize, m_params.m_robustMinRawRatio, m_params.m_robustSizeRatio))
+        {
+            state.m_robust = true;
+            AddEvent(TrackEvent::Robust, trackID, state);
+        }
+
+        const bool isStatic = track->IsStatic();
+        if (isStatic && !state.m_static)
+            AddEvent(TrackEvent::Static, trackID, state);
+        state.m_static = isStatic;
+
+        const bool outOfTheFrame = track->IsOutOfTheFrame();
+        if (outOfTheFrame && !state.m_outOfTheFrame)
+            AddEvent(TrackEvent::LeftFrame, trackID, state);
+        state.m_outOfTheFrame = outOfTheFrame;
+
+        if (!m_params.m_zones.empty())
+            CheckZones(trackID, state, center);
+    }
+
+    // The tracks without the current state were removed
+    for (auto it = std::begin(m_states); it != std::end(m_states);)
+    {
+        if (it->second.m_frameInd == m_frameInd)
+        {
+            ++it;
+            continue;
+        }
+        AddEvent(TrackEvent::Removed, it->first, it->second);
+        it = m_states.erase(it);
+    }
+
+    if (!m_events.empty() && m_handler)
+        m_handler(m_events);
+}
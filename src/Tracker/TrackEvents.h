@@ -0,0 +1,45 @@
+#pragma once
+#include <unordered_map>
+#include "Ctracker.h"
+#include "track.h"
+
+///
+/// \brief The TrackEvents class
+/// Events of the tracks from the difference of their states with the states of the previous Update: the flags of the
+/// announced states, the last center for the lines crossing and the zones of the center. The tracks which are missed
+/// in the current tracks are removed
+///
+class TrackEvents
+{
+public:
+    TrackEvents(const TrackEventsParams& params, TrackEventsHandler handler);
+
+    ///
+    /// \brief Update
+    /// It's called at the end of the tracker Update, the handler gets the events if they are
+    /// \param tracks
+    ///
+    void Update(const tracks_t& tracks);
+
+private:
+    TrackEventsParams m_params;
+    TrackEventsHandler m_handler;
+
+    struct TrackState
+    {
+        cv::Point2f m_center;
+        objtype_t m_type = bad_type;
+        size_t m_frameInd = 0;     // Last Update with the track
+        bool m_robust = false;
+        bool m_static = false;
+        bool m_outOfTheFrame = false;
+        std::vector<char> m_inZones;
+    };
+    std::unordered_map<track_id_t, TrackState> m_states;
+    std::vector<TrackEvent> m_events;
+    size_t m_frameInd = 0;
+
+    void AddEvent(TrackEvent::Types type, track_id_t trackID, const TrackState& state, int areaID = -1, int direction = 0);
+    void CheckLines(track_id_t trackID, const TrackState& state, const cv::Point2f& center);
+    void CheckZones(track_id_t trackID, TrackState& state, const cv::Point2f& center);
+};
@@ -0,0 +1,73 @@
+#include <iostream>
+
+#include "TrackIDAllocator.h"
+#include "TrackerSettings.h"
+
+static_assert(sizeof(track_id_t::value_type) * 8 >= TrackIDAllocator::SequenceBits + TrackIDAllocator::StreamBits,
+              "Packed track IDs need 64-bit track_id_t");
+
+///
+/// \brief ProcessTrackIDAllocator::NextID
+/// \return
+///
+track_id_t ProcessTrackIDAllocator::NextID()
+{
+    return track_id_t(Counter().fetch_add(1, std::memory_order_relaxed));
+}
+
+///
+/// \brief ProcessTrackIDAllocator::Peek
+/// \return
+///
+track_id_t::value_type ProcessTrackIDAllocator::Peek() const
+{
+    return Counter().load(std::memory_order_relaxed);
+}
+
+///
+/// \brief ProcessTrackIDAllocator::Resume
+/// \param next
+///
+void ProcessTrackIDAllocator::Resume(track_id_t::value_type next)
+{
+    std::atomic<track_id_t::value_type>& counter = Counter();
+    track_id_t::value_type curr = counter.load(std::memory_order_relaxed);
+    while (curr < next && !counter.compare_exchange_weak(curr, next, std::memory_order_relaxed))
+    {
+    }
+}
+
+///
+/// \brief ProcessTrackIDAllocator::Counter
+/// \return One counter of the process
+///
+std::atomic<track_id_t::value_type>& ProcessTrackIDAllocator::Counter()
+{
+    static std::atomic<track_id_t::value_type> nextID{ 0 };
+    return nextID;
+}
+
+///
+/// \brief TrackIDAllocator::CreateAllocator
+/// \param settings
+/// \return
+///
+std::shared_ptr<TrackIDAllocator> TrackIDAllocator::CreateAllocator(const TrackerSettings& settings)
+{
+    if (settings.m_trackIDAllocator)
+        return settings.m_trackIDAllocator;
+
+    switch (settings.m_trackIDMode)
+    {
+    case tracking::IDProcess:
+        return std::make_shared<ProcessTrackIDAllocator>();
+
+    case tracking::IDPacked:
+        if (settings.m_streamID > StreamMask)
+            std::cerr << "Stream ID " << settings.m_streamID << " is out of " << StreamBits << " bits of the packed track IDs" << std::endl;
+        return std::make_shared<PackedTrackIDAllocator>(settings.m_streamID);
+
+    default:
+        return std::make_shared<LocalTrackIDAllocator>();
+    }
+}
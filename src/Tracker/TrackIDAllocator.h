@@ -0,0 +1,141 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include "defines.h"
+
+struct TrackerSettings;
+
+///
+/// \brief The TrackIDAllocator class
+/// Source of the IDs for the new tracks. The tracker calls NextID from its Update, the shared allocators must be thread safe
+///
+class TrackIDAllocator
+{
+public:
+    virtual ~TrackIDAllocator() = default;
+
+    ///
+    virtual track_id_t NextID() = 0;
+
+    ///
+    /// \brief Peek
+    /// \return Value of the next ID for the checkpoint of the tracker, 0 if the allocator doesn't support it
+    ///
+    virtual track_id_t::value_type Peek() const
+    {
+        return 0;
+    }
+    ///
+    /// \brief Resume
+    /// The restored tracker continues the IDs of the checkpoint: the next ID isn't less than the Peek value
+    /// \param next
+    ///
+    virtual void Resume(track_id_t::value_type /*next*/)
+    {
+    }
+
+    ///
+    /// \brief CreateAllocator
+    /// \param settings - m_trackIDAllocator if it isn't empty else the allocator of m_trackIDMode
+    /// \return
+    ///
+    static std::shared_ptr<TrackIDAllocator> CreateAllocator(const TrackerSettings& settings);
+
+    ///
+    /// \brief PackID
+    /// \param streamId - low StreamBits bits are used
+    /// \param sequence - low SequenceBits bits are used
+    /// \return
+    ///
+    static constexpr track_id_t::value_type PackID(stream_id_t streamId, track_id_t::value_type sequence)
+    {
+        return ((static_cast<track_id_t::value_type>(streamId) & StreamMask) << SequenceBits) | (sequence & SequenceMask);
+    }
+    ///
+    static constexpr stream_id_t StreamOfID(const track_id_t& id)
+    {
+        return static_cast<stream_id_t>((id.m_val >> SequenceBits) & StreamMask);
+    }
+    ///
+    static constexpr track_id_t::value_type SequenceOfID(const track_id_t& id)
+    {
+        return id.m_val & SequenceMask;
+    }
+
+    static constexpr int SequenceBits = 40; // 10^12 tracks of the stream
+    static constexpr int StreamBits = 24;   // 16M streams
+    static constexpr track_id_t::value_type SequenceMask = (static_cast<track_id_t::value_type>(1) << SequenceBits) - 1;
+    static constexpr track_id_t::value_type StreamMask = (static_cast<track_id_t::value_type>(1) << StreamBits) - 1;
+};
+
+///
+/// \brief The LocalTrackIDAllocator class
+/// Own counter of the tracker, the IDs of the different trackers are equal
+///
+class LocalTrackIDAllocator final : public TrackIDAllocator
+{
+public:
+    track_id_t NextID() override
+    {
+        return track_id_t(m_nextID++);
+    }
+    track_id_t::value_type Peek() const override
+    {
+        return m_nextID;
+    }
+    void Resume(track_id_t::value_type next) override
+    {
+        m_nextID = std::max(m_nextID, next);
+    }
+
+private:
+    track_id_t::value_type m_nextID = 0;
+};
+
+///
+/// \brief The ProcessTrackIDAllocator class
+/// One counter of all trackers of the process, the IDs are unique in the process
+///
+class ProcessTrackIDAllocator final : public TrackIDAllocator
+{
+public:
+    track_id_t NextID() override;
+    track_id_t::value_type Peek() const override;
+    void Resume(track_id_t::value_type next) override;
+
+private:
+    static std::atomic<track_id_t::value_type>& Counter();
+};
+
+///
+/// \brief The PackedTrackIDAllocator class
+/// (stream ID, sequence) in one 64-bit ID: the IDs are unique in the cluster if the stream IDs are unique
+///
+class PackedTrackIDAllocator final : public TrackIDAllocator
+{
+public:
+    PackedTrackIDAllocator(stream_id_t streamId)
+        : m_streamId(streamId)
+    {
+    }
+
+    track_id_t NextID() override
+    {
+        return track_id_t(PackID(m_streamId, m_sequence.fetch_add(1, std::memory_order_relaxed)));
+    }
+    track_id_t::value_type Peek() const override
+    {
+        return m_sequence.load(std::memory_order_relaxed);
+    }
+    void Resume(track_id_t::value_type next) override
+    {
+        track_id_t::value_type curr = m_sequence.load(std::memory_order_relaxed);
+        while (curr < next && !m_sequence.compare_exchange_weak(curr, next, std::memory_order_relaxed))
+        {
+        }
+    }
+
+private:
+    stream_id_t m_streamId = 0;
+    std::atomic<track_id_t::value_type> m_sequence{ 0 };
+};
@@ -0,0 +1,108 @@
+#include "TrackInterpolator.h"
+
+#include <unordered_map>
+
+///
+/// \brief TrackInterpolator::Update
+/// \param frameInd
+/// \param tracks
+///
+void TrackInterpolator::Update(int frameInd, const std::vector<TrackingObject>& tracks)
+{
+    m_lastFrameInd = frameInd;
+    m_lastTracks = tracks;
+}
+
+///
+/// \brief TrackInterpolator::Reset
+///
+void TrackInterpolator::Reset()
+{
+    m_lastFrameInd = -1;
+    m_lastTracks.clear();
+}
+
+///
+/// \brief TrackInterpolator::Extrapolate
+/// \param frameInd
+/// \param fps
+/// \param tracks
+/// \return
+///
+bool TrackInterpolator::Extrapolate(int frameInd, float fps, std::vector<TrackingObject>& tracks) const
+{
+    tracks.clear();
+    if (m_lastFrameInd < 0 || frameInd < m_lastFrameInd || fps <= 0)
+        return false;
+
+    const track_t dt = static_cast<track_t>(frameInd - m_lastFrameInd) / fps;
+    tracks.reserve(m_lastTracks.size());
+    for (const auto& last : m_lastTracks)
+    {
+        tracks.emplace_back(last);
+        TrackingObject& track = tracks.back();
+        if (!track.m_isStatic)
+        {
+            track.m_rrect.center.x += static_cast<float>(track.m_velocity[0] * dt);
+            track.m_rrect.center.y += static_cast<float>(track.m_velocity[1] * dt);
+        }
+        track.m_estimate = TrackingObject::Estimate::Extrapolated;
+    }
+    return true;
+}
+
+///
+/// \brief TrackInterpolator::Interpolate
+/// \param frameInd
+/// \param nextFrameInd
+/// \param nextTracks
+/// \param tracks
+/// \return
+///
+bool TrackInterpolator::Interpolate(int frameInd, int nextFrameInd, const std::vector<TrackingObject>& nextTracks, std::vector<TrackingObject>& tracks) const
+{
+    tracks.clear();
+    if (m_lastFrameInd < 0 || frameInd <= m_lastFrameInd || frameInd >= nextFrameInd)
+        return false;
+
+    std::unordered_map<track_id_t, size_t> nextInds;
+    nextInds.reserve(nextTracks.size());
+    for (size_t i = 0; i < nextTracks.size(); ++i)
+    {
+        nextInds.emplace(nextTracks[i].m_ID, i);
+    }
+
+    const float alpha = static_cast<float>(frameInd - m_lastFrameInd) / static_cast<float>(nextFrameInd - m_lastFrameInd);
+    auto Lerp = [alpha](float v1, float v2)
+    {
+        return v1 + alpha * (v2 - v1);
+    };
+
+    tracks.reserve(m_lastTracks.size());
+    for (const auto& last : m_lastTracks)
+    {
+        auto it = nextInds.find(last.m_ID);
+        if (it == std::end(nextInds))
+            continue;
+        const TrackingObject& next = nextTracks[it->second];
+
+        tracks.emplace_back(last);
+        TrackingObject& track = tracks.back();
+        track.m_rrect.center.x = Lerp(last.m_rrect.center.x, next.m_rrect.center.x);
+        track.m_rrect.center.y = Lerp(last.m_rrect.center.y, next.m_rrect.center.y);
+        track.m_rrect.size.width = Lerp(last.m_rrect.size.width, next.m_rrect.size.width);
+        track.m_rrect.size.height = Lerp(last.m_rrect.size.height, next.m_rrect.size.height);
+        // The rectangle is symmetric: the angles are interpolated by the shortest turn
+        float dAngle = next.m_rrect.angle - last.m_rrect.angle;
+        while (dAngle > 90.f)
+            dAngle -= 180.f;
+        while (dAngle < -90.f)
+            dAngle += 180.f;
+        track.m_rrect.angle = last.m_rrect.angle + alpha * dAngle;
+        track.m_velocity[0] = static_cast<track_t>(Lerp(static_cast<float>(last.m_velocity[0]), static_cast<float>(next.m_velocity[0])));
+        track.m_velocity[1] = static_cast<track_t>(Lerp(static_cast<float>(last.m_velocity[1]), static_cast<float>(next.m_velocity[1])));
+        track.m_type = next.m_type;
+        track.m_estimate = TrackingObject::Estimate::Interpolated;
+    }
+    return true;
+}
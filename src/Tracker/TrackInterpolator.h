@@ -0,0 +1,55 @@
+#pragma once
+#include <vector>
+
+#include "trajectory.h"
+
+///
+/// \brief The TrackInterpolator class
+/// Tracks of the frames without the tracker update: the detection and the association run only on the keyframes
+/// and the output stays at the full frame rate. The state of the last update is kept, the frame after it gets
+/// the tracks extrapolated by their velocity (the same constant velocity as the Kalman prediction) or, after the
+/// next update, interpolated between two updates. The objects are marked by TrackingObject::m_estimate
+///
+class TrackInterpolator
+{
+public:
+    ///
+    /// \brief Update
+    /// \param frameInd - frame of the tracker update
+    /// \param tracks - of the update, they are copied
+    ///
+    void Update(int frameInd, const std::vector<TrackingObject>& tracks);
+
+    ///
+    void Reset();
+
+    ///
+    /// \brief Extrapolate
+    /// \param frameInd - frame after the last update
+    /// \param fps - frame rate of the stream: the velocity is in pixels/sec
+    /// \param tracks - tracks of the last update moved on their velocity
+    /// \return false if there wasn't the update
+    ///
+    bool Extrapolate(int frameInd, float fps, std::vector<TrackingObject>& tracks) const;
+
+    ///
+    /// \brief Interpolate
+    /// Retroactive interpolation between the last update and the next one: only the tracks of the both updates
+    /// \param frameInd - frame between the last update and nextFrameInd
+    /// \param nextFrameInd
+    /// \param nextTracks - tracks of the update on nextFrameInd
+    /// \param tracks
+    /// \return false if frameInd isn't between the updates
+    ///
+    bool Interpolate(int frameInd, int nextFrameInd, const std::vector<TrackingObject>& nextTracks, std::vector<TrackingObject>& tracks) const;
+
+    ///
+    int LastFrame() const
+    {
+        return m_lastFrameInd;
+    }
+
+private:
+    int m_lastFrameInd = -1;
+    std::vector<TrackingObject> m_lastTracks;
+};
@@ -0,0 +1,122 @@
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+#include "TrackerCheckpoint.h"
+
+namespace checkpoint
+{
+///
+/// \brief SaveFile
+/// \param fileName
+/// \param data
+/// \return
+///
+bool SaveFile(const std::string& fileName, const std::vector<uchar>& data)
+{
+    const std::string tmpName = fileName + ".tmp";
+    {
+        std::ofstream file(tmpName, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            std::cerr << "Checkpoint: can't open " << tmpName << std::endl;
+            return false;
+        }
+        file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+        if (!file.good())
+        {
+            std::cerr << "Checkpoint: write error " << tmpName << std::endl;
+            return false;
+        }
+    }
+#ifdef _WIN32
+    // rename doesn't replace the existing file on Windows
+    std::remove(fileName.c_str());
+#endif
+    if (std::rename(tmpName.c_str(), fileName.c_str()) != 0)
+    {
+        std::cerr << "Checkpoint: can't rename " << tmpName << " to " << fileName << std::endl;
+        return false;
+    }
+    return true;
+}
+
+///
+/// \brief LoadFile
+/// \param fileName
+/// \param data
+/// \return
+///
+bool LoadFile(const std::string& fileName, std::vector<uchar>& data)
+{
+    std::ifstream file(fileName, std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+        return false;
+    const std::streamsize size = file.tellg();
+    if (size <= 0)
+        return false;
+    file.seekg(0);
+    data.resize(static_cast<size_t>(size));
+    file.read(reinterpret_cast<char*>(data.data()), size);
+    return file.good();
+}
+
+///
+/// \brief BackgroundWriter::BackgroundWriter
+/// \param fileName
+///
+BackgroundWriter::BackgroundWriter(const std::string& fileName)
+    : m_fileName(fileName)
+{
+    m_thread = std::thread(&BackgroundWriter::Worker, this);
+}
+
+///
+/// \brief BackgroundWriter::~BackgroundWriter
+/// The last posted checkpoint is written before the exit
+///
+BackgroundWriter::~BackgroundWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cond.notify_one();
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+///
+/// \brief BackgroundWriter::Post
+/// \param data
+///
+void BackgroundWriter::Post(std::vector<uchar>& data)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending.swap(data);
+        m_hasPending = true;
+    }
+    m_cond.notify_one();
+}
+
+///
+/// \brief BackgroundWriter::Worker
+///
+void BackgroundWriter::Worker()
+{
+    std::vector<uchar> data;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cond.wait(lock, [this]() { return m_stop || m_hasPending; });
+            if (!m_hasPending)
+                break;
+            data.swap(m_pending);
+            m_hasPending = false;
+        }
+        SaveFile(m_fileName, data);
+    }
+}
+}
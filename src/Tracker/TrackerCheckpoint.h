@@ -0,0 +1,295 @@
+#pragma once
+#include <mutex>
+#include <thread>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <type_traits>
+#include <condition_variable>
+
+#include "defines.h"
+
+///
+/// Checkpoint of the tracker state for the restart or the failover to the standby process:
+///
+///     tracker->Serialize(data);             // In the thread of Update, it copies the state only
+///     writer.Post(std::move(data));         // The file is written in the background
+///     ...
+///     checkpoint::LoadFile(fileName, data);
+///     tracker->Deserialize(data);           // The standby process continues the tracks and the IDs
+///
+/// The format is the little endian binary dump: the header (magic, version, track_t size) and the records
+/// written by the Writer of the tracker. The readers of the other versions reject the data
+///
+namespace checkpoint
+{
+constexpr uint32_t Magic = 0x4B43544D; // "MTCK"
+constexpr uint32_t Version = 3; // 2 - square rooted normalized histograms, 3 - simplified history of the trajectories
+
+///
+/// \brief The Writer class
+///
+class Writer
+{
+public:
+    ///
+    explicit Writer(std::vector<uchar>& data)
+        : m_data(data)
+    {
+    }
+
+    ///
+    template<typename T>
+    void Pod(const T& val)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Only the trivially copyable types");
+        const size_t pos = m_data.size();
+        m_data.resize(pos + sizeof(T));
+        memcpy(&m_data[pos], &val, sizeof(T));
+    }
+
+    ///
+    template<typename T>
+    void Vector(const std::vector<T>& vals)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Only the trivially copyable types");
+        Pod(static_cast<uint64_t>(vals.size()));
+        if (vals.empty())
+            return;
+        const size_t pos = m_data.size();
+        m_data.resize(pos + vals.size() * sizeof(T));
+        memcpy(&m_data[pos], vals.data(), vals.size() * sizeof(T));
+    }
+
+    ///
+    /// \brief Point, Rect, RotatedRect
+    /// By the fields: the copy constructors of the OpenCV types aren't trivial in the all versions
+    ///
+    template<typename T>
+    void Point(const cv::Point_<T>& pt)
+    {
+        Pod(pt.x);
+        Pod(pt.y);
+    }
+    ///
+    template<typename T>
+    void Rect(const cv::Rect_<T>& rect)
+    {
+        Pod(rect.x);
+        Pod(rect.y);
+        Pod(rect.width);
+        Pod(rect.height);
+    }
+    ///
+    void RotatedRect(const cv::RotatedRect& rrect)
+    {
+        Point(rrect.center);
+        Pod(rrect.size.width);
+        Pod(rrect.size.height);
+        Pod(rrect.angle);
+    }
+
+    ///
+    /// \brief Mat
+    /// The 2D continuous or not matrix
+    ///
+    void Mat(const cv::Mat& mat)
+    {
+        Pod(static_cast<int32_t>(mat.rows));
+        Pod(static_cast<int32_t>(mat.cols));
+        Pod(static_cast<int32_t>(mat.type()));
+        if (mat.empty())
+            return;
+        const size_t rowBytes = mat.cols * mat.elemSize();
+        for (int y = 0; y < mat.rows; ++y)
+        {
+            const size_t pos = m_data.size();
+            m_data.resize(pos + rowBytes);
+            memcpy(&m_data[pos], mat.ptr(y), rowBytes);
+        }
+    }
+
+    ///
+    void Header()
+    {
+        Pod(Magic);
+        Pod(Version);
+        Pod(static_cast<uint32_t>(sizeof(track_t)));
+    }
+
+private:
+    std::vector<uchar>& m_data;
+};
+
+///
+/// \brief The Reader class
+/// Any read after the error fails, so the result is checked once by Ok()
+///
+class Reader
+{
+public:
+    ///
+    explicit Reader(const std::vector<uchar>& data)
+        : m_data(data)
+    {
+    }
+
+    ///
+    bool Ok() const
+    {
+        return m_ok;
+    }
+
+    ///
+    template<typename T>
+    bool Pod(T& val)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Only the trivially copyable types");
+        if (!Has(sizeof(T)))
+            return false;
+        memcpy(&val, &m_data[m_pos], sizeof(T));
+        m_pos += sizeof(T);
+        return true;
+    }
+
+    ///
+    template<typename T>
+    bool Vector(std::vector<T>& vals)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Only the trivially copyable types");
+        uint64_t count = 0;
+        if (!Pod(count) || !Has(count * sizeof(T)))
+            return false;
+        vals.resize(static_cast<size_t>(count));
+        if (count)
+            memcpy(vals.data(), &m_data[m_pos], vals.size() * sizeof(T));
+        m_pos += vals.size() * sizeof(T);
+        return true;
+    }
+
+    ///
+    template<typename T>
+    bool Point(cv::Point_<T>& pt)
+    {
+        return Pod(pt.x) && Pod(pt.y);
+    }
+    ///
+    template<typename T>
+    bool Rect(cv::Rect_<T>& rect)
+    {
+        return Pod(rect.x) && Pod(rect.y) && Pod(rect.width) && Pod(rect.height);
+    }
+    ///
+    bool RotatedRect(cv::RotatedRect& rrect)
+    {
+        return Point(rrect.center) && Pod(rrect.size.width) && Pod(rrect.size.height) && Pod(rrect.angle);
+    }
+
+    ///
+    bool Mat(cv::Mat& mat)
+    {
+        int32_t rows = 0;
+        int32_t cols = 0;
+        int32_t type = 0;
+        if (!Pod(rows) || !Pod(cols) || !Pod(type) || rows < 0 || cols < 0)
+            return Fail();
+        if (!rows || !cols)
+        {
+            mat.release();
+            return true;
+        }
+        const size_t bytes = static_cast<size_t>(rows) * cols * CV_ELEM_SIZE(type);
+        if (!Has(bytes))
+            return false;
+        mat.create(rows, cols, type);
+        memcpy(mat.data, &m_data[m_pos], bytes);
+        m_pos += bytes;
+        return true;
+    }
+
+    ///
+    bool Header()
+    {
+        uint32_t magic = 0;
+        uint32_t version = 0;
+        uint32_t valueSize = 0;
+        if (!Pod(magic) || !Pod(version) || !Pod(valueSize))
+            return false;
+        if (magic != Magic || version != Version || valueSize != sizeof(track_t))
+            return Fail();
+        return true;
+    }
+
+private:
+    const std::vector<uchar>& m_data;
+    size_t m_pos = 0;
+    bool m_ok = true;
+
+    ///
+    bool Has(size_t bytes)
+    {
+        if (!m_ok || m_data.size() - m_pos < bytes)
+            return Fail();
+        return true;
+    }
+    ///
+    bool Fail()
+    {
+        m_ok = false;
+        return false;
+    }
+};
+
+///
+/// \brief SaveFile
+/// The data is written to the temporary file and renamed: the reader sees the old or the new checkpoint
+/// \param fileName
+/// \param data
+/// \return
+///
+bool SaveFile(const std::string& fileName, const std::vector<uchar>& data);
+
+///
+/// \brief LoadFile
+/// \param fileName
+/// \param data
+/// \return false if the file doesn't exist or can't be read
+///
+bool LoadFile(const std::string& fileName, std::vector<uchar>& data);
+
+///
+/// \brief The BackgroundWriter class
+/// Writes the checkpoints to the file in the own thread. If the file is written slower than the checkpoints are posted
+/// the not written checkpoint is replaced by the newer one, so Post never waits for the disk
+///
+class BackgroundWriter
+{
+public:
+    ///
+    explicit BackgroundWriter(const std::string& fileName);
+    ///
+    ~BackgroundWriter();
+
+    BackgroundWriter(const BackgroundWriter&) = delete;
+    BackgroundWriter& operator=(const BackgroundWriter&) = delete;
+
+    ///
+    /// \brief Post
+    /// \param data - the checkpoint, its buffer is swapped with the buffer of the written one for the reuse
+    ///
+    void Post(std::vector<uchar>& data);
+
+private:
+    std::string m_fileName;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    std::vector<uchar> m_pending;
+    bool m_hasPending = false;
+    bool m_stop = false;
+    std::thread m_thread;
+
+    void Worker();
+};
+}
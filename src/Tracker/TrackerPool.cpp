@@ -0,0 +1,216 @@
+#include "TrackerPool.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+///
+/// \brief TrackerPool::TrackerPool
+/// \param workersCount
+/// \param ompThreadsPerWorker
+/// \param workerInit
+///
+TrackerPool::TrackerPool(size_t workersCount, int ompThreadsPerWorker, WorkerInit workerInit)
+    : m_ompThreadsPerWorker(ompThreadsPerWorker), m_workerInit(std::move(workerInit))
+{
+    if (!workersCount)
+        workersCount = std::max(1u, std::thread::hardware_concurrency());
+
+    m_workers.reserve(workersCount);
+    for (size_t i = 0; i < workersCount; ++i)
+    {
+        m_workers.emplace_back(&TrackerPool::WorkerThread, this, i);
+    }
+}
+
+///
+/// \brief TrackerPool::~TrackerPool
+///
+TrackerPool::~TrackerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cond.notify_all();
+    for (auto& worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+///
+/// \brief TrackerPool::AddStream
+/// \param streamId
+/// \param settings
+/// \param callback
+/// \return
+///
+bool TrackerPool::AddStream(stream_id_t streamId, const TrackerSettings& settings, ResultCallback callback)
+{
+    auto stream = std::make_shared<Stream>();
+    stream->m_id = streamId;
+    if (settings.m_trackIDMode == tracking::IDPacked)
+    {
+        // Streams of the pool have the different packed IDs, m_streamID is the offset of the pool in the cluster
+        TrackerSettings streamSettings(settings);
+        streamSettings.m_streamID += streamId;
+        stream->m_tracker = BaseTracker::CreateTracker(streamSettings);
+    }
+    else
+    {
+        stream->m_tracker = BaseTracker::CreateTracker(settings);
+    }
+    stream->m_callback = callback;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_streams.try_emplace(streamId, stream).second;
+}
+
+///
+/// \brief TrackerPool::RemoveStream
+/// \param streamId
+///
+void TrackerPool::RemoveStream(stream_id_t streamId)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    auto it = m_streams.find(streamId);
+    if (it == std::end(m_streams))
+        return;
+
+    std::shared_ptr<Stream> stream = it->second;
+    m_streams.erase(it);
+    m_doneCond.wait(lock, [&] { return !stream->m_scheduled; });
+}
+
+///
+/// \brief TrackerPool::Submit
+/// \param streamId
+/// \param regions
+/// \param frame
+/// \param fps
+/// \return
+///
+bool TrackerPool::Submit(stream_id_t streamId, const regions_t& regions, cv::UMat frame, float fps)
+{
+    Task task;
+    task.m_regions = regions;
+    task.m_frame = frame;
+    task.m_fps = fps;
+    return Submit(streamId, std::move(task));
+}
+
+///
+/// \brief TrackerPool::Submit
+/// \param streamId
+/// \param regions
+/// \param regionEmbeddings
+/// \param frame
+/// \param fps
+/// \return
+///
+bool TrackerPool::Submit(stream_id_t streamId, const regions_t& regions, std::vector<RegionEmbedding>&& regionEmbeddings, cv::UMat frame, float fps)
+{
+    Task task;
+    task.m_regions = regions;
+    task.m_regionEmbeddings = std::move(regionEmbeddings);
+    task.m_hasEmbeddings = true;
+    task.m_frame = frame;
+    task.m_fps = fps;
+    return Submit(streamId, std::move(task));
+}
+
+///
+/// \brief TrackerPool::Submit
+/// \param streamId
+/// \param task
+/// \return
+///
+bool TrackerPool::Submit(stream_id_t streamId, Task&& task)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_streams.find(streamId);
+        if (it == std::end(m_streams))
+            return false;
+
+        Stream& stream = *it->second;
+        stream.m_tasks.emplace_back(std::move(task));
+        ++m_tasksInWork;
+        if (stream.m_scheduled)
+            return true;
+
+        stream.m_scheduled = true;
+        m_readyStreams.push_back(it->second);
+    }
+    m_cond.notify_one();
+    return true;
+}
+
+///
+/// \brief TrackerPool::Wait
+///
+void TrackerPool::Wait()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_doneCond.wait(lock, [&] { return m_tasksInWork == 0; });
+}
+
+///
+/// \brief TrackerPool::WorkerThread
+/// \param workerIndex
+///
+void TrackerPool::WorkerThread(size_t workerIndex)
+{
+#ifdef _OPENMP
+    // Workers share the cores: OpenMP inside the trackers would oversubscribe them
+    if (m_ompThreadsPerWorker > 0)
+        omp_set_num_threads(m_ompThreadsPerWorker);
+#endif
+    if (m_workerInit)
+        m_workerInit(workerIndex);
+
+    for (;;)
+    {
+        std::shared_ptr<Stream> stream;
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cond.wait(lock, [&] { return m_stop || !m_readyStreams.empty(); });
+            if (m_stop)
+                break;
+
+            stream = m_readyStreams.front();
+            m_readyStreams.pop_front();
+            task = std::move(stream->m_tasks.front());
+            stream->m_tasks.pop_front();
+        }
+
+        // Only this worker owns the stream until it's rescheduled
+        if (task.m_hasEmbeddings)
+            stream->m_tracker->Update(task.m_regions, task.m_regionEmbeddings, task.m_frame, task.m_fps);
+        else
+            stream->m_tracker->Update(task.m_regions, task.m_frame, task.m_fps);
+        if (stream->m_callback)
+        {
+            stream->m_tracker->GetTracks(stream->m_tracks);
+            stream->m_tracker->GetRemovedTracks(stream->m_removedTracks);
+            stream->m_callback(stream->m_id, stream->m_tracks, stream->m_removedTracks);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            --m_tasksInWork;
+            if (stream->m_tasks.empty())
+            {
+                stream->m_scheduled = false;
+            }
+            else
+            {
+                m_readyStreams.push_back(stream);
+                m_cond.notify_one();
+            }
+        }
+        m_doneCond.notify_all();
+    }
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <map>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+#include "Ctracker.h"
+
+///
+/// \brief The TrackerPool class
+/// Trackers for many video streams on one bounded pool of the worker threads.
+/// Updates of the different streams are processed concurrently, updates of one stream are serialized
+///
+class TrackerPool
+{
+public:
+    ///
+    /// \brief ResultCallback
+    /// Called from a worker thread after each update of the stream
+    ///
+    typedef std::function<void(stream_id_t streamId, const std::vector<TrackingObject>& tracks, const std::vector<track_id_t>& removedTracks)> ResultCallback;
+
+    ///
+    /// \brief WorkerInit
+    /// Called by the every worker thread before the first task: the affinity and the OpenMP threads of the worker
+    ///
+    typedef std::function<void(size_t workerIndex)> WorkerInit;
+
+    ///
+    /// \brief TrackerPool
+    /// \param workersCount - 0 means hardware concurrency
+    /// \param ompThreadsPerWorker - OpenMP threads inside one tracker update, 0 - don't change
+    /// \param workerInit - nullptr or the initialization of the worker thread after the OpenMP threads count
+    ///
+    TrackerPool(size_t workersCount, int ompThreadsPerWorker = 1, WorkerInit workerInit = nullptr);
+    TrackerPool(const TrackerPool&) = delete;
+    TrackerPool(TrackerPool&&) = delete;
+    TrackerPool& operator=(const TrackerPool&) = delete;
+    TrackerPool& operator=(TrackerPool&&) = delete;
+    ~TrackerPool();
+
+    ///
+    /// \brief AddStream
+    /// \param streamId
+    /// \param settings - with tracking::IDPacked the tracker packs settings.m_streamID + streamId in the track IDs
+    /// \param callback
+    /// \return false if the stream already exists
+    ///
+    bool AddStream(stream_id_t streamId, const TrackerSettings& settings, ResultCallback callback);
+    ///
+    /// \brief RemoveStream
+    /// Waits for the queued updates of the stream and removes its tracker
+    /// \param streamId
+    ///
+    void RemoveStream(stream_id_t streamId);
+
+    ///
+    /// \brief Submit
+    /// \param streamId
+    /// \param regions
+    /// \param frame
+    /// \param fps
+    /// \return false if the stream doesn't exist
+    ///
+    bool Submit(stream_id_t streamId, const regions_t& regions, cv::UMat frame, float fps);
+    ///
+    /// \brief Submit
+    /// \param streamId
+    /// \param regions
+    /// \param regionEmbeddings - calculated outside of the tracker (EmbeddingsPool)
+    /// \param frame
+    /// \param fps
+    /// \return false if the stream doesn't exist
+    ///
+    bool Submit(stream_id_t streamId, const regions_t& regions, std::vector<RegionEmbedding>&& regionEmbeddings, cv::UMat frame, float fps);
+
+    ///
+    /// \brief Wait
+    /// Waits until all submitted updates are processed
+    ///
+    void Wait();
+
+private:
+    struct Task
+    {
+        regions_t m_regions;
+        std::vector<RegionEmbedding> m_regionEmbeddings;
+        bool m_hasEmbeddings = false;
+        cv::UMat m_frame;
+        float m_fps = 0;
+    };
+
+    struct Stream
+    {
+        stream_id_t m_id = 0;
+        std::unique_ptr<BaseTracker> m_tracker;
+        ResultCallback m_callback;
+        std::deque<Task> m_tasks;
+        bool m_scheduled = false; // Stream is in the ready queue or is processed by a worker
+
+        std::vector<TrackingObject> m_tracks;
+        std::vector<track_id_t> m_removedTracks;
+    };
+
+    std::map<stream_id_t, std::shared_ptr<Stream>> m_streams;
+    std::deque<std::shared_ptr<Stream>> m_readyStreams;
+    size_t m_tasksInWork = 0;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    std::condition_variable m_doneCond;
+    bool m_stop = false;
+
+    int m_ompThreadsPerWorker = 1;
+    WorkerInit m_workerInit;
+    std::vector<std::thread> m_workers;
+
+    void WorkerThread(size_t workerIndex);
+    bool Submit(stream_id_t streamId, Task&& task);
+};
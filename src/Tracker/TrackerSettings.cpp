@@ -1,5 +1,25 @@
 #include "TrackerSettings.h"
 #include <inih/INIReader.h>
+#include <fstream>
+#include <iterator>
+
+///
+/// \brief SettingsFileHash
+/// FNV-1a of the file content
+/// \param settingsFile
+/// \return
+///
+static uint64_t SettingsFileHash(const std::string& settingsFile)
+{
+    std::ifstream file(settingsFile, std::ios::binary);
+    uint64_t hash = 14695981039346656037ull;
+    for (std::istreambuf_iterator<char> it(file), end; it != end; ++it)
+    {
+        hash ^= static_cast<unsigned char>(*it);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
 
 ///
 /// \brief CarsCounting::ParseTrackerSettings
@@ -38,19 +58,76 @@ bool ParseTrackerSettings(const std::string& settingsFile, TrackerSettings& trac
         auto matchType = reader.GetInteger("tracking", "match_type", -1);
         if (matchType >= 0 && matchType < (int)tracking::MatchCount)
             trackerSettings.m_matchType = (tracking::MatchType)matchType;
+        trackerSettings.m_splitAssignment = reader.GetInteger("tracking", "split_assignment", 0) != 0;
+        trackerSettings.m_typeGroupsAssignment = reader.GetInteger("tracking", "type_groups_assignment", 0) != 0;
+        trackerSettings.m_flowWindow = reader.GetInteger("tracking", "flow_window", 0);
+        trackerSettings.m_flowBirthCost = static_cast<track_t>(reader.GetReal("tracking", "flow_birth_cost", 0.5));
 
         trackerSettings.m_useAcceleration = reader.GetInteger("tracking", "use_aceleration", 0) != 0; // Use constant acceleration motion model
+        trackerSettings.m_batchedKalman = reader.GetInteger("tracking", "batched_kalman", 0) != 0;
+        trackerSettings.m_kalmanSteadyState = reader.GetInteger("tracking", "kalman_steady_state", 0) != 0;
         trackerSettings.m_dt = static_cast<track_t>(reader.GetReal("tracking", "delta_time", 0.4));  // Delta time for Kalman filter
+        trackerSettings.m_nominalFps = static_cast<float>(reader.GetReal("tracking", "nominal_fps", 0.));
         trackerSettings.m_accelNoiseMag = static_cast<track_t>(reader.GetReal("tracking", "accel_noise", 0.2)); // Accel noise magnitude for Kalman filter
         trackerSettings.m_distThres = static_cast<track_t>(reader.GetReal("tracking", "dist_thresh", 0.8));     // Distance threshold between region and object on two frames
         trackerSettings.m_minAreaRadiusPix = static_cast<track_t>(reader.GetReal("tracking", "min_area_radius_pix", -1.));
         trackerSettings.m_minAreaRadiusK = static_cast<track_t>(reader.GetReal("tracking", "min_area_radius_k", 0.8));
+        trackerSettings.m_useSpatialGating = reader.GetInteger("tracking", "spatial_gating", 0) != 0;
+        trackerSettings.m_parallelDistMatrix = reader.GetInteger("tracking", "parallel_dist_matrix", 0) != 0;
+        trackerSettings.m_parallelTracksUpdate = reader.GetInteger("tracking", "parallel_tracks_update", 0) != 0;
+        trackerSettings.m_lostTrackPyramid = reader.GetInteger("tracking", "lost_track_pyramid", 0) != 0;
+        trackerSettings.m_lostTrackMinSize = reader.GetInteger("tracking", "lost_track_min_size", 48);
+        trackerSettings.m_lostTrackMaxSize = std::max(0, static_cast<int>(reader.GetInteger("tracking", "lost_track_max_size", 0)));
+        trackerSettings.m_processingScale = std::min(1.f, std::max(0.05f, static_cast<track_t>(reader.GetReal("tracking", "processing_scale", 1))));
+        trackerSettings.m_lostTracksMaxUpdates = reader.GetInteger("tracking", "lost_tracks_max_updates", 0);
+        trackerSettings.m_lostTracksTimeBudget = static_cast<float>(reader.GetReal("tracking", "lost_tracks_time_budget", 0.));
+        trackerSettings.m_lostTrackersPoolSize = reader.GetInteger("tracking", "lost_trackers_pool_size", 16);
         trackerSettings.m_maximumAllowedSkippedFrames = reader.GetInteger("tracking", "max_skip_frames", 50); // Maximum allowed skipped frames
         trackerSettings.m_maxTraceLength = reader.GetInteger("tracking", "max_trace_len", 50);                 // Maximum trace length
+        trackerSettings.m_traceHistoryError = static_cast<track_t>(reader.GetReal("tracking", "trace_history_error", 0.));
+        trackerSettings.m_traceHistoryLength = reader.GetInteger("tracking", "trace_history_len", 1000);
         trackerSettings.m_useAbandonedDetection = reader.GetInteger("tracking", "detect_abandoned", 0) != 0;
         trackerSettings.m_minStaticTime = reader.GetInteger("tracking", "min_static_time", 5);
         trackerSettings.m_maxStaticTime = reader.GetInteger("tracking", "max_static_time", 25);
         trackerSettings.m_maxSpeedForStatic = reader.GetInteger("tracking", "max_speed_for_static", 10);
+        trackerSettings.m_staticSnapshotMargin = static_cast<track_t>(reader.GetReal("tracking", "static_snapshot_margin", 0.1));
+        trackerSettings.m_staticSnapshotScale = static_cast<track_t>(reader.GetReal("tracking", "static_snapshot_scale", 1.));
+        trackerSettings.m_staticSnapshotsMaxMem = reader.GetInteger("tracking", "static_snapshots_max_mb", 0);
+        trackerSettings.m_staticUpdatePeriod = reader.GetInteger("tracking", "static_update_period", 0);
+        trackerSettings.m_staticMaxDiff = static_cast<track_t>(reader.GetReal("tracking", "static_max_diff", 10.));
+        trackerSettings.m_tracksMaxMem = reader.GetInteger("tracking", "tracks_max_mb", 0);
+        trackerSettings.m_bestCrops = reader.GetInteger("tracking", "best_crops", 0) != 0;
+        trackerSettings.m_bestCropsMaxSide = std::max(8, static_cast<int>(reader.GetInteger("tracking", "best_crops_max_side", 256)));
+        trackerSettings.m_bestCropsMaxMem = reader.GetInteger("tracking", "best_crops_max_mb", 64);
+        trackerSettings.m_bestCropsEncodeFps = static_cast<float>(reader.GetReal("tracking", "best_crops_encode_fps", 50.));
+        trackerSettings.m_bestCropsQuality = std::min(100, std::max(1, static_cast<int>(reader.GetInteger("tracking", "best_crops_quality", 90))));
+        auto trackIDMode = reader.GetInteger("tracking", "track_id_mode", -1);
+        if (trackIDMode >= 0 && trackIDMode < (int)tracking::IDModesCount)
+            trackerSettings.m_trackIDMode = (tracking::TrackIDMode)trackIDMode;
+        trackerSettings.m_streamID = static_cast<stream_id_t>(reader.GetInteger("tracking", "stream_id", 0));
+        trackerSettings.m_shardsCols = std::max(1, static_cast<int>(reader.GetInteger("tracking", "shards_cols", 1)));
+        trackerSettings.m_shardsRows = std::max(1, static_cast<int>(reader.GetInteger("tracking", "shards_rows", 1)));
+        trackerSettings.m_shardsOverlap = std::max(0.f, static_cast<float>(reader.GetReal("tracking", "shards_overlap", 0.1)));
+        trackerSettings.m_checkpointFile = reader.GetString("tracking", "checkpoint_file", "");
+        trackerSettings.m_checkpointPeriod = reader.GetInteger("tracking", "checkpoint_period", 25);
+        trackerSettings.m_checkpointTrace = reader.GetInteger("tracking", "checkpoint_trace", 50);
+        trackerSettings.m_checkpointRestore = reader.GetInteger("tracking", "checkpoint_restore", 0) != 0;
+        trackerSettings.m_flightRecorderSeconds = static_cast<float>(reader.GetReal("tracking", "flight_recorder_seconds", 0.));
+        trackerSettings.m_flightRecorderFrameScale = static_cast<float>(reader.GetReal("tracking", "flight_recorder_frame_scale", 0.));
+        trackerSettings.m_flightRecorderMaxMem = reader.GetInteger("tracking", "flight_recorder_max_mem", 64);
+        trackerSettings.m_flightRecorderFile = reader.GetString("tracking", "flight_recorder_file", "");
+        trackerSettings.m_flightRecorderSloMs = static_cast<float>(reader.GetReal("tracking", "flight_recorder_slo_ms", 0.));
+        trackerSettings.m_publishSnapshots = reader.GetInteger("tracking", "publish_snapshots", 0) != 0;
+        trackerSettings.m_snapshotTail = std::max(0, static_cast<int>(reader.GetInteger("tracking", "snapshot_tail", 50)));
+        trackerSettings.m_settingsHash = SettingsFileHash(settingsFile);
+        trackerSettings.m_reidGallerySize = reader.GetInteger("tracking", "reid_gallery_size", 0);
+        trackerSettings.m_reidGalleryTime = static_cast<track_t>(reader.GetReal("tracking", "reid_gallery_time", 10.));
+        trackerSettings.m_reidGalleryDist = static_cast<track_t>(reader.GetReal("tracking", "reid_gallery_dist", 0.15));
+        trackerSettings.m_embeddingsEMA = static_cast<track_t>(reader.GetReal("tracking", "embeddings_ema", 0.));
+        trackerSettings.m_embeddingsFP16 = reader.GetInteger("tracking", "embeddings_fp16", 0) != 0;
+        trackerSettings.m_embeddingsLoading = reader.GetInteger("tracking", "embeddings_loading", 1);
+        trackerSettings.m_lazyEmbeddings = reader.GetInteger("tracking", "lazy_embeddings", 0) != 0;
+        trackerSettings.m_lazyEmbeddingsIoU = static_cast<track_t>(reader.GetReal("tracking", "lazy_embeddings_iou", 0.5));
 
 
         // Read detection settings
@@ -61,12 +138,29 @@ bool ParseTrackerSettings(const std::string& settingsFile, TrackerSettings& trac
         trackerSettings.m_maxCropRatio = static_cast<track_t>(reader.GetReal("detection", "max_crop_ratio", -1));
         trackerSettings.m_maxBatch = reader.GetInteger("detection", "max_batch", 1);
         trackerSettings.m_gpuId = reader.GetInteger("detection", "gpu_id", 0);
+        trackerSettings.m_detectKeyframeInterval = std::max(1, static_cast<int>(reader.GetInteger("detection", "keyframe_interval", 1)));
+        trackerSettings.m_keyframeInterpolation = std::max(0, std::min(2, static_cast<int>(reader.GetInteger("detection", "keyframe_interpolation", 0))));
+        trackerSettings.m_detectRoiMargin = static_cast<float>(reader.GetReal("detection", "roi_margin", 0.5));
+        trackerSettings.m_detectBorderRatio = static_cast<float>(reader.GetReal("detection", "roi_border", 0.05));
+        trackerSettings.m_wakeIdlePeriod = std::max(1, static_cast<int>(reader.GetInteger("detection", "wake_idle_period", 1)));
+        trackerSettings.m_wakeMotionScale = static_cast<float>(reader.GetReal("detection", "wake_motion_scale", 0.125));
+        trackerSettings.m_wakeDiffThreshold = static_cast<int>(reader.GetInteger("detection", "wake_diff_threshold", 25));
+        trackerSettings.m_wakeMotionThreshold = static_cast<float>(reader.GetReal("detection", "wake_motion_threshold", 0.001));
+        trackerSettings.m_roiPolygon = reader.GetString("detection", "roi_polygon", "");
+        trackerSettings.m_excludePolygon = reader.GetString("detection", "exclude_polygon", "");
         trackerSettings.m_netType = reader.GetString("detection", "net_type", "YOLOV4_TINY");
         trackerSettings.m_inferencePrecison = reader.GetString("detection", "inference_precison", "FP16");
         trackerSettings.m_detectorBackend = reader.GetInteger("detection", "detector_backend", (int)tracking::Detectors::DNN_OCV);
         trackerSettings.m_dnnTarget = reader.GetString("detection", "ocv_dnn_target", "DNN_TARGET_CPU");
         trackerSettings.m_dnnBackend = reader.GetString("detection", "ocv_dnn_backend", "DNN_BACKEND_OPENCV");
 
+        // Read execution settings
+        auto execBackend = reader.GetInteger("execution", "backend", -1);
+        if (execBackend >= 0 && execBackend < (int)exec::Backend::BackendsCount)
+            trackerSettings.m_execPolicy.m_backend = (exec::Backend)execBackend;
+        trackerSettings.m_execPolicy.m_openclDevice = reader.GetString("execution", "opencl_device", "");
+        trackerSettings.m_execPolicy.m_logTransfers = reader.GetInteger("execution", "log_transfers", 0) != 0;
+
         res = true;
     }
     std::cout << "ParseTrackerSettings: " << res << std::endl;
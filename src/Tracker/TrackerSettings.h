@@ -1,9 +1,13 @@
 #pragma once
 #include <vector>
 #include <array>
+#include <memory>
 #include <numeric>
 
 #include "defines.h"
+#include "execution_policy.h"
+
+class TrackIDAllocator;
 // ----------------------------------------------------------------------
 
 ///
@@ -20,6 +24,33 @@ struct TrackerSettings
     tracking::LostTrackType m_lostTrackType = tracking::TrackKCF; // Used if m_filterGoal == tracking::FilterRect
     tracking::MatchType m_matchType = tracking::MatchHungrian;
 
+    ///
+    /// \brief m_splitAssignment
+    /// Split the assignment problem on the independent groups of tracks and regions with distance less than m_distThres
+    ///
+    bool m_splitAssignment = false;
+
+    ///
+    /// \brief m_typeGroupsAssignment
+    /// Tracks and regions are partitioned on the groups of the compatible types by CheckType,
+    /// every group is solved by own solver in parallel
+    ///
+    bool m_typeGroupsAssignment = false;
+
+    ///
+    /// \brief m_flowWindow
+    /// Frames in the sliding window of the global association by the min-cost flow, the tracks are reported
+    /// with the lag of m_flowWindow - 1 frames. 0 or 1 - online tracker with the frame by frame assignment
+    ///
+    size_t m_flowWindow = 0;
+
+    ///
+    /// \brief m_flowBirthCost
+    /// Cost of the new trajectory in the window, every detection on the trajectory gives -1.
+    /// Detections are linked only with the cost less than m_flowBirthCost
+    ///
+    track_t m_flowBirthCost = 0.5f;
+
 	std::array<track_t, tracking::DistsCount> m_distType;
 
     ///
@@ -27,6 +58,12 @@ struct TrackerSettings
     /// Time step for Kalman
     ///
     track_t m_dt = 1.0f;
+    ///
+    /// \brief m_nominalFps
+    /// Frame rate of the stream for the updates by the timestamps: m_dt is the time step of one frame of this rate.
+    /// 0 - the minimal interval between the timestamps
+    ///
+    float m_nominalFps = 0.f;
 
     ///
     /// \brief m_accelNoiseMag
@@ -40,6 +77,19 @@ struct TrackerSettings
 	///
 	bool m_useAcceleration = false;
 
+	///
+	/// \brief m_batchedKalman
+	/// Linear Kalman filters with constant velocity of all tracks are stored together and predicted in one pass
+	///
+	bool m_batchedKalman = false;
+
+	///
+	/// \brief m_kalmanSteadyState
+	/// Linear Kalman filter of the track uses the cached steady state gain after the covariance convergence.
+	/// Full update returns after the missed detection or the change of the time step
+	///
+	bool m_kalmanSteadyState = false;
+
     ///
     /// \brief m_distThres
     /// Distance threshold for Assignment problem: from 0 to 1
@@ -58,6 +108,72 @@ struct TrackerSettings
 	///
 	track_t m_minAreaRadiusK = 0.5f;
 
+	///
+	/// \brief m_useSpatialGating
+	/// Calculate distances only for regions with centers inside the bounding box of the track prediction area.
+	/// All other pairs will have forbidden cost
+	///
+	bool m_useSpatialGating = false;
+
+	///
+	/// \brief m_parallelDistMatrix
+	/// Calculate rows of the distance matrix in parallel (OpenMP), one row per track
+	///
+	bool m_parallelDistMatrix = false;
+
+	///
+	/// \brief m_parallelTracksUpdate
+	/// Update tracks in parallel (OpenMP): Kalman filters and trackers for the lost objects (KCF, CSRT, STAPLE, LDES etc)
+	///
+	bool m_parallelTracksUpdate = false;
+
+	///
+	/// \brief m_lostTrackPyramid
+	/// Trackers for the lost objects share the image pyramid of the frame, each tracker works on the level
+	/// where the object side is about m_lostTrackMinSize
+	///
+	bool m_lostTrackPyramid = false;
+
+	///
+	/// \brief m_lostTrackMinSize
+	/// Minimal side of the object in pixels on the pyramid level of its tracker
+	///
+	int m_lostTrackMinSize = 48;
+
+	///
+	/// \brief m_lostTrackMaxSize
+	/// Maximal side of the object in pixels on the frame of its visual tracker, 0 - not limited.
+	/// The large object is tracked on the level of the shared pyramid, so the time of its tracker doesn't grow with its size
+	///
+	int m_lostTrackMaxSize = 0;
+
+	///
+	/// \brief m_processingScale
+	/// The histograms, the embeddings, the static checks and the visual trackers work on the frame resized on this scale,
+	/// the regions and the tracks stay in the coordinates of the original frame. (0, 1], 1 - the original resolution
+	///
+	track_t m_processingScale = 1.f;
+
+	///
+	/// \brief m_lostTracksMaxUpdates
+	/// Maximum count of the visual trackers updates for the lost tracks per frame, 0 - without limit.
+	/// Tracks with the lower priority are only predicted by Kalman on this frame
+	///
+	size_t m_lostTracksMaxUpdates = 0;
+
+	///
+	/// \brief m_lostTracksTimeBudget
+	/// Time in milliseconds for the tracks update per frame after which the lost tracks aren't updated by the visual trackers, 0 - without limit
+	///
+	float m_lostTracksTimeBudget = 0.f;
+
+	///
+	/// \brief m_lostTrackersPoolSize
+	/// Maximum count of the released OpenCV trackers (KCF, MIL, GOTURN, CSRT, ...) kept for the reuse by the next lost tracks,
+	/// 0 - tracker is created for every lost track
+	///
+	size_t m_lostTrackersPoolSize = 16;
+
     ///
     /// \brief m_maximumAllowedSkippedFrames
     /// If the object don't assignment more than this frames then it will be removed
@@ -69,6 +185,17 @@ struct TrackerSettings
     /// The maximum trajectory length
     ///
     size_t m_maxTraceLength = 50;
+    ///
+    /// \brief m_traceHistoryError
+    /// The points older than m_maxTraceLength are simplified to the history of the key points with this error in pixels,
+    /// see Trace::SetHistory. 0 - the old points are removed
+    ///
+    track_t m_traceHistoryError = 0;
+    ///
+    /// \brief m_traceHistoryLength
+    /// Maximum count of the key points of the history, 0 - without limit
+    ///
+    size_t m_traceHistoryLength = 1000;
 
     ///
     /// \brief m_useAbandonedDetection
@@ -92,6 +219,176 @@ struct TrackerSettings
     /// If speed of object is more that this value than object is non static
     ///
     int m_maxSpeedForStatic = 10;
+    ///
+    /// \brief m_staticSnapshotMargin
+    /// Snapshot of the static object is its rectangle with this margin in parts of the object size
+    ///
+    track_t m_staticSnapshotMargin = 0.1f;
+    ///
+    /// \brief m_staticSnapshotScale
+    /// Resolution of the static object snapshot relative to the frame, (0, 1]
+    ///
+    track_t m_staticSnapshotScale = 1.f;
+    ///
+    /// \brief m_staticSnapshotsMaxMem
+    /// Memory limit in MB for the snapshots of all static objects, 0 - without limit
+    ///
+    size_t m_staticSnapshotsMaxMem = 0;
+    ///
+    /// \brief m_staticUpdatePeriod
+    /// Static tracks take part in the full association (cost matrix, Kalman, visual trackers) only every N frames, on the other frames
+    /// they are checked by the difference with the snapshot and by the overlapped regions. 0 or 1 - every frame
+    ///
+    int m_staticUpdatePeriod = 0;
+    ///
+    /// \brief m_staticMaxDiff
+    /// Maximum mean absolute difference between the snapshot of the static object and the frame, it's "still there"
+    ///
+    track_t m_staticMaxDiff = 10.f;
+    ///
+    /// \brief m_tracksMaxMem
+    /// Memory budget in MB of all tracks: trajectories, histograms, embeddings, snapshots and the visual trackers.
+    /// Over the budget the trajectories are shortened, then the histograms and the visual trackers are released
+    /// starting from the lost and the oldest tracks. 0 - without limit
+    ///
+    size_t m_tracksMaxMem = 0;
+
+    ///
+    /// \brief m_bestCrops
+    /// Best crop of the every track by the confidence, the size and the sharpness, it's encoded to JPEG in the background, see BaseTracker::GetTrackCrops
+    ///
+    bool m_bestCrops = false;
+    ///
+    /// \brief m_bestCropsMaxSide
+    /// Crops are downscaled to this max side in pixels
+    ///
+    int m_bestCropsMaxSide = 256;
+    ///
+    /// \brief m_bestCropsMaxMem
+    /// Memory limit in MB of the not encoded crops of all trackers in the process, 0 - without limit
+    ///
+    size_t m_bestCropsMaxMem = 64;
+    ///
+    /// \brief m_bestCropsEncodeFps
+    /// Max JPEG encodings per second of all trackers in the process: the crops over it wait, 0 - without limit
+    ///
+    float m_bestCropsEncodeFps = 50.f;
+    ///
+    /// \brief m_bestCropsQuality
+    /// JPEG quality of the crops
+    ///
+    int m_bestCropsQuality = 90;
+
+    ///
+    /// \brief m_trackIDMode
+    /// Allocation of the track IDs: tracker own counter, process wide counter or (m_streamID, sequence) packed ID
+    ///
+    tracking::TrackIDMode m_trackIDMode = tracking::IDLocal;
+    ///
+    /// \brief m_streamID
+    /// Stream (camera) ID for tracking::IDPacked, it must be unique in the cluster. TrackerPool adds the ID of the stream
+    ///
+    stream_id_t m_streamID = 0;
+    ///
+    /// \brief m_trackIDAllocator
+    /// Custom allocator of the track IDs, it's used instead of m_trackIDMode if isn't empty. Can be shared by the trackers
+    ///
+    std::shared_ptr<TrackIDAllocator> m_trackIDAllocator;
+
+    ///
+    /// \brief m_shardsCols, m_shardsRows
+    /// Grid of the spatial shards of the frame for the huge views: the every shard is tracked by the own tracker in parallel,
+    /// the tracks cross the borders with the same ID, see ShardedTracker. 1 x 1 - one tracker of the frame
+    ///
+    int m_shardsCols = 1;
+    int m_shardsRows = 1;
+    ///
+    /// \brief m_shardsOverlap
+    /// Overlap of the neighbour shards in the parts of the shard size, it must be larger than the objects crossing the borders
+    ///
+    float m_shardsOverlap = 0.1f;
+
+    ///
+    /// \brief m_checkpointFile
+    /// File of the tracker state for the restart or the failover to the standby process, it's written in the background.
+    /// Empty - without the checkpoints
+    ///
+    std::string m_checkpointFile;
+    ///
+    /// \brief m_checkpointPeriod
+    /// Period of the checkpoints in the updates of the tracker
+    ///
+    int m_checkpointPeriod = 25;
+    ///
+    /// \brief m_checkpointTrace
+    /// Last points of the trajectories in the checkpoint
+    ///
+    size_t m_checkpointTrace = 50;
+    ///
+    /// \brief m_checkpointRestore
+    /// The new tracker continues the tracks and the IDs of m_checkpointFile if it exists
+    ///
+    bool m_checkpointRestore = false;
+
+    ///
+    /// \brief m_flightRecorderSeconds
+    /// Last seconds of the tracker inputs (regions, embeddings, timestamps) in the ring of the flight recorder, see FlightRecorder.h.
+    /// 0 - without the recorder
+    ///
+    float m_flightRecorderSeconds = 0.f;
+    ///
+    /// \brief m_flightRecorderFrameScale
+    /// Scale of the recorded frames for the visual trackers on the replay, 0 - without the frames
+    ///
+    float m_flightRecorderFrameScale = 0.f;
+    ///
+    /// \brief m_flightRecorderMaxMem
+    /// Memory limit of the ring in megabytes, the oldest updates are dropped. 0 - only the time limit
+    ///
+    size_t m_flightRecorderMaxMem = 64;
+    ///
+    /// \brief m_flightRecorderFile
+    /// Dump on demand, the dumps by the SLO are <file without .mtfr>_<N>.mtfr
+    ///
+    std::string m_flightRecorderFile;
+    ///
+    /// \brief m_flightRecorderSloMs
+    /// The Update with the larger latency dumps the ring, 0 - the dumps only on demand
+    ///
+    float m_flightRecorderSloMs = 0.f;
+
+    ///
+    /// \brief m_publishSnapshots
+    /// The Update publishes the immutable snapshot of the tracks for the readers of the other threads, see BaseTracker::GetSnapshot
+    ///
+    bool m_publishSnapshots = false;
+    ///
+    /// \brief m_snapshotTail
+    /// Last points of the trajectories in the snapshot
+    ///
+    size_t m_snapshotTail = 50;
+    ///
+    /// \brief m_settingsHash
+    /// Hash of the ini file by ParseTrackerSettings, the replay of the flight record checks it. 0 - unknown
+    ///
+    uint64_t m_settingsHash = 0;
+
+    ///
+    /// \brief m_reidGallerySize
+    /// Capacity of the gallery of the removed tracks signatures: the new track with the close embedding takes the ID of the removed track.
+    /// 0 - without the re-identification
+    ///
+    size_t m_reidGallerySize = 0;
+    ///
+    /// \brief m_reidGalleryTime
+    /// Lifetime in seconds of the signature in the gallery
+    ///
+    track_t m_reidGalleryTime = 10.f;
+    ///
+    /// \brief m_reidGalleryDist
+    /// Maximum cosine distance between the new region and the removed track
+    ///
+    track_t m_reidGalleryDist = 0.15f;
 
 	///
 	/// \brief m_nearTypes
@@ -125,6 +422,55 @@ struct TrackerSettings
     ///
     int m_gpuId = 0;
 
+    ///
+    /// \brief m_detectKeyframeInterval
+    /// The full frame is detected on the every m_detectKeyframeInterval frame, the frames between them
+    /// only around the predicted tracks and near the borders. 1 - the full frame detection on the every frame
+    ///
+    int m_detectKeyframeInterval = 1;
+
+    ///
+    /// \brief m_keyframeInterpolation
+    /// Output of the frames between the keyframes: 0 - they are detected around the predicted tracks and tracked,
+    /// 1 - they aren't detected and tracked, their tracks are extrapolated from the last update by the velocity,
+    /// 2 - the same but the results log gets the tracks interpolated between the keyframes after the next one
+    ///
+    int m_keyframeInterpolation = 0;
+
+    ///
+    /// \brief m_detectRoiMargin
+    /// The predicted area of the track is expanded on this part of its size from the every side
+    ///
+    float m_detectRoiMargin = 0.5f;
+
+    ///
+    /// \brief m_detectBorderRatio
+    /// Width of the frame borders detected between the keyframes in the part of the min frame side
+    ///
+    float m_detectBorderRatio = 0.05f;
+
+    ///
+    /// \brief m_wakeIdlePeriod
+    /// Without the tracks and the motion on the low resolution frames difference only the every m_wakeIdlePeriod frame
+    /// is detected and tracked. 1 - the every frame is processed
+    ///
+    int m_wakeIdlePeriod = 1;
+
+    ///
+    /// \brief m_wakeMotionScale, m_wakeDiffThreshold, m_wakeMotionThreshold
+    /// Scale of the difference frame, min brightness difference of the changed pixel and min part of the changed pixels for the motion
+    ///
+    float m_wakeMotionScale = 0.125f;
+    int m_wakeDiffThreshold = 25;
+    float m_wakeMotionThreshold = 0.001f;
+
+    ///
+    /// \brief m_roiPolygon, m_excludePolygon
+    /// Static detection mask: "x0,y0;x1,y1;x2,y2" in pixels or in the parts of the frame, some polygons are separated by '|'
+    ///
+    std::string m_roiPolygon;
+    std::string m_excludePolygon;
+
     ///
     /// YOLOV2
     /// YOLOV3
@@ -164,6 +510,11 @@ struct TrackerSettings
     // DNN_BACKEND_INFERENCE_ENGINE_NN_BUILDER_2019
     std::string m_dnnBackend = "DNN_BACKEND_OPENCV";
 
+    ///
+    /// \brief m_execPolicy
+    /// CPU or OpenCL for the UMat code paths of the all pipeline stages, see exec::ScopedStage
+    ///
+    exec::Policy m_execPolicy;
 
     ///
     struct EmbeddingParams
@@ -185,12 +536,51 @@ struct TrackerSettings
 		///
 		std::vector<ObjectTypes> m_objectTypes;
 
+		///
+		/// \brief m_maxBatch
+		/// Maximal number of the regions in one forward pass, 1 - forward for each region.
+		/// Network must support the dynamic batch size
+		///
+		size_t m_maxBatch = 1;
+
+		///
+		/// \brief m_dnnTarget
+		/// The same values as m_dnnTarget for the detector: DNN_TARGET_CPU, DNN_TARGET_CUDA_FP16, DNN_TARGET_MYRIAD etc
+		///
+		std::string m_dnnTarget = "DNN_TARGET_CPU";
+		///
+		/// \brief m_dnnBackend
+		/// The same values as m_dnnBackend for the detector: DNN_BACKEND_OPENCV, DNN_BACKEND_CUDA, DNN_BACKEND_INFERENCE_ENGINE etc
+		///
+		std::string m_dnnBackend = "DNN_BACKEND_INFERENCE_ENGINE";
+
+		///
+		/// \brief m_interpolation
+		/// Resize of the crops to the input layer: cv::INTER_LINEAR, cv::INTER_AREA, cv::INTER_LANCZOS4 etc
+		///
+		int m_interpolation = cv::INTER_LINEAR;
+		///
+		/// \brief m_scale, m_mean, m_swapRB
+		/// Normalization of the input: (pixel - m_mean) * m_scale in the BGR or RGB order, as in cv::dnn::blobFromImage
+		///
+		double m_scale = 1.;
+		cv::Scalar m_mean;
+		bool m_swapRB = false;
+
+		///
+		/// \brief m_embeddingSpace
+		/// Name of the feature space of the network: after the hot swap to the network of the same space (the backward compatible training
+		/// with the same output size) the tracks keep their signatures and the re-ID gallery. Empty - the network is compatible only with itself
+		///
+		std::string m_embeddingSpace;
+
 		EmbeddingParams(const std::string& embeddingCfgName, const std::string& embeddingWeightsName,
-			const cv::Size& inputLayer, const std::vector<ObjectTypes>& objectTypes)
+			const cv::Size& inputLayer, const std::vector<ObjectTypes>& objectTypes, size_t maxBatch = 1)
 			: m_embeddingCfgName(embeddingCfgName),
 			m_embeddingWeightsName(embeddingWeightsName),
 			m_inputLayer(inputLayer),
-			m_objectTypes(objectTypes)
+			m_objectTypes(objectTypes),
+			m_maxBatch(maxBatch)
 		{
 			assert(!m_objectTypes.empty());
 		}
@@ -198,6 +588,37 @@ struct TrackerSettings
 	///
 	std::vector<EmbeddingParams> m_embeddings;
 
+	///
+	/// \brief m_embeddingsEMA
+	/// Weight of the accumulated re-ID signature of the track in the exponential moving average, 0 - the last embedding only
+	///
+	track_t m_embeddingsEMA = 0.f;
+
+	///
+	/// \brief m_embeddingsFP16
+	/// Re-ID signatures of the tracks are stored in half precision
+	///
+	bool m_embeddingsFP16 = false;
+
+	///
+	/// \brief m_embeddingsLoading
+	/// When the embeddings networks are loaded: 0 - in the tracker constructor, 1 - in the background threads started by the constructor,
+	/// 2 - on the first region of the object type, so the networks of the never detected types aren't loaded
+	///
+	int m_embeddingsLoading = 1;
+
+	///
+	/// \brief m_lazyEmbeddings
+	/// Embeddings are calculated only for the regions without the track candidate (new tracks) and for the ambiguous ones:
+	/// several candidates with the IoU distance less than m_distThres. The one to one pairs with IoU >= m_lazyEmbeddingsIoU are matched without re-ID
+	///
+	bool m_lazyEmbeddings = false;
+	///
+	/// \brief m_lazyEmbeddingsIoU
+	/// Minimal IoU of the unambiguous pair for the m_lazyEmbeddings
+	///
+	track_t m_lazyEmbeddingsIoU = 0.5f;
+
 	///
 	TrackerSettings()
 	{
@@ -0,0 +1,145 @@
+#pragma once
+#include <vector>
+#include "defines.h"
+
+///
+/// \brief DistEllipse
+/// If result <= 1 then the point is inside ellipse: center, semi-axes = size, angle in radians
+/// \param pt
+/// \param rrect
+/// \return
+///
+inline track_t DistEllipse(const Point_t& pt, const cv::RotatedRect& rrect)
+{
+    Point_t pt_(pt.x - rrect.center.x, pt.y - rrect.center.y);
+    track_t r = sqrtf(pt_.x * pt_.x + pt_.y * pt_.y);
+    track_t t = (r > 1) ? acosf(pt_.x / r) : 0;
+    track_t t_ = t - rrect.angle;
+    Point_t pt_rotated(r * cosf(t_), r * sinf(t_));
+
+    return (pt_rotated.x * pt_rotated.x) / (rrect.size.width * rrect.size.width) + (pt_rotated.y * pt_rotated.y) / (rrect.size.height * rrect.size.height);
+}
+
+///
+/// \brief The EllipseTransform struct
+/// Prediction ellipse with the precomputed rotation and inverse squared semi-axes
+///
+struct EllipseTransform
+{
+    Point_t m_center;
+    track_t m_cosA = 1;
+    track_t m_sinA = 0;
+    track_t m_invW2 = 1;
+    track_t m_invH2 = 1;
+
+    ///
+    EllipseTransform() = default;
+    ///
+    EllipseTransform(const cv::RotatedRect& rrect)
+        : m_center(rrect.center),
+          m_cosA(cosf(rrect.angle)),
+          m_sinA(sinf(rrect.angle)),
+          m_invW2(1.f / (rrect.size.width * rrect.size.width)),
+          m_invH2(1.f / (rrect.size.height * rrect.size.height))
+    {
+    }
+};
+
+///
+/// \brief DistEllipse
+/// The same value as DistEllipse(pt, rrect) without the trigonometry for each point
+/// \param pt
+/// \param ellipse - transform of the rrect
+/// \return
+///
+inline track_t DistEllipse(const Point_t& pt, const EllipseTransform& ellipse)
+{
+    track_t x = pt.x - ellipse.m_center.x;
+    track_t y = pt.y - ellipse.m_center.y;
+    // The angle of the point is acosf(x / r) in [0, pi] for r > 1 and 0 otherwise
+    if (x * x + y * y > 1)
+    {
+        y = fabsf(y);
+    }
+    else
+    {
+        x = sqrtf(x * x + y * y);
+        y = 0;
+    }
+    const track_t xr = x * ellipse.m_cosA + y * ellipse.m_sinA;
+    const track_t yr = y * ellipse.m_cosA - x * ellipse.m_sinA;
+
+    return xr * xr * ellipse.m_invW2 + yr * yr * ellipse.m_invH2;
+}
+
+///
+/// \brief SizeRatio
+/// Ratio of the smaller value to the bigger, [0, 1]
+/// \param v1
+/// \param v2
+/// \return
+///
+inline track_t SizeRatio(track_t v1, track_t v2)
+{
+    return (v1 < v2) ? (v1 / v2) : (v2 / v1);
+}
+
+///
+/// \brief DistJaccard
+/// 1 - IoU of two rectangles, [0, 1]
+/// \param r1
+/// \param r2
+/// \return
+///
+inline track_t DistJaccard(const cv::Rect& r1, const cv::Rect& r2)
+{
+    track_t intArea = static_cast<track_t>((r1 & r2).area());
+    track_t unionArea = static_cast<track_t>(r1.area() + r2.area() - intArea);
+
+    return 1 - intArea / unionArea;
+}
+
+///
+/// \brief The TracksHotStore struct
+/// Structure of arrays with the track data used by the distance calculation. It's refreshed from the tracks
+/// once per frame, so cost kernels work with contiguous memory and don't touch the heavy CTrack objects
+///
+struct TracksHotStore
+{
+    std::vector<cv::RotatedRect> m_predictedAreas; // Ellipses with prediction and velocity
+    std::vector<EllipseTransform> m_ellipses;      // Transforms of the predicted areas
+    std::vector<cv::Size2f> m_lastSizes;
+    std::vector<cv::Rect> m_lastBRects;
+    std::vector<objtype_t> m_types;
+
+    ///
+    void Resize(size_t tracksCount)
+    {
+        m_predictedAreas.resize(tracksCount);
+        m_ellipses.resize(tracksCount);
+        m_lastSizes.resize(tracksCount);
+        m_lastBRects.resize(tracksCount);
+        m_types.resize(tracksCount);
+    }
+
+    ///
+    size_t Size() const
+    {
+        return m_types.size();
+    }
+
+    ///
+    /// \brief Set
+    /// \param i
+    /// \param lastRegion - last assigned region of the track
+    /// \param predictedArea
+    ///
+    void Set(size_t i, const CRegion& lastRegion, const cv::RotatedRect& predictedArea)
+    {
+        m_predictedAreas[i] = predictedArea;
+        m_ellipses[i] = EllipseTransform(predictedArea);
+        m_lastSizes[i] = lastRegion.m_rrect.size;
+        m_lastBRects[i] = lastRegion.m_brect;
+        m_types[i] = lastRegion.m_type;
+    }
+};
@@ -0,0 +1,416 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include "defines.h"
+
+///
+/// \brief The UnscentedKalman class
+/// Interface of the unscented Kalman filter with the constant acceleration model
+///
+class UnscentedKalman
+{
+public:
+    virtual ~UnscentedKalman() = default;
+
+    ///
+    /// \brief Predict
+    /// \param deltaTime - time step of the transition
+    /// \return A priori state: StateDim() values
+    ///
+    virtual const track_t* Predict(track_t deltaTime) = 0;
+    ///
+    /// \brief Correct
+    /// \param meas - x, y for the point model and x, y, width, height for the rect model
+    /// \return A posteriori state: StateDim() values
+    ///
+    virtual const track_t* Correct(const track_t* meas) = 0;
+
+    ///
+    /// \brief State
+    /// \return The last state
+    ///
+    virtual const track_t* State() const = 0;
+    ///
+    /// \brief GetState
+    /// \param state - StateDim() values of the a posteriori state
+    /// \param errorCov - StateDim() x StateDim() values of the a posteriori error covariance
+    ///
+    virtual void GetState(track_t* state, track_t* errorCov) const = 0;
+    ///
+    /// \brief SetState
+    /// \param state
+    /// \param errorCov
+    ///
+    virtual void SetState(const track_t* state, const track_t* errorCov) = 0;
+    ///
+    /// \brief StateDim
+    /// \return
+    ///
+    virtual int StateDim() const = 0;
+};
+
+///
+/// \brief The UnscentedModel class
+/// Unscented Kalman filter with the compile-time dimensions and the same model as the opencv_contrib filter:
+/// the state is x, y, vx, vy, ax, ay for the point and x, y, vx, vy, ax, ay, width, height for the rect.
+/// The sigma points are stored by components: every row of the workspace is one component of the all sigma points,
+/// so the transition and the weighted sums are the loops over the contiguous lanes without the calls per point.
+/// The all matrices are members and the filter doesn't allocate after the construction.
+/// The augmented variant adds the process and the measurement noises to the state of the sigma points
+///
+template<int STATE_DIM, int MEAS_DIM, bool AUGMENTED>
+class UnscentedModel final : public UnscentedKalman
+{
+public:
+    static_assert(STATE_DIM == 6 || STATE_DIM == 8, "Point or rect state with the acceleration");
+    static_assert(MEAS_DIM == STATE_DIM - 4, "Measurement is the position, for the rect with the size");
+
+    static constexpr int AUG_DIM = AUGMENTED ? (2 * STATE_DIM + MEAS_DIM) : STATE_DIM;
+    static constexpr int SIGMAS = 2 * AUG_DIM + 1;
+
+    typedef cv::Matx<track_t, STATE_DIM, 1> state_t;
+    typedef cv::Matx<track_t, MEAS_DIM, 1> meas_t;
+    typedef cv::Matx<track_t, STATE_DIM, STATE_DIM> state_mat_t;
+    typedef cv::Matx<track_t, MEAS_DIM, MEAS_DIM> meas_mat_t;
+
+    ///
+    /// \brief UnscentedModel
+    /// \param state0 - STATE_DIM values
+    /// \param processNoise - STATE_DIM values of the diagonal process noise covariance
+    /// \param measNoise - measurement noise covariance is measNoise * I
+    /// \param errorCov - a posteriori error covariance is errorCov * I
+    /// \param alpha - spread of the sigma points
+    /// \param beta - prior knowledge of the distribution, 2 for the gaussian
+    /// \param kappa - secondary scaling
+    ///
+    UnscentedModel(const track_t* state0, const track_t* processNoise, track_t measNoise, track_t errorCov,
+                   double alpha = 1., double beta = 2., double kappa = -2.)
+        : m_processNoise(state_mat_t::zeros()),
+          m_measNoise(meas_mat_t::eye() * measNoise),
+          m_state(state0),
+          m_errorCov(state_mat_t::eye() * errorCov)
+    {
+        for (int i = 0; i < STATE_DIM; ++i)
+        {
+            m_processNoise(i, i) = processNoise[i];
+        }
+
+        const double lambda = alpha * alpha * (AUG_DIM + kappa) - AUG_DIM;
+        m_spread = static_cast<track_t>(std::sqrt(AUG_DIM + lambda));
+        m_weightsMean[0] = static_cast<track_t>(lambda / (AUG_DIM + lambda));
+        m_weightsCov[0] = static_cast<track_t>(lambda / (AUG_DIM + lambda) + 1. - alpha * alpha + beta);
+        for (int j = 1; j < SIGMAS; ++j)
+        {
+            m_weightsMean[j] = static_cast<track_t>(1. / (2. * (AUG_DIM + lambda)));
+            m_weightsCov[j] = m_weightsMean[j];
+        }
+    }
+
+    ///
+    const track_t* Predict(track_t deltaTime) override
+    {
+        BuildSigmas(m_errorCov);
+        Transition(deltaTime);
+
+        m_state = Mean<STATE_DIM>(m_sigmas.val);
+        Deviations();
+        m_errorCov = Covariance<STATE_DIM, STATE_DIM>(m_deviations.val, m_deviations.val);
+        if (!AUGMENTED)
+            m_errorCov += m_processNoise;
+        m_predicted = true;
+        return m_state.val;
+    }
+
+    ///
+    const track_t* Correct(const track_t* meas) override
+    {
+        // The additive variant draws the sigma points again from the predicted covariance with the process noise
+        if (!AUGMENTED || !m_predicted)
+        {
+            BuildSigmas(m_errorCov);
+            Deviations();
+        }
+        m_predicted = false;
+
+        // Sigma points in the measurement space: the position and the size rows with the measurement noise
+        for (int m = 0; m < MEAS_DIM; ++m)
+        {
+            const track_t* stateRow = m_sigmas.val + MeasRow(m) * SIGMAS;
+            track_t* measRow = m_measSigmas.val + m * SIGMAS;
+            if (AUGMENTED)
+            {
+                const track_t* noiseRow = m_sigmas.val + (2 * STATE_DIM + m) * SIGMAS;
+                for (int j = 0; j < SIGMAS; ++j)
+                {
+                    measRow[j] = stateRow[j] + noiseRow[j];
+                }
+            }
+            else
+            {
+                std::copy(stateRow, stateRow + SIGMAS, measRow);
+            }
+        }
+        const meas_t measMean = Mean<MEAS_DIM>(m_measSigmas.val);
+        for (int m = 0; m < MEAS_DIM; ++m)
+        {
+            track_t* measRow = m_measSigmas.val + m * SIGMAS;
+            for (int j = 0; j < SIGMAS; ++j)
+            {
+                measRow[j] -= measMean.val[m];
+            }
+        }
+
+        meas_mat_t s = Covariance<MEAS_DIM, MEAS_DIM>(m_measSigmas.val, m_measSigmas.val);
+        if (!AUGMENTED)
+            s += m_measNoise;
+        const gain_t crossCov = Covariance<STATE_DIM, MEAS_DIM>(m_deviations.val, m_measSigmas.val);
+
+        // K = Pxz * S^-1, S is symmetric positive definite
+        const gain_t gain = crossCov * s.inv(cv::DECOMP_CHOLESKY);
+
+        m_state += gain * (meas_t(meas) - measMean);
+        m_errorCov -= gain * s * gain.t();
+        return m_state.val;
+    }
+
+    ///
+    const track_t* State() const override
+    {
+        return m_state.val;
+    }
+
+    ///
+    void GetState(track_t* state, track_t* errorCov) const override
+    {
+        std::copy(m_state.val, m_state.val + STATE_DIM, state);
+        std::copy(m_errorCov.val, m_errorCov.val + STATE_DIM * STATE_DIM, errorCov);
+    }
+
+    ///
+    void SetState(const track_t* state, const track_t* errorCov) override
+    {
+        m_state = state_t(state);
+        m_errorCov = state_mat_t(errorCov);
+        m_predicted = false;
+    }
+
+    ///
+    int StateDim() const override
+    {
+        return STATE_DIM;
+    }
+
+private:
+    typedef cv::Matx<track_t, STATE_DIM, MEAS_DIM> gain_t;
+    typedef cv::Matx<track_t, AUG_DIM, AUG_DIM> aug_mat_t;
+
+    state_mat_t m_processNoise;
+    meas_mat_t m_measNoise;
+
+    state_t m_state;
+    state_mat_t m_errorCov;
+    bool m_predicted = false;     // The propagated sigma points are valid for the correction
+
+    track_t m_spread = 1;         // sqrt(AUG_DIM + lambda)
+    track_t m_weightsMean[SIGMAS];
+    track_t m_weightsCov[SIGMAS];
+
+    // Workspace
+    aug_mat_t m_augCov;
+    aug_mat_t m_sqrtCov;
+    cv::Matx<track_t, AUG_DIM, SIGMAS> m_sigmas;             // Row per component
+    cv::Matx<track_t, STATE_DIM, SIGMAS> m_deviations;       // Sigma points minus the mean state
+    cv::Matx<track_t, MEAS_DIM, SIGMAS> m_measSigmas;
+
+    ///
+    /// \brief MeasRow
+    /// \return Row of the state with the measured component
+    ///
+    static constexpr int MeasRow(int m)
+    {
+        return (m < 2) ? m : (m + 4);
+    }
+
+    ///
+    /// \brief BuildSigmas
+    /// Sigma points of the state and the noises: the mean and the mean -+ the columns of sqrt((L + lambda) * P)
+    /// \param errorCov
+    ///
+    void BuildSigmas(const state_mat_t& errorCov)
+    {
+        m_augCov = aug_mat_t::zeros();
+        for (int r = 0; r < STATE_DIM; ++r)
+        {
+            for (int c = 0; c < STATE_DIM; ++c)
+            {
+                m_augCov(r, c) = errorCov(r, c);
+            }
+        }
+        if (AUGMENTED)
+        {
+            for (int i = 0; i < STATE_DIM; ++i)
+            {
+                m_augCov(STATE_DIM + i, STATE_DIM + i) = m_processNoise(i, i);
+            }
+            for (int i = 0; i < MEAS_DIM; ++i)
+            {
+                m_augCov(2 * STATE_DIM + i, 2 * STATE_DIM + i) = m_measNoise(i, i);
+            }
+        }
+        Cholesky();
+
+        for (int r = 0; r < AUG_DIM; ++r)
+        {
+            const track_t mean = (r < STATE_DIM) ? m_state.val[r] : 0;
+            track_t* row = m_sigmas.val + r * SIGMAS;
+            const track_t* sqrtRow = m_sqrtCov.val + r * AUG_DIM;
+            row[0] = mean;
+            for (int c = 0; c < AUG_DIM; ++c)
+            {
+                row[1 + c] = mean + m_spread * sqrtRow[c];
+                row[1 + AUG_DIM + c] = mean - m_spread * sqrtRow[c];
+            }
+        }
+    }
+
+    ///
+    /// \brief Cholesky
+    /// Lower triangular m_sqrtCov with m_sqrtCov * m_sqrtCov^T = m_augCov. When the covariance has lost
+    /// the positive definiteness from the rounding the square roots of the diagonal are used
+    ///
+    void Cholesky()
+    {
+        m_sqrtCov = aug_mat_t::zeros();
+        for (int c = 0; c < AUG_DIM; ++c)
+        {
+            double diag = m_augCov(c, c);
+            for (int k = 0; k < c; ++k)
+            {
+                diag -= static_cast<double>(m_sqrtCov(c, k)) * m_sqrtCov(c, k);
+            }
+            if (!(diag > 0))
+            {
+                m_sqrtCov = aug_mat_t::zeros();
+                for (int i = 0; i < AUG_DIM; ++i)
+                {
+                    m_sqrtCov(i, i) = std::sqrt(std::abs(m_augCov(i, i)));
+                }
+                return;
+            }
+            const track_t d = static_cast<track_t>(std::sqrt(diag));
+            m_sqrtCov(c, c) = d;
+            for (int r = c + 1; r < AUG_DIM; ++r)
+            {
+                double val = m_augCov(r, c);
+                for (int k = 0; k < c; ++k)
+                {
+                    val -= static_cast<double>(m_sqrtCov(r, k)) * m_sqrtCov(c, k);
+                }
+                m_sqrtCov(r, c) = static_cast<track_t>(val / d);
+            }
+        }
+    }
+
+    ///
+    /// \brief Transition
+    /// Constant acceleration model on the all sigma points, the size of the rect is constant.
+    /// The augmented variant adds the process noise rows
+    /// \param dt
+    ///
+    void Transition(track_t dt)
+    {
+        const track_t dt2 = dt * dt / 2;
+        track_t* x = m_sigmas.val;
+        track_t* y = x + SIGMAS;
+        track_t* vx = y + SIGMAS;
+        track_t* vy = vx + SIGMAS;
+        const track_t* ax = vy + SIGMAS;
+        const track_t* ay = ax + SIGMAS;
+        for (int j = 0; j < SIGMAS; ++j)
+        {
+            x[j] += vx[j] * dt + ax[j] * dt2;
+            y[j] += vy[j] * dt + ay[j] * dt2;
+            vx[j] += ax[j] * dt;
+            vy[j] += ay[j] * dt;
+        }
+        if (AUGMENTED)
+        {
+            const track_t* noise = m_sigmas.val + STATE_DIM * SIGMAS;
+            for (int i = 0; i < STATE_DIM * SIGMAS; ++i)
+            {
+                m_sigmas.val[i] += noise[i];
+            }
+        }
+    }
+
+    ///
+    /// \brief Mean
+    /// \param rows - DIM rows of SIGMAS values
+    /// \return Weighted mean
+    ///
+    template<int DIM>
+    cv::Matx<track_t, DIM, 1> Mean(const track_t* rows) const
+    {
+        cv::Matx<track_t, DIM, 1> res;
+        for (int r = 0; r < DIM; ++r)
+        {
+            const track_t* row = rows + r * SIGMAS;
+            track_t sum = 0;
+            for (int j = 0; j < SIGMAS; ++j)
+            {
+                sum += m_weightsMean[j] * row[j];
+            }
+            res.val[r] = sum;
+        }
+        return res;
+    }
+
+    ///
+    /// \brief Deviations
+    /// State rows of the sigma points minus the mean state
+    ///
+    void Deviations()
+    {
+        for (int r = 0; r < STATE_DIM; ++r)
+        {
+            const track_t* row = m_sigmas.val + r * SIGMAS;
+            track_t* dev = m_deviations.val + r * SIGMAS;
+            for (int j = 0; j < SIGMAS; ++j)
+            {
+                dev[j] = row[j] - m_state.val[r];
+            }
+        }
+    }
+
+    ///
+    /// \brief Covariance
+    /// \param devA - ROWS rows of the deviations
+    /// \param devB - COLS rows of the deviations
+    /// \return Weighted sum of devA * devB^T
+    ///
+    template<int ROWS, int COLS>
+    cv::Matx<track_t, ROWS, COLS> Covariance(const track_t* devA, const track_t* devB) const
+    {
+        cv::Matx<track_t, ROWS, COLS> res;
+        for (int r = 0; r < ROWS; ++r)
+        {
+            track_t weighted[SIGMAS];
+            const track_t* rowA = devA + r * SIGMAS;
+            for (int j = 0; j < SIGMAS; ++j)
+            {
+                weighted[j] = m_weightsCov[j] * rowA[j];
+            }
+            for (int c = 0; c < COLS; ++c)
+            {
+                const track_t* rowB = devB + c * SIGMAS;
+                track_t sum = 0;
+                for (int j = 0; j < SIGMAS; ++j)
+                {
+                    sum += weighted[j] * rowB[j];
+                }
+                res(r, c) = sum;
+            }
+        }
+        return res;
+    }
+};
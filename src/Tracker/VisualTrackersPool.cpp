@@ -0,0 +1,155 @@
+#include <iostream>
+#include "VisualTrackersPool.h"
+
+#ifdef USE_OCV_KCF
+
+///
+/// \brief VisualTrackersPool::Acquire
+/// \param type
+/// \param channels
+/// \return
+///
+cv::Ptr<cv::Tracker> VisualTrackersPool::Acquire(tracking::LostTrackType type, int channels)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_free.find(std::make_pair(static_cast<int>(type), channels));
+        if (it != std::end(m_free) && !it->second.empty())
+        {
+            cv::Ptr<cv::Tracker> tracker = it->second.back();
+            it->second.pop_back();
+            --m_freeCount;
+            return tracker;
+        }
+    }
+    // Creation can be long (GOTURN reads the network), the other tracks don't wait for it
+    return Create(type, channels);
+}
+
+///
+/// \brief VisualTrackersPool::Release
+/// \param type
+/// \param channels
+/// \param tracker
+///
+void VisualTrackersPool::Release(tracking::LostTrackType type, int channels, cv::Ptr<cv::Tracker>& tracker)
+{
+    if (!tracker || tracker.empty())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_freeCount < m_maxFree)
+        {
+            m_free[std::make_pair(static_cast<int>(type), channels)].push_back(tracker);
+            ++m_freeCount;
+        }
+    }
+    tracker.release();
+}
+
+///
+/// \brief VisualTrackersPool::Create
+/// \param type
+/// \param channels
+/// \return
+///
+cv::Ptr<cv::Tracker> VisualTrackersPool::Create(tracking::LostTrackType type, int channels)
+{
+    cv::Ptr<cv::Tracker> tracker;
+
+    switch (type)
+    {
+    case tracking::TrackKCF:
+        {
+            cv::TrackerKCF::Params params;
+			if (channels == 1)
+			{
+				params.compressed_size = 1;
+				params.desc_pca = cv::TrackerKCF::GRAY;
+				params.desc_npca = cv::TrackerKCF::GRAY;
+			}
+			else
+			{
+				params.compressed_size = 3;
+				params.desc_pca = cv::TrackerKCF::CN;
+				params.desc_npca = cv::TrackerKCF::CN;
+			}
+            params.resize = true;
+            params.detect_thresh = 0.7f;
+#if (((CV_VERSION_MAJOR == 3) && (CV_VERSION_MINOR >= 3)) || (CV_VERSION_MAJOR > 3))
+            tracker = cv::TrackerKCF::create(params);
+#else
+            tracker = cv::TrackerKCF::createTracker(params);
+#endif
+        }
+        break;
+
+    case tracking::TrackMIL:
+        {
+            cv::TrackerMIL::Params params;
+
+#if (((CV_VERSION_MAJOR == 3) && (CV_VERSION_MINOR >= 3)) || (CV_VERSION_MAJOR > 3))
+            tracker = cv::TrackerMIL::create(params);
+#else
+            tracker = cv::TrackerMIL::createTracker(params);
+#endif
+        }
+        break;
+
+    case tracking::TrackMedianFlow:
+        {
+#if (((CV_VERSION_MAJOR == 4) && (CV_VERSION_MINOR > 4)) || (CV_VERSION_MAJOR > 4))
+            std::cerr << "TrackMedianFlow not supported in OpenCV 4.5 and newer!" << std::endl;
+            CV_Assert(0);
+#else
+            cv::TrackerMedianFlow::Params params;
+
+#if (((CV_VERSION_MAJOR == 3) && (CV_VERSION_MINOR >= 3)) || (CV_VERSION_MAJOR > 3))
+            tracker = cv::TrackerMedianFlow::create(params);
+#else
+            tracker = cv::TrackerMedianFlow::createTracker(params);
+#endif
+#endif
+        }
+        break;
+
+    case tracking::TrackGOTURN:
+        {
+            cv::TrackerGOTURN::Params params;
+
+#if (((CV_VERSION_MAJOR == 3) && (CV_VERSION_MINOR >= 3)) || (CV_VERSION_MAJOR > 3))
+            tracker = cv::TrackerGOTURN::create(params);
+#else
+            tracker = cv::TrackerGOTURN::createTracker(params);
+#endif
+        }
+        break;
+
+	case tracking::TrackCSRT:
+		{
+#if (CV_VERSION_MAJOR >= 4)
+			cv::TrackerCSRT::Params params;
+			params.psr_threshold = 0.04f; // 0.035f;
+			if (channels == 1)
+			{
+				params.use_gray = true;
+				params.use_rgb = false;
+			}
+			else
+			{
+				params.use_gray = false;
+				params.use_rgb = true;
+			}
+			tracker = cv::TrackerCSRT::create(params);
+#endif
+		}
+		break;
+
+    default:
+        break;
+    }
+    return tracker;
+}
+
+#endif
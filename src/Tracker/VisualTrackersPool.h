@@ -0,0 +1,72 @@
+#pragma once
+#include <vector>
+#include <map>
+#include <mutex>
+#include "defines.h"
+
+#ifdef USE_OCV_KCF
+#include <opencv2/tracking.hpp>
+#endif
+
+///
+/// \brief The VisualTrackersPool class
+/// OpenCV trackers released by the lost tracks are kept and given to the next tracks with the same tracker type
+/// instead of the creation of the new ones, the state is reset by init. So the flickering tracks don't recreate
+/// the trackers on every loss and GOTURN loads its network only for the peak count of the simultaneously lost tracks.
+/// Thread safe
+///
+class VisualTrackersPool
+{
+public:
+    ///
+    /// \brief VisualTrackersPool
+    /// \param maxFree - maximum count of the released trackers kept for the reuse
+    ///
+    VisualTrackersPool(size_t maxFree)
+        : m_maxFree(maxFree)
+    {
+    }
+    VisualTrackersPool(const VisualTrackersPool&) = delete;
+    VisualTrackersPool& operator=(const VisualTrackersPool&) = delete;
+
+#ifdef USE_OCV_KCF
+    ///
+    /// \brief Acquire
+    /// \param type
+    /// \param channels - channels of the frames for the tracker
+    /// \return Released tracker of this type or the new one, must be initialized by init
+    ///
+    cv::Ptr<cv::Tracker> Acquire(tracking::LostTrackType type, int channels);
+
+    ///
+    /// \brief Release
+    /// \param type
+    /// \param channels
+    /// \param tracker - becomes empty
+    ///
+    void Release(tracking::LostTrackType type, int channels, cv::Ptr<cv::Tracker>& tracker);
+
+    ///
+    /// \brief Create
+    /// \param type
+    /// \param channels
+    /// \return New tracker with the parameters for the lost tracks, empty for the unsupported type
+    ///
+    static cv::Ptr<cv::Tracker> Create(tracking::LostTrackType type, int channels);
+#endif
+
+    ///
+    size_t FreeCount() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_freeCount;
+    }
+
+private:
+    size_t m_maxFree = 0;
+    size_t m_freeCount = 0;
+#ifdef USE_OCV_KCF
+    std::map<std::pair<int, int>, std::vector<cv::Ptr<cv::Tracker>>> m_free; // Released trackers by type and channels
+#endif
+    mutable std::mutex m_mutex;
+};
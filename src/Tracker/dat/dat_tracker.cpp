@@ -133,24 +133,31 @@ cv::RotatedRect DAT_TRACKER::Update(const cv::Mat &im, float& confidence)
     cv::Mat search_win, padded_search_win;
     getSubwindowMasked(img, target_pos, search_sz, search_win, padded_search_win);
 
-    // Apply probability LUT
-    cv::Mat pm_search = getForegroundProb(search_win, prob_lut_, cfg.bin_mapping);
-    cv::Mat pm_search_dist;
-    if (cfg.distractor_aware) {
-        pm_search_dist = getForegroundProb(search_win, prob_lut_distractor_, cfg.bin_mapping);
-        pm_search = (pm_search + pm_search_dist)/2.;
-    }
+    // Apply probability LUT, the bins are reused by the distractor histograms
+    getBinIndices(search_win, cfg.num_bins, cfg.bin_mapping, search_bins_);
+    cv::Mat pm_search;
+    if (cfg.distractor_aware)
+        pm_search = getForegroundProb(search_bins_, prob_lut_, prob_lut_distractor_);
+    else
+        pm_search = getForegroundProb(search_bins_, prob_lut_);
     pm_search.setTo(0, padded_search_win);
 
     // Cosine / Hanning window
-    cv::Mat cos_win = CalculateHann(search_sz);
+    if (cos_win_.cols != search_sz.width || cos_win_.rows != search_sz.height)
+        cos_win_ = CalculateHann(search_sz);
 
     std::vector<cv::Rect> hypotheses;
     std::vector<double> vote_scores;
     std::vector<double> dist_scores;
     getNMSRects(pm_search, target_sz, cfg.nms_scale, cfg.nms_overlap,
-                cfg.nms_score_factor, cos_win, cfg.nms_include_center_vote,
+                cfg.nms_score_factor, cos_win_, cfg.nms_include_center_vote,
                 hypotheses, vote_scores, dist_scores);
+    if (hypotheses.empty())
+    {
+        cv::Rect location = pos2rect(target_pos_history_.back(), target_sz_history_.back(), im.size());
+        return cv::RotatedRect(cv::Point2f(location.x + 0.5f * location.width, location.y + 0.5f * location.height),
+                               cv::Size2f(location.width, location.height), 0.f);
+    }
 
     std::vector<cv::Point2f> candidate_centers;
     std::vector<double> candidate_scores;
@@ -222,27 +229,27 @@ cv::RotatedRect DAT_TRACKER::Update(const cv::Mat &im, float& confidence)
             // Handle distractors
             if (distractors.size() > 1) {
                 cv::Rect obj_rect = pos2rect(target_pos, target_sz, search_win.size());
-                cv::Mat prob_lut_dist = getForegroundDistractorProbs(search_win, obj_rect, distractors, cfg.num_bins);
+                cv::Mat prob_lut_dist = getForegroundDistractorProbs(search_bins_, obj_rect, distractors, cfg.num_bins);
 
-                prob_lut_distractor_ = (1 - cfg.prob_lut_update_rate) * prob_lut_distractor_ + cfg.prob_lut_update_rate * prob_lut_dist;
+                cv::addWeighted(prob_lut_distractor_, 1 - cfg.prob_lut_update_rate, prob_lut_dist, cfg.prob_lut_update_rate, 0, prob_lut_distractor_);
             }
             else {
                 // If there are no distractors, trigger decay of distractor LUT
-                prob_lut_distractor_ = (1 - cfg.prob_lut_update_rate) * prob_lut_distractor_ + cfg.prob_lut_update_rate * prob_lut_bg;
+                cv::addWeighted(prob_lut_distractor_, 1 - cfg.prob_lut_update_rate, prob_lut_bg, cfg.prob_lut_update_rate, 0, prob_lut_distractor_);
             }
 
             // Only update if distractors are not overlapping too much
             if (distractors.empty() || (*max_element(distractor_overlap.begin(), distractor_overlap.end()) < 0.1)) {
-                prob_lut_ = (1 - cfg.prob_lut_update_rate) * prob_lut_ + cfg.prob_lut_update_rate * prob_lut_bg;
+                cv::addWeighted(prob_lut_, 1 - cfg.prob_lut_update_rate, prob_lut_bg, cfg.prob_lut_update_rate, 0, prob_lut_);
             }
 
-            prob_map = getForegroundProb(surr_win, prob_lut_, cfg.bin_mapping);
-            cv::Mat dist_map = getForegroundProb(surr_win, prob_lut_distractor_, cfg.bin_mapping);
-            prob_map = .5 * prob_map + .5 * dist_map;
+            getBinIndices(surr_win, cfg.num_bins, cfg.bin_mapping, surr_bins_);
+            prob_map = getForegroundProb(surr_bins_, prob_lut_, prob_lut_distractor_);
         }
         else { // No distractor - awareness
-            prob_lut_ = (1 - cfg.prob_lut_update_rate) * prob_lut_ + cfg.prob_lut_update_rate * prob_lut_bg;
-            prob_map = getForegroundProb(surr_win, prob_lut_, cfg.bin_mapping);
+            cv::addWeighted(prob_lut_, 1 - cfg.prob_lut_update_rate, prob_lut_bg, cfg.prob_lut_update_rate, 0, prob_lut_);
+            getBinIndices(surr_win, cfg.num_bins, cfg.bin_mapping, surr_bins_);
+            prob_map = getForegroundProb(surr_bins_, prob_lut_);
         }
         // Update adaptive threshold
         adaptive_threshold_ = getAdaptiveThreshold(prob_map, obj_rect_surr);
@@ -297,6 +304,10 @@ void DAT_TRACKER::Train(const cv::Mat &/*im*/, bool /*first*/)
 void DAT_TRACKER::getNMSRects(cv::Mat prob_map, cv::Size obj_sz, double scale,
                               double overlap, double score_frac, cv::Mat dist_map, bool include_inner,
                               std::vector<cv::Rect> &top_rects, std::vector<double> &top_vote_scores, std::vector<double> &top_dist_scores){
+    top_rects.clear();
+    top_vote_scores.clear();
+    top_dist_scores.clear();
+
     int height = prob_map.rows;
     int width = prob_map.cols;
     cv::Size rect_sz(floor(obj_sz.width * scale), floor(obj_sz.height * scale));
@@ -304,133 +315,89 @@ void DAT_TRACKER::getNMSRects(cv::Mat prob_map, cv::Size obj_sz, double scale,
     int stepx = std::max(1, int(round(rect_sz.width * (1.0 - overlap))));
     int stepy = std::max(1, int(round(rect_sz.height * (1.0 - overlap))));
 
-    std::vector<int> posx, posy;
-    for (int i = 0; i <= (width -1 - rect_sz.width); i += stepx)
-    {
-        posx.push_back(i);
-    }
-    for (int i = 0; i <= (height -1 - rect_sz.height); i += stepy)
-    {
-        posy.push_back(i);
-    }
-    cv::Mat xgv(posx); cv::Mat ygv(posy); cv::Mat x; cv::Mat y;
-    cv::repeat(xgv.reshape(1, 1), ygv.total(), 1, x);
-    cv::repeat(ygv.reshape(1, 1).t(), 1, xgv.total(), y);
-
-    cv::Mat r = x + rect_sz.width;;
-    cv::Mat b = y + rect_sz.height;
-    r.setTo(width-1, r > (width-1));
-    b.setTo(height-1, b > (height-1));
-
-    std::vector<cv::Rect> boxes;
-    int n = x.rows*x.cols;
-    int *p_x = x.ptr<int>(0);
-    int *p_y = y.ptr<int>(0);
-    int *p_r = r.ptr<int>(0);
-    int *p_b = b.ptr<int>(0);
-    for (int i = 0; i < n; ++i)
-        boxes.push_back(cv::Rect(p_x[i], p_y[i], p_r[i] - p_x[i], p_b[i] - p_y[i]));
-
-    std::vector<cv::Rect> boxes_inner;
 	int o_x = round(std::max(1.0, rect_sz.width*0.2));
 	int o_y = round(std::max(1.0, rect_sz.height*0.2));
-    if (include_inner) {
-        for (int i = 0; i < n; ++i)
-            boxes_inner.push_back(cv::Rect(p_x[i] + o_x, p_y[i] + o_y, p_r[i] - p_x[i] - 2 * o_x, p_b[i] - p_y[i] - 2 * o_y));
-    }
+    cv::Size rect_sz_inner(rect_sz.width - 2 * o_x, rect_sz.height - 2 * o_y);
 
-    // Linear indices
-    cv::Mat l = x;
-    cv::Mat t = y;
-    std::vector<cv::Point>bl, br, tl, tr;
-
-    int *p_l = l.ptr<int>(0);
-    int *p_t = t.ptr<int>(0);
-    for (int i = 0; i < n; ++i){
-        bl.push_back(cv::Point(p_l[i], p_b[i]));
-        br.push_back(cv::Point(p_r[i], p_b[i]));
-        tl.push_back(cv::Point(p_l[i], p_t[i]));
-        tr.push_back(cv::Point(p_r[i], p_t[i]));
-    }
-    cv::Size rect_sz_inner;
-    std::vector<cv::Point>bl_inner, br_inner, tl_inner, tr_inner;
-    if (include_inner){
-        rect_sz_inner.width = rect_sz.width - 2 * o_x;
-        rect_sz_inner.height = rect_sz.height - 2 *o_y;
-
-        for (int i = 0; i < n; ++i){
-            bl_inner.push_back(cv::Point(p_l[i]+o_x, p_b[i]-o_y));
-            br_inner.push_back(cv::Point(p_r[i]-o_x, p_b[i]-o_y));
-            tl_inner.push_back(cv::Point(p_l[i]+o_x, p_t[i]+o_y));
-            tr_inner.push_back(cv::Point(p_r[i]-o_x, p_t[i]+o_y));
+    // Corners tl, tr, bl, br of the boxes as linear indices in the integral images
+    const int istep = width + 1;
+    std::vector<cv::Rect> boxes;
+    std::vector<cv::Vec4i> corners, corners_inner;
+    for (int t = 0; t <= (height - 1 - rect_sz.height); t += stepy)
+    {
+        int b = std::min(t + rect_sz.height, height - 1);
+        for (int l = 0; l <= (width - 1 - rect_sz.width); l += stepx)
+        {
+            int r = std::min(l + rect_sz.width, width - 1);
+            boxes.emplace_back(l, t, r - l, b - t);
+            corners.emplace_back(t * istep + l, t * istep + r, b * istep + l, b * istep + r);
+            if (include_inner)
+                corners_inner.emplace_back((t + o_y) * istep + l + o_x, (t + o_y) * istep + r - o_x,
+                                           (b - o_y) * istep + l + o_x, (b - o_y) * istep + r - o_x);
         }
     }
+    const size_t n = boxes.size();
+    if (!n)
+        return;
+
+    auto BoxSum = [](const double* integral, const cv::Vec4i& c)
+    {
+        return integral[c[3]] - integral[c[2]] - integral[c[1]] + integral[c[0]];
+    };
 
     cv::Mat intProbMap;
-    cv::integral(prob_map, intProbMap);
+    cv::integral(prob_map, intProbMap, CV_64F);
     cv::Mat intDistMap;
-    cv::integral(dist_map, intDistMap);
+    cv::integral(dist_map, intDistMap, CV_64F);
 
-    std::vector<float> v_scores(n, 0);
-    std::vector<float> d_scores(n, 0);
-    for (size_t i = 0; i < bl.size(); ++i){
-        v_scores[i] = intProbMap.at<double>(br[i]) - intProbMap.at<double>(bl[i]) - intProbMap.at<double>(tr[i]) + intProbMap.at<double>(tl[i]);
-        d_scores[i] = intDistMap.at<double>(br[i]) - intDistMap.at<double>(bl[i]) - intDistMap.at<double>(tr[i]) + intDistMap.at<double>(tl[i]);
-    }
-    std::vector<float> scores_inner(n, 0);
-    if (include_inner){
-        for (size_t i = 0; i < bl.size(); ++i){
-            scores_inner[i] = intProbMap.at<double>(br_inner[i]) - intProbMap.at<double>(bl_inner[i]) - intProbMap.at<double>(tr_inner[i]) + intProbMap.at<double>(tl_inner[i]);
-            v_scores[i] = v_scores[i] / double(rect_sz.area()) + scores_inner[i] / double(rect_sz_inner.area());
-        }
+    std::vector<double> v_scores(n, 0);
+    std::vector<double> d_scores(n, 0);
+    auto VoteScore = [&](size_t i)
+    {
+        const double* p_int = intProbMap.ptr<double>(0);
+        v_scores[i] = BoxSum(p_int, corners[i]);
+        if (include_inner)
+            v_scores[i] = v_scores[i] / rect_sz.area() + BoxSum(p_int, corners_inner[i]) / rect_sz_inner.area();
+    };
+    const double* p_int_dist = intDistMap.ptr<double>(0);
+    for (size_t i = 0; i < n; ++i)
+    {
+        VoteScore(i);
+        d_scores[i] = BoxSum(p_int_dist, corners[i]);
     }
 
-    top_rects.clear();;
-    top_vote_scores.clear();
-    top_dist_scores.clear();
-    int midx = max_element(v_scores.begin(), v_scores.end()) - v_scores.begin();
-    double ms = v_scores[midx];
+    // Suppressed boxes are marked instead of erased, the distance map doesn't change
+    std::vector<char> alive(n, 1);
+    auto BestAlive = [&]()
+    {
+        int best = -1;
+        for (size_t i = 0; i < n; ++i)
+        {
+            if (alive[i] && (best < 0 || v_scores[i] > v_scores[best]))
+                best = static_cast<int>(i);
+        }
+        return best;
+    };
 
-    double best_score = ms;
+    int midx = BestAlive();
+    double best_score = v_scores[midx];
 
-    while (ms > score_frac * best_score){
-        prob_map(boxes[midx]) = cv::Scalar(0.0);
-        top_rects.push_back(boxes[midx]);
+    while (midx >= 0 && (top_rects.empty() || v_scores[midx] > score_frac * best_score)){
+        const cv::Rect suppressed = boxes[midx];
+        prob_map(suppressed) = cv::Scalar(0.0);
+        top_rects.push_back(suppressed);
         top_vote_scores.push_back(v_scores[midx]);
         top_dist_scores.push_back(d_scores[midx]);
-        boxes.erase(boxes.begin() + midx);
-        if (include_inner)
-            boxes_inner.erase(boxes_inner.begin() + midx);
-
-        bl.erase(bl.begin() + midx);
-        br.erase(br.begin() + midx);
-        tl.erase(tl.begin() + midx);
-        tr.erase(tr.begin() + midx);
-        if (include_inner){
-            bl_inner.erase(bl_inner.begin() + midx);
-            br_inner.erase(br_inner.begin() + midx);
-            tl_inner.erase(tl_inner.begin() + midx);
-            tr_inner.erase(tr_inner.begin() + midx);
-        }
-
-        cv::integral(prob_map, intProbMap);
-        cv::integral(dist_map, intDistMap);
+        alive[midx] = 0;
 
-        v_scores.resize(bl.size(), 0);
-        d_scores.resize(bl.size(), 0);
-        for (size_t i = 0; i < bl.size(); ++i){
-            v_scores[i] = intProbMap.at<double>(br[i]) - intProbMap.at<double>(bl[i]) - intProbMap.at<double>(tr[i]) + intProbMap.at<double>(tl[i]);
-            d_scores[i] = intDistMap.at<double>(br[i]) - intDistMap.at<double>(bl[i]) - intDistMap.at<double>(tr[i]) + intDistMap.at<double>(tl[i]);
-        }
-        scores_inner.resize(bl.size(), 0);
-        if (include_inner){
-            for (size_t i = 0; i < bl.size(); ++i){
-                scores_inner[i] = intProbMap.at<double>(br_inner[i]) - intProbMap.at<double>(bl_inner[i]) - intProbMap.at<double>(tr_inner[i]) + intProbMap.at<double>(tl_inner[i]);
-                v_scores[i] = v_scores[i] / (rect_sz.area()) + scores_inner[i] / (rect_sz_inner.area());
-            }
+        // Only the boxes crossing the suppressed one lose their votes
+        cv::integral(prob_map, intProbMap, CV_64F);
+        for (size_t i = 0; i < n; ++i)
+        {
+            if (alive[i] && (boxes[i] & suppressed).area() > 0)
+                VoteScore(i);
         }
-        midx = max_element(v_scores.begin(), v_scores.end()) - v_scores.begin();
-        ms = v_scores[midx];
+        midx = BestAlive();
     }
 }
 
@@ -446,32 +413,43 @@ double DAT_TRACKER::intersectionOverUnion(cv::Rect target_rect, cv::Rect candida
 
 ///
 /// \brief DAT_TRACKER::getForegroundDistractorProbs
-/// \param frame
+/// \param frame_bins - bins of the search window from getBinIndices
 /// \param obj_rect
 /// \param distractors
 /// \param num_bins
 /// \return
 ///
-cv::Mat DAT_TRACKER::getForegroundDistractorProbs(cv::Mat frame, cv::Rect obj_rect, std::vector<cv::Rect> distractors, int num_bins) {
-    int imgCount = 1;
-    int dims = 3;
+cv::Mat DAT_TRACKER::getForegroundDistractorProbs(const cv::Mat& frame_bins, cv::Rect obj_rect, const std::vector<cv::Rect>& distractors, int num_bins) {
     const int sizes[] = { num_bins, num_bins, num_bins };
-    const int channels[] = { 0, 1, 2 };
-    float rRange[] = { 0, 256 };
-    float gRange[] = { 0, 256 };
-    float bRange[] = { 0, 256 };
-    const float *ranges[] = { rRange, gRange, bRange };
-
-    cv::Mat Md(frame.size(), CV_8UC1, cv::Scalar(0));
-    cv::Mat Mo(frame.size(), CV_8UC1, cv::Scalar(0));
+    cv::Mat obj_hist(3, sizes, CV_32FC1, cv::Scalar(0));
+    cv::Mat distr_hist(3, sizes, CV_32FC1, cv::Scalar(0));
+
+    // Bit 0 - object, bit 1 - distractors: both histograms by one pass over the bins of the search window
+    constexpr uchar ObjBit = 1;
+    constexpr uchar DistrBit = 2;
+    const cv::Rect bounds(0, 0, frame_bins.cols, frame_bins.rows);
+    distractors_mask_.create(frame_bins.size(), CV_8UC1);
+    distractors_mask_ = cv::Scalar(0);
     for (size_t i = 0; i < distractors.size(); ++i) {
-        Mo(distractors[i]) = true;
+        distractors_mask_(distractors[i] & bounds) = cv::Scalar(DistrBit);
     }
-    Mo(obj_rect) = true;
+    cv::Mat obj_mask = distractors_mask_(obj_rect & bounds);
+    cv::bitwise_or(obj_mask, cv::Scalar(ObjBit), obj_mask);
 
-    cv::Mat obj_hist, distr_hist;
-    cv::calcHist(&frame, imgCount, channels, Md, distr_hist, dims, sizes, ranges);
-    cv::calcHist(&frame, imgCount, channels, Mo, obj_hist, dims, sizes, ranges);
+    float* p_obj_hist = obj_hist.ptr<float>(0);
+    float* p_distr_hist = distr_hist.ptr<float>(0);
+    for (int y = 0; y < frame_bins.rows; ++y)
+    {
+        const int* p_bins = frame_bins.ptr<int>(y);
+        const uchar* p_mask = distractors_mask_.ptr<uchar>(y);
+        for (int x = 0; x < frame_bins.cols; ++x)
+        {
+            if (p_mask[x] & ObjBit)
+                p_obj_hist[p_bins[x]] += 1.f;
+            if (p_mask[x] & DistrBit)
+                p_distr_hist[p_bins[x]] += 1.f;
+        }
+    }
     cv::Mat prob_lut = (obj_hist*distractors.size() + 1) / (distr_hist + obj_hist*distractors.size() + 2);
     return prob_lut;
 }
@@ -495,24 +473,70 @@ cv::Mat DAT_TRACKER::CalculateHann(cv::Size sz) {
 
 ///
 /// \brief DAT_TRACKER::getForegroundProb
-/// \param frame
+/// \param frame_bins
 /// \param prob_lut
-/// \param bin_mapping
 /// \return
 ///
-cv::Mat DAT_TRACKER::getForegroundProb(cv::Mat frame, cv::Mat prob_lut, cv::Mat bin_mapping){
-    cv::Mat frame_bin;
-    cv::Mat prob_map(frame.size(), CV_32FC1);
-    cv::LUT(frame, bin_mapping, frame_bin);
-    float *p_prob_map = prob_map.ptr<float>(0);
-    cv::MatIterator_<cv::Vec3b> it, end;
-    for (it = frame_bin.begin<cv::Vec3b>(), end = frame_bin.end<cv::Vec3b>(); it != end; ++it)
+cv::Mat DAT_TRACKER::getForegroundProb(const cv::Mat& frame_bins, const cv::Mat& prob_lut){
+    cv::Mat prob_map(frame_bins.size(), CV_32FC1);
+    const float* p_lut = prob_lut.ptr<float>(0);
+    for (int y = 0; y < frame_bins.rows; ++y)
+    {
+        const int* p_bins = frame_bins.ptr<int>(y);
+        float* p_prob_map = prob_map.ptr<float>(y);
+        for (int x = 0; x < frame_bins.cols; ++x)
+        {
+            p_prob_map[x] = p_lut[p_bins[x]];
+        }
+    }
+    return prob_map;
+}
+
+///
+/// \brief DAT_TRACKER::getForegroundProb
+/// Mean of the object and the distractor likelihoods by one pass
+/// \param frame_bins
+/// \param prob_lut
+/// \param prob_lut_distractor
+/// \return
+///
+cv::Mat DAT_TRACKER::getForegroundProb(const cv::Mat& frame_bins, const cv::Mat& prob_lut, const cv::Mat& prob_lut_distractor){
+    cv::Mat prob_map(frame_bins.size(), CV_32FC1);
+    const float* p_lut = prob_lut.ptr<float>(0);
+    const float* p_lut_dist = prob_lut_distractor.ptr<float>(0);
+    for (int y = 0; y < frame_bins.rows; ++y)
     {
-        *p_prob_map++ = prob_lut.at<float>((*it)[0], (*it)[1], (*it)[2]);
+        const int* p_bins = frame_bins.ptr<int>(y);
+        float* p_prob_map = prob_map.ptr<float>(y);
+        for (int x = 0; x < frame_bins.cols; ++x)
+        {
+            p_prob_map[x] = 0.5f * (p_lut[p_bins[x]] + p_lut_dist[p_bins[x]]);
+        }
     }
     return prob_map;
 }
 
+///
+/// \brief DAT_TRACKER::getBinIndices
+/// \param frame - 3 channels image
+/// \param num_bins
+/// \param bin_mapping
+/// \param frame_bins - CV_32SC1 linear indices of the pixels in the 3D histogram
+///
+void DAT_TRACKER::getBinIndices(const cv::Mat& frame, int num_bins, const cv::Mat& bin_mapping, cv::Mat& frame_bins){
+    frame_bins.create(frame.size(), CV_32SC1);
+    const uchar* p_mapping = bin_mapping.ptr<uchar>(0);
+    for (int y = 0; y < frame.rows; ++y)
+    {
+        const uchar* p_frame = frame.ptr<uchar>(y);
+        int* p_bins = frame_bins.ptr<int>(y);
+        for (int x = 0; x < frame.cols; ++x, p_frame += 3)
+        {
+            p_bins[x] = (p_mapping[p_frame[0]] * num_bins + p_mapping[p_frame[1]]) * num_bins + p_mapping[p_frame[2]];
+        }
+    }
+}
+
 ///
 /// \brief DAT_TRACKER::getSubwindowMasked
 /// \param im
@@ -613,16 +637,9 @@ void DAT_TRACKER::getForegroundBackgroundProbs(cv::Mat frame, cv::Rect obj_rect,
     cv::calcHist(&obj_win, imgCount, channels, mask, obj_hist, dims, sizes, ranges);
     prob_lut = (obj_hist + 1.) / (surr_hist + 2.);
 
-    prob_map = cv::Mat(frame.size(), CV_32FC1);
-    cv::Mat frame_bin;
-    cv::LUT(frame, bin_mapping, frame_bin);
-
-    float *p_prob_map = prob_map.ptr<float>(0);
-    cv::MatIterator_<cv::Vec3b> it, end;
-    for (it = frame_bin.begin<cv::Vec3b>(), end = frame_bin.end<cv::Vec3b>(); it != end; ++it)
-    {
-        *p_prob_map++ = prob_lut.at<float>((*it)[0], (*it)[1], (*it)[2]);
-    }
+    cv::Mat frame_bins;
+    getBinIndices(frame, num_bins, bin_mapping, frame_bins);
+    prob_map = getForegroundProb(frame_bins, prob_lut);
 }
 
 ///
@@ -58,11 +58,15 @@ protected:
 
     void getForegroundBackgroundProbs(cv::Mat frame, cv::Rect obj_rect, int num_bins, cv::Mat &prob_lut);
 
-    cv::Mat getForegroundDistractorProbs(cv::Mat frame, cv::Rect obj_rect, std::vector<cv::Rect> distractors, int num_bins);
+    cv::Mat getForegroundDistractorProbs(const cv::Mat& frame_bins, cv::Rect obj_rect, const std::vector<cv::Rect>& distractors, int num_bins);
 
     double getAdaptiveThreshold(cv::Mat prob_map, cv::Rect obj_rect_surr);
 
-    cv::Mat getForegroundProb(cv::Mat frame, cv::Mat prob_lut, cv::Mat bin_mapping);
+    cv::Mat getForegroundProb(const cv::Mat& frame_bins, const cv::Mat& prob_lut);
+
+    cv::Mat getForegroundProb(const cv::Mat& frame_bins, const cv::Mat& prob_lut, const cv::Mat& prob_lut_distractor);
+
+    void getBinIndices(const cv::Mat& frame, int num_bins, const cv::Mat& bin_mapping, cv::Mat& frame_bins);
 
     cv::Mat CalculateHann(cv::Size sz);
 
@@ -89,4 +93,9 @@ private:
     double adaptive_threshold_;
     std::vector<cv::Point>target_pos_history_;
     std::vector<cv::Size>target_sz_history_;
+
+    cv::Mat cos_win_;          // Hanning window of the last search window size
+    cv::Mat search_bins_;      // Histogram bins of the search window pixels
+    cv::Mat surr_bins_;        // Histogram bins of the surrounding window pixels
+    cv::Mat distractors_mask_;
 };
@@ -1,5 +1,6 @@
 #include <cstring>
 #include <iostream>
+#include <algorithm>
 
 #include "fhog.h"
 #undef MIN
@@ -61,15 +62,21 @@ void grad2( float *I, float *Gx, float *Gy, int h, int w, int d ) {
 }
 
 // build lookup table a[] s.t. a[x*n]~=acos(x) for x in [-1,1]
-float* acosTable() {
+// the table is built once in the thread safe initialization of the static: trackers call FHOG in parallel
+static float* buildAcosTable() {
     const int n=10000, b=10; int i;
-    static float a[n*2+b*2]; static bool init=false;
-    float *a1=a+n+b; if( init ) return a1;
+    static float a[n*2+b*2];
+    float *a1=a+n+b;
     for( i=-n-b; i<-n; i++ )   a1[i]=PI;
     for( i=-n; i<n; i++ )      a1[i]=float(acos(i/float(n)));
     for( i=n; i<n+b; i++ )     a1[i]=0;
     for( i=-n-b; i<n/10; i++ ) if( a1[i] > PI-1e-6f ) a1[i]=PI-1e-6f;
-    init=true; return a1;
+    return a1;
+}
+
+float* acosTable() {
+    static float* a1 = buildAcosTable();
+    return a1;
 }
 
 // compute gradient magnitude and orientation at each location (uses sse)
@@ -470,94 +477,51 @@ float* fhog(float *M,float* O,int height,int width,int /*channel*/,int *h,int *w
     return crop_H(H,h,w,*d,height%binSize < binSize/2,width%binSize < binSize/2);
 }
 
-void fhog(cv::MatND &fhog_feature, const cv::Mat& input, int binSize, int nOrients, float clip, bool crop) {
-    int HEIGHT = input.rows;
-    int WIDTH = input.cols;
-    int DEPTH = input.channels();
-
-    float *II = new float[HEIGHT*WIDTH*DEPTH];
-    int count=0;
-
-    // MatLab:: RGB, OpenCV: BGR
-
-    for (int i = 0; i < WIDTH; i++) {
-        for (int j = 0; j < HEIGHT; j++) {
-            cv::Vec3b p = input.at<cv::Vec3b>(j,i);
-            II[count+2] = p[0]; // B->R
-            II[count+1] = p[1]; // G->G
-            II[count+0] = p[2]; // R->B
-            count += 3;
-        }
-    }
+// HH with shape channel x width x height of the 8-bit gray or color image
+static float* fhogPlanes(const cv::Mat& input, int binSize, int nOrients, float clip, bool crop, int* h, int* w, int* d) {
+    const int HEIGHT = input.rows;
+    const int WIDTH = input.cols;
+    const int DEPTH = input.channels();
 
+    // channel x width x height, MatLab:: RGB, OpenCV: BGR
     float *I = new float[HEIGHT*WIDTH*DEPTH];
-
-    // channel x width x height
-    for (int i = 0; i < WIDTH; i++) {
-        for (int j = 0; j < HEIGHT; j++) {
+    for (int j = 0; j < HEIGHT; j++) {
+        const uchar* p = input.ptr<uchar>(j);
+        for (int i = 0; i < WIDTH; i++) {
             for (int k = 0; k < DEPTH; k++) {
-                I[k*WIDTH*HEIGHT+i*HEIGHT+j] = II[i*HEIGHT*DEPTH+j*DEPTH+k];
+                I[k*WIDTH*HEIGHT+i*HEIGHT+j] = p[DEPTH-1-k];
             }
+            p += DEPTH;
         }
     }
 
     float *M = new float[HEIGHT*WIDTH], *O = new float[HEIGHT*WIDTH];
     gradMag(I, M, O, HEIGHT, WIDTH, DEPTH, true);
 
-    int h,w,d;
-    float* HH = fhog(M,O,HEIGHT,WIDTH,DEPTH,&h,&w,&d,binSize,nOrients,clip,crop);
-    float* H = new float[w*h*d];
-
-    for(int i = 0;i < w; i++)
-        for(int j = 0;j < h; j++)
-            for(int k = 0;k < d; k++)
-                //H[i*h*d+j*d+k] = HH[k*w*h+i*h+j]; // ->hwd
-                H[j*w*d+i*d+k] = HH[k*w*h+i*h+j]; // ->whd
-
-    fhog_feature = cv::MatND(h,w,CV_32FC(32),H).clone();
-
-    delete[] H;
+    float* HH = fhog(M,O,HEIGHT,WIDTH,DEPTH,h,w,d,binSize,nOrients,clip,crop);
 
     delete[] M; delete[] O;
-    delete[] II;delete[] I;delete[] HH;
+    delete[] I;
+    return HH;
 }
 
-void fhog28(cv::MatND &fhog_feature, const cv::Mat& input, int binSize, int nOrients, float clip, bool crop) {
-    int HEIGHT = input.rows;
-    int WIDTH = input.cols;
-    int DEPTH = input.channels();
-
-    float *II = new float[WIDTH*HEIGHT*DEPTH];
-    int count=0;
-
-    // MatLab:: RGB, OpenCV: BGR
-
-    for (int i = 0; i < WIDTH; i++) {
-        for (int j = 0; j < HEIGHT; j++) {
-            cv::Vec3b p = input.at<cv::Vec3b>(j,i);
-            II[count+2] = p[0]; // B->R
-            II[count+1] = p[1]; // G->G
-            II[count+0] = p[2]; // R->B
-            count += 3;
-        }
-    }
-
-    float *I = new float[HEIGHT*WIDTH*DEPTH];
+void fhog(cv::MatND &fhog_feature, const cv::Mat& input, int binSize, int nOrients, float clip, bool crop) {
+    int h,w,d;
+    float* HH = fhogPlanes(input,binSize,nOrients,clip,crop,&h,&w,&d);
 
-    // channel x width x height
-    for (int i = 0; i < WIDTH; i++) {
-        for (int j = 0; j < HEIGHT; j++) {
-            for (int k = 0; k < DEPTH; k++) {
-                I[k*WIDTH*HEIGHT+i*HEIGHT+j] = II[i*HEIGHT*DEPTH+j*DEPTH+k];
-            }
-        }
+    fhog_feature = cv::Mat(h,w,CV_32FC(d)); // new buffers in all functions: the caller can keep the previous features
+    for(int j = 0;j < h; j++) {
+        float* H = fhog_feature.ptr<float>(j);
+        for(int i = 0;i < w; i++)
+            for(int k = 0;k < d; k++)
+                H[i*d+k] = HH[k*w*h+i*h+j]; // ->whd
     }
+    delete[] HH;
+}
 
-    float *M = new float[HEIGHT*WIDTH], *O = new float[HEIGHT*WIDTH];
-    gradMag(I, M, O, HEIGHT, WIDTH, DEPTH, true);
-
+void fhog28(cv::MatND &fhog_feature, const cv::Mat& input, int binSize, int nOrients, float clip, bool crop) {
     int h,w,d;
-    float* HH = fhog(M,O,HEIGHT,WIDTH,DEPTH,&h,&w,&d,binSize,nOrients,clip,crop);
+    float* HH = fhogPlanes(input,binSize,nOrients,clip,crop,&h,&w,&d);
 
 #undef CHANNELS
 #define CHANNELS 28
@@ -566,63 +530,21 @@ void fhog28(cv::MatND &fhog_feature, const cv::Mat& input, int binSize, int nOri
 
     // out = zeros(h, w, 28, 'single');
     // out(:,:,2:28) = temp(:,:,1:27);
-
-    float* H = new float[w*h*CHANNELS];
-
-    for(int i = 0;i < w; i++)
-        for(int j = 0;j < h; j++) {
-            //H[i*h*CHANNELS+j*CHANNELS+0] = 0.0;
-            H[j*w*CHANNELS+i*CHANNELS+0] = 0.0;
-            for(int k = 0;k < CHANNELS-1;k++) {
-                //H[i*h*CHANNELS+j*CHANNELS+k+1] = HH[k*w*h+i*h+j]; // ->hwd
-                H[j*w*CHANNELS+i*CHANNELS+k+1] = HH[k*w*h+i*h+j]; // ->whd
-            }
+    fhog_feature = cv::Mat(h,w,CV_32FC(CHANNELS));
+    for(int j = 0;j < h; j++) {
+        float* H = fhog_feature.ptr<float>(j);
+        for(int i = 0;i < w; i++) {
+            H[i*CHANNELS+0] = 0.0;
+            for(int k = 0;k < CHANNELS-1;k++)
+                H[i*CHANNELS+k+1] = HH[k*w*h+i*h+j]; // ->whd
         }
-
-    fhog_feature = cv::MatND(h,w,CV_32FC(CHANNELS),H).clone();
-
-    delete[] H;
-
-    delete[] M; delete[] O;
-    delete[] II;delete[] I;delete[] HH;
+    }
+    delete[] HH;
 }
 
 void fhog31(cv::MatND &fhog_feature, const cv::Mat& input, int binSize, int nOrients, float clip, bool crop) {
-    int HEIGHT = input.rows;
-    int WIDTH = input.cols;
-    int DEPTH = input.channels();
-
-    float *II = new float[WIDTH*HEIGHT*DEPTH];
-    int count=0;
-
-    // MatLab:: RGB, OpenCV: BGR
-
-    for (int i = 0; i < WIDTH; i++) {
-        for (int j = 0; j < HEIGHT; j++) {
-            cv::Vec3b p = input.at<cv::Vec3b>(j,i);
-            II[count+2] = p[0]; // B->R
-            II[count+1] = p[1]; // G->G
-            II[count+0] = p[2]; // R->B
-            count += 3;
-        }
-    }
-
-    float *I = new float[HEIGHT*WIDTH*DEPTH];
-
-    // channel x width x height
-    for (int i = 0; i < WIDTH; i++) {
-        for (int j = 0; j < HEIGHT; j++) {
-            for (int k = 0; k < DEPTH; k++) {
-                I[k*WIDTH*HEIGHT+i*HEIGHT+j] = II[i*HEIGHT*DEPTH+j*DEPTH+k];
-            }
-        }
-    }
-
-    float *M = new float[HEIGHT*WIDTH], *O = new float[HEIGHT*WIDTH];
-    gradMag(I, M, O, HEIGHT, WIDTH, DEPTH, true);
-
     int h,w,d;
-    float* HH = fhog(M,O,HEIGHT,WIDTH,DEPTH,&h,&w,&d,binSize,nOrients,clip,crop);
+    float* HH = fhogPlanes(input,binSize,nOrients,clip,crop,&h,&w,&d);
 
 #undef CHANNELS
 #define CHANNELS 31
@@ -631,21 +553,44 @@ void fhog31(cv::MatND &fhog_feature, const cv::Mat& input, int binSize, int nOri
 
     // out = zeros(h, w, 31, 'single');
     // out(:,:,1:31) = temp(:,:,1:31);
+    fhog_feature = cv::Mat(h,w,CV_32FC(CHANNELS));
+    for(int j = 0;j < h; j++) {
+        float* H = fhog_feature.ptr<float>(j);
+        for(int i = 0;i < w; i++)
+            for(int k = 0;k < CHANNELS;k++)
+                H[i*CHANNELS+k] = HH[k*w*h+i*h+j]; // ->whd
+    }
+    delete[] HH;
+}
 
-    float* H = new float[w*h*CHANNELS];
+void fhog31(std::vector<cv::MatND> &fhog_features, const std::vector<cv::Mat>& inputs, int binSize, int nOrients, float clip, bool crop) {
+    fhog_features.resize(inputs.size());
+    cv::parallel_for_(cv::Range(0, static_cast<int>(inputs.size())), [&](const cv::Range& range) {
+        for (int i = range.start; i < range.end; i++)
+            fhog31(fhog_features[i], inputs[i], binSize, nOrients, clip, crop);
+    });
+}
 
-    for(int i = 0;i < w; i++)
-        for(int j = 0;j < h; j++) {
-            for(int k = 0;k < CHANNELS;k++) {
-                //H[i*h*CHANNELS+j*CHANNELS+k+1] = HH[k*w*h+i*h+j]; // ->hwd
-                H[j*w*CHANNELS+i*CHANNELS+k] = HH[k*w*h+i*h+j]; // ->whd
-            }
-        }
+void fhogRows(cv::Mat &fhog_feature, const cv::Mat& input, int* sizes, int binSize, int nOrients, float clip) {
+    int h,w,d;
+    float* HH = fhogPlanes(input,binSize,nOrients,clip,false,&h,&w,&d);
 
-    fhog_feature = cv::MatND(h,w,CV_32FC(CHANNELS),H).clone();
+#undef CHANNELS
+#define CHANNELS 31
 
-    delete[] H;
+    assert(d >= CHANNELS);
 
-    delete[] M; delete[] O;
-    delete[] II;delete[] I;delete[] HH;
+    // Cells on the border haven't the full neighbourhood for the block normalization
+    const int hc = std::max(0, h - 2), wc = std::max(0, w - 2);
+    sizes[0] = hc;
+    sizes[1] = wc;
+    sizes[2] = CHANNELS;
+    fhog_feature = cv::Mat(CHANNELS, hc*wc, CV_32F);
+    for(int k = 0;k < CHANNELS;k++) {
+        float* H = fhog_feature.ptr<float>(k);
+        for(int j = 0;j < hc; j++)
+            for(int i = 0;i < wc; i++)
+                H[j*wc+i] = HH[k*w*h+(i+1)*h+j+1];
+    }
+    delete[] HH;
 }
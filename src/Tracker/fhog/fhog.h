@@ -4,9 +4,11 @@
 #include <cstdlib>
 #include <cmath>
 #include <cstring>
+#include <vector>
 #include "sse.hpp"
 
 #include <opencv2/core/core.hpp>
+#include <opencv2/core/utility.hpp>
 
 /**
     Inputs:
@@ -31,6 +33,18 @@ void fhog(cv::MatND &fhog_feature, const cv::Mat& input, int binSize = 4,int nOr
 void fhog28(cv::MatND &fhog_feature, const cv::Mat& input, int binSize = 4,int nOrients = 9,float clip=0.2f,bool crop = false);
 void fhog31(cv::MatND &fhog_feature, const cv::Mat& input, int binSize = 4,int nOrients = 9,float clip=0.2f,bool crop = false);
 
+/**
+    Features of several patches in one call, the patches are processed in parallel
+**/
+void fhog31(std::vector<cv::MatND> &fhog_features, const std::vector<cv::Mat>& inputs, int binSize = 4,int nOrients = 9,float clip=0.2f,bool crop = false);
+
+/**
+    31 channels without the border cells in the layout of the correlation trackers: one row per channel,
+    the cells of the row are in the row-major order.
+    sizes - returns the height, the width in cells and the channels count
+**/
+void fhogRows(cv::Mat &fhog_feature, const cv::Mat& input, int* sizes, int binSize = 4,int nOrients = 9,float clip=0.2f);
+
 // wrapper functions if compiling from C/C++
 inline void wrError(const char *errormsg) { throw errormsg; }
 inline void* wrCalloc( size_t num, size_t size ) { return calloc(num,size); }
@@ -0,0 +1,171 @@
+/*******************************************************************************
+* Piotr's Computer Vision Matlab Toolbox      Version 3.23
+* Copyright 2014 Piotr Dollar.  [pdollar-at-gmail.com]
+* Licensed under the Simplified BSD License [see external/bsd.txt]
+*******************************************************************************/
+#ifndef _SSE_HPP_
+#define _SSE_HPP_
+
+// The kernels of FHOG work with 4 floats: SSE2 on x86, NEON on ARM and the plain structs on other platforms
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define FHOG_SIMD_SSE2
+#include <emmintrin.h> // SSE2:<e*.h>, SSE3:<p*.h>, SSE4:<s*.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define FHOG_SIMD_NEON
+#include <arm_neon.h>
+typedef float32x4_t __m128;
+typedef int32x4_t __m128i;
+#else
+#define FHOG_SIMD_SCALAR
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+struct alignas(16) __m128 { float v[4]; };
+struct alignas(16) __m128i { int32_t v[4]; };
+#endif
+
+namespace sse{
+
+#define RETf inline __m128
+#define RETi inline __m128i
+
+#if defined(FHOG_SIMD_SSE2)
+
+// set, load and store values
+RETf SET( const float &x ) { return _mm_set1_ps(x); }
+RETf SET( float x, float y, float z, float w ) { return _mm_set_ps(x,y,z,w); }
+RETi SET( const int &x ) { return _mm_set1_epi32(x); }
+RETf LD( const float &x ) { return _mm_load_ps(&x); }
+RETf LDu( const float &x ) { return _mm_loadu_ps(&x); }
+RETf STR( float &x, const __m128 y ) { _mm_store_ps(&x,y); return y; }
+RETf STR1( float &x, const __m128 y ) { _mm_store_ss(&x,y); return y; }
+RETf STRu( float &x, const __m128 y ) { _mm_storeu_ps(&x,y); return y; }
+
+// arithmetic operators
+RETi ADD( const __m128i x, const __m128i y ) { return _mm_add_epi32(x,y); }
+RETf ADD( const __m128 x, const __m128 y ) { return _mm_add_ps(x,y); }
+RETf SUB( const __m128 x, const __m128 y ) { return _mm_sub_ps(x,y); }
+RETf MUL( const __m128 x, const __m128 y ) { return _mm_mul_ps(x,y); }
+RETf MIN( const __m128 x, const __m128 y ) { return _mm_min_ps(x,y); }
+RETf RCP( const __m128 x ) { return _mm_rcp_ps(x); }
+RETf RCPSQRT( const __m128 x ) { return _mm_rsqrt_ps(x); }
+
+// logical operators
+RETf AND( const __m128 x, const __m128 y ) { return _mm_and_ps(x,y); }
+RETi AND( const __m128i x, const __m128i y ) { return _mm_and_si128(x,y); }
+RETf ANDNOT( const __m128 x, const __m128 y ) { return _mm_andnot_ps(x,y); }
+RETf OR( const __m128 x, const __m128 y ) { return _mm_or_ps(x,y); }
+RETf XOR( const __m128 x, const __m128 y ) { return _mm_xor_ps(x,y); }
+
+// comparison operators
+RETf CMPGT( const __m128 x, const __m128 y ) { return _mm_cmpgt_ps(x,y); }
+RETf CMPLT( const __m128 x, const __m128 y ) { return _mm_cmplt_ps(x,y); }
+RETi CMPGT( const __m128i x, const __m128i y ) { return _mm_cmpgt_epi32(x,y); }
+RETi CMPLT( const __m128i x, const __m128i y ) { return _mm_cmplt_epi32(x,y); }
+
+// conversion operators
+RETf CVT( const __m128i x ) { return _mm_cvtepi32_ps(x); }
+RETi CVT( const __m128 x ) { return _mm_cvttps_epi32(x); }
+
+#elif defined(FHOG_SIMD_NEON)
+
+// set, load and store values
+RETf SET( const float &x ) { return vdupq_n_f32(x); }
+RETf SET( float x, float y, float z, float w ) { const float v[4] = { w, z, y, x }; return vld1q_f32(v); }
+RETi SET( const int &x ) { return vdupq_n_s32(x); }
+RETf LD( const float &x ) { return vld1q_f32(&x); }
+RETf LDu( const float &x ) { return vld1q_f32(&x); }
+RETf STR( float &x, const __m128 y ) { vst1q_f32(&x,y); return y; }
+RETf STR1( float &x, const __m128 y ) { vst1q_lane_f32(&x,y,0); return y; }
+RETf STRu( float &x, const __m128 y ) { vst1q_f32(&x,y); return y; }
+
+// arithmetic operators
+RETi ADD( const __m128i x, const __m128i y ) { return vaddq_s32(x,y); }
+RETf ADD( const __m128 x, const __m128 y ) { return vaddq_f32(x,y); }
+RETf SUB( const __m128 x, const __m128 y ) { return vsubq_f32(x,y); }
+RETf MUL( const __m128 x, const __m128 y ) { return vmulq_f32(x,y); }
+RETf MIN( const __m128 x, const __m128 y ) { return vminq_f32(x,y); }
+// The estimates are refined by Newton step to the precision of SSE
+RETf RCP( const __m128 x ) { __m128 r=vrecpeq_f32(x); return vmulq_f32(vrecpsq_f32(x,r),r); }
+RETf RCPSQRT( const __m128 x ) { __m128 r=vrsqrteq_f32(x); return vmulq_f32(vrsqrtsq_f32(vmulq_f32(x,r),r),r); }
+
+// logical operators
+RETf AND( const __m128 x, const __m128 y ) { return vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(x),vreinterpretq_u32_f32(y))); }
+RETi AND( const __m128i x, const __m128i y ) { return vandq_s32(x,y); }
+RETf ANDNOT( const __m128 x, const __m128 y ) { return vreinterpretq_f32_u32(vbicq_u32(vreinterpretq_u32_f32(y),vreinterpretq_u32_f32(x))); }
+RETf OR( const __m128 x, const __m128 y ) { return vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(x),vreinterpretq_u32_f32(y))); }
+RETf XOR( const __m128 x, const __m128 y ) { return vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(x),vreinterpretq_u32_f32(y))); }
+
+// comparison operators
+RETf CMPGT( const __m128 x, const __m128 y ) { return vreinterpretq_f32_u32(vcgtq_f32(x,y)); }
+RETf CMPLT( const __m128 x, const __m128 y ) { return vreinterpretq_f32_u32(vcltq_f32(x,y)); }
+RETi CMPGT( const __m128i x, const __m128i y ) { return vreinterpretq_s32_u32(vcgtq_s32(x,y)); }
+RETi CMPLT( const __m128i x, const __m128i y ) { return vreinterpretq_s32_u32(vcltq_s32(x,y)); }
+
+// conversion operators
+RETf CVT( const __m128i x ) { return vcvtq_f32_s32(x); }
+RETi CVT( const __m128 x ) { return vcvtq_s32_f32(x); }
+
+#else
+
+#define FHOG_FOR4(expr) for( int i=0; i<4; i++ ) { expr; }
+inline uint32_t BITS( float x ) { uint32_t b; memcpy(&b,&x,sizeof(b)); return b; }
+inline float FLT( uint32_t b ) { float x; memcpy(&x,&b,sizeof(x)); return x; }
+
+// set, load and store values
+RETf SET( const float &x ) { __m128 r; FHOG_FOR4(r.v[i]=x); return r; }
+RETf SET( float x, float y, float z, float w ) { __m128 r; r.v[0]=w; r.v[1]=z; r.v[2]=y; r.v[3]=x; return r; }
+RETi SET( const int &x ) { __m128i r; FHOG_FOR4(r.v[i]=x); return r; }
+RETf LD( const float &x ) { __m128 r; memcpy(r.v,&x,sizeof(r.v)); return r; }
+RETf LDu( const float &x ) { return LD(x); }
+RETf STR( float &x, const __m128 y ) { memcpy(&x,y.v,sizeof(y.v)); return y; }
+RETf STR1( float &x, const __m128 y ) { x=y.v[0]; return y; }
+RETf STRu( float &x, const __m128 y ) { return STR(x,y); }
+
+// arithmetic operators
+RETi ADD( const __m128i x, const __m128i y ) { __m128i r; FHOG_FOR4(r.v[i]=x.v[i]+y.v[i]); return r; }
+RETf ADD( const __m128 x, const __m128 y ) { __m128 r; FHOG_FOR4(r.v[i]=x.v[i]+y.v[i]); return r; }
+RETf SUB( const __m128 x, const __m128 y ) { __m128 r; FHOG_FOR4(r.v[i]=x.v[i]-y.v[i]); return r; }
+RETf MUL( const __m128 x, const __m128 y ) { __m128 r; FHOG_FOR4(r.v[i]=x.v[i]*y.v[i]); return r; }
+RETf MIN( const __m128 x, const __m128 y ) { __m128 r; FHOG_FOR4(r.v[i]=(x.v[i]<y.v[i])?x.v[i]:y.v[i]); return r; }
+RETf RCP( const __m128 x ) { __m128 r; FHOG_FOR4(r.v[i]=1.f/x.v[i]); return r; }
+RETf RCPSQRT( const __m128 x ) { __m128 r; FHOG_FOR4(r.v[i]=1.f/std::sqrt(x.v[i])); return r; }
+
+// logical operators
+RETf AND( const __m128 x, const __m128 y ) { __m128 r; FHOG_FOR4(r.v[i]=FLT(BITS(x.v[i])&BITS(y.v[i]))); return r; }
+RETi AND( const __m128i x, const __m128i y ) { __m128i r; FHOG_FOR4(r.v[i]=x.v[i]&y.v[i]); return r; }
+RETf ANDNOT( const __m128 x, const __m128 y ) { __m128 r; FHOG_FOR4(r.v[i]=FLT(~BITS(x.v[i])&BITS(y.v[i]))); return r; }
+RETf OR( const __m128 x, const __m128 y ) { __m128 r; FHOG_FOR4(r.v[i]=FLT(BITS(x.v[i])|BITS(y.v[i]))); return r; }
+RETf XOR( const __m128 x, const __m128 y ) { __m128 r; FHOG_FOR4(r.v[i]=FLT(BITS(x.v[i])^BITS(y.v[i]))); return r; }
+
+// comparison operators
+RETf CMPGT( const __m128 x, const __m128 y ) { __m128 r; FHOG_FOR4(r.v[i]=FLT((x.v[i]>y.v[i])?~0u:0u)); return r; }
+RETf CMPLT( const __m128 x, const __m128 y ) { __m128 r; FHOG_FOR4(r.v[i]=FLT((x.v[i]<y.v[i])?~0u:0u)); return r; }
+RETi CMPGT( const __m128i x, const __m128i y ) { __m128i r; FHOG_FOR4(r.v[i]=(x.v[i]>y.v[i])?-1:0); return r; }
+RETi CMPLT( const __m128i x, const __m128i y ) { __m128i r; FHOG_FOR4(r.v[i]=(x.v[i]<y.v[i])?-1:0); return r; }
+
+// conversion operators
+RETf CVT( const __m128i x ) { __m128 r; FHOG_FOR4(r.v[i]=static_cast<float>(x.v[i])); return r; }
+RETi CVT( const __m128 x ) { __m128i r; FHOG_FOR4(r.v[i]=static_cast<int32_t>(x.v[i])); return r; }
+
+#undef FHOG_FOR4
+#endif
+
+// operators on top of the platform ones
+RETf STR( float &x, const float y ) { return STR(x,SET(y)); }
+RETf ADD( const __m128 x, const __m128 y, const __m128 z ) {
+    return ADD(ADD(x,y),z); }
+RETf ADD( const __m128 a, const __m128 b, const __m128 c, const __m128 &d ) {
+    return ADD(ADD(ADD(a,b),c),d); }
+RETf MUL( const __m128 x, const float y ) { return MUL(x,SET(y)); }
+RETf MUL( const float x, const __m128 y ) { return MUL(SET(x),y); }
+RETf INC( __m128 &x, const __m128 y ) { return x = ADD(x,y); }
+RETf INC( float &x, const __m128 y ) { __m128 t=ADD(LD(x),y); return STR(x,t); }
+RETf DEC( __m128 &x, const __m128 y ) { return x = SUB(x,y); }
+RETf DEC( float &x, const __m128 y ) { __m128 t=SUB(LD(x),y); return STR(x,t); }
+
+#undef RETf
+#undef RETi
+
+}
+#endif
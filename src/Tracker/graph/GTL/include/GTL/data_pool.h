@@ -0,0 +1,81 @@
+/* This software is distributed under the GNU Lesser General Public License */
+//==========================================================================
+//
+//   data_pool.h
+//
+//==========================================================================
+
+#ifndef GTL_DATA_POOL_H
+#define GTL_DATA_POOL_H
+
+#include <GTL/GTL.h>
+
+#include <memory>
+#include <vector>
+
+__GTL_BEGIN_NAMESPACE
+
+/**
+ * @internal
+ * Storage of the node and edge data objects in the chunks. Released
+ * objects are kept in the free list and reused by the next acquire,
+ * all chunks are freed at once with the pool.
+ */
+template <class T>
+class data_pool
+{
+public:
+    data_pool() = default;
+    data_pool(const data_pool&) = delete;
+    data_pool& operator=(const data_pool&) = delete;
+
+    /**
+     * @internal
+     * Returns a default constructed object.
+     */
+    T* acquire()
+    {
+	if (free_items.empty())
+	{
+	    grow();
+	}
+	T* item = free_items.back();
+	free_items.pop_back();
+	return item;
+    }
+
+    /**
+     * @internal
+     * Resets the object and returns it to the free list.
+     */
+    void release(T* item)
+    {
+	*item = T();
+	free_items.push_back(item);
+    }
+
+private:
+    enum { chunk_size = 256 };
+
+    std::vector<std::unique_ptr<T[]>> chunks;
+    std::vector<T*> free_items;
+
+    void grow()
+    {
+	chunks.emplace_back(new T[chunk_size]);
+	T* chunk = chunks.back().get();
+	free_items.reserve(free_items.size() + chunk_size);
+	for (int i = chunk_size - 1; i >= 0; --i)
+	{
+	    free_items.push_back(chunk + i);
+	}
+    }
+};
+
+__GTL_END_NAMESPACE
+
+#endif // GTL_DATA_POOL_H
+
+//--------------------------------------------------------------------------
+//   end of file
+//--------------------------------------------------------------------------
@@ -241,6 +241,25 @@ public:
      */
     void clear();
 
+    /**
+     * Switches the allocation of the node and edge data to the pool.
+     * Data of the deleted nodes and edges is reused by the new ones and
+     * the whole storage is freed at once with the graph, so a graph that
+     * is cleared and rebuilt many times doesn't allocate it again.
+     * <p>
+     * <em>Precondition:</em> the graph is empty.
+     *
+     * @param <code>enable</code> use the pool
+     */
+    void use_pool(bool enable);
+
+    /**
+     * Checks if the node and edge data is allocated from the pool.
+     *
+     * @return true iff the pool is used
+     */
+    bool is_pooled() const;
+
     //================================================== Iterators
 
     /**
@@ -799,6 +818,16 @@ private:
 	void del_list(nodes_t &);
 	void del_list(edges_t &);
 
+    //================================================== Data allocation
+
+    struct data_pools;
+    data_pools* pools;
+
+    node_data* alloc_node_data();
+    edge_data* alloc_edge_data();
+    void free_data(node_data*);
+    void free_data(edge_data*);
+
 	GTL_EXTERN friend std::ostream& operator<< (std::ostream& os, const graph& G);
 };
 
@@ -10,6 +10,7 @@
 #include <GTL/node_data.h>
 #include <GTL/edge_data.h>
 #include <GTL/node_map.h>
+#include <GTL/data_pool.h>
 
 #include <GTL/dfs.h>
 #include <GTL/topsort.h>
@@ -29,6 +30,14 @@
 
 __GTL_BEGIN_NAMESPACE
 
+/**
+ * @internal
+ */
+struct graph::data_pools
+{
+    data_pool<node_data> nodes;
+    data_pool<edge_data> edges;
+};
 //--------------------------------------------------------------------------
 //   Con-/Destructors
 //--------------------------------------------------------------------------
@@ -37,7 +46,8 @@ graph::graph() :
     directed(true),
     nodes_count(0), edges_count(0),
     hidden_nodes_count(0), hidden_edges_count(0),
-    free_node_ids_count(0), free_edge_ids_count(0)
+    free_node_ids_count(0), free_edge_ids_count(0),
+    pools(0)
 {
 }
 
@@ -45,7 +55,8 @@ graph::graph(const graph &G) :
     directed(G.directed),
     nodes_count(0), edges_count(0),
     hidden_nodes_count(0), hidden_edges_count(0),
-    free_node_ids_count(0), free_edge_ids_count(0)
+    free_node_ids_count(0), free_edge_ids_count(0),
+    pools(0)
 {
     copy (G, G.nodes.begin(), G.nodes.end());
 }
@@ -55,7 +66,8 @@ graph::graph(const graph& G, const nodes_t& nod) :
     directed(G.directed),
     nodes_count(0), edges_count(0),
     hidden_nodes_count(0), hidden_edges_count(0),
-    free_node_ids_count(0), free_edge_ids_count(0)
+    free_node_ids_count(0), free_edge_ids_count(0),
+    pools(0)
 {
     copy (G, nod.begin(), nod.end());
 }
@@ -67,7 +79,8 @@ graph::graph (const graph& G,
     directed(G.directed),
     nodes_count(0), edges_count(0),
     hidden_nodes_count(0), hidden_edges_count(0),
-    free_node_ids_count(0), free_edge_ids_count(0)
+    free_node_ids_count(0), free_edge_ids_count(0),
+    pools(0)
 {
     copy (G, it, end);
 }
@@ -104,6 +117,57 @@ void graph::copy (const graph& G,
 graph::~graph() 
 {
     clear();
+    delete pools;
+}
+
+//--------------------------------------------------------------------------
+//   Data allocation
+//--------------------------------------------------------------------------
+
+void graph::use_pool(bool enable)
+{
+    assert(nodes_count == 0 && hidden_nodes_count == 0);
+
+    if (enable && !pools)
+    {
+	pools = new data_pools;
+    }
+    else if (!enable && pools)
+    {
+	delete pools;
+	pools = 0;
+    }
+}
+
+bool graph::is_pooled() const
+{
+    return pools != 0;
+}
+
+node_data* graph::alloc_node_data()
+{
+    return pools ? pools->nodes.acquire() : new node_data;
+}
+
+edge_data* graph::alloc_edge_data()
+{
+    return pools ? pools->edges.acquire() : new edge_data;
+}
+
+void graph::free_data(node_data* data)
+{
+    if (pools)
+	pools->nodes.release(data);
+    else
+	delete data;
+}
+
+void graph::free_data(edge_data* data)
+{
+    if (pools)
+	pools->edges.release(data);
+    else
+	delete data;
 }
 
 //-------------------------------------------------------------------------
@@ -178,7 +242,7 @@ node graph::new_node()
     // create node
     
     node n;
-    n.data = new node_data;
+    n.data = alloc_node_data();
 
     // set data variables
 
@@ -207,7 +271,7 @@ edge graph::new_edge(GTL::node source, GTL::node target)
     // create edge
     
     edge e;
-    e.data = new edge_data;
+    e.data = alloc_edge_data();
     
     // set id
 
@@ -282,7 +346,7 @@ void graph::del_node(GTL::node n)
     { 
 	if (it->source() == n || it->target() == n)
 	{
-	    delete it->data;
+	    free_data(it->data);
 	    it = hidden_edges.erase (it);
 	}
 	else
@@ -299,7 +363,7 @@ void graph::del_node(GTL::node n)
     --nodes_count;
     free_node_ids.push_back(n.data->id);
     ++free_node_ids_count;
-    delete n.data;
+    free_data(n.data);
 
     post_del_node_handler();
 }
@@ -319,7 +383,7 @@ void graph::del_edge(GTL::edge e)
     --edges_count;
     free_edge_ids.push_back(e.data->id);
     ++free_edge_ids_count;
-    delete e.data;
+    free_data(e.data);
 
     post_del_edge_handler(s, t);
 }
@@ -773,7 +837,7 @@ void graph::del_list(nodes_t& l)
 
     while(it != end)
     {
-	delete it->data;
+	free_data(it->data);
 	++it;
     }
     
@@ -787,7 +851,7 @@ void graph::del_list(edges_t& l)
 
     while(it != end)
     {
-	delete it->data;
+	free_data(it->data);
 	++it;
     }
     
@@ -0,0 +1,361 @@
+#include "csrgraph.h"
+
+#include <queue>
+#include <numeric>
+#include <utility>
+#include <algorithm>
+#include <functional>
+
+///
+/// \brief CSRGraph::Build
+/// \param nodesCount
+/// \param sources
+/// \param targets
+/// \param weights
+///
+void CSRGraph::Build(int nodesCount, const std::vector<int>& sources, const std::vector<int>& targets, const std::vector<int>& weights)
+{
+    const size_t edgesCount = std::min(sources.size(), targets.size());
+
+    // Counting sort of the edges by the sources keeps the input order of the out edges
+    m_offsets.assign(static_cast<size_t>(std::max(0, nodesCount)) + 1, 0);
+    for (size_t e = 0; e < edgesCount; ++e)
+    {
+        ++m_offsets[sources[e] + 1];
+    }
+    for (size_t i = 1; i < m_offsets.size(); ++i)
+    {
+        m_offsets[i] += m_offsets[i - 1];
+    }
+
+    m_sources.resize(edgesCount);
+    m_targets.resize(edgesCount);
+    m_weights.resize(edgesCount);
+    m_inputEdges.resize(edgesCount);
+    std::vector<int> fillPos(m_offsets.begin(), m_offsets.end() - 1);
+    for (size_t e = 0; e < edgesCount; ++e)
+    {
+        const int pos = fillPos[sources[e]]++;
+        m_sources[pos] = sources[e];
+        m_targets[pos] = targets[e];
+        m_weights[pos] = weights.empty() ? 0 : weights[e];
+        m_inputEdges[pos] = static_cast<int>(e);
+    }
+}
+
+///
+/// \brief CSRGraph::FromGTL
+/// \param G
+/// \param weights
+/// \param nodes
+/// \param edges
+///
+void CSRGraph::FromGTL(const GTL::graph& G, const GTL::edge_map<int>* weights, std::vector<GTL::node>* nodes, std::vector<GTL::edge>* edges)
+{
+    // Ids of the GTL nodes can have the gaps after the deletions
+    GTL::node_map<int> nodeInd(G, -1);
+    std::vector<GTL::node> allNodes;
+    allNodes.reserve(G.number_of_nodes());
+    GTL::node n;
+    forall_nodes(n, G)
+    {
+        nodeInd[n] = static_cast<int>(allNodes.size());
+        allNodes.push_back(n);
+    }
+
+    std::vector<GTL::edge> allEdges;
+    allEdges.reserve(G.number_of_edges());
+    std::vector<int> sources;
+    std::vector<int> targets;
+    std::vector<int> edgeWeights;
+    sources.reserve(G.number_of_edges());
+    targets.reserve(G.number_of_edges());
+    if (weights)
+        edgeWeights.reserve(G.number_of_edges());
+    GTL::edge e;
+    forall_edges(e, G)
+    {
+        allEdges.push_back(e);
+        sources.push_back(nodeInd[e.source()]);
+        targets.push_back(nodeInd[e.target()]);
+        if (weights)
+            edgeWeights.push_back((*weights)[e]);
+    }
+    Build(static_cast<int>(allNodes.size()), sources, targets, edgeWeights);
+
+    if (nodes)
+        nodes->swap(allNodes);
+    if (edges)
+    {
+        edges->resize(allEdges.size());
+        for (size_t i = 0; i < allEdges.size(); ++i)
+        {
+            (*edges)[i] = allEdges[m_inputEdges[i]];
+        }
+    }
+}
+
+///
+/// \brief CSRMaxWeightBipartiteMatching
+/// \param G
+/// \param matching
+/// \return
+///
+long CSRMaxWeightBipartiteMatching(const CSRGraph& G, std::vector<int>& matching)
+{
+    matching.clear();
+    const int nodesCount = G.NodesCount();
+    const int edgesCount = G.EdgesCount();
+    if (!edgesCount)
+        return 0;
+
+    int maxWeight = 0;
+    for (int e = 0; e < edgesCount; ++e)
+    {
+        maxWeight = std::max(maxWeight, G.Weight(e));
+    }
+
+    std::vector<long> pot(nodesCount, 0);
+    std::vector<long> dist(nodesCount, 0);
+    std::vector<int> pred(nodesCount, -1); // Edge of the shortest path to the node
+    std::vector<int> mate(nodesCount, -1); // Matched edge of the node
+    std::vector<char> isFree(nodesCount, 1);
+    std::vector<char> matched(edgesCount, 0);
+    for (int a = 0; a < nodesCount; ++a)
+    {
+        if (G.OutDegree(a) > 0)
+            pot[a] = maxWeight;
+    }
+
+    typedef std::pair<long, int> HeapItem;
+    std::priority_queue<HeapItem, std::vector<HeapItem>, std::greater<HeapItem>> heap;
+    std::vector<int> reachedA;
+    std::vector<int> reachedB;
+
+    // Unmatched edges are directed from the first partition to the second, matched ones are reversed
+    auto Relax = [&](int a)
+    {
+        for (int e = G.OutBegin(a); e < G.OutEnd(a); ++e)
+        {
+            if (matched[e])
+                continue;
+            const int b = G.Target(e);
+            const long db = dist[a] + (pot[a] + pot[b] - G.Weight(e));
+            if (pred[b] == -1)
+            {
+                reachedB.push_back(b);
+            }
+            else if (db >= dist[b])
+            {
+                continue;
+            }
+            dist[b] = db;
+            pred[b] = e;
+            heap.emplace(db, b);
+        }
+    };
+
+    auto AugmentPathTo = [&](int v)
+    {
+        int e = pred[v];
+        while (e != -1)
+        {
+            const int a = G.Source(e);
+            const int b = G.Target(e);
+            if (matched[e])
+            {
+                matched[e] = 0;
+                if (mate[a] == e)
+                    mate[a] = -1;
+                if (mate[b] == e)
+                    mate[b] = -1;
+                e = pred[b];
+            }
+            else
+            {
+                matched[e] = 1;
+                mate[a] = e;
+                mate[b] = e;
+                e = pred[a];
+            }
+        }
+    };
+
+    for (int a = 0; a < nodesCount; ++a)
+    {
+        if (!G.OutDegree(a) || !isFree[a])
+            continue;
+
+        dist[a] = 0;
+        reachedA.assign(1, a);
+        reachedB.clear();
+        heap = decltype(heap)();
+        Relax(a);
+
+        int bestA = a;
+        long minA = pot[a];
+        long delta = 0;
+        for (;;)
+        {
+            // Node of the second partition with the minimal distance, the outdated heap items are skipped
+            int b = -1;
+            long db = 0;
+            while (!heap.empty())
+            {
+                const HeapItem item = heap.top();
+                heap.pop();
+                if (item.first == dist[item.second])
+                {
+                    b = item.second;
+                    db = item.first;
+                    break;
+                }
+            }
+
+            if (b == -1 || db >= minA)
+            {
+                // Augmentation by the best node of the first partition
+                delta = minA;
+                AugmentPathTo(bestA);
+                isFree[a] = 0;
+                isFree[bestA] = 1;
+                break;
+            }
+            if (isFree[b])
+            {
+                // Augmentation by the path to b: a and b are matched
+                delta = db;
+                AugmentPathTo(b);
+                isFree[a] = 0;
+                isFree[b] = 0;
+                break;
+            }
+
+            // Continue the shortest paths through the mate of b
+            const int e = mate[b];
+            const int a2 = G.Source(e);
+            pred[a2] = e;
+            reachedA.push_back(a2);
+            dist[a2] = db;
+            if (db + pot[a2] < minA)
+            {
+                bestA = a2;
+                minA = db + pot[a2];
+            }
+            Relax(a2);
+        }
+
+        for (int ra : reachedA)
+        {
+            pred[ra] = -1;
+            const long potChange = delta - dist[ra];
+            if (potChange > 0)
+                pot[ra] -= potChange;
+        }
+        for (int rb : reachedB)
+        {
+            pred[rb] = -1;
+            const long potChange = delta - dist[rb];
+            if (potChange > 0)
+                pot[rb] += potChange;
+        }
+    }
+
+    long res = 0;
+    for (int e = 0; e < edgesCount; ++e)
+    {
+        if (matched[e])
+        {
+            matching.push_back(e);
+            res += G.Weight(e);
+        }
+    }
+    return res;
+}
+
+///
+/// \brief CSRConnectedComponents
+/// \param G
+/// \param component
+/// \return
+///
+int CSRConnectedComponents(const CSRGraph& G, std::vector<int>& component)
+{
+    const int nodesCount = G.NodesCount();
+
+    // Union-find with the path halving
+    std::vector<int> parents(nodesCount);
+    std::iota(parents.begin(), parents.end(), 0);
+    auto FindRoot = [&parents](int node)
+    {
+        while (parents[node] != node)
+        {
+            parents[node] = parents[parents[node]];
+            node = parents[node];
+        }
+        return node;
+    };
+    for (int e = 0; e < G.EdgesCount(); ++e)
+    {
+        const int r1 = FindRoot(G.Source(e));
+        const int r2 = FindRoot(G.Target(e));
+        if (r1 != r2)
+            parents[std::max(r1, r2)] = std::min(r1, r2);
+    }
+
+    // The root is the min node of the component, so it's numbered before the other nodes
+    component.resize(nodesCount);
+    int count = 0;
+    for (int i = 0; i < nodesCount; ++i)
+    {
+        const int root = FindRoot(i);
+        component[i] = (root == i) ? count++ : component[root];
+    }
+    return count;
+}
+
+///
+/// \brief MAX_WEIGHT_BIPARTITE_MATCHING_CSR
+/// \param G
+/// \param weights
+/// \return
+///
+GTL::edges_t MAX_WEIGHT_BIPARTITE_MATCHING_CSR(const GTL::graph& G, const GTL::edge_map<int>& weights)
+{
+    CSRGraph csr;
+    std::vector<GTL::edge> edges;
+    csr.FromGTL(G, &weights, nullptr, &edges);
+
+    std::vector<int> matching;
+    CSRMaxWeightBipartiteMatching(csr, matching);
+
+    GTL::edges_t res;
+    for (int e : matching)
+    {
+        res.push_back(edges[e]);
+    }
+    return res;
+}
+
+///
+/// \brief CONNECTED_COMPONENTS_CSR
+/// \param G
+/// \param component
+/// \return
+///
+int CONNECTED_COMPONENTS_CSR(const GTL::graph& G, GTL::node_map<int>& component)
+{
+    CSRGraph csr;
+    std::vector<GTL::node> nodes;
+    csr.FromGTL(G, nullptr, &nodes, nullptr);
+
+    std::vector<int> csrComponent;
+    const int count = CSRConnectedComponents(csr, csrComponent);
+
+    component.init(G, -1);
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+        component[nodes[i]] = csrComponent[i];
+    }
+    return count;
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <vector>
+
+#include <GTL/graph.h>
+#include <GTL/node_map.h>
+#include <GTL/edge_map.h>
+
+///
+/// \brief The CSRGraph class
+/// Compact directed graph for the algorithms of this folder: the out edges of the node are the contiguous range
+/// of the int arrays, so the traversals don't follow the pointers of the GTL lists. It's built once from
+/// the list of the edges or from GTL::graph and isn't changed by the algorithms
+///
+class CSRGraph
+{
+public:
+    CSRGraph() = default;
+
+    ///
+    /// \brief Build
+    /// \param nodesCount
+    /// \param sources - sources of the edges in [0, nodesCount)
+    /// \param targets - targets of the edges in [0, nodesCount)
+    /// \param weights - weights of the edges, empty for the zero weights
+    ///
+    void Build(int nodesCount, const std::vector<int>& sources, const std::vector<int>& targets, const std::vector<int>& weights);
+
+    ///
+    /// \brief FromGTL
+    /// Adapter of the GTL graph: nodes and edges are numbered in the order of the GTL iterators
+    /// \param G
+    /// \param weights - nullptr for the zero weights
+    /// \param nodes - if not nullptr then GTL node of the every CSR node
+    /// \param edges - if not nullptr then GTL edge of the every CSR edge
+    ///
+    void FromGTL(const GTL::graph& G, const GTL::edge_map<int>* weights, std::vector<GTL::node>* nodes, std::vector<GTL::edge>* edges);
+
+    ///
+    int NodesCount() const
+    {
+        return m_offsets.empty() ? 0 : static_cast<int>(m_offsets.size()) - 1;
+    }
+    ///
+    int EdgesCount() const
+    {
+        return static_cast<int>(m_targets.size());
+    }
+    ///
+    /// \brief OutBegin
+    /// \param node
+    /// \return The first out edge of the node, the out edges are [OutBegin, OutEnd)
+    ///
+    int OutBegin(int node) const
+    {
+        return m_offsets[node];
+    }
+    ///
+    int OutEnd(int node) const
+    {
+        return m_offsets[node + 1];
+    }
+    ///
+    int OutDegree(int node) const
+    {
+        return m_offsets[node + 1] - m_offsets[node];
+    }
+    ///
+    int Source(int edge) const
+    {
+        return m_sources[edge];
+    }
+    ///
+    int Target(int edge) const
+    {
+        return m_targets[edge];
+    }
+    ///
+    int Weight(int edge) const
+    {
+        return m_weights[edge];
+    }
+    ///
+    /// \brief InputEdge
+    /// \param edge
+    /// \return Index of the edge in the arrays of Build
+    ///
+    int InputEdge(int edge) const
+    {
+        return m_inputEdges[edge];
+    }
+
+private:
+    std::vector<int> m_offsets;    // Out edges of the node i are [m_offsets[i], m_offsets[i + 1])
+    std::vector<int> m_sources;    // Edges are sorted by the sources
+    std::vector<int> m_targets;
+    std::vector<int> m_weights;
+    std::vector<int> m_inputEdges;
+};
+
+///
+/// \brief CSRMaxWeightBipartiteMatching
+/// Maximum weight bipartite matching by the same algorithm as mwbmatching: nodes with the out edges are the first partition,
+/// the targets of the edges are the second. Edges aren't reversed, the matched edges are marked in the own arrays
+/// \param G
+/// \param matching - CSR edges of the matching
+/// \return Weight of the matching
+///
+long CSRMaxWeightBipartiteMatching(const CSRGraph& G, std::vector<int>& matching);
+
+///
+/// \brief CSRConnectedComponents
+/// Components of the graph with the undirected edges
+/// \param G
+/// \param component - component of the every node, the components are numbered in the order of their first nodes
+/// \return Count of the components
+///
+int CSRConnectedComponents(const CSRGraph& G, std::vector<int>& component);
+
+///
+/// \brief MAX_WEIGHT_BIPARTITE_MATCHING_CSR
+/// The same result as MAX_WEIGHT_BIPARTITE_MATCHING but on the CSR copy of the graph, G isn't changed
+/// \param G
+/// \param weights
+/// \return Edges of the matching
+///
+GTL::edges_t MAX_WEIGHT_BIPARTITE_MATCHING_CSR(const GTL::graph& G, const GTL::edge_map<int>& weights);
+
+///
+/// \brief CONNECTED_COMPONENTS_CSR
+/// \param G
+/// \param component - component of the every node
+/// \return Count of the components
+///
+int CONNECTED_COMPONENTS_CSR(const GTL::graph& G, GTL::node_map<int>& component);
@@ -52,6 +52,7 @@ void mincut::reset ()
 int mincut::run(GTL::graph& G)
 {
 	GTL::graph g;
+    g.use_pool(true); // The copy is built and destroyed on every run
     g.make_undirected();
 
     // Make a local copy of the graph as mincut modifies the original graph
@@ -106,4 +106,51 @@ cv::Mat phaseCorrelation(cv::Mat& x1, cv::Mat& x2, int h, int w, int channel) {
 		xy += xy_temp;
 	}
 	return xy;
-}
\ No newline at end of file
+}
+
+void channelsSpectra(const cv::Mat& x, int h, int channel, std::vector<cv::Mat>& spectra, FFTWorkspace& ws) {
+	spectra.resize(channel);
+	for (int i = 0; i < channel; i++) {
+		fftd(x.row(i).reshape(1, h), spectra[i], ws);
+	}
+}
+
+cv::Mat gaussianCorrelation(const cv::Mat& x1, const std::vector<cv::Mat>& x1f, const cv::Mat& x2, const std::vector<cv::Mat>& x2f,
+                            int h, int w, int channel, float sigma, FFTWorkspace& ws) {
+	const double n1 = cv::norm(x1);
+	const double n2 = cv::norm(x2);
+
+	// Inverse transform is linear: the sum of the spectra instead of the sum of the correlations
+	ws.m_sum.create(h, w, CV_32FC2);
+	ws.m_sum.setTo(cv::Scalar::all(0));
+	for (int i = 0; i < channel; i++) {
+		cv::mulSpectrums(x1f[i], x2f[i], ws.m_product, 0, true);
+		ws.m_sum += ws.m_product;
+	}
+	cv::Mat xy;
+	cv::dft(ws.m_sum, xy, cv::DFT_INVERSE | cv::DFT_SCALE | cv::DFT_REAL_OUTPUT);
+	rearrange(xy);
+
+	cv::Mat d;
+	cv::max(((n1 * n1 + n2 * n2) - 2. * xy) / (w * h * channel), 0, d);
+
+	cv::exp((-d / (sigma * sigma)), d);
+	cv::Mat kf;
+	fftd(d, kf, ws);
+	return kf;
+}
+
+cv::Mat phaseCorrelation(const std::vector<cv::Mat>& x1f, const std::vector<cv::Mat>& x2f, int h, int w, int channel, FFTWorkspace& ws) {
+	cv::Mat xy = cv::Mat(h, w, CV_32FC2, cv::Scalar(0));
+	for (int i = 0; i < channel; i++) {
+		cv::mulSpectrums(x1f[i], x2f[i], ws.m_product, 0, true);
+		cv::split(ws.m_product, ws.m_planes);
+		cv::magnitude(ws.m_planes[0], ws.m_planes[1], ws.m_magnitude);
+		ws.m_magnitude += 2.2204e-16;
+		cv::divide(ws.m_planes[0], ws.m_magnitude, ws.m_planes[0]);
+		cv::divide(ws.m_planes[1], ws.m_magnitude, ws.m_planes[1]);
+		cv::merge(ws.m_planes, 2, ws.m_product);
+		xy += ws.m_product;
+	}
+	return xy;
+}
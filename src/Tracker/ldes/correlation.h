@@ -1,6 +1,8 @@
 #pragma once
 #include <opencv2/opencv.hpp>
 #include <iostream>
+#include <vector>
+#include "fft_functions.h"
 
 cv::Mat gaussianCorrelation(cv::Mat& x1, cv::Mat& x2, int h, int w, int channel, float sigma);
 
@@ -10,3 +12,27 @@ cv::Mat polynomialCorrelation(cv::Mat& x1, cv::Mat& x2, int h, int w, int channe
 
 cv::Mat phaseCorrelation(cv::Mat& x1, cv::Mat& x2, int h, int w, int channel);
 
+///
+/// \brief channelsSpectra
+/// \param x - features with one channel in a row
+/// \param h
+/// \param channel
+/// \param spectra - spectrum of every channel, reused between the calls
+/// \param ws
+///
+void channelsSpectra(const cv::Mat& x, int h, int channel, std::vector<cv::Mat>& spectra, FFTWorkspace& ws);
+
+///
+/// \brief gaussianCorrelation
+/// The same as gaussianCorrelation(x1, x2, ...) with the precalculated spectra of the channels, the products are summed
+/// in the frequency domain, so only one inverse transform is used
+///
+cv::Mat gaussianCorrelation(const cv::Mat& x1, const std::vector<cv::Mat>& x1f, const cv::Mat& x2, const std::vector<cv::Mat>& x2f,
+                            int h, int w, int channel, float sigma, FFTWorkspace& ws);
+
+///
+/// \brief phaseCorrelation
+/// The same as phaseCorrelation(x1, x2, ...) with the precalculated spectra of the channels
+///
+cv::Mat phaseCorrelation(const std::vector<cv::Mat>& x1f, const std::vector<cv::Mat>& x2f, int h, int w, int channel, FFTWorkspace& ws);
+
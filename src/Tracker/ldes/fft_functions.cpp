@@ -87,4 +87,14 @@ void rearrange(cv::Mat& img) {
 	q1.copyTo(tmp); // swap quadrant (Top-Right with Bottom-Left)
 	q2.copyTo(q1);
 	tmp.copyTo(q2);
-}
\ No newline at end of file
+}
+
+void fftd(const cv::Mat& img, cv::Mat& res, FFTWorkspace& ws) {
+	if (img.type() == CV_32FC1) {
+		cv::dft(img, res, cv::DFT_COMPLEX_OUTPUT);
+	}
+	else {
+		img.convertTo(ws.m_real, CV_32F);
+		cv::dft(ws.m_real, res, cv::DFT_COMPLEX_OUTPUT);
+	}
+}
@@ -4,6 +4,29 @@
 
 cv::Mat fftd(const cv::Mat& img, bool reverse = false);
 
+///
+/// \brief The FFTWorkspace struct
+/// Buffers of one tracker for the transforms of the same size on every frame: cv::dft and the arithmetic
+/// write into the already allocated matrices
+///
+struct FFTWorkspace
+{
+	cv::Mat m_real;
+	cv::Mat m_product;
+	cv::Mat m_sum;
+	cv::Mat m_planes[2];
+	cv::Mat m_magnitude;
+};
+
+///
+/// \brief fftd
+/// Complex spectrum of the real image without the intermediate complex copy
+/// \param img
+/// \param res - reused if it has the same size
+/// \param ws
+///
+void fftd(const cv::Mat& img, cv::Mat& res, FFTWorkspace& ws);
+
 cv::Mat real(const cv::Mat& img);
 
 cv::Mat imag(const cv::Mat& img);
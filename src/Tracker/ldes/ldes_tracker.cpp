@@ -104,6 +104,8 @@ void LDESTracker::getTemplates(const cv::Mat& image)
 	_alphaf = cv::Mat(size_patch[0], size_patch[1], CV_32FC2, float(0));
 	_z = cv::Mat(size_patch[2], size_patch[0] * size_patch[1], CV_32F, float(0));
 	modelPatch=cv::Mat(size_scale[2], size_scale[0]*size_scale[1], CV_32F, float(0));
+	_zf.clear();
+	_modelPatchf.clear();
 	
 	trainLocation(x, 1.0);
 	trainScale(xl, 1.0);
@@ -112,10 +114,12 @@ void LDESTracker::getTemplates(const cv::Mat& image)
 ///
 void LDESTracker::trainLocation(cv::Mat& x, float train_interp_factor_)
 {
-	cv::Mat k = gaussianCorrelation(x, x, size_patch[0], size_patch[1], size_patch[2], sigma);
+	channelsSpectra(x, size_patch[0], size_patch[2], _xf, _fftWs);
+	cv::Mat k = gaussianCorrelation(x, _xf, x, _xf, size_patch[0], size_patch[1], size_patch[2], sigma, _fftWs);
 	cv::Mat alphaf = complexDivision(_yf, (k + lambda));
 
 	_z = (1 - train_interp_factor_) * _z + (train_interp_factor_)* x;
+	updateSpectra(_zf, _xf, train_interp_factor_);
 	_alphaf = (1 - train_interp_factor_) * _alphaf + (train_interp_factor_)* alphaf;
 }
 
@@ -123,6 +127,22 @@ void LDESTracker::trainLocation(cv::Mat& x, float train_interp_factor_)
 void LDESTracker::trainScale(cv::Mat& x, float interp_factor_)
 {
 	modelPatch = (1 - interp_factor_)*modelPatch + interp_factor_ * x;
+	channelsSpectra(x, size_scale[0], size_scale[2], _xlf, _fftWs);
+	updateSpectra(_modelPatchf, _xlf, interp_factor_);
+}
+
+///
+void LDESTracker::updateSpectra(std::vector<cv::Mat>& modelf, const std::vector<cv::Mat>& xf, float interp_factor_)
+{
+	if (modelf.size() != xf.size()) {
+		modelf.resize(xf.size());
+		for (size_t i = 0; i < xf.size(); i++) {
+			modelf[i] = cv::Mat::zeros(xf[i].size(), xf[i].type());
+		}
+	}
+	for (size_t i = 0; i < xf.size(); i++) {
+		cv::addWeighted(modelf[i], 1 - interp_factor_, xf[i], interp_factor_, 0, modelf[i]);
+	}
 }
 
 ///
@@ -221,7 +241,9 @@ cv::Mat LDESTracker::cropImageAffine(const cv::Mat& image, const cv::Point2i& po
 ///
 void LDESTracker::estimateLocation(cv::Mat& z, cv::Mat x)
 {
-	cv::Mat kf = gaussianCorrelation(x, z, size_patch[0], size_patch[1], size_patch[2], sigma);
+	// z is _z with the spectra in _zf
+	channelsSpectra(x, size_patch[0], size_patch[2], _xf, _fftWs);
+	cv::Mat kf = gaussianCorrelation(x, _xf, z, _zf, size_patch[0], size_patch[1], size_patch[2], sigma, _fftWs);
 	cv::Mat res = fftd(complexMultiplication(_alphaf, kf), true);
 
     res.copyTo(resmap_location);
@@ -250,9 +272,11 @@ void LDESTracker::estimateLocation(cv::Mat& z, cv::Mat x)
 }
 
 ///
-void LDESTracker::estimateScale(cv::Mat& z, cv::Mat& x)
+void LDESTracker::estimateScale(cv::Mat& /*z*/, cv::Mat& x)
 {
-	cv::Mat rf = phaseCorrelation(x, z, size_scale[0], size_scale[1], size_scale[2]);
+	// z is modelPatch with the spectra in _modelPatchf
+	channelsSpectra(x, size_scale[0], size_scale[2], _xlf, _fftWs);
+	cv::Mat rf = phaseCorrelation(_xlf, _modelPatchf, size_scale[0], size_scale[1], size_scale[2], _fftWs);
 	cv::Mat res = fftd(rf, true);
 	rearrange(res);
 
@@ -412,18 +436,8 @@ void LDESTracker::createGaussianPeak(int sizey, int sizex)
 cv::Mat LDESTracker::getFeatures(const cv::Mat & patchl, cv::Mat& han, int* sizes, bool inithann)
 {
 	cv::Mat FeaturesMap;
-	// HOG features
-	CvLSVMFeatureMapCaskade *map;
-	getFeatureMaps(patchl, cell_size, &map);
-	normalizeAndTruncate(map, 0.2f);
-	PCAFeatureMaps(map);
-	sizes[0] = map->sizeY;
-	sizes[1] = map->sizeX;
-	sizes[2] = map->numFeatures;
-
-	FeaturesMap = cv::Mat(cv::Size(map->numFeatures, map->sizeX*map->sizeY), CV_32F, map->map);  // Procedure do deal with cv::Mat multichannel bug
-	FeaturesMap = FeaturesMap.t();
-	freeFeatureMapObject(&map);
+	// HOG features: one row per channel
+	fhogRows(FeaturesMap, patchl, sizes, cell_size, 9, 0.2f);
 
 	if (inithann) {		
 		cv::Size hannSize(sizes[1], sizes[0]);
@@ -2,7 +2,7 @@
 #include <opencv2/opencv.hpp>
 #include "fft_functions.h"
 #include "correlation.h"
-#include "fhog.hpp"
+#include "../fhog/fhog.h"
 #include "hann.h"
 
 #include "../VOTTracker.hpp"
@@ -119,6 +119,16 @@ protected:
 	cv::Mat _labCentroids;
 	cv::Rect _roi;
 
+	// Spectra are linear: the models are updated in the frequency domain together with the time domain
+	// and aren't transformed again on every BGD iteration
+	FFTWorkspace _fftWs;
+	std::vector<cv::Mat> _xf;	//spectra of the location features
+	std::vector<cv::Mat> _zf;	//spectra of _z
+	std::vector<cv::Mat> _xlf;	//spectra of the scale features
+	std::vector<cv::Mat> _modelPatchf;	//spectra of modelPatch
+
+	void updateSpectra(std::vector<cv::Mat>& modelf, const std::vector<cv::Mat>& xf, float interp_factor_);
+
 private:
 	int size_patch[3];
 	int size_scale[3];
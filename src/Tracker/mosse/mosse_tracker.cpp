@@ -0,0 +1,294 @@
+#include "mosse_tracker.h"
+#include "../fhog/sse.hpp"
+
+///
+/// \brief MOSSETracker::MOSSETracker
+///
+MOSSETracker::MOSSETracker()
+    : MOSSETracker(Params())
+{
+}
+
+///
+/// \brief MOSSETracker::MOSSETracker
+/// \param params
+///
+MOSSETracker::MOSSETracker(const Params& params)
+    : m_params(params), m_rng(0x4d4f5353)
+{
+    m_warp.create(2, 3, CV_32F);
+}
+
+///
+/// \brief MOSSETracker::Initialize
+/// The buffers are reallocated only if the template size was changed
+/// \param im
+/// \param region
+///
+void MOSSETracker::Initialize(const cv::Mat &/*im*/, cv::Rect region)
+{
+    m_pos = cv::Point2f(region.x + region.width / 2.f, region.y + region.height / 2.f);
+    m_targetSize = cv::Size2f(static_cast<float>(std::max(1, region.width)), static_cast<float>(std::max(1, region.height)));
+    m_windowSize = cv::Size2f(m_params.m_padding * m_targetSize.width, m_params.m_padding * m_targetSize.height);
+
+    const float tmplScale = m_params.m_templateSize / std::max(m_windowSize.width, m_windowSize.height);
+    const cv::Size tmplSize(cv::getOptimalDFTSize(std::max(8, cvRound(tmplScale * m_windowSize.width))),
+                            cv::getOptimalDFTSize(std::max(8, cvRound(tmplScale * m_windowSize.height))));
+    if (tmplSize == m_tmplSize)
+        return;
+
+    m_tmplSize = tmplSize;
+    cv::createHanningWindow(m_hann, m_tmplSize, CV_32F);
+
+    // Gaussian peak in the template center
+    cv::Mat target(m_tmplSize, CV_32F);
+    const float cx = static_cast<float>(m_tmplSize.width / 2);
+    const float cy = static_cast<float>(m_tmplSize.height / 2);
+    const float k = -0.5f / (m_params.m_sigma * m_params.m_sigma);
+    for (int y = 0; y < target.rows; ++y)
+    {
+        float* row = target.ptr<float>(y);
+        for (int x = 0; x < target.cols; ++x)
+        {
+            row[x] = std::exp(k * ((x - cx) * (x - cx) + (y - cy) * (y - cy)));
+        }
+    }
+    cv::dft(target, m_spectrum, cv::DFT_COMPLEX_OUTPUT);
+    cv::split(m_spectrum, m_planes);
+    m_planes[0].copyTo(m_targetRe);
+    m_planes[1].copyTo(m_targetIm);
+
+    m_numRe.create(m_tmplSize, CV_32F);
+    m_numIm.create(m_tmplSize, CV_32F);
+    m_den.create(m_tmplSize, CV_32F);
+    m_patch8u.create(m_tmplSize, CV_8UC1);
+    m_patch.create(m_tmplSize, CV_32F);
+    m_response.create(m_tmplSize, CV_32F);
+}
+
+///
+/// \brief MOSSETracker::Update
+/// \param im
+/// \param confidence - PSR of the response / m_psrScale
+/// \return
+///
+cv::RotatedRect MOSSETracker::Update(const cv::Mat &im, float& confidence)
+{
+    confidence = 0;
+    if (m_tmplSize.area() <= 0)
+        return cv::RotatedRect(m_pos, m_targetSize, 0.f);
+
+    Sample(Gray(im), 0.f, 1.f);
+    Spectrum();
+    cv::Point2f shift;
+    confidence = Correlate(shift) / m_params.m_psrScale;
+
+    m_pos.x += shift.x * m_windowSize.width / m_tmplSize.width;
+    m_pos.y += shift.y * m_windowSize.height / m_tmplSize.height;
+    m_pos.x = std::max(0.f, std::min(static_cast<float>(im.cols - 1), m_pos.x));
+    m_pos.y = std::max(0.f, std::min(static_cast<float>(im.rows - 1), m_pos.y));
+    return cv::RotatedRect(m_pos, m_targetSize, 0.f);
+}
+
+///
+/// \brief MOSSETracker::Train
+/// The first filter is the average of the target and its small random rotations and scales
+/// \param im
+/// \param first
+///
+void MOSSETracker::Train(const cv::Mat &im, bool first)
+{
+    if (m_tmplSize.area() <= 0)
+        return;
+
+    const cv::Mat& gray = Gray(im);
+    if (first)
+    {
+        m_numRe.setTo(0);
+        m_numIm.setTo(0);
+        m_den.setTo(0);
+
+        const float weight = 1.f / (m_params.m_perturbations + 1);
+        Sample(gray, 0.f, 1.f);
+        Spectrum();
+        Accumulate(1.f, weight);
+        for (int i = 0; i < m_params.m_perturbations; ++i)
+        {
+            Sample(gray, m_rng.uniform(-0.1f, 0.1f), m_rng.uniform(0.9f, 1.1f));
+            Spectrum();
+            Accumulate(1.f, weight);
+        }
+    }
+    else
+    {
+        Sample(gray, 0.f, 1.f);
+        Spectrum();
+        Accumulate(1.f - m_params.m_learningRate, m_params.m_learningRate);
+    }
+}
+
+///
+/// \brief MOSSETracker::Gray
+/// \param im
+/// \return
+///
+const cv::Mat& MOSSETracker::Gray(const cv::Mat& im)
+{
+    if (im.channels() == 1)
+        return im;
+    cv::cvtColor(im, m_gray, (im.channels() == 4) ? cv::COLOR_BGRA2GRAY : cv::COLOR_BGR2GRAY);
+    return m_gray;
+}
+
+///
+/// \brief MOSSETracker::Sample
+/// The window around m_pos is warped to the template with the rotation and the scale around its center,
+/// the out of frame pixels are replicated. The template is log-transformed, normalized and windowed
+/// \param gray
+/// \param angle - in radians
+/// \param scale
+///
+void MOSSETracker::Sample(const cv::Mat& gray, float angle, float scale)
+{
+    const float sx = scale * m_windowSize.width / m_tmplSize.width;
+    const float sy = scale * m_windowSize.height / m_tmplSize.height;
+    const float cosA = std::cos(angle);
+    const float sinA = std::sin(angle);
+    const float centerX = static_cast<float>(m_tmplSize.width / 2);
+    const float centerY = static_cast<float>(m_tmplSize.height / 2);
+
+    // Template to frame
+    float* warp = m_warp.ptr<float>();
+    warp[0] = cosA * sx;
+    warp[1] = -sinA * sy;
+    warp[2] = m_pos.x - warp[0] * centerX - warp[1] * centerY;
+    warp[3] = sinA * sx;
+    warp[4] = cosA * sy;
+    warp[5] = m_pos.y - warp[3] * centerX - warp[4] * centerY;
+    cv::warpAffine(gray, m_patch8u, m_warp, m_tmplSize, cv::INTER_LINEAR | cv::WARP_INVERSE_MAP, cv::BORDER_REPLICATE);
+
+    m_patch8u.convertTo(m_patch, CV_32F, 1., 1.);
+    cv::log(m_patch, m_patch);
+    cv::Scalar mean;
+    cv::Scalar stddev;
+    cv::meanStdDev(m_patch, mean, stddev);
+    const double norm = 1. / (stddev[0] + 1e-5);
+    m_patch.convertTo(m_patch, CV_32F, norm, -mean[0] * norm);
+    cv::multiply(m_patch, m_hann, m_patch);
+}
+
+///
+/// \brief MOSSETracker::Spectrum
+/// Real and imaginary planes of the template spectrum
+///
+void MOSSETracker::Spectrum()
+{
+    cv::dft(m_patch, m_spectrum, cv::DFT_COMPLEX_OUTPUT);
+    cv::split(m_spectrum, m_planes);
+}
+
+///
+/// \brief MOSSETracker::Accumulate
+/// num = keep * num + add * G * conj(F), den = keep * den + add * F * conj(F)
+/// \param keep
+/// \param add
+///
+void MOSSETracker::Accumulate(float keep, float add)
+{
+    const int n = m_tmplSize.area();
+    const float* gr = m_targetRe.ptr<float>();
+    const float* gi = m_targetIm.ptr<float>();
+    const float* fr = m_planes[0].ptr<float>();
+    const float* fi = m_planes[1].ptr<float>();
+    float* ar = m_numRe.ptr<float>();
+    float* ai = m_numIm.ptr<float>();
+    float* b = m_den.ptr<float>();
+
+    int i = 0;
+    const __m128 vKeep = sse::SET(keep);
+    const __m128 vAdd = sse::SET(add);
+    for (; i + 4 <= n; i += 4)
+    {
+        const __m128 vgr = sse::LDu(gr[i]);
+        const __m128 vgi = sse::LDu(gi[i]);
+        const __m128 vfr = sse::LDu(fr[i]);
+        const __m128 vfi = sse::LDu(fi[i]);
+
+        const __m128 re = sse::ADD(sse::MUL(vgr, vfr), sse::MUL(vgi, vfi));
+        const __m128 im = sse::SUB(sse::MUL(vgi, vfr), sse::MUL(vgr, vfi));
+        const __m128 power = sse::ADD(sse::MUL(vfr, vfr), sse::MUL(vfi, vfi));
+
+        sse::STRu(ar[i], sse::ADD(sse::MUL(vKeep, sse::LDu(ar[i])), sse::MUL(vAdd, re)));
+        sse::STRu(ai[i], sse::ADD(sse::MUL(vKeep, sse::LDu(ai[i])), sse::MUL(vAdd, im)));
+        sse::STRu(b[i], sse::ADD(sse::MUL(vKeep, sse::LDu(b[i])), sse::MUL(vAdd, power)));
+    }
+    for (; i < n; ++i)
+    {
+        ar[i] = keep * ar[i] + add * (gr[i] * fr[i] + gi[i] * fi[i]);
+        ai[i] = keep * ai[i] + add * (gi[i] * fr[i] - gr[i] * fi[i]);
+        b[i] = keep * b[i] + add * (fr[i] * fr[i] + fi[i] * fi[i]);
+    }
+}
+
+///
+/// \brief MOSSETracker::Correlate
+/// The response spectrum F * num / den replaces the template spectrum
+/// \param shift - of the peak from the template center, in the template pixels
+/// \return PSR of the response
+///
+float MOSSETracker::Correlate(cv::Point2f& shift)
+{
+    const int n = m_tmplSize.area();
+    const float* ar = m_numRe.ptr<float>();
+    const float* ai = m_numIm.ptr<float>();
+    const float* b = m_den.ptr<float>();
+    float* fr = m_planes[0].ptr<float>();
+    float* fi = m_planes[1].ptr<float>();
+
+    int i = 0;
+    const __m128 vEps = sse::SET(m_params.m_eps);
+    const __m128 vTwo = sse::SET(2.f);
+    for (; i + 4 <= n; i += 4)
+    {
+        const __m128 vfr = sse::LDu(fr[i]);
+        const __m128 vfi = sse::LDu(fi[i]);
+        const __m128 var = sse::LDu(ar[i]);
+        const __m128 vai = sse::LDu(ai[i]);
+        const __m128 den = sse::ADD(sse::LDu(b[i]), vEps);
+
+        // Approximate reciprocal with one Newton step
+        __m128 inv = sse::RCP(den);
+        inv = sse::MUL(inv, sse::SUB(vTwo, sse::MUL(den, inv)));
+
+        sse::STRu(fr[i], sse::MUL(sse::SUB(sse::MUL(vfr, var), sse::MUL(vfi, vai)), inv));
+        sse::STRu(fi[i], sse::MUL(sse::ADD(sse::MUL(vfr, vai), sse::MUL(vfi, var)), inv));
+    }
+    for (; i < n; ++i)
+    {
+        const float inv = 1.f / (b[i] + m_params.m_eps);
+        const float re = (fr[i] * ar[i] - fi[i] * ai[i]) * inv;
+        const float im = (fr[i] * ai[i] + fi[i] * ar[i]) * inv;
+        fr[i] = re;
+        fi[i] = im;
+    }
+    cv::merge(m_planes, 2, m_spectrum);
+    cv::dft(m_spectrum, m_response, cv::DFT_INVERSE | cv::DFT_SCALE | cv::DFT_REAL_OUTPUT);
+
+    double maxVal = 0;
+    cv::Point peak;
+    cv::minMaxLoc(m_response, nullptr, &maxVal, nullptr, &peak);
+    shift = cv::Point2f(static_cast<float>(peak.x - m_tmplSize.width / 2), static_cast<float>(peak.y - m_tmplSize.height / 2));
+
+    constexpr int peakHalf = 5;
+    const cv::Rect peakArea = cv::Rect(peak.x - peakHalf, peak.y - peakHalf, 2 * peakHalf + 1, 2 * peakHalf + 1) & cv::Rect(0, 0, m_response.cols, m_response.rows);
+    const double count = static_cast<double>(m_response.total() - peakArea.area());
+    if (count < 1)
+        return 0.f;
+
+    const cv::Mat peakResponse = m_response(peakArea);
+    const double sum = cv::sum(m_response)[0] - cv::sum(peakResponse)[0];
+    const double sqSum = m_response.dot(m_response) - peakResponse.dot(peakResponse);
+    const double mean = sum / count;
+    const double variance = sqSum / count - mean * mean;
+    return static_cast<float>((maxVal - mean) / std::sqrt(std::max(variance, 1e-12)));
+}
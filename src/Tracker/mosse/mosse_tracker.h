@@ -0,0 +1,67 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+
+#include "../VOTTracker.hpp"
+
+///
+/// \brief The MOSSETracker class
+/// MOSSE correlation filter (Bolme et al., "Visual Object Tracking using Adaptive Correlation Filters") on the gray frame.
+/// The window of the target is warped to the template of the fixed size, so the DFTs of the every frame have the same size
+/// and all buffers are allocated once by Initialize. The spectra are kept as the separate real and imaginary planes:
+/// the training and the correlation are the element-wise SIMD kernels on them
+///
+class MOSSETracker final : public VOTTracker
+{
+public:
+    ///
+    /// \brief The Params struct
+    ///
+    struct Params
+    {
+        int m_templateSize = 64;        // Max side of the template, the sides are the optimal DFT sizes
+        float m_padding = 2.f;          // Window in sizes of the target
+        float m_learningRate = 0.125f;  // Update rate of the filter
+        float m_sigma = 2.f;            // Gaussian of the desired response in the template pixels
+        float m_eps = 1e-5f;            // Regularization of the filter denominator
+        float m_psrScale = 20.f;        // Confidence is PSR / m_psrScale
+        int m_perturbations = 8;        // Random affine samples of the first frame
+    };
+
+    MOSSETracker();
+    explicit MOSSETracker(const Params& params);
+    ~MOSSETracker() = default;
+
+    void Initialize(const cv::Mat &im, cv::Rect region);
+    cv::RotatedRect Update(const cv::Mat &im, float& confidence);
+    void Train(const cv::Mat &im, bool first);
+
+private:
+    Params m_params;
+
+    cv::Point2f m_pos;
+    cv::Size2f m_targetSize;
+    cv::Size2f m_windowSize;
+    cv::Size m_tmplSize;
+    cv::RNG m_rng;
+
+    cv::Mat m_hann;
+    cv::Mat m_targetRe;    // Spectrum of the desired response
+    cv::Mat m_targetIm;
+    cv::Mat m_numRe;       // Filter is numerator / denominator
+    cv::Mat m_numIm;
+    cv::Mat m_den;
+
+    cv::Mat m_gray;
+    cv::Mat m_warp;
+    cv::Mat m_patch8u;
+    cv::Mat m_patch;
+    cv::Mat m_spectrum;
+    cv::Mat m_planes[2];
+    cv::Mat m_response;
+
+    const cv::Mat& Gray(const cv::Mat& im);
+    void Sample(const cv::Mat& gray, float angle, float scale);
+    void Spectrum();
+    void Accumulate(float keep, float add);
+    float Correlate(cv::Point2f& shift);
+};
@@ -0,0 +1,349 @@
+#include "mtracking_c.h"
+
+#include <iostream>
+#include <exception>
+#include <algorithm>
+
+#include "Ctracker.h"
+#include "TrackerSettings.h"
+#include "ShmDetectionsRing.h"
+#include "ShmTracksRing.h"
+
+///
+/// \brief The mt_tracker struct
+///
+struct mt_tracker
+{
+    std::unique_ptr<BaseTracker> m_tracker;
+    regions_t m_regions;
+    std::vector<RegionEmbedding> m_embeddings;
+    std::vector<TrackingObject> m_tracks;
+    std::vector<track_id_t> m_removed;
+    TracksDelta m_delta;
+};
+
+///
+/// \brief The mt_ring struct
+///
+struct mt_ring
+{
+    ShmDetectionsRing m_ring;
+};
+
+///
+/// \brief The mt_tracks_ring struct
+///
+struct mt_tracks_ring
+{
+    ShmTracksRing m_ring;
+};
+
+namespace
+{
+///
+/// \brief WrapFrame
+/// \param frame
+/// \return UMat over the frame of the caller without the copy or the empty one
+///
+cv::UMat WrapFrame(const mt_frame_t* frame)
+{
+    if (!frame || !frame->data || frame->width <= 0 || frame->height <= 0 || frame->channels < 1 || frame->channels > 4)
+        return cv::UMat();
+    cv::Mat mat(frame->height, frame->width, CV_8UC(frame->channels), const_cast<uint8_t*>(frame->data), frame->stride ? frame->stride : cv::Mat::AUTO_STEP);
+    return mat.getUMat(cv::ACCESS_READ);
+}
+
+///
+/// \brief FillRegions
+/// \param tracker
+/// \param regions
+/// \param regionsCount
+/// \param embeddings - regionsCount x embeddingDim floats, the rows are wrapped without the copy
+/// \param embeddingDim
+///
+void FillRegions(mt_tracker_t* tracker, const mt_region_t* regions, size_t regionsCount, const float* embeddings, size_t embeddingDim)
+{
+    tracker->m_regions.clear();
+    tracker->m_regions.reserve(regionsCount);
+    for (size_t i = 0; i < regionsCount; ++i)
+    {
+        const mt_region_t& reg = regions[i];
+        tracker->m_regions.emplace_back(cv::Rect(reg.x, reg.y, reg.width, reg.height), static_cast<objtype_t>(reg.type), reg.confidence);
+    }
+
+    tracker->m_embeddings.resize(embeddings ? regionsCount : 0);
+    for (size_t i = 0; i < tracker->m_embeddings.size(); ++i)
+    {
+        RegionEmbedding& regEmb = tracker->m_embeddings[i];
+        regEmb.m_embedding = cv::Mat(1, static_cast<int>(embeddingDim), CV_32FC1, const_cast<float*>(embeddings + i * embeddingDim));
+        regEmb.m_embDot = regEmb.m_embedding.dot(regEmb.m_embedding);
+    }
+}
+
+///
+/// \brief Update
+/// \param tracker
+/// \param frame
+/// \param fps
+/// \param timestamp - > 0 for the update by the timestamp if the embeddings are absent
+/// \return
+///
+int Update(mt_tracker_t* tracker, const mt_frame_t* frame, float fps, double timestamp)
+{
+    try
+    {
+        cv::UMat currFrame = WrapFrame(frame);
+        if (!tracker->m_embeddings.empty())
+            tracker->m_tracker->Update(tracker->m_regions, tracker->m_embeddings, currFrame, fps);
+        else if (timestamp > 0)
+            tracker->m_tracker->UpdateAt(tracker->m_regions, currFrame, timestamp);
+        else
+            tracker->m_tracker->Update(tracker->m_regions, currFrame, fps);
+
+        // The external embeddings are views of the caller memory: they aren't kept after the update
+        tracker->m_embeddings.clear();
+        return MT_OK;
+    }
+    catch (const std::exception& ex)
+    {
+        std::cerr << "mt_tracker_update: " << ex.what() << std::endl;
+    }
+    tracker->m_embeddings.clear();
+    return MT_ERROR;
+}
+}
+
+///
+uint32_t mt_api_version(void)
+{
+    return MT_API_VERSION;
+}
+
+///
+mt_tracker_t* mt_tracker_create(const char* settings_file)
+{
+    try
+    {
+        TrackerSettings settings;
+        if (settings_file && !ParseTrackerSettings(settings_file, settings))
+            return nullptr;
+
+        std::unique_ptr<mt_tracker_t> tracker = std::make_unique<mt_tracker_t>();
+        tracker->m_tracker = BaseTracker::CreateTracker(settings);
+        if (!tracker->m_tracker)
+            return nullptr;
+        return tracker.release();
+    }
+    catch (const std::exception& ex)
+    {
+        std::cerr << "mt_tracker_create: " << ex.what() << std::endl;
+    }
+    return nullptr;
+}
+
+///
+void mt_tracker_destroy(mt_tracker_t* tracker)
+{
+    delete tracker;
+}
+
+///
+int mt_tracker_update(mt_tracker_t* tracker, const mt_region_t* regions, size_t regions_count, const mt_frame_t* frame, float fps)
+{
+    if (!tracker || (regions_count && !regions))
+        return MT_ERROR;
+
+    FillRegions(tracker, regions, regions_count, nullptr, 0);
+    return Update(tracker, frame, fps, 0);
+}
+
+///
+int mt_tracker_update_embeddings(mt_tracker_t* tracker, const mt_region_t* regions, size_t regions_count,
+                                 const float* embeddings, size_t embedding_dim, const mt_frame_t* frame, float fps)
+{
+    if (!tracker || (regions_count && (!regions || !embeddings || !embedding_dim)))
+        return MT_ERROR;
+
+    FillRegions(tracker, regions, regions_count, embeddings, embedding_dim);
+    return Update(tracker, frame, fps, 0);
+}
+
+///
+size_t mt_tracker_get_tracks(const mt_tracker_t* tracker, mt_track_t* tracks, size_t capacity)
+{
+    if (!tracker)
+        return 0;
+
+    auto& trackingObjects = const_cast<mt_tracker_t*>(tracker)->m_tracks;
+    trackingObjects.clear();
+    tracker->m_tracker->GetTracks(trackingObjects);
+
+    const size_t count = tracks ? std::min(capacity, trackingObjects.size()) : 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        ShmTracksRing::ToTrack(trackingObjects[i], tracks[i]);
+    }
+    return trackingObjects.size();
+}
+
+///
+size_t mt_tracker_get_removed(const mt_tracker_t* tracker, uint64_t* ids, size_t capacity)
+{
+    if (!tracker)
+        return 0;
+
+    auto& removed = const_cast<mt_tracker_t*>(tracker)->m_removed;
+    removed.clear();
+    tracker->m_tracker->GetRemovedTracks(removed);
+
+    const size_t count = ids ? std::min(capacity, removed.size()) : 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        ids[i] = static_cast<uint64_t>(removed[i].m_val);
+    }
+    return removed.size();
+}
+
+///
+mt_ring_t* mt_ring_create(const char* name, uint32_t slots, uint32_t max_regions, uint32_t embedding_dim)
+{
+    if (!name)
+        return nullptr;
+    std::unique_ptr<mt_ring_t> ring = std::make_unique<mt_ring_t>();
+    return ring->m_ring.Create(name, slots, max_regions, embedding_dim) ? ring.release() : nullptr;
+}
+
+///
+mt_ring_t* mt_ring_open(const char* name)
+{
+    if (!name)
+        return nullptr;
+    std::unique_ptr<mt_ring_t> ring = std::make_unique<mt_ring_t>();
+    return ring->m_ring.Open(name) ? ring.release() : nullptr;
+}
+
+///
+void mt_ring_close(mt_ring_t* ring)
+{
+    delete ring;
+}
+
+///
+int mt_ring_remove(const char* name)
+{
+    return (name && ShmMapping::Remove(name)) ? MT_OK : MT_ERROR;
+}
+
+///
+int mt_ring_write(mt_ring_t* ring, uint64_t frame_index, double timestamp, const mt_region_t* regions, size_t regions_count, const float* embeddings)
+{
+    return (ring && ring->m_ring.Write(frame_index, timestamp, regions, regions_count, embeddings)) ? MT_OK : MT_ERROR;
+}
+
+///
+int mt_tracker_update_ring(mt_tracker_t* tracker, mt_ring_t* ring, const mt_frame_t* frame, float fps, uint64_t* frame_index)
+{
+    if (!tracker || !ring)
+        return MT_ERROR;
+
+    ShmDetectionsRing::FrameView view;
+    bool lapped = false;
+    if (!ring->m_ring.Acquire(view, lapped))
+        return MT_NO_DATA;
+
+    // The regions are converted to regions_t, the embeddings are used in place in the shared memory
+    FillRegions(tracker, view.m_regions, view.m_regionsCount, view.m_embeddings, view.m_embeddingDim);
+    if (!ring->m_ring.Validate(view))
+    {
+        tracker->m_embeddings.clear();
+        return MT_RING_TORN;
+    }
+
+    const int res = Update(tracker, frame, fps, view.m_timestamp);
+    if (res != MT_OK)
+        return res;
+    if (frame_index)
+        *frame_index = view.m_frameIndex;
+
+    // The embeddings could be changed by the producer during the update
+    if (view.m_embeddings && !ring->m_ring.Validate(view))
+        return MT_RING_TORN;
+    return lapped ? MT_RING_LAPPED : MT_OK;
+}
+
+///
+mt_tracks_ring_t* mt_tracks_ring_create(const char* name, uint32_t slots, uint32_t max_tracks, uint32_t max_removed)
+{
+    if (!name)
+        return nullptr;
+    std::unique_ptr<mt_tracks_ring_t> ring = std::make_unique<mt_tracks_ring_t>();
+    return ring->m_ring.Create(name, slots, max_tracks, max_removed) ? ring.release() : nullptr;
+}
+
+///
+mt_tracks_ring_t* mt_tracks_ring_open(const char* name)
+{
+    if (!name)
+        return nullptr;
+    std::unique_ptr<mt_tracks_ring_t> ring = std::make_unique<mt_tracks_ring_t>();
+    return ring->m_ring.Open(name) ? ring.release() : nullptr;
+}
+
+///
+void mt_tracks_ring_close(mt_tracks_ring_t* ring)
+{
+    delete ring;
+}
+
+///
+int mt_tracker_publish(mt_tracker_t* tracker, mt_tracks_ring_t* ring, uint64_t frame_index, double timestamp)
+{
+    if (!tracker || !ring)
+        return MT_ERROR;
+
+    try
+    {
+        tracker->m_tracker->GetTracksDelta(tracker->m_delta, false);
+        return ring->m_ring.Publish(frame_index, timestamp, tracker->m_delta) ? MT_OK : MT_ERROR;
+    }
+    catch (const std::exception& ex)
+    {
+        std::cerr << "mt_tracker_publish: " << ex.what() << std::endl;
+    }
+    return MT_ERROR;
+}
+
+///
+int mt_tracks_ring_acquire(mt_tracks_ring_t* ring, mt_tracks_view_t* view, int latest)
+{
+    if (!ring || !view)
+        return MT_ERROR;
+
+    ShmTracksRing::FrameView frameView;
+    bool lapped = false;
+    if (latest ? !ring->m_ring.AcquireLatest(frameView) : !ring->m_ring.Acquire(frameView, lapped))
+        return MT_NO_DATA;
+
+    view->frame_index = frameView.m_frameIndex;
+    view->timestamp = frameView.m_timestamp;
+    view->tracks = frameView.m_tracks;
+    view->tracks_count = frameView.m_tracksCount;
+    view->removed = frameView.m_removed;
+    view->removed_count = frameView.m_removedCount;
+    view->truncated = frameView.m_truncated ? 1 : 0;
+    view->seq = frameView.m_seq;
+    view->slot = frameView.m_slot;
+    return lapped ? MT_RING_LAPPED : MT_OK;
+}
+
+///
+int mt_tracks_ring_validate(const mt_tracks_ring_t* ring, const mt_tracks_view_t* view)
+{
+    if (!ring || !view)
+        return MT_ERROR;
+
+    ShmTracksRing::FrameView frameView;
+    frameView.m_seq = view->seq;
+    frameView.m_slot = static_cast<const ShmTracksRing::ShmTracksSlot*>(view->slot);
+    return ring->m_ring.Validate(frameView) ? MT_OK : MT_RING_TORN;
+}
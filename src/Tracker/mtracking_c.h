@@ -0,0 +1,237 @@
+#pragma once
+
+///
+/// Stable C API of the tracker: opaque handles, plain structs and the status codes, no C++ types and exceptions
+/// cross the boundary. The ABI is versioned by MT_API_VERSION, the structs are only extended in the new versions.
+///
+/// The shared memory ring of the detections connects the detector process (producer) with the tracker process (consumer):
+/// the producer writes the regions and the optional embeddings of the frame into the slot, the consumer reads them in place.
+/// One ring has one producer and one consumer, the tracker service opens one ring and one tracker per detector process.
+///
+/// The shared memory ring of the tracks publishes the results of the tracker to the analytics processes: the tracker
+/// writes the all alive tracks and the removed IDs of the frame into the slot, any count of the readers read them in place.
+/// The tracker never waits for the readers, the slow reader skips the overwritten frames.
+///
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#  define MT_API // mtracking is the static library on Windows
+#else
+#  define MT_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MT_API_VERSION 1
+
+/// Status codes
+#define MT_OK 0
+#define MT_NO_DATA 1         // The ring hasn't the new frames
+#define MT_ERROR -1          // Invalid arguments or the failed call, see stderr
+#define MT_RING_LAPPED -2    // The producer has overwritten the unread frames, the consumer skipped to the oldest alive one
+#define MT_RING_TORN -3      // The slot was overwritten while the tracker was reading it: the regions were dropped or the embeddings were inconsistent
+
+typedef struct mt_tracker mt_tracker_t;
+typedef struct mt_ring mt_ring_t;
+typedef struct mt_tracks_ring mt_tracks_ring_t;
+
+///
+/// \brief The mt_region_t struct
+/// Axis aligned region of the detector
+///
+typedef struct mt_region
+{
+    int32_t x;
+    int32_t y;
+    int32_t width;
+    int32_t height;
+    int32_t type;       // objtype_t, -1 - unknown
+    float confidence;
+} mt_region_t;
+
+/// mt_track_t flags
+#define MT_TRACK_STATIC 1
+#define MT_TRACK_OUT_OF_FRAME 2
+#define MT_TRACK_NEW 4          // The track was created after the previous published frame
+#define MT_TRACK_PREDICTED 8    // No detection was matched on the frame: the position is the motion prediction
+
+///
+/// \brief The mt_track_t struct
+///
+typedef struct mt_track
+{
+    uint64_t id;
+    int32_t type;
+    float confidence;
+    float center_x;     // Rotated rect
+    float center_y;
+    float width;
+    float height;
+    float angle;
+    float velocity_x;   // pixels/sec
+    float velocity_y;
+    uint32_t flags;
+} mt_track_t;
+
+///
+/// \brief The mt_frame_t struct
+/// Frame of the caller, it's used without the copy and only the previous frame is kept by the tracker until the next update
+///
+typedef struct mt_frame
+{
+    const uint8_t* data;
+    int32_t width;
+    int32_t height;
+    int32_t channels;   // 1, 3 (BGR) or 4
+    size_t stride;      // Bytes of the row
+} mt_frame_t;
+
+///
+/// \brief The mt_tracks_view_t struct
+/// Frame of the tracks ring in the shared memory, it's valid until the producer overwrites the slot: see mt_tracks_ring_validate
+///
+typedef struct mt_tracks_view
+{
+    uint64_t frame_index;
+    double timestamp;
+    const mt_track_t* tracks;
+    size_t tracks_count;
+    const uint64_t* removed;    // IDs of the tracks removed after the previous published frame
+    size_t removed_count;
+    uint32_t truncated;         // 1 - the tracks or the removed IDs were more than the capacity of the slot
+    uint64_t seq;               // Internal
+    const void* slot;           // Internal
+} mt_tracks_view_t;
+
+///
+MT_API uint32_t mt_api_version(void);
+
+///
+/// \brief mt_tracker_create
+/// \param settings_file - ini file of the settings, NULL for the defaults
+/// \return NULL on the error
+///
+MT_API mt_tracker_t* mt_tracker_create(const char* settings_file);
+///
+MT_API void mt_tracker_destroy(mt_tracker_t* tracker);
+
+///
+/// \brief mt_tracker_update
+/// \param frame - NULL for the trackers without the visual parts (filter_goal = 0 and without the embeddings)
+/// \param fps
+/// \return MT_OK or MT_ERROR
+///
+MT_API int mt_tracker_update(mt_tracker_t* tracker, const mt_region_t* regions, size_t regions_count, const mt_frame_t* frame, float fps);
+
+///
+/// \brief mt_tracker_update_embeddings
+/// \param embeddings - regions_count x embedding_dim floats of the external re-ID network
+///
+MT_API int mt_tracker_update_embeddings(mt_tracker_t* tracker, const mt_region_t* regions, size_t regions_count,
+                                        const float* embeddings, size_t embedding_dim, const mt_frame_t* frame, float fps);
+
+///
+/// \brief mt_tracker_get_tracks
+/// \param tracks - capacity records or NULL
+/// \return Count of the alive tracks, only the first capacity ones are written
+///
+MT_API size_t mt_tracker_get_tracks(const mt_tracker_t* tracker, mt_track_t* tracks, size_t capacity);
+
+///
+/// \brief mt_tracker_get_removed
+/// \return Count of the tracks removed by the last update, only the first capacity IDs are written
+///
+MT_API size_t mt_tracker_get_removed(const mt_tracker_t* tracker, uint64_t* ids, size_t capacity);
+
+///
+/// \brief mt_ring_create
+/// Producer side: creates (or recreates) the named shared memory ring
+/// \param name - name of the shared memory object, for example "/mtracking_cam1"
+/// \param slots - frames in the ring
+/// \param max_regions - maximum regions of one frame
+/// \param embedding_dim - floats of the region embedding, 0 - without the embeddings
+///
+MT_API mt_ring_t* mt_ring_create(const char* name, uint32_t slots, uint32_t max_regions, uint32_t embedding_dim);
+
+///
+/// \brief mt_ring_open
+/// Consumer side: opens the existing ring, the reading starts from the oldest frame in the ring
+///
+MT_API mt_ring_t* mt_ring_open(const char* name);
+
+///
+/// \brief mt_ring_close
+/// Unmaps the ring, the shared memory object stays until mt_ring_remove
+///
+MT_API void mt_ring_close(mt_ring_t* ring);
+///
+/// \brief mt_ring_remove
+/// Removes the shared memory object of the ring of the detections or the tracks
+///
+MT_API int mt_ring_remove(const char* name);
+
+///
+/// \brief mt_ring_write
+/// \param embeddings - regions_count x embedding_dim floats or NULL
+/// \return MT_OK or MT_ERROR if the regions are more than max_regions
+///
+MT_API int mt_ring_write(mt_ring_t* ring, uint64_t frame_index, double timestamp, const mt_region_t* regions, size_t regions_count, const float* embeddings);
+
+///
+/// \brief mt_tracker_update_ring
+/// Consumes the next frame of the ring: the regions and the embeddings are read in place in the shared memory.
+/// The frames with the timestamp > 0 and without the embeddings are tracked by the timestamps, the others with fps
+/// \param frame - the image of the frame or NULL
+/// \param frame_index - index of the consumed frame, NULL if unused
+/// \return MT_OK, MT_NO_DATA, MT_RING_LAPPED (the frame is consumed after the skip), MT_RING_TORN or MT_ERROR
+///
+MT_API int mt_tracker_update_ring(mt_tracker_t* tracker, mt_ring_t* ring, const mt_frame_t* frame, float fps, uint64_t* frame_index);
+
+///
+/// \brief mt_tracks_ring_create
+/// Producer side: creates (or recreates) the named shared memory ring of the tracks
+/// \param slots - frames in the ring
+/// \param max_tracks - maximum tracks of one frame
+/// \param max_removed - maximum removed IDs of one frame
+///
+MT_API mt_tracks_ring_t* mt_tracks_ring_create(const char* name, uint32_t slots, uint32_t max_tracks, uint32_t max_removed);
+
+///
+/// \brief mt_tracks_ring_open
+/// Reader side: opens the existing ring, the reading starts from the last published frame
+///
+MT_API mt_tracks_ring_t* mt_tracks_ring_open(const char* name);
+
+///
+MT_API void mt_tracks_ring_close(mt_tracks_ring_t* ring);
+
+///
+/// \brief mt_tracker_publish
+/// Writes the tracks of the last update into the ring. It polls the tracks delta of the tracker: the new tracks get MT_TRACK_NEW
+/// and the removed IDs are collected from the previous publication
+/// \return MT_OK or MT_ERROR
+///
+MT_API int mt_tracker_publish(mt_tracker_t* tracker, mt_tracks_ring_t* ring, uint64_t frame_index, double timestamp);
+
+///
+/// \brief mt_tracks_ring_acquire
+/// Reader side: the next frame of the ring or the last published one
+/// \param latest - 1 - skip to the last published frame
+/// \return MT_OK, MT_NO_DATA, MT_RING_LAPPED (the frame is acquired after the skip) or MT_ERROR
+///
+MT_API int mt_tracks_ring_acquire(mt_tracks_ring_t* ring, mt_tracks_view_t* view, int latest);
+
+///
+/// \brief mt_tracks_ring_validate
+/// It's called after the reading of the view or the copy of its records
+/// \return MT_OK or MT_RING_TORN if the slot was overwritten
+///
+MT_API int mt_tracks_ring_validate(const mt_tracks_ring_t* ring, const mt_tracks_view_t* view);
+
+#ifdef __cplusplus
+}
+#endif
@@ -11,7 +11,7 @@
  * Mat::at(Point(x, y)) == Mat::at(y,x)
  */
 
-#include "fhog.h"
+#include "../fhog/fhog.h"
 #include "staple_tracker.hpp"
 #include <iomanip>
 
@@ -537,10 +537,18 @@ void STAPLE_TRACKER::Initialize(const cv::Mat &im, cv::Rect region)
         base_target_sz = target_sz; // xxx
         float scale_sigma = sqrt(static_cast<float>(m_cfg.num_scales)) * m_cfg.scale_sigma_factor;
 
-        cv::Mat ys = cv::Mat(1, m_cfg.num_scales, CV_32FC2);
-        for (int i = 0; i < m_cfg.num_scales; i++)
+        // Coarse search: fewer samples over the same range of scales, sigma and step are in the samples
+        num_scale_samples = (m_cfg.num_scales_coarse > 1 && m_cfg.num_scales_coarse < m_cfg.num_scales) ? m_cfg.num_scales_coarse : m_cfg.num_scales;
+        float samples_ratio = 1.f;
+        if (num_scale_samples != m_cfg.num_scales)
+            samples_ratio = (num_scale_samples - 1) / static_cast<float>(m_cfg.num_scales - 1);
+        scale_sigma *= samples_ratio;
+        scale_sample_step = pow(m_cfg.scale_step, 1.f / samples_ratio);
+
+        cv::Mat ys = cv::Mat(1, num_scale_samples, CV_32FC2);
+        for (int i = 0; i < num_scale_samples; i++)
         {
-            cv::Vec2f val((i + 1) - ceil(m_cfg.num_scales/2.0f), 0.f);
+            cv::Vec2f val((i + 1) - ceil(num_scale_samples/2.0f), 0.f);
             val[0] = exp(-0.5f * (val[0] * val[0]) / (scale_sigma * scale_sigma));
             ys.at<cv::Vec2f>(i) = val;
 
@@ -551,28 +559,28 @@ void STAPLE_TRACKER::Initialize(const cv::Mat &im, cv::Rect region)
         cv::dft(ys, ysf, cv::DFT_ROWS);
         //std::cout << ysf << std::endl;
 
-        scale_window = cv::Mat(1, m_cfg.num_scales, CV_32FC1);
-        if (m_cfg.num_scales % 2 == 0)
+        scale_window = cv::Mat(1, num_scale_samples, CV_32FC1);
+        if (num_scale_samples % 2 == 0)
         {
-            for (int i = 0; i < m_cfg.num_scales + 1; ++i)
+            for (int i = 0; i < num_scale_samples + 1; ++i)
             {
                 if (i > 0)
-                    scale_window.at<float>(i - 1) = 0.5f * (1 - cos(static_cast<float>(CV_2PI) * i / (m_cfg.num_scales + 1 - 1)));
+                    scale_window.at<float>(i - 1) = 0.5f * (1 - cos(static_cast<float>(CV_2PI) * i / (num_scale_samples + 1 - 1)));
             }
         }
         else
         {
-            for (int i = 0; i < m_cfg.num_scales; ++i)
+            for (int i = 0; i < num_scale_samples; ++i)
             {
-                scale_window.at<float>(i) = 0.5f * (1 - cos(static_cast<float>(CV_2PI) * i / (m_cfg.num_scales - 1)));
+                scale_window.at<float>(i) = 0.5f * (1 - cos(static_cast<float>(CV_2PI) * i / (num_scale_samples - 1)));
             }
         }
 
 
-        scale_factors = cv::Mat(1, m_cfg.num_scales, CV_32FC1);
-        for (int i = 0; i < m_cfg.num_scales; i++)
+        scale_factors = cv::Mat(1, num_scale_samples, CV_32FC1);
+        for (int i = 0; i < num_scale_samples; i++)
         {
-            scale_factors.at<float>(i) = pow(m_cfg.scale_step, (ceil(m_cfg.num_scales/2.0f)  - (i+1)));
+            scale_factors.at<float>(i) = pow(scale_sample_step, (ceil(num_scale_samples/2.0f)  - (i+1)));
         }
 
         //std::cout << scale_factors << std::endl;
@@ -769,30 +777,34 @@ void STAPLE_TRACKER::getSubwindowFloor(const cv::Mat &im, cv::Point_<float> cent
 ///
 void STAPLE_TRACKER::getScaleSubwindow(const cv::Mat &im, cv::Point_<float> centerCoor, cv::Mat &output)
 {
-    int ch = 0;
-    int total = 0;
-
-    for (int s = 0; s < m_cfg.num_scales; s++)
+    // Samples and their features are independent: all scales are extracted in parallel
+    const int nScales = num_scale_samples;
+    std::vector<cv::Mat> patches(nScales);
+    cv::parallel_for_(cv::Range(0, nScales), [&](const cv::Range& range)
     {
-        cv::Size_<float> patch_sz;
+        for (int s = range.start; s < range.end; s++)
+        {
+            cv::Size_<float> patch_sz;
 
-        patch_sz.width = floor(base_target_sz.width * scale_factor * scale_factors.at<float>(s));
-        patch_sz.height = floor(base_target_sz.height * scale_factor * scale_factors.at<float>(s));
+            patch_sz.width = floor(base_target_sz.width * scale_factor * scale_factors.at<float>(s));
+            patch_sz.height = floor(base_target_sz.height * scale_factor * scale_factors.at<float>(s));
 
-        cv::Mat im_patch_resized;
-        getSubwindowFloor(im, centerCoor, scale_model_sz, patch_sz, im_patch_resized);
+            getSubwindowFloor(im, centerCoor, scale_model_sz, patch_sz, patches[s]);
+        }
+    });
 
-        // extract scale features
-        cv::MatND temp;
-        fhog31(temp, im_patch_resized, m_cfg.hog_cell_size, 9);
+    // extract scale features
+    std::vector<cv::MatND> features;
+    fhog31(features, patches, m_cfg.hog_cell_size, 9);
 
-        if (s == 0)
-        {
-            ch = temp.channels();
-            total = temp.cols * temp.rows * ch;
+    const int ch = features[0].channels();
+    const int total = features[0].cols * features[0].rows * ch;
+    output = cv::Mat(total, nScales, CV_32FC2);
+    float* outData = (float*)output.data;
 
-            output = cv::Mat(total, m_cfg.num_scales, CV_32FC2);
-        }
+    for (int s = 0; s < nScales; s++)
+    {
+        const cv::MatND& temp = features[s];
 
         int tempw = temp.cols;
         int temph = temp.rows;
@@ -802,8 +814,6 @@ void STAPLE_TRACKER::getScaleSubwindow(const cv::Mat &im, cv::Point_<float> cent
 
         float scaleWnd = scale_window.at<float>(s);
 
-        float* outData = (float*)output.data;
-
         // window
         for (int j = 0; j < temph; ++j)
         {
@@ -813,8 +823,8 @@ void STAPLE_TRACKER::getScaleSubwindow(const cv::Mat &im, cv::Point_<float> cent
             {
                 for (int k = 0; k < tempch; ++k)
                 {
-                    outData[(count * m_cfg.num_scales + s) * 2 + 0] = tmpData[k] * scaleWnd;
-                    outData[(count * m_cfg.num_scales + s) * 2 + 1] = 0.0;
+                    outData[(count * nScales + s) * 2 + 0] = tmpData[k] * scaleWnd;
+                    outData[(count * nScales + s) * 2 + 1] = 0.0;
 
                     ++count;
                 }
@@ -1489,7 +1499,21 @@ cv::RotatedRect STAPLE_TRACKER::Update(const cv::Mat &im, float& confidence)
         int recovered_scale = maxLoc.x;
 
         // set the scale
-        scale_factor = scale_factor * scale_factors.at<float>(recovered_scale);
+        if (num_scale_samples == m_cfg.num_scales)
+        {
+            scale_factor = scale_factor * scale_factors.at<float>(recovered_scale);
+        }
+        else
+        {
+            // Fine scale between the coarse samples by the parabola over the circular neighbours of the peak
+            const float* pResp = scale_response.ptr<float>(0);
+            const float left = pResp[(recovered_scale + num_scale_samples - 1) % num_scale_samples];
+            const float right = pResp[(recovered_scale + 1) % num_scale_samples];
+            const float center = pResp[recovered_scale];
+            const float divisor = 2 * center - right - left;
+            const float delta = (divisor > 0) ? std::max(-0.5f, std::min(0.5f, 0.5f * (right - left) / divisor)) : 0.f;
+            scale_factor = scale_factor * pow(scale_sample_step, (ceil(num_scale_samples/2.0f) - (recovered_scale + delta + 1)));
+        }
 
         if (scale_factor < min_scale_factor) {
             scale_factor = min_scale_factor;
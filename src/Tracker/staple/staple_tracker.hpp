@@ -38,6 +38,7 @@ struct staple_cfg
     float learning_rate_scale = 0.025f;
     float scale_sigma_factor = 1/4.0f;
     int num_scales = 33;
+    int num_scales_coarse = 0;          // > 1: coarse search with so many samples over the range of num_scales, the fine scale is the interpolated peak
     float scale_model_factor = 1.0f;
     float scale_step = 1.02f;
     float scale_model_max_area = 32*16;
@@ -112,7 +113,9 @@ private:
 
     float scale_factor;
     cv::Mat scale_window;
-    cv::Mat scale_factors;
+    cv::Mat scale_factors;              // of the scale samples
+    int num_scale_samples = 0;
+    float scale_sample_step = 1.f;
     cv::Size scale_model_sz;
     float min_scale_factor;
     float max_scale_factor;
@@ -1,6 +1,11 @@
+#include <memory_resource>
+
 #include "track.h"
+#include "execution_policy.h"
+#include "RegionHistograms.h"
 
 #include "dat/dat_tracker.hpp"
+#include "mosse/mosse_tracker.h"
 #ifdef USE_STAPLE_TRACKER
 #include "staple/staple_tracker.hpp"
 #include "ldes/ldes_tracker.h"
@@ -15,17 +20,28 @@
 /// \param trackID
 /// \param filterObjectSize
 /// \param externalTrackerForLost
+/// \param embeddingMemory
+/// \param staticSnapshot
+/// \param kalmanBatch
+/// \param framePyramid - shared by the visual trackers of the lost tracks, can be null
+/// \param trackersPool - released OpenCV trackers for the reuse, can be null
 ///
 CTrack::CTrack(const CRegion& region,
                tracking::KalmanType kalmanType,
                track_t deltaTime,
                track_t accelNoiseMag,
                bool useAcceleration,
+               bool steadyStateGain,
                track_id_t trackID,
                bool filterObjectSize,
-               tracking::LostTrackType externalTrackerForLost)
+               tracking::LostTrackType externalTrackerForLost,
+               const EmbeddingMemory& embeddingMemory,
+               const StaticSnapshot::Settings& staticSnapshot,
+               std::shared_ptr<KalmanBatch> kalmanBatch,
+               std::shared_ptr<FramePyramid> framePyramid,
+               std::shared_ptr<VisualTrackersPool> trackersPool)
     :
-      m_kalman(kalmanType, useAcceleration, deltaTime, accelNoiseMag),
+      m_kalman(kalmanType, useAcceleration, deltaTime, accelNoiseMag, steadyStateGain, kalmanBatch),
       m_lastRegion(region),
       m_predictionRect(region.m_rrect),
       m_predictionPoint(region.m_rrect.center),
@@ -33,6 +49,10 @@ CTrack::CTrack(const CRegion& region,
       m_currType(region.m_type),
       m_lastType(region.m_type),
       m_externalTrackerForLost(externalTrackerForLost),
+      m_framePyramid(framePyramid),
+      m_trackersPool(trackersPool),
+      m_embeddingMemory(embeddingMemory),
+      m_staticSnapshot(staticSnapshot),
       m_filterObjectSize(filterObjectSize)
 {
     if (filterObjectSize)
@@ -41,7 +61,7 @@ CTrack::CTrack(const CRegion& region,
         m_kalman.Update(m_predictionPoint, true);
 
     Point_t pt(m_predictionPoint.x, m_predictionPoint.y + region.m_brect.height / 2);
-    m_trace.push_back(pt, pt);
+    PushTrace(pt, pt);
 }
 
 ///
@@ -52,9 +72,15 @@ CTrack::CTrack(const CRegion& region,
 /// \param deltaTime
 /// \param accelNoiseMag
 /// \param useAcceleration
+/// \param steadyStateGain
 /// \param trackID
 /// \param filterObjectSize
 /// \param externalTrackerForLost
+/// \param embeddingMemory
+/// \param staticSnapshot
+/// \param kalmanBatch
+/// \param framePyramid - shared by the visual trackers of the lost tracks, can be null
+/// \param trackersPool - released OpenCV trackers for the reuse, can be null
 ///
 CTrack::CTrack(const CRegion& region,
                const RegionEmbedding& regionEmbedding,
@@ -62,11 +88,17 @@ CTrack::CTrack(const CRegion& region,
                track_t deltaTime,
                track_t accelNoiseMag,
                bool useAcceleration,
+               bool steadyStateGain,
                track_id_t trackID,
                bool filterObjectSize,
-               tracking::LostTrackType externalTrackerForLost)
+               tracking::LostTrackType externalTrackerForLost,
+               const EmbeddingMemory& embeddingMemory,
+               const StaticSnapshot::Settings& staticSnapshot,
+               std::shared_ptr<KalmanBatch> kalmanBatch,
+               std::shared_ptr<FramePyramid> framePyramid,
+               std::shared_ptr<VisualTrackersPool> trackersPool)
     :
-      m_kalman(kalmanType, useAcceleration, deltaTime, accelNoiseMag),
+      m_kalman(kalmanType, useAcceleration, deltaTime, accelNoiseMag, steadyStateGain, kalmanBatch),
       m_lastRegion(region),
       m_predictionRect(region.m_rrect),
       m_predictionPoint(region.m_rrect.center),
@@ -74,15 +106,62 @@ CTrack::CTrack(const CRegion& region,
       m_currType(region.m_type),
       m_lastType(region.m_type),
       m_externalTrackerForLost(externalTrackerForLost),
-      m_regionEmbedding(regionEmbedding),
+      m_framePyramid(framePyramid),
+      m_trackersPool(trackersPool),
+      m_embeddingMemory(embeddingMemory),
+      m_staticSnapshot(staticSnapshot),
       m_filterObjectSize(filterObjectSize)
 {
+    if (m_memoryLevel < 2)
+        m_regionEmbedding.m_hist = regionEmbedding.m_hist;
+    m_embeddingMemory.Update(regionEmbedding.m_embedding, m_regionEmbedding);
+
     if (filterObjectSize)
         m_kalman.Update(region.m_brect, true);
     else
         m_kalman.Update(m_predictionPoint, true);
 
-    m_trace.push_back(m_predictionPoint, m_predictionPoint);
+    PushTrace(m_predictionPoint, m_predictionPoint);
+}
+
+///
+/// \brief CTrack::~CTrack
+///
+CTrack::~CTrack()
+{
+    ReleaseTracker();
+}
+
+///
+/// \brief TracksPool
+/// The trackers of the different streams create the tracks in the different threads.
+/// The pool isn't destroyed on the exit: the tracks of the static objects can be deleted after it
+/// \return
+///
+static std::pmr::synchronized_pool_resource& TracksPool()
+{
+    static auto* pool = new std::pmr::synchronized_pool_resource();
+    return *pool;
+}
+
+///
+/// \brief CTrack::operator new
+/// \param size
+/// \return
+///
+void* CTrack::operator new(size_t size)
+{
+    return TracksPool().allocate(size, alignof(CTrack));
+}
+
+///
+/// \brief CTrack::operator delete
+/// \param ptr
+/// \param size
+///
+void CTrack::operator delete(void* ptr, size_t size)
+{
+    TracksPool().deallocate(ptr, size, alignof(CTrack));
 }
 
 ///
@@ -125,10 +204,7 @@ track_t CTrack::CalcDistRect(const CRegion& reg) const
 ///
 track_t CTrack::CalcDistJaccard(const CRegion& reg) const
 {
-    track_t intArea = static_cast<track_t>((reg.m_brect & m_lastRegion.m_brect).area());
-    track_t unionArea = static_cast<track_t>(reg.m_brect.area() + m_lastRegion.m_brect.area() - intArea);
-
-    return 1 - intArea / unionArea;
+    return DistJaccard(reg.m_brect, m_lastRegion.m_brect);
 }
 
 ///
@@ -140,14 +216,15 @@ track_t CTrack::CalcDistHist(const RegionEmbedding& embedding) const
 {
 	track_t res = 1;
 
+    // Histogram was dropped by ReduceMemory
+    if (m_memoryLevel >= 2)
+        return res;
+
     if (!embedding.m_hist.empty() && !m_regionEmbedding.m_hist.empty())
 	{
-#if (((CV_VERSION_MAJOR == 4) && (CV_VERSION_MINOR < 1)) || (CV_VERSION_MAJOR == 3))
-		res = static_cast<track_t>(cv::compareHist(embedding.m_hist, m_regionEmbedding.m_hist, CV_COMP_BHATTACHARYYA));
-        //res = 1.f - static_cast<track_t>(cv::compareHist(hist, m_regionEmbedding.m_hist, CV_COMP_CORREL));
-#else
-        res = static_cast<track_t>(cv::compareHist(embedding.m_hist, m_regionEmbedding.m_hist, cv::HISTCMP_BHATTACHARYYA));
-#endif
+        // The histograms are square rooted and normalized: the Bhattacharyya coefficient is the dot product
+        if (embedding.m_hist.total() == m_regionEmbedding.m_hist.total())
+            res = RegionHistograms::Bhattacharyya(embedding.m_hist.dot(m_regionEmbedding.m_hist));
 	}
     else
     {
@@ -168,16 +245,18 @@ std::optional<track_t> CTrack::CalcCosine(const RegionEmbedding& embedding) cons
 	track_t res = 1;
 	if (!embedding.m_embedding.empty() && !m_regionEmbedding.m_embedding.empty())
 	{
-		double xy = embedding.m_embedding.dot(m_regionEmbedding.m_embedding);
-		double norm = sqrt(embedding.m_embDot * m_regionEmbedding.m_embDot) + 1e-6;
-#if 1
-        res = 1.f - 0.5f * fabs(static_cast<float>(xy / norm));
-#else
-        res = 0.5f * static_cast<float>(1.0 - xy / norm);
-        if (res < 0)
-            res += 1;
-        //res = static_cast<float>(-xy / norm);
-#endif
+		double xy = 0;
+		if (embedding.m_embedding.type() == m_regionEmbedding.m_embedding.type())
+		{
+			xy = embedding.m_embedding.dot(m_regionEmbedding.m_embedding);
+		}
+		else
+		{
+			cv::Mat trackEmb;
+			m_regionEmbedding.m_embedding.convertTo(trackEmb, embedding.m_embedding.type());
+			xy = embedding.m_embedding.dot(trackEmb);
+		}
+        res = CosineDist(xy, embedding.m_embDot, m_regionEmbedding.m_embDot);
         //std::cout << "CTrack::CalcCosine: " << embedding.m_embedding.size() << " - " << m_regionEmbedding.m_embedding.size() << " = " << res << std::endl;
         return res;
 	}
@@ -190,6 +269,44 @@ std::optional<track_t> CTrack::CalcCosine(const RegionEmbedding& embedding) cons
     }
 }
 
+///
+/// \brief CTrack::CosineDist
+/// \param xy
+/// \param embDot1
+/// \param embDot2
+/// \return
+///
+track_t CTrack::CosineDist(double xy, double embDot1, double embDot2)
+{
+    double norm = sqrt(embDot1 * embDot2) + 1e-6;
+#if 1
+    return 1.f - 0.5f * fabs(static_cast<float>(xy / norm));
+#else
+    track_t res = 0.5f * static_cast<float>(1.0 - xy / norm);
+    if (res < 0)
+        res += 1;
+    return res;
+    //return static_cast<float>(-xy / norm);
+#endif
+}
+
+///
+/// \brief CTrack::GetRegionEmbedding
+/// \return
+///
+const RegionEmbedding& CTrack::GetRegionEmbedding() const
+{
+    return m_regionEmbedding;
+}
+
+///
+/// \brief CTrack::ResetEmbedding
+///
+void CTrack::ResetEmbedding()
+{
+    m_embeddingMemory.Reset(m_regionEmbedding);
+}
+
 ///
 /// \brief CTrack::Update
 /// \param region
@@ -198,13 +315,16 @@ std::optional<track_t> CTrack::CalcCosine(const RegionEmbedding& embedding) cons
 /// \param prevFrame
 /// \param currFrame
 /// \param trajLen
+/// \param maxSpeedForStatic
+/// \param useExternalTracker
 ///
 void CTrack::Update(const CRegion& region,
                     bool dataCorrect,
                     size_t max_trace_length,
                     cv::UMat prevFrame,
                     cv::UMat currFrame,
-                    int trajLen, int maxSpeedForStatic)
+                    int trajLen, int maxSpeedForStatic,
+                    bool useExternalTracker)
 {
     if (region.m_type == m_currType)
     {
@@ -230,26 +350,26 @@ void CTrack::Update(const CRegion& region,
     }
 
     if (m_filterObjectSize) // Kalman filter for object coordinates and size
-        RectUpdate(region, dataCorrect, prevFrame, currFrame);
+        RectUpdate(region, dataCorrect, prevFrame, currFrame, useExternalTracker);
     else // Kalman filter only for object center
-        PointUpdate(region.m_rrect.center, region.m_rrect.size, dataCorrect, currFrame.size());
+        PointUpdate(region.m_rrect.center, region.m_rrect.size, dataCorrect, FrameSize(currFrame));
+
+    // Old points are overwritten by the new
+    m_trace.SetCapacity(TraceCapacity(max_trace_length));
 
     if (dataCorrect)
     {
         //std::cout << m_lastRegion.m_brect << " - " << region.m_brect << std::endl;
 
         m_lastRegion = region;
-        m_trace.push_back(m_predictionPoint, region.m_rrect.center);
+        PushTrace(m_predictionPoint, region.m_rrect.center);
 
         CheckStatic(trajLen, currFrame, region, maxSpeedForStatic);
     }
     else
     {
-        m_trace.push_back(m_predictionPoint);
+        PushTrace(m_predictionPoint);
     }
-
-    if (m_trace.size() > max_trace_length)
-        m_trace.pop_front(m_trace.size() - max_trace_length);
 }
 
 ///
@@ -270,29 +390,30 @@ void CTrack::Update(const CRegion& region,
                     cv::UMat currFrame,
                     int trajLen, int maxSpeedForStatic)
 {
-    m_regionEmbedding = regionEmbedding;
+    m_regionEmbedding.m_hist = regionEmbedding.m_hist;
+    m_embeddingMemory.Update(regionEmbedding.m_embedding, m_regionEmbedding);
 
     if (m_filterObjectSize) // Kalman filter for object coordinates and size
-        RectUpdate(region, dataCorrect, prevFrame, currFrame);
+        RectUpdate(region, dataCorrect, prevFrame, currFrame, true);
     else // Kalman filter only for object center
-        PointUpdate(region.m_rrect.center, region.m_rrect.size, dataCorrect, currFrame.size());
+        PointUpdate(region.m_rrect.center, region.m_rrect.size, dataCorrect, FrameSize(currFrame));
+
+    // Old points are overwritten by the new
+    m_trace.SetCapacity(TraceCapacity(max_trace_length));
 
     if (dataCorrect)
     {
         //std::cout << m_lastRegion.m_brect << " - " << region.m_brect << std::endl;
 
         m_lastRegion = region;
-        m_trace.push_back(m_predictionPoint, m_lastRegion.m_rrect.center);
+        PushTrace(m_predictionPoint, m_lastRegion.m_rrect.center);
 
         CheckStatic(trajLen, currFrame, region, maxSpeedForStatic);
     }
     else
     {
-        m_trace.push_back(m_predictionPoint);
+        PushTrace(m_predictionPoint);
     }
-
-    if (m_trace.size() > max_trace_length)
-        m_trace.pop_front(m_trace.size() - max_trace_length);
 }
 
 ///
@@ -314,6 +435,21 @@ bool CTrack::IsStaticTimeout(int framesTime) const
     return (m_staticFrames > framesTime);
 }
 
+///
+/// \brief CTrack::KeepStatic
+/// \param region
+///
+void CTrack::KeepStatic(const CRegion* region)
+{
+    if (region)
+    {
+        m_lastRegion = *region;
+        m_skippedFrames = 0;
+    }
+    PushTrace(m_predictionPoint, m_lastRegion.m_rrect.center);
+    ++m_staticFrames;
+}
+
 ///
 /// \brief CTrack::IsOutOfTheFrame
 /// \return
@@ -361,13 +497,7 @@ cv::RotatedRect CTrack::CalcPredictionEllipse(cv::Size_<track_t> minRadius) cons
 ///
 track_t CTrack::IsInsideArea(const Point_t& pt, const cv::RotatedRect& rrect) const
 {
-	Point_t pt_(pt.x - rrect.center.x, pt.y - rrect.center.y);
-	track_t r = sqrtf(sqr(pt_.x) + sqr(pt_.y));
-	track_t t = (r > 1) ? acosf(pt_.x / r) : 0;
-	track_t t_ = t - rrect.angle;
-	Point_t pt_rotated(r * cosf(t_), r * sinf(t_));
-
-	return sqr(pt_rotated.x) / sqr(rrect.size.width) + sqr(pt_rotated.y) / sqr(rrect.size.height);
+	return DistEllipse(pt, rrect);
 }
 
 ///
@@ -377,10 +507,7 @@ track_t CTrack::IsInsideArea(const Point_t& pt, const cv::RotatedRect& rrect) co
 ///
 track_t CTrack::WidthDist(const CRegion& reg) const
 {
-    if (m_lastRegion.m_rrect.size.width < reg.m_rrect.size.width)
-        return m_lastRegion.m_rrect.size.width / reg.m_rrect.size.width;
-    else
-        return reg.m_rrect.size.width / m_lastRegion.m_rrect.size.width;
+    return SizeRatio(m_lastRegion.m_rrect.size.width, reg.m_rrect.size.width);
 }
 
 ///
@@ -390,10 +517,7 @@ track_t CTrack::WidthDist(const CRegion& reg) const
 ///
 track_t CTrack::HeightDist(const CRegion& reg) const
 {
-    if (m_lastRegion.m_rrect.size.height < reg.m_rrect.size.height)
-        return m_lastRegion.m_rrect.size.height / reg.m_rrect.size.height;
-    else
-        return reg.m_rrect.size.height / m_lastRegion.m_rrect.size.height;
+    return SizeRatio(m_lastRegion.m_rrect.size.height, reg.m_rrect.size.height);
 }
 
 ///
@@ -407,7 +531,7 @@ bool CTrack::CheckStatic(int trajLen, cv::UMat currFrame, const CRegion& region,
     {
         m_isStatic = false;
         m_staticFrames = 0;
-        m_staticFrame = cv::UMat();
+        m_staticSnapshot.Reset();
     }
     else
     {
@@ -417,12 +541,12 @@ bool CTrack::CheckStatic(int trajLen, cv::UMat currFrame, const CRegion& region,
         {
             if (!m_isStatic)
             {
-                m_staticFrame = currFrame.clone();
+                m_staticSnapshot.Take(currFrame, ScaleRect(region.m_brect, m_processingScale));
                 m_staticRect = region.m_brect;
 #if 0
 #ifndef SILENT_WORK
                 cv::namedWindow("m_staticFrame", cv::WINDOW_NORMAL);
-                cv::Mat img = m_staticFrame.getMat(cv::ACCESS_READ).clone();
+                cv::Mat img = currFrame.getMat(cv::ACCESS_READ).clone();
                 cv::rectangle(img, m_staticRect, cv::Scalar(255, 0, 255), 1);
                 for (size_t i = m_trace.size() - trajLen; i < m_trace.size() - 1; ++i)
                 {
@@ -449,7 +573,7 @@ bool CTrack::CheckStatic(int trajLen, cv::UMat currFrame, const CRegion& region,
         {
             m_isStatic = false;
             m_staticFrames = 0;
-            m_staticFrame = cv::UMat();
+            m_staticSnapshot.Reset();
         }
     }
     return m_isStatic;
@@ -485,14 +609,168 @@ objtype_t CTrack::GetCurrType() const
     return m_currType;
 }
 
+///
+/// \brief CTrack::GetTrace
+/// \return
+///
+const Trace& CTrack::GetTrace() const
+{
+    return m_trace;
+}
+
 ///
 /// \brief CTrack::ConstructObject
 /// \return
 ///
 TrackingObject CTrack::ConstructObject() const
 {
-    return TrackingObject(GetLastRect(), m_trackID, m_trace, IsStatic(), IsOutOfTheFrame(),
-                          m_currType, m_lastRegion.m_confidence, m_kalman.GetVelocity());
+    TrackingObject obj(GetLastRect(), m_trackID, m_trace, IsStatic(), IsOutOfTheFrame(),
+                       m_currType, m_lastRegion.m_confidence, m_kalman.GetVelocity());
+    obj.m_motion = m_motionStats.Motion();
+    if (m_skippedFrames)
+        obj.m_estimate = TrackingObject::Estimate::Predicted;
+    return obj;
+}
+
+///
+/// \brief CTrack::ConstructObject
+/// \param tailSize - count of the last trajectory points
+/// \return
+///
+TrackingObject CTrack::ConstructObject(size_t tailSize) const
+{
+    TrackingObject obj(GetLastRect(), m_trackID, m_trace.Tail(tailSize), IsStatic(), IsOutOfTheFrame(),
+                       m_currType, m_lastRegion.m_confidence, m_kalman.GetVelocity());
+    obj.m_motion = m_motionStats.Motion();
+    if (m_skippedFrames)
+        obj.m_estimate = TrackingObject::Estimate::Predicted;
+    return obj;
+}
+
+///
+/// \brief CTrack::TotalPointsCount
+/// \return
+///
+size_t CTrack::TotalPointsCount() const
+{
+    return m_trace.GetTotalCount();
+}
+
+///
+/// \brief CTrack::NewPointsCount
+/// \param totalPoints
+/// \return
+///
+size_t CTrack::NewPointsCount(size_t totalPoints) const
+{
+    return std::min(m_trace.size(), m_trace.GetTotalCount() - totalPoints);
+}
+
+///
+/// \brief CTrack::PolledPoints
+/// \return
+///
+size_t& CTrack::PolledPoints()
+{
+    return m_polledPoints;
+}
+
+///
+/// \brief CTrack::MemoryBytes
+/// \return
+///
+size_t CTrack::MemoryBytes() const
+{
+    auto MatBytes = [](const cv::Mat& mat) -> size_t
+    {
+        return mat.empty() ? 0 : mat.total() * mat.elemSize();
+    };
+    // The embedding shares the data with the signature of m_embeddingMemory
+    size_t bytes = sizeof(CTrack) + m_trace.MemoryBytes() + MatBytes(m_regionEmbedding.m_hist) + MatBytes(m_regionEmbedding.m_embedding) + m_staticSnapshot.Bytes();
+
+    // Model of the visual tracker isn't visible: correlation filters keep about 8 float maps of the object patch
+    bool hasVisualTracker = m_VOTTracker != nullptr;
+    int channels = 3;
+#ifdef USE_OCV_KCF
+    if (m_tracker && !m_tracker.empty())
+    {
+        hasVisualTracker = true;
+        channels = m_trackerChannels;
+    }
+#endif
+    if (hasVisualTracker)
+    {
+        const size_t patchArea = static_cast<size_t>(std::max(0, ScaleRect(m_lastRegion.m_brect, m_processingScale).area())) >> (2 * m_trackerLevel);
+        bytes += 8 * patchArea * channels * sizeof(float);
+    }
+    return bytes;
+}
+
+///
+/// \brief CTrack::ReduceMemory
+/// \param level
+/// \param minTraceLen
+/// \return
+///
+bool CTrack::ReduceMemory(int level, size_t minTraceLen)
+{
+    if (level <= m_memoryLevel)
+        return false;
+
+    for (int l = m_memoryLevel + 1; l <= level; ++l)
+    {
+        switch (l)
+        {
+        case 1:
+            m_traceLimit = std::max<size_t>({ 1, minTraceLen, m_trace.size() / 4 });
+            m_trace.SetCapacity(m_traceLimit);
+            m_trace.ShrinkToFit();
+            break;
+
+        case 2:
+            m_regionEmbedding.m_hist.release();
+            break;
+
+        case 3:
+            switch (m_externalTrackerForLost)
+            {
+            case tracking::TrackKCF:
+            case tracking::TrackMIL:
+            case tracking::TrackMedianFlow:
+            case tracking::TrackGOTURN:
+            case tracking::TrackMOSSE:
+            case tracking::TrackCSRT:
+            case tracking::TrackDAT:
+            case tracking::TrackSTAPLE:
+            case tracking::TrackLDES:
+                // The lost track is predicted only by Kalman
+#ifdef USE_OCV_KCF
+                if (m_tracker && !m_tracker.empty())
+                    ReleaseTracker();
+#endif
+                m_VOTTracker = nullptr;
+                m_externalTrackerForLost = tracking::TrackNone;
+                break;
+            default:
+                break;
+            }
+            break;
+        }
+    }
+    m_memoryLevel = level;
+    return true;
+}
+
+///
+/// \brief CTrack::TraceCapacity
+/// \param maxTraceLength
+/// \return
+///
+size_t CTrack::TraceCapacity(size_t maxTraceLength) const
+{
+    if (m_traceLimit && (!maxTraceLength || maxTraceLength > m_traceLimit))
+        return m_traceLimit;
+    return maxTraceLength;
 }
 
 ///
@@ -513,6 +791,15 @@ size_t CTrack::SkippedFrames() const
     return m_skippedFrames;
 }
 
+///
+/// \brief CTrack::SetBatchedRect
+/// \param rrect
+///
+void CTrack::SetBatchedRect(const cv::RotatedRect& rrect)
+{
+    m_batchedRect = rrect;
+}
+
 ///
 /// \brief CTrack::SkippedFrames
 /// \return
@@ -528,17 +815,37 @@ size_t& CTrack::SkippedFrames()
 /// \param dataCorrect
 /// \param prevFrame
 /// \param currFrame
+/// \param useExternalTracker - visual tracker for the lost track
 ///
 void CTrack::RectUpdate(const CRegion& region,
                         bool dataCorrect,
                         cv::UMat prevFrame,
-                        cv::UMat currFrame)
+                        cv::UMat currFrame,
+                        bool useExternalTracker)
 {
     m_kalman.GetRectPrediction();
 
     bool wasTracked = false;
     cv::RotatedRect trackedRRect;
 
+    // Visual tracker works on the level of the shared pyramid that was selected on its initialization
+    const bool grayInput = (m_externalTrackerForLost == tracking::TrackMOSSE) || (m_externalTrackerForLost == tracking::TrackMedianFlow);
+    auto TrackerFrame = [&]() -> cv::UMat
+    {
+        if (!m_framePyramid)
+            return currFrame;
+        return grayInput ? m_framePyramid->Gray(m_trackerLevel) : m_framePyramid->Level(m_trackerLevel);
+    };
+    auto SelectLevel = [&](const cv::Rect& objRect)
+    {
+        m_trackerLevel = m_framePyramid ? m_framePyramid->SelectLevel(ScaleRect(objRect, m_processingScale).size()) : 0;
+    };
+    // Size of the pixel of the tracker frame on the original frame
+    auto LevelScale = [&]() -> track_t
+    {
+        return FramePyramid::Scale(m_trackerLevel) / m_processingScale;
+    };
+
     auto Clamp = [](int& v, int& size, int hi) -> int
     {
         int res = 0;
@@ -587,36 +894,44 @@ void CTrack::RectUpdate(const CRegion& region,
         switch (m_externalTrackerForLost)
         {
         case tracking::TrackNone:
+        case tracking::TrackBatchedLK:
+        case tracking::TrackBatchedMOSSE:
             break;
 
         case tracking::TrackKCF:
         case tracking::TrackMIL:
         case tracking::TrackMedianFlow:
         case tracking::TrackGOTURN:
-        case tracking::TrackMOSSE:
         case tracking::TrackCSRT:
 #ifdef USE_OCV_KCF
             {
-                roiRect.width = std::max(3 * brect.width, currFrame.cols / 4);
-                roiRect.height = std::max(3 * brect.height, currFrame.rows / 4);
-                if (roiRect.width > currFrame.cols)
-                    roiRect.width = currFrame.cols;
-
-                if (roiRect.height > currFrame.rows)
-                    roiRect.height = currFrame.rows;
-
-                roiRect.x = brect.x + brect.width / 2 - roiRect.width / 2;
-                roiRect.y = brect.y + brect.height / 2 - roiRect.height / 2;
-                Clamp(roiRect.x, roiRect.width, currFrame.cols);
-                Clamp(roiRect.y, roiRect.height, currFrame.rows);
-
-                if (!m_tracker || m_tracker.empty() || reinit)
+                const bool create = !m_tracker || m_tracker.empty() || reinit;
+                if (create)
+                    SelectLevel(brect);
+                cv::UMat frame = TrackerFrame();
+                const track_t scale = LevelScale();
+                const cv::Rect levelRect(cvRound(brect.x / scale), cvRound(brect.y / scale), cvRound(brect.width / scale), cvRound(brect.height / scale));
+
+                roiRect.width = std::max(3 * levelRect.width, frame.cols / 4);
+                roiRect.height = std::max(3 * levelRect.height, frame.rows / 4);
+                if (roiRect.width > frame.cols)
+                    roiRect.width = frame.cols;
+
+                if (roiRect.height > frame.rows)
+                    roiRect.height = frame.rows;
+
+                roiRect.x = levelRect.x + levelRect.width / 2 - roiRect.width / 2;
+                roiRect.y = levelRect.y + levelRect.height / 2 - roiRect.height / 2;
+                Clamp(roiRect.x, roiRect.width, frame.cols);
+                Clamp(roiRect.y, roiRect.height, frame.rows);
+
+                if (create)
                 {
-                    CreateExternalTracker(currFrame.channels());
+                    CreateExternalTracker(frame.channels());
 
                     int dx = 0;//m_predictionRect.width / 8;
                     int dy = 0;//m_predictionRect.height / 8;
-                    cv::Rect2d lastRect(brect.x - roiRect.x - dx, brect.y - roiRect.y - dy, brect.width + 2 * dx, brect.height + 2 * dy);
+                    cv::Rect2d lastRect(levelRect.x - roiRect.x - dx, levelRect.y - roiRect.y - dy, levelRect.width + 2 * dx, levelRect.height + 2 * dy);
 
                     if (lastRect.x >= 0 &&
                             lastRect.y >= 0 &&
@@ -624,10 +939,10 @@ void CTrack::RectUpdate(const CRegion& region,
                             lastRect.y + lastRect.height < roiRect.height &&
                             lastRect.area() > 0)
                     {
-                        m_tracker->init(cv::UMat(currFrame, roiRect), lastRect);
+                        m_tracker->init(cv::UMat(frame, roiRect), lastRect);
 #if 0
 #ifndef SILENT_WORK
-                        cv::Mat tmp = cv::UMat(currFrame, roiRect).getMat(cv::ACCESS_READ).clone();
+                        cv::Mat tmp = cv::UMat(frame, roiRect).getMat(cv::ACCESS_READ).clone();
                         cv::rectangle(tmp, lastRect, cv::Scalar(255, 255, 255), 2);
                         cv::imshow("init " + std::to_string(m_trackID), tmp);
 #endif
@@ -637,7 +952,7 @@ void CTrack::RectUpdate(const CRegion& region,
                     }
                     else
                     {
-                        m_tracker.release();
+                        ReleaseTracker();
                         m_outOfTheFrame = true;
                     }
                 }
@@ -647,23 +962,27 @@ void CTrack::RectUpdate(const CRegion& region,
 #endif
             break;
 
+        case tracking::TrackMOSSE:
         case tracking::TrackDAT:
         case tracking::TrackSTAPLE:
         case tracking::TrackLDES:
             {
                 if (!m_VOTTracker || reinit)
                 {
-                    CreateExternalTracker(currFrame.channels());
+                    SelectLevel(brect);
+                    cv::UMat frame = TrackerFrame();
+                    const track_t scale = LevelScale();
+                    CreateExternalTracker(frame.channels());
 
-                    cv::Rect2d lastRect(brect.x, brect.y, brect.width, brect.height);
+                    cv::Rect2d lastRect(brect.x / scale, brect.y / scale, brect.width / scale, brect.height / scale);
 
                     if (lastRect.x >= 0 &&
                             lastRect.y >= 0 &&
-                            lastRect.x + lastRect.width < prevFrame.cols &&
-                            lastRect.y + lastRect.height < prevFrame.rows &&
+                            lastRect.x + lastRect.width < frame.cols &&
+                            lastRect.y + lastRect.height < frame.rows &&
                             lastRect.area() > 0)
                     {
-                        cv::Mat mat = currFrame.getMat(cv::ACCESS_READ);
+                        cv::Mat mat = exec::MapToHost(frame, "CTrack::RectUpdate(VOT init)");
                         m_VOTTracker->Initialize(mat, lastRect);
                         m_VOTTracker->Train(mat, true);
 
@@ -682,16 +1001,26 @@ void CTrack::RectUpdate(const CRegion& region,
         return inited;
     };
 
-    switch (m_externalTrackerForLost)
+    // Without the visual tracker the lost track is only predicted
+    switch ((dataCorrect || useExternalTracker) ? m_externalTrackerForLost : tracking::TrackNone)
     {
     case tracking::TrackNone:
         break;
 
+    case tracking::TrackBatchedLK:
+    case tracking::TrackBatchedMOSSE:
+        // Box was propagated by CTracker together with the other lost tracks
+        if (m_batchedRect)
+        {
+            trackedRRect = *m_batchedRect;
+            wasTracked = true;
+        }
+        break;
+
     case tracking::TrackKCF:
     case tracking::TrackMIL:
     case tracking::TrackMedianFlow:
     case tracking::TrackGOTURN:
-    case tracking::TrackMOSSE:
 	case tracking::TrackCSRT:
 #ifdef USE_OCV_KCF
         {
@@ -702,11 +1031,12 @@ void CTrack::RectUpdate(const CRegion& region,
 #else
             cv::Rect newRect;
 #endif
-            if (!inited && !m_tracker.empty() && m_tracker->update(cv::UMat(currFrame, roiRect), newRect))
+            cv::UMat frame = TrackerFrame();
+            if (!inited && !m_tracker.empty() && m_tracker->update(cv::UMat(frame, roiRect), newRect))
             {
 #if 0
 #ifndef SILENT_WORK
-                cv::Mat tmp2 = cv::UMat(currFrame, roiRect).getMat(cv::ACCESS_READ).clone();
+                cv::Mat tmp2 = cv::UMat(frame, roiRect).getMat(cv::ACCESS_READ).clone();
                 cv::rectangle(tmp2, newRect, cv::Scalar(255, 255, 255), 2);
                 cv::imshow("track " + std::to_string(m_trackID), tmp2);
 #endif
@@ -718,7 +1048,8 @@ void CTrack::RectUpdate(const CRegion& region,
                 cv::Rect prect(newRect.x + roiRect.x, newRect.y + roiRect.y, newRect.width, newRect.height);
 #endif
                 //trackedRRect = cv::RotatedRect(prect.tl(), cv::Point2f(static_cast<float>(prect.x + prect.width), static_cast<float>(prect.y)), prect.br());
-                trackedRRect = cv::RotatedRect(cv::Point2f(prect.x + prect.width / 2.f, prect.y + prect.height / 2.f), cv::Size2f(prect.width, prect.height), 0);
+                const track_t scale = LevelScale();
+                trackedRRect = cv::RotatedRect(cv::Point2f(scale * (prect.x + prect.width / 2.f), scale * (prect.y + prect.height / 2.f)), cv::Size2f(scale * prect.width, scale * prect.height), 0);
                 wasTracked = true;
             }
         }
@@ -727,6 +1058,7 @@ void CTrack::RectUpdate(const CRegion& region,
 #endif
         break;
 
+    case tracking::TrackMOSSE:
     case tracking::TrackDAT:
     case tracking::TrackSTAPLE:
     case tracking::TrackLDES:
@@ -736,9 +1068,14 @@ void CTrack::RectUpdate(const CRegion& region,
             if (!inited && m_VOTTracker)
             {
                 constexpr float confThresh = 0.3f;
-                cv::Mat mat = currFrame.getMat(cv::ACCESS_READ);
+                cv::UMat frame = TrackerFrame();
+                cv::Mat mat = exec::MapToHost(frame, "CTrack::RectUpdate(VOT)");
                 float confidence = 0;
                 trackedRRect = m_VOTTracker->Update(mat, confidence);
+                const track_t scale = LevelScale();
+                trackedRRect.center *= scale;
+                trackedRRect.size.width *= scale;
+                trackedRRect.size.height *= scale;
                 if (confidence > confThresh)
                 {
                     m_VOTTracker->Train(mat, false);
@@ -825,8 +1162,9 @@ void CTrack::RectUpdate(const CRegion& region,
     }
 
     brect = m_predictionRect.boundingRect();
-    int dx = Clamp(brect.x, brect.width, currFrame.cols);
-    int dy = Clamp(brect.y, brect.height, currFrame.rows);
+    const cv::Size frameSize = FrameSize(currFrame);
+    int dx = Clamp(brect.x, brect.width, frameSize.width);
+    int dy = Clamp(brect.y, brect.height, frameSize.height);
 #if 0
     m_predictionRect.center.x += dx;
     m_predictionRect.center.y += dy;
@@ -835,6 +1173,8 @@ void CTrack::RectUpdate(const CRegion& region,
 
     m_predictionPoint = m_predictionRect.center;
 
+    m_batchedRect.reset();
+
 	//std::cout << "brect = " << brect << ", dx = " << dx << ", dy = " << dy << ", outOfTheFrame = " << m_outOfTheFrame << ", predictionPoint = " << m_predictionPoint << std::endl;
 }
 
@@ -846,95 +1186,27 @@ void CTrack::CreateExternalTracker(int channels)
     switch (m_externalTrackerForLost)
     {
     case tracking::TrackNone:
+    case tracking::TrackBatchedLK:
+    case tracking::TrackBatchedMOSSE:
         if (m_VOTTracker)
             m_VOTTracker = nullptr;
 
 #ifdef USE_OCV_KCF
         if (m_tracker && !m_tracker.empty())
-            m_tracker.release();
+            ReleaseTracker();
 #endif
         break;
 
     case tracking::TrackKCF:
-#ifdef USE_OCV_KCF
-        if (!m_tracker || m_tracker.empty())
-        {
-            cv::TrackerKCF::Params params;
-			if (channels == 1)
-			{
-				params.compressed_size = 1;
-				params.desc_pca = cv::TrackerKCF::GRAY;
-				params.desc_npca = cv::TrackerKCF::GRAY;
-			}
-			else
-			{
-				params.compressed_size = 3;
-				params.desc_pca = cv::TrackerKCF::CN;
-				params.desc_npca = cv::TrackerKCF::CN;
-			}
-            params.resize = true;
-            params.detect_thresh = 0.7f;
-#if (((CV_VERSION_MAJOR == 3) && (CV_VERSION_MINOR >= 3)) || (CV_VERSION_MAJOR > 3))
-            m_tracker = cv::TrackerKCF::create(params);
-#else
-            m_tracker = cv::TrackerKCF::createTracker(params);
-#endif
-        }
-#endif
-        if (m_VOTTracker)
-            m_VOTTracker = nullptr;
-        break;
-
     case tracking::TrackMIL:
-#ifdef USE_OCV_KCF
-        if (!m_tracker || m_tracker.empty())
-        {
-            cv::TrackerMIL::Params params;
-
-#if (((CV_VERSION_MAJOR == 3) && (CV_VERSION_MINOR >= 3)) || (CV_VERSION_MAJOR > 3))
-            m_tracker = cv::TrackerMIL::create(params);
-#else
-            m_tracker = cv::TrackerMIL::createTracker(params);
-#endif
-        }
-#endif
-        if (m_VOTTracker)
-            m_VOTTracker = nullptr;
-        break;
-
     case tracking::TrackMedianFlow:
-#ifdef USE_OCV_KCF
-        if (!m_tracker || m_tracker.empty())
-        {
-#if (((CV_VERSION_MAJOR == 4) && (CV_VERSION_MINOR > 4)) || (CV_VERSION_MAJOR > 4))
-            std::cerr << "TrackMedianFlow not supported in OpenCV 4.5 and newer!" << std::endl;
-            CV_Assert(0);
-#else
-            cv::TrackerMedianFlow::Params params;
-
-#if (((CV_VERSION_MAJOR == 3) && (CV_VERSION_MINOR >= 3)) || (CV_VERSION_MAJOR > 3))
-            m_tracker = cv::TrackerMedianFlow::create(params);
-#else
-            m_tracker = cv::TrackerMedianFlow::createTracker(params);
-#endif
-#endif
-        }
-#endif
-        if (m_VOTTracker)
-            m_VOTTracker = nullptr;
-        break;
-
     case tracking::TrackGOTURN:
+    case tracking::TrackCSRT:
 #ifdef USE_OCV_KCF
         if (!m_tracker || m_tracker.empty())
         {
-            cv::TrackerGOTURN::Params params;
-
-#if (((CV_VERSION_MAJOR == 3) && (CV_VERSION_MINOR >= 3)) || (CV_VERSION_MAJOR > 3))
-            m_tracker = cv::TrackerGOTURN::create(params);
-#else
-            m_tracker = cv::TrackerGOTURN::createTracker(params);
-#endif
+            m_tracker = m_trackersPool ? m_trackersPool->Acquire(m_externalTrackerForLost, channels) : VisualTrackersPool::Create(m_externalTrackerForLost, channels);
+            m_trackerChannels = channels;
         }
 #endif
         if (m_VOTTracker)
@@ -943,53 +1215,17 @@ void CTrack::CreateExternalTracker(int channels)
 
     case tracking::TrackMOSSE:
 #ifdef USE_OCV_KCF
-        if (!m_tracker || m_tracker.empty())
-        {
-#if (((CV_VERSION_MAJOR == 4) && (CV_VERSION_MINOR > 4)) || (CV_VERSION_MAJOR > 4))
-            std::cerr << "TrackMOSSE not supported in OpenCV 4.5 and newer!" << std::endl;
-            CV_Assert(0);
-#else
-#if (((CV_VERSION_MAJOR == 3) && (CV_VERSION_MINOR > 3)) || (CV_VERSION_MAJOR > 3))
-            m_tracker = cv::TrackerMOSSE::create();
-#else
-            m_tracker = cv::TrackerMOSSE::createTracker();
-#endif
-#endif
-        }
+        if (m_tracker && !m_tracker.empty())
+            ReleaseTracker();
 #endif
-        if (m_VOTTracker)
-            m_VOTTracker = nullptr;
+        if (!m_VOTTracker)
+            m_VOTTracker = std::make_unique<MOSSETracker>();
         break;
 
-	case tracking::TrackCSRT:
-#ifdef USE_OCV_KCF
-		if (!m_tracker || m_tracker.empty())
-		{
-#if (CV_VERSION_MAJOR >= 4)
-			cv::TrackerCSRT::Params params;
-			params.psr_threshold = 0.04f; // 0.035f;
-			if (channels == 1)
-			{
-				params.use_gray = true;
-				params.use_rgb = false;
-			}
-			else
-			{
-				params.use_gray = false;
-				params.use_rgb = true;
-			}
-			m_tracker = cv::TrackerCSRT::create(params);
-#endif
-		}
-#endif
-        if (m_VOTTracker)
-            m_VOTTracker = nullptr;
-		break;
-
     case tracking::TrackDAT:
 #ifdef USE_OCV_KCF
 		if (m_tracker && !m_tracker.empty())
-			m_tracker.release();
+			ReleaseTracker();
 #endif
         if (!m_VOTTracker)
             m_VOTTracker = std::make_unique<DAT_TRACKER>();
@@ -998,7 +1234,7 @@ void CTrack::CreateExternalTracker(int channels)
     case tracking::TrackSTAPLE:
 #ifdef USE_OCV_KCF
         if (m_tracker && !m_tracker.empty())
-            m_tracker.release();
+            ReleaseTracker();
 #endif
 #ifdef USE_STAPLE_TRACKER
         if (!m_VOTTracker)
@@ -1011,7 +1247,7 @@ void CTrack::CreateExternalTracker(int channels)
 	case tracking::TrackLDES:
 #ifdef USE_OCV_KCF
 		if (m_tracker && !m_tracker.empty())
-			m_tracker.release();
+			ReleaseTracker();
 #endif
 #ifdef USE_STAPLE_TRACKER
 		if (!m_VOTTracker)
@@ -1024,6 +1260,20 @@ void CTrack::CreateExternalTracker(int channels)
     }
 }
 
+///
+/// \brief ReleaseTracker
+/// OpenCV tracker goes back to the pool for the next lost tracks
+///
+void CTrack::ReleaseTracker()
+{
+#ifdef USE_OCV_KCF
+    if (m_trackersPool)
+        m_trackersPool->Release(m_externalTrackerForLost, m_trackerChannels, m_tracker);
+    else if (m_tracker && !m_tracker.empty())
+        m_tracker.release();
+#endif
+}
+
 ///
 /// \brief PointUpdate
 /// \param pt
@@ -1065,3 +1315,166 @@ void CTrack::PointUpdate(const Point_t& pt,
 
 	//std::cout << "predictionRect = " << m_predictionRect.boundingRect() << ", outOfTheFrame = " << m_outOfTheFrame << ", predictionPoint = " << m_predictionPoint << std::endl;
 }
+
+///
+/// \brief CTrack::Save
+/// \param writer
+/// \param traceTail
+///
+void CTrack::Save(checkpoint::Writer& writer, size_t traceTail) const
+{
+    writer.Pod(static_cast<uint64_t>(m_trackID.m_val));
+    writer.Pod(m_lastRegion.m_type);
+    writer.RotatedRect(m_lastRegion.m_rrect);
+    writer.Rect(m_lastRegion.m_brect);
+    writer.Pod(m_lastRegion.m_confidence);
+    writer.RotatedRect(m_predictionRect);
+    writer.Point(m_predictionPoint);
+    writer.Pod(static_cast<uint64_t>(m_skippedFrames));
+    writer.Pod(m_currType);
+    writer.Pod(m_lastType);
+    writer.Pod(static_cast<uint64_t>(m_anotherTypeCounter));
+    writer.Rect(m_staticRect);
+    writer.Pod(static_cast<int32_t>(m_staticFrames));
+    writer.Pod(static_cast<uint8_t>(m_isStatic));
+    writer.Pod(static_cast<uint8_t>(m_outOfTheFrame));
+
+    // The points before the tail are simplified to the history of the copy
+    const Trace* srcTrace = &m_trace;
+    Trace simplified;
+    if (m_trace.HistoryError() > 0 && traceTail < m_trace.size())
+    {
+        simplified = m_trace;
+        simplified.pop_front(m_trace.size() - traceTail);
+        srcTrace = &simplified;
+    }
+
+    // Key points of the history: the coordinates and the deltas of the point numbers
+    std::vector<track_t> historyPoints;
+    std::vector<uint32_t> historyDeltas;
+    historyPoints.reserve(2 * srcTrace->HistorySize());
+    historyDeltas.reserve(srcTrace->HistorySize());
+    uint32_t prevInd = 0;
+    for (size_t i = 0; i < srcTrace->HistorySize(); ++i)
+    {
+        const TraceKeyPoint& keyPoint = srcTrace->History(i);
+        historyPoints.push_back(keyPoint.m_pt.x);
+        historyPoints.push_back(keyPoint.m_pt.y);
+        historyDeltas.push_back(keyPoint.m_ind - prevInd);
+        prevInd = keyPoint.m_ind;
+    }
+    writer.Vector(historyPoints);
+    writer.Vector(historyDeltas);
+
+    // Prediction, raw point and its flag
+    const size_t tail = std::min(traceTail, srcTrace->size());
+    writer.Pod(static_cast<uint64_t>(srcTrace->GetTotalCount() - tail));
+    std::vector<track_t> trace;
+    trace.reserve(5 * tail);
+    for (size_t i = srcTrace->size() - tail; i < srcTrace->size(); ++i)
+    {
+        const TrajectoryPoint& pt = srcTrace->at(i);
+        trace.push_back(pt.m_prediction.x);
+        trace.push_back(pt.m_prediction.y);
+        trace.push_back(pt.m_raw.x);
+        trace.push_back(pt.m_raw.y);
+        trace.push_back(pt.m_hasRaw ? 1.f : 0.f);
+    }
+    writer.Vector(trace);
+
+    writer.Mat(m_regionEmbedding.m_hist);
+    writer.Mat(m_regionEmbedding.m_embedding);
+
+    std::vector<track_t> kalman;
+    m_kalman.Save(kalman);
+    writer.Vector(kalman);
+}
+
+///
+/// \brief CTrack::Restore
+/// \param reader
+/// \return
+///
+bool CTrack::Restore(checkpoint::Reader& reader)
+{
+    uint64_t trackID = 0;
+    CRegion lastRegion;
+    uint64_t skippedFrames = 0;
+    uint64_t anotherTypeCounter = 0;
+    int32_t staticFrames = 0;
+    uint8_t isStatic = 0;
+    uint8_t outOfTheFrame = 0;
+    reader.Pod(trackID);
+    reader.Pod(lastRegion.m_type);
+    reader.RotatedRect(lastRegion.m_rrect);
+    reader.Rect(lastRegion.m_brect);
+    reader.Pod(lastRegion.m_confidence);
+    reader.RotatedRect(m_predictionRect);
+    reader.Point(m_predictionPoint);
+    reader.Pod(skippedFrames);
+    reader.Pod(m_currType);
+    reader.Pod(m_lastType);
+    reader.Pod(anotherTypeCounter);
+    reader.Rect(m_staticRect);
+    reader.Pod(staticFrames);
+    reader.Pod(isStatic);
+    reader.Pod(outOfTheFrame);
+
+    std::vector<track_t> historyPoints;
+    std::vector<uint32_t> historyDeltas;
+    uint64_t pointsBefore = 0;
+    std::vector<track_t> trace;
+    cv::Mat hist;
+    cv::Mat embedding;
+    std::vector<track_t> kalman;
+    reader.Vector(historyPoints);
+    reader.Vector(historyDeltas);
+    reader.Pod(pointsBefore);
+    reader.Vector(trace);
+    reader.Mat(hist);
+    reader.Mat(embedding);
+    reader.Vector(kalman);
+    if (!reader.Ok() || trace.size() % 5 != 0 || historyPoints.size() != 2 * historyDeltas.size() || !m_kalman.Restore(kalman))
+        return false;
+
+    m_trackID = track_id_t(static_cast<track_id_t::value_type>(trackID));
+    m_lastRegion = lastRegion;
+    m_skippedFrames = static_cast<size_t>(skippedFrames);
+    m_anotherTypeCounter = static_cast<size_t>(anotherTypeCounter);
+    m_staticFrames = staticFrames;
+    m_isStatic = isStatic != 0;
+    m_outOfTheFrame = outOfTheFrame != 0;
+    m_polledPoints = 0;
+
+    std::vector<TraceKeyPoint> history(historyDeltas.size());
+    uint32_t ind = 0;
+    for (size_t i = 0; i < history.size(); ++i)
+    {
+        ind += historyDeltas[i];
+        history[i].m_pt = Point_t(historyPoints[2 * i], historyPoints[2 * i + 1]);
+        history[i].m_ind = ind;
+    }
+    m_trace = Trace();
+    m_trace.RestoreHistory(std::move(history), static_cast<size_t>(pointsBefore));
+    m_trace.Reserve(trace.size() / 5);
+    m_motionStats.Reset();
+    for (size_t i = 0; i < trace.size(); i += 5)
+    {
+        const Point_t prediction(trace[i], trace[i + 1]);
+        if (trace[i + 4] != 0)
+            PushTrace(prediction, Point_t(trace[i + 2], trace[i + 3]));
+        else
+            PushTrace(prediction);
+    }
+
+    m_regionEmbedding = RegionEmbedding();
+    if (m_memoryLevel < 2)
+        m_regionEmbedding.m_hist = hist;
+    m_embeddingMemory.Restore(embedding, m_regionEmbedding);
+
+    // The visual tracker and the snapshot of the static object are created again by the next frames
+    ReleaseTracker();
+    m_batchedRect.reset();
+    m_staticSnapshot.Reset();
+    return true;
+}
@@ -15,16 +15,12 @@
 #include "object_types.h"
 #include "Kalman.h"
 #include "VOTTracker.hpp"
-
-///
-/// \brief The RegionEmbedding struct
-///
-struct RegionEmbedding
-{
-    cv::Mat m_hist;
-    cv::Mat m_embedding;
-    double m_embDot = 0.;
-};
+#include "TracksHotStore.h"
+#include "EmbeddingMemory.h"
+#include "StaticSnapshot.h"
+#include "FramePyramid.h"
+#include "VisualTrackersPool.h"
+#include "TrackerCheckpoint.h"
 
 ///
 /// \brief The CTrack class
@@ -37,9 +33,15 @@ public:
            track_t deltaTime,
            track_t accelNoiseMag,
            bool useAcceleration,
+           bool steadyStateGain,
            track_id_t trackID,
            bool filterObjectSize,
-           tracking::LostTrackType externalTrackerForLost);
+           tracking::LostTrackType externalTrackerForLost,
+           const EmbeddingMemory& embeddingMemory,
+           const StaticSnapshot::Settings& staticSnapshot,
+           std::shared_ptr<KalmanBatch> kalmanBatch,
+           std::shared_ptr<FramePyramid> framePyramid,
+           std::shared_ptr<VisualTrackersPool> trackersPool);
 
     CTrack(const CRegion& region,
            const RegionEmbedding& regionEmbedding,
@@ -47,9 +49,21 @@ public:
            track_t deltaTime,
            track_t accelNoiseMag,
            bool useAcceleration,
+           bool steadyStateGain,
            track_id_t trackID,
            bool filterObjectSize,
-           tracking::LostTrackType externalTrackerForLost);
+           tracking::LostTrackType externalTrackerForLost,
+           const EmbeddingMemory& embeddingMemory,
+           const StaticSnapshot::Settings& staticSnapshot,
+           std::shared_ptr<KalmanBatch> kalmanBatch,
+           std::shared_ptr<FramePyramid> framePyramid,
+           std::shared_ptr<VisualTrackersPool> trackersPool);
+
+    ~CTrack();
+
+    // The tracks are allocated from the pool of the process: the new tracks reuse the blocks of the removed ones
+    static void* operator new(size_t size);
+    static void operator delete(void* ptr, size_t size);
 
     ///
     /// \brief CalcDistCenter
@@ -86,6 +100,25 @@ public:
 	/// \return
 	///
 	std::optional<track_t> CalcCosine(const RegionEmbedding& embedding) const;
+	///
+	/// \brief CosineDist
+	/// Distance from 0 to 1 by the dot product of two embeddings and their squared norms
+	/// \param xy
+	/// \param embDot1
+	/// \param embDot2
+	/// \return
+	///
+	static track_t CosineDist(double xy, double embDot1, double embDot2);
+	///
+	/// \brief GetRegionEmbedding
+	/// \return Histogram and embedding of the last region
+	///
+	const RegionEmbedding& GetRegionEmbedding() const;
+	///
+	/// \brief ResetEmbedding
+	/// The re-ID network of the track type was swapped to the incompatible one
+	///
+	void ResetEmbedding();
 
 	cv::RotatedRect CalcPredictionEllipse(cv::Size_<track_t> minRadius) const;
 	///
@@ -99,34 +132,149 @@ public:
     track_t WidthDist(const CRegion& reg) const;
     track_t HeightDist(const CRegion& reg) const;
 
-    void Update(const CRegion& region, bool dataCorrect, size_t max_trace_length, cv::UMat prevFrame, cv::UMat currFrame, int trajLen, int maxSpeedForStatic);
+    ///
+    /// \brief Update
+    /// \param useExternalTracker - if false then the lost track is only predicted by Kalman without the visual tracker
+    ///
+    void Update(const CRegion& region, bool dataCorrect, size_t max_trace_length, cv::UMat prevFrame, cv::UMat currFrame, int trajLen, int maxSpeedForStatic, bool useExternalTracker = true);
     void Update(const CRegion& region, const RegionEmbedding& regionEmbedding, bool dataCorrect, size_t max_trace_length, cv::UMat prevFrame, cv::UMat currFrame, int trajLen, int maxSpeedForStatic);
 
     bool IsStatic() const;
     bool IsStaticTimeout(int framesTime) const;
+    int StaticFrames() const
+    {
+        return m_staticFrames;
+    }
+    const cv::Rect& StaticRect() const
+    {
+        return m_staticRect;
+    }
+    ///
+    /// \brief StaticDiff
+    /// \return Difference between the snapshot of the static object and the current frame, -1 without the snapshot
+    ///
+    double StaticDiff(cv::UMat currFrame) const
+    {
+        return m_staticSnapshot.Diff(currFrame);
+    }
+    ///
+    /// \brief KeepStatic
+    /// Cheap update of the static track without the association and the Kalman filter: the trajectory and the static time are continued
+    /// \param region - the detected region of the object or nullptr
+    ///
+    void KeepStatic(const CRegion* region);
+
+    ///
+    /// \brief SetTimeScale
+    /// \param timeScale - interval until the next update in the nominal frames
+    ///
+    void SetTimeScale(track_t timeScale)
+    {
+        m_kalman.SetTimeScale(timeScale);
+    }
+    ///
+    /// \brief SetFrameGeometry
+    /// \param frameSize - original frame: the coordinates of the track
+    /// \param processingScale - the frames of Update and StaticDiff are resized on this scale
+    ///
+    void SetFrameGeometry(cv::Size frameSize, track_t processingScale)
+    {
+        m_frameSize = frameSize;
+        m_processingScale = processingScale;
+    }
+    ///
+    /// \brief SetTraceHistory
+    /// \param maxError - of the simplified history of the points removed from the trajectory, 0 - without history
+    /// \param capacity - of the key points of the history
+    ///
+    void SetTraceHistory(track_t maxError, size_t capacity)
+    {
+        m_trace.SetHistory(maxError, capacity);
+    }
     bool IsOutOfTheFrame() const;
 
     cv::RotatedRect GetLastRect() const;
 
+    ///
+    /// \brief SetBatchedRect
+    /// Box of the lost track on the current frame for tracking::TrackBatchedLK and TrackBatchedMOSSE, it's used by the next Update
+    /// \param rrect
+    ///
+    void SetBatchedRect(const cv::RotatedRect& rrect);
+
     const Point_t& AveragePoint() const;
     Point_t& AveragePoint();
     const CRegion& LastRegion() const;
     objtype_t GetCurrType() const;
+    const Trace& GetTrace() const;
     size_t SkippedFrames() const;
     size_t& SkippedFrames();
 
     TrackingObject ConstructObject() const;
+    TrackingObject ConstructObject(size_t tailSize) const;
     track_id_t GetID() const;
 
+    ///
+    /// \brief TotalPointsCount
+    /// Count of the points that were added to the trajectory during the track life
+    /// \return
+    ///
+    size_t TotalPointsCount() const;
+    ///
+    /// \brief NewPointsCount
+    /// Count of points in trajectory that were added after the totalPoints
+    /// \param totalPoints
+    /// \return
+    ///
+    size_t NewPointsCount(size_t totalPoints) const;
+    ///
+    /// \brief PolledPoints
+    /// Value of the TotalPointsCount on the previous BaseTracker::GetTracksDelta, 0 if the track wasn't polled
+    /// \return
+    ///
+    size_t& PolledPoints();
+
+    ///
+    /// \brief MemoryBytes
+    /// Trajectory, histogram, embedding, static snapshot and the estimation of the visual tracker model
+    /// \return
+    ///
+    size_t MemoryBytes() const;
+    ///
+    /// \brief ReduceMemory
+    /// Degradation of the track under the memory budget of the tracker, the levels are cumulative
+    /// \param level - 1 - trajectory is shortened to a quarter, 2 - histogram isn't kept, 3 - visual tracker of the lost track is released
+    /// \param minTraceLen - the shortened trajectory isn't shorter
+    /// \return false if the track has already this level
+    ///
+    bool ReduceMemory(int level, size_t minTraceLen);
+
+    ///
+    /// \brief Save
+    /// State of the track for the checkpoint: the last region, the trajectory tail and the simplified history before it,
+    /// the Kalman filter, the re-ID signature and the counters. The models of the visual trackers aren't saved, they are created again on the next loss of the track
+    /// \param writer
+    /// \param traceTail - last points of the trajectory
+    ///
+    void Save(checkpoint::Writer& writer, size_t traceTail) const;
+    ///
+    /// \brief Restore
+    /// \param reader
+    /// \return false if the data is corrupted, the track isn't valid then
+    ///
+    bool Restore(checkpoint::Reader& reader);
+
 private:
     TKalmanFilter m_kalman;
     CRegion m_lastRegion;
     Trace m_trace;
+    MotionStats m_motionStats;
     cv::RotatedRect m_predictionRect;
     Point_t m_predictionPoint;
 
     track_id_t m_trackID = 0;
     size_t m_skippedFrames = 0;
+    size_t m_polledPoints = 0;
 
     objtype_t m_currType = bad_type;
     objtype_t m_lastType = bad_type;
@@ -136,29 +284,65 @@ private:
     tracking::LostTrackType m_externalTrackerForLost = tracking::TrackNone;
 #ifdef USE_OCV_KCF
     cv::Ptr<cv::Tracker> m_tracker;
+    int m_trackerChannels = 0;
 #endif
+    std::shared_ptr<VisualTrackersPool> m_trackersPool;
     std::unique_ptr<VOTTracker> m_VOTTracker;
+    std::shared_ptr<FramePyramid> m_framePyramid;
+    int m_trackerLevel = 0; // Level of the pyramid for the visual tracker
+    cv::Size m_frameSize;          // Empty if the frames of Update have the original size
+    track_t m_processingScale = 1; // Of the frames of Update relative to the original frame
+
+    ///
+    cv::Size FrameSize(const cv::UMat& frame) const
+    {
+        return m_frameSize.empty() ? frame.size() : m_frameSize;
+    }
+    std::optional<cv::RotatedRect> m_batchedRect;
 
     ///
-    void RectUpdate(const CRegion& region, bool dataCorrect, cv::UMat prevFrame, cv::UMat currFrame);
+    /// \brief PushTrace
+    /// New point of the trajectory and of the motion statistics
+    ///
+    void PushTrace(const Point_t& prediction)
+    {
+        m_trace.push_back(prediction);
+        m_motionStats.Add(prediction);
+    }
+    ///
+    void PushTrace(const Point_t& prediction, const Point_t& raw)
+    {
+        m_trace.push_back(prediction, raw);
+        m_motionStats.Add(prediction);
+    }
+
+    ///
+    void RectUpdate(const CRegion& region, bool dataCorrect, cv::UMat prevFrame, cv::UMat currFrame, bool useExternalTracker);
 
     ///
     void CreateExternalTracker(int channels);
+    ///
+    void ReleaseTracker();
 
     ///
     void PointUpdate(const Point_t& pt, const cv::Size& newObjSize, bool dataCorrect, const cv::Size& frameSize);
 
+    EmbeddingMemory m_embeddingMemory;
     RegionEmbedding m_regionEmbedding;
 
     ///
     bool CheckStatic(int trajLen, cv::UMat currFrame, const CRegion& region, int maxSpeedForStatic);
-    cv::UMat m_staticFrame;
+    StaticSnapshot m_staticSnapshot;
     cv::Rect m_staticRect;
     int m_staticFrames = 0;
     bool m_isStatic = false;
 
     bool m_filterObjectSize = false;
     bool m_outOfTheFrame = false;
+
+    int m_memoryLevel = 0;     // Level of ReduceMemory
+    size_t m_traceLimit = 0;   // Length of the shortened trajectory, 0 - max_trace_length of Update
+    size_t TraceCapacity(size_t maxTraceLength) const;
 };
 
 typedef std::vector<std::unique_ptr<CTrack>> tracks_t;
@@ -1,6 +1,9 @@
 #pragma once
 #include <vector>
+#include <cmath>
+#include <algorithm>
 #include "defines.h"
+#include "MotionStats.h"
 
 ///
 /// \brief The TrajectoryPoint struct
@@ -57,8 +60,21 @@ struct TrajectoryPoint
 	bool m_hasRaw = false;
 };
 
+///
+/// \brief The TraceKeyPoint struct
+/// Point of the simplified history of the trajectory
+///
+struct TraceKeyPoint
+{
+    Point_t m_pt;       // Prediction
+    uint32_t m_ind = 0; // Number of the point from the start of the track, see Trace::GetTotalCount
+};
+
 ///
 /// \brief The Trace class
+/// Trajectory in the circular buffer: if capacity is set then the oldest points are overwritten by the new.
+/// With SetHistory the overwritten points aren't lost: they are simplified online to the key points of the history
+/// with the bounded error, so the long history costs only the turns of the trajectory
 ///
 class Trace
 {
@@ -69,6 +85,10 @@ public:
     Trace(const Trace&) = default;
     ///
     Trace(Trace&&) = default;
+    ///
+    Trace& operator=(const Trace&) = default;
+    ///
+    Trace& operator=(Trace&&) = default;
 
     ///
     /// \brief operator []
@@ -77,7 +97,7 @@ public:
     ///
     const Point_t& operator[](size_t i) const
     {
-        return m_trace[i].m_prediction;
+        return m_trace[Index(i)].m_prediction;
     }
 
     ///
@@ -87,7 +107,7 @@ public:
     ///
     Point_t& operator[](size_t i)
     {
-        return m_trace[i].m_prediction;
+        return m_trace[Index(i)].m_prediction;
     }
 
     ///
@@ -97,7 +117,7 @@ public:
     ///
     const TrajectoryPoint& at(size_t i) const
     {
-        return m_trace[i];
+        return m_trace[Index(i)];
     }
 
     ///
@@ -106,7 +126,7 @@ public:
     ///
     size_t size() const
     {
-        return m_trace.size();
+        return m_size;
     }
 
     ///
@@ -115,11 +135,11 @@ public:
     ///
     void push_back(const Point_t& prediction)
     {
-        m_trace.emplace_back(prediction);
+        Push(TrajectoryPoint(prediction));
     }
     void push_back(const Point_t& prediction, const Point_t& raw)
     {
-        m_trace.emplace_back(prediction, raw);
+        Push(TrajectoryPoint(prediction, raw));
     }
 
     ///
@@ -128,10 +148,29 @@ public:
     ///
     void pop_front(size_t count)
     {
-        if (count < size())
-            m_trace.erase(m_trace.begin(), m_trace.begin() + count);
+        if (m_historyError > 0)
+        {
+            for (size_t i = 0; i < std::min(count, m_size); ++i)
+            {
+                AddHistory(at(i).m_prediction, m_totalCount - m_size + i);
+            }
+        }
+        if (count < m_size)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                if (at(i).m_hasRaw)
+                    --m_rawCount;
+            }
+            m_first = Index(count);
+            m_size -= count;
+        }
         else
-            m_trace.clear();
+        {
+            m_first = 0;
+            m_size = 0;
+            m_rawCount = 0;
+        }
     }
 
     ///
@@ -141,18 +180,27 @@ public:
     ///
     size_t GetRawCount(size_t lastPeriod) const
     {
-        size_t res = 0;
+        if (lastPeriod >= m_size)
+            return m_rawCount;
 
-        size_t i = 0;
-        if (lastPeriod < m_trace.size())
-            i = m_trace.size() - lastPeriod;
-
-        for (; i < m_trace.size(); ++i)
+        // Scan the shorter part of the trajectory
+        const size_t firstPeriod = m_size - lastPeriod;
+        if (firstPeriod < lastPeriod)
+        {
+            size_t res = m_rawCount;
+            for (size_t i = 0; i < firstPeriod; ++i)
+            {
+                if (at(i).m_hasRaw)
+                    --res;
+            }
+            return res;
+        }
+        size_t res = 0;
+        for (size_t i = firstPeriod; i < m_size; ++i)
         {
-            if (m_trace[i].m_hasRaw)
+            if (at(i).m_hasRaw)
                 ++res;
         }
-
         return res;
     }
 
@@ -166,8 +214,295 @@ public:
 		m_trace.reserve(capacity);
 	}
 
+    ///
+    /// \brief SetCapacity
+    /// Maximum count of the points, the oldest points are removed. 0 - without limit
+    /// \param capacity
+    ///
+    void SetCapacity(size_t capacity)
+    {
+        if (capacity == m_capacity)
+            return;
+
+        if (capacity && m_size > capacity)
+            pop_front(m_size - capacity);
+        Linearize();
+        m_capacity = capacity;
+        if (m_capacity)
+            m_trace.reserve(m_capacity);
+    }
+
+    ///
+    /// \brief ShrinkToFit
+    /// Memory of the points over the size is freed
+    ///
+    void ShrinkToFit()
+    {
+        Linearize();
+        m_trace.shrink_to_fit();
+    }
+
+    ///
+    /// \brief MemoryBytes
+    /// \return Allocated memory of the points
+    ///
+    size_t MemoryBytes() const
+    {
+        return m_trace.capacity() * sizeof(TrajectoryPoint) + m_history.capacity() * sizeof(TraceKeyPoint);
+    }
+
+    ///
+    /// \brief GetTotalCount
+    /// \return Count of all points that were added including removed by pop_front
+    ///
+    size_t GetTotalCount() const
+    {
+        return m_totalCount;
+    }
+
+    ///
+    /// \brief SetHistory
+    /// The points removed from the buffer are simplified to the key points: the polyline of the key points is
+    /// not farther than maxError from the every removed point (sleeve of the directions from the last key point)
+    /// \param maxError - in pixels, 0 - the removed points are lost
+    /// \param capacity - of the key points, the oldest are removed. 0 - without limit
+    ///
+    void SetHistory(track_t maxError, size_t capacity)
+    {
+        if (maxError <= 0)
+        {
+            m_history.clear();
+            m_history.shrink_to_fit();
+            m_hasProvisional = false;
+        }
+        m_historyError = std::max<track_t>(0, maxError);
+        m_historyCapacity = capacity;
+        TrimHistory();
+    }
+
+    ///
+    /// \brief HistoryError
+    /// \return 0 if the history is disabled
+    ///
+    track_t HistoryError() const
+    {
+        return m_historyError;
+    }
+
+    ///
+    /// \brief HistorySize
+    /// \return Key points before the points of the buffer
+    ///
+    size_t HistorySize() const
+    {
+        return m_history.size();
+    }
+
+    ///
+    /// \brief History
+    /// \param i - 0 is the oldest
+    /// \return
+    ///
+    const TraceKeyPoint& History(size_t i) const
+    {
+        return m_history[i];
+    }
+
+    ///
+    /// \brief RestoreHistory
+    /// Key points of the checkpoint before the push of the buffer points
+    /// \param history
+    /// \param totalCount - of the points before the buffer points
+    ///
+    void RestoreHistory(std::vector<TraceKeyPoint>&& history, size_t totalCount)
+    {
+        m_history = std::move(history);
+        m_hasProvisional = false;
+        m_sleeveSet = false;
+        m_totalCount = std::max(m_totalCount, totalCount);
+        TrimHistory();
+    }
+
+    ///
+    /// \brief Tail
+    /// Without the history
+    /// \param count
+    /// \return Trace with the last count points
+    ///
+    Trace Tail(size_t count) const
+    {
+        Trace res;
+        if (count > m_size)
+            count = m_size;
+        res.m_trace.reserve(count);
+        for (size_t i = m_size - count; i < m_size; ++i)
+        {
+            res.Push(at(i));
+        }
+        return res;
+    }
+
 private:
-    std::vector<TrajectoryPoint> m_trace;
+    std::vector<TrajectoryPoint> m_trace; // Circular buffer
+    size_t m_first = 0;                   // Index of the oldest point in m_trace
+    size_t m_size = 0;
+    size_t m_capacity = 0;
+    size_t m_rawCount = 0;                // Count of points with m_hasRaw
+    size_t m_totalCount = 0;
+
+    std::vector<TraceKeyPoint> m_history; // Simplified removed points, the last can be provisional
+    track_t m_historyError = 0;
+    size_t m_historyCapacity = 0;
+    bool m_hasProvisional = false;        // The last key point is replaced while the sleeve contains the new points
+    bool m_sleeveSet = false;             // The removed points after the anchor aren't only in its maxError circle
+    track_t m_sleeveRef = 0;              // Direction of the sleeve, the bounds are relative to it
+    track_t m_sleeveLo = 0;
+    track_t m_sleeveHi = 0;
+    track_t m_sleeveDist = 0;             // Max distance of the removed points from the anchor
+
+    ///
+    size_t Index(size_t i) const
+    {
+        size_t ind = m_first + i;
+        if (ind >= m_trace.size())
+            ind -= m_trace.size();
+        return ind;
+    }
+
+    ///
+    void Push(const TrajectoryPoint& pt)
+    {
+        if (m_size < m_trace.size())
+        {
+            // Free place after pop_front
+            m_trace[Index(m_size)] = pt;
+            ++m_size;
+        }
+        else if (!m_capacity || m_trace.size() < m_capacity)
+        {
+            Linearize();
+            m_trace.push_back(pt);
+            ++m_size;
+        }
+        else
+        {
+            // Full: overwrite the oldest point
+            if (m_historyError > 0)
+                AddHistory(m_trace[m_first].m_prediction, m_totalCount - m_size);
+            if (m_trace[m_first].m_hasRaw)
+                --m_rawCount;
+            m_trace[m_first] = pt;
+            m_first = Index(1);
+        }
+        if (pt.m_hasRaw)
+            ++m_rawCount;
+        ++m_totalCount;
+    }
+
+    ///
+    void Linearize()
+    {
+        if (m_first == 0 && m_size == m_trace.size())
+            return;
+
+        std::rotate(m_trace.begin(), m_trace.begin() + m_first, m_trace.end());
+        m_trace.resize(m_size);
+        m_first = 0;
+    }
+
+    ///
+    static track_t WrapAngle(track_t angle)
+    {
+        constexpr track_t pi = static_cast<track_t>(CV_PI);
+        while (angle > pi)
+            angle -= 2 * pi;
+        while (angle < -pi)
+            angle += 2 * pi;
+        return angle;
+    }
+
+    ///
+    /// \brief NarrowSleeve
+    /// The directions from the anchor which pass not farther than m_historyError from the point
+    ///
+    void NarrowSleeve(const Point_t& pt, const Point_t& anchor)
+    {
+        const Point_t diff = pt - anchor;
+        const track_t dist = std::hypot(diff.x, diff.y);
+        m_sleeveDist = std::max(m_sleeveDist, dist);
+        if (dist <= m_historyError)
+            return;
+        const track_t half = std::asin(m_historyError / dist);
+        const track_t angle = std::atan2(diff.y, diff.x);
+        if (!m_sleeveSet)
+        {
+            m_sleeveSet = true;
+            m_sleeveRef = angle;
+            m_sleeveLo = -half;
+            m_sleeveHi = half;
+            return;
+        }
+        const track_t rel = WrapAngle(angle - m_sleeveRef);
+        m_sleeveLo = std::max(m_sleeveLo, rel - half);
+        m_sleeveHi = std::min(m_sleeveHi, rel + half);
+    }
+
+    ///
+    /// \brief AddHistory
+    /// Online simplification: the provisional key point is moved to the new point while the segment from the anchor
+    /// (the previous key point) to it is in the sleeve of the replaced points, else it becomes the anchor
+    ///
+    void AddHistory(const Point_t& pt, size_t ind)
+    {
+        const TraceKeyPoint keyPoint{ pt, static_cast<uint32_t>(ind) };
+        if (m_history.empty())
+        {
+            m_history.push_back(keyPoint);
+            return;
+        }
+        if (!m_hasProvisional)
+        {
+            m_sleeveSet = false;
+            m_sleeveDist = 0;
+            NarrowSleeve(pt, m_history.back().m_pt);
+            m_history.push_back(keyPoint);
+            m_hasProvisional = true;
+            return;
+        }
+
+        const Point_t& anchor = m_history[m_history.size() - 2].m_pt;
+        const Point_t diff = pt - anchor;
+        const track_t dist = std::hypot(diff.x, diff.y);
+        bool inSleeve = dist + m_historyError >= m_sleeveDist;
+        if (inSleeve && m_sleeveSet)
+        {
+            const track_t rel = WrapAngle(std::atan2(diff.y, diff.x) - m_sleeveRef);
+            inSleeve = (rel >= m_sleeveLo) && (rel <= m_sleeveHi);
+        }
+        if (inSleeve)
+        {
+            NarrowSleeve(pt, anchor);
+            m_history.back() = keyPoint;
+            return;
+        }
+
+        // The provisional point is the new anchor
+        m_hasProvisional = false;
+        TrimHistory();
+        AddHistory(pt, ind);
+    }
+
+    ///
+    void TrimHistory()
+    {
+        if (!m_historyCapacity || m_history.size() <= m_historyCapacity)
+            return;
+        // By the chunks: the erase of the vector begin is linear
+        const size_t count = std::max<size_t>(m_history.size() - m_historyCapacity, m_historyCapacity / 8);
+        m_history.erase(m_history.begin(), m_history.begin() + std::min(count, m_history.size() - 1));
+        if (m_history.size() < 2)
+            m_hasProvisional = false;
+    }
 };
 
 ///
@@ -175,6 +510,15 @@ private:
 ///
 struct TrackingObject
 {
+	///
+	enum class Estimate
+	{
+		Detected,     // Matched with the detection on this frame
+		Predicted,    // The tracker was updated without the matched detection: the motion model prediction
+		Extrapolated, // The frame wasn't tracked: moved by the velocity from the last update
+		Interpolated  // The frame wasn't tracked: interpolated between two updates
+	};
+
 	Trace m_trace;                     // Trajectory
 	track_id_t m_ID = 0;               // Objects ID
 	cv::RotatedRect m_rrect;           // Coordinates
@@ -184,6 +528,8 @@ struct TrackingObject
 	bool m_isStatic = false;           // Object is abandoned
 	bool m_outOfTheFrame = false;      // Is object out of the frame
 	mutable bool m_lastRobust = false; // saved latest robust value
+	Estimate m_estimate = Estimate::Detected; // Source of the coordinates
+	TrackMotion m_motion;              // Running statistics of the all trajectory, not only of m_trace
 
 	///
     TrackingObject(const cv::RotatedRect& rrect, track_id_t ID, const Trace& trace,
@@ -193,8 +539,14 @@ struct TrackingObject
 	{
 	}
 
+	///
+	TrackingObject(const TrackingObject&) = default;
 	///
 	TrackingObject(TrackingObject&&) = default;
+	///
+	TrackingObject& operator=(const TrackingObject&) = default;
+	///
+	TrackingObject& operator=(TrackingObject&&) = default;
 
     ///
     /// \brief IsRobust
@@ -205,19 +557,28 @@ struct TrackingObject
     ///
 	bool IsRobust(int minTraceSize, float minRawRatio, cv::Size2f sizeRatio) const
 	{
-		m_lastRobust = m_trace.size() > static_cast<size_t>(minTraceSize);
-		m_lastRobust &= m_trace.GetRawCount(m_trace.size() - 1) / static_cast<float>(m_trace.size()) > minRawRatio;
+		m_lastRobust = IsRobust(m_trace, m_rrect, m_outOfTheFrame, minTraceSize, minRawRatio, sizeRatio);
+		return m_lastRobust;
+	}
+
+    ///
+    /// \brief IsRobust
+    /// The same check on the state of the track before the construction of TrackingObject
+    ///
+	static bool IsRobust(const Trace& trace, const cv::RotatedRect& rrect, bool outOfTheFrame, int minTraceSize, float minRawRatio, cv::Size2f sizeRatio)
+	{
+		if (outOfTheFrame || trace.size() == 0 || trace.size() <= static_cast<size_t>(minTraceSize))
+			return false;
+		if (trace.GetRawCount(trace.size() - 1) / static_cast<float>(trace.size()) <= minRawRatio)
+			return false;
 		if (sizeRatio.width + sizeRatio.height > 0)
 		{
-            float sr = m_rrect.size.width / m_rrect.size.height;
-			if (sizeRatio.width > 0)
-				m_lastRobust &= (sr > sizeRatio.width);
-
-			if (sizeRatio.height > 0)
-				m_lastRobust &= (sr < sizeRatio.height);
+            float sr = rrect.size.width / rrect.size.height;
+			if (sizeRatio.width > 0 && !(sr > sizeRatio.width))
+				return false;
+			if (sizeRatio.height > 0 && !(sr < sizeRatio.height))
+				return false;
 		}
-		if (m_outOfTheFrame)
-			m_lastRobust = false;
-		return m_lastRobust;
+		return true;
 	}
 };
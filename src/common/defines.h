@@ -2,7 +2,10 @@
 
 #include <vector>
 #include <string>
+#include <cstdint>
 #include <map>
+#include <numeric>
+#include <algorithm>
 #include <opencv2/opencv.hpp>
 #include "object_types.h"
 
@@ -15,7 +18,189 @@ typedef cv::Point_<track_t> Point_t;
 #define Mat_t CV_32FC
 
 typedef std::vector<int> assignments_t;
-typedef std::vector<track_t> distMatrix_t;
+
+///
+/// \brief The CostMatrix class
+/// Costs of the assignment: the rows are tracks and the columns are regions. The layout is row-major, the rows are
+/// padded and aligned to the cache line, so the costs of the track are written and read sequentially.
+/// The buffer is reused on the resize and it only grows
+///
+class CostMatrix
+{
+public:
+    static constexpr size_t Alignment = 64;
+
+    CostMatrix() = default;
+    CostMatrix(size_t rows, size_t cols, track_t value = 0)
+    {
+        Assign(rows, cols, value);
+    }
+    CostMatrix(const CostMatrix& other)
+    {
+        *this = other;
+    }
+    CostMatrix(CostMatrix&& other) noexcept
+    {
+        *this = std::move(other);
+    }
+
+    CostMatrix& operator=(const CostMatrix& other)
+    {
+        if (this != &other)
+        {
+            Resize(other.m_rows, other.m_cols);
+            std::copy_n(other.m_ptr, m_rows * m_stride, m_ptr);
+        }
+        return *this;
+    }
+    CostMatrix& operator=(CostMatrix&& other) noexcept
+    {
+        if (this != &other)
+        {
+            // The moved buffer keeps its address
+            m_data = std::move(other.m_data);
+            m_ptr = other.m_ptr;
+            m_rows = other.m_rows;
+            m_cols = other.m_cols;
+            m_stride = other.m_stride;
+            other.m_data.clear();
+            other.m_ptr = nullptr;
+            other.m_rows = other.m_cols = other.m_stride = 0;
+        }
+        return *this;
+    }
+
+    ///
+    /// \brief Resize
+    /// \param rows
+    /// \param cols
+    /// The values are not initialized
+    ///
+    void Resize(size_t rows, size_t cols)
+    {
+        constexpr size_t alignElems = Alignment / sizeof(track_t);
+        m_rows = rows;
+        m_cols = cols;
+        m_stride = ((cols + alignElems - 1) / alignElems) * alignElems;
+        const size_t size = m_rows * m_stride + alignElems;
+        if (m_data.size() < size)
+            m_data.resize(size);
+        const uintptr_t addr = reinterpret_cast<uintptr_t>(m_data.data());
+        m_ptr = reinterpret_cast<track_t*>((addr + Alignment - 1) & ~static_cast<uintptr_t>(Alignment - 1));
+    }
+
+    ///
+    /// \brief Assign
+    /// \param rows
+    /// \param cols
+    /// \param value - of the all elements
+    ///
+    void Assign(size_t rows, size_t cols, track_t value)
+    {
+        Resize(rows, cols);
+        Fill(value);
+    }
+
+    ///
+    /// \brief Fill
+    /// \param value - of the all elements
+    ///
+    void Fill(track_t value)
+    {
+        std::fill_n(m_ptr, m_rows * m_stride, value);
+    }
+
+    ///
+    track_t* Row(size_t row)
+    {
+        return m_ptr + row * m_stride;
+    }
+    ///
+    const track_t* Row(size_t row) const
+    {
+        return m_ptr + row * m_stride;
+    }
+    ///
+    track_t& operator()(size_t row, size_t col)
+    {
+        return m_ptr[row * m_stride + col];
+    }
+    ///
+    track_t operator()(size_t row, size_t col) const
+    {
+        return m_ptr[row * m_stride + col];
+    }
+
+    ///
+    size_t Rows() const
+    {
+        return m_rows;
+    }
+    ///
+    size_t Cols() const
+    {
+        return m_cols;
+    }
+    ///
+    /// \brief Stride
+    /// \return Elements between the rows, multiple of the alignment
+    ///
+    size_t Stride() const
+    {
+        return m_stride;
+    }
+
+private:
+    std::vector<track_t> m_data;
+    track_t* m_ptr = nullptr;
+    size_t m_rows = 0;
+    size_t m_cols = 0;
+    size_t m_stride = 0;
+};
+typedef CostMatrix distMatrix_t;
+
+///
+/// \brief The SparsePairs struct
+/// Compressed rows of the cost matrix: for each track (row) the regions (columns) with a calculated distance.
+/// All other pairs have implicit forbidden cost
+///
+struct SparsePairs
+{
+    std::vector<size_t> m_rowsStart; // Offsets in m_cols, rows + 1 elements
+    std::vector<int> m_cols;
+
+    ///
+    void Clear()
+    {
+        m_rowsStart.assign(1, 0);
+        m_cols.clear();
+    }
+    ///
+    void AddCol(int col)
+    {
+        m_cols.push_back(col);
+    }
+    ///
+    void FinishRow()
+    {
+        m_rowsStart.push_back(m_cols.size());
+    }
+    ///
+    size_t Rows() const
+    {
+        return m_rowsStart.empty() ? 0 : m_rowsStart.size() - 1;
+    }
+    ///
+    const int* RowBegin(size_t row) const
+    {
+        return m_cols.data() + m_rowsStart[row];
+    }
+    ///
+    const int* RowEnd(size_t row) const
+    {
+        return m_cols.data() + m_rowsStart[row + 1];
+    }
+};
 
 ///
 template<typename T>
@@ -44,6 +229,7 @@ public:
     const TrackID& operator=(T val)
     {
         m_val = val;
+        return *this;
     }
 
     bool operator==(const TrackID& id) const
@@ -57,7 +243,7 @@ public:
     }
     static TrackID Str2ID(const std::string& id)
     {
-        return TrackID(std::stoi(id));
+        return TrackID(static_cast<T>(std::stoull(id)));
     }
     TrackID NextID() const
     {
@@ -72,6 +258,9 @@ public:
 };
 
 typedef TrackID<size_t> track_id_t;
+
+/// Video stream (camera) of the multi-stream processing
+typedef size_t stream_id_t;
 namespace std
 {
   template <>
@@ -137,13 +326,109 @@ private:
     ///
     cv::RotatedRect B2RRect() noexcept
     {
-        m_rrect = cv::RotatedRect(m_brect.tl(), cv::Point2f(static_cast<float>(m_brect.x + m_brect.width), static_cast<float>(m_brect.y)), m_brect.br());
+        // The same as RotatedRect(tl, tr, br) of the axis aligned rect without the norms, atan and the perpendicularity check
+        m_rrect.center = cv::Point2f(m_brect.x + 0.5f * m_brect.width, m_brect.y + 0.5f * m_brect.height);
+        m_rrect.size = cv::Size2f(static_cast<float>(m_brect.width), static_cast<float>(m_brect.height));
+        m_rrect.angle = 0.f;
         return m_rrect;
     }
 };
 
 typedef std::vector<CRegion> regions_t;
 
+///
+/// \brief The RegionsSoA struct
+/// Axis aligned candidates of the detector in the contiguous arrays: the filtering and NMS of the candidates
+/// don't touch the rotated rects, CRegion is created only for the results
+///
+struct RegionsSoA
+{
+    std::vector<cv::Rect> m_rects;
+    std::vector<objtype_t> m_types;
+    std::vector<float> m_confidences;
+
+    ///
+    void emplace_back(const cv::Rect& rect, objtype_t type, float confidence)
+    {
+        m_rects.push_back(rect);
+        m_types.push_back(type);
+        m_confidences.push_back(confidence);
+    }
+    ///
+    void append(const RegionsSoA& regions)
+    {
+        m_rects.insert(std::end(m_rects), std::begin(regions.m_rects), std::end(regions.m_rects));
+        m_types.insert(std::end(m_types), std::begin(regions.m_types), std::end(regions.m_types));
+        m_confidences.insert(std::end(m_confidences), std::begin(regions.m_confidences), std::end(regions.m_confidences));
+    }
+    ///
+    void reserve(size_t count)
+    {
+        m_rects.reserve(count);
+        m_types.reserve(count);
+        m_confidences.reserve(count);
+    }
+    ///
+    void clear()
+    {
+        m_rects.clear();
+        m_types.clear();
+        m_confidences.clear();
+    }
+    ///
+    size_t size() const
+    {
+        return m_rects.size();
+    }
+    ///
+    bool empty() const
+    {
+        return m_rects.empty();
+    }
+
+    ///
+    /// \brief KeepTopK
+    /// Leaves k candidates with the best confidences in their order
+    /// \param k
+    ///
+    void KeepTopK(size_t k)
+    {
+        if (size() <= k)
+            return;
+        std::vector<size_t> inds(size());
+        std::iota(std::begin(inds), std::end(inds), 0);
+        std::nth_element(std::begin(inds), std::begin(inds) + k, std::end(inds),
+                         [this](size_t i1, size_t i2) { return m_confidences[i1] > m_confidences[i2]; });
+        inds.resize(k);
+        std::sort(std::begin(inds), std::end(inds)); // inds[i] >= i, so the moves don't overwrite the next sources
+        for (size_t i = 0; i < k; ++i)
+        {
+            m_rects[i] = m_rects[inds[i]];
+            m_types[i] = m_types[inds[i]];
+            m_confidences[i] = m_confidences[inds[i]];
+        }
+        m_rects.resize(k);
+        m_types.resize(k);
+        m_confidences.resize(k);
+    }
+    ///
+    CRegion Region(size_t i) const
+    {
+        return CRegion(m_rects[i], m_types[i], m_confidences[i]);
+    }
+};
+
+///
+/// \brief The RegionEmbedding struct
+///
+struct RegionEmbedding
+{
+    cv::Mat m_hist;           // Square root of the normalized color histogram in one row, see RegionHistograms::SqrtNormalize
+
+    cv::Mat m_embedding;
+    double m_embDot = 0.;
+};
+
 ///
 ///
 ///
@@ -211,6 +496,9 @@ enum MatchType
 {
     MatchHungrian,
     MatchBipart,
+    MatchLAPJV,
+    MatchGreedy,
+    MatchAuto,
     MatchCount
 };
 
@@ -229,6 +517,19 @@ enum LostTrackType
     TrackDAT,
     TrackSTAPLE,
     TrackLDES,
+    TrackBatchedLK,    // Sparse optical flow of all lost tracks in one pass, see LostTracksFlow
+    TrackBatchedMOSSE, // Correlation filters of all lost tracks in one batch on OpenCL, see LostTracksCorrelation
     SingleTracksCount
 };
+
+///
+/// \brief The TrackIDMode enum
+///
+enum TrackIDMode
+{
+    IDLocal,   // Own counter of the every tracker from 0
+    IDProcess, // One atomic counter of all trackers of the process
+    IDPacked,  // Stream ID in the high bits and the own counter of the tracker in the low bits, see TrackIDAllocator.h
+    IDModesCount
+};
 }
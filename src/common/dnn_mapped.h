@@ -0,0 +1,68 @@
+#pragma once
+#include <string>
+#include <cctype>
+#include <algorithm>
+#include <opencv2/dnn.hpp>
+
+#include "mapped_file.h"
+
+namespace dnn_mapped
+{
+///
+/// \brief Extension
+/// \param fileName
+/// \return Lower case extension without the dot
+///
+inline std::string Extension(const std::string& fileName)
+{
+    const size_t dot = fileName.find_last_of('.');
+    if (dot == std::string::npos)
+        return std::string();
+    std::string ext = fileName.substr(dot + 1);
+    std::transform(std::begin(ext), std::end(ext), std::begin(ext), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return ext;
+}
+
+///
+/// \brief ReadNet
+/// The same as cv::dnn::readNet but the files are parsed from the shared read only mappings instead of the ifstream buffers:
+/// the weights file isn't read to the heap of the every process and instance. Falls back to cv::dnn::readNet
+/// for the unknown frameworks and the files which can't be mapped
+/// \param model
+/// \param config
+/// \return
+///
+inline cv::dnn::Net ReadNet(std::string model, std::string config = std::string())
+{
+    std::string modelExt = Extension(model);
+    std::string configExt = Extension(config);
+    // readNet accepts the both orders of the files
+    if (modelExt == "cfg" || modelExt == "prototxt" || modelExt == "pbtxt")
+    {
+        std::swap(model, config);
+        std::swap(modelExt, configExt);
+    }
+
+    auto modelFile = MappedFile::Open(model);
+    std::shared_ptr<const MappedFile> configFile;
+    if (!config.empty())
+        configFile = MappedFile::Open(config);
+    if (!modelFile || (!config.empty() && !configFile))
+        return cv::dnn::readNet(model, config);
+
+    const char* configData = configFile ? configFile->Chars() : nullptr;
+    const size_t configBytes = configFile ? configFile->Bytes() : 0;
+
+    if (modelExt == "weights" && configFile)
+        return cv::dnn::readNetFromDarknet(configData, configBytes, modelFile->Chars(), modelFile->Bytes());
+    if (modelExt == "caffemodel" && configFile)
+        return cv::dnn::readNetFromCaffe(configData, configBytes, modelFile->Chars(), modelFile->Bytes());
+    if (modelExt == "pb")
+        return cv::dnn::readNetFromTensorflow(modelFile->Chars(), modelFile->Bytes(), configData, configBytes);
+#if (((CV_VERSION_MAJOR == 4) && (CV_VERSION_MINOR >= 3)) || (CV_VERSION_MAJOR > 4))
+    if (modelExt == "onnx")
+        return cv::dnn::readNetFromONNX(modelFile->Chars(), modelFile->Bytes());
+#endif
+    return cv::dnn::readNet(model, config);
+}
+}
@@ -0,0 +1,272 @@
+#pragma once
+#include <map>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <cstdint>
+#include <utility>
+#include <iostream>
+
+#include <opencv2/core.hpp>
+#include <opencv2/core/ocl.hpp>
+
+#include "metrics.h"
+
+///
+/// Execution policy of the UMat code paths. cv::ocl::setUseOpenCL is the thread local state of OpenCV, so without
+/// the explicit policy the OpenCL usage of the detector and the tracker depends on the thread that calls them.
+/// Every stage thread of the pipeline applies the same policy:
+///
+///     exec::ScopedStage stage(policy, "detect");
+///
+/// The implicit transfers between the device and the host memory (getMat of the OpenCL buffer, getUMat of the host
+/// frame with OpenCL) are made by exec::MapToHost/MapToDevice: they are counted by the metrics
+/// mtracker_device_transfers_total{stage,direction} and mtracker_device_transfer_bytes_total{stage,direction}
+/// and optionally logged with the call site
+///
+namespace exec
+{
+///
+/// \brief The Backend enum
+///
+enum class Backend
+{
+    Auto = 0,   // OpenCL if it's enabled in the thread that creates the pipeline
+    CPU = 1,
+    OpenCL = 2,
+    BackendsCount
+};
+
+///
+/// \brief The Direction enum
+///
+enum class Direction
+{
+    ToHost = 0,
+    ToDevice = 1
+};
+
+///
+/// \brief The Policy struct
+///
+struct Policy
+{
+    Backend m_backend = Backend::Auto;
+    std::string m_openclDevice;    // The OPENCV_OPENCL_DEVICE format: "Intel:GPU:0", ":GPU:1", empty - the default device
+    bool m_logTransfers = false;
+
+    ///
+    /// \brief Resolve
+    /// Auto is replaced by the OpenCL state of the calling thread: the all stages get the same backend
+    ///
+    Policy Resolve() const
+    {
+        Policy policy = *this;
+        if (policy.m_backend == Backend::Auto)
+            policy.m_backend = cv::ocl::useOpenCL() ? Backend::OpenCL : Backend::CPU;
+        return policy;
+    }
+};
+
+namespace detail
+{
+///
+/// \brief The ThreadState struct
+///
+struct ThreadState
+{
+    const char* m_stage = "unknown";
+    bool m_logTransfers = false;
+    std::map<std::pair<const char*, int>, std::pair<metrics::Counter*, metrics::Counter*>> m_counters;
+};
+
+///
+inline ThreadState& GetThreadState()
+{
+    static thread_local ThreadState state;
+    return state;
+}
+
+#if (((CV_VERSION_MAJOR == 4) && (CV_VERSION_MINOR >= 5)) || (CV_VERSION_MAJOR > 4))
+#define MTRACKER_OCL_EXECUTION_CONTEXT 1
+///
+/// \brief GetDeviceContext
+/// The execution contexts of the selected devices are created once and shared by the all threads
+///
+inline bool GetDeviceContext(const std::string& device, cv::ocl::OpenCLExecutionContext& context)
+{
+    static std::mutex mutex;
+    static std::map<std::string, cv::ocl::OpenCLExecutionContext> contexts;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = contexts.find(device);
+    if (it == std::end(contexts))
+    {
+        cv::ocl::OpenCLExecutionContext newContext;
+        try
+        {
+            cv::ocl::Context ctx = cv::ocl::Context::create(device);
+            if (ctx.ptr() && ctx.ndevices() > 0)
+            {
+                newContext = cv::ocl::OpenCLExecutionContext::create(ctx, ctx.device(0));
+                std::cout << "OpenCL device " << device << ": " << ctx.device(0).name() << std::endl;
+            }
+        }
+        catch (const cv::Exception& ex)
+        {
+            std::cerr << "OpenCL device " << device << ": " << ex.what() << std::endl;
+        }
+        if (newContext.empty())
+            std::cerr << "OpenCL device " << device << " not found, the default device is used" << std::endl;
+        it = contexts.emplace(device, newContext).first;
+    }
+    context = it->second;
+    return !context.empty();
+}
+#endif
+
+///
+/// \brief StageCounters
+/// \return The transfers count and the bytes counters of the stage, they are cached by the thread
+///
+inline std::pair<metrics::Counter*, metrics::Counter*> StageCounters(ThreadState& state, Direction direction)
+{
+    auto key = std::make_pair(state.m_stage, static_cast<int>(direction));
+    auto it = state.m_counters.find(key);
+    if (it == std::end(state.m_counters))
+    {
+        std::string labels = std::string("{stage=\"") + state.m_stage + "\",direction=\"" + ((direction == Direction::ToHost) ? "to_host" : "to_device") + "\"}";
+        metrics::Registry& registry = metrics::Registry::Instance();
+        metrics::Counter* count = &registry.GetCounter("mtracker_device_transfers_total" + labels, "Implicit transfers between the OpenCL device and the host memory");
+        metrics::Counter* bytes = &registry.GetCounter("mtracker_device_transfer_bytes_total" + labels, "Bytes of the implicit transfers between the OpenCL device and the host memory");
+        it = state.m_counters.emplace(key, std::make_pair(count, bytes)).first;
+    }
+    return it->second;
+}
+}
+
+///
+/// \brief Apply
+/// Applies the policy to the calling thread
+/// \param policy - the resolved policy
+///
+inline void Apply(const Policy& policy)
+{
+    const bool useOCL = (policy.m_backend == Backend::OpenCL);
+    if (policy.m_backend != Backend::Auto)
+        cv::ocl::setUseOpenCL(useOCL);
+    if (useOCL && !cv::ocl::useOpenCL())
+        std::cerr << "Execution policy: OpenCL isn't available, the CPU is used" << std::endl;
+
+    if (useOCL && !policy.m_openclDevice.empty() && cv::ocl::useOpenCL())
+    {
+#ifdef MTRACKER_OCL_EXECUTION_CONTEXT
+        cv::ocl::OpenCLExecutionContext context;
+        if (detail::GetDeviceContext(policy.m_openclDevice, context))
+            context.bind();
+#else
+        static std::once_flag warnOnce;
+        std::call_once(warnOnce, []() { std::cerr << "Execution policy: the OpenCL device is selected by the OPENCV_OPENCL_DEVICE environment variable with OpenCV < 4.5" << std::endl; });
+#endif
+    }
+    detail::GetThreadState().m_logTransfers = policy.m_logTransfers;
+}
+
+///
+/// \brief CountTransfer
+/// Records the transfer in the metrics of the current stage
+/// \param direction
+/// \param bytes
+/// \param site - string literal with the call site name
+///
+inline void CountTransfer(Direction direction, size_t bytes, const char* site)
+{
+    detail::ThreadState& state = detail::GetThreadState();
+    auto counters = detail::StageCounters(state, direction);
+    counters.first->Add();
+    counters.second->Add(bytes);
+
+    if (state.m_logTransfers)
+    {
+        // The first transfer of the site and then the every 1000th
+        static std::mutex mutex;
+        static std::map<const char*, uint64_t> siteCounts;
+        uint64_t siteCount = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            siteCount = ++siteCounts[site];
+        }
+        if (siteCount == 1 || siteCount % 1000 == 0)
+        {
+            std::cerr << "Implicit transfer " << ((direction == Direction::ToHost) ? "to host" : "to device")
+                      << " in " << state.m_stage << " at " << site << ": " << bytes << " bytes, " << siteCount << " times" << std::endl;
+        }
+    }
+}
+
+///
+/// \brief OnDevice
+/// \return true if the UMat data is in the OpenCL buffer
+///
+inline bool OnDevice(const cv::UMat& umat)
+{
+    return umat.u && umat.u->handle;
+}
+
+///
+/// \brief MapToHost
+/// Read-only host view of the UMat, the mapping of the OpenCL buffer waits for the queue and copies it on the discrete GPU
+///
+inline cv::Mat MapToHost(const cv::UMat& umat, const char* site)
+{
+    if (OnDevice(umat))
+        CountTransfer(Direction::ToHost, umat.total() * umat.elemSize(), site);
+    return umat.getMat(cv::ACCESS_READ);
+}
+
+///
+/// \brief MapToDevice
+/// Read-only UMat of the host frame, with OpenCL the data is uploaded on the first kernel
+///
+inline cv::UMat MapToDevice(const cv::Mat& mat, const char* site)
+{
+    if (cv::ocl::useOpenCL() && !mat.empty())
+        CountTransfer(Direction::ToDevice, mat.total() * mat.elemSize(), site);
+    return mat.getUMat(cv::ACCESS_READ);
+}
+
+///
+/// \brief The ScopedStage class
+/// Applies the policy to the stage thread and names the stage in the transfers metrics
+///
+class ScopedStage
+{
+public:
+    ///
+    ScopedStage(const Policy& policy, const char* stage)
+        : m_useOCL(cv::ocl::useOpenCL())
+    {
+        detail::ThreadState& state = detail::GetThreadState();
+        m_prevStage = state.m_stage;
+        m_prevLog = state.m_logTransfers;
+        state.m_stage = stage;
+        Apply(policy);
+    }
+    ///
+    ~ScopedStage()
+    {
+        detail::ThreadState& state = detail::GetThreadState();
+        state.m_stage = m_prevStage;
+        state.m_logTransfers = m_prevLog;
+        cv::ocl::setUseOpenCL(m_useOCL);
+    }
+
+    ScopedStage(const ScopedStage&) = delete;
+    ScopedStage& operator=(const ScopedStage&) = delete;
+
+private:
+    bool m_useOCL = false;
+    const char* m_prevStage = nullptr;
+    bool m_prevLog = false;
+};
+}
@@ -0,0 +1,212 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+
+#include "metrics.h"
+
+///
+/// Timestamps of the frame on the way from the capture to the published tracks. Every stage marks its stamps on the
+/// frame, the output adds the frame to StageLatencies:
+///
+///     frame.m_timestamps.Mark(latency::Stamp::DetectStart);
+///     ...
+///     frame.m_timestamps.Mark(latency::Stamp::Output);
+///     latencies.Add(frame.m_timestamps);
+///
+/// The interval of the stage is measured from the nearest previous stamp of the frame, so the frame without the
+/// detection (skipped by the latency controller or the motion gate) has the track_wait from the decoding.
+/// The distributions are the metrics histograms mtracker_frame_stage_seconds{pipeline,stage} and
+/// mtracker_frame_latency_seconds{pipeline} (end-to-end) of metrics::Registry
+///
+namespace latency
+{
+///
+/// \brief The Stamp enum
+///
+enum class Stamp
+{
+    Capture = 0,  // The capture of the frame is started (the grab of the live stream)
+    Decoded,      // The frame is decoded to the host or the device memory
+    DetectStart,
+    DetectEnd,
+    TrackStart,
+    TrackEnd,
+    Output,       // The tracks of the frame are published: drawn or written to the log
+    StampsCount
+};
+
+///
+/// \brief StageName
+/// \return Name of the interval that ends by the stamp
+///
+inline const char* StageName(Stamp stamp)
+{
+    switch (stamp)
+    {
+    case Stamp::Capture: return "capture";
+    case Stamp::Decoded: return "decode";
+    case Stamp::DetectStart: return "detect_wait";
+    case Stamp::DetectEnd: return "detect";
+    case Stamp::TrackStart: return "track_wait";
+    case Stamp::TrackEnd: return "track";
+    case Stamp::Output: return "output_wait";
+    case Stamp::StampsCount: break;
+    }
+    return "unknown";
+}
+
+///
+/// \brief Now
+/// \return steady_clock time in nanoseconds
+///
+inline int64_t Now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+///
+/// \brief The FrameTimestamps struct
+///
+struct FrameTimestamps
+{
+    static constexpr size_t StampsCount = static_cast<size_t>(Stamp::StampsCount);
+
+    std::array<int64_t, StampsCount> m_ns {}; // 0 - the stage wasn't passed
+
+    ///
+    void Reset()
+    {
+        m_ns.fill(0);
+    }
+    ///
+    void Mark(Stamp stamp)
+    {
+        m_ns[static_cast<size_t>(stamp)] = Now();
+    }
+    ///
+    void Set(Stamp stamp, int64_t ns)
+    {
+        m_ns[static_cast<size_t>(stamp)] = ns;
+    }
+    ///
+    int64_t Get(Stamp stamp) const
+    {
+        return m_ns[static_cast<size_t>(stamp)];
+    }
+    ///
+    bool Has(Stamp stamp) const
+    {
+        return Get(stamp) != 0;
+    }
+
+    ///
+    /// \brief Ms
+    /// \return Milliseconds between the stamps, negative if one of them is absent
+    ///
+    double Ms(Stamp from, Stamp to) const
+    {
+        if (!Has(from) || !Has(to))
+            return -1.;
+        return (Get(to) - Get(from)) / 1e6;
+    }
+};
+
+///
+/// \brief The StageLatencies class
+/// Per stage and end-to-end latency distributions of the pipeline, the frames are added from any thread
+///
+class StageLatencies
+{
+public:
+    ///
+    /// \brief StageLatencies
+    /// \param pipeline - label of the metrics
+    /// \param slaMs - end-to-end latency SLA, the frames above it are counted as the violations, 0 - no SLA
+    ///
+    StageLatencies(const std::string& pipeline, double slaMs = 0)
+        : m_pipeline(pipeline), m_slaNs(static_cast<int64_t>(slaMs * 1e6))
+    {
+        metrics::Registry& registry = metrics::Registry::Instance();
+        for (size_t i = 1; i < FrameTimestamps::StampsCount; ++i)
+        {
+            m_stages[i] = &registry.GetHistogram("mtracker_frame_stage_seconds{pipeline=\"" + pipeline + "\",stage=\"" + StageName(static_cast<Stamp>(i)) + "\"}",
+                                                 "Time of the frame in the stage or in the queue before it");
+        }
+        m_endToEnd = &registry.GetHistogram("mtracker_frame_latency_seconds{pipeline=\"" + pipeline + "\"}", "Latency from the capture of the frame to the published tracks");
+        m_slaViolations = &registry.GetCounter("mtracker_frame_latency_sla_violations_total{pipeline=\"" + pipeline + "\"}", "Frames with the end-to-end latency above the SLA");
+    }
+
+    ///
+    /// \brief Add
+    /// \param timestamps - the frame with the Capture and the Output stamps
+    /// \return End-to-end latency in milliseconds, negative if the frame isn't complete
+    ///
+    double Add(const FrameTimestamps& timestamps)
+    {
+        if (!timestamps.Has(Stamp::Capture) || !timestamps.Has(Stamp::Output))
+            return -1.;
+
+        int64_t prev = timestamps.Get(Stamp::Capture);
+        for (size_t i = 1; i < FrameTimestamps::StampsCount; ++i)
+        {
+            const int64_t ns = timestamps.m_ns[i];
+            if (!ns)
+                continue;
+            m_stages[i]->Observe(std::chrono::nanoseconds(ns - prev));
+            prev = ns;
+        }
+        const int64_t endToEnd = timestamps.Get(Stamp::Output) - timestamps.Get(Stamp::Capture);
+        m_endToEnd->Observe(std::chrono::nanoseconds(endToEnd));
+        if (m_slaNs > 0 && endToEnd > m_slaNs)
+            m_slaViolations->Add();
+        return endToEnd / 1e6;
+    }
+
+    ///
+    /// \brief PrintReport
+    /// The quantiles are the upper bounds of the histogram buckets
+    ///
+    void PrintReport() const
+    {
+        const metrics::Histogram::Snapshot endToEnd = m_endToEnd->Collect();
+        if (!endToEnd.m_count)
+            return;
+
+        auto printRow = [](const char* name, const metrics::Histogram::Snapshot& snapshot)
+        {
+            const std::streamsize precision = std::cout.precision();
+            std::cout << std::setw(12) << name << ": count " << snapshot.m_count << std::fixed << std::setprecision(2)
+                      << ", mean " << snapshot.MeanMs() << ", p50 " << snapshot.QuantileMs(0.5)
+                      << ", p95 " << snapshot.QuantileMs(0.95) << ", p99 " << snapshot.QuantileMs(0.99) << std::endl;
+            std::cout.unsetf(std::ios_base::floatfield);
+            std::cout.precision(precision);
+        };
+
+        std::cout << "Frame latency of " << m_pipeline << ", ms:" << std::endl;
+        for (size_t i = 1; i < FrameTimestamps::StampsCount; ++i)
+        {
+            const metrics::Histogram::Snapshot snapshot = m_stages[i]->Collect();
+            if (snapshot.m_count)
+                printRow(StageName(static_cast<Stamp>(i)), snapshot);
+        }
+        printRow("end_to_end", endToEnd);
+        if (m_slaNs > 0)
+        {
+            const uint64_t violations = m_slaViolations->Value();
+            std::cout << "  SLA " << (m_slaNs / 1e6) << " ms: " << violations << " violations (" << (100. * violations / endToEnd.m_count) << "%)" << std::endl;
+        }
+    }
+
+private:
+    std::string m_pipeline;
+    int64_t m_slaNs = 0;
+    std::array<metrics::Histogram*, FrameTimestamps::StampsCount> m_stages {};
+    metrics::Histogram* m_endToEnd = nullptr;
+    metrics::Counter* m_slaViolations = nullptr;
+};
+}
@@ -0,0 +1,167 @@
+#pragma once
+#include <string>
+#include <memory>
+#include <mutex>
+#include <cerrno>
+#include <cstring>
+#include <cstdint>
+#include <iostream>
+#include <unordered_map>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+///
+/// \brief The MappedFile class
+/// Read only mapping of the file: the pages are read by the first access and are shared through the page cache
+/// by the all processes which map the same file, so the weights of the networks aren't copied to the private heap.
+/// MappedFile::Open shares one mapping between the instances of the process
+///
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile()
+    {
+        Close();
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ///
+    /// \brief Map
+    /// \param fileName
+    /// \return false if the file can't be mapped, the caller reads it by the usual way
+    ///
+    bool Map(const std::string& fileName)
+    {
+        Close();
+#ifdef _WIN32
+        m_file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (m_file == INVALID_HANDLE_VALUE)
+        {
+            m_file = nullptr;
+            return false;
+        }
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0)
+        {
+            Close();
+            return false;
+        }
+        m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (m_mapping)
+            m_memory = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+        if (!m_memory)
+        {
+            std::cerr << "MappedFile: map of " << fileName << " error " << GetLastError() << std::endl;
+            Close();
+            return false;
+        }
+        m_bytes = static_cast<size_t>(size.QuadPart);
+#else
+        const int fd = open(fileName.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0)
+        {
+            close(fd);
+            return false;
+        }
+        void* memory = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (memory == MAP_FAILED)
+        {
+            std::cerr << "MappedFile: mmap " << fileName << " failed: " << strerror(errno) << std::endl;
+            return false;
+        }
+        m_memory = static_cast<const uint8_t*>(memory);
+        m_bytes = static_cast<size_t>(st.st_size);
+#endif
+        return true;
+    }
+
+    ///
+    void Close()
+    {
+#ifdef _WIN32
+        if (m_memory)
+            UnmapViewOfFile(m_memory);
+        if (m_mapping)
+            CloseHandle(m_mapping);
+        if (m_file)
+            CloseHandle(m_file);
+        m_mapping = nullptr;
+        m_file = nullptr;
+#else
+        if (m_memory)
+            munmap(const_cast<uint8_t*>(m_memory), m_bytes);
+#endif
+        m_memory = nullptr;
+        m_bytes = 0;
+    }
+
+    ///
+    const uint8_t* Data() const
+    {
+        return m_memory;
+    }
+    ///
+    const char* Chars() const
+    {
+        return reinterpret_cast<const char*>(m_memory);
+    }
+    ///
+    size_t Bytes() const
+    {
+        return m_bytes;
+    }
+
+    ///
+    /// \brief Open
+    /// The mapping of the file is shared by the callers while one of them holds it
+    /// \param fileName
+    /// \return nullptr if the file can't be mapped
+    ///
+    static std::shared_ptr<const MappedFile> Open(const std::string& fileName)
+    {
+        static std::mutex mutex;
+        static std::unordered_map<std::string, std::weak_ptr<const MappedFile>> files;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = files.find(fileName);
+        if (it != std::end(files))
+        {
+            if (auto mapped = it->second.lock())
+                return mapped;
+        }
+        auto mapped = std::make_shared<MappedFile>();
+        if (!mapped->Map(fileName))
+        {
+            files.erase(fileName);
+            return nullptr;
+        }
+        files[fileName] = mapped;
+        return mapped;
+    }
+
+private:
+    const uint8_t* m_memory = nullptr;
+    size_t m_bytes = 0;
+
+#ifdef _WIN32
+    HANDLE m_file = nullptr;
+    HANDLE m_mapping = nullptr;
+#endif
+};
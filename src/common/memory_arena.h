@@ -0,0 +1,118 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <memory_resource>
+
+///
+/// \brief The CountingResource class
+/// Memory resource with the counters of the allocations from its upstream: the hot path is allocation-free on the steady state
+/// when Allocations doesn't grow between the frames
+///
+class CountingResource final : public std::pmr::memory_resource
+{
+public:
+    explicit CountingResource(std::pmr::memory_resource* upstream = std::pmr::new_delete_resource())
+        : m_upstream(upstream)
+    {
+    }
+
+    ///
+    /// \brief Allocations
+    /// \return Count of the allocations from the upstream
+    ///
+    size_t Allocations() const
+    {
+        return m_allocations.load(std::memory_order_relaxed);
+    }
+    ///
+    /// \brief Bytes
+    /// \return Allocated and not released bytes
+    ///
+    size_t Bytes() const
+    {
+        return m_bytes.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::pmr::memory_resource* m_upstream = nullptr;
+    std::atomic<size_t> m_allocations{ 0 };
+    std::atomic<size_t> m_bytes{ 0 };
+
+    void* do_allocate(size_t bytes, size_t alignment) override
+    {
+        void* ptr = m_upstream->allocate(bytes, alignment);
+        m_allocations.fetch_add(1, std::memory_order_relaxed);
+        m_bytes.fetch_add(bytes, std::memory_order_relaxed);
+        return ptr;
+    }
+    void do_deallocate(void* ptr, size_t bytes, size_t alignment) override
+    {
+        m_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+        m_upstream->deallocate(ptr, bytes, alignment);
+    }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+};
+
+///
+/// \brief The FrameArena class
+/// Monotonic arena of the scratch of one frame: the allocation is the bump of the pointer and Reset releases all of them at once.
+/// The vectors on the arena must be destroyed before Reset. The own buffer grows to the peak of the frames, so on the steady state
+/// the arena doesn't allocate from the upstream. It isn't thread-safe
+///
+class FrameArena
+{
+public:
+    explicit FrameArena(size_t initialBytes = 64 << 10)
+    {
+        Rebuild(initialBytes);
+    }
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    ///
+    std::pmr::memory_resource* Resource()
+    {
+        return &(*m_arena);
+    }
+
+    ///
+    /// \brief Reset
+    /// Releases the scratch of the frame, the buffer is enlarged if the frame didn't fit in it
+    /// \return Count of the allocations of the frame from the upstream
+    ///
+    size_t Reset()
+    {
+        const size_t overflowBytes = m_upstream.Bytes();
+        const size_t allocations = m_upstream.Allocations() - m_lastAllocations;
+        m_arena->release();
+        if (overflowBytes)
+            Rebuild(m_bufferSize + overflowBytes);
+        m_lastAllocations = m_upstream.Allocations();
+        return allocations;
+    }
+
+    ///
+    size_t BufferBytes() const
+    {
+        return m_bufferSize;
+    }
+
+private:
+    CountingResource m_upstream;
+    std::unique_ptr<std::byte[]> m_buffer;
+    size_t m_bufferSize = 0;
+    size_t m_lastAllocations = 0;
+    std::optional<std::pmr::monotonic_buffer_resource> m_arena;
+
+    void Rebuild(size_t bytes)
+    {
+        m_arena.reset();
+        m_bufferSize = bytes;
+        m_buffer.reset(new std::byte[m_bufferSize]);
+        m_arena.emplace(m_buffer.get(), m_bufferSize, &m_upstream);
+    }
+};
@@ -0,0 +1,459 @@
+#pragma once
+#include <map>
+#include <array>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <thread>
+#include <sstream>
+#include <fstream>
+#include <cstdio>
+#include <iostream>
+#include <algorithm>
+#include <condition_variable>
+
+///
+/// Lightweight metrics of the pipeline stages: the recording is lock-free (relaxed atomics), only the registration
+/// of the new metric and the collection take the mutex. The metrics are registered once and cached by the callers:
+///
+///     static metrics::Histogram& detectTime = metrics::Registry::Instance().GetHistogram("mtracker_detect_seconds{detector=\"yolo\"}", "Detection time");
+///     metrics::ScopedTimer timer(detectTime);
+///
+/// The name can contain the Prometheus labels in the braces, the metrics with the same name and different labels
+/// are the one family
+///
+namespace metrics
+{
+///
+/// \brief The Counter class
+/// Monotonic counter
+///
+class Counter
+{
+public:
+    void Add(uint64_t value = 1)
+    {
+        m_value.fetch_add(value, std::memory_order_relaxed);
+    }
+    uint64_t Value() const
+    {
+        return m_value.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<uint64_t> m_value { 0 };
+};
+
+///
+/// \brief The Gauge class
+/// Current value: queue depth, tracks count
+///
+class Gauge
+{
+public:
+    void Set(int64_t value)
+    {
+        m_value.store(value, std::memory_order_relaxed);
+    }
+    void Add(int64_t value)
+    {
+        m_value.fetch_add(value, std::memory_order_relaxed);
+    }
+    int64_t Value() const
+    {
+        return m_value.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<int64_t> m_value { 0 };
+};
+
+///
+/// \brief The Histogram class
+/// Latency histogram with the fixed exponential buckets: 50 us * 2^i, the last bucket is about 26 seconds
+///
+class Histogram
+{
+public:
+    static constexpr size_t BucketsCount = 20;
+
+    ///
+    /// \brief UpperBound
+    /// \param bucket
+    /// \return Upper bound of the bucket in nanoseconds
+    ///
+    static constexpr uint64_t UpperBound(size_t bucket)
+    {
+        return 50000ull << bucket;
+    }
+
+    ///
+    /// \brief Observe
+    /// \param duration
+    ///
+    void Observe(std::chrono::nanoseconds duration)
+    {
+        const uint64_t ns = static_cast<uint64_t>(std::max<int64_t>(0, duration.count()));
+        size_t bucket = 0;
+        while (bucket < BucketsCount && ns > UpperBound(bucket))
+        {
+            ++bucket;
+        }
+        m_buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+        m_sumNs.fetch_add(ns, std::memory_order_relaxed);
+    }
+
+    ///
+    /// \brief The Snapshot struct
+    /// Not cumulative counts of the buckets, the last one is +Inf
+    ///
+    struct Snapshot
+    {
+        std::array<uint64_t, BucketsCount + 1> m_buckets {};
+        uint64_t m_count = 0;
+        uint64_t m_sumNs = 0;
+
+        ///
+        /// \brief MeanMs
+        /// \return
+        ///
+        double MeanMs() const
+        {
+            return m_count ? (m_sumNs / (1e6 * m_count)) : 0.;
+        }
+
+        ///
+        /// \brief QuantileMs
+        /// \param q - [0, 1]
+        /// \return The upper bound of the bucket with the quantile
+        ///
+        double QuantileMs(double q) const
+        {
+            if (!m_count)
+                return 0.;
+            const uint64_t rank = static_cast<uint64_t>(q * (m_count - 1)) + 1;
+            uint64_t count = 0;
+            for (size_t i = 0; i < BucketsCount; ++i)
+            {
+                count += m_buckets[i];
+                if (count >= rank)
+                    return UpperBound(i) / 1e6;
+            }
+            return UpperBound(BucketsCount - 1) / 1e6;
+        }
+    };
+
+    ///
+    /// \brief Collect
+    /// \return
+    ///
+    Snapshot Collect() const
+    {
+        Snapshot snapshot;
+        for (size_t i = 0; i < m_buckets.size(); ++i)
+        {
+            snapshot.m_buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+            snapshot.m_count += snapshot.m_buckets[i];
+        }
+        snapshot.m_sumNs = m_sumNs.load(std::memory_order_relaxed);
+        return snapshot;
+    }
+
+private:
+    std::array<std::atomic<uint64_t>, BucketsCount + 1> m_buckets {};
+    std::atomic<uint64_t> m_sumNs { 0 };
+};
+
+///
+/// \brief The ScopedTimer class
+/// Observes the lifetime of the object in the histogram
+///
+class ScopedTimer
+{
+public:
+    explicit ScopedTimer(Histogram& histogram)
+        : m_histogram(histogram), m_start(std::chrono::steady_clock::now())
+    {
+    }
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    ~ScopedTimer()
+    {
+        m_histogram.Observe(std::chrono::steady_clock::now() - m_start);
+    }
+
+private:
+    Histogram& m_histogram;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+///
+/// \brief The Registry class
+/// Process-wide registry of the metrics, the references returned by Get* are valid until the end of the process
+///
+class Registry
+{
+public:
+    enum class Type
+    {
+        Counter,
+        Gauge,
+        Histogram
+    };
+
+    ///
+    /// \brief Instance
+    /// \return
+    ///
+    static Registry& Instance()
+    {
+        static Registry registry;
+        return registry;
+    }
+
+    ///
+    Counter& GetCounter(const std::string& name, const std::string& help = std::string())
+    {
+        return *GetEntry(name, help, Type::Counter).m_counter;
+    }
+    ///
+    Gauge& GetGauge(const std::string& name, const std::string& help = std::string())
+    {
+        return *GetEntry(name, help, Type::Gauge).m_gauge;
+    }
+    ///
+    Histogram& GetHistogram(const std::string& name, const std::string& help = std::string())
+    {
+        return *GetEntry(name, help, Type::Histogram).m_histogram;
+    }
+
+    ///
+    /// \brief The Sample struct
+    /// Value of the one metric for the pull API
+    ///
+    struct Sample
+    {
+        std::string m_name;   // With labels
+        std::string m_help;
+        Type m_type = Type::Counter;
+        int64_t m_value = 0;  // Counter and gauge
+        Histogram::Snapshot m_histogram;
+    };
+
+    ///
+    /// \brief Collect
+    /// \return Values of the all metrics sorted by the names
+    ///
+    std::vector<Sample> Collect() const
+    {
+        std::vector<Sample> samples;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        samples.reserve(m_entries.size());
+        for (const auto& it : m_entries)
+        {
+            Sample sample;
+            sample.m_name = it.first;
+            sample.m_help = it.second.m_help;
+            sample.m_type = it.second.m_type;
+            switch (it.second.m_type)
+            {
+            case Type::Counter:
+                sample.m_value = static_cast<int64_t>(it.second.m_counter->Value());
+                break;
+            case Type::Gauge:
+                sample.m_value = it.second.m_gauge->Value();
+                break;
+            case Type::Histogram:
+                sample.m_histogram = it.second.m_histogram->Collect();
+                break;
+            }
+            samples.emplace_back(std::move(sample));
+        }
+        return samples;
+    }
+
+    ///
+    /// \brief PrometheusText
+    /// \return The metrics in the Prometheus text exposition format
+    ///
+    std::string PrometheusText() const
+    {
+        std::ostringstream out;
+        std::string prevFamily;
+        for (const auto& sample : Collect())
+        {
+            std::string family;
+            std::string labels;
+            SplitName(sample.m_name, family, labels);
+            if (family != prevFamily)
+            {
+                if (!sample.m_help.empty())
+                    out << "# HELP " << family << " " << sample.m_help << "\n";
+                out << "# TYPE " << family << " " << (sample.m_type == Type::Counter ? "counter" : (sample.m_type == Type::Gauge ? "gauge" : "histogram")) << "\n";
+                prevFamily = family;
+            }
+            if (sample.m_type != Type::Histogram)
+            {
+                out << sample.m_name << " " << sample.m_value << "\n";
+                continue;
+            }
+            const std::string sep = labels.empty() ? "" : ",";
+            uint64_t cumulative = 0;
+            for (size_t i = 0; i < Histogram::BucketsCount; ++i)
+            {
+                cumulative += sample.m_histogram.m_buckets[i];
+                char bound[32];
+                snprintf(bound, sizeof(bound), "%g", Histogram::UpperBound(i) / 1e9);
+                out << family << "_bucket{" << labels << sep << "le=\"" << bound << "\"} " << cumulative << "\n";
+            }
+            out << family << "_bucket{" << labels << sep << "le=\"+Inf\"} " << sample.m_histogram.m_count << "\n";
+            const std::string braces = labels.empty() ? "" : ("{" + labels + "}");
+            out << family << "_sum" << braces << " " << (sample.m_histogram.m_sumNs / 1e9) << "\n";
+            out << family << "_count" << braces << " " << sample.m_histogram.m_count << "\n";
+        }
+        return out.str();
+    }
+
+private:
+    struct Entry
+    {
+        Type m_type = Type::Counter;
+        std::string m_help;
+        std::unique_ptr<Counter> m_counter;
+        std::unique_ptr<Gauge> m_gauge;
+        std::unique_ptr<Histogram> m_histogram;
+    };
+    std::map<std::string, Entry> m_entries;
+    mutable std::mutex m_mutex;
+
+    Registry() = default;
+    Registry(const Registry&) = delete;
+    Registry& operator=(const Registry&) = delete;
+
+    ///
+    /// \brief GetEntry
+    /// The metric with the same name and other type is an error of the caller: the existing is returned with the new instance of the type
+    ///
+    Entry& GetEntry(const std::string& name, const std::string& help, Type type)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Entry& entry = m_entries[name];
+        if (!entry.m_counter && !entry.m_gauge && !entry.m_histogram)
+        {
+            entry.m_type = type;
+            entry.m_help = help;
+        }
+        switch (type)
+        {
+        case Type::Counter:
+            if (!entry.m_counter)
+                entry.m_counter = std::make_unique<Counter>();
+            break;
+        case Type::Gauge:
+            if (!entry.m_gauge)
+                entry.m_gauge = std::make_unique<Gauge>();
+            break;
+        case Type::Histogram:
+            if (!entry.m_histogram)
+                entry.m_histogram = std::make_unique<Histogram>();
+            break;
+        }
+        return entry;
+    }
+
+    ///
+    /// \brief SplitName
+    /// \param name - family{labels}
+    ///
+    static void SplitName(const std::string& name, std::string& family, std::string& labels)
+    {
+        const size_t brace = name.find('{');
+        if (brace == std::string::npos)
+        {
+            family = name;
+            labels.clear();
+        }
+        else
+        {
+            family = name.substr(0, brace);
+            const size_t end = name.rfind('}');
+            labels = name.substr(brace + 1, (end != std::string::npos && end > brace) ? (end - brace - 1) : std::string::npos);
+        }
+    }
+};
+
+///
+/// \brief The TextFileExporter class
+/// Periodically writes the PrometheusText of the registry to the file for the textfile collector of the node_exporter.
+/// The file is replaced atomically by the rename of the temporary file
+///
+class TextFileExporter
+{
+public:
+    ///
+    /// \brief TextFileExporter
+    /// \param fileName - *.prom in the directory of the --collector.textfile.directory
+    /// \param period
+    ///
+    TextFileExporter(const std::string& fileName, std::chrono::milliseconds period)
+        : m_fileName(fileName), m_period(period)
+    {
+        m_thread = std::thread(&TextFileExporter::Worker, this);
+    }
+    TextFileExporter(const TextFileExporter&) = delete;
+    TextFileExporter& operator=(const TextFileExporter&) = delete;
+
+    ~TextFileExporter()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_cond.notify_all();
+        if (m_thread.joinable())
+            m_thread.join();
+        Write();
+    }
+
+    ///
+    /// \brief Write
+    /// \return
+    ///
+    bool Write() const
+    {
+        const std::string tmpName = m_fileName + ".tmp";
+        {
+            std::ofstream file(tmpName, std::ios::trunc);
+            if (!file.is_open())
+                return false;
+            file << Registry::Instance().PrometheusText();
+        }
+        std::remove(m_fileName.c_str());
+        return std::rename(tmpName.c_str(), m_fileName.c_str()) == 0;
+    }
+
+private:
+    std::string m_fileName;
+    std::chrono::milliseconds m_period;
+    bool m_stop = false;
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    std::thread m_thread;
+
+    void Worker()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (!m_cond.wait_for(lock, m_period, [this]() { return m_stop; }))
+        {
+            lock.unlock();
+            if (!Write())
+                std::cerr << "metrics: can't write " << m_fileName << std::endl;
+            lock.lock();
+        }
+    }
+};
+}
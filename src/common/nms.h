@@ -1,6 +1,169 @@
 #pragma once
 #include <opencv2/opencv.hpp>
 #include <assert.h>
+#include <algorithm>
+#include <numeric>
+#include <cstdint>
+#include <cmath>
+#include <cfloat>
+#include "defines.h"
+
+namespace nms_detail
+{
+    ///
+    /// \brief The Boxes struct
+    /// Coordinates of the rects in SoA layout in the order of the descending keys
+    ///
+    struct Boxes
+    {
+        std::vector<size_t> m_inds; // Indexes in the source vector
+        std::vector<float> m_keys;
+        std::vector<float> m_x1;
+        std::vector<float> m_y1;
+        std::vector<float> m_x2;
+        std::vector<float> m_y2;
+        std::vector<float> m_area;
+        std::vector<int> m_types;   // Is empty for the class agnostic NMS
+
+        ///
+        /// \brief Init
+        /// The equal keys keep the order of the multimap based NMS: the last index first
+        ///
+        template<typename GET_RECT_FUNC, typename GET_KEY_FUNC>
+        void Init(size_t size, GET_RECT_FUNC GetRect, GET_KEY_FUNC GetKey)
+        {
+            std::vector<float> keys(size);
+            for (size_t i = 0; i < size; ++i)
+            {
+                keys[i] = static_cast<float>(GetKey(i));
+            }
+            m_inds.resize(size);
+            std::iota(std::begin(m_inds), std::end(m_inds), 0);
+            std::sort(std::begin(m_inds), std::end(m_inds), [&keys](size_t i1, size_t i2)
+            {
+                return (keys[i1] > keys[i2]) || (keys[i1] == keys[i2] && i1 > i2);
+            });
+
+            m_keys.resize(size);
+            m_x1.resize(size);
+            m_y1.resize(size);
+            m_x2.resize(size);
+            m_y2.resize(size);
+            m_area.resize(size);
+            for (size_t i = 0; i < size; ++i)
+            {
+                const cv::Rect& r = GetRect(m_inds[i]);
+                m_keys[i] = keys[m_inds[i]];
+                m_x1[i] = static_cast<float>(r.x);
+                m_y1[i] = static_cast<float>(r.y);
+                m_x2[i] = static_cast<float>(r.x + r.width);
+                m_y2[i] = static_cast<float>(r.y + r.height);
+                m_area[i] = static_cast<float>(r.area());
+            }
+        }
+
+        ///
+        /// \brief InitTypes
+        ///
+        template<typename GET_TYPE_FUNC>
+        void InitTypes(GET_TYPE_FUNC GetType)
+        {
+            m_types.resize(m_inds.size());
+            for (size_t i = 0; i < m_inds.size(); ++i)
+            {
+                m_types[i] = static_cast<int>(GetType(m_inds[i]));
+            }
+        }
+
+        size_t size() const
+        {
+            return m_inds.size();
+        }
+    };
+
+    // Overlaps are calculated by the blocks which stay in L1 cache
+    constexpr size_t OverlapsBlock = 256;
+
+    ///
+    /// \brief Overlaps
+    /// IoU of the box i with the boxes [from, to), the boxes of the other types get -1.
+    /// The loop is branch free for the vectorization
+    ///
+    inline void Overlaps(const Boxes& boxes, size_t i, size_t from, size_t to, float* overlaps)
+    {
+        const float ax1 = boxes.m_x1[i];
+        const float ay1 = boxes.m_y1[i];
+        const float ax2 = boxes.m_x2[i];
+        const float ay2 = boxes.m_y2[i];
+        const float aarea = boxes.m_area[i];
+        const float* x1 = boxes.m_x1.data() + from;
+        const float* y1 = boxes.m_y1.data() + from;
+        const float* x2 = boxes.m_x2.data() + from;
+        const float* y2 = boxes.m_y2.data() + from;
+        const float* area = boxes.m_area.data() + from;
+        const int count = static_cast<int>(to - from);
+
+#pragma omp simd
+        for (int j = 0; j < count; ++j)
+        {
+            const float w = std::max(0.f, std::min(ax2, x2[j]) - std::max(ax1, x1[j]));
+            const float h = std::max(0.f, std::min(ay2, y2[j]) - std::max(ay1, y1[j]));
+            const float intArea = w * h;
+            overlaps[j] = intArea / std::max(aarea + area[j] - intArea, FLT_MIN);
+        }
+        if (!boxes.m_types.empty())
+        {
+            const int type = boxes.m_types[i];
+            const int* types = boxes.m_types.data() + from;
+#pragma omp simd
+            for (int j = 0; j < count; ++j)
+            {
+                overlaps[j] = (types[j] == type) ? overlaps[j] : -1.f;
+            }
+        }
+    }
+
+    ///
+    /// \brief Suppress
+    /// Greedy NMS over the sorted boxes with the suppression bitmask
+    /// \param Keep - is called for the every not suppressed box: Keep(sourceIndex, neighborsCount, scoresSum)
+    ///
+    template<typename KEEP_FUNC>
+    void Suppress(const Boxes& boxes, float thresh, KEEP_FUNC Keep)
+    {
+        const size_t size = boxes.size();
+        std::vector<uint64_t> suppressed((size + 63) / 64, 0);
+        float overlaps[OverlapsBlock];
+
+        auto IsSuppressed = [&suppressed](size_t ind) { return (suppressed[ind / 64] >> (ind % 64)) & 1; };
+
+        for (size_t i = 0; i < size; ++i)
+        {
+            if (IsSuppressed(i))
+                continue;
+
+            int neigborsCount = 0;
+            float scoresSum = boxes.m_keys[i];
+
+            for (size_t from = i + 1; from < size; from += OverlapsBlock)
+            {
+                const size_t to = std::min(size, from + OverlapsBlock);
+                Overlaps(boxes, i, from, to, overlaps);
+                for (size_t j = from; j < to; ++j)
+                {
+                    // if there is sufficient overlap, suppress the current bounding box
+                    if (overlaps[j - from] > thresh && !IsSuppressed(j))
+                    {
+                        suppressed[j / 64] |= uint64_t(1) << (j % 64);
+                        scoresSum += boxes.m_keys[j];
+                        ++neigborsCount;
+                    }
+                }
+            }
+            Keep(boxes.m_inds[i], neigborsCount, scoresSum);
+        }
+    }
+}
 
 /**
  * @brief nms
@@ -22,46 +185,16 @@ inline void nms(const std::vector<cv::Rect>& srcRects,
         return;
 
     // Sort the bounding boxes by the bottom - right y - coordinate of the bounding box
-    std::multimap<int, size_t> idxs;
-    for (size_t i = 0; i < size; ++i)
-    {
-        idxs.emplace(srcRects[i].br().y, i);
-    }
+    nms_detail::Boxes boxes;
+    boxes.Init(size,
+               [&srcRects](size_t i) -> const cv::Rect& { return srcRects[i]; },
+               [&srcRects](size_t i) { return srcRects[i].br().y; });
 
-    // keep looping while some indexes still remain in the indexes list
-    while (idxs.size() > 0)
+    nms_detail::Suppress(boxes, thresh, [&](size_t ind, int neigborsCount, float /*scoresSum*/)
     {
-        // grab the last rectangle
-        auto lastElem = --std::end(idxs);
-        const cv::Rect& rect1 = srcRects[lastElem->second];
-
-        int neigborsCount = 0;
-
-        idxs.erase(lastElem);
-
-        for (auto pos = std::begin(idxs); pos != std::end(idxs); )
-        {
-            // grab the current rectangle
-            const cv::Rect& rect2 = srcRects[pos->second];
-
-			float intArea = static_cast<float>((rect1 & rect2).area());
-			float unionArea = static_cast<float>(rect1.area() + rect2.area() - intArea);
-            float overlap = intArea / unionArea;
-
-            // if there is sufficient overlap, suppress the current bounding box
-            if (overlap > thresh)
-            {
-                pos = idxs.erase(pos);
-                ++neigborsCount;
-            }
-            else
-            {
-                ++pos;
-            }
-        }
         if (neigborsCount >= neighbors)
-            resRects.push_back(rect1);
-    }
+            resRects.push_back(srcRects[ind]);
+    });
 }
 
 /**
@@ -89,48 +222,16 @@ inline void nms2(const std::vector<cv::Rect>& srcRects,
     assert(srcRects.size() == scores.size());
 
     // Sort the bounding boxes by the detection score
-    std::multimap<float, size_t> idxs;
-    for (size_t i = 0; i < size; ++i)
-    {
-        idxs.emplace(scores[i], i);
-    }
+    nms_detail::Boxes boxes;
+    boxes.Init(size,
+               [&srcRects](size_t i) -> const cv::Rect& { return srcRects[i]; },
+               [&scores](size_t i) { return scores[i]; });
 
-    // keep looping while some indexes still remain in the indexes list
-    while (idxs.size() > 0)
+    nms_detail::Suppress(boxes, thresh, [&](size_t ind, int neigborsCount, float scoresSum)
     {
-        // grab the last rectangle
-        auto lastElem = --std::end(idxs);
-        const cv::Rect& rect1 = srcRects[lastElem->second];
-
-        int neigborsCount = 0;
-        float scoresSum = lastElem->first;
-
-        idxs.erase(lastElem);
-
-        for (auto pos = std::begin(idxs); pos != std::end(idxs); )
-        {
-            // grab the current rectangle
-            const cv::Rect& rect2 = srcRects[pos->second];
-
-            float intArea = static_cast<float>((rect1 & rect2).area());
-            float unionArea = static_cast<float>(rect1.area() + rect2.area() - intArea);
-            float overlap = intArea / unionArea;
-
-            // if there is sufficient overlap, suppress the current bounding box
-            if (overlap > thresh)
-            {
-                scoresSum += pos->first;
-                pos = idxs.erase(pos);
-                ++neigborsCount;
-            }
-            else
-            {
-                ++pos;
-            }
-        }
         if (neigborsCount >= neighbors && scoresSum >= minScoresSum)
-            resRects.push_back(rect1);
-    }
+            resRects.push_back(srcRects[ind]);
+    });
 }
 
 
@@ -158,57 +259,115 @@ inline void nms3(const std::vector<OBJ>& srcRects,
     if (!size)
         return;
 
-    // Sort the bounding boxes by the detection score
-    std::multimap<float, size_t> idxs;
-    for (size_t i = 0; i < size; ++i)
+    // Sort the bounding boxes by the detection score, only the boxes of the same type suppress each other
+    nms_detail::Boxes boxes;
+    boxes.Init(size,
+               [&](size_t i) { return GetRect(srcRects[i]); },
+               [&](size_t i) { return GetScore(srcRects[i]); });
+    boxes.InitTypes([&](size_t i) { return GetType(srcRects[i]); });
+
+    nms_detail::Suppress(boxes, thresh, [&](size_t ind, int neigborsCount, float scoresSum)
     {
-        idxs.emplace(GetScore(srcRects[i]), i);
-    }
+        if (neigborsCount >= neighbors && scoresSum >= minScoresSum)
+            resRects.push_back(srcRects[ind]);
+    });
+}
 
-    // keep looping while some indexes still remain in the indexes list
-    while (idxs.size() > 0)
+/**
+ * @brief nms_regions
+ * The same as nms3 for the candidates in SoA layout, the regions are created only for the kept candidates
+ * @param srcRegions
+ * @param resRegions
+ * @param thresh
+ */
+inline void nms_regions(const RegionsSoA& srcRegions,
+                        regions_t& resRegions,
+                        float thresh)
+{
+    resRegions.clear();
+
+    const size_t size = srcRegions.size();
+    if (!size)
+        return;
+
+    nms_detail::Boxes boxes;
+    boxes.Init(size,
+               [&](size_t i) { return srcRegions.m_rects[i]; },
+               [&](size_t i) { return srcRegions.m_confidences[i]; });
+    boxes.InitTypes([&](size_t i) { return srcRegions.m_types[i]; });
+
+    nms_detail::Suppress(boxes, thresh, [&](size_t ind, int /*neigborsCount*/, float /*scoresSum*/)
     {
-        // grab the last rectangle
-        auto lastElem = --std::end(idxs);
-        size_t lastPos = lastElem->second;
-        const cv::Rect& rect1 = GetRect(srcRects[lastPos]);
-        auto type1 = GetType(srcRects[lastPos]);
+        resRegions.push_back(srcRegions.Region(ind));
+    });
+}
 
-        int neigborsCount = 0;
-        float scoresSum = lastElem->first;
+/**
+ * @brief soft_nms3
+ * Gaussian Soft-NMS: the overlapped boxes of the same type aren't removed but their scores decay as exp(-IoU^2 / sigma)
+ * @param srcRects
+ * @param resRects
+ * @param resScores - decayed scores of resRects
+ * @param sigma
+ * @param scoreThresh - boxes with the lower decayed score are removed
+ */
+template<typename OBJ, typename GET_RECT_FUNC, typename GET_SCORE_FUNC, typename GET_TYPE_FUNC>
+inline void soft_nms3(const std::vector<OBJ>& srcRects,
+                      std::vector<OBJ>& resRects,
+                      std::vector<float>& resScores,
+                      float sigma,
+                      float scoreThresh,
+                      GET_RECT_FUNC GetRect,
+                      GET_SCORE_FUNC GetScore,
+                      GET_TYPE_FUNC GetType)
+{
+    resRects.clear();
+    resScores.clear();
 
-        idxs.erase(lastElem);
+    const size_t size = srcRects.size();
+    if (!size)
+        return;
 
-        for (auto pos = std::begin(idxs); pos != std::end(idxs); )
-        {
-            // grab the current rectangle
-            auto type2 = GetType(srcRects[pos->second]);
-            if (type1 == type2)
-            {
-                const cv::Rect& rect2 = GetRect(srcRects[pos->second]);
+    nms_detail::Boxes boxes;
+    boxes.Init(size,
+               [&](size_t i) { return GetRect(srcRects[i]); },
+               [&](size_t i) { return GetScore(srcRects[i]); });
+    boxes.InitTypes([&](size_t i) { return GetType(srcRects[i]); });
 
-                float intArea = static_cast<float>((rect1 & rect2).area());
-                float unionArea = static_cast<float>(rect1.area() + rect2.area() - intArea);
-                float overlap = intArea / unionArea;
+    // Removed and kept boxes get the negative scores
+    std::vector<float> scores(boxes.m_keys);
+    for (auto& score : scores)
+    {
+        if (score < scoreThresh)
+            score = -1.f;
+    }
+    float overlaps[nms_detail::OverlapsBlock];
+    const float invSigma = 1.f / std::max(sigma, FLT_MIN);
 
-                // if there is sufficient overlap, suppress the current bounding box
-                if (overlap > thresh)
-                {
-                    scoresSum += pos->first;
-                    pos = idxs.erase(pos);
-                    ++neigborsCount;
-                }
-                else
+    for (;;)
+    {
+        auto maxIt = std::max_element(std::begin(scores), std::end(scores));
+        if (*maxIt < 0.f)
+            break;
+        const size_t i = static_cast<size_t>(std::distance(std::begin(scores), maxIt));
+        resRects.push_back(srcRects[boxes.m_inds[i]]);
+        resScores.push_back(*maxIt);
+        *maxIt = -1.f;
+
+        for (size_t from = 0; from < size; from += nms_detail::OverlapsBlock)
+        {
+            const size_t to = std::min(size, from + nms_detail::OverlapsBlock);
+            nms_detail::Overlaps(boxes, i, from, to, overlaps);
+            for (size_t j = from; j < to; ++j)
+            {
+                const float overlap = overlaps[j - from];
+                if (overlap > 0.f && scores[j] >= 0.f)
                 {
-                    ++pos;
+                    scores[j] *= std::exp(-overlap * overlap * invSigma);
+                    if (scores[j] < scoreThresh)
+                        scores[j] = -1.f;
                 }
             }
-            else
-            {
-                ++pos;
-            }
         }
-        if (neigborsCount >= neighbors && scoresSum >= minScoresSum)
-            resRects.push_back(srcRects[lastPos]);
     }
 }
@@ -1,88 +1,87 @@
 #include "object_types.h"
 
-std::vector<std::string> TypeConverter::m_typeNames =
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+std::string TypeConverter::m_badTypeName = "unknown";
+
+namespace
+{
+///
+/// \brief The InternedTypes struct
+/// Ids of all the known names and the names of the types outside of ObjectTypes in the order of the registration
+///
+struct InternedTypes
 {
-	"person",
-"bicycle",
-"car",
-"motorbike",
-"aeroplane",
-"bus",
-"train",
-"truck",
-"boat",
-"traffic_light",
-"fire_hydrant",
-"stop_sign",
-"parking_meter",
-"bench",
-"bird",
-"cat",
-"dog",
-"horse",
-"sheep",
-"cow",
-"elephant",
-"bear",
-"zebra",
-"giraffe",
-"backpack",
-"umbrella",
-"handbag",
-"tie",
-"suitcase",
-"frisbee",
-"skis",
-"snowboard",
-"sports_ball",
-"kite",
-"baseball_bat",
-"baseball_glove",
-"skateboard",
-"surfboard",
-"tennis_racket",
-"bottle",
-"wine_glass",
-"cup",
-"fork",
-"knife",
-"spoon",
-"bowl",
-"banana",
-"apple",
-"sandwich",
-"orange",
-"broccoli",
-"carrot",
-"hot_dog",
-"pizza",
-"donut",
-"cake",
-"chair",
-"sofa",
-"pottedplant",
-"bed",
-"diningtable",
-"toilet",
-"tvmonitor",
-"laptop",
-"mouse",
-"remote",
-"keyboard",
-"cell_phone",
-"microwave",
-"oven",
-"toaster",
-"sink",
-"refrigerator",
-"book",
-"clock",
-"vase",
-"scissors",
-"teddy_bear",
-"hair_drier",
-"toothbrush",
-"vehicle"
+	InternedTypes()
+	{
+		constexpr objtype_t builtinCount = static_cast<objtype_t>(ObjectTypes::TypesCount);
+		m_ids.reserve(2 * builtinCount);
+		for (objtype_t type = 0; type < builtinCount; ++type)
+		{
+			m_ids.emplace(TypeConverter::Type2Str(type), type);
+		}
+	}
+
+	std::shared_mutex m_mutex;
+	std::vector<std::string> m_names;
+	std::unordered_map<std::string, objtype_t> m_ids;
 };
 
-std::string TypeConverter::m_badTypeName = "unknown";
+///
+/// \brief GetInternedTypes
+/// Function local static: Str2Type can be called from the static initializers of the other translation units
+///
+InternedTypes& GetInternedTypes()
+{
+	static InternedTypes internedTypes;
+	return internedTypes;
+}
+
+constexpr objtype_t BuiltinTypesCount = static_cast<objtype_t>(ObjectTypes::TypesCount);
+}
+
+///
+/// \brief TypeConverter::Type2Str
+/// \param type
+/// \return
+///
+std::string TypeConverter::Type2Str(objtype_t type)
+{
+	if (type >= 0 && type < BuiltinTypesCount)
+		return std::string(m_builtinNames[static_cast<size_t>(type)]);
+
+	if (type >= BuiltinTypesCount)
+	{
+		InternedTypes& interned = GetInternedTypes();
+		std::shared_lock<std::shared_mutex> lock(interned.m_mutex);
+		const size_t ind = static_cast<size_t>(type - BuiltinTypesCount);
+		if (ind < interned.m_names.size())
+			return interned.m_names[ind];
+	}
+	return m_badTypeName;
+}
+
+///
+/// \brief TypeConverter::Str2Type
+/// \param str
+/// \return
+///
+objtype_t TypeConverter::Str2Type(const std::string& str)
+{
+	InternedTypes& interned = GetInternedTypes();
+	{
+		std::shared_lock<std::shared_mutex> lock(interned.m_mutex);
+		auto it = interned.m_ids.find(str);
+		if (it != std::end(interned.m_ids))
+			return it->second;
+	}
+
+	// The name could be added by the other thread between the locks
+	std::unique_lock<std::shared_mutex> lock(interned.m_mutex);
+	auto it = interned.m_ids.emplace(str, BuiltinTypesCount + static_cast<objtype_t>(interned.m_names.size()));
+	if (it.second)
+		interned.m_names.emplace_back(str);
+	return it.first->second;
+}
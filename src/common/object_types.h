@@ -1,6 +1,8 @@
 #pragma once
+#include <array>
 #include <string>
 #include <vector>
+#include <string_view>
 
 ///
 enum class ObjectTypes
@@ -92,29 +94,53 @@ enum class ObjectTypes
 typedef int objtype_t;
 constexpr objtype_t bad_type = -1;
 
+///
+/// \brief The TypeConverter class
+/// Names of the types: the types of ObjectTypes are resolved at compile time, the other names are interned at run time.
+/// Str2Type and Type2Str can be called from the different threads, the interned ids don't change
 ///
 class TypeConverter
 {
 public:
 	///
-	static std::string Type2Str(objtype_t type)
-	{
-		return (type == bad_type) ? m_badTypeName : m_typeNames[type];
-	}
+	static std::string Type2Str(objtype_t type);
 
 	///
-	static objtype_t Str2Type(const std::string& str)
+	static objtype_t Str2Type(const std::string& str);
+
+	///
+	/// \brief BuiltinType
+	/// Compile time lookup of the ObjectTypes names: constexpr objtype_t carType = TypeConverter::BuiltinType("car");
+	/// \return bad_type for the names outside of ObjectTypes
+	///
+	static constexpr objtype_t BuiltinType(std::string_view str)
 	{
-		for (size_t i = 0; i < m_typeNames.size(); ++i)
+		for (size_t i = 0; i < m_builtinNames.size(); ++i)
 		{
-			if (str == m_typeNames[i])
+			if (str == m_builtinNames[i])
 				return static_cast<objtype_t>(i);
 		}
-        m_typeNames.emplace_back(str);
-		return static_cast<objtype_t>(m_typeNames.size()) - 1;
+		return bad_type;
+	}
+
+	///
+	static constexpr objtype_t ToType(ObjectTypes type)
+	{
+		return static_cast<objtype_t>(type);
 	}
 
 private:
-	static std::vector<std::string> m_typeNames;
+	static constexpr std::array<std::string_view, static_cast<size_t>(ObjectTypes::TypesCount)> m_builtinNames =
+	{
+		"person", "bicycle", "car", "motorbike", "aeroplane", "bus", "train", "truck", "boat", "traffic_light",
+		"fire_hydrant", "stop_sign", "parking_meter", "bench", "bird", "cat", "dog", "horse", "sheep", "cow",
+		"elephant", "bear", "zebra", "giraffe", "backpack", "umbrella", "handbag", "tie", "suitcase", "frisbee",
+		"skis", "snowboard", "sports_ball", "kite", "baseball_bat", "baseball_glove", "skateboard", "surfboard",
+		"tennis_racket", "bottle", "wine_glass", "cup", "fork", "knife", "spoon", "bowl", "banana", "apple",
+		"sandwich", "orange", "broccoli", "carrot", "hot_dog", "pizza", "donut", "cake", "chair", "sofa",
+		"pottedplant", "bed", "diningtable", "toilet", "tvmonitor", "laptop", "mouse", "remote", "keyboard",
+		"cell_phone", "microwave", "oven", "toaster", "sink", "refrigerator", "book", "clock", "vase", "scissors",
+		"teddy_bear", "hair_drier", "toothbrush", "vehicle"
+	};
 	static std::string m_badTypeName;
 };
@@ -0,0 +1,110 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include <opencv2/opencv.hpp>
+
+///
+/// \brief The RecyclingPool class
+/// Pool of the reusable objects with the large buffers (frames): Get returns the refcounted handle and the object
+/// goes back to the pool when the last copy of the handle is released. The buffers of the returned objects stay
+/// allocated, so the next user (capture) writes into the same memory. The handles may outlive the pool
+///
+template<typename T>
+class RecyclingPool
+{
+public:
+    ///
+    /// \brief RecyclingPool
+    /// \param maxFree - max count of the objects waiting in the pool, the others are deleted
+    /// \param recycle - prepares the returned object for the reuse, false if it can't be reused (its buffers are still shared)
+    ///
+    explicit RecyclingPool(size_t maxFree, std::function<bool(T&)> recycle = nullptr)
+        : m_state(std::make_shared<State>())
+    {
+        m_state->m_maxFree = maxFree;
+        m_state->m_recycle = std::move(recycle);
+    }
+
+    ///
+    /// \brief Get
+    /// \param create - creates the new object if the pool is empty
+    /// \return
+    ///
+    template<typename CREATE_FUNC>
+    std::shared_ptr<T> Get(CREATE_FUNC create)
+    {
+        std::unique_ptr<T> obj;
+        {
+            std::lock_guard<std::mutex> lock(m_state->m_mutex);
+            if (!m_state->m_free.empty())
+            {
+                obj = std::move(m_state->m_free.back());
+                m_state->m_free.pop_back();
+                ++m_state->m_reused;
+            }
+            else
+            {
+                ++m_state->m_created;
+            }
+        }
+        if (!obj)
+            obj = create();
+
+        std::weak_ptr<State> weakState = m_state;
+        return std::shared_ptr<T>(obj.release(), [weakState](T* ptr)
+        {
+            std::unique_ptr<T> returned(ptr);
+            if (auto state = weakState.lock())
+                state->Return(std::move(returned));
+        });
+    }
+
+    ///
+    /// \brief CreatedCount
+    /// \return Count of the objects created by the pool, the rest of Get calls reused them
+    ///
+    size_t CreatedCount() const
+    {
+        std::lock_guard<std::mutex> lock(m_state->m_mutex);
+        return m_state->m_created;
+    }
+    ///
+    size_t ReusedCount() const
+    {
+        std::lock_guard<std::mutex> lock(m_state->m_mutex);
+        return m_state->m_reused;
+    }
+
+    ///
+    /// \brief IsExclusive
+    /// \param mat
+    /// \return true if nobody else shares the data of the matrix and it can be overwritten
+    ///
+    static bool IsExclusive(const cv::Mat& mat)
+    {
+        return !mat.u || mat.u->refcount == 1;
+    }
+
+private:
+    struct State
+    {
+        size_t m_maxFree = 0;
+        std::function<bool(T&)> m_recycle;
+        std::vector<std::unique_ptr<T>> m_free;
+        size_t m_created = 0;
+        size_t m_reused = 0;
+        mutable std::mutex m_mutex;
+
+        void Return(std::unique_ptr<T>&& obj)
+        {
+            if (m_recycle && !m_recycle(*obj))
+                return;
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_free.size() < m_maxFree)
+                m_free.emplace_back(std::move(obj));
+        }
+    };
+    std::shared_ptr<State> m_state;
+};
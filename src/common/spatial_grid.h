@@ -0,0 +1,311 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <opencv2/opencv.hpp>
+
+///
+/// \brief The GridGeometry class
+/// Cells of the uniform grid over the area, the points outside of the area are clamped to the nearest cell
+///
+class GridGeometry
+{
+public:
+    ///
+    /// \brief SetGeometry
+    /// \param area
+    /// \param cellSize - size of the one cell in pixels
+    /// \return Count of the cells
+    ///
+    size_t SetGeometry(cv::Size area, int cellSize)
+    {
+        m_cellSize = std::max(1, cellSize);
+        m_cols = std::max(1, (area.width + m_cellSize - 1) / m_cellSize);
+        m_rows = std::max(1, (area.height + m_cellSize - 1) / m_cellSize);
+        return static_cast<size_t>(m_cols) * static_cast<size_t>(m_rows);
+    }
+
+protected:
+    int m_cellSize = 1;
+    int m_cols = 1;
+    int m_rows = 1;
+
+    ///
+    int CellX(float x) const
+    {
+        return std::clamp(static_cast<int>(x) / m_cellSize, 0, m_cols - 1);
+    }
+    ///
+    int CellY(float y) const
+    {
+        return std::clamp(static_cast<int>(y) / m_cellSize, 0, m_rows - 1);
+    }
+    ///
+    size_t CellIndex(int x, int y) const
+    {
+        return static_cast<size_t>(y) * static_cast<size_t>(m_cols) + static_cast<size_t>(x);
+    }
+    ///
+    size_t PointCell(const cv::Point2f& pt) const
+    {
+        return CellIndex(CellX(pt.x), CellY(pt.y));
+    }
+    ///
+    static bool Inside(const cv::Point2f& pt, const cv::Rect2f& area)
+    {
+        return pt.x >= area.x && pt.x <= area.x + area.width &&
+               pt.y >= area.y && pt.y <= area.y + area.height;
+    }
+};
+
+///
+/// \brief The SpatialGrid class
+/// Uniform grid index over the points. It rebuilds from scratch on each frame,
+/// all internal buffers are reused between the frames
+///
+class SpatialGrid : public GridGeometry
+{
+public:
+    SpatialGrid() = default;
+
+    ///
+    /// \brief Build
+    /// \param objects - container with objects
+    /// \param area - size of the indexed area, points outside of the area are clamped to the nearest cell
+    /// \param cellSize - size of the one cell in pixels
+    /// \param GetPoint - functor that returns cv::Point2f of the object
+    ///
+    template<typename CONT, typename GET_POINT_FUNC>
+    void Build(const CONT& objects, cv::Size area, int cellSize, GET_POINT_FUNC GetPoint)
+    {
+        const size_t cellsCount = SetGeometry(area, cellSize);
+
+        m_points.resize(objects.size());
+        m_pointCells.resize(objects.size());
+        m_cellsStart.assign(cellsCount + 1, 0);
+
+        // Counting sort of the points by cells
+        for (size_t i = 0; i < objects.size(); ++i)
+        {
+            m_points[i] = GetPoint(objects[i]);
+            m_pointCells[i] = PointCell(m_points[i]);
+            ++m_cellsStart[m_pointCells[i] + 1];
+        }
+        for (size_t i = 1; i < m_cellsStart.size(); ++i)
+        {
+            m_cellsStart[i] += m_cellsStart[i - 1];
+        }
+        m_items.resize(objects.size());
+        m_fillPos.assign(std::begin(m_cellsStart), std::end(m_cellsStart) - 1);
+        for (size_t i = 0; i < objects.size(); ++i)
+        {
+            m_items[m_fillPos[m_pointCells[i]]++] = i;
+        }
+    }
+
+    ///
+    /// \brief Query
+    /// Call func(index) for all points that are inside the area
+    /// \param area
+    /// \param func
+    ///
+    template<typename FUNC>
+    void Query(const cv::Rect2f& area, FUNC func) const
+    {
+        if (m_items.empty())
+            return;
+
+        const int x0 = CellX(area.x);
+        const int x1 = CellX(area.x + area.width);
+        const int y0 = CellY(area.y);
+        const int y1 = CellY(area.y + area.height);
+
+        for (int y = y0; y <= y1; ++y)
+        {
+            for (int x = x0; x <= x1; ++x)
+            {
+                const size_t cell = CellIndex(x, y);
+                for (size_t i = m_cellsStart[cell]; i < m_cellsStart[cell + 1]; ++i)
+                {
+                    const size_t ind = m_items[i];
+                    if (Inside(m_points[ind], area))
+                        func(ind);
+                }
+            }
+        }
+    }
+
+    ///
+    /// \brief Size
+    /// \return
+    ///
+    size_t Size() const
+    {
+        return m_items.size();
+    }
+
+private:
+    std::vector<cv::Point2f> m_points;
+    std::vector<size_t> m_pointCells;
+    std::vector<size_t> m_cellsStart;
+    std::vector<size_t> m_fillPos;
+    std::vector<size_t> m_items;
+};
+
+///
+/// \brief The DynamicSpatialGrid class
+/// Uniform grid index over the moving objects with the keys: the object is moved to the other cell only when its point
+/// leaves the cell, so the update of the slow objects is the lookup of the key
+///
+template<typename KEY, typename VALUE>
+class DynamicSpatialGrid : public GridGeometry
+{
+public:
+    DynamicSpatialGrid() = default;
+
+    ///
+    /// \brief Reset
+    /// The objects are removed
+    /// \param area
+    /// \param cellSize
+    ///
+    void Reset(cv::Size area, int cellSize)
+    {
+        m_area = area;
+        m_cells.resize(SetGeometry(area, cellSize));
+        Clear();
+    }
+
+    ///
+    /// \brief Area
+    /// \return Of the last Reset
+    ///
+    cv::Size Area() const
+    {
+        return m_area;
+    }
+
+    ///
+    /// \brief Clear
+    ///
+    void Clear()
+    {
+        for (auto& cell : m_cells)
+        {
+            cell.clear();
+        }
+        m_positions.clear();
+    }
+
+    ///
+    /// \brief Update
+    /// Inserts the new object or moves the indexed one
+    /// \param key
+    /// \param pt
+    /// \param value
+    ///
+    void Update(const KEY& key, const cv::Point2f& pt, const VALUE& value)
+    {
+        if (m_cells.empty())
+            return;
+
+        const size_t cell = PointCell(pt);
+        auto it = m_positions.find(key);
+        if (it != std::end(m_positions))
+        {
+            if (it->second.first == cell)
+            {
+                Item& item = m_cells[cell][it->second.second];
+                item.m_pt = pt;
+                item.m_value = value;
+                return;
+            }
+            Erase(it->second);
+            it->second = std::make_pair(cell, m_cells[cell].size());
+        }
+        else
+        {
+            m_positions.emplace(key, std::make_pair(cell, m_cells[cell].size()));
+        }
+        m_cells[cell].push_back(Item{ key, pt, value });
+    }
+
+    ///
+    /// \brief Remove
+    /// \param key
+    ///
+    void Remove(const KEY& key)
+    {
+        auto it = m_positions.find(key);
+        if (it == std::end(m_positions))
+            return;
+        Erase(it->second);
+        m_positions.erase(it);
+    }
+
+    ///
+    /// \brief Query
+    /// Call func(key, value, point) for all objects that are inside the area
+    /// \param area
+    /// \param func
+    ///
+    template<typename FUNC>
+    void Query(const cv::Rect2f& area, FUNC func) const
+    {
+        if (m_positions.empty())
+            return;
+
+        const int x0 = CellX(area.x);
+        const int x1 = CellX(area.x + area.width);
+        const int y0 = CellY(area.y);
+        const int y1 = CellY(area.y + area.height);
+
+        for (int y = y0; y <= y1; ++y)
+        {
+            for (int x = x0; x <= x1; ++x)
+            {
+                for (const auto& item : m_cells[CellIndex(x, y)])
+                {
+                    if (Inside(item.m_pt, area))
+                        func(item.m_key, item.m_value, item.m_pt);
+                }
+            }
+        }
+    }
+
+    ///
+    /// \brief Size
+    /// \return
+    ///
+    size_t Size() const
+    {
+        return m_positions.size();
+    }
+
+private:
+    ///
+    struct Item
+    {
+        KEY m_key;
+        cv::Point2f m_pt;
+        VALUE m_value;
+    };
+    cv::Size m_area;
+    std::vector<std::vector<Item>> m_cells;
+    std::unordered_map<KEY, std::pair<size_t, size_t>> m_positions; // Key -> cell and the index in the cell
+
+    ///
+    /// \brief Erase
+    /// The last object of the cell takes the place of the erased
+    ///
+    void Erase(const std::pair<size_t, size_t>& pos)
+    {
+        auto& cell = m_cells[pos.first];
+        if (pos.second + 1 != cell.size())
+        {
+            cell[pos.second] = std::move(cell.back());
+            m_positions[cell[pos.second].m_key].second = pos.second;
+        }
+        cell.pop_back();
+    }
+};
@@ -0,0 +1,404 @@
+#pragma once
+#include <mutex>
+#include <deque>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <exception>
+#include <type_traits>
+#include <condition_variable>
+
+#include <opencv2/core.hpp>
+
+#if (((CV_VERSION_MAJOR == 4) && ((CV_VERSION_MINOR > 5) || ((CV_VERSION_MINOR == 5) && (CV_VERSION_REVISION >= 2)))) || (CV_VERSION_MAJOR > 4))
+#include <opencv2/core/parallel/parallel_backend.hpp>
+#define MTRACKER_OCV_PARALLEL_BACKEND 1
+#endif
+
+///
+/// One work-stealing pool of the threads for the all parallel loops of the library (trackers, detectors,
+/// background subtractors) and, with InstallOpenCVBackend, for cv::parallel_for_ of OpenCV:
+///
+///     tasks::ParallelFor(0, rows, [&](int y) { ... });
+///     tasks::ParallelForRange(0, rows, [&](int from, int to) { scratch buffer; for (int y = from; y < to; ++y) ... });
+///
+/// The loops of the many streams share the same threads, so the cores aren't oversubscribed. The nested loops are
+/// allowed: the thread that waits for its loop runs the chunks of the other loops. The thread that calls the loop
+/// runs the chunks too, so the loop of the single threaded scheduler is the serial loop
+///
+namespace tasks
+{
+///
+/// \brief The Scheduler class
+///
+class Scheduler
+{
+public:
+    ///
+    static Scheduler& Instance()
+    {
+        static Scheduler scheduler;
+        return scheduler;
+    }
+
+    ///
+    /// \brief SetThreadsCount
+    /// Restarts the workers, it's called before the processing
+    /// \param threads - count of the threads with the calling one, 0 - hardware concurrency
+    ///
+    void SetThreadsCount(size_t threads)
+    {
+        std::lock_guard<std::mutex> lock(m_configMutex);
+        StopWorkers();
+        StartWorkers(threads ? threads : std::max(1u, std::thread::hardware_concurrency()));
+    }
+
+    ///
+    /// \brief ThreadsCount
+    /// \return Workers and the calling thread
+    ///
+    size_t ThreadsCount()
+    {
+        EnsureStarted();
+        return m_workers.size() + 1;
+    }
+
+    ///
+    /// \brief WorkerIndex
+    /// \return 1..ThreadsCount()-1 for the workers of the scheduler, 0 for the other threads
+    ///
+    static int WorkerIndex()
+    {
+        return ThreadIndex();
+    }
+
+    ///
+    /// \brief ParallelForRange
+    /// \param begin
+    /// \param end
+    /// \param body - body(from, to) of the chunk [from, to)
+    /// \param grain - indices in the chunk, 0 - about 4 chunks per thread
+    ///
+    template<typename BODY>
+    void ParallelForRange(int begin, int end, BODY&& body, int grain = 0)
+    {
+        if (end <= begin)
+            return;
+        EnsureStarted();
+
+        const int total = end - begin;
+        const int threads = static_cast<int>(m_workers.size()) + 1;
+        if (grain <= 0)
+            grain = std::max(1, total / (4 * threads));
+        const int chunks = (total + grain - 1) / grain;
+        if (chunks == 1 || threads == 1)
+        {
+            body(begin, end);
+            return;
+        }
+
+        using body_t = std::remove_reference_t<BODY>;
+        auto job = std::make_shared<Job>();
+        job->m_func = [](void* data, int from, int to) { (*static_cast<body_t*>(data))(from, to); };
+        job->m_data = const_cast<void*>(static_cast<const void*>(std::addressof(body)));
+        job->m_begin = begin;
+        job->m_end = end;
+        job->m_grain = grain;
+        job->m_chunks = chunks;
+
+        Push(job, std::min(threads - 1, chunks - 1));
+        RunChunks(*job);
+
+        // Waiting for the chunks taken by the other threads: the waiting thread helps with the other loops
+        while (job->m_done.load(std::memory_order_acquire) < chunks)
+        {
+            std::shared_ptr<Job> other = Take();
+            if (other)
+                RunChunks(*other);
+            else
+                std::this_thread::yield();
+        }
+        if (job->m_error)
+            std::rethrow_exception(job->m_error);
+    }
+
+    ///
+    ~Scheduler()
+    {
+        std::lock_guard<std::mutex> lock(m_configMutex);
+        StopWorkers();
+    }
+
+private:
+    ///
+    /// \brief The Job struct
+    /// The loop: the chunks are taken by the atomic counter, the queues keep the references of the loop for the helpers
+    ///
+    struct Job
+    {
+        void (*m_func)(void* data, int from, int to) = nullptr;
+        void* m_data = nullptr;
+        int m_begin = 0;
+        int m_end = 0;
+        int m_grain = 1;
+        int m_chunks = 0;
+        std::atomic<int> m_next { 0 };
+        std::atomic<int> m_done { 0 };
+        std::mutex m_errorMutex;
+        std::exception_ptr m_error;
+    };
+
+    ///
+    struct Queue
+    {
+        std::mutex m_mutex;
+        std::deque<std::shared_ptr<Job>> m_jobs;
+    };
+
+    std::mutex m_configMutex;
+    std::once_flag m_startFlag;
+    std::vector<std::thread> m_workers;
+    std::vector<std::unique_ptr<Queue>> m_queues; // 0 - the queue of the external threads, i - of the worker i
+
+    std::mutex m_sleepMutex;
+    std::condition_variable m_sleepCond;
+    std::atomic<int> m_pending { 0 };
+    bool m_stop = false;
+
+    Scheduler() = default;
+    Scheduler(const Scheduler&) = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+
+    ///
+    static int& ThreadIndex()
+    {
+        static thread_local int index = 0;
+        return index;
+    }
+
+    ///
+    void EnsureStarted()
+    {
+        std::call_once(m_startFlag, [this]()
+        {
+            std::lock_guard<std::mutex> lock(m_configMutex);
+            if (m_queues.empty())
+                StartWorkers(std::max(1u, std::thread::hardware_concurrency()));
+        });
+    }
+
+    ///
+    void StartWorkers(size_t threads)
+    {
+        m_stop = false;
+        m_pending = 0;
+        m_queues.clear();
+        for (size_t i = 0; i < threads; ++i)
+        {
+            m_queues.emplace_back(std::make_unique<Queue>());
+        }
+        for (size_t i = 1; i < threads; ++i)
+        {
+            m_workers.emplace_back(&Scheduler::WorkerThread, this, static_cast<int>(i));
+        }
+    }
+
+    ///
+    void StopWorkers()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_sleepMutex);
+            m_stop = true;
+        }
+        m_sleepCond.notify_all();
+        for (auto& worker : m_workers)
+        {
+            if (worker.joinable())
+                worker.join();
+        }
+        m_workers.clear();
+    }
+
+    ///
+    void WorkerThread(int index)
+    {
+        ThreadIndex() = index;
+        for (;;)
+        {
+            std::shared_ptr<Job> job = Take();
+            if (job)
+            {
+                RunChunks(*job);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(m_sleepMutex);
+            m_sleepCond.wait(lock, [this]() { return m_stop || m_pending.load(std::memory_order_acquire) > 0; });
+            if (m_stop)
+                break;
+        }
+    }
+
+    ///
+    /// \brief Push
+    /// \param job
+    /// \param helpers - references of the job for the other threads
+    ///
+    void Push(const std::shared_ptr<Job>& job, int helpers)
+    {
+        Queue& queue = *m_queues[std::min(static_cast<size_t>(ThreadIndex()), m_queues.size() - 1)];
+        {
+            std::lock_guard<std::mutex> lock(queue.m_mutex);
+            for (int i = 0; i < helpers; ++i)
+            {
+                queue.m_jobs.push_back(job);
+            }
+        }
+        m_pending.fetch_add(helpers, std::memory_order_release);
+        {
+            std::lock_guard<std::mutex> lock(m_sleepMutex);
+        }
+        if (helpers > 1)
+            m_sleepCond.notify_all();
+        else
+            m_sleepCond.notify_one();
+    }
+
+    ///
+    /// \brief Take
+    /// The newest job of the own queue or the oldest job stolen from the other queues
+    ///
+    std::shared_ptr<Job> Take()
+    {
+        if (m_pending.load(std::memory_order_acquire) <= 0)
+            return nullptr;
+
+        const size_t queuesCount = m_queues.size();
+        const size_t own = std::min(static_cast<size_t>(ThreadIndex()), queuesCount - 1);
+        for (size_t i = 0; i < queuesCount; ++i)
+        {
+            Queue& queue = *m_queues[(own + i) % queuesCount];
+            std::lock_guard<std::mutex> lock(queue.m_mutex);
+            if (queue.m_jobs.empty())
+                continue;
+            std::shared_ptr<Job> job;
+            if (i == 0)
+            {
+                job = std::move(queue.m_jobs.back());
+                queue.m_jobs.pop_back();
+            }
+            else
+            {
+                job = std::move(queue.m_jobs.front());
+                queue.m_jobs.pop_front();
+            }
+            m_pending.fetch_sub(1, std::memory_order_relaxed);
+            return job;
+        }
+        return nullptr;
+    }
+
+    ///
+    static void RunChunks(Job& job)
+    {
+        for (;;)
+        {
+            const int chunk = job.m_next.fetch_add(1, std::memory_order_relaxed);
+            if (chunk >= job.m_chunks)
+                break;
+            const int from = job.m_begin + chunk * job.m_grain;
+            const int to = std::min(job.m_end, from + job.m_grain);
+            try
+            {
+                job.m_func(job.m_data, from, to);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(job.m_errorMutex);
+                if (!job.m_error)
+                    job.m_error = std::current_exception();
+            }
+            job.m_done.fetch_add(1, std::memory_order_release);
+        }
+    }
+};
+
+///
+/// \brief ParallelForRange
+/// body(from, to) for the chunks of [begin, end)
+///
+template<typename BODY>
+void ParallelForRange(int begin, int end, BODY&& body, int grain = 0)
+{
+    Scheduler::Instance().ParallelForRange(begin, end, std::forward<BODY>(body), grain);
+}
+
+///
+/// \brief ParallelFor
+/// body(i) for the every i of [begin, end)
+///
+template<typename BODY>
+void ParallelFor(int begin, int end, BODY&& body, int grain = 0)
+{
+    Scheduler::Instance().ParallelForRange(begin, end, [&body](int from, int to)
+    {
+        for (int i = from; i < to; ++i)
+        {
+            body(i);
+        }
+    }, grain);
+}
+
+#ifdef MTRACKER_OCV_PARALLEL_BACKEND
+///
+/// \brief The OpenCVBackend class
+/// cv::parallel_for_ on the threads of the Scheduler, cv::setNumThreads restarts its workers
+///
+class OpenCVBackend : public cv::parallel::ParallelForAPI
+{
+public:
+    void parallel_for(int tasks, FN_parallel_for_body_cb_t body_callback, void* callback_data) override
+    {
+        Scheduler::Instance().ParallelForRange(0, tasks, [&](int from, int to) { body_callback(from, to, callback_data); }, 1);
+    }
+    int getThreadNum() const override
+    {
+        return Scheduler::WorkerIndex();
+    }
+    int getNumThreads() const override
+    {
+        return static_cast<int>(Scheduler::Instance().ThreadsCount());
+    }
+    int setNumThreads(int nThreads) override
+    {
+        const int prevThreads = getNumThreads();
+        Scheduler::Instance().SetThreadsCount(static_cast<size_t>(std::max(0, nThreads)));
+        return prevThreads;
+    }
+    const char* getName() const override
+    {
+        return "mtracker";
+    }
+};
+#endif
+
+///
+/// \brief InstallOpenCVBackend
+/// Sets the threads of the scheduler and replaces the parallel backend of OpenCV (4.5.2+) by the scheduler
+/// \param threads - 0 - hardware concurrency
+///
+inline void InstallOpenCVBackend(size_t threads)
+{
+    Scheduler::Instance().SetThreadsCount(threads);
+#ifdef MTRACKER_OCV_PARALLEL_BACKEND
+    cv::parallel::setParallelForBackend(std::make_shared<OpenCVBackend>(), false);
+    std::cout << "Task scheduler: " << Scheduler::Instance().ThreadsCount() << " threads for the library and OpenCV" << std::endl;
+#else
+    // OpenCV keeps own threads: they are limited by the same count
+    cv::setNumThreads(static_cast<int>(Scheduler::Instance().ThreadsCount()));
+    std::cout << "Task scheduler: " << Scheduler::Instance().ThreadsCount() << " threads, OpenCV < 4.5.2 uses own parallel backend" << std::endl;
+#endif
+}
+}
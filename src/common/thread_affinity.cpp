@@ -0,0 +1,250 @@
+#include "thread_affinity.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <sched.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+namespace affinity
+{
+///
+/// \brief ParseCpuList
+/// \param cpuList
+/// \return
+///
+std::vector<int> ParseCpuList(const std::string& cpuList)
+{
+    std::vector<int> cpus;
+    std::istringstream stream(cpuList);
+    std::string range;
+    while (std::getline(stream, range, ','))
+    {
+        range.erase(std::remove_if(range.begin(), range.end(), [](char ch) { return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r'; }), range.end());
+        if (range.empty())
+            continue;
+        try
+        {
+            size_t dash = range.find('-');
+            int first = std::stoi(range.substr(0, dash));
+            int last = (dash == std::string::npos) ? first : std::stoi(range.substr(dash + 1));
+            if (first < 0 || last < first)
+                return std::vector<int>();
+            for (int cpu = first; cpu <= last; ++cpu)
+            {
+                cpus.push_back(cpu);
+            }
+        }
+        catch (const std::exception&)
+        {
+            return std::vector<int>();
+        }
+    }
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return cpus;
+}
+
+///
+/// \brief NumaNodeCpus
+/// \param node
+/// \return
+///
+std::vector<int> NumaNodeCpus(int node)
+{
+    std::vector<int> cpus;
+    if (node < 0)
+        return cpus;
+#if defined(_WIN32)
+    ULONGLONG mask = 0;
+    if (GetNumaNodeProcessorMask(static_cast<UCHAR>(node), &mask))
+    {
+        for (int cpu = 0; cpu < 64; ++cpu)
+        {
+            if (mask & (1ULL << cpu))
+                cpus.push_back(cpu);
+        }
+    }
+#elif defined(__linux__)
+    std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+    std::string cpuList;
+    if (file && std::getline(file, cpuList))
+        cpus = ParseCpuList(cpuList);
+#endif
+    return cpus;
+}
+
+///
+/// \brief PinCurrentThread
+/// \param cpus
+/// \return
+///
+bool PinCurrentThread(const std::vector<int>& cpus)
+{
+    if (cpus.empty())
+        return false;
+#if defined(_WIN32)
+    // The mask of the one processor group
+    DWORD_PTR mask = 0;
+    for (int cpu : cpus)
+    {
+        if (cpu < static_cast<int>(8 * sizeof(DWORD_PTR)))
+            mask |= static_cast<DWORD_PTR>(1) << cpu;
+    }
+    return mask && SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+#elif defined(__linux__)
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    for (int cpu : cpus)
+    {
+        if (cpu < CPU_SETSIZE)
+            CPU_SET(cpu, &cpuSet);
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) == 0;
+#else
+    // macOS has only the affinity tags without the binding to the cores
+    return false;
+#endif
+}
+
+///
+/// \brief CurrentNumaNode
+/// \return
+///
+int CurrentNumaNode()
+{
+#if defined(_WIN32)
+    USHORT node = 0;
+    PROCESSOR_NUMBER processor;
+    GetCurrentProcessorNumberEx(&processor);
+    if (GetNumaProcessorNodeEx(&processor, &node))
+        return static_cast<int>(node);
+#elif defined(__linux__) && defined(SYS_getcpu)
+    unsigned cpu = 0;
+    unsigned node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0)
+        return static_cast<int>(node);
+#endif
+    return -1;
+}
+
+///
+/// \brief Placement::Parse
+/// \param spec
+/// \return
+///
+bool Placement::Parse(const std::string& spec)
+{
+    m_stages.clear();
+
+    std::istringstream stream(spec);
+    std::string item;
+    while (std::getline(stream, item, ';'))
+    {
+        if (item.find_first_not_of(" \t") == std::string::npos)
+            continue;
+        size_t eq = item.find('=');
+        if (eq == std::string::npos || eq == 0)
+        {
+            std::cerr << "Placement: '" << item << "' isn't <stage>=<cpus>[/<OpenMP threads>]" << std::endl;
+            m_stages.clear();
+            return false;
+        }
+        std::string stage = item.substr(0, eq);
+        stage.erase(std::remove(stage.begin(), stage.end(), ' '), stage.end());
+        std::string cpus = item.substr(eq + 1);
+
+        StagePlacement placement;
+        size_t slash = cpus.find('/');
+        if (slash != std::string::npos)
+        {
+            placement.m_ompThreads = std::max(0, atoi(cpus.c_str() + slash + 1));
+            cpus = cpus.substr(0, slash);
+        }
+        cpus.erase(std::remove(cpus.begin(), cpus.end(), ' '), cpus.end());
+        if (cpus.compare(0, 4, "node") == 0)
+        {
+            placement.m_numaNode = atoi(cpus.c_str() + 4);
+            placement.m_cpus = NumaNodeCpus(placement.m_numaNode);
+            if (placement.m_cpus.empty())
+                std::cerr << "Placement: NUMA node " << placement.m_numaNode << " of " << stage << " not found, the thread isn't pinned" << std::endl;
+        }
+        else if (!cpus.empty())
+        {
+            placement.m_cpus = ParseCpuList(cpus);
+            if (placement.m_cpus.empty())
+            {
+                std::cerr << "Placement: wrong CPUs list '" << cpus << "' of " << stage << std::endl;
+                m_stages.clear();
+                return false;
+            }
+        }
+        m_stages[stage] = placement;
+    }
+    return true;
+}
+
+///
+/// \brief Placement::Find
+/// \param stage
+/// \param index
+/// \return
+///
+const StagePlacement* Placement::Find(const std::string& stage, int index) const
+{
+    if (m_stages.empty())
+        return nullptr;
+    auto it = (index >= 0) ? m_stages.find(stage + std::to_string(index)) : std::end(m_stages);
+    if (it == std::end(m_stages))
+        it = m_stages.find(stage);
+    if (it == std::end(m_stages))
+        it = m_stages.find("*");
+    return (it != std::end(m_stages)) ? &it->second : nullptr;
+}
+
+///
+/// \brief Placement::Apply
+/// \param stage
+/// \param index
+/// \return
+///
+bool Placement::Apply(const std::string& stage, int index) const
+{
+    const StagePlacement* placement = Find(stage, index);
+    if (!placement)
+        return true;
+
+    bool res = true;
+    if (!placement->m_cpus.empty())
+    {
+        res = PinCurrentThread(placement->m_cpus);
+        if (!res)
+            std::cerr << "Placement: affinity of " << stage << ((index >= 0) ? std::to_string(index) : std::string()) << " wasn't set" << std::endl;
+    }
+#ifdef _OPENMP
+    // The OpenMP threads count is the state of the calling thread: the parallel regions of the stage use it
+    if (placement->m_ompThreads > 0)
+        omp_set_num_threads(placement->m_ompThreads);
+#endif
+    std::cout << "Placement: " << stage << ((index >= 0) ? std::to_string(index) : std::string())
+              << " on " << placement->m_cpus.size() << " CPUs, NUMA node " << CurrentNumaNode()
+              << ", OpenMP threads " << placement->m_ompThreads << std::endl;
+    return res;
+}
+}
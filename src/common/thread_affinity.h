@@ -0,0 +1,90 @@
+#pragma once
+#include <map>
+#include <string>
+#include <vector>
+
+///
+/// CPU affinity and NUMA placement of the pipeline threads. The placement is the list of the stages:
+///
+///     capture=node0;detect=2-9/8;track=node0/4;*=node0
+///
+/// <stage>=<cpus>[/<OpenMP threads>], the cpus are the list "0-3,8,10-11" or "node<N>" for the all CPUs of the NUMA node,
+/// "*" is the default of the other stages. The stage with the index (the stream or the worker) is looked up as
+/// "<stage><index>", then "<stage>" and "*": stream0=node0;stream1=node1.
+///
+/// The frames are allocated and first touched by the capture thread, so with the pinned capture the pools
+/// of the frames (RecyclingPool, the buffers of the pipeline) are in the memory of its NUMA node
+///
+namespace affinity
+{
+///
+/// \brief The StagePlacement struct
+///
+struct StagePlacement
+{
+    std::vector<int> m_cpus;  // Empty - the thread isn't pinned
+    int m_numaNode = -1;      // The node of "node<N>"
+    int m_ompThreads = 0;     // OpenMP threads of the parallel regions started by the stage, 0 - don't change
+};
+
+///
+/// \brief ParseCpuList
+/// \param cpuList - "0-3,8,10-11"
+/// \return Empty on the error
+///
+std::vector<int> ParseCpuList(const std::string& cpuList);
+
+///
+/// \brief NumaNodeCpus
+/// \return CPUs of the NUMA node, empty if the node doesn't exist or NUMA isn't supported
+///
+std::vector<int> NumaNodeCpus(int node);
+
+///
+/// \brief PinCurrentThread
+/// \return false if the affinity isn't supported or wasn't set
+///
+bool PinCurrentThread(const std::vector<int>& cpus);
+
+///
+/// \brief CurrentNumaNode
+/// \return NUMA node of the CPU that runs the calling thread, -1 if unknown
+///
+int CurrentNumaNode();
+
+///
+/// \brief The Placement class
+///
+class Placement
+{
+public:
+    ///
+    /// \brief Parse
+    /// \param spec - see the description of the namespace, empty - the threads aren't placed
+    /// \return false on the syntax error
+    ///
+    bool Parse(const std::string& spec);
+
+    ///
+    bool Empty() const
+    {
+        return m_stages.empty();
+    }
+
+    ///
+    /// \brief Find
+    /// \return Placement of "<stage><index>", "<stage>" or "*", nullptr if the stage isn't placed
+    ///
+    const StagePlacement* Find(const std::string& stage, int index = -1) const;
+
+    ///
+    /// \brief Apply
+    /// Pins the calling thread of the stage and sets its OpenMP threads
+    /// \return false if the stage is placed but the affinity wasn't set
+    ///
+    bool Apply(const std::string& stage, int index = -1) const;
+
+private:
+    std::map<std::string, StagePlacement> m_stages;
+};
+}
@@ -0,0 +1,287 @@
+#pragma once
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+#include <algorithm>
+
+///
+/// Timeline of the pipeline in the Chrome trace_event format (chrome://tracing, ui.perfetto.dev).
+/// The spans are recorded to the ring buffer of the last events and are dumped on demand:
+///
+///     TRACE_SPAN("detect", "pipeline");
+///
+/// Without MTRACKER_TRACE_EVENTS (CMake option USE_TRACE_EVENTS) the macros are removed.
+/// With it the disabled recorder costs one relaxed atomic load per span
+///
+namespace trace
+{
+///
+/// \brief The Event struct
+/// Names are the string literals: only the pointers are stored
+///
+struct Event
+{
+    const char* m_name = nullptr;
+    const char* m_category = nullptr;
+    int64_t m_startUs = 0;
+    int64_t m_durationUs = 0;
+    uint32_t m_threadId = 0;
+};
+
+///
+/// \brief The Recorder class
+/// Process-wide ring buffer of the complete ("X") events
+///
+class Recorder
+{
+public:
+    ///
+    static Recorder& Instance()
+    {
+        static Recorder recorder;
+        return recorder;
+    }
+
+    ///
+    /// \brief Enable
+    /// \param capacity - count of the last events in the ring buffer
+    ///
+    void Enable(size_t capacity = 1 << 16)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_events.assign(std::max<size_t>(1, capacity), Event());
+            m_next = 0;
+        }
+        m_enabled.store(true, std::memory_order_release);
+    }
+    ///
+    void Disable()
+    {
+        m_enabled.store(false, std::memory_order_release);
+    }
+    ///
+    bool Enabled() const
+    {
+        return m_enabled.load(std::memory_order_relaxed);
+    }
+
+    ///
+    /// \brief NowUs
+    /// \return Microseconds from the start of the process
+    ///
+    int64_t NowUs() const
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_start).count();
+    }
+
+    ///
+    /// \brief ThreadId
+    /// \return Small sequential id of the calling thread
+    ///
+    uint32_t ThreadId()
+    {
+        thread_local uint32_t threadId = m_threadsCount.fetch_add(1, std::memory_order_relaxed) + 1;
+        return threadId;
+    }
+
+    ///
+    /// \brief SetThreadName
+    /// Name of the calling thread on the timeline
+    /// \param name - string literal
+    ///
+    void SetThreadName(const char* name)
+    {
+        const uint32_t threadId = ThreadId();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto& thread : m_threadNames)
+        {
+            if (thread.first == threadId)
+            {
+                thread.second = name;
+                return;
+            }
+        }
+        m_threadNames.emplace_back(threadId, name);
+    }
+
+    ///
+    /// \brief Add
+    /// \param name - string literal
+    /// \param category - string literal
+    /// \param startUs
+    /// \param durationUs
+    ///
+    void Add(const char* name, const char* category, int64_t startUs, int64_t durationUs)
+    {
+        const uint32_t threadId = ThreadId();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_events.empty())
+            return;
+        Event& event = m_events[m_next % m_events.size()];
+        event.m_name = name;
+        event.m_category = category;
+        event.m_startUs = startUs;
+        event.m_durationUs = durationUs;
+        event.m_threadId = threadId;
+        ++m_next;
+    }
+
+    ///
+    /// \brief Dump
+    /// Writes the events from the ring buffer to the JSON file, the recording continues
+    /// \param fileName
+    /// \return
+    ///
+    bool Dump(const std::string& fileName) const
+    {
+        std::vector<Event> events;
+        std::vector<std::pair<uint32_t, const char*>> threadNames;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            const size_t count = std::min(m_next, m_events.size());
+            events.reserve(count);
+            for (size_t i = m_next - count; i < m_next; ++i)
+            {
+                events.emplace_back(m_events[i % m_events.size()]);
+            }
+            threadNames = m_threadNames;
+        }
+
+        std::ofstream file(fileName, std::ios::trunc);
+        if (!file.is_open())
+            return false;
+        file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        bool first = true;
+        for (const auto& thread : threadNames)
+        {
+            file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread.first << ",\"args\":{\"name\":\"" << thread.second << "\"}}";
+            first = false;
+        }
+        for (const auto& event : events)
+        {
+            file << (first ? "" : ",\n") << "{\"name\":\"" << event.m_name << "\",\"cat\":\"" << event.m_category << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.m_threadId
+                 << ",\"ts\":" << event.m_startUs << ",\"dur\":" << event.m_durationUs << "}";
+            first = false;
+        }
+        file << "\n]}\n";
+        return file.good();
+    }
+
+private:
+    std::atomic<bool> m_enabled { false };
+    std::atomic<uint32_t> m_threadsCount { 0 };
+    const std::chrono::steady_clock::time_point m_start = std::chrono::steady_clock::now();
+
+    std::vector<Event> m_events;
+    size_t m_next = 0;
+    std::vector<std::pair<uint32_t, const char*>> m_threadNames;
+    mutable std::mutex m_mutex;
+
+    Recorder() = default;
+    Recorder(const Recorder&) = delete;
+    Recorder& operator=(const Recorder&) = delete;
+};
+
+///
+/// \brief The Span class
+/// Records the lifetime of the object if the recorder was enabled at its construction
+///
+class Span
+{
+public:
+    Span(const char* name, const char* category)
+        : m_name(name), m_category(category)
+    {
+        if (Recorder::Instance().Enabled())
+            m_startUs = Recorder::Instance().NowUs();
+    }
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+
+    ~Span()
+    {
+        if (m_startUs >= 0)
+        {
+            Recorder& recorder = Recorder::Instance();
+            recorder.Add(m_name, m_category, m_startUs, recorder.NowUs() - m_startUs);
+        }
+    }
+
+private:
+    const char* m_name = nullptr;
+    const char* m_category = nullptr;
+    int64_t m_startUs = -1;
+};
+
+///
+/// \brief The SloDumper class
+/// Dumps the timeline when the latency exceeds the SLO: <fileName without .json>_<N>.json.
+/// The dumps are rate limited, the ring buffer keeps the events before the violation
+///
+class SloDumper
+{
+public:
+    ///
+    /// \param fileName - *.json
+    /// \param sloMs - 0 for the dumps only on demand
+    /// \param minIntervalMs - min time between the dumps
+    /// \param maxDumps
+    ///
+    SloDumper(const std::string& fileName, double sloMs, int64_t minIntervalMs = 5000, size_t maxDumps = 10)
+        : m_fileName(fileName), m_sloMs(sloMs), m_minIntervalUs(1000 * minIntervalMs), m_maxDumps(maxDumps)
+    {
+    }
+
+    ///
+    /// \brief Check
+    /// \param latencyMs
+    /// \return true if the timeline was dumped
+    ///
+    bool Check(double latencyMs)
+    {
+        if (m_sloMs <= 0 || latencyMs <= m_sloMs || m_dumps >= m_maxDumps || !Recorder::Instance().Enabled())
+            return false;
+        const int64_t now = Recorder::Instance().NowUs();
+        if (m_lastDumpUs >= 0 && now - m_lastDumpUs < m_minIntervalUs)
+            return false;
+        m_lastDumpUs = now;
+        std::string base = m_fileName;
+        if (base.size() > 5 && base.compare(base.size() - 5, 5, ".json") == 0)
+            base.resize(base.size() - 5);
+        return Recorder::Instance().Dump(base + "_" + std::to_string(m_dumps++) + ".json");
+    }
+
+    ///
+    /// \brief Dump
+    /// On demand and at the end of the processing
+    ///
+    bool Dump() const
+    {
+        return Recorder::Instance().Dump(m_fileName);
+    }
+
+private:
+    std::string m_fileName;
+    double m_sloMs = 0;
+    int64_t m_minIntervalUs = 0;
+    size_t m_maxDumps = 0;
+    size_t m_dumps = 0;
+    int64_t m_lastDumpUs = -1;
+};
+}
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+
+#ifdef MTRACKER_TRACE_EVENTS
+#define TRACE_SPAN(name, category) trace::Span TRACE_CONCAT(traceSpan_, __LINE__)(name, category)
+#define TRACE_THREAD_NAME(name) trace::Recorder::Instance().SetThreadName(name)
+#else
+#define TRACE_SPAN(name, category)
+#define TRACE_THREAD_NAME(name)
+#endif
@@ -0,0 +1,324 @@
+#include <iostream>
+#include <iomanip>
+#include <deque>
+#include <future>
+#include <cstdio>
+#include "BatchRunner.h"
+#include "BinaryResultsLog.h"
+
+///
+/// \brief BatchRunner::BatchRunner
+/// \param settings
+///
+BatchRunner::BatchRunner(const BatchRunnerSettings& settings)
+    : m_settings(settings), m_fileSettings(settings.m_trackerSettings)
+{
+    // The files don't share the checkpoints and the flight records of the process
+    m_fileSettings.m_checkpointFile.clear();
+    m_fileSettings.m_checkpointRestore = false;
+    m_fileSettings.m_flightRecorderSeconds = 0.f;
+
+    std::ifstream journal(JournalFile());
+    std::string source;
+    while (std::getline(journal, source))
+    {
+        if (!source.empty() && source.back() == '\r')
+            source.pop_back();
+        if (!source.empty())
+            m_journaled.insert(source);
+    }
+    if (!m_journaled.empty())
+        std::cout << "BatchRunner: " << m_journaled.size() << " files are finished by the journal " << JournalFile() << std::endl;
+}
+
+///
+/// \brief BatchRunner::~BatchRunner
+///
+BatchRunner::~BatchRunner()
+{
+    Stop();
+    for (auto& worker : m_workers)
+    {
+        if (worker.joinable())
+            worker.join();
+    }
+}
+
+///
+/// \brief BatchRunner::JournalFile
+/// \return
+///
+std::string BatchRunner::JournalFile() const
+{
+    return m_settings.m_journalFile.empty() ? (m_settings.m_outDir + "/batch_journal.txt") : m_settings.m_journalFile;
+}
+
+///
+/// \brief BatchRunner::ResultFile
+/// The whole path is in the name: the files of the different cameras have the same names
+/// \param source
+/// \return
+///
+std::string BatchRunner::ResultFile(const std::string& source) const
+{
+    std::string name = source;
+    for (auto& c : name)
+    {
+        if (c == '/' || c == '\\' || c == ':')
+            c = '_';
+    }
+    name.erase(0, name.find_first_not_of("._"));
+    return m_settings.m_outDir + "/" + name + ".bin";
+}
+
+///
+/// \brief BatchRunner::AddFiles
+/// \param sources
+/// \return
+///
+size_t BatchRunner::AddFiles(const std::vector<std::string>& sources)
+{
+    for (const auto& source : sources)
+    {
+        if (m_journaled.count(source))
+            ++m_skippedFiles;
+        else
+            m_files.push_back(source);
+    }
+    return m_files.size();
+}
+
+///
+/// \brief BatchRunner::Run
+/// \return
+///
+bool BatchRunner::Run()
+{
+    if (m_files.empty())
+    {
+        std::cout << "BatchRunner: no files to process, skipped " << m_skippedFiles << std::endl;
+        return true;
+    }
+
+    // The first frame creates the detector
+    cv::Mat firstFrame;
+    for (const auto& source : m_files)
+    {
+        cv::VideoCapture capture(source);
+        if (capture.isOpened())
+            capture >> firstFrame;
+        if (!firstFrame.empty())
+            break;
+    }
+    if (firstFrame.empty())
+    {
+        std::cerr << "BatchRunner: no frames in the files" << std::endl;
+        return false;
+    }
+
+    // Detector state of one camera (motion gates of the crops) can't be shared between the files
+    config_t detectorConfig = m_settings.m_detectorConfig;
+    detectorConfig.erase("tilesMotionGate");
+    detectorConfig.erase("tilesCache");
+    // The background models of the slots are the tiles of one atlas
+    const bool motionDetector = m_settings.m_detectorType <= tracking::Motion_MOG2;
+    if (motionDetector && detectorConfig.find("motionStreams") == detectorConfig.end())
+    {
+        size_t motionStreams = m_settings.m_concurrentFiles ? m_settings.m_concurrentFiles : std::max(1u, std::thread::hardware_concurrency());
+        detectorConfig.emplace("motionStreams", std::to_string(std::min(motionStreams, m_files.size())));
+    }
+    cv::UMat frame = firstFrame.getUMat(cv::ACCESS_READ);
+    std::unique_ptr<BaseDetector> detector = CreateDetector(m_settings.m_detectorType, detectorConfig, frame);
+    if (!detector)
+    {
+        std::cerr << "BatchRunner: detector wasn't created" << std::endl;
+        return false;
+    }
+    const size_t maxBatch = detector->MaxBatchSize();
+    size_t slots = m_settings.m_concurrentFiles ? m_settings.m_concurrentFiles : (motionDetector ? maxBatch : 2 * maxBatch);
+    slots = std::min(std::max<size_t>(1, slots), m_files.size());
+    // The queue of the service holds the frames in flight of the all files
+    const size_t framesInFlight = std::max<size_t>(1, m_settings.m_framesInFlight);
+    m_detectionService = std::make_unique<BatchDetectionService>(std::move(detector), m_settings.m_maxBatchWait, slots * framesInFlight);
+
+    // The trackers of the files get the embeddings from the pool and don't load the networks
+    if (EmbeddingsPool::NeedEmbeddings(m_settings.m_trackerSettings))
+    {
+        m_embeddingsPool = std::make_unique<EmbeddingsPool>(m_settings.m_trackerSettings, m_settings.m_reidWorkers);
+        m_fileSettings.m_embeddings.clear();
+    }
+
+    m_journal.open(JournalFile(), std::ios::app);
+    if (!m_journal.is_open())
+        std::cerr << "BatchRunner: can't open the journal " << JournalFile() << ", the run can't be resumed" << std::endl;
+
+    std::cout << "BatchRunner: " << m_files.size() << " files by " << slots << " workers, max batch " << maxBatch << ", skipped " << m_skippedFiles << std::endl;
+
+    const int64 t1 = cv::getTickCount();
+    for (size_t i = 0; i < slots; ++i)
+    {
+        m_workers.emplace_back(&BatchRunner::Worker, this, i);
+    }
+    for (auto& worker : m_workers)
+    {
+        if (worker.joinable())
+            worker.join();
+    }
+    m_workers.clear();
+    m_workTime = cv::getTickCount() - t1;
+    return true;
+}
+
+///
+/// \brief BatchRunner::Stop
+///
+void BatchRunner::Stop()
+{
+    m_stop = true;
+}
+
+///
+/// \brief BatchRunner::Worker
+/// \param slot - the stream of the detector: the state of the detector is kept between the files of the slot
+///
+void BatchRunner::Worker(size_t slot)
+{
+    while (!m_stop)
+    {
+        const size_t fileInd = m_nextFile.fetch_add(1);
+        if (fileInd >= m_files.size())
+            break;
+
+        const std::string& source = m_files[fileInd];
+        if (!ProcessFile(slot, source))
+        {
+            if (!m_stop)
+                ++m_failedFiles;
+            continue;
+        }
+
+        const std::string resultFile = ResultFile(source);
+        std::remove(resultFile.c_str());
+        if (std::rename((resultFile + ".part").c_str(), resultFile.c_str()) != 0)
+        {
+            std::cerr << "BatchRunner: can't rename the results of " << source << std::endl;
+            ++m_failedFiles;
+            continue;
+        }
+        ++m_finishedFiles;
+        std::lock_guard<std::mutex> lock(m_journalMutex);
+        if (m_journal.is_open())
+            m_journal << source << std::endl;
+    }
+}
+
+///
+/// \brief BatchRunner::ProcessFile
+/// The next frames are decoded and queued to the detector while the previous frame is tracked
+/// \param slot
+/// \param source
+/// \return false if the file wasn't processed to the end
+///
+bool BatchRunner::ProcessFile(size_t slot, const std::string& source)
+{
+    cv::VideoCapture capture(source);
+    if (!capture.isOpened())
+    {
+        std::cerr << "BatchRunner: can't open " << source << std::endl;
+        return false;
+    }
+    const float fps = std::max(1.f, static_cast<float>(capture.get(cv::CAP_PROP_FPS)));
+
+    std::unique_ptr<BaseTracker> tracker = BaseTracker::CreateTracker(m_fileSettings);
+    if (!tracker)
+        return false;
+    BinaryResultsWriter writer(ResultFile(source) + ".part", m_settings.m_writeEachNFrame);
+    if (!writer.IsOpened())
+        return false;
+
+    ///
+    struct InFlight
+    {
+        cv::UMat m_frame; // Isn't changed until the detection
+        std::future<regions_t> m_regions;
+    };
+    std::deque<InFlight> inFlight;
+    const size_t framesInFlight = std::max<size_t>(1, m_settings.m_framesInFlight);
+
+    std::vector<TrackingObject> tracks;
+    const int minTraceSize = cvRound(fps / 4);
+    int frameInd = 0;
+    bool finished = false;
+    while (!m_stop)
+    {
+        while (!finished && inFlight.size() < framesInFlight)
+        {
+            cv::Mat frame;
+            capture >> frame;
+            if (frame.empty())
+            {
+                finished = true;
+                break;
+            }
+            InFlight next;
+            frame.copyTo(next.m_frame);
+            next.m_regions = m_detectionService->Push(slot, next.m_frame);
+            inFlight.emplace_back(std::move(next));
+        }
+        if (inFlight.empty())
+            break;
+
+        InFlight curr = std::move(inFlight.front());
+        inFlight.pop_front();
+        regions_t regions = curr.m_regions.get();
+        if (m_embeddingsPool)
+        {
+            std::vector<RegionEmbedding> embeddings = m_embeddingsPool->Calc(regions, curr.m_frame).get();
+            tracker->Update(regions, embeddings, curr.m_frame, fps);
+        }
+        else
+        {
+            tracker->Update(regions, curr.m_frame, fps);
+        }
+
+        tracker->GetTracks(tracks);
+        for (auto& track : tracks)
+        {
+            writer.AddTrack(frameInd, track.m_ID, track.m_rrect.boundingRect(), track.m_type, track.m_confidence);
+            if (track.IsRobust(minTraceSize, 0.7f, cv::Size2f(0.1f, 8.0f)))
+                writer.AddRobustTrack(frameInd, track.m_ID);
+        }
+        ++frameInd;
+        ++m_frames;
+    }
+    // The queued frames are detected before their buffers are released
+    for (auto& frame : inFlight)
+    {
+        frame.m_regions.wait();
+    }
+    if (m_stop)
+        return false;
+    std::cout << "BatchRunner: " << source << " finished, " << frameInd << " frames" << std::endl;
+    return true;
+}
+
+///
+/// \brief BatchRunner::PrintStat
+///
+void BatchRunner::PrintStat() const
+{
+    const double workTime = m_workTime / cv::getTickFrequency();
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "Files: finished " << m_finishedFiles.load() << ", failed " << m_failedFiles.load() << ", skipped by the journal " << m_skippedFiles
+              << ", not processed " << (m_files.size() - std::min(m_files.size(), m_finishedFiles.load() + m_failedFiles.load())) << std::endl;
+    std::cout << "Frames " << m_frames.load() << " in " << workTime << " s, " << (workTime > 0 ? (m_frames.load() / workTime) : 0.) << " fps, "
+              << (workTime > 0 ? (3600. * m_finishedFiles.load() / workTime) : 0.) << " files per hour" << std::endl;
+    if (m_detectionService)
+    {
+        BatchDetectionService::Stat stat = m_detectionService->GetStat();
+        std::cout << "Detector: " << stat.m_batches << " batches of max " << m_detectionService->MaxBatchSize() << ", " << stat.m_frames << " frames, "
+                  << (stat.m_batches ? (static_cast<double>(stat.m_frames) / stat.m_batches) : 0.) << " frames per batch, "
+                  << stat.m_timeoutBatches << " batches by timeout" << std::endl;
+    }
+    std::cout << std::defaultfloat;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_set>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+
+#include <opencv2/opencv.hpp>
+
+#include "BaseDetector.h"
+#include "BatchDetectionService.h"
+#include "EmbeddingsPool.h"
+#include "Ctracker.h"
+
+// ----------------------------------------------------------------------
+
+///
+/// \brief The BatchRunnerSettings struct
+///
+struct BatchRunnerSettings
+{
+    tracking::Detectors m_detectorType = tracking::Detectors::Yolo_Darknet;
+    config_t m_detectorConfig;                       // "gpuIds" creates the detectors on the several GPUs
+    std::chrono::milliseconds m_maxBatchWait { 50 }; // Not the real time: the batches wait longer to be full
+    TrackerSettings m_trackerSettings;
+    size_t m_concurrentFiles = 0;                    // 0 - twice the max batch of the detector
+    size_t m_framesInFlight = 2;                     // Decoded frames of the file in the detection
+    size_t m_reidWorkers = 1;
+    std::string m_outDir = ".";                      // <out>/<source path with '_' instead of the separators>.bin
+    std::string m_journalFile;                       // Finished sources, empty - <out>/batch_journal.txt
+    int m_writeEachNFrame = 1;
+};
+
+///
+/// \brief The BatchRunner class
+/// Offline processing of the video archive for the maximum files per hour instead of the real time: the worker of the every
+/// concurrent file decodes it and keeps m_framesInFlight frames in one BatchDetectionService, so the detector gets the full
+/// cross-file batches while the files are decoded in parallel. The every file has own tracker, its results are written by
+/// BinaryResultsWriter to <name>.bin.part which is renamed to <name>.bin at the end of the file.
+/// The finished files are appended to the journal: Run after the interruption skips them and processes the others from the start
+///
+class BatchRunner
+{
+public:
+    BatchRunner(const BatchRunnerSettings& settings);
+    BatchRunner(const BatchRunner&) = delete;
+    BatchRunner& operator=(const BatchRunner&) = delete;
+    ~BatchRunner();
+
+    ///
+    /// \brief AddFiles
+    /// \param sources
+    /// \return Count of the files to process, the files of the journal are skipped
+    ///
+    size_t AddFiles(const std::vector<std::string>& sources);
+
+    ///
+    /// \brief Run
+    /// Processes the files until their end or Stop
+    /// \return false if the detector wasn't created
+    ///
+    bool Run();
+
+    ///
+    /// \brief Stop
+    /// Can be called from the other thread, the not finished files aren't journaled
+    ///
+    void Stop();
+
+    ///
+    /// \brief PrintStat
+    ///
+    void PrintStat() const;
+
+private:
+    BatchRunnerSettings m_settings;
+    TrackerSettings m_fileSettings; // Of the trackers of the files, without the networks of the pool
+
+    std::vector<std::string> m_files;
+    std::atomic<size_t> m_nextFile { 0 };
+    std::unordered_set<std::string> m_journaled;
+    size_t m_skippedFiles = 0;
+
+    std::mutex m_journalMutex;
+    std::ofstream m_journal;
+
+    std::unique_ptr<BatchDetectionService> m_detectionService;
+    std::unique_ptr<EmbeddingsPool> m_embeddingsPool;
+    std::vector<std::thread> m_workers;
+
+    std::atomic<bool> m_stop { false };
+    std::atomic<size_t> m_finishedFiles { 0 };
+    std::atomic<size_t> m_failedFiles { 0 };
+    std::atomic<size_t> m_frames { 0 };
+    int64 m_workTime = 0;
+
+    std::string JournalFile() const;
+    std::string ResultFile(const std::string& source) const;
+    void Worker(size_t slot);
+    bool ProcessFile(size_t slot, const std::string& source);
+};
@@ -0,0 +1,275 @@
+#include <iostream>
+#include <iomanip>
+#include "StreamServer.h"
+
+///
+/// \brief StreamServer::StreamServer
+/// \param settings
+/// \param callback
+///
+StreamServer::StreamServer(const StreamServerSettings& settings, ResultCallback callback)
+    : m_settings(settings), m_callback(callback)
+{
+}
+
+///
+/// \brief StreamServer::~StreamServer
+///
+StreamServer::~StreamServer()
+{
+    Stop();
+    for (auto& stream : m_streams)
+    {
+        if (stream->m_thread.joinable())
+            stream->m_thread.join();
+    }
+}
+
+///
+/// \brief StreamServer::AddStream
+/// \param source
+/// \param streamId
+/// \return
+///
+bool StreamServer::AddStream(const std::string& source, stream_id_t& streamId)
+{
+    auto stream = std::make_unique<Stream>();
+    stream->m_id = m_streams.size();
+    stream->m_source = source;
+    if (stream->m_id < m_settings.m_streamsQoS.size())
+        stream->m_qos = m_settings.m_streamsQoS[stream->m_id];
+
+    if (source.size() == 1 && std::isdigit(static_cast<unsigned char>(source[0])))
+        stream->m_capture.open(atoi(source.c_str()));
+    else
+        stream->m_capture.open(source);
+    if (!stream->m_capture.isOpened())
+    {
+        std::cerr << "StreamServer: can't open " << source << std::endl;
+        return false;
+    }
+    stream->m_fps = std::max(1.f, static_cast<float>(stream->m_capture.get(cv::CAP_PROP_FPS)));
+
+    // The first frame creates the detector
+    stream->m_capture >> stream->m_firstFrame;
+    if (stream->m_firstFrame.empty())
+    {
+        std::cerr << "StreamServer: empty first frame of " << source << std::endl;
+        return false;
+    }
+
+    streamId = stream->m_id;
+    std::cout << "Stream " << streamId << ": " << source << ", " << stream->m_firstFrame.cols << "x" << stream->m_firstFrame.rows << ", " << stream->m_fps << " fps" << std::endl;
+    m_streams.emplace_back(std::move(stream));
+    return true;
+}
+
+///
+/// \brief StreamServer::Run
+/// \return
+///
+bool StreamServer::Run()
+{
+    if (m_streams.empty())
+    {
+        std::cerr << "StreamServer: no streams" << std::endl;
+        return false;
+    }
+
+    // Detector state of one camera (motion gates of the crops) can't be shared between the streams
+    config_t detectorConfig = m_settings.m_detectorConfig;
+    detectorConfig.erase("tilesMotionGate");
+    detectorConfig.erase("tilesCache");
+    // The background models of the streams are the tiles of one atlas
+    if (m_settings.m_detectorType <= tracking::Motion_MOG2 && detectorConfig.find("motionStreams") == detectorConfig.end())
+        detectorConfig.emplace("motionStreams", std::to_string(m_streams.size()));
+    cv::UMat firstFrame = m_streams.front()->m_firstFrame.getUMat(cv::ACCESS_READ);
+    std::unique_ptr<BaseDetector> detector = CreateDetector(m_settings.m_detectorType, detectorConfig, firstFrame);
+    if (!detector)
+    {
+        std::cerr << "StreamServer: detector wasn't created" << std::endl;
+        return false;
+    }
+    m_detectionService = std::make_unique<BatchDetectionService>(std::move(detector), m_settings.m_maxBatchWait, 0, [this]() { m_settings.m_placement.Apply("detect"); });
+    for (auto& stream : m_streams)
+    {
+        BatchDetectionService::StreamQoS qos;
+        switch (stream->m_qos)
+        {
+        case StreamQoS::High:
+            qos.m_weight = 4.;
+            qos.m_deadline = m_settings.m_highDeadline;
+            break;
+        case StreamQoS::Normal:
+            break;
+        case StreamQoS::Low:
+            qos.m_weight = 0.5;
+            stream->m_scheduler = std::make_unique<DetectionScheduler>(m_settings.m_degradedKeyframes, m_settings.m_trackerSettings.m_detectRoiMargin,
+                                                                       m_settings.m_trackerSettings.m_detectBorderRatio);
+            break;
+        }
+        m_detectionService->SetStreamQoS(stream->m_id, qos);
+    }
+
+    // The trackers of the streams get the embeddings from the pool and don't load the networks
+    TrackerSettings streamSettings = m_settings.m_trackerSettings;
+    if (EmbeddingsPool::NeedEmbeddings(m_settings.m_trackerSettings))
+    {
+        m_embeddingsPool = std::make_unique<EmbeddingsPool>(m_settings.m_trackerSettings, m_settings.m_reidWorkers);
+        streamSettings.m_embeddings.clear();
+    }
+
+    m_trackerPool = std::make_unique<TrackerPool>(m_settings.m_trackerWorkers, 1, [this](size_t workerIndex) { m_settings.m_placement.Apply("tracker", static_cast<int>(workerIndex)); });
+    for (auto& stream : m_streams)
+    {
+        Stream* streamPtr = stream.get();
+        m_trackerPool->AddStream(stream->m_id, streamSettings, [this, streamPtr](stream_id_t streamId, const std::vector<TrackingObject>& tracks, const std::vector<track_id_t>& /*removedTracks*/)
+        {
+            size_t frameInd = 0;
+            {
+                std::lock_guard<std::mutex> lock(streamPtr->m_framesMutex);
+                frameInd = streamPtr->m_framesInTracker.front();
+                streamPtr->m_framesInTracker.pop_front();
+                if (streamPtr->m_scheduler)
+                {
+                    streamPtr->m_trackRects.clear();
+                    for (const auto& track : tracks)
+                    {
+                        streamPtr->m_trackRects.emplace_back(track.m_rrect.boundingRect());
+                    }
+                }
+            }
+            ++streamPtr->m_trackedFrames;
+            if (m_callback)
+                m_callback(streamId, frameInd, tracks);
+        });
+    }
+
+    const int64 t1 = cv::getTickCount();
+    for (auto& stream : m_streams)
+    {
+        stream->m_thread = std::thread(&StreamServer::StreamThread, this, stream.get());
+    }
+    for (auto& stream : m_streams)
+    {
+        if (stream->m_thread.joinable())
+            stream->m_thread.join();
+    }
+    m_trackerPool->Wait();
+    m_workTime = cv::getTickCount() - t1;
+    return true;
+}
+
+///
+/// \brief StreamServer::Stop
+///
+void StreamServer::Stop()
+{
+    m_stop = true;
+}
+
+///
+/// \brief StreamServer::StreamThread
+/// \param stream
+///
+void StreamServer::StreamThread(Stream* stream)
+{
+    // The frames of the stream are allocated by this thread: on the NUMA node of its placement
+    m_settings.m_placement.Apply("stream", static_cast<int>(stream->m_id));
+
+    cv::Mat frame = stream->m_firstFrame;
+    stream->m_firstFrame.release();
+
+    bool degraded = false;
+    std::vector<cv::Rect> trackRects;
+    std::vector<DetectionScheduler::Placement> placements;
+    cv::UMat image;
+
+    for (size_t frameInd = 0; !m_stop; ++frameInd)
+    {
+        if (frame.empty())
+        {
+            stream->m_capture >> frame;
+            if (frame.empty())
+                break;
+        }
+        ++stream->m_capturedFrames;
+
+        // The frame goes to the asynchronous tracker, so the next frame is captured to the new buffer
+        cv::UMat uframe;
+        frame.copyTo(uframe);
+        frame.release();
+
+        // The Low stream reduces its load while the detector is contended: the keyframes and the areas of the tracks are detected
+        regions_t regions;
+        if (stream->m_scheduler && m_detectionService->Contended())
+        {
+            if (!degraded)
+                stream->m_scheduler->Reset();
+            degraded = true;
+            {
+                std::lock_guard<std::mutex> lock(stream->m_framesMutex);
+                trackRects = stream->m_trackRects;
+            }
+            stream->m_scheduler->Prepare(uframe, trackRects, image, placements);
+            regions_t imageRegions = m_detectionService->Push(stream->m_id, image).get();
+            stream->m_scheduler->Restore(imageRegions, placements, regions);
+            if (!placements.empty())
+                ++stream->m_degradedFrames;
+        }
+        else
+        {
+            degraded = false;
+            regions = m_detectionService->Push(stream->m_id, uframe).get();
+        }
+        image.release();
+
+        {
+            std::lock_guard<std::mutex> lock(stream->m_framesMutex);
+            stream->m_framesInTracker.push_back(frameInd);
+        }
+        if (m_embeddingsPool)
+        {
+            std::vector<RegionEmbedding> embeddings = m_embeddingsPool->Calc(regions, uframe).get();
+            m_trackerPool->Submit(stream->m_id, regions, std::move(embeddings), uframe, stream->m_fps);
+        }
+        else
+        {
+            m_trackerPool->Submit(stream->m_id, regions, uframe, stream->m_fps);
+        }
+    }
+    std::cout << "Stream " << stream->m_id << " finished: " << stream->m_capturedFrames.load() << " frames" << std::endl;
+}
+
+///
+/// \brief StreamServer::PrintStat
+///
+void StreamServer::PrintStat() const
+{
+    const double workTime = m_workTime / cv::getTickFrequency();
+    size_t framesCount = 0;
+    for (const auto& stream : m_streams)
+    {
+        std::cout << "Stream " << stream->m_id << ": captured " << stream->m_capturedFrames.load() << ", tracked " << stream->m_trackedFrames.load() << " frames";
+        if (stream->m_scheduler)
+            std::cout << ", " << stream->m_degradedFrames.load() << " frames by the areas of the tracks";
+        std::cout << std::endl;
+        framesCount += stream->m_trackedFrames.load();
+    }
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "Streams " << m_streams.size() << ": " << framesCount << " frames in " << workTime << " s, " << (workTime > 0 ? (framesCount / workTime) : 0.) << " fps" << std::endl;
+    if (m_detectionService)
+    {
+        BatchDetectionService::Stat stat = m_detectionService->GetStat();
+        std::cout << "Detector: " << stat.m_batches << " batches of max " << m_detectionService->MaxBatchSize() << ", " << stat.m_frames << " frames, "
+                  << stat.m_timeoutBatches << " batches by timeout, " << stat.m_deadlineMisses << " deadline misses" << std::endl;
+    }
+    // Latency of the stages from the metrics registry
+    for (const auto& sample : metrics::Registry::Instance().Collect())
+    {
+        if (sample.m_type == metrics::Registry::Type::Histogram && sample.m_histogram.m_count)
+            std::cout << sample.m_name << ": " << sample.m_histogram.m_count << " calls, mean " << sample.m_histogram.MeanMs() << " ms, p50 <= "
+                      << sample.m_histogram.QuantileMs(0.5) << " ms, p99 <= " << sample.m_histogram.QuantileMs(0.99) << " ms" << std::endl;
+    }
+    std::cout << std::defaultfloat;
+}
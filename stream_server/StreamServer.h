@@ -0,0 +1,138 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <functional>
+
+#include <opencv2/opencv.hpp>
+
+#include "BaseDetector.h"
+#include "BatchDetectionService.h"
+#include "DetectionScheduler.h"
+#include "TrackerPool.h"
+#include "EmbeddingsPool.h"
+#include "thread_affinity.h"
+
+// ----------------------------------------------------------------------
+
+///
+/// \brief The StreamQoS enum
+/// High - the weight 4 and the deadline of the detection, Normal - the weight 1, Low - the weight 0.5 and the detection
+/// of the keyframes and of the areas of the tracks while the detector is contended
+///
+enum class StreamQoS
+{
+    High,
+    Normal,
+    Low
+};
+
+///
+/// \brief The StreamServerSettings struct
+///
+struct StreamServerSettings
+{
+    tracking::Detectors m_detectorType = tracking::Detectors::Yolo_Darknet;
+    config_t m_detectorConfig;                     // "gpuIds" creates the detectors on the several GPUs
+    std::chrono::milliseconds m_maxBatchWait { 20 }; // The longest waiting of the frame for the full batch of the streams
+    TrackerSettings m_trackerSettings;
+    size_t m_trackerWorkers = 0;                   // 0 - hardware concurrency
+    size_t m_reidWorkers = 1;
+    affinity::Placement m_placement;               // Stages "stream<id>" (capture, the frames buffers), "detect" and "tracker<worker>"
+    std::vector<StreamQoS> m_streamsQoS;           // By the stream index, Normal for the others
+    std::chrono::milliseconds m_highDeadline { 40 }; // Detection deadline of the High streams
+    int m_degradedKeyframes = 10;                  // Keyframe interval of the Low streams under the contention
+};
+
+///
+/// \brief The StreamServer class
+/// Many video streams in one process: the frames of the all streams are detected by one BatchDetectionService
+/// (the cross-stream batches), the embeddings are calculated by one EmbeddingsPool and the streams trackers run on
+/// one TrackerPool. So the detector and the re-identification networks are loaded once for the all cameras.
+/// The every stream has the capture thread with one frame in the detection, the tracking is asynchronous.
+/// The streams share the detector by their StreamQoS: the important cameras keep the latency as the load grows
+///
+class StreamServer
+{
+public:
+    ///
+    /// \brief ResultCallback
+    /// Called from a worker thread of the TrackerPool after the every tracked frame of the stream in the order of the frames
+    ///
+    typedef std::function<void(stream_id_t streamId, size_t frameInd, const std::vector<TrackingObject>& tracks)> ResultCallback;
+
+    StreamServer(const StreamServerSettings& settings, ResultCallback callback);
+    StreamServer(const StreamServer&) = delete;
+    StreamServer& operator=(const StreamServer&) = delete;
+    ~StreamServer();
+
+    ///
+    /// \brief AddStream
+    /// Opens the stream, it's processed after Run
+    /// \param source - file, url or camera index
+    /// \param streamId
+    /// \return
+    ///
+    bool AddStream(const std::string& source, stream_id_t& streamId);
+
+    ///
+    /// \brief Run
+    /// Processes the streams until their end or Stop
+    /// \return false if the detector wasn't created
+    ///
+    bool Run();
+
+    ///
+    /// \brief Stop
+    /// Can be called from the other thread
+    ///
+    void Stop();
+
+    ///
+    /// \brief PrintStat
+    ///
+    void PrintStat() const;
+
+private:
+    StreamServerSettings m_settings;
+    ResultCallback m_callback;
+
+    ///
+    /// \brief The Stream struct
+    ///
+    struct Stream
+    {
+        stream_id_t m_id = 0;
+        std::string m_source;
+        cv::VideoCapture m_capture;
+        cv::Mat m_firstFrame;
+        float m_fps = 25.f;
+        StreamQoS m_qos = StreamQoS::Normal;
+        std::unique_ptr<DetectionScheduler> m_scheduler; // Only for the Low streams
+        std::atomic<size_t> m_degradedFrames { 0 };     // Detected by the areas of the tracks
+
+        std::thread m_thread;
+        std::atomic<size_t> m_capturedFrames { 0 };
+        std::atomic<size_t> m_trackedFrames { 0 };
+
+        std::mutex m_framesMutex;
+        std::deque<size_t> m_framesInTracker; // Indices of the frames submitted to the TrackerPool
+        std::vector<cv::Rect> m_trackRects;    // Of the last tracked frame
+    };
+    std::vector<std::unique_ptr<Stream>> m_streams;
+
+    std::unique_ptr<BatchDetectionService> m_detectionService;
+    std::unique_ptr<EmbeddingsPool> m_embeddingsPool;
+    std::unique_ptr<TrackerPool> m_trackerPool;
+
+    std::atomic<bool> m_stop { false };
+    int64 m_workTime = 0;
+
+    void StreamThread(Stream* stream);
+};
@@ -0,0 +1,113 @@
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+#include <opencv2/opencv.hpp>
+#include <opencv2/core/ocl.hpp>
+
+#include "BatchRunner.h"
+#include "task_scheduler.h"
+
+// ----------------------------------------------------------------------
+
+static void Help()
+{
+    printf("\nOffline batch runner of the video archives: the files are decoded concurrently and detected by the shared batches\n"
+           "Usage: \n"
+           "          ./BatchRunner <comma separated files or text file with the file per line> [--settings]=<ini file> [--tensorrt]=<Yolo TensorRT detector> [--gpu_ids]=<GPUs of the detector> [--batch_wait]=<milliseconds> [--files]=<concurrent files> [--in_flight]=<frames of the file in the detection> [--reid_workers]=<threads> [--out]=<directory of the results> [--journal]=<file of the finished files> [--write_n_frame]=<frames> [--threads]=<threads of the task scheduler> \n\n"
+           );
+}
+
+const char* keys =
+{
+    "{ @1              |../data/atrium.avi  | Comma separated video files or text file with the file per line | }"
+    "{ s settings      |../data/settings.ini | Ini file with the detector and tracker settings | }"
+    "{ trt tensorrt    |0                   | Yolo TensorRT detector instead of Darknet | }"
+    "{ gi gpu_ids      |                    | Comma separated GPU ids of the detector, empty for the gpu_id of the settings | }"
+    "{ bw batch_wait   |50                  | Longest waiting of the frame for the full batch of the files in milliseconds | }"
+    "{ f files         |0                   | Concurrently processed files, 0 - twice the max batch of the detector | }"
+    "{ if in_flight    |2                   | Decoded frames of the every file in the detection | }"
+    "{ rw reid_workers |1                   | Threads of the re-identification networks pool | }"
+    "{ o out           |.                   | Directory of the results: <source path with '_' instead of the separators>.bin | }"
+    "{ j journal       |                    | Finished files for the resume after the interruption, empty - <out>/batch_journal.txt | }"
+    "{ wf write_n_frame |1                  | Write the tracks of the every N frame | }"
+    "{ g gpu           |0                   | Use OpenCL acceleration | }"
+    "{ th threads      |0                   | Threads of the task scheduler shared by the parallel loops of the library and OpenCV, 0 - hardware concurrency | }"
+};
+
+///
+/// \brief ReadSources
+/// \param arg
+/// \return
+///
+static std::vector<std::string> ReadSources(const std::string& arg)
+{
+    std::vector<std::string> sources;
+    std::ifstream file;
+    if (arg.size() > 4 && arg.compare(arg.size() - 4, 4, ".txt") == 0)
+        file.open(arg);
+
+    std::istringstream list(arg);
+    std::istream& in = file.is_open() ? static_cast<std::istream&>(file) : static_cast<std::istream&>(list);
+    std::string source;
+    while (std::getline(in, source, file.is_open() ? '\n' : ','))
+    {
+        source.erase(0, source.find_first_not_of(" \t\r"));
+        source.erase(source.find_last_not_of(" \t\r") + 1);
+        if (!source.empty())
+            sources.push_back(source);
+    }
+    return sources;
+}
+
+// ----------------------------------------------------------------------
+
+int main(int argc, char** argv)
+{
+    Help();
+
+    cv::CommandLineParser parser(argc, argv, keys);
+
+    bool useOCL = parser.get<int>("gpu") ? 1 : 0;
+    cv::ocl::setUseOpenCL(useOCL);
+    std::cout << (cv::ocl::useOpenCL() ? "OpenCL is enabled" : "OpenCL not used") << std::endl;
+
+    tasks::InstallOpenCVBackend(static_cast<size_t>(std::max(0, parser.get<int>("threads"))));
+
+    BatchRunnerSettings settings;
+    if (!ParseTrackerSettings(parser.get<std::string>("settings"), settings.m_trackerSettings))
+    {
+        std::cerr << "Can't read settings " << parser.get<std::string>("settings") << std::endl;
+        return 1;
+    }
+    const TrackerSettings& ts = settings.m_trackerSettings;
+    settings.m_detectorType = parser.get<int>("tensorrt") ? tracking::Detectors::Yolo_TensorRT : tracking::Detectors::Yolo_Darknet;
+    settings.m_detectorConfig.emplace("modelConfiguration", ts.m_nnConfig);
+    settings.m_detectorConfig.emplace("modelBinary", ts.m_nnWeights);
+    settings.m_detectorConfig.emplace("confidenceThreshold", std::to_string(ts.m_confidenceThreshold));
+    settings.m_detectorConfig.emplace("classNames", ts.m_classNames);
+    settings.m_detectorConfig.emplace("maxCropRatio", std::to_string(ts.m_maxCropRatio));
+    settings.m_detectorConfig.emplace("maxBatch", std::to_string(ts.m_maxBatch));
+    settings.m_detectorConfig.emplace("gpuId", std::to_string(ts.m_gpuId));
+    settings.m_detectorConfig.emplace("net_type", ts.m_netType);
+    settings.m_detectorConfig.emplace("inference_precison", ts.m_inferencePrecison);
+    std::string gpuIds = parser.get<std::string>("gpu_ids");
+    if (!gpuIds.empty())
+        settings.m_detectorConfig.emplace("gpuIds", gpuIds);
+    settings.m_maxBatchWait = std::chrono::milliseconds(std::max(0, parser.get<int>("batch_wait")));
+    settings.m_concurrentFiles = static_cast<size_t>(std::max(0, parser.get<int>("files")));
+    settings.m_framesInFlight = static_cast<size_t>(std::max(1, parser.get<int>("in_flight")));
+    settings.m_reidWorkers = static_cast<size_t>(std::max(1, parser.get<int>("reid_workers")));
+    settings.m_outDir = parser.get<std::string>("out");
+    settings.m_journalFile = parser.get<std::string>("journal");
+    settings.m_writeEachNFrame = std::max(1, parser.get<int>("write_n_frame"));
+
+    BatchRunner runner(settings);
+    runner.AddFiles(ReadSources(parser.get<std::string>(0)));
+    if (!runner.Run())
+        return 1;
+    runner.PrintStat();
+
+    std::cout << "Correct exit" << std::endl;
+    return 0;
+}
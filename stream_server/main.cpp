@@ -0,0 +1,174 @@
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+#include <opencv2/opencv.hpp>
+#include <opencv2/core/ocl.hpp>
+
+#include "StreamServer.h"
+#include "task_scheduler.h"
+
+// ----------------------------------------------------------------------
+
+static void Help()
+{
+    printf("\nMulti-stream server: one detector and re-identification pool for the all streams\n"
+           "Usage: \n"
+           "          ./StreamServer <comma separated sources or text file with the source per line> [--settings]=<ini file> [--tensorrt]=<Yolo TensorRT detector> [--gpu_ids]=<GPUs of the detector> [--batch_wait]=<milliseconds> [--tracker_workers]=<threads> [--reid_workers]=<threads> [--out]=<prefix of the csv files> [--metrics_file]=<prometheus text file> [--affinity]=<placement of the threads> [--threads]=<threads of the task scheduler> [--qos]=<high, normal or low by the streams> [--qos_deadline]=<milliseconds> [--degraded_keyframes]=<frames> \n\n"
+           );
+}
+
+const char* keys =
+{
+    "{ @1              |../data/atrium.avi  | Comma separated sources (files, urls, camera indices) or text file with the source per line | }"
+    "{ s settings      |../data/settings.ini | Ini file with the detector and tracker settings | }"
+    "{ trt tensorrt    |0                   | Yolo TensorRT detector instead of Darknet | }"
+    "{ gi gpu_ids      |                    | Comma separated GPU ids of the detector, <gpu>:dla<core> for the TensorRT engine on the DLA core of Jetson (0,0:dla0,0:dla1), empty for the gpu_id of the settings | }"
+    "{ bw batch_wait   |20                  | Longest waiting of the frame for the full batch of the streams in milliseconds | }"
+    "{ tw tracker_workers |0                | Threads of the trackers pool, 0 - hardware concurrency | }"
+    "{ rw reid_workers |1                   | Threads of the re-identification networks pool | }"
+    "{ o out           |                    | Prefix of the csv files with the tracks of the streams: <out><stream>.csv | }"
+    "{ g gpu           |0                   | Use OpenCL acceleration | }"
+    "{ mf metrics_file |                   | Prometheus text file with the metrics of the detector, tracker and queues for the node_exporter textfile collector, it's rewritten every second | }"
+    "{ af affinity     |                    | CPU affinity of the threads: stage=cpus[/OpenMP threads] separated by ';', the stages stream<id>, detect, tracker<worker> and * (the others), the cpus 0-3,8 or node1 | }"
+    "{ th threads      |0                   | Threads of the task scheduler shared by the parallel loops of the library and OpenCV, 0 - hardware concurrency | }"
+    "{ qos             |                    | Comma separated QoS classes of the streams in their order: high (weight 4 and the deadline), normal, low (weight 0.5 and the detection of the areas of the tracks under the contention) | }"
+    "{ qd qos_deadline |40                  | Detection deadline of the high streams in milliseconds | }"
+    "{ dk degraded_keyframes |10            | Keyframe interval of the low streams while the detector is contended | }"
+};
+
+///
+/// \brief ReadSources
+/// \param arg
+/// \return
+///
+static std::vector<std::string> ReadSources(const std::string& arg)
+{
+    std::vector<std::string> sources;
+    std::ifstream file;
+    if (arg.size() > 4 && arg.compare(arg.size() - 4, 4, ".txt") == 0)
+        file.open(arg);
+
+    std::istringstream list(arg);
+    std::istream& in = file.is_open() ? static_cast<std::istream&>(file) : static_cast<std::istream&>(list);
+    std::string source;
+    while (std::getline(in, source, file.is_open() ? '\n' : ','))
+    {
+        source.erase(0, source.find_first_not_of(" \t\r"));
+        source.erase(source.find_last_not_of(" \t\r") + 1);
+        if (!source.empty())
+            sources.push_back(source);
+    }
+    return sources;
+}
+
+///
+/// \brief ParseQoS
+/// \param arg
+/// \param qos
+/// \return
+///
+static bool ParseQoS(const std::string& arg, std::vector<StreamQoS>& qos)
+{
+    std::istringstream list(arg);
+    std::string name;
+    while (std::getline(list, name, ','))
+    {
+        name.erase(0, name.find_first_not_of(" \t"));
+        name.erase(name.find_last_not_of(" \t") + 1);
+        if (name == "high")
+            qos.push_back(StreamQoS::High);
+        else if (name == "normal" || name.empty())
+            qos.push_back(StreamQoS::Normal);
+        else if (name == "low")
+            qos.push_back(StreamQoS::Low);
+        else
+        {
+            std::cerr << "Unknown QoS class of the stream " << qos.size() << ": " << name << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// ----------------------------------------------------------------------
+
+int main(int argc, char** argv)
+{
+    Help();
+
+    cv::CommandLineParser parser(argc, argv, keys);
+
+    bool useOCL = parser.get<int>("gpu") ? 1 : 0;
+    cv::ocl::setUseOpenCL(useOCL);
+    std::cout << (cv::ocl::useOpenCL() ? "OpenCL is enabled" : "OpenCL not used") << std::endl;
+
+    tasks::InstallOpenCVBackend(static_cast<size_t>(std::max(0, parser.get<int>("threads"))));
+
+    StreamServerSettings settings;
+    if (!ParseTrackerSettings(parser.get<std::string>("settings"), settings.m_trackerSettings))
+    {
+        std::cerr << "Can't read settings " << parser.get<std::string>("settings") << std::endl;
+        return 1;
+    }
+    const TrackerSettings& ts = settings.m_trackerSettings;
+    settings.m_detectorType = parser.get<int>("tensorrt") ? tracking::Detectors::Yolo_TensorRT : tracking::Detectors::Yolo_Darknet;
+    settings.m_detectorConfig.emplace("modelConfiguration", ts.m_nnConfig);
+    settings.m_detectorConfig.emplace("modelBinary", ts.m_nnWeights);
+    settings.m_detectorConfig.emplace("confidenceThreshold", std::to_string(ts.m_confidenceThreshold));
+    settings.m_detectorConfig.emplace("classNames", ts.m_classNames);
+    settings.m_detectorConfig.emplace("maxCropRatio", std::to_string(ts.m_maxCropRatio));
+    settings.m_detectorConfig.emplace("maxBatch", std::to_string(ts.m_maxBatch));
+    settings.m_detectorConfig.emplace("gpuId", std::to_string(ts.m_gpuId));
+    settings.m_detectorConfig.emplace("net_type", ts.m_netType);
+    settings.m_detectorConfig.emplace("inference_precison", ts.m_inferencePrecison);
+    std::string gpuIds = parser.get<std::string>("gpu_ids");
+    if (!gpuIds.empty())
+        settings.m_detectorConfig.emplace("gpuIds", gpuIds);
+    settings.m_maxBatchWait = std::chrono::milliseconds(std::max(0, parser.get<int>("batch_wait")));
+    settings.m_trackerWorkers = static_cast<size_t>(std::max(0, parser.get<int>("tracker_workers")));
+    settings.m_reidWorkers = static_cast<size_t>(std::max(1, parser.get<int>("reid_workers")));
+    if (!settings.m_placement.Parse(parser.get<std::string>("affinity")))
+        return 1;
+    if (!ParseQoS(parser.get<std::string>("qos"), settings.m_streamsQoS))
+        return 1;
+    settings.m_highDeadline = std::chrono::milliseconds(std::max(0, parser.get<int>("qos_deadline")));
+    settings.m_degradedKeyframes = std::max(1, parser.get<int>("degraded_keyframes"));
+
+    // Results of the every stream are published to own csv: frame,ID,x,y,width,height,type,confidence
+    std::string outPrefix = parser.get<std::string>("out");
+    std::vector<std::unique_ptr<std::ofstream>> outFiles;
+    StreamServer server(settings, [&outFiles](stream_id_t streamId, size_t frameInd, const std::vector<TrackingObject>& tracks)
+    {
+        if (streamId >= outFiles.size() || !outFiles[streamId])
+            return;
+        std::ofstream& out = *outFiles[streamId];
+        for (const auto& track : tracks)
+        {
+            cv::Rect brect = track.m_rrect.boundingRect();
+            out << frameInd << "," << track.m_ID.ID2Str() << "," << brect.x << "," << brect.y << "," << brect.width << "," << brect.height << ","
+                << TypeConverter::Type2Str(track.m_type) << "," << track.m_confidence << "\n";
+        }
+    });
+
+    for (const auto& source : ReadSources(parser.get<std::string>(0)))
+    {
+        stream_id_t streamId = 0;
+        if (server.AddStream(source, streamId) && !outPrefix.empty())
+        {
+            outFiles.resize(streamId + 1);
+            outFiles[streamId] = std::make_unique<std::ofstream>(outPrefix + std::to_string(streamId) + ".csv");
+        }
+    }
+
+    std::unique_ptr<metrics::TextFileExporter> metricsExporter;
+    if (!parser.get<std::string>("metrics_file").empty())
+        metricsExporter = std::make_unique<metrics::TextFileExporter>(parser.get<std::string>("metrics_file"), std::chrono::milliseconds(1000));
+
+    if (!server.Run())
+        return 1;
+    server.PrintStat();
+
+    std::cout << "Correct exit" << std::endl;
+    return 0;
+}
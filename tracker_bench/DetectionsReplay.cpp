@@ -0,0 +1,250 @@
+#include <fstream>
+#include <iostream>
+#include <cstdlib>
+#include <map>
+
+#include "DetectionsReplay.h"
+#include "FileLogger.h"
+#include "FlightRecorder.h"
+
+///
+/// \brief DetectionsReplay::Open
+/// \param fileName
+/// \param format
+/// \param minConfidence
+/// \return
+///
+bool DetectionsReplay::Open(const std::string& fileName, Format format, float minConfidence)
+{
+    m_frames.clear();
+    m_frameSize = cv::Size();
+    m_detectionsCount = 0;
+    m_settingsHash = 0;
+
+    if (format == Format::Auto)
+    {
+        if (ResultsLog::HasExtension(fileName, ".bin"))
+            format = Format::ResultsBinary;
+        else if (ResultsLog::HasExtension(fileName, ".txt"))
+            format = Format::MOTChallenge;
+        else if (ResultsLog::HasExtension(fileName, ".mtfr"))
+            format = Format::FlightRecord;
+        else
+            format = Format::ResultsCsv;
+    }
+
+    bool res = false;
+    switch (format)
+    {
+    case Format::ResultsBinary:
+        res = ReadBinary(fileName, minConfidence);
+        break;
+    case Format::MOTChallenge:
+        res = ReadMOTChallenge(fileName, minConfidence);
+        break;
+    case Format::FlightRecord:
+        res = ReadFlightRecord(fileName);
+        break;
+    default:
+        res = ReadCsv(fileName, minConfidence);
+        break;
+    }
+    if (!res)
+        std::cerr << "DetectionsReplay: can't read " << fileName << std::endl;
+    return res && !m_frames.empty();
+}
+
+///
+/// \brief DetectionsReplay::AddDetection
+/// The files are written by the frames but the order isn't required
+/// \param frameInd
+/// \param region
+/// \param minConfidence
+///
+void DetectionsReplay::AddDetection(int frameInd, const CRegion& region, float minConfidence)
+{
+    if (frameInd < 0)
+        return;
+
+    if (m_frames.empty())
+    {
+        m_frames.emplace_back();
+        m_frames.back().m_frameInd = frameInd;
+    }
+    else if (frameInd < m_frames.front().m_frameInd)
+    {
+        const size_t prepend = static_cast<size_t>(m_frames.front().m_frameInd - frameInd);
+        m_frames.insert(m_frames.begin(), prepend, Frame());
+        for (size_t i = 0; i < prepend; ++i)
+        {
+            m_frames[i].m_frameInd = frameInd + static_cast<int>(i);
+        }
+    }
+    while (m_frames.back().m_frameInd < frameInd)
+    {
+        const int next = m_frames.back().m_frameInd + 1;
+        m_frames.emplace_back();
+        m_frames.back().m_frameInd = next;
+    }
+
+    if (region.m_confidence < minConfidence || region.m_brect.width <= 0 || region.m_brect.height <= 0)
+        return;
+    m_frames[static_cast<size_t>(frameInd - m_frames.front().m_frameInd)].m_regions.push_back(region);
+    m_frameSize.width = std::max(m_frameSize.width, region.m_brect.x + region.m_brect.width);
+    m_frameSize.height = std::max(m_frameSize.height, region.m_brect.y + region.m_brect.height);
+    ++m_detectionsCount;
+}
+
+///
+/// \brief DetectionsReplay::ExtendFrames
+/// \param firstFrame
+/// \param lastFrame
+///
+void DetectionsReplay::ExtendFrames(int firstFrame, int lastFrame)
+{
+    firstFrame = std::max(0, firstFrame);
+    if (m_frames.empty())
+    {
+        if (lastFrame < firstFrame)
+            return;
+        m_frames.emplace_back();
+        m_frames.back().m_frameInd = firstFrame;
+    }
+    if (firstFrame < m_frames.front().m_frameInd)
+    {
+        const size_t prepend = static_cast<size_t>(m_frames.front().m_frameInd - firstFrame);
+        m_frames.insert(m_frames.begin(), prepend, Frame());
+        for (size_t i = 0; i < prepend; ++i)
+        {
+            m_frames[i].m_frameInd = firstFrame + static_cast<int>(i);
+        }
+    }
+    while (m_frames.back().m_frameInd < lastFrame)
+    {
+        const int next = m_frames.back().m_frameInd + 1;
+        m_frames.emplace_back();
+        m_frames.back().m_frameInd = next;
+    }
+}
+
+///
+/// \brief DetectionsReplay::ReadCsv
+/// \param fileName
+/// \param minConfidence
+/// \return
+///
+bool DetectionsReplay::ReadCsv(const std::string& fileName, float minConfidence)
+{
+    ResultsReader reader(fileName);
+    if (!reader.Open())
+        return false;
+
+    ResultsReader::Detection detect;
+    std::string line;
+    while (reader.Read(detect, line))
+    {
+        AddDetection(detect.m_frame, CRegion(detect.m_rect, detect.m_type, detect.m_conf), minConfidence);
+    }
+    return true;
+}
+
+///
+/// \brief DetectionsReplay::ReadBinary
+/// \param fileName
+/// \param minConfidence
+/// \return
+///
+bool DetectionsReplay::ReadBinary(const std::string& fileName, float minConfidence)
+{
+    // All detections: the robust flag is the decision of the recorded tracker, the replayed tracker makes own
+    BinaryResultsReader reader(fileName);
+    if (!reader.Open(false))
+        return false;
+
+    BinaryRecord record;
+    while (reader.Read(record))
+    {
+        const objtype_t type = (record.m_type < 0) ? bad_type : static_cast<objtype_t>(record.m_type);
+        AddDetection(record.m_frame, CRegion(cv::Rect(record.m_x, record.m_y, record.m_width, record.m_height), type, record.m_conf), minConfidence);
+    }
+    return true;
+}
+
+///
+/// \brief DetectionsReplay::ReadMOTChallenge
+/// det.txt: frame,id,bb_left,bb_top,bb_width,bb_height,conf,x,y,z with the frames from 1, the detections are persons
+/// \param fileName
+/// \param minConfidence
+/// \return
+///
+bool DetectionsReplay::ReadMOTChallenge(const std::string& fileName, float minConfidence)
+{
+    std::ifstream file(fileName);
+    if (!file.is_open())
+        return false;
+
+    const objtype_t personType = TypeConverter::Str2Type("person");
+    std::string line;
+    size_t lineNum = 0;
+    while (std::getline(file, line))
+    {
+        ++lineNum;
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        const char* str = line.c_str();
+        char* end = nullptr;
+        double vals[7];
+        size_t i = 0;
+        for (; i < 7; ++i)
+        {
+            vals[i] = std::strtod(str, &end);
+            if (end == str)
+                break;
+            str = end;
+            while (*str == ',' || *str == ' ' || *str == '\t')
+            {
+                ++str;
+            }
+        }
+        if (i < 7)
+        {
+            std::cerr << "DetectionsReplay: " << fileName << ":" << lineNum << " wrong line \"" << line << "\"" << std::endl;
+            continue;
+        }
+        const cv::Rect rect(cvRound(vals[2]), cvRound(vals[3]), cvRound(vals[4]), cvRound(vals[5]));
+        AddDetection(static_cast<int>(vals[0]), CRegion(rect, personType, static_cast<float>(vals[6])), minConfidence);
+    }
+    return true;
+}
+
+///
+/// \brief DetectionsReplay::ReadFlightRecord
+/// The updates are replayed as they were recorded, so the detections aren't filtered by the confidence
+/// \param fileName
+/// \return
+///
+bool DetectionsReplay::ReadFlightRecord(const std::string& fileName)
+{
+    std::vector<flight::Record> records;
+    if (!flight::Load(fileName, m_settingsHash, records))
+        return false;
+
+    m_frames.resize(records.size());
+    for (size_t i = 0; i < records.size(); ++i)
+    {
+        flight::Record& record = records[i];
+        Frame& frame = m_frames[i];
+        frame.m_frameInd = static_cast<int>(record.m_updateInd);
+        frame.m_regions = std::move(record.m_regions);
+        frame.m_embeddings = std::move(record.m_embeddings);
+        frame.m_fps = record.m_fps;
+        frame.m_timestamp = record.m_timestamp;
+        frame.m_image = record.m_frame;
+
+        m_frameSize.width = std::max(m_frameSize.width, record.m_frameSize.width);
+        m_frameSize.height = std::max(m_frameSize.height, record.m_frameSize.height);
+        m_detectionsCount += frame.m_regions.size();
+    }
+    return true;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "defines.h"
+
+///
+/// \brief The DetectionsReplay class
+/// Recorded detections for the tracker without the detector: the csv of ResultsLog (frame,type,x,y,width,height,confidence,ID),
+/// the binary ".bin" of BinaryResultsWriter, MOTChallenge det.txt (frame,id,x,y,width,height,confidence,...)
+/// or the ".mtfr" dump of the flight recorder with the embeddings, the fps and the downscaled frames of the recorded tracker.
+/// The file is loaded to the memory by Open, so the replay doesn't measure the reading
+///
+class DetectionsReplay
+{
+public:
+    ///
+    /// \brief The Format enum
+    ///
+    enum class Format
+    {
+        Auto = 0,
+        ResultsCsv,
+        ResultsBinary,
+        MOTChallenge,
+        FlightRecord
+    };
+
+    ///
+    /// \brief Open
+    /// \param fileName
+    /// \param format - Auto: ".bin" is binary, ".txt" is MOTChallenge, ".mtfr" is the flight record, others are csv
+    /// \param minConfidence - the weaker detections are skipped
+    /// \return
+    ///
+    bool Open(const std::string& fileName, Format format, float minConfidence);
+
+    ///
+    /// \brief The Frame struct
+    ///
+    struct Frame
+    {
+        int m_frameInd = 0;
+        regions_t m_regions;
+
+        // Only in the flight record
+        std::vector<RegionEmbedding> m_embeddings; // Empty if the tracker calculates them
+        float m_fps = 0;
+        double m_timestamp = -1.;                  // Of UpdateAt, negative for Update by the fps
+        cv::Mat m_image;                           // Downscaled frame or empty
+    };
+
+    ///
+    /// \brief Frames
+    /// \return All frames from the first to the last detection, the frames without detections have the empty regions
+    ///
+    const std::vector<Frame>& Frames() const
+    {
+        return m_frames;
+    }
+
+    ///
+    /// \brief FrameSize
+    /// \return Bounding size of the all detections, it's used if the video isn't replayed
+    ///
+    cv::Size FrameSize() const
+    {
+        return m_frameSize;
+    }
+
+    ///
+    /// \brief DetectionsCount
+    /// \return
+    ///
+    size_t DetectionsCount() const
+    {
+        return m_detectionsCount;
+    }
+
+    ///
+    /// \brief ExtendFrames
+    /// Adds the empty frames before the first and after the last detection: the sequence without detections at the ends
+    /// \param firstFrame
+    /// \param lastFrame
+    ///
+    void ExtendFrames(int firstFrame, int lastFrame);
+
+    ///
+    /// \brief SettingsHash
+    /// \return Hash of the ini file of the recorded tracker, 0 if it's unknown or it isn't the flight record
+    ///
+    uint64_t SettingsHash() const
+    {
+        return m_settingsHash;
+    }
+
+private:
+    std::vector<Frame> m_frames;
+    cv::Size m_frameSize;
+    size_t m_detectionsCount = 0;
+    uint64_t m_settingsHash = 0;
+
+    void AddDetection(int frameInd, const CRegion& region, float minConfidence);
+    bool ReadCsv(const std::string& fileName, float minConfidence);
+    bool ReadBinary(const std::string& fileName, float minConfidence);
+    bool ReadMOTChallenge(const std::string& fileName, float minConfidence);
+    bool ReadFlightRecord(const std::string& fileName);
+};
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <map>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <iostream>
+#include <algorithm>
+
+///
+/// Minimal harness of the microbenchmarks: the iterations count is calibrated to the min time,
+/// the median and min of the repetitions are reported and compared with the baseline csv of the previous run
+///
+namespace microbench
+{
+///
+/// \brief DoNotOptimize
+/// The result of the benchmarked code escapes to the memory, so the compiler doesn't remove the calculation
+///
+template<typename T>
+inline void DoNotOptimize(const T& value)
+{
+    static const void* volatile sink = nullptr;
+    sink = &value;
+}
+
+///
+/// \brief The Result struct
+///
+struct Result
+{
+    std::string m_name;
+    size_t m_iterations = 0;
+    double m_medianNs = 0;  // Per item
+    double m_minNs = 0;
+};
+
+///
+/// \brief The Runner class
+///
+class Runner
+{
+public:
+    ///
+    /// \brief Runner
+    /// \param minTimeMs - total time of the one benchmark
+    /// \param repetitions - median of the repetitions is reported
+    /// \param filter - only the benchmarks with the names containing the filter
+    ///
+    Runner(double minTimeMs, size_t repetitions, const std::string& filter)
+        : m_minTimeMs(std::max(1., minTimeMs)), m_repetitions(std::max<size_t>(1, repetitions)), m_filter(filter)
+    {
+        std::cout << std::left << std::setw(56) << "benchmark" << std::right << std::setw(12) << "iterations" << std::setw(14) << "median ns" << std::setw(14) << "min ns" << std::setw(10) << "baseline" << std::endl;
+    }
+
+    ///
+    /// \brief Run
+    /// \param name
+    /// \param func - one iteration
+    /// \param itemsPerIteration - the time is reported per item: per pair of the distance kernels, per matrix of the solvers
+    ///
+    template<typename F>
+    void Run(const std::string& name, F&& func, size_t itemsPerIteration = 1)
+    {
+        if (!m_filter.empty() && name.find(m_filter) == std::string::npos)
+            return;
+
+        // Calibration: the batch of the iterations takes at least 1 / repetitions of the min time
+        const double batchMs = m_minTimeMs / m_repetitions;
+        size_t iterations = 1;
+        for (;;)
+        {
+            const double ms = Measure(func, iterations);
+            if (ms >= batchMs || iterations >= (size_t(1) << 30))
+                break;
+            const double scale = (ms > 0) ? std::min(10., 1.2 * batchMs / ms) : 10.;
+            iterations = std::max(iterations + 1, static_cast<size_t>(iterations * scale));
+        }
+
+        std::vector<double> times;
+        times.reserve(m_repetitions);
+        for (size_t i = 0; i < m_repetitions; ++i)
+        {
+            times.push_back(1e6 * Measure(func, iterations) / (iterations * std::max<size_t>(1, itemsPerIteration)));
+        }
+        std::sort(times.begin(), times.end());
+
+        Result result;
+        result.m_name = name;
+        result.m_iterations = iterations;
+        result.m_medianNs = times[times.size() / 2];
+        result.m_minNs = times.front();
+        m_results.push_back(result);
+
+        std::cout << std::left << std::setw(56) << name << std::right << std::setw(12) << iterations << std::fixed << std::setprecision(1)
+                  << std::setw(14) << result.m_medianNs << std::setw(14) << result.m_minNs;
+        auto baseline = m_baseline.find(name);
+        if (baseline != m_baseline.end() && baseline->second > 0)
+            std::cout << std::setw(9) << std::setprecision(2) << (result.m_medianNs / baseline->second) << "x";
+        std::cout << std::defaultfloat << std::endl;
+    }
+
+    ///
+    /// \brief ReadBaseline
+    /// \param fileName - csv of the WriteCsv
+    /// \return
+    ///
+    bool ReadBaseline(const std::string& fileName)
+    {
+        std::ifstream file(fileName);
+        if (!file.is_open())
+            return false;
+        std::string line;
+        std::getline(file, line); // Header
+        while (std::getline(file, line))
+        {
+            std::stringstream ss(line);
+            std::string name, iterations, median;
+            if (std::getline(ss, name, ',') && std::getline(ss, iterations, ',') && std::getline(ss, median, ','))
+                m_baseline[name] = std::atof(median.c_str());
+        }
+        return !m_baseline.empty();
+    }
+
+    ///
+    /// \brief WriteCsv
+    /// \param fileName
+    /// \return
+    ///
+    bool WriteCsv(const std::string& fileName) const
+    {
+        std::ofstream file(fileName, std::ios::trunc);
+        if (!file.is_open())
+            return false;
+        file << "name,iterations,median_ns,min_ns" << std::endl;
+        for (const auto& result : m_results)
+        {
+            file << result.m_name << "," << result.m_iterations << "," << result.m_medianNs << "," << result.m_minNs << std::endl;
+        }
+        return file.good();
+    }
+
+private:
+    double m_minTimeMs = 100;
+    size_t m_repetitions = 5;
+    std::string m_filter;
+    std::vector<Result> m_results;
+    std::map<std::string, double> m_baseline;
+
+    ///
+    template<typename F>
+    static double Measure(F& func, size_t iterations)
+    {
+        const auto t1 = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; ++i)
+        {
+            func();
+        }
+        const auto t2 = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::milli>(t2 - t1).count();
+    }
+};
+}
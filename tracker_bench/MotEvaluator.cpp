@@ -0,0 +1,394 @@
+#include <fstream>
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+#include "MotEvaluator.h"
+
+///
+/// \brief IoU
+/// \param r1
+/// \param r2
+/// \return
+///
+static float IoU(const cv::Rect2f& r1, const cv::Rect2f& r2)
+{
+    const float intersection = (r1 & r2).area();
+    const float unionArea = r1.area() + r2.area() - intersection;
+    return (unionArea > 0) ? (intersection / unionArea) : 0.f;
+}
+
+///
+/// \brief MotMetrics::Add
+/// \param other
+///
+void MotMetrics::Add(const MotMetrics& other)
+{
+    m_gtDets += other.m_gtDets;
+    m_trDets += other.m_trDets;
+    m_matches += other.m_matches;
+    m_idSwitches += other.m_idSwitches;
+    m_iouSum += other.m_iouSum;
+    m_idtp += other.m_idtp;
+    for (size_t a = 0; a < AlphasCount; ++a)
+    {
+        m_hotaTP[a] += other.m_hotaTP[a];
+        m_assSum[a] += other.m_assSum[a];
+        m_locSum[a] += other.m_locSum[a];
+    }
+}
+
+///
+/// \brief MotEvaluator::ReadGroundTruth
+/// \param gtFile
+/// \param mot20
+/// \return
+///
+bool MotEvaluator::ReadGroundTruth(const std::string& gtFile, bool mot20)
+{
+    m_gt.clear();
+    m_mot20 = mot20;
+
+    std::ifstream file(gtFile);
+    if (!file.is_open())
+    {
+        std::cerr << "MotEvaluator: can't open " << gtFile << std::endl;
+        return false;
+    }
+
+    std::string line;
+    size_t lineNum = 0;
+    while (std::getline(file, line))
+    {
+        ++lineNum;
+        if (line.empty())
+            continue;
+
+        const char* str = line.c_str();
+        char* end = nullptr;
+        double vals[8];
+        size_t i = 0;
+        for (; i < 8; ++i)
+        {
+            vals[i] = std::strtod(str, &end);
+            if (end == str)
+                break;
+            str = end;
+            while (*str == ',' || *str == ' ' || *str == '\t')
+            {
+                ++str;
+            }
+        }
+        if (i < 6)
+        {
+            std::cerr << "MotEvaluator: " << gtFile << ":" << lineNum << " wrong line \"" << line << "\"" << std::endl;
+            continue;
+        }
+        GtBox gt;
+        gt.m_box = MotBox(static_cast<int>(vals[1]), cv::Rect2f(static_cast<float>(vals[2]), static_cast<float>(vals[3]), static_cast<float>(vals[4]), static_cast<float>(vals[5])));
+        gt.m_consider = (i < 7) || (vals[6] != 0);
+        gt.m_class = (i < 8) ? 1 : static_cast<int>(vals[7]);
+        m_gt[static_cast<int>(vals[0])].push_back(gt);
+    }
+    return !m_gt.empty();
+}
+
+///
+/// \brief MotEvaluator::IsDistractor
+/// \param cls
+/// \return
+///
+bool MotEvaluator::IsDistractor(int cls) const
+{
+    // person_on_vehicle, static_person, distractor, reflection and non_mot_vehicle in MOT20
+    return cls == 2 || cls == 7 || cls == 8 || cls == 12 || (m_mot20 && cls == 6);
+}
+
+///
+/// \brief MotEvaluator::DenseId
+/// \param idsMap
+/// \param counts
+/// \param id
+/// \return
+///
+int MotEvaluator::DenseId(std::unordered_map<int, int>& idsMap, std::vector<size_t>& counts, int id)
+{
+    auto it = idsMap.emplace(id, static_cast<int>(counts.size()));
+    if (it.second)
+        counts.push_back(0);
+    ++counts[it.first->second];
+    return it.first->second;
+}
+
+///
+/// \brief MotEvaluator::Assign
+/// Maximizes the IoU (or the scores) of the pairs
+/// \param rows
+/// \param cols
+/// \param pairs
+/// \param minIoU - the pairs with the lower IoU aren't assigned, the count of the assigned pairs is maximized at first
+/// \param scores - of the pairs: the sum of the scores is maximized without the forbidden pairs
+/// \param assignment
+///
+void MotEvaluator::Assign(size_t rows, size_t cols, const std::vector<Pair>& pairs, track_t minIoU, const std::vector<double>* scores, assignments_t& assignment)
+{
+    assignment.assign(rows, -1);
+    if (!rows || !cols || pairs.empty())
+        return;
+
+    constexpr track_t forbidden = 2.f;
+    m_costs.Assign(rows, cols, scores ? 1.f : forbidden);
+    for (size_t i = 0; i < pairs.size(); ++i)
+    {
+        const Pair& pair = pairs[i];
+        if (scores)
+            m_costs(pair.m_gt, pair.m_tr) = static_cast<track_t>(1. - (*scores)[i]);
+        else if (pair.m_iou >= minIoU)
+            m_costs(pair.m_gt, pair.m_tr) = 1.f - pair.m_iou;
+    }
+    m_solver.Solve(m_costs, rows, cols, assignment, forbidden);
+
+    // Without the scores the not allowed pairs can't be assigned, with the scores only the real pairs are used
+    for (size_t row = 0; row < rows; ++row)
+    {
+        if (assignment[row] >= 0 && m_costs(row, assignment[row]) >= (scores ? 1.f : forbidden))
+            assignment[row] = -1;
+    }
+}
+
+///
+/// \brief MotEvaluator::AddFrame
+/// \param frameInd
+/// \param tracks
+///
+void MotEvaluator::AddFrame(int frameInd, const std::vector<MotBox>& tracks)
+{
+    static const std::vector<GtBox> noGt;
+    auto gtIt = m_gt.find(frameInd);
+    const std::vector<GtBox>& gtAll = (gtIt != m_gt.end()) ? gtIt->second : noGt;
+
+    // The tracker boxes on the distractors aren't the false positives
+    std::vector<Pair> pairs;
+    for (size_t i = 0; i < gtAll.size(); ++i)
+    {
+        for (size_t j = 0; j < tracks.size(); ++j)
+        {
+            const float iou = IoU(gtAll[i].m_box.m_rect, tracks[j].m_rect);
+            if (iou >= 0.5f)
+                pairs.push_back({ static_cast<int>(i), static_cast<int>(j), iou });
+        }
+    }
+    std::vector<char> removed(tracks.size(), 0);
+    Assign(gtAll.size(), tracks.size(), pairs, 0.5f, nullptr, m_assignment);
+    for (size_t i = 0; i < gtAll.size(); ++i)
+    {
+        if (m_assignment[i] >= 0 && IsDistractor(gtAll[i].m_class))
+            removed[m_assignment[i]] = 1;
+    }
+
+    std::vector<MotBox> gt;
+    for (const auto& box : gtAll)
+    {
+        if (box.m_class == 1 && box.m_consider)
+            gt.push_back(box.m_box);
+    }
+    std::vector<MotBox> tr;
+    for (size_t j = 0; j < tracks.size(); ++j)
+    {
+        if (!removed[j])
+            tr.push_back(tracks[j]);
+    }
+
+    FrameData frame;
+    frame.m_gtIds.reserve(gt.size());
+    for (const auto& box : gt)
+    {
+        frame.m_gtIds.push_back(DenseId(m_gtIdsMap, m_gtIdCount, box.m_id));
+    }
+    frame.m_trIds.reserve(tr.size());
+    for (const auto& box : tr)
+    {
+        frame.m_trIds.push_back(DenseId(m_trIdsMap, m_trIdCount, box.m_id));
+    }
+    for (size_t i = 0; i < gt.size(); ++i)
+    {
+        for (size_t j = 0; j < tr.size(); ++j)
+        {
+            const float iou = IoU(gt[i].m_rect, tr[j].m_rect);
+            if (iou > 0)
+                frame.m_pairs.push_back({ static_cast<int>(i), static_cast<int>(j), iou });
+        }
+    }
+
+    // CLEAR MOT: the matches of the previous frame are kept while IoU >= 0.5
+    m_metrics.m_gtDets += gt.size();
+    m_metrics.m_trDets += tr.size();
+    std::vector<int> gtMatch(gt.size(), -1);
+    std::vector<char> trUsed(tr.size(), 0);
+    for (const auto& pair : frame.m_pairs)
+    {
+        if (pair.m_iou < 0.5f || gtMatch[pair.m_gt] >= 0 || trUsed[pair.m_tr])
+            continue;
+        auto prev = m_prevMatch.find(gt[pair.m_gt].m_id);
+        if (prev != m_prevMatch.end() && prev->second == tr[pair.m_tr].m_id)
+        {
+            gtMatch[pair.m_gt] = pair.m_tr;
+            trUsed[pair.m_tr] = 1;
+        }
+    }
+    pairs.clear();
+    for (const auto& pair : frame.m_pairs)
+    {
+        if (gtMatch[pair.m_gt] < 0 && !trUsed[pair.m_tr])
+            pairs.push_back(pair);
+    }
+    Assign(gt.size(), tr.size(), pairs, 0.5f, nullptr, m_assignment);
+    for (size_t i = 0; i < gt.size(); ++i)
+    {
+        if (gtMatch[i] < 0 && m_assignment[i] >= 0)
+            gtMatch[i] = m_assignment[i];
+    }
+
+    m_prevMatch.clear();
+    for (size_t i = 0; i < gt.size(); ++i)
+    {
+        if (gtMatch[i] < 0)
+            continue;
+        const int trId = tr[gtMatch[i]].m_id;
+        auto last = m_lastMatch.find(gt[i].m_id);
+        if (last != m_lastMatch.end() && last->second != trId)
+            ++m_metrics.m_idSwitches;
+        m_lastMatch[gt[i].m_id] = trId;
+        m_prevMatch[gt[i].m_id] = trId;
+        ++m_metrics.m_matches;
+        m_metrics.m_iouSum += IoU(gt[i].m_rect, tr[gtMatch[i]].m_rect);
+    }
+
+    m_frames.emplace_back(std::move(frame));
+}
+
+///
+/// \brief MotEvaluator::Evaluate
+/// \return
+///
+MotMetrics MotEvaluator::Evaluate()
+{
+    MotMetrics metrics = m_metrics;
+    auto PairKey = [](int gtId, int trId)
+    {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(gtId)) << 32) | static_cast<uint32_t>(trId);
+    };
+
+    // Identity: the global matching of the ids maximizes the count of the frames with IoU >= 0.5
+    {
+        std::unordered_map<uint64_t, size_t> pairFrames;
+        std::unordered_map<int, int> gtRows;
+        std::unordered_map<int, int> trCols;
+        for (const auto& frame : m_frames)
+        {
+            for (const auto& pair : frame.m_pairs)
+            {
+                if (pair.m_iou < 0.5f)
+                    continue;
+                const int gtId = frame.m_gtIds[pair.m_gt];
+                const int trId = frame.m_trIds[pair.m_tr];
+                ++pairFrames[PairKey(gtId, trId)];
+                gtRows.emplace(gtId, static_cast<int>(gtRows.size()));
+                trCols.emplace(trId, static_cast<int>(trCols.size()));
+            }
+        }
+        if (!pairFrames.empty())
+        {
+            size_t maxCount = 0;
+            for (const auto& it : pairFrames)
+            {
+                maxCount = std::max(maxCount, it.second);
+            }
+            const size_t rows = gtRows.size();
+            const size_t cols = trCols.size();
+            const track_t maxCost = static_cast<track_t>(maxCount);
+            m_costs.Assign(rows, cols, maxCost);
+            for (const auto& it : pairFrames)
+            {
+                const int row = gtRows[static_cast<int>(it.first >> 32)];
+                const int col = trCols[static_cast<int>(it.first & 0xffffffff)];
+                m_costs(row, col) = maxCost - static_cast<track_t>(it.second);
+            }
+            m_solver.Solve(m_costs, rows, cols, m_assignment, 2 * maxCost + 1);
+            for (size_t row = 0; row < rows; ++row)
+            {
+                if (m_assignment[row] >= 0)
+                    metrics.m_idtp += static_cast<size_t>(maxCost - m_costs(row, m_assignment[row]) + 0.5f);
+            }
+        }
+    }
+
+    // HOTA: the global alignment score of the ids
+    std::unordered_map<uint64_t, double> potentialMatches;
+    std::vector<double> gtSums;
+    std::vector<double> trSums;
+    for (const auto& frame : m_frames)
+    {
+        gtSums.assign(frame.m_gtIds.size(), 0.);
+        trSums.assign(frame.m_trIds.size(), 0.);
+        for (const auto& pair : frame.m_pairs)
+        {
+            gtSums[pair.m_gt] += pair.m_iou;
+            trSums[pair.m_tr] += pair.m_iou;
+        }
+        for (const auto& pair : frame.m_pairs)
+        {
+            const double denom = gtSums[pair.m_gt] + trSums[pair.m_tr] - pair.m_iou;
+            if (denom > 0)
+                potentialMatches[PairKey(frame.m_gtIds[pair.m_gt], frame.m_trIds[pair.m_tr])] += pair.m_iou / denom;
+        }
+    }
+    auto GlobalAlignment = [&](int gtId, int trId)
+    {
+        auto it = potentialMatches.find(PairKey(gtId, trId));
+        if (it == potentialMatches.end())
+            return 0.;
+        return it->second / (m_gtIdCount[gtId] + m_trIdCount[trId] - it->second);
+    };
+
+    std::array<std::unordered_map<uint64_t, size_t>, MotMetrics::AlphasCount> matchesCounts;
+    std::vector<double> scores;
+    for (const auto& frame : m_frames)
+    {
+        scores.resize(frame.m_pairs.size());
+        for (size_t k = 0; k < frame.m_pairs.size(); ++k)
+        {
+            const Pair& pair = frame.m_pairs[k];
+            scores[k] = GlobalAlignment(frame.m_gtIds[pair.m_gt], frame.m_trIds[pair.m_tr]) * pair.m_iou;
+        }
+        Assign(frame.m_gtIds.size(), frame.m_trIds.size(), frame.m_pairs, 0.f, &scores, m_assignment);
+        for (const auto& pair : frame.m_pairs)
+        {
+            if (m_assignment[pair.m_gt] != pair.m_tr)
+                continue;
+            for (size_t a = 0; a < MotMetrics::AlphasCount; ++a)
+            {
+                const double alpha = 0.05 * (a + 1);
+                if (pair.m_iou >= alpha - 1e-6)
+                {
+                    metrics.m_hotaTP[a] += 1;
+                    metrics.m_locSum[a] += pair.m_iou;
+                    ++matchesCounts[a][PairKey(frame.m_gtIds[pair.m_gt], frame.m_trIds[pair.m_tr])];
+                }
+            }
+        }
+    }
+    for (size_t a = 0; a < MotMetrics::AlphasCount; ++a)
+    {
+        for (const auto& it : matchesCounts[a])
+        {
+            const int gtId = static_cast<int>(it.first >> 32);
+            const int trId = static_cast<int>(it.first & 0xffffffff);
+            const double matches = static_cast<double>(it.second);
+            metrics.m_assSum[a] += matches * matches / (m_gtIdCount[gtId] + m_trIdCount[trId] - matches);
+        }
+    }
+    return metrics;
+}
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <map>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "defines.h"
+#include "LAPJV/LAPJV.h"
+
+///
+/// \brief The MotBox struct
+/// Object of the ground truth or of the tracker on the one frame
+///
+struct MotBox
+{
+    int m_id = 0;
+    cv::Rect2f m_rect;
+
+    MotBox() = default;
+    MotBox(int id, const cv::Rect2f& rect)
+        : m_id(id), m_rect(rect)
+    {
+    }
+};
+
+///
+/// \brief The MotMetrics struct
+/// Additive counters of the CLEAR MOT, identity and HOTA metrics: the sums of the sequences give the combined metrics
+///
+struct MotMetrics
+{
+    static constexpr size_t AlphasCount = 19; // HOTA thresholds 0.05, 0.10, ..., 0.95
+
+    // CLEAR MOT with IoU >= 0.5
+    size_t m_gtDets = 0;
+    size_t m_trDets = 0;
+    size_t m_matches = 0;
+    size_t m_idSwitches = 0;
+    double m_iouSum = 0;
+
+    // Identity
+    size_t m_idtp = 0;
+
+    // HOTA for the every alpha
+    std::array<double, AlphasCount> m_hotaTP {};
+    std::array<double, AlphasCount> m_assSum {}; // AssA * TP
+    std::array<double, AlphasCount> m_locSum {};
+
+    ///
+    double MOTA() const
+    {
+        return m_gtDets ? (1. - static_cast<double>((m_gtDets - m_matches) + (m_trDets - m_matches) + m_idSwitches) / m_gtDets) : 0.;
+    }
+    ///
+    double MOTP() const
+    {
+        return m_matches ? (m_iouSum / m_matches) : 0.;
+    }
+    ///
+    double IDF1() const
+    {
+        return (m_gtDets + m_trDets) ? (2. * m_idtp / (m_gtDets + m_trDets)) : 0.;
+    }
+    ///
+    double DetA(size_t alpha) const
+    {
+        const double denom = m_gtDets + m_trDets - m_hotaTP[alpha];
+        return (denom > 0) ? (m_hotaTP[alpha] / denom) : 0.;
+    }
+    ///
+    double AssA(size_t alpha) const
+    {
+        return (m_hotaTP[alpha] > 0) ? (m_assSum[alpha] / m_hotaTP[alpha]) : 0.;
+    }
+    ///
+    /// \brief HOTA
+    /// \return Mean of the HOTA for the all alphas
+    ///
+    double HOTA() const
+    {
+        double res = 0;
+        for (size_t a = 0; a < AlphasCount; ++a)
+        {
+            res += sqrt(DetA(a) * AssA(a));
+        }
+        return res / AlphasCount;
+    }
+    ///
+    double DetA() const
+    {
+        double res = 0;
+        for (size_t a = 0; a < AlphasCount; ++a)
+        {
+            res += DetA(a);
+        }
+        return res / AlphasCount;
+    }
+    ///
+    double AssA() const
+    {
+        double res = 0;
+        for (size_t a = 0; a < AlphasCount; ++a)
+        {
+            res += AssA(a);
+        }
+        return res / AlphasCount;
+    }
+
+    ///
+    void Add(const MotMetrics& other);
+};
+
+///
+/// \brief The MotEvaluator class
+/// Evaluation of the tracker on the MOTChallenge sequence like the official devkit (TrackEval):
+/// the tracker boxes matched to the distractors (static persons, reflections, persons on vehicles) are removed,
+/// only the pedestrians with the consider flag are the ground truth
+///
+class MotEvaluator
+{
+public:
+    ///
+    /// \brief ReadGroundTruth
+    /// gt.txt: frame,id,bb_left,bb_top,bb_width,bb_height,consider,class,visibility
+    /// \param gtFile
+    /// \param mot20 - non motorized vehicles are the distractors too
+    /// \return
+    ///
+    bool ReadGroundTruth(const std::string& gtFile, bool mot20);
+
+    ///
+    /// \brief AddFrame
+    /// \param frameInd - from 1 like in gt.txt
+    /// \param tracks
+    ///
+    void AddFrame(int frameInd, const std::vector<MotBox>& tracks);
+
+    ///
+    /// \brief Evaluate
+    /// \return The metrics of the added frames
+    ///
+    MotMetrics Evaluate();
+
+private:
+    ///
+    struct GtBox
+    {
+        MotBox m_box;
+        int m_class = 1;
+        bool m_consider = true;
+    };
+    std::map<int, std::vector<GtBox>> m_gt;
+    bool m_mot20 = false;
+
+    ///
+    struct Pair
+    {
+        int m_gt = 0;  // Indices on the frame
+        int m_tr = 0;
+        float m_iou = 0;
+    };
+    ///
+    struct FrameData
+    {
+        std::vector<int> m_gtIds;  // Dense ids
+        std::vector<int> m_trIds;
+        std::vector<Pair> m_pairs; // IoU > 0
+    };
+    std::vector<FrameData> m_frames;
+
+    std::unordered_map<int, int> m_gtIdsMap;
+    std::unordered_map<int, int> m_trIdsMap;
+    std::vector<size_t> m_gtIdCount;
+    std::vector<size_t> m_trIdCount;
+
+    // CLEAR MOT state
+    std::unordered_map<int, int> m_lastMatch;  // gt id -> the last matched tracker id
+    std::unordered_map<int, int> m_prevMatch;  // gt id -> tracker id on the previous frame
+    MotMetrics m_metrics;
+
+    LAPJVSolver m_solver;
+    distMatrix_t m_costs;
+    assignments_t m_assignment;
+
+    bool IsDistractor(int cls) const;
+    static int DenseId(std::unordered_map<int, int>& idsMap, std::vector<size_t>& counts, int id);
+    void Assign(size_t rows, size_t cols, const std::vector<Pair>& pairs, track_t minIoU, const std::vector<double>* scores, assignments_t& assignment);
+};
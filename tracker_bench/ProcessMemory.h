@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdio>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <unistd.h>
+#include <sys/resource.h>
+#endif
+
+///
+/// \brief PeakRssMb
+/// \return Peak resident memory of the process
+///
+inline double PeakRssMb()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return counters.PeakWorkingSetSize / (1024. * 1024.);
+    return 0.;
+#else
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+    {
+#ifdef __APPLE__
+        return usage.ru_maxrss / (1024. * 1024.);
+#else
+        return usage.ru_maxrss / 1024.;
+#endif
+    }
+    return 0.;
+#endif
+}
+
+///
+/// \brief CurrentRssMb
+/// \return Current resident memory of the process, 0 if it's unknown
+///
+inline double CurrentRssMb()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return counters.WorkingSetSize / (1024. * 1024.);
+    return 0.;
+#elif defined(__linux__)
+    double res = 0.;
+    if (FILE* file = fopen("/proc/self/statm", "r"))
+    {
+        long pages = 0;
+        long residentPages = 0;
+        if (fscanf(file, "%ld %ld", &pages, &residentPages) == 2)
+            res = residentPages * (sysconf(_SC_PAGESIZE) / (1024. * 1024.));
+        fclose(file);
+    }
+    return res;
+#else
+    return 0.;
+#endif
+}
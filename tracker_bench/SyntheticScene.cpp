@@ -0,0 +1,147 @@
+#include <algorithm>
+#include <cmath>
+
+#include "SyntheticScene.h"
+
+///
+/// \brief SyntheticScene::SyntheticScene
+/// \param settings
+///
+SyntheticScene::SyntheticScene(const SyntheticSceneSettings& settings)
+    : m_settings(settings), m_rng(settings.m_seed)
+{
+    if (m_settings.m_type == bad_type)
+        m_settings.m_type = TypeConverter::Str2Type("person");
+    m_settings.m_frameSize.width = std::max(m_settings.m_frameSize.width, 2 * cvCeil(m_settings.m_maxSize.width));
+    m_settings.m_frameSize.height = std::max(m_settings.m_frameSize.height, 2 * cvCeil(m_settings.m_maxSize.height));
+
+    m_objects.resize(m_settings.m_objectsCount);
+    for (auto& object : m_objects)
+    {
+        Spawn(object);
+    }
+}
+
+///
+/// \brief SyntheticScene::Spawn
+/// \param object
+///
+void SyntheticScene::Spawn(Object& object)
+{
+    object.m_id = m_nextId++;
+    object.m_size.width = m_rng.uniform(m_settings.m_minSize.width, m_settings.m_maxSize.width);
+    object.m_size.height = m_rng.uniform(m_settings.m_minSize.height, m_settings.m_maxSize.height);
+    object.m_center.x = m_rng.uniform(object.m_size.width / 2.f, m_settings.m_frameSize.width - object.m_size.width / 2.f);
+    object.m_center.y = m_rng.uniform(object.m_size.height / 2.f, m_settings.m_frameSize.height - object.m_size.height / 2.f);
+    const float angle = m_rng.uniform(0.f, static_cast<float>(2 * CV_PI));
+    const float speed = std::max(0.f, static_cast<float>(m_settings.m_speed * (1. + 0.3 * m_rng.gaussian(1.))));
+    object.m_velocity = cv::Point2f(speed * std::cos(angle), speed * std::sin(angle));
+    object.m_occludedFrames = 0;
+}
+
+///
+/// \brief SyntheticScene::Move
+/// \param object
+///
+void SyntheticScene::Move(Object& object)
+{
+    switch (m_settings.m_motion)
+    {
+    case SyntheticSceneSettings::Motion::RandomWalk:
+        object.m_velocity.x += static_cast<float>(m_rng.gaussian(0.2 * m_settings.m_speed));
+        object.m_velocity.y += static_cast<float>(m_rng.gaussian(0.2 * m_settings.m_speed));
+        break;
+
+    case SyntheticSceneSettings::Motion::Turns:
+        if (m_rng.uniform(0.f, 1.f) < 0.02f)
+        {
+            const float speed = std::sqrt(object.m_velocity.dot(object.m_velocity));
+            const float angle = m_rng.uniform(0.f, static_cast<float>(2 * CV_PI));
+            object.m_velocity = cv::Point2f(speed * std::cos(angle), speed * std::sin(angle));
+        }
+        break;
+
+    default:
+        break;
+    }
+    object.m_center += object.m_velocity;
+
+    // Bounce from the borders
+    const cv::Point2f half(object.m_size.width / 2.f, object.m_size.height / 2.f);
+    if (object.m_center.x < half.x || object.m_center.x > m_settings.m_frameSize.width - half.x)
+    {
+        object.m_velocity.x = -object.m_velocity.x;
+        object.m_center.x = std::max(half.x, std::min(m_settings.m_frameSize.width - half.x, object.m_center.x));
+    }
+    if (object.m_center.y < half.y || object.m_center.y > m_settings.m_frameSize.height - half.y)
+    {
+        object.m_velocity.y = -object.m_velocity.y;
+        object.m_center.y = std::max(half.y, std::min(m_settings.m_frameSize.height - half.y, object.m_center.y));
+    }
+}
+
+///
+/// \brief SyntheticScene::Detection
+/// \param center
+/// \param size
+/// \return Noisy detection of the box
+///
+cv::Rect SyntheticScene::Detection(const cv::Point2f& center, const cv::Size2f& size)
+{
+    const float noise = m_settings.m_boxNoise;
+    const float x = center.x + static_cast<float>(m_rng.gaussian(noise));
+    const float y = center.y + static_cast<float>(m_rng.gaussian(noise));
+    const float w = std::max(2.f, size.width + static_cast<float>(m_rng.gaussian(noise)));
+    const float h = std::max(2.f, size.height + static_cast<float>(m_rng.gaussian(noise)));
+    return cv::Rect(cvRound(x - w / 2.f), cvRound(y - h / 2.f), cvRound(w), cvRound(h));
+}
+
+///
+/// \brief SyntheticScene::Next
+/// \param regions
+///
+void SyntheticScene::Next(regions_t& regions)
+{
+    regions.clear();
+    m_groundTruth.clear();
+    ++m_frameInd;
+
+    for (auto& object : m_objects)
+    {
+        if (m_rng.uniform(0.f, 1.f) < m_settings.m_respawnRate)
+            Spawn(object);
+        else
+            Move(object);
+
+        m_groundTruth.emplace_back(object.m_id, cv::Rect2f(object.m_center.x - object.m_size.width / 2.f, object.m_center.y - object.m_size.height / 2.f, object.m_size.width, object.m_size.height));
+
+        if (object.m_occludedFrames)
+        {
+            --object.m_occludedFrames;
+            continue;
+        }
+        if (m_settings.m_occlusionFrames && m_rng.uniform(0.f, 1.f) < m_settings.m_occlusionRate)
+        {
+            object.m_occludedFrames = static_cast<size_t>(m_rng.uniform(1, static_cast<int>(m_settings.m_occlusionFrames) + 1)) - 1;
+            continue;
+        }
+        if (m_rng.uniform(0.f, 1.f) < m_settings.m_missRate)
+            continue;
+
+        regions.emplace_back(Detection(object.m_center, object.m_size), m_settings.m_type, m_rng.uniform(0.5f, 1.f));
+    }
+
+    // False positives are uniform over the frame
+    const float falsePositives = m_settings.m_falsePositivesRate * m_objects.size();
+    size_t fpCount = static_cast<size_t>(falsePositives);
+    if (m_rng.uniform(0.f, 1.f) < falsePositives - fpCount)
+        ++fpCount;
+    for (size_t i = 0; i < fpCount; ++i)
+    {
+        const cv::Size2f size(m_rng.uniform(m_settings.m_minSize.width, m_settings.m_maxSize.width),
+                              m_rng.uniform(m_settings.m_minSize.height, m_settings.m_maxSize.height));
+        const cv::Point2f center(m_rng.uniform(size.width / 2.f, m_settings.m_frameSize.width - size.width / 2.f),
+                                 m_rng.uniform(size.height / 2.f, m_settings.m_frameSize.height - size.height / 2.f));
+        regions.emplace_back(Detection(center, size), m_settings.m_type, m_rng.uniform(0.3f, 0.7f));
+    }
+}
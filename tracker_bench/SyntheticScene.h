@@ -0,0 +1,93 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "defines.h"
+#include "MotEvaluator.h"
+
+///
+/// \brief The SyntheticSceneSettings struct
+///
+struct SyntheticSceneSettings
+{
+    ///
+    /// \brief The Motion enum
+    ///
+    enum class Motion
+    {
+        Linear = 0,  // Constant velocity, the objects bounce from the frame borders
+        RandomWalk,  // Gaussian acceleration on every frame
+        Turns        // Constant speed with the rare sharp turns
+    };
+
+    cv::Size m_frameSize { 1920, 1080 };
+    size_t m_objectsCount = 100;
+    Motion m_motion = Motion::Linear;
+    float m_speed = 4.f;                      // Mean speed in pixels per frame
+    cv::Size2f m_minSize { 15.f, 30.f };      // Object sizes are uniform in [min, max]
+    cv::Size2f m_maxSize { 50.f, 120.f };
+    float m_occlusionRate = 0.01f;            // Probability of the occlusion start for the object on the frame
+    size_t m_occlusionFrames = 10;            // Max duration of the occlusion
+    float m_missRate = 0.05f;                 // Probability of the missed detection of the visible object
+    float m_falsePositivesRate = 0.02f;       // False positives count on the frame relative to the objects count
+    float m_boxNoise = 1.f;                   // Sigma of the detections noise in pixels
+    float m_respawnRate = 0.002f;             // Probability that the object is replaced by the new one
+    uint64_t m_seed = 0x12345678;
+    objtype_t m_type = bad_type;              // bad_type - "person"
+};
+
+///
+/// \brief The SyntheticScene class
+/// Generator of the detections for the crowds of the any size: the objects move by the motion model,
+/// the detections are noisy, some of them are missed, occluded or false
+///
+class SyntheticScene
+{
+public:
+    explicit SyntheticScene(const SyntheticSceneSettings& settings);
+
+    ///
+    /// \brief Next
+    /// Moves the objects to the next frame
+    /// \param regions - detections on the new frame
+    ///
+    void Next(regions_t& regions);
+
+    ///
+    /// \brief GroundTruth
+    /// \return The all objects on the last frame including the occluded
+    ///
+    const std::vector<MotBox>& GroundTruth() const
+    {
+        return m_groundTruth;
+    }
+
+    ///
+    size_t FrameInd() const
+    {
+        return m_frameInd;
+    }
+
+private:
+    ///
+    struct Object
+    {
+        int m_id = 0;
+        cv::Point2f m_center;
+        cv::Point2f m_velocity;
+        cv::Size2f m_size;
+        size_t m_occludedFrames = 0;
+    };
+    std::vector<Object> m_objects;
+    std::vector<MotBox> m_groundTruth;
+
+    SyntheticSceneSettings m_settings;
+    cv::RNG m_rng;
+    int m_nextId = 1;
+    size_t m_frameInd = 0;
+
+    void Spawn(Object& object);
+    void Move(Object& object);
+    cv::Rect Detection(const cv::Point2f& center, const cv::Size2f& size);
+};
@@ -0,0 +1,266 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <algorithm>
+
+#include <opencv2/opencv.hpp>
+#include <opencv2/core/ocl.hpp>
+
+#include "BackgroundSubtract.h"
+#include "ProcessMemory.h"
+
+// ----------------------------------------------------------------------
+
+static void Help()
+{
+    printf("\nThroughput of the background subtractors across the resolutions, OpenCL and threads\n"
+           "Usage: \n"
+           "          ./BgfgBench <comma separated videos> [--algs]=<comma separated BGFG_ALGS> [--heights]=<comma separated frame heights> [--opencl]=<comma separated 0 or 1> [--threads]=<comma separated threads count> [--channels]=<1 or 3> [--clip_frames]=<preloaded frames> [--frames]=<measured frames> [--out]=<csv file> \n\n"
+           );
+}
+
+const char* keys =
+{
+    "{ @1              |                    | Comma separated videos, the frames are resized to the every height | }"
+    "{ a algs          |0,1,2,3,4,5,6       | Comma separated algorithms: 0 - VIBE, 1 - MOG, 2 - GMG, 3 - CNT, 4 - SuBSENSE, 5 - LOBSTER, 6 - MOG2 | }"
+    "{ hs heights      |480,720,1080,2160   | Comma separated heights of the frames, the width keeps the aspect ratio of the video | }"
+    "{ ocl opencl      |0,1                 | Comma separated modes: 0 - CPU, 1 - OpenCL | }"
+    "{ t threads       |1,4,0               | Comma separated counts of the OpenCV threads, 0 - default | }"
+    "{ c channels      |1                   | Channels of the frames like MotionDetector: 1 - gray, 3 - color | }"
+    "{ cf clip_frames  |50                  | Frames read from the video, they are replayed forward and backward | }"
+    "{ n frames        |300                 | Measured frames for the every run after 20 frames of the warm up | }"
+    "{ o out           |                    | Csv with the results | }"
+};
+
+///
+/// \brief Percentile
+/// \param sorted
+/// \param p - [0, 1]
+/// \return
+///
+static double Percentile(const std::vector<double>& sorted, double p)
+{
+    if (sorted.empty())
+        return 0.;
+    const size_t ind = std::min(sorted.size() - 1, static_cast<size_t>(p * (sorted.size() - 1) + 0.5));
+    return sorted[ind];
+}
+
+///
+/// \brief SplitList
+/// \param list - comma separated
+/// \return
+///
+static std::vector<std::string> SplitList(const std::string& list)
+{
+    std::vector<std::string> res;
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ','))
+    {
+        if (!item.empty())
+            res.emplace_back(item);
+    }
+    return res;
+}
+
+///
+/// \brief ParseInts
+/// \param list - comma separated
+/// \return
+///
+static std::vector<int> ParseInts(const std::string& list)
+{
+    std::vector<int> res;
+    for (const auto& item : SplitList(list))
+    {
+        res.push_back(std::atoi(item.c_str()));
+    }
+    return res;
+}
+
+///
+static const char* AlgName(int algType)
+{
+    static const char* names[] = { "VIBE", "MOG", "GMG", "CNT", "SuBSENSE", "LOBSTER", "MOG2" };
+    return (algType >= 0 && algType <= BackgroundSubtract::ALG_MOG2) ? names[algType] : "?";
+}
+
+///
+/// \brief ReadClip
+/// \param fileName
+/// \param maxFrames
+/// \param channels
+/// \param frames
+/// \return
+///
+static bool ReadClip(const std::string& fileName, size_t maxFrames, int channels, std::vector<cv::Mat>& frames)
+{
+    cv::VideoCapture capture(fileName);
+    if (!capture.isOpened())
+    {
+        std::cerr << "Can't open " << fileName << std::endl;
+        return false;
+    }
+    cv::Mat frame;
+    while (frames.size() < maxFrames && capture.read(frame) && !frame.empty())
+    {
+        if (channels == 1 && frame.channels() != 1)
+        {
+            cv::Mat gray;
+            cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
+            frames.emplace_back(gray);
+        }
+        else
+        {
+            frames.emplace_back(frame.clone());
+        }
+    }
+    return !frames.empty();
+}
+
+// ----------------------------------------------------------------------
+
+int main(int argc, char** argv)
+{
+    Help();
+
+    cv::CommandLineParser parser(argc, argv, keys);
+
+    const std::vector<std::string> videos = SplitList(parser.get<std::string>(0));
+    const std::vector<int> algs = ParseInts(parser.get<std::string>("algs"));
+    const std::vector<int> heights = ParseInts(parser.get<std::string>("heights"));
+    const std::vector<int> openclModes = ParseInts(parser.get<std::string>("opencl"));
+    const std::vector<int> threads = ParseInts(parser.get<std::string>("threads"));
+    const int channels = (parser.get<int>("channels") == 3) ? 3 : 1;
+    const size_t clipFrames = static_cast<size_t>(std::max(1, parser.get<int>("clip_frames")));
+    const size_t framesCount = static_cast<size_t>(std::max(1, parser.get<int>("frames")));
+    constexpr size_t warmUpFrames = 20;
+    const int defaultThreads = cv::getNumThreads();
+    if (videos.empty())
+    {
+        std::cerr << "Videos are not defined" << std::endl;
+        return 1;
+    }
+
+    std::ofstream csvFile;
+    const std::string outFile = parser.get<std::string>("out");
+    if (!outFile.empty())
+    {
+        csvFile.open(outFile, std::ios::trunc);
+        if (!csvFile.is_open())
+        {
+            std::cerr << "Can't create " << outFile << std::endl;
+            return 1;
+        }
+        csvFile << "video,alg,width,height,opencl,threads,fps,mean_ms,p50_ms,p90_ms,p99_ms,max_ms,model_mb,peak_rss_mb" << std::endl;
+    }
+
+    std::cout << std::left << std::setw(12) << "alg" << std::right << std::setw(11) << "size" << std::setw(8) << "opencl" << std::setw(8) << "threads"
+              << std::setw(9) << "fps" << std::setw(9) << "p50 ms" << std::setw(9) << "p90 ms" << std::setw(9) << "p99 ms" << std::setw(9) << "max ms"
+              << std::setw(10) << "model MB" << std::setw(10) << "RSS MB" << std::endl;
+
+    std::vector<cv::Mat> clip;
+    std::vector<cv::UMat> frames;
+    std::vector<double> latencies;
+    cv::UMat foreground;
+    for (const auto& video : videos)
+    {
+        clip.clear();
+        if (!ReadClip(video, clipFrames, channels, clip))
+            continue;
+        std::cout << video << ": " << clip.size() << " frames " << clip.front().size() << std::endl;
+
+        for (int height : heights)
+        {
+            if (height <= 0)
+                continue;
+            const cv::Size frameSize(cvRound(height * static_cast<double>(clip.front().cols) / clip.front().rows), height);
+
+            for (int opencl : openclModes)
+            {
+                cv::ocl::setUseOpenCL(opencl != 0);
+                if (opencl && !cv::ocl::useOpenCL())
+                {
+                    std::cout << "OpenCL isn't available" << std::endl;
+                    continue;
+                }
+
+                // The frames of the resolution are uploaded before the runs, so the resize and the reading aren't measured
+                frames.clear();
+                frames.reserve(clip.size());
+                for (const auto& frame : clip)
+                {
+                    cv::UMat resized;
+                    cv::resize(frame.getUMat(cv::ACCESS_READ), resized, frameSize, 0, 0, (frameSize.height < frame.rows) ? cv::INTER_AREA : cv::INTER_LINEAR);
+                    frames.emplace_back(resized);
+                }
+
+                for (int threadsCount : threads)
+                {
+                    cv::setNumThreads((threadsCount > 0) ? threadsCount : defaultThreads);
+
+                    for (int alg : algs)
+                    {
+                        if (alg < 0 || alg > BackgroundSubtract::ALG_MOG2)
+                            continue;
+
+                        const double rssBefore = CurrentRssMb();
+                        BackgroundSubtract subtractor(static_cast<BackgroundSubtract::BGFG_ALGS>(alg), channels);
+                        if (subtractor.m_algType != alg)
+                        {
+                            std::cout << AlgName(alg) << " isn't available" << std::endl;
+                            continue;
+                        }
+
+                        latencies.clear();
+                        latencies.reserve(framesCount);
+                        double allTime = 0;
+                        for (size_t i = 0; i < warmUpFrames + framesCount; ++i)
+                        {
+                            // Forward and backward without the jumps of the background
+                            const size_t period = std::max<size_t>(1, 2 * frames.size() - 2);
+                            const size_t pos = i % period;
+                            const cv::UMat& frame = frames[(pos < frames.size()) ? pos : (period - pos)];
+
+                            const auto t1 = std::chrono::steady_clock::now();
+                            subtractor.Subtract(frame, foreground);
+                            if (opencl)
+                                cv::ocl::finish();
+                            const auto t2 = std::chrono::steady_clock::now();
+                            if (i >= warmUpFrames)
+                            {
+                                const double latency = std::chrono::duration<double, std::milli>(t2 - t1).count();
+                                latencies.push_back(latency);
+                                allTime += latency;
+                            }
+                        }
+                        const double modelMb = std::max(0., CurrentRssMb() - rssBefore);
+                        const double peakRssMb = PeakRssMb();
+                        std::sort(latencies.begin(), latencies.end());
+                        const double fps = (allTime > 0) ? (1000. * latencies.size() / allTime) : 0.;
+                        const int threadsNum = cv::getNumThreads();
+
+                        std::cout << std::left << std::setw(12) << AlgName(alg) << std::right << std::setw(11) << (std::to_string(frameSize.width) + "x" + std::to_string(frameSize.height))
+                                  << std::setw(8) << opencl << std::setw(8) << threadsNum << std::fixed << std::setprecision(1) << std::setw(9) << fps
+                                  << std::setprecision(2) << std::setw(9) << Percentile(latencies, 0.5) << std::setw(9) << Percentile(latencies, 0.9)
+                                  << std::setw(9) << Percentile(latencies, 0.99) << std::setw(9) << latencies.back()
+                                  << std::setprecision(1) << std::setw(10) << modelMb << std::setw(10) << peakRssMb << std::defaultfloat << std::endl;
+                        if (csvFile.is_open())
+                        {
+                            csvFile << video << "," << AlgName(alg) << "," << frameSize.width << "," << frameSize.height << "," << opencl << "," << threadsNum << ","
+                                    << fps << "," << (allTime / latencies.size()) << "," << Percentile(latencies, 0.5) << "," << Percentile(latencies, 0.9) << ","
+                                    << Percentile(latencies, 0.99) << "," << latencies.back() << "," << modelMb << "," << peakRssMb << std::endl;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    cv::setNumThreads(defaultThreads);
+
+    std::cout << "Correct exit" << std::endl;
+    return 0;
+}
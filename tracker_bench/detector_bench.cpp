@@ -0,0 +1,341 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <algorithm>
+
+#include <opencv2/opencv.hpp>
+#include <opencv2/core/ocl.hpp>
+
+#ifdef BUILD_YOLO_TENSORRT
+#include <cuda_runtime_api.h>
+#endif
+
+#include "BaseDetector.h"
+#include "ProcessMemory.h"
+
+// ----------------------------------------------------------------------
+
+static void Help()
+{
+    printf("\nLatency and throughput of the detectors on the synthetic or recorded frames\n"
+           "Usage: \n"
+           "          ./DetectorBench [--detector]=<tracking::Detectors> [--cfg]=<model configuration> [--weights]=<model binary> [--names]=<class names> [--config]=<key=value;key=value> [--video]=<recorded frames> [--frame_size]=<WxH> [--batch]=<frames in Detect> [--crop]=<maxCropRatio> [--warmup]=<iterations> [--iterations]=<measured iterations> [--out]=<csv file> \n\n"
+           );
+}
+
+const char* keys =
+{
+    "{ d detector      |11                  | tracking::Detectors: 10 - Yolo_Darknet, 11 - Yolo_TensorRT, 12 - DNN_OCV, other types are also possible | }"
+    "{ cfg             |../data/yolov4-tiny.cfg | Model configuration: modelConfiguration of the config | }"
+    "{ w weights       |../data/yolov4-tiny.weights | Model binary: modelBinary of the config | }"
+    "{ n names         |../data/coco.names  | Class names: classNames of the config | }"
+    "{ th threshold    |0.5                 | confidenceThreshold of the config | }"
+    "{ c config        |                    | Other keys of the config: key=value;key=value, for example net_type=YOLOV4_TINY;inference_precison=FP16 | }"
+    "{ v video         |                    | Recorded frames, empty - the synthetic frames | }"
+    "{ fs frame_size   |1920x1080           | Size of the frames, the recorded frames are resized, 0x0 - the size of the video | }"
+    "{ cf clip_frames  |50                  | Frames read from the video or generated, they are repeated | }"
+    "{ b batch         |1                   | Frames in one Detect call: maxBatch of the config | }"
+    "{ cr crop         |-1                  | maxCropRatio of the config: -1 - the whole frame is resized to the network | }"
+    "{ wu warmup       |20                  | Iterations without the measurement | }"
+    "{ it iterations   |200                 | Measured iterations | }"
+    "{ o out           |                    | Csv with the results, the row is appended | }"
+    "{ g gpu           |0                   | Use OpenCL acceleration | }"
+};
+
+///
+/// \brief Percentile
+/// \param sorted
+/// \param p - [0, 1]
+/// \return
+///
+static double Percentile(const std::vector<double>& sorted, double p)
+{
+    if (sorted.empty())
+        return 0.;
+    const size_t ind = std::min(sorted.size() - 1, static_cast<size_t>(p * (sorted.size() - 1) + 0.5));
+    return sorted[ind];
+}
+
+///
+/// \brief ParseConfig
+/// \param str - key=value;key=value
+/// \param config
+/// \return
+///
+static bool ParseConfig(const std::string& str, config_t& config)
+{
+    std::stringstream ss(str);
+    std::string item;
+    while (std::getline(ss, item, ';'))
+    {
+        if (item.empty())
+            continue;
+        const size_t pos = item.find('=');
+        if (pos == std::string::npos || pos == 0)
+        {
+            std::cerr << "Wrong config item " << item << ", key=value is expected" << std::endl;
+            return false;
+        }
+        // The keys of the command line replace the defaults
+        const std::string key = item.substr(0, pos);
+        config.erase(key);
+        config.emplace(key, item.substr(pos + 1));
+    }
+    return true;
+}
+
+///
+/// \brief GpuMemoryUsedMb
+/// \return Used memory of the current CUDA device, 0 if it's unknown
+///
+static double GpuMemoryUsedMb()
+{
+#ifdef BUILD_YOLO_TENSORRT
+    size_t freeBytes = 0;
+    size_t totalBytes = 0;
+    if (cudaMemGetInfo(&freeBytes, &totalBytes) == cudaSuccess)
+        return (totalBytes - freeBytes) / (1024. * 1024.);
+#endif
+    return 0.;
+}
+
+///
+/// \brief ReadClip
+/// \param fileName
+/// \param maxFrames
+/// \param frameSize - empty for the size of the video
+/// \param frames
+/// \return
+///
+static bool ReadClip(const std::string& fileName, size_t maxFrames, cv::Size frameSize, std::vector<cv::UMat>& frames)
+{
+    cv::VideoCapture capture(fileName);
+    if (!capture.isOpened())
+    {
+        std::cerr << "Can't open " << fileName << std::endl;
+        return false;
+    }
+    cv::Mat frame;
+    while (frames.size() < maxFrames && capture.read(frame) && !frame.empty())
+    {
+        cv::UMat resized;
+        if (frameSize.area() > 0 && frameSize != frame.size())
+            cv::resize(frame, resized, frameSize, 0, 0, (frameSize.height < frame.rows) ? cv::INTER_AREA : cv::INTER_LINEAR);
+        else
+            frame.copyTo(resized);
+        frames.emplace_back(resized);
+    }
+    return !frames.empty();
+}
+
+///
+/// \brief SyntheticClip
+/// The textured background with the moving blobs: the network has the work of the real frames, the detections aren't checked
+/// \param framesCount
+/// \param frameSize
+/// \param frames
+///
+static void SyntheticClip(size_t framesCount, cv::Size frameSize, std::vector<cv::UMat>& frames)
+{
+    cv::RNG rng(12345);
+    cv::Mat background(frameSize, CV_8UC3);
+    rng.fill(background, cv::RNG::UNIFORM, cv::Scalar::all(40), cv::Scalar::all(200));
+    cv::GaussianBlur(background, background, cv::Size(0, 0), 3);
+
+    struct Blob
+    {
+        cv::Point2f m_pos;
+        cv::Point2f m_velocity;
+        cv::Size m_size;
+        cv::Scalar m_color;
+    };
+    std::vector<Blob> blobs(20);
+    for (auto& blob : blobs)
+    {
+        blob.m_size = cv::Size(rng.uniform(frameSize.width / 40 + 1, frameSize.width / 10 + 2), rng.uniform(frameSize.height / 20 + 1, frameSize.height / 5 + 2));
+        blob.m_pos = cv::Point2f(rng.uniform(0.f, static_cast<float>(frameSize.width)), rng.uniform(0.f, static_cast<float>(frameSize.height)));
+        blob.m_velocity = cv::Point2f(rng.uniform(-5.f, 5.f), rng.uniform(-3.f, 3.f));
+        blob.m_color = cv::Scalar(rng.uniform(0, 255), rng.uniform(0, 255), rng.uniform(0, 255));
+    }
+
+    cv::Mat frame;
+    for (size_t i = 0; i < framesCount; ++i)
+    {
+        background.copyTo(frame);
+        for (auto& blob : blobs)
+        {
+            blob.m_pos += blob.m_velocity;
+            if (blob.m_pos.x < 0 || blob.m_pos.x > frameSize.width)
+                blob.m_velocity.x = -blob.m_velocity.x;
+            if (blob.m_pos.y < 0 || blob.m_pos.y > frameSize.height)
+                blob.m_velocity.y = -blob.m_velocity.y;
+            cv::ellipse(frame, cv::Point(cvRound(blob.m_pos.x), cvRound(blob.m_pos.y)), cv::Size(blob.m_size.width / 2, blob.m_size.height / 2),
+                        0, 0, 360, blob.m_color, cv::FILLED);
+        }
+        frames.emplace_back(frame.getUMat(cv::ACCESS_READ).clone());
+    }
+}
+
+// ----------------------------------------------------------------------
+
+int main(int argc, char** argv)
+{
+    Help();
+
+    cv::CommandLineParser parser(argc, argv, keys);
+
+    bool useOCL = parser.get<int>("gpu") ? 1 : 0;
+    cv::ocl::setUseOpenCL(useOCL);
+    std::cout << (cv::ocl::useOpenCL() ? "OpenCL is enabled" : "OpenCL not used") << std::endl;
+
+    const int detectorType = parser.get<int>("detector");
+    if (detectorType < 0 || detectorType >= tracking::DetectorsCount)
+    {
+        std::cerr << "Wrong detector type " << detectorType << std::endl;
+        return 1;
+    }
+    const size_t batchSize = static_cast<size_t>(std::max(1, parser.get<int>("batch")));
+    const size_t warmUp = static_cast<size_t>(std::max(0, parser.get<int>("warmup")));
+    const size_t iterations = static_cast<size_t>(std::max(1, parser.get<int>("iterations")));
+    const size_t clipFrames = static_cast<size_t>(std::max(1, parser.get<int>("clip_frames")));
+
+    cv::Size frameSize(0, 0);
+    const std::string frameSizeStr = parser.get<std::string>("frame_size");
+    if (sscanf(frameSizeStr.c_str(), "%dx%d", &frameSize.width, &frameSize.height) != 2)
+    {
+        std::cerr << "Wrong frame size " << frameSizeStr << ", WxH is expected" << std::endl;
+        return 1;
+    }
+
+    config_t config;
+    config.emplace("modelConfiguration", parser.get<std::string>("cfg"));
+    config.emplace("modelBinary", parser.get<std::string>("weights"));
+    config.emplace("classNames", parser.get<std::string>("names"));
+    config.emplace("confidenceThreshold", parser.get<std::string>("threshold"));
+    config.emplace("maxCropRatio", parser.get<std::string>("crop"));
+    config.emplace("maxBatch", std::to_string(batchSize));
+    if (!ParseConfig(parser.get<std::string>("config"), config))
+        return 1;
+
+    // The frames are prepared before the detector: the reading and the resize aren't measured
+    std::vector<cv::UMat> clip;
+    const std::string videoFile = parser.get<std::string>("video");
+    if (!videoFile.empty())
+    {
+        if (!ReadClip(videoFile, clipFrames, frameSize, clip))
+            return 1;
+    }
+    else
+    {
+        if (frameSize.area() <= 0)
+        {
+            std::cerr << "Synthetic frames need the frame size" << std::endl;
+            return 1;
+        }
+        SyntheticClip(clipFrames, frameSize, clip);
+    }
+    frameSize = clip.front().size();
+    std::cout << (videoFile.empty() ? std::string("Synthetic") : videoFile) << ": " << clip.size() << " frames " << frameSize << std::endl;
+
+    const double rssBefore = CurrentRssMb();
+    const double gpuBefore = GpuMemoryUsedMb();
+    const auto tInit1 = std::chrono::steady_clock::now();
+    cv::UMat firstFrame = clip.front();
+    std::unique_ptr<BaseDetector> detector = CreateDetector(static_cast<tracking::Detectors>(detectorType), config, firstFrame);
+    const auto tInit2 = std::chrono::steady_clock::now();
+    if (!detector)
+    {
+        std::cerr << "Detector wasn't created" << std::endl;
+        return 1;
+    }
+    const double initTime = std::chrono::duration<double, std::milli>(tInit2 - tInit1).count();
+    if (batchSize > detector->MaxBatchSize())
+        std::cout << "Detector runs the batch of " << detector->MaxBatchSize() << " frames, the batch of " << batchSize << " is detected in parts" << std::endl;
+
+    std::vector<cv::UMat> batch(batchSize);
+    std::vector<regions_t> regions(batchSize);
+    std::vector<double> latencies;
+    latencies.reserve(iterations);
+    double allTime = 0;
+    double preprocessTime = 0;
+    double inferenceTime = 0;
+    double gpuPeak = GpuMemoryUsedMb();
+    size_t detectionsCount = 0;
+    size_t frameInd = 0;
+    for (size_t i = 0; i < warmUp + iterations; ++i)
+    {
+        for (auto& frame : batch)
+        {
+            frame = clip[frameInd++ % clip.size()];
+        }
+
+        const DetectStages stages = detector->Stages();
+        const auto t1 = std::chrono::steady_clock::now();
+        if (batchSize > 1)
+        {
+            detector->Detect(batch, regions);
+        }
+        else
+        {
+            detector->Detect(batch.front());
+            detector->TakeDetects(regions.front());
+        }
+        const auto t2 = std::chrono::steady_clock::now();
+
+        if (i >= warmUp)
+        {
+            const double latency = std::chrono::duration<double, std::milli>(t2 - t1).count();
+            latencies.push_back(latency);
+            allTime += latency;
+            preprocessTime += 1000. * (detector->Stages().m_preprocess - stages.m_preprocess);
+            inferenceTime += 1000. * (detector->Stages().m_inference - stages.m_inference);
+            for (const auto& frameRegions : regions)
+            {
+                detectionsCount += frameRegions.size();
+            }
+            gpuPeak = std::max(gpuPeak, GpuMemoryUsedMb());
+        }
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    const double meanLatency = allTime / latencies.size();
+    const double meanPreprocess = preprocessTime / latencies.size();
+    const double meanInference = inferenceTime / latencies.size();
+    const double meanPostprocess = std::max(0., meanLatency - meanPreprocess - meanInference);
+    const double fps = (allTime > 0) ? (1000. * batchSize * latencies.size() / allTime) : 0.;
+    const double modelMb = std::max(0., CurrentRssMb() - rssBefore);
+    const double gpuMb = std::max(0., gpuPeak - gpuBefore);
+    const double peakRssMb = PeakRssMb();
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "Detector " << detectorType << ": " << iterations << " iterations of " << batchSize << " frames " << frameSize << " after " << warmUp << " warm up, init " << initTime << " ms" << std::endl;
+    std::cout << "Throughput: " << fps << " fps, " << (static_cast<double>(detectionsCount) / (batchSize * latencies.size())) << " detections per frame" << std::endl;
+    std::cout << "Batch latency, ms: mean " << meanLatency << ", p50 " << Percentile(latencies, 0.5) << ", p90 " << Percentile(latencies, 0.9)
+              << ", p99 " << Percentile(latencies, 0.99) << ", max " << latencies.back() << std::endl;
+    std::cout << "Stages, ms: preprocess " << meanPreprocess << ", inference " << meanInference << ", postprocess " << meanPostprocess << std::endl;
+    std::cout << std::setprecision(1) << "Memory, MB: model " << modelMb << ", peak RSS " << peakRssMb << ", GPU " << gpuMb << std::endl;
+    std::cout << std::defaultfloat;
+
+    const std::string outFile = parser.get<std::string>("out");
+    if (!outFile.empty())
+    {
+        const bool newFile = !std::ifstream(outFile).good();
+        std::ofstream csvFile(outFile, std::ios::app);
+        if (!csvFile.is_open())
+        {
+            std::cerr << "Can't create " << outFile << std::endl;
+            return 1;
+        }
+        if (newFile)
+            csvFile << "detector,source,width,height,batch,crop,fps,mean_ms,p50_ms,p90_ms,p99_ms,max_ms,preprocess_ms,inference_ms,postprocess_ms,init_ms,model_mb,peak_rss_mb,gpu_mb" << std::endl;
+        csvFile << detectorType << "," << (videoFile.empty() ? std::string("synthetic") : videoFile) << "," << frameSize.width << "," << frameSize.height << ","
+                << batchSize << "," << parser.get<std::string>("crop") << "," << fps << "," << meanLatency << "," << Percentile(latencies, 0.5) << ","
+                << Percentile(latencies, 0.9) << "," << Percentile(latencies, 0.99) << "," << latencies.back() << "," << meanPreprocess << ","
+                << meanInference << "," << meanPostprocess << "," << initTime << "," << modelMb << "," << peakRssMb << "," << gpuMb << std::endl;
+    }
+
+    std::cout << "Correct exit" << std::endl;
+    return 0;
+}
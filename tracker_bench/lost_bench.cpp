@@ -0,0 +1,368 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <algorithm>
+
+#include <opencv2/opencv.hpp>
+#include <opencv2/core/ocl.hpp>
+
+#include "track.h"
+#include "FramePyramid.h"
+
+// ----------------------------------------------------------------------
+
+static void Help()
+{
+    printf("\nCost of the visual trackers of the lost tracks across the object sizes\n"
+           "Usage: \n"
+           "          ./LostTrackBench [--types]=<comma separated LostTrackType> [--sizes]=<comma separated object heights> [--video]=<recorded sequence> [--objects]=<tracks count> [--frames]=<lost updates> [--pyramid]=<min object size> [--max_size]=<max object size> [--out]=<csv file> \n\n"
+           );
+}
+
+const char* keys =
+{
+    "{ t types         |1,2,3,4,5,6,7,8,9   | Comma separated LostTrackType: 1 - KCF, 2 - MIL, 3 - MedianFlow, 4 - GOTURN, 5 - MOSSE, 6 - CSRT, 7 - DAT, 8 - STAPLE, 9 - LDES | }"
+    "{ sz sizes        |16,32,64,128,256    | Comma separated heights of the objects, the width is the half | }"
+    "{ v video         |                    | Recorded sequence, empty - the synthetic textured object on the textured background | }"
+    "{ fs frame_size   |1920x1080           | Size of the synthetic frames | }"
+    "{ n objects       |10                  | Tracks in the different places for the every type and size | }"
+    "{ f frames        |30                  | Updates of the lost track after the initialization | }"
+    "{ p pyramid       |0                   | Min object size on the level of the shared frame pyramid like lostTrackMinSize, 0 - full resolution | }"
+    "{ ms max_size     |0                   | Max object side on the frame of the tracker like lostTrackMaxSize, 0 - not limited | }"
+    "{ o out           |                    | Csv with the results | }"
+    "{ g gpu           |0                   | Use OpenCL acceleration | }"
+};
+
+///
+/// \brief Percentile
+/// \param sorted
+/// \param p - [0, 1]
+/// \return
+///
+static double Percentile(const std::vector<double>& sorted, double p)
+{
+    if (sorted.empty())
+        return 0.;
+    const size_t ind = std::min(sorted.size() - 1, static_cast<size_t>(p * (sorted.size() - 1) + 0.5));
+    return sorted[ind];
+}
+
+///
+/// \brief ParseInts
+/// \param list - comma separated
+/// \return
+///
+static std::vector<int> ParseInts(const std::string& list)
+{
+    std::vector<int> res;
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ','))
+    {
+        if (!item.empty())
+            res.push_back(std::atoi(item.c_str()));
+    }
+    return res;
+}
+
+///
+static const char* LostTrackName(int type)
+{
+    static const char* names[] = { "None", "KCF", "MIL", "MedianFlow", "GOTURN", "MOSSE", "CSRT", "DAT", "STAPLE", "LDES" };
+    return (type >= 0 && type <= tracking::TrackLDES) ? names[type] : "?";
+}
+
+///
+/// \brief IsAvailable
+/// \param type
+/// \return false for the OpenCV trackers without opencv_contrib
+///
+static bool IsAvailable(tracking::LostTrackType type)
+{
+    switch (type)
+    {
+    case tracking::TrackKCF:
+    case tracking::TrackMIL:
+    case tracking::TrackMedianFlow:
+    case tracking::TrackGOTURN:
+    case tracking::TrackMOSSE:
+    case tracking::TrackCSRT:
+#ifdef USE_OCV_KCF
+        return true;
+#else
+        return false;
+#endif
+    case tracking::TrackDAT:
+    case tracking::TrackSTAPLE:
+    case tracking::TrackLDES:
+        return true;
+    default:
+        return false;
+    }
+}
+
+///
+/// \brief The Sequence class
+/// Frames with the one object: the synthetic textured patch moves over the textured background,
+/// on the recorded video the object is the region of the frame moving with the same velocity
+///
+class Sequence
+{
+public:
+    ///
+    /// \brief InitSynthetic
+    /// \param frameSize
+    /// \param rng
+    ///
+    void InitSynthetic(cv::Size frameSize, cv::RNG& rng)
+    {
+        m_background = cv::Mat(frameSize, CV_8UC3);
+        rng.fill(m_background, cv::RNG::UNIFORM, cv::Scalar::all(0), cv::Scalar::all(255));
+        cv::GaussianBlur(m_background, m_background, cv::Size(5, 5), 1.5);
+        m_patch = cv::Mat(512, 256, CV_8UC3);
+        rng.fill(m_patch, cv::RNG::UNIFORM, cv::Scalar::all(0), cv::Scalar::all(255));
+        cv::GaussianBlur(m_patch, m_patch, cv::Size(9, 9), 3);
+        m_video.clear();
+    }
+
+    ///
+    /// \brief InitVideo
+    /// \param fileName
+    /// \param maxFrames
+    /// \return
+    ///
+    bool InitVideo(const std::string& fileName, size_t maxFrames)
+    {
+        cv::VideoCapture capture(fileName);
+        if (!capture.isOpened())
+        {
+            std::cerr << "Can't open " << fileName << std::endl;
+            return false;
+        }
+        cv::Mat frame;
+        while (m_video.size() < maxFrames && capture.read(frame) && !frame.empty())
+        {
+            m_video.emplace_back(frame.clone());
+        }
+        return !m_video.empty();
+    }
+
+    ///
+    cv::Size FrameSize() const
+    {
+        return m_video.empty() ? m_background.size() : m_video.front().size();
+    }
+
+    ///
+    /// \brief Frame
+    /// \param ind
+    /// \param objRect - position of the object on the frame
+    /// \param frame
+    ///
+    void Frame(size_t ind, const cv::Rect& objRect, cv::UMat& frame)
+    {
+        if (!m_video.empty())
+        {
+            m_video[ind % m_video.size()].copyTo(frame);
+            return;
+        }
+        m_background.copyTo(m_frame);
+        const cv::Rect rect = objRect & cv::Rect(0, 0, m_frame.cols, m_frame.rows);
+        if (rect.area() > 0)
+        {
+            cv::Mat patch;
+            cv::resize(m_patch, patch, objRect.size());
+            patch(cv::Rect(rect.x - objRect.x, rect.y - objRect.y, rect.width, rect.height)).copyTo(m_frame(rect));
+        }
+        m_frame.copyTo(frame);
+    }
+
+private:
+    cv::Mat m_background;
+    cv::Mat m_patch;
+    cv::Mat m_frame;
+    std::vector<cv::Mat> m_video;
+};
+
+// ----------------------------------------------------------------------
+
+int main(int argc, char** argv)
+{
+    Help();
+
+    cv::CommandLineParser parser(argc, argv, keys);
+
+    bool useOCL = parser.get<int>("gpu") ? 1 : 0;
+    cv::ocl::setUseOpenCL(useOCL);
+    std::cout << (cv::ocl::useOpenCL() ? "OpenCL is enabled" : "OpenCL not used") << std::endl;
+
+    const std::vector<int> types = ParseInts(parser.get<std::string>("types"));
+    const std::vector<int> sizes = ParseInts(parser.get<std::string>("sizes"));
+    const size_t objectsCount = static_cast<size_t>(std::max(1, parser.get<int>("objects")));
+    const size_t framesCount = static_cast<size_t>(std::max(1, parser.get<int>("frames")));
+    const int pyramidMinSize = parser.get<int>("pyramid");
+    const int maxObjectSize = parser.get<int>("max_size");
+
+    cv::RNG rng(12345);
+    Sequence sequence;
+    const std::string videoFile = parser.get<std::string>("video");
+    if (!videoFile.empty())
+    {
+        if (!sequence.InitVideo(videoFile, framesCount + 2))
+            return 1;
+    }
+    else
+    {
+        cv::Size frameSize(1920, 1080);
+        const std::string frameSizeStr = parser.get<std::string>("frame_size");
+        if (sscanf(frameSizeStr.c_str(), "%dx%d", &frameSize.width, &frameSize.height) != 2 || frameSize.width < 64 || frameSize.height < 64)
+        {
+            std::cerr << "Wrong frame size " << frameSizeStr << std::endl;
+            return 1;
+        }
+        sequence.InitSynthetic(frameSize, rng);
+    }
+    const cv::Size frameSize = sequence.FrameSize();
+    std::cout << (videoFile.empty() ? std::string("Synthetic") : videoFile) << " frames " << frameSize << std::endl;
+
+    std::ofstream csvFile;
+    const std::string outFile = parser.get<std::string>("out");
+    if (!outFile.empty())
+    {
+        csvFile.open(outFile, std::ios::trunc);
+        if (!csvFile.is_open())
+        {
+            std::cerr << "Can't create " << outFile << std::endl;
+            return 1;
+        }
+        csvFile << "type,width,height,init_ms,update_mean_ms,update_p50_ms,update_p99_ms,update_max_ms,tracked_ratio" << std::endl;
+    }
+
+    std::cout << std::left << std::setw(12) << "type" << std::right << std::setw(10) << "size" << std::setw(10) << "init ms" << std::setw(11) << "update ms"
+              << std::setw(9) << "p50 ms" << std::setw(9) << "p99 ms" << std::setw(9) << "max ms" << std::setw(9) << "tracked" << std::endl;
+
+    std::shared_ptr<FramePyramid> framePyramid;
+    if (pyramidMinSize > 0 || maxObjectSize > 0)
+        framePyramid = std::make_shared<FramePyramid>(pyramidMinSize, maxObjectSize);
+
+    // Kalman only: the cost of CTrack::Update without the visual tracker
+    std::vector<int> allTypes(1, tracking::TrackNone);
+    allTypes.insert(allTypes.end(), types.begin(), types.end());
+
+    cv::UMat prevFrame;
+    cv::UMat currFrame;
+    std::vector<double> initTimes;
+    std::vector<double> updateTimes;
+    for (int typeInt : allTypes)
+    {
+        if (typeInt < tracking::TrackNone || typeInt > tracking::TrackLDES)
+            continue;
+        const tracking::LostTrackType type = static_cast<tracking::LostTrackType>(typeInt);
+        if (type != tracking::TrackNone && !IsAvailable(type))
+        {
+            std::cout << LostTrackName(typeInt) << " isn't available: opencv_contrib trackers need USE_OCV_KCF" << std::endl;
+            continue;
+        }
+
+        for (int height : sizes)
+        {
+            // The object moves 2 pixels per frame and stays inside the frame
+            const cv::Point2f velocity(2.f, 1.f);
+            const cv::Size objSize(std::max(4, height / 2), std::max(8, height));
+            const cv::Point maxStart(frameSize.width - 2 * objSize.width - cvCeil(velocity.x * (framesCount + 2)),
+                                     frameSize.height - 2 * objSize.height - cvCeil(velocity.y * (framesCount + 2)));
+            if (maxStart.x <= objSize.width || maxStart.y <= objSize.height)
+            {
+                std::cout << "Object " << objSize << " is too big for the frame" << std::endl;
+                continue;
+            }
+
+            initTimes.clear();
+            updateTimes.clear();
+            size_t trackedCount = 0;
+            bool failed = false;
+            for (size_t obj = 0; obj < objectsCount && !failed; ++obj)
+            {
+                const cv::Point2f start(static_cast<float>(rng.uniform(objSize.width, maxStart.x)), static_cast<float>(rng.uniform(objSize.height, maxStart.y)));
+                auto ObjectRect = [&](size_t frameInd)
+                {
+                    return cv::Rect(cvRound(start.x + velocity.x * frameInd), cvRound(start.y + velocity.y * frameInd), objSize.width, objSize.height);
+                };
+
+                try
+                {
+                    sequence.Frame(0, ObjectRect(0), currFrame);
+                    if (framePyramid)
+                        framePyramid->Build(currFrame);
+                    const CRegion region(ObjectRect(0), 0, 1.f);
+                    CTrack track(region, tracking::KalmanLinear, 1.f, 0.1f, false, false, track_id_t(obj), true, type,
+                                 EmbeddingMemory(), StaticSnapshot::Settings(), nullptr, framePyramid, nullptr);
+
+                    // The detected object on the second frame: the visual tracker is initialized
+                    prevFrame = currFrame.clone();
+                    sequence.Frame(1, ObjectRect(1), currFrame);
+                    if (framePyramid)
+                        framePyramid->Build(currFrame);
+                    auto t1 = std::chrono::steady_clock::now();
+                    track.Update(CRegion(ObjectRect(1), 0, 1.f), true, 50, prevFrame, currFrame, 0, 10, true);
+                    auto t2 = std::chrono::steady_clock::now();
+                    initTimes.push_back(std::chrono::duration<double, std::milli>(t2 - t1).count());
+
+                    // The lost object is tracked only by the visual tracker
+                    for (size_t i = 2; i < framesCount + 2; ++i)
+                    {
+                        prevFrame = currFrame.clone();
+                        sequence.Frame(i, ObjectRect(i), currFrame);
+                        if (framePyramid)
+                            framePyramid->Build(currFrame);
+                        t1 = std::chrono::steady_clock::now();
+                        track.Update(CRegion(ObjectRect(i), 0, 0.f), false, 50, prevFrame, currFrame, 0, 10, true);
+                        t2 = std::chrono::steady_clock::now();
+                        updateTimes.push_back(std::chrono::duration<double, std::milli>(t2 - t1).count());
+                    }
+                    const cv::Rect lastRect = ObjectRect(framesCount + 1);
+                    const cv::Rect predicted = track.GetLastRect().boundingRect();
+                    if ((lastRect & predicted).area() > 0.5 * lastRect.area())
+                        ++trackedCount;
+                }
+                catch (const std::exception& ex)
+                {
+                    std::cout << LostTrackName(typeInt) << " failed: " << ex.what() << std::endl;
+                    failed = true;
+                }
+            }
+            if (failed || updateTimes.empty())
+                continue;
+
+            std::sort(updateTimes.begin(), updateTimes.end());
+            double initMean = 0;
+            for (double t : initTimes)
+            {
+                initMean += t;
+            }
+            initMean /= initTimes.size();
+            double updateMean = 0;
+            for (double t : updateTimes)
+            {
+                updateMean += t;
+            }
+            updateMean /= updateTimes.size();
+            const double trackedRatio = static_cast<double>(trackedCount) / objectsCount;
+
+            std::cout << std::left << std::setw(12) << LostTrackName(typeInt) << std::right << std::setw(10) << (std::to_string(objSize.width) + "x" + std::to_string(objSize.height))
+                      << std::fixed << std::setprecision(3) << std::setw(10) << initMean << std::setw(11) << updateMean
+                      << std::setw(9) << Percentile(updateTimes, 0.5) << std::setw(9) << Percentile(updateTimes, 0.99) << std::setw(9) << updateTimes.back()
+                      << std::setprecision(2) << std::setw(9) << trackedRatio << std::defaultfloat << std::endl;
+            if (csvFile.is_open())
+            {
+                csvFile << LostTrackName(typeInt) << "," << objSize.width << "," << objSize.height << "," << initMean << "," << updateMean << ","
+                        << Percentile(updateTimes, 0.5) << "," << Percentile(updateTimes, 0.99) << "," << updateTimes.back() << "," << trackedRatio << std::endl;
+            }
+        }
+    }
+
+    std::cout << "Correct exit" << std::endl;
+    return 0;
+}
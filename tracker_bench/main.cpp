@@ -0,0 +1,218 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <algorithm>
+#include <numeric>
+
+#include <opencv2/opencv.hpp>
+#include <opencv2/core/ocl.hpp>
+
+#include "DetectionsReplay.h"
+#include "FileLogger.h"
+#include "Ctracker.h"
+#include "metrics.h"
+
+// ----------------------------------------------------------------------
+
+static void Help()
+{
+    printf("\nTracker benchmark on the recorded detections without the detector\n"
+           "Usage: \n"
+           "          ./TrackerBench <detections file: csv or bin of the --res, MOTChallenge det.txt, mtfr of the flight recorder> [--settings]=<ini file> [--format]=<0 - auto, 1 - csv, 2 - bin, 3 - MOTChallenge, 4 - flight record> [--video]=<frames for the histograms, embeddings and visual trackers> [--fps]=<frames per second> [--min_confidence]=<threshold> [--repeat]=<runs count> [--res]=<csv with the tracks> \n\n"
+           );
+}
+
+const char* keys =
+{
+    "{ @1              |                    | Detections: csv or bin of the ResultsLog (--res of the examples), MOTChallenge det.txt, mtfr dump of the flight recorder | }"
+    "{ s settings      |../data/settings.ini | Ini file with the tracker settings | }"
+    "{ f format        |0                   | Format of the detections: 0 - by extension (.bin, .txt - MOTChallenge, .mtfr - flight record, other - csv), 1 - csv, 2 - bin, 3 - MOTChallenge, 4 - flight record | }"
+    "{ v video         |                    | Video of the detections, it's needed only for the histograms, embeddings and visual trackers of the lost objects | }"
+    "{ fps             |25                  | Frames per second of the detections without the video | }"
+    "{ mc min_confidence |0                 | The detections with the lower confidence are skipped | }"
+    "{ rp repeat       |1                   | Count of the runs with the new tracker, the latency is reported for the all runs | }"
+    "{ r res           |                    | Csv with the tracks of the last run | }"
+    "{ g gpu           |0                   | Use OpenCL acceleration | }"
+};
+
+///
+/// \brief Percentile
+/// \param sorted
+/// \param p - [0, 1]
+/// \return
+///
+static double Percentile(const std::vector<double>& sorted, double p)
+{
+    if (sorted.empty())
+        return 0.;
+    const size_t ind = std::min(sorted.size() - 1, static_cast<size_t>(p * (sorted.size() - 1) + 0.5));
+    return sorted[ind];
+}
+
+// ----------------------------------------------------------------------
+
+int main(int argc, char** argv)
+{
+    Help();
+
+    cv::CommandLineParser parser(argc, argv, keys);
+
+    bool useOCL = parser.get<int>("gpu") ? 1 : 0;
+    cv::ocl::setUseOpenCL(useOCL);
+    std::cout << (cv::ocl::useOpenCL() ? "OpenCL is enabled" : "OpenCL not used") << std::endl;
+
+    TrackerSettings settings;
+    if (!ParseTrackerSettings(parser.get<std::string>("settings"), settings))
+    {
+        std::cerr << "Can't read settings " << parser.get<std::string>("settings") << std::endl;
+        return 1;
+    }
+
+    DetectionsReplay replay;
+    const int format = std::max(0, std::min(static_cast<int>(DetectionsReplay::Format::FlightRecord), parser.get<int>("format")));
+    if (!replay.Open(parser.get<std::string>(0), static_cast<DetectionsReplay::Format>(format), parser.get<float>("min_confidence")))
+        return 1;
+    const auto& frames = replay.Frames();
+    std::cout << "Replay: " << frames.size() << " frames from " << frames.front().m_frameInd << ", " << replay.DetectionsCount() << " detections" << std::endl;
+    if (replay.SettingsHash() && settings.m_settingsHash != replay.SettingsHash())
+        std::cerr << "Replay: the flight record was made with the other settings file, the tracks can differ" << std::endl;
+    // The benchmark doesn't overwrite the dumps of the stream
+    settings.m_flightRecorderSeconds = 0.f;
+
+    // The frames are read once before the runs: the benchmark measures only the tracker
+    std::string videoFile = parser.get<std::string>("video");
+    float fps = std::max(1.f, parser.get<float>("fps"));
+    std::vector<cv::UMat> videoFrames;
+    cv::UMat emptyFrame;
+    if (!frames.front().m_image.empty())
+    {
+        // The downscaled frames of the flight record are restored to the size of the regions
+        cv::Mat frame;
+        for (const auto& replayFrame : frames)
+        {
+            if (replayFrame.m_image.empty())
+                break;
+            cv::resize(replayFrame.m_image, frame, replay.FrameSize(), 0, 0, cv::INTER_LINEAR);
+            if (frame.channels() == 1)
+                cv::cvtColor(frame, frame, cv::COLOR_GRAY2BGR);
+            videoFrames.emplace_back(frame.getUMat(cv::ACCESS_READ).clone());
+        }
+        std::cout << "Frames of the flight record: " << videoFrames.size() << std::endl;
+    }
+    else if (!videoFile.empty())
+    {
+        cv::VideoCapture capture(videoFile);
+        if (!capture.isOpened())
+        {
+            std::cerr << "Can't open " << videoFile << std::endl;
+            return 1;
+        }
+        fps = std::max(1.f, static_cast<float>(capture.get(cv::CAP_PROP_FPS)));
+        // MOTChallenge frames are numbered from 1
+        int videoFrameInd = (format == static_cast<int>(DetectionsReplay::Format::MOTChallenge) ||
+                             (format == 0 && ResultsLog::HasExtension(parser.get<std::string>(0), ".txt"))) ? 1 : 0;
+        cv::Mat frame;
+        for (const auto& replayFrame : frames)
+        {
+            while (videoFrameInd <= replayFrame.m_frameInd)
+            {
+                capture >> frame;
+                if (frame.empty())
+                    break;
+                ++videoFrameInd;
+            }
+            if (frame.empty())
+            {
+                std::cerr << "Video is shorter than the detections: " << videoFrames.size() << " frames" << std::endl;
+                break;
+            }
+            videoFrames.emplace_back(frame.getUMat(cv::ACCESS_READ).clone());
+        }
+    }
+    else
+    {
+        cv::Size frameSize = replay.FrameSize();
+        frameSize.width = std::max(frameSize.width, 1);
+        frameSize.height = std::max(frameSize.height, 1);
+        emptyFrame = cv::UMat(frameSize, CV_8UC3, cv::Scalar(0, 0, 0));
+        std::cout << "Without video, frame size " << frameSize << std::endl;
+    }
+    const size_t framesCount = videoFrames.empty() ? frames.size() : std::min(frames.size(), videoFrames.size());
+
+    ResultsLog resultsLog(parser.get<std::string>("res"), 1);
+    const bool writeResults = resultsLog.Open();
+
+    const int repeat = std::max(1, parser.get<int>("repeat"));
+    std::vector<double> latencies;
+    latencies.reserve(repeat * framesCount);
+    double allTime = 0;
+    std::vector<TrackingObject> tracks;
+    cv::UMat grayFrame;
+
+    // The scratch arena of the tracker grows on the first frames, then the steady state doesn't allocate
+    metrics::Counter& arenaAllocations = metrics::Registry::Instance().GetCounter("mtracker_frame_arena_allocations_total", "Allocations of the frame scratch out of the arena buffer, it doesn't grow on the steady state");
+    const size_t arenaWarmUp = std::min<size_t>(framesCount / 2, 10);
+    uint64_t arenaAllocationsStart = 0;
+    for (int run = 0; run < repeat; ++run)
+    {
+        std::unique_ptr<BaseTracker> tracker = BaseTracker::CreateTracker(settings);
+        if (!tracker)
+        {
+            std::cerr << "Tracker wasn't created" << std::endl;
+            return 1;
+        }
+        const bool colorFrame = tracker->CanColorFrameToTrack();
+
+        for (size_t i = 0; i < framesCount; ++i)
+        {
+            if (run == repeat - 1 && i == arenaWarmUp)
+                arenaAllocationsStart = arenaAllocations.Value();
+
+            cv::UMat frame = videoFrames.empty() ? emptyFrame : videoFrames[i];
+            if (!colorFrame && frame.channels() != 1)
+            {
+                cv::cvtColor(frame, grayFrame, cv::COLOR_BGR2GRAY);
+                frame = grayFrame;
+            }
+
+            // The flight record is replayed by the calls of the recorded tracker
+            const DetectionsReplay::Frame& replayFrame = frames[i];
+            const auto t1 = std::chrono::steady_clock::now();
+            if (replayFrame.m_timestamp >= 0)
+                tracker->UpdateAt(replayFrame.m_regions, frame, replayFrame.m_timestamp);
+            else if (!replayFrame.m_embeddings.empty())
+                tracker->Update(replayFrame.m_regions, replayFrame.m_embeddings, frame, replayFrame.m_fps);
+            else
+                tracker->Update(replayFrame.m_regions, frame, (replayFrame.m_fps > 0) ? replayFrame.m_fps : fps);
+            const auto t2 = std::chrono::steady_clock::now();
+            const double latency = std::chrono::duration<double, std::milli>(t2 - t1).count();
+            latencies.push_back(latency);
+            allTime += latency;
+
+            if (writeResults && run == repeat - 1)
+            {
+                tracker->GetTracks(tracks);
+                for (const auto& track : tracks)
+                {
+                    if (track.IsRobust(cvRound(fps / 4), 0.7f, cv::Size2f(0.1f, 8.0f)))
+                    {
+                        resultsLog.AddTrack(frames[i].m_frameInd, track.m_ID, track.m_rrect.boundingRect(), track.m_type, track.m_confidence);
+                        resultsLog.AddRobustTrack(track.m_ID);
+                    }
+                }
+            }
+        }
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "Tracker: " << repeat << " runs of " << framesCount << " frames, " << (allTime > 0 ? (1000. * latencies.size() / allTime) : 0.) << " fps" << std::endl;
+    std::cout << "Frame latency, ms: mean " << (latencies.empty() ? 0. : allTime / latencies.size())
+              << ", p50 " << Percentile(latencies, 0.5) << ", p90 " << Percentile(latencies, 0.9) << ", p99 " << Percentile(latencies, 0.99)
+              << ", max " << (latencies.empty() ? 0. : latencies.back()) << std::endl;
+    std::cout << std::defaultfloat;
+    std::cout << "Frame arena: " << (arenaAllocations.Value() - arenaAllocationsStart) << " allocations after " << arenaWarmUp << " frames of the last run" << std::endl;
+
+    std::cout << "Correct exit" << std::endl;
+    return 0;
+}
@@ -0,0 +1,399 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <algorithm>
+
+#include <opencv2/opencv.hpp>
+#include <opencv2/core/ocl.hpp>
+
+#include <inih/INIReader.h>
+
+#ifdef HAVE_FILESYSTEM
+#include <filesystem>
+namespace fs = std::filesystem;
+#endif
+
+#include "DetectionsReplay.h"
+#include "MotEvaluator.h"
+#include "ProcessMemory.h"
+#include "FileLogger.h"
+#include "Ctracker.h"
+
+// ----------------------------------------------------------------------
+
+static void Help()
+{
+    printf("\nMOTChallenge evaluation and throughput of the tracker settings on the public detections\n"
+           "Usage: \n"
+           "          ./MotBench <MOTChallenge split: MOT17/train> [--settings]=<comma separated ini files> [--seqs]=<comma separated sequences or seqmap file> [--mot20]=<-1 - by path, 0, 1> [--images]=<0 or 1> [--min_confidence]=<threshold> [--robust]=<0 or 1> [--out]=<json file> \n\n"
+           );
+}
+
+const char* keys =
+{
+    "{ @1              |                    | MOTChallenge split directory with the sequences: <seq>/det/det.txt, <seq>/gt/gt.txt, <seq>/seqinfo.ini | }"
+    "{ s settings      |../data/settings.ini | Comma separated ini files: the presets of the tracker settings | }"
+    "{ q seqs          |                    | Comma separated sequences or the text file with the sequence per line (seqmap), empty - the all sequences of the split | }"
+    "{ m mot20         |-1                  | MOT20 distractor classes: -1 - if the path contains MOT20, 0 - no, 1 - yes | }"
+    "{ i images        |0                   | Read the frames from <seq>/img1 for the histograms, embeddings and visual trackers, the reading isn't measured | }"
+    "{ mc min_confidence |0                 | The detections with the lower confidence are skipped | }"
+    "{ rb robust       |1                   | Evaluate only the robust tracks like the --res of the examples | }"
+    "{ o out           |                    | Json with the metrics of the every preset and sequence | }"
+    "{ g gpu           |0                   | Use OpenCL acceleration | }"
+};
+
+///
+/// \brief Percentile
+/// \param sorted
+/// \param p - [0, 1]
+/// \return
+///
+static double Percentile(const std::vector<double>& sorted, double p)
+{
+    if (sorted.empty())
+        return 0.;
+    const size_t ind = std::min(sorted.size() - 1, static_cast<size_t>(p * (sorted.size() - 1) + 0.5));
+    return sorted[ind];
+}
+
+///
+/// \brief SplitList
+/// \param list - comma separated or the file with the item per line
+/// \return
+///
+static std::vector<std::string> SplitList(const std::string& list)
+{
+    std::vector<std::string> res;
+    auto AddItem = [&res](std::string item)
+    {
+        item.erase(0, item.find_first_not_of(" \t\r"));
+        item.erase(item.find_last_not_of(" \t\r") + 1);
+        if (!item.empty())
+            res.emplace_back(item);
+    };
+    if (ResultsLog::HasExtension(list, ".txt"))
+    {
+        std::ifstream file(list);
+        std::string line;
+        while (std::getline(file, line))
+        {
+            // The seqmap of the devkit begins with the "name" header
+            if (line.find("name") != 0)
+                AddItem(line);
+        }
+    }
+    else
+    {
+        std::stringstream ss(list);
+        std::string item;
+        while (std::getline(ss, item, ','))
+        {
+            AddItem(item);
+        }
+    }
+    return res;
+}
+
+///
+/// \brief FileStem
+/// \param fileName
+/// \return The file name without the directory and extension
+///
+static std::string FileStem(const std::string& fileName)
+{
+    const size_t slash = fileName.find_last_of("/\\");
+    std::string res = (slash == std::string::npos) ? fileName : fileName.substr(slash + 1);
+    const size_t dot = res.find_last_of('.');
+    if (dot != std::string::npos && dot > 0)
+        res.resize(dot);
+    return res;
+}
+
+///
+/// \brief The SequenceResult struct
+///
+struct SequenceResult
+{
+    std::string m_preset;
+    std::string m_sequence;
+    size_t m_frames = 0;
+    MotMetrics m_metrics;
+    std::vector<double> m_latencies;
+    double m_allTime = 0;
+    double m_peakRssMb = 0;
+
+    ///
+    double Fps() const
+    {
+        return (m_allTime > 0) ? (1000. * m_latencies.size() / m_allTime) : 0.;
+    }
+};
+
+///
+/// \brief RunSequence
+/// \param settings
+/// \param seqDir
+/// \param mot20
+/// \param useImages
+/// \param minConfidence
+/// \param robustOnly
+/// \param result
+/// \return
+///
+static bool RunSequence(const TrackerSettings& settings, const std::string& seqDir, bool mot20, bool useImages, float minConfidence, bool robustOnly, SequenceResult& result)
+{
+    INIReader seqInfo(seqDir + "/seqinfo.ini");
+    if (seqInfo.ParseError() < 0)
+    {
+        std::cerr << "Can't read " << seqDir << "/seqinfo.ini" << std::endl;
+        return false;
+    }
+    const float fps = std::max(1.f, static_cast<float>(seqInfo.GetReal("Sequence", "frameRate", 30)));
+    const int seqLength = static_cast<int>(seqInfo.GetInteger("Sequence", "seqLength", 0));
+    const cv::Size frameSize(std::max(1, static_cast<int>(seqInfo.GetInteger("Sequence", "imWidth", 1920))),
+                             std::max(1, static_cast<int>(seqInfo.GetInteger("Sequence", "imHeight", 1080))));
+    const std::string imDir = seqInfo.GetString("Sequence", "imDir", "img1");
+    const std::string imExt = seqInfo.GetString("Sequence", "imExt", ".jpg");
+
+    DetectionsReplay replay;
+    if (!replay.Open(seqDir + "/det/det.txt", DetectionsReplay::Format::MOTChallenge, minConfidence))
+        return false;
+    replay.ExtendFrames(1, seqLength);
+
+    MotEvaluator evaluator;
+    if (!evaluator.ReadGroundTruth(seqDir + "/gt/gt.txt", mot20))
+        return false;
+
+    std::unique_ptr<BaseTracker> tracker = BaseTracker::CreateTracker(settings);
+    if (!tracker)
+    {
+        std::cerr << "Tracker wasn't created" << std::endl;
+        return false;
+    }
+    const bool colorFrame = tracker->CanColorFrameToTrack();
+
+    cv::UMat emptyFrame(frameSize, CV_8UC3, cv::Scalar(0, 0, 0));
+    cv::UMat imageFrame;
+    cv::UMat frame;
+    cv::UMat grayFrame;
+    std::vector<TrackingObject> tracks;
+    std::vector<MotBox> motTracks;
+    char imName[32];
+    result.m_latencies.reserve(replay.Frames().size());
+    for (const auto& replayFrame : replay.Frames())
+    {
+        if (replayFrame.m_frameInd < 1)
+            continue;
+        if (useImages)
+        {
+            snprintf(imName, sizeof(imName), "/%06d", replayFrame.m_frameInd);
+            cv::Mat image = cv::imread(seqDir + "/" + imDir + imName + imExt);
+            if (image.empty())
+            {
+                std::cerr << "Can't read the frame " << replayFrame.m_frameInd << " from " << seqDir << "/" << imDir << std::endl;
+                return false;
+            }
+            image.copyTo(imageFrame);
+            frame = imageFrame;
+        }
+        else
+        {
+            frame = emptyFrame;
+        }
+        if (!colorFrame && frame.channels() != 1)
+        {
+            cv::cvtColor(frame, grayFrame, cv::COLOR_BGR2GRAY);
+            frame = grayFrame;
+        }
+
+        const auto t1 = std::chrono::steady_clock::now();
+        tracker->Update(replayFrame.m_regions, frame, fps);
+        const auto t2 = std::chrono::steady_clock::now();
+        const double latency = std::chrono::duration<double, std::milli>(t2 - t1).count();
+        result.m_latencies.push_back(latency);
+        result.m_allTime += latency;
+
+        // The filter is evaluated before the objects are constructed, the trajectories aren't needed
+        TracksQuery query;
+        query.m_robustOnly = robustOnly;
+        query.m_minTraceSize = cvRound(fps / 4);
+        query.m_minRawRatio = 0.7f;
+        query.m_sizeRatio = cv::Size2f(0.1f, 8.0f);
+        query.m_tailSize = 0;
+        tracker->QueryTracks(query, tracks);
+        motTracks.clear();
+        for (const auto& track : tracks)
+        {
+            const cv::Rect brect = track.m_rrect.boundingRect();
+            motTracks.emplace_back(static_cast<int>(track.m_ID.m_val), cv::Rect2f(static_cast<float>(brect.x), static_cast<float>(brect.y), static_cast<float>(brect.width), static_cast<float>(brect.height)));
+        }
+        evaluator.AddFrame(replayFrame.m_frameInd, motTracks);
+        ++result.m_frames;
+    }
+    result.m_metrics = evaluator.Evaluate();
+    result.m_peakRssMb = PeakRssMb();
+    std::sort(result.m_latencies.begin(), result.m_latencies.end());
+    return true;
+}
+
+///
+/// \brief PrintResult
+/// \param preset
+/// \param sequence
+/// \param metrics
+/// \param fps
+/// \param latencies - sorted
+/// \param peakRssMb
+///
+static void PrintResult(const std::string& preset, const std::string& sequence, const MotMetrics& metrics, double fps, const std::vector<double>& latencies, double peakRssMb)
+{
+    std::cout << std::left << std::setw(16) << preset << std::setw(16) << sequence << std::right << std::fixed << std::setprecision(1)
+              << std::setw(7) << 100. * metrics.MOTA() << std::setw(7) << 100. * metrics.IDF1() << std::setw(7) << 100. * metrics.HOTA()
+              << std::setw(7) << 100. * metrics.DetA() << std::setw(7) << 100. * metrics.AssA() << std::setw(7) << metrics.m_idSwitches
+              << std::setw(9) << fps << std::setprecision(3) << std::setw(9) << Percentile(latencies, 0.5) << std::setw(9) << Percentile(latencies, 0.99)
+              << std::setprecision(1) << std::setw(9) << peakRssMb << std::defaultfloat << std::endl;
+}
+
+///
+/// \brief WriteJsonResult
+/// \param file
+/// \param preset
+/// \param sequence
+/// \param frames
+/// \param metrics
+/// \param fps
+/// \param latencies - sorted
+/// \param peakRssMb
+///
+static void WriteJsonResult(std::ofstream& file, const std::string& preset, const std::string& sequence, size_t frames, const MotMetrics& metrics, double fps, const std::vector<double>& latencies, double peakRssMb)
+{
+    file << "{\"preset\":\"" << preset << "\",\"sequence\":\"" << sequence << "\",\"frames\":" << frames
+         << ",\"MOTA\":" << metrics.MOTA() << ",\"MOTP\":" << metrics.MOTP() << ",\"IDF1\":" << metrics.IDF1()
+         << ",\"HOTA\":" << metrics.HOTA() << ",\"DetA\":" << metrics.DetA() << ",\"AssA\":" << metrics.AssA()
+         << ",\"IDSW\":" << metrics.m_idSwitches << ",\"gt_dets\":" << metrics.m_gtDets << ",\"tracker_dets\":" << metrics.m_trDets
+         << ",\"fps\":" << fps << ",\"latency_p50_ms\":" << Percentile(latencies, 0.5) << ",\"latency_p99_ms\":" << Percentile(latencies, 0.99)
+         << ",\"peak_rss_mb\":" << peakRssMb << "}";
+}
+
+// ----------------------------------------------------------------------
+
+int main(int argc, char** argv)
+{
+    Help();
+
+    cv::CommandLineParser parser(argc, argv, keys);
+
+    bool useOCL = parser.get<int>("gpu") ? 1 : 0;
+    cv::ocl::setUseOpenCL(useOCL);
+    std::cout << (cv::ocl::useOpenCL() ? "OpenCL is enabled" : "OpenCL not used") << std::endl;
+
+    const std::string splitDir = parser.get<std::string>(0);
+    if (splitDir.empty())
+    {
+        std::cerr << "MOTChallenge split directory is empty" << std::endl;
+        return 1;
+    }
+    std::vector<std::string> sequences = SplitList(parser.get<std::string>("seqs"));
+    if (sequences.empty())
+    {
+#ifdef HAVE_FILESYSTEM
+        for (const auto& entry : fs::directory_iterator(splitDir))
+        {
+            if (entry.is_directory() && fs::exists(entry.path() / "gt" / "gt.txt"))
+                sequences.emplace_back(entry.path().filename().string());
+        }
+        std::sort(sequences.begin(), sequences.end());
+#else
+        std::cerr << "Sequences are not defined: use --seqs" << std::endl;
+        return 1;
+#endif
+    }
+    if (sequences.empty())
+    {
+        std::cerr << "Sequences with the ground truth are not found in " << splitDir << std::endl;
+        return 1;
+    }
+
+    const int mot20Flag = parser.get<int>("mot20");
+    const bool mot20 = (mot20Flag < 0) ? (splitDir.find("MOT20") != std::string::npos) : (mot20Flag != 0);
+    const bool useImages = parser.get<int>("images") != 0;
+    const float minConfidence = parser.get<float>("min_confidence");
+    const bool robustOnly = parser.get<int>("robust") != 0;
+
+    std::ofstream jsonFile;
+    const std::string outFile = parser.get<std::string>("out");
+    if (!outFile.empty())
+    {
+        jsonFile.open(outFile, std::ios::trunc);
+        if (!jsonFile.is_open())
+        {
+            std::cerr << "Can't create " << outFile << std::endl;
+            return 1;
+        }
+        jsonFile << "{\"split\":\"" << splitDir << "\",\"mot20\":" << (mot20 ? "true" : "false") << ",\"results\":[\n";
+    }
+    bool firstJson = true;
+
+    std::cout << std::left << std::setw(16) << "preset" << std::setw(16) << "sequence" << std::right
+              << std::setw(7) << "MOTA" << std::setw(7) << "IDF1" << std::setw(7) << "HOTA" << std::setw(7) << "DetA" << std::setw(7) << "AssA" << std::setw(7) << "IDSW"
+              << std::setw(9) << "fps" << std::setw(9) << "p50 ms" << std::setw(9) << "p99 ms" << std::setw(9) << "RSS MB" << std::endl;
+
+    const std::vector<std::string> presets = SplitList(parser.get<std::string>("settings"));
+    for (const auto& presetFile : presets)
+    {
+        TrackerSettings settings;
+        if (!ParseTrackerSettings(presetFile, settings))
+        {
+            std::cerr << "Can't read settings " << presetFile << std::endl;
+            return 1;
+        }
+        const std::string preset = FileStem(presetFile);
+
+        MotMetrics combined;
+        std::vector<double> allLatencies;
+        double allTime = 0;
+        size_t allFrames = 0;
+        double peakRssMb = 0;
+        for (const auto& sequence : sequences)
+        {
+            SequenceResult result;
+            if (!RunSequence(settings, splitDir + "/" + sequence, mot20, useImages, minConfidence, robustOnly, result))
+            {
+                std::cerr << "Sequence " << sequence << " was skipped" << std::endl;
+                continue;
+            }
+            PrintResult(preset, sequence, result.m_metrics, result.Fps(), result.m_latencies, result.m_peakRssMb);
+            if (jsonFile.is_open())
+            {
+                jsonFile << (firstJson ? "" : ",\n");
+                WriteJsonResult(jsonFile, preset, sequence, result.m_frames, result.m_metrics, result.Fps(), result.m_latencies, result.m_peakRssMb);
+                firstJson = false;
+            }
+
+            combined.Add(result.m_metrics);
+            allLatencies.insert(allLatencies.end(), result.m_latencies.begin(), result.m_latencies.end());
+            allTime += result.m_allTime;
+            allFrames += result.m_frames;
+            peakRssMb = std::max(peakRssMb, result.m_peakRssMb);
+        }
+        if (allFrames)
+        {
+            std::sort(allLatencies.begin(), allLatencies.end());
+            const double fps = (allTime > 0) ? (1000. * allLatencies.size() / allTime) : 0.;
+            PrintResult(preset, "COMBINED", combined, fps, allLatencies, peakRssMb);
+            if (jsonFile.is_open())
+            {
+                jsonFile << (firstJson ? "" : ",\n");
+                WriteJsonResult(jsonFile, preset, "COMBINED", allFrames, combined, fps, allLatencies, peakRssMb);
+                firstJson = false;
+            }
+        }
+    }
+    if (jsonFile.is_open())
+        jsonFile << "\n]}\n";
+
+    std::cout << "Correct exit" << std::endl;
+    return 0;
+}
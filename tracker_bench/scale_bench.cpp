@@ -0,0 +1,263 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+
+#include <opencv2/opencv.hpp>
+#include <opencv2/core/ocl.hpp>
+
+#include "SyntheticScene.h"
+#include "Ctracker.h"
+#include "metrics.h"
+
+// ----------------------------------------------------------------------
+
+static void Help()
+{
+    printf("\nScaling of the tracker stages on the synthetic crowds\n"
+           "Usage: \n"
+           "          ./ScaleBench [--counts]=<comma separated objects counts> [--match]=<comma separated MatchType> [--kalman]=<comma separated KalmanType> [--frames]=<frames count> [--settings]=<ini file> [--motion]=<0 - linear, 1 - random walk, 2 - turns> [--occlusion]=<rate> [--miss]=<rate> [--fp]=<rate> [--max_frame_ms]=<ms> [--out]=<csv file> \n\n"
+           );
+}
+
+const char* keys =
+{
+    "{ c counts        |10,30,100,300,1000,3000,10000 | Comma separated counts of the objects in the scene | }"
+    "{ m match         |0,1,2,3             | Comma separated MatchType: 0 - Hungrian, 1 - Bipart, 2 - LAPJV, 3 - Greedy | }"
+    "{ k kalman        |0,1,2               | Comma separated KalmanType: 0 - Linear, 1 - Unscented, 2 - AugmentedUnscented | }"
+    "{ n frames        |100                 | Measured frames for the every run, the first 10 frames are the warm up | }"
+    "{ s settings      |                    | Ini file with the tracker settings, empty - centers and IoU distance without the visual trackers | }"
+    "{ mo motion       |0                   | Motion model: 0 - linear, 1 - random walk, 2 - turns | }"
+    "{ sp speed        |4                   | Mean speed of the objects in pixels per frame | }"
+    "{ d density       |50                  | Objects per megapixel: the frame grows with the objects count | }"
+    "{ oc occlusion    |0.01                | Probability of the occlusion start for the object on the frame | }"
+    "{ ms miss         |0.05                | Probability of the missed detection | }"
+    "{ fp false_positives |0.02             | False positives on the frame relative to the objects count | }"
+    "{ sd seed         |305419896           | Seed of the scene generator | }"
+    "{ mf max_frame_ms |1000                | The larger counts are skipped for the configuration with the slower frames | }"
+    "{ o out           |                    | Csv with the results | }"
+    "{ g gpu           |0                   | Use OpenCL acceleration | }"
+};
+
+///
+/// \brief ParseInts
+/// \param list - comma separated
+/// \return
+///
+static std::vector<int> ParseInts(const std::string& list)
+{
+    std::vector<int> res;
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ','))
+    {
+        if (!item.empty())
+            res.push_back(std::atoi(item.c_str()));
+    }
+    return res;
+}
+
+///
+/// \brief The StageTime struct
+/// Increment of the stage histogram of CTracker between two moments
+///
+struct StageTime
+{
+    metrics::Histogram& m_histogram;
+    metrics::Histogram::Snapshot m_start;
+
+    explicit StageTime(const std::string& stage)
+        : m_histogram(metrics::Registry::Instance().GetHistogram("mtracker_tracker_stage_seconds{stage=\"" + stage + "\"}", "Time of the CTracker::Update stages"))
+    {
+    }
+
+    ///
+    void Start()
+    {
+        m_start = m_histogram.Collect();
+    }
+    ///
+    /// \brief TotalMs
+    /// \return Time of the stage from the Start
+    ///
+    double TotalMs() const
+    {
+        return (m_histogram.Collect().m_sumNs - m_start.m_sumNs) / 1e6;
+    }
+};
+
+///
+static const char* MatchName(int matchType)
+{
+    static const char* names[] = { "Hungrian", "Bipart", "LAPJV", "Greedy", "Auto" };
+    return (matchType >= 0 && matchType < tracking::MatchCount) ? names[matchType] : "?";
+}
+
+///
+static const char* KalmanName(int kalmanType)
+{
+    static const char* names[] = { "Linear", "Unscented", "AugmentedUnscented" };
+    return (kalmanType >= 0 && kalmanType < tracking::KalmanCount) ? names[kalmanType] : "?";
+}
+
+// ----------------------------------------------------------------------
+
+int main(int argc, char** argv)
+{
+    Help();
+
+    cv::CommandLineParser parser(argc, argv, keys);
+
+    bool useOCL = parser.get<int>("gpu") ? 1 : 0;
+    cv::ocl::setUseOpenCL(useOCL);
+    std::cout << (cv::ocl::useOpenCL() ? "OpenCL is enabled" : "OpenCL not used") << std::endl;
+
+    TrackerSettings baseSettings;
+    const std::string settingsFile = parser.get<std::string>("settings");
+    if (!settingsFile.empty())
+    {
+        if (!ParseTrackerSettings(settingsFile, baseSettings))
+        {
+            std::cerr << "Can't read settings " << settingsFile << std::endl;
+            return 1;
+        }
+    }
+    else
+    {
+        // The synthetic frames are empty: only the geometric distances
+        std::array<track_t, tracking::DistsCount> distType {};
+        distType[tracking::DistCenters] = 0.5f;
+        distType[tracking::DistJaccard] = 0.5f;
+        baseSettings.SetDistances(distType);
+        baseSettings.m_filterGoal = tracking::FilterRect;
+        baseSettings.m_lostTrackType = tracking::TrackNone;
+        baseSettings.m_useAbandonedDetection = false;
+        baseSettings.m_maximumAllowedSkippedFrames = 25;
+        baseSettings.m_maxTraceLength = 50;
+    }
+
+    const std::vector<int> counts = ParseInts(parser.get<std::string>("counts"));
+    const std::vector<int> matchTypes = ParseInts(parser.get<std::string>("match"));
+    const std::vector<int> kalmanTypes = ParseInts(parser.get<std::string>("kalman"));
+    const size_t framesCount = static_cast<size_t>(std::max(1, parser.get<int>("frames")));
+    constexpr size_t warmUpFrames = 10;
+    const double density = std::max(1., parser.get<double>("density"));
+    const double maxFrameMs = parser.get<double>("max_frame_ms");
+    const float fps = 25.f;
+
+    SyntheticSceneSettings sceneSettings;
+    sceneSettings.m_motion = static_cast<SyntheticSceneSettings::Motion>(std::max(0, std::min(2, parser.get<int>("motion"))));
+    sceneSettings.m_speed = parser.get<float>("speed");
+    sceneSettings.m_occlusionRate = parser.get<float>("occlusion");
+    sceneSettings.m_missRate = parser.get<float>("miss");
+    sceneSettings.m_falsePositivesRate = parser.get<float>("false_positives");
+    sceneSettings.m_seed = static_cast<uint64_t>(parser.get<double>("seed"));
+
+    std::ofstream csvFile;
+    const std::string outFile = parser.get<std::string>("out");
+    if (!outFile.empty())
+    {
+        csvFile.open(outFile, std::ios::trunc);
+        if (!csvFile.is_open())
+        {
+            std::cerr << "Can't create " << outFile << std::endl;
+            return 1;
+        }
+        csvFile << "match,kalman,objects,detections,tracks,frame_ms,cost_matrix_ms,solve_ms,tracks_update_ms,track_update_us" << std::endl;
+    }
+
+    std::cout << std::left << std::setw(10) << "match" << std::setw(20) << "kalman" << std::right << std::setw(8) << "objects" << std::setw(8) << "tracks"
+              << std::setw(11) << "frame ms" << std::setw(11) << "cost ms" << std::setw(11) << "solve ms" << std::setw(11) << "update ms" << std::setw(12) << "track us" << std::endl;
+
+    StageTime costMatrixTime("cost_matrix");
+    StageTime solveTime("solve");
+    StageTime tracksUpdateTime("tracks_update");
+
+    regions_t regions;
+    cv::UMat frame;
+    for (int matchType : matchTypes)
+    {
+        if (matchType < 0 || matchType >= tracking::MatchCount)
+            continue;
+        for (int kalmanType : kalmanTypes)
+        {
+            if (kalmanType < 0 || kalmanType >= tracking::KalmanCount)
+                continue;
+
+            TrackerSettings settings = baseSettings;
+            settings.m_matchType = static_cast<tracking::MatchType>(matchType);
+            settings.m_kalmanType = static_cast<tracking::KalmanType>(kalmanType);
+
+            for (int count : counts)
+            {
+                if (count <= 0)
+                    continue;
+
+                // The same density of the objects for the all counts
+                sceneSettings.m_objectsCount = static_cast<size_t>(count);
+                const double side = std::sqrt(1e6 * count / density / (16. * 9.));
+                sceneSettings.m_frameSize = cv::Size(cvRound(16 * side), cvRound(9 * side));
+                SyntheticScene scene(sceneSettings);
+
+                std::unique_ptr<BaseTracker> tracker = BaseTracker::CreateTracker(settings);
+                if (!tracker)
+                {
+                    std::cerr << "Tracker wasn't created" << std::endl;
+                    return 1;
+                }
+                frame = cv::UMat(sceneSettings.m_frameSize, tracker->CanColorFrameToTrack() ? CV_8UC3 : CV_8UC1, cv::Scalar::all(0));
+
+                double allTime = 0;
+                size_t detections = 0;
+                size_t tracks = 0;
+                for (size_t i = 0; i < warmUpFrames + framesCount; ++i)
+                {
+                    scene.Next(regions);
+                    if (i == warmUpFrames)
+                    {
+                        costMatrixTime.Start();
+                        solveTime.Start();
+                        tracksUpdateTime.Start();
+                    }
+                    const auto t1 = std::chrono::steady_clock::now();
+                    tracker->Update(regions, frame, fps);
+                    const auto t2 = std::chrono::steady_clock::now();
+                    if (i >= warmUpFrames)
+                    {
+                        allTime += std::chrono::duration<double, std::milli>(t2 - t1).count();
+                        detections += regions.size();
+                        tracks += tracker->GetTracksCount();
+                    }
+                }
+                const double frameMs = allTime / framesCount;
+                const double costMs = costMatrixTime.TotalMs() / framesCount;
+                const double solveMs = solveTime.TotalMs() / framesCount;
+                const double updateMs = tracksUpdateTime.TotalMs() / framesCount;
+                const double meanTracks = static_cast<double>(tracks) / framesCount;
+                const double trackUs = (meanTracks > 0) ? (1000. * updateMs / meanTracks) : 0.;
+
+                std::cout << std::left << std::setw(10) << MatchName(matchType) << std::setw(20) << KalmanName(kalmanType) << std::right << std::setw(8) << count
+                          << std::setw(8) << cvRound(meanTracks) << std::fixed << std::setprecision(3)
+                          << std::setw(11) << frameMs << std::setw(11) << costMs << std::setw(11) << solveMs << std::setw(11) << updateMs << std::setw(12) << trackUs
+                          << std::defaultfloat << std::endl;
+                if (csvFile.is_open())
+                {
+                    csvFile << MatchName(matchType) << "," << KalmanName(kalmanType) << "," << count << "," << (static_cast<double>(detections) / framesCount) << ","
+                            << meanTracks << "," << frameMs << "," << costMs << "," << solveMs << "," << updateMs << "," << trackUs << std::endl;
+                }
+
+                if (maxFrameMs > 0 && frameMs > maxFrameMs)
+                {
+                    std::cout << "The larger counts are skipped for " << MatchName(matchType) << " " << KalmanName(kalmanType) << ": " << frameMs << " ms per frame" << std::endl;
+                    break;
+                }
+            }
+        }
+    }
+
+    std::cout << "Correct exit" << std::endl;
+    return 0;
+}
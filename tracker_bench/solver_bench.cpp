@@ -0,0 +1,334 @@
+#include <iostream>
+#include <memory>
+
+#include <opencv2/opencv.hpp>
+
+#include "MicroBench.h"
+#include "ShortPathCalculator.h"
+#include "track.h"
+#include "RegionHistograms.h"
+
+// ----------------------------------------------------------------------
+
+static void Help()
+{
+    printf("\nMicrobenchmarks of the assignment solvers and distance kernels\n"
+           "Usage: \n"
+           "          ./SolverBench [--sizes]=<comma separated matrix sizes> [--min_time]=<ms per benchmark> [--repetitions]=<count> [--filter]=<substring of the names> [--out]=<csv file> [--baseline]=<csv of the previous run> \n\n"
+           );
+}
+
+const char* keys =
+{
+    "{ sz sizes        |10,50,100,200,500   | Comma separated sizes of the square cost matrices | }"
+    "{ t min_time      |200                 | Min time of the one benchmark in milliseconds | }"
+    "{ rp repetitions  |5                   | Repetitions of the measured batch, the median is reported | }"
+    "{ f filter        |                    | Only the benchmarks with the names containing the substring | }"
+    "{ o out           |                    | Csv with the results, it's the baseline for the next runs | }"
+    "{ b baseline      |                    | Csv of the previous run: the ratio of the median times is reported | }"
+    "{ sd seed         |305419896           | Seed of the random matrices | }"
+};
+
+///
+/// \brief The MatrixKind enum
+///
+enum class MatrixKind
+{
+    Random,    // Uniform costs in [0, 1)
+    Sparse,    // 5% of the pairs are feasible, other have the forbidden cost
+    Clustered  // Tracks and regions are in the small groups: the feasible pairs are inside the groups
+};
+
+///
+static const char* MatrixKindName(MatrixKind kind)
+{
+    switch (kind)
+    {
+    case MatrixKind::Random:
+        return "random";
+    case MatrixKind::Sparse:
+        return "sparse";
+    default:
+        return "clustered";
+    }
+}
+
+///
+/// \brief GenerateMatrix
+/// \param kind
+/// \param size - rows and columns
+/// \param distThres - pairs over it are forbidden
+/// \param rng
+/// \return Cost matrix like CTracker::CreateDistaceMatrix
+///
+static distMatrix_t GenerateMatrix(MatrixKind kind, size_t size, track_t distThres, cv::RNG& rng)
+{
+    distMatrix_t costMatrix(size, size, 1.f);
+    switch (kind)
+    {
+    case MatrixKind::Random:
+        for (size_t row = 0; row < size; ++row)
+        {
+            for (size_t col = 0; col < size; ++col)
+            {
+                costMatrix(row, col) = rng.uniform(0.f, 1.f);
+            }
+        }
+        break;
+
+    case MatrixKind::Sparse:
+        for (size_t row = 0; row < size; ++row)
+        {
+            for (size_t col = 0; col < size; ++col)
+            {
+                if (rng.uniform(0.f, 1.f) < 0.05f)
+                    costMatrix(row, col) = rng.uniform(0.f, distThres);
+            }
+        }
+        break;
+
+    case MatrixKind::Clustered:
+    {
+        // Groups of 1-8 objects in the unit square, the regions are the noisy tracks
+        std::vector<cv::Point2f> tracks(size);
+        std::vector<cv::Point2f> regions(size);
+        size_t i = 0;
+        while (i < size)
+        {
+            const cv::Point2f center(rng.uniform(0.f, 1.f), rng.uniform(0.f, 1.f));
+            const size_t groupSize = std::min(size - i, static_cast<size_t>(rng.uniform(1, 9)));
+            for (size_t k = 0; k < groupSize; ++k, ++i)
+            {
+                tracks[i] = center + cv::Point2f(static_cast<float>(rng.gaussian(0.01)), static_cast<float>(rng.gaussian(0.01)));
+                regions[i] = tracks[i] + cv::Point2f(static_cast<float>(rng.gaussian(0.005)), static_cast<float>(rng.gaussian(0.005)));
+            }
+        }
+        for (size_t j = 0; j < size; ++j)
+        {
+            const size_t ind = static_cast<size_t>(rng.uniform(0, static_cast<int>(j) + 1));
+            std::swap(regions[j], regions[ind]);
+        }
+        for (size_t row = 0; row < size; ++row)
+        {
+            for (size_t col = 0; col < size; ++col)
+            {
+                const cv::Point2f diff = tracks[row] - regions[col];
+                costMatrix(row, col) = std::min(1.f, 20.f * std::sqrt(diff.x * diff.x + diff.y * diff.y));
+            }
+        }
+        break;
+    }
+    }
+    return costMatrix;
+}
+
+///
+/// \brief ParseSizes
+/// \param list
+/// \return
+///
+static std::vector<size_t> ParseSizes(const std::string& list)
+{
+    std::vector<size_t> res;
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ','))
+    {
+        const int size = std::atoi(item.c_str());
+        if (size > 0)
+            res.push_back(static_cast<size_t>(size));
+    }
+    return res;
+}
+
+///
+/// \brief RandomRegion
+/// \param rng
+/// \return
+///
+static CRegion RandomRegion(cv::RNG& rng)
+{
+    const int w = rng.uniform(20, 80);
+    const int h = rng.uniform(40, 160);
+    return CRegion(cv::Rect(rng.uniform(0, 1920 - w), rng.uniform(0, 1080 - h), w, h), 0, 1.f);
+}
+
+///
+/// \brief RandomEmbedding
+/// \param rng
+/// \param size
+/// \return
+///
+static cv::Mat RandomEmbedding(cv::RNG& rng, int size)
+{
+    cv::Mat embedding(1, size, CV_32FC1);
+    rng.fill(embedding, cv::RNG::UNIFORM, -1.f, 1.f);
+    cv::normalize(embedding, embedding);
+    return embedding;
+}
+
+///
+/// \brief CreateTrack
+/// \param region
+/// \param embedding
+/// \param hist
+/// \param fp16 - half precision signature of the track
+/// \return
+///
+static std::unique_ptr<CTrack> CreateTrack(const CRegion& region, const cv::Mat& embedding, const cv::Mat& hist, bool fp16)
+{
+    RegionEmbedding regionEmbedding;
+    regionEmbedding.m_hist = hist;
+    regionEmbedding.m_embedding = embedding;
+    regionEmbedding.m_embDot = embedding.empty() ? 0. : embedding.dot(embedding);
+    return std::make_unique<CTrack>(region, regionEmbedding, tracking::KalmanLinear, 1.f, 0.1f, false, false, track_id_t(0), true, tracking::TrackNone,
+                                    EmbeddingMemory(0.f, fp16), StaticSnapshot::Settings(), nullptr, nullptr, nullptr);
+}
+
+// ----------------------------------------------------------------------
+
+int main(int argc, char** argv)
+{
+    Help();
+
+    cv::CommandLineParser parser(argc, argv, keys);
+
+    microbench::Runner runner(parser.get<double>("min_time"), static_cast<size_t>(std::max(1, parser.get<int>("repetitions"))), parser.get<std::string>("filter"));
+    const std::string baselineFile = parser.get<std::string>("baseline");
+    if (!baselineFile.empty() && !runner.ReadBaseline(baselineFile))
+        std::cerr << "Can't read baseline " << baselineFile << std::endl;
+
+    cv::RNG rng(static_cast<uint64>(parser.get<double>("seed")));
+    const std::vector<size_t> sizes = ParseSizes(parser.get<std::string>("sizes"));
+    constexpr track_t distThres = 0.8f;
+
+    // Solvers
+    AssignmentProblemSolver hungarian;
+    SPSettings spSettings;
+    spSettings.m_distThres = distThres;
+    SPBipart bipart(spSettings);
+    LAPJVSolver lapjv;
+    assignments_t assignment;
+    for (auto kind : { MatrixKind::Random, MatrixKind::Sparse, MatrixKind::Clustered })
+    {
+        for (size_t size : sizes)
+        {
+            const distMatrix_t costMatrix = GenerateMatrix(kind, size, distThres, rng);
+            track_t maxCost = 0;
+            for (size_t row = 0; row < size; ++row)
+            {
+                maxCost = std::max(maxCost, *std::max_element(costMatrix.Row(row), costMatrix.Row(row) + size));
+            }
+            const std::string suffix = std::string("/") + MatrixKindName(kind) + "/" + std::to_string(size);
+
+            runner.Run("Hungarian_optimal" + suffix, [&]()
+            {
+                microbench::DoNotOptimize(hungarian.Solve(costMatrix, size, size, assignment, AssignmentProblemSolver::optimal));
+            });
+            runner.Run("Hungarian_many_forbidden" + suffix, [&]()
+            {
+                microbench::DoNotOptimize(hungarian.Solve(costMatrix, size, size, assignment, AssignmentProblemSolver::many_forbidden_assignments));
+            });
+            runner.Run("Hungarian_without_forbidden" + suffix, [&]()
+            {
+                microbench::DoNotOptimize(hungarian.Solve(costMatrix, size, size, assignment, AssignmentProblemSolver::without_forbidden_assignments));
+            });
+            runner.Run("SPBipart" + suffix, [&]()
+            {
+                bipart.Solve(costMatrix, size, size, assignment, maxCost, nullptr);
+                microbench::DoNotOptimize(assignment);
+            });
+            runner.Run("LAPJV" + suffix, [&]()
+            {
+                microbench::DoNotOptimize(lapjv.Solve(costMatrix, size, size, assignment, distThres));
+            });
+        }
+    }
+
+    // Distance kernels: the time per pair of the track and region
+    constexpr size_t regionsCount = 1024;
+    regions_t regions;
+    regions.reserve(regionsCount);
+    for (size_t i = 0; i < regionsCount; ++i)
+    {
+        regions.push_back(RandomRegion(rng));
+    }
+    {
+        std::unique_ptr<CTrack> track = CreateTrack(RandomRegion(rng), cv::Mat(), cv::Mat(), false);
+        track_t sum = 0;
+        runner.Run("CTrack::CalcDistCenter", [&]()
+        {
+            for (const auto& region : regions)
+            {
+                sum += track->CalcDistCenter(region);
+            }
+            microbench::DoNotOptimize(sum);
+        }, regionsCount);
+        runner.Run("CTrack::CalcDistRect", [&]()
+        {
+            for (const auto& region : regions)
+            {
+                sum += track->CalcDistRect(region);
+            }
+            microbench::DoNotOptimize(sum);
+        }, regionsCount);
+        runner.Run("CTrack::CalcDistJaccard", [&]()
+        {
+            for (const auto& region : regions)
+            {
+                sum += track->CalcDistJaccard(region);
+            }
+            microbench::DoNotOptimize(sum);
+        }, regionsCount);
+    }
+    {
+        constexpr size_t histsCount = 64;
+        std::vector<RegionEmbedding> hists(histsCount);
+        for (auto& hist : hists)
+        {
+            hist.m_hist = cv::Mat(1, 64, CV_32FC1);
+            rng.fill(hist.m_hist, cv::RNG::UNIFORM, 0.f, 1.f);
+            RegionHistograms::SqrtNormalize(hist.m_hist);
+        }
+        std::unique_ptr<CTrack> track = CreateTrack(RandomRegion(rng), cv::Mat(), hists.front().m_hist, false);
+        track_t sum = 0;
+        runner.Run("CTrack::CalcDistHist/64", [&]()
+        {
+            for (const auto& hist : hists)
+            {
+                sum += track->CalcDistHist(hist);
+            }
+            microbench::DoNotOptimize(sum);
+        }, histsCount);
+    }
+    for (int embeddingSize : { 128, 512, 2048 })
+    {
+        constexpr size_t embeddingsCount = 64;
+        std::vector<RegionEmbedding> embeddings(embeddingsCount);
+        for (auto& embedding : embeddings)
+        {
+            embedding.m_embedding = RandomEmbedding(rng, embeddingSize);
+            embedding.m_embDot = embedding.m_embedding.dot(embedding.m_embedding);
+        }
+        for (bool fp16 : { false, true })
+        {
+            std::unique_ptr<CTrack> track = CreateTrack(RandomRegion(rng), RandomEmbedding(rng, embeddingSize), cv::Mat(), fp16);
+            track_t sum = 0;
+            runner.Run(std::string("CTrack::CalcCosine/") + (fp16 ? "fp16/" : "fp32/") + std::to_string(embeddingSize), [&]()
+            {
+                for (const auto& embedding : embeddings)
+                {
+                    sum += track->CalcCosine(embedding).value_or(1.f);
+                }
+                microbench::DoNotOptimize(sum);
+            }, embeddingsCount);
+        }
+    }
+
+    const std::string outFile = parser.get<std::string>("out");
+    if (!outFile.empty() && !runner.WriteCsv(outFile))
+        std::cerr << "Can't write " << outFile << std::endl;
+
+    std::cout << "Correct exit" << std::endl;
+    return 0;
+}